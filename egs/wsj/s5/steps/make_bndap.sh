@@ -12,6 +12,7 @@ bndap_config=conf/bndap.conf
 frame_length=40
 #f0_frame_length=25
 compress=false
+minmax=false  # also write the global minmax stats to $data/bndap_minmax.mat
 # End configuration section.
 
 echo "$0 $@"  # Print the command line for logging
@@ -90,7 +91,10 @@ else
 fi
 
 #output="ark,t:| awk '(\$2 == \"[\"){print}(\$2 != \"[\"){if (\$NF == \"]\") {end=1; NF=NF-1}; for (i = 1; i <= NF; i++) if (\$i >= 0.0) printf \"0.0 \" ; else printf \"%f \", 20 * (\$i) / log(10); if (end) printf \"]\n\"; else printf \"\n\"; end = 0}'"
-bndap_feats="ark,s,cs:compute-aperiodic-feats --frame-length=$frame_length --config=$bndap_config $in_feats scp:$pitch_scp ark:- |"
+minmax_opt=
+$minmax && minmax_opt="--minmax-stats=$bndapdir/minmax_$name.JOB.mat"
+
+bndap_feats="ark,s,cs:compute-aperiodic-feats $minmax_opt --frame-length=$frame_length --config=$bndap_config $in_feats scp:$pitch_scp ark:- |"
 
 
 $cmd JOB=1:$nj $logdir/make_bndap.JOB.log \
@@ -110,6 +114,12 @@ for n in $(seq $nj); do
   cat $bndapdir/raw_bndap_$name.$n.scp || exit 1;
 done > $data/bndap_feats.scp
 
+# merge the stats of the jobs, made while extracting the features
+if $minmax; then
+  sum-minmax-stats $(for n in $(seq $nj); do echo $bndapdir/minmax_$name.$n.mat; done) \
+    $data/bndap_minmax.mat 2>$logdir/sum_minmax.log || exit 1;
+fi
+
 rm $logdir/wav_${name}.*.scp  $logdir/segments.* 2>/dev/null
 
 nf=`cat $data/bndap_feats.scp | wc -l` 
@@ -11,6 +11,7 @@ cmd=run.pl
 mcep_config=conf/mcep.conf
 frame_length=30
 compress=false
+minmax=false  # also write the global minmax stats to $data/mcep_minmax.mat
 # End configuration section.
 
 echo "$0 $@"  # Print the command line for logging
@@ -21,7 +22,7 @@ if [ -f path.sh ]; then . ./path.sh; fi
 if [ $# != 3 ]; then
    echo "usage: make_mcep.sh [options] <data-dir> <log-dir> <path-to-mfccdir>";
    echo "options: "
-   echo "  --mcep-config <config-file>                     # config passed to compute-kaldi-mcep-feats "
+   echo "  --mcep-config <config-file>                     # srate, order, alpha and fshift for compute-mcep-feats "
    echo "  --nj <nj>                                        # number of parallel jobs"
    echo "  --cmd (utils/run.pl|utils/queue.pl <queue opts>) # how to run jobs."
    exit 1;
@@ -88,7 +89,18 @@ else
     in_feats="scp,p:$logdir/wav_${name}.JOB.scp"
 fi
 
-mcep_feats="ark,s,cs:compute-mcep-feats.sh --config $mcep_config --frame_length $frame_length $in_feats ark:- |"
+# the config sets shell variables, as it did for the SPTK based
+# compute-mcep-feats.sh
+srate=48000
+order=60
+alpha=0.55
+fshift=5
+. $mcep_config || exit 1;
+
+minmax_opt=
+$minmax && minmax_opt="--minmax-stats=$mcepdir/minmax_$name.JOB.mat"
+
+mcep_feats="ark,s,cs:compute-mcep-feats $minmax_opt --sample-frequency=$srate --frame-shift=$fshift --frame-length=$frame_length --mcep-order=$order --alpha=$alpha $in_feats ark:- |"
 
 
 $cmd JOB=1:$nj $logdir/make_mcep.JOB.log \
@@ -108,6 +120,12 @@ for n in $(seq $nj); do
   cat $mcepdir/raw_mcep_$name.$n.scp || exit 1;
 done > $data/mcep_feats.scp
 
+# merge the stats of the jobs, made while extracting the features
+if $minmax; then
+  sum-minmax-stats $(for n in $(seq $nj); do echo $mcepdir/minmax_$name.$n.mat; done) \
+    $data/mcep_minmax.mat 2>$logdir/sum_minmax.log || exit 1;
+fi
+
 rm $logdir/wav_${name}.*.scp  $logdir/segments.* 2>/dev/null
 
 nf=`cat $data/mcep_feats.scp | wc -l` 
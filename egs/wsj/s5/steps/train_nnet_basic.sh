@@ -31,6 +31,8 @@ ivector_append_tool=append-vector-to-feats # (optional) the tool for appending i
 insplice=
 indelta_opts=
 minmax_opts=
+minmax_stats=       # (optional) global minmax stats of the input features, e.g. from
+                    # --minmax-stats at extraction, saves a pass over the training set
 global_cmvn=
 incmvn_opts="--norm-means=true --norm-vars=true"
 ##
@@ -365,9 +367,20 @@ else
     feature_transform_old=$feature_transform
     feature_transform=${feature_transform%.nnet}_minmax.nnet
     echo "Renormalizing MLP output features using minmax into $feature_transform"
-    nnet-forward $feature_transform_old "$feats_tr" ark:- |\
-      compute-minmax-stats ark:- - 2>$dir/log/minmax_calculation.log | minmax-to-nnet - - |\
-      nnet-concat --binary=false $feature_transform_old - $feature_transform
+    if [ ! -z $minmax_stats ]; then
+      # The splice (or delay) of a plain feature transform only copies frames,
+      # so each copy has the range of the input features
+      [ "$feat_type" != plain -o ! -z "$cmvn_opts" -o ! -z "$delta_opts" -o ! -z "$speak_transform" ] && \
+        echo "$0: --minmax-stats needs plain features without cmvn, deltas or transforms" && exit 1
+      num_copies=$(( $(feat-to-dim "$feats_tr_10k nnet-forward $feature_transform_old ark:- ark:- |" -) / $feat_dim ))
+      echo "# using minmax stats $minmax_stats for $num_copies copies of the input"
+      minmax-to-nnet --num-copies=$num_copies $minmax_stats - 2>$dir/log/minmax_calculation.log |\
+        nnet-concat --binary=false $feature_transform_old - $feature_transform
+    else
+      nnet-forward $feature_transform_old "$feats_tr" ark:- |\
+        compute-minmax-stats ark:- - 2>$dir/log/minmax_calculation.log | minmax-to-nnet - - |\
+        nnet-concat --binary=false $feature_transform_old - $feature_transform
+    fi
   else
     if [ ! -z $global_cmvn ]; then
       # Renormalize the MLP input to zero mean and unit variance,
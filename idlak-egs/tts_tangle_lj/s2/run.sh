@@ -285,13 +285,8 @@ if [ $stage -le 4 ]; then
         # Merge alignment with output from idlak cex front-end => gives you a nice vector
         # NB: for triphone alignment:
         # make-fullctx-ali-dnn  --phone-context=3 --mid-context=1 --max-sil-phone=15 $ali/final.mdl ark:"gunzip -c $ali/ali.*.gz|" ark,t:data/$step/cex.ark ark,t:data/$step/ali
-        make-fullctx-ali-dnn --max-sil-phone=15 $ali/final.mdl ark:"gunzip -c $alifiles|" ark,t:data/$step/cex.ark ark,t:data/$step/ali
-
-
-        # UGLY convert alignment to features
-        cat data/$step/ali \
-	        | awk '{print $1, "["; $1=""; na = split($0, a, ";"); for (i = 1; i < na; i++) print a[i]; print "]"}' \
-	        | copy-feats ark:- ark,scp:$featdir/in_feats_$step.ark,$featdir/in_feats_$step.scp
+        make-fullctx-ali-dnn --max-sil-phone=15 --output-feat=true $ali/final.mdl ark:"gunzip -c $alifiles|" ark,t:data/$step/cex.ark \
+            ark,scp:$featdir/in_feats_$step.ark,$featdir/in_feats_$step.scp
     done
 
     # HACKY
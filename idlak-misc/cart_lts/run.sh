@@ -117,6 +117,11 @@ $phonetisaurus_align --input=$convertedlex --ofile=$alignment --delim="$delim" -
 # Add more Phonetisaurus arguments here if needed
 # Run ./phonetisaurus-align -help in idlak/tools/Phonetisaurus for more options
 
+ltstrain="$HERE/../../src/idlaktxpbin/idlakltstrain"
+if [ -x $ltstrain ]; then
+    echo "##### training LTS rules #####"
+    $ltstrain --num-threads=${nj:-4} $alignment $output
+else
 echo "##### generating cart files #####"
 python3 $HERE/phonet2cart.py -o $tmpdir $alignment
 
@@ -131,5 +136,6 @@ done
 echo "##### generating LTS rules #####"
 
 python3 $HERE/carttree2xml.py -d $tmpdir/$( basename $output .xml )_diagnostics.dat $wagondir $output
+fi
 
 echo "##### done #####"
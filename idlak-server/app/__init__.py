@@ -1,3 +1,4 @@
+import gc
 import logging
 import os
 import sys
@@ -14,10 +15,14 @@ from datetime import datetime
 db = SQLAlchemy()
 api = None
 jwt = JWTManager()
+voice_cache = None
+audio_cache = None
+warmup = None
+worker_pool = None
 
 
 def create_app(config_name):
-    global api, jwt
+    global api, jwt, voice_cache, audio_cache, warmup, worker_pool
     app = Flask(__name__)
     app.config.from_object(Config())
     load_config_file(app.config, config_name)
@@ -67,6 +72,52 @@ def create_app(config_name):
                     sys.exit()
             app.logger.info("Voices from configuration file have been loaded")
 
+        # keep the synthesis voices resident between requests
+        from app.voicecache import VoiceCache
+        voice_cache = VoiceCache(
+            memory_budget=app.config['VOICE_CACHE_MEMORY_MB'] * 1024 * 1024,
+            max_voices=app.config['VOICE_CACHE_MAX_VOICES'],
+            check_interval=app.config['VOICE_CACHE_CHECK_INTERVAL'],
+            batching=app.config['INFERENCE_BATCHING'],
+            max_batch_frames=app.config['INFERENCE_MAX_BATCH_FRAMES'],
+            max_delay=app.config['INFERENCE_MAX_DELAY_MS'] / 1000.,
+            loglvl=app.logger.level)
+        # synthesis results of repeated requests
+        from app.audiocache import AudioCache
+        audio_cache = AudioCache(
+            memory_budget=app.config['AUDIO_CACHE_MEMORY_MB'] * 1024 * 1024,
+            disk_dir=app.config['AUDIO_CACHE_DIR'],
+            disk_budget=app.config['AUDIO_CACHE_DISK_MB'] * 1024 * 1024,
+            redis_url=app.config['AUDIO_CACHE_REDIS_URL'],
+            redis_ttl=app.config['AUDIO_CACHE_REDIS_TTL'])
+        # back-end workers of a coordinator
+        from app.cluster import WorkerPool
+        worker_pool = WorkerPool(
+            app.config['CLUSTER_WORKERS'], app.config['CLUSTER_KEY'],
+            segment_phones=app.config['CLUSTER_SEGMENT_PHONES'],
+            timeout=app.config['CLUSTER_TIMEOUT'],
+            concurrency=app.config['CLUSTER_CONCURRENCY'],
+            logger=app.logger)
+        if app.config['VOICE_PRELOAD']:
+            for voice in Voice.query.all():
+                app.logger.info("Preloading voice {}".format(voice.id))
+                voice_cache.preload([(voice.id, voice.directory)])
+            app.logger.info("Voices have been preloaded")
+            # workers forked from here share the voices' pages until they
+            # are written, keep the garbage collector from touching them
+            if hasattr(gc, 'freeze'):
+                gc.freeze()
+
+        # synthesise on the configured voices before reporting ready
+        from app.warmup import Warmup
+        warmup_voices = []
+        if app.config['VOICE_WARMUP'] and 'VOICE_CONFIG' in app.config:
+            for v in app.config['VOICE_CONFIG']['voices']:
+                sentences = v.get('warmup', [app.config['VOICE_WARMUP_TEXT']])
+                warmup_voices.append((v['vid'], v['dir'], sentences))
+        warmup = Warmup(voice_cache, warmup_voices, app.logger)
+        warmup.start()
+
     # url endpoints
     from app.endpoints.auth import Auth, Auth_Expire
     api.add_resource(Auth, '/auth')
@@ -74,15 +125,25 @@ def create_app(config_name):
     from app.endpoints.language import Languages, Accents
     api.add_resource(Languages, '/languages')
     api.add_resource(Accents, '/languages/<lang_iso>/accents')
-    from app.endpoints.speech import Speech
+    from app.endpoints.speech import Speech, SpeechStream, SpeechSegment
     api.add_resource(Speech, '/speech')
+    api.add_resource(SpeechStream, '/speech/stream')
+    api.add_resource(SpeechSegment, '/speech/segment')
     from app.endpoints.user import Users, Users_Password, Users_Delete, Toggle_Admin
     api.add_resource(Users, '/users')
     api.add_resource(Users_Password, '/users/<user_id>/password')
     api.add_resource(Users_Delete, '/users/<user_id>')
     api.add_resource(Toggle_Admin, '/users/<user_id>/admin')
-    from app.endpoints.voice import Voices, VoiceDetails
+    from app.endpoints.voice import (Voices, VoiceDetails, VoiceLexicon,
+                                     VoiceCacheStats, AudioCacheStats)
     api.add_resource(Voices, '/voices')
     api.add_resource(VoiceDetails, '/voices/<voice_id>')
+    api.add_resource(VoiceLexicon, '/voices/<voice_id>/lexicon')
+    api.add_resource(VoiceCacheStats, '/voicecache')
+    api.add_resource(AudioCacheStats, '/audiocache')
+    from app.endpoints.metrics import Metrics
+    api.add_resource(Metrics, '/metrics')
+    from app.endpoints.health import Health
+    api.add_resource(Health, '/health')
 
     return app
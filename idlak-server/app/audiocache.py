@@ -0,0 +1,300 @@
+# -*- coding: utf-8 -*-
+""" Content addressed cache of synthesis results
+
+    Requests for the same text on the same voice give the same audio, so the
+    encoded audio of a request is cached under a hash of the voice id, the
+    voice version (the fingerprint of its files), the normalised text, the
+    audio format and any synthesis options. Beneath that the front end
+    results (the DNN input features of each spurt) are cached by text, and
+    the waveform of each spurt by a hash of its features, so a templated
+    prompt where one part changed only synthesises the spurts that differ.
+
+    Everything is kept in a memory tier, least recently used entries are
+    evicted once its budget is exceeded. Encoded audio can also be kept in a
+    disk directory or in Redis, which outlive the process and are shared
+    between the server's workers.
+"""
+import array
+import collections
+import hashlib
+import json
+import os
+import tempfile
+import threading
+import unicodedata
+
+
+def normalise_text(text):
+    """ Normalises the text of a request for use in a cache key
+
+        Args:
+            text (str): the text or SSML of the request
+
+        Returns:
+            (str): the text in NFC with runs of whitespace collapsed
+    """
+    return ' '.join(unicodedata.normalize('NFC', text).split())
+
+
+def _hash(*parts):
+    return hashlib.sha256(json.dumps(parts, sort_keys=True).encode('utf-8')
+                          ).hexdigest()
+
+
+def _features_size(features):
+    """ Rough size in bytes of the spurt features of a request """
+    return sum(8 * len(row) + 64 for spurt in features.values()
+               for row in spurt) + 64
+
+
+class _MemoryTier(object):
+    """ LRU of (kind, key) to (value, size in bytes) with a byte budget """
+    def __init__(self, budget):
+        self.budget = budget
+        self.size = 0
+        self._entries = collections.OrderedDict()
+        self._lock = threading.Lock()
+
+    def get(self, kind, key):
+        with self._lock:
+            entry = self._entries.get((kind, key))
+            if entry is None:
+                return None
+            self._entries.move_to_end((kind, key))
+            return entry[0]
+
+    def put(self, kind, key, value, size):
+        if size > self.budget:
+            return
+        with self._lock:
+            old = self._entries.pop((kind, key), None)
+            if old is not None:
+                self.size -= old[1]
+            self._entries[(kind, key)] = (value, size)
+            self.size += size
+            while self.size > self.budget:
+                _, (_, evicted) = self._entries.popitem(last=False)
+                self.size -= evicted
+
+    def count(self, kind):
+        with self._lock:
+            return sum(1 for k, _ in self._entries if k == kind)
+
+
+class _DiskTier(object):
+    """ Encoded audio in files named by key, the oldest files are removed
+        once the total size exceeds the budget (0 for no limit) """
+    def __init__(self, directory, budget=0):
+        self.directory = directory
+        self.budget = budget
+        self._lock = threading.Lock()
+        if not os.path.isdir(directory):
+            os.makedirs(directory)
+        self.size = sum(st.st_size for _, st in self._files())
+
+    def _path(self, key):
+        return os.path.join(self.directory, key[:2], key)
+
+    def _files(self):
+        for root, dirs, files in os.walk(self.directory):
+            for fn in files:
+                try:
+                    yield os.path.join(root, fn), os.stat(os.path.join(root, fn))
+                except OSError:
+                    continue
+
+    def get(self, key):
+        try:
+            with open(self._path(key), 'rb') as fin:
+                return fin.read()
+        except (IOError, OSError):
+            return None
+
+    def put(self, key, audio):
+        path = self._path(key)
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+        # written under a temporary name so other workers never read a
+        # partial file
+        fd, tmp = tempfile.mkstemp(dir=os.path.dirname(path))
+        with os.fdopen(fd, 'wb') as fout:
+            fout.write(audio)
+        os.rename(tmp, path)
+        with self._lock:
+            self.size += len(audio)
+            if self.budget and self.size > self.budget:
+                self._prune()
+
+    def _prune(self):
+        files = sorted(self._files(), key=lambda f: f[1].st_mtime)
+        self.size = sum(st.st_size for _, st in files)
+        for path, st in files:
+            if self.size <= self.budget * 0.9:
+                break
+            try:
+                os.remove(path)
+                self.size -= st.st_size
+            except OSError:
+                continue
+
+
+class _RedisTier(object):
+    """ Encoded audio in Redis, with an expiry time (0 for none) """
+    def __init__(self, url, ttl=0):
+        import redis
+        self._redis = redis.Redis.from_url(url)
+        self._ttl = int(ttl)
+
+    def get(self, key):
+        try:
+            return self._redis.get('idlak:audio:' + key)
+        except Exception:
+            return None
+
+    def put(self, key, audio):
+        try:
+            self._redis.set('idlak:audio:' + key, audio,
+                            ex=self._ttl if self._ttl > 0 else None)
+        except Exception:
+            pass
+
+
+class AudioCache(object):
+    """ Thread safe cache of synthesis results
+
+        Args:
+            memory_budget (int): size in bytes of the memory tier, 0 disables
+                                 the cache
+            disk_dir (str): directory of the disk tier of encoded audio,
+                            empty for none
+            disk_budget (int): size in bytes of the disk tier, 0 for no limit
+            redis_url (str): url of the Redis tier of encoded audio, empty
+                             for none
+            redis_ttl (int): seconds before audio expires from Redis, 0 for
+                             never
+    """
+    def __init__(self, memory_budget=0, disk_dir='', disk_budget=0,
+                 redis_url='', redis_ttl=0):
+        self._memory = _MemoryTier(memory_budget)
+        self._tiers = []
+        if memory_budget and disk_dir:
+            self._tiers.append(('disk', _DiskTier(disk_dir, disk_budget)))
+        if memory_budget and redis_url:
+            self._tiers.append(('redis', _RedisTier(redis_url, redis_ttl)))
+        self._lock = threading.Lock()
+        self._stats = collections.defaultdict(int)
+
+    @property
+    def enabled(self):
+        return self._memory.budget > 0
+
+    def audio_key(self, voice_id, voice_version, text, audio_format,
+                  options=None):
+        """ Gets the key of the encoded audio of a request
+
+            Args:
+                voice_id (str): id of the voice
+                voice_version: anything identifying the voice files
+                text (str): text or SSML of the request
+                audio_format (str): format of the audio
+                options (dict): any other synthesis options
+
+            Returns:
+                (str): the key
+        """
+        return _hash('audio', voice_id, voice_version, normalise_text(text),
+                     audio_format, options or {})
+
+    def get_audio(self, key):
+        """ Gets encoded audio, None if it is not cached """
+        if not self.enabled:
+            return None
+        audio = self._memory.get('audio', key)
+        if audio is not None:
+            self._count('audio', 'memory', True)
+            return audio
+        self._count('audio', 'memory', False)
+        for name, tier in self._tiers:
+            audio = tier.get(key)
+            self._count('audio', name, audio is not None)
+            if audio is not None:
+                self._memory.put('audio', key, audio, len(audio))
+                return audio
+        return None
+
+    def put_audio(self, key, audio):
+        """ Caches encoded audio in all the tiers """
+        if not self.enabled:
+            return
+        self._memory.put('audio', key, audio, len(audio))
+        for _, tier in self._tiers:
+            tier.put(key, audio)
+
+    def get_features(self, voice_id, voice_version, text):
+        """ Gets the spurt features of a text, None if they are not cached """
+        if not self.enabled:
+            return None
+        features = self._memory.get(
+            'features', _hash('features', voice_id, voice_version,
+                              normalise_text(text)))
+        self._count('features', 'memory', features is not None)
+        return features
+
+    def put_features(self, voice_id, voice_version, text, features):
+        """ Caches the spurt features of a text (which must not be changed
+            afterwards) """
+        if not self.enabled:
+            return
+        self._memory.put('features',
+                         _hash('features', voice_id, voice_version,
+                               normalise_text(text)),
+                         features, _features_size(features))
+
+    def spurt_key(self, voice_id, voice_version, spurt_features):
+        """ Gets the key of the waveform of a spurt from its DNN input
+            features """
+        h = hashlib.sha256(_hash('spurt', voice_id, voice_version
+                                 ).encode('utf-8'))
+        for row in spurt_features:
+            h.update(array.array('d', row).tobytes())
+            h.update(b'\n')
+        return h.hexdigest()
+
+    def get_spurt(self, key):
+        """ Gets the waveform of a spurt, None if it is not cached """
+        if not self.enabled:
+            return None
+        samples = self._memory.get('spurt', key)
+        self._count('spurt', 'memory', samples is not None)
+        return None if samples is None else samples.tolist()
+
+    def put_spurt(self, key, waveform):
+        """ Caches the waveform of a spurt """
+        if not self.enabled:
+            return
+        samples = array.array('d', waveform)
+        self._memory.put('spurt', key, samples,
+                         samples.itemsize * len(samples) + 64)
+
+    def stats(self):
+        """ Gets the cache metrics
+
+            Returns:
+                (dict): hits and misses by kind (audio, features, spurt) and
+                        tier, the number of entries of each kind and the
+                        bytes used in memory
+        """
+        with self._lock:
+            counts = dict(self._stats)
+        ret = {'enabled': self.enabled, 'memory': self._memory.size,
+               'memory_budget': self._memory.budget, 'hits': {},
+               'misses': {}, 'entries': {}}
+        for (kind, tier, hit), n in counts.items():
+            ret['hits' if hit else 'misses']['{0}_{1}'.format(kind, tier)] = n
+        for kind in ('audio', 'features', 'spurt'):
+            ret['entries'][kind] = self._memory.count(kind)
+        return ret
+
+    def _count(self, kind, tier, hit):
+        with self._lock:
+            self._stats[(kind, tier, hit)] += 1
@@ -0,0 +1,259 @@
+# -*- coding: utf-8 -*-
+""" Synthesis of long documents across a pool of worker servers
+
+    A server with CLUSTER_WORKERS set is a coordinator: it runs the front end
+    of a request itself, splits the spurts of the processed document into
+    segments of consecutive spurts and posts each segment's DNN input
+    features to ```/speech/segment``` on the workers, which synthesise them
+    and return the waveforms. The segments are handed back in document
+    order, each as soon as it and all before it are done, so the audio can
+    be streamed while the later segments are still being synthesised.
+
+    Workers are ordinary servers with CLUSTER_KEY set to the coordinator's
+    key and the same voices. A segment that fails on one worker is tried on
+    the others and, if they all fail, synthesised locally. Spurts in the
+    coordinator's audio cache are not sent, and the waveforms returned are
+    added to it.
+
+    Segments are sent in a binary form: a big endian length, a JSON header
+    with the spurt ids and the shape of each spurt's features, then the
+    feature values (or waveform samples) as little endian doubles.
+"""
+import array
+import collections
+import concurrent.futures
+import itertools
+import json
+import struct
+import sys
+import threading
+
+import requests
+
+KEY_HEADER = 'X-Idlak-Cluster-Key'
+SIZE_HEADER = 'X-Idlak-Voice-Size'
+CONTENT_TYPE = 'application/x-idlak-segment'
+
+
+def _pack(header, values):
+    header = json.dumps(header).encode('utf-8')
+    if sys.byteorder != 'little':
+        values.byteswap()
+    return struct.pack('>I', len(header)) + header + values.tobytes()
+
+
+def _unpack(data):
+    length, = struct.unpack('>I', data[:4])
+    header = json.loads(data[4:4 + length].decode('utf-8'))
+    values = array.array('d')
+    values.frombytes(data[4 + length:])
+    if sys.byteorder != 'little':
+        values.byteswap()
+    return header, values
+
+
+def encode_features(features):
+    """ Serialises the DNN input features of spurts
+
+        Args:
+            features (OrderedDict): spurt id to its rows of features
+
+        Returns:
+            (bytes): the segment
+    """
+    header = []
+    values = array.array('d')
+    for spurtid, rows in features.items():
+        width = len(rows[0]) if rows else 0
+        header.append([spurtid, len(rows), width])
+        for row in rows:
+            if len(row) != width:
+                raise ValueError('Spurt {} has rows of different lengths'
+                                 .format(spurtid))
+            values.extend(row)
+    return _pack(header, values)
+
+
+def decode_features(data):
+    """ Inverse of encode_features """
+    header, values = _unpack(data)
+    features = collections.OrderedDict()
+    offset = 0
+    for spurtid, nrows, width in header:
+        rows = []
+        for _ in range(nrows):
+            rows.append(values[offset:offset + width].tolist())
+            offset += width
+        features[spurtid] = rows
+    if offset != len(values):
+        raise ValueError('Segment is {} values long, expected {}'
+                         .format(len(values), offset))
+    return features
+
+
+def encode_waveforms(waveforms):
+    """ Serialises the waveforms of spurts
+
+        Args:
+            waveforms (OrderedDict): spurt id to its samples
+
+        Returns:
+            (bytes): the segment
+    """
+    header = []
+    values = array.array('d')
+    for spurtid, waveform in waveforms.items():
+        header.append([spurtid, len(waveform)])
+        values.extend(waveform)
+    return _pack(header, values)
+
+
+def decode_waveforms(data):
+    """ Inverse of encode_waveforms """
+    header, values = _unpack(data)
+    waveforms = collections.OrderedDict()
+    offset = 0
+    for spurtid, length in header:
+        waveforms[spurtid] = values[offset:offset + length].tolist()
+        offset += length
+    if offset != len(values):
+        raise ValueError('Segment is {} samples long, expected {}'
+                         .format(len(values), offset))
+    return waveforms
+
+
+def split_segments(features, max_phones):
+    """ Splits spurts into segments of consecutive spurts
+
+        Args:
+            features (OrderedDict): spurt id to its rows of features
+            max_phones (int): a segment is closed once it has this many
+                              rows, a longer spurt is a segment of its own
+
+        Returns:
+            (list): OrderedDicts of the spurts of each segment, in order
+    """
+    segments = []
+    segment, size = collections.OrderedDict(), 0
+    for spurtid, rows in features.items():
+        if segment and size + len(rows) > max_phones:
+            segments.append(segment)
+            segment, size = collections.OrderedDict(), 0
+        segment[spurtid] = rows
+        size += len(rows)
+    if segment:
+        segments.append(segment)
+    return segments
+
+
+class WorkerPool(object):
+    """ The worker servers of a coordinator
+
+        Args:
+            workers (list): base urls of the workers, none if this is not a
+                            coordinator
+            key (str): shared key sent to the workers
+            segment_phones (int): phones of a segment, see split_segments
+            timeout (float): seconds to wait for a worker's response
+            concurrency (int): segments sent to each worker at a time
+            logger: where failing workers are reported
+    """
+    def __init__(self, workers, key, segment_phones=400, timeout=60.,
+                 concurrency=1, logger=None):
+        self.workers = [w.rstrip('/') for w in workers]
+        self.key = key
+        self.segment_phones = segment_phones
+        self.timeout = timeout
+        self.logger = logger
+        self._next = itertools.cycle(range(max(1, len(self.workers))))
+        self._lock = threading.Lock()
+        self._session = requests.Session()
+        self._executor = concurrent.futures.ThreadPoolExecutor(
+            max_workers=max(1, len(self.workers) * max(1, concurrency)))
+        self._counts = collections.Counter()
+
+    @property
+    def enabled(self):
+        return bool(self.workers)
+
+    def _post(self, worker, voice_id, voice_size, data):
+        resp = self._session.post(
+            worker + '/speech/segment', params={'voice_id': voice_id},
+            data=data, timeout=self.timeout,
+            headers={KEY_HEADER: self.key, SIZE_HEADER: str(voice_size),
+                     'Content-Type': CONTENT_TYPE})
+        resp.raise_for_status()
+        return decode_waveforms(resp.content)
+
+    def synthesiser(self, voice_id, voice_size, local):
+        """ Gets a function which synthesises spurts on the workers
+
+            The spurts are sent to the next worker in turn, then to the
+            others if it fails, and are synthesised by local if they all do.
+
+            Args:
+                voice_id (str): id of the voice, which the workers must have
+                voice_size (int): size of the voice's files, workers whose
+                                  files differ refuse the spurts
+                local (function): synthesises an OrderedDict of spurt id to
+                                  features here
+
+            Returns:
+                (function): OrderedDict of spurt id to features to the
+                            OrderedDict of spurt id to waveform
+        """
+        def synthesise(features):
+            data = encode_features(features)
+            with self._lock:
+                first = next(self._next)
+            for i in range(len(self.workers)):
+                worker = self.workers[(first + i) % len(self.workers)]
+                try:
+                    waveforms = self._post(worker, voice_id, voice_size, data)
+                    if list(waveforms) != list(features):
+                        raise ValueError('Worker returned the wrong spurts')
+                    self._count(worker, True)
+                    return waveforms
+                except (requests.RequestException, ValueError) as e:
+                    self._count(worker, False)
+                    if self.logger is not None:
+                        self.logger.warning('Segment failed on worker {}: {}'
+                                            .format(worker, e))
+            self._count('local', True)
+            return local(features)
+        return synthesise
+
+    def map_ordered(self, func, segments):
+        """ Runs func on each segment concurrently
+
+            A generator of the results in the order of the segments, each is
+            yielded as soon as it and those before it are done, while later
+            segments are still running. Closing the generator cancels the
+            segments which have not started.
+        """
+        futures = [self._executor.submit(func, segment)
+                   for segment in segments]
+        try:
+            for future in futures:
+                yield future.result()
+        finally:
+            for future in futures:
+                future.cancel()
+
+    def _count(self, worker, ok):
+        with self._lock:
+            self._counts[(worker, 'ok' if ok else 'failed')] += 1
+
+    def stats(self):
+        """ Gets the segments sent to each worker
+
+            Returns:
+                (dict): worker url (or local) to the numbers of segments it
+                        synthesised and failed
+        """
+        with self._lock:
+            stats = {}
+            for (worker, outcome), count in self._counts.items():
+                stats.setdefault(worker, {'ok': 0, 'failed': 0})
+                stats[worker][outcome] = count
+            return stats
@@ -1 +1 @@
-from app.endpoints import user, auth, voice, speech, language
+from app.endpoints import user, auth, voice, speech, language, metrics, health
@@ -0,0 +1,19 @@
+# -*- coding: utf-8 -*-
+from flask_restful import Resource
+import app as idlakapp
+
+
+class Health(Resource):
+    """ Class for the readiness endpoint, not authenticated so that load
+        balancers can poll it """
+
+    def get(self):
+        """ Health endpoint
+
+            Returns:
+                dict: the state of the voice warm up, the voices warmed up
+                      and any errors, with status 200 once the server is
+                      ready and 503 before
+        """
+        status = idlakapp.warmup.status()
+        return status, (200 if status['status'] == 'ready' else 503)
@@ -0,0 +1,91 @@
+# -*- coding: utf-8 -*-
+from app.middleware.auth import admin_required, not_expired
+from app.voicecache import TangleVoice  # noqa, puts pyIdlak on the path
+from flask_jwt_simple import jwt_required
+from flask import current_app, Response
+from flask_restful import Resource
+from pyIdlak import txp
+import app as idlakapp
+
+
+def _batching_metrics():
+    """ Prometheus text for the inference batchers of the resident voices """
+    metrics = [
+        ('queue_depth', 'gauge', 'Forward passes waiting to be batched'),
+        ('max_queue_depth', 'gauge', 'Most forward passes waiting at once'),
+        ('batches', 'counter', 'Batches run'),
+        ('requests', 'counter', 'Forward passes run in batches'),
+        ('frames', 'counter', 'Frames run in batches'),
+        ('queue_time', 'counter', 'Seconds forward passes waited for a batch'),
+        ('forward_time', 'counter', 'Seconds spent running batches'),
+    ]
+    voices = [v for v in idlakapp.voice_cache.stats()['voices'] if v['batching']]
+    lines = []
+    for key, kind, text in metrics:
+        name = 'idlak_batch_' + key
+        if kind == 'counter':
+            name += '_total'
+        lines.append('# HELP {0} {1}'.format(name, text))
+        lines.append('# TYPE {0} {1}'.format(name, kind))
+        for v in voices:
+            for model, stats in sorted(v['batching'].items()):
+                lines.append('{0}{{voice="{1}",model="{2}"}} {3}'.format(
+                    name, v['id'], model, stats[key]))
+    return '\n'.join(lines) + '\n'
+
+
+def _audio_cache_metrics():
+    """ Prometheus text for the cache of synthesis results """
+    stats = idlakapp.audio_cache.stats()
+    lines = []
+    for key, text in (('hits', 'Cache lookups which were found'),
+                      ('misses', 'Cache lookups which were not found')):
+        name = 'idlak_audio_cache_{0}_total'.format(key)
+        lines.append('# HELP {0} {1}'.format(name, text))
+        lines.append('# TYPE {0} counter'.format(name))
+        for kind_tier, n in sorted(stats[key].items()):
+            kind, tier = kind_tier.split('_', 1)
+            lines.append('{0}{{kind="{1}",tier="{2}"}} {3}'.format(
+                name, kind, tier, n))
+    lines.append('# HELP idlak_audio_cache_entries Entries in the memory tier')
+    lines.append('# TYPE idlak_audio_cache_entries gauge')
+    for kind, n in sorted(stats['entries'].items()):
+        lines.append('idlak_audio_cache_entries{{kind="{0}"}} {1}'.format(
+            kind, n))
+    lines.append('# HELP idlak_audio_cache_bytes Bytes used by the memory tier')
+    lines.append('# TYPE idlak_audio_cache_bytes gauge')
+    lines.append('idlak_audio_cache_bytes {0}'.format(stats['memory']))
+    return '\n'.join(lines) + '\n'
+
+
+def _cluster_metrics():
+    """ Prometheus text for the segments sent to the cluster workers """
+    stats = idlakapp.worker_pool.stats()
+    lines = ['# HELP idlak_cluster_segments_total Segments synthesised by '
+             'each worker, local when all the workers failed',
+             '# TYPE idlak_cluster_segments_total counter']
+    for worker, counts in sorted(stats.items()):
+        for outcome, n in sorted(counts.items()):
+            lines.append('idlak_cluster_segments_total{{worker="{0}",'
+                         'outcome="{1}"}} {2}'.format(worker, outcome, n))
+    return '\n'.join(lines) + '\n'
+
+
+class Metrics(Resource):
+    """ Class for the synthesis stage timings endpoint """
+    decorators = ([admin_required, not_expired, jwt_required]
+                  if current_app.config['AUTHORIZATION'] else [])
+
+    def get(self):
+        """ Metrics endpoint
+
+            Returns:
+                Prometheus text: calls, seconds and items processed by each
+                synthesis stage and the seconds of audio synthesised since
+                the server started, the queues of the inference batchers and
+                the hits and misses of the synthesis result cache and the
+                segments sent to the cluster workers
+        """
+        return Response(txp.stagestats.prometheus() + _batching_metrics() +
+                        _audio_cache_metrics() + _cluster_metrics(),
+                        mimetype='text/plain; version=0.0.4')
@@ -1,62 +1,154 @@
 # -*- coding: utf-8 -*-
+import collections
+import hmac
+import struct
 import subprocess
 import sys
 import os
-import uuid
 import time
-import shutil
-import wave
-import struct
-from app import db, api, jwt, reqparser
+from app import db, api, jwt, reqparser, cluster
+import app as idlakapp
+from app.voicecache import TangleVoice  # noqa, puts pyIdlak on the path
 from app.respmsg import mk_response
 from app.middleware.auth import not_expired
-from flask import send_from_directory, current_app
+from flask import send_from_directory, current_app, Response, stream_with_context
 from flask_restful import Resource, abort, request
 from flask_jwt_simple import jwt_required
 from app.models.voice import Voice
-
-idlakdir = os.path.dirname(os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
-
-sys.path.append(os.path.join(idlakdir, 'src'))
-from pyIdlak import TangleVoice         # noqa
+from pyIdlak import vocoder
 
 spch_parser = reqparser.RequestParser()
 spch_parser.add_argument('voice_id', help='Provide a voice id',
                          location='json', required=True)
-spch_parser.add_argument('audio_format', choices=['wav', 'ogg', 'mp3'],
-                         help='Valid choices: wav|ogg|mp3, default=wav',
+spch_parser.add_argument('audio_format', choices=['wav', 'ogg', 'opus', 'mp3'],
+                         help='Valid choices: wav|ogg|opus|mp3, default=wav',
                          location='json', default='wav')
 spch_parser.add_argument('text', help='Provide a text to syntesise speech',
                          location='json', required=True)
 
 
-def _convert_to(audio_format, filename):
-    """ Converts a wav audio file into a provided audio format
+def _encode(audio_format, waveform, srate):
+    """ Encodes a waveform in memory
+
+        Formats which pyIdlak was built without are converted from wav by
+        ffmpeg through pipes
 
         Args:
-            audio_format (str): format of audio (assuming correct - ogg|mp3)
-            filename (str): path of the file with its name
-                            (assuming has extension of wav file)
+            audio_format (str): format of audio (assuming correct)
+            waveform (list): samples on the 16 bit scale
+            srate (int): sample rate of the waveform
 
         Returns:
-            (str): filename of the converted file
+            (bytes): the audio file
     """
-    new_filename = filename[:-3] + audio_format
-    command = "ffmpeg -nostats -loglevel 0 -i {} {}".format(filename, new_filename)
-    return_code = subprocess.call(command, shell=True)
-    return new_filename
+    if audio_format in vocoder.encoder.formats():
+        return vocoder.encode(audio_format, waveform, srate)
+    wav = vocoder.encode('wav', waveform, srate)
+    command = ['ffmpeg', '-nostats', '-loglevel', '0', '-f', 'wav',
+               '-i', 'pipe:0', '-f', audio_format, 'pipe:1']
+    return subprocess.run(command, input=wav, stdout=subprocess.PIPE,
+                          check=True).stdout
+
+
+def _spurt_features(voice_id, voice_dir, version, text):
+    """ Gets the DNN input features of each spurt of the text, from the
+        cache if the text has been seen before """
+    features = idlakapp.audio_cache.get_features(voice_id, version, text)
+    if features is None:
+        with idlakapp.voice_cache.acquire(voice_id, voice_dir) as tanglevoice:
+            features = tanglevoice.spurt_features(text)
+        idlakapp.audio_cache.put_features(voice_id, version, text, features)
+    return features
+
 
+def _local_synthesiser(voice_id, voice_dir):
+    """ Gets a function which synthesises spurts on the resident voice """
+    def synthesise(features):
+        with idlakapp.voice_cache.acquire(voice_id, voice_dir,
+                                          synthesis=True) as tanglevoice:
+            return tanglevoice.synthesise_features(features, by_spurt=True)
+    return synthesise
 
-def _wav_to_file(waveform, fn, srate=48000):
-    wav = wave.open(fn, 'wb')
-    wav.setnchannels(1)
-    wav.setsampwidth(2)
-    wav.setframerate(srate)
-    for w in waveform:
-        wout = int(max(min(w, 0x7fff), (-0x7fff - 1)))  # ensures in range
-        write_data = struct.pack("<h", wout)
-        wav.writeframes(write_data)
-    wav.close()
+
+def _synthesise_spurts(voice_id, voice_dir, version, features,
+                       synthesiser=None):
+    """ Synthesises the spurts which are not in the cache together
+
+        Args:
+            synthesiser (function, optional): synthesises the missing spurts,
+                                              on the resident voice by default
+
+        Returns:
+            (OrderedDict): spurt id to its waveform
+    """
+    cache = idlakapp.audio_cache
+    keys = collections.OrderedDict(
+        (spurtid, cache.spurt_key(voice_id, version, spurtfeatures))
+        for spurtid, spurtfeatures in features.items())
+    waveforms = {}
+    missing = collections.OrderedDict()
+    for spurtid, spurtfeatures in features.items():
+        waveforms[spurtid] = cache.get_spurt(keys[spurtid])
+        if waveforms[spurtid] is None:
+            missing[spurtid] = spurtfeatures
+    if missing:
+        if synthesiser is None:
+            synthesiser = _local_synthesiser(voice_id, voice_dir)
+        synthesised = synthesiser(missing)
+        for spurtid, waveform in synthesised.items():
+            cache.put_spurt(keys[spurtid], waveform)
+            waveforms[spurtid] = waveform
+    return collections.OrderedDict((spurtid, waveforms[spurtid])
+                                   for spurtid in features)
+
+
+def _synthesise(voice_id, voice_dir, version, features):
+    """ Synthesises the spurts which are not in the cache together and puts
+        the waveform together with the cached ones
+
+        Returns:
+            (list): the waveform
+            (int): sample rate of the waveform
+    """
+    waveforms = _synthesise_spurts(voice_id, voice_dir, version, features)
+    srate = idlakapp.voice_cache.get(voice_id, voice_dir).srate
+    waveform = []
+    for spurtwaveform in waveforms.values():
+        waveform.extend(spurtwaveform)
+    return waveform, srate
+
+
+def _synthesise_segments(voice_id, voice_dir, version, features):
+    """ Synthesises the spurts a segment at a time
+
+        On a coordinator the segments are synthesised concurrently on the
+        cluster workers, otherwise each spurt is a segment synthesised here
+        when the one before it has been consumed.
+
+        Returns:
+            generator of the waveform (list) of each segment in order
+    """
+    pool = idlakapp.worker_pool
+    if not pool.enabled:
+        for spurtid, spurtfeatures in features.items():
+            waveform, _ = _synthesise(
+                voice_id, voice_dir, version,
+                collections.OrderedDict([(spurtid, spurtfeatures)]))
+            yield waveform
+        return
+    remote = pool.synthesiser(voice_id, version[0],
+                              _local_synthesiser(voice_id, voice_dir))
+
+    def synthesise(segment):
+        waveform = []
+        for spurtwaveform in _synthesise_spurts(voice_id, voice_dir, version,
+                                                segment, remote).values():
+            waveform.extend(spurtwaveform)
+        return waveform
+
+    segments = cluster.split_segments(features, pool.segment_phones)
+    for waveform in pool.map_ordered(synthesise, segments):
+        yield waveform
 
 
 class Speech(Resource):
@@ -82,24 +174,123 @@ class Speech(Resource):
         if voice is None:
             return mk_response("Voice could not be found", 400)
 
-        # creating syntesised speech and saving into file
-        tanglevoice = TangleVoice(voice_dir=os.path.abspath(voice.directory),
-                                  loglvl=current_app.logger.level)
-        audio_fn = os.path.abspath(uuid.uuid4().hex[:8] + '.wav')
-        waveform = tanglevoice.speak(args['text'])
-        _wav_to_file(waveform, audio_fn)
-
-        # convert to requested type
-        if 'audio_format' in args and args['audio_format'] != "wav":
-            old_audio_fn = audio_fn
-            audio_fn = _convert_to(args['audio_format'], audio_fn)
-            os.remove(old_audio_fn)
-        elif 'audio_format' not in args:
+        # synthesise the speech and encode it in the requested format
+        if 'audio_format' not in args:
             args['audio_format'] = "wav"
-        # get the audio as bytes, delete the file and return audio as bytes
-        with open(audio_fn, 'rb') as audio_f:
-            wavefile = b''.join(audio_f.readlines())
-        os.remove(audio_fn)
-        response = current_app.make_response(wavefile)
+        # repeated prompts are returned from the cache without synthesis
+        version = idlakapp.voice_cache.version(voice.id, voice.directory)
+        key = idlakapp.audio_cache.audio_key(voice.id, version, args['text'],
+                                             args['audio_format'])
+        audio = idlakapp.audio_cache.get_audio(key)
+        cached = audio is not None
+        if not cached:
+            features = _spurt_features(voice.id, voice.directory, version,
+                                       args['text'])
+            if idlakapp.worker_pool.enabled:
+                waveform = []
+                for segment in _synthesise_segments(
+                        voice.id, voice.directory, version, features):
+                    waveform.extend(segment)
+                srate = idlakapp.voice_cache.get(voice.id,
+                                                 voice.directory).srate
+            else:
+                waveform, srate = _synthesise(voice.id, voice.directory,
+                                              version, features)
+            audio = _encode(args['audio_format'], waveform, srate)
+            idlakapp.audio_cache.put_audio(key, audio)
+        response = current_app.make_response(audio)
         response.headers['Content-Type'] = 'audio/' + args['audio_format']
+        response.headers['X-Idlak-Cache'] = 'hit' if cached else 'miss'
+        return response
+
+
+class SpeechStream(Resource):
+    decorators = ([not_expired, jwt_required]
+                  if current_app.config['AUTHORIZATION'] else [])
+
+    def post(self):
+        """ Streaming speech endpoint
+
+            Args:
+                voice_id (str): id of the voice
+                audio_format (str, optional): wav|ogg|opus|mp3
+                text (str): text to process
+
+            Returns:
+                chunked audio, sent a spurt at a time as each is synthesised
+                (a segment at a time on a coordinator)
+        """
+        args = spch_parser.parse_args()
+        if isinstance(args, current_app.response_class):
+            return args
+        voice = Voice.query.filter_by(id=args['voice_id']).first()
+        if voice is None:
+            return mk_response("Voice could not be found", 400)
+        if 'audio_format' not in args:
+            args['audio_format'] = "wav"
+        if args['audio_format'] not in vocoder.encoder.formats():
+            return mk_response("Audio format cannot be streamed", 400)
+
+        voice_id, voice_dir = voice.id, voice.directory
+        version = idlakapp.voice_cache.version(voice_id, voice_dir)
+        features = _spurt_features(voice_id, voice_dir, version, args['text'])
+        srate = idlakapp.voice_cache.get(voice_id, voice_dir).srate
+        encoder = vocoder.AudioEncoder(args['audio_format'], srate)
+
+        def generate():
+            # the next spurt is only synthesised once the previous chunk has
+            # been written, and the voice is only held while synthesising so
+            # a slow client does not block other requests for it. On a
+            # coordinator the workers synthesise ahead of the client. If the
+            # client disconnects the generator is closed and synthesis stops
+            try:
+                for waveform in _synthesise_segments(voice_id, voice_dir,
+                                                     version, features):
+                    yield encoder.encode(waveform)
+                yield encoder.flush()
+            except GeneratorExit:
+                current_app.logger.info("Speech stream closed by the client")
+                raise
+
+        return Response(stream_with_context(generate()),
+                        mimetype='audio/' + args['audio_format'])
+
+
+class SpeechSegment(Resource):
+    """ Class for the endpoint cluster workers synthesise segments on,
+        authenticated by the cluster key rather than a token """
+
+    def post(self):
+        """ Segment synthesis endpoint
+
+            Args:
+                voice_id (str): id of the voice, in the query string
+                body: the DNN input features of the spurts, encoded by
+                      cluster.encode_features
+
+            Returns:
+                the waveforms of the spurts, encoded by
+                cluster.encode_waveforms
+        """
+        key = current_app.config['CLUSTER_KEY']
+        given = request.headers.get(cluster.KEY_HEADER, '')
+        if not key or not hmac.compare_digest(given.encode('utf-8'),
+                                              key.encode('utf-8')):
+            return mk_response("Cluster key is incorrect", 403)
+        voice = Voice.query.filter_by(id=request.args.get('voice_id')).first()
+        if voice is None:
+            return mk_response("Voice could not be found", 400)
+        version = idlakapp.voice_cache.version(voice.id, voice.directory)
+        if request.headers.get(cluster.SIZE_HEADER) != str(version[0]):
+            return mk_response("Voice files differ from the coordinator's",
+                               409)
+        try:
+            features = cluster.decode_features(request.get_data())
+        except (ValueError, TypeError, struct.error, UnicodeDecodeError):
+            return mk_response("Segment could not be decoded", 400)
+        waveforms = _synthesise_spurts(voice.id, voice.directory, version,
+                                       features)
+        response = current_app.make_response(
+            cluster.encode_waveforms(waveforms))
+        response.headers['Content-Type'] = cluster.CONTENT_TYPE
         return response
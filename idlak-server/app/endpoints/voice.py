@@ -1,7 +1,10 @@
 import json
 from app import api, jwt, db, reqparser
+import app as idlakapp
 from app.respmsg import mk_response
 from app.models.voice import Voice
+from app.middleware.auth import admin_required, not_expired
+from flask_jwt_simple import jwt_required
 from flask import current_app
 from flask_restful import Resource, abort, request
 from datetime import date
@@ -13,6 +16,13 @@ vcs_parser.add_argument('accent', location='json')
 vcs_parser.add_argument('gender', choices=['male', 'female'],
                         help='Valid choices: male|female', location='json')
 
+lex_parser = reqparser.RequestParser()
+lex_parser.add_argument('word', required=True, help='Provide a word',
+                        location='json')
+lex_parser.add_argument('entry', location='json')
+lex_parser.add_argument('pron', location='json')
+lex_parser.add_argument('default', type='Bool', location='json')
+
 
 class Voices(Resource):
     """ Class for Voices enpoint """
@@ -69,3 +79,100 @@ class VoiceDetails(Resource):
         if voice is None:
             return mk_response("Voice could not be found", 404)
         return voice.to_dict()
+
+
+class VoiceCacheStats(Resource):
+    """ Class for the resident voice cache endpoint """
+    decorators = ([admin_required, not_expired, jwt_required]
+                  if current_app.config['AUTHORIZATION'] else [])
+
+    def get(self):
+        """ Voice cache endpoint
+
+            Returns:
+                dict: hit, miss, load and eviction counts, total load time
+                      in seconds and the currently resident voices
+        """
+        return idlakapp.voice_cache.stats()
+
+
+class AudioCacheStats(Resource):
+    """ Class for the synthesis result cache endpoint """
+    decorators = ([admin_required, not_expired, jwt_required]
+                  if current_app.config['AUTHORIZATION'] else [])
+
+    def get(self):
+        """ Audio cache endpoint
+
+            Returns:
+                dict: hits and misses of the audio, front end and spurt
+                      caches by tier, the number of entries and the memory
+                      used
+        """
+        return idlakapp.audio_cache.stats()
+
+
+class VoiceLexicon(Resource):
+    """ Class for the user lexicon endpoint of a voice """
+    decorators = ([admin_required, not_expired, jwt_required]
+                  if current_app.config['AUTHORIZATION'] else [])
+
+    def get(self, voice_id):
+        """ User lexicon endpoint
+
+            Args:
+                voice_id (str): voice id
+            Returns:
+                dict: the user lexicon changes made to the voice by this
+                      worker, in order, pron is null for removals
+        """
+        if Voice.query.get(voice_id) is None:
+            return mk_response("Voice could not be found", 404)
+        return {'entries': idlakapp.voice_cache.lexicon_entries(voice_id)}
+
+    def post(self, voice_id):
+        """ Adds or replaces a user pronunciation, used from the next request
+
+            Args:
+                voice_id (str): voice id
+                word (str): the word
+                entry (str, optional): the lexicon entry, defaults to full
+                pron (str): space separated phones of the voice
+                default (bool, optional): make it the default pronunciation
+        """
+        args = lex_parser.parse_args()
+        if isinstance(args, current_app.response_class):
+            return args
+        if not args.get('pron'):
+            return mk_response("Provide a pronunciation", 422)
+        voice = Voice.query.get(voice_id)
+        if voice is None:
+            return mk_response("Voice could not be found", 404)
+        try:
+            idlakapp.voice_cache.add_lexicon_entry(
+                voice.id, voice.directory, args['word'],
+                args.get('entry') or 'full', args['pron'],
+                bool(args.get('default')))
+        except ValueError as e:
+            return mk_response(str(e), 400)
+        return mk_response("Lexicon entry has been added")
+
+    def delete(self, voice_id):
+        """ Removes a user or voice lexicon entry, or the word
+
+            Args:
+                voice_id (str): voice id
+                word (str): the word
+                entry (str, optional): the entry, the whole word if omitted
+        """
+        args = lex_parser.parse_args()
+        if isinstance(args, current_app.response_class):
+            return args
+        voice = Voice.query.get(voice_id)
+        if voice is None:
+            return mk_response("Voice could not be found", 404)
+        if not idlakapp.voice_cache.remove_lexicon_entry(
+                voice.id, voice.directory, args['word'],
+                args.get('entry') or ''):
+            return mk_response("Lexicon entry could not be found", 404)
+        return mk_response("Lexicon entry has been removed")
@@ -0,0 +1,368 @@
+# -*- coding: utf-8 -*-
+""" Process wide registry of loaded TangleVoice objects
+
+    Constructing a TangleVoice parses every tpdb file of the voice and reads
+    the duration, pitch and acoustic models, so the server keeps loaded
+    voices resident and reuses them across requests. Voices are evicted in
+    least recently used order once the configured memory budget is exceeded
+    and reloaded when the files in their directory change.
+
+    User lexicon entries added to a voice are kept here as well, so that they
+    are applied again when the voice is reloaded. They belong to the process:
+    each worker applies the changes it is sent.
+"""
+import collections
+import contextlib
+import hashlib
+import os
+import sys
+import threading
+import time
+
+idlakdir = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+sys.path.append(os.path.join(idlakdir, 'src'))
+from pyIdlak import TangleVoice         # noqa
+
+
+def _voice_fingerprint(voice_dir):
+    """ Gets the total size and the latest modification time of the files
+        in a voice directory
+
+        Args:
+            voice_dir (str): path of the voice directory
+
+        Returns:
+            (tuple): (size in bytes, latest modification time)
+    """
+    size = 0
+    mtime = 0.
+    for root, dirs, files in os.walk(voice_dir, followlinks=True):
+        for fn in files:
+            try:
+                st = os.stat(os.path.join(root, fn))
+            except OSError:
+                continue
+            size += st.st_size
+            mtime = max(mtime, st.st_mtime)
+    return size, mtime
+
+
+class _VoiceEntry(object):
+    """ A loaded voice together with the information needed to manage it """
+    def __init__(self, voice_dir, voice, size, mtime, load_time):
+        self.voice_dir = voice_dir
+        self.voice = voice
+        self.size = size
+        self.mtime = mtime
+        self.load_time = load_time
+        self.last_check = time.time()
+        # TangleVoice is not reentrant, requests on one voice are serialised
+        # apart from batched synthesis
+        self.lock = threading.Lock()
+
+
+class VoiceCache(object):
+    """ Thread safe LRU cache of TangleVoice objects keyed on voice id
+
+        Args:
+            memory_budget (int): maximum total size in bytes of the resident
+                                 voices, estimated from the size of their
+                                 files on disk, 0 for no limit
+            max_voices (int): maximum number of resident voices, 0 for no limit
+            check_interval (float): minimum number of seconds between checks
+                                    of a voice directory for changes, a
+                                    negative value disables hot reloading
+            loglvl (int): logging level passed to the voices
+            batching (bool): run the forward passes of requests synthesising
+                             at the same time on a voice together in batches
+            max_batch_frames (int): largest batch in frames
+            max_delay (float): longest time in seconds a forward pass waits
+                               for others to join its batch
+    """
+    def __init__(self, memory_budget=0, max_voices=0, check_interval=10.,
+                 loglvl=None, batching=False, max_batch_frames=4096,
+                 max_delay=0.005):
+        self._memory_budget = memory_budget
+        self._batching = batching
+        self._max_batch_frames = max_batch_frames
+        self._max_delay = max_delay
+        self._max_voices = max_voices
+        self._check_interval = check_interval
+        self._loglvl = loglvl
+        self._voices = collections.OrderedDict()
+        self._lock = threading.Lock()
+        # one lock per voice id so that a voice is only loaded once even if
+        # several requests for it arrive at the same time
+        self._load_locks = collections.defaultdict(threading.Lock)
+        self._stats = {'hits': 0, 'misses': 0, 'loads': 0, 'reloads': 0,
+                       'evictions': 0, 'load_time': 0.}
+        # user lexicon changes by voice id, (word, entry) -> (pron, default)
+        # or None for a removal, in the order they were made. Held while a
+        # change is applied so that loads see each change exactly once
+        self._lexicon = collections.defaultdict(collections.OrderedDict)
+        self._lexicon_digests = {}
+        self._lexicon_lock = threading.Lock()
+
+    def get(self, voice_id, voice_dir):
+        """ Gets a voice, loading it if it is not resident
+
+            Args:
+                voice_id (str): id of the voice
+                voice_dir (str): directory of the voice
+
+            Returns:
+                (TangleVoice): the loaded voice
+        """
+        return self._get_entry(voice_id, voice_dir).voice
+
+    def version(self, voice_id, voice_dir):
+        """ Gets the version of a voice's files, which changes when the
+            voice is reloaded
+
+            Args:
+                voice_id (str): id of the voice
+                voice_dir (str): directory of the voice
+
+            Returns:
+                (list): the size and latest modification time of its files
+                        and a digest of its user lexicon entries
+        """
+        entry = self._get_entry(voice_id, voice_dir)
+        with self._lexicon_lock:
+            digest = self._lexicon_digests.get(voice_id, '')
+        return [entry.size, entry.mtime, digest]
+
+    def lexicon_entries(self, voice_id):
+        """ Gets the user lexicon changes of a voice
+
+            Args:
+                voice_id (str): id of the voice
+
+            Returns:
+                (list): dicts of word, entry, pron and default in the order
+                        they were made, pron is None for a removal
+        """
+        with self._lexicon_lock:
+            changes = list(self._lexicon.get(voice_id, {}).items())
+        return [{'word': word, 'entry': lexentry,
+                 'pron': None if value is None else value[0],
+                 'default': False if value is None else value[1]}
+                for (word, lexentry), value in changes]
+
+    def add_lexicon_entry(self, voice_id, voice_dir, word, entry, pron,
+                          default=False):
+        """ Adds or replaces a user pronunciation, loading the voice
+
+            Args:
+                voice_id (str): id of the voice
+                voice_dir (str): directory of the voice
+                word (str): the word
+                entry (str): the lexicon entry, e.g. full
+                pron (str): space separated phones
+                default (bool): make it the default pronunciation
+
+            Raises:
+                ValueError: if the word or entry is invalid
+        """
+        voice = self._get_entry(voice_id, voice_dir).voice
+        with self._lexicon_lock:
+            voice.add_lexicon_entry(word, entry, pron, default)
+            changes = self._lexicon[voice_id]
+            changes.pop((word, entry), None)
+            changes[(word, entry)] = (pron, bool(default))
+            self._update_digest(voice_id)
+
+    def remove_lexicon_entry(self, voice_id, voice_dir, word, entry=''):
+        """ Removes an entry of a word, or the word if entry is empty
+
+            Args:
+                voice_id (str): id of the voice
+                voice_dir (str): directory of the voice
+                word (str): the word
+                entry (str): the lexicon entry
+
+            Returns:
+                (bool): False if the voice has no such entry
+        """
+        voice = self._get_entry(voice_id, voice_dir).voice
+        with self._lexicon_lock:
+            if not voice.remove_lexicon_entry(word, entry):
+                return False
+            changes = self._lexicon[voice_id]
+            for key in list(changes):
+                if key[0] == word and (not entry or key[1] == entry):
+                    del changes[key]
+            changes[(word, entry)] = None
+            self._update_digest(voice_id)
+        return True
+
+    def clear_lexicon_entries(self, voice_id):
+        """ Removes all user lexicon entries of a voice
+
+            Args:
+                voice_id (str): id of the voice
+        """
+        with self._lock:
+            entry = self._voices.get(voice_id)
+        with self._lexicon_lock:
+            self._lexicon.pop(voice_id, None)
+            self._lexicon_digests.pop(voice_id, None)
+            if entry is not None:
+                entry.voice.clear_lexicon_entries()
+
+    @contextlib.contextmanager
+    def acquire(self, voice_id, voice_dir, synthesis=False):
+        """ Context manager giving exclusive use of a voice
+
+            Args:
+                voice_id (str): id of the voice
+                voice_dir (str): directory of the voice
+                synthesis (bool): the voice is only used for
+                                  TangleVoice.synthesise_features, which is
+                                  shared with other requests when batching
+
+            Yields:
+                (TangleVoice): the loaded voice
+        """
+        entry = self._get_entry(voice_id, voice_dir)
+        if synthesis and self._batching:
+            yield entry.voice
+            return
+        with entry.lock:
+            yield entry.voice
+
+    def preload(self, voices):
+        """ Loads a list of voices
+
+            Args:
+                voices (list): list of (voice id, voice directory) tuples
+        """
+        for voice_id, voice_dir in voices:
+            self._get_entry(voice_id, voice_dir)
+
+    def evict(self, voice_id):
+        """ Removes a voice from the cache
+
+            Args:
+                voice_id (str): id of the voice
+
+            Returns:
+                (bool): True if the voice was resident
+        """
+        with self._lock:
+            return self._voices.pop(voice_id, None) is not None
+
+    def clear(self):
+        """ Removes all voices from the cache """
+        with self._lock:
+            self._voices.clear()
+
+    def stats(self):
+        """ Gets the cache metrics
+
+            Returns:
+                (dict): hit, miss, load, reload and eviction counts, the
+                        total load time and details of the resident voices
+        """
+        with self._lock:
+            ret = dict(self._stats)
+            ret['memory'] = sum(e.size for e in self._voices.values())
+            ret['memory_budget'] = self._memory_budget
+            ret['voices'] = [{'id': vid, 'directory': e.voice_dir,
+                              'size': e.size, 'load_time': e.load_time,
+                              'batching': e.voice.batching_stats()}
+                             for vid, e in self._voices.items()]
+        return ret
+
+    def _get_entry(self, voice_id, voice_dir):
+        voice_dir = os.path.abspath(voice_dir)
+        entry = self._lookup(voice_id, voice_dir)
+        if entry is not None:
+            return entry
+        with self._lock:
+            load_lock = self._load_locks[voice_id]
+        with load_lock:
+            # another request may have loaded it while we were waiting
+            entry = self._lookup(voice_id, voice_dir, count=False)
+            if entry is not None:
+                return entry
+            return self._load(voice_id, voice_dir)
+
+    def _lookup(self, voice_id, voice_dir, count=True):
+        """ Finds a resident voice, returns None if it has to be (re)loaded """
+        with self._lock:
+            entry = self._voices.get(voice_id)
+            if entry is not None and entry.voice_dir != voice_dir:
+                del self._voices[voice_id]
+                entry = None
+            if entry is not None and self._is_stale(entry):
+                del self._voices[voice_id]
+                self._stats['reloads'] += 1
+                entry = None
+            if entry is None:
+                if count:
+                    self._stats['misses'] += 1
+                return None
+            self._voices.move_to_end(voice_id)
+            if count:
+                self._stats['hits'] += 1
+            return entry
+
+    def _is_stale(self, entry):
+        if self._check_interval < 0:
+            return False
+        now = time.time()
+        if now - entry.last_check < self._check_interval:
+            return False
+        entry.last_check = now
+        size, mtime = _voice_fingerprint(entry.voice_dir)
+        return size != entry.size or mtime != entry.mtime
+
+    def _load(self, voice_id, voice_dir):
+        size, mtime = _voice_fingerprint(voice_dir)
+        start = time.time()
+        kwargs = {}
+        if self._loglvl is not None:
+            kwargs['loglvl'] = self._loglvl
+        voice = TangleVoice(voice_dir=voice_dir, **kwargs)
+        if self._batching:
+            voice.enable_batching(self._max_batch_frames, self._max_delay)
+        load_time = time.time() - start
+        entry = _VoiceEntry(voice_dir, voice, size, mtime, load_time)
+        with self._lexicon_lock:
+            self._apply_lexicon(voice_id, voice)
+            with self._lock:
+                self._voices[voice_id] = entry
+                self._voices.move_to_end(voice_id)
+                self._stats['loads'] += 1
+                self._stats['load_time'] += load_time
+                self._enforce_limits()
+        return entry
+
+    def _apply_lexicon(self, voice_id, voice):
+        """ Replays the user lexicon changes of a voice, requires the
+            lexicon lock. The lexicon may be shared with the voice being
+            replaced, so it is cleared first """
+        voice.clear_lexicon_entries()
+        for (word, entry), value in self._lexicon.get(voice_id, {}).items():
+            if value is None:
+                voice.remove_lexicon_entry(word, entry)
+            else:
+                voice.add_lexicon_entry(word, entry, value[0], value[1])
+
+    def _update_digest(self, voice_id):
+        changes = self._lexicon[voice_id]
+        self._lexicon_digests[voice_id] = hashlib.sha1(
+            repr(list(changes.items())).encode('utf-8')).hexdigest()
+
+    def _enforce_limits(self):
+        """ Evicts least recently used voices, always keeps the newest one """
+        def _over_limit():
+            if self._max_voices and len(self._voices) > self._max_voices:
+                return True
+            memory = sum(e.size for e in self._voices.values())
+            return bool(self._memory_budget and memory > self._memory_budget)
+        while len(self._voices) > 1 and _over_limit():
+            self._voices.popitem(last=False)
+            self._stats['evictions'] += 1
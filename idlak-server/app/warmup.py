@@ -0,0 +1,112 @@
+# -*- coding: utf-8 -*-
+""" Warm up of the configured voices when the server starts
+
+    Loading a voice does not do everything the first request needs: the
+    regular expressions of text processing are compiled, the model buffers
+    and (on a GPU) the CUDA context and its memory pools are created on first
+    use. The warm up loads every voice in voiceconfig.json and synthesises a
+    few sentences on each, and /health only reports the server ready once it
+    has finished, so a load balancer does not send requests to a cold worker.
+
+    Threads and CUDA contexts do not survive fork, so in a uWSGI master the
+    warm up is started in each worker after it is forked instead.
+"""
+import os
+import threading
+import time
+
+
+class Warmup(object):
+    """ Warms up voices in a background thread and keeps its state
+
+        Args:
+            voice_cache (VoiceCache): the cache the voices are loaded into
+            voices (list): list of (voice id, voice directory, sentences)
+            logger: logger for progress and errors
+    """
+    def __init__(self, voice_cache, voices, logger):
+        self._voice_cache = voice_cache
+        self._voices = voices
+        self._logger = logger
+        self._lock = threading.Lock()
+        self._reset()
+
+    def _reset(self):
+        self._state = 'warming' if self._voices else 'ready'
+        self._done = []
+        self._errors = {}
+        self._start = time.time()
+        self._time = 0.
+        self._thread = None
+
+    def start(self):
+        """ Starts the warm up, after the fork if this is a uWSGI master """
+        if not self._voices:
+            return
+        if _in_uwsgi_master() and hasattr(os, 'register_at_fork'):
+            os.register_at_fork(after_in_child=self._start_in_child)
+            return
+        self._run_in_thread()
+
+    def _start_in_child(self):
+        self._lock = threading.Lock()
+        self._reset()
+        self._run_in_thread()
+
+    def _run_in_thread(self):
+        self._thread = threading.Thread(target=self._run, name='idlak-warmup')
+        self._thread.daemon = True
+        self._thread.start()
+
+    def _run(self):
+        for voice_id, voice_dir, sentences in self._voices:
+            try:
+                start = time.time()
+                with self._voice_cache.acquire(voice_id, voice_dir) as voice:
+                    features = [voice.spurt_features(s) for s in sentences]
+                for spurt_features in features:
+                    with self._voice_cache.acquire(voice_id, voice_dir,
+                                                   synthesis=True) as voice:
+                        voice.synthesise_features(spurt_features)
+                self._logger.info("Voice {0} warmed up in {1:.2f}s".format(
+                    voice_id, time.time() - start))
+                with self._lock:
+                    self._done.append(voice_id)
+            except Exception as e:
+                self._logger.error("Warm up of voice {0} failed: {1}".format(
+                    voice_id, e))
+                with self._lock:
+                    self._errors[voice_id] = str(e)
+        with self._lock:
+            self._time = time.time() - self._start
+            self._state = 'failed' if self._errors else 'ready'
+
+    @property
+    def ready(self):
+        """ True once every voice has been warmed up """
+        with self._lock:
+            return self._state == 'ready'
+
+    def status(self):
+        """ Gets the state of the warm up
+
+            Returns:
+                (dict): the state (warming, ready or failed), the voices
+                        warmed up so far, the errors by voice id and the
+                        time the warm up took
+        """
+        with self._lock:
+            return {'status': self._state, 'voices': list(self._done),
+                    'errors': dict(self._errors),
+                    'warmup_time': (self._time if self._state != 'warming'
+                                    else time.time() - self._start)}
+
+
+def _in_uwsgi_master():
+    """ True if the app is being loaded by a uWSGI master that forks its
+        workers from it """
+    try:
+        import uwsgi
+    except ImportError:
+        return False
+    return uwsgi.worker_id() == 0
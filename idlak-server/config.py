@@ -46,6 +46,43 @@ def load_config_file(conf, config_name):
             raise ValueError('AUTHORIZATION value in config is incorrect!')
     else:
         conf['AUTHORIZATION'] = True
+    # resident voice cache
+    conf['VOICE_CACHE_MEMORY_MB'] = int(conf.get('VOICE_CACHE_MEMORY_MB', 0))
+    conf['VOICE_CACHE_MAX_VOICES'] = int(conf.get('VOICE_CACHE_MAX_VOICES', 0))
+    conf['VOICE_CACHE_CHECK_INTERVAL'] = float(
+        conf.get('VOICE_CACHE_CHECK_INTERVAL', 10))
+    preload = str(conf.get('VOICE_PRELOAD', False))
+    conf['VOICE_PRELOAD'] = preload.lower() in ("yes", "true", "t", "1")
+    warmup = str(conf.get('VOICE_WARMUP', False))
+    conf['VOICE_WARMUP'] = warmup.lower() in ("yes", "true", "t", "1")
+    conf['VOICE_WARMUP_TEXT'] = conf.get(
+        'VOICE_WARMUP_TEXT', 'Hello. This sentence warms up the voice.')
+    # batching of the forward passes of concurrent requests
+    batching = str(conf.get('INFERENCE_BATCHING', False))
+    conf['INFERENCE_BATCHING'] = batching.lower() in ("yes", "true", "t", "1")
+    conf['INFERENCE_MAX_BATCH_FRAMES'] = int(
+        conf.get('INFERENCE_MAX_BATCH_FRAMES', 4096))
+    conf['INFERENCE_MAX_DELAY_MS'] = float(conf.get('INFERENCE_MAX_DELAY_MS', 5))
+    # cache of synthesis results
+    conf['AUDIO_CACHE_MEMORY_MB'] = int(conf.get('AUDIO_CACHE_MEMORY_MB', 0))
+    conf['AUDIO_CACHE_DIR'] = conf.get('AUDIO_CACHE_DIR', '')
+    if conf['AUDIO_CACHE_DIR']:
+        conf['AUDIO_CACHE_DIR'] = os.path.realpath(
+            os.path.join(basedir, conf['AUDIO_CACHE_DIR']))
+    conf['AUDIO_CACHE_DISK_MB'] = int(conf.get('AUDIO_CACHE_DISK_MB', 0))
+    conf['AUDIO_CACHE_REDIS_URL'] = conf.get('AUDIO_CACHE_REDIS_URL', '')
+    conf['AUDIO_CACHE_REDIS_TTL'] = int(conf.get('AUDIO_CACHE_REDIS_TTL', 0))
+    # synthesis across worker servers
+    conf['CLUSTER_WORKERS'] = [w.strip() for w in
+                               str(conf.get('CLUSTER_WORKERS', '')).split(',')
+                               if w.strip()]
+    conf['CLUSTER_KEY'] = conf.get('CLUSTER_KEY', '')
+    if conf['CLUSTER_WORKERS'] and not conf['CLUSTER_KEY']:
+        raise ValueError('CLUSTER_KEY must be set with CLUSTER_WORKERS!')
+    conf['CLUSTER_SEGMENT_PHONES'] = int(conf.get('CLUSTER_SEGMENT_PHONES',
+                                                  400))
+    conf['CLUSTER_TIMEOUT'] = float(conf.get('CLUSTER_TIMEOUT', 60))
+    conf['CLUSTER_CONCURRENCY'] = int(conf.get('CLUSTER_CONCURRENCY', 1))
     return conf
     # set logging value
     if 'LOGGING' in conf:
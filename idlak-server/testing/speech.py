@@ -29,6 +29,24 @@ class SpeechTest(unittest.TestCase):
             self.db.session.query(Voice).delete()
             self.db.session.commit()
 
+    def test_segment_without_cluster_key(self):
+        # the test config sets no CLUSTER_KEY, so the endpoint is disabled
+        resp = self.client.post('/speech/segment?voice_id=alk', data=b'',
+                                headers=[('X-Idlak-Cluster-Key', '')])
+        self.assertEqual(resp.status_code, 403, resp.data)
+        self.assertIn('Cluster key', resp.json['message'])
+
+    def test_segment_with_wrong_cluster_key(self):
+        self.app.config['CLUSTER_KEY'] = uuid.uuid4().hex
+        try:
+            resp = self.client.post('/speech/segment?voice_id=alk',
+                                    data=b'', headers=[
+                                        ('X-Idlak-Cluster-Key',
+                                         uuid.uuid4().hex)])
+        finally:
+            self.app.config['CLUSTER_KEY'] = ''
+        self.assertEqual(resp.status_code, 403, resp.data)
+
     def test_speech_with_empty_db(self):
         voice_id = uuid.uuid4().hex[:3]
         with self.app.app_context():
@@ -139,3 +157,24 @@ class SpeechTest(unittest.TestCase):
         self.assertEqual(resp.status_code, 200, resp.json)
         self.assertEqual(content_type, 'audio/'+audf)
         self.assertGreater(content_length, len(text)*600)
+
+    @unittest.skipIf(not os.path.isdir('../idlak-egs/tts_tangle_arctic/' +
+                                       's2/slt_pmdl'),
+                     'No built voice files')
+    def test_speech_repeated_from_cache(self):
+        voice = _create_existing_voice(self.app)
+        text = 'Please hold, this is text for testing the audio cache.'
+        with self.app.app_context():
+            from flask_jwt_simple import create_jwt
+            token = create_jwt(identity='admin')
+        # act
+        resps = [self.client.post('/speech', json={'voice_id': voice[0],
+                                                   'text': text},
+                                  headers=[('Authorization',
+                                            'Bearer ' + token)])
+                 for _ in range(2)]
+        # assert
+        for resp in resps:
+            self.assertEqual(resp.status_code, 200, resp.json)
+        self.assertEqual(resps[1].headers['X-Idlak-Cache'], 'hit')
+        self.assertEqual(resps[0].data, resps[1].data)
@@ -95,3 +95,28 @@ class VoicesTest(unittest.TestCase):
         self.assertEqual(resp.status_code, 404)
         self.assertIn('message', resp.json)
         self.assertIn('could not be found', resp.json['message'])
+
+    def _admin_headers(self):
+        with self.app.app_context():
+            from flask_jwt_simple import create_jwt
+            token = create_jwt(identity='admin')
+        return [('Authorization', 'Bearer ' + token)]
+
+    def test_voicelexicon_with_valid_voice(self):
+        id, name, lang, acc, gender, dir = _create_random_voice(self.app)
+        # act
+        resp = self.client.get('/voices/' + id + '/lexicon',
+                               headers=self._admin_headers())
+        # assert
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(resp.json['entries'], [])
+
+    def test_voicelexicon_with_invalid_voice(self):
+        id, name, lang, acc, gender, dir = _create_random_voice(self.app)
+        # act
+        resp = self.client.post('/voices/' + id + 'invalid/lexicon',
+                                headers=self._admin_headers(),
+                                json={'word': 'idlak', 'pron': 'ay1 d l ae k'})
+        # assert
+        self.assertEqual(resp.status_code, 404)
+        self.assertIn('could not be found', resp.json['message'])
@@ -0,0 +1,64 @@
+// base/cpu-dispatch.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/cpu-dispatch.h"
+
+namespace kaldi {
+
+static CpuIsa DetectCpuIsa() {
+#ifdef KALDI_CPU_DISPATCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return kCpuIsaAvx512;
+  if (__builtin_cpu_supports("avx2"))
+    return kCpuIsaAvx2;
+#endif
+  return kCpuIsaDefault;
+}
+
+static CpuIsa &CurrentCpuIsa() {
+  static CpuIsa isa = DetectCpuIsa();
+  return isa;
+}
+
+CpuIsa GetCpuIsa() {
+  return CurrentCpuIsa();
+}
+
+void SetCpuIsa(CpuIsa isa) {
+  CpuIsa supported = DetectCpuIsa();
+  CurrentCpuIsa() = (isa < supported ? isa : supported);
+}
+
+const char *CpuIsaName(CpuIsa isa) {
+  switch (isa) {
+    case kCpuIsaAvx512: return "avx512f";
+    case kCpuIsaAvx2: return "avx2";
+    default:
+#if defined(__x86_64__)
+      return "sse2";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      return "neon";
+#else
+      return "generic";
+#endif
+  }
+}
+
+}  // namespace kaldi
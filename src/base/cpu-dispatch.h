@@ -0,0 +1,157 @@
+// base/cpu-dispatch.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_BASE_CPU_DISPATCH_H_
+#define KALDI_BASE_CPU_DISPATCH_H_
+
+// Run time selection of the instruction set of hot loops.  Kaldi is built for
+// the baseline of the target (SSE2 on x86-64) so that the binaries run
+// anywhere; a kernel written as
+//
+//   template<CpuIsa isa> struct ScaleKernel {
+//     template<typename Real>
+//     static KALDI_CPU_INLINE void Run(Real alpha, Real *data, int32 dim) {
+//       for (int32 i = 0; i < dim; i++) data[i] *= alpha;
+//     }
+//   };
+//
+// and called as CpuDispatch<ScaleKernel>(alpha, data, dim) is compiled, with
+// GCC and clang on x86-64, once for AVX-512, once for AVX2 and once for the
+// baseline, and the version for the CPU is called.  With GCC the versions are
+// compiled with the loop vectorizer on, which the default -O1 doesn't enable.
+// Floating point contraction stays off, so the versions give the same
+// results unless the kernel itself depends on "isa" (e.g. for the width of
+// vectors of the GCC vector extensions).
+//
+// This does what GCC's target_clones and ifunc resolvers do, but those
+// don't clear the upper halves of the AVX registers on return at -O1, which
+// makes the SSE code that runs after them very slow on some CPUs, and ifunc
+// isn't available on every platform.
+
+#include "base/kaldi-types.h"
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(KALDI_NO_CPU_DISPATCH)
+#define KALDI_CPU_DISPATCH_X86 1
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define KALDI_CPU_VECTORIZE \
+  __attribute__((optimize("tree-vectorize", "fp-contract=off")))
+#else
+#define KALDI_CPU_VECTORIZE
+#endif
+
+#if defined(__GNUC__)
+// Kernels must be inlined into the versions, to be compiled for their
+// instruction sets.
+#define KALDI_CPU_INLINE inline __attribute__((always_inline))
+#else
+#define KALDI_CPU_INLINE inline
+#endif
+
+namespace kaldi {
+
+/// The instruction sets the kernels are compiled for, in increasing order.
+/// kCpuIsaDefault is that of the build (SSE2 on x86-64, NEON on ARM, ...).
+enum CpuIsa { kCpuIsaDefault = 0, kCpuIsaAvx2 = 1, kCpuIsaAvx512 = 2 };
+
+/// Returns the instruction set CpuDispatch() uses: the best one the CPU
+/// supports unless SetCpuIsa() was called.
+CpuIsa GetCpuIsa();
+
+/// Makes CpuDispatch() use "isa" if the CPU supports it (else the best one it
+/// supports); for tests and timing, and not thread safe.
+void SetCpuIsa(CpuIsa isa);
+
+/// Returns the name of "isa" for logging, e.g. "avx2".
+const char *CpuIsaName(CpuIsa isa);
+
+#ifdef KALDI_CPU_DISPATCH_X86
+
+namespace internal {
+
+// Clears the upper halves of the AVX registers when the AVX2 and AVX-512
+// versions return.
+struct CpuZeroUpper {
+  __attribute__((target("avx"), always_inline)) ~CpuZeroUpper() {
+    __builtin_ia32_vzeroupper();
+  }
+};
+
+template<template<CpuIsa> class Kernel, typename... Args>
+__attribute__((target("avx512f"))) KALDI_CPU_VECTORIZE
+auto CpuRunAvx512(Args... args) -> decltype(
+    Kernel<kCpuIsaAvx512>::Run(args...)) {
+  CpuZeroUpper zero_upper;
+  return Kernel<kCpuIsaAvx512>::Run(args...);
+}
+
+template<template<CpuIsa> class Kernel, typename... Args>
+__attribute__((target("avx2"))) KALDI_CPU_VECTORIZE
+auto CpuRunAvx2(Args... args) -> decltype(Kernel<kCpuIsaAvx2>::Run(args...)) {
+  CpuZeroUpper zero_upper;
+  return Kernel<kCpuIsaAvx2>::Run(args...);
+}
+
+template<template<CpuIsa> class Kernel, typename... Args>
+KALDI_CPU_VECTORIZE
+auto CpuRunDefault(Args... args) -> decltype(
+    Kernel<kCpuIsaDefault>::Run(args...)) {
+  return Kernel<kCpuIsaDefault>::Run(args...);
+}
+
+}  // namespace internal
+
+/// Calls Kernel<isa>::Run(args...) for the instruction set of GetCpuIsa();
+/// see the comment at the top of this file.
+template<template<CpuIsa> class Kernel, typename... Args>
+inline auto CpuDispatch(Args... args) -> decltype(
+    Kernel<kCpuIsaDefault>::Run(args...)) {
+  switch (GetCpuIsa()) {
+    case kCpuIsaAvx512:
+      return internal::CpuRunAvx512<Kernel>(args...);
+    case kCpuIsaAvx2:
+      return internal::CpuRunAvx2<Kernel>(args...);
+    default:
+      return internal::CpuRunDefault<Kernel>(args...);
+  }
+}
+
+#else  // KALDI_CPU_DISPATCH_X86
+
+namespace internal {
+template<template<CpuIsa> class Kernel, typename... Args>
+KALDI_CPU_VECTORIZE
+auto CpuRunDefault(Args... args) -> decltype(
+    Kernel<kCpuIsaDefault>::Run(args...)) {
+  return Kernel<kCpuIsaDefault>::Run(args...);
+}
+}  // namespace internal
+
+template<template<CpuIsa> class Kernel, typename... Args>
+inline auto CpuDispatch(Args... args) -> decltype(
+    Kernel<kCpuIsaDefault>::Run(args...)) {
+  return internal::CpuRunDefault<Kernel>(args...);
+}
+
+#endif  // KALDI_CPU_DISPATCH_X86
+
+}  // namespace kaldi
+
+#endif  // KALDI_BASE_CPU_DISPATCH_H_
@@ -18,6 +18,8 @@
 // limitations under the License.
 #include "base/kaldi-math.h"
 #include <limits>
+#include <thread>
+#include <vector>
 #include "base/timer.h"
 
 namespace kaldi {
@@ -168,6 +170,48 @@ void UnitTestRand() {
   }
 }
 
+void UnitTestThreadRand() {
+  // the generator of a thread depends only on its seed
+  std::vector<int> a(100), b(100);
+  SetThreadRandSeed(1234);
+  KALDI_ASSERT(HasThreadRandSeed());
+  for (size_t i = 0; i < a.size(); i++) a[i] = Rand();
+  RandSeed(1234);
+  for (size_t i = 0; i < b.size(); i++) b[i] = Rand();
+  KALDI_ASSERT(a == b);
+  std::thread thread([&b] () {
+    SetThreadRandSeed(1234);
+    for (size_t i = 0; i < b.size(); i++) b[i] = Rand();
+  });
+  thread.join();
+  KALDI_ASSERT(a == b);
+  double sum = 0.0;
+  for (int32 i = 0; i < 10000; i++) {
+    int r = Rand();
+    KALDI_ASSERT(r >= 0 && r <= RAND_MAX);
+    sum += RandUniform();
+  }
+  KALDI_ASSERT(std::abs(sum / 10000 - 0.5) < 0.02);
+  ClearThreadRandSeed();
+  KALDI_ASSERT(!HasThreadRandSeed());
+
+  // the fills give the same numbers as the functions they stand for
+  for (int32 n = 0; n < 10; n++) {
+    std::vector<float> fill(n), ref(n);
+    RandomState state1, state2;
+    state2.seed = state1.seed;
+    RandGaussFill(fill.data(), n, &state1);
+    for (int32 i = 0; i + 1 < n; i += 2)
+      RandGauss2(&ref[i], &ref[i + 1], &state2);
+    if (n % 2 == 1) ref[n - 1] = RandGauss(&state2);
+    KALDI_ASSERT(fill == ref);
+    std::vector<double> dfill(n);
+    RandUniformFill(dfill.data(), n, &state1);
+    for (int32 i = 0; i < n; i++)
+      KALDI_ASSERT(dfill[i] == RandUniform(&state2));
+  }
+}
+
 void UnitTestLogAddSub() {
   for (int i = 0; i < 100; i++) {
     double f1 = Rand() % 10000, f2 = Rand() % 20;
@@ -323,6 +367,7 @@ int main() {
   UnitTestDefines();
   UnitTestLogAddSub();
   UnitTestRand();
+  UnitTestThreadRand();
   UnitTestAssertFunc();
   UnitTestRoundUpToNearestPowerOfTwo();
   UnitTestDivideRoundingDown();
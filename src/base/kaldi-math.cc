@@ -41,7 +41,69 @@ int32 RoundUpToNearestPowerOfTwo(int32 n) {
 
 static std::mutex _RandMutex;
 
+// The generator of a thread that has one: xoshiro128** (Blackman and Vigna),
+// seeded with splitmix64.
+struct ThreadRandState {
+  bool seeded;
+  uint32 s[4];
+};
+static thread_local ThreadRandState tls_rand = { false, { 0, 0, 0, 0 } };
+
+static inline uint32 RotateLeft(uint32 x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32 NextThreadRand(uint32 *s) {
+  uint32 result = RotateLeft(s[1] * 5, 7) * 9, t = s[1] << 9;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = RotateLeft(s[3], 11);
+  return result;
+}
+
+// Maps the 32 bits of NextThreadRand() to 0 .. RAND_MAX, as rand() does.
+static inline int ThreadRandToInt(uint32 r) {
+  r >>= 1;
+  return (RAND_MAX == 0x7fffffff ? static_cast<int>(r) :
+          static_cast<int>(r % (static_cast<uint32>(RAND_MAX) + 1)));
+}
+
+void SetThreadRandSeed(uint64 seed) {
+  uint64 z = seed;
+  for (int32 i = 0; i < 4; i += 2) {
+    z += 0x9E3779B97F4A7C15ULL;
+    uint64 x = z;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    tls_rand.s[i] = static_cast<uint32>(x);
+    tls_rand.s[i + 1] = static_cast<uint32>(x >> 32);
+  }
+  if ((tls_rand.s[0] | tls_rand.s[1] | tls_rand.s[2] | tls_rand.s[3]) == 0)
+    tls_rand.s[0] = 1;  // the all-zero state is the one it cannot leave.
+  tls_rand.seeded = true;
+}
+
+void ClearThreadRandSeed() {
+  tls_rand.seeded = false;
+}
+
+bool HasThreadRandSeed() {
+  return tls_rand.seeded;
+}
+
+void RandSeed(unsigned seed) {
+  srand(seed);
+  if (tls_rand.seeded)
+    SetThreadRandSeed(seed);
+}
+
 int Rand(struct RandomState* state) {
+  if (!state && tls_rand.seeded)
+    return ThreadRandToInt(NextThreadRand(tls_rand.s));
 #if defined(_MSC_VER) || defined(__CYGWIN__)
   // On Windows and Cygwin, just call Rand()
   return rand();
@@ -159,5 +221,62 @@ void RandGauss2(double *a, double *b, RandomState *state) {
   *b = b_float;
 }
 
+// The same numbers as RandUniform(state), n times.
+template<typename Real>
+static void RandUniformFillTpl(Real *data, int32 n, RandomState *state) {
+  if (!state) {
+    if (tls_rand.seeded) {
+      uint32 *s = tls_rand.s;
+      for (int32 i = 0; i < n; i++)
+        data[i] = static_cast<float>(
+            (ThreadRandToInt(NextThreadRand(s)) + 1.0) / (RAND_MAX + 2.0));
+      return;
+    }
+    RandomState local_state;
+    RandUniformFillTpl(data, n, &local_state);
+    return;
+  }
+  for (int32 i = 0; i < n; i++)
+    data[i] = RandUniform(state);
+}
+
+// The same numbers as RandGauss2(.., state) for each pair; the arithmetic is
+// in float, as there.
+template<typename Real>
+static void RandGaussFillTpl(Real *data, int32 n, RandomState *state) {
+  if (!state && !tls_rand.seeded) {
+    RandomState local_state;
+    RandGaussFillTpl(data, n, &local_state);
+    return;
+  }
+  int32 last = n - (n % 2);
+  RandUniformFillTpl(data, last, state);
+  for (int32 i = 0; i < last; i += 2) {
+    float u1 = static_cast<float>(data[i]), u2 = static_cast<float>(data[i + 1]);
+    u1 = sqrtf(-2.0f * logf(u1));
+    u2 =  2.0f * M_PI * u2;
+    data[i] = u1 * cosf(u2);
+    data[i + 1] = u1 * sinf(u2);
+  }
+  if (last != n)
+    data[last] = RandGauss(state);
+}
+
+void RandUniformFill(float *data, int32 n, RandomState *state) {
+  RandUniformFillTpl(data, n, state);
+}
+
+void RandUniformFill(double *data, int32 n, RandomState *state) {
+  RandUniformFillTpl(data, n, state);
+}
+
+void RandGaussFill(float *data, int32 n, RandomState *state) {
+  RandGaussFillTpl(data, n, state);
+}
+
+void RandGaussFill(double *data, int32 n, RandomState *state) {
+  RandGaussFillTpl(data, n, state);
+}
+
 
 }  // end namespace kaldi
@@ -129,7 +129,9 @@ const float kLogZeroFloat = -std::numeric_limits<float>::infinity();
 const double kLogZeroDouble = -std::numeric_limits<double>::infinity();
 const BaseFloat kLogZeroBaseFloat = -std::numeric_limits<BaseFloat>::infinity();
 
-// Returns a random integer between 0 and RAND_MAX, inclusive
+// Returns a random integer between 0 and RAND_MAX, inclusive.  Without a
+// state it uses the generator of the calling thread if it has one (see
+// SetThreadRandSeed()), otherwise rand() under a process-wide lock.
 int Rand(struct RandomState* state = NULL);
 
 // State for thread-safe random number generator
@@ -138,6 +140,22 @@ struct RandomState {
   unsigned seed;
 };
 
+/// Gives the calling thread a random number generator of its own
+/// (xoshiro128**), so that Rand() and everything built on it (RandGauss(),
+/// RandomState(), ...) need no lock on it; the numbers it gives depend only
+/// on the seed.  The worker threads of the ThreadPool in util/kaldi-thread.h
+/// are seeded as they are started.
+void SetThreadRandSeed(uint64 seed);
+/// Makes the calling thread use rand() again.
+void ClearThreadRandSeed();
+/// True if the calling thread has its own generator.
+bool HasThreadRandSeed();
+
+/// Calls srand(seed) and reseeds the generator of the calling thread if it
+/// has one; code that reseeds for reproducibility should call this rather
+/// than srand(), which has no effect on threads with their own generator.
+void RandSeed(unsigned seed);
+
 // Returns a random integer between first and last inclusive.
 int32 RandInt(int32 first, int32 last, struct RandomState* state = NULL);
 
@@ -166,6 +184,16 @@ int32 RandPoisson(float lambda, struct RandomState* state = NULL);
 void RandGauss2(float *a, float *b, RandomState *state = NULL);
 void RandGauss2(double *a, double *b, RandomState *state = NULL);
 
+/// Sets data[0 .. n-1] to RandUniform() numbers, or to RandGauss2() pairs
+/// (RandGauss() for the last one if n is odd).  The uniform numbers are
+/// drawn in one loop before the Box-Muller transform is applied to all of
+/// them.  Without a state they use the calling thread's generator if it has
+/// one and otherwise a RandomState, so the lock is taken at most once.
+void RandUniformFill(float *data, int32 n, RandomState *state = NULL);
+void RandUniformFill(double *data, int32 n, RandomState *state = NULL);
+void RandGaussFill(float *data, int32 n, RandomState *state = NULL);
+void RandGaussFill(double *data, int32 n, RandomState *state = NULL);
+
 // Also see Vector<float,double>::RandCategorical().
 
 // This is a randomized pruning mechanism that preserves expectations,
@@ -18,6 +18,10 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdio>
+#include <map>
+#include <thread>
+
 #include "base/timer.h"
 #include "base/kaldi-common.h"
 #include "base/kaldi-utils.h"
@@ -36,10 +40,52 @@ void TimerTest() {
     KALDI_ERR << "Timer fail: waited " << f << " seconds instead of "
               <<  time_secs << " secs.";
 }
+
+void ProfilerTestInner() {
+  KALDI_PROFILE_SCOPE("ProfilerTestInner");
+  Sleep(0.02);
+}
+
+void ProfilerTestOuter() {
+  KALDI_PROFILE_SCOPE("ProfilerTestOuter");
+  ProfilerTestInner();
+  Sleep(0.01);
+}
+
+void RemoveProfile() {
+  std::remove("timer-test.profile");
+}
+
+void ProfilerTest() {
+  ProfilerTestOuter();  // not profiled yet.
+  std::atexit(RemoveProfile);  // runs after the profile is written.
+  EnableProfiler("timer-test.profile");
+  ProfilerTestOuter();
+  std::thread thread(ProfilerTestOuter);  // merged with this thread.
+  thread.join();
+  ProfilerTestInner();
+
+  std::ostringstream os;
+  WriteProfile(os);
+  std::istringstream is(os.str());
+  std::map<std::string, int64> self_us;
+  std::string path;
+  int64 us;
+  while (is >> path >> us)
+    self_us[path] = us;
+  KALDI_ASSERT(self_us.size() == 3);
+  // the sleeps are 2 * 20ms, 2 * 10ms and 20ms.
+  KALDI_ASSERT(std::abs(self_us["ProfilerTestOuter;ProfilerTestInner"] -
+                        40000) < 20000);
+  KALDI_ASSERT(std::abs(self_us["ProfilerTestOuter"] - 20000) < 20000);
+  KALDI_ASSERT(std::abs(self_us["ProfilerTestInner"] - 20000) < 20000);
+}
+
 }
 
 
 int main() {
   for (int i = 0; i < 4; i++)
     kaldi::TimerTest();
+  kaldi::ProfilerTest();
 }
@@ -19,67 +19,145 @@
 
 #include "base/timer.h"
 #include "base/kaldi-error.h"
-#include <algorithm>
-#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <map>
-#include <unordered_map>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace kaldi {
 
-class ProfileStats {
- public:
-  void AccStats(const char *function_name, double elapsed) {
-    std::unordered_map<const char*, ProfileStatsEntry>::iterator
-        iter = map_.find(function_name);
-    if (iter == map_.end()) {
-      map_[function_name] = ProfileStatsEntry(function_name);
-      map_[function_name].total_time = elapsed;
-    } else {
-      iter->second.total_time += elapsed;
-    }
+namespace internal {
+
+bool g_profiler_enabled = false;
+
+// A node of the call tree of a thread: a scope, as reached by the path from
+// the root.
+struct ProfileNode {
+  const char *name;
+  ProfileNode *parent;
+  std::vector<ProfileNode*> children;
+  int64 total_ns;  // including the children.
+
+  ProfileNode(const char *name, ProfileNode *parent):
+      name(name), parent(parent), total_ns(0) { }
+};
+
+struct ProfileThread {
+  ProfileNode root;
+  ProfileNode *current;
+  ProfileThread(): root("", NULL), current(&root) { }
+};
+
+}  // namespace internal
+
+namespace {
+
+using internal::ProfileNode;
+using internal::ProfileThread;
+
+// The call trees of the threads, which are never freed, as the report is
+// written after the threads have exited.
+struct ProfileRegistry {
+  std::mutex mutex;
+  std::vector<ProfileThread*> threads;
+  std::string filename;
+};
+
+ProfileRegistry &GetProfileRegistry() {
+  static ProfileRegistry *registry = new ProfileRegistry();
+  return *registry;
+}
+
+ProfileThread *GetProfileThread() {
+  static thread_local ProfileThread *thread = NULL;
+  if (thread == NULL) {
+    thread = new ProfileThread();
+    ProfileRegistry &registry = GetProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(thread);
   }
-  ~ProfileStats() {
-    // This map makes sure we agglomerate the time if there were any duplicate
-    // addresses of strings.
-    std::unordered_map<std::string, double> total_time;
-    for (auto iter = map_.begin(); iter != map_.end(); iter++)
-      total_time[iter->second.name] += iter->second.total_time;
-
-    ReverseSecondComparator comp;
-    std::vector<std::pair<std::string, double> > pairs(total_time.begin(),
-                                                       total_time.end());
-    std::sort(pairs.begin(), pairs.end(), comp);
-    for (size_t i = 0; i < pairs.size(); i++) {
-      KALDI_LOG << "Time taken in " << pairs[i].first << " is "
-                << std::fixed << std::setprecision(2) << pairs[i].second << "s.";
-    }
+  return thread;
+}
+
+inline int64 ProfileNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Adds the self times of "node" and its descendants to "self_ns", keyed on
+// the call path, "path" being that of "node".
+void AccProfileNode(const ProfileNode &node, const std::string &path,
+                    std::map<std::string, int64> *self_ns) {
+  int64 children_ns = 0;
+  for (size_t i = 0; i < node.children.size(); i++) {
+    const ProfileNode &child = *node.children[i];
+    children_ns += child.total_ns;
+    AccProfileNode(child, path.empty() ? std::string(child.name) :
+                   path + ';' + child.name, self_ns);
   }
- private:
-
-  struct ProfileStatsEntry {
-    std::string name;
-    double total_time;
-    ProfileStatsEntry() { }
-    ProfileStatsEntry(const char *name): name(name) { }
-  };
-
-  struct ReverseSecondComparator {
-    bool operator () (const std::pair<std::string, double> &a,
-                      const std::pair<std::string, double> &b) {
-      return a.second > b.second;
+  if (!path.empty())
+    (*self_ns)[path] += node.total_ns - children_ns;
+}
+
+void WriteProfileAtExit() {
+  const std::string &filename = GetProfileRegistry().filename;
+  std::ofstream os(filename.c_str());
+  WriteProfile(os);
+  if (!os.good())
+    KALDI_WARN << "Error writing profile to " << filename;
+  else
+    KALDI_LOG << "Wrote profile to " << filename;
+}
+
+}  // namespace
+
+void Profiler::Enter(const char *name) {
+  thread_ = GetProfileThread();
+  ProfileNode *parent = thread_->current;
+  std::vector<ProfileNode*> &children = parent->children;
+  for (size_t i = 0; i < children.size(); i++) {
+    if (children[i]->name == name) {
+      node_ = children[i];
+      break;
     }
-  };
+  }
+  if (node_ == NULL) {
+    node_ = new ProfileNode(name, parent);
+    children.push_back(node_);
+  }
+  thread_->current = node_;
+  start_ns_ = ProfileNowNs();
+}
 
-  // Note: this map is keyed on the address of the string, there is no proper
-  // hash function.  The assumption is that the strings are compile-time
-  // constants.
-  std::unordered_map<const char*, ProfileStatsEntry> map_;
-};
+void Profiler::Exit() {
+  node_->total_ns += ProfileNowNs() - start_ns_;
+  thread_->current = node_->parent;
+}
 
-ProfileStats g_profile_stats;
+void EnableProfiler(const std::string &filename) {
+  KALDI_ASSERT(!filename.empty());
+  ProfileRegistry &registry = GetProfileRegistry();
+  bool first_call = registry.filename.empty();
+  registry.filename = filename;
+  internal::g_profiler_enabled = true;
+  if (first_call)
+    std::atexit(WriteProfileAtExit);
+}
 
-Profiler::~Profiler() {
-  g_profile_stats.AccStats(name_, tim_.Elapsed());
+void WriteProfile(std::ostream &os) {
+  ProfileRegistry &registry = GetProfileRegistry();
+  std::map<std::string, int64> self_ns;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (size_t i = 0; i < registry.threads.size(); i++)
+      AccProfileNode(registry.threads[i]->root, "", &self_ns);
+  }
+  for (std::map<std::string, int64>::const_iterator iter = self_ns.begin();
+       iter != self_ns.end(); ++iter)
+    os << iter->first << ' ' << (iter->second + 500) / 1000 << '\n';
 }
 
 }  // namespace kaldi
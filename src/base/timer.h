@@ -19,6 +19,9 @@
 #ifndef KALDI_BASE_TIMER_H_
 #define KALDI_BASE_TIMER_H_
 
+#include <ostream>
+#include <string>
+
 #include "base/kaldi-utils.h"
 #include "base/kaldi-error.h"
 
@@ -90,22 +93,63 @@ class Timer {
 
 #endif
 
+namespace internal {
+struct ProfileNode;
+struct ProfileThread;
+extern bool g_profiler_enabled;
+}
+
+/// Hierarchical profiler: a Profiler object times the scope it is declared
+/// in, as a child of the scopes enclosing it in the same thread, so the
+/// report gives the time of each call path, e.g.
+/// "NnetComputer::Run;CuMatrixBase::AddMatMat".  It does nothing (beyond
+/// testing a flag) unless EnableProfiler() was called, which ParseOptions does
+/// for --profile-output.  Each thread accumulates into its own call tree, so
+/// timing takes no lock; the trees are merged in the report.
 class Profiler {
  public:
   // Caution: the 'const char' should always be a string constant; for speed,
   // internally the profiling code uses the address of it as a lookup key.
-  Profiler(const char *function_name): name_(function_name) { }
-  ~Profiler();
+  explicit Profiler(const char *name): node_(NULL) {
+    if (internal::g_profiler_enabled)
+      Enter(name);
+  }
+  ~Profiler() {
+    if (node_ != NULL)
+      Exit();
+  }
  private:
-  Timer tim_;
-  const char *name_;
+  void Enter(const char *name);
+  void Exit();
+
+  internal::ProfileThread *thread_;
+  internal::ProfileNode *node_;
+  int64 start_ns_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Profiler);
 };
 
+/// Turns on the Profiler objects and makes the program write the profile, at
+/// exit, to the file "filename".  The profile is in the collapsed-stack format
+/// of flamegraph.pl and speedscope: one line per call path, with the
+/// semicolon-separated scope names and the microseconds spent in the last of
+/// them and not in its children.  Is called by ParseOptions::Read() for
+/// --profile-output; should be called before any threads are started.
+void EnableProfiler(const std::string &filename);
+
+/// Writes the profile gathered so far in the format described above, merging
+/// the threads.  Calls to it while other threads are in profiled scopes may
+/// miss their latest timings.
+void WriteProfile(std::ostream &os);
+
 //  To add timing info for a function, you just put
 //  KALDI_PROFILE;
 //  at the beginning of the function.  Caution: this doesn't
-//  include the class name.
-#define KALDI_PROFILE Profiler _profiler(__func__)
+//  include the class name; KALDI_PROFILE_SCOPE("CuMatrixBase::AddMatMat")
+//  times the enclosing scope under the name given, which must be a string
+//  literal.
+#define KALDI_PROFILE ::kaldi::Profiler _kaldi_profiler(__func__)
+#define KALDI_PROFILE_SCOPE(name) \
+  ::kaldi::Profiler _kaldi_profiler_scope("" name)
 
 
 
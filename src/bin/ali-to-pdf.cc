@@ -57,10 +57,8 @@ int main(int argc, char *argv[]) {
     int32 num_done = 0;
     for (; !reader.Done(); reader.Next()) {
       std::string key = reader.Key();
-      std::vector<int32> alignment = reader.Value();
-
-      for (size_t i = 0; i < alignment.size(); i++)
-        alignment[i] = trans_model.TransitionIdToPdf(alignment[i]);
+      std::vector<int32> alignment;
+      trans_model.TransitionIdsToPdfs(reader.Value(), &alignment);
 
       writer.Write(key, alignment);
       num_done++;
@@ -17,6 +17,10 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#if !defined(_MSC_VER)
+#include <sys/resource.h>
+#endif
+#include <thread>
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "tree/context-dep.h"
@@ -27,6 +31,82 @@
 #include "fstext/grammar-context-fst.h"
 #include "decoder/grammar-fst.h"
 
+namespace kaldi {
+
+// Peak resident memory of this process in MB, or -1 if unknown.
+static double PeakMemoryMb() {
+#if defined(_MSC_VER)
+  return -1.0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return -1.0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+  return usage.ru_maxrss / 1024.0;  // kilobytes
+#endif
+#endif
+}
+
+// Logs the size of a graph built at some stage, with an estimate of the
+// memory it takes and the peak memory of the process so far.
+static void LogGraphSize(const std::string &name,
+                         const fst::VectorFst<fst::StdArc> &fst) {
+  int64 num_states = fst.NumStates(), num_arcs = 0;
+  for (int64 s = 0; s < num_states; s++)
+    num_arcs += fst.NumArcs(s);
+  double mb = (num_states * sizeof(fst::VectorState<fst::StdArc>) +
+               num_arcs * sizeof(fst::StdArc)) / (1024.0 * 1024.0);
+  KALDI_LOG << name << " has " << num_states << " states and " << num_arcs
+            << " arcs, about " << mb << " MB; peak memory so far "
+            << PeakMemoryMb() << " MB";
+}
+
+// Reads the tree and the model, in a thread of its own while the FSTs are
+// read.
+static void ReadTreeAndModel(std::string tree_rxfilename,
+                             std::string model_rxfilename,
+                             ContextDependency *ctx_dep,
+                             TransitionModel *trans_model,
+                             bool *success) {
+  try {
+    ReadKaldiObject(tree_rxfilename, ctx_dep);
+    ReadKaldiObject(model_rxfilename, trans_model);
+    *success = true;
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error reading the tree or model: " << e.what();
+    *success = false;
+  }
+}
+
+static void ILabelSort(fst::VectorFst<fst::StdArc> *fst) {
+  if (fst->Properties(fst::kILabelSorted, true) == 0)
+    fst::ArcSort(fst, fst::ILabelCompare<fst::StdArc>());
+}
+
+// Composes ifst1 and ifst2 and determinizes the result in the log semiring
+// (with epsilon removal).  If lazy, the composition is only expanded as
+// DeterminizeStar visits it, so it never has to fit in memory.
+static void ComposeDeterminize(const fst::VectorFst<fst::StdArc> &ifst1,
+                               const fst::VectorFst<fst::StdArc> &ifst2,
+                               bool lazy, const fst::CacheOptions &cache_opts,
+                               int32 max_states,
+                               fst::VectorFst<fst::StdArc> *ofst) {
+  if (lazy) {
+    fst::ComposeFst<fst::StdArc> *composed =
+        fst::TableComposeFst(ifst1, ifst2, fst::TableComposeOptions(),
+                             cache_opts);
+    DeterminizeStarInLog(*composed, ofst, fst::kDelta, NULL, max_states);
+    delete composed;
+    // paths of the composition that did not reach a final state
+    Connect(ofst);
+  } else {
+    TableCompose(ifst1, ifst2, ofst);
+    DeterminizeStarInLog(ofst, fst::kDelta, NULL, max_states);
+  }
+}
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -40,6 +120,9 @@ int main(int argc, char *argv[]) {
 
     const char *usage =
         "Creates HCLG decoding graph.  Similar to mkgraph.sh but done in code.\n"
+        "By default the compositions are expanded lazily as they are\n"
+        "determinized, and the size of each stage and the peak memory use\n"
+        "are logged.\n"
         "\n"
         "Usage:   compile-graph [options] <tree-in> <model-in> <lexicon-fst-in> "
         " <gammar-rspecifier> <hclg-wspecifier>\n"
@@ -52,6 +135,8 @@ int main(int argc, char *argv[]) {
     BaseFloat self_loop_scale = 1.0;  // Caution: the script default is 0.1.
     int32 nonterm_phones_offset = -1;
     std::string disambig_rxfilename;
+    bool lazy_compose = true;
+    int32 compose_cache_mb = 256, max_states = -1;
 
 
     po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
@@ -64,6 +149,15 @@ int main(int argc, char *argv[]) {
     po.Register("nonterm-phones-offset", &nonterm_phones_offset, "Integer "
                 "value of symbol #nonterm_bos in phones.txt, if present. "
                 "(Only relevant for grammar decoding).");
+    po.Register("lazy-compose", &lazy_compose, "If true, the compositions "
+                "L o G and H o CLG are expanded as they are determinized "
+                "rather than built first, which saves the memory of the "
+                "undeterminized graphs.");
+    po.Register("compose-cache-mb", &compose_cache_mb, "Memory in MB the lazy "
+                "compositions may use to cache expanded states.");
+    po.Register("max-states", &max_states, "If >0, determinization fails "
+                "once it has made this many states (a guard against graphs "
+                "that would not fit in memory).");
 
     po.Read(argc, argv);
 
@@ -78,14 +172,30 @@ int main(int argc, char *argv[]) {
         grammar_rxfilename = po.GetArg(4),
         hclg_wxfilename = po.GetArg(5);
 
+    // The tree and model are read while the (typically much larger) FSTs
+    // are.
     ContextDependency ctx_dep;  // the tree.
-    ReadKaldiObject(tree_rxfilename, &ctx_dep);
-
     TransitionModel trans_model;
-    ReadKaldiObject(model_rxfilename, &trans_model);
+    bool model_read = false;
+    std::thread model_thread(ReadTreeAndModel, tree_rxfilename,
+                             model_rxfilename, &ctx_dep, &trans_model,
+                             &model_read);
+
+    VectorFst<StdArc> *lex_fst = NULL, *grammar_fst = NULL;
+    try {
+      lex_fst = fst::ReadFstKaldi(lex_rxfilename);
+      grammar_fst = fst::ReadFstKaldi(grammar_rxfilename);
+      ILabelSort(grammar_fst);
+    } catch (...) {
+      model_thread.join();
+      throw;
+    }
+    model_thread.join();
+    if (!model_read)
+      KALDI_ERR << "Could not read the tree or model.";
 
-    VectorFst<StdArc> *lex_fst = fst::ReadFstKaldi(lex_rxfilename),
-        *grammar_fst = fst::ReadFstKaldi(grammar_rxfilename);
+    fst::CacheOptions cache_opts(true, static_cast<size_t>(compose_cache_mb)
+                                 << 20);
 
     std::vector<int32> disambig_syms;
     if (disambig_rxfilename != "")
@@ -107,16 +217,15 @@ int main(int argc, char *argv[]) {
                   << " is also a phone.";
 
     VectorFst<StdArc> lg_fst;
-    TableCompose(*lex_fst, *grammar_fst, &lg_fst);
-
-    DeterminizeStarInLog(&lg_fst, fst::kDelta);
+    ComposeDeterminize(*lex_fst, *grammar_fst, lazy_compose, cache_opts,
+                       max_states, &lg_fst);
+    delete grammar_fst;
+    delete lex_fst;
 
     MinimizeEncoded(&lg_fst, fst::kDelta);
 
     fst::PushSpecial(&lg_fst, fst::kDelta);
-
-    delete grammar_fst;
-    delete lex_fst;
+    LogGraphSize("LG", lg_fst);
 
     VectorFst<StdArc> clg_fst;
 
@@ -139,28 +248,36 @@ int main(int argc, char *argv[]) {
                                 lg_fst, &clg_fst, &ilabels);
     }
     lg_fst.DeleteStates();
+    LogGraphSize("CLG", clg_fst);
 
+    // H only needs the ilabels, so it is made while CLG is sorted for the
+    // composition.
+    std::thread sort_thread(ILabelSort, &clg_fst);
     HTransducerConfig h_cfg;
     h_cfg.transition_scale = transition_scale;
     h_cfg.nonterm_phones_offset = nonterm_phones_offset;
     std::vector<int32> disambig_syms_h; // disambiguation symbols on
                                         // input side of H.
-    VectorFst<StdArc> *h_fst = GetHTransducer(ilabels,
-                                              ctx_dep,
-                                              trans_model,
-                                              h_cfg,
-                                              &disambig_syms_h);
+    VectorFst<StdArc> *h_fst = NULL;
+    try {
+      h_fst = GetHTransducer(ilabels, ctx_dep, trans_model, h_cfg,
+                             &disambig_syms_h);
+    } catch (...) {
+      sort_thread.join();
+      throw;
+    }
+    sort_thread.join();
 
     VectorFst<StdArc> hclg_fst;  // transition-id to word.
-    TableCompose(*h_fst, clg_fst, &hclg_fst);
+    // Epsilon-removal and determinization combined. This will fail if not
+    // determinizable.
+    ComposeDeterminize(*h_fst, clg_fst, lazy_compose, cache_opts, max_states,
+                       &hclg_fst);
     clg_fst.DeleteStates();
     delete h_fst;
 
     KALDI_ASSERT(hclg_fst.Start() != fst::kNoStateId);
 
-    // Epsilon-removal and determinization combined. This will fail if not determinizable.
-    DeterminizeStarInLog(&hclg_fst);
-
     if (!disambig_syms_h.empty()) {
       RemoveSomeInputSymbols(disambig_syms_h, &hclg_fst);
       RemoveEpsLocal(&hclg_fst);
@@ -190,6 +307,7 @@ int main(int argc, char *argv[]) {
       const_hclg.Write(ko.Stream(), wopts);
     }
 
+    LogGraphSize("HCLG", hclg_fst);
     KALDI_LOG << "Wrote graph with " << hclg_fst.NumStates()
               << " states to " << hclg_wxfilename;
     return 0;
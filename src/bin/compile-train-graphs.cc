@@ -57,6 +57,8 @@ int main(int argc, char *argv[]) {
                 "more memory.  E.g. 500");
     po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
                 "list of disambiguation symbols in phone symbol table");
+    po.Register("num-threads", &gopts.num_threads, "Number of threads to "
+                "compile each batch of graphs with (see --batch-size).");
     
     po.Read(argc, argv);
 
@@ -18,12 +18,169 @@
 // limitations under the License.
 
 
+#include "base/cpu-dispatch.h"
 #include "chain/chain-denominator.h"
 #include "chain/chain-kernels-ansi.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 namespace chain {
 
+namespace {
+
+#if HAVE_CUDA == 1
+// The most transitions the tiled kernels of chain-kernels.cu keep in shared
+// memory for a block (24KB).
+const int32 kMaxTileTransitions = 2048;
+#endif
+
+// The CPU versions of _cuda_chain_hmm_forward and _cuda_chain_hmm_backward in
+// chain-kernels.cu, for the sequences s_begin <= s < s_end.  They go over the
+// transitions of each HMM state once, with the sequences, which are contiguous
+// in memory, in the inner loops so that those vectorize.  The arithmetic is
+// the same as computing each (state, sequence) separately, so the results
+// don't depend on the range of sequences.  "sum" is space for s_end - s_begin
+// elements.
+template<CpuIsa isa> struct ChainHmmForwardKernel {
+  static KALDI_CPU_INLINE void Run(
+      const Int32Pair *backward_transitions,
+      const DenominatorGraphTransition *transitions,
+      int32 num_sequences, int32 num_hmm_states, int32 s_begin, int32 s_end,
+      const BaseFloat *probs, int32 prob_stride,
+      const BaseFloat *prev_alpha, BaseFloat *this_alpha, double *sum) {
+    int32 n = s_end - s_begin;
+    // The alpha-sums of the previous frame, whose inverses are the arbitrary
+    // scales; see _cuda_chain_hmm_forward.
+    const BaseFloat *prev_alpha_sum =
+        prev_alpha + num_hmm_states * num_sequences + s_begin;
+    for (int32 h = 0; h < num_hmm_states; h++) {
+      for (int32 i = 0; i < n; i++)
+        sum[i] = 0.0;
+      const DenominatorGraphTransition
+          *trans_iter = transitions + backward_transitions[h].first,
+          *trans_end = transitions + backward_transitions[h].second;
+      for (; trans_iter != trans_end; ++trans_iter) {
+        BaseFloat transition_prob = trans_iter->transition_prob;
+        const BaseFloat *prob = probs + trans_iter->pdf_id * prob_stride +
+            s_begin,
+            *alpha = prev_alpha + trans_iter->hmm_state * num_sequences +
+            s_begin;
+        for (int32 i = 0; i < n; i++)
+          sum[i] += alpha[i] * transition_prob * prob[i];
+      }
+      for (int32 i = 0; i < n; i++)
+        KALDI_ASSERT(sum[i] - sum[i] == 0);
+      BaseFloat *out = this_alpha + h * num_sequences + s_begin;
+      for (int32 i = 0; i < n; i++) {
+        BaseFloat arbitrary_scale = 1.0 / prev_alpha_sum[i];
+        out[i] = sum[i] * arbitrary_scale;
+      }
+    }
+  }
+};
+
+template<CpuIsa isa> struct ChainHmmBackwardKernel {
+  static KALDI_CPU_INLINE void Run(
+      const Int32Pair *forward_transitions,
+      const DenominatorGraphTransition *transitions,
+      int32 num_sequences, int32 num_hmm_states, int32 s_begin, int32 s_end,
+      const BaseFloat *probs, int32 prob_stride,
+      const BaseFloat *this_alpha, const BaseFloat *next_beta,
+      BaseFloat *this_beta, BaseFloat *log_prob_deriv,
+      int32 log_prob_deriv_stride, double *sum, BaseFloat *occupation_factor) {
+    int32 n = s_end - s_begin;
+    const BaseFloat *inv_arbitrary_scale =
+        this_alpha + num_hmm_states * num_sequences + s_begin;
+    for (int32 h = 0; h < num_hmm_states; h++) {
+      const BaseFloat *alpha = this_alpha + h * num_sequences + s_begin;
+      for (int32 i = 0; i < n; i++) {
+        sum[i] = 0.0;
+        occupation_factor[i] = alpha[i] / inv_arbitrary_scale[i];
+      }
+      const DenominatorGraphTransition
+          *trans_iter = transitions + forward_transitions[h].first,
+          *trans_end = transitions + forward_transitions[h].second;
+      for (; trans_iter != trans_end; ++trans_iter) {
+        BaseFloat transition_prob = trans_iter->transition_prob;
+        int32 pdf_id = trans_iter->pdf_id;
+        const BaseFloat *prob = probs + pdf_id * prob_stride + s_begin,
+            *beta = next_beta + trans_iter->hmm_state * num_sequences +
+            s_begin;
+        BaseFloat *deriv = log_prob_deriv + pdf_id * log_prob_deriv_stride +
+            s_begin;
+        for (int32 i = 0; i < n; i++) {
+          BaseFloat variable_factor = transition_prob * beta[i] * prob[i];
+          sum[i] += variable_factor;
+          deriv[i] += variable_factor * occupation_factor[i];
+        }
+      }
+      BaseFloat *out = this_beta + h * num_sequences + s_begin;
+      for (int32 i = 0; i < n; i++)
+        out[i] = sum[i] / inv_arbitrary_scale[i];
+    }
+  }
+};
+
+// Runs the forward (this_beta == NULL) or backward kernel above for one frame,
+// with the sequences divided between the threads.  The threads write to
+// disjoint elements of the outputs.
+class ChainHmmFrameClass: public MultiThreadable {
+ public:
+  ChainHmmFrameClass(const Int32Pair *state_transitions,
+                     const DenominatorGraphTransition *transitions,
+                     int32 num_sequences, int32 num_hmm_states,
+                     const BaseFloat *probs, int32 prob_stride,
+                     const BaseFloat *alpha, const BaseFloat *next_beta,
+                     BaseFloat *this_alpha, BaseFloat *this_beta,
+                     BaseFloat *log_prob_deriv, int32 log_prob_deriv_stride):
+      state_transitions_(state_transitions), transitions_(transitions),
+      num_sequences_(num_sequences), num_hmm_states_(num_hmm_states),
+      probs_(probs), prob_stride_(prob_stride), alpha_(alpha),
+      next_beta_(next_beta), this_alpha_(this_alpha), this_beta_(this_beta),
+      log_prob_deriv_(log_prob_deriv),
+      log_prob_deriv_stride_(log_prob_deriv_stride) { }
+
+  void operator () () {
+    // Ranges of a multiple of 8 sequences keep the vectors aligned.
+    int32 block = (num_sequences_ + num_threads_ - 1) / num_threads_;
+    block = (block + 7) / 8 * 8;
+    int32 s_begin = std::min(num_sequences_, thread_id_ * block),
+        s_end = std::min(num_sequences_, s_begin + block);
+    if (s_begin == s_end)
+      return;
+    std::vector<double> sum(s_end - s_begin);
+    if (this_beta_ == NULL) {
+      CpuDispatch<ChainHmmForwardKernel>(
+          state_transitions_, transitions_, num_sequences_, num_hmm_states_,
+          s_begin, s_end, probs_, prob_stride_, alpha_, this_alpha_, &(sum[0]));
+    } else {
+      std::vector<BaseFloat> occupation_factor(s_end - s_begin);
+      CpuDispatch<ChainHmmBackwardKernel>(
+          state_transitions_, transitions_, num_sequences_, num_hmm_states_,
+          s_begin, s_end, probs_, prob_stride_, alpha_, next_beta_, this_beta_,
+          log_prob_deriv_, log_prob_deriv_stride_, &(sum[0]),
+          &(occupation_factor[0]));
+    }
+  }
+
+ private:
+  const Int32Pair *state_transitions_;
+  const DenominatorGraphTransition *transitions_;
+  int32 num_sequences_;
+  int32 num_hmm_states_;
+  const BaseFloat *probs_;
+  int32 prob_stride_;
+  const BaseFloat *alpha_;  // the previous alpha-dash for the forward
+                            // computation, this alpha-dash for the backward.
+  const BaseFloat *next_beta_;
+  BaseFloat *this_alpha_;
+  BaseFloat *this_beta_;
+  BaseFloat *log_prob_deriv_;
+  int32 log_prob_deriv_stride_;
+};
+
+}  // namespace
+
 DenominatorComputation::DenominatorComputation(
     const ChainTrainingOptions &opts,
     const DenominatorGraph &den_graph,
@@ -110,7 +267,23 @@ void DenominatorComputation::AlphaGeneralFrame(int32 t) {
   const BaseFloat *prob_data = probs.Data();
 
 #if HAVE_CUDA == 1
-  if (CuDevice::Instantiate().Enabled()) {
+  int32 tile_states = CU1DBLOCK / num_sequences;
+  if (CuDevice::Instantiate().Enabled() && tile_states > 1 &&
+      n_blocks(num_hmm_states, tile_states) <= 65535) {
+    // With few sequences, each block does several HMM states so that it is
+    // full.  This is profiled separately from the kernel below so that they
+    // can be compared.
+    CuTimer tim;
+    dim3 dimBlock(num_sequences, tile_states, 1);
+    dim3 dimGrid(1, n_blocks(num_hmm_states, tile_states), 1);
+    cuda_chain_hmm_forward_tiled(dimGrid, dimBlock,
+                                 backward_transitions, transitions,
+                                 num_sequences, num_hmm_states,
+                                 kMaxTileTransitions, prob_data,
+                                 probs.Stride(), prev_alpha_dash, this_alpha);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile("AlphaGeneralFrameTiled", tim);
+  } else if (CuDevice::Instantiate().Enabled()) {
     CuTimer tim;
     dim3 dimBlock(std::min<int32>(CU1DBLOCK, num_sequences), 1, 1);
     dim3 dimGrid(n_blocks(num_sequences, dimBlock.x), num_hmm_states, 1);
@@ -140,35 +313,11 @@ void DenominatorComputation::AlphaGeneralFrame(int32 t) {
   } else
 #endif
   {
-    int32 prob_stride = probs.Stride();
-    for (int32 h = 0; h < num_hmm_states; h++) {
-      for (int32 s = 0; s < num_sequences; s++) {
-        double this_tot_alpha = 0.0;
-        const DenominatorGraphTransition
-            *trans_iter = transitions + backward_transitions[h].first,
-            *trans_end = transitions + backward_transitions[h].second;
-        for (; trans_iter != trans_end; ++trans_iter) {
-          BaseFloat transition_prob = trans_iter->transition_prob;
-          int32 pdf_id = trans_iter->pdf_id,
-              prev_hmm_state = trans_iter->hmm_state;
-          BaseFloat prob = prob_data[pdf_id * prob_stride + s],
-              this_prev_alpha = prev_alpha_dash[prev_hmm_state * num_sequences + s];
-          this_tot_alpha += this_prev_alpha * transition_prob * prob;
-        }
-        // Let arbitrary_scale be the inverse of the alpha-sum value that we
-        // store in the same place we'd store the alpha for the state numbered
-        // 'num_hmm_states'. We multiply this into all the
-        // transition-probabilities from the previous frame to this frame, in
-        // both the forward and backward passes, in order to keep the alphas in
-        // a good numeric range.  This won't affect the posteriors, but when
-        // computing the total likelihood we'll need to compensate for it later
-        // on.
-        BaseFloat arbitrary_scale =
-            1.0 / prev_alpha_dash[num_hmm_states * num_sequences + s];
-        KALDI_ASSERT(this_tot_alpha - this_tot_alpha == 0);
-        this_alpha[h * num_sequences + s] = this_tot_alpha * arbitrary_scale;
-      }
-    }
+    MultiThreader<ChainHmmFrameClass> threader(
+        opts_.den_num_threads > 1 ? opts_.den_num_threads : 0,
+        ChainHmmFrameClass(backward_transitions, transitions, num_sequences,
+                           num_hmm_states, prob_data, probs.Stride(),
+                           prev_alpha_dash, NULL, this_alpha, NULL, NULL, 0));
   }
 }
 
@@ -340,7 +489,22 @@ void DenominatorComputation::BetaDashGeneralFrame(int32 t) {
       num_sequences = num_sequences_;
 
 #if HAVE_CUDA == 1
-  if (CuDevice::Instantiate().Enabled()) {
+  int32 tile_states = CU1DBLOCK / num_sequences;
+  if (CuDevice::Instantiate().Enabled() && tile_states > 1 &&
+      n_blocks(num_hmm_states, tile_states) <= 65535) {
+    // See AlphaGeneralFrame().
+    CuTimer tim;
+    dim3 dimBlock(num_sequences, tile_states, 1);
+    dim3 dimGrid(1, n_blocks(num_hmm_states, tile_states), 1);
+    cuda_chain_hmm_backward_tiled(dimGrid, dimBlock, forward_transitions,
+                                  transitions, num_sequences, num_hmm_states,
+                                  kMaxTileTransitions, probs.Data(),
+                                  probs.Stride(), this_alpha_dash, next_beta,
+                                  this_beta_dash, log_prob_deriv.Data(),
+                                  log_prob_deriv.Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile("BetaDashGeneralFrameTiled", tim);
+  } else if (CuDevice::Instantiate().Enabled()) {
     CuTimer tim;
     dim3 dimBlock(std::min<int32>(CU1DBLOCK, num_sequences), 1, 1);
     dim3 dimGrid(n_blocks(num_sequences, dimBlock.x), num_hmm_states, 1);
@@ -371,36 +535,12 @@ void DenominatorComputation::BetaDashGeneralFrame(int32 t) {
   } else
 #endif
   {
-    int32 prob_stride = probs.Stride(),
-         deriv_stride = log_prob_deriv.Stride();
-    const BaseFloat *prob_data = probs.Data();
-    BaseFloat *log_prob_deriv_data = log_prob_deriv.Data();
-    for (int32 h = 0; h < num_hmm_states; h++) {
-      for (int32 s = 0; s < num_sequences; s++) {
-        BaseFloat this_alpha_dash_prob = this_alpha_dash[h * num_sequences + s],
-            inv_arbitrary_scale =
-            this_alpha_dash[num_hmm_states * num_sequences + s];
-        double tot_variable_factor = 0.0;
-        BaseFloat occupation_factor = this_alpha_dash_prob /
-            inv_arbitrary_scale;
-        const DenominatorGraphTransition
-            *trans_iter = transitions + forward_transitions[h].first,
-            *trans_end = transitions + forward_transitions[h].second;
-        for (; trans_iter != trans_end; ++trans_iter) {
-          BaseFloat transition_prob = trans_iter->transition_prob;
-          int32 pdf_id = trans_iter->pdf_id,
-              next_hmm_state = trans_iter->hmm_state;
-          BaseFloat variable_factor = transition_prob *
-              next_beta[next_hmm_state * num_sequences + s] *
-              prob_data[pdf_id * prob_stride + s];
-          tot_variable_factor += variable_factor;
-          BaseFloat occupation_prob = variable_factor * occupation_factor;
-          log_prob_deriv_data[pdf_id * deriv_stride + s] += occupation_prob;
-        }
-        this_beta_dash[h * num_sequences + s] =
-            tot_variable_factor / inv_arbitrary_scale;
-      }
-    }
+    MultiThreader<ChainHmmFrameClass> threader(
+        opts_.den_num_threads > 1 ? opts_.den_num_threads : 0,
+        ChainHmmFrameClass(forward_transitions, transitions, num_sequences,
+                           num_hmm_states, probs.Data(), probs.Stride(),
+                           this_alpha_dash, next_beta, NULL, this_beta_dash,
+                           log_prob_deriv.Data(), log_prob_deriv.Stride()));
   }
 }
 
@@ -48,6 +48,33 @@ extern "C" {
                               const BaseFloat *prev_alpha,
                               BaseFloat *this_alpha);
 
+  // These do the same as the above for minibatches with few sequences; see
+  // _cuda_chain_hmm_forward_tiled in chain-kernels.cu.
+  void cuda_chain_hmm_backward_tiled(dim3 Gr, dim3 Bl,
+                                     const Int32Pair *forward_transitions,
+                                     const DenominatorGraphTransition *transitions,
+                                     int32_cuda num_sequences,
+                                     int32_cuda num_hmm_states,
+                                     int32_cuda max_tile_size,
+                                     const BaseFloat *probs,
+                                     int32_cuda prob_stride,
+                                     const BaseFloat *this_alpha,
+                                     const BaseFloat *next_beta,
+                                     BaseFloat *this_beta,
+                                     BaseFloat *log_prob_deriv,
+                                     int32_cuda log_prob_deriv_stride);
+
+  void cuda_chain_hmm_forward_tiled(dim3 Gr, dim3 Bl,
+                                    const Int32Pair *backward_transitions,
+                                    const DenominatorGraphTransition *transitions,
+                                    int32_cuda num_sequences,
+                                    int32_cuda num_hmm_states,
+                                    int32_cuda max_tile_size,
+                                    const BaseFloat *probs,
+                                    int32_cuda prob_stride,
+                                    const BaseFloat *prev_alpha,
+                                    BaseFloat *this_alpha);
+
 } // extern "C"
 
 #endif  // HAVE_CUDA
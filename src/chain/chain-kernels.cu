@@ -256,6 +256,117 @@ static void _cuda_chain_hmm_backward(const Int32Pair *forward_transitions,
 }
 
 
+// Copies into the shared memory 'tile' the transitions of the HMM states
+// handled by this block of _cuda_chain_hmm_{forward,backward}_tiled, which are
+// contiguous in 'transitions', if there are no more than 'max_tile_size' of
+// them.  Returns the offset to add to the indexes in 'state_transitions' to
+// index 'tile', or -1 if they didn't fit (then 'transitions' is used).
+__device__
+static int32_cuda _chain_load_transition_tile(
+    const Int32Pair *state_transitions,
+    const DenominatorGraphTransition *transitions,
+    int32_cuda num_hmm_states, int32_cuda max_tile_size,
+    DenominatorGraphTransition *tile) {
+  int32_cuda h_begin = blockIdx.y * blockDim.y,
+      h_end = min(h_begin + static_cast<int32_cuda>(blockDim.y),
+                  num_hmm_states),
+      tile_begin = state_transitions[h_begin].first,
+      tile_size = state_transitions[h_end - 1].second - tile_begin;
+  bool use_tile = (tile_size <= max_tile_size);
+  if (use_tile) {
+    for (int32_cuda i = threadIdx.y * blockDim.x + threadIdx.x; i < tile_size;
+         i += blockDim.x * blockDim.y)
+      tile[i] = transitions[tile_begin + i];
+  }
+  __syncthreads();
+  return (use_tile ? -tile_begin : -1);
+}
+
+// This does the same as _cuda_chain_hmm_forward, but for minibatches with few
+// sequences: a block handles blockDim.y HMM states (threadIdx.y) for
+// blockDim.x sequences (threadIdx.x), so the blocks are full even if
+// num_sequences is much less than CU1DBLOCK.  The transitions of the block's
+// states are first loaded into shared memory, where all the sequences of a
+// state read them.  Launch it with max_tile_size *
+// sizeof(DenominatorGraphTransition) bytes of shared memory.
+__global__
+static void _cuda_chain_hmm_forward_tiled(
+    const Int32Pair *backward_transitions,
+    const DenominatorGraphTransition *transitions,
+    int32_cuda num_sequences, int32_cuda num_hmm_states,
+    int32_cuda max_tile_size, const BaseFloat *probs, int32_cuda prob_stride,
+    const BaseFloat *prev_alpha, BaseFloat *this_alpha) {
+  extern __shared__ DenominatorGraphTransition forward_tile[];
+  int32_cuda offset = _chain_load_transition_tile(backward_transitions,
+                                                  transitions, num_hmm_states,
+                                                  max_tile_size, forward_tile);
+  int32_cuda s = threadIdx.x + blockIdx.x * blockDim.x,
+      h = threadIdx.y + blockIdx.y * blockDim.y;
+  if (s >= num_sequences || h >= num_hmm_states)
+    return;
+  const DenominatorGraphTransition *trans_base =
+      (offset == -1 ? transitions : forward_tile + offset),
+      *trans_iter = trans_base + backward_transitions[h].first,
+      *trans_end = trans_base + backward_transitions[h].second;
+  double this_tot_alpha = 0.0;
+  for (; trans_iter != trans_end; ++trans_iter) {
+    BaseFloat transition_prob = trans_iter->transition_prob;
+    int32_cuda pdf_id = trans_iter->pdf_id,
+        prev_hmm_state = trans_iter->hmm_state;
+    this_tot_alpha += prev_alpha[prev_hmm_state * num_sequences + s] *
+        transition_prob * probs[pdf_id * prob_stride + s];
+  }
+  // See _cuda_chain_hmm_forward for the arbitrary scale.
+  BaseFloat arbitrary_scale =
+      1.0 / prev_alpha[num_hmm_states * num_sequences + s];
+  this_alpha[h * num_sequences + s] = this_tot_alpha * arbitrary_scale;
+}
+
+// This does the same as _cuda_chain_hmm_backward, with the blocks arranged as
+// for _cuda_chain_hmm_forward_tiled.
+__global__
+static void _cuda_chain_hmm_backward_tiled(
+    const Int32Pair *forward_transitions,
+    const DenominatorGraphTransition *transitions,
+    int32_cuda num_sequences, int32_cuda num_hmm_states,
+    int32_cuda max_tile_size, const BaseFloat *probs, int32_cuda prob_stride,
+    const BaseFloat *this_alpha, const BaseFloat *next_beta,
+    BaseFloat *this_beta, BaseFloat *log_prob_deriv,
+    int32_cuda log_prob_deriv_stride) {
+  extern __shared__ DenominatorGraphTransition backward_tile[];
+  int32_cuda offset = _chain_load_transition_tile(forward_transitions,
+                                                  transitions, num_hmm_states,
+                                                  max_tile_size, backward_tile);
+  int32_cuda s = threadIdx.x + blockIdx.x * blockDim.x,
+      h = threadIdx.y + blockIdx.y * blockDim.y;
+  if (s >= num_sequences || h >= num_hmm_states)
+    return;
+  BaseFloat this_alpha_prob = this_alpha[h * num_sequences + s],
+      inv_arbitrary_scale =
+      this_alpha[num_hmm_states * num_sequences + s];
+  double tot_variable_factor = 0.0;
+  BaseFloat occupation_factor = this_alpha_prob / inv_arbitrary_scale;
+  const DenominatorGraphTransition *trans_base =
+      (offset == -1 ? transitions : backward_tile + offset),
+      *trans_iter = trans_base + forward_transitions[h].first,
+      *trans_end = trans_base + forward_transitions[h].second;
+  for (; trans_iter != trans_end; ++trans_iter) {
+    BaseFloat transition_prob = trans_iter->transition_prob;
+    int32_cuda pdf_id = trans_iter->pdf_id,
+        next_hmm_state = trans_iter->hmm_state;
+    BaseFloat variable_factor = transition_prob *
+        next_beta[next_hmm_state * num_sequences + s] *
+        probs[pdf_id * prob_stride + s];
+    tot_variable_factor += variable_factor;
+    BaseFloat occupation_prob = variable_factor * occupation_factor;
+    atomic_add_thresholded(log_prob_deriv + (pdf_id * log_prob_deriv_stride + s),
+                           occupation_prob);
+  }
+  BaseFloat beta = tot_variable_factor / inv_arbitrary_scale;
+  this_beta[h * num_sequences + s] = beta;
+}
+
+
 void cuda_chain_hmm_forward(dim3 Gr, dim3 Bl,
                             const Int32Pair *backward_transitions,
                             const DenominatorGraphTransition *transitions,
@@ -287,3 +398,39 @@ void cuda_chain_hmm_backward(dim3 Gr, dim3 Bl,
                                       this_beta, log_prob_deriv,
                                       log_prob_deriv_stride);
 }
+
+void cuda_chain_hmm_forward_tiled(dim3 Gr, dim3 Bl,
+                                  const Int32Pair *backward_transitions,
+                                  const DenominatorGraphTransition *transitions,
+                                  int32_cuda num_sequences,
+                                  int32_cuda num_hmm_states,
+                                  int32_cuda max_tile_size,
+                                  const BaseFloat *probs,
+                                  int32_cuda prob_stride,
+                                  const BaseFloat *prev_alpha,
+                                  BaseFloat *this_alpha) {
+  _cuda_chain_hmm_forward_tiled<<<Gr, Bl,
+      max_tile_size * sizeof(DenominatorGraphTransition)>>>(
+          backward_transitions, transitions, num_sequences, num_hmm_states,
+          max_tile_size, probs, prob_stride, prev_alpha, this_alpha);
+}
+
+void cuda_chain_hmm_backward_tiled(dim3 Gr, dim3 Bl,
+                                   const Int32Pair *forward_transitions,
+                                   const DenominatorGraphTransition *transitions,
+                                   int32_cuda num_sequences,
+                                   int32_cuda num_hmm_states,
+                                   int32_cuda max_tile_size,
+                                   const BaseFloat *probs,
+                                   int32_cuda prob_stride,
+                                   const BaseFloat *this_alpha,
+                                   const BaseFloat *next_beta,
+                                   BaseFloat *this_beta,
+                                   BaseFloat *log_prob_deriv,
+                                   int32_cuda log_prob_deriv_stride) {
+  _cuda_chain_hmm_backward_tiled<<<Gr, Bl,
+      max_tile_size * sizeof(DenominatorGraphTransition)>>>(
+          forward_transitions, transitions, num_sequences, num_hmm_states,
+          max_tile_size, probs, prob_stride, this_alpha, next_beta, this_beta,
+          log_prob_deriv, log_prob_deriv_stride);
+}
@@ -412,6 +412,25 @@ void ChainDenominatorTest(const DenominatorGraph &den_graph) {
                  10.0);
   }
 
+  bool use_gpu = false;
+#if HAVE_CUDA == 1
+  use_gpu = CuDevice::Instantiate().Enabled();
+#endif
+  if (!use_gpu) {
+    // Splitting the CPU computation over threads should not change the
+    // results at all.
+    ChainTrainingOptions threaded_opts(opts);
+    threaded_opts.den_num_threads = RandInt(2, 3);
+    DenominatorComputation threaded_computation(threaded_opts, den_graph,
+                                                num_sequences, nnet_output);
+    KALDI_ASSERT(threaded_computation.Forward() == forward_prob);
+    CuMatrix<BaseFloat> threaded_deriv(nnet_output.NumRows(),
+                                       nnet_output.NumCols());
+    threaded_computation.Backward(1.0, &threaded_deriv);
+    threaded_deriv.AddMat(-1.0, nnet_output_deriv);
+    KALDI_ASSERT(threaded_deriv.FrobeniusNorm() == 0.0);
+  }
+
   int32 num_tries = 5;
   BaseFloat epsilon = 1.0e-04;
   Vector<BaseFloat> predicted_objf_changes(num_tries),
@@ -755,27 +755,71 @@ void MergeSupervision(const std::vector<const Supervision*> &input,
     KALDI_ASSERT(input[i]->label_dim == label_dim &&
                  "Trying to append incompatible Supervision objects");
     KALDI_ASSERT(input[i]->alignment_pdfs.empty());
-  }
-  *output_supervision = *(input[num_inputs-1]);
-  for (int32 i = num_inputs - 2; i >= 0; i--) {
-    const Supervision &src = *(input[i]);
-    if (output_supervision->weight == src.weight &&
-        output_supervision->frames_per_sequence ==
-        src.frames_per_sequence) {
-      // Combine with current output
-      // append src.fst to output_supervision->fst.
-      // the complexity here is O(V1 + E1)
-      fst::Concat(src.fst, &output_supervision->fst);
-      output_supervision->num_sequences++;
-    } else {
+    if (input[i]->weight != input[0]->weight ||
+        input[i]->frames_per_sequence != input[0]->frames_per_sequence)
       KALDI_ERR << "Mismatch weight or frames_per_sequence  between inputs";
-    }
-
   }
+  output_supervision->weight = input[0]->weight;
+  output_supervision->frames_per_sequence = input[0]->frames_per_sequence;
+  output_supervision->label_dim = label_dim;
+  output_supervision->num_sequences = 0;
+  output_supervision->e2e_fsts.clear();
+  output_supervision->alignment_pdfs.clear();
+
+  // The FSTs are concatenated directly, without the epsilons (and the
+  // RmEpsilon() and state sorting) that fst::Concat() would need.  This relies
+  // on the properties of the supervision FSTs: the states are in increasing
+  // order of time, the start state 0 has no arcs entering it, and all paths
+  // have the same length, so the final states are the last ones to be reached.
+  // The start state of each FST after the first is dropped, and the arcs
+  // leaving it leave each final state of the FST before instead (times its
+  // final-prob).  The states stay in increasing order of time.
+  typedef fst::StdArc::Weight Weight;
   fst::StdVectorFst &out_fst = output_supervision->fst;
-  // The process of concatenation will have introduced epsilons.
-  fst::RmEpsilon(&out_fst);
-  SortBreadthFirstSearch(&out_fst);
+  out_fst.DeleteStates();
+  std::vector<std::pair<int32, Weight> > prev_final_states;
+  for (int32 i = 0; i < num_inputs; i++) {
+    const fst::StdVectorFst &src_fst = input[i]->fst;
+    KALDI_ASSERT(src_fst.Start() == 0);
+    output_supervision->num_sequences += input[i]->num_sequences;
+    int32 src_num_states = src_fst.NumStates(),
+        first_src_state = (i == 0 ? 0 : 1),
+        // the output state of source state s (if s >= first_src_state).
+        offset = out_fst.NumStates() - first_src_state;
+    for (int32 s = first_src_state; s < src_num_states; s++)
+      out_fst.AddState();
+    if (i == 0)
+      out_fst.SetStart(0);
+    std::vector<std::pair<int32, Weight> > final_states;
+    for (int32 s = 0; s < src_num_states; s++) {
+      for (fst::ArcIterator<fst::StdVectorFst> aiter(src_fst, s);
+           !aiter.Done(); aiter.Next()) {
+        fst::StdArc arc = aiter.Value();
+        KALDI_ASSERT(arc.nextstate > 0);
+        arc.nextstate += offset;
+        if (s < first_src_state) {
+          for (size_t j = 0; j < prev_final_states.size(); j++)
+            out_fst.AddArc(prev_final_states[j].first,
+                           fst::StdArc(arc.ilabel, arc.olabel,
+                                       fst::Times(prev_final_states[j].second,
+                                                  arc.weight),
+                                       arc.nextstate));
+        } else {
+          out_fst.AddArc(s + offset, arc);
+        }
+      }
+      Weight final_weight = src_fst.Final(s);
+      if (final_weight != Weight::Zero()) {
+        KALDI_ASSERT(s >= first_src_state);
+        if (i + 1 == num_inputs)
+          out_fst.SetFinal(s + offset, final_weight);
+        else
+          final_states.push_back(std::pair<int32, Weight>(s + offset,
+                                                          final_weight));
+      }
+    }
+    prev_final_states.swap(final_states);
+  }
 }
 
 // This static function is called by AddWeightToSupervisionFst if the supervision
@@ -62,8 +62,12 @@ struct ChainTrainingOptions {
   // should have a softmax as its final nonlinearity.
   BaseFloat xent_regularize;
 
+  // Number of threads for the forward-backward of the denominator computation
+  // when it is not done on a GPU.
+  int32 den_num_threads;
+
   ChainTrainingOptions(): l2_regularize(0.0), leaky_hmm_coefficient(1.0e-05),
-                          xent_regularize(0.0) { }
+                          xent_regularize(0.0), den_num_threads(1) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("l2-regularize", &l2_regularize, "l2 regularization "
@@ -79,6 +83,9 @@ struct ChainTrainingOptions {
                    "nonzero, the network is expected to have an output "
                    "named 'output-xent', which should have a softmax as "
                    "its final nonlinearity.");
+    opts->Register("den-num-threads", &den_num_threads, "Number of threads "
+                   "for the denominator forward-backward when not using a "
+                   "GPU.");
   }
 };
 
@@ -23,33 +23,94 @@
 #include "util/common-utils.h"
 #include "chain/chain-supervision.h"
 #include "tree/context-dep.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 namespace chain {
 
 
-// This wrapper function does all the job of processing the features and
-// lattice into ChainSupervision objects, and writing them out.
-static bool ProcessSupervision(const TransitionModel &trans_model,
-                               const ContextDependencyInterface &ctx_dep,
-                               const ProtoSupervision &proto_sup,
-                               const std::string &key,
-                               bool convert_to_pdfs,
-                               SupervisionWriter *supervision_writer) {
-  Supervision supervision;
-  if (!ProtoSupervisionToSupervision(ctx_dep, trans_model,
-                                     proto_sup, convert_to_pdfs,
-                                     &supervision)) {
-    KALDI_WARN << "Failed creating supervision for utterance "
-               << key;
-    return false;
+// This class does all the job of processing the alignment or lattice of an
+// utterance into a Supervision object (in operator (), which may run in
+// parallel with other utterances), and writing it out (in the destructor,
+// which TaskSequencer calls in the order of the input).
+class SupervisionTask {
+ public:
+  // Takes the alignment of the utterance (phones and durations).
+  SupervisionTask(const SupervisionOptions &sup_opts,
+                  const TransitionModel &trans_model,
+                  const ContextDependencyInterface &ctx_dep,
+                  const std::string &key,
+                  const std::vector<std::pair<int32, int32> > &ali,
+                  SupervisionWriter *supervision_writer,
+                  int32 *num_utts_done, int32 *num_utts_error):
+      sup_opts_(sup_opts), trans_model_(trans_model), ctx_dep_(ctx_dep),
+      key_(key), lattice_input_(false), ali_(ali),
+      supervision_writer_(supervision_writer),
+      num_utts_done_(num_utts_done), num_utts_error_(num_utts_error),
+      ok_(false) { }
+
+  // Takes the phone lattice of the utterance.
+  SupervisionTask(const SupervisionOptions &sup_opts,
+                  const TransitionModel &trans_model,
+                  const ContextDependencyInterface &ctx_dep,
+                  const std::string &key,
+                  const CompactLattice &clat,
+                  SupervisionWriter *supervision_writer,
+                  int32 *num_utts_done, int32 *num_utts_error):
+      sup_opts_(sup_opts), trans_model_(trans_model), ctx_dep_(ctx_dep),
+      key_(key), lattice_input_(true), clat_(clat),
+      supervision_writer_(supervision_writer),
+      num_utts_done_(num_utts_done), num_utts_error_(num_utts_error),
+      ok_(false) { }
+
+  void operator () () {
+    ProtoSupervision proto_supervision;
+    if (lattice_input_) {
+      if (!PhoneLatticeToProtoSupervision(sup_opts_, clat_,
+                                          &proto_supervision)) {
+        KALDI_WARN << "Error creating proto-supervision for utterance "
+                   << key_;
+        return;
+      }
+    } else {
+      AlignmentToProtoSupervision(sup_opts_, ali_, &proto_supervision);
+    }
+    if (!ProtoSupervisionToSupervision(ctx_dep_, trans_model_,
+                                       proto_supervision,
+                                       sup_opts_.convert_to_pdfs,
+                                       &supervision_)) {
+      KALDI_WARN << "Failed creating supervision for utterance "
+                 << key_;
+      return;
+    }
+    if (RandInt(0, 10) == 0)
+      supervision_.Check(trans_model_);
+    ok_ = true;
   }
-  if (RandInt(0, 10) == 0)
-    supervision.Check(trans_model);
 
-  supervision_writer->Write(key, supervision);
-  return true;
-}
+  ~SupervisionTask() {
+    if (ok_) {
+      supervision_writer_->Write(key_, supervision_);
+      (*num_utts_done_)++;
+    } else {
+      (*num_utts_error_)++;
+    }
+  }
+
+ private:
+  const SupervisionOptions &sup_opts_;
+  const TransitionModel &trans_model_;
+  const ContextDependencyInterface &ctx_dep_;
+  std::string key_;
+  bool lattice_input_;
+  std::vector<std::pair<int32, int32> > ali_;
+  CompactLattice clat_;
+  SupervisionWriter *supervision_writer_;
+  int32 *num_utts_done_;
+  int32 *num_utts_error_;
+  Supervision supervision_;
+  bool ok_;
+};
 
 
 } // namespace chain
@@ -74,14 +135,18 @@ int main(int argc, char *argv[]) {
         "\n"
         "Usage: chain-get-supervision [options] <tree> <transition-model> "
         "[<phones-with-lengths-rspecifier>|<phone-lattice-rspecifier>] <supervision-wspecifier>\n"
-        "See steps/nnet3/chain/get_egs.sh for example\n";
+        "See steps/nnet3/chain/get_egs.sh for example\n"
+        "With --num-threads, utterances are processed in parallel (the\n"
+        "output is in the same order).\n";
 
 
     bool lattice_input = false;
     SupervisionOptions sup_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     ParseOptions po(usage);
     sup_opts.Register(&po);
+    sequencer_config.Register(&po);
     po.Register("lattice-input", &lattice_input, "If true, expect phone "
                 "lattices as input");
 
@@ -107,44 +172,30 @@ int main(int argc, char *argv[]) {
 
     int32 num_utts_done = 0, num_utts_error = 0;
 
-    if (lattice_input) {
-      SequentialCompactLatticeReader clat_reader(phone_durs_or_lat_rspecifier);
-      for (; !clat_reader.Done(); clat_reader.Next()) {
-        std::string key = clat_reader.Key();
-        const CompactLattice &clat = clat_reader.Value();
-        ProtoSupervision proto_supervision;
-        bool ans = PhoneLatticeToProtoSupervision(sup_opts, clat,
-                                                  &proto_supervision);
-        if (!ans) {
-          KALDI_WARN << "Error creating proto-supervision for utterance " << key;
-          num_utts_error++;
-          continue;
-        }
-        if (ProcessSupervision(trans_model, ctx_dep,
-                               proto_supervision, key,
-                               sup_opts.convert_to_pdfs,
-                               &supervision_writer))
-          num_utts_done++;
-        else
-          num_utts_error++;
-      }
-    } else {
-      SequentialInt32PairVectorReader phone_and_dur_reader(
-          phone_durs_or_lat_rspecifier);
-      for (; !phone_and_dur_reader.Done(); phone_and_dur_reader.Next()) {
-        std::string key = phone_and_dur_reader.Key();
-        const std::vector<std::pair<int32,int32> > &ali =
-            phone_and_dur_reader.Value();
-        ProtoSupervision proto_supervision;
-        AlignmentToProtoSupervision(sup_opts, ali,
-                                    &proto_supervision);
-        if (ProcessSupervision(trans_model, ctx_dep,
-                               proto_supervision, key,
-                               sup_opts.convert_to_pdfs,
-                               &supervision_writer))
-          num_utts_done++;
-        else
-          num_utts_error++;
+    {
+      // the transition model, tree and options are shared (read-only) by the
+      // tasks; the destructor waits for them all.
+      TaskSequencer<SupervisionTask> sequencer(sequencer_config);
+      if (lattice_input) {
+        SequentialCompactLatticeReader clat_reader(
+            phone_durs_or_lat_rspecifier);
+        for (; !clat_reader.Done(); clat_reader.Next())
+          sequencer.Run(new SupervisionTask(sup_opts, trans_model, ctx_dep,
+                                            clat_reader.Key(),
+                                            clat_reader.Value(),
+                                            &supervision_writer,
+                                            &num_utts_done,
+                                            &num_utts_error));
+      } else {
+        SequentialInt32PairVectorReader phone_and_dur_reader(
+            phone_durs_or_lat_rspecifier);
+        for (; !phone_and_dur_reader.Done(); phone_and_dur_reader.Next())
+          sequencer.Run(new SupervisionTask(sup_opts, trans_model, ctx_dep,
+                                            phone_and_dur_reader.Key(),
+                                            phone_and_dur_reader.Value(),
+                                            &supervision_writer,
+                                            &num_utts_done,
+                                            &num_utts_error));
       }
     }
     KALDI_LOG << "Generated chain supervision information for "
@@ -17,6 +17,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <mutex>
 #include <sstream>
 
 #include "base/kaldi-common.h"
@@ -26,14 +27,58 @@
 #include "nnet3/nnet-example.h"
 #include "nnet3/nnet-chain-example.h"
 #include "nnet3/nnet-example-utils.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 namespace nnet3 {
 
 
+// Copies of the normalization FST for the tasks below.  Composition with an
+// FST is not thread-safe even when it is const (OpenFst caches its properties),
+// so each task that is running uses its own copy, of which there are at most
+// --num-threads.
+class NormalizationFstPool {
+ public:
+  explicit NormalizationFstPool(const fst::StdVectorFst &normalization_fst):
+      normalization_fst_(normalization_fst) { }
+
+  const fst::StdVectorFst *Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+      // The copy constructor of VectorFst would share the implementation, so
+      // copy it as an Fst.
+      fst::StdVectorFst *copy = new fst::StdVectorFst(
+          static_cast<const fst::StdFst&>(normalization_fst_));
+      fsts_.push_back(copy);
+      return copy;
+    }
+    const fst::StdVectorFst *ans = free_.back();
+    free_.pop_back();
+    return ans;
+  }
+
+  void Release(const fst::StdVectorFst *fst) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(fst);
+  }
+
+  ~NormalizationFstPool() { DeletePointers(&fsts_); }
+
+ private:
+  const fst::StdVectorFst &normalization_fst_;
+  std::mutex mutex_;
+  std::vector<fst::StdVectorFst*> fsts_;
+  std::vector<const fst::StdVectorFst*> free_;
+};
+
 /**
-   This function does all the processing for one utterance, and outputs the
-   supervision objects to 'example_writer'.
+   This class does the processing for one utterance: the supervision is split
+   into chunks and normalized and the examples are created in operator (),
+   which may run in parallel with other utterances, and they are written to
+   'example_writers' in the destructor, which TaskSequencer calls in the order
+   of the input.  The chunks, and anything else random, are chosen in the
+   constructor, which is called in the main thread, so the egs do not depend
+   on the number of threads.
 
      @param [in]  trans_mdl           The transition-model for the tree for which we
                                       are dumping egs.  This is expected to be
@@ -45,10 +90,10 @@ namespace nnet3 {
                                       which contain pdf-ids+1 but which won't enforce any
                                       alignment constraints interior to the
                                       utterance.
-     @param [in]  normalization_fst   A version of denominator FST used to add weights
+     @param [in]  normalization_fsts  Copies of a version of denominator FST used to add weights
                                       to the created supervision. It is
                                       actually an FST expected to have the
-                                      labels as (pdf-id+1).  If this has no states,
+                                      labels as (pdf-id+1).  If this is NULL,
                                       we skip the final stage of egs preparation
                                       in which we compose with the normalization
                                       FST, and you should do it later with
@@ -82,39 +127,91 @@ namespace nnet3 {
      @param [out]  utt_splitter       Pointer to UtteranceSplitter object,
                                       which helps to split an utterance into
                                       chunks. This also stores some stats.
-     @param [out]  example_writer     Pointer to egs writer.
-
+     @param [out]  example_writers    The egs writers; the egs are written
+                                      to them in turn.
+     @param [in,out] num_written      The number of egs written so far, which
+                                      decides the writer of the next eg.
+
+   The inputs are copied, as far as needed.  After construction, Ok() is false
+   if the utterance cannot be processed (a warning has been printed) and the
+   task should just be deleted.
 **/
-
-static bool ProcessFile(const TransitionModel *trans_mdl,
-                        const fst::StdVectorFst &normalization_fst,
-                        const GeneralMatrix &feats,
-                        const MatrixBase<BaseFloat> *ivector_feats,
-                        int32 ivector_period,
-                        const chain::Supervision &supervision,
-                        const VectorBase<BaseFloat> *deriv_weights,
-                        int32 supervision_length_tolerance,
-                        const std::string &utt_id,
-                        bool compress,
-                        UtteranceSplitter *utt_splitter,
-                        NnetChainExampleWriter *example_writer) {
+class ChainExampleTask {
+ public:
+  ChainExampleTask(const TransitionModel *trans_mdl,
+                   NormalizationFstPool *normalization_fsts,
+                   const GeneralMatrix &feats,
+                   const MatrixBase<BaseFloat> *ivector_feats,
+                   int32 ivector_period,
+                   const chain::Supervision &supervision,
+                   const VectorBase<BaseFloat> *deriv_weights,
+                   int32 supervision_length_tolerance,
+                   const std::string &utt_id,
+                   bool compress,
+                   UtteranceSplitter *utt_splitter,
+                   std::vector<NnetChainExampleWriter*> *example_writers,
+                   int64 *num_written);
+
+  bool Ok() const { return !chunks_.empty(); }
+
+  void operator () ();
+
+  ~ChainExampleTask();
+
+ private:
+  const TransitionModel *trans_mdl_;
+  NormalizationFstPool *normalization_fsts_;
+  GeneralMatrix feats_;
+  chain::Supervision supervision_;
+  Vector<BaseFloat> deriv_weights_;
+  bool has_deriv_weights_;
+  std::string utt_id_;
+  bool compress_;
+  int32 frame_subsampling_factor_;
+  std::vector<NnetChainExampleWriter*> *example_writers_;
+  int64 *num_written_;
+  std::vector<ChunkTimeInfo> chunks_;
+  // the iVector of each chunk (if there are iVectors); they are chosen from a
+  // random frame in the chunk.
+  std::vector<Vector<BaseFloat> > chunk_ivectors_;
+  // the output of operator ().
+  std::vector<NnetChainExample> egs_;
+};
+
+ChainExampleTask::ChainExampleTask(
+    const TransitionModel *trans_mdl,
+    NormalizationFstPool *normalization_fsts,
+    const GeneralMatrix &feats,
+    const MatrixBase<BaseFloat> *ivector_feats,
+    int32 ivector_period,
+    const chain::Supervision &supervision,
+    const VectorBase<BaseFloat> *deriv_weights,
+    int32 supervision_length_tolerance,
+    const std::string &utt_id,
+    bool compress,
+    UtteranceSplitter *utt_splitter,
+    std::vector<NnetChainExampleWriter*> *example_writers,
+    int64 *num_written):
+    trans_mdl_(trans_mdl), normalization_fsts_(normalization_fsts),
+    has_deriv_weights_(deriv_weights != NULL), utt_id_(utt_id),
+    compress_(compress),
+    frame_subsampling_factor_(utt_splitter->Config().frame_subsampling_factor),
+    example_writers_(example_writers), num_written_(num_written) {
   KALDI_ASSERT(supervision.num_sequences == 1);
   int32 num_input_frames = feats.NumRows(),
       num_output_frames = supervision.frames_per_sequence;
 
-  int32 frame_subsampling_factor = utt_splitter->Config().frame_subsampling_factor;
-
   if (deriv_weights && (std::abs(deriv_weights->Dim() - num_output_frames)
                         > supervision_length_tolerance)) {
     KALDI_WARN << "For utterance " << utt_id
                << ", mismatch between deriv-weights dim and num-output-frames"
                << "; " << deriv_weights->Dim() << " vs " << num_output_frames;
-    return false;
+    return;
   }
 
   if (!utt_splitter->LengthsMatch(utt_id, num_input_frames, num_output_frames,
                                   supervision_length_tolerance))
-    return false;  // LengthsMatch() will have printed a warning.
+    return;  // LengthsMatch() will have printed a warning.
 
   // It can happen if people mess with the feature frame-width options, that
   // there can be small mismatches in length between the supervisions (derived
@@ -123,24 +220,50 @@ static bool ProcessFile(const TransitionModel *trans_mdl,
   // than plausible for this num_output_frames, then it could lead us to try to
   // access frames in the supervision that don't exist.  The following
   // if-statement is to prevent that happening.
-  if (num_input_frames > num_output_frames * frame_subsampling_factor)
-    num_input_frames = num_output_frames * frame_subsampling_factor;
+  if (num_input_frames > num_output_frames * frame_subsampling_factor_)
+    num_input_frames = num_output_frames * frame_subsampling_factor_;
 
-  std::vector<ChunkTimeInfo> chunks;
+  utt_splitter->GetChunksForUtterance(num_input_frames, &chunks_);
 
-  utt_splitter->GetChunksForUtterance(num_input_frames, &chunks);
-
-  if (chunks.empty()) {
+  if (chunks_.empty()) {
     KALDI_WARN << "Not producing egs for utterance " << utt_id
                << " because it is too short: "
                << num_input_frames << " frames.";
-    return false;
+    return;
   }
 
-  chain::SupervisionSplitter sup_splitter(supervision);
+  if (ivector_feats != NULL) {
+    chunk_ivectors_.resize(chunks_.size());
+    for (size_t c = 0; c < chunks_.size(); c++) {
+      const ChunkTimeInfo &chunk = chunks_[c];
+      int32 start_frame = chunk.first_frame - chunk.left_context;
+      // choose iVector from a random frame in the chunk
+      int32 ivector_frame = RandInt(start_frame,
+                                    start_frame + num_input_frames - 1),
+          ivector_frame_subsampled = ivector_frame / ivector_period;
+      if (ivector_frame_subsampled < 0)
+        ivector_frame_subsampled = 0;
+      if (ivector_frame_subsampled >= ivector_feats->NumRows())
+        ivector_frame_subsampled = ivector_feats->NumRows() - 1;
+      chunk_ivectors_[c] = ivector_feats->Row(ivector_frame_subsampled);
+    }
+  }
+  feats_ = feats;
+  supervision_ = supervision;
+  if (deriv_weights != NULL)
+    deriv_weights_ = *deriv_weights;
+}
+
+void ChainExampleTask::operator () () {
+  int32 frame_subsampling_factor = frame_subsampling_factor_;
+  const fst::StdVectorFst *normalization_fst =
+      (normalization_fsts_ != NULL ? normalization_fsts_->Acquire() : NULL);
+
+  chain::SupervisionSplitter sup_splitter(supervision_);
 
-  for (size_t c = 0; c < chunks.size(); c++) {
-    ChunkTimeInfo &chunk = chunks[c];
+  egs_.resize(chunks_.size());
+  for (size_t c = 0; c < chunks_.size(); c++) {
+    ChunkTimeInfo &chunk = chunks_[c];
 
     int32 start_frame_subsampled = chunk.first_frame / frame_subsampling_factor,
         num_frames_subsampled = chunk.num_frames / frame_subsampling_factor;
@@ -150,13 +273,13 @@ static bool ProcessFile(const TransitionModel *trans_mdl,
                                num_frames_subsampled,
                                &supervision_part);
 
-    if (trans_mdl != NULL)
-      ConvertSupervisionToUnconstrained(*trans_mdl, &supervision_part);
+    if (trans_mdl_ != NULL)
+      ConvertSupervisionToUnconstrained(*trans_mdl_, &supervision_part);
 
-    if (normalization_fst.NumStates() > 0 &&
-        !AddWeightToSupervisionFst(normalization_fst,
+    if (normalization_fst != NULL &&
+        !AddWeightToSupervisionFst(*normalization_fst,
                                    &supervision_part)) {
-      KALDI_WARN << "For utterance " << utt_id << ", feature frames "
+      KALDI_WARN << "For utterance " << utt_id_ << ", feature frames "
                  << chunk.first_frame << " to "
                  << (chunk.first_frame + chunk.num_frames)
                  << ", FST was empty after composing with normalization FST. "
@@ -166,14 +289,14 @@ static bool ProcessFile(const TransitionModel *trans_mdl,
     int32 first_frame = 0;  // we shift the time-indexes of all these parts so
                             // that the supervised part starts from frame 0.
 
-    NnetChainExample nnet_chain_eg;
+    NnetChainExample &nnet_chain_eg = egs_[c];
     nnet_chain_eg.outputs.resize(1);
 
     SubVector<BaseFloat> output_weights(
         &(chunk.output_weights[0]),
         static_cast<int32>(chunk.output_weights.size()));
 
-    if (!deriv_weights) {
+    if (!has_deriv_weights_) {
       NnetChainSupervision nnet_supervision("output", supervision_part,
                                             output_weights,
                                             first_frame,
@@ -183,8 +306,8 @@ static bool ProcessFile(const TransitionModel *trans_mdl,
       Vector<BaseFloat> this_deriv_weights(num_frames_subsampled);
       for (int32 i = 0; i < num_frames_subsampled; i++) {
         int32 t = i + start_frame_subsampled;
-        if (t < deriv_weights->Dim())
-          this_deriv_weights(i) = (*deriv_weights)(t);
+        if (t < deriv_weights_.Dim())
+          this_deriv_weights(i) = deriv_weights_(t);
       }
       KALDI_ASSERT(output_weights.Dim() == num_frames_subsampled);
       this_deriv_weights.MulElements(output_weights);
@@ -195,46 +318,44 @@ static bool ProcessFile(const TransitionModel *trans_mdl,
       nnet_chain_eg.outputs[0].Swap(&nnet_supervision);
     }
 
-    nnet_chain_eg.inputs.resize(ivector_feats != NULL ? 2 : 1);
+    nnet_chain_eg.inputs.resize(chunk_ivectors_.empty() ? 1 : 2);
 
     int32 tot_input_frames = chunk.left_context + chunk.num_frames +
         chunk.right_context,
         start_frame = chunk.first_frame - chunk.left_context;
 
     GeneralMatrix input_frames;
-    ExtractRowRangeWithPadding(feats, start_frame, tot_input_frames,
+    ExtractRowRangeWithPadding(feats_, start_frame, tot_input_frames,
                                &input_frames);
 
     NnetIo input_io("input", -chunk.left_context, input_frames);
     nnet_chain_eg.inputs[0].Swap(&input_io);
 
-    if (ivector_feats != NULL) {
+    if (!chunk_ivectors_.empty()) {
       // if applicable, add the iVector feature.
-      // choose iVector from a random frame in the chunk
-      int32 ivector_frame = RandInt(start_frame,
-                                    start_frame + num_input_frames - 1),
-          ivector_frame_subsampled = ivector_frame / ivector_period;
-      if (ivector_frame_subsampled < 0)
-        ivector_frame_subsampled = 0;
-      if (ivector_frame_subsampled >= ivector_feats->NumRows())
-        ivector_frame_subsampled = ivector_feats->NumRows() - 1;
-      Matrix<BaseFloat> ivector(1, ivector_feats->NumCols());
-      ivector.Row(0).CopyFromVec(ivector_feats->Row(ivector_frame_subsampled));
+      Matrix<BaseFloat> ivector(1, chunk_ivectors_[c].Dim());
+      ivector.Row(0).CopyFromVec(chunk_ivectors_[c]);
       NnetIo ivector_io("ivector", 0, ivector);
       nnet_chain_eg.inputs[1].Swap(&ivector_io);
     }
 
-    if (compress)
+    if (compress_)
       nnet_chain_eg.Compress();
+  }
+  if (normalization_fst != NULL)
+    normalization_fsts_->Release(normalization_fst);
+}
 
+ChainExampleTask::~ChainExampleTask() {
+  for (size_t c = 0; c < egs_.size(); c++) {
     std::ostringstream os;
-    os << utt_id << "-" << chunk.first_frame;
+    os << utt_id_ << "-" << chunks_[c].first_frame;
 
     std::string key = os.str(); // key is <utt_id>-<frame_id>
 
-    example_writer->Write(key, nnet_chain_eg);
+    int32 index = (*num_written_)++ % example_writers_->size();
+    (*example_writers_)[index]->Write(key, egs_[c]);
   }
-  return true;
 }
 
 } // namespace nnet2
@@ -256,14 +377,19 @@ int main(int argc, char *argv[]) {
         "with nnet3-chain-normalize-egs\n"
         "\n"
         "Usage:  nnet3-chain-get-egs [options] [<normalization-fst>] <features-rspecifier> "
-        "<chain-supervision-rspecifier> <egs-wspecifier>\n"
+        "<chain-supervision-rspecifier> <egs-wspecifier1> [<egs-wspecifier2> ...]\n"
         "\n"
         "An example [where $feats expands to the actual features]:\n"
         "chain-get-supervision [args] | \\\n"
         "  nnet3-chain-get-egs --left-context=25 --right-context=9 --num-frames=150,100,90 dir/normalization.fst \\\n"
         "  \"$feats\" ark,s,cs:- ark:cegs.1.ark\n"
         "Note: the --frame-subsampling-factor option must be the same as given to\n"
-        "chain-get-supervision.\n";
+        "chain-get-supervision.\n"
+        "With more than one egs-wspecifier, the egs are written to them in turn\n"
+        "(round-robin).  With --num-threads, utterances are processed in\n"
+        "parallel; the egs are the same, and in the same order, as with one\n"
+        "thread.  --num-threads-total limits the number of utterances in\n"
+        "memory at once.\n";
 
     bool compress = true;
     int32 length_tolerance = 100, online_ivector_period = 1,
@@ -271,6 +397,7 @@ int main(int argc, char *argv[]) {
 
     ExampleGenerationConfig eg_config;  // controls num-frames,
                                         // left/right-context, etc.
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     BaseFloat normalization_fst_scale = 1.0;
     int32 srand_seed = 0;
@@ -313,12 +440,13 @@ int main(int argc, char *argv[]) {
                 "--convert-to-pdfs=false to chain-get-supervision.");
 
     eg_config.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
     srand(srand_seed);
 
-    if (po.NumArgs() < 3 || po.NumArgs() > 4) {
+    if (po.NumArgs() < 3) {
       po.PrintUsage();
       exit(1);
     }
@@ -326,20 +454,25 @@ int main(int argc, char *argv[]) {
     std::string
         normalization_fst_rxfilename,
         feature_rspecifier,
-        supervision_rspecifier,
-        examples_wspecifier;
+        supervision_rspecifier;
+    std::vector<std::string> examples_wspecifiers;
 
-    if (po.NumArgs() == 3) {
-      feature_rspecifier = po.GetArg(1);
-      supervision_rspecifier = po.GetArg(2);
-      examples_wspecifier = po.GetArg(3);
-    } else {
+    // The normalization FST, if given, is a filename, not an rspecifier; that
+    // tells us where the features are, since there may be several outputs.
+    int32 first_arg = 1;
+    if (ClassifyRspecifier(po.GetArg(1), NULL, NULL) == kNoRspecifier) {
       normalization_fst_rxfilename = po.GetArg(1);
       KALDI_ASSERT(!normalization_fst_rxfilename.empty());
-      feature_rspecifier = po.GetArg(2);
-      supervision_rspecifier = po.GetArg(3);
-      examples_wspecifier = po.GetArg(4);
+      first_arg = 2;
+      if (po.NumArgs() < 4) {
+        po.PrintUsage();
+        exit(1);
+      }
     }
+    feature_rspecifier = po.GetArg(first_arg);
+    supervision_rspecifier = po.GetArg(first_arg + 1);
+    for (int32 i = first_arg + 2; i <= po.NumArgs(); i++)
+      examples_wspecifiers.push_back(po.GetArg(i));
 
     eg_config.ComputeDerived();
     UtteranceSplitter utt_splitter(eg_config);
@@ -371,13 +504,21 @@ int main(int argc, char *argv[]) {
     SequentialGeneralMatrixReader feat_reader(feature_rspecifier);
     chain::RandomAccessSupervisionReader supervision_reader(
         supervision_rspecifier);
-    NnetChainExampleWriter example_writer(examples_wspecifier);
+    std::vector<NnetChainExampleWriter*> example_writers(
+        examples_wspecifiers.size());
+    for (size_t i = 0; i < examples_wspecifiers.size(); i++)
+      example_writers[i] = new NnetChainExampleWriter(examples_wspecifiers[i]);
+    int64 num_written = 0;
     RandomAccessBaseFloatMatrixReader online_ivector_reader(
         online_ivector_rspecifier);
     RandomAccessBaseFloatVectorReader deriv_weights_reader(
         deriv_weights_rspecifier);
+    NormalizationFstPool normalization_fsts(normalization_fst);
 
     int32 num_err = 0;
+    // the destructor waits for all the tasks, so it must come after the
+    // things the tasks use.
+    TaskSequencer<ChainExampleTask> sequencer(sequencer_config);
 
     for (; !feat_reader.Done(); feat_reader.Next()) {
       std::string key = feat_reader.Key();
@@ -423,14 +564,22 @@ int main(int argc, char *argv[]) {
           }
         }
 
-        if (!ProcessFile(trans_mdl_ptr, normalization_fst, feats,
-                         online_ivector_feats, online_ivector_period,
-                         supervision, deriv_weights, supervision_length_tolerance,
-                         key, compress,
-                         &utt_splitter, &example_writer))
+        ChainExampleTask *task = new ChainExampleTask(
+            trans_mdl_ptr,
+            (normalization_fst.NumStates() > 0 ? &normalization_fsts : NULL),
+            feats, online_ivector_feats, online_ivector_period,
+            supervision, deriv_weights, supervision_length_tolerance,
+            key, compress, &utt_splitter, &example_writers, &num_written);
+        if (task->Ok()) {
+          sequencer.Run(task);
+        } else {
+          delete task;
           num_err++;
+        }
       }
     }
+    sequencer.Wait();
+    DeletePointers(&example_writers);
     if (num_err > 0)
       KALDI_WARN << num_err << " utterances had errors and could "
           "not be processed.";
@@ -21,6 +21,7 @@
 #include "util/common-utils.h"
 #include "nnet3/nnet-chain-training.h"
 #include "cudamatrix/cu-allocator.h"
+#include "matrix/matrix-allocator.h"
 
 
 int main(int argc, char *argv[]) {
@@ -34,7 +35,8 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Train nnet3+chain neural network parameters with backprop and stochastic\n"
         "gradient descent.  Minibatches are to be created by nnet3-chain-merge-egs in\n"
-        "the input pipeline.  This training program is single-threaded (best to\n"
+        "the input pipeline, or by this program with --egs.merge (and shuffled\n"
+        "with --egs.buffer-size).  This training program is single-threaded (best to\n"
         "use it with a GPU).\n"
         "\n"
         "Usage:  nnet3-chain-train [options] <raw-nnet-in> <denominator-fst-in> <chain-training-examples-in> <raw-nnet-out>\n"
@@ -45,6 +47,8 @@ int main(int argc, char *argv[]) {
     bool binary_write = true;
     std::string use_gpu = "yes";
     NnetChainTrainingOptions opts;
+    ExampleLoaderOptions loader_opts;
+    ExampleMergingConfig merging_config;
 
     ParseOptions po(usage);
     po.Register("srand", &srand_seed, "Seed for random number generator ");
@@ -53,9 +57,19 @@ int main(int argc, char *argv[]) {
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
 
     opts.Register(&po);
+    // the loader's options are prefixed, e.g. --egs.buffer-size, so that
+    // --egs.minibatch-size and --egs.compress do not clash with anything.
+    ParseOptions egs_opts("egs", &po);
+    loader_opts.Register(&egs_opts);
+    merging_config.Register(&egs_opts);
     RegisterCuAllocatorOptions(&po);
+    RegisterCuGemmOptions(&po);
+    RegisterMatrixAllocatorOptions(&po);
+    RegisterIoOptions(&po);
 
     po.Read(argc, argv);
+    if (loader_opts.merge)
+      merging_config.ComputeDerived();
 
     srand(srand_seed);
 
@@ -84,10 +98,11 @@ int main(int argc, char *argv[]) {
 
       NnetChainTrainer trainer(opts, den_fst, &nnet);
 
-      SequentialNnetChainExampleReader example_reader(examples_rspecifier);
+      NnetChainExampleLoader example_loader(loader_opts, merging_config,
+                                            examples_rspecifier);
 
-      for (; !example_reader.Done(); example_reader.Next())
-        trainer.Train(example_reader.Value());
+      while (const NnetChainExample *eg = example_loader.Next())
+        trainer.Train(*eg);
 
       ok = trainer.PrintTotalStats();
     }
@@ -95,6 +110,7 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    PrintMatrixAllocatorStats();
     WriteKaldiObject(nnet, nnet_wxfilename, binary_write);
     KALDI_LOG << "Wrote raw model to " << nnet_wxfilename;
     return (ok ? 0 : 1);
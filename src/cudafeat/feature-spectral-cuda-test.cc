@@ -0,0 +1,122 @@
+// cudafeat/feature-spectral-cuda-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cudafeat/feature-spectral-cuda.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+static void RandomizeFrameOptions(FrameExtractionOptions *frame_opts) {
+  frame_opts->dither = 0.0;  // so that the output can be compared.
+  frame_opts->snip_edges = (RandInt(0, 1) == 0);
+  frame_opts->remove_dc_offset = (RandInt(0, 1) == 0);
+  frame_opts->round_to_power_of_two = (RandInt(0, 3) != 0);
+  frame_opts->preemph_coeff = (RandInt(0, 1) == 0 ? 0.97 : 0.0);
+  frame_opts->frame_length_ms = (RandInt(0, 1) == 0 ? 25.0 : 20.0);
+  const char *window_types[] = { "povey", "hamming", "hanning",
+                                 "rectangular", "blackman" };
+  frame_opts->window_type = window_types[RandInt(0, 4)];
+}
+
+static void RandomWave(Vector<BaseFloat> *wave) {
+  wave->Resize(RandInt(0, 1) == 0 ? RandInt(0, 1000) : RandInt(1000, 20000));
+  for (int32 i = 0; i < wave->Dim(); i++)
+    (*wave)(i) = RandInt(-10000, 10000);
+}
+
+static void UnitTestCudaMfcc() {
+  for (int32 i = 0; i < 10; i++) {
+    MfccOptions opts;
+    RandomizeFrameOptions(&opts.frame_opts);
+    opts.use_energy = (RandInt(0, 1) == 0);
+    opts.raw_energy = (RandInt(0, 1) == 0);
+    opts.energy_floor = (RandInt(0, 1) == 0 ? 0.0 : 1.0e+06);
+    opts.htk_compat = (RandInt(0, 1) == 0);
+    opts.mel_opts.htk_mode = (RandInt(0, 1) == 0);
+    opts.cepstral_lifter = (RandInt(0, 1) == 0 ? 22.0 : 0.0);
+    BaseFloat vtln_warp = (RandInt(0, 1) == 0 ? 1.0 : 0.9);
+
+    Vector<BaseFloat> wave;
+    RandomWave(&wave);
+    Mfcc mfcc(opts);
+    Matrix<BaseFloat> feats;
+    mfcc.ComputeFeatures(wave, opts.frame_opts.samp_freq, vtln_warp, &feats);
+
+    CudaSpectralFeatures cuda_mfcc(opts);
+    KALDI_ASSERT(cuda_mfcc.Dim() == mfcc.Dim());
+    Matrix<BaseFloat> cuda_feats;
+    cuda_mfcc.ComputeFeatures(wave, opts.frame_opts.samp_freq, vtln_warp,
+                              &cuda_feats);
+    KALDI_ASSERT(cuda_feats.NumRows() == feats.NumRows());
+    KALDI_ASSERT(feats.NumRows() == 0 || feats.ApproxEqual(cuda_feats, 0.001));
+  }
+}
+
+static void UnitTestCudaFbank() {
+  for (int32 i = 0; i < 10; i++) {
+    FbankOptions opts;
+    RandomizeFrameOptions(&opts.frame_opts);
+    opts.use_energy = (RandInt(0, 1) == 0);
+    opts.raw_energy = (RandInt(0, 1) == 0);
+    opts.energy_floor = (RandInt(0, 1) == 0 ? 0.0 : 1.0e+06);
+    opts.htk_compat = (RandInt(0, 1) == 0);
+    opts.use_power = (RandInt(0, 1) == 0);
+    opts.use_log_fbank = (RandInt(0, 3) != 0);
+    BaseFloat vtln_warp = (RandInt(0, 1) == 0 ? 1.0 : 1.1);
+
+    Vector<BaseFloat> wave;
+    RandomWave(&wave);
+    Fbank fbank(opts);
+    Matrix<BaseFloat> feats;
+    fbank.ComputeFeatures(wave, opts.frame_opts.samp_freq, vtln_warp, &feats);
+
+    CudaSpectralFeatures cuda_fbank(opts);
+    KALDI_ASSERT(cuda_fbank.Dim() == fbank.Dim());
+    Matrix<BaseFloat> cuda_feats;
+    cuda_fbank.ComputeFeatures(wave, opts.frame_opts.samp_freq, vtln_warp,
+                               &cuda_feats);
+    KALDI_ASSERT(cuda_feats.NumRows() == feats.NumRows());
+    KALDI_ASSERT(feats.NumRows() == 0 || feats.ApproxEqual(cuda_feats, 0.001));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  int32 loop = 0;
+#if HAVE_CUDA == 1
+  for (; loop < 2; loop++) {
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("yes");
+#endif
+    UnitTestCudaMfcc();
+    UnitTestCudaFbank();
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+#if HAVE_CUDA == 1
+  }
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  return 0;
+}
@@ -0,0 +1,304 @@
+// cudafeat/feature-spectral-cuda.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cudafeat/feature-spectral-cuda.h"
+
+#include <limits>
+#include <vector>
+
+#include "cudamatrix/cu-array.h"
+#include "feat/resample.h"
+#include "matrix/matrix-functions.h"
+
+namespace kaldi {
+
+CudaSpectralFeatures::CudaSpectralFeatures(const MfccOptions &opts):
+    is_mfcc_(true), mfcc_opts_(opts), frame_opts_(opts.frame_opts),
+    mel_opts_(opts.mel_opts), use_energy_(opts.use_energy),
+    raw_energy_(opts.raw_energy), log_energy_floor_(0.0),
+    energy_floor_(opts.energy_floor), htk_compat_(opts.htk_compat) {
+  int32 num_bins = opts.mel_opts.num_bins;
+  if (opts.num_ceps > num_bins)
+    KALDI_ERR << "num-ceps cannot be larger than num-mel-bins."
+              << " It should be smaller or equal. You provided num-ceps: "
+              << opts.num_ceps << "  and num-mel-bins: "
+              << num_bins;
+  Matrix<BaseFloat> dct_matrix(num_bins, num_bins);
+  ComputeDctMatrix(&dct_matrix);
+  // as in MfccComputer, the zeroth dct is included in either case.
+  dct_matrix_ = SubMatrix<BaseFloat>(dct_matrix, 0, opts.num_ceps,
+                                     0, num_bins);
+  if (opts.cepstral_lifter != 0.0) {
+    Vector<BaseFloat> lifter_coeffs(opts.num_ceps);
+    ComputeLifterCoeffs(opts.cepstral_lifter, &lifter_coeffs);
+    lifter_coeffs_ = lifter_coeffs;
+  }
+  Init();
+}
+
+CudaSpectralFeatures::CudaSpectralFeatures(const FbankOptions &opts):
+    is_mfcc_(false), fbank_opts_(opts), frame_opts_(opts.frame_opts),
+    mel_opts_(opts.mel_opts), use_energy_(opts.use_energy),
+    raw_energy_(opts.raw_energy), log_energy_floor_(0.0),
+    energy_floor_(opts.energy_floor), htk_compat_(opts.htk_compat) {
+  Init();
+}
+
+void CudaSpectralFeatures::Init() {
+  if (energy_floor_ > 0.0)
+    log_energy_floor_ = Log(energy_floor_);
+
+  FeatureWindowFunction window_function(frame_opts_);
+  window_ = window_function.window;
+
+  int32 frame_length = frame_opts_.WindowSize(),
+      padded_window_size = frame_opts_.PaddedWindowSize(),
+      num_fft_bins = padded_window_size / 2;
+  Matrix<BaseFloat> dft(frame_length, 2 * num_fft_bins);
+  for (int32 n = 0; n < frame_length; n++) {
+    for (int32 k = 0; k < num_fft_bins; k++) {
+      // n * k is reduced first so that the angle is accurate.
+      double angle = M_2PI * ((static_cast<int64>(n) * k) % padded_window_size)
+          / padded_window_size;
+      dft(n, k) = cos(angle);
+      dft(n, num_fft_bins + k) = -sin(angle);
+    }
+  }
+  dft_.Swap(&dft);
+
+  // We'll definitely need the filterbanks info for VTLN warping factor 1.0.
+  // [note: this call caches it.]
+  GetMelBanks(1.0);
+}
+
+CudaSpectralFeatures::~CudaSpectralFeatures() {
+  for (std::map<BaseFloat, CuMatrix<BaseFloat>*>::iterator iter =
+           mel_banks_.begin(); iter != mel_banks_.end(); ++iter)
+    delete iter->second;
+}
+
+int32 CudaSpectralFeatures::Dim() const {
+  if (is_mfcc_)
+    return mfcc_opts_.num_ceps;
+  else
+    return mel_opts_.num_bins + (use_energy_ ? 1 : 0);
+}
+
+const CuMatrix<BaseFloat> &CudaSpectralFeatures::GetMelBanks(
+    BaseFloat vtln_warp) {
+  std::map<BaseFloat, CuMatrix<BaseFloat>*>::iterator iter =
+      mel_banks_.find(vtln_warp);
+  if (iter != mel_banks_.end())
+    return *(iter->second);
+  MelBanks mel_banks(mel_opts_, frame_opts_, vtln_warp);
+  CuMatrix<BaseFloat> *this_mel_banks =
+      new CuMatrix<BaseFloat>(mel_banks.GetBinWeights());
+  mel_banks_[vtln_warp] = this_mel_banks;
+  return *this_mel_banks;
+}
+
+void CudaSpectralFeatures::ExtractWindows(const VectorBase<BaseFloat> &wave,
+                                          CuMatrix<BaseFloat> *frames) const {
+  int32 num_frames = NumFrames(wave.Dim(), frame_opts_),
+      frame_length = frame_opts_.WindowSize(),
+      wave_dim = wave.Dim();
+  if (num_frames == 0) {
+    frames->Resize(0, 0);
+    return;
+  }
+  frames->Resize(num_frames, frame_length, kUndefined);
+
+  CuVector<BaseFloat> cu_wave(wave);
+  // The frames that go over the ends of the wave (only if snip_edges ==
+  // false) are reflected at the ends as ExtractWindow() does, on the CPU.
+  std::vector<int32> edge_frames;
+  for (int32 f = 0; f < num_frames; f++) {
+    int64 start_sample = FirstSampleOfFrame(f, frame_opts_);
+    if (start_sample < 0 || start_sample + frame_length > wave_dim)
+      edge_frames.push_back(f);
+  }
+  Matrix<BaseFloat> edges;
+  if (!edge_frames.empty())
+    edges.Resize(edge_frames.size(), frame_length, kUndefined);
+  for (size_t i = 0; i < edge_frames.size(); i++) {
+    int64 start_sample = FirstSampleOfFrame(edge_frames[i], frame_opts_);
+    for (int32 s = 0; s < frame_length; s++) {
+      int64 s_in_wave = s + start_sample;
+      while (s_in_wave < 0 || s_in_wave >= wave_dim) {
+        if (s_in_wave < 0) s_in_wave = - s_in_wave - 1;
+        else s_in_wave = 2 * wave_dim - 1 - s_in_wave;
+      }
+      edges(i, s) = wave(s_in_wave);
+    }
+  }
+  CuMatrix<BaseFloat> cu_edges(edges);
+
+  // the frames are gathered from the wave in one go, as rows that start at
+  // the first sample of each frame.
+  std::vector<const BaseFloat*> frame_starts(num_frames);
+  size_t e = 0;
+  for (int32 f = 0; f < num_frames; f++) {
+    if (e < edge_frames.size() && edge_frames[e] == f)
+      frame_starts[f] = cu_edges.RowData(e++);
+    else
+      frame_starts[f] = cu_wave.Data() + FirstSampleOfFrame(f, frame_opts_);
+  }
+  CuArray<const BaseFloat*> cu_frame_starts(frame_starts);
+  frames->CopyRows(cu_frame_starts);
+}
+
+void CudaSpectralFeatures::ProcessWindows(
+    CuMatrixBase<BaseFloat> *frames,
+    CuVectorBase<BaseFloat> *log_energies) {
+  int32 num_frames = frames->NumRows(),
+      frame_length = frames->NumCols();
+
+  if (frame_opts_.dither != 0.0) {
+    CuMatrix<BaseFloat> noise(num_frames, frame_length, kUndefined);
+    rand_.RandGaussian(&noise);
+    frames->AddMat(frame_opts_.dither, noise);
+  }
+
+  if (frame_opts_.remove_dc_offset) {
+    CuVector<BaseFloat> sums(num_frames, kUndefined);
+    sums.AddColSumMat(1.0, *frames, 0.0);
+    frames->AddVecToCols(-1.0 / frame_length, sums);
+  }
+
+  if (raw_energy_) {
+    log_energies->AddDiagMat2(1.0, *frames, kNoTrans, 0.0);
+    log_energies->ApplyFloor(std::numeric_limits<float>::epsilon());
+    log_energies->ApplyLog();
+  }
+
+  BaseFloat preemph_coeff = frame_opts_.preemph_coeff;
+  if (preemph_coeff != 0.0) {
+    KALDI_ASSERT(preemph_coeff >= 0.0 && preemph_coeff <= 1.0);
+    CuMatrix<BaseFloat> frames_copy(*frames);
+    frames->ColRange(1, frame_length - 1).AddMat(
+        -preemph_coeff, frames_copy.ColRange(0, frame_length - 1));
+    frames->ColRange(0, 1).AddMat(-preemph_coeff, frames_copy.ColRange(0, 1));
+  }
+
+  frames->MulColsVec(window_);
+
+  // Compute energy after window function (not the raw one).
+  if (!raw_energy_) {
+    log_energies->AddDiagMat2(1.0, *frames, kNoTrans, 0.0);
+    log_energies->ApplyFloor(std::numeric_limits<float>::min());
+    log_energies->ApplyLog();
+  }
+}
+
+void CudaSpectralFeatures::ComputeFeatures(const VectorBase<BaseFloat> &wave,
+                                           BaseFloat sample_freq,
+                                           BaseFloat vtln_warp,
+                                           CuMatrix<BaseFloat> *output) {
+  Vector<BaseFloat> downsampled_wave;
+  const VectorBase<BaseFloat> *this_wave = &wave;
+  BaseFloat new_sample_freq = frame_opts_.samp_freq;
+  if (sample_freq != new_sample_freq) {
+    if (new_sample_freq > sample_freq)
+      KALDI_ERR << "New sample Frequency " << new_sample_freq
+                << " is larger than waveform original sampling frequency "
+                << sample_freq;
+    if (!frame_opts_.allow_downsample)
+      KALDI_ERR << "Waveform and config sample Frequency mismatch: "
+                << sample_freq << " .vs " << new_sample_freq
+                << " ( use --allow_downsample=true option to allow "
+                << " downsampling the waveform).";
+    DownsampleWaveForm(sample_freq, wave, new_sample_freq, &downsampled_wave);
+    this_wave = &downsampled_wave;
+  }
+
+  CuMatrix<BaseFloat> frames;
+  ExtractWindows(*this_wave, &frames);
+  int32 num_frames = frames.NumRows(),
+      num_bins = mel_opts_.num_bins;
+  if (num_frames == 0) {
+    output->Resize(0, 0);
+    return;
+  }
+  output->Resize(num_frames, Dim());
+
+  CuVector<BaseFloat> log_energies(num_frames, kUndefined);
+  ProcessWindows(&frames, &log_energies);
+  if (use_energy_ && energy_floor_ > 0.0)
+    log_energies.ApplyFloor(log_energy_floor_);
+
+  // The power spectrum: the squares of the real parts of the DFT, plus those
+  // of the imaginary parts.
+  int32 num_fft_bins = dft_.NumCols() / 2;
+  CuMatrix<BaseFloat> spectra(num_frames, 2 * num_fft_bins, kUndefined);
+  spectra.AddMatMat(1.0, frames, kNoTrans, dft_, kNoTrans, 0.0);
+  frames.Resize(0, 0);
+  spectra.ApplyPow(2.0);
+  CuSubMatrix<BaseFloat> power_spectra(spectra.ColRange(0, num_fft_bins));
+  power_spectra.AddMat(1.0, spectra.ColRange(num_fft_bins, num_fft_bins));
+  // Use magnitude instead of power if requested.
+  if (!is_mfcc_ && !fbank_opts_.use_power)
+    power_spectra.ApplyPow(0.5);
+
+  CuMatrix<BaseFloat> mel_energies(num_frames, num_bins, kUndefined);
+  mel_energies.AddMatMat(1.0, power_spectra, kNoTrans, GetMelBanks(vtln_warp),
+                         kTrans, 0.0);
+  if (mel_opts_.htk_mode)
+    mel_energies.ApplyFloor(1.0);
+  if (is_mfcc_ || fbank_opts_.use_log_fbank) {
+    // avoid log of zero (which should be prevented anyway by dithering).
+    mel_energies.ApplyFloor(std::numeric_limits<float>::epsilon());
+    mel_energies.ApplyLog();
+  }
+
+  if (!is_mfcc_) {
+    int32 mel_offset = ((use_energy_ && !htk_compat_) ? 1 : 0);
+    output->ColRange(mel_offset, num_bins).CopyFromMat(mel_energies);
+    if (use_energy_)
+      output->CopyColFromVec(log_energies, htk_compat_ ? num_bins : 0);
+    return;
+  }
+
+  int32 num_ceps = mfcc_opts_.num_ceps;
+  output->AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
+  if (mfcc_opts_.cepstral_lifter != 0.0)
+    output->MulColsVec(lifter_coeffs_);
+  if (use_energy_)
+    output->CopyColFromVec(log_energies, 0);
+  if (htk_compat_) {
+    // put energy or C0 last, with a scale as in MfccComputer::Compute().
+    CuMatrix<BaseFloat> features(*output);
+    output->ColRange(0, num_ceps - 1).CopyFromMat(
+        features.ColRange(1, num_ceps - 1));
+    output->ColRange(num_ceps - 1, 1).CopyFromMat(features.ColRange(0, 1));
+    if (!use_energy_)
+      output->ColRange(num_ceps - 1, 1).Scale(M_SQRT2);
+  }
+}
+
+void CudaSpectralFeatures::ComputeFeatures(const VectorBase<BaseFloat> &wave,
+                                           BaseFloat sample_freq,
+                                           BaseFloat vtln_warp,
+                                           Matrix<BaseFloat> *output) {
+  CuMatrix<BaseFloat> cu_output;
+  ComputeFeatures(wave, sample_freq, vtln_warp, &cu_output);
+  output->Resize(cu_output.NumRows(), cu_output.NumCols(), kUndefined);
+  cu_output.CopyToMat(output);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,123 @@
+// cudafeat/feature-spectral-cuda.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAFEAT_FEATURE_SPECTRAL_CUDA_H_
+#define KALDI_CUDAFEAT_FEATURE_SPECTRAL_CUDA_H_
+
+#include <map>
+
+#include "base/kaldi-common.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-rand.h"
+#include "cudamatrix/cu-vector.h"
+#include "feat/feature-fbank.h"
+#include "feat/feature-mfcc.h"
+
+namespace kaldi {
+
+/**
+   CudaSpectralFeatures computes MFCC or filterbank features as Mfcc and Fbank
+   do (see feature-mfcc.h and feature-fbank.h, whose options it takes), but
+   with cudamatrix operations over all the frames of the utterance at once, so
+   that they are computed on the GPU if one was selected (and in cudamatrix's
+   CPU code if not).  The waveform is copied to the device once, and the
+   frames are gathered from it there.
+
+   The power spectra are computed with a matrix multiplication by the real
+   and imaginary parts of the DFT, as cudamatrix has no FFT; this is fast on a
+   GPU, but much slower than Mfcc on the CPU.  The output is the same as that
+   of Mfcc or Fbank up to rounding, except that with dithering the random
+   numbers differ.
+*/
+class CudaSpectralFeatures {
+ public:
+  explicit CudaSpectralFeatures(const MfccOptions &opts);
+  explicit CudaSpectralFeatures(const FbankOptions &opts);
+
+  ~CudaSpectralFeatures();
+
+  int32 Dim() const;
+
+  /// Computes the features of the waveform "wave", which is downsampled first
+  /// if sample_freq is higher than the sampling frequency of the options and
+  /// downsampling is allowed, as OfflineFeatureTpl::ComputeFeatures() does.
+  /// The features are left on the device, e.g. for nnet3 computation.
+  void ComputeFeatures(const VectorBase<BaseFloat> &wave,
+                       BaseFloat sample_freq,
+                       BaseFloat vtln_warp,
+                       CuMatrix<BaseFloat> *output);
+
+  /// As the other version of ComputeFeatures(), but outputs the features to
+  /// a CPU-based matrix.
+  void ComputeFeatures(const VectorBase<BaseFloat> &wave,
+                       BaseFloat sample_freq,
+                       BaseFloat vtln_warp,
+                       Matrix<BaseFloat> *output);
+
+ private:
+  void Init();
+
+  // Outputs the frames of "wave" to the rows of "frames", of dimension
+  // num-frames by the window size (not the padded one).
+  void ExtractWindows(const VectorBase<BaseFloat> &wave,
+                      CuMatrix<BaseFloat> *frames) const;
+
+  // Does what ProcessWindow() does, for all the frames: dithering, removal of
+  // the DC offset, pre-emphasis and the window function.  The log-energies of
+  // the frames are output to "log_energies" (as given by raw_energy).
+  void ProcessWindows(CuMatrixBase<BaseFloat> *frames,
+                      CuVectorBase<BaseFloat> *log_energies);
+
+  const CuMatrix<BaseFloat> &GetMelBanks(BaseFloat vtln_warp);
+
+  bool is_mfcc_;
+  MfccOptions mfcc_opts_;
+  FbankOptions fbank_opts_;
+  // the options of whichever of mfcc_opts_ and fbank_opts_ are used.
+  FrameExtractionOptions frame_opts_;
+  MelBanksOptions mel_opts_;
+  bool use_energy_;
+  bool raw_energy_;
+  BaseFloat log_energy_floor_;  // only used if energy_floor > 0.
+  BaseFloat energy_floor_;
+  bool htk_compat_;
+
+  // the window function, of dimension the window size.
+  CuVector<BaseFloat> window_;
+  // the real (cosine) then the imaginary (minus sine) parts of the DFT of the
+  // padded window, for the first half of its bins (the ones the mel banks
+  // use); of dimension window size by twice the number of those bins.  (There
+  // is no need for the rows of the padding, which is zero.)
+  CuMatrix<BaseFloat> dft_;
+  // MFCC only: the DCT matrix, num-ceps by num-bins, and the lifter.
+  CuMatrix<BaseFloat> dct_matrix_;
+  CuVector<BaseFloat> lifter_coeffs_;
+
+  // the mel banks as a matrix of dimension num-bins by half the padded window
+  // size (from MelBanks::GetBinWeights()), per VTLN warp factor.
+  std::map<BaseFloat, CuMatrix<BaseFloat>*> mel_banks_;
+
+  CuRand<BaseFloat> rand_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CudaSpectralFeatures);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAFEAT_FEATURE_SPECTRAL_CUDA_H_
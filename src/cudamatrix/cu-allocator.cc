@@ -44,11 +44,26 @@
 namespace kaldi {
 
 
+// True if the options ask for cudaMallocAsync() and this CUDA has it.
+static inline bool UseMallocAsync(const CuAllocatorOptions &opts) {
+#if CUDART_VERSION >= 11020
+  return opts.malloc_async;
+#else
+  return false;
+#endif
+}
+
 void* CuMemoryAllocator::Malloc(size_t size) {
   Timer tim;
+  num_mallocs_++;
   if (!opts_.cache_memory) {
     void *ans;
-    CU_SAFE_CALL(cudaMalloc(&ans, size));
+#if CUDART_VERSION >= 11020
+    if (UseMallocAsync(opts_))
+      CU_SAFE_CALL(cudaMallocAsync(&ans, size, cudaStreamPerThread));
+    else
+#endif
+      CU_SAFE_CALL(cudaMalloc(&ans, size));
     double elapsed = tim.Elapsed();
     tot_time_taken_ += elapsed;
     malloc_time_taken_ += elapsed;
@@ -326,6 +341,13 @@ std::string GetFreeGpuMemory(int64* free, int64* total) {
 }
 
 void CuMemoryAllocator::PrintMemoryUsage() const {
+  if (num_locks_ > 0 || num_thread_cache_hits_ > 0) {
+    KALDI_LOG << "Multi-threaded allocation: locked the allocator "
+              << num_locks_ << " times, " << num_contended_locks_
+              << " of them contended, waiting " << lock_wait_time_
+              << " seconds in total; " << num_thread_cache_hits_
+              << " allocations served from the per-thread caches.";
+  }
   if (!opts_.cache_memory) {
     KALDI_LOG << "Not caching allocations; time taken in "
               << "malloc/free is " << malloc_time_taken_
@@ -390,7 +412,12 @@ CuMemoryAllocator::CuMemoryAllocator():
     tot_time_taken_(0.0),
     malloc_time_taken_(0.0),
     max_allocated_memory_(0),
-    allocated_memory_(0) {
+    allocated_memory_(0),
+    num_mallocs_(0),
+    num_locks_(0),
+    num_contended_locks_(0),
+    lock_wait_time_(0.0),
+    num_thread_cache_hits_(0) {
   // Note: we don't allocate any memory regions at the start; we wait for the user
   // to call Malloc() or MallocPitch(), and then allocate one when needed.
 }
@@ -400,9 +427,18 @@ void* CuMemoryAllocator::MallocPitch(size_t row_bytes,
                                      size_t num_rows,
                                      size_t *pitch) {
   Timer tim;
+  num_mallocs_++;
   if (!opts_.cache_memory) {
     void *ans;
-    CU_SAFE_CALL(cudaMallocPitch(&ans, pitch, row_bytes, num_rows));
+#if CUDART_VERSION >= 11020
+    if (UseMallocAsync(opts_)) {
+      // there is no stream-ordered cudaMallocPitch().
+      *pitch = (row_bytes + 255) & ~((size_t)255);
+      CU_SAFE_CALL(cudaMallocAsync(&ans, *pitch * num_rows,
+                                   cudaStreamPerThread));
+    } else
+#endif
+      CU_SAFE_CALL(cudaMallocPitch(&ans, pitch, row_bytes, num_rows));
     double elapsed = tim.Elapsed();
     tot_time_taken_ += elapsed;
     malloc_time_taken_ += elapsed;
@@ -420,7 +456,12 @@ void* CuMemoryAllocator::MallocPitch(size_t row_bytes,
 void CuMemoryAllocator::Free(void *ptr) {
   Timer tim;
   if (!opts_.cache_memory) {
-    CU_SAFE_CALL(cudaFree(ptr));
+#if CUDART_VERSION >= 11020
+    if (UseMallocAsync(opts_))
+      CU_SAFE_CALL(cudaFreeAsync(ptr, cudaStreamPerThread));
+    else
+#endif
+      CU_SAFE_CALL(cudaFree(ptr));
     tot_time_taken_ += tim.Elapsed();
     t_++;
     return;
@@ -490,6 +531,142 @@ void CuMemoryAllocator::Free(void *ptr) {
   tot_time_taken_ += tim.Elapsed();
 }
 
+// Set when the calling thread's cache is destroyed as the thread exits; other
+// thread-local objects may still free memory after that.
+static thread_local bool thread_cache_destroyed = false;
+
+struct CuMemoryAllocator::ThreadCache {
+  ThreadCache(): bytes(0) { }
+  // Returns the blocks to the pool when the thread exits.
+  ~ThreadCache() {
+    g_cuda_allocator.FlushThreadCache(this);
+    thread_cache_destroyed = true;
+  }
+
+  // The cached blocks, indexed by their size.
+  std::unordered_map<size_t, std::vector<void*> > blocks;
+  // The total size of the cached blocks.
+  size_t bytes;
+};
+
+CuMemoryAllocator::ThreadCache *CuMemoryAllocator::GetThreadCache() {
+  if (thread_cache_destroyed)
+    return NULL;
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+bool CuMemoryAllocator::IsThreadCached(size_t size) const {
+  return opts_.cache_memory && size != 0 &&
+      size <= (static_cast<size_t>(opts_.thread_cache_mb) << 20) / 8;
+}
+
+std::unique_lock<std::mutex> CuMemoryAllocator::LockPool() {
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    Timer tim;
+    lock.lock();
+    num_contended_locks_++;
+    lock_wait_time_ += tim.Elapsed();
+  }
+  num_locks_++;
+  return lock;
+}
+
+void* CuMemoryAllocator::MallocLocking(size_t size) {
+  size_t rounded_size = (size + 255) & ~((size_t)255);
+  if (IsThreadCached(rounded_size))
+    return MallocThreadCached(rounded_size);
+  std::unique_lock<std::mutex> lock(LockPool());
+  return Malloc(size);
+}
+
+void* CuMemoryAllocator::MallocPitchLocking(size_t row_bytes,
+                                            size_t num_rows,
+                                            size_t *pitch) {
+  // the same rounding as in MallocPitch().
+  size_t rounded_row_bytes = (row_bytes + 255) & ~((size_t)255);
+  if (IsThreadCached(rounded_row_bytes * num_rows)) {
+    *pitch = rounded_row_bytes;
+    return MallocThreadCached(rounded_row_bytes * num_rows);
+  }
+  std::unique_lock<std::mutex> lock(LockPool());
+  return MallocPitch(row_bytes, num_rows, pitch);
+}
+
+void* CuMemoryAllocator::MallocThreadCached(size_t size) {
+  ThreadCache *cache = GetThreadCache();
+  if (cache == NULL) {
+    std::unique_lock<std::mutex> lock(LockPool());
+    return Malloc(size);
+  }
+  unordered_map<size_t, std::vector<void*> >::iterator iter =
+      cache->blocks.find(size);
+  if (iter != cache->blocks.end() && !iter->second.empty()) {
+    void *ans = iter->second.back();
+    iter->second.pop_back();
+    cache->bytes -= size;
+    num_thread_cache_hits_++;
+    return ans;
+  }
+  void *ans;
+  {
+    std::unique_lock<std::mutex> lock(LockPool());
+    ans = Malloc(size);
+  }
+  SizeShard &shard = GetSizeShard(ans);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  shard.sizes[ans] = size;
+  return ans;
+}
+
+void CuMemoryAllocator::FreeLocking(void *ptr) {
+  if (opts_.cache_memory && opts_.thread_cache_mb > 0) {
+    size_t size = 0;
+    {
+      SizeShard &shard = GetSizeShard(ptr);
+      std::unique_lock<std::mutex> lock(shard.mutex);
+      unordered_map<void*, size_t>::iterator iter = shard.sizes.find(ptr);
+      if (iter != shard.sizes.end()) {
+        size = iter->second;
+        // a thread that is exiting frees straight to the pool.
+        if (thread_cache_destroyed)
+          shard.sizes.erase(iter);
+      }
+    }
+    ThreadCache *cache = (size != 0 ? GetThreadCache() : NULL);
+    if (cache != NULL) {
+      if (cache->bytes + size >
+          (static_cast<size_t>(opts_.thread_cache_mb) << 20))
+        FlushThreadCache(cache);
+      cache->blocks[size].push_back(ptr);
+      cache->bytes += size;
+      return;
+    }
+  }
+  std::unique_lock<std::mutex> lock(LockPool());
+  Free(ptr);
+}
+
+void CuMemoryAllocator::FlushThreadCache(ThreadCache *cache) {
+  if (cache->bytes == 0)
+    return;
+  unordered_map<size_t, std::vector<void*> >::iterator iter;
+  for (iter = cache->blocks.begin(); iter != cache->blocks.end(); ++iter) {
+    for (size_t i = 0; i < iter->second.size(); i++) {
+      SizeShard &shard = GetSizeShard(iter->second[i]);
+      std::unique_lock<std::mutex> lock(shard.mutex);
+      shard.sizes.erase(iter->second[i]);
+    }
+  }
+  std::unique_lock<std::mutex> lock(LockPool());
+  for (iter = cache->blocks.begin(); iter != cache->blocks.end(); ++iter)
+    for (size_t i = 0; i < iter->second.size(); i++)
+      Free(iter->second[i]);
+  cache->blocks.clear();
+  cache->bytes = 0;
+}
+
 void CuMemoryAllocator::AllocateNewRegion(size_t size) {
   int64 free_memory, total_memory;
   std::string mem_info = GetFreeGpuMemory(&free_memory, &total_memory);
@@ -627,6 +804,99 @@ CuMemoryAllocator::~CuMemoryAllocator() {
 CuMemoryAllocator g_cuda_allocator;
 
 
+void *CuPinnedAllocator::Malloc(size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ReclaimCompleted();
+  // take the smallest cached block that is big enough, unless it would waste
+  // more than half of it.
+  std::multimap<size_t, void*>::iterator iter = free_blocks_.lower_bound(size);
+  if (iter != free_blocks_.end() && iter->first <= 2 * size) {
+    void *ans = iter->second;
+    cached_bytes_ -= iter->first;
+    free_blocks_.erase(iter);
+    return ans;
+  }
+  void *ans;
+  cudaError_t e = cudaMallocHost(&ans, size);
+  if (e != cudaSuccess && !free_blocks_.empty()) {
+    // free the cache and try again.
+    cudaGetLastError();
+    for (iter = free_blocks_.begin(); iter != free_blocks_.end(); ++iter) {
+      sizes_.erase(iter->second);
+      CU_SAFE_CALL(cudaFreeHost(iter->second));
+    }
+    free_blocks_.clear();
+    cached_bytes_ = 0;
+    e = cudaMallocHost(&ans, size);
+  }
+  if (e != cudaSuccess)
+    KALDI_ERR << "cudaMallocHost failed to allocate " << size << " bytes: "
+              << cudaGetErrorString(e);
+  sizes_[ans] = size;
+  return ans;
+}
+
+void CuPinnedAllocator::FreeInternal(void *ptr) {
+  std::map<void*, size_t>::iterator iter = sizes_.find(ptr);
+  KALDI_ASSERT(iter != sizes_.end() && "Freeing memory not from Malloc()");
+  size_t size = iter->second;
+  if (cached_bytes_ + size <= max_cached_bytes_) {
+    free_blocks_.insert(std::pair<const size_t, void*>(size, ptr));
+    cached_bytes_ += size;
+  } else {
+    sizes_.erase(iter);
+    CU_SAFE_CALL(cudaFreeHost(ptr));
+  }
+}
+
+void CuPinnedAllocator::Free(void *ptr) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FreeInternal(ptr);
+}
+
+void CuPinnedAllocator::FreeAfterStream(void *ptr) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PendingBlock block;
+  block.ptr = ptr;
+  if (free_events_.empty()) {
+    CU_SAFE_CALL(cudaEventCreateWithFlags(&block.event,
+                                          cudaEventDisableTiming));
+  } else {
+    block.event = free_events_.back();
+    free_events_.pop_back();
+  }
+  CU_SAFE_CALL(cudaEventRecord(block.event, cudaStreamPerThread));
+  pending_.push_back(block);
+}
+
+void CuPinnedAllocator::ReclaimCompleted() {
+  // the blocks may be on the streams of different threads, so we look at all
+  // of them.
+  std::list<PendingBlock>::iterator iter = pending_.begin();
+  while (iter != pending_.end()) {
+    cudaError_t e = cudaEventQuery(iter->event);
+    if (e == cudaErrorNotReady) {
+      ++iter;
+      continue;
+    }
+    CU_SAFE_CALL(e);
+    FreeInternal(iter->ptr);
+    free_events_.push_back(iter->event);
+    iter = pending_.erase(iter);
+  }
+}
+
+CuPinnedAllocator::~CuPinnedAllocator() {
+  // No need to check the return status here-- the program is exiting anyway.
+  for (std::map<void*, size_t>::iterator iter = sizes_.begin();
+       iter != sizes_.end(); ++iter)
+    cudaFreeHost(iter->first);
+}
+
+
+CuPinnedAllocator g_cuda_pinned_allocator;
+
+
 }  // namespace kaldi
 
 
@@ -28,6 +28,7 @@
 #include <cuda_runtime_api.h>
 #endif
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <mutex>
@@ -64,8 +65,25 @@ struct CuAllocatorOptions {
   // memory low addresses.
   int32 num_subregions;
 
+  // The size in megabytes of the cache of recently freed blocks each CPU
+  // thread keeps, in multi-threaded programs (if CuDevice::AllowMultithreading()
+  // was called); blocks up to an eighth of this size are cached.  0 disables
+  // the per-thread caches, so every allocation locks the allocator.
+  int32 thread_cache_mb;
+
+  // If true and cache_memory is false, allocate with the stream-ordered
+  // cudaMallocAsync() and cudaFreeAsync() (CUDA 11.2 or later) rather than
+  // cudaMalloc() and cudaFree(), which synchronize the device.
+  bool malloc_async;
+
+  // The maximum size in megabytes of the freed blocks of pinned host memory
+  // (used for asynchronous copies, see CuPinnedAllocator) that are kept for
+  // reuse.
+  int32 pinned_cache_mb;
+
   CuAllocatorOptions():
-      cache_memory(true), memory_proportion(0.5), num_subregions(20) { }
+      cache_memory(true), memory_proportion(0.5), num_subregions(20),
+      thread_cache_mb(16), malloc_async(false), pinned_cache_mb(256) { }
 
   void Register(OptionsItf *po) {
     po->Register("cuda-cache-memory", &cache_memory, "True if you want "
@@ -74,11 +92,21 @@ struct CuAllocatorOptions {
     po->Register("cuda-memory-proportion", &memory_proportion,
                  "Proportion of the GPU device memory that the allocator "
                  "should allocate at the start");
+    po->Register("cuda-thread-cache-mb", &thread_cache_mb, "Size in MB of "
+                 "the cache of freed GPU memory blocks kept by each CPU thread "
+                 "in multi-threaded programs; 0 to disable.");
+    po->Register("cuda-malloc-async", &malloc_async, "If true and "
+                 "--cuda-cache-memory=false, use CUDA's stream-ordered "
+                 "allocator (cudaMallocAsync, CUDA 11.2 or later).");
+    po->Register("cuda-pinned-cache-mb", &pinned_cache_mb, "Size in MB of "
+                 "the cache of freed pinned host memory used for asynchronous "
+                 "copies to and from the GPU.");
   }
 
   void Check() {
     // don't let it get too close to 1;
     KALDI_ASSERT(memory_proportion >= 0.05 && memory_proportion < 0.99);
+    KALDI_ASSERT(thread_cache_mb >= 0 && pinned_cache_mb >= 0);
   }
 };
 
@@ -148,6 +176,18 @@ namespace kaldi {
    that size.  (Note: we can allocate blocks that span sub-regions, so this
    approach does not limit the block size we can allocate).
 
+   NOTE ON CONTENTION: in multi-threaded programs the '*Locking' functions
+   would all serialize on one mutex.  To avoid that, each CPU thread keeps a
+   small cache of the blocks it has freed, by size (see
+   CuAllocatorOptions::thread_cache_mb), and an allocation of a size that the
+   thread has recently freed is served from there without taking the mutex.
+   The cached blocks stay allocated as far as the shared pool is concerned,
+   and as a block is only reused by the thread that freed it, no
+   synchronization is needed.  The sizes of the blocks that may be cached are
+   kept in a map split into shards by address, each with its own mutex, so
+   that FreeLocking() can find them.  A thread's cache is returned to the pool
+   when it is full and when the thread exits.  PrintMemoryUsage() reports how
+   often the mutex was taken and how often a thread had to wait for it.
 */
 
 class CuMemoryAllocator {
@@ -162,21 +202,14 @@ class CuMemoryAllocator {
   /// Free device memory allocated by Malloc() or MallocPitch().
   void Free(void *ptr);
 
-  /// Mutex-guarded version of Malloc(), for use in multi-threaded programs.
-  inline void* MallocLocking(size_t size) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    return Malloc(size);
-  }
-  /// Mutex-guarded version of Malloc(), for use in multi-threaded programs.
-  inline void* MallocPitchLocking(size_t row_bytes, size_t num_rows, size_t *pitch) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    return MallocPitch(row_bytes, num_rows, pitch);
-  }
-  /// Mutex-guarded version of Free(), for use in multi-threaded programs.
-  void FreeLocking(void *ptr) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    Free(ptr);
-  }
+  /// Thread-safe version of Malloc(), for use in multi-threaded programs.
+  /// It uses this thread's cache of freed blocks or, failing that, locks
+  /// the class.
+  void* MallocLocking(size_t size);
+  /// Thread-safe version of MallocPitch(), for use in multi-threaded programs.
+  void* MallocPitchLocking(size_t row_bytes, size_t num_rows, size_t *pitch);
+  /// Thread-safe version of Free(), for use in multi-threaded programs.
+  void FreeLocking(void *ptr);
 
   void PrintMemoryUsage() const;
 
@@ -186,6 +219,12 @@ class CuMemoryAllocator {
   //  returns the maximum memory used within the cache during current execution
   size_t GetMaxAllocatedMemory() { return max_allocated_memory_; }
 
+  // returns the number of allocations done so far (e.g. to check that some
+  // code does not allocate).
+  size_t GetNumMallocs() const {
+    return num_mallocs_ + num_thread_cache_hits_;
+  }
+
   CuMemoryAllocator();
 
   // Allows you to set options: must be called before any Malloc function is
@@ -312,6 +351,40 @@ class CuMemoryAllocator {
   // the code), and it also recomputes the largest_free_block_ array.
   void SortSubregions();
 
+  // A cache of the blocks freed by one CPU thread; defined in the .cc file.
+  struct ThreadCache;
+
+  // Returns the cache of the calling thread, or NULL if the thread is exiting
+  // and its cache has already been destroyed.
+  ThreadCache *GetThreadCache();
+
+  // True if blocks of this size (already rounded up to a multiple of 256) go
+  // through the per-thread caches.
+  inline bool IsThreadCached(size_t size) const;
+
+  // The part of MallocLocking() and MallocPitchLocking() for sizes for which
+  // IsThreadCached() is true.
+  void* MallocThreadCached(size_t size);
+
+  // Returns all the blocks in 'cache' to the pool.
+  void FlushThreadCache(ThreadCache *cache);
+
+  // Locks mutex_, keeping the contention statistics.
+  std::unique_lock<std::mutex> LockPool();
+
+  // A shard of the map from the blocks (given out by MallocThreadCached())
+  // that may go into the per-thread caches to their sizes.
+  struct SizeShard {
+    std::mutex mutex;
+    std::unordered_map<void*, size_t> sizes;
+  };
+  static const int32 kNumSizeShards = 16;
+
+  SizeShard &GetSizeShard(void *ptr) {
+    // the low 8 bits are always zero.
+    return size_shards_[(reinterpret_cast<size_t>(ptr) >> 8) % kNumSizeShards];
+  }
+
 
 
   CuAllocatorOptions opts_;
@@ -346,6 +419,19 @@ class CuMemoryAllocator {
   //   the application
   size_t max_allocated_memory_;
   size_t allocated_memory_;
+
+  // Number of calls to Malloc() and MallocPitch().
+  size_t num_mallocs_;
+
+  SizeShard size_shards_[kNumSizeShards];
+
+  // Contention statistics, for PrintMemoryUsage(); the first three are only
+  // changed with mutex_ locked.
+  size_t num_locks_;  // number of times mutex_ was locked
+  size_t num_contended_locks_;  // ... of which it was already locked
+  double lock_wait_time_;  // Total time spent waiting for mutex_.
+  // The number of allocations served from the per-thread caches.
+  std::atomic<size_t> num_thread_cache_hits_;
 };
 
 
@@ -358,6 +444,60 @@ std::string GetFreeGpuMemory(int64* free, int64* total);
 
 extern CuMemoryAllocator g_cuda_allocator;
 
+
+/**
+   This class allocates pinned (page-locked) host memory with cudaMallocHost(),
+   which the GPU can copy to and from asynchronously, and faster than pageable
+   memory; it caches the freed blocks, as cudaMallocHost() and cudaFreeHost()
+   are very slow.  It is used (via CuDevice::MallocPinned() etc.) for staging
+   the copies of CuMatrixBase::CopyFromMatAsync() and CopyToMatAsync().  It is
+   thread-safe.
+*/
+class CuPinnedAllocator {
+ public:
+  CuPinnedAllocator(): cached_bytes_(0), max_cached_bytes_(256 << 20) { }
+
+  // Must be called before any Malloc function is called; c.f.
+  // CuMemoryAllocator::SetOptions().
+  void SetOptions(const CuAllocatorOptions &opts) {
+    max_cached_bytes_ = static_cast<size_t>(opts.pinned_cache_mb) << 20;
+  }
+
+  void *Malloc(size_t size);
+
+  void Free(void *ptr);
+
+  /// Frees the block once the work queued so far on the stream of the
+  /// calling thread (i.e. its per-thread default stream) has completed, e.g.
+  /// an asynchronous copy from it.
+  void FreeAfterStream(void *ptr);
+
+  ~CuPinnedAllocator();
+
+ private:
+  // Frees the blocks from FreeAfterStream() whose work has completed; called
+  // with mutex_ locked.
+  void ReclaimCompleted();
+
+  // Frees a block, with mutex_ locked.
+  void FreeInternal(void *ptr);
+
+  struct PendingBlock {
+    void *ptr;
+    cudaEvent_t event;  // recorded on the stream when it was freed.
+  };
+
+  std::mutex mutex_;
+  std::map<void*, size_t> sizes_;  // the sizes of the allocated blocks.
+  std::multimap<size_t, void*> free_blocks_;  // the cached blocks, by size.
+  std::list<PendingBlock> pending_;
+  std::vector<cudaEvent_t> free_events_;
+  size_t cached_bytes_;  // the total size of free_blocks_.
+  size_t max_cached_bytes_;
+};
+
+extern CuPinnedAllocator g_cuda_pinned_allocator;
+
 }  // namespace kaldi
 
 #endif // HAVE_CUDA
@@ -122,6 +122,10 @@ static void UnitTestCuBlockMatrixAddMatMat() {
       if (i == 0) { dimM = 1; dimN = 1; }
       // early failures will have small dim for easier eyeballing.
       if (b % 2 == 0) std::swap(dimM, dimN);
+      if (i % 4 == 3 && b > 0) {  // blocks of the same size.
+        dimM = data[0].NumRows();
+        dimN = data[0].NumCols();
+      }
       data[b].Resize(dimM, dimN);
       KALDI_LOG << "dimM " << dimM << ", dimN " << dimN << ", stride " << data[b].Stride();
       data[b].SetRandn();
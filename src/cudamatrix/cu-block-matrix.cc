@@ -228,6 +228,31 @@ void CuBlockMatrix<Real>::AddMatMat(
   KALDI_ASSERT(A_num_rows == NumRows() && B_num_cols == NumCols()
                && A_num_cols == B_num_rows);
   if (NumBlocks() == 0) return; // empty matrix.
+  bool same_size = true;
+  for (MatrixIndexT b = 1; b < NumBlocks(); b++)
+    if (block_data_[b].num_rows != block_data_[0].num_rows ||
+        block_data_[b].num_cols != block_data_[0].num_cols)
+      same_size = false;
+  if (same_size) {
+    // The blocks, and the parts of A and B they use, are equally spaced, so
+    // we can do them all with one strided-batched multiplication.
+    MatrixIndexT block_rows = block_data_[0].num_rows,
+        block_cols = block_data_[0].num_cols;
+    CuSubMatrix<Real> block = Block(0),
+        A_part = (transA == kNoTrans ?
+                  A.Range(0, block_rows, 0, A.NumCols()) :
+                  A.Range(0, A.NumRows(), 0, block_rows)),
+        B_part = (transB == kNoTrans ?
+                  B.Range(0, B.NumRows(), 0, block_cols) :
+                  B.Range(0, block_cols, 0, B.NumCols()));
+    AddMatMatStridedBatched<Real>(
+        alpha, &block, block_cols,
+        A_part, (transA == kNoTrans ? block_rows * A.Stride() : block_rows),
+        transA,
+        B_part, (transB == kNoTrans ? block_cols : block_cols * B.Stride()),
+        transB, beta, NumBlocks());
+    return;
+  }
 #if HAVE_CUDA == 1
   if (CuDevice::Instantiate().Enabled()) {
     CuTimer tim;
@@ -27,6 +27,7 @@
 #include <cuda.h>
 #include <cuda_runtime_api.h>
 
+#include <cstring>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -46,6 +47,12 @@
 
 namespace kaldi {
 
+// The precision of the matrix multiplications (see GetGemmPrecision()): the
+// one from the options, set by SelectGpuId(), and the one set for this thread
+// by SetGemmPrecision(), if any (else -1).
+static CuGemmPrecision default_gemm_precision = kGemmFloat;
+static thread_local int32 thread_gemm_precision = -1;
+
 /// This function attempts to get a CUDA device context on some available device
 /// by doing 'cudaFree(0)'.  If it succeeds it returns true; if it fails, it
 /// outputs some debugging information into 'debug_str' and returns false.
@@ -133,8 +140,14 @@ void CuDevice::SelectGpuId(std::string use_gpu) {
 
   cudaError_t e = cudaGetDeviceCount(&num_gpus);
 
-  // Make sure the global allocator object has the up-to-date options.
+  // Make sure the global allocator objects have the up-to-date options.
   g_cuda_allocator.SetOptions(g_allocator_options);
+  g_cuda_pinned_allocator.SetOptions(g_allocator_options);
+  default_gemm_precision = g_gemm_options.Precision();
+#if CUDART_VERSION < 11000
+  if (default_gemm_precision == kGemmBfloat16)
+    KALDI_ERR << "--cuda-gemm-precision=bfloat16 requires CUDA 11 or later.";
+#endif
 
   if (num_gpus == 0) {
     if (use_gpu == "yes" || use_gpu == "wait") {
@@ -514,7 +527,56 @@ CuDevice::CuDevice():
     cusparse_handle_(NULL) {
 }
 
+void CuDevice::AddAsyncCopy(void *pinned, void *dest, MatrixIndexT num_rows,
+                            MatrixIndexT row_bytes,
+                            MatrixIndexT dest_stride_bytes) {
+  AsyncCopy copy;
+  copy.pinned = pinned;
+  copy.dest = dest;
+  copy.num_rows = num_rows;
+  copy.row_bytes = row_bytes;
+  copy.dest_stride_bytes = dest_stride_bytes;
+  if (free_events_.empty()) {
+    CU_SAFE_CALL(cudaEventCreateWithFlags(&copy.event,
+                                          cudaEventDisableTiming));
+  } else {
+    copy.event = free_events_.back();
+    free_events_.pop_back();
+  }
+  CU_SAFE_CALL(cudaEventRecord(copy.event, cudaStreamPerThread));
+  async_copies_.push_back(copy);
+}
+
+void CuDevice::FinishAsyncCopies() {
+  if (async_copies_.empty())
+    return;
+  CuTimer tim;
+  for (size_t i = 0; i < async_copies_.size(); i++) {
+    AsyncCopy &copy = async_copies_[i];
+    CU_SAFE_CALL(cudaEventSynchronize(copy.event));
+    const char *src = static_cast<const char*>(copy.pinned);
+    char *dest = static_cast<char*>(copy.dest);
+    if (copy.dest_stride_bytes == copy.row_bytes) {
+      memcpy(dest, src, static_cast<size_t>(copy.num_rows) * copy.row_bytes);
+    } else {
+      for (MatrixIndexT r = 0; r < copy.num_rows; r++)
+        memcpy(dest + static_cast<size_t>(r) * copy.dest_stride_bytes,
+               src + static_cast<size_t>(r) * copy.row_bytes, copy.row_bytes);
+    }
+    FreePinned(copy.pinned);
+    free_events_.push_back(copy.event);
+  }
+  async_copies_.clear();
+  AccuProfile(__func__, tim);
+}
+
 CuDevice::~CuDevice() {
+  if (!async_copies_.empty())
+    KALDI_WARN << "Asynchronous copies from the GPU were never finished "
+               << "(call FinishAsyncCopies()).";
+  // No need to check the return status here.
+  for (size_t i = 0; i < free_events_.size(); i++)
+    cudaEventDestroy(free_events_[i]);
   if (cublas_handle_)
     CUBLAS_SAFE_CALL(cublasDestroy(cublas_handle_));
   if (cusparse_handle_)
@@ -541,13 +603,67 @@ void SynchronizeGpu() {
   CU_SAFE_CALL(cudaGetLastError());
 }
 
+void FinishAsyncCopies() {
+  CuDevice::Instantiate().FinishAsyncCopies();
+}
+
+CuGemmPrecision GetGemmPrecision() {
+  return thread_gemm_precision < 0 ? default_gemm_precision :
+      static_cast<CuGemmPrecision>(thread_gemm_precision);
+}
+
+CuGemmPrecision SetGemmPrecision(CuGemmPrecision precision) {
+  CuGemmPrecision ans = GetGemmPrecision();
+#if CUDART_VERSION < 11000
+  if (precision == kGemmBfloat16)
+    KALDI_ERR << "Matrix multiplication in bfloat16 requires CUDA 11 or later.";
+#endif
+  thread_gemm_precision = precision;
+  return ans;
+}
+
 }  // namespace kaldi
 
 #else  // #if HAVE_CUDA == 1
 
+#include "cudamatrix/cu-device.h"
+
 namespace kaldi {
-// SynchronizeGpu() does nothing if we didn't compile for GPU.
+// SynchronizeGpu() and FinishAsyncCopies() do nothing if we didn't compile
+// for GPU.
 void SynchronizeGpu() { }
+void FinishAsyncCopies() { }
+
+// Without a GPU, the precision is only remembered.
+static thread_local CuGemmPrecision thread_gemm_precision = kGemmFloat;
+
+CuGemmPrecision GetGemmPrecision() { return thread_gemm_precision; }
+
+CuGemmPrecision SetGemmPrecision(CuGemmPrecision precision) {
+  CuGemmPrecision ans = thread_gemm_precision;
+  thread_gemm_precision = precision;
+  return ans;
+}
 }
 
 #endif  // #if HAVE_CUDA == 1
+
+namespace kaldi {
+
+// Like g_allocator_options, this is defined whether or not CUDA is compiled
+// in, so that the binaries accept the same options.
+CuGemmOptions g_gemm_options;
+
+CuGemmPrecision CuGemmOptions::Precision() const {
+  if (precision == "float")
+    return kGemmFloat;
+  else if (precision == "half")
+    return kGemmHalf;
+  else if (precision == "bfloat16")
+    return kGemmBfloat16;
+  KALDI_ERR << "Invalid --cuda-gemm-precision option '" << precision
+            << "': expected float, half or bfloat16.";
+  return kGemmFloat;  // suppress compiler warning.
+}
+
+}  // namespace kaldi
@@ -28,6 +28,7 @@
 #include <cusparse.h>
 #include <map>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <cuda.h>
 #include <cuda_runtime_api.h>
@@ -111,6 +112,29 @@ class CuDevice {
     else g_cuda_allocator.Free(ptr);
   }
 
+  // MallocPinned() and FreePinned() allocate and free pinned host memory, for
+  // asynchronous copies (see class CuPinnedAllocator); FreePinnedAfterStream()
+  // frees it once the work queued so far on this thread's stream is done.
+  inline void* MallocPinned(size_t size) {
+    return g_cuda_pinned_allocator.Malloc(size);
+  }
+  inline void FreePinned(void *ptr) { g_cuda_pinned_allocator.Free(ptr); }
+  inline void FreePinnedAfterStream(void *ptr) {
+    g_cuda_pinned_allocator.FreeAfterStream(ptr);
+  }
+
+  /// Called by CuMatrixBase::CopyToMatAsync(), after it has queued the copy
+  /// of "num_rows" rows of "row_bytes" bytes from the GPU to "pinned": it
+  /// records an event on this thread's stream, and FinishAsyncCopies() waits
+  /// for it and copies the rows to "dest" (with rows "dest_stride_bytes"
+  /// apart), then frees "pinned".
+  void AddAsyncCopy(void *pinned, void *dest, MatrixIndexT num_rows,
+                    MatrixIndexT row_bytes, MatrixIndexT dest_stride_bytes);
+
+  /// Completes the copies started by CopyToMatAsync() from this thread; see
+  /// the function FinishAsyncCopies().
+  void FinishAsyncCopies();
+
   /// Select a GPU for computation.  You are supposed to call this function just
   /// once, at the beginning of the program (from the main thread), or not at
   /// all.
@@ -151,6 +175,8 @@ class CuDevice {
   /// for a multi-threaded program, it may occasionally segfault (and also
   /// the code will detect that you failed to call it, and will print a warning).
   inline void AllowMultithreading() { multi_threaded_ = true; }
+  /// True if AllowMultithreading() has been called.
+  inline bool MultithreadingAllowed() const { return multi_threaded_; }
 
   /// Get the name of the GPU
   void DeviceGetName(char* name, int32 len, int32 dev);
@@ -271,6 +297,19 @@ class CuDevice {
 
   cusparseHandle_t cusparse_handle_;
 
+  // The copies from CopyToMatAsync() not yet completed by
+  // FinishAsyncCopies(), and the events to reuse for them.
+  struct AsyncCopy {
+    void *pinned;
+    void *dest;
+    MatrixIndexT num_rows;
+    MatrixIndexT row_bytes;
+    MatrixIndexT dest_stride_bytes;
+    cudaEvent_t event;
+  };
+  std::vector<AsyncCopy> async_copies_;
+  std::vector<cudaEvent_t> free_events_;
+
 }; // class CuDevice
 
 
@@ -294,9 +333,74 @@ inline cusparseHandle_t GetCusparseHandle() { return CuDevice::Instantiate().Get
 
 #endif // HAVE_CUDA
 
+#include <string>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
 
 namespace kaldi {
 
+/// The precision of the inputs of the matrix multiplications done by
+/// CuMatrixBase<float>::AddMatMat() on a GPU.  With kGemmHalf and
+/// kGemmBfloat16 the inputs are rounded to 16 bits and multiplied with
+/// cublasGemmEx() using tensor cores where the GPU has them; the products
+/// are still accumulated and output in float.  (kGemmBfloat16 needs CUDA 11.)
+/// Double-precision matrices, and everything without a GPU, are unaffected.
+enum CuGemmPrecision {
+  kGemmFloat,
+  kGemmHalf,
+  kGemmBfloat16
+};
+
+struct CuGemmOptions {
+  // "float", "half" or "bfloat16"; see CuGemmPrecision.
+  std::string precision;
+
+  CuGemmOptions(): precision("float") { }
+
+  void Register(OptionsItf *po) {
+    po->Register("cuda-gemm-precision", &precision, "Precision of the inputs "
+                 "of float matrix multiplications on the GPU: float, half or "
+                 "bfloat16 (16-bit inputs use tensor cores where available, "
+                 "and accumulate in float).");
+  }
+
+  /// Returns the precision, or dies if it is not a valid value.
+  CuGemmPrecision Precision() const;
+};
+
+// The options are read by CuDevice::SelectGpuId(), which sets the precision
+// of all the threads that have not overridden it with SetGemmPrecision().
+extern CuGemmOptions g_gemm_options;
+
+inline void RegisterCuGemmOptions(OptionsItf *po) {
+  g_gemm_options.Register(po);
+}
+
+/// Returns the precision used by CuMatrixBase<float>::AddMatMat() in this
+/// thread.
+CuGemmPrecision GetGemmPrecision();
+
+/// Sets the precision used by CuMatrixBase<float>::AddMatMat() in this
+/// thread, overriding --cuda-gemm-precision, and returns the previous one.
+/// You can use this around the matrix multiplications of particular call
+/// sites, or use class CuGemmPrecisionScope to do so.
+CuGemmPrecision SetGemmPrecision(CuGemmPrecision precision);
+
+/// Sets the precision of the matrix multiplications of this thread for as
+/// long as it exists, e.g.
+/// \code
+///   { CuGemmPrecisionScope scope(kGemmHalf); out.AddMatMat(...); }
+/// \endcode
+class CuGemmPrecisionScope {
+ public:
+  explicit CuGemmPrecisionScope(CuGemmPrecision precision):
+      old_precision_(SetGemmPrecision(precision)) { }
+  ~CuGemmPrecisionScope() { SetGemmPrecision(old_precision_); }
+ private:
+  CuGemmPrecision old_precision_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuGemmPrecisionScope);
+};
+
 /**
    The function SynchronizeGpu(), which for convenience is defined whether or
    not we have compiled for CUDA, is intended to be called in places where threads
@@ -317,6 +421,17 @@ namespace kaldi {
 */
 void SynchronizeGpu();
 
+/**
+   The function FinishAsyncCopies() (which, like SynchronizeGpu(), is defined
+   whether or not we have compiled for CUDA) waits for the copies started from
+   this thread by CuMatrixBase::CopyToMatAsync() and puts their data in the
+   destination matrices.  Until it is called, the destination matrices must
+   not be read, changed or freed.  It does not wait for the work queued on the
+   GPU after the copies, so the copies of the output of one computation can be
+   overlapped with the next.
+*/
+void FinishAsyncCopies();
+
 }   // namespace kaldi
 
 #endif // KALDI_CUDAMATRIX_CU_DEVICE_H_
@@ -500,6 +500,14 @@ void cudaD_heaviside(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d,
                      int src_stride);
 void cudaF_heaviside(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d,
                      int src_stride);
+void cudaD_philox_dropout(dim3 Gr, dim3 Bl, double *y, const double *x,
+                           MatrixDim d, int src_stride,
+                           double dropout_proportion, double scale,
+                           uint32_cuda key0, uint32_cuda key1, bool per_row);
+void cudaF_philox_dropout(dim3 Gr, dim3 Bl, float *y, const float *x,
+                           MatrixDim d, int src_stride,
+                           float dropout_proportion, float scale,
+                           uint32_cuda key0, uint32_cuda key1, bool per_row);
 void cuda_int32_add(dim3 Gr, dim3 Bl, int32_cuda *mat, int32_cuda value,
                     MatrixDim d);
 void cuda_int32_set_const(dim3 Gr, dim3 Bl, int32_cuda *mat, int32_cuda value,
@@ -789,6 +797,48 @@ void cuda_uncompress_int8(dim3 Gr, dim3 Bl, BaseFloat *dest,
 void cuda_uncompress_uint8(dim3 Gr, dim3 Bl, BaseFloat *dest,
                           MatrixDim dim, const uint8_t *src,
                           int src_stride, float scale);
+void cudaF_copy_from_compressed(dim3 Gr, dim3 Bl, float *mat, MatrixDim d,
+                                const uint8_t *data, int format,
+                                float min_value, float range);
+void cudaD_copy_from_compressed(dim3 Gr, dim3 Bl, double *mat, MatrixDim d,
+                                const uint8_t *data, int format,
+                                float min_value, float range);
+void cudaF_restricted_attention(int Gr, int Bl, float key_scale,
+                                  const float *keys, int keys_stride,
+                                  const float *queries, int queries_stride,
+                                  const float *values, int values_stride,
+                                  int key_dim, int value_dim, int context_dim,
+                                  int row_shift, float *c, int c_stride,
+                                  float *output, int output_stride,
+                                  bool output_context);
+void cudaF_restricted_attention_backprop(
+    int Gr_outputs, int Gr_inputs, int Bl, float key_scale, const float *keys,
+    int keys_stride, const float *queries, int queries_stride,
+    const float *values, int values_stride, const float *c, int c_stride,
+    const float *output_deriv, int output_deriv_stride, int key_dim,
+    int value_dim, int context_dim, int row_shift, bool output_context,
+    float *b_deriv, int b_deriv_stride, float *keys_deriv,
+    int keys_deriv_stride, float *queries_deriv, int queries_deriv_stride,
+    float *values_deriv, int values_deriv_stride);
+void cudaD_restricted_attention(int Gr, int Bl, double key_scale,
+                                  const double *keys, int keys_stride,
+                                  const double *queries, int queries_stride,
+                                  const double *values, int values_stride,
+                                  int key_dim, int value_dim, int context_dim,
+                                  int row_shift, double *c, int c_stride,
+                                  double *output, int output_stride,
+                                  bool output_context);
+void cudaD_restricted_attention_backprop(
+    int Gr_outputs, int Gr_inputs, int Bl, double key_scale, const double *keys,
+    int keys_stride, const double *queries, int queries_stride,
+    const double *values, int values_stride, const double *c, int c_stride,
+    const double *output_deriv, int output_deriv_stride, int key_dim,
+    int value_dim, int context_dim, int row_shift, bool output_context,
+    double *b_deriv, int b_deriv_stride, double *keys_deriv,
+    int keys_deriv_stride, double *queries_deriv, int queries_deriv_stride,
+    double *values_deriv, int values_deriv_stride);
+void cudaF_copy_to_16bit(dim3 Gr, dim3 Bl, const float *mat, MatrixDim d,
+                         uint16_t *out, bool bfloat16);
 
 // Launches a kernel that does nothing, explicitly using the legacy default stream;
 // this will synchronize all CUDA streams (except for non-blocking streams) on the
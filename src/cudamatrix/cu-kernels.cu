@@ -27,7 +27,9 @@
 #include <cfloat>
 #include <limits>
 #include <math_constants.h>
+#include <cuda_fp16.h>
 #include "cudamatrix/cu-kernels-ansi.h"
+#include "cudamatrix/cu-philox.h"
 
 
 
@@ -59,6 +61,28 @@ static Real _sum_reduce(Real buffer[]) {
   return buffer[0];
 }
 
+template<typename Real>
+__device__
+static Real _max_reduce(Real buffer[]) {
+  // Total number of active threads
+  int32_cuda nTotalThreads = blockDim.x;
+  __syncthreads();
+  // perform tree-based reduction (max)
+  while (nTotalThreads > 1) {
+    int32_cuda halfPoint = ((1 + nTotalThreads) >> 1); // divide by two
+    // only the first half of the threads will be active.
+    if (threadIdx.x >= halfPoint && threadIdx.x < nTotalThreads) {
+      Real temp = buffer[threadIdx.x];
+      if (temp > buffer[threadIdx.x - halfPoint])
+        buffer[threadIdx.x - halfPoint] = temp;
+    }
+    __syncthreads();
+    nTotalThreads = ((1 + nTotalThreads) >> 1); // divide by two.
+  }
+  // the result
+  return buffer[0];
+}
+
 /***********************************************************************
  * CUDA kernels
  * the functions are templated to have the float/double operations
@@ -2481,6 +2505,22 @@ static void _heaviside(Real*y, const Real*x, MatrixDim d, int src_stride) {
   }
 }
 
+template<typename Real>
+__global__
+static void _philox_dropout(Real *y, const Real *x, MatrixDim d,
+                            int src_stride, Real dropout_proportion,
+                            Real scale, uint32_cuda key0, uint32_cuda key1,
+                            bool per_row) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  int dst_index = i + j * d.stride, src_index = i + j * src_stride;
+  if (i < d.cols && j < d.rows) {
+    bool keep = PhiloxDropoutKeep(key0, key1, j, (per_row ? 0 : i),
+                                  dropout_proportion);
+    y[dst_index] = (keep ? x[src_index] * scale : Real(0));
+  }
+}
+
 template<typename Real>
 __global__
 static void _softmax_reduce(Real*y, const Real*x, MatrixDim d, int src_stride) {
@@ -3699,6 +3739,202 @@ static void _cuda_uncompress(BaseFloat *dest, MatrixDim dim,
   }
 }
 
+// Decompresses the data of a CompressedMatrix (all but its GlobalHeader,
+// whose format, min_value and range are given), with dimension "d"; see the
+// data formats in ../matrix/compressed-matrix.h.
+template<typename Real>
+__global__
+static void _copy_from_compressed(Real *mat, MatrixDim d, const uint8_t *data,
+                                  int format, float min_value, float range) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i >= d.cols || j >= d.rows)
+    return;
+  // the scale of the uint16's, as in CompressedMatrix::Uint16ToFloat().
+  const float uint16_scale = range * 1.52590218966964e-05f;
+  const uint16_t *data16 = reinterpret_cast<const uint16_t*>(data);
+  float f;
+  if (format == 1) {  // kOneByteWithColHeaders
+    const uint16_t *header = data16 + 4 * i;
+    float p0 = min_value + uint16_scale * header[0],
+        p25 = min_value + uint16_scale * header[1],
+        p75 = min_value + uint16_scale * header[2],
+        p100 = min_value + uint16_scale * header[3];
+    int value = data[8 * d.cols + i * d.rows + j];
+    if (value <= 64)
+      f = p0 + (p25 - p0) * value * (1 / 64.0f);
+    else if (value <= 192)
+      f = p25 + (p75 - p25) * (value - 64) * (1 / 128.0f);
+    else
+      f = p75 + (p100 - p75) * (value - 192) * (1 / 63.0f);
+  } else if (format == 2) {  // kTwoByte
+    f = min_value + uint16_scale * data16[j * d.cols + i];
+  } else if (format == 3) {  // kOneByte
+    f = min_value + range * (1 / 255.0f) * data[j * d.cols + i];
+  } else {  // kFourBitBlocks, in blocks of 32 rows.
+    int num_blocks = (d.rows + 31) / 32, col_bytes = (d.rows + 1) / 2;
+    const uint16_t *header = data16 + 2 * (i * num_blocks + j / 32);
+    float lo = min_value + uint16_scale * header[0],
+        hi = min_value + uint16_scale * header[1];
+    int byte = data[4 * num_blocks * d.cols + i * col_bytes + j / 2];
+    f = lo + (hi - lo) * (1 / 15.0f) * (j % 2 == 0 ? byte & 15 : byte >> 4);
+  }
+  mat[j * d.stride + i] = f;
+}
+
+// The restricted attention of ../nnet3/attention.h, fused into one kernel:
+// thread block i (of CU1DBLOCK threads) does output row i, whose o'th key
+// and value (for o < context_dim <= CU1DBLOCK) are rows i + o * row_shift
+// of "keys" and "values".  Thread o computes the o'th input of the softmax
+// and the block the softmax itself, so only the softmax output "c" is
+// written to memory, and it adds c times the values to the value part of
+// "output" (and copies c to its context part, if "output_context").
+template<typename Real>
+__global__
+static void _restricted_attention(Real key_scale, const Real *keys,
+                                  int keys_stride, const Real *queries,
+                                  int queries_stride, const Real *values,
+                                  int values_stride, int key_dim,
+                                  int value_dim, int context_dim,
+                                  int row_shift, Real *c, int c_stride,
+                                  Real *output, int output_stride,
+                                  bool output_context) {
+  __shared__ Real buffer[CU1DBLOCK];
+  __shared__ Real weights[CU1DBLOCK];
+  const int i = blockIdx.x, tid = threadIdx.x;
+  const Real *query = queries + i * queries_stride;
+  Real b = sizeof(Real) == sizeof(float) ? -CUDART_INF_F : -CUDART_INF;
+  if (tid < context_dim) {
+    const Real *key = keys + (i + tid * row_shift) * keys_stride;
+    Real dot = 0;
+    for (int k = 0; k < key_dim; k++)
+      dot += query[k] * key[k];
+    b = key_scale * dot + query[key_dim + tid];
+  }
+  buffer[tid] = b;
+  Real max = _max_reduce(buffer);
+  __syncthreads();
+  Real e = (tid < context_dim ? exp(b - max) : Real(0));
+  buffer[tid] = e;
+  Real weight = e / _sum_reduce(buffer);
+  weights[tid] = weight;
+  if (tid < context_dim) {
+    c[i * c_stride + tid] = weight;
+    if (output_context)
+      output[i * output_stride + value_dim + tid] = weight;
+  }
+  __syncthreads();
+  Real *output_row = output + i * output_stride;
+  for (int v = tid; v < value_dim; v += CU1DBLOCK) {
+    Real sum = 0;
+    for (int o = 0; o < context_dim; o++)
+      sum += weights[o] * values[(i + o * row_shift) * values_stride + v];
+    output_row[v] += sum;
+  }
+}
+
+// The first part of the backprop of _restricted_attention: thread block i
+// does output row i.  It outputs to "b_deriv" the derivative w.r.t. the
+// input of the softmax, and adds the derivatives w.r.t. query i to
+// "queries_deriv".  See _restricted_attention_backprop_inputs for the rest.
+template<typename Real>
+__global__
+static void _restricted_attention_backprop_outputs(
+    Real key_scale, const Real *keys, int keys_stride, const Real *values,
+    int values_stride, const Real *c, int c_stride, const Real *output_deriv,
+    int output_deriv_stride, int key_dim, int value_dim, int context_dim,
+    int row_shift, bool output_context, Real *b_deriv, int b_deriv_stride,
+    Real *queries_deriv, int queries_deriv_stride) {
+  __shared__ Real buffer[CU1DBLOCK];
+  __shared__ Real b_derivs[CU1DBLOCK];
+  const int i = blockIdx.x, tid = threadIdx.x;
+  const Real *od = output_deriv + i * output_deriv_stride;
+  Real weight = 0, c_deriv = 0;
+  if (tid < context_dim) {
+    const Real *value = values + (i + tid * row_shift) * values_stride;
+    for (int v = 0; v < value_dim; v++)
+      c_deriv += od[v] * value[v];
+    if (output_context)
+      c_deriv += od[value_dim + tid];
+    weight = c[i * c_stride + tid];
+  }
+  buffer[tid] = weight * c_deriv;
+  // the backprop through the softmax.
+  Real this_b_deriv = weight * (c_deriv - _sum_reduce(buffer));
+  b_derivs[tid] = this_b_deriv;
+  Real *qd = queries_deriv + i * queries_deriv_stride;
+  if (tid < context_dim) {
+    b_deriv[i * b_deriv_stride + tid] = this_b_deriv;
+    qd[key_dim + tid] += this_b_deriv;
+  }
+  __syncthreads();
+  for (int k = tid; k < key_dim; k += CU1DBLOCK) {
+    Real sum = 0;
+    for (int o = 0; o < context_dim; o++)
+      sum += b_derivs[o] * keys[(i + o * row_shift) * keys_stride + k];
+    qd[k] += key_scale * sum;
+  }
+}
+
+// The second part of the backprop of _restricted_attention: thread block j
+// adds to row j of "keys_deriv" and "values_deriv" the derivatives from the
+// output rows that row j is a key and value of, i.e. rows j - o * row_shift.
+// Doing this per input row, rather than per output row, means no two blocks
+// write the same memory (so there are no atomic operations, and the result
+// is deterministic).
+template<typename Real>
+__global__
+static void _restricted_attention_backprop_inputs(
+    Real key_scale, const Real *queries, int queries_stride, const Real *c,
+    int c_stride, const Real *b_deriv, int b_deriv_stride,
+    const Real *output_deriv, int output_deriv_stride, int num_output_rows,
+    int key_dim, int value_dim, int context_dim, int row_shift,
+    Real *keys_deriv, int keys_deriv_stride, Real *values_deriv,
+    int values_deriv_stride) {
+  const int j = blockIdx.x;
+  for (int k = threadIdx.x; k < key_dim + value_dim; k += CU1DBLOCK) {
+    Real sum = 0;
+    for (int o = 0, i = j; o < context_dim && i >= 0; o++, i -= row_shift) {
+      if (i >= num_output_rows)
+        continue;
+      if (k < key_dim)
+        sum += b_deriv[i * b_deriv_stride + o] * queries[i * queries_stride + k];
+      else
+        sum += c[i * c_stride + o] *
+            output_deriv[i * output_deriv_stride + k - key_dim];
+    }
+    if (k < key_dim)
+      keys_deriv[j * keys_deriv_stride + k] += key_scale * sum;
+    else
+      values_deriv[j * values_deriv_stride + k - key_dim] += sum;
+  }
+}
+
+// Rounds "mat" to 16 bits, to half precision or (if "bfloat16") to bfloat16,
+// for the inputs of cublasGemmEx(); the rows of "out" are d.cols apart.
+__global__
+static void _copy_to_16bit(const float *mat, MatrixDim d, uint16_t *out,
+                           bool bfloat16) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i >= d.cols || j >= d.rows)
+    return;
+  float f = mat[j * d.stride + i];
+  uint16_t h;
+  if (bfloat16) {
+    // round to nearest even, as __float2bfloat16_rn() does.
+    unsigned int bits = __float_as_uint(f);
+    h = (isnan(f) ? 0x7fc0 : (bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+  } else {
+#if CUDART_VERSION >= 9000
+    h = __half_as_ushort(__float2half_rn(f));
+#else
+    h = 0;  // never used: CuMatrixBase::AddMatMat() needs CUDA 9 for this.
+#endif
+  }
+  out[j * d.cols + i] = h;
+}
+
 __global__
 static void _noop_kernel() {
 }
@@ -4301,6 +4537,14 @@ void cudaF_heaviside(dim3 Gr, dim3 Bl, float* y, const float* x, MatrixDim d,
   _heaviside<<<Gr,Bl>>>(y, x, d, src_stride);
 }
 
+void cudaF_philox_dropout(dim3 Gr, dim3 Bl, float *y, const float *x,
+                           MatrixDim d, int src_stride,
+                           float dropout_proportion, float scale,
+                           uint32_cuda key0, uint32_cuda key1, bool per_row) {
+  _philox_dropout<<<Gr,Bl>>>(y, x, d, src_stride, dropout_proportion, scale,
+                             key0, key1, per_row);
+}
+
 void cudaF_softmax_reduce(size_t Gr, size_t Bl, float* y, const float* x,
                           MatrixDim d, int src_stride) {
   _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride);
@@ -4998,6 +5242,14 @@ void cudaD_heaviside(dim3 Gr, dim3 Bl, double* y, const double* x, MatrixDim d,
   _heaviside<<<Gr,Bl>>>(y, x, d, src_stride);
 }
 
+void cudaD_philox_dropout(dim3 Gr, dim3 Bl, double *y, const double *x,
+                           MatrixDim d, int src_stride,
+                           double dropout_proportion, double scale,
+                           uint32_cuda key0, uint32_cuda key1, bool per_row) {
+  _philox_dropout<<<Gr,Bl>>>(y, x, d, src_stride, dropout_proportion, scale,
+                             key0, key1, per_row);
+}
+
 void cudaD_softmax_reduce(size_t Gr, size_t Bl, double* y, const double* x,
                           MatrixDim d, int src_stride) {
   _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride);
@@ -5462,6 +5714,90 @@ void cuda_uncompress_int16(dim3 Gr, dim3 Bl, BaseFloat *dest,
   _cuda_uncompress<<<Gr, Bl>>>(dest, dim, src, src_stride, scale);
 }
 
+void cudaF_copy_from_compressed(dim3 Gr, dim3 Bl, float *mat, MatrixDim d,
+                                const uint8_t *data, int format,
+                                float min_value, float range) {
+  _copy_from_compressed<<<Gr, Bl>>>(mat, d, data, format, min_value, range);
+}
+void cudaD_copy_from_compressed(dim3 Gr, dim3 Bl, double *mat, MatrixDim d,
+                                const uint8_t *data, int format,
+                                float min_value, float range) {
+  _copy_from_compressed<<<Gr, Bl>>>(mat, d, data, format, min_value, range);
+}
+
+void cudaF_restricted_attention(int Gr, int Bl, float key_scale,
+                                  const float *keys, int keys_stride,
+                                  const float *queries, int queries_stride,
+                                  const float *values, int values_stride,
+                                  int key_dim, int value_dim, int context_dim,
+                                  int row_shift, float *c, int c_stride,
+                                  float *output, int output_stride,
+                                  bool output_context) {
+  _restricted_attention<<<Gr, Bl>>>(key_scale, keys, keys_stride, queries,
+                                    queries_stride, values, values_stride,
+                                    key_dim, value_dim, context_dim,
+                                    row_shift, c, c_stride, output,
+                                    output_stride, output_context);
+}
+void cudaF_restricted_attention_backprop(
+    int Gr_outputs, int Gr_inputs, int Bl, float key_scale, const float *keys,
+    int keys_stride, const float *queries, int queries_stride,
+    const float *values, int values_stride, const float *c, int c_stride,
+    const float *output_deriv, int output_deriv_stride, int key_dim,
+    int value_dim, int context_dim, int row_shift, bool output_context,
+    float *b_deriv, int b_deriv_stride, float *keys_deriv,
+    int keys_deriv_stride, float *queries_deriv, int queries_deriv_stride,
+    float *values_deriv, int values_deriv_stride) {
+  _restricted_attention_backprop_outputs<<<Gr_outputs, Bl>>>(
+      key_scale, keys, keys_stride, values, values_stride, c, c_stride,
+      output_deriv, output_deriv_stride, key_dim, value_dim, context_dim,
+      row_shift, output_context, b_deriv, b_deriv_stride, queries_deriv,
+      queries_deriv_stride);
+  _restricted_attention_backprop_inputs<<<Gr_inputs, Bl>>>(
+      key_scale, queries, queries_stride, c, c_stride, b_deriv,
+      b_deriv_stride, output_deriv, output_deriv_stride, Gr_outputs, key_dim,
+      value_dim, context_dim, row_shift, keys_deriv, keys_deriv_stride,
+      values_deriv, values_deriv_stride);
+}
+void cudaD_restricted_attention(int Gr, int Bl, double key_scale,
+                                  const double *keys, int keys_stride,
+                                  const double *queries, int queries_stride,
+                                  const double *values, int values_stride,
+                                  int key_dim, int value_dim, int context_dim,
+                                  int row_shift, double *c, int c_stride,
+                                  double *output, int output_stride,
+                                  bool output_context) {
+  _restricted_attention<<<Gr, Bl>>>(key_scale, keys, keys_stride, queries,
+                                    queries_stride, values, values_stride,
+                                    key_dim, value_dim, context_dim,
+                                    row_shift, c, c_stride, output,
+                                    output_stride, output_context);
+}
+void cudaD_restricted_attention_backprop(
+    int Gr_outputs, int Gr_inputs, int Bl, double key_scale, const double *keys,
+    int keys_stride, const double *queries, int queries_stride,
+    const double *values, int values_stride, const double *c, int c_stride,
+    const double *output_deriv, int output_deriv_stride, int key_dim,
+    int value_dim, int context_dim, int row_shift, bool output_context,
+    double *b_deriv, int b_deriv_stride, double *keys_deriv,
+    int keys_deriv_stride, double *queries_deriv, int queries_deriv_stride,
+    double *values_deriv, int values_deriv_stride) {
+  _restricted_attention_backprop_outputs<<<Gr_outputs, Bl>>>(
+      key_scale, keys, keys_stride, values, values_stride, c, c_stride,
+      output_deriv, output_deriv_stride, key_dim, value_dim, context_dim,
+      row_shift, output_context, b_deriv, b_deriv_stride, queries_deriv,
+      queries_deriv_stride);
+  _restricted_attention_backprop_inputs<<<Gr_inputs, Bl>>>(
+      key_scale, queries, queries_stride, c, c_stride, b_deriv,
+      b_deriv_stride, output_deriv, output_deriv_stride, Gr_outputs, key_dim,
+      value_dim, context_dim, row_shift, keys_deriv, keys_deriv_stride,
+      values_deriv, values_deriv_stride);
+}
+void cudaF_copy_to_16bit(dim3 Gr, dim3 Bl, const float *mat, MatrixDim d,
+                         uint16_t *out, bool bfloat16) {
+  _copy_to_16bit<<<Gr, Bl>>>(mat, d, out, bfloat16);
+}
+
 
 // Launches a kernel that does nothing, explicitly using the legacy default stream;
 // this will synchronize all threads without blocking.
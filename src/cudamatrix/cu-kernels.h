@@ -942,6 +942,22 @@ inline void cuda_heaviside(dim3 Gr, dim3 Bl, float *y, const float *x,
                            MatrixDim d, int src_stride) {
   cudaF_heaviside(Gr, Bl, y, x, d, src_stride);
 }
+inline void cuda_philox_dropout(dim3 Gr, dim3 Bl, double *y, const double *x,
+                                MatrixDim d, int src_stride,
+                                double dropout_proportion, double scale,
+                                uint32_cuda key0, uint32_cuda key1,
+                                bool per_row) {
+  cudaD_philox_dropout(Gr, Bl, y, x, d, src_stride, dropout_proportion, scale,
+                        key0, key1, per_row);
+}
+inline void cuda_philox_dropout(dim3 Gr, dim3 Bl, float *y, const float *x,
+                                MatrixDim d, int src_stride,
+                                float dropout_proportion, float scale,
+                                uint32_cuda key0, uint32_cuda key1,
+                                bool per_row) {
+  cudaF_philox_dropout(Gr, Bl, y, x, d, src_stride, dropout_proportion, scale,
+                        key0, key1, per_row);
+}
 inline void cuda_invert_elements(dim3 Gr, dim3 Bl, double *data, MatrixDim d) {
   cudaD_invert_elements(Gr, Bl, data, d);
 }
@@ -1551,6 +1567,83 @@ inline void cuda_mat_uncompress(dim3 Gr, dim3 Bl, BaseFloat *dest,
   cuda_uncompress_uint16(Gr, Bl, dest, dim, src, src_stride, scale);
 }
 
+inline void cuda_copy_from_compressed(dim3 Gr, dim3 Bl, float *mat,
+                                      MatrixDim d, const uint8_t *data,
+                                      int format, float min_value,
+                                      float range) {
+  cudaF_copy_from_compressed(Gr, Bl, mat, d, data, format, min_value, range);
+}
+inline void cuda_copy_from_compressed(dim3 Gr, dim3 Bl, double *mat,
+                                      MatrixDim d, const uint8_t *data,
+                                      int format, float min_value,
+                                      float range) {
+  cudaD_copy_from_compressed(Gr, Bl, mat, d, data, format, min_value, range);
+}
+inline void cuda_restricted_attention(int Gr, int Bl, float key_scale,
+                                      const float *keys, int keys_stride,
+                                      const float *queries, int queries_stride,
+                                      const float *values, int values_stride,
+                                      int key_dim, int value_dim,
+                                      int context_dim, int row_shift,
+                                      float *c, int c_stride, float *output,
+                                      int output_stride,
+                                      bool output_context) {
+  cudaF_restricted_attention(Gr, Bl, key_scale, keys, keys_stride, queries,
+                               queries_stride, values, values_stride, key_dim,
+                               value_dim, context_dim, row_shift, c, c_stride,
+                               output, output_stride, output_context);
+}
+inline void cuda_restricted_attention_backprop(
+    int Gr_outputs, int Gr_inputs, int Bl, float key_scale, const float *keys,
+    int keys_stride, const float *queries, int queries_stride,
+    const float *values, int values_stride, const float *c, int c_stride,
+    const float *output_deriv, int output_deriv_stride, int key_dim,
+    int value_dim, int context_dim, int row_shift, bool output_context,
+    float *b_deriv, int b_deriv_stride, float *keys_deriv,
+    int keys_deriv_stride, float *queries_deriv, int queries_deriv_stride,
+    float *values_deriv, int values_deriv_stride) {
+  cudaF_restricted_attention_backprop(
+      Gr_outputs, Gr_inputs, Bl, key_scale, keys, keys_stride, queries,
+      queries_stride, values, values_stride, c, c_stride, output_deriv,
+      output_deriv_stride, key_dim, value_dim, context_dim, row_shift,
+      output_context, b_deriv, b_deriv_stride, keys_deriv, keys_deriv_stride,
+      queries_deriv, queries_deriv_stride, values_deriv, values_deriv_stride);
+}
+inline void cuda_restricted_attention(int Gr, int Bl, double key_scale,
+                                      const double *keys, int keys_stride,
+                                      const double *queries, int queries_stride,
+                                      const double *values, int values_stride,
+                                      int key_dim, int value_dim,
+                                      int context_dim, int row_shift,
+                                      double *c, int c_stride, double *output,
+                                      int output_stride,
+                                      bool output_context) {
+  cudaD_restricted_attention(Gr, Bl, key_scale, keys, keys_stride, queries,
+                               queries_stride, values, values_stride, key_dim,
+                               value_dim, context_dim, row_shift, c, c_stride,
+                               output, output_stride, output_context);
+}
+inline void cuda_restricted_attention_backprop(
+    int Gr_outputs, int Gr_inputs, int Bl, double key_scale, const double *keys,
+    int keys_stride, const double *queries, int queries_stride,
+    const double *values, int values_stride, const double *c, int c_stride,
+    const double *output_deriv, int output_deriv_stride, int key_dim,
+    int value_dim, int context_dim, int row_shift, bool output_context,
+    double *b_deriv, int b_deriv_stride, double *keys_deriv,
+    int keys_deriv_stride, double *queries_deriv, int queries_deriv_stride,
+    double *values_deriv, int values_deriv_stride) {
+  cudaD_restricted_attention_backprop(
+      Gr_outputs, Gr_inputs, Bl, key_scale, keys, keys_stride, queries,
+      queries_stride, values, values_stride, c, c_stride, output_deriv,
+      output_deriv_stride, key_dim, value_dim, context_dim, row_shift,
+      output_context, b_deriv, b_deriv_stride, keys_deriv, keys_deriv_stride,
+      queries_deriv, queries_deriv_stride, values_deriv, values_deriv_stride);
+}
+inline void cuda_copy_to_16bit(dim3 Gr, dim3 Bl, const float *mat,
+                               MatrixDim d, uint16_t *out, bool bfloat16) {
+  cudaF_copy_to_16bit(Gr, Bl, mat, d, out, bfloat16);
+}
+
 
 } // namespace kaldi
 
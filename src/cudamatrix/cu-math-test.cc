@@ -26,6 +26,7 @@
 #include "util/common-utils.h"
 #include "cudamatrix/cu-matrix-lib.h"
 #include "cudamatrix/cu-math.h"
+#include "cudamatrix/cu-philox.h"
 #include "cudamatrix/cu-array.h"
 
 #if defined(_MSC_VER)
@@ -93,6 +94,46 @@ static void UnitTestEnsureNonzero() {
 }
 
 
+template<typename Real>
+static void UnitTestPhiloxDropout() {
+  int32 M = 100 + Rand() % 200, N = 100 + Rand() % 200;
+  Real dropout_proportion = 0.3, scale = 1.0 / (1.0 - dropout_proportion);
+  uint64 seed = RandInt(0, 100000) + (static_cast<uint64>(Rand()) << 32);
+  CuMatrix<Real> x(M, N);
+  x.SetRandn();
+  x.Add(10.0);  // so that no element is zero.
+  CuMatrix<Real> y(M, N, kUndefined), y2(x);
+  cu::PhiloxDropout(x, dropout_proportion, scale, seed, false, &y);
+  // in place, and again with the same seed, gives the same mask.
+  cu::PhiloxDropout(y2, dropout_proportion, scale, seed, false, &y2);
+  AssertEqual(y, y2);
+  Matrix<Real> x_cpu(x), y_cpu(y);
+  int32 num_kept = 0;
+  uint32 key0 = static_cast<uint32>(seed),
+      key1 = static_cast<uint32>(seed >> 32);
+  for (int32 r = 0; r < M; r++) {
+    for (int32 c = 0; c < N; c++) {
+      bool keep = PhiloxDropoutKeep(key0, key1, r, c, dropout_proportion);
+      KALDI_ASSERT(y_cpu(r, c) == (keep ? x_cpu(r, c) * scale : 0.0));
+      num_kept += (keep ? 1 : 0);
+    }
+  }
+  BaseFloat kept_proportion = num_kept / static_cast<BaseFloat>(M * N);
+  KALDI_ASSERT(fabs(kept_proportion - (1.0 - dropout_proportion)) < 0.02);
+
+  // another seed gives another mask.
+  cu::PhiloxDropout(x, dropout_proportion, scale, seed + 1, false, &y2);
+  KALDI_ASSERT(!y.ApproxEqual(y2));
+
+  cu::PhiloxDropout(x, dropout_proportion, scale, seed, true, &y);
+  y_cpu.CopyFromMat(y);
+  for (int32 r = 0; r < M; r++) {
+    bool keep = PhiloxDropoutKeep(key0, key1, r, 0, dropout_proportion);
+    for (int32 c = 0; c < N; c++)
+      KALDI_ASSERT(y_cpu(r, c) == (keep ? x_cpu(r, c) * scale : 0.0));
+  }
+}
+
 template<typename Real>
 static void UnitTestCuMathCopy() {
   int32 M = 100 + Rand() % 200, N = 100 + Rand() % 200;
@@ -647,6 +688,63 @@ static void UnitTestCuDiffNormalizePerRow() {
 
 
 
+template<typename Real>
+static void UnitTestCuMathRestrictedAttention() {
+  for (int i = 0; i < 5; i++) {
+    int32 key_dim = 1 + Rand() % 20, value_dim = 1 + Rand() % 20,
+        context_dim = 1 + Rand() % 10,
+        row_shift = (context_dim == 1 ? 0 : 1 + Rand() % 3),
+        num_output_rows = 1 + Rand() % 50,
+        num_input_rows = num_output_rows + (context_dim - 1) * row_shift;
+    bool output_context = (RandInt(0, 1) == 0);
+    Real key_scale = 0.5;
+    Matrix<Real> Hkeys(num_input_rows, key_dim),
+        Hqueries(num_output_rows, key_dim + context_dim),
+        Hvalues(num_input_rows, value_dim),
+        Hc(num_output_rows, context_dim),
+        Houtput(num_output_rows,
+                value_dim + (output_context ? context_dim : 0)),
+        Houtput_deriv(Houtput.NumRows(), Houtput.NumCols()),
+        Hkeys_deriv(num_input_rows, key_dim),
+        Hqueries_deriv(num_output_rows, key_dim + context_dim),
+        Hvalues_deriv(num_input_rows, value_dim);
+    Hkeys.SetRandn();
+    Hqueries.SetRandn();
+    Hvalues.SetRandn();
+    Houtput.SetRandn();
+    Houtput_deriv.SetRandn();
+    Hkeys_deriv.SetRandn();
+    Hqueries_deriv.SetRandn();
+    Hvalues_deriv.SetRandn();
+
+    CuMatrix<Real> Dkeys(Hkeys), Dqueries(Hqueries), Dvalues(Hvalues),
+        Dc(Hc), Doutput(Houtput), Doutput_deriv(Houtput_deriv),
+        Dkeys_deriv(Hkeys_deriv), Dqueries_deriv(Hqueries_deriv),
+        Dvalues_deriv(Hvalues_deriv);
+
+    cu::CpuComputeRestrictedAttention(key_scale, Hkeys, Hqueries, Hvalues,
+                                      &Hc, &Houtput);
+    cu::ComputeRestrictedAttention(key_scale, Dkeys, Dqueries, Dvalues,
+                                   &Dc, &Doutput);
+    AssertEqual(Hc, Matrix<Real>(Dc));
+    AssertEqual(Houtput, Matrix<Real>(Doutput));
+
+    // each row of c is a softmax output.
+    for (int32 r = 0; r < num_output_rows; r++)
+      AssertEqual(Hc.Row(r).Sum(), 1.0);
+
+    cu::CpuBackpropRestrictedAttention(key_scale, Hkeys, Hqueries, Hvalues,
+                                       Hc, Houtput_deriv, &Hkeys_deriv,
+                                       &Hqueries_deriv, &Hvalues_deriv);
+    cu::BackpropRestrictedAttention(key_scale, Dkeys, Dqueries, Dvalues, Dc,
+                                    Doutput_deriv, &Dkeys_deriv,
+                                    &Dqueries_deriv, &Dvalues_deriv);
+    AssertEqual(Hkeys_deriv, Matrix<Real>(Dkeys_deriv));
+    AssertEqual(Hqueries_deriv, Matrix<Real>(Dqueries_deriv));
+    AssertEqual(Hvalues_deriv, Matrix<Real>(Dvalues_deriv));
+  }
+}
+
 template<typename Real> void CudaMathUnitTest() {
 #if HAVE_CUDA == 1
   if (CuDevice::Instantiate().DoublePrecisionSupported())
@@ -658,9 +756,11 @@ template<typename Real> void CudaMathUnitTest() {
   UnitTestCuMathCopy<Real>();
   UnitTestLstmNonlinearity();
   UnitTestEnsureNonzero<Real>();
+  UnitTestPhiloxDropout<Real>();
   UnitTestBackpropLstmNonlinearity<Real>();
   UnitTestCuMathNormalizePerRow<Real>();
   UnitTestCuDiffNormalizePerRow<Real>();
+  UnitTestCuMathRestrictedAttention<Real>();
 }
 
 } // namespace kaldi
@@ -23,6 +23,7 @@
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
+#include "cudamatrix/cu-philox.h"
 
 namespace kaldi {
 
@@ -238,6 +239,60 @@ void EnsureNonzero(const CuMatrixBase<Real> &src,
   }
 }
 
+template <typename Real>
+void PhiloxDropout(const CuMatrixBase<Real> &src,
+                   Real dropout_proportion, Real scale,
+                   uint64 seed, bool per_row,
+                   CuMatrixBase<Real> *dest) {
+  KALDI_ASSERT(SameDim(*dest, src) &&
+               dropout_proportion >= 0.0 && dropout_proportion <= 1.0);
+  uint32 key0 = static_cast<uint32>(seed),
+      key1 = static_cast<uint32>(seed >> 32);
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    dim3 dimGrid, dimBlock;
+    GetBlockSizesForSimpleMatrixOperation(src.NumRows(), src.NumCols(),
+                                          &dimGrid, &dimBlock);
+    cuda_philox_dropout(dimGrid, dimBlock, dest->Data(), src.Data(),
+                        dest->Dim(), src.Stride(), dropout_proportion, scale,
+                        key0, key1, per_row);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    int32 num_rows = src.NumRows(), num_cols = src.NumCols();
+    float proportion = dropout_proportion;
+    for (int32 r = 0; r < num_rows; r++) {
+      const Real *src_data = src.RowData(r);
+      Real *dest_data = dest->RowData(r);
+      if (per_row) {
+        if (PhiloxDropoutKeep(key0, key1, r, 0, proportion)) {
+          for (int32 c = 0; c < num_cols; c++)
+            dest_data[c] = src_data[c] * scale;
+        } else {
+          for (int32 c = 0; c < num_cols; c++)
+            dest_data[c] = 0.0;
+        }
+        continue;
+      }
+      // one call to Philox4x32() gives the mask of four columns.
+      uint32 ctr[4];
+      for (int32 c = 0; c < num_cols; c++) {
+        if ((c & 3) == 0) {
+          ctr[0] = static_cast<uint32>(c) >> 2;
+          ctr[1] = static_cast<uint32>(r);
+          ctr[2] = ctr[3] = 0;
+          Philox4x32(key0, key1, ctr);
+        }
+        float u = (ctr[c & 3] >> 8) * (1.0f / 16777216.0f);
+        dest_data[c] = (u >= proportion ? src_data[c] * scale : Real(0));
+      }
+    }
+  }
+}
+
 
 // instantiate the templates.
 template
@@ -245,6 +300,14 @@ void RegularizeL1(CuMatrixBase<float> *weight, CuMatrixBase<float> *grad, float
 template
 void RegularizeL1(CuMatrixBase<double> *weight, CuMatrixBase<double> *grad, double l1, double lr);
 
+template
+void PhiloxDropout(const CuMatrixBase<float> &src,
+                   float dropout_proportion, float scale,
+                   uint64 seed, bool per_row, CuMatrixBase<float> *dest);
+template
+void PhiloxDropout(const CuMatrixBase<double> &src,
+                   double dropout_proportion, double scale,
+                   uint64 seed, bool per_row, CuMatrixBase<double> *dest);
 template
 void Splice(const CuMatrixBase<float> &src, const CuArray<int32> &frame_offsets,
             CuMatrixBase<float> *tgt);
@@ -992,6 +1055,251 @@ void BackpropLstmNonlinearity(const CuMatrixBase<double> &input,
                               CuMatrixBase<double> *deriv_sum_out,
                               CuMatrixBase<double> *self_repair_sum_out);
 
+// Returns the "row_shift" of the restricted attention, i.e. the number of
+// rows of the keys and values between consecutive context positions.
+static inline int32 RestrictedAttentionRowShift(int32 num_input_rows,
+                                                int32 num_output_rows,
+                                                int32 context_dim) {
+  KALDI_ASSERT(num_input_rows >= num_output_rows && context_dim > 0);
+  if (context_dim == 1)
+    return 0;
+  KALDI_ASSERT((num_input_rows - num_output_rows) % (context_dim - 1) == 0);
+  return (num_input_rows - num_output_rows) / (context_dim - 1);
+}
+
+template<typename Real>
+void CpuComputeRestrictedAttention(Real key_scale,
+                                   const MatrixBase<Real> &keys,
+                                   const MatrixBase<Real> &queries,
+                                   const MatrixBase<Real> &values,
+                                   MatrixBase<Real> *c,
+                                   MatrixBase<Real> *output) {
+  int32 key_dim = keys.NumCols(), value_dim = values.NumCols(),
+      num_output_rows = queries.NumRows(),
+      context_dim = queries.NumCols() - key_dim,
+      row_shift = RestrictedAttentionRowShift(keys.NumRows(), num_output_rows,
+                                              context_dim);
+  KALDI_ASSERT(values.NumRows() == keys.NumRows() &&
+               c->NumRows() == num_output_rows &&
+               c->NumCols() == context_dim &&
+               output->NumRows() == num_output_rows &&
+               (output->NumCols() == value_dim ||
+                output->NumCols() == value_dim + context_dim));
+  bool output_context = (output->NumCols() != value_dim);
+  for (int32 i = 0; i < num_output_rows; i++) {
+    SubVector<Real> query_key_part(queries.RowData(i), key_dim),
+        query_context_part(queries.RowData(i) + key_dim, context_dim),
+        c_row(c->RowData(i), context_dim),
+        output_values_part(output->RowData(i), value_dim);
+    for (int32 o = 0; o < context_dim; o++) {
+      SubVector<Real> key(keys, i + o * row_shift);
+      c_row(o) = key_scale * VecVec(query_key_part, key) +
+          query_context_part(o);
+    }
+    c_row.ApplySoftMax();
+    for (int32 o = 0; o < context_dim; o++) {
+      SubVector<Real> value(values, i + o * row_shift);
+      output_values_part.AddVec(c_row(o), value);
+    }
+    if (output_context) {
+      SubVector<Real> output_context_part(output->RowData(i) + value_dim,
+                                          context_dim);
+      output_context_part.CopyFromVec(c_row);
+    }
+  }
+}
+
+template<typename Real>
+void ComputeRestrictedAttention(Real key_scale,
+                                const CuMatrixBase<Real> &keys,
+                                const CuMatrixBase<Real> &queries,
+                                const CuMatrixBase<Real> &values,
+                                CuMatrixBase<Real> *c,
+                                CuMatrixBase<Real> *output) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    int32 key_dim = keys.NumCols(), value_dim = values.NumCols(),
+        num_output_rows = queries.NumRows(),
+        context_dim = queries.NumCols() - key_dim,
+        row_shift = RestrictedAttentionRowShift(keys.NumRows(),
+                                                num_output_rows, context_dim);
+    KALDI_ASSERT(context_dim <= CU1DBLOCK &&
+                 values.NumRows() == keys.NumRows() &&
+                 c->NumRows() == num_output_rows &&
+                 c->NumCols() == context_dim &&
+                 output->NumRows() == num_output_rows &&
+                 (output->NumCols() == value_dim ||
+                  output->NumCols() == value_dim + context_dim));
+    cuda_restricted_attention(num_output_rows, CU1DBLOCK, key_scale,
+                              keys.Data(), keys.Stride(), queries.Data(),
+                              queries.Stride(), values.Data(), values.Stride(),
+                              key_dim, value_dim, context_dim, row_shift,
+                              c->Data(), c->Stride(), output->Data(),
+                              output->Stride(),
+                              output->NumCols() != value_dim);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    CpuComputeRestrictedAttention(key_scale, keys.Mat(), queries.Mat(),
+                                  values.Mat(), &(c->Mat()), &(output->Mat()));
+  }
+}
+
+template<typename Real>
+void CpuBackpropRestrictedAttention(Real key_scale,
+                                    const MatrixBase<Real> &keys,
+                                    const MatrixBase<Real> &queries,
+                                    const MatrixBase<Real> &values,
+                                    const MatrixBase<Real> &c,
+                                    const MatrixBase<Real> &output_deriv,
+                                    MatrixBase<Real> *keys_deriv,
+                                    MatrixBase<Real> *queries_deriv,
+                                    MatrixBase<Real> *values_deriv) {
+  int32 key_dim = keys.NumCols(), value_dim = values.NumCols(),
+      num_output_rows = queries.NumRows(),
+      context_dim = queries.NumCols() - key_dim,
+      row_shift = RestrictedAttentionRowShift(keys.NumRows(), num_output_rows,
+                                              context_dim);
+  KALDI_ASSERT(values.NumRows() == keys.NumRows() &&
+               c.NumRows() == num_output_rows && c.NumCols() == context_dim &&
+               output_deriv.NumRows() == num_output_rows &&
+               (output_deriv.NumCols() == value_dim ||
+                output_deriv.NumCols() == value_dim + context_dim) &&
+               SameDim(keys, *keys_deriv) && SameDim(queries, *queries_deriv) &&
+               SameDim(values, *values_deriv));
+  bool output_context = (output_deriv.NumCols() != value_dim);
+  Vector<Real> b_deriv(context_dim, kUndefined);
+  for (int32 i = 0; i < num_output_rows; i++) {
+    SubVector<Real> c_row(c.RowData(i), context_dim),
+        output_deriv_values_part(output_deriv.RowData(i), value_dim),
+        query_key_part(queries.RowData(i), key_dim),
+        query_key_part_deriv(queries_deriv->RowData(i), key_dim),
+        query_context_part_deriv(queries_deriv->RowData(i) + key_dim,
+                                 context_dim);
+    // the derivative w.r.t. c, then back through the softmax.
+    for (int32 o = 0; o < context_dim; o++) {
+      SubVector<Real> value(values, i + o * row_shift);
+      b_deriv(o) = VecVec(output_deriv_values_part, value);
+      if (output_context)
+        b_deriv(o) += output_deriv(i, value_dim + o);
+    }
+    Real sum = VecVec(c_row, b_deriv);
+    b_deriv.Add(-sum);
+    b_deriv.MulElements(c_row);
+    query_context_part_deriv.AddVec(1.0, b_deriv);
+    for (int32 o = 0; o < context_dim; o++) {
+      int32 j = i + o * row_shift;
+      SubVector<Real> key(keys, j), key_deriv(*keys_deriv, j),
+          value_deriv(*values_deriv, j);
+      query_key_part_deriv.AddVec(key_scale * b_deriv(o), key);
+      key_deriv.AddVec(key_scale * b_deriv(o), query_key_part);
+      value_deriv.AddVec(c_row(o), output_deriv_values_part);
+    }
+  }
+}
+
+template<typename Real>
+void BackpropRestrictedAttention(Real key_scale,
+                                 const CuMatrixBase<Real> &keys,
+                                 const CuMatrixBase<Real> &queries,
+                                 const CuMatrixBase<Real> &values,
+                                 const CuMatrixBase<Real> &c,
+                                 const CuMatrixBase<Real> &output_deriv,
+                                 CuMatrixBase<Real> *keys_deriv,
+                                 CuMatrixBase<Real> *queries_deriv,
+                                 CuMatrixBase<Real> *values_deriv) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    int32 key_dim = keys.NumCols(), value_dim = values.NumCols(),
+        num_output_rows = queries.NumRows(),
+        context_dim = queries.NumCols() - key_dim,
+        row_shift = RestrictedAttentionRowShift(keys.NumRows(),
+                                                num_output_rows, context_dim);
+    KALDI_ASSERT(context_dim <= CU1DBLOCK &&
+                 values.NumRows() == keys.NumRows() &&
+                 c.NumRows() == num_output_rows &&
+                 c.NumCols() == context_dim &&
+                 output_deriv.NumRows() == num_output_rows &&
+                 (output_deriv.NumCols() == value_dim ||
+                  output_deriv.NumCols() == value_dim + context_dim) &&
+                 SameDim(keys, *keys_deriv) &&
+                 SameDim(queries, *queries_deriv) &&
+                 SameDim(values, *values_deriv));
+    // the derivative w.r.t. the input of the softmax.
+    CuMatrix<Real> b_deriv(num_output_rows, context_dim, kUndefined);
+    cuda_restricted_attention_backprop(
+        num_output_rows, keys.NumRows(), CU1DBLOCK, key_scale, keys.Data(),
+        keys.Stride(), queries.Data(), queries.Stride(), values.Data(),
+        values.Stride(), c.Data(), c.Stride(), output_deriv.Data(),
+        output_deriv.Stride(), key_dim, value_dim, context_dim, row_shift,
+        output_deriv.NumCols() != value_dim, b_deriv.Data(), b_deriv.Stride(),
+        keys_deriv->Data(), keys_deriv->Stride(), queries_deriv->Data(),
+        queries_deriv->Stride(), values_deriv->Data(), values_deriv->Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    CpuBackpropRestrictedAttention(key_scale, keys.Mat(), queries.Mat(),
+                                   values.Mat(), c.Mat(), output_deriv.Mat(),
+                                   &(keys_deriv->Mat()),
+                                   &(queries_deriv->Mat()),
+                                   &(values_deriv->Mat()));
+  }
+}
+
+template
+void CpuComputeRestrictedAttention(
+    float key_scale, const MatrixBase<float> &keys,
+    const MatrixBase<float> &queries, const MatrixBase<float> &values,
+    MatrixBase<float> *c, MatrixBase<float> *output);
+template
+void ComputeRestrictedAttention(
+    float key_scale, const CuMatrixBase<float> &keys,
+    const CuMatrixBase<float> &queries, const CuMatrixBase<float> &values,
+    CuMatrixBase<float> *c, CuMatrixBase<float> *output);
+template
+void CpuBackpropRestrictedAttention(
+    float key_scale, const MatrixBase<float> &keys,
+    const MatrixBase<float> &queries, const MatrixBase<float> &values,
+    const MatrixBase<float> &c, const MatrixBase<float> &output_deriv,
+    MatrixBase<float> *keys_deriv, MatrixBase<float> *queries_deriv,
+    MatrixBase<float> *values_deriv);
+template
+void BackpropRestrictedAttention(
+    float key_scale, const CuMatrixBase<float> &keys,
+    const CuMatrixBase<float> &queries, const CuMatrixBase<float> &values,
+    const CuMatrixBase<float> &c, const CuMatrixBase<float> &output_deriv,
+    CuMatrixBase<float> *keys_deriv, CuMatrixBase<float> *queries_deriv,
+    CuMatrixBase<float> *values_deriv);
+template
+void CpuComputeRestrictedAttention(
+    double key_scale, const MatrixBase<double> &keys,
+    const MatrixBase<double> &queries, const MatrixBase<double> &values,
+    MatrixBase<double> *c, MatrixBase<double> *output);
+template
+void ComputeRestrictedAttention(
+    double key_scale, const CuMatrixBase<double> &keys,
+    const CuMatrixBase<double> &queries, const CuMatrixBase<double> &values,
+    CuMatrixBase<double> *c, CuMatrixBase<double> *output);
+template
+void CpuBackpropRestrictedAttention(
+    double key_scale, const MatrixBase<double> &keys,
+    const MatrixBase<double> &queries, const MatrixBase<double> &values,
+    const MatrixBase<double> &c, const MatrixBase<double> &output_deriv,
+    MatrixBase<double> *keys_deriv, MatrixBase<double> *queries_deriv,
+    MatrixBase<double> *values_deriv);
+template
+void BackpropRestrictedAttention(
+    double key_scale, const CuMatrixBase<double> &keys,
+    const CuMatrixBase<double> &queries, const CuMatrixBase<double> &values,
+    const CuMatrixBase<double> &c, const CuMatrixBase<double> &output_deriv,
+    CuMatrixBase<double> *keys_deriv, CuMatrixBase<double> *queries_deriv,
+    CuMatrixBase<double> *values_deriv);
 
 
 } //namespace cu
@@ -74,6 +74,19 @@ void Copy(const CuMatrixBase<Real> &src,
           CuMatrixBase<Real> *tgt);
 
 
+/// Dropout with a mask that is never stored: it sets
+/// dest(r, c) = src(r, c) * scale if the mask keeps element (r, c), and 0
+/// otherwise.  The mask drops each element with probability
+/// dropout_proportion (if per_row, whole rows at a time), and it is a function
+/// of the seed and of (r, c) only (see PhiloxDropoutKeep() in cu-philox.h), so
+/// the backward pass is the same call with the same seed on the derivatives.
+/// src and dest must have the same dimension, and may be the same matrix.
+template<typename Real>
+void PhiloxDropout(const CuMatrixBase<Real> &src,
+                   Real dropout_proportion, Real scale,
+                   uint64 seed, bool per_row,
+                   CuMatrixBase<Real> *dest);
+
 /// This function requires that src and dest have the same dimension and epsilon
 /// > 0.  It copies src to dest while ensuring that the values are bounded away
 /// from zero by at least epsilon:
@@ -298,6 +311,64 @@ void DiffNormalizePerRow(const CuMatrixBase<Real> &in_value,
                          const Real target_rms, const bool add_log_stddev,
                          CuMatrixBase<Real>* in_deriv);
 
+/**
+   The forward computation of the restricted attention of
+   ../nnet3/attention.h (see AttentionForward() there for the meaning of the
+   arguments, and the math), done in one pass over the output rows so that
+   the dot products and the input of the softmax are never written to
+   memory.  "c" is written to, and the result is added to the first
+   values.NumCols() columns of "output"; if "output" has
+   values.NumCols() + context_dim columns, "c" is also copied to the rest.
+   The number of context positions, queries.NumCols() - keys.NumCols(), must
+   be no more than CU1DBLOCK when using a GPU.
+*/
+template<typename Real>
+void ComputeRestrictedAttention(Real key_scale,
+                                const CuMatrixBase<Real> &keys,
+                                const CuMatrixBase<Real> &queries,
+                                const CuMatrixBase<Real> &values,
+                                CuMatrixBase<Real> *c,
+                                CuMatrixBase<Real> *output);
+// This is a version of ComputeRestrictedAttention() that only uses the CPU,
+// even if a GPU is available, and is used for testing.
+template<typename Real>
+void CpuComputeRestrictedAttention(Real key_scale,
+                                   const MatrixBase<Real> &keys,
+                                   const MatrixBase<Real> &queries,
+                                   const MatrixBase<Real> &values,
+                                   MatrixBase<Real> *c,
+                                   MatrixBase<Real> *output);
+
+/**
+   The backprop of ComputeRestrictedAttention() (see AttentionBackward() in
+   ../nnet3/attention.h): adds the derivatives w.r.t. "keys", "queries" and
+   "values" to "keys_deriv", "queries_deriv" and "values_deriv".  On the GPU
+   the derivatives w.r.t. keys and values are gathered per input row, so
+   there are no atomic additions and the result is deterministic.
+*/
+template<typename Real>
+void BackpropRestrictedAttention(Real key_scale,
+                                 const CuMatrixBase<Real> &keys,
+                                 const CuMatrixBase<Real> &queries,
+                                 const CuMatrixBase<Real> &values,
+                                 const CuMatrixBase<Real> &c,
+                                 const CuMatrixBase<Real> &output_deriv,
+                                 CuMatrixBase<Real> *keys_deriv,
+                                 CuMatrixBase<Real> *queries_deriv,
+                                 CuMatrixBase<Real> *values_deriv);
+// This is a version of BackpropRestrictedAttention() that only uses the CPU,
+// even if a GPU is available, and is used for testing.
+template<typename Real>
+void CpuBackpropRestrictedAttention(Real key_scale,
+                                    const MatrixBase<Real> &keys,
+                                    const MatrixBase<Real> &queries,
+                                    const MatrixBase<Real> &values,
+                                    const MatrixBase<Real> &c,
+                                    const MatrixBase<Real> &output_deriv,
+                                    MatrixBase<Real> *keys_deriv,
+                                    MatrixBase<Real> *queries_deriv,
+                                    MatrixBase<Real> *values_deriv);
+
 
 } // namespace cu
 } // namespace kaldi
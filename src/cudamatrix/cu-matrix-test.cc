@@ -1830,6 +1830,122 @@ static void UnitTestCuMatrixCopyFromMat() {
   }
 }
 
+template<typename Real>
+static void UnitTestCuMatrixCopyFromCompressed() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 100), num_cols = RandInt(1, 20);
+    Matrix<Real> A(num_rows, num_cols);
+    A.SetRandn();
+    CompressionMethod method = static_cast<CompressionMethod>(
+        RandInt(1, 8));
+    if (method == kTwoByteSignedInteger || method == kOneByteUnsignedInteger)
+      method = kAutomaticMethod;  // these need integer data.
+    CompressedMatrix cmat(A, method);
+    Matrix<Real> B(num_rows, num_cols);
+    cmat.CopyToMat(&B);
+    CuMatrix<Real> C(num_rows, num_cols);
+    C.CopyFromMat(cmat);
+    Matrix<Real> D(C);
+    KALDI_ASSERT(B.ApproxEqual(D, 1.0e-05));
+  }
+}
+
+template<typename Real>
+static void UnitTestCuMatrixAddMatMatMixedPrecision() {
+  CuGemmPrecision precisions[] = { kGemmHalf, kGemmBfloat16 };
+  for (int32 i = 0; i < 10; i++) {
+    CuGemmPrecision precision = precisions[i % 2];
+#if HAVE_CUDA == 1 && CUDART_VERSION < 11000
+    precision = kGemmHalf;
+#endif
+    MatrixIndexT m = RandInt(1, 100), n = RandInt(1, 100), k = RandInt(1, 100);
+    MatrixTransposeType transA = (i % 3 == 0 ? kTrans : kNoTrans),
+        transB = (i % 4 == 0 ? kTrans : kNoTrans);
+    CuMatrix<Real> A(transA == kTrans ? k : m, transA == kTrans ? m : k),
+        B(transB == kTrans ? n : k, transB == kTrans ? k : n), C(m, n), D(m, n);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    D.CopyFromMat(C);
+    C.AddMatMat(0.5, A, transA, B, transB, 2.0);
+    {
+      CuGemmPrecisionScope scope(precision);
+      KALDI_ASSERT(GetGemmPrecision() == precision);
+      D.AddMatMat(0.5, A, transA, B, transB, 2.0);
+    }
+    KALDI_ASSERT(GetGemmPrecision() == kGemmFloat);
+    // bfloat16 has 8 bits of mantissa.
+    KALDI_ASSERT(C.ApproxEqual(D, 0.02));
+  }
+}
+
+template<typename Real>
+static void UnitTestCuMatrixAddMatMatStridedBatched() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 batch_size = RandInt(1, 10);
+    MatrixIndexT m = RandInt(1, 20), n = RandInt(1, 20), k = RandInt(1, 20);
+    MatrixTransposeType transA = (i % 2 == 0 ? kTrans : kNoTrans),
+        transB = (i % 3 == 0 ? kTrans : kNoTrans);
+    MatrixIndexT a_rows = (transA == kTrans ? k : m),
+        a_cols = (transA == kTrans ? m : k),
+        b_rows = (transB == kTrans ? n : k),
+        b_cols = (transB == kTrans ? k : n);
+    // the A's side by side, the B's one above the other and the C's side by
+    // side.
+    CuMatrix<Real> A(a_rows, a_cols * batch_size),
+        B(b_rows * batch_size, b_cols),
+        C(m, n * batch_size), D(m, n * batch_size);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    D.CopyFromMat(C);
+    for (int32 b = 0; b < batch_size; b++) {
+      CuSubMatrix<Real> D_part(D.ColRange(b * n, n));
+      D_part.AddMatMat(0.5, A.ColRange(b * a_cols, a_cols), transA,
+                       B.RowRange(b * b_rows, b_rows), transB, 2.0);
+    }
+    CuSubMatrix<Real> C_part(C.ColRange(0, n));
+    AddMatMatStridedBatched<Real>(0.5, &C_part, n,
+                                  A.ColRange(0, a_cols), a_cols, transA,
+                                  B.RowRange(0, b_rows), b_rows * B.Stride(),
+                                  transB, 2.0, batch_size);
+    AssertEqual(C, D);
+  }
+}
+
+template<typename Real>
+static void UnitTestCuMatrixCopyAsync() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 100), num_cols = RandInt(1, 50);
+    Matrix<Real> A(num_rows, num_cols), B(num_rows, num_cols + 3);
+    A.SetRandn();
+    CuMatrix<Real> C(num_rows, num_cols);
+    C.CopyFromMatAsync(A);
+    SubMatrix<Real> B_part(B, 0, num_rows, 0, num_cols);
+    C.CopyToMatAsync(&B_part);
+    FinishAsyncCopies();
+    AssertEqual<Real>(A, B_part);
+  }
+}
+
+static void UnitTestCuPinnedMatrix() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(2, 100), num_cols = RandInt(1, 50),
+        split = RandInt(1, num_rows - 1);
+    Matrix<BaseFloat> A(num_rows, num_cols);
+    A.SetRandn();
+    CuMatrix<BaseFloat> C(A);
+    CuPinnedMatrix B;
+    B.Resize(num_rows, num_cols);
+    // copy in two pieces, the second one first.
+    B.CopyRowsFromCuMatAsync(C.RowRange(split, num_rows - split), split);
+    B.CopyRowsFromCuMatAsync(C.RowRange(0, split), 0);
+    B.Wait();
+    KALDI_ASSERT(B.Ready());
+    AssertEqual<BaseFloat>(A, B.Mat());
+  }
+}
+
 template<typename Real>
 static void UnitTestCuMatrixCopyFromTp() {
   for (int32 i = 1; i < 10; i++) {
@@ -2971,6 +3087,11 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuMatrixAddMatMatBatched<Real>();
   UnitTestCuMatrixSymInvertPosDef<Real>();
   UnitTestCuMatrixCopyFromMat<Real>();
+  UnitTestCuMatrixCopyFromCompressed<Real>();
+  UnitTestCuMatrixCopyAsync<Real>();
+  UnitTestCuPinnedMatrix();
+  UnitTestCuMatrixAddMatMatStridedBatched<Real>();
+  UnitTestCuMatrixAddMatMatMixedPrecision<Real>();
   UnitTestCuMatrixCopyFromTp<Real>();
   UnitTestCuMatrixAddMatTp<Real>();
   UnitTestCuMatrixCopyCols<Real>();
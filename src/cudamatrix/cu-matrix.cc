@@ -28,6 +28,7 @@
 #if HAVE_CUDA == 1
 #include <cuda_runtime_api.h>
 #include <cublas_v2.h>
+#include <cstring>
 #endif
 
 #include "base/timer.h"
@@ -42,6 +43,7 @@
 #include "cudamatrix/cu-block-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/matrix-allocator.h"
 
 namespace kaldi {
 
@@ -101,7 +103,8 @@ void CuMatrix<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    // the memory came from Matrix, Vector or PackedMatrix.
+    if (this->data_ != NULL) MatrixFree(this->data_);
   }
   this->data_ = NULL;
   this->num_rows_ = 0;
@@ -344,6 +347,57 @@ void CuMatrixBase<Real>::CopyFromMat(const MatrixBase<OtherReal> &src,
   this->CopyFromMat(temp, trans);
 }
 
+template<typename Real>
+void CuMatrixBase<Real>::CopyFromMatAsync(const MatrixBase<Real> &src) {
+  KALDI_ASSERT(src.NumRows() == num_rows_ && src.NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    MatrixIndexT row_bytes = num_cols_ * sizeof(Real);
+    char *pinned = static_cast<char*>(CuDevice::Instantiate().MallocPinned(
+        static_cast<size_t>(num_rows_) * row_bytes));
+    for (MatrixIndexT r = 0; r < num_rows_; r++)
+      memcpy(pinned + static_cast<size_t>(r) * row_bytes, src.RowData(r),
+             row_bytes);
+    CU_SAFE_CALL(cudaMemcpy2DAsync(data_, stride_ * sizeof(Real), pinned,
+                                   row_bytes, row_bytes, num_rows_,
+                                   cudaMemcpyHostToDevice,
+                                   cudaStreamPerThread));
+    CuDevice::Instantiate().FreePinnedAfterStream(pinned);
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    Mat().CopyFromMat(src);
+  }
+}
+
+template<typename Real>
+void CuMatrixBase<Real>::CopyToMatAsync(MatrixBase<Real> *dst) const {
+  KALDI_ASSERT(dst->NumRows() == num_rows_ && dst->NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    MatrixIndexT row_bytes = num_cols_ * sizeof(Real);
+    void *pinned = CuDevice::Instantiate().MallocPinned(
+        static_cast<size_t>(num_rows_) * row_bytes);
+    CU_SAFE_CALL(cudaMemcpy2DAsync(pinned, row_bytes, data_,
+                                   stride_ * sizeof(Real), row_bytes,
+                                   num_rows_, cudaMemcpyDeviceToHost,
+                                   cudaStreamPerThread));
+    CuDevice::Instantiate().AddAsyncCopy(pinned, dst->Data(), num_rows_,
+                                         row_bytes,
+                                         dst->Stride() * sizeof(Real));
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    dst->CopyFromMat(Mat());
+  }
+}
+
 // instantiate the template above.
 template
 void CuMatrixBase<float>::CopyFromMat(const MatrixBase<double> &src,
@@ -1273,6 +1327,67 @@ void CuMatrixBase<Real>::AddVecToRows(Real alpha,
 
 
 
+#if HAVE_CUDA == 1
+// Returns a copy of "M" rounded to 16 bits (see _copy_to_16bit), in memory
+// from CuDevice::Malloc() which the caller frees, with rows M.NumCols() apart.
+static void *CopyTo16Bit(const CuMatrixBase<float> &M, bool bfloat16) {
+  uint16_t *ans = static_cast<uint16_t*>(CuDevice::Instantiate().Malloc(
+      static_cast<size_t>(M.NumRows()) * M.NumCols() * sizeof(uint16_t)));
+  dim3 dimGrid, dimBlock;
+  GetBlockSizesForSimpleMatrixOperation(M.NumRows(), M.NumCols(),
+                                        &dimGrid, &dimBlock);
+  cuda_copy_to_16bit(dimGrid, dimBlock, M.Data(), M.Dim(), ans, bfloat16);
+  CU_SAFE_CALL(cudaGetLastError());
+  return ans;
+}
+
+// This does what AddMatMat() does on the GPU, but with the inputs rounded to
+// 16 bits and multiplied by cublasGemmEx(), if GetGemmPrecision() says so and
+// Real is float; it returns false (having done nothing) otherwise.
+template<typename Real>
+static bool AddMatMatMixedPrecision(
+    Real alpha, const CuMatrixBase<Real> &A, MatrixTransposeType transA,
+    const CuMatrixBase<Real> &B, MatrixTransposeType transB, Real beta,
+    CuMatrixBase<Real> *C) {
+  return false;
+}
+
+template<>
+bool AddMatMatMixedPrecision(
+    float alpha, const CuMatrixBase<float> &A, MatrixTransposeType transA,
+    const CuMatrixBase<float> &B, MatrixTransposeType transB, float beta,
+    CuMatrixBase<float> *C) {
+#if CUDART_VERSION >= 9000
+  CuGemmPrecision precision = GetGemmPrecision();
+  if (precision == kGemmFloat || A.NumRows() == 0 || A.NumCols() == 0)
+    return false;
+  bool bfloat16 = (precision == kGemmBfloat16);
+  cudaDataType_t type = CUDA_R_16F;
+#if CUDART_VERSION >= 11000
+  if (bfloat16)
+    type = CUDA_R_16BF;
+#endif
+  // as in AddMatMat(), A and B are swapped as cuBLAS is column-major.
+  MatrixIndexT m = C->NumCols(), n = C->NumRows(),
+      k = (transA == kTrans ? A.NumRows() : A.NumCols());
+  void *a = CopyTo16Bit(A, bfloat16), *b = CopyTo16Bit(B, bfloat16);
+  CUBLAS_SAFE_CALL(cublasGemmEx(GetCublasHandle(),
+                                (transB == kTrans ? CUBLAS_OP_T : CUBLAS_OP_N),
+                                (transA == kTrans ? CUBLAS_OP_T : CUBLAS_OP_N),
+                                m, n, k, &alpha, b, type, B.NumCols(),
+                                a, type, A.NumCols(), &beta,
+                                C->Data(), CUDA_R_32F, C->Stride(),
+                                CUDA_R_32F, CUBLAS_GEMM_DEFAULT_TENSOR_OP));
+  // the memory is only reused by kernels queued after the GEMM.
+  CuDevice::Instantiate().Free(a);
+  CuDevice::Instantiate().Free(b);
+  return true;
+#else
+  return false;
+#endif
+}
+#endif
+
 /*
  * Method wrapping the CUBLAS function GEMM
  */
@@ -1280,6 +1395,7 @@ template<typename Real>
 void CuMatrixBase<Real>::AddMatMat(
     Real alpha, const CuMatrixBase<Real> &A, MatrixTransposeType transA,
     const CuMatrixBase<Real> &B, MatrixTransposeType transB, Real beta) {
+  KALDI_PROFILE_SCOPE("CuMatrixBase::AddMatMat");
 
 
     // CUBLAS is col-major, cudamatrix is row-major, how to do the mapping?
@@ -1299,11 +1415,12 @@ void CuMatrixBase<Real>::AddMatMat(
 #if HAVE_CUDA == 1
   if (CuDevice::Instantiate().Enabled()) {
     CuTimer tim;
-    CUBLAS_SAFE_CALL(cublas_gemm(GetCublasHandle(),
-                             (transB==kTrans? CUBLAS_OP_T:CUBLAS_OP_N),
-                             (transA==kTrans? CUBLAS_OP_T:CUBLAS_OP_N),
-                             m, n, k, alpha, B.data_, B.Stride(),
-                             A.data_, A.Stride(), beta, data_, Stride()));
+    if (!AddMatMatMixedPrecision(alpha, A, transA, B, transB, beta, this))
+      CUBLAS_SAFE_CALL(cublas_gemm(GetCublasHandle(),
+                               (transB==kTrans? CUBLAS_OP_T:CUBLAS_OP_N),
+                               (transA==kTrans? CUBLAS_OP_T:CUBLAS_OP_N),
+                               m, n, k, alpha, B.data_, B.Stride(),
+                               A.data_, A.Stride(), beta, data_, Stride()));
 
     CuDevice::Instantiate().AccuProfile(__func__, tim);
   } else
@@ -2280,6 +2397,73 @@ void AddMatMatBatched(const double alpha, std::vector<CuSubMatrix<double>* > &C,
                       const std::vector<CuSubMatrix<double>* > &B,
                       MatrixTransposeType transB, const double beta);
 
+template<typename Real>
+void AddMatMatStridedBatched(Real alpha, CuMatrixBase<Real> *C,
+                             MatrixIndexT c_offset,
+                             const CuMatrixBase<Real> &A,
+                             MatrixIndexT a_offset, MatrixTransposeType transA,
+                             const CuMatrixBase<Real> &B,
+                             MatrixIndexT b_offset, MatrixTransposeType transB,
+                             Real beta, int32 batch_size) {
+  KALDI_ASSERT(batch_size >= 0);
+  MatrixIndexT m = ((transB==kTrans)? B.NumRows() : B.NumCols());
+  MatrixIndexT n = ((transA==kTrans)? A.NumCols() : A.NumRows());
+  MatrixIndexT k = ((transB==kTrans)? B.NumCols() : B.NumRows());
+  MatrixIndexT k1 = ((transA==kTrans)? A.NumRows() : A.NumCols());
+
+  KALDI_ASSERT(m == C->NumCols());
+  KALDI_ASSERT(n == C->NumRows());
+  KALDI_ASSERT(k == k1);
+
+  if (m == 0 || n == 0 || batch_size == 0) return;
+
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    CUBLAS_SAFE_CALL(cublas_gemmStridedBatched(
+        GetCublasHandle(),
+        (transB==kTrans? CUBLAS_OP_T:CUBLAS_OP_N),
+        (transA==kTrans? CUBLAS_OP_T:CUBLAS_OP_N),
+        m, n, k, alpha, B.Data(), B.Stride(), b_offset,
+        A.Data(), A.Stride(), a_offset, beta,
+        C->Data(), C->Stride(), c_offset, batch_size));
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    // AddMatMat() uses its own kernels, not BLAS, for small matrices.
+    for (int32 i = 0; i < batch_size; i++) {
+      SubMatrix<Real> C_i(C->Data() + i * c_offset, C->NumRows(),
+                          C->NumCols(), C->Stride());
+      C_i.AddMatMat(alpha,
+                    SubMatrix<Real>(const_cast<Real*>(A.Data()) + i * a_offset,
+                                    A.NumRows(), A.NumCols(), A.Stride()),
+                    transA,
+                    SubMatrix<Real>(const_cast<Real*>(B.Data()) + i * b_offset,
+                                    B.NumRows(), B.NumCols(), B.Stride()),
+                    transB, beta);
+    }
+  }
+}
+
+template
+void AddMatMatStridedBatched(float alpha, CuMatrixBase<float> *C,
+                             MatrixIndexT c_offset,
+                             const CuMatrixBase<float> &A,
+                             MatrixIndexT a_offset, MatrixTransposeType transA,
+                             const CuMatrixBase<float> &B,
+                             MatrixIndexT b_offset, MatrixTransposeType transB,
+                             float beta, int32 batch_size);
+
+template
+void AddMatMatStridedBatched(double alpha, CuMatrixBase<double> *C,
+                             MatrixIndexT c_offset,
+                             const CuMatrixBase<double> &A,
+                             MatrixIndexT a_offset, MatrixTransposeType transA,
+                             const CuMatrixBase<double> &B,
+                             MatrixIndexT b_offset, MatrixTransposeType transB,
+                             double beta, int32 batch_size);
+
 template<typename Real>
 void CuMatrixBase<Real>::CopyRowsFromVec(const CuVectorBase<Real> &v) {
 #if HAVE_CUDA == 1
@@ -3062,6 +3246,35 @@ Real CuMatrixBase<Real>::Trace(bool check_square) const {
   }
 }
 
+template <typename Real>
+void CuMatrixBase<Real>::CopyFromMat(const CompressedMatrix &src) {
+  KALDI_ASSERT(src.NumRows() == num_rows_ && src.NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    typedef CompressedMatrix::GlobalHeader GlobalHeader;
+    const GlobalHeader *h = reinterpret_cast<const GlobalHeader*>(src.Data());
+    MatrixIndexT num_bytes = CompressedMatrix::DataSize(*h) -
+        sizeof(GlobalHeader);
+    void *data = CuDevice::Instantiate().Malloc(num_bytes);
+    CU_SAFE_CALL(cudaMemcpy(data, h + 1, num_bytes, cudaMemcpyHostToDevice));
+    dim3 dimGrid, dimBlock;
+    GetBlockSizesForSimpleMatrixOperation(NumRows(), NumCols(),
+                                          &dimGrid, &dimBlock);
+    cuda_copy_from_compressed(dimGrid, dimBlock, data_, Dim(),
+                              static_cast<const uint8_t*>(data), h->format,
+                              h->min_value, h->range);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().Free(data);
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+#endif
+  {
+    src.CopyToMat(&(Mat()));
+  }
+}
+
 template <typename Real>
 void CuMatrixBase<Real>::CopyFromGeneralMat(const GeneralMatrix &src,
                                             MatrixTransposeType trans) {
@@ -3072,9 +3285,13 @@ void CuMatrixBase<Real>::CopyFromGeneralMat(const GeneralMatrix &src,
       return;
     }
     case kCompressedMatrix: {
-      Matrix<BaseFloat> mat;
-      src.GetMatrix(&mat);
-      this->CopyFromMat(mat, trans);
+      if (trans == kNoTrans) {
+        this->CopyFromMat(src.GetCompressedMatrix());
+      } else {
+        Matrix<BaseFloat> mat;
+        src.GetMatrix(&mat);
+        this->CopyFromMat(mat, trans);
+      }
       return;
     }
     case kSparseMatrix: {
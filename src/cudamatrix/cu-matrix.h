@@ -58,6 +58,27 @@ void AddMatMatBatched(const Real alpha, std::vector<CuSubMatrix<Real>* > &C,
                       MatrixTransposeType transB,
                       const Real beta);
 
+/// Does "batch_size" matrix multiplications of the same dimensions, whose
+/// matrices are equally spaced in memory, with one call to cuBLAS's
+/// gemmStridedBatched if we are using a GPU; this avoids the per-call launch
+/// overhead of many small multiplications, and (unlike AddMatMatBatched())
+/// needs no arrays of pointers.  For each i < batch_size, it does
+///  C_i = alpha * A_i(^T) * B_i(^T) + beta * C_i,
+/// where C_i has the dimensions and stride of C but its data begins
+/// i * c_offset elements after that of C (and likewise for A_i and B_i).
+/// For example, for the blocks of a block-diagonal matrix, C could be the
+/// ColRange() of the first block and c_offset its number of columns.  The
+/// caller must make sure all the A_i, B_i and C_i are within their matrices,
+/// and that no two C_i overlap.
+template<typename Real>
+void AddMatMatStridedBatched(Real alpha, CuMatrixBase<Real> *C,
+                             MatrixIndexT c_offset,
+                             const CuMatrixBase<Real> &A,
+                             MatrixIndexT a_offset, MatrixTransposeType transA,
+                             const CuMatrixBase<Real> &B,
+                             MatrixIndexT b_offset, MatrixTransposeType transB,
+                             Real beta, int32 batch_size);
+
 /**
  * Matrix for CUDA computing.
  * Does the computation on the CUDA card when CUDA is compiled in and
@@ -240,6 +261,11 @@ class CuMatrixBase {
   void CopyFromGeneralMat(const GeneralMatrix &src,
                           MatrixTransposeType trans = kNoTrans);
 
+  /// Decompresses "src" (which must have the same dimension); when using the
+  /// GPU, the compressed data is copied to it and decompressed there, which
+  /// needs far less copying than decompressing it first.
+  void CopyFromMat(const CompressedMatrix &src);
+
   void CopyFromMat(const MatrixBase<Real> &src,
                    MatrixTransposeType trans = kNoTrans);
 
@@ -257,6 +283,22 @@ class CuMatrixBase {
   void CopyToMat(MatrixBase<OtherReal> *dst,
                  MatrixTransposeType trans = kNoTrans) const;
 
+  /// Like CopyFromMat(src), except that when using a GPU it does not wait for
+  /// the copy to the GPU: "src" is copied to pinned memory, and from there to
+  /// the GPU asynchronously, in order with the other work of this thread (so
+  /// *this can be used straight away, and "src" changed or freed).  It lets
+  /// the CPU get on with other work, e.g. preparing the next input, while the
+  /// data is copied.
+  void CopyFromMatAsync(const MatrixBase<Real> &src);
+
+  /// Like CopyToMat(dst), except that when using a GPU it only queues the
+  /// copy, via pinned memory: the data is in "dst" only after
+  /// FinishAsyncCopies() (see cu-device.h) is called from this thread, and
+  /// "dst" must not be used or freed until then.  This allows several copies
+  /// to be queued and waited for together, and the GPU to go on with the work
+  /// queued after them.
+  void CopyToMatAsync(MatrixBase<Real> *dst) const;
+
   /// This function has two modes of operation.  If v.Dim() == NumRows() *
   /// NumCols(), then treats the vector as a row-by-row concatenation of a
   /// matrix and copies to *this.
@@ -513,7 +555,8 @@ class CuMatrixBase {
   void AddVecToCols(Real alpha, const CuVectorBase<Real> &col, Real beta = 1.0);
   /// (for each row r of *this), r = alpha * row + beta * r
   void AddVecToRows(Real alpha, const CuVectorBase<Real> &row, Real beta = 1.0);
-  /// C = alpha * A(^T)*B(^T) + beta * C
+  /// C = alpha * A(^T)*B(^T) + beta * C.  For float on a GPU, the inputs may
+  /// be rounded to 16 bits (see GetGemmPrecision() in cu-device.h).
   void AddMatMat(Real alpha, const CuMatrixBase<Real> &A, MatrixTransposeType transA,
                  const CuMatrixBase<Real> &B, MatrixTransposeType transB, Real beta);
   /// A = alpha * x * y^T + A .
@@ -33,6 +33,7 @@
 #include "cudamatrix/cu-math.h"
 #include "cudamatrix/cu-packed-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/matrix-allocator.h"
 
 namespace kaldi {
 
@@ -91,7 +92,8 @@ void CuPackedMatrix<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    // the memory came from Matrix, Vector or PackedMatrix.
+    if (this->data_ != NULL) MatrixFree(this->data_);
   }
   this->data_ = NULL;
   this->num_rows_ = 0;
@@ -0,0 +1,77 @@
+// cudamatrix/cu-philox.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_PHILOX_H_
+#define KALDI_CUDAMATRIX_CU_PHILOX_H_
+
+// This file is included both by the C++ code and by the CUDA code, so that the
+// CPU and the GPU compute exactly the same random numbers.
+
+#include "cudamatrix/cu-matrixdim.h"
+
+#ifdef __CUDACC__
+#define KALDI_PHILOX_FUNC __host__ __device__ inline
+#else
+#define KALDI_PHILOX_FUNC inline
+#endif
+
+/**
+   The counter-based random number generator Philox4x32-10 (Salmon et al.,
+   "Parallel random numbers: as easy as 1, 2, 3", SC 2011): it maps a 128-bit
+   counter and a 64-bit key to four random 32-bit words, with no state in
+   between, so that the random number for an element of a matrix can be
+   computed (and computed again, later) from its position and the seed alone.
+   'ctr' is replaced by the output.
+*/
+KALDI_PHILOX_FUNC void Philox4x32(uint32_cuda key0, uint32_cuda key1,
+                                  uint32_cuda ctr[4]) {
+  for (int round = 0; round < 10; round++) {
+    unsigned long long p0 = 0xD2511F53ull * ctr[0],
+        p2 = 0xCD9E8D57ull * ctr[2];
+    uint32_cuda hi0 = static_cast<uint32_cuda>(p0 >> 32),
+        lo0 = static_cast<uint32_cuda>(p0),
+        hi2 = static_cast<uint32_cuda>(p2 >> 32),
+        lo2 = static_cast<uint32_cuda>(p2);
+    ctr[0] = hi2 ^ ctr[1] ^ key0;
+    ctr[1] = lo2;
+    ctr[2] = hi0 ^ ctr[3] ^ key1;
+    ctr[3] = lo0;
+    key0 += 0x9E3779B9u;
+    key1 += 0xBB67AE85u;
+  }
+}
+
+/// Returns true if element (row, col) of the dropout mask for the seed
+/// (key0, key1) is kept, i.e. with probability 1 - dropout_proportion.  Four
+/// consecutive columns come from the same call to Philox4x32(); if 'per_row',
+/// pass col = 0 to get the same value for the whole row.
+KALDI_PHILOX_FUNC bool PhiloxDropoutKeep(uint32_cuda key0, uint32_cuda key1,
+                                         int32_cuda row, int32_cuda col,
+                                         float dropout_proportion) {
+  uint32_cuda ctr[4] = { static_cast<uint32_cuda>(col) >> 2,
+                         static_cast<uint32_cuda>(row), 0, 0 };
+  Philox4x32(key0, key1, ctr);
+  // the top 24 bits give a float in [0, 1) exactly, on the CPU and the GPU.
+  float u = (ctr[col & 3] >> 8) * (1.0f / 16777216.0f);
+  return u >= dropout_proportion;
+}
+
+#undef KALDI_PHILOX_FUNC
+
+#endif  // KALDI_CUDAMATRIX_CU_PHILOX_H_
@@ -0,0 +1,127 @@
+// cudamatrix/cu-pinned-matrix.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cudamatrix/cu-pinned-matrix.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+CuPinnedMatrix::CuPinnedMatrix():
+    data_(NULL), num_rows_(0), num_cols_(0), stride_(0), pinned_(false) {
+#if HAVE_CUDA == 1
+  event_created_ = false;
+  copy_pending_ = false;
+#endif
+}
+
+CuPinnedMatrix::~CuPinnedMatrix() {
+  Destroy();
+#if HAVE_CUDA == 1
+  if (event_created_)
+    cudaEventDestroy(event_);  // no need to check the status here.
+#endif
+}
+
+void CuPinnedMatrix::Destroy() {
+  Wait();
+#if HAVE_CUDA == 1
+  if (pinned_)
+    CuDevice::Instantiate().FreePinned(data_);
+#endif
+  cpu_mat_.Resize(0, 0);
+  data_ = NULL;
+  num_rows_ = num_cols_ = stride_ = 0;
+  pinned_ = false;
+}
+
+void CuPinnedMatrix::Resize(MatrixIndexT num_rows, MatrixIndexT num_cols) {
+  KALDI_ASSERT(num_rows >= 0 && num_cols >= 0);
+  Destroy();
+  if (num_rows == 0 || num_cols == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    // the rows are contiguous, so that the copy of a block of rows is one
+    // contiguous region of the destination.
+    data_ = static_cast<BaseFloat*>(CuDevice::Instantiate().MallocPinned(
+        static_cast<size_t>(num_rows) * num_cols * sizeof(BaseFloat)));
+    stride_ = num_cols;
+    pinned_ = true;
+  } else
+#endif
+  {
+    cpu_mat_.Resize(num_rows, num_cols, kUndefined);
+    data_ = cpu_mat_.Data();
+    stride_ = cpu_mat_.Stride();
+  }
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+}
+
+void CuPinnedMatrix::CopyRowsFromCuMatAsync(const CuMatrixBase<BaseFloat> &src,
+                                            MatrixIndexT row_offset) {
+  KALDI_ASSERT(src.NumCols() == num_cols_ && row_offset >= 0 &&
+               row_offset + src.NumRows() <= num_rows_);
+  if (src.NumRows() == 0) return;
+#if HAVE_CUDA == 1
+  if (pinned_) {
+    CuTimer tim;
+    MatrixIndexT row_bytes = num_cols_ * sizeof(BaseFloat);
+    CU_SAFE_CALL(cudaMemcpy2DAsync(data_ + static_cast<size_t>(row_offset) *
+                                   stride_, stride_ * sizeof(BaseFloat),
+                                   src.Data(), src.Stride() * sizeof(BaseFloat),
+                                   row_bytes, src.NumRows(),
+                                   cudaMemcpyDeviceToHost,
+                                   cudaStreamPerThread));
+    if (!event_created_) {
+      CU_SAFE_CALL(cudaEventCreateWithFlags(&event_, cudaEventDisableTiming));
+      event_created_ = true;
+    }
+    CU_SAFE_CALL(cudaEventRecord(event_, cudaStreamPerThread));
+    copy_pending_ = true;
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+    return;
+  }
+#endif
+  SubMatrix<BaseFloat>(data_ + static_cast<size_t>(row_offset) * stride_,
+                       src.NumRows(), num_cols_, stride_).CopyFromMat(src);
+}
+
+void CuPinnedMatrix::Wait() {
+#if HAVE_CUDA == 1
+  if (copy_pending_) {
+    CU_SAFE_CALL(cudaEventSynchronize(event_));
+    copy_pending_ = false;
+  }
+#endif
+}
+
+bool CuPinnedMatrix::Ready() {
+#if HAVE_CUDA == 1
+  if (copy_pending_) {
+    cudaError_t e = cudaEventQuery(event_);
+    if (e == cudaErrorNotReady) return false;
+    CU_SAFE_CALL(e);
+    copy_pending_ = false;
+  }
+#endif
+  return true;
+}
+
+}  // namespace kaldi
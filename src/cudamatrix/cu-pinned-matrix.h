@@ -0,0 +1,96 @@
+// cudamatrix/cu-pinned-matrix.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_PINNED_MATRIX_H_
+#define KALDI_CUDAMATRIX_CU_PINNED_MATRIX_H_
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include "cudamatrix/cu-matrix.h"
+
+namespace kaldi {
+
+/**
+   CuPinnedMatrix is a matrix in host memory that the GPU writes into with
+   asynchronous copies.  When a GPU is used its memory is pinned (page-locked),
+   so the GPU copies straight into it, without the staging buffer and the
+   second copy of CuMatrixBase::CopyToMatAsync(), and the thread that queues
+   the copies does not wait for them: whoever reads the matrix calls Wait()
+   first, which waits only for the copies into this matrix.  Without a GPU
+   the copies are done straight away.
+
+   Wait() may be called from a different thread from the one that queued the
+   copies, as long as something (e.g. a Semaphore) makes sure it is called
+   after them.
+*/
+class CuPinnedMatrix {
+ public:
+  CuPinnedMatrix();
+
+  /// Waits for any copies still pending before freeing the memory.
+  ~CuPinnedMatrix();
+
+  /// Resizes the matrix; the contents are undefined.  Waits for any copies
+  /// still pending.
+  void Resize(MatrixIndexT num_rows, MatrixIndexT num_cols);
+
+  /// Queues the copy of "src" to rows row_offset ... row_offset +
+  /// src.NumRows() - 1 of *this, on the stream of the calling thread (so
+  /// after the work queued so far that computes "src").
+  void CopyRowsFromCuMatAsync(const CuMatrixBase<BaseFloat> &src,
+                              MatrixIndexT row_offset);
+
+  /// Waits until the copies queued so far have completed.
+  void Wait();
+
+  /// Returns true if the copies queued so far have completed, without
+  /// waiting.
+  bool Ready();
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// Returns the matrix; call Wait() before reading it.
+  SubMatrix<BaseFloat> Mat() {
+    return SubMatrix<BaseFloat>(data_, num_rows_, num_cols_, stride_);
+  }
+
+ private:
+  void Destroy();
+
+  BaseFloat *data_;
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  MatrixIndexT stride_;
+  bool pinned_;  // true if data_ is from CuDevice::MallocPinned().
+  Matrix<BaseFloat> cpu_mat_;  // the memory, if not pinned.
+#if HAVE_CUDA == 1
+  cudaEvent_t event_;  // recorded after the last copy queued.
+  bool event_created_;
+  bool copy_pending_;
+#endif
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuPinnedMatrix);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_PINNED_MATRIX_H_
@@ -38,6 +38,7 @@
 #include "cudamatrix/cu-sp-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/matrix-allocator.h"
 
 namespace kaldi {
 
@@ -1037,7 +1038,8 @@ void CuVector<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    // the memory came from Matrix, Vector or PackedMatrix.
+    if (this->data_ != NULL) MatrixFree(this->data_);
   }
   this->data_ = NULL;
   this->dim_ = 0;
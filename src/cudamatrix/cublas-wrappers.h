@@ -63,6 +63,43 @@ inline cublasStatus_t cublas_gemmBatched(
     double *C[], int ldc, int batchCount) {
   return cublasDgemmBatched(handle, transa, transb, m, n, k, &alpha, A, lda, B, ldb, &beta, C, ldc, batchCount);
 }
+// cublasXgemmStridedBatched() was added in CUDA 8; before it, we loop.
+inline cublasStatus_t cublas_gemmStridedBatched(
+    cublasHandle_t handle, cublasOperation_t transa,
+    cublasOperation_t transb, int m, int n, int k, float alpha,
+    const float *A, int lda, long long strideA, const float *B, int ldb,
+    long long strideB, float beta, float *C, int ldc, long long strideC,
+    int batchCount) {
+#if CUDA_VERSION >= 8000
+  return cublasSgemmStridedBatched(handle, transa, transb, m, n, k, &alpha,
+                                   A, lda, strideA, B, ldb, strideB, &beta,
+                                   C, ldc, strideC, batchCount);
+#else
+  cublasStatus_t ans = CUBLAS_STATUS_SUCCESS;
+  for (int i = 0; i < batchCount && ans == CUBLAS_STATUS_SUCCESS; i++)
+    ans = cublas_gemm(handle, transa, transb, m, n, k, alpha, A + i * strideA,
+                      lda, B + i * strideB, ldb, beta, C + i * strideC, ldc);
+  return ans;
+#endif
+}
+inline cublasStatus_t cublas_gemmStridedBatched(
+    cublasHandle_t handle, cublasOperation_t transa,
+    cublasOperation_t transb, int m, int n, int k, double alpha,
+    const double *A, int lda, long long strideA, const double *B, int ldb,
+    long long strideB, double beta, double *C, int ldc, long long strideC,
+    int batchCount) {
+#if CUDA_VERSION >= 8000
+  return cublasDgemmStridedBatched(handle, transa, transb, m, n, k, &alpha,
+                                   A, lda, strideA, B, ldb, strideB, &beta,
+                                   C, ldc, strideC, batchCount);
+#else
+  cublasStatus_t ans = CUBLAS_STATUS_SUCCESS;
+  for (int i = 0; i < batchCount && ans == CUBLAS_STATUS_SUCCESS; i++)
+    ans = cublas_gemm(handle, transa, transb, m, n, k, alpha, A + i * strideA,
+                      lda, B + i * strideB, ldb, beta, C + i * strideC, ldc);
+  return ans;
+#endif
+}
 inline cublasStatus_t cublas_trsm(cublasHandle_t handle, int m, int n,
                                   float alpha, const float* A, int lda,
                                   float* B, int ldb) {
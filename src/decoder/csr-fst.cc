@@ -0,0 +1,281 @@
+// decoder/csr-fst.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/csr-fst.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util/kaldi-io.h"
+#include "fstext/kaldi-fst-io.h"
+
+namespace kaldi {
+
+// Image layout, native byte order:
+//   CsrFstHeader
+//   int32 arc_offsets[num_states + 1]
+//   int32 emitting_offsets[num_states]
+//   BaseFloat final_costs[num_states]
+//   fst::StdArc arcs[num_arcs]
+static const char kCsrFstMagic[8] = {'K', 'C', 'S', 'R', 'F', 'S', 'T', '1'};
+static const uint32 kCsrFstByteOrder = 0x01020304;
+
+struct CsrFstHeader {
+  char magic[8];
+  uint32 byte_order;
+  int32 num_states;
+  int32 num_arcs;
+  int32 start;
+  int32 arc_size;  // sizeof(fst::StdArc) of the writer
+  int32 reserved;
+};
+
+template<typename T>
+static void AppendToImage(const std::vector<T> &v, std::string *image) {
+  if (!v.empty())
+    image->append(reinterpret_cast<const char*>(&v[0]), v.size() * sizeof(T));
+}
+
+CsrFst::CsrFst(): image_(NULL), image_size_(0), image_mapped_(false) {
+  Destroy();
+}
+
+CsrFst::CsrFst(const fst::Fst<fst::StdArc> &fst):
+    image_(NULL), image_size_(0), image_mapped_(false) {
+  Destroy();
+  Init(fst);
+  image_ = image_buffer_.data();
+  image_size_ = image_buffer_.size();
+  if (!SetArrays())
+    KALDI_ERR << "Could not make the graph in CSR form";  // Shouldn't happen.
+}
+
+CsrFst::~CsrFst() {
+  Destroy();
+}
+
+void CsrFst::Init(const fst::Fst<fst::StdArc> &fst) {
+  if (fst.Start() == fst::kNoStateId)
+    KALDI_ERR << "The decoding graph has no start state";
+  StateId num_states = fst::CountStates(fst);
+
+  // number the states breadth-first from the start state.
+  std::vector<StateId> order, new_state(num_states, -1);
+  order.reserve(num_states);
+  new_state[fst.Start()] = 0;
+  order.push_back(fst.Start());
+  int32 num_arcs = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    for (fst::ArcIterator<fst::Fst<fst::StdArc> > aiter(fst, order[i]);
+         !aiter.Done(); aiter.Next()) {
+      StateId nextstate = aiter.Value().nextstate;
+      if (nextstate < 0 || nextstate >= num_states)
+        KALDI_ERR << "The states of the decoding graph are not numbered "
+                  << "contiguously from zero";
+      if (new_state[nextstate] < 0) {
+        new_state[nextstate] = order.size();
+        order.push_back(nextstate);
+      }
+      num_arcs++;
+    }
+  }
+  int32 num_accessible = order.size();
+  for (StateId s = 0; s < num_states; s++) {
+    if (new_state[s] < 0) {
+      new_state[s] = order.size();
+      order.push_back(s);
+      num_arcs += fst.NumArcs(s);
+    }
+  }
+
+  std::vector<int32> arc_offsets(num_states + 1), emitting_offsets(num_states);
+  std::vector<BaseFloat> final_costs(num_states);
+  std::vector<fst::StdArc> arcs;
+  arcs.reserve(num_arcs);
+  for (StateId s = 0; s < num_states; s++) {
+    StateId old_state = order[s];
+    arc_offsets[s] = arcs.size();
+    final_costs[s] = fst.Final(old_state).Value();
+    // the non-emitting arcs, then the emitting ones.
+    for (int32 pass = 0; pass < 2; pass++) {
+      if (pass == 1)
+        emitting_offsets[s] = arcs.size();
+      for (fst::ArcIterator<fst::Fst<fst::StdArc> > aiter(fst, old_state);
+           !aiter.Done(); aiter.Next()) {
+        fst::StdArc arc = aiter.Value();
+        if ((arc.ilabel != 0) != (pass == 1))
+          continue;
+        if (arc.nextstate < 0 || arc.nextstate >= num_states)
+          KALDI_ERR << "The states of the decoding graph are not numbered "
+                    << "contiguously from zero";
+        arc.nextstate = new_state[arc.nextstate];
+        arcs.push_back(arc);
+      }
+    }
+  }
+  arc_offsets[num_states] = arcs.size();
+
+  CsrFstHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kCsrFstMagic, sizeof(kCsrFstMagic));
+  header.byte_order = kCsrFstByteOrder;
+  header.num_states = num_states;
+  header.num_arcs = arcs.size();
+  header.start = 0;
+  header.arc_size = sizeof(fst::StdArc);
+  image_buffer_.clear();
+  image_buffer_.reserve(sizeof(header) +
+                        (3 * num_states + 1) * sizeof(int32) +
+                        arcs.size() * sizeof(fst::StdArc));
+  image_buffer_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  AppendToImage(arc_offsets, &image_buffer_);
+  AppendToImage(emitting_offsets, &image_buffer_);
+  AppendToImage(final_costs, &image_buffer_);
+  AppendToImage(arcs, &image_buffer_);
+  KALDI_VLOG(1) << "Graph has " << num_states << " states ("
+                << (num_states - num_accessible) << " not accessible) and "
+                << arcs.size() << " arcs";
+}
+
+bool CsrFst::SetArrays() {
+  const CsrFstHeader *header = reinterpret_cast<const CsrFstHeader*>(image_);
+  bool valid = image_size_ >= sizeof(CsrFstHeader) &&
+      !memcmp(header->magic, kCsrFstMagic, sizeof(kCsrFstMagic)) &&
+      header->byte_order == kCsrFstByteOrder &&
+      header->arc_size == sizeof(fst::StdArc) &&
+      header->num_states > 0 && header->num_arcs >= 0 &&
+      header->start >= 0 && header->start < header->num_states;
+  if (!valid) return false;
+  size_t num_states = header->num_states, num_arcs = header->num_arcs;
+  if (image_size_ != sizeof(CsrFstHeader) +
+      (num_states + 1 + num_states) * sizeof(int32) +
+      num_states * sizeof(BaseFloat) + num_arcs * sizeof(fst::StdArc))
+    return false;
+  num_states_ = header->num_states;
+  num_arcs_ = header->num_arcs;
+  start_ = header->start;
+  arc_offsets_ = reinterpret_cast<const int32*>(image_ + sizeof(CsrFstHeader));
+  emitting_offsets_ = arc_offsets_ + num_states + 1;
+  final_costs_ = reinterpret_cast<const BaseFloat*>(emitting_offsets_ +
+                                                    num_states);
+  arcs_ = reinterpret_cast<const fst::StdArc*>(final_costs_ + num_states);
+  valid = arc_offsets_[0] == 0 && arc_offsets_[num_states_] == num_arcs_;
+#ifdef KALDI_PARANOID
+  // checking every state and arc would read all of a mapped graph, so it is
+  // only done when paranoid.
+  for (int32 s = 0; valid && s < num_states_; s++)
+    valid = arc_offsets_[s] <= emitting_offsets_[s] &&
+        emitting_offsets_[s] <= arc_offsets_[s + 1];
+  for (int32 a = 0; valid && a < num_arcs_; a++)
+    valid = arcs_[a].nextstate >= 0 && arcs_[a].nextstate < num_states_;
+#endif
+  return valid;
+}
+
+void CsrFst::Destroy() {
+#ifndef _MSC_VER
+  if (image_mapped_)
+    munmap(const_cast<char*>(image_), image_size_);
+#endif
+  image_ = NULL;
+  image_size_ = 0;
+  image_mapped_ = false;
+  image_buffer_.clear();
+  num_states_ = num_arcs_ = 0;
+  start_ = fst::kNoStateId;
+  arc_offsets_ = emitting_offsets_ = NULL;
+  final_costs_ = NULL;
+  arcs_ = NULL;
+}
+
+void CsrFst::Write(std::ostream &os, bool binary) const {
+  if (!binary)
+    KALDI_ERR << "CsrFst::Write only supports binary mode.";
+  if (image_ == NULL)
+    KALDI_ERR << "Writing an empty CsrFst";
+  os.write(image_, image_size_);
+  if (!os.good())
+    KALDI_ERR << "Error writing the graph in CSR form";
+}
+
+void CsrFst::Read(const std::string &rxfilename) {
+  Destroy();
+#ifndef _MSC_VER
+  if (ClassifyRxfilename(rxfilename) == kFileInput) {
+    int fd = open(rxfilename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+          image_ = static_cast<const char*>(addr);
+          image_size_ = st.st_size;
+          image_mapped_ = true;
+        }
+      }
+      close(fd);
+    }
+  }
+#endif
+  if (!image_) {
+    Input ki(rxfilename);
+    std::ostringstream buf;
+    buf << ki.Stream().rdbuf();
+    image_buffer_ = buf.str();
+    image_ = image_buffer_.data();
+    image_size_ = image_buffer_.size();
+  }
+  if (!SetArrays()) {
+    Destroy();
+    KALDI_ERR << "Not a valid graph in CSR form: "
+              << PrintableRxfilename(rxfilename);
+  }
+  KALDI_VLOG(1) << "Read graph with " << num_states_ << " states and "
+                << num_arcs_ << " arcs" << (image_mapped_ ? " (mapped)" : "");
+}
+
+bool CsrFst::IsCsrFstFile(const std::string &rxfilename) {
+  if (ClassifyRxfilename(rxfilename) != kFileInput)
+    return false;
+  std::ifstream is(rxfilename.c_str(), std::ios::binary);
+  char magic[sizeof(kCsrFstMagic)];
+  is.read(magic, sizeof(magic));
+  return is.good() && !memcmp(magic, kCsrFstMagic, sizeof(kCsrFstMagic));
+}
+
+CsrFst *ReadCsrFstGeneric(const std::string &rxfilename) {
+  CsrFst *ans = NULL;
+  if (CsrFst::IsCsrFstFile(rxfilename)) {
+    ans = new CsrFst();
+    ans->Read(rxfilename);
+  } else {
+    fst::Fst<fst::StdArc> *fst = fst::ReadFstKaldiGeneric(rxfilename);
+    ans = new CsrFst(*fst);
+    delete fst;
+  }
+  return ans;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,167 @@
+// decoder/csr-fst.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_CSR_FST_H_
+#define KALDI_DECODER_CSR_FST_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fst/fstlib.h"
+
+namespace kaldi {
+class CsrFst;
+}
+
+namespace fst {
+template<> class ArcIterator<kaldi::CsrFst>;
+}
+
+namespace kaldi {
+
+/**
+   An immutable decoding graph flattened into arrays in compressed sparse row
+   (CSR) form: the arcs of state s are [ArcsBegin(s), ArcsEnd(s)) of one array
+   of (ilabel, olabel, weight, nextstate) arcs.  Of the arcs of a state, those
+   with ilabel 0 come first, so that the emitting arcs are
+   [EmittingArcsBegin(s), ArcsEnd(s)) and each pass of a decoder reads just the
+   arcs it needs.  The states are numbered in breadth-first order from the
+   start state (which is state 0), so that the states that are active together
+   are mostly near each other in memory.
+
+   The graph is written as an image of its arrays, with Write(), and Read()
+   maps it into memory where it can, so that processes decoding with the same
+   graph share its pages; see make-csr-fst.  It has the parts of the interface
+   of fst::Fst that the decoders use (Start(), Final(), NumInputEpsilons(),
+   Type() and fst::ArcIterator<CsrFst>), so LatticeFasterDecoderTpl and
+   LatticeFasterOnlineDecoderTpl are instantiated for it.
+*/
+class CsrFst {
+ public:
+  typedef fst::StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+  typedef Arc::Label Label;
+
+  /// An empty graph, for Read().
+  CsrFst();
+
+  /// The states of fst must be numbered 0 .. n - 1, as they are for a
+  /// VectorFst or ConstFst.  They are numbered breadth-first here; the states
+  /// not accessible from the start state come last.
+  explicit CsrFst(const fst::Fst<fst::StdArc> &fst);
+
+  ~CsrFst();
+
+  /// Writes the image of the graph; binary only.
+  void Write(std::ostream &os, bool binary) const;
+
+  /// Reads a graph written by Write().  If rxfilename is a file it is mapped
+  /// into memory, else (or if mapping fails) it is read into a buffer.
+  void Read(const std::string &rxfilename);
+
+  /// True if rxfilename is a file that starts as Write() writes.
+  static bool IsCsrFstFile(const std::string &rxfilename);
+
+  StateId Start() const { return start_; }
+  StateId NumStates() const { return num_states_; }
+  int32 NumArcs() const { return num_arcs_; }
+
+  Weight Final(StateId state) const { return Weight(final_costs_[state]); }
+  /// infinity for a state that is not final
+  BaseFloat FinalCost(StateId state) const { return final_costs_[state]; }
+
+  size_t NumArcs(StateId state) const {
+    return arc_offsets_[state + 1] - arc_offsets_[state];
+  }
+  size_t NumInputEpsilons(StateId state) const {
+    return emitting_offsets_[state] - arc_offsets_[state];
+  }
+
+  std::string Type() const { return "csr"; }
+
+  // The arcs of a state are [ArcsBegin(), ArcsEnd()) of the arcs, the
+  // non-emitting ones before EmittingArcsBegin().
+  int32 ArcsBegin(StateId state) const { return arc_offsets_[state]; }
+  int32 EmittingArcsBegin(StateId state) const {
+    return emitting_offsets_[state];
+  }
+  int32 ArcsEnd(StateId state) const { return arc_offsets_[state + 1]; }
+  const Arc &GetArc(int32 arc) const { return arcs_[arc]; }
+  const Arc *Arcs() const { return arcs_; }
+
+ private:
+  // Makes image_buffer_ the image of the graph.
+  void Init(const fst::Fst<fst::StdArc> &fst);
+
+  // Points the arrays into image_; false if it is not a valid image.
+  bool SetArrays();
+
+  void Destroy();
+
+  // The image of the graph, in image_buffer_ or mapped from a file.
+  const char *image_;
+  size_t image_size_;
+  bool image_mapped_;
+  std::string image_buffer_;
+
+  // These point into image_.
+  int32 num_states_;
+  int32 num_arcs_;
+  int32 start_;
+  const int32 *arc_offsets_;       // dim is num_states_ + 1
+  const int32 *emitting_offsets_;  // dim is num_states_
+  const BaseFloat *final_costs_;   // dim is num_states_
+  const Arc *arcs_;                // dim is num_arcs_
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CsrFst);
+};
+
+/// Reads a graph as CsrFst: one written by make-csr-fst is mapped, any other
+/// FST is read with fst::ReadFstKaldiGeneric() and converted.  Graphs read
+/// from a pipe or an offset are taken to be FSTs.
+CsrFst *ReadCsrFstGeneric(const std::string &rxfilename);
+
+}  // namespace kaldi
+
+namespace fst {
+
+template<>
+class ArcIterator<kaldi::CsrFst> {
+ public:
+  typedef kaldi::CsrFst::Arc Arc;
+  typedef kaldi::CsrFst::StateId StateId;
+
+  ArcIterator(const kaldi::CsrFst &fst, StateId s):
+      arc_(fst.Arcs() + fst.ArcsBegin(s)),
+      end_(fst.Arcs() + fst.ArcsEnd(s)) { }
+
+  bool Done() const { return arc_ == end_; }
+  const Arc &Value() const { return *arc_; }
+  void Next() { ++arc_; }
+
+ private:
+  const Arc *arc_;
+  const Arc *end_;
+};
+
+}  // namespace fst
+
+#endif  // KALDI_DECODER_CSR_FST_H_
@@ -26,7 +26,7 @@ DecodableMatrixMapped::DecodableMatrixMapped(
     const MatrixBase<BaseFloat> &likes,
     int32 frame_offset):
     trans_model_(tm), likes_(&likes), likes_to_delete_(NULL),
-    frame_offset_(frame_offset) {
+    frame_offset_(frame_offset), prefetched_frame_(-1) {
   stride_ = likes.Stride();
   raw_data_ = likes.Data() - (stride_ * frame_offset);
 
@@ -40,7 +40,7 @@ DecodableMatrixMapped::DecodableMatrixMapped(
     const TransitionModel &tm, const Matrix<BaseFloat> *likes,
     int32 frame_offset):
     trans_model_(tm), likes_(likes), likes_to_delete_(likes),
-    frame_offset_(frame_offset) {
+    frame_offset_(frame_offset), prefetched_frame_(-1) {
   stride_ = likes->Stride();
   raw_data_ = likes->Data() - (stride_ * frame_offset_);
   if (likes->NumCols() != tm.NumPdfs())
@@ -50,7 +50,19 @@ DecodableMatrixMapped::DecodableMatrixMapped(
 }
 
 
+void DecodableMatrixMapped::PrefetchFrame(int32 frame) {
+  prefetched_frame_.store(frame, std::memory_order_relaxed);
+#ifdef __GNUC__
+  const char *row = reinterpret_cast<const char*>(raw_data_ + frame * stride_),
+      *end = row + likes_->NumCols() * sizeof(BaseFloat);
+  for (; row < end; row += 64)  // 64 bytes is the usual cache-line size.
+    __builtin_prefetch(row);
+#endif
+}
+
 BaseFloat DecodableMatrixMapped::LogLikelihood(int32 frame, int32 tid) {
+  if (frame != prefetched_frame_.load(std::memory_order_relaxed))
+    PrefetchFrame(frame);
   int32 pdf_id = trans_model_.TransitionIdToPdfFast(tid);
 #ifdef KALDI_PARANOID
   return (*likes_)(frame - frame_offset_, pdf_id);
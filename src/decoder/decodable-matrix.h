@@ -21,6 +21,7 @@
 #ifndef KALDI_DECODER_DECODABLE_MATRIX_H_
 #define KALDI_DECODER_DECODABLE_MATRIX_H_
 
+#include <atomic>
 #include <vector>
 
 #include "base/kaldi-common.h"
@@ -72,6 +73,9 @@ class DecodableMatrixScaledMapped: public DecodableInterface {
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  // LogLikelihood() only reads from the matrix.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   virtual ~DecodableMatrixScaledMapped() {
     if (delete_likes_) delete likes_;
   }
@@ -119,6 +123,9 @@ class DecodableMatrixMapped: public DecodableInterface {
   // Note: these indices are 1-based.
   virtual int32 NumIndices() const;
 
+  // LogLikelihood() only reads from the matrix (prefetched_frame_ is atomic).
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   virtual ~DecodableMatrixMapped();
 
  private:
@@ -132,6 +139,14 @@ class DecodableMatrixMapped: public DecodableInterface {
   const BaseFloat *raw_data_;
   int32 stride_;
 
+  // Prefetches the row of 'frame' into the processor's cache.  The decoder
+  // reads a few scattered elements of it for each active token, and the row
+  // is often not in the cache (e.g. when the GPU has just written it).
+  void PrefetchFrame(int32 frame);
+  // The last frame PrefetchFrame() was called for.  It is atomic as the
+  // decoder may call LogLikelihood() from several threads.
+  std::atomic<int32> prefetched_frame_;
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableMatrixMapped);
 };
 
@@ -191,6 +206,9 @@ class DecodableMatrixMappedOffset: public DecodableInterface {
 
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  // LogLikelihood() only reads from the matrix.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   // nothing special to do in destructor.
   virtual ~DecodableMatrixMappedOffset() { }
  private:
@@ -237,6 +255,9 @@ class DecodableMatrixScaled: public DecodableInterface {
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() const { return likes_.NumCols(); }
 
+  // LogLikelihood() only reads from the matrix.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
  private:
   const Matrix<BaseFloat> &likes_;
   BaseFloat scale_;
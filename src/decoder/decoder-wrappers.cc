@@ -20,6 +20,7 @@
 #include "decoder/decoder-wrappers.h"
 #include "decoder/faster-decoder.h"
 #include "decoder/lattice-faster-decoder.h"
+#include "decoder/lattice-batch-decoder.h"
 #include "decoder/grammar-fst.h"
 #include "lat/lattice-functions.h"
 
@@ -182,6 +183,9 @@ DecodeUtteranceLatticeFasterClass::~DecodeUtteranceLatticeFasterClass() {
               << num_frames << " frames.";
     KALDI_VLOG(2) << "Cost for utterance " << utt_ << " is "
                   << weight.Value1() << " + " << weight.Value2();
+    const LatticeFasterDecoderConfig &config = decoder_->GetOptions();
+    if (config.target_rtf > 0.0)
+      decoder_->RtfStats().Print(utt_, config.rtf_frame_shift);
 
     // Now output the various diagnostic variables.
     if (like_sum_ != NULL) *like_sum_ += likelihood;
@@ -196,11 +200,15 @@ DecodeUtteranceLatticeFasterClass::~DecodeUtteranceLatticeFasterClass() {
 }
 
 
-// Takes care of output.  Returns true on success.
-template <typename FST>
-bool DecodeUtteranceLatticeFaster(
-    LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
-    DecodableInterface &decodable, // not const but is really an input.
+// Takes care of the output of an utterance that has been decoded, for
+// DecodeUtteranceLatticeFaster() and DecodeUtteranceLatticeBatch().  Decoder
+// needs ReachedFinal(), GetBestPath(), GetRawLattice() and GetOptions() as in
+// LatticeFasterDecoderTpl.  If determinizer is non-NULL and determinize ==
+// true, the lattice is the one it has determinized as the utterance was
+// decoded.  Returns true on success.
+template <typename Decoder>
+static bool OutputDecodedUtterance(
+    const Decoder &decoder,
     const TransitionModel &trans_model,
     const fst::SymbolTable *word_syms,
     std::string utt,
@@ -211,13 +219,10 @@ bool DecodeUtteranceLatticeFaster(
     Int32VectorWriter *words_writer,
     CompactLatticeWriter *compact_lattice_writer,
     LatticeWriter *lattice_writer,
-    double *like_ptr) { // puts utterance's like in like_ptr on success.
+    double *like_ptr,  // puts utterance's like in like_ptr on success.
+    LatticeIncrementalDeterminizer *determinizer = NULL) {
   using fst::VectorFst;
 
-  if (!decoder.Decode(&decodable)) {
-    KALDI_WARN << "Failed to decode file " << utt;
-    return false;
-  }
   if (!decoder.ReachedFinal()) {
     if (allow_partial) {
       KALDI_WARN << "Outputting partial output for utterance " << utt
@@ -260,31 +265,46 @@ bool DecodeUtteranceLatticeFaster(
     likelihood = -(weight.Value1() + weight.Value2());
   }
 
-  // Get lattice, and do determinization if requested.
-  Lattice lat;
-  decoder.GetRawLattice(&lat);
-  if (lat.NumStates() == 0)
-    KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
-  fst::Connect(&lat);
-  if (determinize) {
+  if (determinizer != NULL && determinize) {
     CompactLattice clat;
-    if (!DeterminizeLatticePhonePrunedWrapper(
-            trans_model,
-            &lat,
-            decoder.GetOptions().lattice_beam,
-            &clat,
-            decoder.GetOptions().det_opts))
+    if (!determinizer->GetLattice(&clat))
       KALDI_WARN << "Determinization finished earlier than the beam for "
                  << "utterance " << utt;
+    if (clat.NumStates() == 0)
+      KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
     // We'll write the lattice without acoustic scaling.
     if (acoustic_scale != 0.0)
       fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale), &clat);
     compact_lattice_writer->Write(utt, clat);
   } else {
-    // We'll write the lattice without acoustic scaling.
-    if (acoustic_scale != 0.0)
-      fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale), &lat);
-    lattice_writer->Write(utt, lat);
+    // Get lattice, and do determinization if requested.
+    Lattice lat;
+    decoder.GetRawLattice(&lat);
+    if (lat.NumStates() == 0)
+      KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
+    fst::Connect(&lat);
+    if (determinize) {
+      CompactLattice clat;
+      if (!DeterminizeLatticePhonePrunedWrapper(
+              trans_model,
+              &lat,
+              decoder.GetOptions().lattice_beam,
+              &clat,
+              decoder.GetOptions().det_opts))
+        KALDI_WARN << "Determinization finished earlier than the beam for "
+                   << "utterance " << utt;
+      // We'll write the lattice without acoustic scaling.
+      if (acoustic_scale != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale),
+                          &clat);
+      compact_lattice_writer->Write(utt, clat);
+    } else {
+      // We'll write the lattice without acoustic scaling.
+      if (acoustic_scale != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale),
+                          &lat);
+      lattice_writer->Write(utt, lat);
+    }
   }
   KALDI_LOG << "Log-like per frame for utterance " << utt << " is "
             << (likelihood / num_frames) << " over "
@@ -295,7 +315,168 @@ bool DecodeUtteranceLatticeFaster(
   return true;
 }
 
-// Instantiate the template above for the two required FST types.
+// Takes care of output.  Returns true on success.
+template <typename FST>
+bool DecodeUtteranceLatticeFaster(
+    LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *like_ptr) { // puts utterance's like in like_ptr on success.
+  if (!decoder.Decode(&decodable)) {
+    KALDI_WARN << "Failed to decode file " << utt;
+    return false;
+  }
+  const LatticeFasterDecoderConfig &config = decoder.GetOptions();
+  if (config.target_rtf > 0.0)
+    decoder.RtfStats().Print(utt, config.rtf_frame_shift);
+  return OutputDecodedUtterance(decoder, trans_model, word_syms, utt,
+                                acoustic_scale, determinize, allow_partial,
+                                alignment_writer, words_writer,
+                                compact_lattice_writer, lattice_writer,
+                                like_ptr);
+}
+
+template <typename FST>
+bool DecodeUtteranceLatticeIncremental(
+    LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
+    LatticeIncrementalDeterminizer &determinizer,
+    DecodableInterface &decodable, // not const but is really an input.
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    double *like_ptr) { // puts utterance's like in like_ptr on success.
+  const LatticeIncrementalDeterminizerConfig &config = determinizer.Config();
+  KALDI_ASSERT(config.chunk_size > 0);
+  decoder.InitDecoding();
+  determinizer.Init();
+  RawLatticeChunk chunk;
+  // each chunk is taken once the decoder is config.determinize_delay frames
+  // past its end, so that its tokens have been pruned.
+  int32 chunk_end = config.chunk_size;
+  while (true) {
+    int32 num_frames_wanted = chunk_end + config.determinize_delay -
+        decoder.NumFramesDecoded();
+    decoder.AdvanceDecoding(&decodable, num_frames_wanted);
+    if (decoder.NumFramesDecoded() < chunk_end + config.determinize_delay)
+      break;  // reached the end of the utterance.
+    if (!decoder.GetRawLatticeChunk(chunk_end, false, &chunk)) {
+      KALDI_WARN << "Failed to decode file " << utt;
+      return false;
+    }
+    determinizer.AcceptChunk(&chunk);
+    chunk_end += config.chunk_size;
+  }
+  decoder.FinalizeDecoding();
+  if (decoder.NumFramesDecoded() == 0 ||
+      !decoder.GetRawLatticeChunk(decoder.NumFramesDecoded(), true, &chunk)) {
+    KALDI_WARN << "Failed to decode file " << utt;
+    determinizer.Init();  // waits for any chunk being determinized.
+    return false;
+  }
+  determinizer.AcceptChunk(&chunk);
+  return OutputDecodedUtterance(decoder, trans_model, word_syms, utt,
+                                acoustic_scale, true, allow_partial,
+                                alignment_writer, words_writer,
+                                compact_lattice_writer, NULL, like_ptr,
+                                &determinizer);
+}
+
+// One lane of a LatticeBatchDecoder, with the interface that
+// OutputDecodedUtterance() needs.
+class LatticeBatchDecoderLane {
+ public:
+  LatticeBatchDecoderLane(const LatticeBatchDecoder &decoder, int32 lane):
+      decoder_(decoder), lane_(lane) { }
+  bool ReachedFinal() const { return decoder_.ReachedFinal(lane_); }
+  bool GetBestPath(Lattice *ofst) const {
+    return decoder_.GetBestPath(lane_, ofst);
+  }
+  bool GetRawLattice(Lattice *ofst) const {
+    return decoder_.GetRawLattice(lane_, ofst);
+  }
+  const LatticeFasterDecoderConfig &GetOptions() const {
+    return decoder_.GetOptions();
+  }
+ private:
+  const LatticeBatchDecoder &decoder_;
+  int32 lane_;
+};
+
+int32 DecodeUtteranceLatticeBatch(
+    LatticeBatchDecoder &decoder,
+    const std::vector<DecodableInterface*> &decodables,
+    const std::vector<std::string> &utts,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *tot_like,
+    int64 *frame_count) {
+  KALDI_ASSERT(decodables.size() == utts.size());
+  decoder.Decode(decodables);
+  return OutputLatticeBatch(decoder, utts, trans_model, word_syms,
+                            acoustic_scale, determinize, allow_partial,
+                            alignment_writer, words_writer,
+                            compact_lattice_writer, lattice_writer,
+                            tot_like, frame_count);
+}
+
+int32 OutputLatticeBatch(
+    const LatticeBatchDecoder &decoder,
+    const std::vector<std::string> &utts,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *tot_like,
+    int64 *frame_count) {
+  KALDI_ASSERT(decoder.NumLanes() == static_cast<int32>(utts.size()));
+  int32 num_success = 0;
+  for (size_t i = 0; i < utts.size(); i++) {
+    if (!decoder.Succeeded(i)) {
+      KALDI_WARN << "Failed to decode file " << utts[i];
+      continue;
+    }
+    double like;
+    if (OutputDecodedUtterance(LatticeBatchDecoderLane(decoder, i),
+                               trans_model, word_syms, utts[i],
+                               acoustic_scale, determinize, allow_partial,
+                               alignment_writer, words_writer,
+                               compact_lattice_writer, lattice_writer,
+                               &like)) {
+      if (tot_like != NULL) *tot_like += like;
+      if (frame_count != NULL) *frame_count += decoder.NumFramesDecoded(i);
+      num_success++;
+    }
+  }
+  return num_success;
+}
+
+// Instantiate the template above for the required FST types.
 template bool DecodeUtteranceLatticeFaster(
     LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> > &decoder,
     DecodableInterface &decodable,
@@ -326,6 +507,49 @@ template bool DecodeUtteranceLatticeFaster(
     LatticeWriter *lattice_writer,
     double *like_ptr);
 
+template bool DecodeUtteranceLatticeFaster(
+    LatticeFasterDecoderTpl<CsrFst> &decoder,
+    DecodableInterface &decodable,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *like_ptr);
+
+template bool DecodeUtteranceLatticeIncremental(
+    LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> >> &decoder,
+    LatticeIncrementalDeterminizer &determinizer,
+    DecodableInterface &decodable,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    double *like_ptr);
+
+template bool DecodeUtteranceLatticeIncremental(
+    LatticeFasterDecoderTpl<CsrFst> &decoder,
+    LatticeIncrementalDeterminizer &determinizer,
+    DecodableInterface &decodable,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    double *like_ptr);
+
 
 // Takes care of output.  Returns true on success.
 bool DecodeUtteranceLatticeSimple(
@@ -390,8 +614,20 @@ bool DecodeUtteranceLatticeSimple(
     likelihood = -(weight.Value1() + weight.Value2());
   }
 
-  // Get lattice, and do determinization if requested.
-  Lattice lat;
+  if (determinizer != NULL && determinize) {
+    CompactLattice clat;
+    if (!determinizer->GetLattice(&clat))
+      KALDI_WARN << "Determinization finished earlier than the beam for "
+                 << "utterance " << utt;
+    if (clat.NumStates() == 0)
+      KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
+    // We'll write the lattice without acoustic scaling.
+    if (acoustic_scale != 0.0)
+      fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale), &clat);
+    compact_lattice_writer->Write(utt, clat);
+  } else {
+    // Get lattice, and do determinization if requested.
+    Lattice lat;
   if (!decoder.GetRawLattice(&lat))
     KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
   fst::Connect(&lat);
@@ -456,33 +692,19 @@ void ModifyGraphForCarefulAlignment(
 }
 
 
-void AlignUtteranceWrapper(
-    const AlignConfig &config,
-    const std::string &utt,
-    BaseFloat acoustic_scale,  // affects scores written to scores_writer, if
-                               // present
-    fst::VectorFst<fst::StdArc> *fst,  // non-const in case config.careful ==
-                                       // true.
-    DecodableInterface *decodable,  // not const but is really an input.
-    Int32VectorWriter *alignment_writer,
-    BaseFloatWriter *scores_writer,
-    int32 *num_done,
-    int32 *num_error,
-    int32 *num_retried,
-    double *tot_like,
-    int64 *frame_count,
-    BaseFloatVectorWriter *per_frame_acwt_writer) {
-
-  if ((config.retry_beam != 0 && config.retry_beam <= config.beam) ||
-      config.beam <= 0.0) {
-    KALDI_ERR << "Beams do not make sense: beam " << config.beam
-              << ", retry-beam " << config.retry_beam;
-  }
-
+// Does the decoding for AlignUtteranceWrapper() and AlignUtteranceClass;
+// returns false (after a warning) on failure.  Sets *retried if it retried
+// with config.retry_beam.
+static bool AlignUtteranceInternal(const AlignConfig &config,
+                                   const std::string &utt,
+                                   fst::VectorFst<fst::StdArc> *fst,
+                                   DecodableInterface *decodable,
+                                   bool *retried,
+                                   fst::VectorFst<LatticeArc> *decoded) {
+  *retried = false;
   if (fst->Start() == fst::kNoStateId) {
     KALDI_WARN << "Empty decoding graph for " << utt;
-    if (num_error != NULL) (*num_error)++;
-    return;
+    return false;
   }
 
   if (config.careful)
@@ -497,7 +719,7 @@ void AlignUtteranceWrapper(
   bool ans = decoder.ReachedFinal();  // consider only final states.
 
   if (!ans && config.retry_beam != 0.0) {
-    if (num_retried != NULL) (*num_retried)++;
+    *retried = true;
     KALDI_WARN << "Retrying utterance " << utt << " with beam "
                << config.retry_beam;
     decode_opts.beam = config.retry_beam;
@@ -509,18 +731,28 @@ void AlignUtteranceWrapper(
   if (!ans) {  // Still did not reach final state.
     KALDI_WARN << "Did not successfully decode file " << utt << ", len = "
                << decodable->NumFramesReady();
-    if (num_error != NULL) (*num_error)++;
-    return;
+    return false;
   }
 
-  fst::VectorFst<LatticeArc> decoded;  // linear FST.
-  decoder.GetBestPath(&decoded);
-  if (decoded.NumStates() == 0) {
+  decoder.GetBestPath(decoded);
+  if (decoded->NumStates() == 0) {
     KALDI_WARN << "Error getting best path from decoder (likely a bug)";
-    if (num_error != NULL) (*num_error)++;
-    return;
+    return false;
   }
+  return true;
+}
 
+// Does the output for AlignUtteranceWrapper() and AlignUtteranceClass.
+static void OutputAlignment(const std::string &utt,
+                            BaseFloat acoustic_scale,
+                            const fst::VectorFst<LatticeArc> &decoded,
+                            int32 num_frames,
+                            Int32VectorWriter *alignment_writer,
+                            BaseFloatWriter *scores_writer,
+                            int32 *num_done,
+                            double *tot_like,
+                            int64 *frame_count,
+                            BaseFloatVectorWriter *per_frame_acwt_writer) {
   std::vector<int32> alignment;
   std::vector<int32> words;
   LatticeWeight weight;
@@ -530,7 +762,7 @@ void AlignUtteranceWrapper(
 
   if (num_done != NULL) (*num_done)++;
   if (tot_like != NULL) (*tot_like) += like;
-  if (frame_count != NULL) (*frame_count) += decodable->NumFramesReady();
+  if (frame_count != NULL) (*frame_count) += num_frames;
 
   if (alignment_writer != NULL && alignment_writer->IsOpen())
     alignment_writer->Write(utt, alignment);
@@ -546,4 +778,90 @@ void AlignUtteranceWrapper(
   }
 }
 
+static void CheckAlignConfig(const AlignConfig &config) {
+  if ((config.retry_beam != 0 && config.retry_beam <= config.beam) ||
+      config.beam <= 0.0) {
+    KALDI_ERR << "Beams do not make sense: beam " << config.beam
+              << ", retry-beam " << config.retry_beam;
+  }
+}
+
+void AlignUtteranceWrapper(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,  // affects scores written to scores_writer, if
+                               // present
+    fst::VectorFst<fst::StdArc> *fst,  // non-const in case config.careful ==
+                                       // true.
+    DecodableInterface *decodable,  // not const but is really an input.
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer) {
+  CheckAlignConfig(config);
+
+  bool retried;
+  fst::VectorFst<LatticeArc> decoded;  // linear FST.
+  bool ans = AlignUtteranceInternal(config, utt, fst, decodable, &retried,
+                                    &decoded);
+  if (retried && num_retried != NULL) (*num_retried)++;
+  if (!ans) {
+    if (num_error != NULL) (*num_error)++;
+    return;
+  }
+  OutputAlignment(utt, acoustic_scale, decoded, decodable->NumFramesReady(),
+                  alignment_writer, scores_writer, num_done, tot_like,
+                  frame_count, per_frame_acwt_writer);
+}
+
+
+AlignUtteranceClass::AlignUtteranceClass(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,
+    fst::VectorFst<fst::StdArc> *fst,
+    DecodableInterface *decodable,
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer):
+    config_(config), utt_(utt), acoustic_scale_(acoustic_scale), fst_(fst),
+    decodable_(decodable), alignment_writer_(alignment_writer),
+    scores_writer_(scores_writer), num_done_(num_done),
+    num_error_(num_error), num_retried_(num_retried), tot_like_(tot_like),
+    frame_count_(frame_count), per_frame_acwt_writer_(per_frame_acwt_writer),
+    computed_(false), success_(false), retried_(false) {
+  CheckAlignConfig(config);
+}
+
+void AlignUtteranceClass::operator () () {
+  computed_ = true;
+  success_ = AlignUtteranceInternal(config_, utt_, fst_, decodable_,
+                                    &retried_, &decoded_);
+}
+
+AlignUtteranceClass::~AlignUtteranceClass() {
+  if (!computed_)
+    KALDI_ERR << "Destructor called without operator (), error in calling code.";
+  if (retried_ && num_retried_ != NULL) (*num_retried_)++;
+  if (!success_) {
+    if (num_error_ != NULL) (*num_error_)++;
+  } else {
+    OutputAlignment(utt_, acoustic_scale_, decoded_,
+                    decodable_->NumFramesReady(), alignment_writer_,
+                    scores_writer_, num_done_, tot_like_, frame_count_,
+                    per_frame_acwt_writer_);
+  }
+  delete fst_;
+  delete decodable_;
+}
+
 } // end namespace kaldi.
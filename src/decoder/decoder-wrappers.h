@@ -22,7 +22,9 @@
 
 #include "itf/options-itf.h"
 #include "decoder/lattice-faster-decoder.h"
+#include "decoder/lattice-incremental-determinizer.h"
 #include "decoder/lattice-simple-decoder.h"
+#include "decoder/lattice-batch-decoder.h"
 
 // This header contains declarations from various convenience functions that are called
 // from binary-level programs such as gmm-decode-faster.cc, gmm-align-compiled.cc, and
@@ -72,6 +74,50 @@ void AlignUtteranceWrapper(
     int64 *frame_count,
     BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
 
+/// This class does the same job as AlignUtteranceWrapper(), but in a way that
+/// allows multi-threaded command line programs (with TaskSequencer): the
+/// alignment takes place in operator (), and the output and the updates of
+/// the counters in the destructor.  It takes ownership of "fst" and
+/// "decodable".
+class AlignUtteranceClass {
+ public:
+  AlignUtteranceClass(const AlignConfig &config,
+                      const std::string &utt,
+                      BaseFloat acoustic_scale,
+                      fst::VectorFst<fst::StdArc> *fst,
+                      DecodableInterface *decodable,
+                      Int32VectorWriter *alignment_writer,
+                      BaseFloatWriter *scores_writer,
+                      int32 *num_done,
+                      int32 *num_error,
+                      int32 *num_retried,
+                      double *tot_like,
+                      int64 *frame_count,
+                      BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
+  void operator () ();  // The alignment happens here.
+  ~AlignUtteranceClass();  // Output happens here.
+ private:
+  AlignConfig config_;
+  std::string utt_;
+  BaseFloat acoustic_scale_;
+  fst::VectorFst<fst::StdArc> *fst_;
+  DecodableInterface *decodable_;
+  Int32VectorWriter *alignment_writer_;
+  BaseFloatWriter *scores_writer_;
+  int32 *num_done_;
+  int32 *num_error_;
+  int32 *num_retried_;
+  double *tot_like_;
+  int64 *frame_count_;
+  BaseFloatVectorWriter *per_frame_acwt_writer_;
+
+  // The following variables are stored by the computation.
+  bool computed_;  // operator () was called.
+  bool success_;
+  bool retried_;
+  fst::VectorFst<LatticeArc> decoded_;  // linear FST.
+};
+
 
 
 /// This function modifies the decoding graph for what we call "careful
@@ -96,9 +142,9 @@ void ModifyGraphForCarefulAlignment(
 /// lattice_writer, else to compact_lattice_writer.  The writers for
 /// alignments and words will only be written to if they are open.
 ///
-/// Caution: this will only link correctly if FST is either fst::Fst<fst::StdArc>,
-/// or fst::GrammarFst, as the template function is defined in the .cc file and
-/// only instantiated for those two types.
+/// Caution: this will only link correctly if FST is fst::Fst<fst::StdArc>,
+/// fst::GrammarFst or CsrFst, as the template function is defined in the .cc
+/// file and only instantiated for those types.
 template <typename FST>
 bool DecodeUtteranceLatticeFaster(
     LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
@@ -116,6 +162,69 @@ bool DecodeUtteranceLatticeFaster(
     double *like_ptr);  // puts utterance's likelihood in like_ptr on success.
 
 
+/// This function does the same job as DecodeUtteranceLatticeFaster with
+/// determinize == true, but the lattice is determinized by determinizer a chunk
+/// of determinizer.Config().chunk_size frames at a time as the utterance is
+/// decoded (see LatticeIncrementalDeterminizer), instead of all at the end.
+/// Note: the lattice is determinized on words with DeterminizeLatticePruned(),
+/// not first on phones as DecodeUtteranceLatticeFaster does.  Only instantiated
+/// for fst::Fst<fst::StdArc> and CsrFst.
+template <typename FST>
+bool DecodeUtteranceLatticeIncremental(
+    LatticeFasterDecoderTpl<FST> &decoder, // not const but is really an input.
+    LatticeIncrementalDeterminizer &determinizer,
+    DecodableInterface &decodable, // not const but is really an input.
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool allow_partial,
+    Int32VectorWriter *alignments_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    double *like_ptr);  // puts utterance's likelihood in like_ptr on success.
+
+
+/// This function does the same job as DecodeUtteranceLatticeFaster for a batch
+/// of utterances, which are decoded together by a LatticeBatchDecoder (one
+/// lane each), and writes the output in the same way.  Returns the number that
+/// succeeded; their likelihoods are added to tot_like and their frames to
+/// frame_count, if non-NULL.
+int32 DecodeUtteranceLatticeBatch(
+    LatticeBatchDecoder &decoder, // not const but is really an input.
+    const std::vector<DecodableInterface*> &decodables,
+    const std::vector<std::string> &utts,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignments_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *tot_like,
+    int64 *frame_count);
+
+/// Writes the output of a LatticeBatchDecoder that has decoded utts, one lane
+/// each, as DecodeUtteranceLatticeBatch() does; for when it was decoded some
+/// other way (e.g. by CudaLatticeBatchDecoder).  Returns the number that
+/// succeeded.
+int32 OutputLatticeBatch(
+    const LatticeBatchDecoder &decoder,
+    const std::vector<std::string> &utts,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    double acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignments_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *tot_like,
+    int64 *frame_count);
+
 /// This class basically does the same job as the function
 /// DecodeUtteranceLatticeFaster, but in a way that allows us
 /// to build a multi-threaded command line program more easily.
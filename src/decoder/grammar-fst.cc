@@ -864,6 +864,79 @@ void PrepareForGrammarFst(int32 nonterm_phones_offset,
   p.Prepare();
 }
 
+bool PushCostsToEntryArcs(int32 nonterm_phones_offset,
+                          VectorFst<StdArc> *fst) {
+  typedef StdArc::StateId StateId;
+  typedef StdArc::Weight Weight;
+  StateId start = fst->Start();
+  if (start == kNoStateId)
+    return false;
+  int32 big_number = kNontermBigNumber,
+      encoding_multiple = GetEncodingMultiple(nonterm_phones_offset),
+      nonterm_begin = nonterm_phones_offset + static_cast<int32>(kNontermBegin),
+      nonterm_end = nonterm_phones_offset + static_cast<int32>(kNontermEnd);
+  if (fst->Final(start) != Weight::Zero() || fst->NumArcs(start) == 0)
+    return false;
+  for (ArcIterator<VectorFst<StdArc> > aiter(*fst, start); !aiter.Done();
+       aiter.Next()) {
+    int32 ilabel = aiter.Value().ilabel;
+    if (ilabel <= big_number ||
+        (ilabel - big_number) / encoding_multiple != nonterm_begin)
+      return false;
+  }
+
+  StateId num_states = fst->NumStates();
+  // The states the #nonterm_end arcs enter, whose final-probs must stay One()
+  // (see PrepareForGrammarFst()), get potential zero like the start state.
+  std::vector<bool> zero_potential(num_states, false);
+  zero_potential[start] = true;
+  // The finals of the special states (KALDI_GRAMMAR_FST_SPECIAL_WEIGHT) are
+  // not real final-probs; remove them for working out the potentials.
+  VectorFst<StdArc> fst_no_special(*fst);
+  for (StateId s = 0; s < num_states; s++) {
+    if (fst->Final(s).Value() == KALDI_GRAMMAR_FST_SPECIAL_WEIGHT)
+      fst_no_special.SetFinal(s, Weight::Zero());
+    for (ArcIterator<VectorFst<StdArc> > aiter(*fst, s); !aiter.Done();
+         aiter.Next()) {
+      const StdArc &arc = aiter.Value();
+      if (arc.nextstate == start) {
+        KALDI_WARN << "Not pushing costs: the start state has arcs "
+            "entering it.";
+        return false;
+      }
+      if (arc.ilabel > big_number &&
+          (arc.ilabel - big_number) / encoding_multiple == nonterm_end)
+        zero_potential[arc.nextstate] = true;
+    }
+  }
+  std::vector<Weight> distance;
+  ShortestDistance(fst_no_special, &distance, true);
+
+  // Any finite potentials leave the cost of complete paths unchanged; states
+  // that cannot reach the end get zero.
+  std::vector<float> potential(num_states, 0.0);
+  for (StateId s = 0; s < num_states; s++) {
+    if (!zero_potential[s] && s < static_cast<StateId>(distance.size()) &&
+        distance[s] != Weight::Zero())
+      potential[s] = distance[s].Value();
+  }
+
+  for (StateId s = 0; s < num_states; s++) {
+    for (MutableArcIterator<VectorFst<StdArc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      StdArc arc = aiter.Value();
+      arc.weight = Weight(arc.weight.Value() + potential[arc.nextstate] -
+                          potential[s]);
+      aiter.SetValue(arc);
+    }
+    Weight final_weight = fst->Final(s);
+    if (final_weight != Weight::Zero() &&
+        final_weight.Value() != KALDI_GRAMMAR_FST_SPECIAL_WEIGHT)
+      fst->SetFinal(s, Weight(final_weight.Value() - potential[s]));
+  }
+  return true;
+}
+
 void CopyToVectorFst(GrammarFst *grammar_fst,
                      VectorFst<StdArc> *vector_fst) {
   typedef GrammarFstArc::StateId GrammarStateId;  // int64
@@ -634,6 +634,35 @@ void PrepareForGrammarFst(int32 nonterm_phones_offset,
                           VectorFst<StdArc> *fst);
 
 
+/**
+   This function, to be called after PrepareForGrammarFst() on an FST that
+   represents a nonterminal (i.e. not the top-level FST), moves the costs of
+   the FST as early as possible, so that the cost of the cheapest way through
+   it goes on its entry arcs (the arcs with #nonterm_begin leaving its start
+   state).  This is a form of weight lookahead: when the GrammarFst enters the
+   FST the decoder sees at once how costly it is to get through it, rather
+   than at the end, so tokens that go into sub-grammars that are rarely reached
+   (e.g. large contact lists) are pruned away sooner.  The cost of every
+   complete path is unchanged.
+
+   It reweights the FST with potentials given by the shortest distance from
+   each state to the end of the FST (the #nonterm_end arcs), except that the
+   entry arcs keep the whole cost.  The weights of nested nonterminals are not
+   included (each FST is pushed on its own).  Grammar FSTs are pushed once,
+   when they are prepared (see make-grammar-fst --push-costs-to-entries), so
+   nothing is done at decoding time.
+
+     @param [in] nonterm_phones_offset   The integer id of
+                the symbols #nonterm_bos in the phones.txt file.
+     @param [in,out] fst  The FST to be reweighted.
+     @return  Returns false, leaving 'fst' unchanged, if its start state does
+              not have only #nonterm_begin arcs (e.g. for the top-level FST),
+              or has arcs entering it or a final-prob.
+*/
+bool PushCostsToEntryArcs(int32 nonterm_phones_offset,
+                          VectorFst<StdArc> *fst);
+
+
 } // end namespace fst
 
 
@@ -0,0 +1,101 @@
+// decoder/lattice-batch-datastruct.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_DECODER_LATTICE_BATCH_DATASTRUCT_H_
+#define KALDI_DECODER_LATTICE_BATCH_DATASTRUCT_H_
+#include "cudamatrix/cu-matrixdim.h" // for CU1DBLOCK, int32_cuda and uint32_cuda
+
+/**
+   This header declares the "C" structures of the CUDA interface of
+   CudaLatticeBatchDecoder (see lattice-batch-decoder-cuda.h and
+   lattice-batch-kernels.cu).  All the pointers are to device memory.
+ */
+
+extern "C" {
+  // "C" version of the BaseFloat typedef, as in chain/chain-datastruct.h.
+#if (KALDI_DOUBLEPRECISION != 0)
+  typedef double  BaseFloat;
+#else
+  typedef float   BaseFloat;
+#endif
+
+  // The decoding graph, in the CSR form of CsrFst, with the arcs as separate
+  // arrays.  The arcs of state s are [arc_offsets[s], arc_offsets[s+1]), the
+  // emitting ones from emitting_offsets[s].
+  struct LatticeBatchGraph {
+    const int32_cuda *arc_offsets;       // dim is num_states + 1
+    const int32_cuda *emitting_offsets;  // dim is num_states
+    const int32_cuda *nextstates;        // dim is num_arcs
+    const int32_cuda *pdfs;              // dim is num_arcs; -1 if not emitting
+    const BaseFloat *weights;            // dim is num_arcs
+  };
+
+  // Indexes of LatticeBatchFrame::counts.
+  enum {
+    kLatticeBatchNumTouched = 0,   // states given a cost on the frame
+    kLatticeBatchNumCandidates,    // emitting arcs expanded
+    kLatticeBatchNumQueued,        // states queued for the non-emitting arcs,
+                                   // two counts, one for each queue
+    kLatticeBatchNumTokens = kLatticeBatchNumQueued + 2,
+    kLatticeBatchNumEmittingArcs,
+    kLatticeBatchNumNonemittingArcs,
+    kLatticeBatchOverflow,         // nonzero if a buffer was too small
+    kLatticeBatchNumCounts
+  };
+
+  // The buffers for decoding a frame.  The costs of states are kept as
+  // unsigned codes that are ordered as the costs are, so that the best one is
+  // an atomicMin(); see CostToCode() in lattice-batch-kernels.cu.
+  struct LatticeBatchFrame {
+    uint32_cuda *state_costs;  // per state; the code of +infinity if untouched
+    int32_cuda *state_tokens;  // per state; the token on this frame, or -1
+    int32_cuda *counts;        // dim is kLatticeBatchNumCounts
+    uint32_cuda *best_cost;    // the code of the best cost of the frame
+    BaseFloat *cutoff;
+    int32_cuda *histogram;     // of the costs within the beam
+
+    int32_cuda max_tokens;
+    int32_cuda max_arcs;
+
+    // These have dim max_tokens.
+    int32_cuda *touched_states;
+    int32_cuda *queues[2];
+    const int32_cuda *prev_token_states;  // the tokens of the frame before
+    const BaseFloat *prev_token_costs;
+    int32_cuda *token_states;             // the tokens of this frame
+    BaseFloat *token_costs;
+
+    // The expanded emitting arcs; dim is max_arcs.
+    int32_cuda *candidate_prev_tokens;
+    int32_cuda *candidate_arcs;
+    BaseFloat *candidate_acoustic_costs;
+    BaseFloat *candidate_costs;
+
+    // The arcs into the tokens of this frame, the emitting ones from
+    // the tokens of the frame before in [0, max_arcs) and the non-emitting
+    // ones in [max_arcs, 2 * max_arcs); dim is 2 * max_arcs.
+    int32_cuda *arc_prev_tokens;
+    int32_cuda *arc_next_tokens;
+    int32_cuda *arc_arcs;                 // arcs of the graph
+    BaseFloat *arc_acoustic_costs;
+  };
+} // extern "C"
+
+#endif  // KALDI_DECODER_LATTICE_BATCH_DATASTRUCT_H_
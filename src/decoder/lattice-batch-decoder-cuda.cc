@@ -0,0 +1,400 @@
+// decoder/lattice-batch-decoder-cuda.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#if HAVE_CUDA == 1
+
+#include <algorithm>
+#include <limits>
+
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-device.h"
+#include "decoder/lattice-batch-decoder-cuda.h"
+#include "decoder/lattice-batch-kernels-ansi.h"
+
+namespace kaldi {
+
+// the bins of the histogram of the costs within the beam, from which the
+// --max-active cutoff is found.
+static const int32 kNumHistogramBins = 256;
+
+// the blocks of the kernels, which go over their tokens, states or arcs with
+// a stride of the whole grid.
+static const int32 kNumBlocks = 256;
+
+// Copies the first n elements of src to dest, in the stream of the thread.
+template<typename T>
+static void CopyToHostAsync(const T *src, int32 n, std::vector<T> *dest) {
+  dest->resize(n);
+  if (n > 0)
+    CU_SAFE_CALL(cudaMemcpyAsync(&((*dest)[0]), src, n * sizeof(T),
+                                 cudaMemcpyDeviceToHost,
+                                 cudaStreamPerThread));
+}
+
+CudaLatticeBatchDecoder::CudaLatticeBatchDecoder(
+    const CsrFst &fst, const TransitionModel &trans_model,
+    const LatticeFasterDecoderConfig &config,
+    const CudaLatticeBatchDecoderConfig &cuda_config):
+    LatticeBatchDecoder(fst, config), cuda_config_(cuda_config),
+    num_pdfs_(trans_model.NumPdfs()), cur_tokens_(0),
+    num_emitting_arcs_(0) {
+  cuda_config_.Check();
+  if (!CuDevice::Instantiate().Enabled())
+    KALDI_ERR << "CudaLatticeBatchDecoder needs a GPU";
+  if (sizeof(BaseFloat) != sizeof(float))
+    KALDI_ERR << "CudaLatticeBatchDecoder needs KALDI_DOUBLEPRECISION=0";
+
+  int32 num_states = fst.NumStates(), num_arcs = fst.NumArcs();
+  std::vector<int32> arc_offsets(num_states + 1), emitting_offsets(num_states),
+      nextstates(num_arcs), pdfs(num_arcs);
+  std::vector<BaseFloat> weights(num_arcs);
+  for (int32 s = 0; s < num_states; s++) {
+    arc_offsets[s] = fst.ArcsBegin(s);
+    emitting_offsets[s] = fst.EmittingArcsBegin(s);
+    for (int32 a = fst.ArcsBegin(s); a < fst.ArcsEnd(s); a++) {
+      const CsrFst::Arc &arc = fst.GetArc(a);
+      nextstates[a] = arc.nextstate;
+      weights[a] = arc.weight.Value();
+      if (a < fst.EmittingArcsBegin(s)) {
+        pdfs[a] = -1;
+      } else {
+        if (arc.ilabel > trans_model.NumTransitionIds())
+          KALDI_ERR << "The graph has ilabel " << arc.ilabel
+                    << ", which is not a transition-id of the model";
+        pdfs[a] = trans_model.TransitionIdToPdf(arc.ilabel);
+      }
+    }
+  }
+  arc_offsets[num_states] = num_arcs;
+  arc_offsets_.CopyFromVec(arc_offsets);
+  emitting_offsets_.CopyFromVec(emitting_offsets);
+  nextstates_.CopyFromVec(nextstates);
+  pdfs_.CopyFromVec(pdfs);
+  weights_.CopyFromVec(weights);
+  graph_.arc_offsets = arc_offsets_.Data();
+  graph_.emitting_offsets = emitting_offsets_.Data();
+  graph_.nextstates = nextstates_.Data();
+  graph_.pdfs = pdfs_.Data();
+  graph_.weights = weights_.Data();
+
+  int32 max_tokens = cuda_config.max_tokens_per_frame,
+      max_arcs = cuda_config.max_arcs_per_frame;
+  state_costs_.Resize(num_states, kUndefined);
+  state_tokens_.Resize(num_states, kUndefined);
+  counts_.Resize(kLatticeBatchNumCounts);
+  best_cost_.Resize(1);
+  cutoff_.Resize(1);
+  histogram_.Resize(kNumHistogramBins);
+  touched_states_.Resize(max_tokens, kUndefined);
+  for (int32 i = 0; i < 2; i++) {
+    queues_[i].Resize(max_tokens, kUndefined);
+    token_states_[i].Resize(max_tokens, kUndefined);
+    token_costs_[i].Resize(max_tokens, kUndefined);
+  }
+  candidate_prev_tokens_.Resize(max_arcs, kUndefined);
+  candidate_arcs_.Resize(max_arcs, kUndefined);
+  candidate_acoustic_costs_.Resize(max_arcs, kUndefined);
+  candidate_costs_.Resize(max_arcs, kUndefined);
+  arc_prev_tokens_.Resize(2 * max_arcs, kUndefined);
+  arc_next_tokens_.Resize(2 * max_arcs, kUndefined);
+  arc_arcs_.Resize(2 * max_arcs, kUndefined);
+  arc_acoustic_costs_.Resize(2 * max_arcs, kUndefined);
+
+  frame_.state_costs = state_costs_.Data();
+  frame_.state_tokens = state_tokens_.Data();
+  frame_.counts = counts_.Data();
+  frame_.best_cost = best_cost_.Data();
+  frame_.cutoff = cutoff_.Data();
+  frame_.histogram = histogram_.Data();
+  frame_.max_tokens = max_tokens;
+  frame_.max_arcs = max_arcs;
+  frame_.touched_states = touched_states_.Data();
+  frame_.queues[0] = queues_[0].Data();
+  frame_.queues[1] = queues_[1].Data();
+  frame_.candidate_prev_tokens = candidate_prev_tokens_.Data();
+  frame_.candidate_arcs = candidate_arcs_.Data();
+  frame_.candidate_acoustic_costs = candidate_acoustic_costs_.Data();
+  frame_.candidate_costs = candidate_costs_.Data();
+  frame_.arc_prev_tokens = arc_prev_tokens_.Data();
+  frame_.arc_next_tokens = arc_next_tokens_.Data();
+  frame_.arc_arcs = arc_arcs_.Data();
+  frame_.arc_acoustic_costs = arc_acoustic_costs_.Data();
+
+  // all the states start with no cost and no token.
+  cuda_lattice_batch_reset_states(dim3(kNumBlocks), dim3(CU1DBLOCK), frame_,
+                                  num_states, 1);
+  CU_SAFE_CALL(cudaGetLastError());
+}
+
+bool CudaLatticeBatchDecoder::ProcessFrame(const BaseFloat *loglikes,
+                                           BaseFloat cost_offset,
+                                           int32 num_prev_tokens) {
+  CuTimer tim;
+  dim3 dimGrid(kNumBlocks), dimBlock(CU1DBLOCK), one(1);
+  frame_.prev_token_states = token_states_[1 - cur_tokens_].Data();
+  frame_.prev_token_costs = token_costs_[1 - cur_tokens_].Data();
+  frame_.token_states = token_states_[cur_tokens_].Data();
+  frame_.token_costs = token_costs_[cur_tokens_].Data();
+
+  cuda_lattice_batch_start_frame(one, dimBlock, frame_, kNumHistogramBins);
+  if (loglikes == NULL)
+    cuda_lattice_batch_start_lane(one, one, frame_, fst_.Start());
+  else
+    cuda_lattice_batch_expand_emitting(dimGrid, dimBlock, graph_, frame_,
+                                       num_prev_tokens, cost_offset, loglikes);
+  cuda_lattice_batch_histogram(dimGrid, dimBlock, frame_, config_.beam,
+                               kNumHistogramBins);
+  cuda_lattice_batch_cutoff(one, one, frame_, config_.beam,
+                            config_.max_active, config_.min_active,
+                            kNumHistogramBins);
+  cuda_lattice_batch_queue_states(dimGrid, dimBlock, frame_);
+  CU_SAFE_CALL(cudaGetLastError());
+
+  // relax the non-emitting arcs until no state is queued.
+  for (int32 queue = 0; ; queue = 1 - queue) {
+    int32 *num_queued_device = counts_.Data() + kLatticeBatchNumQueued +
+        (1 - queue), num_queued;
+    CU_SAFE_CALL(cudaMemsetAsync(num_queued_device, 0, sizeof(int32),
+                                 cudaStreamPerThread));
+    cuda_lattice_batch_expand_nonemitting(dimGrid, dimBlock, graph_, frame_,
+                                          queue);
+    CU_SAFE_CALL(cudaGetLastError());
+    CU_SAFE_CALL(cudaMemcpyAsync(&num_queued, num_queued_device,
+                                 sizeof(int32), cudaMemcpyDeviceToHost,
+                                 cudaStreamPerThread));
+    CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+    if (num_queued == 0)
+      break;
+  }
+
+  cuda_lattice_batch_make_tokens(dimGrid, dimBlock, frame_);
+  cuda_lattice_batch_make_arcs(dimGrid, dimBlock, graph_, frame_);
+  CU_SAFE_CALL(cudaGetLastError());
+  CopyToHostAsync<int32>(counts_.Data(), kLatticeBatchNumCounts,
+                         &counts_host_);
+  CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+
+  int32 max_tokens = frame_.max_tokens, max_arcs = frame_.max_arcs,
+      num_tokens = std::min(counts_host_[kLatticeBatchNumTokens], max_tokens),
+      num_emitting = std::min(counts_host_[kLatticeBatchNumEmittingArcs],
+                              max_arcs),
+      num_nonemitting = std::min(counts_host_[kLatticeBatchNumNonemittingArcs],
+                                 max_arcs);
+  bool overflow = (counts_host_[kLatticeBatchOverflow] != 0);
+  CopyToHostAsync<int32>(frame_.token_states, num_tokens,
+                         &token_states_host_);
+  CopyToHostAsync<BaseFloat>(frame_.token_costs, num_tokens,
+                             &token_costs_host_);
+  // the emitting arcs are at the start of the arrays and the non-emitting ones
+  // at max_arcs; they are copied to be together.
+  num_emitting_arcs_ = num_emitting;
+  int32 num_arcs = num_emitting + num_nonemitting;
+  arc_prev_tokens_host_.resize(num_arcs);
+  arc_next_tokens_host_.resize(num_arcs);
+  arc_arcs_host_.resize(num_arcs);
+  arc_acoustic_costs_host_.resize(num_arcs);
+  for (int32 part = 0; part < 2; part++) {
+    int32 n = (part == 0 ? num_emitting : num_nonemitting),
+        src = (part == 0 ? 0 : max_arcs), dest = (part == 0 ? 0 : num_emitting);
+    if (n == 0)
+      continue;
+    CU_SAFE_CALL(cudaMemcpyAsync(&(arc_prev_tokens_host_[dest]),
+                                 frame_.arc_prev_tokens + src,
+                                 n * sizeof(int32), cudaMemcpyDeviceToHost,
+                                 cudaStreamPerThread));
+    CU_SAFE_CALL(cudaMemcpyAsync(&(arc_next_tokens_host_[dest]),
+                                 frame_.arc_next_tokens + src,
+                                 n * sizeof(int32), cudaMemcpyDeviceToHost,
+                                 cudaStreamPerThread));
+    CU_SAFE_CALL(cudaMemcpyAsync(&(arc_arcs_host_[dest]),
+                                 frame_.arc_arcs + src,
+                                 n * sizeof(int32), cudaMemcpyDeviceToHost,
+                                 cudaStreamPerThread));
+    CU_SAFE_CALL(cudaMemcpyAsync(&(arc_acoustic_costs_host_[dest]),
+                                 frame_.arc_acoustic_costs + src,
+                                 n * sizeof(BaseFloat), cudaMemcpyDeviceToHost,
+                                 cudaStreamPerThread));
+  }
+
+  // if a buffer was too small, some touched states may not be in
+  // touched_states, so all of them are reset.
+  cuda_lattice_batch_reset_states(dimGrid, dimBlock, frame_,
+                                  fst_.NumStates(), overflow ? 1 : 0);
+  CU_SAFE_CALL(cudaGetLastError());
+  CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+  cur_tokens_ = 1 - cur_tokens_;
+  CuDevice::Instantiate().AccuProfile(__func__, tim);
+  return !overflow;
+}
+
+void CudaLatticeBatchDecoder::AddFrame(BaseFloat cost_offset,
+                                       bool first_frame, Lane *lane) {
+  std::vector<Token> &tokens = lane->tokens;
+  int32 num_tokens = token_states_host_.size(),
+      num_arcs = arc_arcs_host_.size(),
+      prev_begin = (first_frame ? 0 :
+                    lane->frame_offsets[lane->frame_offsets.size() - 2]),
+      begin = tokens.size();
+
+  // the tokens in order of state, so that the lattice does not depend on the
+  // order in which the GPU made them; on the first frame the start token goes
+  // first, as LatticeBatchDecoder needs token 0 to be the start.
+  std::vector<std::pair<int32, int32> > order(num_tokens);
+  for (int32 t = 0; t < num_tokens; t++) {
+    int32 state = token_states_host_[t];
+    order[t] = std::make_pair(first_frame && state == fst_.Start() ? -1 : state,
+                              t);
+  }
+  std::sort(order.begin(), order.end());
+  prev_token_ranks_.swap(token_ranks_);
+  token_ranks_.resize(num_tokens);
+  for (int32 r = 0; r < num_tokens; r++) {
+    int32 t = order[r].second;
+    token_ranks_[t] = r;
+    Token token;
+    token.state = token_states_host_[t];
+    token.cost = token_costs_host_[t];
+    token.best_arc = (order[r].first == -1 && token.cost == 0.0 ? -1 : -2);
+    tokens.push_back(token);
+  }
+
+  // the arcs, the emitting ones first, each part in order of the tokens they
+  // go into and come from, and of the arcs of the graph.
+  std::vector<TokenArc> arcs(num_arcs);
+  std::vector<int32> arc_order(num_arcs);
+  for (int32 i = 0; i < num_arcs; i++) {
+    bool emitting = (i < num_emitting_arcs_);
+    TokenArc &arc = arcs[i];
+    const CsrFst::Arc &fst_arc = fst_.GetArc(arc_arcs_host_[i]);
+    arc.prev_token = (emitting ?
+                      prev_begin + prev_token_ranks_[arc_prev_tokens_host_[i]] :
+                      begin + token_ranks_[arc_prev_tokens_host_[i]]);
+    arc.next_token = begin + token_ranks_[arc_next_tokens_host_[i]];
+    arc.ilabel = fst_arc.ilabel;
+    arc.olabel = fst_arc.olabel;
+    arc.graph_cost = fst_arc.weight.Value();
+    arc.acoustic_cost = arc_acoustic_costs_host_[i];
+    arc_order[i] = i;
+  }
+  int32 num_emitting = num_emitting_arcs_;
+  std::sort(arc_order.begin(), arc_order.end(),
+            [&arcs, num_emitting, this] (int32 i, int32 j) {
+              if ((i < num_emitting) != (j < num_emitting))
+                return i < num_emitting;
+              const TokenArc &arc_i = arcs[i], &arc_j = arcs[j];
+              if (arc_i.next_token != arc_j.next_token)
+                return arc_i.next_token < arc_j.next_token;
+              if (arc_i.prev_token != arc_j.prev_token)
+                return arc_i.prev_token < arc_j.prev_token;
+              return arc_arcs_host_[i] < arc_arcs_host_[j];
+            });
+
+  // the best arc into each token is the first whose costs add up to its
+  // cost, as the GPU added them: an emitting one if there is one, else a
+  // non-emitting one from a token whose best arc is known, so there are no
+  // cycles.
+  int32 arc_begin = lane->arcs.size();
+  for (int32 i = 0; i < num_arcs; i++)
+    lane->arcs.push_back(arcs[arc_order[i]]);
+  int32 nonemitting_begin = arc_begin + num_emitting_arcs_;
+  for (int32 a = arc_begin; a < nonemitting_begin; a++) {
+    const TokenArc &arc = lane->arcs[a];
+    Token &next_token = tokens[arc.next_token];
+    if (next_token.best_arc == -2 &&
+        tokens[arc.prev_token].cost + cost_offset + arc.graph_cost +
+        arc.acoustic_cost == next_token.cost)
+      next_token.best_arc = a;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int32 a = nonemitting_begin; a < arc_begin + num_arcs; a++) {
+      const TokenArc &arc = lane->arcs[a];
+      Token &next_token = tokens[arc.next_token];
+      if (next_token.best_arc == -2 && arc.prev_token != arc.next_token &&
+          tokens[arc.prev_token].best_arc != -2 &&
+          tokens[arc.prev_token].cost + arc.graph_cost == next_token.cost) {
+        next_token.best_arc = a;
+        changed = true;
+      }
+    }
+  }
+  lane->frame_offsets.push_back(tokens.size());
+}
+
+void CudaLatticeBatchDecoder::DecodeLane(
+    const CuMatrixBase<BaseFloat> &loglikes, Lane *lane) {
+  KALDI_ASSERT(loglikes.NumCols() == num_pdfs_);
+  lane->tokens.clear();
+  lane->frame_offsets.assign(1, 0);
+  lane->arcs.clear();
+  lane->cost_offsets.clear();
+  lane->ok = true;
+  token_ranks_.clear();
+  bool warned = false;
+  // frame -1 is the start state and the states reached from it by
+  // non-emitting arcs, which is frame 0 of the lane.
+  for (int32 frame = -1; frame < loglikes.NumRows(); frame++) {
+    int32 num_prev_tokens = token_ranks_.size();
+    BaseFloat cost_offset = 0.0;
+    if (frame >= 0) {
+      // the costs of the new tokens are relative to the best one before.
+      int32 prev_begin = lane->frame_offsets[lane->frame_offsets.size() - 2];
+      cost_offset = std::numeric_limits<BaseFloat>::infinity();
+      for (size_t t = prev_begin; t < lane->tokens.size(); t++)
+        cost_offset = std::min(cost_offset, lane->tokens[t].cost);
+      cost_offset = -cost_offset;
+      lane->cost_offsets.push_back(cost_offset);
+    }
+    bool ok = ProcessFrame(frame < 0 ? NULL : loglikes.RowData(frame),
+                           cost_offset, num_prev_tokens);
+    if (!ok && !warned) {
+      KALDI_WARN << "Some states or arcs were lost on frame " << frame
+                 << " because the GPU buffers are too small; increase "
+                 << "--max-tokens-per-frame or --max-arcs-per-frame, or "
+                 << "decrease --max-active.";
+      warned = true;
+    }
+    if (token_states_host_.empty()) {
+      KALDI_WARN << "No tokens survived on frame " << frame;
+      lane->ok = false;
+      return;
+    }
+    AddFrame(cost_offset, frame < 0, lane);
+    int32 num_frames_decoded = lane->frame_offsets.size() - 2;
+    if (frame >= 0 && num_frames_decoded % config_.prune_interval == 0)
+      PruneTokens(lane);
+  }
+}
+
+bool CudaLatticeBatchDecoder::Decode(
+    const std::vector<const CuMatrixBase<BaseFloat>*> &loglikes) {
+  lanes_.clear();
+  lanes_.resize(loglikes.size());
+  bool any_ok = false;
+  for (size_t l = 0; l < lanes_.size(); l++) {
+    DecodeLane(*(loglikes[l]), &lanes_[l]);
+    any_ok = any_ok || lanes_[l].ok;
+  }
+  return any_ok;
+}
+
+}  // namespace kaldi
+
+#endif  // HAVE_CUDA == 1
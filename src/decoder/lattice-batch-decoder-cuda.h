@@ -0,0 +1,169 @@
+// decoder/lattice-batch-decoder-cuda.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_LATTICE_BATCH_DECODER_CUDA_H_
+#define KALDI_DECODER_LATTICE_BATCH_DECODER_CUDA_H_
+
+#if HAVE_CUDA == 1
+
+#include <vector>
+
+#include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-matrix.h"
+#include "decoder/lattice-batch-datastruct.h"
+#include "decoder/lattice-batch-decoder.h"
+#include "hmm/transition-model.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+struct CudaLatticeBatchDecoderConfig {
+  int32 max_tokens_per_frame;
+  int32 max_arcs_per_frame;
+
+  CudaLatticeBatchDecoderConfig(): max_tokens_per_frame(500000),
+                                   max_arcs_per_frame(2000000) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("max-tokens-per-frame", &max_tokens_per_frame,
+                   "Number of states a frame may reach, for the size of the "
+                   "GPU buffers used by the decoder (with --use-gpu).  If it "
+                   "is exceeded, states are dropped with a warning.");
+    opts->Register("max-arcs-per-frame", &max_arcs_per_frame,
+                   "Number of arcs a frame may expand, for the size of the "
+                   "GPU buffers used by the decoder (with --use-gpu).  If it "
+                   "is exceeded, arcs are dropped with a warning.");
+  }
+  void Check() const {
+    KALDI_ASSERT(max_tokens_per_frame > 0 && max_arcs_per_frame > 0);
+  }
+};
+
+/**
+   LatticeBatchDecoder with the passes over the tokens of each frame done on
+   the GPU, by the kernels of lattice-batch-kernels.cu, from log-likelihoods
+   that are already there (e.g. the output of NnetBatchComputer with
+   output_to_cpu == false).  The graph is copied to the GPU once, with the
+   transition-ids of its emitting arcs mapped to pdf-ids.
+
+   For each frame, a thread per token of the frame before expands its
+   emitting arcs, and the best cost of each state, and of the frame, is kept
+   by atomic minimums of the costs.  The cutoff is computed on the GPU from
+   the best cost and a histogram of the costs within the beam, so --max-active
+   is only kept to the width of a bin, and it is the same for the emitting
+   and the non-emitting arcs.  The non-emitting arcs are relaxed a queue of
+   states at a time, until no cost goes down.
+
+   Only the tokens and arcs that are kept, which make up the lattice, are
+   copied back to the host, where the frame is appended to the lane with the
+   tokens in order of state, so the output does not depend on the order in
+   which the GPU made them.  The best arc into each token is found there, by
+   the same sums of costs as on the GPU, and the pruning with --lattice-beam
+   and the output are those of LatticeBatchDecoder.  The lanes are decoded
+   one after the other.
+
+   The costs on the GPU are floats, so this needs KALDI_DOUBLEPRECISION=0.
+*/
+class CudaLatticeBatchDecoder: public LatticeBatchDecoder {
+ public:
+  /// The GPU must have been selected (CuDevice::Instantiate().Enabled()).
+  CudaLatticeBatchDecoder(const CsrFst &fst,
+                          const TransitionModel &trans_model,
+                          const LatticeFasterDecoderConfig &config,
+                          const CudaLatticeBatchDecoderConfig &cuda_config);
+
+  using LatticeBatchDecoder::Decode;
+
+  /// Decodes the utterances, one lane each, from their log-likelihoods on the
+  /// GPU, each num-frames by num-pdfs and already scaled.  Returns true if
+  /// any of them was decoded; for each, see Succeeded().
+  bool Decode(const std::vector<const CuMatrixBase<BaseFloat>*> &loglikes);
+
+ private:
+  void DecodeLane(const CuMatrixBase<BaseFloat> &loglikes, Lane *lane);
+
+  // Decodes a frame on the GPU, from the num_prev_tokens tokens of the frame
+  // before and the log-likelihoods of the frame, or from the start state if
+  // loglikes is NULL, and copies its tokens and arcs to the host.  Returns
+  // false if a buffer was too small.
+  bool ProcessFrame(const BaseFloat *loglikes, BaseFloat cost_offset,
+                    int32 num_prev_tokens);
+
+  // Appends the tokens and arcs copied by ProcessFrame() to the lane.
+  void AddFrame(BaseFloat cost_offset, bool first_frame, Lane *lane);
+
+  const CudaLatticeBatchDecoderConfig &cuda_config_;
+  int32 num_pdfs_;
+
+  // The graph.
+  CuArray<int32> arc_offsets_;
+  CuArray<int32> emitting_offsets_;
+  CuArray<int32> nextstates_;
+  CuArray<int32> pdfs_;
+  CuArray<BaseFloat> weights_;
+  LatticeBatchGraph graph_;
+
+  // The buffers of frame_; token_states_[cur_tokens_] and
+  // token_costs_[cur_tokens_] are for the frame being decoded, the others for
+  // the one before.
+  CuArray<uint32> state_costs_;
+  CuArray<int32> state_tokens_;
+  CuArray<int32> counts_;
+  CuArray<uint32> best_cost_;
+  CuArray<BaseFloat> cutoff_;
+  CuArray<int32> histogram_;
+  CuArray<int32> touched_states_;
+  CuArray<int32> queues_[2];
+  CuArray<int32> token_states_[2];
+  CuArray<BaseFloat> token_costs_[2];
+  CuArray<int32> candidate_prev_tokens_;
+  CuArray<int32> candidate_arcs_;
+  CuArray<BaseFloat> candidate_acoustic_costs_;
+  CuArray<BaseFloat> candidate_costs_;
+  CuArray<int32> arc_prev_tokens_;
+  CuArray<int32> arc_next_tokens_;
+  CuArray<int32> arc_arcs_;
+  CuArray<BaseFloat> arc_acoustic_costs_;
+  LatticeBatchFrame frame_;
+  int32 cur_tokens_;
+
+  // What ProcessFrame() copied to the host: the counts, the tokens, and the
+  // arcs, the emitting ones first.
+  std::vector<int32> counts_host_;
+  std::vector<int32> token_states_host_;
+  std::vector<BaseFloat> token_costs_host_;
+  int32 num_emitting_arcs_;
+  std::vector<int32> arc_prev_tokens_host_;
+  std::vector<int32> arc_next_tokens_host_;
+  std::vector<int32> arc_arcs_host_;
+  std::vector<BaseFloat> arc_acoustic_costs_host_;
+
+  // The place in its frame on the host of each token on the GPU, for this
+  // frame and the one before.
+  std::vector<int32> token_ranks_;
+  std::vector<int32> prev_token_ranks_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CudaLatticeBatchDecoder);
+};
+
+}  // namespace kaldi
+
+#endif  // HAVE_CUDA == 1
+
+#endif  // KALDI_DECODER_LATTICE_BATCH_DECODER_CUDA_H_
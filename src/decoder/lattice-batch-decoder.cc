@@ -0,0 +1,502 @@
+// decoder/lattice-batch-decoder.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+
+#include "decoder/lattice-batch-decoder.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+LatticeBatchDecoder::LatticeBatchDecoder(
+    const CsrFst &fst, const LatticeFasterDecoderConfig &config):
+    fst_(fst), config_(config),
+    state_cost_(fst.NumStates(), std::numeric_limits<BaseFloat>::infinity()),
+    state_token_(fst.NumStates(), -1) {
+  config_.Check();
+}
+
+void LatticeBatchDecoder::ResetStates() {
+  for (size_t i = 0; i < touched_states_.size(); i++) {
+    state_cost_[touched_states_[i]] =
+        std::numeric_limits<BaseFloat>::infinity();
+    state_token_[touched_states_[i]] = -1;
+  }
+  touched_states_.clear();
+}
+
+BaseFloat LatticeBatchDecoder::GetCutoff() const {
+  // the same rules as LatticeFasterDecoderTpl::GetCutoff().
+  BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
+  for (size_t i = 0; i < touched_states_.size(); i++)
+    best_cost = std::min(best_cost, state_cost_[touched_states_[i]]);
+  BaseFloat beam_cutoff = best_cost + config_.beam;
+  size_t max_active = config_.max_active, min_active = config_.min_active;
+  if (touched_states_.size() <= min_active)
+    return std::numeric_limits<BaseFloat>::infinity();
+  if (touched_states_.size() <= max_active && min_active == 0)
+    return beam_cutoff;
+
+  std::vector<BaseFloat> costs(touched_states_.size());
+  for (size_t i = 0; i < touched_states_.size(); i++)
+    costs[i] = state_cost_[touched_states_[i]];
+  if (costs.size() > max_active) {
+    std::nth_element(costs.begin(), costs.begin() + max_active, costs.end());
+    BaseFloat max_active_cutoff = costs[max_active];
+    if (max_active_cutoff < beam_cutoff)
+      return max_active_cutoff;
+  }
+  if (min_active == 0)
+    return beam_cutoff;
+  std::nth_element(costs.begin(), costs.begin() + min_active,
+                   costs.size() > max_active ?
+                   costs.begin() + max_active : costs.end());
+  return std::max(costs[min_active], beam_cutoff);
+}
+
+void LatticeBatchDecoder::InitLane(Lane *lane) {
+  Token start;
+  start.state = fst_.Start();
+  start.cost = 0.0;
+  start.best_arc = -1;
+  lane->tokens.clear();
+  lane->tokens.push_back(start);
+  lane->frame_offsets.clear();
+  lane->frame_offsets.push_back(0);
+  lane->frame_offsets.push_back(1);
+  lane->arcs.clear();
+  lane->cost_offsets.clear();
+  lane->ok = true;
+  ProcessNonemitting(lane);
+}
+
+void LatticeBatchDecoder::ProcessEmitting(DecodableInterface *decodable,
+                                          Lane *lane) {
+  std::vector<Token> &tokens = lane->tokens;
+  int32 frame = lane->frame_offsets.size() - 2,
+      begin = lane->frame_offsets[frame],
+      end = lane->frame_offsets[frame + 1];
+
+  // the costs of the new tokens are relative to the best token of this frame.
+  BaseFloat cost_offset = std::numeric_limits<BaseFloat>::infinity();
+  for (int32 t = begin; t < end; t++)
+    cost_offset = std::min(cost_offset, tokens[t].cost);
+  cost_offset = -cost_offset;
+  lane->cost_offsets.push_back(cost_offset);
+
+  // expand the arcs, keeping the best cost of each state.
+  candidates_.clear();
+  for (int32 t = begin; t < end; t++) {
+    int32 state = tokens[t].state;
+    int32 arc_end = fst_.ArcsEnd(state);
+    for (int32 a = fst_.EmittingArcsBegin(state); a < arc_end; a++) {
+      const CsrFst::Arc &fst_arc = fst_.GetArc(a);
+      Candidate candidate;
+      candidate.prev_token = t;
+      candidate.arc = a;
+      candidate.acoustic_cost = -decodable->LogLikelihood(frame,
+                                                          fst_arc.ilabel);
+      candidate.cost = tokens[t].cost + cost_offset + fst_arc.weight.Value() +
+          candidate.acoustic_cost;
+      int32 next_state = fst_arc.nextstate;
+      if (candidate.cost < state_cost_[next_state]) {
+        if (state_cost_[next_state] ==
+            std::numeric_limits<BaseFloat>::infinity())
+          touched_states_.push_back(next_state);
+        state_cost_[next_state] = candidate.cost;
+      }
+      candidates_.push_back(candidate);
+    }
+  }
+
+  // the tokens of the states within the cutoff, and the arcs into them.
+  BaseFloat cutoff = GetCutoff();
+  int32 new_begin = tokens.size();
+  for (size_t i = 0; i < touched_states_.size(); i++) {
+    int32 state = touched_states_[i];
+    if (state_cost_[state] < cutoff) {
+      Token token;
+      token.state = state;
+      token.cost = state_cost_[state];
+      token.best_arc = -1;
+      state_token_[state] = tokens.size();
+      tokens.push_back(token);
+    }
+  }
+  for (size_t i = 0; i < candidates_.size(); i++) {
+    const Candidate &candidate = candidates_[i];
+    const CsrFst::Arc &fst_arc = fst_.GetArc(candidate.arc);
+    int32 next_token = state_token_[fst_arc.nextstate];
+    if (next_token < 0 || candidate.cost >= cutoff)
+      continue;
+    TokenArc arc;
+    arc.prev_token = candidate.prev_token;
+    arc.next_token = next_token;
+    arc.ilabel = fst_arc.ilabel;
+    arc.olabel = fst_arc.olabel;
+    arc.graph_cost = fst_arc.weight.Value();
+    arc.acoustic_cost = candidate.acoustic_cost;
+    if (candidate.cost == tokens[next_token].cost &&
+        tokens[next_token].best_arc < 0)
+      tokens[next_token].best_arc = lane->arcs.size();
+    lane->arcs.push_back(arc);
+  }
+  lane->frame_offsets.push_back(tokens.size());
+  ResetStates();
+  if (static_cast<int32>(tokens.size()) == new_begin) {
+    KALDI_WARN << "No tokens survived on frame " << frame;
+    lane->ok = false;
+  }
+}
+
+void LatticeBatchDecoder::ProcessNonemitting(Lane *lane) {
+  std::vector<Token> &tokens = lane->tokens;
+  int32 begin = lane->frame_offsets[lane->frame_offsets.size() - 2];
+
+  std::vector<int32> queue;
+  for (int32 t = begin; t < static_cast<int32>(tokens.size()); t++) {
+    state_token_[tokens[t].state] = t;
+    state_cost_[tokens[t].state] = tokens[t].cost;
+    touched_states_.push_back(tokens[t].state);
+    queue.push_back(t);
+  }
+  BaseFloat cutoff = GetCutoff();
+
+  // relax the costs until none changes; the tokens whose cost came from a
+  // non-emitting arc have best_arc -2 until the arcs are kept below.
+  while (!queue.empty()) {
+    int32 t = queue.back();
+    queue.pop_back();
+    int32 state = tokens[t].state;
+    BaseFloat cost = tokens[t].cost;
+    int32 arc_end = fst_.EmittingArcsBegin(state);
+    for (int32 a = fst_.ArcsBegin(state); a < arc_end; a++) {
+      const CsrFst::Arc &fst_arc = fst_.GetArc(a);
+      BaseFloat next_cost = cost + fst_arc.weight.Value();
+      if (next_cost >= cutoff)
+        continue;
+      int32 next_state = fst_arc.nextstate,
+          next_token = state_token_[next_state];
+      if (next_token < 0) {
+        Token token;
+        token.state = next_state;
+        token.cost = next_cost;
+        token.best_arc = -2;
+        next_token = tokens.size();
+        tokens.push_back(token);
+        state_token_[next_state] = next_token;
+        touched_states_.push_back(next_state);
+      } else if (next_cost < tokens[next_token].cost) {
+        tokens[next_token].cost = next_cost;
+        tokens[next_token].best_arc = -2;
+      } else {
+        continue;
+      }
+      state_cost_[next_state] = next_cost;
+      queue.push_back(next_token);
+    }
+  }
+
+  int32 end = tokens.size();
+  for (int32 t = begin; t < end; t++) {
+    int32 state = tokens[t].state;
+    int32 arc_end = fst_.EmittingArcsBegin(state);
+    for (int32 a = fst_.ArcsBegin(state); a < arc_end; a++) {
+      const CsrFst::Arc &fst_arc = fst_.GetArc(a);
+      BaseFloat next_cost = tokens[t].cost + fst_arc.weight.Value();
+      int32 next_token = state_token_[fst_arc.nextstate];
+      if (next_token < 0 || next_cost >= cutoff)
+        continue;
+      TokenArc arc;
+      arc.prev_token = t;
+      arc.next_token = next_token;
+      arc.ilabel = 0;
+      arc.olabel = fst_arc.olabel;
+      arc.graph_cost = fst_arc.weight.Value();
+      arc.acoustic_cost = 0.0;
+      if (tokens[next_token].best_arc == -2 && next_token != t &&
+          next_cost == tokens[next_token].cost)
+        tokens[next_token].best_arc = lane->arcs.size();
+      lane->arcs.push_back(arc);
+    }
+  }
+  lane->frame_offsets.back() = end;
+  ResetStates();
+}
+
+void LatticeBatchDecoder::PruneTokens(Lane *lane) {
+  std::vector<Token> &tokens = lane->tokens;
+  std::vector<TokenArc> &arcs = lane->arcs;
+  std::vector<int32> &frame_offsets = lane->frame_offsets;
+  const BaseFloat delta = config_.lattice_beam * config_.prune_scale;
+  int32 num_tokens = tokens.size(), num_arcs = arcs.size(),
+      last_frame = frame_offsets.size() - 2;
+
+  // As in LatticeFasterDecoderTpl::PruneForwardLinks(), the extra cost of a
+  // token is how much worse the best path through it is than the best path to
+  // a token of the last frame (whose extra costs are zero), and that of an
+  // arc is the same for the best path through the arc.  Returns true if the
+  // extra cost of the token the arc leaves went down by more than delta.
+  extra_cost_.assign(num_tokens, std::numeric_limits<BaseFloat>::infinity());
+  for (int32 t = frame_offsets[last_frame]; t < num_tokens; t++)
+    extra_cost_[t] = 0.0;
+  std::vector<BaseFloat> arc_extra_cost(num_arcs);
+  auto update_extra_cost = [&] (int32 a, BaseFloat cost_offset) -> bool {
+    const TokenArc &arc = arcs[a];
+    BaseFloat extra_cost = extra_cost_[arc.next_token] +
+        ((tokens[arc.prev_token].cost + cost_offset + arc.graph_cost +
+          arc.acoustic_cost) - tokens[arc.next_token].cost);
+    KALDI_ASSERT(extra_cost == extra_cost);  // check for NaN
+    arc_extra_cost[a] = extra_cost;
+    if (extra_cost > config_.lattice_beam)
+      return false;
+    BaseFloat &prev_extra_cost = extra_cost_[arc.prev_token];
+    if (extra_cost >= prev_extra_cost)
+      return false;
+    bool changed = prev_extra_cost - extra_cost > delta;
+    prev_extra_cost = std::max<BaseFloat>(extra_cost, 0.0);
+    return changed;
+  };
+
+  // The arcs into the tokens of a frame are the emitting ones from the frame
+  // before and the non-emitting ones within the frame, which are not in
+  // topological order, so they are gone through until no extra cost changes
+  // by more than delta.
+  int32 arc_end = num_arcs;
+  for (int32 frame = last_frame; frame >= 0; frame--) {
+    int32 frame_begin = frame_offsets[frame], arc_begin = arc_end;
+    while (arc_begin > 0 && arcs[arc_begin - 1].next_token >= frame_begin)
+      arc_begin--;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int32 a = arc_begin; a < arc_end; a++)
+        if (arcs[a].prev_token >= frame_begin && update_extra_cost(a, 0.0))
+          changed = true;
+    }
+    for (int32 a = arc_begin; a < arc_end; a++)
+      if (arcs[a].prev_token < frame_begin)
+        update_extra_cost(a, lane->cost_offsets[frame - 1]);
+    arc_end = arc_begin;
+  }
+
+  // Keep the tokens and arcs within the lattice beam, and the best paths of
+  // the tokens kept (which only rounding could prune), so that GetBestPath()
+  // still works.
+  std::vector<bool> keep_token(num_tokens), keep_arc(num_arcs);
+  std::vector<int32> queue;
+  for (int32 t = 0; t < num_tokens; t++) {
+    keep_token[t] = (t == 0 || extra_cost_[t] <= config_.lattice_beam);
+    if (keep_token[t])
+      queue.push_back(t);
+  }
+  for (int32 a = 0; a < num_arcs; a++)
+    keep_arc[a] = arc_extra_cost[a] <= config_.lattice_beam &&
+        keep_token[arcs[a].prev_token] && keep_token[arcs[a].next_token];
+  while (!queue.empty()) {
+    int32 t = queue.back();
+    queue.pop_back();
+    int32 a = tokens[t].best_arc;
+    if (a < 0)
+      continue;
+    keep_arc[a] = true;
+    if (!keep_token[arcs[a].prev_token]) {
+      keep_token[arcs[a].prev_token] = true;
+      queue.push_back(arcs[a].prev_token);
+    }
+  }
+
+  // Renumber what is kept, in the same order.
+  std::vector<int32> new_token(num_tokens, -1), new_arc(num_arcs, -1);
+  int32 num_kept = 0;
+  for (int32 frame = 0; frame <= last_frame; frame++) {
+    int32 begin = frame_offsets[frame], end = frame_offsets[frame + 1];
+    frame_offsets[frame] = num_kept;
+    for (int32 t = begin; t < end; t++) {
+      if (keep_token[t]) {
+        new_token[t] = num_kept;
+        tokens[num_kept++] = tokens[t];
+      }
+    }
+  }
+  frame_offsets[last_frame + 1] = num_kept;
+  tokens.resize(num_kept);
+  int32 num_arcs_kept = 0;
+  for (int32 a = 0; a < num_arcs; a++) {
+    if (keep_arc[a]) {
+      TokenArc arc = arcs[a];
+      arc.prev_token = new_token[arc.prev_token];
+      arc.next_token = new_token[arc.next_token];
+      new_arc[a] = num_arcs_kept;
+      arcs[num_arcs_kept++] = arc;
+    }
+  }
+  arcs.resize(num_arcs_kept);
+  for (int32 t = 0; t < num_kept; t++)
+    if (tokens[t].best_arc >= 0)
+      tokens[t].best_arc = new_arc[tokens[t].best_arc];
+  KALDI_VLOG(4) << "Pruned tokens from " << num_tokens << " to " << num_kept
+                << " and arcs from " << num_arcs << " to " << num_arcs_kept;
+}
+
+bool LatticeBatchDecoder::Decode(
+    const std::vector<DecodableInterface*> &decodables) {
+  lanes_.clear();
+  lanes_.resize(decodables.size());
+  for (size_t l = 0; l < lanes_.size(); l++)
+    InitLane(&lanes_[l]);
+
+  // the lanes advance a frame at a time together.
+  bool any_active = true;
+  while (any_active) {
+    any_active = false;
+    for (size_t l = 0; l < lanes_.size(); l++) {
+      Lane &lane = lanes_[l];
+      if (!lane.ok || decodables[l]->IsLastFrame(NumFramesDecoded(l) - 1))
+        continue;
+      any_active = true;
+      ProcessEmitting(decodables[l], &lane);
+      if (lane.ok)
+        ProcessNonemitting(&lane);
+      if (lane.ok && NumFramesDecoded(l) % config_.prune_interval == 0)
+        PruneTokens(&lane);
+    }
+  }
+
+  bool any_ok = false;
+  for (size_t l = 0; l < lanes_.size(); l++)
+    any_ok = any_ok || lanes_[l].ok;
+  return any_ok;
+}
+
+void LatticeBatchDecoder::FinalCosts(
+    const Lane &lane, bool use_final_probs,
+    std::vector<BaseFloat> *final_costs) const {
+  int32 begin = lane.frame_offsets[lane.frame_offsets.size() - 2],
+      end = lane.frame_offsets.back();
+  final_costs->assign(end - begin, 0.0);
+  if (!use_final_probs)
+    return;
+  bool reached_final = false;
+  for (int32 t = begin; t < end; t++) {
+    (*final_costs)[t - begin] = fst_.FinalCost(lane.tokens[t].state);
+    if ((*final_costs)[t - begin] !=
+        std::numeric_limits<BaseFloat>::infinity())
+      reached_final = true;
+  }
+  if (!reached_final)
+    final_costs->assign(end - begin, 0.0);
+}
+
+bool LatticeBatchDecoder::ReachedFinal(int32 lane) const {
+  const Lane &this_lane = lanes_[lane];
+  if (!this_lane.ok)
+    return false;
+  int32 begin = this_lane.frame_offsets[this_lane.frame_offsets.size() - 2],
+      end = this_lane.frame_offsets.back();
+  for (int32 t = begin; t < end; t++)
+    if (fst_.FinalCost(this_lane.tokens[t].state) !=
+        std::numeric_limits<BaseFloat>::infinity())
+      return true;
+  return false;
+}
+
+bool LatticeBatchDecoder::GetBestPath(int32 lane, Lattice *ofst,
+                                      bool use_final_probs) const {
+  ofst->DeleteStates();
+  const Lane &this_lane = lanes_[lane];
+  if (!this_lane.ok)
+    return false;
+  std::vector<BaseFloat> final_costs;
+  FinalCosts(this_lane, use_final_probs, &final_costs);
+  int32 begin = this_lane.frame_offsets[this_lane.frame_offsets.size() - 2],
+      best_token = -1;
+  BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
+  for (size_t i = 0; i < final_costs.size(); i++) {
+    BaseFloat cost = this_lane.tokens[begin + i].cost + final_costs[i];
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_token = begin + i;
+    }
+  }
+  if (best_token < 0)
+    return false;
+
+  std::vector<int32> path;  // the arcs, last first
+  int32 t = best_token;
+  for (; this_lane.tokens[t].best_arc >= 0;
+       t = this_lane.arcs[this_lane.tokens[t].best_arc].prev_token) {
+    path.push_back(this_lane.tokens[t].best_arc);
+    if (path.size() > this_lane.arcs.size())
+      KALDI_ERR << "Cycle in the best path";
+  }
+  // only the start token has no arc into it; -2 would be a token whose best
+  // non-emitting arc was not found.
+  if (t != 0)
+    KALDI_ERR << "The best path of lane " << lane << " stops at token " << t
+              << " (best_arc " << this_lane.tokens[t].best_arc
+              << ") before the start";
+  ofst->AddState();
+  ofst->SetStart(0);
+  for (int32 i = path.size() - 1; i >= 0; i--) {
+    const TokenArc &arc = this_lane.arcs[path[i]];
+    int32 next_state = ofst->AddState();
+    ofst->AddArc(next_state - 1,
+                 LatticeArc(arc.ilabel, arc.olabel,
+                            LatticeWeight(arc.graph_cost, arc.acoustic_cost),
+                            next_state));
+  }
+  ofst->SetFinal(ofst->NumStates() - 1,
+                 LatticeWeight(final_costs[best_token - begin], 0.0));
+  return true;
+}
+
+bool LatticeBatchDecoder::GetRawLattice(int32 lane, Lattice *ofst,
+                                        bool use_final_probs) const {
+  ofst->DeleteStates();
+  const Lane &this_lane = lanes_[lane];
+  if (!this_lane.ok)
+    return false;
+  // a state per token, in order, so the start state is 0.
+  int32 num_tokens = this_lane.tokens.size();
+  ofst->ReserveStates(num_tokens);
+  for (int32 t = 0; t < num_tokens; t++)
+    ofst->AddState();
+  ofst->SetStart(0);
+  for (size_t i = 0; i < this_lane.arcs.size(); i++) {
+    const TokenArc &arc = this_lane.arcs[i];
+    ofst->AddArc(arc.prev_token,
+                 LatticeArc(arc.ilabel, arc.olabel,
+                            LatticeWeight(arc.graph_cost, arc.acoustic_cost),
+                            arc.next_token));
+  }
+  std::vector<BaseFloat> final_costs;
+  FinalCosts(this_lane, use_final_probs, &final_costs);
+  int32 begin = this_lane.frame_offsets[this_lane.frame_offsets.size() - 2];
+  for (size_t i = 0; i < final_costs.size(); i++)
+    if (final_costs[i] != std::numeric_limits<BaseFloat>::infinity())
+      ofst->SetFinal(begin + i, LatticeWeight(final_costs[i], 0.0));
+  // this also sorts it topologically and removes the states that are not on
+  // a path.
+  PruneLattice(config_.lattice_beam, ofst);
+  return ofst->NumStates() > 0;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,179 @@
+// decoder/lattice-batch-decoder.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_LATTICE_BATCH_DECODER_H_
+#define KALDI_DECODER_LATTICE_BATCH_DECODER_H_
+
+#include <vector>
+
+#include "itf/decodable-itf.h"
+#include "lat/kaldi-lattice.h"
+#include "decoder/csr-fst.h"
+#include "decoder/lattice-faster-decoder.h"
+
+namespace kaldi {
+
+/**
+   A lattice generating decoder that decodes a batch of utterances ("lanes")
+   frame by frame over a graph in CSR form (CsrFst).  It is laid out for
+   data-parallel token passing rather than for LatticeFasterDecoder's hash of
+   tokens: the tokens and the arcs between them of each frame are held in flat
+   arrays, indexed by token number, and each frame is decoded in passes that do
+   not depend on the order of their elements:
+     - the emitting arcs of the tokens of the last frame are expanded, and each
+       state's best cost is kept by a minimum (the atomic min of a device);
+     - the cutoff is the best cost plus the beam, tightened to --max-active
+       states (and loosened to --min-active);
+     - the tokens of the states within the cutoff are made and the arcs into
+       them kept;
+     - the non-emitting arcs of the new tokens are relaxed until no cost
+       changes, and then the arcs between the tokens are kept.
+   The output, from GetRawLattice(), is the same kind of raw state-level
+   lattice as LatticeFasterDecoder's (transition-ids as ilabels, scaled
+   acoustic costs), pruned with --lattice-beam; DecodeUtteranceLatticeBatch()
+   in decoder-wrappers.h writes it as DecodeUtteranceLatticeFaster() does.
+   Of LatticeFasterDecoderConfig it uses beam, max-active, min-active,
+   lattice-beam and prune-interval.
+
+   As in LatticeFasterDecoder, the costs of the tokens of each frame are
+   offset by minus the best cost of the frame before, so that they stay small
+   however long the utterance is, and every --prune-interval frames the tokens
+   and arcs that are not within --lattice-beam of the best path through a
+   token of the last frame are removed.
+*/
+class LatticeBatchDecoder {
+ public:
+  LatticeBatchDecoder(const CsrFst &fst,
+                      const LatticeFasterDecoderConfig &config);
+
+  const LatticeFasterDecoderConfig &GetOptions() const { return config_; }
+
+  /// Decodes the utterances together, one lane each.  Returns true if any of
+  /// them was decoded; for each, see Succeeded().
+  bool Decode(const std::vector<DecodableInterface*> &decodables);
+
+  int32 NumLanes() const { return lanes_.size(); }
+
+  /// False if all the tokens of the lane were pruned away.
+  bool Succeeded(int32 lane) const { return lanes_[lane].ok; }
+
+  int32 NumFramesDecoded(int32 lane) const {
+    return lanes_[lane].frame_offsets.size() - 2;
+  }
+
+  /// True if a final state was active on the last frame of the lane.
+  bool ReachedFinal(int32 lane) const;
+
+  /// A linear lattice of the best path of the lane.  If use_final_probs is
+  /// true and a final state was reached, the final-probs are included, else
+  /// they are all treated as one.  Returns false if the lane has no output.
+  bool GetBestPath(int32 lane, Lattice *ofst,
+                   bool use_final_probs = true) const;
+
+  /// The raw lattice of the lane, topologically sorted, with final-probs as
+  /// for GetBestPath().
+  bool GetRawLattice(int32 lane, Lattice *ofst,
+                     bool use_final_probs = true) const;
+
+ protected:
+  // CudaLatticeBatchDecoder fills in the lanes, and uses the rest.
+  struct Token {
+    int32 state;
+    BaseFloat cost;
+    // the arc into the token on the best path, -1 for the start token (and
+    // -2 while ProcessNonemitting() has not found it)
+    int32 best_arc;
+  };
+
+  struct TokenArc {
+    int32 prev_token;
+    int32 next_token;
+    int32 ilabel;
+    int32 olabel;
+    BaseFloat graph_cost;
+    BaseFloat acoustic_cost;
+  };
+
+  struct Lane {
+    // the tokens of frame f are [frame_offsets[f], frame_offsets[f+1]), frame
+    // 0 is before the first acoustic frame.
+    std::vector<Token> tokens;
+    std::vector<int32> frame_offsets;
+    // the arcs into the tokens of each frame are after those into the frames
+    // before.
+    std::vector<TokenArc> arcs;
+    // cost_offsets[f] is added to the costs of the emitting arcs out of the
+    // tokens of frame f; the costs of the arcs are not offset.
+    std::vector<BaseFloat> cost_offsets;
+    bool ok;
+  };
+
+  // an expanded emitting arc, a token of the next frame if it survives
+  struct Candidate {
+    int32 prev_token;
+    int32 arc;
+    BaseFloat acoustic_cost;
+    BaseFloat cost;
+  };
+
+  void InitLane(Lane *lane);
+
+  // the tokens of the next frame from the emitting arcs
+  void ProcessEmitting(DecodableInterface *decodable, Lane *lane);
+
+  // adds the tokens reached by non-emitting arcs to the last frame
+  void ProcessNonemitting(Lane *lane);
+
+  // removes the tokens and arcs that are not within the lattice beam, as
+  // LatticeFasterDecoderTpl::PruneActiveTokens() does.
+  void PruneTokens(Lane *lane);
+
+  // the cost of the state, or of its token, on the frame being made
+  BaseFloat StateCost(int32 state) const { return state_cost_[state]; }
+
+  // the cutoff for the costs of touched_states_
+  BaseFloat GetCutoff() const;
+
+  // forgets the costs of touched_states_
+  void ResetStates();
+
+  // the final cost of each token of the last frame, all zero if
+  // !use_final_probs or no final state was reached
+  void FinalCosts(const Lane &lane, bool use_final_probs,
+                  std::vector<BaseFloat> *final_costs) const;
+
+  const CsrFst &fst_;
+  const LatticeFasterDecoderConfig &config_;
+  std::vector<Lane> lanes_;
+
+  // per state, reset after each frame: the best cost on the frame being made
+  // and the token, or infinity and -1.
+  std::vector<BaseFloat> state_cost_;
+  std::vector<int32> state_token_;
+  std::vector<int32> touched_states_;
+  std::vector<Candidate> candidates_;
+  // per token, for PruneTokens()
+  std::vector<BaseFloat> extra_cost_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeBatchDecoder);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_LATTICE_BATCH_DECODER_H_
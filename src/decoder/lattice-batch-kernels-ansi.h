@@ -0,0 +1,93 @@
+// decoder/lattice-batch-kernels-ansi.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_DECODER_LATTICE_BATCH_KERNELS_ANSI_H_
+#define KALDI_DECODER_LATTICE_BATCH_KERNELS_ANSI_H_
+#include "decoder/lattice-batch-datastruct.h"
+
+#if HAVE_CUDA == 1
+extern "C" {
+
+  // Zeroes the counts and the histogram and sets the best cost to infinity.
+  // Launch with one block.
+  void cuda_lattice_batch_start_frame(dim3 Gr, dim3 Bl,
+                                      LatticeBatchFrame frame,
+                                      int32_cuda num_bins);
+
+  // Gives the start state cost zero, for the frame before the first.  Launch
+  // with one thread.
+  void cuda_lattice_batch_start_lane(dim3 Gr, dim3 Bl,
+                                     LatticeBatchFrame frame,
+                                     int32_cuda start_state);
+
+  // Expands the emitting arcs of the num_prev_tokens tokens of the frame
+  // before, whose costs are offset by cost_offset; loglikes is the row of
+  // log-likelihoods of the frame, indexed by pdf-id.
+  void cuda_lattice_batch_expand_emitting(dim3 Gr, dim3 Bl,
+                                          LatticeBatchGraph graph,
+                                          LatticeBatchFrame frame,
+                                          int32_cuda num_prev_tokens,
+                                          BaseFloat cost_offset,
+                                          const BaseFloat *loglikes);
+
+  // Counts the touched states in num_bins bins of the beam above the best cost.
+  void cuda_lattice_batch_histogram(dim3 Gr, dim3 Bl,
+                                    LatticeBatchFrame frame,
+                                    BaseFloat beam, int32_cuda num_bins);
+
+  // Sets the cutoff from the best cost and the histogram.  Launch with one
+  // thread.
+  void cuda_lattice_batch_cutoff(dim3 Gr, dim3 Bl, LatticeBatchFrame frame,
+                                 BaseFloat beam, int32_cuda max_active,
+                                 int32_cuda min_active, int32_cuda num_bins);
+
+  // Queues the touched states within the cutoff in queue 0.
+  void cuda_lattice_batch_queue_states(dim3 Gr, dim3 Bl,
+                                       LatticeBatchFrame frame);
+
+  // Relaxes the non-emitting arcs of the states in queue "queue", and queues
+  // the states whose costs go down in the other one, whose count must have
+  // been zeroed.
+  void cuda_lattice_batch_expand_nonemitting(dim3 Gr, dim3 Bl,
+                                             LatticeBatchGraph graph,
+                                             LatticeBatchFrame frame,
+                                             int32_cuda queue);
+
+  // Makes the tokens of the touched states within the cutoff.
+  void cuda_lattice_batch_make_tokens(dim3 Gr, dim3 Bl,
+                                      LatticeBatchFrame frame);
+
+  // Keeps the arcs into the tokens: the expanded emitting arcs, and the
+  // non-emitting arcs between the tokens.
+  void cuda_lattice_batch_make_arcs(dim3 Gr, dim3 Bl, LatticeBatchGraph graph,
+                                    LatticeBatchFrame frame);
+
+  // Forgets the costs and tokens of the touched states, or of all the states
+  // if all_states is nonzero.
+  void cuda_lattice_batch_reset_states(dim3 Gr, dim3 Bl,
+                                       LatticeBatchFrame frame,
+                                       int32_cuda num_states,
+                                       int32_cuda all_states);
+
+} // extern "C"
+
+#endif  // HAVE_CUDA
+
+#endif  // KALDI_DECODER_LATTICE_BATCH_KERNELS_ANSI_H_
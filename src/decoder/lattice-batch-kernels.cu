@@ -0,0 +1,356 @@
+// decoder/lattice-batch-kernels.cu
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cfloat>
+#include "decoder/lattice-batch-kernels-ansi.h"
+
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 200
+#error - Kaldi no longer supports CC1.x devices. Please use a newer GPU or \
+         configure with --use-cuda=no (this will disable the use of GPU).
+#endif
+
+// The costs of states are kept as codes that are ordered as the costs are, so
+// that the best cost of each state, and of the frame, is an atomicMin() of
+// the codes: a cost that is not negative gets its sign bit set, and a negative
+// one has all its bits flipped.  The costs are floats (see
+// CudaLatticeBatchDecoder).
+static const uint32_cuda kInfCode = 0xff800000u;  // the code of +infinity
+
+static __device__ inline uint32_cuda CostToCode(BaseFloat cost) {
+  uint32_cuda bits = __float_as_uint(cost);
+  return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static __device__ inline BaseFloat CodeToCost(uint32_cuda code) {
+  return __uint_as_float((code & 0x80000000u) ? (code & 0x7fffffffu) : ~code);
+}
+
+static __device__ inline void AddTouchedState(const LatticeBatchFrame &frame,
+                                              int32_cuda state) {
+  int32_cuda i = atomicAdd(frame.counts + kLatticeBatchNumTouched, 1);
+  if (i < frame.max_tokens)
+    frame.touched_states[i] = state;
+  else
+    frame.counts[kLatticeBatchOverflow] = 1;
+}
+
+static __device__ inline void QueueState(const LatticeBatchFrame &frame,
+                                         int32_cuda queue, int32_cuda state) {
+  int32_cuda i = atomicAdd(frame.counts + kLatticeBatchNumQueued + queue, 1);
+  if (i < frame.max_tokens)
+    frame.queues[queue][i] = state;
+  else
+    frame.counts[kLatticeBatchOverflow] = 1;
+}
+
+static __device__ inline int32_cuda NumTouched(const LatticeBatchFrame &frame) {
+  return min(frame.counts[kLatticeBatchNumTouched], frame.max_tokens);
+}
+
+
+__global__
+static void _lattice_batch_start_frame(LatticeBatchFrame frame,
+                                       int32_cuda num_bins) {
+  for (int32_cuda i = threadIdx.x; i < kLatticeBatchNumCounts; i += blockDim.x)
+    frame.counts[i] = 0;
+  for (int32_cuda i = threadIdx.x; i < num_bins; i += blockDim.x)
+    frame.histogram[i] = 0;
+  if (threadIdx.x == 0)
+    *frame.best_cost = kInfCode;
+}
+
+__global__
+static void _lattice_batch_start_lane(LatticeBatchFrame frame,
+                                      int32_cuda start_state) {
+  frame.state_costs[start_state] = CostToCode(0.0);
+  frame.touched_states[0] = start_state;
+  frame.counts[kLatticeBatchNumTouched] = 1;
+  *frame.best_cost = CostToCode(0.0);
+}
+
+// One thread per token; the costs are added up in the same order as in
+// LatticeBatchDecoder::ProcessEmitting(), so that the host can find the best
+// arc into each token by comparing them.
+__global__
+static void _lattice_batch_expand_emitting(LatticeBatchGraph graph,
+                                           LatticeBatchFrame frame,
+                                           int32_cuda num_prev_tokens,
+                                           BaseFloat cost_offset,
+                                           const BaseFloat *loglikes) {
+  for (int32_cuda t = blockIdx.x * blockDim.x + threadIdx.x;
+       t < num_prev_tokens; t += blockDim.x * gridDim.x) {
+    int32_cuda state = frame.prev_token_states[t],
+        arc_end = graph.arc_offsets[state + 1];
+    BaseFloat cost = frame.prev_token_costs[t] + cost_offset;
+    for (int32_cuda a = graph.emitting_offsets[state]; a < arc_end; a++) {
+      BaseFloat acoustic_cost = -loglikes[graph.pdfs[a]],
+          arc_cost = cost + graph.weights[a] + acoustic_cost;
+      int32_cuda next_state = graph.nextstates[a];
+      uint32_cuda code = CostToCode(arc_cost),
+          old_code = atomicMin(frame.state_costs + next_state, code);
+      if (old_code == kInfCode && code != kInfCode)
+        AddTouchedState(frame, next_state);
+      atomicMin(frame.best_cost, code);
+      int32_cuda i = atomicAdd(frame.counts + kLatticeBatchNumCandidates, 1);
+      if (i < frame.max_arcs) {
+        frame.candidate_prev_tokens[i] = t;
+        frame.candidate_arcs[i] = a;
+        frame.candidate_acoustic_costs[i] = acoustic_cost;
+        frame.candidate_costs[i] = arc_cost;
+      } else {
+        frame.counts[kLatticeBatchOverflow] = 1;
+      }
+    }
+  }
+}
+
+__global__
+static void _lattice_batch_histogram(LatticeBatchFrame frame, BaseFloat beam,
+                                     int32_cuda num_bins) {
+  int32_cuda num_touched = NumTouched(frame);
+  BaseFloat best_cost = CodeToCost(*frame.best_cost),
+      bins_per_cost = num_bins / beam;
+  for (int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x; i < num_touched;
+       i += blockDim.x * gridDim.x) {
+    BaseFloat extra_cost =
+        CodeToCost(frame.state_costs[frame.touched_states[i]]) - best_cost;
+    if (extra_cost < beam) {
+      int32_cuda bin = min(static_cast<int32_cuda>(extra_cost * bins_per_cost),
+                           num_bins - 1);
+      atomicAdd(frame.histogram + bin, 1);
+    }
+  }
+}
+
+// The same rules as LatticeFasterDecoderTpl::GetCutoff(), to the width of a
+// bin: the beam, tightened to about max_active states.  If fewer than
+// min_active states are within the beam, all are kept.
+__global__
+static void _lattice_batch_cutoff(LatticeBatchFrame frame, BaseFloat beam,
+                                  int32_cuda max_active, int32_cuda min_active,
+                                  int32_cuda num_bins) {
+  const BaseFloat infinity = __int_as_float(0x7f800000);
+  int32_cuda num_touched = NumTouched(frame);
+  BaseFloat best_cost = CodeToCost(*frame.best_cost),
+      cutoff = best_cost + beam;
+  if (num_touched <= min_active) {
+    cutoff = infinity;
+  } else {
+    int32_cuda count = 0, bin = 0;
+    for (; bin < num_bins; bin++) {
+      count += frame.histogram[bin];
+      if (count > max_active)
+        break;
+    }
+    if (bin < num_bins)
+      cutoff = best_cost + beam * (bin + 1) / num_bins;
+    else if (count < min_active)
+      cutoff = infinity;
+  }
+  *frame.cutoff = cutoff;
+}
+
+__global__
+static void _lattice_batch_queue_states(LatticeBatchFrame frame) {
+  int32_cuda num_touched = NumTouched(frame);
+  BaseFloat cutoff = *frame.cutoff;
+  for (int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x; i < num_touched;
+       i += blockDim.x * gridDim.x) {
+    int32_cuda state = frame.touched_states[i];
+    if (CodeToCost(frame.state_costs[state]) < cutoff)
+      QueueState(frame, 0, state);
+  }
+}
+
+// A state may get a better cost while its arcs are being relaxed; it is then
+// queued again, and relaxed with that cost by the next launch.
+__global__
+static void _lattice_batch_expand_nonemitting(LatticeBatchGraph graph,
+                                              LatticeBatchFrame frame,
+                                              int32_cuda queue) {
+  int32_cuda num_queued = min(frame.counts[kLatticeBatchNumQueued + queue],
+                              frame.max_tokens);
+  BaseFloat cutoff = *frame.cutoff;
+  for (int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x; i < num_queued;
+       i += blockDim.x * gridDim.x) {
+    int32_cuda state = frame.queues[queue][i],
+        arc_end = graph.emitting_offsets[state];
+    BaseFloat cost = CodeToCost(frame.state_costs[state]);
+    for (int32_cuda a = graph.arc_offsets[state]; a < arc_end; a++) {
+      BaseFloat next_cost = cost + graph.weights[a];
+      if (!(next_cost < cutoff))
+        continue;
+      int32_cuda next_state = graph.nextstates[a];
+      uint32_cuda code = CostToCode(next_cost),
+          old_code = atomicMin(frame.state_costs + next_state, code);
+      if (code < old_code) {
+        if (old_code == kInfCode)
+          AddTouchedState(frame, next_state);
+        QueueState(frame, 1 - queue, next_state);
+      }
+    }
+  }
+}
+
+__global__
+static void _lattice_batch_make_tokens(LatticeBatchFrame frame) {
+  int32_cuda num_touched = NumTouched(frame);
+  BaseFloat cutoff = *frame.cutoff;
+  for (int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x; i < num_touched;
+       i += blockDim.x * gridDim.x) {
+    int32_cuda state = frame.touched_states[i];
+    BaseFloat cost = CodeToCost(frame.state_costs[state]);
+    if (cost < cutoff) {
+      int32_cuda t = atomicAdd(frame.counts + kLatticeBatchNumTokens, 1);
+      if (t < frame.max_tokens) {
+        frame.token_states[t] = state;
+        frame.token_costs[t] = cost;
+        frame.state_tokens[state] = t;
+      } else {
+        frame.counts[kLatticeBatchOverflow] = 1;
+      }
+    }
+  }
+}
+
+__global__
+static void _lattice_batch_make_arcs(LatticeBatchGraph graph,
+                                     LatticeBatchFrame frame) {
+  BaseFloat cutoff = *frame.cutoff;
+  int32_cuda num_candidates = min(frame.counts[kLatticeBatchNumCandidates],
+                                  frame.max_arcs),
+      num_tokens = min(frame.counts[kLatticeBatchNumTokens], frame.max_tokens);
+  for (int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+       i < num_candidates; i += blockDim.x * gridDim.x) {
+    int32_cuda a = frame.candidate_arcs[i],
+        next_token = frame.state_tokens[graph.nextstates[a]];
+    if (next_token < 0 || !(frame.candidate_costs[i] < cutoff))
+      continue;
+    int32_cuda j = atomicAdd(frame.counts + kLatticeBatchNumEmittingArcs, 1);
+    if (j < frame.max_arcs) {
+      frame.arc_prev_tokens[j] = frame.candidate_prev_tokens[i];
+      frame.arc_next_tokens[j] = next_token;
+      frame.arc_arcs[j] = a;
+      frame.arc_acoustic_costs[j] = frame.candidate_acoustic_costs[i];
+    } else {
+      frame.counts[kLatticeBatchOverflow] = 1;
+    }
+  }
+  for (int32_cuda t = blockIdx.x * blockDim.x + threadIdx.x; t < num_tokens;
+       t += blockDim.x * gridDim.x) {
+    int32_cuda state = frame.token_states[t],
+        arc_end = graph.emitting_offsets[state];
+    BaseFloat cost = frame.token_costs[t];
+    for (int32_cuda a = graph.arc_offsets[state]; a < arc_end; a++) {
+      int32_cuda next_token = frame.state_tokens[graph.nextstates[a]];
+      if (next_token < 0 || !(cost + graph.weights[a] < cutoff))
+        continue;
+      int32_cuda j = atomicAdd(frame.counts + kLatticeBatchNumNonemittingArcs,
+                               1);
+      if (j < frame.max_arcs) {
+        j += frame.max_arcs;
+        frame.arc_prev_tokens[j] = t;
+        frame.arc_next_tokens[j] = next_token;
+        frame.arc_arcs[j] = a;
+        frame.arc_acoustic_costs[j] = 0.0;
+      } else {
+        frame.counts[kLatticeBatchOverflow] = 1;
+      }
+    }
+  }
+}
+
+__global__
+static void _lattice_batch_reset_states(LatticeBatchFrame frame,
+                                        int32_cuda num_states,
+                                        int32_cuda all_states) {
+  int32_cuda n = all_states ? num_states : NumTouched(frame);
+  for (int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x; i < n;
+       i += blockDim.x * gridDim.x) {
+    int32_cuda state = all_states ? i : frame.touched_states[i];
+    frame.state_costs[state] = kInfCode;
+    frame.state_tokens[state] = -1;
+  }
+}
+
+
+void cuda_lattice_batch_start_frame(dim3 Gr, dim3 Bl,
+                                    LatticeBatchFrame frame,
+                                    int32_cuda num_bins) {
+  _lattice_batch_start_frame<<<Gr,Bl>>>(frame, num_bins);
+}
+
+void cuda_lattice_batch_start_lane(dim3 Gr, dim3 Bl,
+                                   LatticeBatchFrame frame,
+                                   int32_cuda start_state) {
+  _lattice_batch_start_lane<<<Gr,Bl>>>(frame, start_state);
+}
+
+void cuda_lattice_batch_expand_emitting(dim3 Gr, dim3 Bl,
+                                        LatticeBatchGraph graph,
+                                        LatticeBatchFrame frame,
+                                        int32_cuda num_prev_tokens,
+                                        BaseFloat cost_offset,
+                                        const BaseFloat *loglikes) {
+  _lattice_batch_expand_emitting<<<Gr,Bl>>>(graph, frame, num_prev_tokens,
+                                            cost_offset, loglikes);
+}
+
+void cuda_lattice_batch_histogram(dim3 Gr, dim3 Bl,
+                                  LatticeBatchFrame frame,
+                                  BaseFloat beam, int32_cuda num_bins) {
+  _lattice_batch_histogram<<<Gr,Bl>>>(frame, beam, num_bins);
+}
+
+void cuda_lattice_batch_cutoff(dim3 Gr, dim3 Bl, LatticeBatchFrame frame,
+                               BaseFloat beam, int32_cuda max_active,
+                               int32_cuda min_active, int32_cuda num_bins) {
+  _lattice_batch_cutoff<<<Gr,Bl>>>(frame, beam, max_active, min_active,
+                                   num_bins);
+}
+
+void cuda_lattice_batch_queue_states(dim3 Gr, dim3 Bl,
+                                     LatticeBatchFrame frame) {
+  _lattice_batch_queue_states<<<Gr,Bl>>>(frame);
+}
+
+void cuda_lattice_batch_expand_nonemitting(dim3 Gr, dim3 Bl,
+                                           LatticeBatchGraph graph,
+                                           LatticeBatchFrame frame,
+                                           int32_cuda queue) {
+  _lattice_batch_expand_nonemitting<<<Gr,Bl>>>(graph, frame, queue);
+}
+
+void cuda_lattice_batch_make_tokens(dim3 Gr, dim3 Bl,
+                                    LatticeBatchFrame frame) {
+  _lattice_batch_make_tokens<<<Gr,Bl>>>(frame);
+}
+
+void cuda_lattice_batch_make_arcs(dim3 Gr, dim3 Bl, LatticeBatchGraph graph,
+                                  LatticeBatchFrame frame) {
+  _lattice_batch_make_arcs<<<Gr,Bl>>>(graph, frame);
+}
+
+void cuda_lattice_batch_reset_states(dim3 Gr, dim3 Bl,
+                                     LatticeBatchFrame frame,
+                                     int32_cuda num_states,
+                                     int32_cuda all_states) {
+  _lattice_batch_reset_states<<<Gr,Bl>>>(frame, num_states, all_states);
+}
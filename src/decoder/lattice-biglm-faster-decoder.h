@@ -29,6 +29,7 @@
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
 #include "decoder/lattice-faster-decoder.h" // for options.
+#include "decoder/lm-arc-cache.h"
 
 
 namespace kaldi {
@@ -54,12 +55,15 @@ class LatticeBiglmFasterDecoder {
   typedef uint64 PairId;
   typedef Arc::Weight Weight;
   // instantiate this class once for each thing you have to decode.
+  // The arcs of lm_diff_fst are cached (see LmArcCache), up to lm_cache_size
+  // of them; 0 disables the cache.
   LatticeBiglmFasterDecoder(
       const fst::Fst<fst::StdArc> &fst,      
       const LatticeBiglmFasterDecoderConfig &config,
-      fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst):
-      fst_(fst), lm_diff_fst_(lm_diff_fst), config_(config),
-      warned_noarc_(false), num_toks_(0) {
+      fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst,
+      int32 lm_cache_size = 250000):
+      fst_(fst), lm_diff_fst_(lm_diff_fst), lm_cache_(lm_diff_fst, lm_cache_size),
+      config_(config), warned_noarc_(false), num_toks_(0) {
     config.Check();
     KALDI_ASSERT(fst.Start() != fst::kNoStateId &&
                  lm_diff_fst->Start() != fst::kNoStateId);
@@ -666,7 +670,7 @@ class LatticeBiglmFasterDecoder {
       return lm_state; // no change in LM state if no word crossed.
     } else { // Propagate in the LM-diff FST.
       Arc lm_arc;
-      bool ans = lm_diff_fst_->GetArc(lm_state, arc->olabel, &lm_arc);
+      bool ans = lm_cache_.GetArc(lm_state, arc->olabel, &lm_arc);
       if (!ans) { // this case is unexpected for statistical LMs.
         if (!warned_noarc_) {
           warned_noarc_ = true;
@@ -840,6 +844,7 @@ class LatticeBiglmFasterDecoder {
   // make it class member to avoid internal new/delete.
   const fst::Fst<fst::StdArc> &fst_;
   fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst_;  
+  LmArcCache lm_cache_;  // called instead of lm_diff_fst_->GetArc().
   LatticeBiglmFasterDecoderConfig config_;
   bool warned_noarc_;  
   int32 num_toks_; // current total #toks allocated...
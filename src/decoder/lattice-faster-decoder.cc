@@ -30,7 +30,10 @@ template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
     const FST &fst,
     const LatticeFasterDecoderConfig &config):
-    fst_(&fst), delete_fst_(false), config_(config), num_toks_(0) {
+    fst_(&fst), delete_fst_(false),
+    arcs_thread_safe_(decoder::ArcIteratorsThreadSafe(fst)),
+    expand_threads_warned_(false), config_(config), cur_beam_(config.beam),
+    cur_max_active_(config.max_active), num_toks_(0), chunk_begin_frame_(0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -39,7 +42,10 @@ LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
 template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
     const LatticeFasterDecoderConfig &config, FST *fst):
-    fst_(fst), delete_fst_(true), config_(config), num_toks_(0) {
+    fst_(fst), delete_fst_(true),
+    arcs_thread_safe_(decoder::ArcIteratorsThreadSafe(*fst)),
+    expand_threads_warned_(false), config_(config), cur_beam_(config.beam),
+    cur_max_active_(config.max_active), num_toks_(0), chunk_begin_frame_(0) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -62,14 +68,44 @@ void LatticeFasterDecoderTpl<FST, Token>::InitDecoding() {
   num_toks_ = 0;
   decoding_finalized_ = false;
   final_costs_.clear();
+  chunk_begin_frame_ = 0;
+  chunk_token_labels_.clear();
+  cur_beam_ = config_.beam;
+  cur_max_active_ = config_.max_active;
+  rtf_window_frames_ = 0;
+  rtf_window_seconds_ = 0.0;
+  rtf_window_toks_ = 0.0;
+  rtf_stats_.Reset();
   StateId start_state = fst_->Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL, NULL);
+  Token *start_tok = new (token_pool_.Allocate())
+      Token(0.0, 0.0, NULL, NULL, NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
-  ProcessNonemitting(config_.beam);
+  ProcessNonemitting(cur_beam_);
+}
+
+void LatticeFasterDecoderRtfStats::Reset() {
+  num_frames = 0;
+  decode_seconds = 0.0;
+  num_narrowed = 0;
+  num_widened = 0;
+  beam_sum = 0.0;
+  min_beam = std::numeric_limits<BaseFloat>::infinity();
+  min_max_active = std::numeric_limits<int32>::max();
+}
+
+void LatticeFasterDecoderRtfStats::Print(const std::string &utt,
+                                         BaseFloat frame_shift) const {
+  if (num_frames == 0) return;
+  KALDI_LOG << "For utterance " << utt << ", real-time factor was "
+            << (decode_seconds / (num_frames * frame_shift)) << "; beam was "
+            << "narrowed " << num_narrowed << " and widened " << num_widened
+            << " times, average beam " << (beam_sum / num_frames)
+            << ", smallest beam " << min_beam << " and max-active "
+            << min_max_active;
 }
 
 // Returns true if any kind of traceback is available (not necessarily from
@@ -77,17 +113,21 @@ void LatticeFasterDecoderTpl<FST, Token>::InitDecoding() {
 // an unusual search error.
 template <typename FST, typename Token>
 bool LatticeFasterDecoderTpl<FST, Token>::Decode(DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::Decode");
   InitDecoding();
 
   // We use 1-based indexing for frames in this decoder (if you view it in
   // terms of features), but note that the decodable object uses zero-based
   // numbering, which we have to correct for when we call it.
 
+  Timer frame_timer;
   while (!decodable->IsLastFrame(NumFramesDecoded() - 1)) {
     if (NumFramesDecoded() % config_.prune_interval == 0)
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
     BaseFloat cost_cutoff = ProcessEmitting(decodable);
     ProcessNonemitting(cost_cutoff);
+    if (config_.target_rtf > 0.0)
+      AdjustBeamForRtf(&frame_timer);
   }
   FinalizeDecoding();
 
@@ -196,12 +236,109 @@ bool LatticeFasterDecoderTpl<FST, Token>::GetRawLattice(
 }
 
 
+template <typename FST, typename Token>
+bool LatticeFasterDecoderTpl<FST, Token>::GetRawLatticeChunk(
+    int32 end_frame, bool is_last, RawLatticeChunk *chunk) {
+  typedef LatticeArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  int32 begin_frame = chunk_begin_frame_;
+  KALDI_ASSERT(begin_frame <= end_frame && end_frame <= NumFramesDecoded() &&
+               (!is_last || end_frame == NumFramesDecoded()));
+  unordered_map<Token*, BaseFloat> final_costs_local;
+  const unordered_map<Token*, BaseFloat> &final_costs =
+      (decoding_finalized_ ? final_costs_ : final_costs_local);
+  if (is_last && !decoding_finalized_)
+    ComputeFinalCosts(&final_costs_local, NULL, NULL);
+
+  Lattice *ofst = &(chunk->lat);
+  ofst->DeleteStates();
+  chunk->begin_tokens.clear();
+  chunk->end_tokens.clear();
+  chunk->end_costs.clear();
+  chunk->is_last = is_last;
+  unordered_map<Token*, StateId> tok_map;
+  std::vector<Token*> token_list;
+  for (int32 f = begin_frame; f <= end_frame; f++) {
+    if (active_toks_[f].toks == NULL) {
+      KALDI_WARN << "GetRawLatticeChunk: no tokens active on frame " << f
+                 << ": not producing lattice.\n";
+      return false;
+    }
+    TopSortTokens(active_toks_[f].toks, &token_list);
+    for (size_t i = 0; i < token_list.size(); i++)
+      if (token_list[i] != NULL)
+        tok_map[token_list[i]] = ofst->AddState();
+  }
+  ofst->SetStart(0);
+
+  // the links of the frames of the chunk; those of frame end_frame belong to
+  // the next chunk, unless this is the last.
+  int32 last_links_frame = (is_last ? end_frame : end_frame - 1);
+  for (int32 f = begin_frame; f <= last_links_frame; f++) {
+    for (Token *tok = active_toks_[f].toks; tok != NULL; tok = tok->next) {
+      StateId cur_state = tok_map[tok];
+      for (ForwardLinkT *l = tok->links; l != NULL; l = l->next) {
+        typename unordered_map<Token*, StateId>::const_iterator
+            iter = tok_map.find(l->next_tok);
+        KALDI_ASSERT(iter != tok_map.end());
+        BaseFloat cost_offset = 0.0;
+        if (l->ilabel != 0) {  // emitting..
+          KALDI_ASSERT(f >= 0 && f < cost_offsets_.size());
+          cost_offset = cost_offsets_[f];
+        }
+        Arc arc(l->ilabel, l->olabel,
+                Weight(l->graph_cost, l->acoustic_cost - cost_offset),
+                iter->second);
+        ofst->AddArc(cur_state, arc);
+      }
+    }
+  }
+
+  if (begin_frame > 0) {
+    for (Token *tok = active_toks_[begin_frame].toks; tok != NULL;
+         tok = tok->next) {
+      typename unordered_map<Token*, int32>::const_iterator
+          iter = chunk_token_labels_.find(tok);
+      if (iter != chunk_token_labels_.end())
+        chunk->begin_tokens.push_back(std::make_pair(tok_map[tok],
+                                                     iter->second));
+    }
+  }
+  chunk_token_labels_.clear();
+  int32 label = 0;
+  for (Token *tok = active_toks_[end_frame].toks; tok != NULL;
+       tok = tok->next, label++) {
+    BaseFloat cost;
+    if (!is_last) {
+      // extra_cost - tot_cost is, up to a constant, the backward cost of the
+      // token as of when it was last pruned.
+      cost = tok->extra_cost - tok->tot_cost;
+      chunk_token_labels_[tok] = label;
+    } else if (final_costs.empty()) {
+      cost = 0.0;
+    } else {
+      typename unordered_map<Token*, BaseFloat>::const_iterator
+          iter = final_costs.find(tok);
+      cost = (iter != final_costs.end() ? iter->second :
+              std::numeric_limits<BaseFloat>::infinity());
+    }
+    chunk->end_tokens.push_back(std::make_pair(tok_map[tok], label));
+    chunk->end_costs.push_back(cost);
+  }
+  chunk_begin_frame_ = end_frame;
+  return true;
+}
+
+
 // This function is now deprecated, since now we do determinization from outside
 // the LatticeFasterDecoder class.  Outputs an FST corresponding to the
 // lattice-determinized lattice (one path per word sequence).
 template <typename FST, typename Token>
 bool LatticeFasterDecoderTpl<FST, Token>::GetLattice(CompactLattice *ofst,
                                            bool use_final_probs) const {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::GetLattice");
   Lattice raw_fst;
   GetRawLattice(&raw_fst, use_final_probs);
   Invert(&raw_fst);  // make it so word labels are on the input.
@@ -276,7 +413,8 @@ inline Token* LatticeFasterDecoderTpl<FST, Token>::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks, backpointer);
+    Token *new_tok = new (token_pool_.Allocate())
+        Token(tot_cost, extra_cost, NULL, toks, backpointer);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -353,7 +491,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinks(
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Free(link);
           link = next_link;  // advance link but leave prev_link the same.
           *links_pruned = true;
         } else {   // keep the link and update the tok_extra_cost if needed.
@@ -441,7 +579,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinksFinal() {
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Free(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -502,7 +640,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneTokensForFrame(int32 frame_plus_o
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      token_pool_.Free(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -622,20 +760,84 @@ void LatticeFasterDecoderTpl<FST, Token>::AdvanceDecoding(DecodableInterface *de
   if (max_num_frames >= 0)
     target_frames_decoded = std::min(target_frames_decoded,
                                      NumFramesDecoded() + max_num_frames);
+  // the timer is local so that time spent between calls (e.g. waiting for
+  // audio in online decoding) is not counted.
+  Timer frame_timer;
   while (NumFramesDecoded() < target_frames_decoded) {
     if (NumFramesDecoded() % config_.prune_interval == 0) {
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
     }
     BaseFloat cost_cutoff = ProcessEmitting(decodable);
     ProcessNonemitting(cost_cutoff);
+    if (config_.target_rtf > 0.0)
+      AdjustBeamForRtf(&frame_timer);
   }
 }
 
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::AdjustBeamForRtf(Timer *timer) {
+  double seconds = timer->Elapsed();
+  timer->Reset();
+  rtf_window_frames_++;
+  rtf_window_seconds_ += seconds;
+  rtf_stats_.num_frames++;
+  rtf_stats_.decode_seconds += seconds;
+  rtf_stats_.beam_sum += cur_beam_;
+  rtf_stats_.min_beam = std::min(rtf_stats_.min_beam, cur_beam_);
+  rtf_stats_.min_max_active = std::min(rtf_stats_.min_max_active,
+                                       cur_max_active_);
+  if (rtf_window_frames_ < config_.rtf_interval)
+    return;
+
+  // ratio > 1 means we are slower than the target.
+  double rtf = rtf_window_seconds_ /
+      (rtf_window_frames_ * config_.rtf_frame_shift),
+      ratio = rtf / config_.target_rtf,
+      avg_toks = rtf_window_toks_ / rtf_window_frames_;
+  rtf_window_frames_ = 0;
+  rtf_window_seconds_ = 0.0;
+  rtf_window_toks_ = 0.0;
+
+  // Decoding time is roughly proportional to the number of active tokens, so
+  // max-active is set from the tokens we actually saw; the beam, whose effect
+  // on the token count is roughly exponential, moves in smaller steps.  We
+  // widen only with clear headroom so as not to oscillate around the target.
+  BaseFloat min_beam = std::min(config_.rtf_min_beam, config_.beam);
+  int32 min_max_active = std::min(config_.max_active,
+                                  std::max(config_.rtf_min_max_active,
+                                           config_.min_active + 1));
+  if (ratio > 1.0) {
+    double scale = std::max(0.5, 1.0 / ratio),
+        new_max_active = std::min(static_cast<double>(cur_max_active_),
+                                  avg_toks * scale);
+    BaseFloat old_beam = cur_beam_;
+    int32 old_max_active = cur_max_active_;
+    cur_beam_ = std::max(min_beam,
+                         static_cast<BaseFloat>(cur_beam_ * std::sqrt(scale)));
+    cur_max_active_ = std::max(min_max_active,
+                               static_cast<int32>(new_max_active));
+    if (cur_beam_ < old_beam || cur_max_active_ < old_max_active)
+      rtf_stats_.num_narrowed++;
+  } else if (ratio < 0.8 && (cur_beam_ < config_.beam ||
+                             cur_max_active_ < config_.max_active)) {
+    cur_beam_ = std::min(config_.beam, cur_beam_ * 1.05f);
+    double new_max_active = cur_max_active_ * 1.25;
+    cur_max_active_ = (new_max_active >= config_.max_active ?
+                       config_.max_active :
+                       static_cast<int32>(new_max_active));
+    rtf_stats_.num_widened++;
+  }
+  KALDI_VLOG(3) << "Real-time factor " << rtf << " over the last "
+                << config_.rtf_interval << " frames; beam is now "
+                << cur_beam_ << ", max-active " << cur_max_active_;
+}
+
 // FinalizeDecoding() is a version of PruneActiveTokens that we call
 // (optionally) on the final frame.  Takes into account the final-prob of
 // tokens.  This function used to be called PruneActiveTokensFinal().
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::FinalizeDecoding() {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::FinalizeDecoding");
   int32 final_frame_plus_one = NumFramesDecoded();
   int32 num_toks_begin = num_toks_;
   // PruneForwardLinksFinal() prunes final frame (with final-probs), and
@@ -659,7 +861,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
   // positive == high cost == bad.
   size_t count = 0;
-  if (config_.max_active == std::numeric_limits<int32>::max() &&
+  if (cur_max_active_ == std::numeric_limits<int32>::max() &&
       config_.min_active == 0) {
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       BaseFloat w = static_cast<BaseFloat>(e->val->tot_cost);
@@ -669,8 +871,8 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    if (adaptive_beam != NULL) *adaptive_beam = config_.beam;
-    return best_weight + config_.beam;
+    if (adaptive_beam != NULL) *adaptive_beam = cur_beam_;
+    return best_weight + cur_beam_;
   } else {
     tmp_array_.clear();
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
@@ -683,18 +885,18 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
     }
     if (tok_count != NULL) *tok_count = count;
 
-    BaseFloat beam_cutoff = best_weight + config_.beam,
+    BaseFloat beam_cutoff = best_weight + cur_beam_,
         min_active_cutoff = std::numeric_limits<BaseFloat>::infinity(),
         max_active_cutoff = std::numeric_limits<BaseFloat>::infinity();
 
     KALDI_VLOG(6) << "Number of tokens active on frame " << NumFramesDecoded()
                   << " is " << tmp_array_.size();
 
-    if (tmp_array_.size() > static_cast<size_t>(config_.max_active)) {
+    if (tmp_array_.size() > static_cast<size_t>(cur_max_active_)) {
       std::nth_element(tmp_array_.begin(),
-                       tmp_array_.begin() + config_.max_active,
+                       tmp_array_.begin() + cur_max_active_,
                        tmp_array_.end());
-      max_active_cutoff = tmp_array_[config_.max_active];
+      max_active_cutoff = tmp_array_[cur_max_active_];
     }
     if (max_active_cutoff < beam_cutoff) { // max_active is tighter than beam.
       if (adaptive_beam)
@@ -706,8 +908,8 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
       else {
         std::nth_element(tmp_array_.begin(),
                          tmp_array_.begin() + config_.min_active,
-                         tmp_array_.size() > static_cast<size_t>(config_.max_active) ?
-                         tmp_array_.begin() + config_.max_active :
+                         tmp_array_.size() > static_cast<size_t>(cur_max_active_) ?
+                         tmp_array_.begin() + cur_max_active_ :
                          tmp_array_.end());
         min_active_cutoff = tmp_array_[config_.min_active];
       }
@@ -717,7 +919,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
         *adaptive_beam = min_active_cutoff - best_weight + config_.beam_delta;
       return min_active_cutoff;
     } else {
-      *adaptive_beam = config_.beam;
+      *adaptive_beam = cur_beam_;
       return beam_cutoff;
     }
   }
@@ -726,6 +928,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
 template <typename FST, typename Token>
 BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
     DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessEmitting");
   KALDI_ASSERT(active_toks_.size() > 0);
   int32 frame = active_toks_.size() - 1; // frame is the frame-index
                                          // (zero-based) used to get likelihoods
@@ -743,6 +946,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
                 << adaptive_beam;
 
   PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.
+  rtf_window_toks_ += tok_cnt;
 
   BaseFloat next_cutoff = std::numeric_limits<BaseFloat>::infinity();
   // pruning "online" before having seen all tokens
@@ -754,6 +958,10 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   // First process the best token to get a hopefully
   // reasonably tight bound on the next cutoff.  The only
   // products of the next block are "next_cutoff" and "cost_offset".
+  // frame_computed is set once we have asked the decodable object for a
+  // likelihood of this frame, after which ExpandTokensParallel() may ask for
+  // others from several threads.
+  bool frame_computed = false;
   if (best_elem) {
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
@@ -763,6 +971,7 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
          aiter.Next()) {
       const Arc &arc = aiter.Value();
       if (arc.ilabel != 0) {  // propagate..
+        frame_computed = true;
         BaseFloat new_weight = arc.weight.Value() + cost_offset -
             decodable->LogLikelihood(frame, arc.ilabel) + tok->tot_cost;
         if (new_weight + adaptive_beam < next_cutoff)
@@ -777,6 +986,20 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   cost_offsets_.resize(frame + 1, 0.0);
   cost_offsets_[frame] = cost_offset;
 
+  if (config_.num_expand_threads > 1 && !expand_threads_warned_ &&
+      !(arcs_thread_safe_ && decodable->LogLikelihoodIsThreadSafe())) {
+    KALDI_WARN << "--expand-threads=" << config_.num_expand_threads
+               << " is not supported for this "
+               << (arcs_thread_safe_ ? "decodable object" : "FST type")
+               << "; expanding tokens in one thread.";
+    expand_threads_warned_ = true;
+  }
+  if (config_.num_expand_threads > 1 && arcs_thread_safe_ && frame_computed &&
+      decodable->LogLikelihoodIsThreadSafe() &&
+      tok_cnt >= static_cast<size_t>(config_.expand_min_tokens))
+    return ExpandTokensParallel(decodable, final_toks, frame, cur_cutoff,
+                                cost_offset, adaptive_beam, next_cutoff);
+
   // the tokens are now owned here, in final_toks, and the hash is empty.
   // 'owned' is a complex thing here; the point is we need to call DeleteElem
   // on each elem 'e' to let toks_ know we're done with them.
@@ -805,8 +1028,9 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
           // NULL: no change indicator needed
 
           // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLinkT(next_tok, arc.ilabel, arc.olabel,
-                                        graph_cost, ac_cost, tok->links);
+          tok->links = new (link_pool_.Allocate())
+              ForwardLinkT(next_tok, arc.ilabel, arc.olabel,
+                           graph_cost, ac_cost, tok->links);
         }
       } // for all arcs
     }
@@ -816,13 +1040,87 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   return next_cutoff;
 }
 
-// static inline
+template <typename FST, typename Token>
+BaseFloat LatticeFasterDecoderTpl<FST, Token>::ExpandTokensParallel(
+    DecodableInterface *decodable, Elem *final_toks, int32 frame,
+    BaseFloat cur_cutoff, BaseFloat cost_offset, BaseFloat adaptive_beam,
+    BaseFloat next_cutoff) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ExpandTokensParallel");
+  expand_toks_.clear();
+  for (Elem *e = final_toks, *e_tail; e != NULL; e = e_tail) {
+    if (e->val->tot_cost <= cur_cutoff)
+      expand_toks_.push_back(std::make_pair(e->key, e->val));
+    e_tail = e->tail;
+    toks_.Delete(e); // delete Elem; the Token stays.
+  }
+
+  int32 num_threads = config_.num_expand_threads;
+  expand_buffers_.resize(num_threads);
+  expand_cutoffs_.assign(num_threads, next_cutoff);
+  {
+    ExpandTask task(this, decodable, frame, cost_offset, adaptive_beam);
+    // the destructor waits for the threads.
+    MultiThreader<ExpandTask> threader(num_threads, task);
+  }
+  for (int32 t = 0; t < num_threads; t++)
+    next_cutoff = std::min(next_cutoff, expand_cutoffs_[t]);
+
+  // The threads' ranges are in the order of final_toks, so this adds the
+  // tokens and links in the same order as the single-threaded loop.
+  for (int32 t = 0; t < num_threads; t++) {
+    const std::vector<ExpandCandidate> &buffer = expand_buffers_[t];
+    for (size_t i = 0; i < buffer.size(); i++) {
+      const ExpandCandidate &c = buffer[i];
+      if (c.tot_cost > next_cutoff) continue;
+      Token *next_tok = FindOrAddToken(c.nextstate, frame + 1, c.tot_cost,
+                                       c.tok, NULL);
+      c.tok->links = new (link_pool_.Allocate())
+          ForwardLinkT(next_tok, c.ilabel, c.olabel,
+                       c.graph_cost, c.ac_cost, c.tok->links);
+    }
+  }
+  return next_cutoff;
+}
+
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::ExpandTask::operator() () {
+  const std::vector<std::pair<StateId, Token*> > &toks = decoder_->expand_toks_;
+  std::vector<ExpandCandidate> &buffer = decoder_->expand_buffers_[thread_id_];
+  buffer.clear();
+  size_t begin = toks.size() * thread_id_ / num_threads_,
+      end = toks.size() * (thread_id_ + 1) / num_threads_;
+  BaseFloat next_cutoff = decoder_->expand_cutoffs_[thread_id_];
+  const FST &fst = *(decoder_->fst_);
+  for (size_t i = begin; i < end; i++) {
+    Token *tok = toks[i].second;
+    for (fst::ArcIterator<FST> aiter(fst, toks[i].first);
+         !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel != 0) {
+        BaseFloat ac_cost = cost_offset_ -
+            decodable_->LogLikelihood(frame_, arc.ilabel),
+            graph_cost = arc.weight.Value(),
+            tot_cost = tok->tot_cost + ac_cost + graph_cost;
+        if (tot_cost > next_cutoff) continue;
+        else if (tot_cost + adaptive_beam_ < next_cutoff)
+          next_cutoff = tot_cost + adaptive_beam_;
+        ExpandCandidate c = { tok, arc.nextstate, arc.ilabel, arc.olabel,
+                              graph_cost, ac_cost, tot_cost };
+        buffer.push_back(c);
+      }
+    }
+  }
+  decoder_->expand_cutoffs_[thread_id_] = next_cutoff;
+}
+
+// inline
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(Token *tok) {
   ForwardLinkT *l = tok->links, *m;
   while (l != NULL) {
     m = l->next;
-    delete l;
+    link_pool_.Free(l);
     l = m;
   }
   tok->links = NULL;
@@ -831,6 +1129,7 @@ void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(Token *tok) {
 
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessNonemitting");
   KALDI_ASSERT(!active_toks_.empty());
   int32 frame = static_cast<int32>(active_toks_.size()) - 2;
   // Note: "frame" is the time-index we just processed, or -1 if
@@ -885,8 +1184,9 @@ void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
           Token *new_tok = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
                                           tok, &changed);
 
-          tok->links = new ForwardLinkT(new_tok, 0, arc.olabel,
-                                        graph_cost, 0, tok->links);
+          tok->links = new (link_pool_.Allocate())
+              ForwardLinkT(new_tok, 0, arc.olabel,
+                           graph_cost, 0, tok->links);
 
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
@@ -909,19 +1209,12 @@ void LatticeFasterDecoderTpl<FST, Token>::DeleteElems(Elem *list) {
 
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      DeleteForwardLinks(tok);
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
-    }
-  }
+  // All the tokens alive, and the forward links they may have, are freed at
+  // once with their pools.
+  token_pool_.FreeAll();
+  link_pool_.FreeAll();
+  num_toks_ = 0;
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
 }
 
 // static
@@ -1009,11 +1302,13 @@ template class LatticeFasterDecoderTpl<fst::Fst<fst::StdArc>, decoder::StdToken>
 template class LatticeFasterDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::StdToken >;
 template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::StdToken >;
 template class LatticeFasterDecoderTpl<fst::GrammarFst, decoder::StdToken>;
+template class LatticeFasterDecoderTpl<CsrFst, decoder::StdToken>;
 
 template class LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> , decoder::BackpointerToken>;
 template class LatticeFasterDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::BackpointerToken >;
 template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::BackpointerToken >;
 template class LatticeFasterDecoderTpl<fst::GrammarFst, decoder::BackpointerToken>;
+template class LatticeFasterDecoderTpl<CsrFst, decoder::BackpointerToken>;
 
 
 } // end namespace kaldi.
@@ -24,14 +24,18 @@
 #define KALDI_DECODER_LATTICE_FASTER_DECODER_H_
 
 
+#include "base/timer.h"
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/kaldi-thread.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
 #include "decoder/grammar-fst.h"
+#include "decoder/csr-fst.h"
+#include "decoder/lattice-incremental-determinizer.h"
 
 namespace kaldi {
 
@@ -52,6 +56,19 @@ struct LatticeFasterDecoderConfig {
   // LatticeFasterDecoder class itself, but by the code that calls it, for
   // example in the function DecodeUtteranceLatticeFaster.
   fst::DeterminizeLatticePhonePrunedOptions det_opts;
+  // The following options control the real-time controller, which narrows the
+  // effective beam and max-active when decoding runs slower than target_rtf,
+  // and widens them back towards beam and max_active when it runs faster.
+  // It is off if target_rtf == 0.
+  BaseFloat target_rtf;
+  BaseFloat rtf_frame_shift;  // seconds of audio per decoded frame.
+  int32 rtf_interval;  // frames between adjustments.
+  BaseFloat rtf_min_beam;
+  int32 rtf_min_max_active;
+  // If num_expand_threads > 1, frames with at least expand_min_tokens active
+  // tokens have their arcs expanded by that many threads.
+  int32 num_expand_threads;
+  int32 expand_min_tokens;
 
   LatticeFasterDecoderConfig(): beam(16.0),
                                 max_active(std::numeric_limits<int32>::max()),
@@ -61,7 +78,14 @@ struct LatticeFasterDecoderConfig {
                                 determinize_lattice(true),
                                 beam_delta(0.5),
                                 hash_ratio(2.0),
-                                prune_scale(0.1) { }
+                                prune_scale(0.1),
+                                target_rtf(0.0),
+                                rtf_frame_shift(0.01),
+                                rtf_interval(10),
+                                rtf_min_beam(6.0),
+                                rtf_min_max_active(1000),
+                                num_expand_threads(1),
+                                expand_min_tokens(5000) { }
   void Register(OptionsItf *opts) {
     det_opts.Register(opts);
     opts->Register("beam", &beam, "Decoding beam.  Larger->slower, more accurate.");
@@ -80,15 +104,61 @@ struct LatticeFasterDecoderConfig {
                    "max-active constraint is applied.  Larger is more accurate.");
     opts->Register("hash-ratio", &hash_ratio, "Setting used in decoder to "
                    "control hash behavior");
+    opts->Register("target-rtf", &target_rtf, "If >0, the real-time factor "
+                   "the decoder aims for by narrowing the beam and max-active "
+                   "(within --rtf-min-beam and --rtf-min-max-active) when it "
+                   "is slower, and widening them back towards --beam and "
+                   "--max-active when it is faster.");
+    opts->Register("rtf-frame-shift", &rtf_frame_shift, "Seconds of audio per "
+                   "decoded frame, used with --target-rtf (e.g. 0.03 for "
+                   "chain models with frame-subsampling-factor=3).");
+    opts->Register("rtf-interval", &rtf_interval, "Number of frames over "
+                   "which decoding time is measured between adjustments, "
+                   "with --target-rtf.");
+    opts->Register("rtf-min-beam", &rtf_min_beam, "Smallest beam that "
+                   "--target-rtf may narrow the beam to.");
+    opts->Register("rtf-min-max-active", &rtf_min_max_active, "Smallest "
+                   "max-active that --target-rtf may narrow max-active to.");
+    opts->Register("expand-threads", &num_expand_threads, "Number of threads "
+                   "used to expand the active tokens of a frame, for large "
+                   "graphs.  Only used with ConstFst or VectorFst graphs and "
+                   "decodables whose LogLikelihoodIsThreadSafe() is true "
+                   "(e.g. nnet3 and matrix ones); otherwise a warning is "
+                   "printed and one thread is used.");
+    opts->Register("expand-min-tokens", &expand_min_tokens, "With "
+                   "--expand-threads > 1, frames with fewer active tokens than "
+                   "this are expanded in one thread.");
   }
   void Check() const {
     KALDI_ASSERT(beam > 0.0 && max_active > 1 && lattice_beam > 0.0
                  && min_active <= max_active
                  && prune_interval > 0 && beam_delta > 0.0 && hash_ratio >= 1.0
                  && prune_scale > 0.0 && prune_scale < 1.0);
+    KALDI_ASSERT(target_rtf >= 0.0 && rtf_frame_shift > 0.0 &&
+                 rtf_interval > 0 && rtf_min_beam > 0.0 &&
+                 rtf_min_max_active > 1);
+    KALDI_ASSERT(num_expand_threads > 0 && expand_min_tokens >= 0);
   }
 };
 
+/// Statistics of the real-time controller (see
+/// LatticeFasterDecoderConfig::target_rtf) for the current utterance.
+struct LatticeFasterDecoderRtfStats {
+  int32 num_frames;  // frames decoded
+  double decode_seconds;  // time spent decoding them
+  int32 num_narrowed;  // adjustments that narrowed the beam
+  int32 num_widened;  // adjustments that widened the beam
+  double beam_sum;  // effective beam summed over frames
+  BaseFloat min_beam;  // smallest effective beam used
+  int32 min_max_active;  // smallest effective max-active used
+
+  LatticeFasterDecoderRtfStats() { Reset(); }
+  void Reset();
+  /// Prints the statistics with KALDI_LOG; frame_shift is the audio duration
+  /// of a frame, in seconds.
+  void Print(const std::string &utt, BaseFloat frame_shift) const;
+};
+
 namespace decoder {
 // We will template the decoder on the token type as well as the FST type; this
 // is a mechanism so that we can use the same underlying decoder code for
@@ -205,6 +275,86 @@ struct BackpointerToken {
       backpointer(backpointer) { }
 };
 
+
+// A pool from which the decoder allocates its tokens (or forward links).  As
+// HashList does for its Elems, it allocates them in blocks and keeps the freed
+// ones for reuse, so that making and pruning them each frame does not go to
+// the system allocator and the objects made on a frame are mostly together in
+// memory.  FreeAll() frees all the objects at once, keeping the blocks, which
+// is how the tokens and links of an utterance are freed at its end.  Objects
+// are constructed in the memory from Allocate() with placement new; T must be
+// trivially destructible and at least as large as a pointer.
+template <typename T>
+class ObjectPool {
+ public:
+  ObjectPool(): free_head_(NULL), next_block_(0), cur_(NULL), end_(NULL) { }
+
+  ~ObjectPool() {
+    for (size_t i = 0; i < blocks_.size(); i++)
+      ::operator delete(blocks_[i]);
+  }
+
+  inline void *Allocate() {
+    if (free_head_ != NULL) {
+      FreeObject *ans = free_head_;
+      free_head_ = free_head_->next;
+      return ans;
+    }
+    if (cur_ == end_) {
+      if (next_block_ == blocks_.size())
+        blocks_.push_back(static_cast<T*>(
+            ::operator new(sizeof(T) * kBlockSize)));
+      cur_ = blocks_[next_block_++];
+      end_ = cur_ + kBlockSize;
+    }
+    return cur_++;
+  }
+
+  inline void Free(T *t) {
+    FreeObject *f = reinterpret_cast<FreeObject*>(t);
+    f->next = free_head_;
+    free_head_ = f;
+  }
+
+  // Frees all the objects allocated.
+  void FreeAll() {
+    free_head_ = NULL;
+    next_block_ = 0;
+    cur_ = end_ = NULL;
+  }
+
+ private:
+  struct FreeObject {
+    FreeObject *next;
+  };
+  static const size_t kBlockSize = 1024;
+
+  FreeObject *free_head_;  // list of the freed objects
+  std::vector<T*> blocks_;
+  size_t next_block_;  // the block to allocate from when cur_ reaches end_
+  T *cur_;
+  T *end_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+
+// Whether arc iterators of the FST may be used from several threads at once,
+// for LatticeFasterDecoderConfig::num_expand_threads.  This is so for the
+// expanded FST types; for the others (e.g. GrammarFst, or lazy FSTs behind
+// an fst::Fst<fst::StdArc>) we assume not.
+template <typename FST>
+inline bool ArcIteratorsThreadSafe(const FST &fst) { return false; }
+inline bool ArcIteratorsThreadSafe(const fst::Fst<fst::StdArc> &fst) {
+  return fst.Type() == "const" || fst.Type() == "vector";
+}
+inline bool ArcIteratorsThreadSafe(const fst::ConstFst<fst::StdArc> &fst) {
+  return true;
+}
+inline bool ArcIteratorsThreadSafe(const fst::VectorFst<fst::StdArc> &fst) {
+  return true;
+}
+
 }  // namespace decoder
 
 
@@ -288,6 +438,16 @@ class LatticeFasterDecoderTpl {
   /// We could put that here in future needed.
   bool GetRawLattice(Lattice *ofst, bool use_final_probs = true) const;
 
+  /// Outputs the raw lattice of the frames decoded since the last call (or
+  /// since InitDecoding()) up to end_frame, for
+  /// LatticeIncrementalDeterminizer; see RawLatticeChunk for what it holds.
+  /// end_frame should be far enough behind NumFramesDecoded() that its tokens
+  /// have been pruned, except for the last chunk (is_last == true), which must
+  /// end at NumFramesDecoded() and includes the final-probs if a final state
+  /// was reached.  Returns false if some frame has no tokens.
+  bool GetRawLatticeChunk(int32 end_frame, bool is_last,
+                          RawLatticeChunk *chunk);
+
 
 
   /// [Deprecated, users should now use GetRawLattice and determinize it
@@ -342,13 +502,17 @@ class LatticeFasterDecoderTpl {
   // whenever we call ProcessEmitting().
   inline int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
 
+  /// Returns the statistics of the real-time controller for the utterance
+  /// being decoded; they are only collected if config.target_rtf > 0.
+  const LatticeFasterDecoderRtfStats &RtfStats() const { return rtf_stats_; }
+
  protected:
   // we make things protected instead of private, as code in
   // LatticeFasterOnlineDecoderTpl, which inherits from this, also uses the
   // internals.
 
   // Deletes the elements of the singly linked list tok->links.
-  inline static void DeleteForwardLinks(Token *tok);
+  inline void DeleteForwardLinks(Token *tok);
 
   // head of per-frame list of Tokens (list is in topological order),
   // and something saying whether we ever pruned it using PruneForwardLinks.
@@ -452,6 +616,55 @@ class LatticeFasterDecoderTpl {
   /// preceding ProcessEmitting().
   void ProcessNonemitting(BaseFloat cost_cutoff);
 
+  /// Called after each frame if config_.target_rtf > 0; 'timer' was reset
+  /// when the frame began.  Every config_.rtf_interval frames it compares the
+  /// time taken with the audio duration and adjusts cur_beam_ and
+  /// cur_max_active_.
+  void AdjustBeamForRtf(Timer *timer);
+
+  /// The multi-threaded version of the main loop of ProcessEmitting(), used
+  /// if config_.num_expand_threads > 1 and the frame has enough tokens.  The
+  /// tokens of final_toks within cur_cutoff are split into one contiguous
+  /// range per thread; each thread expands their arcs into its own buffer of
+  /// candidates, pruning with its own copy of next_cutoff, and the buffers are
+  /// then merged into toks_ in token order, pruning with the smallest of the
+  /// threads' cutoffs.  (So the result only differs from the single-threaded
+  /// loop in that a few tokens it would keep until the next frame's pruning
+  /// are pruned straight away.)  Returns the cutoff for ProcessNonemitting().
+  BaseFloat ExpandTokensParallel(DecodableInterface *decodable,
+                                 Elem *final_toks, int32 frame,
+                                 BaseFloat cur_cutoff, BaseFloat cost_offset,
+                                 BaseFloat adaptive_beam,
+                                 BaseFloat next_cutoff);
+
+  // An arc from a token on the current frame, found by ExpandTokensParallel().
+  struct ExpandCandidate {
+    Token *tok;
+    StateId nextstate;
+    Label ilabel;
+    Label olabel;
+    BaseFloat graph_cost;
+    BaseFloat ac_cost;
+    BaseFloat tot_cost;
+  };
+
+  // Expands the arcs of a range of expand_toks_ into expand_buffers_.
+  class ExpandTask: public MultiThreadable {
+   public:
+    ExpandTask(LatticeFasterDecoderTpl *decoder,
+               DecodableInterface *decodable, int32 frame,
+               BaseFloat cost_offset, BaseFloat adaptive_beam):
+        decoder_(decoder), decodable_(decodable), frame_(frame),
+        cost_offset_(cost_offset), adaptive_beam_(adaptive_beam) { }
+    void operator() ();
+   private:
+    LatticeFasterDecoderTpl *decoder_;
+    DecodableInterface *decodable_;
+    int32 frame_;
+    BaseFloat cost_offset_;
+    BaseFloat adaptive_beam_;
+  };
+
   // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.  It is indexed by frame-index
@@ -464,20 +677,43 @@ class LatticeFasterDecoderTpl {
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
+  // The Tokens and ForwardLinks are allocated from these.
+  decoder::ObjectPool<Token> token_pool_;
+  decoder::ObjectPool<ForwardLinkT> link_pool_;
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
+  // used in ExpandTokensParallel(): the tokens to expand, and for each thread
+  // its candidates and its cutoff.
+  std::vector<std::pair<StateId, Token*> > expand_toks_;
+  std::vector<std::vector<ExpandCandidate> > expand_buffers_;
+  std::vector<BaseFloat> expand_cutoffs_;
 
   // fst_ is a pointer to the FST we are decoding from.
   const FST *fst_;
   // delete_fst_ is true if the pointer fst_ needs to be deleted when this
   // object is destroyed.
   bool delete_fst_;
+  // true if the threads of ExpandTokensParallel() may iterate over fst_.
+  bool arcs_thread_safe_;
+  // true once we have warned that --expand-threads can't be used, because of
+  // the FST type or because the decodable's LogLikelihoodIsThreadSafe() is
+  // false.
+  bool expand_threads_warned_;
 
   std::vector<BaseFloat> cost_offsets_; // This contains, for each
   // frame, an offset that was added to the acoustic log-likelihoods on that
   // frame in order to keep everything in a nice dynamic range i.e.  close to
   // zero, to reduce roundoff errors.
   LatticeFasterDecoderConfig config_;
+  // The beam and max-active used in GetCutoff(); they equal config_.beam and
+  // config_.max_active unless the real-time controller has narrowed them.
+  BaseFloat cur_beam_;
+  int32 cur_max_active_;
+  // Frames, seconds and active tokens since the controller's last adjustment.
+  int32 rtf_window_frames_;
+  double rtf_window_seconds_;
+  double rtf_window_toks_;
+  LatticeFasterDecoderRtfStats rtf_stats_;
   int32 num_toks_; // current total #toks allocated...
   bool warned_;
 
@@ -495,6 +731,11 @@ class LatticeFasterDecoderTpl {
   BaseFloat final_relative_cost_;
   BaseFloat final_best_cost_;
 
+  /// For GetRawLatticeChunk(): the frame the next chunk begins with, and the
+  /// labels the last chunk gave the tokens of that frame.
+  int32 chunk_begin_frame_;
+  unordered_map<Token*, int32> chunk_token_labels_;
+
   // There are various cleanup tasks... the the toks_ structure contains
   // singly linked lists of Token pointers, where Elem is the list type.
   // It also indexes them in a hash, indexed by state (this hash is only
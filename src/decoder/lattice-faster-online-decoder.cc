@@ -164,6 +164,153 @@ typename LatticeFasterOnlineDecoderTpl<FST>::BestPathIterator LatticeFasterOnlin
   return BestPathIterator(tok->backpointer, ret_t);
 }
 
+template <typename FST>
+void LatticeFasterOnlineDecoderTpl<FST>::ComputeBestPathExtraCosts(
+    bool use_final_probs,
+    unordered_map<Token*, BaseFloat> *extra_costs) const {
+  const BaseFloat infinity = std::numeric_limits<BaseFloat>::infinity();
+  unordered_map<Token*, BaseFloat> final_costs_local;
+  const unordered_map<Token*, BaseFloat> &final_costs =
+      (this->decoding_finalized_ ? this->final_costs_ : final_costs_local);
+  if (!this->decoding_finalized_ && use_final_probs)
+    this->ComputeFinalCosts(&final_costs_local, NULL, NULL);
+  bool use_finals = use_final_probs && !final_costs.empty();
+
+  extra_costs->clear();
+  int32 num_frames = this->NumFramesDecoded();
+  // the costs of the paths that end on the last frame.
+  BaseFloat best_cost = infinity;
+  for (Token *tok = this->active_toks_[num_frames].toks; tok != NULL;
+       tok = tok->next) {
+    BaseFloat cost = tok->tot_cost;
+    if (use_finals) {
+      typename unordered_map<Token*, BaseFloat>::const_iterator iter =
+          final_costs.find(tok);
+      cost = (iter != final_costs.end() ? cost + iter->second : infinity);
+    }
+    (*extra_costs)[tok] = cost;
+    best_cost = std::min(best_cost, cost);
+  }
+  for (Token *tok = this->active_toks_[num_frames].toks; tok != NULL;
+       tok = tok->next)
+    (*extra_costs)[tok] -= best_cost;
+
+  // then backwards over the links, as in PruneForwardLinks(), which iterates
+  // on each frame because of the epsilon links within it.
+  BaseFloat delta = this->config_.lattice_beam * 1.0e-04;
+  for (int32 f = num_frames; f >= 0; f--) {
+    if (f < num_frames)
+      for (Token *tok = this->active_toks_[f].toks; tok != NULL;
+           tok = tok->next)
+        (*extra_costs)[tok] = infinity;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (Token *tok = this->active_toks_[f].toks; tok != NULL;
+           tok = tok->next) {
+        BaseFloat &tok_extra_cost = (*extra_costs)[tok];
+        for (ForwardLinkT *link = tok->links; link != NULL;
+             link = link->next) {
+          typename unordered_map<Token*, BaseFloat>::const_iterator iter =
+              extra_costs->find(link->next_tok);
+          if (iter == extra_costs->end())
+            continue;
+          BaseFloat link_extra_cost = iter->second +
+              ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
+               - link->next_tok->tot_cost);
+          if (link_extra_cost < tok_extra_cost - delta) {
+            tok_extra_cost = link_extra_cost;
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename FST>
+bool LatticeFasterOnlineDecoderTpl<FST>::GetBestPathWordConfidences(
+    bool use_final_probs,
+    std::vector<int32> *words,
+    std::vector<std::pair<int32, int32> > *times,
+    std::vector<BaseFloat> *confidences,
+    std::vector<int32> *alignment) const {
+  words->clear();
+  times->clear();
+  confidences->clear();
+  if (alignment != NULL)
+    alignment->clear();
+
+  // Trace back the best path, noting the frame at which each word starts.
+  BestPathIterator iter = BestPathEnd(use_final_probs);
+  if (iter.Done())
+    return false;
+  std::vector<int32> begin_frames;
+  while (!iter.Done()) {
+    // an emitting link is on the frame iter.frame; an epsilon link on the
+    // frame after it.
+    int32 frame = iter.frame;
+    LatticeArc arc;
+    iter = TraceBackBestPath(iter, &arc);
+    if (arc.olabel != 0) {
+      words->push_back(arc.olabel);
+      begin_frames.push_back(arc.ilabel != 0 ? frame : frame + 1);
+    }
+    if (arc.ilabel != 0 && alignment != NULL)
+      alignment->push_back(arc.ilabel);
+  }
+  std::reverse(words->begin(), words->end());
+  std::reverse(begin_frames.begin(), begin_frames.end());
+  if (alignment != NULL)
+    std::reverse(alignment->begin(), alignment->end());
+  if (words->empty())
+    return true;
+
+  unordered_map<Token*, BaseFloat> extra_costs;
+  ComputeBestPathExtraCosts(use_final_probs, &extra_costs);
+
+  int32 num_frames = this->NumFramesDecoded();
+  for (size_t i = 0; i < words->size(); i++) {
+    int32 word = (*words)[i], begin = begin_frames[i],
+        end = (i + 1 < words->size() ? begin_frames[i + 1] : num_frames);
+    // the best cost of each other word on the links of the word's frames
+    // (active_toks_[f], for the tokens before frame f is consumed).
+    unordered_map<Label, BaseFloat> other_word_costs;
+    for (int32 f = begin; f <= std::max(begin, end - 1) && f <= num_frames;
+         f++) {
+      for (Token *tok = this->active_toks_[f].toks; tok != NULL;
+           tok = tok->next) {
+        for (ForwardLinkT *link = tok->links; link != NULL;
+             link = link->next) {
+          if (link->olabel == 0 || link->olabel == word)
+            continue;
+          typename unordered_map<Token*, BaseFloat>::const_iterator iter =
+              extra_costs.find(link->next_tok);
+          if (iter == extra_costs.end())
+            continue;
+          BaseFloat link_extra_cost = iter->second +
+              ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
+               - link->next_tok->tot_cost);
+          typename unordered_map<Label, BaseFloat>::iterator word_iter =
+              other_word_costs.find(link->olabel);
+          if (word_iter == other_word_costs.end())
+            other_word_costs[link->olabel] = link_extra_cost;
+          else if (link_extra_cost < word_iter->second)
+            word_iter->second = link_extra_cost;
+        }
+      }
+    }
+    double denominator = 1.0;
+    for (typename unordered_map<Label, BaseFloat>::const_iterator word_iter =
+             other_word_costs.begin(); word_iter != other_word_costs.end();
+         ++word_iter)
+      denominator += Exp(-std::max<BaseFloat>(word_iter->second, 0.0));
+    times->push_back(std::pair<int32, int32>(begin, std::max(begin, end)));
+    confidences->push_back(1.0 / denominator);
+  }
+  return true;
+}
+
 template <typename FST>
 bool LatticeFasterOnlineDecoderTpl<FST>::GetRawLatticePruned(
     Lattice *ofst,
@@ -271,6 +418,7 @@ template class LatticeFasterOnlineDecoderTpl<fst::Fst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::VectorFst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::ConstFst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::GrammarFst>;
+template class LatticeFasterOnlineDecoderTpl<CsrFst>;
 
 
 } // end namespace kaldi.
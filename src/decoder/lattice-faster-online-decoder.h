@@ -127,6 +127,33 @@ class LatticeFasterOnlineDecoderTpl:
       BestPathIterator iter, LatticeArc *arc) const;
 
 
+  /// Outputs the words of the best path with their times and confidences,
+  /// straight from the tokens, for when the lattice would only be made for a
+  /// ctm with confidences (as from lattice-to-ctm-conf).  It costs about as
+  /// much as a pass of PruneForwardLinks() over the frames.
+  ///
+  /// The confidence of a word is its share of the Viterbi (max-marginal)
+  /// posteriors of the words hypothesised in its span: each other word whose
+  /// label is on a link of the span counts with exp(-c), where c is the cost
+  /// of the best path through that link, less that of the best path.  (The
+  /// costs are those of the search, i.e. with the acoustic scale applied.)
+  /// Paths with no word in the span are not competitors, so for rarely
+  /// contested words this is more optimistic than the MBR confidences.
+  ///
+  /// times are the (begin, end) frames of the words; a word is taken to start
+  /// where its label is on the best path, and to last until the next word
+  /// starts (or the utterance ends), so that any silence after it is
+  /// included.  If alignment is non-NULL, it is set to the transition-ids of
+  /// the best path (one per frame), with which the caller can trim such
+  /// silences.  Returns false if there is no best path.
+  bool GetBestPathWordConfidences(
+      bool use_final_probs,
+      std::vector<int32> *words,
+      std::vector<std::pair<int32, int32> > *times,
+      std::vector<BaseFloat> *confidences,
+      std::vector<int32> *alignment = NULL) const;
+
+
   /// Behaves the same as GetRawLattice but only processes tokens whose
   /// extra_cost is smaller than the best-cost plus the specified beam.
   /// It is only worthwhile to call this function if beam is less than
@@ -136,6 +163,15 @@ class LatticeFasterOnlineDecoderTpl:
                            bool use_final_probs,
                            BaseFloat beam) const;
 
+ private:
+  // Computes, for each token, the cost of the best path through it less that
+  // of the best path, as PruneForwardLinks() does for extra_cost but from the
+  // current frame (with its final-probs if use_final_probs and there are
+  // any), for GetBestPathWordConfidences().
+  void ComputeBestPathExtraCosts(
+      bool use_final_probs,
+      unordered_map<Token*, BaseFloat> *extra_costs) const;
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeFasterOnlineDecoderTpl);
 };
 
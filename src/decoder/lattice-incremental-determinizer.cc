@@ -0,0 +1,311 @@
+// decoder/lattice-incremental-determinizer.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/lattice-incremental-determinizer.h"
+#include "lat/lattice-functions.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+// The labels that mark, in the lattices determinized for the chunks, the
+// states of the lattice so far that are re-determinized and the tokens where
+// the chunks end.  They are above any word-id.
+static const int32 kStateLabelOffset = 1000000000;
+static const int32 kTokenLabelOffset = 2000000000;
+
+LatticeIncrementalDeterminizer::LatticeIncrementalDeterminizer(
+    const LatticeIncrementalDeterminizerConfig &config,
+    BaseFloat lattice_beam,
+    const fst::DeterminizeLatticePrunedOptions &det_opts):
+    config_(config), lattice_beam_(lattice_beam), det_opts_(det_opts) {
+  config_.Check();
+  Init();
+}
+
+LatticeIncrementalDeterminizer::~LatticeIncrementalDeterminizer() {
+  Wait();
+}
+
+void LatticeIncrementalDeterminizer::Init() {
+  Wait();
+  clat_.DeleteStates();
+  boundary_states_.clear();
+  num_chunks_ = 0;
+  last_chunk_done_ = false;
+  determinize_ok_ = true;
+}
+
+void LatticeIncrementalDeterminizer::Wait() {
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void LatticeIncrementalDeterminizer::AcceptChunk(RawLatticeChunk *chunk) {
+  Wait();
+  KALDI_ASSERT(!last_chunk_done_ &&
+               "AcceptChunk() called after the last chunk, call Init()");
+  // chunk is left with nothing shared with pending_, which the thread uses.
+  pending_.lat = chunk->lat;
+  chunk->lat.DeleteStates();
+  pending_.begin_tokens.swap(chunk->begin_tokens);
+  pending_.end_tokens.swap(chunk->end_tokens);
+  pending_.end_costs.swap(chunk->end_costs);
+  pending_.is_last = chunk->is_last;
+  chunk->begin_tokens.clear();
+  chunk->end_tokens.clear();
+  chunk->end_costs.clear();
+  last_chunk_done_ = pending_.is_last;
+  if (config_.background)
+    thread_ = std::thread(&LatticeIncrementalDeterminizer::ProcessPendingChunk,
+                          this);
+  else
+    ProcessPendingChunk();
+}
+
+void LatticeIncrementalDeterminizer::ProcessPendingChunk() {
+  Timer timer;
+  Lattice lat;
+  MakeChunkLattice(pending_, &lat);
+  Invert(&lat);  // make it so word labels are on the input.
+  fst::ILabelCompare<LatticeArc> ilabel_comp;
+  ArcSort(&lat, ilabel_comp);
+  CompactLattice chunk_clat;
+  if (!DeterminizeLatticePruned(lat, lattice_beam_, &chunk_clat, det_opts_))
+    determinize_ok_ = false;
+  lat.DeleteStates();
+  StitchChunk(pending_, &chunk_clat);
+  pending_.lat.DeleteStates();
+  KALDI_VLOG(3) << "Determinized chunk " << num_chunks_ << " in "
+                << timer.Elapsed() << "s, lattice so far has "
+                << clat_.NumStates() << " states";
+  num_chunks_++;
+}
+
+void LatticeIncrementalDeterminizer::MakeChunkLattice(
+    const RawLatticeChunk &chunk, Lattice *ofst) const {
+  typedef LatticeArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  ofst->DeleteStates();
+  StateId start = ofst->AddState();
+  ofst->SetStart(start);
+  const Lattice &lat = chunk.lat;
+  StateId offset = ofst->NumStates();
+  for (StateId s = 0; s < lat.NumStates(); s++)
+    ofst->AddState();
+  for (StateId s = 0; s < lat.NumStates(); s++) {
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
+      Arc arc = aiter.Value();
+      arc.nextstate += offset;
+      ofst->AddArc(s + offset, arc);
+    }
+  }
+
+  if (num_chunks_ == 0) {
+    ofst->AddArc(start, Arc(0, 0, Weight::One(), offset + lat.Start()));
+  } else {
+    // an arc to each boundary state, labelled by it and with its forward cost
+    // for pruning, followed by its arcs to the tokens the chunk begins with.
+    unordered_map<int32, StateId> token_states;
+    for (size_t i = 0; i < chunk.begin_tokens.size(); i++)
+      token_states[chunk.begin_tokens[i].second] =
+          offset + chunk.begin_tokens[i].first;
+    for (size_t i = 0; i < boundary_states_.size(); i++) {
+      int32 clat_state = boundary_states_[i].first;
+      StateId state = ofst->AddState();
+      ofst->AddArc(start, Arc(0, kStateLabelOffset + clat_state,
+                              Weight(boundary_states_[i].second, 0.0), state));
+      for (fst::ArcIterator<CompactLattice> aiter(clat_, clat_state);
+           !aiter.Done(); aiter.Next()) {
+        const CompactLatticeArc &carc = aiter.Value();
+        if (carc.ilabel < kTokenLabelOffset)
+          continue;
+        unordered_map<int32, StateId>::const_iterator iter =
+            token_states.find(carc.ilabel - kTokenLabelOffset);
+        if (iter == token_states.end())
+          continue;  // the token has been pruned away since.
+        // the transition-ids of the arc (and of the final-prob after it) as a
+        // chain of arcs, with the cost on the first.
+        CompactLatticeWeight w = fst::Times(carc.weight,
+                                            clat_.Final(carc.nextstate));
+        const std::vector<int32> &str = w.String();
+        StateId cur_state = state;
+        for (size_t j = 0; j + 1 < str.size(); j++) {
+          StateId next_state = ofst->AddState();
+          ofst->AddArc(cur_state, Arc(str[j], 0,
+                                      j == 0 ? w.Weight() : Weight::One(),
+                                      next_state));
+          cur_state = next_state;
+        }
+        ofst->AddArc(cur_state, Arc(str.empty() ? 0 : str.back(), 0,
+                                    str.size() <= 1 ? w.Weight() :
+                                    Weight::One(), iter->second));
+      }
+    }
+  }
+
+  // the tokens the chunk ends with: final states for the last chunk, else
+  // arcs labelled by the tokens to a final state, with the cost to prune by.
+  StateId final_state = fst::kNoStateId;
+  if (!chunk.is_last) {
+    final_state = ofst->AddState();
+    ofst->SetFinal(final_state, Weight::One());
+  }
+  for (size_t i = 0; i < chunk.end_tokens.size(); i++) {
+    StateId state = offset + chunk.end_tokens[i].first;
+    BaseFloat cost = chunk.end_costs[i];
+    if (cost == std::numeric_limits<BaseFloat>::infinity())
+      continue;
+    if (chunk.is_last)
+      ofst->SetFinal(state, Weight(cost, 0.0));
+    else
+      ofst->AddArc(state, Arc(0, kTokenLabelOffset + chunk.end_tokens[i].second,
+                              Weight(cost, 0.0), final_state));
+  }
+}
+
+void LatticeIncrementalDeterminizer::StitchChunk(
+    const RawLatticeChunk &chunk, CompactLattice *chunk_clat) {
+  typedef CompactLatticeArc Arc;
+  typedef Arc::StateId StateId;
+
+  // the boundary states are replaced by the chunk, whatever it holds.
+  for (size_t i = 0; num_chunks_ > 0 && i < boundary_states_.size(); i++) {
+    StateId s = boundary_states_[i].first;
+    std::vector<Arc> arcs;
+    for (fst::ArcIterator<CompactLattice> aiter(clat_, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel < kTokenLabelOffset)
+        arcs.push_back(arc);
+      else
+        clat_.SetFinal(arc.nextstate, CompactLatticeWeight::Zero());
+    }
+    clat_.DeleteArcs(s);
+    for (size_t j = 0; j < arcs.size(); j++)
+      clat_.AddArc(s, arcs[j]);
+  }
+  // the costs that were added at the boundaries, to take out again.
+  unordered_map<int32, double> state_costs;
+  for (size_t i = 0; i < boundary_states_.size(); i++)
+    state_costs[boundary_states_[i].first] = boundary_states_[i].second;
+  unordered_map<int32, BaseFloat> token_costs;
+  for (size_t i = 0; !chunk.is_last && i < chunk.end_tokens.size(); i++)
+    token_costs[chunk.end_tokens[i].second] = chunk.end_costs[i];
+  boundary_states_.clear();
+
+  Connect(chunk_clat);
+  if (chunk_clat->NumStates() == 0) {
+    KALDI_WARN << "Empty lattice for chunk " << num_chunks_
+               << " of the utterance";
+    determinize_ok_ = false;
+    return;
+  }
+  TopSortCompactLatticeIfNeeded(chunk_clat);
+  StateId num_states = chunk_clat->NumStates(),
+      start = chunk_clat->Start();
+
+  // the best forward cost of each state, which for the first chunk and (as the
+  // costs of the boundary states were on the arcs from the start) for the
+  // others too is its forward cost in clat_.
+  std::vector<double> forward_costs(num_states,
+                                    std::numeric_limits<double>::infinity());
+  forward_costs[start] = 0.0;
+  for (StateId s = 0; s < num_states; s++) {
+    for (fst::ArcIterator<CompactLattice> aiter(*chunk_clat, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      double cost = forward_costs[s] + ConvertToCost(arc.weight);
+      if (cost < forward_costs[arc.nextstate])
+        forward_costs[arc.nextstate] = cost;
+    }
+  }
+
+  std::vector<StateId> state_map(num_states, fst::kNoStateId);
+  for (StateId s = 0; s < num_states; s++)
+    if (num_chunks_ == 0 || s != start)
+      state_map[s] = clat_.AddState();
+  if (num_chunks_ == 0)
+    clat_.SetStart(state_map[start]);
+
+  std::vector<bool> is_boundary(num_states, false);
+  for (StateId s = 0; s < num_states; s++) {
+    for (fst::ArcIterator<CompactLattice> aiter(*chunk_clat, s); !aiter.Done();
+         aiter.Next()) {
+      Arc arc = aiter.Value();
+      LatticeWeight w = arc.weight.Weight();
+      arc.nextstate = state_map[arc.nextstate];
+      if (num_chunks_ != 0 && s == start) {
+        // the arc takes the place of the arcs to the tokens of the state it
+        // is labelled by.
+        KALDI_ASSERT(arc.ilabel >= kStateLabelOffset &&
+                     arc.ilabel < kTokenLabelOffset);
+        StateId clat_state = arc.ilabel - kStateLabelOffset;
+        arc.weight = CompactLatticeWeight(
+            LatticeWeight(w.Value1() - state_costs[clat_state], w.Value2()),
+            arc.weight.String());
+        arc.ilabel = arc.olabel = 0;
+        clat_.AddArc(clat_state, arc);
+        continue;
+      }
+      if (arc.ilabel >= kTokenLabelOffset) {
+        KALDI_ASSERT(!chunk.is_last);
+        BaseFloat token_cost = token_costs[arc.ilabel - kTokenLabelOffset];
+        arc.weight = CompactLatticeWeight(
+            LatticeWeight(w.Value1() - token_cost, w.Value2()),
+            arc.weight.String());
+        if (!is_boundary[s]) {
+          is_boundary[s] = true;
+          boundary_states_.push_back(std::make_pair(state_map[s],
+                                                    forward_costs[s]));
+        }
+      }
+      clat_.AddArc(state_map[s], arc);
+    }
+    if (state_map[s] != fst::kNoStateId)
+      clat_.SetFinal(state_map[s], chunk_clat->Final(s));
+  }
+  chunk_clat->DeleteStates();
+}
+
+bool LatticeIncrementalDeterminizer::GetLattice(CompactLattice *clat) {
+  Wait();
+  KALDI_ASSERT(last_chunk_done_ &&
+               "GetLattice() called before the last chunk was accepted");
+  clat->DeleteStates();
+  // Connect() drops the states that chunks took the place of.
+  Connect(&clat_);
+  if (clat_.NumStates() == 0)
+    return false;
+
+  // Determinize the stitched lattice, which may have more than one path with
+  // a word sequence where the chunks meet.
+  Lattice lat;
+  ConvertLattice(clat_, &lat);
+  Invert(&lat);
+  fst::ILabelCompare<LatticeArc> ilabel_comp;
+  ArcSort(&lat, ilabel_comp);
+  bool ans = DeterminizeLatticePruned(lat, lattice_beam_, clat, det_opts_);
+  lat.DeleteStates();
+  Connect(clat);
+  return ans && determinize_ok_ && clat->NumStates() != 0;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,173 @@
+// decoder/lattice-incremental-determinizer.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_LATTICE_INCREMENTAL_DETERMINIZER_H_
+#define KALDI_DECODER_LATTICE_INCREMENTAL_DETERMINIZER_H_
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/determinize-lattice-pruned.h"
+
+namespace kaldi {
+
+struct LatticeIncrementalDeterminizerConfig {
+  int32 chunk_size;
+  int32 determinize_delay;
+  bool background;
+
+  LatticeIncrementalDeterminizerConfig(): chunk_size(0),
+                                          determinize_delay(25),
+                                          background(false) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("determinize-chunk-size", &chunk_size, "If >0, the "
+                   "lattice is determinized in chunks of this many frames "
+                   "while the utterance is decoded, rather than all at the "
+                   "end.");
+    opts->Register("determinize-delay", &determinize_delay, "With "
+                   "--determinize-chunk-size, the number of frames by which a "
+                   "chunk is determinized behind the decoding, so that its "
+                   "tokens have been pruned.");
+    opts->Register("determinize-in-background", &background, "With "
+                   "--determinize-chunk-size, determinize the chunks on a "
+                   "thread of their own while decoding continues.");
+  }
+  void Check() const {
+    KALDI_ASSERT(chunk_size >= 0 && determinize_delay >= 0);
+  }
+};
+
+
+/// The raw lattice of a chunk of frames of an utterance, as output by
+/// LatticeFasterDecoderTpl::GetRawLatticeChunk() for
+/// LatticeIncrementalDeterminizer.  lat is as from GetRawLattice() (its
+/// states are tokens, with transition-ids as ilabels and words as olabels) but
+/// has only the arcs that leave the tokens of frames begin .. end - 1 of the
+/// chunk (and of frame end too, for the last chunk), and no final-probs.  The
+/// tokens of frames begin and end are where the chunk meets the chunks before
+/// and after it.  Each token of frame end is given a label; the tokens of frame
+/// begin have the labels the last chunk gave them.
+struct RawLatticeChunk {
+  Lattice lat;
+  // the (state, label) of the tokens of the first frame; empty for the first
+  // chunk, whose start state is that of the start token.
+  std::vector<std::pair<int32, int32> > begin_tokens;
+  // the (state, label) of the tokens of the last frame.
+  std::vector<std::pair<int32, int32> > end_tokens;
+  // per end token, the cost by which it is thought to be worse than the best
+  // path (as from the token's extra_cost), for pruning; for the last chunk,
+  // its final cost (infinity if it is not final).
+  std::vector<BaseFloat> end_costs;
+  bool is_last;
+
+  RawLatticeChunk(): is_last(false) { }
+};
+
+
+/**
+   LatticeIncrementalDeterminizer determinizes the lattice of an utterance a
+   chunk of frames at a time while it is decoded (see
+   DecodeUtteranceLatticeIncremental() in decoder-wrappers.h), rather than
+   determinizing the whole raw lattice at its end, which for long utterances
+   with wide beams can take as long as the decoding.
+
+   Each chunk is determinized with DeterminizeLatticePruned() on its own, with
+   the end tokens marked by their labels on arcs to a final state, so that the
+   states of the output that lead to each token are known.  The states of the
+   lattice so far that had arcs to the tokens where the new chunk begins are
+   re-determinized with it: the chunk lattice starts with an arc to each of
+   them, labelled by that state, followed by its arcs to the tokens.  Stitching
+   the output in then replaces those arcs with the arcs of the chunk.  The
+   marking labels and the costs used for pruning at the boundaries are taken
+   out again when stitching, so the costs of the paths are exact.
+
+   Because the chunks meet at tokens, the result can have more than one path
+   with a word sequence; GetLattice() determinizes it once more, but this is
+   over a lattice that is already almost deterministic, not the raw lattice.
+   With config.background, each chunk is determinized on a thread while the
+   decoder carries on.
+*/
+class LatticeIncrementalDeterminizer {
+ public:
+  LatticeIncrementalDeterminizer(
+      const LatticeIncrementalDeterminizerConfig &config,
+      BaseFloat lattice_beam,
+      const fst::DeterminizeLatticePrunedOptions &det_opts);
+
+  ~LatticeIncrementalDeterminizer();
+
+  const LatticeIncrementalDeterminizerConfig &Config() const {
+    return config_;
+  }
+
+  /// Starts a new utterance.
+  void Init();
+
+  /// Determinizes the next chunk of the utterance and adds it to the lattice
+  /// so far.  The contents of chunk are taken (it is left empty).  With
+  /// config.background, this returns once the last chunk is done and this one
+  /// has been started.
+  void AcceptChunk(RawLatticeChunk *chunk);
+
+  /// Outputs the determinized lattice of the utterance, whose last chunk must
+  /// have been accepted.  Returns false if it is empty or determinization
+  /// finished earlier than the beam.
+  bool GetLattice(CompactLattice *clat);
+
+ private:
+  // Determinizes pending_ and stitches it into clat_.
+  void ProcessPendingChunk();
+
+  // Waits for the chunk that is being determinized in the background.
+  void Wait();
+
+  // The lattice to determinize for the chunk: words on the output, as
+  // GetRawLattice() outputs.
+  void MakeChunkLattice(const RawLatticeChunk &chunk, Lattice *ofst) const;
+
+  // Adds the determinized chunk to clat_.
+  void StitchChunk(const RawLatticeChunk &chunk, CompactLattice *chunk_clat);
+
+  LatticeIncrementalDeterminizerConfig config_;
+  BaseFloat lattice_beam_;
+  fst::DeterminizeLatticePrunedOptions det_opts_;
+
+  // The lattice so far.
+  CompactLattice clat_;
+  // The states of clat_ with arcs to the tokens where the next chunk begins
+  // (labelled by the tokens), with their best forward costs.
+  std::vector<std::pair<int32, double> > boundary_states_;
+  int32 num_chunks_;
+  bool last_chunk_done_;
+  bool determinize_ok_;
+
+  RawLatticeChunk pending_;
+  std::thread thread_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeIncrementalDeterminizer);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_LATTICE_INCREMENTAL_DETERMINIZER_H_
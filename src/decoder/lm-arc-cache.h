@@ -0,0 +1,166 @@
+// decoder/lm-arc-cache.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_LM_ARC_CACHE_H_
+#define KALDI_DECODER_LM_ARC_CACHE_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fstext/deterministic-fst.h"
+
+namespace kaldi {
+
+/**
+   LmArcCache caches the arcs of a DeterministicOnDemandFst, for decoders such
+   as LatticeBiglmFasterDecoder that look up the arc (lm_state, word) of the
+   language-model FST for every word arc they expand.  Asking the FST is slow:
+   it is a virtual call that, for ComposeDeterministicOnDemandFst, hashes the
+   state pair and asks both FSTs in turn.
+
+   There are two tables.  A small direct-mapped one holds the arcs used most
+   recently, which are mostly those of the current frame, since the tokens of
+   a frame share few LM states; it fits in the processor's cache.  Behind it,
+   a larger open-addressing table (linear probing) holds the arcs used so far
+   in the utterance and after; once it holds max_entries arcs it is emptied.
+   Because the state ids of the FST stay valid as long as the FST exists, the
+   cache need not be emptied between utterances.
+*/
+class LmArcCache {
+ public:
+  typedef fst::StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Label Label;
+  typedef Arc::Weight Weight;
+
+  /// Does not take ownership of 'fst'.  max_entries is the number of arcs
+  /// the main table holds before it is emptied; if it is 0, GetArc() just
+  /// asks the FST.
+  LmArcCache(fst::DeterministicOnDemandFst<Arc> *fst, int32 max_entries):
+      fst_(fst), max_entries_(max_entries), num_entries_(0),
+      num_hits_(0), num_misses_(0) {
+    KALDI_ASSERT(max_entries >= 0);
+    if (max_entries == 0) return;
+    int32 bits = 1;
+    while ((static_cast<int64>(1) << bits) < 2 * static_cast<int64>(max_entries))
+      bits++;
+    table_shift_ = 64 - bits;
+    table_.resize(static_cast<size_t>(1) << bits);
+    int32 recent_bits = (bits < kRecentBits ? bits : kRecentBits);
+    recent_shift_ = 64 - recent_bits;
+    recent_.resize(static_cast<size_t>(1) << recent_bits);
+    Clear();
+  }
+
+  /// Does the same as fst->GetArc(s, ilabel, oarc).
+  inline bool GetArc(StateId s, Label ilabel, Arc *oarc) {
+    if (table_.empty()) return fst_->GetArc(s, ilabel, oarc);
+    uint64 key = Key(s, ilabel), hash = key * kHashMultiplier;
+    Entry *recent = &recent_[hash >> recent_shift_];
+    if (recent->key != key) {
+      size_t mask = table_.size() - 1, i = hash >> table_shift_;
+      while (table_[i].key != key && table_[i].key != kNoKey)
+        i = (i + 1) & mask;
+      if (table_[i].key == kNoKey) {
+        num_misses_++;
+        if (num_entries_ >= max_entries_) {
+          ClearTable();
+          i = hash >> table_shift_;
+        }
+        Arc arc;
+        Entry entry;
+        entry.key = key;
+        if (fst_->GetArc(s, ilabel, &arc)) {
+          entry.nextstate = arc.nextstate;
+          entry.olabel = arc.olabel;
+          entry.weight = arc.weight.Value();
+        } else {
+          entry.nextstate = fst::kNoStateId;
+          entry.olabel = 0;
+          entry.weight = 0.0;
+        }
+        table_[i] = entry;
+        num_entries_++;
+      } else {
+        num_hits_++;
+      }
+      *recent = table_[i];
+    } else {
+      num_hits_++;
+    }
+    if (recent->nextstate == fst::kNoStateId) return false;
+    oarc->ilabel = ilabel;
+    oarc->olabel = recent->olabel;
+    oarc->weight = Weight(recent->weight);
+    oarc->nextstate = recent->nextstate;
+    return true;
+  }
+
+  /// Empties both tables.
+  void Clear() {
+    ClearTable();
+    Entry empty;
+    empty.key = kNoKey;
+    std::fill(recent_.begin(), recent_.end(), empty);
+  }
+
+  int64 NumHits() const { return num_hits_; }
+  int64 NumMisses() const { return num_misses_; }
+
+ private:
+  struct Entry {
+    uint64 key;  // see Key(); kNoKey if the entry is empty.
+    StateId nextstate;  // kNoStateId if the FST has no such arc.
+    Label olabel;
+    BaseFloat weight;
+  };
+
+  // The state ids and labels are non-negative 32-bit values, so no key equals
+  // kNoKey.
+  static inline uint64 Key(StateId s, Label ilabel) {
+    return (static_cast<uint64>(static_cast<uint32>(s)) << 32) |
+        static_cast<uint32>(ilabel);
+  }
+
+  void ClearTable() {
+    Entry empty;
+    empty.key = kNoKey;
+    std::fill(table_.begin(), table_.end(), empty);
+    num_entries_ = 0;
+    // the recent table may keep its arcs: they are still correct.
+  }
+
+  static const uint64 kNoKey = ~static_cast<uint64>(0);
+  static const uint64 kHashMultiplier = 0x9E3779B97F4A7C15ULL;
+  static const int32 kRecentBits = 12;  // 4096 entries in recent_.
+
+  fst::DeterministicOnDemandFst<Arc> *fst_;
+  int32 max_entries_;
+  int32 num_entries_;  // entries in use in table_.
+  int32 table_shift_;
+  int32 recent_shift_;
+  std::vector<Entry> table_;
+  std::vector<Entry> recent_;
+  int64 num_hits_;
+  int64 num_misses_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_LM_ARC_CACHE_H_
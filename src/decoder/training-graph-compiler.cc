@@ -19,6 +19,7 @@
 // limitations under the License.
 #include "decoder/training-graph-compiler.h"
 #include "hmm/hmm-utils.h" // for GetHTransducer
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -29,7 +30,8 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
                                              const std::vector<int32> &disambig_syms,
                                              const TrainingGraphCompilerOptions &opts):
     trans_model_(trans_model), ctx_dep_(ctx_dep), lex_fst_(lex_fst),
-    disambig_syms_(disambig_syms), opts_(opts) {
+    disambig_syms_(disambig_syms), opts_(opts), inv_cfst_(NULL),
+    h_fst_(NULL), h_fst_num_ilabels_(0) {
   using namespace fst;
   const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
 
@@ -61,6 +63,56 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
   }
 }
 
+TrainingGraphCompiler::~TrainingGraphCompiler() {
+  delete lex_fst_;
+  delete inv_cfst_;
+  delete h_fst_;
+}
+
+fst::InverseContextFst *TrainingGraphCompiler::GetContextFst() {
+  if (inv_cfst_ != NULL &&
+      inv_cfst_->IlabelInfo().size() >
+      static_cast<size_t>(opts_.max_cached_contexts)) {
+    KALDI_VLOG(1) << "Re-creating the context FST, which has "
+                  << inv_cfst_->IlabelInfo().size() << " phones in context";
+    delete inv_cfst_;
+    inv_cfst_ = NULL;
+    delete h_fst_;
+    h_fst_ = NULL;
+  }
+  if (inv_cfst_ == NULL) {
+    // needed to create context fst.
+    const std::vector<int32> &phone_syms = trans_model_.GetPhones();
+    // inv_cfst_ will be expanded on the fly, as needed.
+    inv_cfst_ = new fst::InverseContextFst(subsequential_symbol_,
+                                           phone_syms,
+                                           disambig_syms_,
+                                           ctx_dep_.ContextWidth(),
+                                           ctx_dep_.CentralPosition());
+  }
+  return inv_cfst_;
+}
+
+const fst::VectorFst<fst::StdArc> &TrainingGraphCompiler::GetH(
+    std::vector<int32> *disambig_syms_h) {
+  KALDI_ASSERT(inv_cfst_ != NULL);
+  const std::vector<std::vector<int32> > &ilabel_info =
+      inv_cfst_->IlabelInfo();
+  if (h_fst_ == NULL || h_fst_num_ilabels_ != ilabel_info.size()) {
+    // The ilabels of C are only ever added to, so an H for more of them still
+    // composes correctly with an older ctx2word_fst.
+    delete h_fst_;
+    HTransducerConfig h_cfg;
+    h_cfg.transition_scale = opts_.transition_scale;
+    disambig_syms_h_.clear();
+    h_fst_ = GetHTransducer(ilabel_info, ctx_dep_, trans_model_, h_cfg,
+                                   &disambig_syms_h_);
+    h_fst_num_ilabels_ = ilabel_info.size();
+  }
+  *disambig_syms_h = disambig_syms_h_;
+  return *h_fst_;
+}
+
 bool TrainingGraphCompiler::CompileGraphFromText(
     const std::vector<int32> &transcript,
     fst::VectorFst<fst::StdArc> *out_fst) {
@@ -82,34 +134,30 @@ bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word
 
   KALDI_ASSERT(phone2word_fst.Start() != kNoStateId);
 
-  const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
-
-  // inv_cfst will be expanded on the fly, as needed.
-  InverseContextFst inv_cfst(subsequential_symbol_,
-                             phone_syms,
-                             disambig_syms_,
-                             ctx_dep_.ContextWidth(),
-                             ctx_dep_.CentralPosition());
-
+  // the context FST is expanded on the fly, as needed.
+  InverseContextFst *inv_cfst = GetContextFst();
 
   VectorFst<StdArc> ctx2word_fst;
-  ComposeDeterministicOnDemandInverse(phone2word_fst, &inv_cfst, &ctx2word_fst);
+  ComposeDeterministicOnDemandInverse(phone2word_fst, inv_cfst, &ctx2word_fst);
   // now ctx2word_fst is C * LG, assuming phone2word_fst is written as LG.
   KALDI_ASSERT(ctx2word_fst.Start() != kNoStateId);
 
-  HTransducerConfig h_cfg;
-  h_cfg.transition_scale = opts_.transition_scale;
-
   std::vector<int32> disambig_syms_h; // disambiguation symbols on
   // input side of H.
-  VectorFst<StdArc> *H = GetHTransducer(inv_cfst.IlabelInfo(),
-                                        ctx_dep_,
-                                        trans_model_,
-                                        h_cfg,
-                                        &disambig_syms_h);
+  const VectorFst<StdArc> &H = GetH(&disambig_syms_h);
 
-  VectorFst<StdArc> &trans2word_fst = *out_fst;  // transition-id to word.
-  TableCompose(*H, ctx2word_fst, &trans2word_fst);
+  *out_fst = ctx2word_fst;
+  ComposeWithH(H, disambig_syms_h, out_fst);
+  return true;
+}
+
+void TrainingGraphCompiler::ComposeWithH(
+    const fst::VectorFst<fst::StdArc> &H,
+    const std::vector<int32> &disambig_syms_h,
+    fst::VectorFst<fst::StdArc> *fst) const {
+  using namespace fst;
+  VectorFst<StdArc> trans2word_fst;  // transition-id to word.
+  TableCompose(H, *fst, &trans2word_fst);
 
   KALDI_ASSERT(trans2word_fst.Start() != kNoStateId);
 
@@ -137,11 +185,35 @@ bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word
                check_no_self_loops,
                &trans2word_fst);
 
-  delete H;
-  return true;
+  KALDI_ASSERT(trans2word_fst.Start() != kNoStateId);
+  *fst = trans2word_fst;
 }
 
 
+// Does TrainingGraphCompiler::ComposeWithH() on every num_threads_'th graph,
+// for CompileGraphs().
+class ComposeWithHClass: public MultiThreadable {
+ public:
+  ComposeWithHClass(const TrainingGraphCompiler &compiler,
+                    const fst::VectorFst<fst::StdArc> &H,
+                    const std::vector<int32> &disambig_syms_h,
+                    std::vector<fst::VectorFst<fst::StdArc>*> *fsts):
+      compiler_(compiler), H_(H), disambig_syms_h_(disambig_syms_h),
+      fsts_(fsts) { }
+
+  void operator () () {
+    for (size_t i = thread_id_; i < fsts_->size(); i += num_threads_)
+      compiler_.ComposeWithH(H_, disambig_syms_h_, (*fsts_)[i]);
+  }
+
+ private:
+  const TrainingGraphCompiler &compiler_;
+  const fst::VectorFst<fst::StdArc> &H_;
+  const std::vector<int32> &disambig_syms_h_;
+  std::vector<fst::VectorFst<fst::StdArc>*> *fsts_;
+};
+
+
 bool TrainingGraphCompiler::CompileGraphsFromText(
     const std::vector<std::vector<int32> > &transcripts,
     std::vector<fst::VectorFst<fst::StdArc>*> *out_fsts) {
@@ -168,14 +240,9 @@ bool TrainingGraphCompiler::CompileGraphs(
   out_fsts->resize(word_fsts.size(), NULL);
   if (word_fsts.empty()) return true;
 
-  const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
-
-  // inv_cfst will be expanded on the fly, as needed.
-  InverseContextFst inv_cfst(subsequential_symbol_,
-                             phone_syms,
-                             disambig_syms_,
-                             ctx_dep_.ContextWidth(),
-                             ctx_dep_.CentralPosition());
+  // the context FST is expanded on the fly, as needed, and kept for the
+  // next call.
+  InverseContextFst *inv_cfst = GetContextFst();
 
   for (size_t i = 0; i < word_fsts.size(); i++) {
     VectorFst<StdArc> phone2word_fst;
@@ -186,7 +253,7 @@ bool TrainingGraphCompiler::CompileGraphs(
                  "Perhaps you have words missing in your lexicon?");
 
     VectorFst<StdArc> ctx2word_fst;
-    ComposeDeterministicOnDemandInverse(phone2word_fst, &inv_cfst, &ctx2word_fst);
+    ComposeDeterministicOnDemandInverse(phone2word_fst, inv_cfst, &ctx2word_fst);
     // now ctx2word_fst is C * LG, assuming phone2word_fst is written as LG.
     KALDI_ASSERT(ctx2word_fst.Start() != kNoStateId);
 
@@ -194,47 +261,17 @@ bool TrainingGraphCompiler::CompileGraphs(
     // representing phones-in-context.
   }
 
-  HTransducerConfig h_cfg;
-  h_cfg.transition_scale = opts_.transition_scale;
-
   std::vector<int32> disambig_syms_h;
-  VectorFst<StdArc> *H = GetHTransducer(inv_cfst.IlabelInfo(),
-                                        ctx_dep_,
-                                        trans_model_,
-                                        h_cfg,
-                                        &disambig_syms_h);
-
-  for (size_t i = 0; i < out_fsts->size(); i++) {
-    VectorFst<StdArc> &ctx2word_fst = *((*out_fsts)[i]);
-    VectorFst<StdArc> trans2word_fst;
-    TableCompose(*H, ctx2word_fst, &trans2word_fst);
-
-    DeterminizeStarInLog(&trans2word_fst);
-
-    if (!disambig_syms_h.empty()) {
-      RemoveSomeInputSymbols(disambig_syms_h, &trans2word_fst);
-      if (opts_.rm_eps)
-        RemoveEpsLocal(&trans2word_fst);
-    }
-
-    // Encoded minimization.
-    MinimizeEncoded(&trans2word_fst);
-
-    std::vector<int32> disambig;
-    bool check_no_self_loops = true;
-    AddSelfLoops(trans_model_,
-                 disambig,
-                 opts_.self_loop_scale,
-                 opts_.reorder,
-                 check_no_self_loops,
-                 &trans2word_fst);
-
-    KALDI_ASSERT(trans2word_fst.Start() != kNoStateId);
-
-    *((*out_fsts)[i]) = trans2word_fst;
+  const VectorFst<StdArc> &H = GetH(&disambig_syms_h);
+
+  if (opts_.num_threads > 1) {
+    ComposeWithHClass c(*this, H, disambig_syms_h, out_fsts);
+    MultiThreader<ComposeWithHClass> m(opts_.num_threads, c);
+  } else {
+    for (size_t i = 0; i < out_fsts->size(); i++)
+      ComposeWithH(H, disambig_syms_h, (*out_fsts)[i]);
   }
 
-  delete H;
   return true;
 }
 
@@ -35,6 +35,10 @@ struct TrainingGraphCompilerOptions {
   BaseFloat self_loop_scale;
   bool rm_eps;
   bool reorder;  // (Dan-style graphs)
+  int32 max_cached_contexts;
+  // Threads for CompileGraphs(); not registered by Register(), as only the
+  // programs that compile graphs in batches use it.
+  int32 num_threads;
 
   explicit TrainingGraphCompilerOptions(BaseFloat transition_scale = 1.0,
                                         BaseFloat self_loop_scale = 1.0,
@@ -42,7 +46,9 @@ struct TrainingGraphCompilerOptions {
       transition_scale(transition_scale),
       self_loop_scale(self_loop_scale),
       rm_eps(false),
-      reorder(b) { }
+      reorder(b),
+      max_cached_contexts(1000000),
+      num_threads(1) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("transition-scale", &transition_scale, "Scale of transition "
@@ -52,11 +58,16 @@ struct TrainingGraphCompilerOptions {
     opts->Register("reorder", &reorder, "Reorder transition ids for greater decoding efficiency.");
     opts->Register("rm-eps", &rm_eps,  "Remove [most] epsilons before minimization (only applicable "
                    "if disambig symbols present)");
+    opts->Register("max-cached-contexts", &max_cached_contexts, "The phones "
+                   "in context (and the H transducer for them) are kept from "
+                   "one utterance to the next, until there are more than this "
+                   "many.");
   }
 };
 
 
 class TrainingGraphCompiler {
+  friend class ComposeWithHClass;
  public:
   TrainingGraphCompiler(const TransitionModel &trans_model,  // Maintains reference to this object.
                         const ContextDependency &ctx_dep,  // And this.
@@ -76,7 +87,10 @@ class TrainingGraphCompiler {
                     fst::VectorFst<fst::StdArc> *out_fst);
 
   // CompileGraphs allows you to compile a number of graphs at the same
-  // time.  This consumes more memory but is faster.
+  // time.  This consumes more memory but is faster.  With opts.num_threads > 1,
+  // the graphs are composed with the lexicon and context one after another
+  // (those stages share caches) and the rest, which takes most of the time, is
+  // done on that many threads.
   bool CompileGraphs(
       const std::vector<const fst::VectorFst<fst::StdArc> *> &word_fsts,
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
@@ -91,8 +105,25 @@ class TrainingGraphCompiler {
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
 
 
-  ~TrainingGraphCompiler() { delete lex_fst_; }
+  ~TrainingGraphCompiler();
  private:
+  // Returns the context FST (C, inverted) expanded so far, which is shared by
+  // all the graphs compiled.  It is re-created if it has grown to more than
+  // opts_.max_cached_contexts phones in context.
+  fst::InverseContextFst *GetContextFst();
+
+  // Returns H for the phones in context of GetContextFst(), and in
+  // disambig_syms_h the disambiguation symbols on its input side.  It is
+  // rebuilt only when there are new phones in context.
+  const fst::VectorFst<fst::StdArc> &GetH(std::vector<int32> *disambig_syms_h);
+
+  // Turns the graph with phones in context on its input (C * LG) into the
+  // training graph (HCLG).  Const, so that it may be called from several
+  // threads at once.
+  void ComposeWithH(const fst::VectorFst<fst::StdArc> &H,
+                    const std::vector<int32> &disambig_syms_h,
+                    fst::VectorFst<fst::StdArc> *fst) const;
+
   const TransitionModel &trans_model_;
   const ContextDependency &ctx_dep_;
   fst::VectorFst<fst::StdArc> *lex_fst_; // lexicon FST (an input; we take
@@ -104,6 +135,14 @@ class TrainingGraphCompiler {
   // this is one of Dan's extensions.
 
   TrainingGraphCompilerOptions opts_;
+
+  fst::InverseContextFst *inv_cfst_;
+  fst::VectorFst<fst::StdArc> *h_fst_;
+  std::vector<int32> disambig_syms_h_;
+  // the number of phones in context (ilabels of C) h_fst_ was built for.
+  size_t h_fst_num_ilabels_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TrainingGraphCompiler);
 };
 
 
@@ -25,6 +25,35 @@
 
 namespace kaldi {
 
+template <class F>
+const VectorBase<BaseFloat> &OfflineFeatureTpl<F>::WaveAtSampleFreq(
+    const VectorBase<BaseFloat> &wave,
+    BaseFloat sample_freq,
+    Vector<BaseFloat> *downsampled_wave) const {
+  BaseFloat new_sample_freq = computer_.GetFrameOptions().samp_freq;
+  if (sample_freq == new_sample_freq)
+    return wave;
+  if (new_sample_freq < sample_freq) {
+    if (! computer_.GetFrameOptions().allow_downsample)
+      KALDI_ERR << "Waveform and config sample Frequency mismatch: "
+                << sample_freq << " .vs " << new_sample_freq
+                << " ( use --allow_downsample=true option to allow "
+                << " downsampling the waveform).";
+
+    // Downsample the waveform.
+    downsampled_wave->Resize(wave.Dim());
+    downsampled_wave->CopyFromVec(wave);
+    DownsampleWaveForm(sample_freq, wave,
+                       new_sample_freq, downsampled_wave);
+    return *downsampled_wave;
+  } else {
+    KALDI_ERR << "New sample Frequency " << new_sample_freq
+              << " is larger than waveform original sampling frequency "
+              << sample_freq;
+    return wave;  // suppress compiler warning.
+  }
+}
+
 template <class F>
 void OfflineFeatureTpl<F>::ComputeFeatures(
     const VectorBase<BaseFloat> &wave,
@@ -32,28 +61,21 @@ void OfflineFeatureTpl<F>::ComputeFeatures(
     BaseFloat vtln_warp,
     Matrix<BaseFloat> *output) {
   KALDI_ASSERT(output != NULL);
-  BaseFloat new_sample_freq = computer_.GetFrameOptions().samp_freq;
-  if (sample_freq == new_sample_freq)
-    Compute(wave, vtln_warp, output);
-  else {
-    if (new_sample_freq < sample_freq) {
-      if (! computer_.GetFrameOptions().allow_downsample)
-        KALDI_ERR << "Waveform and config sample Frequency mismatch: "
-                  << sample_freq << " .vs " << new_sample_freq
-                  << " ( use --allow_downsample=true option to allow "
-                  << " downsampling the waveform).";
-
-      // Downsample the waveform.
-      Vector<BaseFloat> downsampled_wave(wave);
-      DownsampleWaveForm(sample_freq, wave,
-                         new_sample_freq, &downsampled_wave);
-      Compute(downsampled_wave, vtln_warp, output);
-    } else
-      KALDI_ERR << "New sample Frequency " << new_sample_freq
-                << " is larger than waveform original sampling frequency "
-                << sample_freq;
+  Vector<BaseFloat> downsampled_wave;
+  Compute(WaveAtSampleFreq(wave, sample_freq, &downsampled_wave),
+          vtln_warp, output);
+}
 
-  }
+template <class F>
+void OfflineFeatureTpl<F>::ComputeFeaturesBatched(
+    const VectorBase<BaseFloat> &wave,
+    BaseFloat sample_freq,
+    BaseFloat vtln_warp,
+    Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output != NULL);
+  Vector<BaseFloat> downsampled_wave;
+  ComputeBatched(WaveAtSampleFreq(wave, sample_freq, &downsampled_wave),
+                 vtln_warp, output);
 }
 
 template <class F>
@@ -61,6 +83,7 @@ void OfflineFeatureTpl<F>::Compute(
     const VectorBase<BaseFloat> &wave,
     BaseFloat vtln_warp,
     Matrix<BaseFloat> *output) {
+  KALDI_PROFILE_SCOPE("OfflineFeatureTpl::Compute");
   KALDI_ASSERT(output != NULL);
   int32 rows_out = NumFrames(wave.Dim(), computer_.GetFrameOptions()),
       cols_out = computer_.Dim();
@@ -82,6 +105,43 @@ void OfflineFeatureTpl<F>::Compute(
   }
 }
 
+template <class F>
+void OfflineFeatureTpl<F>::ComputeBatched(
+    const VectorBase<BaseFloat> &wave,
+    BaseFloat vtln_warp,
+    Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output != NULL);
+  const FrameExtractionOptions &frame_opts = computer_.GetFrameOptions();
+  int32 rows_out = NumFrames(wave.Dim(), frame_opts),
+      cols_out = computer_.Dim();
+  if (rows_out == 0) {
+    output->Resize(0, 0);
+    return;
+  }
+  output->Resize(rows_out, cols_out);
+  // The frames are done in blocks so that the windows stay in the cache.
+  const int32 block_size = 256;
+  Matrix<BaseFloat> windows;
+  Vector<BaseFloat> window, raw_log_energies;
+  bool use_raw_log_energy = computer_.NeedRawLogEnergy();
+  for (int32 begin = 0; begin < rows_out; begin += block_size) {
+    int32 num_rows = std::min(block_size, rows_out - begin);
+    windows.Resize(num_rows, frame_opts.PaddedWindowSize(), kUndefined);
+    raw_log_energies.Resize(num_rows);
+    for (int32 r = 0; r < num_rows; r++) {  // begin + r is the frame index.
+      BaseFloat raw_log_energy = 0.0;
+      ExtractWindow(0, wave, begin + r, frame_opts,
+                    feature_window_function_, &window,
+                    (use_raw_log_energy ? &raw_log_energy : NULL));
+      windows.Row(r).CopyFromVec(window);
+      raw_log_energies(r) = raw_log_energy;
+    }
+    SubMatrix<BaseFloat> output_rows(*output, begin, num_rows, 0, cols_out);
+    computer_.ComputeBatch(raw_log_energies, vtln_warp, &windows,
+                           &output_rows);
+  }
+}
+
 template <class F>
 void OfflineFeatureTpl<F>::Compute(
     const VectorBase<BaseFloat> &wave,
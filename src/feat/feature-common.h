@@ -94,6 +94,16 @@ class ExampleFeatureComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /// Needed by OfflineFeatureTpl::ComputeBatched() and by
+  /// OnlineGenericBaseFeature (it is there for MfccComputer, FbankComputer and
+  /// PlpComputer).  As Compute(), but for a block of frames at once: the rows
+  /// of signal_frames are the frames, and the rows of features are set to
+  /// their features.
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
  private:
   // disallow assignment.
   ExampleFeatureComputer &operator = (const ExampleFeatureComputer &in);
@@ -153,6 +163,22 @@ class OfflineFeatureTpl {
                        BaseFloat vtln_warp,
                        Matrix<BaseFloat> *output);
 
+  /// As ComputeFeatures(), but the frames are processed in blocks, each with
+  /// F::ComputeBatch(): the windows of a block of frames are put in the rows of
+  /// a matrix, and the matrix operations (e.g. the mel binning) are done once
+  /// for the block rather than for each frame.  Only for computers that have
+  /// ComputeBatch() (MfccComputer, FbankComputer and PlpComputer).  The output is the same
+  /// as that of ComputeFeatures() to within rounding error.
+  void ComputeFeaturesBatched(const VectorBase<BaseFloat> &wave,
+                              BaseFloat sample_freq,
+                              BaseFloat vtln_warp,
+                              Matrix<BaseFloat> *output);
+
+  /// The batched version of Compute(); see ComputeFeaturesBatched().
+  void ComputeBatched(const VectorBase<BaseFloat> &wave,
+                      BaseFloat vtln_warp,
+                      Matrix<BaseFloat> *output);
+
   int32 Dim() const { return computer_.Dim(); }
 
   // Copy constructor.
@@ -163,6 +189,14 @@ class OfflineFeatureTpl {
   // Disallow assignment.
   OfflineFeatureTpl<F> &operator =(const OfflineFeatureTpl<F> &other);
 
+  // Returns wave if its sample frequency is that of the options, else
+  // downsamples it into *downsampled_wave and returns that; it is an error if
+  // the frequency is lower than that of the options.
+  const VectorBase<BaseFloat> &WaveAtSampleFreq(
+      const VectorBase<BaseFloat> &wave,
+      BaseFloat sample_freq,
+      Vector<BaseFloat> *downsampled_wave) const;
+
   F computer_;
   FeatureWindowFunction feature_window_function_;
 };
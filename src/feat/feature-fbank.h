@@ -126,6 +126,27 @@ class FbankComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /**
+     As Compute(), for many frames at once (see
+     OfflineFeatureTpl::ComputeBatched()): the rows of "signal_frames" are
+     the frames of signal and the rows of "features" are set to their
+     features.  The mel binning is done with one matrix multiplication
+     for all of the frames.  The output is the same as that of Compute() to
+     within rounding error.
+
+     @param [in] signal_raw_log_energies  The raw log-energies of the frames,
+         as for Compute(); ignored if this class returns false from
+         this->NeedRawLogEnergy().
+     @param [in] vtln_warp  As for Compute().
+     @param [in] signal_frames  The frames of signal, used as a workspace.
+     @param [out] features  Pointer to a matrix with a row per frame and
+         this->Dim() columns, to which the features will be written.
+  */
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
   ~FbankComputer();
 
  private:
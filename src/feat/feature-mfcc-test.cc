@@ -653,10 +653,38 @@ void UnitTestVtln() {
   }
 }
 
+static void UnitTestBatched() {
+  std::cout << "=== UnitTestBatched() ===\n";
+
+  Vector<BaseFloat> v(20000 + Rand() % 20000);
+  v.SetRandn();
+  v.Scale(1000.0);
+
+  MfccOptions op;
+  op.frame_opts.dither = 0.0;
+  op.frame_opts.round_to_power_of_two = (Rand() % 2 == 0);
+  op.use_energy = (Rand() % 2 == 0);
+  op.raw_energy = (Rand() % 2 == 0);
+  op.htk_compat = (Rand() % 2 == 0);
+  op.energy_floor = (Rand() % 2 == 0 ? 0.0 : 1.0);
+  op.cepstral_lifter = (Rand() % 2 == 0 ? 0.0 : 22.0);
+  BaseFloat vtln_warp = (Rand() % 2 == 0 ? 1.0 : 0.9);
+
+  Mfcc mfcc(op);
+  Matrix<BaseFloat> m, m_batched;
+  mfcc.Compute(v, vtln_warp, &m);
+  mfcc.ComputeBatched(v, vtln_warp, &m_batched);
+  KALDI_ASSERT(m.NumRows() > 0);
+  AssertEqual(m, m_batched, 0.001);
+  std::cout << "Test passed :)\n\n";
+}
+
+
 static void UnitTestFeat() {
   UnitTestVtln();
   UnitTestReadWave();
   UnitTestSimple();
+  UnitTestBatched();
   UnitTestHTKCompare1();
   UnitTestHTKCompare2();
   // commenting out this one as it doesn't compare right now I normalized
@@ -79,6 +79,78 @@ void MfccComputer::Compute(BaseFloat signal_log_energy,
   }
 }
 
+void MfccComputer::ComputeBatch(
+    const VectorBase<BaseFloat> &signal_raw_log_energies,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows(),
+      padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  KALDI_ASSERT(signal_frames->NumCols() == padded_window_size &&
+               features->NumRows() == num_frames &&
+               features->NumCols() == this->Dim() &&
+               signal_raw_log_energies.Dim() == num_frames);
+
+  const MelBanks &mel_banks = *(GetMelBanks(vtln_warp));
+
+  Vector<BaseFloat> log_energies;
+  if (opts_.use_energy) {
+    if (!opts_.raw_energy) {
+      log_energies.Resize(num_frames, kUndefined);
+      log_energies.AddDiagMat2(1.0, *signal_frames, kNoTrans, 0.0);
+      log_energies.ApplyFloor(std::numeric_limits<float>::min());
+      log_energies.ApplyLog();
+    } else {
+      log_energies = signal_raw_log_energies;
+    }
+  }
+
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> signal_frame(*signal_frames, r);
+    if (srfft_ != NULL)  // Compute FFT using the split-radix algorithm.
+      srfft_->Compute(signal_frame.Data(), true);
+    else  // An alternative algorithm that works for non-powers-of-two.
+      RealFft(&signal_frame, true);
+    // Convert the FFT into a power spectrum.
+    ComputePowerSpectrum(&signal_frame);
+  }
+  SubMatrix<BaseFloat> power_spectra(*signal_frames, 0, num_frames,
+                                     0, padded_window_size / 2 + 1);
+
+  Matrix<BaseFloat> mel_energies(num_frames, opts_.mel_opts.num_bins,
+                                 kUndefined);
+  mel_banks.Compute(power_spectra, &mel_energies);
+
+  // avoid log of zero (which should be prevented anyway by dithering).
+  mel_energies.ApplyFloor(std::numeric_limits<float>::epsilon());
+  mel_energies.ApplyLog();  // take the log.
+
+  features->SetZero();  // in case there were NaNs.
+  // features = mel_energies [which now have log] * dct_matrix_^T
+  features->AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
+
+  if (opts_.cepstral_lifter != 0.0)
+    features->MulColsVec(lifter_coeffs_);
+
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energies.ApplyFloor(log_energy_floor_);
+    features->CopyColFromVec(log_energies, 0);
+  }
+
+  if (opts_.htk_compat) {
+    for (int32 r = 0; r < num_frames; r++) {
+      SubVector<BaseFloat> feature(*features, r);
+      BaseFloat energy = feature(0);
+      for (int32 i = 0; i < opts_.num_ceps - 1; i++)
+        feature(i) = feature(i+1);
+      if (!opts_.use_energy)
+        energy *= M_SQRT2;  // scale on C0, as in Compute().
+      feature(opts_.num_ceps - 1)  = energy;
+    }
+  }
+}
+
 MfccComputer::MfccComputer(const MfccOptions &opts):
     opts_(opts), srfft_(NULL),
     mel_energies_(opts.mel_opts.num_bins) {
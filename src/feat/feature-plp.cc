@@ -188,4 +188,20 @@ void PlpComputer::Compute(BaseFloat signal_log_energy,
 }
 
 
+void PlpComputer::ComputeBatch(
+    const VectorBase<BaseFloat> &signal_raw_log_energies,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows();
+  KALDI_ASSERT(features->NumRows() == num_frames &&
+               features->NumCols() == this->Dim() &&
+               signal_raw_log_energies.Dim() == num_frames);
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> signal_frame(*signal_frames, r),
+        feature(*features, r);
+    Compute(signal_raw_log_energies(r), vtln_warp, &signal_frame, &feature);
+  }
+}
+
 }  // namespace kaldi
@@ -138,6 +138,15 @@ class PlpComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /// As Compute(), for the frames in the rows of "signal_frames" (see
+  /// MfccComputer::ComputeBatch()).  The LPC analysis is done frame by frame,
+  /// so this only saves the per-frame calls of the caller; it is there so
+  /// that the batched online and offline code also works for PLP.
+  void ComputeBatch(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                    BaseFloat vtln_warp,
+                    MatrixBase<BaseFloat> *signal_frames,
+                    MatrixBase<BaseFloat> *features);
+
   ~PlpComputer();
  private:
 
@@ -21,6 +21,7 @@
 
 
 #include "feat/feature-window.h"
+#include "base/cpu-dispatch.h"
 #include "matrix/matrix-functions.h"
 
 
@@ -98,12 +99,28 @@ void Dither(VectorBase<BaseFloat> *waveform, BaseFloat dither_value) {
 }
 
 
+namespace {
+
+// The loop of Preemphasize(), which CpuDispatch() runs compiled for the
+// instruction set of the CPU (see base/cpu-dispatch.h).  The windowing itself
+// is VectorBase::MulElements(), which is dispatched in the same way.
+template<CpuIsa isa> struct PreemphasizeKernel {
+  static KALDI_CPU_INLINE void Run(BaseFloat preemph_coeff, BaseFloat *data,
+                                   int32 dim) {
+    for (int32 i = dim - 1; i > 0; i--)
+      data[i] -= preemph_coeff * data[i - 1];
+    data[0] -= preemph_coeff * data[0];
+  }
+};
+
+}  // namespace
+
 void Preemphasize(VectorBase<BaseFloat> *waveform, BaseFloat preemph_coeff) {
   if (preemph_coeff == 0.0) return;
   KALDI_ASSERT(preemph_coeff >= 0.0 && preemph_coeff <= 1.0);
-  for (int32 i = waveform->Dim()-1; i > 0; i--)
-    (*waveform)(i) -= preemph_coeff * (*waveform)(i-1);
-  (*waveform)(0) -= preemph_coeff * (*waveform)(0);
+  KALDI_ASSERT(waveform->Dim() > 0);
+  CpuDispatch<PreemphasizeKernel>(preemph_coeff, waveform->Data(),
+                                  waveform->Dim());
 }
 
 FeatureWindowFunction::FeatureWindowFunction(const FrameExtractionOptions &opts) {
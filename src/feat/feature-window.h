@@ -44,6 +44,7 @@ struct FrameExtractionOptions {
   BaseFloat blackman_coeff;
   bool snip_edges;
   bool allow_downsample;
+  int32 max_feature_vectors;  // only used by the online features.
   // May be "hamming", "rectangular", "povey", "hanning", "blackman"
   // "povey" is a window I made to be similar to Hamming but to go to zero at the
   // edges, it's pow((0.5 - 0.5*cos(n/N*2*pi)), 0.85)
@@ -59,7 +60,8 @@ struct FrameExtractionOptions {
       round_to_power_of_two(true),
       blackman_coeff(0.42),
       snip_edges(true),
-      allow_downsample(false) { }
+      allow_downsample(false),
+      max_feature_vectors(-1) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("sample-frequency", &samp_freq,
@@ -90,6 +92,13 @@ struct FrameExtractionOptions {
     opts->Register("allow-downsample", &allow_downsample,
                    "If true, allow the input waveform to have a higher frequency than "
                    "the specified --sample-frequency (and we'll downsample).");
+    opts->Register("max-feature-vectors", &max_feature_vectors,
+                   "Online feature extraction only: if > 0, only this many of "
+                   "the most recent frames are kept, so that the memory used "
+                   "does not grow with the length of the stream.  It must be "
+                   "more than the number of frames before the most recent one "
+                   "that anything reading the features may need (e.g. the "
+                   "CMVN window plus 20 frames, plus the frames of a chunk).");
   }
   int32 WindowShift() const {
     return static_cast<int32>(samp_freq * 0.001 * frame_shift_ms);
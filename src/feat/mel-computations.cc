@@ -133,6 +133,11 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
       bins_[bin].second(0) = 0.0;
 
   }
+  bin_weights_.Resize(num_bins, num_fft_bins);
+  for (int32 bin = 0; bin < num_bins; bin++)
+    bin_weights_.Row(bin).Range(bins_[bin].first,
+                                bins_[bin].second.Dim()).CopyFromVec(
+                                    bins_[bin].second);
   if (debug_) {
     for (size_t i = 0; i < bins_.size(); i++) {
       KALDI_LOG << "bin " << i << ", offset = " << bins_[i].first
@@ -144,6 +149,7 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
 MelBanks::MelBanks(const MelBanks &other):
     center_freqs_(other.center_freqs_),
     bins_(other.bins_),
+    bin_weights_(other.bin_weights_),
     debug_(other.debug_),
     htk_mode_(other.htk_mode_) { }
 
@@ -250,6 +256,34 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void MelBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                       MatrixBase<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = bins_.size(), num_fft_bins = bin_weights_.NumCols();
+  KALDI_ASSERT(mel_energies_out->NumCols() == num_bins &&
+               mel_energies_out->NumRows() == power_spectra.NumRows() &&
+               power_spectra.NumCols() >= num_fft_bins);
+
+  // The bins are mostly zero, but a dense matrix multiplication is quicker than
+  // AddMatSmat(), which goes down the columns of fft_bins.
+  SubMatrix<BaseFloat> fft_bins(power_spectra, 0, power_spectra.NumRows(),
+                                0, num_fft_bins);
+  mel_energies_out->AddMatMat(1.0, fft_bins, kNoTrans, bin_weights_, kTrans,
+                              0.0);
+  // HTK-like flooring- for testing purposes (we prefer dither)
+  if (htk_mode_)
+    mel_energies_out->ApplyFloor(1.0);
+  KALDI_ASSERT(!KALDI_ISNAN(mel_energies_out->Sum()));
+
+  if (debug_) {
+    fprintf(stderr, "MEL BANKS:\n");
+    for (int32 r = 0; r < mel_energies_out->NumRows(); r++) {
+      for (int32 i = 0; i < num_bins; i++)
+        fprintf(stderr, " %f", (*mel_energies_out)(r, i));
+      fprintf(stderr, "\n");
+    }
+  }
+}
+
 void ComputeLifterCoeffs(BaseFloat Q, VectorBase<BaseFloat> *coeffs) {
   // Compute liftering coefficients (scaling on cepstral coeffs)
   // coeffs are numbered slightly differently from HTK: the zeroth
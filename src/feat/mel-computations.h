@@ -111,11 +111,22 @@ class MelBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                VectorBase<BaseFloat> *mel_energies_out) const;
 
+  /// As Compute() for a vector, for many frames at once: each row of
+  /// "fft_energies" is the FFT energies of a frame, and the mel energies of
+  /// the frames are output to the rows of "mel_energies_out", with a single
+  /// matrix multiplication.
+  void Compute(const MatrixBase<BaseFloat> &fft_energies,
+               MatrixBase<BaseFloat> *mel_energies_out) const;
+
   int32 NumBins() const { return bins_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
   const Vector<BaseFloat> &GetCenterFreqs() const { return center_freqs_; }
 
+  // returns the weights of the bins as a matrix, of dimension num-bins by the
+  // number of FFT bins (half the padded window size); needed by the GPU code.
+  const Matrix<BaseFloat> &GetBinWeights() const { return bin_weights_; }
+
   // Copy constructor
   MelBanks(const MelBanks &other);
  private:
@@ -130,6 +141,10 @@ class MelBanks {
   // (the first nonzero fft-bin), (the vector of weights).
   std::vector<std::pair<int32, Vector<BaseFloat> > > bins_;
 
+  // the weights of "bins_" as a matrix, of dimension num-bins by the number of
+  // FFT bins, for the matrix version of Compute().
+  Matrix<BaseFloat> bin_weights_;
+
   bool debug_;
   bool htk_mode_;
 };
@@ -53,6 +53,25 @@ void GetOutput(OnlineFeatureInterface *a,
   cache.ClearCache();
 }
 
+// Checks that GetFrames() gives the same as GetOutput() for a chunk of
+// consecutive frames and for a few scattered ones.
+void CheckGetFrames(OnlineFeatureInterface *a,
+                    const Matrix<BaseFloat> &output) {
+  int32 num_frames = output.NumRows();
+  std::vector<int32> frames;
+  int32 begin = rand() % num_frames, size = 1 + rand() % 30;
+  for (int32 t = begin; t < std::min(num_frames, begin + size); t++)
+    frames.push_back(t);
+  for (int32 i = 0; i < 3; i++)
+    frames.push_back(rand() % num_frames);
+  Matrix<BaseFloat> feats(frames.size(), a->Dim());
+  a->GetFrames(frames, &feats);
+  for (size_t i = 0; i < frames.size(); i++) {
+    SubVector<BaseFloat> row(output, frames[i]);
+    KALDI_ASSERT(feats.Row(i).ApproxEqual(row));
+  }
+}
+
 // Only generate random length for each piece
 bool RandomSplit(int32 wav_dim,
                  std::vector<int32> *piece_dim,
@@ -94,6 +113,32 @@ void TestOnlineMatrixCacheFeature() {
   AssertEqual(input_feats, output_feats);
 }
 
+// test OnlineCacheFeature with a limit on the frames cached, with frames
+// asked for in a random order (some of them older than the ones cached).
+void TestOnlineCacheFeatureMaxFrames() {
+  int32 dim = 2 + rand() % 5;  // dimension of features.
+  int32 num_frames = 100 + rand() % 100;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixFeature matrix_feats(input_feats);
+  OnlineCacheFeature cache(&matrix_feats, 1 + rand() % 20);
+  Vector<BaseFloat> feat(dim);
+  for (int32 i = 0; i < 500; i++) {
+    int32 t = rand() % num_frames;
+    cache.GetFrame(t, &feat);
+    KALDI_ASSERT(feat.ApproxEqual(input_feats.Row(t)));
+    std::vector<int32> frames(1 + rand() % 5);
+    for (size_t j = 0; j < frames.size(); j++)
+      frames[j] = std::max(0, std::min(t + rand() % 5 - 2, num_frames - 1));
+    Matrix<BaseFloat> feats(frames.size(), dim);
+    cache.GetFrames(frames, &feats);
+    for (size_t j = 0; j < frames.size(); j++)
+      KALDI_ASSERT(feats.Row(j).ApproxEqual(input_feats.Row(frames[j])));
+  }
+}
+
 void TestOnlineDeltaFeature() {
   int32 dim = 2 + rand() % 5;  // dimension of features.
   int32 num_frames = 100 + rand() % 100;
@@ -116,6 +161,7 @@ void TestOnlineDeltaFeature() {
   ComputeDeltas(opts, input_feats, &output_feats2);
 
   KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
+  CheckGetFrames(&delta_feats, output_feats1);
 }
 
 void TestOnlineSpliceFrames() {
@@ -141,6 +187,7 @@ void TestOnlineSpliceFrames() {
     &output_feats2);
 
   KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
+  CheckGetFrames(&splice_frame, output_feats1);
 }
 
 void TestOnlineMfcc() {
@@ -190,11 +237,83 @@ void TestOnlineMfcc() {
 
     Matrix<BaseFloat> online_mfcc_feats;
     GetOutput(&online_mfcc, &online_mfcc_feats);
+    CheckGetFrames(&online_mfcc, online_mfcc_feats);
 
     AssertEqual(mfcc_feats, online_mfcc_feats);
   }
 }
 
+// test the max-feature-vectors option of the online features, with the
+// frames read as they are ready, and OnlineCmvn with max_cached_frames.
+void TestOnlineMfccMaxFeatureVectors() {
+  std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
+  WaveData wave;
+  wave.Read(is);
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+
+  MfccOptions op;
+  op.frame_opts.dither = 0.0;
+  op.frame_opts.samp_freq = wave.SampFreq();
+  Mfcc mfcc(op);
+  Matrix<BaseFloat> mfcc_feats;
+  mfcc.Compute(waveform, 1.0, &mfcc_feats);
+
+  OnlineCmvnOptions cmvn_opts;
+  cmvn_opts.cmn_window = 20 + rand() % 20;
+  cmvn_opts.speaker_frames = cmvn_opts.global_frames = 10;
+  int32 dim = mfcc.Dim();
+  Matrix<double> global_stats(2, dim + 1);
+  for (int32 t = 0; t < mfcc_feats.NumRows(); t++) {
+    Vector<double> feat(mfcc_feats.Row(t));
+    global_stats.Row(0).Range(0, dim).AddVec(1.0, feat);
+    global_stats.Row(1).Range(0, dim).AddVec2(1.0, feat);
+    global_stats(0, dim) += 1.0;
+  }
+  OnlineCmvnState cmvn_state(global_stats);
+  // OnlineCmvn may go back as far as its window plus the modulus from the
+  // frame it normalizes, which may be up to a piece (< 15 frames) behind the
+  // most recent one.
+  op.frame_opts.max_feature_vectors = cmvn_opts.cmn_window +
+      cmvn_opts.modulus + 15 + rand() % 20;
+  OnlineMfcc online_mfcc(op);
+  OnlineCmvn cmvn(cmvn_opts, cmvn_state, &online_mfcc);
+  // the same, without the limits.
+  OnlineMatrixFeature matrix_feats(mfcc_feats);
+  OnlineCmvn ref_cmvn(cmvn_opts, cmvn_state, &matrix_feats);
+  cmvn_opts.max_cached_frames = RandInt(1, 100);
+  OnlineCmvn limited_cmvn(cmvn_opts, cmvn_state, &matrix_feats);
+
+  int32 num_frames_read = 0;
+  Vector<BaseFloat> feat(dim), ref_feat(dim);
+  for (int32 offset = 0; offset < waveform.Dim(); ) {
+    int32 n = std::min(RandInt(1, 2000), waveform.Dim() - offset);
+    online_mfcc.AcceptWaveform(wave.SampFreq(), waveform.Range(offset, n));
+    offset += n;
+    if (offset == waveform.Dim())
+      online_mfcc.InputFinished();
+    int32 num_frames = online_mfcc.NumFramesReady();
+    KALDI_ASSERT(online_mfcc.FirstFrameAvailable() ==
+                 std::max(0, num_frames - op.frame_opts.max_feature_vectors));
+    for (; num_frames_read < num_frames; num_frames_read++) {
+      online_mfcc.GetFrame(num_frames_read, &feat);
+      KALDI_ASSERT(feat.ApproxEqual(mfcc_feats.Row(num_frames_read)));
+      cmvn.GetFrame(num_frames_read, &feat);
+      ref_cmvn.GetFrame(num_frames_read, &ref_feat);
+      KALDI_ASSERT(feat.ApproxEqual(ref_feat));
+      limited_cmvn.GetFrame(num_frames_read, &feat);
+      KALDI_ASSERT(feat.ApproxEqual(ref_feat));
+    }
+  }
+  KALDI_ASSERT(num_frames_read == mfcc_feats.NumRows());
+  // frames that old are gone, but limited_cmvn can still go back to the
+  // start.
+  if (num_frames_read > cmvn_opts.max_cached_frames + cmvn_opts.modulus) {
+    limited_cmvn.GetFrame(0, &feat);
+    ref_cmvn.GetFrame(0, &ref_feat);
+    KALDI_ASSERT(feat.ApproxEqual(ref_feat));
+  }
+}
+
 void TestOnlinePlp() {
   std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
   WaveData wave;
@@ -381,9 +500,11 @@ int main() {
   using namespace kaldi;
   for (int i = 0; i < 10; i++) {
     TestOnlineMatrixCacheFeature();
+    TestOnlineCacheFeatureMaxFrames();
     TestOnlineDeltaFeature();
     TestOnlineSpliceFrames();
     TestOnlineMfcc();
+    TestOnlineMfccMaxFeatureVectors();
     TestOnlinePlp();
     TestOnlineTransform();
     TestOnlineAppendFeature();
@@ -19,22 +19,59 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+
 #include "feat/online-feature.h"
 #include "transform/cmvn.h"
 
 namespace kaldi {
 
+RecyclingVector::RecyclingVector(int32 items_to_hold):
+    items_to_hold_(items_to_hold), first_available_index_(0) { }
+
+RecyclingVector::~RecyclingVector() {
+  for (size_t i = 0; i < items_.size(); i++)
+    delete items_[i];
+}
+
+Vector<BaseFloat> *RecyclingVector::At(int32 index) const {
+  if (index < first_available_index_ || index >= Size())
+    KALDI_ERR << "Attempted to get feature vector " << index << ", but only "
+              << "frames " << first_available_index_ << " to " << Size() - 1
+              << " are available (see --max-feature-vectors).";
+  return items_[index - first_available_index_];
+}
+
+void RecyclingVector::PushBack(Vector<BaseFloat> *item) {
+  if (items_to_hold_ > 0 &&
+      static_cast<int32>(items_.size()) == items_to_hold_) {
+    delete items_.front();
+    items_.pop_front();
+    first_available_index_++;
+  }
+  items_.push_back(item);
+}
+
+
 template<class C>
 void OnlineGenericBaseFeature<C>::GetFrame(int32 frame,
                                            VectorBase<BaseFloat> *feat) {
-  // 'at' does size checking.
-  feat->CopyFromVec(*(features_.at(frame)));
+  feat->CopyFromVec(*(features_.At(frame)));
 };
 
+template<class C>
+void OnlineGenericBaseFeature<C>::GetFrames(const std::vector<int32> &frames,
+                                            MatrixBase<BaseFloat> *feats) {
+  KALDI_ASSERT(static_cast<int32>(frames.size()) == feats->NumRows());
+  for (size_t i = 0; i < frames.size(); i++)
+    feats->Row(i).CopyFromVec(*(features_.At(frames[i])));
+}
+
 template<class C>
 OnlineGenericBaseFeature<C>::OnlineGenericBaseFeature(
     const typename C::Options &opts):
     computer_(opts), window_function_(computer_.GetFrameOptions()),
+    features_(computer_.GetFrameOptions().max_feature_vectors),
     input_finished_(false), waveform_offset_(0) { }
 
 template<class C>
@@ -63,25 +100,37 @@ template<class C>
 void OnlineGenericBaseFeature<C>::ComputeFeatures() {
   const FrameExtractionOptions &frame_opts = computer_.GetFrameOptions();
   int64 num_samples_total = waveform_offset_ + waveform_remainder_.Dim();
-  int32 num_frames_old = features_.size(),
+  int32 num_frames_old = features_.Size(),
       num_frames_new = NumFrames(num_samples_total, frame_opts,
                                  input_finished_);
   KALDI_ASSERT(num_frames_new >= num_frames_old);
-  features_.resize(num_frames_new, NULL);
 
-  Vector<BaseFloat> window;
+  // The new frames are done in blocks (as in OfflineFeatureTpl) so that the
+  // windows stay in the cache.
+  const int32 block_size = 256;
+  Vector<BaseFloat> window, raw_log_energies;
+  Matrix<BaseFloat> windows, block_features;
   bool need_raw_log_energy = computer_.NeedRawLogEnergy();
-  for (int32 frame = num_frames_old; frame < num_frames_new; frame++) {
-    BaseFloat raw_log_energy = 0.0;
-    ExtractWindow(waveform_offset_, waveform_remainder_, frame,
-                  frame_opts, window_function_, &window,
-                  need_raw_log_energy ? &raw_log_energy : NULL);
-    Vector<BaseFloat> *this_feature = new Vector<BaseFloat>(computer_.Dim(),
-                                                            kUndefined);
+  for (int32 begin = num_frames_old; begin < num_frames_new;
+       begin += block_size) {
+    int32 num_rows = std::min(block_size, num_frames_new - begin);
+    windows.Resize(num_rows, frame_opts.PaddedWindowSize(), kUndefined);
+    raw_log_energies.Resize(num_rows);
+    for (int32 r = 0; r < num_rows; r++) {  // begin + r is the frame index.
+      BaseFloat raw_log_energy = 0.0;
+      ExtractWindow(waveform_offset_, waveform_remainder_, begin + r,
+                    frame_opts, window_function_, &window,
+                    need_raw_log_energy ? &raw_log_energy : NULL);
+      windows.Row(r).CopyFromVec(window);
+      raw_log_energies(r) = raw_log_energy;
+    }
+    block_features.Resize(num_rows, computer_.Dim(), kUndefined);
     // note: this online feature-extraction code does not support VTLN.
     BaseFloat vtln_warp = 1.0;
-    computer_.Compute(raw_log_energy, vtln_warp, &window, this_feature);
-    features_[frame] = this_feature;
+    computer_.ComputeBatch(raw_log_energies, vtln_warp, &windows,
+                           &block_features);
+    for (int32 r = 0; r < num_rows; r++)
+      features_.PushBack(new Vector<BaseFloat>(block_features.Row(r)));
   }
   // OK, we will now discard any portion of the signal that will not be
   // necessary to compute frames in the future.
@@ -193,8 +242,13 @@ void OnlineCmvn::GetMostRecentCachedFrame(int32 frame,
       n = static_cast<int32>(cached_stats_modulo_.size() - 1);
     }
   }
+  if (cached_stats_modulo_[n] == NULL) {
+    // it was discarded (see max_cached_frames), so we start again.
+    *cached_frame = -1;
+    stats->SetZero();
+    return;
+  }
   *cached_frame = n * opts_.modulus;
-  KALDI_ASSERT(cached_stats_modulo_[n] != NULL);
   stats->CopyFromMat(*(cached_stats_modulo_[n]));
 }
 
@@ -218,6 +272,16 @@ void OnlineCmvn::CacheFrame(int32 frame, const MatrixBase<double> &stats) {
       // current one.
       KALDI_ASSERT(n == cached_stats_modulo_.size());
       cached_stats_modulo_.push_back(new Matrix<double>(stats));
+      if (opts_.max_cached_frames > 0) {
+        int32 old_n = n - opts_.max_cached_frames / opts_.modulus - 1;
+        if (old_n >= 0) {
+          delete cached_stats_modulo_[old_n];
+          cached_stats_modulo_[old_n] = NULL;
+        }
+      }
+    } else if (cached_stats_modulo_[n] == NULL) {
+      // after going back to the start for a discarded frame.
+      cached_stats_modulo_[n] = new Matrix<double>(stats);
     } else {
       KALDI_WARN << "Did not expect to reach this part of code.";
       // do what seems right, but we shouldn't get here.
@@ -404,6 +468,35 @@ int32 OnlineSpliceFrames::NumFramesReady() const {
     return std::max<int32>(0, num_frames - right_context_);
 }
 
+// Gets the frames of "src" that the output frames "frames" of a feature with
+// the given left and right context need, i.e. frames *begin to
+// *begin + span->NumRows() - 1, in one call to src->GetFrames(), limiting
+// them to the frames that are ready.  Returns false without getting anything
+// if the frames are too far apart for that to be worth it, the caller should
+// then get them one by one.
+static bool GetContextFrames(OnlineFeatureInterface *src,
+                             const std::vector<int32> &frames,
+                             int32 left_context, int32 right_context,
+                             int32 *begin, Matrix<BaseFloat> *span) {
+  if (frames.empty()) return false;
+  int32 min_frame = *std::min_element(frames.begin(), frames.end()),
+      max_frame = *std::max_element(frames.begin(), frames.end()),
+      num_ready = src->NumFramesReady();
+  int32 first = std::max<int32>(0, min_frame - left_context),
+      last = std::min<int32>(num_ready - 1, max_frame + right_context);
+  KALDI_ASSERT(last >= first);
+  int32 num_frames = last + 1 - first,
+      context = 1 + left_context + right_context;
+  if (num_frames > 2 * static_cast<int32>(frames.size()) * context)
+    return false;
+  std::vector<int32> src_frames(num_frames);
+  for (int32 t = 0; t < num_frames; t++) src_frames[t] = first + t;
+  span->Resize(num_frames, src->Dim(), kUndefined);
+  src->GetFrames(src_frames, span);
+  *begin = first;
+  return true;
+}
+
 void OnlineSpliceFrames::GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
   KALDI_ASSERT(left_context_ >= 0 && right_context_ >= 0);
   KALDI_ASSERT(frame >= 0 && frame < NumFramesReady());
@@ -421,6 +514,33 @@ void OnlineSpliceFrames::GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
   }
 }
 
+void OnlineSpliceFrames::GetFrames(const std::vector<int32> &frames,
+                                   MatrixBase<BaseFloat> *feats) {
+  KALDI_ASSERT(static_cast<int32>(frames.size()) == feats->NumRows());
+  KALDI_ASSERT(left_context_ >= 0 && right_context_ >= 0);
+  int32 begin;
+  Matrix<BaseFloat> span;
+  if (!GetContextFrames(src_, frames, left_context_, right_context_,
+                        &begin, &span)) {
+    OnlineFeatureInterface::GetFrames(frames, feats);
+    return;
+  }
+  int32 dim_in = src_->Dim(), last = begin + span.NumRows() - 1;
+  KALDI_ASSERT(feats->NumCols() == dim_in * (1 + left_context_ +
+                                             right_context_));
+  for (size_t i = 0; i < frames.size(); i++) {
+    int32 frame = frames[i];
+    KALDI_ASSERT(frame >= 0 && frame < NumFramesReady());
+    for (int32 t2 = frame - left_context_; t2 <= frame + right_context_;
+         t2++) {
+      int32 t2_limited = std::min(std::max(t2, begin), last),
+          n = t2 - (frame - left_context_);
+      SubVector<BaseFloat> part(feats->Row(i), n * dim_in, dim_in);
+      part.CopyFromVec(span.Row(t2_limited - begin));
+    }
+  }
+}
+
 OnlineTransform::OnlineTransform(const MatrixBase<BaseFloat> &transform,
                                  OnlineFeatureInterface *src):
     src_(src) {
@@ -499,6 +619,30 @@ void OnlineDeltaFeature::GetFrame(int32 frame,
   delta_features_.Process(temp_src, temp_t, feat);
 }
 
+void OnlineDeltaFeature::GetFrames(const std::vector<int32> &frames,
+                                   MatrixBase<BaseFloat> *feats) {
+  KALDI_ASSERT(static_cast<int32>(frames.size()) == feats->NumRows());
+  int32 context = opts_.order * opts_.window, begin;
+  Matrix<BaseFloat> span;
+  if (!GetContextFrames(src_, frames, context, context, &begin, &span)) {
+    OnlineFeatureInterface::GetFrames(frames, feats);
+    return;
+  }
+  int32 last = begin + span.NumRows() - 1, num_ready = NumFramesReady();
+  for (size_t i = 0; i < frames.size(); i++) {
+    int32 frame = frames[i];
+    KALDI_ASSERT(frame >= 0 && frame < num_ready);
+    // the same truncated context as GetFrame() uses.
+    int32 left_frame = std::max(frame - context, begin),
+        right_frame = std::min(frame + context, last);
+    SubMatrix<BaseFloat> temp_src(span, left_frame - begin,
+                                  right_frame + 1 - left_frame,
+                                  0, span.NumCols());
+    SubVector<BaseFloat> feat(*feats, i);
+    delta_features_.Process(temp_src, frame - left_frame, &feat);
+  }
+}
+
 
 OnlineDeltaFeature::OnlineDeltaFeature(const DeltaFeaturesOptions &opts,
                                        OnlineFeatureInterface *src):
@@ -506,16 +650,13 @@ OnlineDeltaFeature::OnlineDeltaFeature(const DeltaFeaturesOptions &opts,
 
 void OnlineCacheFeature::GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
   KALDI_ASSERT(frame >= 0);
-  if (static_cast<size_t>(frame) < cache_.size() && cache_[frame] != NULL) {
-    feat->CopyFromVec(*(cache_[frame]));
+  const Vector<BaseFloat> *cached = CachedFrame(frame);
+  if (cached != NULL) {
+    feat->CopyFromVec(*cached);
   } else {
-    if (static_cast<size_t>(frame) >= cache_.size())
-      cache_.resize(frame + 1, NULL);
-    int32 dim = this->Dim();
-    cache_[frame] = new Vector<BaseFloat>(dim);
     // The following call will crash if frame "frame" is not ready.
-    src_->GetFrame(frame, cache_[frame]);
-    feat->CopyFromVec(*(cache_[frame]));
+    src_->GetFrame(frame, feat);
+    CacheFrame(frame, *feat);
   }
 }
 
@@ -532,8 +673,9 @@ void OnlineCacheFeature::GetFrames(
   non_cached_indexes.reserve(frames.size());
   for (int32 i = 0; i < num_frames; i++) {
     int32 t = frames[i];
-    if (static_cast<size_t>(t) < cache_.size() && cache_[t] != NULL) {
-      feats->Row(i).CopyFromVec(*(cache_[t]));
+    const Vector<BaseFloat> *cached = CachedFrame(t);
+    if (cached != NULL) {
+      feats->Row(i).CopyFromVec(*cached);
     } else {
       non_cached_frames.push_back(t);
       non_cached_indexes.push_back(i);
@@ -547,25 +689,44 @@ void OnlineCacheFeature::GetFrames(
                                      kUndefined);
   src_->GetFrames(non_cached_frames, &non_cached_feats);
   for (int32 i = 0; i < num_non_cached_frames; i++) {
-    int32 t = non_cached_frames[i];
-    if (static_cast<size_t>(t) < cache_.size() && cache_[t] != NULL) {
-      // We can reach this point due to repeat indexes in 'non_cached_frames'.
-      feats->Row(non_cached_indexes[i]).CopyFromVec(*(cache_[t]));
-    } else {
-      SubVector<BaseFloat> this_feat(non_cached_feats, i);
-      feats->Row(non_cached_indexes[i]).CopyFromVec(this_feat);
-      if (static_cast<size_t>(t) >= cache_.size())
-        cache_.resize(t + 1, NULL);
-      cache_[t] = new Vector<BaseFloat>(this_feat);
-    }
+    SubVector<BaseFloat> this_feat(non_cached_feats, i);
+    feats->Row(non_cached_indexes[i]).CopyFromVec(this_feat);
+    // (with repeated indexes in 'non_cached_frames', the frame may already
+    // have been cached.)
+    if (CachedFrame(non_cached_frames[i]) == NULL)
+      CacheFrame(non_cached_frames[i], this_feat);
   }
 }
 
+const Vector<BaseFloat> *OnlineCacheFeature::CachedFrame(int32 frame) const {
+  int32 i = frame - cache_offset_;
+  if (i < 0 || static_cast<size_t>(i) >= cache_.size())
+    return NULL;
+  return cache_[i];
+}
+
+void OnlineCacheFeature::CacheFrame(int32 frame,
+                                    const VectorBase<BaseFloat> &feat) {
+  int32 i = frame - cache_offset_;
+  if (i < 0)
+    return;  // it is older than the frames we keep.
+  if (static_cast<size_t>(i) >= cache_.size())
+    cache_.resize(i + 1, NULL);
+  cache_[i] = new Vector<BaseFloat>(feat);
+  if (max_cached_frames_ > 0) {
+    while (static_cast<int32>(cache_.size()) > max_cached_frames_) {
+      delete cache_.front();
+      cache_.pop_front();
+      cache_offset_++;
+    }
+  }
+}
 
 void OnlineCacheFeature::ClearCache() {
   for (size_t i = 0; i < cache_.size(); i++)
     delete cache_[i];
-  cache_.resize(0);
+  cache_.clear();
+  cache_offset_ = 0;
 }
 
 
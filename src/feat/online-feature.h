@@ -41,6 +41,40 @@ namespace kaldi {
 /// @{
 
 
+/// RecyclingVector stores the feature vectors of the frames of an online
+/// feature, keeping only the most recent "items_to_hold" of them if that is
+/// > 0, so that long streams don't use ever more memory.  The frames are still
+/// indexed from the start of the stream.
+class RecyclingVector {
+ public:
+  /// By default it does not remove any elements.
+  explicit RecyclingVector(int32 items_to_hold = -1);
+
+  /// The vector is owned by this class.  It is an error to ask for a frame
+  /// that has been removed.
+  Vector<BaseFloat> *At(int32 index) const;
+
+  /// Takes ownership of "item".
+  void PushBack(Vector<BaseFloat> *item);
+
+  /// The number of items pushed back, including those that have since been
+  /// removed.
+  int32 Size() const { return first_available_index_ + items_.size(); }
+
+  /// The index of the first item that has not been removed.
+  int32 FirstAvailableIndex() const { return first_available_index_; }
+
+  ~RecyclingVector();
+
+ private:
+  std::deque<Vector<BaseFloat>*> items_;
+  int32 items_to_hold_;
+  int32 first_available_index_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(RecyclingVector);
+};
+
+
 /// This is a templated class for online feature extraction;
 /// it's templated on a class like MfccComputer or PlpComputer
 /// that does the basic feature extraction.
@@ -61,12 +95,19 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
     return computer_.GetFrameOptions().frame_shift_ms / 1000.0f;
   }
 
-  virtual int32 NumFramesReady() const { return features_.size(); }
+  virtual int32 NumFramesReady() const { return features_.Size(); }
 
   virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
 
+  virtual void GetFrames(const std::vector<int32> &frames,
+                         MatrixBase<BaseFloat> *feats);
+
   // Next, functions that are not in the interface.
 
+  // The first frame that can still be got with GetFrame(); it is nonzero if
+  // the max-feature-vectors option is set.
+  int32 FirstFrameAvailable() const { return features_.FirstAvailableIndex(); }
+
 
   // Constructor from options class
   explicit OnlineGenericBaseFeature(const typename C::Options &opts);
@@ -88,9 +129,7 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
     ComputeFeatures();
   }
 
-  ~OnlineGenericBaseFeature() {
-    DeletePointers(&features_);
-  }
+  ~OnlineGenericBaseFeature() { }
 
  private:
   // This function computes any additional feature frames that it is possible to
@@ -99,15 +138,16 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
   // waveform_remainder_ before calling this function).  It adds these feature
   // frames to features_, and shifts off any now-unneeded samples of input from
   // waveform_remainder_ while incrementing waveform_offset_ by the same amount.
+  // The new frames are computed together with C::ComputeBatch().
   void ComputeFeatures();
 
   C computer_;  // class that does the MFCC or PLP or filterbank computation
 
   FeatureWindowFunction window_function_;
 
-  // features_ is the Mfcc or Plp or Fbank features that we have already computed.
-
-  std::vector<Vector<BaseFloat>*> features_;
+  // features_ is the Mfcc or Plp or Fbank features that we have already
+  // computed (the most recent of them, if max_feature_vectors > 0).
+  RecyclingVector features_;
 
   // True if the user has called "InputFinished()"
   bool input_finished_;
@@ -186,6 +226,8 @@ struct OnlineCmvnOptions {
                            // modulus.
   std::string skip_dims; // Colon-separated list of dimensions to skip normalization
                          // of, e.g. 13:14:15.
+  int32 max_cached_frames;  // if > 0, the stats cached every "modulus" frames
+                            // are only kept for this many frames.
 
   OnlineCmvnOptions():
       cmn_window(600),
@@ -195,7 +237,8 @@ struct OnlineCmvnOptions {
       normalize_variance(false),
       modulus(20),
       ring_buffer_size(20),
-      skip_dims("") { }
+      skip_dims(""),
+      max_cached_frames(-1) { }
 
   void Check() {
     KALDI_ASSERT(speaker_frames <= cmn_window && global_frames <= speaker_frames
@@ -219,7 +262,12 @@ struct OnlineCmvnOptions {
     po->Register("norm-means", &normalize_mean, "If true, do mean normalization "
                  "(note: you cannot normalize the variance but not the mean)");
     po->Register("skip-dims", &skip_dims, "Dimensions to skip normalization of "
-                 "(colon-separated list of integers)");}
+                 "(colon-separated list of integers)");
+    po->Register("max-cached-frames", &max_cached_frames, "If > 0, the "
+                 "statistics cached for frames more than this many frames "
+                 "before the latest one are discarded, so that the memory used "
+                 "does not grow with the length of the stream; frames that old "
+                 "can then only be normalized by going back to the start.");}
 };
 
 
@@ -446,6 +494,9 @@ class OnlineSpliceFrames: public OnlineFeatureInterface {
 
   virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
 
+  virtual void GetFrames(const std::vector<int32> &frames,
+                         MatrixBase<BaseFloat> *feats);
+
   //
   // Next, functions that are not in the interface.
   //
@@ -516,6 +567,9 @@ class OnlineDeltaFeature: public OnlineFeatureInterface {
 
   virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
 
+  virtual void GetFrames(const std::vector<int32> &frames,
+                         MatrixBase<BaseFloat> *feats);
+
   //
   // Next, functions that are not in the interface.
   //
@@ -557,11 +611,25 @@ class OnlineCacheFeature: public OnlineFeatureInterface {
   void ClearCache();  // this should be called if you change the underlying
                       // features in some way.
 
-  explicit OnlineCacheFeature(OnlineFeatureInterface *src): src_(src) { }
+  /// If max_cached_frames > 0, only that many frames are kept, up to the most
+  /// recent one cached; earlier frames are got from "src" again (uncached)
+  /// if they are asked for.
+  explicit OnlineCacheFeature(OnlineFeatureInterface *src,
+                              int32 max_cached_frames = -1):
+      src_(src), cache_offset_(0), max_cached_frames_(max_cached_frames) { }
  private:
+  // Returns the cached features of the frame, or NULL.
+  const Vector<BaseFloat> *CachedFrame(int32 frame) const;
+
+  // Caches the features of the frame (unless it's too old), and removes any
+  // frames that are then too old.
+  void CacheFrame(int32 frame, const VectorBase<BaseFloat> &feat);
 
   OnlineFeatureInterface *src_;  // Not owned here
-  std::vector<Vector<BaseFloat>* > cache_;
+  // cache_[i] is frame cache_offset_ + i, or NULL if that was not asked for.
+  std::deque<Vector<BaseFloat>* > cache_;
+  int32 cache_offset_;
+  int32 max_cached_frames_;
 };
 
 
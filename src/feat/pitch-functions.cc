@@ -109,16 +109,36 @@ void ComputeCorrelation(const VectorBase<BaseFloat> &wave,
   SubVector<BaseFloat> wave_part(wave, 0, nccf_window_size);
   // subtract mean-frame from wave
   zero_mean_wave.Add(-wave_part.Sum() / nccf_window_size);
-  BaseFloat e1, e2, sum;
   SubVector<BaseFloat> sub_vec1(zero_mean_wave, 0, nccf_window_size);
-  e1 = VecVec(sub_vec1, sub_vec1);
+  BaseFloat e1 = VecVec(sub_vec1, sub_vec1);
+  SubVector<BaseFloat> sub_vec2(zero_mean_wave, first_lag, nccf_window_size);
+  // e2 is updated from lag to lag, as the window moves by one sample; it is
+  // kept in double so that the rounding errors do not build up.
+  double e2 = VecVec(sub_vec2, sub_vec2);
+  const BaseFloat *data = zero_mean_wave.Data();
   for (int32 lag = first_lag; lag <= last_lag; lag++) {
-    SubVector<BaseFloat> sub_vec2(zero_mean_wave, lag, nccf_window_size);
-    e2 = VecVec(sub_vec2, sub_vec2);
-    sum = VecVec(sub_vec1, sub_vec2);
-    (*inner_prod)(lag - first_lag) = sum;
+    if (lag > first_lag) {
+      double leaving = data[lag - 1],
+          entering = data[lag + nccf_window_size - 1];
+      e2 += entering * entering - leaving * leaving;
+      if (e2 < 0.0) e2 = 0.0;
+    }
     (*norm_prod)(lag - first_lag) = e1 * e2;
   }
+
+  for (int32 lag = first_lag; lag <= last_lag; lag++) {
+    SubVector<BaseFloat> sub_vec2(zero_mean_wave, lag, nccf_window_size);
+    (*inner_prod)(lag - first_lag) = VecVec(sub_vec1, sub_vec2);
+  }
+
+  // The rounding of e2 can take an inner product slightly outside the bounds
+  // that the Cauchy-Schwarz inequality puts on it, which matters where e2 is
+  // close to zero, e.g. in digital silence.
+  for (int32 i = 0; i < inner_prod->Dim(); i++) {
+    BaseFloat bound = std::sqrt((*norm_prod)(i));
+    if ((*inner_prod)(i) > bound) (*inner_prod)(i) = bound;
+    else if ((*inner_prod)(i) < -bound) (*inner_prod)(i) = -bound;
+  }
 }
 
 /**
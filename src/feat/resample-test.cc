@@ -275,12 +275,63 @@ void UnitTestLinearResample2() {
   AssertEqual(self1, cross, 0.001);
 }
 
+void UnitTestLinearResampleRates() {
+  // checks LinearResample against ArbitraryResample for the sampling rates we
+  // usually convert between, whose repeating units are short (a few samples),
+  // with the signal in pieces of random size.
+  int32 rates[][2] = { { 48000, 16000 }, { 16000, 48000 }, { 44100, 16000 },
+                       { 16000, 44100 }, { 16000, 8000 }, { 8000, 16000 } };
+  int32 r = RandInt(0, 5),
+      samp_freq = rates[r][0], resamp_freq = rates[r][1];
+  // a few of the repeating units of 44.1k to 16k (441 samples).
+  int32 num_samp = RandInt(1000, 3000);
+  BaseFloat lowpass_freq = 0.99 * 0.5 * std::min(samp_freq, resamp_freq);
+  int32 num_zeros = RandInt(3, 8);
+
+  int32 num_resamp = ceil(num_samp * static_cast<BaseFloat>(resamp_freq) /
+                          samp_freq);
+  Vector<BaseFloat> resample_points(num_resamp);
+  for (int32 i = 0; i < num_resamp; i++)
+    resample_points(i) = i / static_cast<BaseFloat>(resamp_freq);
+  ArbitraryResample resampler(num_samp, samp_freq, lowpass_freq,
+                              resample_points, num_zeros);
+  Vector<BaseFloat> test_signal(num_samp), resampled_values(num_resamp);
+  test_signal.SetRandn();
+  resampler.Resample(test_signal, &resampled_values);
+
+  LinearResample linear_resampler(samp_freq, resamp_freq,
+                                  lowpass_freq, num_zeros);
+  Vector<BaseFloat> resampled_vec;
+  int32 input_dim_seen = 0;
+  while (input_dim_seen < test_signal.Dim()) {
+    int32 dim_remaining = test_signal.Dim() - input_dim_seen,
+        piece_size = RandInt(0, std::min(dim_remaining, 500));
+    SubVector<BaseFloat> in_piece(test_signal, input_dim_seen, piece_size);
+    Vector<BaseFloat> out_piece;
+    linear_resampler.Resample(in_piece, piece_size == dim_remaining,
+                              &out_piece);
+    int32 old_output_dim = resampled_vec.Dim();
+    resampled_vec.Resize(old_output_dim + out_piece.Dim(), kCopyData);
+    resampled_vec.Range(old_output_dim, out_piece.Dim())
+                 .CopyFromVec(out_piece);
+    input_dim_seen += piece_size;
+  }
+
+  if (!ApproxEqual(resampled_values, resampled_vec)) {
+    KALDI_LOG << "ArbitraryResample: " << resampled_values;
+    KALDI_LOG << "LinearResample[broken-up]: " << resampled_vec;
+    KALDI_ERR << "Signals differ for " << samp_freq << " to " << resamp_freq;
+  }
+}
+
 int main() {
   try {
     for (int32 x = 0; x < 50; x++)
       UnitTestLinearResample();
     for (int32 x = 0; x < 50; x++)
-      UnitTestLinearResample2();    
+      UnitTestLinearResample2();
+    for (int32 x = 0; x < 20; x++)
+      UnitTestLinearResampleRates();
     for (int32 x = 0; x < 50; x++)
       UnitTestArbitraryResample();
 
@@ -23,12 +23,43 @@
 
 #include <algorithm>
 #include <limits>
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
 #include "feat/feature-functions.h"
 #include "matrix/matrix-functions.h"
 #include "feat/resample.h"
 
 namespace kaldi {
 
+// The filters are short (e.g. 36 samples, for 48k to 16k), so the dot products
+// of LinearResample are done inline rather than by BLAS; for float, four
+// elements at a time where SSE2 is available (it is part of x86-64).
+template<typename Real>
+static inline Real DotProduct(const Real *a, const Real *b, int32 dim) {
+  Real sum = 0.0;
+  for (int32 i = 0; i < dim; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+#if defined(__SSE2__)
+template<>
+inline float DotProduct(const float *a, const float *b, int32 dim) {
+  __m128 sum4 = _mm_setzero_ps();
+  int32 i = 0;
+  for (; i + 4 <= dim; i += 4)
+    sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                       _mm_loadu_ps(b + i)));
+  float sums[4];
+  _mm_storeu_ps(sums, sum4);
+  float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  for (; i < dim; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+#endif
+
 
 LinearResample::LinearResample(int32 samp_rate_in_hz,
                                int32 samp_rate_out_hz,
@@ -130,22 +161,17 @@ void LinearResample::SetIndexesAndWeights() {
       weights_[i](j) = FilterFunc(delta_t) / samp_rate_in_;
     }
   }
-}
-
 
-// inline
-void LinearResample::GetIndexes(int64 samp_out,
-                                int64 *first_samp_in,
-                                int32 *samp_out_wrapped) const {
-  // A unit is the smallest nonzero amount of time that is an exact
-  // multiple of the input and output sample periods.  The unit index
-  // is the answer to "which numbered unit we are in".
-  int64 unit_index = samp_out / output_samples_in_unit_;
-  // samp_out_wrapped is equal to samp_out % output_samples_in_unit_
-  *samp_out_wrapped = static_cast<int32>(samp_out -
-                                         unit_index * output_samples_in_unit_);
-  *first_samp_in = first_index_[*samp_out_wrapped] +
-      unit_index * input_samples_in_unit_;
+  int32 max_end_index = first_index_[0] + weights_[0].Dim();
+  min_first_index_ = first_index_[0];
+  for (int32 i = 1; i < output_samples_in_unit_; i++) {
+    min_first_index_ = std::min(min_first_index_, first_index_[i]);
+    max_end_index = std::max(max_end_index,
+                             first_index_[i] + weights_[i].Dim());
+  }
+  num_input_units_needed_ = (max_end_index - min_first_index_ +
+                             input_samples_in_unit_ - 1) /
+      input_samples_in_unit_;
 }
 
 
@@ -160,44 +186,13 @@ void LinearResample::Resample(const VectorBase<BaseFloat> &input,
 
   output->Resize(tot_output_samp - output_sample_offset_);
 
-  // samp_out is the index into the total output signal, not just the part
-  // of it we are producing here.
-  for (int64 samp_out = output_sample_offset_;
-       samp_out < tot_output_samp;
-       samp_out++) {
-    int64 first_samp_in;
-    int32 samp_out_wrapped;
-    GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const Vector<BaseFloat> &weights = weights_[samp_out_wrapped];
-    // first_input_index is the first index into "input" that we have a weight
-    // for.
-    int32 first_input_index = static_cast<int32>(first_samp_in -
-                                                 input_sample_offset_);
-    BaseFloat this_output;
-    if (first_input_index >= 0 &&
-        first_input_index + weights.Dim() <= input_dim) {
-      SubVector<BaseFloat> input_part(input, first_input_index, weights.Dim());
-      this_output = VecVec(input_part, weights);
-    } else {  // Handle edge cases.
-      this_output = 0.0;
-      for (int32 i = 0; i < weights.Dim(); i++) {
-        BaseFloat weight = weights(i);
-        int32 input_index = first_input_index + i;
-        if (input_index < 0 && input_remainder_.Dim() + input_index >= 0) {
-          this_output += weight *
-              input_remainder_(input_remainder_.Dim() + input_index);
-        } else if (input_index >= 0 && input_index < input_dim) {
-          this_output += weight * input(input_index);
-        } else if (input_index >= input_dim) {
-          // We're past the end of the input and are adding zero; should only
-          // happen if the user specified flush == true, or else we would not
-          // be trying to output this sample.
-          KALDI_ASSERT(flush);
-        }
-      }
-    }
-    int32 output_index = static_cast<int32>(samp_out - output_sample_offset_);
-    (*output)(output_index) = this_output;
+  // The output is computed a block at a time, so that the copy of the input
+  // that ResampleBlock() works on stays small.
+  const int32 block_size = 4096;
+  for (int32 i = 0; i < output->Dim(); i += block_size) {
+    SubVector<BaseFloat> output_block(*output, i,
+                                      std::min(block_size, output->Dim() - i));
+    ResampleBlock(input, output_sample_offset_ + i, &output_block);
   }
 
   if (flush) {
@@ -209,6 +204,48 @@ void LinearResample::Resample(const VectorBase<BaseFloat> &input,
   }
 }
 
+void LinearResample::ResampleBlock(const VectorBase<BaseFloat> &input,
+                                   int64 first_samp_out,
+                                   VectorBase<BaseFloat> *output) const {
+  int64 first_unit = first_samp_out / output_samples_in_unit_,
+      last_unit = (first_samp_out + output->Dim() - 1) /
+      output_samples_in_unit_;
+
+  // "signal" is the input from the sample with index signal_offset (in the
+  // whole signal) on, as far as the output samples need: from the remainder,
+  // the input, or zero if it is before the start (or after the end, in
+  // which case we are flushing).
+  int64 signal_offset = first_unit * input_samples_in_unit_ +
+      min_first_index_;
+  Vector<BaseFloat> signal((last_unit - first_unit + num_input_units_needed_) *
+                           input_samples_in_unit_);
+  int64 input_begin = std::max(signal_offset, input_sample_offset_),
+      input_end = std::min(signal_offset + signal.Dim(),
+                           input_sample_offset_ + input.Dim());
+  if (input_end > input_begin)
+    signal.Range(input_begin - signal_offset,
+                 input_end - input_begin).CopyFromVec(
+        input.Range(input_begin - input_sample_offset_,
+                    input_end - input_begin));
+  int64 remainder_offset = input_sample_offset_ - input_remainder_.Dim();
+  for (int64 t = std::max(signal_offset, remainder_offset);
+       t < input_sample_offset_ && t < signal_offset + signal.Dim(); t++)
+    signal(t - signal_offset) = input_remainder_(t - remainder_offset);
+
+  // unit_signal points to where the input for output sample i of the current
+  // unit would start if first_index_[i] were zero.
+  const BaseFloat *unit_signal = signal.Data() - min_first_index_;
+  int32 i = first_samp_out - first_unit * output_samples_in_unit_;
+  for (int32 n = 0; n < output->Dim(); n++) {
+    (*output)(n) = DotProduct(unit_signal + first_index_[i],
+                              weights_[i].Data(), weights_[i].Dim());
+    if (++i == output_samples_in_unit_) {
+      i = 0;
+      unit_signal += input_samples_in_unit_;
+    }
+  }
+}
+
 void LinearResample::SetRemainder(const VectorBase<BaseFloat> &input) {
   Vector<BaseFloat> old_remainder(input_remainder_);
   // max_remainder_needed is the width of the filter from side to side,
@@ -286,6 +323,12 @@ void ArbitraryResample::Resample(const MatrixBase<BaseFloat> &input,
                input.NumCols() == num_samples_in_ &&
                output->NumCols() == weights_.size());
 
+  if (dense_weights_.NumRows() != 0) {
+    // this is much faster than going down the columns of the output as below.
+    output->AddMatMat(1.0, input, kNoTrans, dense_weights_, kNoTrans, 0.0);
+    return;
+  }
+
   Vector<BaseFloat> output_col(output->NumRows());
   for (int32 i = 0; i < NumSamplesOut(); i++) {
     SubMatrix<BaseFloat> input_part(input, 0, input.NumRows(),
@@ -343,6 +386,15 @@ void ArbitraryResample::SetWeights(const Vector<BaseFloat> &sample_points) {
       weights_[i](j) = FilterFunc(delta_t) / samp_rate_in_;
     }
   }
+  // The dense weights are used if they take at most a few megabytes (there
+  // are at most a few hundred samples in the pitch code).
+  if (num_samples_out > 0 &&
+      static_cast<int64>(num_samples_in_) * num_samples_out <= (1 << 20)) {
+    dense_weights_.Resize(num_samples_in_, num_samples_out);
+    for (int32 i = 0; i < num_samples_out; i++)
+      dense_weights_.Range(first_index_[i], weights_[i].Dim(), i, 1).
+          CopyColFromVec(weights_[i], 0);
+  }
 }
 
 /** Here, t is a time in seconds representing an offset from
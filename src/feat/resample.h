@@ -109,6 +109,8 @@ class ArbitraryResample {
   /// and nonzero.
   /// input.NumCols() should equal NumSamplesIn()
   /// and output.NumCols() should equal NumSamplesOut().
+  /// Unless there are very many samples, this is a single matrix
+  /// multiplication.
   void Resample(const MatrixBase<BaseFloat> &input,
                 MatrixBase<BaseFloat> *output) const;
 
@@ -131,6 +133,10 @@ class ArbitraryResample {
   std::vector<int32> first_index_;  // The first input-sample index that we sum
                                     // over, for this output-sample index.
   std::vector<Vector<BaseFloat> > weights_;
+  // weights_ as a matrix, of dimension NumSamplesIn() by NumSamplesOut(), for
+  // the matrix version of Resample(); empty if it would be too large, in which
+  // case that works an output sample at a time.
+  Matrix<BaseFloat> dense_weights_;
 };
 
 
@@ -197,18 +203,18 @@ class LinearResample {
   int64 GetNumOutputSamples(int64 input_num_samp, bool flush) const;
 
 
-  /// Given an output-sample index, this function outputs to *first_samp_in the
-  /// first input-sample index that we have a weight on (may be negative),
-  /// and to *samp_out_wrapped the index into weights_ where we can get the
-  /// corresponding weights on the input.
-  inline void GetIndexes(int64 samp_out,
-                         int64 *first_samp_in,
-                         int32 *samp_out_wrapped) const;
-
   void SetRemainder(const VectorBase<BaseFloat> &input);
 
   void SetIndexesAndWeights();
 
+  /// Outputs to "output" the output samples from first_samp_out on, for the
+  /// input given to Resample() (with the offset and remainder as they are
+  /// before it updates them).  This works on a copy of the input that those
+  /// samples need, so that there are no edge cases in the filtering.
+  void ResampleBlock(const VectorBase<BaseFloat> &input,
+                     int64 first_samp_out,
+                     VectorBase<BaseFloat> *output) const;
+
   BaseFloat FilterFunc(BaseFloat) const;
 
   // The following variables are provided by the user.
@@ -236,6 +242,12 @@ class LinearResample {
   /// Weights on the input samples, for this output-sample index.
   std::vector<Vector<BaseFloat> > weights_;
 
+  /// The smallest of first_index_, i.e. where the input that the output
+  /// samples of unit zero need starts, and the length of that input rounded up
+  /// to a whole number of units, as a number of units.
+  int32 min_first_index_;
+  int32 num_input_units_needed_;
+
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
 
@@ -198,11 +198,60 @@ static void UnitTestEndless2() {
   AssertEqual(wave.Data(), expected);
 }
 
+static void UnitTestStreamReader() {
+  // Writes random wave data, and reads it back a random number of samples at
+  // a time.
+  int32 num_channels = RandInt(1, 3), num_samples = RandInt(1, 5000);
+  Matrix<BaseFloat> data(num_channels, num_samples);
+  for (int32 i = 0; i < num_channels; i++)
+    for (int32 j = 0; j < num_samples; j++)
+      data(i, j) = RandInt(-32768, 32767);
+  std::ostringstream ows(std::ios::out | std::ios::binary);
+  WaveData(16000, data).Write(ows);
+
+  std::istringstream iws(ows.str(), std::ios::in | std::ios::binary);
+  WaveStreamReader reader(iws);
+  AssertEqual(reader.Info().SampFreq(), 16000, 0);
+  KALDI_ASSERT(reader.Info().NumChannels() == num_channels &&
+               reader.Info().SampleCount() == num_samples);
+  Matrix<BaseFloat> read_data(num_channels, num_samples);
+  int32 num_read = 0;
+  while (true) {
+    Matrix<BaseFloat> chunk(num_channels, RandInt(1, 1000));
+    int32 n = reader.Read(&chunk);
+    KALDI_ASSERT(n <= num_samples - num_read);
+    if (n == 0) break;
+    read_data.ColRange(num_read, n).CopyFromMat(chunk.ColRange(0, n));
+    num_read += n;
+    KALDI_ASSERT(reader.NumSamplesRead() == num_read);
+  }
+  KALDI_ASSERT(num_read == num_samples);
+  AssertEqual(read_data, data);
+
+  // A truncated file gives the samples that are there.
+  if (num_samples == 1) return;
+  int32 num_truncated = RandInt(1, num_samples - 1);
+  std::string truncated = ows.str().substr(
+      0, ows.str().size() - num_truncated * 2 * num_channels);
+  std::istringstream its(truncated, std::ios::in | std::ios::binary);
+  WaveStreamReader truncated_reader(its);
+  Matrix<BaseFloat> chunk(num_channels, num_samples);
+  KALDI_ASSERT(truncated_reader.Read(&chunk) == num_samples - num_truncated);
+  KALDI_ASSERT(truncated_reader.Read(&chunk) == 0);
+  std::istringstream its2(truncated, std::ios::in | std::ios::binary);
+  WaveData wave;
+  wave.Read(its2);
+  AssertEqual(wave.Data(), Matrix<BaseFloat>(
+      data.ColRange(0, num_samples - num_truncated)));
+}
+
 static void UnitTest() {
   UnitTestStereo8K();
   UnitTestMono22K();
   UnitTestEndless1();
   UnitTestEndless2();
+  for (int32 i = 0; i < 10; i++)
+    UnitTestStreamReader();
 }
 
 int main() {
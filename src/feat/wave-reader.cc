@@ -28,6 +28,7 @@
 #include "feat/wave-reader.h"
 #include "base/kaldi-error.h"
 #include "base/kaldi-utils.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 
@@ -269,56 +270,104 @@ void WaveInfo::Read(std::istream &is) {
     samp_count_ = data_chunk_size / block_align;
 }
 
+WaveStreamReader::WaveStreamReader(std::istream &is):
+    is_(is), num_samples_read_(0) {
+  header_.Read(is);
+  samples_to_go_ = header_.IsStreamed() ? -1 : header_.SampleCount();
+}
+
+int32 WaveStreamReader::Read(MatrixBase<BaseFloat> *samples) {
+  KALDI_ASSERT(samples->NumRows() == header_.NumChannels());
+  int32 num_samples = samples->NumCols();
+  // Once in a while header.DataBytes() will report an insane value; we then
+  // read to the end of the file.
+  if (samples_to_go_ >= 0 && samples_to_go_ < num_samples)
+    num_samples = samples_to_go_;
+  if (num_samples == 0 || !is_)
+    return 0;
+  size_t block_align = header_.BlockAlign();
+  buffer_.resize(num_samples * block_align);
+  is_.read(&buffer_[0], buffer_.size());
+  if (is_.bad())
+    KALDI_ERR << "WaveData: file read error";
+  // any part of a sample at the end of the file is ignored.
+  num_samples = is_.gcount() / block_align;
+  if (samples_to_go_ >= 0)
+    samples_to_go_ -= num_samples;
+
+  const int16 *data_ptr = reinterpret_cast<const int16*>(&buffer_[0]);
+  int32 num_channels = header_.NumChannels();
+  for (int32 i = 0; i < num_samples; i++) {
+    for (int32 j = 0; j < num_channels; j++) {
+      int16 k = *data_ptr++;
+      if (header_.ReverseBytes())
+        KALDI_SWAP2(k);
+      (*samples)(j, i) = k;
+    }
+  }
+  num_samples_read_ += num_samples;
+  return num_samples;
+}
+
 void WaveData::Read(std::istream &is) {
   const uint32 kBlockSize = 1024 * 1024;
 
-  WaveInfo header;
-  header.Read(is);
+  WaveStreamReader reader(is);
+  const WaveInfo &header = reader.Info();
 
   data_.Resize(0, 0);  // clear the data.
   samp_freq_ = header.SampFreq();
 
-  std::vector<char> buffer;
-  uint32 bytes_to_go = header.IsStreamed() ? kBlockSize : header.DataBytes();
-
-  // Once in a while header.DataBytes() will report an insane value;
-  // read the file to the end
-  while (is && bytes_to_go > 0) {
-    uint32 block_bytes = std::min(bytes_to_go, kBlockSize);
-    uint32 offset = buffer.size();
-    buffer.resize(offset + block_bytes);
-    is.read(&buffer[offset], block_bytes);
-    uint32 bytes_read = is.gcount();
-    buffer.resize(offset + bytes_read);
-    if (!header.IsStreamed())
-      bytes_to_go -= bytes_read;
+  int32 block_samples = kBlockSize / header.BlockAlign();
+  if (!header.IsStreamed() && header.SampleCount() > 0) {
+    // The samples are read straight into the matrix, which is arranged row
+    // per channel, column per sample.
+    data_.Resize(header.NumChannels(), header.SampleCount(), kUndefined);
+    int32 num_read = 0;
+    while (num_read < data_.NumCols()) {
+      SubMatrix<BaseFloat> block(data_, 0, data_.NumRows(), num_read,
+                                 std::min(block_samples,
+                                          data_.NumCols() - num_read));
+      int32 n = reader.Read(&block);
+      num_read += n;
+      if (n < block.NumCols())
+        break;
+    }
+    if (num_read == 0) {
+      data_.Resize(0, 0);
+    } else if (num_read < data_.NumCols()) {
+      KALDI_WARN << "Expected " << header.DataBytes() << " bytes of wave data, "
+                 << "but read only " << num_read * header.BlockAlign()
+                 << " bytes. Truncated file?";
+      Matrix<BaseFloat> data(data_.ColRange(0, num_read));
+      data_.Swap(&data);
+    }
+  } else if (header.IsStreamed()) {
+    std::vector<Matrix<BaseFloat>*> blocks;
+    int32 n;
+    do {
+      Matrix<BaseFloat> *block = new Matrix<BaseFloat>(header.NumChannels(),
+                                                       block_samples,
+                                                       kUndefined);
+      blocks.push_back(block);
+      n = reader.Read(block);
+    } while (n == block_samples);
+    if (reader.NumSamplesRead() > 0) {
+      data_.Resize(header.NumChannels(), reader.NumSamplesRead(), kUndefined);
+      for (size_t i = 0; i < blocks.size(); i++) {
+        int32 offset = i * block_samples,
+            num_samples = std::min<int64>(block_samples,
+                                          data_.NumCols() - offset);
+        if (num_samples > 0)
+          data_.ColRange(offset, num_samples).CopyFromMat(
+              blocks[i]->ColRange(0, num_samples));
+      }
+    }
+    DeletePointers(&blocks);
   }
 
-  if (is.bad())
-    KALDI_ERR << "WaveData: file read error";
-
-  if (buffer.size() == 0)
+  if (data_.NumCols() == 0)
     KALDI_ERR << "WaveData: empty file (no data)";
-
-  if (!header.IsStreamed() && buffer.size() < header.DataBytes()) {
-    KALDI_WARN << "Expected " << header.DataBytes() << " bytes of wave data, "
-               << "but read only " << buffer.size() << " bytes. "
-               << "Truncated file?";
-  }
-
-  uint16 *data_ptr = reinterpret_cast<uint16*>(&buffer[0]);
-
-  // The matrix is arranged row per channel, column per sample.
-  data_.Resize(header.NumChannels(),
-               buffer.size() / header.BlockAlign());
-  for (uint32 i = 0; i < data_.NumCols(); ++i) {
-    for (uint32 j = 0; j < data_.NumRows(); ++j) {
-      int16 k = *data_ptr++;
-      if (header.ReverseBytes())
-        KALDI_SWAP2(k);
-      data_(j, i) =  k;
-    }
-  }
 }
 
 
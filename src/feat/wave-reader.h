@@ -49,6 +49,7 @@
 #define KALDI_FEAT_WAVE_READER_H_
 
 #include <cstring>
+#include <vector>
 
 #include "base/kaldi-types.h"
 #include "matrix/kaldi-vector.h"
@@ -102,6 +103,39 @@ class WaveInfo {
   bool reverse_bytes_;   // File endianness differs from host.
 };
 
+/// This class reads the wave data of a stream a chunk at a time, after its
+/// header, so that long recordings can be processed (e.g. by the online
+/// feature extraction, see online-feature.h) without having all of their
+/// samples in memory.  The samples are scaled as in WaveData.
+class WaveStreamReader {
+ public:
+  /// Reads the header from "is", which should be opened in binary mode and
+  /// must outlive this object.  Throws on error.
+  explicit WaveStreamReader(std::istream &is);
+
+  const WaveInfo &Info() const { return header_; }
+
+  /// Reads the next samples into the columns of "samples", which should have
+  /// a row per channel, and returns how many were read.  This is less than
+  /// samples->NumCols() only at the end of the wave data, and zero once all of
+  /// it has been read.  Throws on a read error.
+  int32 Read(MatrixBase<BaseFloat> *samples);
+
+  /// The number of samples (of each channel) read so far.
+  int64 NumSamplesRead() const { return num_samples_read_; }
+
+ private:
+  std::istream &is_;
+  WaveInfo header_;
+  // the number of samples the header says are left, or -1 if it is streamed
+  // (in which case we read to the end of the stream).
+  int64 samples_to_go_;
+  int64 num_samples_read_;
+  std::vector<char> buffer_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(WaveStreamReader);
+};
+
 /// This class's purpose is to read in Wave files.
 class WaveData {
  public:
@@ -112,7 +146,8 @@ class WaveData {
 
   /// Read() will throw on error.  It's valid to call Read() more than once--
   /// in this case it will destroy what was there before.
-  /// "is" should be opened in binary mode.
+  /// "is" should be opened in binary mode.  (See WaveStreamReader to process
+  /// long recordings without reading all of them in.)
   void Read(std::istream &is);
 
   /// Write() will throw on error.   os should be opened in binary mode.
@@ -144,7 +179,6 @@ class WaveData {
   }
 
  private:
-  static const uint32 kBlockSize = 1024 * 1024;  // Use 1M bytes.
   Matrix<BaseFloat> data_;
   BaseFloat samp_freq_;
 };
@@ -22,6 +22,8 @@
 #include "util/common-utils.h"
 #include "feat/feature-fbank.h"
 #include "feat/wave-reader.h"
+#include "cudafeat/feature-spectral-cuda.h"
+#include "cudamatrix/cu-device.h"
 
 
 int main(int argc, char *argv[]) {
@@ -40,6 +42,8 @@ int main(int argc, char *argv[]) {
     std::string utt2spk_rspecifier;
     int32 channel = -1;
     BaseFloat min_duration = 0.0;
+    bool batched = false;
+    std::string use_gpu = "no";
     // Define defaults for gobal options
     std::string output_format = "kaldi";
 
@@ -53,6 +57,8 @@ int main(int argc, char *argv[]) {
     po.Register("utt2spk", &utt2spk_rspecifier, "Utterance to speaker-id map (if doing VTLN and you have warps per speaker)");
     po.Register("channel", &channel, "Channel to extract (-1 -> expect mono, 0 -> left, 1 -> right)");
     po.Register("min-duration", &min_duration, "Minimum duration of segments to process (in seconds).");
+    po.Register("batched", &batched, "If true, compute the features of many frames at a time with matrix operations, which is faster; the output is the same up to rounding.");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional|wait, only has effect if compiled with CUDA; if not \"no\", the features are computed with CUDA (see cudafeat/feature-spectral-cuda.h).");
 
     // OPTION PARSING ..........................................................
     //
@@ -69,7 +75,15 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     Fbank fbank(fbank_opts);
+    // the CUDA version, if requested.
+    CudaSpectralFeatures *cuda_fbank = NULL;
+    if (use_gpu != "no")
+      cuda_fbank = new CudaSpectralFeatures(fbank_opts);
 
     SequentialTableReader<WaveHolder> reader(wav_rspecifier);
     BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
@@ -136,7 +150,14 @@ int main(int argc, char *argv[]) {
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
       Matrix<BaseFloat> features;
       try {
-        fbank.ComputeFeatures(waveform, wave_data.SampFreq(), vtln_warp_local, &features);
+        if (cuda_fbank != NULL)
+          cuda_fbank->ComputeFeatures(waveform, wave_data.SampFreq(),
+                                       vtln_warp_local, &features);
+        else if (batched)
+          fbank.ComputeFeaturesBatched(waveform, wave_data.SampFreq(),
+                                      vtln_warp_local, &features);
+        else
+          fbank.ComputeFeatures(waveform, wave_data.SampFreq(), vtln_warp_local, &features);
       } catch (...) {
         KALDI_WARN << "Failed to compute features for utterance "
                    << utt;
@@ -170,6 +191,10 @@ int main(int argc, char *argv[]) {
       KALDI_VLOG(2) << "Processed features for key " << utt;
       num_success++;
     }
+    delete cuda_fbank;
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -22,6 +22,8 @@
 #include "util/common-utils.h"
 #include "feat/feature-mfcc.h"
 #include "feat/wave-reader.h"
+#include "cudafeat/feature-spectral-cuda.h"
+#include "cudamatrix/cu-device.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -39,6 +41,8 @@ int main(int argc, char *argv[]) {
     std::string utt2spk_rspecifier;
     int32 channel = -1;
     BaseFloat min_duration = 0.0;
+    bool batched = false;
+    std::string use_gpu = "no";
     // Define defaults for gobal options
     std::string output_format = "kaldi";
 
@@ -60,6 +64,12 @@ int main(int argc, char *argv[]) {
                 "0 -> left, 1 -> right)");
     po.Register("min-duration", &min_duration, "Minimum duration of segments "
                 "to process (in seconds).");
+    po.Register("batched", &batched, "If true, compute the features of many "
+                "frames at a time with matrix operations, which is faster; "
+                "the output is the same up to rounding.");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional|wait, only has effect "
+                "if compiled with CUDA; if not \"no\", the features are "
+                "computed with CUDA (see cudafeat/feature-spectral-cuda.h).");
 
     po.Read(argc, argv);
 
@@ -72,7 +82,15 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     Mfcc mfcc(mfcc_opts);
+    // the CUDA version, if requested.
+    CudaSpectralFeatures *cuda_mfcc = NULL;
+    if (use_gpu != "no")
+      cuda_mfcc = new CudaSpectralFeatures(mfcc_opts);
 
     SequentialTableReader<WaveHolder> reader(wav_rspecifier);
     BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
@@ -139,7 +157,14 @@ int main(int argc, char *argv[]) {
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
       Matrix<BaseFloat> features;
       try {
-        mfcc.ComputeFeatures(waveform, wave_data.SampFreq(), vtln_warp_local, &features);
+        if (cuda_mfcc != NULL)
+          cuda_mfcc->ComputeFeatures(waveform, wave_data.SampFreq(),
+                                      vtln_warp_local, &features);
+        else if (batched)
+          mfcc.ComputeFeaturesBatched(waveform, wave_data.SampFreq(),
+                                    vtln_warp_local, &features);
+        else
+          mfcc.ComputeFeatures(waveform, wave_data.SampFreq(), vtln_warp_local, &features);
       } catch (...) {
         KALDI_WARN << "Failed to compute features for utterance "
                    << utt;
@@ -173,6 +198,10 @@ int main(int argc, char *argv[]) {
       KALDI_VLOG(2) << "Processed features for key " << utt;
       num_success++;
     }
+    delete cuda_mfcc;
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
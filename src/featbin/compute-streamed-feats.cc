@@ -0,0 +1,144 @@
+// featbin/compute-streamed-feats.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/online-feature.h"
+#include "feat/wave-reader.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Compute MFCC, filterbank or PLP features of a single wave file, which\n"
+        "is read a chunk at a time and given to the online feature extraction,\n"
+        "so that the memory needed for the (arbitrarily long) recording does\n"
+        "not depend on its length.  The features are the same as those of\n"
+        "compute-mfcc-feats etc. with the same options (without VTLN).\n"
+        "\n"
+        "Usage:  compute-streamed-feats [options...] <wav-rxfilename> "
+        "<feats-wxfilename>\n"
+        "e.g.: compute-streamed-feats --mfcc-config=conf/mfcc.conf "
+        "meeting.wav meeting.mat\n";
+
+    ParseOptions po(usage);
+    std::string feature_type = "mfcc", mfcc_config, fbank_config, plp_config;
+    int32 channel = -1;
+    BaseFloat chunk_length = 1.0;
+    bool binary = true;
+
+    po.Register("feature-type", &feature_type, "Type of the features: mfcc, "
+                "fbank or plp.");
+    po.Register("mfcc-config", &mfcc_config, "Configuration file for MFCC "
+                "features (e.g. conf/mfcc.conf)");
+    po.Register("fbank-config", &fbank_config, "Configuration file for "
+                "filterbank features (e.g. conf/fbank.conf)");
+    po.Register("plp-config", &plp_config, "Configuration file for PLP "
+                "features (e.g. conf/plp.conf)");
+    po.Register("channel", &channel, "Channel to extract (-1 -> expect mono, "
+                "0 -> left, 1 -> right)");
+    po.Register("chunk-length", &chunk_length, "Length, in seconds, of the "
+                "chunks of the wave data that are read at a time.");
+    po.Register("binary", &binary, "Write output in binary mode.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string wav_rxfilename = po.GetArg(1),
+        feats_wxfilename = po.GetArg(2);
+
+    OnlineBaseFeature *feature = NULL;
+    BaseFloat samp_freq;
+    if (feature_type == "mfcc") {
+      MfccOptions opts;
+      if (mfcc_config != "") ReadConfigFromFile(mfcc_config, &opts);
+      samp_freq = opts.frame_opts.samp_freq;
+      feature = new OnlineMfcc(opts);
+    } else if (feature_type == "fbank") {
+      FbankOptions opts;
+      if (fbank_config != "") ReadConfigFromFile(fbank_config, &opts);
+      samp_freq = opts.frame_opts.samp_freq;
+      feature = new OnlineFbank(opts);
+    } else if (feature_type == "plp") {
+      PlpOptions opts;
+      if (plp_config != "") ReadConfigFromFile(plp_config, &opts);
+      samp_freq = opts.frame_opts.samp_freq;
+      feature = new OnlinePlp(opts);
+    } else {
+      KALDI_ERR << "Invalid feature type: " << feature_type << ". "
+                << "Supported feature types: mfcc, fbank, plp.";
+    }
+
+    Input ki(wav_rxfilename);  // no binary-mode header for wave files.
+    WaveStreamReader reader(ki.Stream());
+    const WaveInfo &info = reader.Info();
+    if (info.SampFreq() != samp_freq)
+      KALDI_ERR << "Sample frequency mismatch: the wave data is at "
+                << info.SampFreq() << " Hz but the features are configured "
+                << "for " << samp_freq << " Hz";
+    int32 num_chan = info.NumChannels(), this_chan = channel;
+    if (channel == -1) {
+      this_chan = 0;
+      if (num_chan != 1)
+        KALDI_WARN << "Channel not specified but you have data with "
+                   << num_chan  << " channels; defaulting to zero";
+    } else if (this_chan >= num_chan) {
+      KALDI_ERR << "File " << wav_rxfilename << " has " << num_chan
+                << " channels but you specified channel " << channel;
+    }
+
+    int32 chunk_samples = std::max(static_cast<int32>(chunk_length *
+                                                      info.SampFreq()), 1);
+    Matrix<BaseFloat> chunk(num_chan, chunk_samples);
+    Vector<BaseFloat> wave;
+    int32 n;
+    while ((n = reader.Read(&chunk)) > 0) {
+      wave.Resize(n, kUndefined);
+      wave.CopyFromVec(chunk.Row(this_chan).Range(0, n));
+      feature->AcceptWaveform(info.SampFreq(), wave);
+    }
+    feature->InputFinished();
+    if (!info.IsStreamed() && reader.NumSamplesRead() < info.SampleCount())
+      KALDI_WARN << "Expected " << info.SampleCount() << " samples but read "
+                 << reader.NumSamplesRead() << ". Truncated file?";
+
+    int32 num_frames = feature->NumFramesReady();
+    if (num_frames == 0)
+      KALDI_ERR << "No features for " << wav_rxfilename << " ("
+                << reader.NumSamplesRead() << " samples)";
+    Matrix<BaseFloat> feats(num_frames, feature->Dim(), kUndefined);
+    for (int32 t = 0; t < num_frames; t++) {
+      SubVector<BaseFloat> row(feats, t);
+      feature->GetFrame(t, &row);
+    }
+    delete feature;
+
+    WriteKaldiObject(feats, feats_wxfilename, binary);
+    KALDI_LOG << "Computed " << num_frames << " frames of features from "
+              << reader.NumSamplesRead() << " samples of " << wav_rxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
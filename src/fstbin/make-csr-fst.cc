@@ -0,0 +1,71 @@
+// fstbin/make-csr-fst.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "decoder/csr-fst.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using kaldi::int32;
+
+    const char *usage =
+        "Convert a decoding graph (e.g. HCLG.fst) to the CSR form read by the\n"
+        "decoders as it is written (see CsrFst in decoder/csr-fst.h): the\n"
+        "states numbered breadth-first from the start state, and the arcs of\n"
+        "each state in one array with the epsilon arcs first.  The output is\n"
+        "mapped into memory when it is read from a file, so it is in the\n"
+        "byte order of this machine.\n"
+        "\n"
+        "Usage: make-csr-fst [options] <fst-in> <csr-fst-out>\n"
+        "e.g.: make-csr-fst exp/tri3/graph/HCLG.fst exp/tri3/graph/HCLG.csr\n"
+        "See also: nnet3-latgen-faster, nnet3-latgen-faster-lanes\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_rxfilename = po.GetArg(1),
+        csr_fst_wxfilename = po.GetArg(2);
+
+    fst::Fst<fst::StdArc> *fst = fst::ReadFstKaldiGeneric(fst_rxfilename);
+    CsrFst csr_fst(*fst);
+    delete fst;
+
+    bool binary = true, write_binary_header = false;
+    Output ko(csr_fst_wxfilename, binary, write_binary_header);
+    csr_fst.Write(ko.Stream(), binary);
+
+    KALDI_LOG << "Wrote graph with " << csr_fst.NumStates() << " states and "
+              << csr_fst.NumArcs() << " arcs to "
+              << PrintableWxfilename(csr_fst_wxfilename);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -80,6 +80,7 @@ int main(int argc, char *argv[]) {
 
     int32 nonterm_phones_offset = -1;
     bool write_as_grammar = true;
+    bool push_costs_to_entries = false;
 
     po.Register("nonterm-phones-offset", &nonterm_phones_offset,
                 "Integer id of #nonterm_bos in phones.txt");
@@ -87,6 +88,10 @@ int main(int argc, char *argv[]) {
                 "write as GrammarFst object; if false, convert to "
                 "ConstFst<StdArc> (readable by standard decoders) "
                 "and write that.");
+    po.Register("push-costs-to-entries", &push_costs_to_entries, "If true, "
+                "push the costs of the FSTs for nonterminals onto their entry "
+                "arcs (see PushCostsToEntryArcs()), which helps pruning when "
+                "decoding; the top-level FST is not changed.");
 
     po.Read(argc, argv);
 
@@ -104,6 +109,10 @@ int main(int argc, char *argv[]) {
       // this usage pattern calls PrepareForGrammarFst().
       VectorFst<StdArc> *fst = ReadFstKaldi(po.GetArg(1));
       PrepareForGrammarFst(nonterm_phones_offset, fst);
+      if (push_costs_to_entries &&
+          !PushCostsToEntryArcs(nonterm_phones_offset, fst))
+        KALDI_LOG << "Not pushing costs of " << po.GetArg(1)
+                  << ", which looks like a top-level FST.";
       // This will write it as VectorFst; to avoid it having to be converted to
       // ConstFst when read again by make-grammar-fst, you may want to pipe
       // through fstconvert --fst_type=const.
@@ -127,6 +136,15 @@ int main(int argc, char *argv[]) {
                   << nonterm_str;
       std::string fst_str = po.GetArg(2*i + 1);
       ConstFst<StdArc> *fst = ReadAsConstFst(fst_str);
+      if (push_costs_to_entries) {
+        VectorFst<StdArc> vfst(*fst);
+        if (PushCostsToEntryArcs(nonterm_phones_offset, &vfst)) {
+          delete fst;
+          fst = new ConstFst<StdArc>(vfst);
+        } else {
+          KALDI_WARN << "Could not push the costs of " << fst_str;
+        }
+      }
       pairs.push_back(std::pair<int32, const ConstFst<StdArc>* >(nonterminal, fst));
     }
 
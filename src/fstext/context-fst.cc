@@ -126,6 +126,30 @@ InverseContextFst::Weight InverseContextFst::Final(StateId s) {
 }
 
 bool InverseContextFst::GetArc(StateId s, Label ilabel, Arc *arc) {
+  std::pair<ArcMap::iterator, bool> ret = arc_map_.insert(
+      ArcMap::value_type(std::pair<StateId, Label>(s, ilabel),
+                         std::pair<Label, StateId>(0, kNoStateId)));
+  if (!ret.second) {
+    if (ret.first->second.second == kNoStateId)
+      return false;
+    arc->ilabel = ilabel;
+    arc->olabel = ret.first->second.first;
+    arc->weight = Weight::One();
+    arc->nextstate = ret.first->second.second;
+    return true;
+  }
+  // Not cached yet.  CreateArc() does not change arc_map_, so ret.first stays
+  // valid.
+  bool ans = CreateArc(s, ilabel, arc);
+  if (ans) {
+    KALDI_PARANOID_ASSERT(arc->nextstate != kNoStateId &&
+                          arc->weight == Weight::One());
+    ret.first->second = std::pair<Label, StateId>(arc->olabel, arc->nextstate);
+  }
+  return ans;
+}
+
+bool InverseContextFst::CreateArc(StateId s, Label ilabel, Arc *arc) {
   KALDI_ASSERT(ilabel != 0 && static_cast<size_t>(s) < state_seqs_.size() &&
                state_seqs_[s].size() == context_width_ - 1);
 
@@ -54,6 +54,7 @@ using std::unordered_map;
 
 #include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 #include <fst/fstlib.h>
 #include <fst/fst-decl.h>
@@ -182,11 +183,16 @@ public:
 
   virtual Weight Final(StateId s);
 
-  /// Note: ilabel must not be epsilon.
+  /// Note: ilabel must not be epsilon.  The arcs are cached, so that asking
+  /// for an arc again (as composing with many FSTs in turn does, see
+  /// TrainingGraphCompiler) costs one hash lookup.
   virtual bool GetArc(StateId s, Label ilabel, Arc *arc);
 
   ~InverseContextFst() { }
 
+  /// The number of states (phonetic contexts) created so far.
+  StateId NumStates() const { return state_seqs_.size(); }
+
   // Returns a reference to a vector<vector<int32> > with information about all
   // the input symbols of C (i.e. all the output symbols of this
   // InverseContextFst).  See
@@ -201,6 +207,9 @@ public:
 
 private:
 
+  /// Works out the arc for GetArc(), which caches it.
+  bool CreateArc(StateId s, Label ilabel, Arc *arc);
+
   /// Returns the state-id corresponding to this vector of phones; creates the
   /// state it if necessary.  Requires seq.size() == context_width_ - 1.
   StateId FindState(const vector<int32> &seq);
@@ -255,6 +264,12 @@ private:
   typedef unordered_map<vector<int32>, Label,
                         kaldi::VectorHasher<int32> > VectorToLabelMap;
 
+  // Map type to map from (state, ilabel) to the (olabel, nextstate) of the arc,
+  // with nextstate == kNoStateId if there is no arc (the weight is always
+  // One()).
+  typedef unordered_map<std::pair<StateId, Label>, std::pair<Label, StateId>,
+                        kaldi::PairHasher<int32> > ArcMap;
+
 
   // Sometimes called N, context_width_ this is the width of the
   // phonetic context, e.g. 3 for triphone, 2 for biphone, one for monophone.
@@ -332,6 +347,8 @@ private:
   // See "http://kaldi-asr.org/doc/tree_externals.html#tree_ilabel".
   vector<vector<int32> > ilabel_info_;
 
+  // The arcs GetArc() has created.
+  ArcMap arc_map_;
 };
 
 }  // namespace fst
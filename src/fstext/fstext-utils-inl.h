@@ -384,6 +384,16 @@ void DeterminizeStarInLog(VectorFst<StdArc> *fst, float delta, bool *debug_ptr,
   delete fst_det_log;
 }
 
+inline
+void DeterminizeStarInLog(const Fst<StdArc> &ifst, VectorFst<StdArc> *ofst,
+                          float delta, bool *debug_ptr, int max_states) {
+  typedef WeightConvertMapper<StdArc, LogArc> Mapper;
+  ArcMapFst<StdArc, LogArc, Mapper> fst_log(ifst, Mapper());
+  VectorFst<LogArc> fst_det_log;
+  DeterminizeStar(fst_log, &fst_det_log, delta, debug_ptr, max_states);
+  Cast(fst_det_log, ofst);
+}
+
 inline
 void DeterminizeInLog(VectorFst<StdArc> *fst) {
   // DeterminizeInLog determinizes 'fst' in the log semiring.
@@ -84,6 +84,15 @@ inline
 void DeterminizeStarInLog(VectorFst<StdArc> *fst, float delta = kDelta, bool *debug_ptr = NULL,
                           int max_states = -1);
 
+/// Version of DeterminizeStarInLog() that reads any FST, e.g. a lazy
+/// composition from TableComposeFst(), and writes the result to ofst.  The
+/// input is converted to the log semiring as it is read, so it is never
+/// copied.
+inline
+void DeterminizeStarInLog(const Fst<StdArc> &ifst, VectorFst<StdArc> *ofst,
+                          float delta = kDelta, bool *debug_ptr = NULL,
+                          int max_states = -1);
+
 
 // e.g. of using this function: PushInLog<REWEIGHT_TO_INITIAL>(fst, kPushWeights|kPushLabels);
 
@@ -453,6 +453,9 @@ class CompactLatticeWeightTpl {
 
   void SetString(const vector<IntType> &s) { string_ = s; }
 
+  // For setting the string in place (e.g. from an array), reusing its memory.
+  vector<IntType> *MutableString() { return &string_; }
+
   static const CompactLatticeWeightTpl<WeightType, IntType> Zero() {
     return CompactLatticeWeightTpl<WeightType, IntType>(
         WeightType::Zero(), vector<IntType>());
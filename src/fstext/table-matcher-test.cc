@@ -240,6 +240,37 @@ template<class Arc>  void TestTableMatcherCacheRight(bool connect) {
 }
 
 
+// Checks the lazy composition against the eager one.
+template<class Arc>  void TestTableComposeFst(bool left) {
+  VectorFst<Arc> *fst1 = RandFst<Arc>();
+  VectorFst<Arc> *fst2 = RandFst<Arc>();
+
+  TableComposeOptions opts;
+  if (left) opts.table_match_type = MATCH_OUTPUT;
+  else opts.table_match_type = MATCH_INPUT;
+  opts.min_table_size = 1 + kaldi::Rand() % 5;
+  opts.table_ratio = 0.25 * (kaldi::Rand() % 5);
+
+  ArcSort(fst1, OLabelCompare<Arc>());
+  ArcSort(fst2, ILabelCompare<Arc>());
+
+  VectorFst<Arc> composed_baseline;
+  TableCompose(*fst1, *fst2, &composed_baseline, opts);
+
+  CacheOptions cache_opts(true, 0);  // keep as little cached as possible.
+  ComposeFst<Arc> *lazy = TableComposeFst(*fst1, *fst2, opts, cache_opts);
+  // the lazy FST holds its own references to the inputs.
+  delete fst1;
+  delete fst2;
+  VectorFst<Arc> composed(*lazy);
+  delete lazy;
+  Connect(&composed);
+
+  assert(RandEquivalent(composed, composed_baseline, 5/*paths*/, 0.01/*delta*/,
+                        kaldi::Rand()/*seed*/, 20/*path length-- max?*/));
+}
+
+
 } // namespace fst
 
 int main() {
@@ -253,5 +284,7 @@ int main() {
     TestTableMatcherCacheLeft<fst::StdArc>(false);
     TestTableMatcherCacheRight<fst::StdArc>(true);
     TestTableMatcherCacheRight<fst::StdArc>(false);
+    TestTableComposeFst<fst::StdArc>(true);
+    TestTableComposeFst<fst::StdArc>(false);
   }
 }
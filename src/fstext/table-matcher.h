@@ -334,6 +334,33 @@ void TableCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
 }
 
 
+/// Lazy version of TableCompose(): the composition is returned as a
+/// ComposeFst whose states are only expanded when they are visited, so an
+/// algorithm reading it (e.g. DeterminizeStar) never has the whole composed
+/// FST in memory; cache_opts bounds how much of it is kept.  opts.connect is
+/// ignored, the result may have states that cannot reach a final state.
+/// The caller owns the returned FST.
+template<class Arc>
+ComposeFst<Arc> *TableComposeFst(
+    const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+    const TableComposeOptions &opts = TableComposeOptions(),
+    const CacheOptions &cache_opts = CacheOptions()) {
+  typedef Fst<Arc> F;
+  if (opts.table_match_type == MATCH_OUTPUT) {
+    ComposeFstImplOptions<TableMatcher<F>, SortedMatcher<F> > impl_opts(
+        cache_opts);
+    impl_opts.matcher1 = new TableMatcher<F>(ifst1, MATCH_OUTPUT, opts);
+    return new ComposeFst<Arc>(ifst1, ifst2, impl_opts);
+  } else {
+    assert(opts.table_match_type == MATCH_INPUT) ;
+    ComposeFstImplOptions<SortedMatcher<F>, TableMatcher<F> > impl_opts(
+        cache_opts);
+    impl_opts.matcher2 = new TableMatcher<F>(ifst2, MATCH_INPUT, opts);
+    return new ComposeFst<Arc>(ifst1, ifst2, impl_opts);
+  }
+}
+
+
 /// TableComposeCache lets us do multiple compositions while caching the same
 /// matcher.
 template<class F>
@@ -92,6 +92,32 @@ void TestSplitStates(const AmDiagGmm &am_gmm) {
   delete am_gmm1;
 }
 
+// Tests AmDiagGmm::LogLikelihoodsBatch() and DiagGmm::LogLikelihoodsBatch()
+// against LogLikelihood().
+void TestLogLikelihoodsBatch(const AmDiagGmm &am_gmm) {
+  int32 num_frames = 1 + kaldi::RandInt(0, 20);
+  kaldi::Matrix<BaseFloat> frames(num_frames, am_gmm.Dim());
+  frames.SetRandn();
+  std::vector<int32> pdf_ids;
+  for (int32 i = kaldi::RandInt(0, 2 * am_gmm.NumPdfs()); i > 0; i--)
+    pdf_ids.push_back(kaldi::RandInt(0, am_gmm.NumPdfs() - 1));
+
+  kaldi::Matrix<BaseFloat> loglikes;
+  am_gmm.LogLikelihoodsBatch(frames, pdf_ids, &loglikes);
+  KALDI_ASSERT(loglikes.NumRows() == num_frames &&
+               loglikes.NumCols() == static_cast<int32>(pdf_ids.size()));
+  kaldi::Vector<BaseFloat> pdf_loglikes(num_frames);
+  am_gmm.GetPdf(0).LogLikelihoodsBatch(frames, &pdf_loglikes);
+  for (int32 t = 0; t < num_frames; t++) {
+    for (size_t i = 0; i < pdf_ids.size(); i++)
+      kaldi::AssertEqual(loglikes(t, i),
+                         am_gmm.LogLikelihood(pdf_ids[i], frames.Row(t)),
+                         1e-4);
+    kaldi::AssertEqual(pdf_loglikes(t), am_gmm.LogLikelihood(0, frames.Row(t)),
+                       1e-4);
+  }
+}
+
 void TestClustering(const AmDiagGmm &am_gmm) {
   int32 target_comp = am_gmm.NumGauss() / 5,
       interm_comp = am_gmm.NumGauss() / 2;
@@ -117,6 +143,7 @@ void UnitTestAmDiagGmm() {
   }
 
   TestAmDiagGmmIO(am_gmm);
+  TestLogLikelihoodsBatch(am_gmm);
   TestSplitStates(am_gmm);
   TestClustering(am_gmm);
 }
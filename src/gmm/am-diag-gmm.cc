@@ -76,6 +76,64 @@ int32 AmDiagGmm::NumGauss() const {
   return ans;
 }
 
+void AmDiagGmm::LogLikelihoodsBatch(const MatrixBase<BaseFloat> &frames,
+                                    const std::vector<int32> &pdf_ids,
+                                    Matrix<BaseFloat> *loglikes,
+                                    BaseFloat log_sum_exp_prune) const {
+  int32 num_frames = frames.NumRows(), num_pdfs = pdf_ids.size(),
+      dim = Dim();
+  KALDI_ASSERT(frames.NumCols() == dim);
+  if (num_frames == 0 || num_pdfs == 0) {
+    loglikes->Resize(0, 0);
+    return;
+  }
+  loglikes->Resize(num_frames, num_pdfs, kUndefined);
+  // offsets[i] is the index of the first Gaussian of pdf_ids[i] in the stacked
+  // parameters.
+  std::vector<int32> offsets(num_pdfs + 1, 0);
+  for (int32 i = 0; i < num_pdfs; i++) {
+    const DiagGmm &pdf = GetPdf(pdf_ids[i]);
+    if (!pdf.valid_gconsts())
+      KALDI_ERR << "State " << pdf_ids[i] << ": Must call ComputeGconsts() "
+          "before computing likelihood.";
+    offsets[i + 1] = offsets[i] + pdf.NumGauss();
+  }
+  // With the frames extended as [ x, x^2, 1 ] and the Gaussians as
+  // [ means * inv(vars), -0.5 * inv(vars), gconst ], all the Gaussian
+  // log-likelihoods are given by one matrix multiplication.
+  int32 num_gauss = offsets[num_pdfs];
+  Matrix<BaseFloat> params(num_gauss, 2 * dim + 1, kUndefined);
+  for (int32 i = 0; i < num_pdfs; i++) {
+    const DiagGmm &pdf = GetPdf(pdf_ids[i]);
+    SubMatrix<BaseFloat> this_params(params, offsets[i], pdf.NumGauss(),
+                                     0, 2 * dim + 1);
+    this_params.ColRange(0, dim).CopyFromMat(pdf.means_invvars());
+    this_params.ColRange(dim, dim).CopyFromMat(pdf.inv_vars());
+    this_params.ColRange(dim, dim).Scale(-0.5);
+    this_params.CopyColFromVec(pdf.gconsts(), 2 * dim);
+  }
+  Matrix<BaseFloat> extended_frames(num_frames, 2 * dim + 1, kUndefined);
+  extended_frames.ColRange(0, dim).CopyFromMat(frames);
+  extended_frames.ColRange(dim, dim).CopyFromMat(frames);
+  extended_frames.ColRange(dim, dim).ApplyPow(2.0);
+  extended_frames.ColRange(2 * dim, 1).Set(1.0);
+
+  Matrix<BaseFloat> gauss_loglikes(num_frames, num_gauss, kUndefined);
+  gauss_loglikes.AddMatMat(1.0, extended_frames, kNoTrans, params, kTrans,
+                           0.0);
+
+  for (int32 t = 0; t < num_frames; t++) {
+    SubVector<BaseFloat> row(gauss_loglikes, t);
+    for (int32 i = 0; i < num_pdfs; i++) {
+      BaseFloat log_sum = row.Range(offsets[i], offsets[i + 1] - offsets[i]).
+          LogSumExp(log_sum_exp_prune);
+      if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+        KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+      (*loglikes)(t, i) = log_sum;
+    }
+  }
+}
+
 void AmDiagGmm::CopyFromAmDiagGmm(const AmDiagGmm &other) {
   if (densities_.size() != 0) {
     DeletePointers(&densities_);
@@ -72,6 +72,17 @@ class AmDiagGmm {
 
   BaseFloat LogLikelihood(const int32 pdf_index,
                           const VectorBase<BaseFloat> &data) const;
+
+  /// Computes the log-likelihoods of the frames (the rows of "frames") for the
+  /// pdfs in "pdf_ids": (*loglikes)(t, i) is that of frame t for pdf
+  /// pdf_ids[i].  The Gaussians of all those pdfs are stacked so that it
+  /// takes one matrix multiplication, which is much faster than calling
+  /// LogLikelihood() per frame and pdf.  See DiagGmm::LogLikelihoodsBatch()
+  /// for log_sum_exp_prune.
+  void LogLikelihoodsBatch(const MatrixBase<BaseFloat> &frames,
+                           const std::vector<int32> &pdf_ids,
+                           Matrix<BaseFloat> *loglikes,
+                           BaseFloat log_sum_exp_prune = -1.0) const;
   
   void Read(std::istream &in_stream, bool binary);
   void Write(std::ostream &out_stream, bool binary) const;
@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <vector>
 using std::vector;
 
@@ -32,6 +33,9 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
   KALDI_ASSERT(static_cast<size_t>(state) < static_cast<size_t>(NumIndices()) &&
                "Likely graph/model mismatch, e.g. using wrong HCLG.fst");
 
+  if (batch_frames_ > 1)
+    return BatchLogLikelihood(frame, state);
+
   if (log_like_cache_[state].hit_time == frame) {
     return log_like_cache_[state].log_like;  // return cached value, if found
   }
@@ -71,6 +75,51 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
   return log_sum;
 }
 
+BaseFloat DecodableAmDiagGmmUnmapped::BatchLogLikelihood(int32 frame,
+                                                         int32 state) {
+  if (batch_start_ < 0 || frame < batch_start_ ||
+      frame >= batch_start_ + batch_frames_)
+    StartBatch(frame - frame % batch_frames_);
+  if (batch_pdf_used_[state] != batch_start_) {
+    batch_pdf_used_[state] = batch_start_;
+    batch_pdfs_.push_back(state);
+    if (batch_pdf_start_[state] != batch_start_) {
+      // the pdf was not needed in the previous block.
+      int32 num_frames = std::min(batch_frames_,
+                                  NumFramesReady() - batch_start_);
+      SubVector<BaseFloat> loglikes(batch_loglikes_.Row(state), 0, num_frames);
+      acoustic_model_.GetPdf(state).LogLikelihoodsBatch(
+          feature_matrix_.RowRange(batch_start_, num_frames), &loglikes,
+          log_sum_exp_prune_);
+      batch_pdf_start_[state] = batch_start_;
+    }
+  }
+  return batch_loglikes_(state, frame - batch_start_);
+}
+
+void DecodableAmDiagGmmUnmapped::StartBatch(int32 batch_start) {
+  if (batch_start < batch_start_) {
+    // going back, e.g. to retry alignment with a larger beam; the stamps
+    // of the earlier pass would be wrong.
+    std::fill(batch_pdf_start_.begin(), batch_pdf_start_.end(), -1);
+    std::fill(batch_pdf_used_.begin(), batch_pdf_used_.end(), -1);
+  }
+  int32 num_frames = std::min(batch_frames_, NumFramesReady() - batch_start);
+  // the pdfs needed in the previous block.
+  std::vector<int32> pdfs;
+  pdfs.swap(batch_pdfs_);
+  Matrix<BaseFloat> loglikes;
+  acoustic_model_.LogLikelihoodsBatch(
+      feature_matrix_.RowRange(batch_start, num_frames), pdfs, &loglikes,
+      log_sum_exp_prune_);
+  for (size_t i = 0; i < pdfs.size(); i++) {
+    SubVector<BaseFloat>(batch_loglikes_.Row(pdfs[i]), 0, num_frames).
+        CopyColFromMat(loglikes, i);
+    batch_pdf_start_[pdfs[i]] = batch_start;
+  }
+  batch_start_ = batch_start;
+}
+
 void DecodableAmDiagGmmUnmapped::ResetLogLikeCache() {
   if (static_cast<int32>(log_like_cache_.size()) != acoustic_model_.NumPdfs()) {
     log_like_cache_.resize(acoustic_model_.NumPdfs());
@@ -78,6 +127,14 @@ void DecodableAmDiagGmmUnmapped::ResetLogLikeCache() {
   vector<LikelihoodCacheRecord>::iterator it = log_like_cache_.begin(),
       end = log_like_cache_.end();
   for (; it != end; ++it) { it->hit_time = -1; }
+  if (batch_frames_ > 1) {
+    batch_loglikes_.Resize(acoustic_model_.NumPdfs(), batch_frames_,
+                           kUndefined);
+    batch_pdf_start_.assign(acoustic_model_.NumPdfs(), -1);
+    batch_pdf_used_.assign(acoustic_model_.NumPdfs(), -1);
+    batch_pdfs_.clear();
+    batch_start_ = -1;
+  }
 }
 
 
@@ -48,11 +48,19 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
   /// in the LogSumExp operation (larger = more exact); I suggest 5.
   /// This is advisable if it's spending a long time doing exp 
   /// operations. 
+  /// If batch_frames > 1, the likelihoods are computed for blocks of that
+  /// many frames at a time: when a block is entered, those of the pdfs that
+  /// were needed in the previous block are computed with
+  /// AmDiagGmm::LogLikelihoodsBatch(), and any other pdf is computed for the
+  /// whole block when it is first needed.  This is much faster when the set
+  /// of active pdfs changes slowly, as in alignment.
   DecodableAmDiagGmmUnmapped(const AmDiagGmm &am,
                              const Matrix<BaseFloat> &feats,
-                             BaseFloat log_sum_exp_prune = -1.0):
+                             BaseFloat log_sum_exp_prune = -1.0,
+                             int32 batch_frames = 0):
     acoustic_model_(am), feature_matrix_(feats),
     previous_frame_(-1), log_sum_exp_prune_(log_sum_exp_prune), 
+    batch_frames_(batch_frames), batch_start_(-1),
     data_squared_(feats.NumCols()) {
     ResetLogLikeCache();
   }
@@ -88,6 +96,20 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
   };
   std::vector<LikelihoodCacheRecord> log_like_cache_;
  private:
+  BaseFloat BatchLogLikelihood(int32 frame, int32 state_index);
+  void StartBatch(int32 batch_start);
+
+  int32 batch_frames_;
+  int32 batch_start_;  ///< First frame of the block in batch_loglikes_.
+  /// Row pdf is the log-likelihoods of the block for pdf, if
+  /// batch_pdf_start_[pdf] == batch_start_.
+  Matrix<BaseFloat> batch_loglikes_;
+  std::vector<int32> batch_pdf_start_;
+  /// The pdfs needed in the block, and batch_pdf_used_[pdf] == batch_start_
+  /// for them.
+  std::vector<int32> batch_pdfs_;
+  std::vector<int32> batch_pdf_used_;
+
   Vector<BaseFloat> data_squared_;  ///< Cache for fast likelihood calculation
 
 
@@ -100,8 +122,9 @@ class DecodableAmDiagGmm: public DecodableAmDiagGmmUnmapped {
   DecodableAmDiagGmm(const AmDiagGmm &am,
                      const TransitionModel &tm,
                      const Matrix<BaseFloat> &feats,
-                     BaseFloat log_sum_exp_prune = -1.0)
-    : DecodableAmDiagGmmUnmapped(am, feats, log_sum_exp_prune),
+                     BaseFloat log_sum_exp_prune = -1.0,
+                     int32 batch_frames = 0)
+    : DecodableAmDiagGmmUnmapped(am, feats, log_sum_exp_prune, batch_frames),
       trans_model_(tm) {}
 
   // Note, frames are numbered from zero.
@@ -124,8 +147,10 @@ class DecodableAmDiagGmmScaled: public DecodableAmDiagGmmUnmapped {
                            const TransitionModel &tm,
                            const Matrix<BaseFloat> &feats,
                            BaseFloat scale,
-                           BaseFloat log_sum_exp_prune = -1.0):
-      DecodableAmDiagGmmUnmapped(am, feats, log_sum_exp_prune), trans_model_(tm),
+                           BaseFloat log_sum_exp_prune = -1.0,
+                           int32 batch_frames = 0):
+      DecodableAmDiagGmmUnmapped(am, feats, log_sum_exp_prune, batch_frames),
+      trans_model_(tm),
       scale_(scale), delete_feats_(NULL) {}
 
   // This version of the initializer takes ownership of the pointer
@@ -134,8 +159,9 @@ class DecodableAmDiagGmmScaled: public DecodableAmDiagGmmUnmapped {
                            const TransitionModel &tm,
                            BaseFloat scale,
                            BaseFloat log_sum_exp_prune,
-                           Matrix<BaseFloat> *feats):
-      DecodableAmDiagGmmUnmapped(am, *feats, log_sum_exp_prune),
+                           Matrix<BaseFloat> *feats,
+                           int32 batch_frames = 0):
+      DecodableAmDiagGmmUnmapped(am, *feats, log_sum_exp_prune, batch_frames),
       trans_model_(tm),  scale_(scale), delete_feats_(feats) {}
 
   // Note, frames are numbered from zero but transition-ids from one.
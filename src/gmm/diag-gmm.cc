@@ -562,6 +562,23 @@ void DiagGmm::LogLikelihoods(const MatrixBase<BaseFloat> &data,
 }
 
 
+void DiagGmm::LogLikelihoodsBatch(const MatrixBase<BaseFloat> &frames,
+                                  VectorBase<BaseFloat> *loglikes,
+                                  BaseFloat log_sum_exp_prune) const {
+  if (!valid_gconsts_)
+    KALDI_ERR << "Must call ComputeGconsts() before computing likelihood";
+  KALDI_ASSERT(loglikes->Dim() == frames.NumRows());
+  Matrix<BaseFloat> component_loglikes;
+  LogLikelihoods(frames, &component_loglikes);
+  for (MatrixIndexT t = 0; t < frames.NumRows(); t++) {
+    BaseFloat log_sum = component_loglikes.Row(t).LogSumExp(log_sum_exp_prune);
+    if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+      KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+    (*loglikes)(t) = log_sum;
+  }
+}
+
+
 
 void DiagGmm::LogLikelihoodsPreselect(const VectorBase<BaseFloat> &data,
                                       const std::vector<int32> &indices,
@@ -91,6 +91,15 @@ class DiagGmm {
   void LogLikelihoods(const MatrixBase<BaseFloat> &data,
                       Matrix<BaseFloat> *loglikes) const;
 
+  /// Outputs the log-likelihood of each of a sequence of frames (the rows of
+  /// "frames"), using two matrix multiplications for all of them.  This gives
+  /// the same as LogLikelihood() on each row, up to roundoff.  If
+  /// log_sum_exp_prune > 0 it prunes the sum over the Gaussians as
+  /// VectorBase::LogSumExp() does.
+  void LogLikelihoodsBatch(const MatrixBase<BaseFloat> &frames,
+                           VectorBase<BaseFloat> *loglikes,
+                           BaseFloat log_sum_exp_prune = -1.0) const;
+
 
   /// Outputs the per-component log-likelihoods of a subset of mixture
   /// components.  Note: at output, loglikes->Dim() will equal indices.size().
@@ -18,13 +18,118 @@
 // limitations under the License.
 
 
+#include <mutex>
+
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
 
+namespace kaldi {
+
+// The statistics accumulated by one thread.
+struct GmmAliAccs {
+  Vector<double> transition_accs;
+  AccumAmDiagGmm gmm_accs;
+  double tot_like;
+};
+
+// Hands out the accumulators to the tasks.  There is one per thread, as at
+// most --num-threads tasks are in operator () at once, and they are summed at
+// the end.  Which utterances go to which accumulator depends on how the
+// tasks are scheduled, so with more than one thread the stats are only the
+// same as the single-threaded ones up to rounding.
+class GmmAliAccsPool {
+ public:
+  GmmAliAccsPool(const AmDiagGmm &am_gmm, const TransitionModel &trans_model,
+                 int32 num_accs) {
+    for (int32 i = 0; i < num_accs; i++) {
+      GmmAliAccs *accs = new GmmAliAccs();
+      trans_model.InitStats(&accs->transition_accs);
+      accs->gmm_accs.Init(am_gmm, kGmmAll);
+      accs->tot_like = 0.0;
+      accs_.push_back(accs);
+    }
+    free_ = accs_;
+  }
+  ~GmmAliAccsPool() { DeletePointers(&accs_); }
+
+  GmmAliAccs *Get() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    KALDI_ASSERT(!free_.empty());
+    GmmAliAccs *accs = free_.back();
+    free_.pop_back();
+    return accs;
+  }
+  void Release(GmmAliAccs *accs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(accs);
+  }
 
+  // Adds the others to the first accumulator and returns it; call when no
+  // tasks are running.
+  const GmmAliAccs &Sum() {
+    for (size_t i = 1; i < accs_.size(); i++) {
+      accs_[0]->transition_accs.AddVec(1.0, accs_[i]->transition_accs);
+      accs_[0]->gmm_accs.Add(1.0, accs_[i]->gmm_accs);
+      accs_[0]->tot_like += accs_[i]->tot_like;
+    }
+    return *accs_[0];
+  }
+ private:
+  std::mutex mutex_;
+  std::vector<GmmAliAccs*> accs_;
+  std::vector<GmmAliAccs*> free_;
+};
+
+class GmmAccStatsAliTask {
+ public:
+  GmmAccStatsAliTask(const AmDiagGmm &am_gmm,
+                     const TransitionModel &trans_model,
+                     const std::string &utt,
+                     const Matrix<BaseFloat> &features,
+                     const std::vector<int32> &alignment,
+                     int32 num_done,
+                     GmmAliAccsPool *pool):
+      am_gmm_(am_gmm), trans_model_(trans_model), utt_(utt),
+      features_(features), alignment_(alignment), num_done_(num_done),
+      pool_(pool), tot_like_this_file_(0.0) { }
+
+  void operator () () {
+    GmmAliAccs *accs = pool_->Get();
+    for (size_t i = 0; i < alignment_.size(); i++) {
+      int32 tid = alignment_[i],  // transition identifier.
+          pdf_id = trans_model_.TransitionIdToPdf(tid);
+      trans_model_.Accumulate(1.0, tid, &accs->transition_accs);
+      tot_like_this_file_ += accs->gmm_accs.AccumulateForGmm(
+          am_gmm_, features_.Row(i), pdf_id, 1.0);
+    }
+    accs->tot_like += tot_like_this_file_;
+    pool_->Release(accs);
+  }
+
+  ~GmmAccStatsAliTask() {
+    if (num_done_ % 50 == 0) {
+      KALDI_LOG << "Processed " << num_done_ << " utterances; for utterance "
+                << utt_ << " avg. like is "
+                << (tot_like_this_file_/alignment_.size())
+                << " over " << alignment_.size() <<" frames.";
+    }
+  }
+ private:
+  const AmDiagGmm &am_gmm_;
+  const TransitionModel &trans_model_;
+  std::string utt_;
+  Matrix<BaseFloat> features_;  // not references, since they come from
+  std::vector<int32> alignment_;  // Tables, and are only valid briefly.
+  int32 num_done_;
+  GmmAliAccsPool *pool_;
+  BaseFloat tot_like_this_file_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -39,7 +144,9 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     bool binary = true;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     po.Register("binary", &binary, "Write output in binary mode");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -61,64 +168,53 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    Vector<double> transition_accs;
-    trans_model.InitStats(&transition_accs);
-    AccumAmDiagGmm gmm_accs;
-    gmm_accs.Init(am_gmm, kGmmAll);
+    GmmAliAccsPool pool(am_gmm, trans_model,
+                        std::max(1, sequencer_config.num_threads));
 
-    double tot_like = 0.0;
     kaldi::int64 tot_t = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     RandomAccessInt32VectorReader alignments_reader(alignments_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!alignments_reader.HasKey(key)) {
-        KALDI_WARN << "No alignment for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const std::vector<int32> &alignment = alignments_reader.Value(key);
-
-        if (alignment.size() != mat.NumRows()) {
-          KALDI_WARN << "Alignments has wrong size " << (alignment.size())
-                     << " vs. " << (mat.NumRows());
+    {
+      TaskSequencer<GmmAccStatsAliTask> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!alignments_reader.HasKey(key)) {
+          KALDI_WARN << "No alignment for utterance " << key;
           num_err++;
-          continue;
-        }
-
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0;
-
-        for (size_t i = 0; i < alignment.size(); i++) {
-          int32 tid = alignment[i],  // transition identifier.
-              pdf_id = trans_model.TransitionIdToPdf(tid);
-          trans_model.Accumulate(1.0, tid, &transition_accs);
-          tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i),
-                                                          pdf_id, 1.0);
-        }
-        tot_like += tot_like_this_file;
-        tot_t += alignment.size();
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is "
-                    << (tot_like_this_file/alignment.size())
-                    << " over " << alignment.size() <<" frames.";
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const std::vector<int32> &alignment = alignments_reader.Value(key);
+
+          if (alignment.size() != mat.NumRows()) {
+            KALDI_WARN << "Alignments has wrong size " << (alignment.size())
+                       << " vs. " << (mat.NumRows());
+            num_err++;
+            continue;
+          }
+
+          num_done++;
+          tot_t += alignment.size();
+          sequencer.Run(new GmmAccStatsAliTask(am_gmm, trans_model, key, mat,
+                                               alignment, num_done, &pool));
         }
       }
+      // the destructor of "sequencer" waits for the remaining tasks.
     }
+    const GmmAliAccs &accs = pool.Sum();
+
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
 
     KALDI_LOG << "Overall avg like per frame (Gaussian only) = "
-              << (tot_like/tot_t) << " over " << tot_t << " frames.";
+              << (accs.tot_like/tot_t) << " over " << tot_t << " frames.";
 
     {
       Output ko(accs_wxfilename, binary);
-      transition_accs.Write(ko.Stream(), binary);
-      gmm_accs.Write(ko.Stream(), binary);
+      accs.transition_accs.Write(ko.Stream(), binary);
+      accs.gmm_accs.Write(ko.Stream(), binary);
     }
     KALDI_LOG << "Written accs.";
     if (num_done != 0)
@@ -130,5 +226,3 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 }
-
-
@@ -26,6 +26,7 @@
 #include "hmm/hmm-utils.h"
 #include "fstext/fstext-lib.h"
 #include "decoder/decoder-wrappers.h"
+#include "util/kaldi-thread.h"
 #include "gmm/decodable-am-diag-gmm.h"
 #include "lat/kaldi-lattice.h" // for {Compact}LatticeArc
 
@@ -49,18 +50,24 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     AlignConfig align_config;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     BaseFloat acoustic_scale = 1.0;
     BaseFloat transition_scale = 1.0;
     BaseFloat self_loop_scale = 1.0;
+    int32 batch_frames = 16;
     std::string per_frame_acwt_wspecifier;
 
     align_config.Register(&po);
+    sequencer_config.Register(&po);
     po.Register("transition-scale", &transition_scale,
                 "Transition-probability scale [relative to acoustics]");
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
     po.Register("self-loop-scale", &self_loop_scale,
                 "Scale of self-loop versus non-self-loop log probs [relative to acoustics]");
+    po.Register("batch-frames", &batch_frames,
+                "Number of frames for which the likelihoods of the pdfs are "
+                "computed together (faster); if <= 1, frame by frame");
     po.Register("write-per-frame-acoustic-loglikes", &per_frame_acwt_wspecifier,
                 "Wspecifier for table of vectors containing the acoustic log-likelihoods "
                 "per frame for each utterance. E.g. ark:foo/per_frame_logprobs.1.ark");
@@ -93,45 +100,60 @@ int main(int argc, char *argv[]) {
     BaseFloatVectorWriter per_frame_acwt_writer(per_frame_acwt_wspecifier);
 
     int num_done = 0, num_err = 0, num_retry = 0;
+    // the errors found here, apart from num_err which the alignment tasks
+    // update from another thread.
+    int num_read_err = 0;
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
 
-    for (; !fst_reader.Done(); fst_reader.Next()) {
-      std::string utt = fst_reader.Key();
-      if (!feature_reader.HasKey(utt)) {
-        num_err++;
-        KALDI_WARN << "No features for utterance " << utt;
-      } else {
-        const Matrix<BaseFloat> &features = feature_reader.Value(utt);
-        VectorFst<StdArc> decode_fst(fst_reader.Value());
-        fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
-        // by deleting the fst inside the reader, since we're about to mutate
-        // the fst by adding transition probs.
-
-        if (features.NumRows() == 0) {
-          KALDI_WARN << "Zero-length utterance: " << utt;
-          num_err++;
-          continue;
-        }
-
-        {  // Add transition-probs to the FST.
-          std::vector<int32> disambig_syms;  // empty.
-          AddTransitionProbs(trans_model, disambig_syms,
-                             transition_scale, self_loop_scale,
-                             &decode_fst);
+    {
+      TaskSequencer<AlignUtteranceClass> sequencer(sequencer_config);
+
+      for (; !fst_reader.Done(); fst_reader.Next()) {
+        std::string utt = fst_reader.Key();
+        if (!feature_reader.HasKey(utt)) {
+          num_read_err++;
+          KALDI_WARN << "No features for utterance " << utt;
+        } else {
+          const Matrix<BaseFloat> &features = feature_reader.Value(utt);
+          if (features.NumRows() == 0) {
+            KALDI_WARN << "Zero-length utterance: " << utt;
+            num_read_err++;
+            continue;
+          }
+          VectorFst<StdArc> *decode_fst =
+              new VectorFst<StdArc>(fst_reader.Value());
+          fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
+          // by deleting the fst inside the reader, since we're about to mutate
+          // the fst by adding transition probs.
+
+          {  // Add transition-probs to the FST.
+            std::vector<int32> disambig_syms;  // empty.
+            AddTransitionProbs(trans_model, disambig_syms,
+                               transition_scale, self_loop_scale,
+                               decode_fst);
+          }
+
+          // the features are copied, as the reference into the table is only
+          // valid until the next lookup.
+          DecodableAmDiagGmmScaled *gmm_decodable =
+              new DecodableAmDiagGmmScaled(am_gmm, trans_model,
+                                           acoustic_scale, -1.0,
+                                           new Matrix<BaseFloat>(features),
+                                           batch_frames);
+
+          KALDI_LOG << utt;
+          sequencer.Run(new AlignUtteranceClass(
+              align_config, utt, acoustic_scale,
+              decode_fst, gmm_decodable,  // takes ownership of these two.
+              &alignment_writer, &scores_writer,
+              &num_done, &num_err, &num_retry,
+              &tot_like, &frame_count, &per_frame_acwt_writer));
         }
-
-        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
-                                               acoustic_scale);
-
-        KALDI_LOG << utt;
-        AlignUtteranceWrapper(align_config, utt,
-                              acoustic_scale, &decode_fst, &gmm_decodable,
-                              &alignment_writer, &scores_writer,
-                              &num_done, &num_err, &num_retry,
-                              &tot_like, &frame_count, &per_frame_acwt_writer);
       }
+      // the destructor of "sequencer" waits for the remaining tasks.
     }
+    num_err += num_read_err;
     KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like/frame_count)
               << " over " << frame_count<< " frames.";
     KALDI_LOG << "Retried " << num_retry << " out of "
@@ -39,14 +39,7 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
                             FmllrDiagGmmAccs *spk_stats) {
   Posterior pdf_post;
   ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-  for (size_t i = 0; i < post.size(); i++) {
-    for (size_t j = 0; j < pdf_post[i].size(); j++) {
-      int32 pdf_id = pdf_post[i][j].first;
-      spk_stats->AccumulateForGmm(am_gmm.GetPdf(pdf_id),
-                                  feats.Row(i),
-                                  pdf_post[i][j].second);
-    }
-  }
+  spk_stats->AccumulateForFrames(am_gmm, feats, pdf_post);
 }
 
 
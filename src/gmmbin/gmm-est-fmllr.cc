@@ -30,25 +30,68 @@ using std::vector;
 #include "hmm/transition-model.h"
 #include "transform/fmllr-diag-gmm.h"
 #include "hmm/posterior.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
-void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
-                            const Posterior &post,
-                            const TransitionModel &trans_model,
-                            const AmDiagGmm &am_gmm,
-                            FmllrDiagGmmAccs *spk_stats) {
-  Posterior pdf_post;
-  ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-  for (size_t i = 0; i < post.size(); i++) {
-    for (size_t j = 0; j < pdf_post[i].size(); j++) {
-      int32 pdf_id = pdf_post[i][j].first;
-      spk_stats->AccumulateForGmm(am_gmm.GetPdf(pdf_id),
-                                  feats.Row(i),
-                                  pdf_post[i][j].second);
-    }
+
+// This class estimates the fMLLR transform of one speaker (or utterance), for
+// use with TaskSequencer, so that several speakers can be done in parallel.
+// The work happens in operator (), the output in the destructor.
+class FmllrEstimateTask {
+ public:
+  FmllrEstimateTask(const AmDiagGmm &am_gmm,
+                    const FmllrOptions &fmllr_opts,
+                    const std::string &key,
+                    const std::string &key_type,  // "speaker" or "utterance"
+                    BaseFloatMatrixWriter *transform_writer,
+                    double *tot_impr,
+                    double *tot_t):
+      am_gmm_(am_gmm), fmllr_opts_(fmllr_opts), key_(key), key_type_(key_type),
+      transform_writer_(transform_writer), tot_impr_(tot_impr), tot_t_(tot_t),
+      impr_(0.0), count_(0.0) { }
+
+  // "pdf_post" is the posterior on pdf-ids.
+  void AddUtterance(const Matrix<BaseFloat> &feats,
+                    const Posterior &pdf_post) {
+    feats_.push_back(feats);
+    pdf_post_.push_back(pdf_post);
+  }
+
+  void operator () () {
+    FmllrDiagGmmAccs spk_stats(am_gmm_.Dim(), fmllr_opts_);
+    for (size_t i = 0; i < feats_.size(); i++)
+      spk_stats.AccumulateForFrames(am_gmm_, feats_[i], pdf_post_[i]);
+    transform_.Resize(am_gmm_.Dim(), am_gmm_.Dim() + 1);
+    transform_.SetUnit();
+    spk_stats.Update(fmllr_opts_, &transform_, &impr_, &count_);
+    // free the memory; the task may wait a while for its turn to write.
+    feats_.clear();
+    pdf_post_.clear();
   }
-}
 
+  ~FmllrEstimateTask() {
+    transform_writer_->Write(key_, transform_);
+    KALDI_LOG << "For " << key_type_ << " " << key_
+              << ", auxf-impr from fMLLR is " << (impr_ / count_) << ", over "
+              << count_ << " frames.";
+    *tot_impr_ += impr_;
+    *tot_t_ += count_;
+  }
+
+ private:
+  const AmDiagGmm &am_gmm_;
+  FmllrOptions fmllr_opts_;
+  std::string key_;
+  std::string key_type_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<Posterior> pdf_post_;
+  BaseFloatMatrixWriter *transform_writer_;
+  double *tot_impr_;
+  double *tot_t_;
+  Matrix<BaseFloat> transform_;
+  BaseFloat impr_;
+  BaseFloat count_;
+};
 
 }
 
@@ -59,16 +102,19 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Estimate global fMLLR transforms, either per utterance or for the supplied\n"
         "set of speakers (spk2utt option).  Reads posteriors (on transition-ids).  Writes\n"
-        "to a table of matrices.\n"
+        "to a table of matrices.  With --num-threads, several speakers (or utterances)\n"
+        "are done in parallel.\n"
         "Usage: gmm-est-fmllr [options] <model-in> "
         "<feature-rspecifier> <post-rspecifier> <transform-wspecifier>\n";
 
     ParseOptions po(usage);
     FmllrOptions fmllr_opts;
+    TaskSequencerConfig sequencer_config;
     string spk2utt_rspecifier;
     po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to "
                 "utterance-list map");
     fmllr_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -99,90 +145,80 @@ int main(int argc, char *argv[]) {
     BaseFloatMatrixWriter transform_writer(trans_wspecifier);
 
     int32 num_done = 0, num_no_post = 0, num_other_error = 0;
-    if (spk2utt_rspecifier != "") {  // per-speaker adaptation
-      SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
-      RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
-
-      for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
-        string spk = spk2utt_reader.Key();
-        const vector<string> &uttlist = spk2utt_reader.Value();
-        for (size_t i = 0; i < uttlist.size(); i++) {
-          std::string utt = uttlist[i];
-          if (!feature_reader.HasKey(utt)) {
-            KALDI_WARN << "Did not find features for utterance " << utt;
-            num_other_error++;
-            continue;
-          }
+    {
+      TaskSequencer<FmllrEstimateTask> sequencer(sequencer_config);
+      if (spk2utt_rspecifier != "") {  // per-speaker adaptation
+        SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
+        RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+
+        for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
+          string spk = spk2utt_reader.Key();
+          FmllrEstimateTask *task = new FmllrEstimateTask(
+              am_gmm, fmllr_opts, spk, "speaker", &transform_writer,
+              &tot_impr, &tot_t);
+          const vector<string> &uttlist = spk2utt_reader.Value();
+          for (size_t i = 0; i < uttlist.size(); i++) {
+            std::string utt = uttlist[i];
+            if (!feature_reader.HasKey(utt)) {
+              KALDI_WARN << "Did not find features for utterance " << utt;
+              num_other_error++;
+              continue;
+            }
+            if (!post_reader.HasKey(utt)) {
+              KALDI_WARN << "Did not find posteriors for utterance " << utt;
+              num_no_post++;
+              continue;
+            }
+            const Matrix<BaseFloat> &feats = feature_reader.Value(utt);
+            const Posterior &post = post_reader.Value(utt);
+            if (static_cast<int32>(post.size()) != feats.NumRows()) {
+              KALDI_WARN << "Posterior vector has wrong size " << (post.size())
+                         << " vs. " << (feats.NumRows());
+              num_other_error++;
+              continue;
+            }
+
+            Posterior pdf_post;
+            ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
+            task->AddUtterance(feats, pdf_post);
+
+            num_done++;
+          }  // end looping over all utterances of the current speaker
+          // takes ownership of "task"; computes the transform and writes it
+          // out.
+          sequencer.Run(task);
+        }  // end looping over speakers
+      } else {  // per-utterance adaptation
+        SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+        for (; !feature_reader.Done(); feature_reader.Next()) {
+          string utt = feature_reader.Key();
           if (!post_reader.HasKey(utt)) {
-            KALDI_WARN << "Did not find posteriors for utterance " << utt;
+            KALDI_WARN << "Did not find posts for utterance "
+                       << utt;
             num_no_post++;
             continue;
           }
-          const Matrix<BaseFloat> &feats = feature_reader.Value(utt);
+          const Matrix<BaseFloat> &feats = feature_reader.Value();
           const Posterior &post = post_reader.Value(utt);
+
           if (static_cast<int32>(post.size()) != feats.NumRows()) {
-            KALDI_WARN << "Posterior vector has wrong size " << (post.size())
-                       << " vs. " << (feats.NumRows());
+            KALDI_WARN << "Posterior has wrong size " << (post.size())
+                << " vs. " << (feats.NumRows());
             num_other_error++;
             continue;
           }
-
-          AccumulateForUtterance(feats, post, trans_model, am_gmm, &spk_stats);
-
           num_done++;
-        }  // end looping over all utterances of the current speaker
-
-        BaseFloat impr, spk_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &spk_tot_t);
-          transform_writer.Write(spk, transform);
-        }
-        KALDI_LOG << "For speaker " << spk << ", auxf-impr from fMLLR is "
-                  << (impr/spk_tot_t) << ", over " << spk_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += spk_tot_t;
-      }  // end looping over speakers
-    } else {  // per-utterance adaptation
-      SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-      for (; !feature_reader.Done(); feature_reader.Next()) {
-        string utt = feature_reader.Key();
-        if (!post_reader.HasKey(utt)) {
-          KALDI_WARN << "Did not find posts for utterance "
-                     << utt;
-          num_no_post++;
-          continue;
-        }
-        const Matrix<BaseFloat> &feats = feature_reader.Value();
-        const Posterior &post = post_reader.Value(utt);
-
-        if (static_cast<int32>(post.size()) != feats.NumRows()) {
-          KALDI_WARN << "Posterior has wrong size " << (post.size())
-              << " vs. " << (feats.NumRows());
-          num_other_error++;
-          continue;
-        }
-        num_done++;
-
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
 
-        AccumulateForUtterance(feats, post, trans_model, am_gmm,
-                               &spk_stats);
-
-        BaseFloat impr, utt_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &utt_tot_t);
-          transform_writer.Write(utt, transform);
+          Posterior pdf_post;
+          ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
+          FmllrEstimateTask *task = new FmllrEstimateTask(
+              am_gmm, fmllr_opts, utt, "utterance", &transform_writer,
+              &tot_impr, &tot_t);
+          task->AddUtterance(feats, pdf_post);
+          sequencer.Run(task);
         }
-        KALDI_LOG << "For utterance " << utt << ", auxf-impr from fMLLR is "
-                  << (impr/utt_tot_t) << ", over " << utt_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += utt_tot_t;
       }
+      // Destructor of "sequencer" will wait for any remaining tasks.
     }
 
     KALDI_LOG << "Done " << num_done << " files, " << num_no_post
@@ -195,4 +231,3 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 }
-
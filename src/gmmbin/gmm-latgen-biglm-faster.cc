@@ -27,6 +27,7 @@
 #include "hmm/transition-model.h"
 #include "fstext/fstext-lib.h"
 #include "decoder/lattice-biglm-faster-decoder.h"
+#include "lm/const-arpa-lm.h"
 #include "gmm/decodable-am-diag-gmm.h"
 #include "base/timer.h"
 
@@ -156,7 +157,8 @@ int main(int argc, char *argv[]) {
         "this decoder applies the difference during decoding\n"
         "Usage: gmm-latgen-biglm-faster [options] model-in (fst-in|fsts-rspecifier) "
         "oldlm-fst-in newlm-fst-in features-rspecifier"
-        " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n";
+        " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n"
+        "With --const-arpa=true, newlm-fst-in is a ConstArpaLm instead.\n";
     ParseOptions po(usage);
     Timer timer;
     bool allow_partial = false;
@@ -164,7 +166,14 @@ int main(int argc, char *argv[]) {
     LatticeBiglmFasterDecoderConfig config;
     
     std::string word_syms_filename;
+    bool const_arpa = false;
+    int32 lm_cache_size = 250000;
     config.Register(&po);
+    po.Register("const-arpa", &const_arpa, "If true, newlm-fst-in is a "
+                "language model in ConstArpaLm format (see arpa-to-const-arpa) "
+                "rather than an FST.");
+    po.Register("lm-cache-size", &lm_cache_size, "Number of arcs of the "
+                "difference LM the decoder caches; 0 disables the cache.");
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
 
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
@@ -199,14 +208,24 @@ int main(int argc, char *argv[]) {
         fst::ReadFstKaldiGeneric(old_lm_fst_rxfilename));
     ApplyProbabilityScale(-1.0, old_lm_fst); // Negate old LM probs...
     
-    VectorFst<StdArc> *new_lm_fst = fst::CastOrConvertToVectorFst(
-        fst::ReadFstKaldiGeneric(new_lm_fst_rxfilename));
+    // The new LM is either an FST or, with --const-arpa, a ConstArpaLm, which
+    // avoids the epsilon (backoff) arcs of the FST.
+    VectorFst<StdArc> *new_lm_fst = NULL;
+    ConstArpaLm new_const_arpa;
+    std::unique_ptr<fst::DeterministicOnDemandFst<StdArc> > new_lm_dfst;
+    if (const_arpa) {
+      new_const_arpa.ReadMapped(new_lm_fst_rxfilename);
+      new_lm_dfst.reset(new ConstArpaLmDeterministicFst(new_const_arpa));
+    } else {
+      new_lm_fst = fst::CastOrConvertToVectorFst(
+          fst::ReadFstKaldiGeneric(new_lm_fst_rxfilename));
+      new_lm_dfst.reset(
+          new fst::BackoffDeterministicOnDemandFst<StdArc>(*new_lm_fst));
+    }
 
     fst::BackoffDeterministicOnDemandFst<StdArc> old_lm_dfst(*old_lm_fst);
-    fst::BackoffDeterministicOnDemandFst<StdArc> new_lm_dfst(*new_lm_fst);
     fst::ComposeDeterministicOnDemandFst<StdArc> compose_dfst(&old_lm_dfst,
-                                                              &new_lm_dfst);
-    fst::CacheDeterministicOnDemandFst<StdArc> cache_dfst(&compose_dfst);
+                                                              new_lm_dfst.get());
 
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
@@ -237,7 +256,8 @@ int main(int argc, char *argv[]) {
       Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
 
       {
-        LatticeBiglmFasterDecoder decoder(*decode_fst, config, &cache_dfst);
+        LatticeBiglmFasterDecoder decoder(*decode_fst, config, &compose_dfst,
+                                          lm_cache_size);
     
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
@@ -284,7 +304,7 @@ int main(int argc, char *argv[]) {
           continue;
         }
         LatticeBiglmFasterDecoder decoder(fst_reader.Value(), config,
-                                          &cache_dfst);
+                                          &compose_dfst, lm_cache_size);
         DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                acoustic_scale);
         double like;
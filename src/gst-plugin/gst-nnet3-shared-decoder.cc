@@ -0,0 +1,359 @@
+// gst-plugin/gst-nnet3-shared-decoder.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <utility>
+
+#include "gst-plugin/gst-nnet3-shared-decoder.h"
+#include "lat/lattice-functions.h"
+#include "nnet3/nnet-utils.h"
+#include "util/simple-options.h"
+
+namespace kaldi {
+
+std::mutex SharedNnet3Decoder::registry_mutex_;
+std::map<std::string, SharedNnet3Decoder*> SharedNnet3Decoder::registry_;
+
+SharedNnet3Decoder *SharedNnet3Decoder::Acquire(
+    const SharedNnet3DecoderConfig &config) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  std::string key = Key(config);
+  std::map<std::string, SharedNnet3Decoder*>::iterator iter =
+      registry_.find(key);
+  if (iter != registry_.end()) {
+    iter->second->num_users_++;
+    return iter->second;
+  }
+  SharedNnet3Decoder *decoder = new SharedNnet3Decoder(config);
+  decoder->key_ = key;
+  decoder->num_users_ = 1;
+  registry_[key] = decoder;
+  return decoder;
+}
+
+void SharedNnet3Decoder::Release(SharedNnet3Decoder *decoder) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  KALDI_ASSERT(decoder->num_users_ > 0);
+  if (--decoder->num_users_ == 0) {
+    registry_.erase(decoder->key_);
+    delete decoder;
+  }
+}
+
+std::string SharedNnet3Decoder::Key(const SharedNnet3DecoderConfig &config) {
+  // every option of the configuration, as registered.
+  SharedNnet3DecoderConfig config_copy(config);
+  SimpleOptions options;
+  config_copy.Register(&options);
+  std::ostringstream key;
+  key << config.model_rxfilename << '\n' << config.fst_rxfilename << '\n'
+      << config.word_syms_rxfilename << '\n' << config.samp_freq << '\n';
+  std::vector<std::pair<std::string, SimpleOptions::OptionInfo> > info =
+      options.GetOptionInfoList();
+  for (size_t i = 0; i < info.size(); i++) {
+    const std::string &name = info[i].first;
+    key << name << '=';
+    switch (info[i].second.type) {
+      case SimpleOptions::kBool: {
+        bool value;
+        options.GetOption(name, &value);
+        key << value;
+        break;
+      }
+      case SimpleOptions::kInt32: {
+        int32 value;
+        options.GetOption(name, &value);
+        key << value;
+        break;
+      }
+      case SimpleOptions::kUint32: {
+        uint32 value;
+        options.GetOption(name, &value);
+        key << value;
+        break;
+      }
+      case SimpleOptions::kFloat: {
+        float value;
+        options.GetOption(name, &value);
+        key << value;
+        break;
+      }
+      case SimpleOptions::kDouble: {
+        double value;
+        options.GetOption(name, &value);
+        key << value;
+        break;
+      }
+      case SimpleOptions::kString: {
+        std::string value;
+        options.GetOption(name, &value);
+        key << value;
+        break;
+      }
+    }
+    key << '\n';
+  }
+  return key.str();
+}
+
+SharedNnet3Decoder::SharedNnet3Decoder(const SharedNnet3DecoderConfig &config):
+    config_(config), num_users_(0), feature_info_(config.feature_opts),
+    decodable_info_(NULL), decode_fst_(NULL), word_syms_(NULL),
+    decoder_(NULL), next_stream_id_(0), have_work_(false), stop_(false) {
+  {
+    bool binary;
+    Input ki(config_.model_rxfilename, &binary);
+    trans_model_.Read(ki.Stream(), binary);
+    am_nnet_.Read(ki.Stream(), binary);
+    SetBatchnormTestMode(true, &(am_nnet_.GetNnet()));
+    SetDropoutTestMode(true, &(am_nnet_.GetNnet()));
+    nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet_.GetNnet()));
+  }
+  decodable_info_ = new nnet3::DecodableNnetSimpleLoopedInfo(
+      config_.decodable_opts, &am_nnet_);
+  decode_fst_ = ReadFstKaldiGeneric(config_.fst_rxfilename);
+  if (config_.word_syms_rxfilename != "" &&
+      !(word_syms_ = fst::SymbolTable::ReadText(config_.word_syms_rxfilename))) {
+    delete decode_fst_;
+    delete decodable_info_;
+    KALDI_ERR << "Could not read symbol table from file "
+              << config_.word_syms_rxfilename;
+  }
+  decoder_ = new OnlineNnet3BatchDecoder(config_.batch_opts,
+                                         config_.decoder_opts, trans_model_,
+                                         *decodable_info_, *decode_fst_);
+  thread_ = std::thread(&SharedNnet3Decoder::Run, this);
+}
+
+SharedNnet3Decoder::~SharedNnet3Decoder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cond_.notify_one();
+  thread_.join();
+  for (std::map<int32, Stream*>::iterator iter = streams_.begin();
+       iter != streams_.end(); ++iter) {
+    if (iter->second->decoder_stream >= 0)
+      decoder_->RemoveStream(iter->second->decoder_stream);
+    delete iter->second;
+  }
+  delete decoder_;
+  delete word_syms_;
+  delete decode_fst_;
+  delete decodable_info_;
+}
+
+SharedNnet3Decoder::Stream *SharedNnet3Decoder::GetStream(int32 stream) {
+  std::map<int32, Stream*>::iterator iter = streams_.find(stream);
+  return (iter == streams_.end() ? NULL : iter->second);
+}
+
+int32 SharedNnet3Decoder::OpenStream() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int32 id = next_stream_id_++;
+  streams_[id] = new Stream(feature_info_);
+  // the decoding thread starts its first utterance.
+  have_work_ = true;
+  work_cond_.notify_one();
+  return id;
+}
+
+void SharedNnet3Decoder::AcceptWaveform(int32 stream,
+                                        const VectorBase<BaseFloat> &samples) {
+  if (samples.Dim() == 0)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stream *s = GetStream(stream);
+  KALDI_ASSERT(s != NULL && !s->input_finished);
+  int32 dim = s->pending.Dim();
+  s->pending.Resize(dim + samples.Dim(), kCopyData);
+  s->pending.Range(dim, samples.Dim()).CopyFromVec(samples);
+  have_work_ = true;
+  work_cond_.notify_one();
+}
+
+void SharedNnet3Decoder::InputFinished(int32 stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stream *s = GetStream(stream);
+  KALDI_ASSERT(s != NULL);
+  s->input_finished = true;
+  have_work_ = true;
+  work_cond_.notify_one();
+}
+
+bool SharedNnet3Decoder::GetResult(int32 stream,
+                                   std::vector<std::string> *words) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    // a stream closed meanwhile may be gone already.
+    Stream *s = GetStream(stream);
+    if (s == NULL || s->closed)
+      return false;
+    if (!s->results.empty()) {
+      words->swap(s->results.front());
+      s->results.pop_front();
+      return true;
+    }
+    if (s->ended)
+      return false;
+    result_cond_.wait(lock);
+  }
+}
+
+void SharedNnet3Decoder::CloseStream(int32 stream) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream *s = GetStream(stream);
+    if (s == NULL)
+      return;
+    // the decoding thread deletes it, as it may be using it.
+    s->closed = true;
+    have_work_ = true;
+    work_cond_.notify_one();
+  }
+  result_cond_.notify_all();
+}
+
+void SharedNnet3Decoder::StartUtterance(Stream *stream) {
+  delete stream->pipeline;
+  stream->pipeline = new OnlineNnet2FeaturePipeline(feature_info_);
+  stream->pipeline->SetAdaptationState(stream->adaptation_state);
+  stream->decoder_stream = decoder_->AddStream(stream->pipeline);
+  stream->pipeline_finished = false;
+}
+
+void SharedNnet3Decoder::GetWords(const Stream &stream,
+                                  std::vector<std::string> *words) const {
+  words->clear();
+  if (decoder_->NumFramesDecoded(stream.decoder_stream) == 0)
+    return;
+  Lattice best_path;
+  bool end_of_utterance = true;
+  decoder_->GetBestPath(stream.decoder_stream, end_of_utterance, &best_path);
+  std::vector<int32> alignment, word_ids;
+  LatticeWeight weight;
+  GetLinearSymbolSequence(best_path, &alignment, &word_ids, &weight);
+  for (size_t i = 0; i < word_ids.size(); i++) {
+    if (word_ids[i] == 0)
+      continue;
+    std::string word;
+    if (word_syms_ != NULL)
+      word = word_syms_->Find(word_ids[i]);
+    if (word.empty()) {
+      KALDI_WARN << "Word-id " << word_ids[i] << " not in symbol table.";
+      std::ostringstream id;
+      id << word_ids[i];
+      word = id.str();
+    }
+    words->push_back(word);
+  }
+}
+
+void SharedNnet3Decoder::Run() {
+  std::vector<Stream*> active;
+  std::vector<Vector<BaseFloat> > audio;
+  std::vector<bool> input_finished;
+  bool busy = false;
+  while (true) {
+    // take the new audio of the streams, and forget the closed ones.
+    active.clear();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // if the last round computed something, the next may be able to as
+      // well; otherwise wait for audio or for streams to open or close.
+      while (!busy && !have_work_ && !stop_)
+        work_cond_.wait(lock);
+      if (stop_)
+        return;
+      have_work_ = false;
+      std::map<int32, Stream*>::iterator iter = streams_.begin();
+      while (iter != streams_.end()) {
+        Stream *s = iter->second;
+        if (s->closed) {
+          if (s->decoder_stream >= 0)
+            decoder_->RemoveStream(s->decoder_stream);
+          delete s;
+          streams_.erase(iter++);
+          continue;
+        }
+        if (!s->ended)
+          active.push_back(s);
+        ++iter;
+      }
+      audio.resize(active.size());
+      input_finished.resize(active.size());
+      for (size_t i = 0; i < active.size(); i++) {
+        audio[i].Swap(&(active[i]->pending));
+        input_finished[i] = active[i]->input_finished;
+      }
+    }
+
+    for (size_t i = 0; i < active.size(); i++) {
+      Stream *s = active[i];
+      if (s->pipeline == NULL)
+        StartUtterance(s);
+      if (audio[i].Dim() > 0) {
+        s->pipeline->AcceptWaveform(config_.samp_freq, audio[i]);
+        audio[i].Resize(0);
+      }
+      if (input_finished[i] && !s->pipeline_finished) {
+        s->pipeline->InputFinished();
+        s->pipeline_finished = true;
+      }
+    }
+
+    int32 num_chunks = decoder_->AdvanceDecoding();
+    busy = (num_chunks > 0);
+
+    // the utterances that are done
+    bool have_results = false;
+    for (size_t i = 0; i < active.size(); i++) {
+      Stream *s = active[i];
+      int32 stream = s->decoder_stream;
+      if (!decoder_->IsFinished(stream) &&
+          !(config_.do_endpointing &&
+            decoder_->EndpointDetected(stream, config_.endpoint_opts)))
+        continue;
+      if (decoder_->NumFramesDecoded(stream) > 0)
+        decoder_->FinalizeDecoding(stream);
+      std::vector<std::string> words;
+      GetWords(*s, &words);
+      s->pipeline->GetAdaptationState(&(s->adaptation_state));
+      decoder_->RemoveStream(stream);
+      s->decoder_stream = -1;
+      bool ended = s->pipeline_finished;
+      if (ended) {
+        delete s->pipeline;
+        s->pipeline = NULL;
+      } else {
+        StartUtterance(s);
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      s->results.push_back(std::vector<std::string>());
+      s->results.back().swap(words);
+      s->ended = ended;
+      have_results = true;
+    }
+    if (have_results)
+      result_cond_.notify_all();
+  }
+}
+
+}  // namespace kaldi
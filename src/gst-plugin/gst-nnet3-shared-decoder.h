@@ -0,0 +1,182 @@
+// gst-plugin/gst-nnet3-shared-decoder.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GST_PLUGIN_GST_NNET3_SHARED_DECODER_H_
+#define KALDI_GST_PLUGIN_GST_NNET3_SHARED_DECODER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "online2/online-nnet3-batch-decoding.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/online-endpoint.h"
+#include "nnet3/decodable-simple-looped.h"
+#include "fstext/fstext-lib.h"
+
+namespace kaldi {
+
+/// The configuration of a SharedNnet3Decoder.  Elements whose configurations
+/// are equal (see Key()) share one decoder.
+struct SharedNnet3DecoderConfig {
+  std::string model_rxfilename;
+  std::string fst_rxfilename;
+  std::string word_syms_rxfilename;
+  BaseFloat samp_freq;
+  bool do_endpointing;
+  OnlineNnet2FeaturePipelineConfig feature_opts;
+  nnet3::NnetSimpleLoopedComputationOptions decodable_opts;
+  LatticeFasterDecoderConfig decoder_opts;
+  OnlineEndpointConfig endpoint_opts;
+  OnlineNnet3BatchDecodingConfig batch_opts;
+
+  SharedNnet3DecoderConfig(): samp_freq(16000.0), do_endpointing(false) { }
+
+  /// Registers everything but the filenames, which the element has as
+  /// properties of their own.
+  void Register(OptionsItf *opts) {
+    opts->Register("do-endpointing", &do_endpointing,
+                   "If true, apply endpoint detection");
+    feature_opts.Register(opts);
+    decodable_opts.Register(opts);
+    decoder_opts.Register(opts);
+    endpoint_opts.Register(opts);
+    batch_opts.Register(opts);
+  }
+};
+
+
+/**
+   SharedNnet3Decoder holds one copy of the nnet3 model, the decoding graph
+   and the word symbols, and decodes the audio of any number of streams (one
+   per element instance, i.e. per pipeline) with one OnlineNnet3BatchDecoder,
+   so that the neural net is computed for the chunks of many streams at once.
+
+   OnlineNnet3BatchDecoder is not thread safe, so it and the feature pipelines
+   of the streams are only touched by a thread of the decoder's own.  The
+   elements' streaming threads just hand their audio over (AcceptWaveform())
+   and wait for the words of each utterance (GetResult()); utterances are
+   segmented by endpointing if it is enabled, and the iVector adaptation
+   state is carried over between the utterances of a stream.
+
+   Decoders are obtained with Acquire(), which returns the existing decoder
+   for the same configuration if there is one, and given back with
+   Release(); the last Release() deletes it.
+*/
+class SharedNnet3Decoder {
+ public:
+  /// Returns the decoder for this configuration, loading the models if no
+  /// element holds one yet.  Throws on error (e.g. a file cannot be read).
+  static SharedNnet3Decoder *Acquire(const SharedNnet3DecoderConfig &config);
+
+  /// Gives back a decoder obtained from Acquire().  The streams opened by the
+  /// caller must have been closed.
+  static void Release(SharedNnet3Decoder *decoder);
+
+  /// Opens a stream and returns its id.
+  int32 OpenStream();
+
+  /// Gives the stream more audio (at the configured sampling frequency).
+  void AcceptWaveform(int32 stream, const VectorBase<BaseFloat> &samples);
+
+  /// Says that the stream will get no more audio; its last utterance is
+  /// finished and the stream ends once its words are out.
+  void InputFinished(int32 stream);
+
+  /// Waits for the words of the next utterance of the stream and outputs
+  /// them.  Returns false, without waiting, if the stream has ended and all
+  /// its utterances were output.
+  bool GetResult(int32 stream, std::vector<std::string> *words);
+
+  /// Closes the stream, whether or not it has ended.  The id must not be used
+  /// after this.
+  void CloseStream(int32 stream);
+
+ private:
+  // The state of a stream.  The members before 'pipeline' are shared with
+  // the element threads and protected by mutex_; the rest are only used by
+  // the decoding thread.
+  struct Stream {
+    explicit Stream(const OnlineNnet2FeaturePipelineInfo &feature_info):
+        input_finished(false), closed(false), ended(false),
+        pipeline(NULL), decoder_stream(-1), pipeline_finished(false),
+        adaptation_state(feature_info.ivector_extractor_info) { }
+    ~Stream() { delete pipeline; }
+
+    Vector<BaseFloat> pending;  // audio not yet given to the pipeline.
+    bool input_finished;
+    bool closed;
+    bool ended;  // true when the words of the last utterance are in 'results'.
+    std::deque<std::vector<std::string> > results;
+
+    OnlineNnet2FeaturePipeline *pipeline;
+    int32 decoder_stream;  // the id of the stream in decoder_, or -1.
+    bool pipeline_finished;  // InputFinished() was called for the pipeline.
+    OnlineIvectorExtractorAdaptationState adaptation_state;
+  };
+
+  explicit SharedNnet3Decoder(const SharedNnet3DecoderConfig &config);
+  ~SharedNnet3Decoder();
+
+  // returns the string that identifies the configuration.
+  static std::string Key(const SharedNnet3DecoderConfig &config);
+
+  Stream *GetStream(int32 stream);  // requires mutex_.
+
+  // the decoding thread.
+  void Run();
+  // starts an utterance of the stream (on the decoding thread).
+  void StartUtterance(Stream *stream);
+  // the words of the best path of the utterance of the stream.
+  void GetWords(const Stream &stream, std::vector<std::string> *words) const;
+
+  SharedNnet3DecoderConfig config_;
+  std::string key_;
+  int32 num_users_;  // protected by the registry's mutex.
+
+  OnlineNnet2FeaturePipelineInfo feature_info_;
+  TransitionModel trans_model_;
+  nnet3::AmNnetSimple am_nnet_;
+  nnet3::DecodableNnetSimpleLoopedInfo *decodable_info_;
+  fst::Fst<fst::StdArc> *decode_fst_;
+  fst::SymbolTable *word_syms_;
+  OnlineNnet3BatchDecoder *decoder_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cond_;  // signals the decoding thread.
+  std::condition_variable result_cond_;  // signals the element threads.
+  std::map<int32, Stream*> streams_;
+  int32 next_stream_id_;
+  bool have_work_;
+  bool stop_;
+  std::thread thread_;
+
+  static std::mutex registry_mutex_;
+  static std::map<std::string, SharedNnet3Decoder*> registry_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SharedNnet3Decoder);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GST_PLUGIN_GST_NNET3_SHARED_DECODER_H_
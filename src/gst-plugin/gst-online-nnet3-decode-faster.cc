@@ -0,0 +1,721 @@
+// gst-plugin/gst-online-nnet3-decode-faster.cc
+
+// Copyright 2013  Tanel Alumae, Tallinn University of Technology
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+// Modifications to the original contribution by Cisco Systems made by:
+// Vassil Panayotov
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+/**
+ * GStreamer plugin for automatic speech recognition with nnet3 models.
+ * Based on Kaldi's OnlineNnet3BatchDecoder: all the onlinennet3decodefaster
+ * elements of a process that have the same model, graph, word symbols and
+ * options share one copy of them and one decoder, which computes the neural
+ * net for the audio of the elements (the streams) in batches.  Each element
+ * has its own feature pipeline, decoder state and endpointing.
+ *
+ * The words of each utterance are pushed when the utterance is finished, at
+ * an endpoint (if do-endpointing is set) or at the end of the stream,
+ * followed by "<#s>".
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0  filesrc location=test.wav \
+ *     ! decodebin ! audioconvert ! audioresample \
+ *     ! onlinennet3decodefaster model=$dir/final.mdl fst=$dir/HCLG.fst \
+ *                              word-syms=$dir/words.txt \
+ *                              mfcc-config=$dir/conf/mfcc.conf \
+ *                              ivector-extraction-config=$dir/conf/ivector_extractor.conf \
+ *                              frames-per-chunk=20 acoustic-scale=1.0 \
+ *                              max-batch-size=32 do-endpointing=true \
+ *     ! filesink location=$resultfile
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#else
+#  define VERSION "1.0"
+#endif
+
+#include <string>
+#include <vector>
+
+#include "gst-plugin/kaldimarshal.h"
+#include "gst-plugin/gst-online-nnet3-decode-faster.h"
+
+#include "util/simple-options.h"
+
+namespace kaldi {
+
+GST_DEBUG_CATEGORY_STATIC(gst_online_nnet3_decode_faster_debug);
+#define GST_CAT_DEFAULT gst_online_nnet3_decode_faster_debug
+
+enum {
+  HYP_WORD_SIGNAL,
+  LAST_SIGNAL
+};
+
+enum {
+  PROP_0,
+  PROP_SILENT,
+  PROP_MODEL,
+  PROP_FST,
+  PROP_WORD_SYMS,
+  PROP_LAST
+};
+
+#define DEFAULT_MODEL           "final.mdl"
+#define DEFAULT_FST             "HCLG.fst"
+#define DEFAULT_WORD_SYMS       "words.txt"
+#define SAMPLE_FREQ             16000
+
+
+/* the capabilities of the inputs and outputs.
+ *
+ * describe the real formats here.
+ */
+static GstStaticPadTemplate sink_factory =
+    GST_STATIC_PAD_TEMPLATE("sink",
+                            GST_PAD_SINK,
+                            GST_PAD_ALWAYS,
+                            GST_STATIC_CAPS(
+                                "audio/x-raw, "
+                                "format = (string) S16LE, "
+                                "channels = (int) 1, "
+                                "rate = (int) 16000 "));
+
+
+static GstStaticPadTemplate src_factory =
+    GST_STATIC_PAD_TEMPLATE("src",
+                            GST_PAD_SRC,
+                            GST_PAD_ALWAYS,
+                            GST_STATIC_CAPS("text/x-raw, format= { utf8 }"));
+
+static guint gst_online_nnet3_decode_faster_signals[LAST_SIGNAL];
+
+#define gst_online_nnet3_decode_faster_parent_class parent_class
+G_DEFINE_TYPE(GstOnlineNnet3DecodeFaster, gst_online_nnet3_decode_faster, GST_TYPE_ELEMENT);
+
+
+static void
+gst_online_nnet3_decode_faster_set_property(GObject * object, guint prop_id,
+                                            const GValue * value,
+                                            GParamSpec * pspec);
+static void
+gst_online_nnet3_decode_faster_get_property(GObject * object, guint prop_id,
+                                            GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn
+gst_online_nnet3_decode_faster_change_state(GstElement *element,
+                                            GstStateChange transition);
+static void
+gst_online_nnet3_decode_faster_finalize(GObject * object);
+
+static gboolean
+gst_online_nnet3_decode_faster_sink_event(GstPad * pad, GstObject * parent,
+                                          GstEvent * event);
+
+static GstFlowReturn gst_online_nnet3_decode_faster_chain(GstPad * pad,
+                                                          GstObject * parent,
+                                                          GstBuffer * buf);
+
+static void
+gst_online_nnet3_decode_faster_loop(GstOnlineNnet3DecodeFaster * filter);
+
+
+/* GObject vmethod implementations */
+
+/* initialize the onlinennet3decodefaster's class */
+static void gst_online_nnet3_decode_faster_class_init(GstOnlineNnet3DecodeFasterClass * klass) {
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+
+  gobject_class->set_property = gst_online_nnet3_decode_faster_set_property;
+  gobject_class->get_property = gst_online_nnet3_decode_faster_get_property;
+  gobject_class->finalize = gst_online_nnet3_decode_faster_finalize;
+
+  gstelement_class->change_state = gst_online_nnet3_decode_faster_change_state;
+
+  g_object_class_install_property(G_OBJECT_CLASS(klass),
+                                  PROP_SILENT,
+                                  g_param_spec_boolean("silent",
+                                                       "Silence the decoder",
+                                                       "Determines whether incoming audio is sent to the decoder or not",
+                                                       false,
+                                                       (GParamFlags) G_PARAM_READWRITE));
+  g_object_class_install_property(G_OBJECT_CLASS(klass),
+                                  PROP_MODEL,
+                                  g_param_spec_string("model",
+                                                      "Acoustic model",
+                                                      "Filename of the nnet3 acoustic model",
+                                                      DEFAULT_MODEL,
+                                                      (GParamFlags) G_PARAM_READWRITE));
+  g_object_class_install_property(G_OBJECT_CLASS(klass),
+                                  PROP_FST,
+                                  g_param_spec_string("fst",
+                                                      "Decoding FST",
+                                                      "Filename of the HCLG FST",
+                                                      DEFAULT_FST,
+                                                      (GParamFlags) G_PARAM_READWRITE));
+  g_object_class_install_property(G_OBJECT_CLASS(klass),
+                                  PROP_WORD_SYMS,
+                                  g_param_spec_string("word-syms",
+                                                      "Word symbols",
+                                                      "Name of word symbols file (typically words.txt)",
+                                                      DEFAULT_WORD_SYMS,
+                                                      (GParamFlags) G_PARAM_READWRITE));
+
+  gst_element_class_set_details_simple(gstelement_class,
+                                       "OnlineNnet3DecodeFaster",
+                                       "Speech/Audio",
+                                       "Convert speech to text",
+                                       "agent");
+
+  gst_element_class_add_pad_template(gstelement_class,
+                                     gst_static_pad_template_get(&src_factory));
+  gst_element_class_add_pad_template(gstelement_class,
+                                     gst_static_pad_template_get(&sink_factory));
+
+  gst_online_nnet3_decode_faster_signals[HYP_WORD_SIGNAL]
+      = g_signal_new("hyp-word", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+                     G_STRUCT_OFFSET(GstOnlineNnet3DecodeFasterClass, hyp_word),
+                     NULL, NULL, kaldi_marshal_VOID__STRING, G_TYPE_NONE, 1,
+                     G_TYPE_STRING);
+}
+
+
+
+/* initialize the new element
+ * instantiate pads and add them to element
+ * set pad calback functions
+ * initialize instance structure
+ */
+static void
+gst_online_nnet3_decode_faster_init(GstOnlineNnet3DecodeFaster * filter) {
+  bool tmp_bool;
+  int32 tmp_int;
+  uint32 tmp_uint;
+  float tmp_float;
+  double tmp_double;
+  std::string tmp_string;
+  filter->silent_ = false;
+  filter->decoder_ = NULL;
+  filter->stream_ = -1;
+  filter->model_rspecifier_ = g_strdup(DEFAULT_MODEL);
+  filter->fst_rspecifier_ = g_strdup(DEFAULT_FST);
+  filter->word_syms_filename_ = g_strdup(DEFAULT_WORD_SYMS);
+
+  filter->simple_options_ = new SimpleOptions();
+
+  filter->config_ = new SharedNnet3DecoderConfig();
+  filter->config_->samp_freq = SAMPLE_FREQ;
+  filter->config_->Register(filter->simple_options_);
+
+  filter->sinkpad_ = gst_pad_new_from_static_template(&sink_factory, "sink");
+  gst_pad_set_event_function(filter->sinkpad_,
+                              GST_DEBUG_FUNCPTR(gst_online_nnet3_decode_faster_sink_event));
+  gst_pad_set_chain_function(filter->sinkpad_,
+                              GST_DEBUG_FUNCPTR(gst_online_nnet3_decode_faster_chain));
+
+  gst_pad_use_fixed_caps(filter->sinkpad_);
+  gst_element_add_pad(GST_ELEMENT(filter), filter->sinkpad_);
+
+  filter->srcpad_ = gst_pad_new_from_static_template(&src_factory, "src");
+  gst_pad_use_fixed_caps(filter->srcpad_);
+  gst_element_add_pad(GST_ELEMENT(filter), filter->srcpad_);
+
+  // init properties from various Kaldi Opts
+  GstElementClass * klass = GST_ELEMENT_GET_CLASS(filter);
+
+  std::vector<std::pair<std::string, SimpleOptions::OptionInfo> > option_info_list;
+  option_info_list = filter->simple_options_->GetOptionInfoList();
+  int32 i = 0;
+  for (std::vector<std::pair<std::string,
+      SimpleOptions::OptionInfo> >::iterator dx = option_info_list.begin();
+      dx != option_info_list.end(); dx++) {
+    std::pair<std::string, SimpleOptions::OptionInfo> result = (*dx);
+    SimpleOptions::OptionInfo option_info = result.second;
+    std::string name = result.first;
+    switch (option_info.type) {
+      case SimpleOptions::kBool:
+        filter->simple_options_->GetOption(name, &tmp_bool);
+        g_object_class_install_property(
+                                        G_OBJECT_CLASS(klass),
+                                        PROP_LAST + i,
+                                        g_param_spec_boolean(
+                                                             name.c_str(),
+                                                             option_info.doc.c_str(),
+                                                             option_info.doc.c_str(),
+                                                             tmp_bool,
+                                                             (GParamFlags) G_PARAM_READWRITE));
+        break;
+      case SimpleOptions::kInt32:
+        filter->simple_options_->GetOption(name, &tmp_int);
+        g_object_class_install_property(
+                                        G_OBJECT_CLASS(klass),
+                                        PROP_LAST + i,
+                                        g_param_spec_int(
+                                                         name.c_str(),
+                                                         option_info.doc.c_str(),
+                                                         option_info.doc.c_str(),
+                                                         G_MININT,
+                                                         G_MAXINT,
+                                                         tmp_int,
+                                                         (GParamFlags) G_PARAM_READWRITE));
+        break;
+      case SimpleOptions::kUint32:
+        filter->simple_options_->GetOption(name, &tmp_uint);
+        g_object_class_install_property(
+                                        G_OBJECT_CLASS(klass),
+                                        PROP_LAST + i,
+                                        g_param_spec_uint(
+                                                          name.c_str(),
+                                                          option_info.doc.c_str(),
+                                                          option_info.doc.c_str(),
+                                                          0,
+                                                          G_MAXUINT,
+                                                          tmp_uint,
+                                                          (GParamFlags) G_PARAM_READWRITE));
+        break;
+      case SimpleOptions::kFloat:
+        filter->simple_options_->GetOption(name, &tmp_float);
+        g_object_class_install_property(
+                                        G_OBJECT_CLASS(klass),
+                                        PROP_LAST + i,
+                                        g_param_spec_float(
+                                                           name.c_str(),
+                                                           option_info.doc.c_str(),
+                                                           option_info.doc.c_str(),
+                                                           G_MINFLOAT,
+                                                           G_MAXFLOAT,
+                                                           tmp_float,
+                                                           (GParamFlags) G_PARAM_READWRITE));
+        break;
+      case SimpleOptions::kDouble:
+        filter->simple_options_->GetOption(name, &tmp_double);
+        g_object_class_install_property(
+                                        G_OBJECT_CLASS(klass),
+                                        PROP_LAST + i,
+                                        g_param_spec_double(
+                                                            name.c_str(),
+                                                            option_info.doc.c_str(),
+                                                            option_info.doc.c_str(),
+                                                            G_MINDOUBLE,
+                                                            G_MAXDOUBLE,
+                                                            tmp_double,
+                                                            (GParamFlags) G_PARAM_READWRITE));
+        break;
+      case SimpleOptions::kString:
+        filter->simple_options_->GetOption(name, &tmp_string);
+        g_object_class_install_property(
+                                        G_OBJECT_CLASS(klass),
+                                        PROP_LAST + i,
+                                        g_param_spec_string(
+                                                            name.c_str(),
+                                                            option_info.doc.c_str(),
+                                                            option_info.doc.c_str(),
+                                                            tmp_string.c_str(),
+                                                            (GParamFlags) G_PARAM_READWRITE));
+        break;
+    }
+    i += 1;
+  }
+}
+
+static bool
+gst_online_nnet3_decode_faster_allocate(GstOnlineNnet3DecodeFaster * filter) {
+  if (!filter->decoder_) {
+    GST_INFO_OBJECT(filter,  "Getting Kaldi decoder");
+    filter->config_->model_rxfilename = filter->model_rspecifier_;
+    filter->config_->fst_rxfilename = filter->fst_rspecifier_;
+    filter->config_->word_syms_rxfilename = filter->word_syms_filename_;
+    try {
+      filter->decoder_ = SharedNnet3Decoder::Acquire(*(filter->config_));
+    } catch(const std::exception &e) {
+      GST_ERROR_OBJECT(filter, "Could not load the decoder: %s", e.what());
+      return false;
+    }
+    GST_INFO_OBJECT(filter,  "Got Kaldi decoder");
+  }
+  return true;
+}
+
+static void
+gst_online_nnet3_decode_faster_finalize(GObject * object) {
+  GstOnlineNnet3DecodeFaster *filter = GST_ONLINENNET3DECODEFASTER(object);
+
+  g_free(filter->model_rspecifier_);
+  g_free(filter->fst_rspecifier_);
+  g_free(filter->word_syms_filename_);
+  if (filter->decoder_) {
+    if (filter->stream_ >= 0) {
+      filter->decoder_->CloseStream(filter->stream_);
+      filter->stream_ = -1;
+    }
+    SharedNnet3Decoder::Release(filter->decoder_);
+    filter->decoder_ = NULL;
+  }
+  delete filter->config_;
+  if (filter->simple_options_) {
+    delete filter->simple_options_;
+    filter->simple_options_ = NULL;
+  }
+
+  G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+
+static bool
+gst_online_nnet3_decode_faster_deallocate(GstOnlineNnet3DecodeFaster * filter) {
+  /* We keep our reference to the shared decoder until the element is
+     finalized, since model loading could take a lot of time */
+  GST_INFO_OBJECT(filter, "Refusing to unload decoder");
+  return true;
+}
+
+static void
+gst_online_nnet3_decode_faster_set_property(GObject * object, guint prop_id,
+                                            const GValue * value, GParamSpec * pspec) {
+  GstOnlineNnet3DecodeFaster *filter = GST_ONLINENNET3DECODEFASTER(object);
+
+  if (prop_id == PROP_SILENT) {
+    filter->silent_ = g_value_get_boolean(value);
+    return;
+  }
+  // All other props cannot be changed after initialization
+  if (filter->decoder_) {
+    GST_WARNING_OBJECT(filter,  "Decoder already initialized, cannot change it's properties");
+    return;
+  }
+  switch (prop_id) {
+    case PROP_MODEL:
+      g_free(filter->model_rspecifier_);
+      filter->model_rspecifier_ = g_value_dup_string(value);
+      break;
+    case PROP_FST:
+      g_free(filter->fst_rspecifier_);
+      filter->fst_rspecifier_ = g_value_dup_string(value);
+      break;
+    case PROP_WORD_SYMS:
+      g_free(filter->word_syms_filename_);
+      filter->word_syms_filename_ = g_value_dup_string(value);
+      break;
+    default:
+      if (prop_id >= PROP_LAST) {
+        const gchar* name = g_param_spec_get_name(pspec);
+        SimpleOptions::OptionType option_type;
+        if (filter->simple_options_->GetOptionType(std::string(name), &option_type)) {
+          switch (option_type) {
+            case SimpleOptions::kBool:
+              filter->simple_options_->SetOption(name, g_value_get_boolean(value));
+              break;
+            case SimpleOptions::kInt32:
+              filter->simple_options_->SetOption(name, g_value_get_int(value));
+              break;
+            case SimpleOptions::kUint32:
+              filter->simple_options_->SetOption(name, g_value_get_uint(value));
+              break;
+            case SimpleOptions::kFloat:
+              filter->simple_options_->SetOption(name, g_value_get_float(value));
+              break;
+            case SimpleOptions::kDouble:
+              filter->simple_options_->SetOption(name, g_value_get_double(value));
+              break;
+            case SimpleOptions::kString:
+              filter->simple_options_->SetOption(name, g_value_dup_string(value));
+              break;
+          }
+          break;
+        }
+      }
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_online_nnet3_decode_faster_get_property(GObject * object, guint prop_id,
+                                            GValue * value, GParamSpec * pspec) {
+  bool tmp_bool;
+  int32 tmp_int;
+  uint32 tmp_uint;
+  float tmp_float;
+  double tmp_double;
+  std::string tmp_string;
+
+  GstOnlineNnet3DecodeFaster *filter = GST_ONLINENNET3DECODEFASTER(object);
+
+  switch (prop_id) {
+    case PROP_SILENT:
+      g_value_set_boolean(value, filter->silent_);
+      break;
+    case PROP_MODEL:
+      g_value_set_string(value, filter->model_rspecifier_);
+      break;
+    case PROP_FST:
+      g_value_set_string(value, filter->fst_rspecifier_);
+      break;
+    case PROP_WORD_SYMS:
+      g_value_set_string(value, filter->word_syms_filename_);
+      break;
+    default:
+      if (prop_id >= PROP_LAST) {
+        const gchar* name = g_param_spec_get_name(pspec);
+        SimpleOptions::OptionType option_type;
+        if (filter->simple_options_->GetOptionType(std::string(name), &option_type)) {
+          switch (option_type) {
+            case SimpleOptions::kBool:
+              filter->simple_options_->GetOption(name, &tmp_bool);
+              g_value_set_boolean(value, tmp_bool);
+              break;
+            case SimpleOptions::kInt32:
+              filter->simple_options_->GetOption(name, &tmp_int);
+              g_value_set_int(value, tmp_int);
+              break;
+            case SimpleOptions::kUint32:
+              filter->simple_options_->GetOption(name, &tmp_uint);
+              g_value_set_uint(value, tmp_uint);
+              break;
+            case SimpleOptions::kFloat:
+              filter->simple_options_->GetOption(name, &tmp_float);
+              g_value_set_float(value, tmp_float);
+              break;
+            case SimpleOptions::kDouble:
+              filter->simple_options_->GetOption(name, &tmp_double);
+              g_value_set_double(value, tmp_double);
+              break;
+            case SimpleOptions::kString:
+              filter->simple_options_->GetOption(name, &tmp_string);
+              g_value_set_string(value, tmp_string.c_str());
+              break;
+          }
+          break;
+        }
+      }
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+
+static GstStateChangeReturn
+gst_online_nnet3_decode_faster_change_state(GstElement *element, GstStateChange transition) {
+  GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+  GstOnlineNnet3DecodeFaster *filter = GST_ONLINENNET3DECODEFASTER(element);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (!gst_online_nnet3_decode_faster_allocate(filter))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      // closing the stream wakes up the decoding task, which then stops.
+      if (filter->stream_ >= 0)
+        filter->decoder_->CloseStream(filter->stream_);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      filter->stream_ = -1;
+      break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_online_nnet3_decode_faster_deallocate(filter);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/*
+ * Emit a single recognized word:
+ *   * emit through the sink pad of the element
+ *   * emit by the hy-word signal
+ */
+static void
+gst_online_nnet3_decode_faster_push_word(GstOnlineNnet3DecodeFaster * filter, GstPad *pad, std::string word) {
+  const gchar *hyp = word.c_str();
+  guint hyp_len = strlen(hyp);
+  GST_DEBUG_OBJECT(filter,  "WORD: %s", hyp);
+  /* +1 for terminating NUL character */
+  GstBuffer *buffer = gst_buffer_new_and_alloc(hyp_len + 2);
+  gst_buffer_fill(buffer, 0, hyp, hyp_len);
+  gst_buffer_memset(buffer, hyp_len, ' ', 1);
+  gst_buffer_memset(buffer, hyp_len + 1, '\0', 1);
+  gst_buffer_set_size(buffer, hyp_len + 1);
+
+  gst_pad_push(pad, buffer);
+  /* Emit a signal for applications. */
+  g_signal_emit(filter, gst_online_nnet3_decode_faster_signals[HYP_WORD_SIGNAL], 0, hyp);
+}
+
+/*
+ * The decoding task: pushes the words of the utterances of the stream as the
+ * shared decoder finishes them, then EOS.
+ */
+static void
+gst_online_nnet3_decode_faster_loop(GstOnlineNnet3DecodeFaster * filter) {
+  std::vector<std::string> words;
+  if (filter->decoder_->GetResult(filter->stream_, &words)) {
+    if (words.empty())
+      return;
+    for (size_t i = 0; i < words.size(); i++)
+      gst_online_nnet3_decode_faster_push_word(filter, filter->srcpad_, words[i]);
+    gst_online_nnet3_decode_faster_push_word(filter, filter->srcpad_, "<#s>");
+    return;
+  }
+  GST_DEBUG_OBJECT(filter, "Finished decoding stream");
+  GST_DEBUG_OBJECT(filter, "Pushing EOS event");
+  gst_pad_push_event(filter->srcpad_, gst_event_new_eos());
+
+  GST_DEBUG_OBJECT(filter, "Pausing decoding task");
+  gst_pad_pause_task(filter->srcpad_);
+}
+
+/* GstElement vmethod implementations */
+/* this function handles sink events */
+static gboolean
+gst_online_nnet3_decode_faster_sink_event(GstPad * pad, GstObject * parent, GstEvent * event) {
+  gboolean ret;
+  GstOnlineNnet3DecodeFaster *filter;
+
+  filter = GST_ONLINENNET3DECODEFASTER(parent);
+  GST_DEBUG_OBJECT(filter, "Handling %s event", GST_EVENT_TYPE_NAME(event));
+
+  switch (GST_EVENT_TYPE(event)) {
+    case GST_EVENT_SEGMENT:
+    {
+      // each segment is decoded as a stream of its own.
+      if (filter->stream_ >= 0)
+        filter->decoder_->CloseStream(filter->stream_);
+      filter->stream_ = filter->decoder_->OpenStream();
+      GST_DEBUG_OBJECT(filter,  "Starting decoding task");
+      gst_pad_start_task(filter->srcpad_,
+                         (GstTaskFunction) gst_online_nnet3_decode_faster_loop, filter, NULL);
+
+      GST_DEBUG_OBJECT(filter,  "Started decoding task");
+      ret = TRUE;
+      break;
+    }
+    case GST_EVENT_CAPS:
+    {
+      ret = TRUE;
+      break;
+    }
+    case GST_EVENT_EOS:
+    {
+      /* end-of-stream, we should close down all stream leftovers here */
+      GST_DEBUG_OBJECT(filter, "EOS received");
+      if (filter->stream_ >= 0)
+        filter->decoder_->InputFinished(filter->stream_);
+      ret = TRUE;
+      break;
+    }
+    default:
+      ret = gst_pad_event_default(pad, parent, event);
+      break;
+  }
+  return ret;
+}
+
+/* chain function
+ * this function does the actual processing
+ */
+static GstFlowReturn gst_online_nnet3_decode_faster_chain(GstPad * pad,
+                                                          GstObject * parent,
+                                                          GstBuffer * buf) {
+  GstOnlineNnet3DecodeFaster *filter;
+
+  filter = GST_ONLINENNET3DECODEFASTER(parent);
+
+  if (G_UNLIKELY(!filter->decoder_ || filter->stream_ < 0))
+    goto not_negotiated;
+  if (!filter->silent_) {
+    GstMapInfo map;
+    if (gst_buffer_map(buf, &map, GST_MAP_READ)) {
+      // hardcoded 16-bit audio, as in the caps.
+      const int16 *data = reinterpret_cast<const int16*>(map.data);
+      Vector<BaseFloat> samples(map.size / sizeof(int16), kUndefined);
+      for (int32 i = 0; i < samples.Dim(); i++)
+        samples(i) = data[i];
+      gst_buffer_unmap(buf, &map);
+      filter->decoder_->AcceptWaveform(filter->stream_, samples);
+    }
+  }
+  gst_buffer_unref(buf);
+  return GST_FLOW_OK;
+
+  /* special cases */
+  not_negotiated: {
+    GST_ELEMENT_ERROR(filter, CORE, NEGOTIATION, (NULL),
+                      ("decoder wasn't allocated before chain function"));
+
+    gst_buffer_unref(buf);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+}
+
+
+/* entry point to initialize the plug-in
+ * initialize the plug-in itself
+ * register the element factories and other features
+ */
+static gboolean
+onlinennet3decodefaster_init(GstPlugin * onlinennet3decodefaster) {
+  /* debug category for fltering log messages
+   */
+  GST_DEBUG_CATEGORY_INIT(gst_online_nnet3_decode_faster_debug, "onlinennet3decodefaster",
+                           0, "Automatic Speech Recognition");
+
+  return gst_element_register(onlinennet3decodefaster, "onlinennet3decodefaster", GST_RANK_NONE,
+                               GST_TYPE_ONLINENNET3DECODEFASTER);
+}
+
+/* PACKAGE: this is usually set by autotools depending on some _INIT macro
+ * in configure.ac and then written into and defined in config.h, but we can
+ * just set it ourselves here in case someone doesn't use autotools to
+ * compile this code. GST_PLUGIN_DEFINE needs PACKAGE to be defined.
+ */
+#ifndef PACKAGE
+#define PACKAGE "onlinennet3decodefaster"
+#endif
+
+GST_PLUGIN_DEFINE(
+    GST_VERSION_MAJOR,
+    GST_VERSION_MINOR,
+    onlinennet3decodefaster,
+    "Online nnet3 speech recognizer based on the Kaldi toolkit",
+    onlinennet3decodefaster_init,
+    VERSION,
+    "LGPL",  // Changing it into Apache prevents the plugin from loading, see gst/gstplugin.c in GStreamer source
+    "Kaldi",
+    "http://kaldi.sourceforge.net/"
+)
+}
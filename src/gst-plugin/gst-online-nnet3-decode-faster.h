@@ -0,0 +1,78 @@
+// gst-plugin/gst-online-nnet3-decode-faster.h
+
+// Copyright 2013  Tanel Alumae, Tallinn University of Technology
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GST_PLUGIN_GST_ONLINE_NNET3_DECODE_FASTER_H_
+#define KALDI_GST_PLUGIN_GST_ONLINE_NNET3_DECODE_FASTER_H_
+
+#include <gst/gst.h>
+
+#include "util/simple-options.h"
+#include "gst-plugin/gst-nnet3-shared-decoder.h"
+
+namespace kaldi {
+
+G_BEGIN_DECLS
+
+/* #defines don't like whitespacey bits */
+#define GST_TYPE_ONLINENNET3DECODEFASTER \
+    (gst_online_nnet3_decode_faster_get_type())
+#define GST_ONLINENNET3DECODEFASTER(obj) \
+    (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_ONLINENNET3DECODEFASTER,GstOnlineNnet3DecodeFaster))
+#define GST_ONLINENNET3DECODEFASTER_CLASS(klass) \
+    (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_ONLINENNET3DECODEFASTER,GstOnlineNnet3DecodeFasterClass))
+#define GST_IS_ONLINENNET3DECODEFASTER(obj) \
+    (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_ONLINENNET3DECODEFASTER))
+#define GST_IS_ONLINENNET3DECODEFASTER_CLASS(klass) \
+    (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_ONLINENNET3DECODEFASTER))
+
+typedef struct _GstOnlineNnet3DecodeFaster      GstOnlineNnet3DecodeFaster;
+typedef struct _GstOnlineNnet3DecodeFasterClass GstOnlineNnet3DecodeFasterClass;
+
+struct _GstOnlineNnet3DecodeFaster {
+  GstElement element;
+
+  GstPad *sinkpad_, *srcpad_;
+
+  bool silent_;
+
+  // shared by all the elements with the same models and options; each
+  // element decodes its audio as one stream of it.
+  SharedNnet3Decoder *decoder_;
+  int32 stream_;  // -1 if no stream is open.
+
+  gchar* model_rspecifier_;
+  gchar* fst_rspecifier_;
+  gchar* word_syms_filename_;
+
+  SharedNnet3DecoderConfig *config_;
+
+  SimpleOptions *simple_options_;
+};
+
+struct _GstOnlineNnet3DecodeFasterClass {
+  GstElementClass parent_class;
+  void (*hyp_word)(GstElement *element, const gchar *hyp_str);
+};
+
+GType gst_online_nnet3_decode_faster_get_type(void);
+
+G_END_DECLS
+}
+#endif  // KALDI_GST_PLUGIN_GST_ONLINE_NNET3_DECODE_FASTER_H_
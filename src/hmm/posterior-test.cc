@@ -81,6 +81,72 @@ void TestPosteriorIo() {
     }
   }
 }
+
+void TestPosteriorCsr() {
+  int32 num_frames = RandInt(0, 20);
+  Posterior post(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 s = RandInt(0, 3);
+    for (int32 j = 0; j < s; j++)
+      post[t].push_back(std::pair<int32,BaseFloat>(
+          RandInt(0, 10), RandUniform()));
+  }
+  PosteriorCsr post_csr(post);
+  KALDI_ASSERT(post_csr.NumFrames() == num_frames);
+  Posterior post2;
+  post_csr.CopyToPosterior(&post2);
+  KALDI_ASSERT(post == post2);
+  KALDI_ASSERT(ApproxEqual(post_csr.Sum(), TotalPosterior(post)));
+
+  // The two types read each other's output.
+  bool binary = (RandInt(0, 1) == 0);
+  {
+    std::ostringstream os;
+    WritePosterior(os, binary, post);
+    std::istringstream is(os.str());
+    PosteriorCsr post_csr2;
+    post_csr2.Read(is, binary);
+    KALDI_ASSERT(post_csr2.NumFrames() == num_frames);
+    if (binary)
+      KALDI_ASSERT(post_csr2 == post_csr);
+    std::ostringstream os2;
+    post_csr2.Write(os2, binary);
+    if (binary)
+      KALDI_ASSERT(os2.str() == os.str());
+    std::istringstream is2(os2.str());
+    ReadPosterior(is2, binary, &post2);
+    KALDI_ASSERT(post2.size() == post.size());
+  }
+
+  // Frame selection and concatenation.
+  typedef std::vector<std::pair<int32, BaseFloat> > Frame;
+  std::vector<int32> indexes;
+  for (int32 i = 0; i < num_frames; i++)
+    if (RandInt(0, 1) == 0) indexes.push_back(RandInt(0, num_frames - 1));
+  PosteriorCsr selected;
+  selected.CopyRows(post_csr, indexes);
+  KALDI_ASSERT(selected.NumFrames() == indexes.size());
+  for (size_t i = 0; i < indexes.size(); i++)
+    KALDI_ASSERT(Frame(selected.FrameBegin(i), selected.FrameEnd(i)) ==
+                 post[indexes[i]]);
+
+  int32 start = RandInt(0, num_frames), length = RandInt(0, num_frames - start);
+  PosteriorCsr range, appended(post_csr);
+  range.CopyRange(post_csr, start, length);
+  appended.Append(range);
+  KALDI_ASSERT(appended.NumFrames() == num_frames + length);
+  for (int32 t = 0; t < length; t++)
+    KALDI_ASSERT(Frame(appended.FrameBegin(num_frames + t),
+                       appended.FrameEnd(num_frames + t)) == post[start + t]);
+  appended.Truncate(num_frames);
+  KALDI_ASSERT(appended == post_csr);
+
+  Matrix<BaseFloat> mat, mat_csr;
+  PosteriorToMatrix(post, 11, &mat);
+  PosteriorToMatrix(post_csr, 11, &mat_csr);
+  KALDI_ASSERT(mat.ApproxEqual(mat_csr, 0.0));
+}
+
 }
 
 int main() {
@@ -88,6 +154,7 @@ int main() {
   for (int i = 0; i < 10; i++) {
     kaldi::TestVectorToPosteriorEntry();
     kaldi::TestPosteriorIo();
+    kaldi::TestPosteriorCsr();
   }
   std::cout << "Test OK.\n";
 }
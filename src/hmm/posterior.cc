@@ -153,6 +153,205 @@ bool PosteriorHolder::Read(std::istream &is) {
   }
 }
 
+void PosteriorCsr::Clear() {
+  frame_offsets_.resize(1);
+  frame_offsets_[0] = 0;
+  entries_.clear();
+}
+
+void PosteriorCsr::Reserve(int32 num_frames, int32 num_entries) {
+  frame_offsets_.reserve(num_frames + 1);
+  entries_.reserve(num_entries);
+}
+
+void PosteriorCsr::AddFrame(const Entry *begin, const Entry *end) {
+  entries_.insert(entries_.end(), begin, end);
+  frame_offsets_.push_back(entries_.size());
+}
+
+void PosteriorCsr::Append(const PosteriorCsr &other) {
+  KALDI_ASSERT(&other != this);
+  int32 offset = entries_.size();
+  entries_.insert(entries_.end(), other.entries_.begin(),
+                  other.entries_.end());
+  frame_offsets_.reserve(frame_offsets_.size() + other.NumFrames());
+  for (size_t t = 1; t < other.frame_offsets_.size(); t++)
+    frame_offsets_.push_back(offset + other.frame_offsets_[t]);
+}
+
+void PosteriorCsr::Truncate(int32 num_frames) {
+  KALDI_ASSERT(num_frames >= 0 && num_frames <= NumFrames());
+  frame_offsets_.resize(num_frames + 1);
+  entries_.resize(frame_offsets_.back());
+}
+
+void PosteriorCsr::CopyRows(const PosteriorCsr &src,
+                            const std::vector<int32> &indexes) {
+  KALDI_ASSERT(&src != this);
+  int32 num_frames = indexes.size(), num_entries = 0;
+  for (int32 i = 0; i < num_frames; i++)
+    num_entries += src.NumEntries(indexes[i]);
+  Clear();
+  Reserve(num_frames, num_entries);
+  for (int32 i = 0; i < num_frames; i++)
+    AddFrame(src.FrameBegin(indexes[i]), src.FrameEnd(indexes[i]));
+}
+
+void PosteriorCsr::CopyRange(const PosteriorCsr &src,
+                             int32 start_frame, int32 num_frames) {
+  KALDI_ASSERT(&src != this && start_frame >= 0 && num_frames >= 0 &&
+               start_frame + num_frames <= src.NumFrames());
+  int32 offset = src.frame_offsets_[start_frame];
+  frame_offsets_.resize(num_frames + 1);
+  for (int32 t = 0; t <= num_frames; t++)
+    frame_offsets_[t] = src.frame_offsets_[start_frame + t] - offset;
+  entries_.assign(src.entries_.begin() + offset,
+                  src.entries_.begin() + offset + frame_offsets_.back());
+}
+
+void PosteriorCsr::CopyFromPosterior(const Posterior &post) {
+  int32 num_frames = post.size(), num_entries = 0;
+  for (int32 t = 0; t < num_frames; t++)
+    num_entries += post[t].size();
+  Clear();
+  Reserve(num_frames, num_entries);
+  for (int32 t = 0; t < num_frames; t++)
+    AddFrame(post[t]);
+}
+
+void PosteriorCsr::CopyToPosterior(Posterior *post) const {
+  int32 num_frames = NumFrames();
+  post->resize(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    (*post)[t].assign(FrameBegin(t), FrameEnd(t));
+}
+
+void PosteriorCsr::Scale(BaseFloat scale) {
+  for (std::vector<Entry>::iterator iter = entries_.begin();
+       iter != entries_.end(); ++iter)
+    iter->second *= scale;
+}
+
+BaseFloat PosteriorCsr::Sum() const {
+  double sum = 0.0;
+  for (std::vector<Entry>::const_iterator iter = entries_.begin();
+       iter != entries_.end(); ++iter)
+    sum += iter->second;
+  return sum;
+}
+
+void PosteriorCsr::Write(std::ostream &os, bool binary) const {
+  int32 num_frames = NumFrames();
+  if (binary) {
+    WriteBasicType(os, binary, num_frames);
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 sz2 = NumEntries(t);
+      WriteBasicType(os, binary, sz2);
+      for (const Entry *iter = FrameBegin(t); iter != FrameEnd(t); ++iter) {
+        WriteBasicType(os, binary, iter->first);
+        WriteBasicType(os, binary, iter->second);
+      }
+    }
+  } else {  // the same format as WritePosterior().
+    for (int32 t = 0; t < num_frames; t++) {
+      os << "[ ";
+      for (const Entry *iter = FrameBegin(t); iter != FrameEnd(t); ++iter)
+        os << iter->first << ' ' << iter->second << ' ';
+      os << "] ";
+    }
+    os << '\n';
+  }
+  if (!os.good())
+    KALDI_ERR << "Output stream error writing Posterior.";
+}
+
+void PosteriorCsr::Read(std::istream &is, bool binary) {
+  Clear();
+  if (binary) {
+    int32 sz;
+    ReadBasicType(is, true, &sz);
+    if (sz < 0 || sz > 10000000)
+      KALDI_ERR << "Reading posterior: got negative or improbably large size"
+                << sz;
+    frame_offsets_.reserve(sz + 1);
+    for (int32 t = 0; t < sz; t++) {
+      int32 sz2;
+      ReadBasicType(is, true, &sz2);
+      if (sz2 < 0)
+        KALDI_ERR << "Reading posteriors: got negative size";
+      size_t offset = entries_.size();
+      entries_.resize(offset + sz2);
+      for (int32 i = 0; i < sz2; i++) {
+        ReadBasicType(is, true, &(entries_[offset + i].first));
+        ReadBasicType(is, true, &(entries_[offset + i].second));
+      }
+      frame_offsets_.push_back(entries_.size());
+    }
+  } else {
+    std::string line;
+    getline(is, line);  // The Posterior is terminated by a newline.
+    if (is.fail())
+      KALDI_ERR << "holder of Posterior: error reading line " << (is.eof() ? "[eof]" : "");
+    std::istringstream line_is(line);
+    while (1) {
+      std::string str;
+      line_is >> std::ws;
+      if (line_is.eof()) break;
+      line_is >> str;
+      if (str != "[") {
+        int32 str_int;
+        KALDI_ERR << "Reading Posterior object: expecting [, got '" << str
+                  << (ConvertStringToInteger(str, &str_int) ?
+                      "': did you provide alignments instead of posteriors?" :
+                      "'.");
+      }
+      while (1) {
+        line_is >> std::ws;
+        if (line_is.peek() == ']') {
+          line_is.get();
+          break;
+        }
+        int32 i; BaseFloat p;
+        line_is >> i >> p;
+        if (line_is.fail())
+          KALDI_ERR << "Error reading Posterior object (could not get data after \"[\");";
+        entries_.push_back(std::make_pair(i, p));
+      }
+      frame_offsets_.push_back(entries_.size());
+    }
+  }
+}
+
+// static
+bool PosteriorCsrHolder::Write(std::ostream &os, bool binary, const T &t) {
+  InitKaldiOutputStream(os, binary);  // Puts binary header if binary mode.
+  try {
+    t.Write(os, binary);
+    return true;
+  } catch(const std::exception &e) {
+    KALDI_WARN << "Exception caught writing table of posteriors. " << e.what();
+    return false;  // Write failure.
+  }
+}
+
+bool PosteriorCsrHolder::Read(std::istream &is) {
+  t_.Clear();
+
+  bool is_binary;
+  if (!InitKaldiInputStream(is, &is_binary)) {
+    KALDI_WARN << "Reading Table object, failed reading binary header";
+    return false;
+  }
+  try {
+    t_.Read(is, is_binary);
+    return true;
+  } catch (std::exception &e) {
+    KALDI_WARN << "Exception caught reading table of posteriors. " << e.what();
+    t_.Clear();
+    return false;
+  }
+}
+
 // static
 bool GaussPostHolder::Write(std::ostream &os, bool binary, const T &t) {
   InitKaldiOutputStream(os, binary);  // Puts binary header if binary mode.
@@ -298,6 +497,16 @@ void AlignmentToPosterior(const std::vector<int32> &ali,
   }
 }
 
+void AlignmentToPosterior(const std::vector<int32> &ali,
+                          PosteriorCsr *post) {
+  post->Clear();
+  post->Reserve(ali.size(), ali.size());
+  for (size_t i = 0; i < ali.size(); i++) {
+    PosteriorCsr::Entry entry(ali[i], 1.0);
+    post->AddFrame(&entry, &entry + 1);
+  }
+}
+
 struct ComparePosteriorByPdfs {
   const TransitionModel *tmodel_;
   ComparePosteriorByPdfs(const TransitionModel &tmodel): tmodel_(&tmodel) {}
@@ -535,6 +744,33 @@ template void PosteriorToMatrix<double>(const Posterior &post,
                                         Matrix<double> *mat);
 
 
+template <typename Real>
+void PosteriorToMatrix(const PosteriorCsr &post,
+                       const int32 post_dim, Matrix<Real> *mat) {
+  int32 num_rows = post.NumFrames();
+  mat->Resize(num_rows, post_dim, kSetZero);  // zero-filled
+  for (int32 t = 0; t < num_rows; t++) {
+    Real *row_data = mat->RowData(t);
+    for (const PosteriorCsr::Entry *iter = post.FrameBegin(t);
+         iter != post.FrameEnd(t); ++iter) {
+      int32 col = iter->first;
+      if (col >= post_dim) {
+        KALDI_ERR << "Out-of-bound Posterior element with index " << col
+                  << ", higher than number of columns " << post_dim;
+      }
+      row_data[col] = iter->second;
+    }
+  }
+}
+// instantiate the template function,
+template void PosteriorToMatrix<float>(const PosteriorCsr &post,
+                                       const int32 post_dim,
+                                       Matrix<float> *mat);
+template void PosteriorToMatrix<double>(const PosteriorCsr &post,
+                                        const int32 post_dim,
+                                        Matrix<double> *mat);
+
+
 template <typename Real>
 void PosteriorToPdfMatrix(const Posterior &post,
                           const TransitionModel &model,
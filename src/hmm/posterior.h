@@ -95,6 +95,136 @@ void WritePosterior(std::ostream &os, bool binary, const Posterior &post);
 void ReadPosterior(std::istream &os, bool binary, Posterior *post);
 
 
+/**
+   PosteriorCsr holds the same thing as a Posterior, but in compressed-sparse-
+   row form: the (index, weight) pairs of all frames are in one array, and
+   frame t has the entries FrameBegin(t) ... FrameEnd(t) - 1.  So reading one
+   costs two allocations instead of one per frame, and the entries of
+   consecutive frames are next to each other in memory.  Its on-disk format is
+   the same as that of Posterior, so archives can be read as either type.
+*/
+class PosteriorCsr {
+ public:
+  typedef std::pair<int32, BaseFloat> Entry;
+
+  PosteriorCsr(): frame_offsets_(1, 0) { }
+
+  explicit PosteriorCsr(const Posterior &post) { CopyFromPosterior(post); }
+
+  int32 NumFrames() const { return frame_offsets_.size() - 1; }
+
+  /// The total number of entries over all frames.
+  int32 NumEntries() const { return entries_.size(); }
+
+  /// The number of entries of frame t.
+  int32 NumEntries(int32 t) const {
+    return frame_offsets_[t + 1] - frame_offsets_[t];
+  }
+
+  const Entry *FrameBegin(int32 t) const {
+    return entries_.data() + frame_offsets_[t];
+  }
+  const Entry *FrameEnd(int32 t) const {
+    return entries_.data() + frame_offsets_[t + 1];
+  }
+  Entry *FrameBegin(int32 t) { return entries_.data() + frame_offsets_[t]; }
+  Entry *FrameEnd(int32 t) { return entries_.data() + frame_offsets_[t + 1]; }
+
+  /// Removes all frames.
+  void Clear();
+
+  /// Reserves space for this many frames and entries in total.
+  void Reserve(int32 num_frames, int32 num_entries);
+
+  /// Adds a frame at the end, with the entries begin ... end - 1.
+  void AddFrame(const Entry *begin, const Entry *end);
+
+  /// Adds a frame at the end.
+  void AddFrame(const std::vector<Entry> &entries) {
+    AddFrame(entries.data(), entries.data() + entries.size());
+  }
+
+  /// Adds the frames of 'other' at the end.
+  void Append(const PosteriorCsr &other);
+
+  /// Keeps only the first num_frames frames; num_frames <= NumFrames().
+  void Truncate(int32 num_frames);
+
+  /// Sets *this to the frames indexes[0], indexes[1], ... of 'src', which
+  /// must not be *this.
+  void CopyRows(const PosteriorCsr &src, const std::vector<int32> &indexes);
+
+  /// Sets *this to the num_frames frames of 'src' starting at start_frame.
+  void CopyRange(const PosteriorCsr &src, int32 start_frame, int32 num_frames);
+
+  void CopyFromPosterior(const Posterior &post);
+
+  void CopyToPosterior(Posterior *post) const;
+
+  /// Scales all the weights.
+  void Scale(BaseFloat scale);
+
+  /// Returns the total of all the weights.
+  BaseFloat Sum() const;
+
+  void Swap(PosteriorCsr *other) {
+    frame_offsets_.swap(other->frame_offsets_);
+    entries_.swap(other->entries_);
+  }
+
+  bool operator == (const PosteriorCsr &other) const {
+    return frame_offsets_ == other.frame_offsets_ && entries_ == other.entries_;
+  }
+
+  /// Writes in the format of WritePosterior().
+  void Write(std::ostream &os, bool binary) const;
+
+  /// Reads the format of WritePosterior().
+  void Read(std::istream &is, bool binary);
+
+ private:
+  // frame_offsets_[t] is the position in entries_ of the first entry of frame
+  // t; it has NumFrames() + 1 elements, the last one being entries_.size().
+  std::vector<int32> frame_offsets_;
+  std::vector<Entry> entries_;
+};
+
+
+// PosteriorCsrHolder is a holder for PosteriorCsr; it reads and writes the
+// same format as PosteriorHolder.
+class PosteriorCsrHolder {
+ public:
+  typedef PosteriorCsr T;
+
+  PosteriorCsrHolder() { }
+
+  static bool Write(std::ostream &os, bool binary, const T &t);
+
+  void Clear() { PosteriorCsr tmp; t_.Swap(&tmp); }
+
+  // Reads into the holder.
+  bool Read(std::istream &is);
+
+  // Kaldi objects always have the stream open in binary mode for
+  // reading.
+  static bool IsReadInBinary() { return true; }
+
+  T &Value() { return t_; }
+
+  void Swap(PosteriorCsrHolder *other) {
+    t_.Swap(&(other->t_));
+  }
+
+  bool ExtractRange(const PosteriorCsrHolder &other, const std::string &range) {
+    KALDI_ERR << "ExtractRange is not defined for this type of holder.";
+    return false;
+  }
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(PosteriorCsrHolder);
+  T t_;
+};
+
+
 // GaussPostHolder is a holder for GaussPost, which is
 // std::vector<std::vector<std::pair<int32, Vector<BaseFloat> > > >
 // This is used for storing posteriors of transition id's for an
@@ -139,6 +269,10 @@ typedef TableWriter<PosteriorHolder> PosteriorWriter;
 typedef SequentialTableReader<PosteriorHolder> SequentialPosteriorReader;
 typedef RandomAccessTableReader<PosteriorHolder> RandomAccessPosteriorReader;
 
+typedef TableWriter<PosteriorCsrHolder> PosteriorCsrWriter;
+typedef SequentialTableReader<PosteriorCsrHolder> SequentialPosteriorCsrReader;
+typedef RandomAccessTableReader<PosteriorCsrHolder> RandomAccessPosteriorCsrReader;
+
 
 // typedef std::vector<std::vector<std::pair<int32, Vector<BaseFloat> > > > GaussPost;
 typedef TableWriter<GaussPostHolder> GaussPostWriter;
@@ -203,6 +337,10 @@ BaseFloat VectorToPosteriorEntry(
 void AlignmentToPosterior(const std::vector<int32> &ali,
                           Posterior *post);
 
+/// As AlignmentToPosterior() above, but outputs a PosteriorCsr.
+void AlignmentToPosterior(const std::vector<int32> &ali,
+                          PosteriorCsr *post);
+
 /// Sorts posterior entries so that transition-ids with same pdf-id are next to
 /// each other.
 void SortPosteriorByPdfs(const TransitionModel &tmodel,
@@ -248,6 +386,11 @@ template <typename Real>
 void PosteriorToMatrix(const Posterior &post,
                        const int32 post_dim, Matrix<Real> *mat);
 
+/// As PosteriorToMatrix() above, for a PosteriorCsr.
+template <typename Real>
+void PosteriorToMatrix(const PosteriorCsr &post,
+                       const int32 post_dim, Matrix<Real> *mat);
+
 /// This converts a Posterior to a Matrix. The number of matrix-rows is the same
 /// as the 'post.size()', the number of matrix-columns is defined by 'NumPdfs'
 /// in the TransitionModel.
@@ -46,11 +46,62 @@ void TestTransitionModel() {
   delete trans_model;
 }
 
+void TestTransitionIdLookups() {
+  TransitionModel *trans_model = GenRandTransitionModel(NULL);
+  const HmmTopology &topo = trans_model->GetTopo();
+  std::vector<int32> trans_ids;
+  for (int32 tid = 1; tid <= trans_model->NumTransitionIds(); tid++) {
+    int32 tstate = trans_model->TransitionIdToTransitionState(tid),
+        tindex = trans_model->TransitionIdToTransitionIndex(tid),
+        phone = trans_model->TransitionStateToPhone(tstate),
+        hmm_state = trans_model->TransitionStateToHmmState(tstate);
+    bool self_loop =
+        (topo.TopologyForPhone(phone)[hmm_state].transitions[tindex].first ==
+         hmm_state);
+    KALDI_ASSERT(trans_model->TransitionIdToPhone(tid) == phone);
+    KALDI_ASSERT(trans_model->TransitionIdToHmmState(tid) == hmm_state);
+    KALDI_ASSERT(trans_model->IsSelfLoop(tid) == self_loop);
+    KALDI_ASSERT(trans_model->TransitionIdToPdf(tid) ==
+                 (self_loop ? trans_model->TransitionStateToSelfLoopPdf(tstate) :
+                  trans_model->TransitionStateToForwardPdf(tstate)));
+    for (int32 i = RandInt(0, 2); i > 0; i--)
+      trans_ids.push_back(tid);
+  }
+  std::random_shuffle(trans_ids.begin(), trans_ids.end());
+
+  std::vector<int32> pdfs, phones, hmm_states = trans_ids;
+  trans_model->TransitionIdsToPdfs(trans_ids, &pdfs);
+  trans_model->TransitionIdsToPhones(trans_ids, &phones);
+  trans_model->TransitionIdsToHmmStates(hmm_states, &hmm_states);  // in place.
+  KALDI_ASSERT(pdfs.size() == trans_ids.size() &&
+               phones.size() == trans_ids.size() &&
+               hmm_states.size() == trans_ids.size());
+  for (size_t i = 0; i < trans_ids.size(); i++) {
+    KALDI_ASSERT(pdfs[i] == trans_model->TransitionIdToPdf(trans_ids[i]));
+    KALDI_ASSERT(phones[i] == trans_model->TransitionIdToPhone(trans_ids[i]));
+    KALDI_ASSERT(hmm_states[i] ==
+                 trans_model->TransitionIdToHmmState(trans_ids[i]));
+  }
+
+  // Out-of-range transition-ids should throw.
+  std::vector<int32> bad(1, trans_model->NumTransitionIds() + 1);
+  bool threw = false;
+  try {
+    trans_model->TransitionIdsToPdfs(bad, &pdfs);
+  } catch (const std::runtime_error &e) {
+    threw = true;
+  }
+  KALDI_ASSERT(threw);
+  delete trans_model;
+}
+
 }
 
 int main() {
-  for (int i = 0; i < 2; i++)
+  for (int i = 0; i < 2; i++) {
     kaldi::TestTransitionModel();
+    kaldi::TestTransitionIdLookups();
+  }
   KALDI_LOG << "Test OK.\n";
 }
 
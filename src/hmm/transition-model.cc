@@ -166,13 +166,28 @@ void TransitionModel::ComputeDerived() {
 
   id2state_.resize(cur_transition_id);   // cur_transition_id is #transition-ids+1.
   id2pdf_id_.resize(cur_transition_id);
+  // Element zero of these is not a valid transition-id; it is only there so
+  // IsSelfLoop(0) returns false, as before.
+  id2phone_.assign(cur_transition_id, 0);
+  id2hmm_state_.assign(cur_transition_id, 0);
+  id2self_loop_.assign(cur_transition_id, 0);
   for (int32 tstate = 1; tstate <= static_cast<int32>(tuples_.size()); tstate++) {
+    const Tuple &tuple = tuples_[tstate-1];
+    const HmmTopology::TopologyEntry &entry =
+        topo_.TopologyForPhone(tuple.phone);
+    KALDI_ASSERT(static_cast<size_t>(tuple.hmm_state) < entry.size());
+    const HmmTopology::HmmState &state = entry[tuple.hmm_state];
     for (int32 tid = state2id_[tstate]; tid < state2id_[tstate+1]; tid++) {
+      int32 trans_index = tid - state2id_[tstate];
+      bool self_loop = (state.transitions[trans_index].first == tuple.hmm_state);
       id2state_[tid] = tstate;
-      if (IsSelfLoop(tid))
-        id2pdf_id_[tid] = tuples_[tstate-1].self_loop_pdf;
+      id2phone_[tid] = tuple.phone;
+      id2hmm_state_[tid] = tuple.hmm_state;
+      id2self_loop_[tid] = (self_loop ? 1 : 0);
+      if (self_loop)
+        id2pdf_id_[tid] = tuple.self_loop_pdf;
       else
-        id2pdf_id_[tid] = tuples_[tstate-1].forward_pdf;
+        id2pdf_id_[tid] = tuple.forward_pdf;
     }
   }
 
@@ -782,12 +797,6 @@ void TransitionModel::MapUpdateShared(const Vector<double> &stats,
 }
 
 
-int32 TransitionModel::TransitionIdToPhone(int32 trans_id) const {
-  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  return tuples_[trans_state-1].phone;
-}
-
 int32 TransitionModel::TransitionIdToPdfClass(int32 trans_id) const {
   KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2state_.size());
   int32 trans_state = id2state_[trans_id];
@@ -802,11 +811,42 @@ int32 TransitionModel::TransitionIdToPdfClass(int32 trans_id) const {
 }
 
 
-int32 TransitionModel::TransitionIdToHmmState(int32 trans_id) const {
-  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  const Tuple &t = tuples_[trans_state-1];
-  return t.hmm_state;
+// Applies "table" (indexed by transition-id) to each element of "trans_ids".
+static void MapTransitionIds(const std::vector<int32> &table,
+                             const std::vector<int32> &trans_ids,
+                             std::vector<int32> *out) {
+  KALDI_ASSERT(out != NULL);
+  size_t size = trans_ids.size();
+  out->resize(size);
+  if (size == 0) return;
+  // The unsigned comparison also catches negative transition-ids; index zero
+  // is excluded because it is not a transition-id.
+  uint32 max_id = table.size() - 1;
+  const int32 *in_data = &(trans_ids[0]), *table_data = &(table[0]);
+  int32 *out_data = &((*out)[0]);
+  for (size_t i = 0; i < size; i++) {
+    int32 tid = in_data[i];
+    if (static_cast<uint32>(tid) - 1 >= max_id)
+      KALDI_ERR << "Transition-id " << tid << " is out of range "
+                << "(likely alignment/model mismatch).";
+    out_data[i] = table_data[tid];
+  }
+}
+
+void TransitionModel::TransitionIdsToPdfs(const std::vector<int32> &trans_ids,
+                                          std::vector<int32> *pdfs) const {
+  MapTransitionIds(id2pdf_id_, trans_ids, pdfs);
+}
+
+void TransitionModel::TransitionIdsToPhones(const std::vector<int32> &trans_ids,
+                                            std::vector<int32> *phones) const {
+  MapTransitionIds(id2phone_, trans_ids, phones);
+}
+
+void TransitionModel::TransitionIdsToHmmStates(
+    const std::vector<int32> &trans_ids,
+    std::vector<int32> *hmm_states) const {
+  MapTransitionIds(id2hmm_state_, trans_ids, hmm_states);
 }
 
 void TransitionModel::Print(std::ostream &os,
@@ -909,16 +949,4 @@ bool TransitionModel::Compatible(const TransitionModel &other) const {
           && num_pdfs_ == other.num_pdfs_);
 }
 
-bool TransitionModel::IsSelfLoop(int32 trans_id) const {
-  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  int32 trans_index = trans_id - state2id_[trans_state];
-  const Tuple &tuple = tuples_[trans_state-1];
-  int32 phone = tuple.phone, hmm_state = tuple.hmm_state;
-  const HmmTopology::TopologyEntry &entry = topo_.TopologyForPhone(phone);
-  KALDI_ASSERT(static_cast<size_t>(hmm_state) < entry.size());
-  return (static_cast<size_t>(trans_index) < entry[hmm_state].transitions.size()
-          && entry[hmm_state].transitions[trans_index].first == hmm_state);
-}
-
 } // End namespace kaldi
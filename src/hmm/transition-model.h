@@ -161,15 +161,26 @@ class TransitionModel {
   // (unless we're in paranoid mode).
   inline int32 TransitionIdToPdfFast(int32 trans_id) const;
 
-  int32 TransitionIdToPhone(int32 trans_id) const;
+  inline int32 TransitionIdToPhone(int32 trans_id) const;
   int32 TransitionIdToPdfClass(int32 trans_id) const;
-  int32 TransitionIdToHmmState(int32 trans_id) const;
+  inline int32 TransitionIdToHmmState(int32 trans_id) const;
+
+  /// These convert a whole sequence of transition-ids (e.g. an alignment) at
+  /// once, using the same tables as the functions above; "trans_ids" and the
+  /// output may be the same vector.  They throw if any transition-id is out of
+  /// range.
+  void TransitionIdsToPdfs(const std::vector<int32> &trans_ids,
+                           std::vector<int32> *pdfs) const;
+  void TransitionIdsToPhones(const std::vector<int32> &trans_ids,
+                             std::vector<int32> *phones) const;
+  void TransitionIdsToHmmStates(const std::vector<int32> &trans_ids,
+                                std::vector<int32> *hmm_states) const;
 
   /// @}
 
   bool IsFinal(int32 trans_id) const;  // returns true if this trans_id goes to the final state
   // (which is bound to be nonemitting).
-  bool IsSelfLoop(int32 trans_id) const;  // return true if this trans_id corresponds to a self-loop.
+  inline bool IsSelfLoop(int32 trans_id) const;  // return true if this trans_id corresponds to a self-loop.
 
   /// Returns the total number of transition-ids (note, these are one-based).
   inline int32 NumTransitionIds() const { return id2state_.size()-1; }
@@ -261,7 +272,8 @@ class TransitionModel {
   void ComputeTuples(const ContextDependencyInterface &ctx_dep);  // called from constructor.  initializes tuples_.
   void ComputeTuplesIsHmm(const ContextDependencyInterface &ctx_dep);
   void ComputeTuplesNotHmm(const ContextDependencyInterface &ctx_dep);
-  void ComputeDerived();  // called from constructor and Read function: computes state2id_ and id2state_.
+  void ComputeDerived();  // called from constructor and Read function: computes state2id_, id2state_
+  // and the other id2*_ tables.
   void ComputeDerivedOfProbs();  // computes quantities derived from log-probs (currently just
   // non_self_loop_log_probs_; called whenever log-probs change.
   void InitializeProbs();  // called from constructor.
@@ -309,6 +321,13 @@ class TransitionModel {
 
   std::vector<int32> id2pdf_id_;
 
+  /// For each transition-id, the phone, the HMM-state and whether it is a
+  /// self-loop (indexed by transition-id; these are derived from id2state_ and
+  /// tuples_ so the per-frame lookups are a single array access).
+  std::vector<int32> id2phone_;
+  std::vector<int32> id2hmm_state_;
+  std::vector<char> id2self_loop_;
+
   /// For each transition-id, the corresponding log-prob.  Indexed by transition-id.
   Vector<BaseFloat> log_probs_;
 
@@ -344,6 +363,21 @@ inline int32 TransitionModel::TransitionIdToPdfFast(int32 trans_id) const {
   return id2pdf_id_[trans_id];
 }
 
+inline int32 TransitionModel::TransitionIdToPhone(int32 trans_id) const {
+  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2phone_.size());
+  return id2phone_[trans_id];
+}
+
+inline int32 TransitionModel::TransitionIdToHmmState(int32 trans_id) const {
+  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2hmm_state_.size());
+  return id2hmm_state_[trans_id];
+}
+
+inline bool TransitionModel::IsSelfLoop(int32 trans_id) const {
+  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2self_loop_.size());
+  return id2self_loop_[trans_id];
+}
+
 /// Works out which pdfs might correspond to the given phones.  Will return true
 /// if these pdfs correspond *just* to these phones, false if these pdfs are also
 /// used by other phones.
@@ -59,8 +59,7 @@ int main(int argc, char *argv[]) {
       std::string key = reader.Key();
       std::vector<int32> alignment = reader.Value();
 
-      for (size_t i = 0; i < alignment.size(); i++)
-        alignment[i] = trans_model.TransitionIdToHmmState(alignment[i]);
+      trans_model.TransitionIdsToHmmStates(alignment, &alignment);
 
       writer.Write(key, alignment);
       num_done++;
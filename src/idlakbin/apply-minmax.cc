@@ -19,6 +19,39 @@
 #include "util/common-utils.h"
 #include "matrix/kaldi-matrix.h"
 #include "idlakfeat/minmax.h"
+#include "idlakfeat/utterance-sequencer.h"
+
+namespace kaldi {
+
+// Normalises one utterance, written in the order read
+class MinmaxTask {
+ public:
+  MinmaxTask(const std::string &utt, const MatrixBase<BaseFloat> &feat,
+             const MatrixBase<double> &cmvn_stats, bool norm_vars,
+             BaseFloatMatrixWriter *feat_writer, int32 *num_done)
+      : utt_(utt), feat_(feat), cmvn_stats_(cmvn_stats),
+        norm_vars_(norm_vars), feat_writer_(feat_writer),
+        num_done_(num_done) { }
+
+  void Compute() {
+    ApplyMinmax(cmvn_stats_, norm_vars_, &feat_);
+  }
+
+  void Output() {
+    feat_writer_->Write(utt_, feat_);
+    (*num_done_)++;
+  }
+
+ private:
+  std::string utt_;
+  Matrix<BaseFloat> feat_;
+  Matrix<double> cmvn_stats_;
+  bool norm_vars_;
+  BaseFloatMatrixWriter *feat_writer_;
+  int32 *num_done_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -33,8 +66,10 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     std::string utt2spk_rspecifier;
     bool norm_vars = false;
+    TaskSequencerConfig sequencer_config;
     po.Register("utt2spk", &utt2spk_rspecifier, "rspecifier for utterance to speaker map");
     po.Register("norm-vars", &norm_vars, "If true, normalize variances");
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -51,6 +86,7 @@ int main(int argc, char *argv[]) {
 
     SequentialBaseFloatMatrixReader feat_reader(feat_rspecifier);
     BaseFloatMatrixWriter feat_writer(feat_wspecifier);
+    UtteranceSequencer<MinmaxTask> sequencer(sequencer_config);
     
     if (ClassifyRspecifier(cmvn_rspecifier_or_rxfilename, NULL, NULL)
         != kNoRspecifier) { // reading from a Table: per-speaker or per-utt CMN/CVN.
@@ -61,7 +97,6 @@ int main(int argc, char *argv[]) {
 
       for (;!feat_reader.Done(); feat_reader.Next()) {
         std::string utt = feat_reader.Key();
-        Matrix<BaseFloat> feat(feat_reader.Value());
 
         if (!cmvn_reader.HasKey(utt)) {
           KALDI_WARN << "No normalization statistics available for key "
@@ -71,10 +106,8 @@ int main(int argc, char *argv[]) {
         }
         const Matrix<double> &cmvn_stats = cmvn_reader.Value(utt);
 
-        ApplyMinmax(cmvn_stats, norm_vars, &feat);
-
-        feat_writer.Write(utt, feat);
-        num_done++;
+        sequencer.Run(new MinmaxTask(utt, feat_reader.Value(), cmvn_stats,
+                                     norm_vars, &feat_writer, &num_done));
       }
     } else {
       if (utt2spk_rspecifier != "")
@@ -88,12 +121,11 @@ int main(int argc, char *argv[]) {
       
       for (;!feat_reader.Done(); feat_reader.Next()) {
         std::string utt = feat_reader.Key();
-        Matrix<BaseFloat> feat(feat_reader.Value());
-        ApplyMinmax(cmvn_stats, norm_vars, &feat);
-        feat_writer.Write(utt, feat);
-        num_done++;
+        sequencer.Run(new MinmaxTask(utt, feat_reader.Value(), cmvn_stats,
+                                     norm_vars, &feat_writer, &num_done));
       }
     }
+    sequencer.Wait();
     if (norm_vars) 
       KALDI_LOG << "Applied minmax transform to "
                 << num_done << " utterances, errors on " << num_err;
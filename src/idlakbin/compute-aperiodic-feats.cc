@@ -18,8 +18,65 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "idlakfeat/feature-aperiodic.h"
+#include "idlakfeat/minmax.h"
+#include "idlakfeat/utterance-sequencer.h"
 #include "feat/wave-reader.h"
 
+namespace kaldi {
+
+// Aperiodic energy of one utterance, written in the order read
+class AperiodicTask {
+ public:
+  AperiodicTask(const AperiodicEnergy &ap_energy, const std::string &utt,
+                const VectorBase<BaseFloat> &waveform,
+                const VectorBase<BaseFloat> &pov,
+                const VectorBase<BaseFloat> &f0,
+                BaseFloatMatrixWriter *feat_writer,
+                MinmaxStatsAccumulator *minmax_stats,
+                int32 *num_done, int32 *num_err)
+      : ap_energy_(ap_energy), utt_(utt), waveform_(waveform), pov_(pov),
+        f0_(f0), ok_(false), feat_writer_(feat_writer),
+        minmax_stats_(minmax_stats), num_done_(num_done), num_err_(num_err) { }
+
+  void Compute() {
+    try {
+      ap_energy_.Compute(waveform_, pov_, f0_, &features_);
+      ok_ = true;
+    } catch(...) {
+      ok_ = false;
+    }
+  }
+
+  void Output() {
+    if (!ok_) {
+      KALDI_WARN << "Failed to compute bndap for utterance "
+                 << utt_;
+      (*num_err_)++;
+      return;
+    }
+    feat_writer_->Write(utt_, features_);
+    if (minmax_stats_ != NULL) minmax_stats_->Accumulate(features_);
+    if (*num_done_ % 50 == 0 && *num_done_ != 0)
+      KALDI_VLOG(2) << "Processed " << *num_done_ << " utterances";
+    (*num_done_)++;
+  }
+
+ private:
+  const AperiodicEnergy &ap_energy_;
+  std::string utt_;
+  Vector<BaseFloat> waveform_;
+  Vector<BaseFloat> pov_;
+  Vector<BaseFloat> f0_;
+  Matrix<BaseFloat> features_;
+  bool ok_;
+  BaseFloatMatrixWriter *feat_writer_;
+  MinmaxStatsAccumulator *minmax_stats_;
+  int32 *num_done_;
+  int32 *num_err_;
+};
+
+}  // namespace kaldi
+
 
 int main(int argc, char *argv[]) {
   try {
@@ -32,17 +89,28 @@ int main(int argc, char *argv[]) {
         "spectrum. The values on each band will always be negative or 0.\n"
         "Usage: compute-aperiodic-feats [options...] <wav-rspecifier> "
         "<f0-rspecifier> <feats-wspecifier>\n"
-        "e.g. compute-aperiodic-feats scp:wav.scp scp:f0.scp ark:- \n"
+        "e.g. compute-aperiodic-feats --num-threads=4 scp:wav.scp scp:f0.scp ark:- \n"
         "\n"
         "See also: compute-kaldi-pitch-feats\n";
 
     bool f0_first = false;
     ParseOptions po(usage);
     AperiodicEnergyOptions aperiodic_opts;
+    TaskSequencerConfig sequencer_config;
+    std::string minmax_wxfilename;
 
     aperiodic_opts.Register(&po);
     po.Register("pitch-first", &f0_first, "Assume first column is pitch, "
                 "second is POV, for compatibility with get_f0. ");
+    po.Register("frame-threads", &aperiodic_opts.num_threads,
+                "Number of threads the frames of each utterance are split "
+                "between, for a few long recordings");
+    po.Register("minmax-stats", &minmax_wxfilename,
+                "If set, also write the global minmax stats of the features "
+                "to this file, as compute-minmax-stats would, merge the stats "
+                "of parallel jobs with sum-minmax-stats");
+    // utterances processed at the same time
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -66,14 +134,16 @@ int main(int argc, char *argv[]) {
       f0_col = 0;
       pov_col = 1;
     }
+    // The FFT tables and bands only depend on the options
+    AperiodicEnergy ap_energy(aperiodic_opts);
+    MinmaxStatsAccumulator minmax_stats;
+    UtteranceSequencer<AperiodicTask> sequencer(sequencer_config);
     for (; !wav_reader.Done(); wav_reader.Next()) {
       // TODO(BP): check keys are matching
       std::string utt = wav_reader.Key();
       const WaveData &wave_data = wav_reader.Value();
       const Matrix<BaseFloat> &pitch_features = f0_reader.Value(utt);
 
-      AperiodicEnergy ap_energy(aperiodic_opts);
-
       // Get first channel wave data
       SubVector<BaseFloat> waveform(wave_data.Data(), 0);
       int32 num_frames = NumFrames(waveform.Dim(), aperiodic_opts.frame_opts);
@@ -92,22 +162,14 @@ int main(int argc, char *argv[]) {
         pov.Resize(num_frames, kCopyData);
       }
 
-      // Output data
-      Matrix<BaseFloat> features;
-      try {
-        ap_energy.Compute(waveform, pov, f0, &features);
-      } catch(...) {
-        KALDI_WARN << "Failed to compute bndap for utterance "
-                   << utt;
-        num_err++;
-        continue;
-      }
-
-      feat_writer.Write(utt, features);
-      if (num_done % 50 == 0 && num_done != 0)
-        KALDI_VLOG(2) << "Processed " << num_done << " utterances";
-      num_done++;
+      sequencer.Run(new AperiodicTask(ap_energy, utt, waveform, pov, f0,
+                                      &feat_writer,
+                                      minmax_wxfilename.empty() ? NULL :
+                                      &minmax_stats, &num_done, &num_err));
     }
+    sequencer.Wait();
+    if (!minmax_wxfilename.empty())
+      minmax_stats.Write(minmax_wxfilename, true);
     KALDI_LOG << "Done " << num_done << " utterances, " << num_err
               << " with errors.";
     return (num_done != 0 ? 0 : 1);
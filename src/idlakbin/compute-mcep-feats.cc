@@ -0,0 +1,149 @@
+// idlakbin/compute-mcep-feats.cc
+
+// Copyright 2026  agent
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "idlakfeat/feature-mcep.h"
+#include "idlakfeat/minmax.h"
+#include "idlakfeat/utterance-sequencer.h"
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+// Mel-cepstra of one utterance, written in the order read
+class McepTask {
+ public:
+  McepTask(const McepComputer &mcep, const std::string &utt,
+           const VectorBase<BaseFloat> &waveform,
+           BaseFloatMatrixWriter *feat_writer,
+           MinmaxStatsAccumulator *minmax_stats,
+           int32 *num_done, int32 *num_err)
+      : mcep_(mcep), utt_(utt), waveform_(waveform), ok_(false),
+        feat_writer_(feat_writer), minmax_stats_(minmax_stats),
+        num_done_(num_done), num_err_(num_err) { }
+
+  void Compute() {
+    try {
+      mcep_.Compute(waveform_, &features_);
+      ok_ = true;
+    } catch(...) {
+      ok_ = false;
+    }
+  }
+
+  void Output() {
+    if (!ok_) {
+      KALDI_WARN << "Failed to compute mcep for utterance " << utt_;
+      (*num_err_)++;
+      return;
+    }
+    feat_writer_->Write(utt_, features_);
+    if (minmax_stats_ != NULL) minmax_stats_->Accumulate(features_);
+    if (*num_done_ % 50 == 0 && *num_done_ != 0)
+      KALDI_VLOG(2) << "Processed " << *num_done_ << " utterances";
+    (*num_done_)++;
+  }
+
+ private:
+  const McepComputer &mcep_;
+  std::string utt_;
+  Vector<BaseFloat> waveform_;
+  Matrix<BaseFloat> features_;
+  bool ok_;
+  BaseFloatMatrixWriter *feat_writer_;
+  MinmaxStatsAccumulator *minmax_stats_;
+  int32 *num_done_;
+  int32 *num_err_;
+};
+
+}  // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Compute mel-cepstral features from wav input, the frequency warped\n"
+        "cepstrum of the log periodogram of each frame.\n"
+        "Usage: compute-mcep-feats [options...] <wav-rspecifier> "
+        "<feats-wspecifier>\n"
+        "e.g. compute-mcep-feats --sample-frequency=16000 --mcep-order=39 "
+        "--alpha=0.42 scp:wav.scp ark:-\n"
+        "\n"
+        "See also: compute-aperiodic-feats\n";
+
+    ParseOptions po(usage);
+    McepOptions mcep_opts;
+    TaskSequencerConfig sequencer_config;
+    std::string minmax_wxfilename;
+
+    mcep_opts.Register(&po);
+    po.Register("minmax-stats", &minmax_wxfilename,
+                "If set, also write the global minmax stats of the features "
+                "to this file, as compute-minmax-stats would, merge the stats "
+                "of parallel jobs with sum-minmax-stats");
+    // utterances processed at the same time
+    sequencer_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string wav_rspecifier = po.GetArg(1),
+        feat_wspecifier = po.GetArg(2);
+
+    SequentialTableReader<WaveHolder> wav_reader(wav_rspecifier);
+    BaseFloatMatrixWriter feat_writer(feat_wspecifier);
+
+    // Output runs on a sequencer thread, utterances skipped here are counted
+    // separately
+    int32 num_done = 0, num_err = 0, num_skipped = 0;
+    // The window and FFT tables only depend on the options
+    McepComputer mcep(mcep_opts);
+    MinmaxStatsAccumulator minmax_stats;
+    UtteranceSequencer<McepTask> sequencer(sequencer_config);
+    for (; !wav_reader.Done(); wav_reader.Next()) {
+      std::string utt = wav_reader.Key();
+      const WaveData &wave_data = wav_reader.Value();
+      if (wave_data.SampFreq() != mcep_opts.frame_opts.samp_freq) {
+        KALDI_WARN << "Sample frequency of " << utt << " is "
+                   << wave_data.SampFreq() << ", expected "
+                   << mcep_opts.frame_opts.samp_freq;
+        num_skipped++;
+        continue;
+      }
+      // Get first channel wave data
+      SubVector<BaseFloat> waveform(wave_data.Data(), 0);
+      sequencer.Run(new McepTask(mcep, utt, waveform, &feat_writer,
+                                 minmax_wxfilename.empty() ? NULL :
+                                 &minmax_stats, &num_done, &num_err));
+    }
+    sequencer.Wait();
+    if (!minmax_wxfilename.empty())
+      minmax_stats.Write(minmax_wxfilename, true);
+    num_err += num_skipped;
+    KALDI_LOG << "Done " << num_done << " utterances, " << num_err
+              << " with errors.";
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -20,31 +20,78 @@
 #include "matrix/kaldi-matrix.h"
 #include "idlakfeat/minmax.h"
 
+#include "idlakfeat/utterance-sequencer.h"
+
 namespace kaldi {
 
-bool AccMinmaxStatsWrapper(std::string utt,
-			   const MatrixBase<BaseFloat> &feats,
-			   RandomAccessBaseFloatVectorReader *weights_reader,
-			   Matrix<double> *cmvn_stats) {
+// Gets the frame weights of an utterance if weights were given, false if
+// they are missing or do not match the features
+bool GetMinmaxWeights(std::string utt,
+                      const MatrixBase<BaseFloat> &feats,
+                      RandomAccessBaseFloatVectorReader *weights_reader,
+                      Vector<BaseFloat> *weights) {
   if (!weights_reader->IsOpen()) {
-    AccMinmaxStats(feats, NULL, cmvn_stats);
+    weights->Resize(0);
     return true;
   } else {
     if (!weights_reader->HasKey(utt)) {
       KALDI_WARN << "No weights available for utterance " << utt;
       return false;
     }
-    const Vector<BaseFloat> &weights = weights_reader->Value(utt);
-    if (weights.Dim() != feats.NumRows()) {
+    *weights = weights_reader->Value(utt);
+    if (weights->Dim() != feats.NumRows()) {
       KALDI_WARN << "Weights for utterance " << utt << " have wrong dimension "
-		 << weights.Dim() << " vs. " << feats.NumRows();
+		 << weights->Dim() << " vs. " << feats.NumRows();
       return false;
     }
-    AccMinmaxStats(feats, &weights, cmvn_stats);
     return true;
   }
 }
-                  
+
+// Accumulates the stats of one utterance or speaker, then in the order
+// read either writes them or adds them to the global stats
+class MinmaxStatsTask {
+ public:
+  MinmaxStatsTask(const std::string &key, DoubleMatrixWriter *writer,
+                  Matrix<double> *global_stats)
+      : key_(key), writer_(writer), global_stats_(global_stats) { }
+
+  void AddUtterance(const MatrixBase<BaseFloat> &feats,
+                    const VectorBase<BaseFloat> &weights) {
+    feats_.push_back(Matrix<BaseFloat>(feats));
+    weights_.push_back(Vector<BaseFloat>(weights));
+  }
+
+  void Compute() {
+    for (size_t i = 0; i < feats_.size(); i++) {
+      if (i == 0) InitMinmaxStats(feats_[i].NumCols(), &stats_);
+      AccMinmaxStats(feats_[i], weights_[i].Dim() ? &weights_[i] : NULL,
+                     &stats_);
+    }
+  }
+
+  void Output() {
+    if (writer_ != NULL) {
+      if (stats_.NumRows() == 0) {
+        KALDI_WARN << "No stats accumulated for speaker " << key_;
+      } else {
+        writer_->Write(key_, stats_);
+      }
+    } else if (stats_.NumRows() != 0) {
+      if (global_stats_->NumRows() == 0)
+        InitMinmaxStats(stats_.NumCols() - 1, global_stats_);
+      AddMinmaxStats(stats_, global_stats_);
+    }
+  }
+
+ private:
+  std::string key_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<Vector<BaseFloat> > weights_;
+  Matrix<double> stats_;
+  DoubleMatrixWriter *writer_;
+  Matrix<double> *global_stats_;
+};
 
 }
 
@@ -62,8 +109,10 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     std::string spk2utt_rspecifier, weights_rspecifier;
     bool binary = true;
+    TaskSequencerConfig sequencer_config;
     po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to utterance-list map");
     po.Register("binary", &binary, "write in binary mode (applies only to global CMN/CVN)");
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -83,6 +132,7 @@ int main(int argc, char *argv[]) {
       std::string wspecifier = wspecifier_or_wxfilename;
 
       DoubleMatrixWriter writer(wspecifier);
+      UtteranceSequencer<MinmaxStatsTask> sequencer(sequencer_config);
 
       if (spk2utt_rspecifier != "") {
         SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
@@ -91,8 +141,7 @@ int main(int argc, char *argv[]) {
         for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
           std::string spk = spk2utt_reader.Key();
           const std::vector<std::string> &uttlist = spk2utt_reader.Value();
-          bool is_init = false;
-          Matrix<double> stats;
+          MinmaxStatsTask *task = new MinmaxStatsTask(spk, &writer, NULL);
           for (size_t i = 0; i < uttlist.size(); i++) {
             std::string utt = uttlist[i];
             if (!feat_reader.HasKey(utt)) {
@@ -101,59 +150,58 @@ int main(int argc, char *argv[]) {
               continue;
             }
             const Matrix<BaseFloat> &feats = feat_reader.Value(utt);
-            if (!is_init) {
-              InitMinmaxStats(feats.NumCols(), &stats);
-              is_init = true;
-            }
-            if (!AccMinmaxStatsWrapper(utt, feats, &weights_reader, &stats)) {
+            Vector<BaseFloat> weights;
+            if (!GetMinmaxWeights(utt, feats, &weights_reader, &weights)) {
               num_err++;
             } else {
+              task->AddUtterance(feats, weights);
               num_done++;
             }
           }
-          if (stats.NumRows() == 0) {
-            KALDI_WARN << "No stats accumulated for speaker " << spk;
-          } else {
-            writer.Write(spk, stats);
-          }
+          sequencer.Run(task);
         }
       } else {  // per-utterance normalization
         SequentialBaseFloatMatrixReader feat_reader(rspecifier);
         
         for (; !feat_reader.Done(); feat_reader.Next()) {
           std::string utt = feat_reader.Key();
-          Matrix<double> stats;
           const Matrix<BaseFloat> &feats = feat_reader.Value();
-          InitMinmaxStats(feats.NumCols(), &stats);
+          Vector<BaseFloat> weights;
 
-          if (!AccMinmaxStatsWrapper(utt, feats, &weights_reader, &stats)) {
+          if (!GetMinmaxWeights(utt, feats, &weights_reader, &weights)) {
             num_err++;
             continue;
           }
-          writer.Write(feat_reader.Key(), stats);          
+          MinmaxStatsTask *task = new MinmaxStatsTask(utt, &writer, NULL);
+          task->AddUtterance(feats, weights);
+          sequencer.Run(task);
           num_done++;
         }
       }
+      sequencer.Wait();
     } else { // accumulate global stats
       if (spk2utt_rspecifier != "")
         KALDI_ERR << "--spk2utt option not compatible with wxfilename as output "
                    << "(did you forget ark:?)";
       std::string wxfilename = wspecifier_or_wxfilename;
-      bool is_init = false;
       Matrix<double> stats;
       SequentialBaseFloatMatrixReader feat_reader(rspecifier);
-      for (; !feat_reader.Done(); feat_reader.Next()) {
-        std::string utt = feat_reader.Key();
-        const Matrix<BaseFloat> &feats = feat_reader.Value();
-        if (!is_init) {
-          InitMinmaxStats(feats.NumCols(), &stats);
-          is_init = true;
-        }
-        if (!AccMinmaxStatsWrapper(utt, feats, &weights_reader, &stats)) {
-          num_err++;
-        } else {
-          num_done++;
+      {
+        UtteranceSequencer<MinmaxStatsTask> sequencer(sequencer_config);
+        for (; !feat_reader.Done(); feat_reader.Next()) {
+          std::string utt = feat_reader.Key();
+          const Matrix<BaseFloat> &feats = feat_reader.Value();
+          Vector<BaseFloat> weights;
+          if (!GetMinmaxWeights(utt, feats, &weights_reader, &weights)) {
+            num_err++;
+          } else {
+            MinmaxStatsTask *task = new MinmaxStatsTask(utt, NULL, &stats);
+            task->AddUtterance(feats, weights);
+            sequencer.Run(task);
+            num_done++;
+          }
         }
+        sequencer.Wait();
       }
       Matrix<float> fstats(stats);
       Output ko(wxfilename, binary);
@@ -0,0 +1,133 @@
+// idlakbin/gmm-align-linear.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "tree/context-dep.h"
+#include "idlakfeat/linear-hmm-aligner.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Align features given [GMM-based] models, when the transcription of\n"
+        "each utterance is a fixed sequence of phones (no optional silence or\n"
+        "alternative pronunciations).  Does a Viterbi directly on the chain of\n"
+        "HMMs rather than compiling a graph.  Topologies must have no\n"
+        "non-emitting states other than the final one.\n"
+        "Usage:   gmm-align-linear [options] <tree-in> <model-in> "
+        "<feature-rspecifier> <phones-rspecifier> <alignments-wspecifier> "
+        "[<scores-wspecifier>]\n"
+        "e.g.: \n"
+        " gmm-align-linear tree 1.mdl scp:train.scp ark:phones.int ark:1.ali\n";
+    ParseOptions po(usage);
+    LinearHmmAlignerOptions aligner_opts;
+    BaseFloat acoustic_scale = 1.0;
+    int32 batch_frames = 0;
+
+    aligner_opts.Register(&po);
+    po.Register("acoustic-scale", &acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("batch-frames", &batch_frames, "If >0, compute the GMM "
+                "likelihoods for this many frames at a time");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 5 || po.NumArgs() > 6) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string tree_in_filename = po.GetArg(1),
+        model_in_filename = po.GetArg(2),
+        feature_rspecifier = po.GetArg(3),
+        phones_rspecifier = po.GetArg(4),
+        alignment_wspecifier = po.GetArg(5),
+        scores_wspecifier = po.GetOptArg(6);
+
+    ContextDependency ctx_dep;
+    ReadKaldiObject(tree_in_filename, &ctx_dep);
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+      bool binary;
+      Input ki(model_in_filename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+
+    LinearHmmAligner aligner(trans_model, ctx_dep, aligner_opts);
+
+    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    RandomAccessInt32VectorReader phones_reader(phones_rspecifier);
+    Int32VectorWriter alignment_writer(alignment_wspecifier);
+    BaseFloatWriter scores_writer(scores_wspecifier);
+
+    int32 num_done = 0, num_err = 0;
+    double tot_like = 0.0;
+    kaldi::int64 frame_count = 0;
+    for (; !feature_reader.Done(); feature_reader.Next()) {
+      std::string utt = feature_reader.Key();
+      if (!phones_reader.HasKey(utt)) {
+        KALDI_WARN << "No phone sequence found for utterance " << utt;
+        num_err++;
+        continue;
+      }
+      const Matrix<BaseFloat> &features = feature_reader.Value();
+      const std::vector<int32> &phones = phones_reader.Value(utt);
+      if (features.NumRows() == 0) {
+        KALDI_WARN << "Zero-length features for utterance: " << utt;
+        num_err++;
+        continue;
+      }
+
+      DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
+                                             acoustic_scale, -1.0,
+                                             batch_frames);
+      std::vector<int32> alignment;
+      BaseFloat like;
+      if (!aligner.Align(phones, &gmm_decodable, &alignment, &like)) {
+        KALDI_WARN << "Did not successfully align utterance " << utt;
+        num_err++;
+        continue;
+      }
+      alignment_writer.Write(utt, alignment);
+      // As AlignUtteranceWrapper(): the score is written as it is, and the
+      // acoustic scale is undone for the log-likelihood.
+      if (scores_writer.IsOpen())
+        scores_writer.Write(utt, like);
+      tot_like += like / acoustic_scale;
+      frame_count += features.NumRows();
+      num_done++;
+    }
+    KALDI_LOG << "Overall log-likelihood per frame is "
+              << (tot_like / frame_count) << " over " << frame_count
+              << " frames.";
+    KALDI_LOG << "Done " << num_done << ", errors on " << num_err;
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
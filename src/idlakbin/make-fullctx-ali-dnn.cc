@@ -32,11 +32,14 @@
 // Models in any built tree for silence data are then ignored.
 
 
+#include <algorithm>
+
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "idlakfeat/hmm-utils-idlak.h"
+#include "idlakfeat/utterance-sequencer.h"
 #include "hmm/tree-accu.h"  // for ReadPhoneMap
 
 #define PHONECONTEXT 5
@@ -47,18 +50,259 @@ double fuzzy_position(double fuzzy_factor, int position, int duration) {
     return round(real_position / fuzzy_factor) /* * fuzzy_factor */;
 }
 
+namespace kaldi {
+
+// Merges the contexts and alignment of one utterance, adding state and phone
+// durations and positions, false if they do not match
+static bool MergeFullContextsDnn(
+    const TransitionModel &trans_model,
+    int phonecontext, int midcontext, int maxsilphone,
+    BaseFloat phone_fuzz_factor, BaseFloat state_fuzz_factor,
+    const std::string &key,
+    const std::vector< std::vector<int32> > &contexts,
+    const std::vector<int32> &old_alignment,
+    std::vector< std::vector<int32> > *output) {
+  int32 phone_index, j, last_phone, last_state, curlen_phone, curlen_state;
+  std::vector< std::vector<int32> >::iterator v;
+    std::vector< std::vector<int32> > phone_windows;
+    std::vector<int32> phones;
+    std::vector<int32> states;
+    std::vector<int32> curphone;
+
+    trans_model.TransitionIdsToHmmStates(old_alignment, &states);
+
+    if (!GetPhoneWindows(trans_model,
+                         old_alignment,
+                         phonecontext,
+                         midcontext,
+                         true,
+                         &phone_windows,
+                         &phones)) {
+        KALDI_WARN << "Could not convert alignment for key " << key
+               <<" (possibly truncated alignment?)";
+        return false;
+    }
+    /* Start processing alignment and label */
+    last_phone = -1;
+    last_state = -1;
+    phone_index = 0;
+    /* Duration (in frames) of current phone and state */
+    curlen_phone = -1;
+    curlen_state = -1;
+    bool new_phone = false, new_state = false;
+    for (v = phone_windows.begin(), j = 0;
+         v != phone_windows.end();
+         v++, j++) {
+        curlen_phone++;
+        curlen_state++;
+        curphone = *v;
+        /* We have a new phone if the phone identity change, or
+           if the state decreases within a non-silence phone */
+        if ( last_phone >= 0 &&
+             (curphone[midcontext] != last_phone ||
+              (last_phone > maxsilphone && states[j] < last_state))) {
+            /* What to do when we have a new phone:
+               1. advance phone index
+               2. output phone / state durations
+               3. reset curlen_phone, curlen_state */
+            phone_index++;
+            new_phone = true;
+            new_state = true;
+        }
+        else if (last_state >= 0 &&
+                 states[j] != last_state) {
+            new_state = true;
+        }
+        // check we have a silence at start of utt if not
+        // skip silence in context data
+        if (!phone_index && curphone[midcontext] > maxsilphone)
+            phone_index++;
+        /*std::cout << phone_index << " " << curphone[midcontext]  << "\n";*/
+
+        // Recreate context structure, add state
+
+        // the phone contexts repeated for each frame, with room for the
+        // state and the state and phone durations and positions
+        const std::vector<int32> &context =
+            contexts[std::min<size_t>(phone_index, contexts.size() - 1)];
+        output->push_back(std::vector<int32>());
+        output->back().reserve(context.size() + 5);
+        output->back().assign(context.begin(), context.end());
+        output->back().push_back(states[j]);
+
+        // Add position / duration information for state
+        if (new_state) {
+            for (int32 k = 0; k < curlen_state; k++) {
+                float position = fuzzy_position(state_fuzz_factor, k, curlen_state);
+                // State duration
+                (*output)[j - curlen_state + k].push_back(curlen_state);
+                // Position within the state
+                (*output)[j - curlen_state + k].push_back(position);
+            }
+            curlen_state = 0;
+            new_state = false;
+        }
+        /* Last iteration of the loop: force the update of phone / state info */
+        if (phone_index >= contexts.size() || (v + 1 == phone_windows.end())) {
+            new_state = true;
+            new_phone = true;
+            j++;
+            curlen_phone++;
+            curlen_state++;
+        }
+
+        // Add position / duration information for state / phone
+        // Note: the state is only added here in the final iteration
+        if (new_state) {
+            for (int32 k = 0; k < curlen_state; k++) {
+                float position = fuzzy_position(state_fuzz_factor, k, curlen_state);
+                // State duration
+                (*output)[j - curlen_state + k].push_back(curlen_state);
+                // Position within the state
+                (*output)[j - curlen_state + k].push_back(position);
+            }
+            curlen_state = 0;
+            new_state = false;
+        }
+        if (new_phone) {
+            for (int32 k = 0; k < curlen_phone; k++) {
+                float position = fuzzy_position(phone_fuzz_factor, k, curlen_phone);
+                // Phone duration
+                (*output)[j - curlen_phone + k].push_back(curlen_phone);
+                // Position within the state
+                (*output)[j - curlen_phone + k].push_back(position);
+            }
+            curlen_phone = 0;
+            new_phone = false;
+        }
+        if (phone_index >= contexts.size()) {
+            break;
+        }
+
+        last_phone = curphone[midcontext];
+        last_state = states[j];
+    }
+    // check we have a silence at end of utt; if not
+    // skip silence in context data
+    if (curphone[midcontext] > maxsilphone) phone_index++;
+    // phone_index should be pointing at the final silence...
+    if (phone_index + 1 != contexts.size()) {
+
+        /*if (phone_index != contexts.size()) {*/
+        KALDI_WARN << "Merge of alignment and contexts failed for key " << key
+                   <<" mismatching number of phones contexts:"
+                   << contexts.size()
+                   <<" alignment:" << phone_index + 1;
+        return false;
+        /*// Or maybe right after it? In which case, there probably was no silence here
+        // in the first place!
+        else {
+            KALDI_WARN << "It seems sentence for key " << key
+                       <<" had no final silence in context. The sentence was"
+                       <<" *not* discarded.";
+                       }*/
+    }
+    /*for (k = 0; k < output.size(); k++) {
+        KALDI_LOG << k << " : " << (*output)[k].size();
+        }*/
+    return true;
+}
+
+// Puts the frames of a merged alignment in the rows of a feature matrix,
+// false if the frames do not all have the same size
+static bool FullContextsToMatrix(
+    const std::string &key, const std::vector< std::vector<int32> > &frames,
+    Matrix<BaseFloat> *feats) {
+  if (frames.empty()) {
+    feats->Resize(0, 0);
+    return true;
+  }
+  size_t dim = frames[0].size();
+  feats->Resize(frames.size(), dim, kUndefined);
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i].size() != dim) {
+      KALDI_WARN << "Frame " << i << " of key " << key << " has "
+                 << frames[i].size() << " values, expected " << dim;
+      return false;
+    }
+    std::copy(frames[i].begin(), frames[i].end(), feats->RowData(i));
+  }
+  return true;
+}
+
+// Merges one utterance, written in the order read
+class FullContextDnnTask {
+ public:
+  FullContextDnnTask(const TransitionModel &trans_model,
+                     int phonecontext, int midcontext, int maxsilphone,
+                     BaseFloat phone_fuzz_factor, BaseFloat state_fuzz_factor,
+                     bool output_feat, const std::string &key,
+                     const std::vector< std::vector<int32> > &contexts,
+                     const std::vector<int32> &old_alignment,
+                     Int32VectorVectorWriter *alignment_writer,
+                     BaseFloatMatrixWriter *feat_writer,
+                     int *num_success, int *num_fail)
+      : trans_model_(trans_model), phonecontext_(phonecontext),
+        midcontext_(midcontext), maxsilphone_(maxsilphone),
+        phone_fuzz_factor_(phone_fuzz_factor),
+        state_fuzz_factor_(state_fuzz_factor), output_feat_(output_feat),
+        key_(key), contexts_(contexts), old_alignment_(old_alignment),
+        ok_(false), alignment_writer_(alignment_writer),
+        feat_writer_(feat_writer), num_success_(num_success),
+        num_fail_(num_fail) { }
+
+  void Compute() {
+    ok_ = MergeFullContextsDnn(trans_model_, phonecontext_, midcontext_,
+                               maxsilphone_, phone_fuzz_factor_,
+                               state_fuzz_factor_, key_, contexts_,
+                               old_alignment_, &output_);
+    if (ok_ && output_feat_)
+      ok_ = FullContextsToMatrix(key_, output_, &output_feats_);
+  }
+
+  void Output() {
+    if (!ok_) {
+      (*num_fail_)++;
+      return;
+    }
+    if (output_feat_) {
+      feat_writer_->Write(key_, output_feats_);
+    } else {
+      alignment_writer_->Write(key_, output_);
+    }
+    (*num_success_)++;
+  }
+
+ private:
+  const TransitionModel &trans_model_;
+  int phonecontext_, midcontext_, maxsilphone_;
+  BaseFloat phone_fuzz_factor_, state_fuzz_factor_;
+  bool output_feat_;
+  std::string key_;
+  std::vector< std::vector<int32> > contexts_;
+  std::vector<int32> old_alignment_;
+  std::vector< std::vector<int32> > output_;
+  Matrix<BaseFloat> output_feats_;
+  bool ok_;
+  Int32VectorVectorWriter *alignment_writer_;
+  BaseFloatMatrixWriter *feat_writer_;
+  int *num_success_, *num_fail_;
+};
+
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   using namespace kaldi;
   typedef kaldi::int32 int32;
-  int32 phone_index, j, k, last_phone, last_state, curlen_phone, curlen_state;
-  std::vector< std::vector<int32> >::iterator v;
   try {
     const char *usage =
         "Merges output from context extraction with a standard alignment\n"
         "Usage: make-fullctx-ali model old-alignments-rspecifier \n"
         " full-contexts-rspecifier fullcontext-alignments-wspecifier\n"
         "e.g.: \n"
-        " make-fullctx-ali model.mdl ark:old.ali ark,t:cex.ark ark:new.ali\n";
+        " make-fullctx-ali model.mdl ark:old.ali ark,t:cex.ark ark:new.ali\n"
+        " make-fullctx-ali-dnn --output-feat=true model.mdl ark:old.ali \\\n"
+        "   ark,t:cex.ark ark,scp:feats.ark,feats.scp\n";
 
 
     std::string phone_map_rxfilename;
@@ -68,13 +312,15 @@ int main(int argc, char *argv[]) {
     bool output_feat = false;
     BaseFloat phone_fuzz_factor = 0.1;
     BaseFloat state_fuzz_factor = 0.2;
+    TaskSequencerConfig sequencer_config;
     ParseOptions po(usage);
     po.Register("phone-context", &phonecontext, "Size of the phone context, e.g. 3 for triphone.");
     po.Register("mid-context", &midcontext, "Position of the middle phone, e.g. 1 for triphone.");
     po.Register("max-sil-phone", &maxsilphone, "Maximum value of silence phone");
     po.Register("phone-fuzz-factor", &phone_fuzz_factor, "Rounding value for phone positioning");
     po.Register("state-fuzz-factor", &state_fuzz_factor, "Rounding value for state positioning");
-    po.Register("output-feat", &output_feat, "Set this to true to output features instead of vectors of vectors");
+    po.Register("output-feat", &output_feat, "Set this to true to output a feature matrix per utterance, a row per frame, instead of vectors of vectors");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -91,12 +337,15 @@ int main(int argc, char *argv[]) {
     ReadKaldiObject(model_filename, &trans_model);
     SequentialInt32VectorReader alignment_reader(old_alignments_rspecifier);
     SequentialInt32VectorVectorReader contexts_reader(contexts_rspecifier);
-    Int32VectorVectorWriter alignment_writer(new_alignments_wspecifier);
-    BaseFloatMatrixWriter feat_writer(new_alignments_wspecifier);
-    int num_success = 0, num_fail = 0;
-    /*if (!output_feat) {
-        alignment_writer = Int32VectorVectorWriter(new_alignments_wspecifier);
-        }*/
+    // only the writer used is opened, both would write to the same place
+    Int32VectorVectorWriter alignment_writer;
+    BaseFloatMatrixWriter feat_writer;
+    if (output_feat ? !feat_writer.Open(new_alignments_wspecifier) :
+        !alignment_writer.Open(new_alignments_wspecifier))
+      KALDI_ERR << "Failed to open " << new_alignments_wspecifier;
+    // num_fail is counted by the tasks, num_missing here
+    int num_success = 0, num_fail = 0, num_missing = 0;
+    UtteranceSequencer<FullContextDnnTask> sequencer(sequencer_config);
 
     for (; !contexts_reader.Done() && !alignment_reader.Done();
          contexts_reader.Next(), alignment_reader.Next()) {
@@ -111,167 +360,18 @@ int main(int argc, char *argv[]) {
         if (ctxkey != key) {
             KALDI_WARN << "Could not merge alignment and contexts for key " << key
                        <<" (missing data?)";
-            num_fail++;
-            continue;
-        }
-        /*std::cout << ctxkey << " " << key << "\n";*/
-        std::vector< std::vector<int32> > phone_windows;
-        std::vector<int32> phones;
-        std::vector<int32> states;
-        std::vector< std::vector<int32> > output;
-        Matrix<BaseFloat> output_feats; 
-        std::vector<int32> curphone;
-
-        for (size_t i = 0; i < old_alignment.size(); i++)
-            states.push_back(trans_model.TransitionIdToHmmState(old_alignment[i]));
-
-        if (!GetPhoneWindows(trans_model,
-                             old_alignment,
-                             phonecontext,
-                             midcontext,
-                             true,
-                             &phone_windows,
-                             &phones)) {
-            KALDI_WARN << "Could not convert alignment for key " << key
-                   <<" (possibly truncated alignment?)";
-            num_fail++;
+            num_missing++;
             continue;
         }
-        /* Start processing alignment and label */
-        last_phone = -1;
-        last_state = -1;
-        phone_index = 0;
-        /* Duration (in frames) of current phone and state */
-        curlen_phone = -1;
-        curlen_state = -1;
-        bool new_phone = false, new_state = false;
-        for (v = phone_windows.begin(), j = 0;
-             v != phone_windows.end();
-             v++, j++) {
-	     
-            curlen_phone++;
-            curlen_state++;
-            curphone = *v;
-            /* We have a new phone if the phone identity change, or
-               if the state decreases within a non-silence phone */
-            if ( last_phone >= 0 && 
-                 (curphone[midcontext] != last_phone || 
-                  (last_phone > maxsilphone && states[j] < last_state))) {
-                /* What to do when we have a new phone:
-                   1. advance phone index
-                   2. output phone / state durations
-                   3. reset curlen_phone, curlen_state */
-                phone_index++;
-                new_phone = true;
-                new_state = true;
-            }
-            else if (last_state >= 0 && 
-                     states[j] != last_state) {
-                new_state = true;
-            }
-            // check we have a silence at start of utt if not
-            // skip silence in context data
-            if (!phone_index && curphone[midcontext] > maxsilphone)
-                phone_index++;
-            /*std::cout << phone_index << " " << curphone[midcontext]  << "\n";*/
-            
-            // Recreate context structure, add state
-
-            std::vector<int32> outphone;
-            if (phone_index < contexts.size()) {
-                for (k = 0; k < contexts[phone_index].size(); k++)
-                    outphone.push_back(contexts[phone_index][k]);
-            } else {
-                for (k = 0; k < contexts[contexts.size() - 1].size(); k++)
-                    outphone.push_back(contexts[contexts.size() - 1][k]); 
-            }
-            outphone.push_back(states[j]);
-            output.push_back(outphone);
-
-            // Add position / duration information for state
-            if (new_state) {
-                for (int32 k = 0; k < curlen_state; k++) {
-                    float position = fuzzy_position(state_fuzz_factor, k, curlen_state);
-                    // State duration
-                    output[j - curlen_state + k].push_back(curlen_state);
-                    // Position within the state
-                    output[j - curlen_state + k].push_back(position);
-                }
-                curlen_state = 0;
-                new_state = false;
-            }
-            /* Last iteration of the loop: force the update of phone / state info */
-            if (phone_index >= contexts.size() || (v + 1 == phone_windows.end())) {
-                new_state = true;
-                new_phone = true;
-                j++;
-                curlen_phone++;
-                curlen_state++;
-            }
-
-            // Add position / duration information for state / phone
-            // Note: the state is only added here in the final iteration
-            if (new_state) {
-                for (int32 k = 0; k < curlen_state; k++) {
-                    float position = fuzzy_position(state_fuzz_factor, k, curlen_state);
-                    // State duration
-                    output[j - curlen_state + k].push_back(curlen_state);
-                    // Position within the state
-                    output[j - curlen_state + k].push_back(position);
-                }
-                curlen_state = 0;
-                new_state = false;
-            }
-            if (new_phone) {
-                for (int32 k = 0; k < curlen_phone; k++) {
-                    float position = fuzzy_position(phone_fuzz_factor, k, curlen_phone);
-                    // Phone duration
-                    output[j - curlen_phone + k].push_back(curlen_phone);
-                    // Position within the state
-                    output[j - curlen_phone + k].push_back(position);
-                }
-                curlen_phone = 0;
-                new_phone = false;
-            }
-            if (phone_index >= contexts.size()) {
-                break;
-            }
-            
-            last_phone = curphone[midcontext];
-            last_state = states[j];
-        }
-        // check we have a silence at end of utt; if not
-        // skip silence in context data
-        if (curphone[midcontext] > maxsilphone) phone_index++;
-        // phone_index should be pointing at the final silence...
-        if (phone_index + 1 != contexts.size()) {
-
-            /*if (phone_index != contexts.size()) {*/
-            KALDI_WARN << "Merge of alignment and contexts failed for key " << key
-                       <<" mismatching number of phones contexts:"
-                       << contexts.size()
-                       <<" alignment:" << phone_index + 1;
-            num_fail++;
-            continue;
-            /*// Or maybe right after it? In which case, there probably was no silence here
-            // in the first place!
-            else {
-                KALDI_WARN << "It seems sentence for key " << key
-                           <<" had no final silence in context. The sentence was"
-                           <<" *not* discarded.";
-                           }*/
-        }
-        /*for (k = 0; k < output.size(); k++) {
-            KALDI_LOG << k << " : " << output[k].size();
-            }*/
-        if (output_feat) {
-            //output_feats.CopyRowsFromVec(output);
-            feat_writer.Write(key, output_feats);
-        } else {
-            alignment_writer.Write(key, output);
-        }
-        num_success++;
+        sequencer.Run(new FullContextDnnTask(
+            trans_model, phonecontext, midcontext, maxsilphone,
+            phone_fuzz_factor, state_fuzz_factor, output_feat, key, contexts,
+            old_alignment, &alignment_writer, &feat_writer, &num_success,
+            &num_fail));
     }
+    sequencer.Wait();
+    KALDI_LOG << "Merged " << num_success << " alignments, "
+              << num_fail + num_missing << " failed";
   } catch(const std::exception &e) {
     std::cerr << e.what();
     return -1;
@@ -37,16 +37,127 @@
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "idlakfeat/hmm-utils-idlak.h"
+#include "idlakfeat/utterance-sequencer.h"
 #include "hmm/tree-accu.h"  // for ReadPhoneMap
 
 #define PHONECONTEXT 5
 #define MIDCONTEXT 2
 
+namespace kaldi {
+
+// Merges the contexts and alignment of one utterance, false if they do not
+// match
+static bool MergeFullContexts(
+    const TransitionModel &trans_model,
+    int phonecontext, int midcontext, int maxsilphone,
+    const std::string &key,
+    const std::vector< std::vector<int32> > &contexts,
+    const std::vector<int32> &old_alignment,
+    std::vector< std::vector<int32> > *output) {
+  int32 phone_index, j, k, last_phone;
+  std::vector< std::vector<int32> >::iterator v;
+  std::vector< std::vector<int32> > phone_windows;
+  std::vector<int32> phones;
+  std::vector<int32> states;
+  std::vector<int32> curphone;
+
+  trans_model.TransitionIdsToHmmStates(old_alignment, &states);
+
+  if (GetPhoneWindows(trans_model,
+                      old_alignment,
+                      phonecontext,
+                      midcontext,
+                      true,
+                      &phone_windows,
+                      &phones)) {
+      last_phone = -1;
+      phone_index = 0;
+      for (v = phone_windows.begin(), j = 0;
+           v != phone_windows.end();
+           v++, j++) {
+          curphone = *v;
+          if ( curphone[midcontext] != last_phone ) {
+              if (last_phone >= 0)  phone_index++;
+          }
+          // check we have a silence at start of utt if not
+          // skip silence in context data
+          if (!phone_index && curphone[midcontext] > maxsilphone)
+              phone_index++;
+          if (phone_index >= contexts.size()) {
+              break;
+          }
+          /*std::cout << phone_index << " " << curphone[midcontext]  << "\n";*/
+          // first item in context is the mid point phone - ignore it
+          for (k = 1; k < contexts[phone_index].size(); k++)
+              curphone.push_back(contexts[phone_index][k]);
+          curphone.push_back(states[j]);
+          output->push_back(curphone);
+          last_phone = curphone[midcontext];
+      }
+      if (curphone[midcontext] > maxsilphone) phone_index++;
+      if (phone_index + 1 != contexts.size()) {
+          KALDI_WARN << "Merge of alignment and contexts failed for key " << key
+                     <<" mismatching number of phones contexts:"
+                     << contexts.size()
+                     <<" alignment:" << phone_index + 1;
+          return false;
+      }
+      return true;
+  } else {
+      KALDI_WARN << "Could not convert alignment for key " << key
+                 <<" (possibly truncated alignment?)";
+      return false;
+  }
+}
+
+// Merges one utterance, written in the order read
+class FullContextTask {
+ public:
+  FullContextTask(const TransitionModel &trans_model,
+                  int phonecontext, int midcontext, int maxsilphone,
+                  const std::string &key,
+                  const std::vector< std::vector<int32> > &contexts,
+                  const std::vector<int32> &old_alignment,
+                  Int32VectorVectorWriter *alignment_writer,
+                  int *num_success, int *num_fail)
+      : trans_model_(trans_model), phonecontext_(phonecontext),
+        midcontext_(midcontext), maxsilphone_(maxsilphone), key_(key),
+        contexts_(contexts), old_alignment_(old_alignment), ok_(false),
+        alignment_writer_(alignment_writer), num_success_(num_success),
+        num_fail_(num_fail) { }
+
+  void Compute() {
+    ok_ = MergeFullContexts(trans_model_, phonecontext_, midcontext_,
+                            maxsilphone_, key_, contexts_, old_alignment_,
+                            &output_);
+  }
+
+  void Output() {
+    if (!ok_) {
+      (*num_fail_)++;
+      return;
+    }
+    alignment_writer_->Write(key_, output_);
+    (*num_success_)++;
+  }
+
+ private:
+  const TransitionModel &trans_model_;
+  int phonecontext_, midcontext_, maxsilphone_;
+  std::string key_;
+  std::vector< std::vector<int32> > contexts_;
+  std::vector<int32> old_alignment_;
+  std::vector< std::vector<int32> > output_;
+  bool ok_;
+  Int32VectorVectorWriter *alignment_writer_;
+  int *num_success_, *num_fail_;
+};
+
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   using namespace kaldi;
   typedef kaldi::int32 int32;
-  int32 phone_index, j, k, last_phone;
-  std::vector< std::vector<int32> >::iterator v;
   try {
     const char *usage =
         "Merges output from context extraction with a standard alignment\n"
@@ -60,10 +171,12 @@ int main(int argc, char *argv[]) {
     int phonecontext = 5;
     int midcontext = 2;
     int maxsilphone = 1;
+    TaskSequencerConfig sequencer_config;
     ParseOptions po(usage);
     po.Register("phone-context", &phonecontext, "Size of the phone context, e.g. 3 for triphone.");
     po.Register("mid-context", &midcontext, "Position of the middle phone, e.g. 1 for triphone.");
     po.Register("max-sil-phone", &maxsilphone, "Maximum value of silence phone");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -82,7 +195,9 @@ int main(int argc, char *argv[]) {
     SequentialInt32VectorVectorReader contexts_reader(contexts_rspecifier);
     Int32VectorVectorWriter alignment_writer(new_alignments_wspecifier);
 
-    int num_success = 0, num_fail = 0;
+    // num_fail is counted by the tasks, num_missing here
+    int num_success = 0, num_fail = 0, num_missing = 0;
+    UtteranceSequencer<FullContextTask> sequencer(sequencer_config);
 
     for (; !contexts_reader.Done() && !alignment_reader.Done();
          contexts_reader.Next(), alignment_reader.Next()) {
@@ -96,68 +211,17 @@ int main(int argc, char *argv[]) {
       if (ctxkey != key) {
         KALDI_WARN << "Could not merge alignment and contexts for key " << key
                    <<" (missing data?)";
-        num_fail++;
+        num_missing++;
         continue;
       }
-      /*std::cout << ctxkey << " " << key << "\n";*/
-      std::vector< std::vector<int32> > phone_windows;
-      std::vector<int32> phones;
-      std::vector<int32> states;
-      std::vector< std::vector<int32> > output;
-      std::vector<int32> curphone;
-
-      for (size_t i = 0; i < old_alignment.size(); i++)
-        states.push_back(trans_model.TransitionIdToHmmState(old_alignment[i]));
-
-      if (GetPhoneWindows(trans_model,
-                          old_alignment,
-                          phonecontext,
-                          midcontext,
-                          true,
-                          &phone_windows,
-                          &phones)) {
-	  last_phone = -1;
-	  phone_index = 0;
-	  for (v = phone_windows.begin(), j = 0;
-	       v != phone_windows.end();
-	       v++, j++) {
-	      curphone = *v;
-	      if ( curphone[midcontext] != last_phone ) {
-		  if (last_phone >= 0)  phone_index++;
-	      }
-	      // check we have a silence at start of utt if not
-	      // skip silence in context data
-	      if (!phone_index && curphone[midcontext] > maxsilphone)
-		  phone_index++;
-	      if (phone_index >= contexts.size()) {
-		  break;
-	      }
-	      /*std::cout << phone_index << " " << curphone[midcontext]  << "\n";*/
-	      // first item in context is the mid point phone - ignore it
-	      for (k = 1; k < contexts[phone_index].size(); k++)
-		  curphone.push_back(contexts[phone_index][k]);
-	      curphone.push_back(states[j]);
-	      output.push_back(curphone);
-	      last_phone = curphone[midcontext];
-	  }
-	  if (curphone[midcontext] > maxsilphone) phone_index++;
-	  if (phone_index + 1 != contexts.size()) {
-	      KALDI_WARN << "Merge of alignment and contexts failed for key " << key
-			 <<" mismatching number of phones contexts:"
-			 << contexts.size()
-			 <<" alignment:" << phone_index + 1;
-	      num_fail++;
-	      continue;
-	  }
-
-	  alignment_writer.Write(key, output);
-	  num_success++;
-      } else {
-	  KALDI_WARN << "Could not convert alignment for key " << key
-		     <<" (possibly truncated alignment?)";
-	  num_fail++;
-      }
+      sequencer.Run(new FullContextTask(trans_model, phonecontext, midcontext,
+                                        maxsilphone, key, contexts,
+                                        old_alignment, &alignment_writer,
+                                        &num_success, &num_fail));
     }
+    sequencer.Wait();
+    KALDI_LOG << "Merged " << num_success << " alignments, "
+              << num_fail + num_missing << " failed";
   } catch(const std::exception &e) {
     std::cerr << e.what();
     return -1;
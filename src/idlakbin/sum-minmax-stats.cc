@@ -0,0 +1,75 @@
+// idlakbin/sum-minmax-stats.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "matrix/kaldi-matrix.h"
+#include "idlakfeat/minmax.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Merge global minmax stats, e.g. those of parallel feature extraction\n"
+        "jobs: the minimum of the minima, the maximum of the maxima and the\n"
+        "total count. Minmax stats can not be combined with matrix-sum.\n"
+        "Usage: sum-minmax-stats [options] <stats-rxfilename1> "
+        "[<stats-rxfilename2> ...] <stats-wxfilename>\n"
+        "e.g.: sum-minmax-stats minmax.1.mat minmax.2.mat minmax.mat\n"
+        "See also: compute-minmax-stats, minmax-to-nnet\n";
+
+    ParseOptions po(usage);
+    bool binary = true;
+    po.Register("binary", &binary, "Write in binary mode");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string wxfilename = po.GetArg(po.NumArgs());
+    Matrix<double> stats;
+    for (int32 i = 1; i < po.NumArgs(); i++) {
+      Matrix<double> other;
+      ReadKaldiObject(po.GetArg(i), &other);
+      if (other.NumRows() != 2 || other.NumCols() < 2)
+        KALDI_ERR << "Bad minmax stats in " << po.GetArg(i) << ", size "
+                  << other.NumRows() << 'x' << other.NumCols();
+      if (stats.NumRows() == 0) {
+        stats = other;
+      } else {
+        if (other.NumCols() != stats.NumCols())
+          KALDI_ERR << "Dimension mismatch in " << po.GetArg(i) << ": "
+                    << other.NumCols() - 1 << " vs. " << stats.NumCols() - 1;
+        AddMinmaxStats(other, &stats);
+      }
+    }
+
+    Matrix<float> fstats(stats);
+    Output ko(wxfilename, binary);
+    fstats.Write(ko.Stream(), binary);
+    KALDI_LOG << "Merged " << po.NumArgs() - 1 << " minmax stats with a count "
+              << "of " << stats(0, stats.NumCols() - 1) << " to " << wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
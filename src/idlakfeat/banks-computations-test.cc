@@ -0,0 +1,74 @@
+// idlakfeat/banks-computations-test.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "feat/feature-window.h"
+#include "idlakfeat/banks-computations.h"
+
+namespace kaldi {
+
+// The banks of a frame, of a matrix of frames and of the full weights
+// applied to the whole spectrum agree
+static void UnitTestFrequencyBanks(const std::string &scale_type) {
+  FrameExtractionOptions frame_opts;
+  frame_opts.samp_freq = 16000;
+  FrequencyBanksOptions opts(5 + Rand() % 20);
+  opts.scale_type = scale_type;
+  FrequencyBanks banks(opts, frame_opts, 1.0);
+  int32 num_bins = banks.NumBins(),
+      padded_window_size = frame_opts.PaddedWindowSize(),
+      dim = padded_window_size / 2 + 1,
+      num_frames = 1 + Rand() % 10;
+  KALDI_ASSERT(num_bins == opts.num_bins);
+
+  // weights of each bin over the whole spectrum, read back one fft-bin at
+  // a time
+  Matrix<BaseFloat> full_weights(num_bins, dim);
+  Vector<BaseFloat> impulse(dim), energies(num_bins);
+  for (int32 j = 0; j < dim; j++) {
+    impulse.SetZero();
+    impulse(j) = 1.0;
+    banks.Compute(impulse, &energies);
+    full_weights.CopyColFromVec(energies, j);
+  }
+
+  Matrix<BaseFloat> spectra(num_frames, dim);
+  spectra.SetRandUniform();
+  Matrix<BaseFloat> batched(num_frames, num_bins), expected(num_frames,
+                                                              num_bins);
+  banks.Compute(spectra, &batched);
+  expected.AddMatMat(1.0, spectra, kNoTrans, full_weights, kTrans, 0.0);
+  AssertEqual(batched, expected, 1.0e-04);
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> batched_row(batched, r);
+    banks.Compute(spectra.Row(r), &energies);
+    AssertEqual(energies, batched_row, 1.0e-04);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestFrequencyBanks("mel");
+    UnitTestFrequencyBanks("bark");
+    UnitTestFrequencyBanks("linear");
+  }
+  std::cout << "Tests succeeded.\n";
+  return 0;
+}
@@ -232,6 +232,24 @@ BaseFloat FrequencyBanks::VtlnWarpFreq(BaseFloat vtln_low_cutoff,
 }
 
 
+// Dot product of a bin's weights with its span of the spectrum. The bins
+// are a few tens of fft-bins wide, too short for a BLAS call to pay off;
+// the independent partial sums let the compiler vectorise the loop.
+static inline BaseFloat BinDot(const BaseFloat *weights,
+                               const BaseFloat *spectrum, int32 size) {
+  BaseFloat sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+  int32 i = 0;
+  for (; i + 4 <= size; i += 4) {
+    sum0 += weights[i] * spectrum[i];
+    sum1 += weights[i + 1] * spectrum[i + 1];
+    sum2 += weights[i + 2] * spectrum[i + 2];
+    sum3 += weights[i + 3] * spectrum[i + 3];
+  }
+  for (; i < size; i++)
+    sum0 += weights[i] * spectrum[i];
+  return (sum0 + sum1) + (sum2 + sum3);
+}
+
 // "power_spectrum" contains fft energies.
 void FrequencyBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
                        VectorBase<BaseFloat> *banks_energies_out) const {
@@ -241,7 +259,9 @@ void FrequencyBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   for (int32 i = 0; i < num_bins; i++) {
     int32 offset = bins_[i].first;
     const Vector<BaseFloat> &v(bins_[i].second);
-    BaseFloat energy = VecVec(v, power_spectrum.Range(offset, v.Dim()));
+    KALDI_ASSERT(offset + v.Dim() <= power_spectrum.Dim());
+    BaseFloat energy = BinDot(v.Data(), power_spectrum.Data() + offset,
+                              v.Dim());
     // HTK-like flooring- for testing purposes (we prefer dither)
     if (htk_mode_ && energy < 1.0) energy = 1.0;
     (*banks_energies_out)(i) = energy;
@@ -260,4 +280,35 @@ void FrequencyBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void FrequencyBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                             MatrixBase<BaseFloat> *banks_energies_out) const {
+  int32 num_bins = bins_.size(),
+      num_frames = power_spectra.NumRows();
+  KALDI_ASSERT(banks_energies_out->NumRows() == num_frames &&
+               banks_energies_out->NumCols() == num_bins);
+  if (num_frames == 0) return;
+
+  Vector<BaseFloat> energies(num_frames, kUndefined);
+  for (int32 i = 0; i < num_bins; i++) {
+    int32 offset = bins_[i].first;
+    const Vector<BaseFloat> &v(bins_[i].second);
+    KALDI_ASSERT(offset + v.Dim() <= power_spectra.NumCols());
+    energies.AddMatVec(1.0, power_spectra.ColRange(offset, v.Dim()),
+                       kNoTrans, v, 0.0);
+    // HTK-like flooring- for testing purposes (we prefer dither)
+    if (htk_mode_) energies.ApplyFloor(1.0);
+    KALDI_ASSERT(!KALDI_ISNAN(energies.Sum()));
+    banks_energies_out->CopyColFromVec(energies, i);
+  }
+
+  if (debug_) {
+    fprintf(stderr, "MEL BANKS:\n");
+    for (int32 r = 0; r < num_frames; r++) {
+      for (int32 i = 0; i < num_bins; i++)
+        fprintf(stderr, " %f", (*banks_energies_out)(r, i));
+      fprintf(stderr, "\n");
+    }
+  }
+}
+
 }  // namespace kaldi
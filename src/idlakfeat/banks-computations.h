@@ -138,6 +138,13 @@ class FrequencyBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                VectorBase<BaseFloat> *banks_energies_out) const;
 
+  /// As above for a matrix with a row of FFT energies per frame, the banks
+  /// energies of each frame are written to the same row of
+  /// "banks_energies_out". Each bin is a matrix-vector product over the
+  /// columns of its span, so the zero weights outside it are never touched.
+  void Compute(const MatrixBase<BaseFloat> &fft_energies,
+               MatrixBase<BaseFloat> *banks_energies_out) const;
+
   int32 NumBins() const { return bins_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
@@ -154,7 +161,8 @@ class FrequencyBanks {
   Vector<BaseFloat> center_freqs_;
 
   // the "bins_" vector is a vector, one for each bin, of a pair:
-  // (the first nonzero fft-bin), (the vector of weights).
+  // (the first nonzero fft-bin), (the vector of weights). The weights only
+  // cover the span between the first and last nonzero fft-bin.
   std::vector<std::pair<int32, Vector<BaseFloat> > > bins_;
 
   bool debug_;
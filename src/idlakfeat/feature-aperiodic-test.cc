@@ -69,6 +69,18 @@ static void UnitTestAperiodic() {
       KALDI_ASSERT(-1000.0 < this_ap_energy(c) && this_ap_energy(c) <= 0.0);
     }
   }
+
+  // Splitting the frames between threads gives the same features, dither
+  // is turned off as it is random
+  opts.frame_opts.dither = 0.0;
+  AperiodicEnergy ap_energy_single(opts);
+  Matrix<BaseFloat> m_single;
+  ap_energy_single.Compute(waveform, pov, f0, &m_single);
+  opts.num_threads = 3;
+  AperiodicEnergy ap_energy_threaded(opts);
+  Matrix<BaseFloat> m_threaded;
+  ap_energy_threaded.Compute(waveform, pov, f0, &m_threaded);
+  KALDI_ASSERT(m_single.ApproxEqual(m_threaded, 0.0));
 }
 }
 
@@ -23,6 +23,7 @@
 #include "idlakfeat/banks-computations.h"
 #include "idlakfeat/feature-mcep.h"
 #include "idlakfeat/feature-window-ext.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -153,6 +154,10 @@ void AperiodicEnergy::FindBandLocations() {
       band_ends_(band) = end_frequency;
     }
   }
+  for (int32 band = 0; band < number_bands; band++) {
+    KALDI_VLOG(1) << "Band " << band << ": [ " << band_starts_(band) << " ; "
+                  << band_centers_(band) << " ; " << band_ends_(band) << " ]";
+  }
 }
 
 
@@ -165,7 +170,7 @@ void AperiodicEnergy::FindBandLocations() {
 // performed in the log domain...
 void AperiodicEnergy::ComputeHtsBands(
     const VectorBase<BaseFloat> &power_spectrum,
-    Vector<BaseFloat> *output) {
+    VectorBase<BaseFloat> *output) const {
   output->SetZero();
   BaseFloat sample_frequency = opts_.frame_opts.samp_freq;
   int32 number_bands = output->Dim();
@@ -189,6 +194,61 @@ void AperiodicEnergy::ComputeHtsBands(
   }
 }
 
+AperiodicEnergy::FrameScratch::FrameScratch(int32 padded_window_size,
+                                            int32 num_bins)
+    : fft_coeffs(padded_window_size, kUndefined),
+      spectrum(padded_window_size, kUndefined),
+      cepstrum(padded_window_size, kUndefined),
+      abs_cepstrum(padded_window_size, kUndefined),
+      harmonic_spectrum(padded_window_size, kUndefined),
+      binned_energies(num_bins, kUndefined),
+      noise_binned_energies(num_bins, kUndefined),
+      noise_indices(padded_window_size / 2 + 1, false),
+      fft_buffer(padded_window_size) { }
+
+/// Computes a contiguous share of the frames, each thread with its own
+/// scratch buffers. The FFT tables and frequency banks are shared.
+class AperiodicEnergy::FrameWorker : public MultiThreadable {
+ public:
+  FrameWorker(const AperiodicEnergy &ap_energy,
+              const VectorBase<BaseFloat> &wave,
+              const VectorBase<BaseFloat> &voicing_prob,
+              const VectorBase<BaseFloat> &f0,
+              Matrix<BaseFloat> *output,
+              std::vector<std::string> *errors)
+      : ap_energy_(ap_energy), wave_(wave), voicing_prob_(voicing_prob),
+        f0_(f0), output_(output), errors_(errors) { }
+
+  void operator() () {
+    int32 num_frames = output_->NumRows(),
+        start = static_cast<int64>(num_frames) * thread_id_ / num_threads_,
+        end = static_cast<int64>(num_frames) * (thread_id_ + 1) / num_threads_;
+    // An exception would terminate the program if it left the thread, it is
+    // rethrown by Compute once all threads have finished
+    try {
+      FrameScratch scratch(ap_energy_.padded_window_size_,
+                           output_->NumCols());
+      scratch.wave_window.Resize(ap_energy_.opts_.frame_opts.PaddedWindowSize(),
+                                 kUndefined);
+      for (int32 r = start; r < end; r++) {  // r is frame index
+        SubVector<BaseFloat> this_ap_energy(output_->Row(r));
+        ap_energy_.ComputeFrame(wave_, r, voicing_prob_(r), f0_(r), &scratch,
+                                &this_ap_energy);
+      }
+    } catch(const std::exception &e) {
+      (*errors_)[thread_id_] = e.what();
+    }
+  }
+
+ private:
+  const AperiodicEnergy &ap_energy_;
+  const VectorBase<BaseFloat> &wave_;
+  const VectorBase<BaseFloat> &voicing_prob_;
+  const VectorBase<BaseFloat> &f0_;
+  Matrix<BaseFloat> *output_;
+  std::vector<std::string> *errors_;
+};
+
 /// Compute aperiodic energy coefficients, obtained by estimating the noise /
 /// aperiodicity spectrogram by sampling the frequencies that minimise the
 /// periodic spectrogram (a.k.a. pitch spectrogram).
@@ -199,7 +259,7 @@ void AperiodicEnergy::ComputeHtsBands(
 void AperiodicEnergy::Compute(const VectorBase<BaseFloat> &wave,
                               const VectorBase<BaseFloat> &voicing_prob,
                               const VectorBase<BaseFloat> &f0,
-                              Matrix<BaseFloat> *output) {
+                              Matrix<BaseFloat> *output) const {
   KALDI_ASSERT(output != NULL);
   KALDI_ASSERT(srfft_ != NULL &&
               "srfft_ must not be NULL if class is initialized properly.");
@@ -220,91 +280,99 @@ void AperiodicEnergy::Compute(const VectorBase<BaseFloat> &wave,
   }
 
   frames_out = std::min(frames_out, f0.Dim());  // will be removed eventually
-  output->Resize(frames_out, dim_out);
-  Vector<BaseFloat> wave_window;
-  Vector<BaseFloat> padded_window(padded_window_size_, kUndefined);
-  Vector<BaseFloat> binned_energies(dim_out);
-  Vector<BaseFloat> noise_binned_energies(dim_out);
-  // Print out band frequency information
-
-  for (int i = 0; i < dim_out; i++) {
-    KALDI_LOG << "Band " << i << ": [ "
-               << band_starts_(i) << " ; " << band_centers_(i) << " ; " << band_ends_(i) << " ]";
+  output->Resize(frames_out, dim_out, kUndefined);
+
+  // With 0 threads MultiThreader runs the worker in this thread
+  int32 num_threads = 0;
+  if (opts_.num_threads > 1 && frames_out > 1)
+    num_threads = std::min(opts_.num_threads, frames_out);
+  std::vector<std::string> errors(std::max(num_threads, 1));
+  {
+    FrameWorker worker(*this, wave, voicing_prob, f0, output, &errors);
+    MultiThreader<FrameWorker> threader(num_threads, worker);
   }
+  for (size_t i = 0; i < errors.size(); i++) {
+    if (!errors[i].empty())
+      KALDI_ERR << "Aperiodic energy computation failed: " << errors[i];
+  }
+}
 
-
-  for (int32 r = 0; r < frames_out; r++) {  // r is frame index
-    SubVector<BaseFloat> this_ap_energy(output->Row(r));
-    ExtractWindow(0, wave, r, opts_.frame_opts, feature_window_function_,
-                  &wave_window, NULL);
-    int32 window_size = wave_window.Dim();
-    padded_window.SetZero();
-    padded_window.Range(padded_window_size_/2 - window_size/2, window_size).
-      CopyFromVec(wave_window);
-    srfft_->Compute(padded_window.Data(), true);
-
-    Vector<BaseFloat> tmp_spectrum(padded_window);
-    ComputePowerSpectrum(&tmp_spectrum);
-    SubVector<BaseFloat> power_spectrum(tmp_spectrum, 0,
-                                        padded_window_size_/2 + 1);
-    KALDI_VLOG(2) << "Computing frame " << r << " with F0 " << f0(r);
-
-    // BP: this code allows us to speed things up a bit for unvoiced regions
-    if (voicing_prob(r) <= 0.0) {  // unvoiced region
-      // While the aperiodic energy will not be used during synthesis of the
-      // unvoiced regions, it is still modeled as a separate stream in the HMM
-      // and so we set it to the log-filterbank values.
-      for (int i = 0; i < dim_out; i++) binned_energies(i) = 0.0;
-      this_ap_energy.CopyFromVec(binned_energies);
-      continue;
-    }
-    // Compute energy bands of signal power spectrum; the aperiodic energy
-    // will be the ratio of noise over signal.
-    // NB: we use ComputeHtsBands only for legacy support
-    if (opts_.use_hts_bands && dim_out == 5)
-      ComputeHtsBands(power_spectrum, &binned_energies);
-    else
-      freq_banks_->Compute(power_spectrum, &binned_energies);
-
-    // Identify the area of spectrum where the noise dominates
-    std::vector<bool> noise_indices;
-    IdentifyNoiseRegions(power_spectrum, f0(r), &noise_indices);
-
-    // Recreate a noise spectrum by interpolating from the noise
-    // regions obtained previously.
-    // padded_window contains the FFT coefficients
-    ObtainNoiseSpectrum(padded_window, noise_indices, &tmp_spectrum);
-    ComputePowerSpectrum(&tmp_spectrum);
-    SubVector<BaseFloat> noise_spectrum(tmp_spectrum, 0,
-                                        padded_window_size_/2 + 1);
-
-    // Compute energy bands of noise power spectrum.
-    if (opts_.use_hts_bands || dim_out == 5)
-      ComputeHtsBands(noise_spectrum, &noise_binned_energies);
-    else
-      freq_banks_->Compute(noise_spectrum, &noise_binned_energies);
-
-    // Normalise noise energy by the total energy in the band
-    for (int i = 0; i < noise_binned_energies.Dim(); i++) {
-      noise_binned_energies(i) /= binned_energies(i);
-      // Prevent overflows
-      if (noise_binned_energies(i) >= 1.0) noise_binned_energies(i) = 1.0;
-      if (noise_binned_energies(i) <= 1e-15) noise_binned_energies(i) = 1e-15;
-    }
-    noise_binned_energies.ApplyLog();  // take the log
-    this_ap_energy.CopyFromVec(noise_binned_energies);
+void AperiodicEnergy::ComputeFrame(const VectorBase<BaseFloat> &wave,
+                                   int32 frame, BaseFloat voicing_prob,
+                                   BaseFloat f0, FrameScratch *scratch,
+                                   SubVector<BaseFloat> *ap_energy) const {
+  KALDI_VLOG(2) << "Computing frame " << frame << " with F0 " << f0;
+  // BP: this code allows us to speed things up a bit for unvoiced regions
+  if (voicing_prob <= 0.0) {  // unvoiced region
+    // While the aperiodic energy will not be used during synthesis of the
+    // unvoiced regions, it is still modeled as a separate stream in the HMM
+    // and so we set it to the log-filterbank values.
+    ap_energy->SetZero();
+    return;
+  }
+  int32 dim_out = ap_energy->Dim();
+  Vector<BaseFloat> &fft_coeffs = scratch->fft_coeffs,
+      &binned_energies = scratch->binned_energies,
+      &noise_binned_energies = scratch->noise_binned_energies;
+  ExtractWindow(0, wave, frame, opts_.frame_opts, feature_window_function_,
+                &scratch->wave_window, NULL);
+  int32 window_size = scratch->wave_window.Dim();
+  fft_coeffs.SetZero();
+  fft_coeffs.Range(padded_window_size_/2 - window_size/2, window_size).
+    CopyFromVec(scratch->wave_window);
+  srfft_->Compute(fft_coeffs.Data(), true, &scratch->fft_buffer);
+
+  scratch->spectrum.CopyFromVec(fft_coeffs);
+  ComputePowerSpectrum(&scratch->spectrum);
+  SubVector<BaseFloat> power_spectrum(scratch->spectrum, 0,
+                                      padded_window_size_/2 + 1);
+
+  // Compute energy bands of signal power spectrum; the aperiodic energy
+  // will be the ratio of noise over signal.
+  // NB: we use ComputeHtsBands only for legacy support
+  if (opts_.use_hts_bands && dim_out == 5)
+    ComputeHtsBands(power_spectrum, &binned_energies);
+  else
+    freq_banks_->Compute(power_spectrum, &binned_energies);
+
+  // Identify the area of spectrum where the noise dominates
+  IdentifyNoiseRegions(power_spectrum, f0, scratch);
+
+  // Recreate a noise spectrum by interpolating from the noise
+  // regions obtained previously.
+  // fft_coeffs contains the FFT coefficients
+  ObtainNoiseSpectrum(fft_coeffs, scratch->noise_indices, &scratch->spectrum);
+  ComputePowerSpectrum(&scratch->spectrum);
+  SubVector<BaseFloat> noise_spectrum(scratch->spectrum, 0,
+                                      padded_window_size_/2 + 1);
+
+  // Compute energy bands of noise power spectrum.
+  if (opts_.use_hts_bands || dim_out == 5)
+    ComputeHtsBands(noise_spectrum, &noise_binned_energies);
+  else
+    freq_banks_->Compute(noise_spectrum, &noise_binned_energies);
+
+  // Normalise noise energy by the total energy in the band
+  for (int i = 0; i < noise_binned_energies.Dim(); i++) {
+    noise_binned_energies(i) /= binned_energies(i);
+    // Prevent overflows
+    if (noise_binned_energies(i) >= 1.0) noise_binned_energies(i) = 1.0;
+    if (noise_binned_energies(i) <= 1e-15) noise_binned_energies(i) = 1e-15;
   }
+  noise_binned_energies.ApplyLog();  // take the log
+  ap_energy->CopyFromVec(noise_binned_energies);
 }
 
 // For voiced regions, we reconstruct the harmonic spectrum from the
 // cepstral coefficients around the cepstral peak corresponding to F0.
 // The frequency samples for which the harmonic spectrum reaches minimum
-// values are considered to be "pure noise" and are returned.
+// values are considered to be "pure noise" and are returned in
+// scratch->noise_indices.
 void AperiodicEnergy::IdentifyNoiseRegions(
     const VectorBase<BaseFloat> &power_spectrum,
     BaseFloat f0,
-    std::vector<bool> *noise_indices) {
-  KALDI_ASSERT(noise_indices != NULL);
+    FrameScratch *scratch) const {
+  KALDI_ASSERT(scratch != NULL);
   KALDI_ASSERT(power_spectrum.Dim() == padded_window_size_/2+1 && "Power "
                "spectrum size expected to be half of padded window plus 1.");
   BaseFloat sampling_freq = opts_.frame_opts.samp_freq;
@@ -316,11 +384,13 @@ void AperiodicEnergy::IdentifyNoiseRegions(
                                                  opts_.f0_width * 0.5));
   int32 transition_width = static_cast<int32>(round(max_f0_index * 0.1));
   int32 cepstrum_peak_width;
-  noise_indices->resize(padded_window_size_/2+1, false);
+  std::vector<bool> &noise_indices = scratch->noise_indices;
 
-  Vector<BaseFloat> noise_spectrum(padded_window_size_, kSetZero);
-  Vector<BaseFloat> test_cepstrum(padded_window_size_, kSetZero);
-  Vector<BaseFloat> abs_cepstrum(padded_window_size_, kSetZero);
+  Vector<BaseFloat> &noise_spectrum = scratch->cepstrum;
+  // Used to find the cepstral peak, then to test its quality
+  Vector<BaseFloat> &abs_cepstrum = scratch->abs_cepstrum;
+  noise_spectrum.SetZero();
+  abs_cepstrum.SetZero();
 
   noise_spectrum.Range(0, padded_window_size_/2+1).CopyFromVec(power_spectrum);
   // Hacky: to avoid high frequency noise in cepstrum, we do a
@@ -338,7 +408,7 @@ void AperiodicEnergy::IdentifyNoiseRegions(
   }
 
   // Compute Real Cepstrum
-  PowerSpectrumToRealCepstrum(&noise_spectrum);
+  PowerSpectrumToRealCepstrum(&noise_spectrum, *srfft_, &scratch->fft_buffer);
 
   // All cepstral coefficients below the one corresponding to maximum F0 are
   // considered to correspond to vocal tract characteristics and ignored from
@@ -354,30 +424,30 @@ void AperiodicEnergy::IdentifyNoiseRegions(
       abs_cepstrum(i) = fabs(noise_spectrum(i));
   }
   abs_cepstrum.Max(&cepstrum_peak_index);
+  BaseFloat cepstrum_peak_value = abs_cepstrum(cepstrum_peak_index);
   cepstrum_peak_width = static_cast<int32>(round(cepstrum_peak_index *
                                                  opts_.f0_width * 0.5));
   // Estimate quality of peak by zeroing peak area and getting max of
   // left-over absolute cepstrum
-  test_cepstrum.CopyFromVec(abs_cepstrum);
   //   1. Set to 0 from peak_index-npeak_width to peak_index+npeak_width.
   // (But maybe we should actually set everything above
   // peak_index-npeak_width to 0?)
-  test_cepstrum.Range(cepstrum_peak_index - cepstrum_peak_width,
-                      cepstrum_peak_width * 2).SetZero();
+  abs_cepstrum.Range(cepstrum_peak_index - cepstrum_peak_width,
+                     cepstrum_peak_width * 2).SetZero();
   //   2. Find vestigial peak
-  test_cepstrum.Max(&test_index);
+  abs_cepstrum.Max(&test_index);
   // Estimate peak quality from ratio of peak amplitudes.
   // Quality between 0.0 (very bad) and 1.0 (perfect). In unvoiced
   // region the peak should be less than 0.1, in well voiced region
   // above 0.5
-  BaseFloat cepstrum_peak_quality = (1.0 - test_cepstrum(test_index) /
+  BaseFloat cepstrum_peak_quality = (1.0 - abs_cepstrum(test_index) /
                                      noise_spectrum(cepstrum_peak_index));
 
   if (cepstrum_peak_index < f0_index - f0_peak_width ||
       cepstrum_peak_index > f0_index + f0_peak_width) {
     KALDI_VLOG(2)
       << "Actual cepstral peak (index=" << cepstrum_peak_index << "; value = "
-      << abs_cepstrum(cepstrum_peak_index) << "; quality = "
+      << cepstrum_peak_value << "; quality = "
       << cepstrum_peak_quality << ") occurs too far from F0 (index="
       << f0_index << "; value = " << noise_spectrum(f0_index) << ").";
   }
@@ -394,7 +464,8 @@ void AperiodicEnergy::IdentifyNoiseRegions(
 
   // Generating harmonic spectrum from cepstral coefficients located
   // around cepstral / f0 peak
-  Vector<BaseFloat> harmonic_spectrum(padded_window_size_, kSetZero);
+  Vector<BaseFloat> &harmonic_spectrum = scratch->harmonic_spectrum;
+  harmonic_spectrum.SetZero();
   // Note that at this point noise_spectrum contains cepstral coeffs
   // energy
   // In the range of interest, we copy the ceps to harmonic_spectrum
@@ -413,7 +484,8 @@ void AperiodicEnergy::IdentifyNoiseRegions(
     }
   }
   // Get log spectrum of harmonic cepstrum
-  RealCepstrumToMagnitudeSpectrum(&harmonic_spectrum, false);
+  RealCepstrumToMagnitudeSpectrum(&harmonic_spectrum, false, *srfft_,
+                                  &scratch->fft_buffer);
 
   // We find the "negative peaks" of the harmonic spectrum, we
   // consider these will always correspond to pure noise spectrum
@@ -435,9 +507,9 @@ void AperiodicEnergy::IdentifyNoiseRegions(
     //     - in 0, the aperiodic energy should always be 0.0!
     if (i > 0 && i < padded_window_size_/2 &&
         _is_neg_peak(harmonic_spectrum, i)) {
-      (*noise_indices)[i] = true;
+      noise_indices[i] = true;
     } else {
-      (*noise_indices)[i] = false;
+      noise_indices[i] = false;
     }
   }
 }
@@ -448,18 +520,12 @@ void AperiodicEnergy::IdentifyNoiseRegions(
 void AperiodicEnergy::ObtainNoiseSpectrum(
   const VectorBase<BaseFloat> &fft_coeffs,
   const std::vector<bool> &noise_indices,
-  Vector<BaseFloat> *noise_spectrum) {
+  VectorBase<BaseFloat> *noise_spectrum) const {
   KALDI_ASSERT(noise_spectrum != NULL);
   KALDI_ASSERT(noise_spectrum->Dim() == padded_window_size_);
 
   noise_spectrum->SetZero();
-  Vector<BaseFloat> prev_estimate(padded_window_size_, kSetZero);
-  Vector<BaseFloat> debug_spectrum(padded_window_size_, kSetZero);
-  Vector<BaseFloat> window_array(padded_window_size_, kSetZero);
-  int32 window_size = opts_.frame_opts.WindowSize();
   int32 last_index = -1;
-  window_array.Range(padded_window_size_/2 - window_size/2, window_size).
-    CopyFromVec(feature_window_function_.window);
 
   // Build Noise FFT by copying frequencies marked as noise and
   // interpolating between them.
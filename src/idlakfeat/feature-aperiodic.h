@@ -41,6 +41,8 @@ struct AperiodicEnergyOptions {
                                // ultimately removed when using Kaldi F0.
   bool use_hts_bands;          //
   bool debug_aperiodic;
+  int32 num_threads;           // frames are split between this many threads,
+                               // programs register it if they want it
 
   AperiodicEnergyOptions() : banks_opts(5),
                              energy_floor(FLT_EPSILON),
@@ -50,7 +52,8 @@ struct AperiodicEnergyOptions {
                              quality_threshold(0.4),
                              frame_diff_tolerance(1),
                              use_hts_bands(false),
-                             debug_aperiodic(false) {
+                             debug_aperiodic(false),
+                             num_threads(1) {
     // We use a separate explicit window that has a power of two
     // size, and copy zero-padded extracted frames there. This
     // allows for better control over the number of generated samples.
@@ -105,25 +108,47 @@ class AperiodicEnergy {
 
   Vector<BaseFloat> CenterFreqs() { return freq_banks_->GetCenterFreqs(); }
 
+  /// The frames are split between opts.num_threads threads, each with its
+  /// own scratch buffers, so no memory is allocated per frame
   void Compute(const VectorBase<BaseFloat> &wave,
                const VectorBase<BaseFloat> &voicing_prob,
                const VectorBase<BaseFloat> &f0,
-               Matrix<BaseFloat> *output);
+               Matrix<BaseFloat> *output) const;
   
   const Vector<BaseFloat> &GetBandStarts() const { return band_starts_; }
   const Vector<BaseFloat> &GetBandCenters() const { return band_centers_; }
   const Vector<BaseFloat> &GetBandEnds() const { return band_ends_; }
 
  private:
+  // Buffers used by one thread, sized once for the padded window
+  struct FrameScratch {
+    explicit FrameScratch(int32 padded_window_size, int32 num_bins);
+    Vector<BaseFloat> wave_window;
+    Vector<BaseFloat> fft_coeffs;
+    Vector<BaseFloat> spectrum;
+    Vector<BaseFloat> cepstrum;
+    Vector<BaseFloat> abs_cepstrum;
+    Vector<BaseFloat> harmonic_spectrum;
+    Vector<BaseFloat> binned_energies;
+    Vector<BaseFloat> noise_binned_energies;
+    std::vector<bool> noise_indices;
+    std::vector<BaseFloat> fft_buffer;
+  };
+  class FrameWorker;
+
   void FindBandLocations();
+  void ComputeFrame(const VectorBase<BaseFloat> &wave,
+                    int32 frame, BaseFloat voicing_prob, BaseFloat f0,
+                    FrameScratch *scratch,
+                    SubVector<BaseFloat> *ap_energy) const;
   void IdentifyNoiseRegions(const VectorBase<BaseFloat> &power_spectrum,
                             BaseFloat f0,
-                            std::vector<bool> *noise_indices);
-  void ObtainNoiseSpectrum(const VectorBase<BaseFloat> &power_spectrum,
+                            FrameScratch *scratch) const;
+  void ObtainNoiseSpectrum(const VectorBase<BaseFloat> &fft_coeffs,
                            const std::vector<bool> &noise_indices,
-                           Vector<BaseFloat> *noise_spectrum);
+                           VectorBase<BaseFloat> *noise_spectrum) const;
   void ComputeHtsBands(const VectorBase<BaseFloat> &power_spectrum,
-                       Vector<BaseFloat> *output);
+                       VectorBase<BaseFloat> *output) const;
 
   AperiodicEnergyOptions opts_;
   FeatureWindowFunction feature_window_function_;
@@ -0,0 +1,82 @@
+// idlakfeat/feature-mcep-test.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "idlakfeat/feature-mcep.h"
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+static void UnitTestMcep() {
+  WaveData wave;
+  {
+    std::ifstream is("../feat/test_data/test.wav");
+    wave.Read(is);
+  }
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+
+  McepOptions opts;
+  opts.frame_opts.samp_freq = wave.SampFreq();
+  opts.mcep_order = 39;
+  opts.alpha = 0.42;
+  McepComputer mcep(opts);
+  Matrix<BaseFloat> m;
+  mcep.Compute(waveform, &m);
+  KALDI_ASSERT(m.NumRows() == NumFrames(waveform.Dim(), opts.frame_opts));
+  KALDI_ASSERT(m.NumCols() == 40 && !m.IsZero());
+  KALDI_ASSERT(!KALDI_ISNAN(m.Sum()) && !KALDI_ISINF(m.Sum()));
+
+  // Without warping the mcep of the full order is the cepstrum of the log
+  // magnitude of each frame, which gives back the log spectrum
+  int32 padded_window_size = opts.frame_opts.PaddedWindowSize(),
+      half_size = padded_window_size / 2;
+  opts.alpha = 0.0;
+  opts.mcep_order = half_size;
+  opts.normalize_window = false;
+  opts.power_floor = 0.0;
+  McepComputer cepstrum(opts);
+  cepstrum.Compute(waveform, &m);
+
+  FeatureWindowFunction window_function(opts.frame_opts);
+  Vector<BaseFloat> window;
+  for (int32 r = 0; r < m.NumRows(); r += 17) {
+    ExtractWindow(0, waveform, r, opts.frame_opts, window_function, &window,
+                  NULL);
+    Vector<double> log_spectrum(window);
+    RealFft(&log_spectrum, true);
+    ComputePowerSpectrum(&log_spectrum);
+    SubVector<double> expected(log_spectrum, 0, half_size + 1);
+    expected.ApplyLog();
+    expected.Scale(0.5);
+
+    // Halve the folded quefrencies to get back the symmetric cepstrum
+    Vector<double> real_cepstrum(padded_window_size);
+    real_cepstrum.Range(0, half_size + 1).CopyFromVec(m.Row(r));
+    real_cepstrum.Range(1, half_size - 1).Scale(0.5);
+    RealCepstrumToMagnitudeSpectrum(&real_cepstrum, false);
+    SubVector<double> magnitude(real_cepstrum, 0, half_size + 1);
+    KALDI_ASSERT(magnitude.ApproxEqual(expected, 1.0e-04));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestMcep();
+  std::cout << "Tests succeeded.\n";
+  return 0;
+}
@@ -21,6 +21,7 @@
 
 #include "feat/feature-functions.h"
 #include "matrix/matrix-functions.h"
+#include "idlakfeat/feature-mcep.h"
 
 
 namespace kaldi {
@@ -48,8 +49,9 @@ void ComputePowerSpectrum(VectorBase<Real> *complex_fft) {
 template void ComputePowerSpectrum(VectorBase<float> *complex_fft);
 template void ComputePowerSpectrum(VectorBase<double> *complex_fft);
 
+// Reconstructs the symmetric log magnitude spectrum before the IFFT
 template<class Real>
-void PowerSpectrumToRealCepstrum(VectorBase<Real> *power_spectrum) {
+static void PowerSpectrumToLogSymmetric(VectorBase<Real> *power_spectrum) {
   int32 dim = power_spectrum->Dim();
   int32 half_dim = dim/2;
   power_spectrum->Range(0, half_dim + 1).ApplyLog();
@@ -62,24 +64,51 @@ void PowerSpectrumToRealCepstrum(VectorBase<Real> *power_spectrum) {
     (*power_spectrum)(dim - 2*i + 1) = 0;
   }
   (*power_spectrum)(1) = nyquist_power;
+}
+
+template<class Real>
+void PowerSpectrumToRealCepstrum(VectorBase<Real> *power_spectrum) {
+  PowerSpectrumToLogSymmetric(power_spectrum);
   RealFft(power_spectrum, false);  // Doing IFFT.
-  power_spectrum->Scale(1.0 / dim);
+  power_spectrum->Scale(1.0 / power_spectrum->Dim());
+}
+
+template<class Real>
+void PowerSpectrumToRealCepstrum(VectorBase<Real> *power_spectrum,
+                                 const SplitRadixRealFft<Real> &srfft,
+                                 std::vector<Real> *temp_buffer) {
+  PowerSpectrumToLogSymmetric(power_spectrum);
+  srfft.Compute(power_spectrum->Data(), false, temp_buffer);  // Doing IFFT.
+  power_spectrum->Scale(1.0 / power_spectrum->Dim());
 }
 
 template void PowerSpectrumToRealCepstrum(VectorBase<float> *power_spectrum);
 template void PowerSpectrumToRealCepstrum(VectorBase<double> *power_spectrum);
+template void PowerSpectrumToRealCepstrum(
+    VectorBase<float> *power_spectrum, const SplitRadixRealFft<float> &srfft,
+    std::vector<float> *temp_buffer);
+template void PowerSpectrumToRealCepstrum(
+    VectorBase<double> *power_spectrum, const SplitRadixRealFft<double> &srfft,
+    std::vector<double> *temp_buffer);
 
 
+// Reconstructs the symmetric real cepstrum before the FFT
 template<class Real>
-void RealCepstrumToMagnitudeSpectrum(VectorBase<Real> *real_cepstrum,
-                                     bool apply_exp) {
+static void SymmetriseRealCepstrum(VectorBase<Real> *real_cepstrum) {
   int32 dim = real_cepstrum->Dim();
   int32 half_dim = dim/2;
   // Now reconstruct the last N/2 - 1 elements of the symmetric cepstrum that
   // correspond to the negative quefrencies.
   for (int32 i = 1; i < half_dim; i++)
     (*real_cepstrum)(dim-i) = (*real_cepstrum)(i);
-  RealFft(real_cepstrum, true);
+}
+
+// Takes the real part of the FFT of a symmetric real cepstrum
+template<class Real>
+static void MagnitudeSpectrumFromFft(VectorBase<Real> *real_cepstrum,
+                                     bool apply_exp) {
+  int32 dim = real_cepstrum->Dim();
+  int32 half_dim = dim/2;
   Real last_spectrum = (*real_cepstrum)(1);
   for (int32 i = 1; i < half_dim; i++) {
     Real real = (*real_cepstrum)(i*2),
@@ -96,14 +125,102 @@ void RealCepstrumToMagnitudeSpectrum(VectorBase<Real> *real_cepstrum,
     real_cepstrum->Range(0, half_dim+1).ApplyExp();
 }
 
+template<class Real>
+void RealCepstrumToMagnitudeSpectrum(VectorBase<Real> *real_cepstrum,
+                                     bool apply_exp) {
+  SymmetriseRealCepstrum(real_cepstrum);
+  RealFft(real_cepstrum, true);
+  MagnitudeSpectrumFromFft(real_cepstrum, apply_exp);
+}
+
+template<class Real>
+void RealCepstrumToMagnitudeSpectrum(VectorBase<Real> *real_cepstrum,
+                                     bool apply_exp,
+                                     const SplitRadixRealFft<Real> &srfft,
+                                     std::vector<Real> *temp_buffer) {
+  SymmetriseRealCepstrum(real_cepstrum);
+  srfft.Compute(real_cepstrum->Data(), true, temp_buffer);
+  MagnitudeSpectrumFromFft(real_cepstrum, apply_exp);
+}
+
 template void RealCepstrumToMagnitudeSpectrum(VectorBase<float> *real_cepstrum,
                                               bool apply_exp);
 template void RealCepstrumToMagnitudeSpectrum(VectorBase<double> *real_cepstrum,
                                               bool apply_exp);
+template void RealCepstrumToMagnitudeSpectrum(
+    VectorBase<float> *real_cepstrum, bool apply_exp,
+    const SplitRadixRealFft<float> &srfft, std::vector<float> *temp_buffer);
+template void RealCepstrumToMagnitudeSpectrum(
+    VectorBase<double> *real_cepstrum, bool apply_exp,
+    const SplitRadixRealFft<double> &srfft, std::vector<double> *temp_buffer);
+
+
+McepComputer::McepComputer(const McepOptions &opts)
+    : opts_(opts), feature_window_function_(opts.frame_opts),
+      srfft_(opts.frame_opts.PaddedWindowSize()), window_scale_(1.0) {
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  if (padded_window_size & (padded_window_size - 1))
+    KALDI_ERR << "The padded window size must be a power of two, use "
+              << "--round-to-power-of-two=true";
+  if (opts_.mcep_order < 0 || opts_.mcep_order > padded_window_size / 2)
+    KALDI_ERR << "Bad mcep order " << opts_.mcep_order << " for an FFT of "
+              << padded_window_size << " points";
+  if (opts_.alpha <= -1.0 || opts_.alpha >= 1.0)
+    KALDI_ERR << "All-pass constant must be in (-1, 1), got " << opts_.alpha;
+  if (opts_.normalize_window) {
+    const Vector<BaseFloat> &window = feature_window_function_.window;
+    window_scale_ = 1.0 / std::sqrt(VecVec(window, window));
+  }
+}
 
+void McepComputer::FrequencyWarp(const VectorBase<double> &cepstrum,
+                                 VectorBase<double> *mcep,
+                                 Vector<double> *d, Vector<double> *g) const {
+  int32 order = mcep->Dim() - 1;
+  double alpha = opts_.alpha, b = 1.0 - alpha * alpha;
+  g->SetZero();
+  // Recursion over the cepstrum from the highest quefrency down
+  for (int32 i = cepstrum.Dim() - 1; i >= 0; i--) {
+    d->CopyFromVec(*g);
+    (*g)(0) = cepstrum(i) + alpha * (*d)(0);
+    if (order >= 1)
+      (*g)(1) = b * (*d)(0) + alpha * (*d)(1);
+    for (int32 j = 2; j <= order; j++)
+      (*g)(j) = (*d)(j - 1) + alpha * ((*d)(j) - (*g)(j - 1));
+  }
+  mcep->CopyFromVec(*g);
+}
 
-
-
-
+void McepComputer::Compute(const VectorBase<BaseFloat> &wave,
+                           Matrix<BaseFloat> *output) const {
+  KALDI_ASSERT(output != NULL);
+  int32 num_frames = NumFrames(wave.Dim(), opts_.frame_opts),
+      padded_window_size = opts_.frame_opts.PaddedWindowSize(),
+      half_size = padded_window_size / 2;
+  if (num_frames == 0)
+    KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
+  output->Resize(num_frames, Dim(), kUndefined);
+
+  Vector<BaseFloat> window;
+  Vector<double> spectrum(padded_window_size, kUndefined),
+      mcep(Dim(), kUndefined), d(Dim(), kUndefined), g(Dim(), kUndefined);
+  std::vector<double> fft_buffer(padded_window_size);
+  for (int32 r = 0; r < num_frames; r++) {
+    ExtractWindow(0, wave, r, opts_.frame_opts, feature_window_function_,
+                  &window, NULL);
+    spectrum.CopyFromVec(window);
+    spectrum.Scale(window_scale_);
+    srfft_.Compute(spectrum.Data(), true, &fft_buffer);
+    ComputePowerSpectrum(&spectrum);
+    spectrum.Range(0, half_size + 1).Add(opts_.power_floor);
+    PowerSpectrumToRealCepstrum(&spectrum, srfft_, &fft_buffer);
+    // The causal cepstrum of the log magnitude, the negative quefrencies
+    // are folded onto the positive ones
+    SubVector<double> cepstrum(spectrum, 0, half_size + 1);
+    cepstrum.Range(1, half_size - 1).Scale(2.0);
+    FrequencyWarp(cepstrum, &mcep, &d, &g);
+    output->Row(r).CopyFromVec(mcep);
+  }
+}
 
 }  // namespace kaldi
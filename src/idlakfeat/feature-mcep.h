@@ -28,6 +28,7 @@
 #include "matrix/matrix-lib.h"
 #include "util/common-utils.h"
 #include "base/kaldi-error.h"
+#include "feat/feature-window.h"
 
 namespace kaldi {
 /// @addtogroup  feat FeatureExtraction
@@ -59,6 +60,14 @@ template<class Real> void ComputePowerSpectrum(VectorBase<Real> *complex_fft);
 template<class Real>
 void PowerSpectrumToRealCepstrum(VectorBase<Real> *power_spectrum);
 
+/// As above, but the IFFT is done with srfft which must have the size of
+/// power_spectrum, using temp_buffer as its workspace. Several threads can
+/// share srfft if each has its own temp_buffer.
+template<class Real>
+void PowerSpectrumToRealCepstrum(VectorBase<Real> *power_spectrum,
+                                 const SplitRadixRealFft<Real> &srfft,
+                                 std::vector<Real> *temp_buffer);
+
 /// RealCepsToMagnitudeSpec takes the output of PowerSpecToRealCeps
 /// and computes an N-point FFT. PowerSpecToRealCeps computes only the
 /// first N/2 + 1 elements (corresponding to positive
@@ -73,8 +82,84 @@ template<class Real>
 void RealCepstrumToMagnitudeSpectrum(VectorBase<Real> *real_cepstrum,
                                      bool apply_exp);
 
-
-
+/// As above, with the FFT done by srfft as for PowerSpectrumToRealCepstrum
+template<class Real>
+void RealCepstrumToMagnitudeSpectrum(VectorBase<Real> *real_cepstrum,
+                                     bool apply_exp,
+                                     const SplitRadixRealFft<Real> &srfft,
+                                     std::vector<Real> *temp_buffer);
+
+
+/// McepOptions contains the options for mel-cepstral analysis. The defaults
+/// are those of the SPTK based compute-mcep-feats.sh this replaces: a 48kHz
+/// Blackman window normalised to unit power, no pre-processing and the frame
+/// zero-padded to a power of two. Frames are centred as for the pitch and
+/// aperiodic energy features.
+struct McepOptions {
+  FrameExtractionOptions frame_opts;
+  int32 mcep_order;  // e.g. 60, there are order + 1 coefficients
+  BaseFloat alpha;  // all-pass constant of the frequency warping
+  BaseFloat power_floor;  // added to the periodogram before taking its log
+  bool normalize_window;  // scale the window to unit power
+
+  McepOptions() : mcep_order(60), alpha(0.55), power_floor(1.0e-08),
+                  normalize_window(true) {
+    frame_opts.samp_freq = 48000;
+    frame_opts.frame_shift_ms = 5.0;
+    frame_opts.frame_length_ms = 25.0;
+    frame_opts.dither = 0.0;
+    frame_opts.preemph_coeff = 0.0;
+    frame_opts.remove_dc_offset = false;
+    frame_opts.window_type = "blackman";
+    frame_opts.snip_edges = false;
+  }
+
+  void Register(OptionsItf *opts) {
+    frame_opts.Register(opts);
+    opts->Register("mcep-order", &mcep_order,
+                   "Order of the mel-cepstrum, the features have one more "
+                   "dimension than this");
+    opts->Register("alpha", &alpha,
+                   "All-pass constant for the frequency warping, e.g. 0.42 "
+                   "at 16kHz, 0.55 at 48kHz");
+    opts->Register("power-floor", &power_floor,
+                   "Small value added to the periodogram before the log");
+    opts->Register("normalize-window", &normalize_window,
+                   "Scale the window to unit power, as SPTK window does");
+  }
+};
+
+/// Computes mel-cepstra of a waveform frame by frame: the real cepstrum of
+/// the log periodogram of each windowed frame is frequency warped by an
+/// all-pass transform (SPTK freqt). This is what SPTK mcep gives without
+/// Newton-Raphson iterations, as compute-mcep-feats.sh ran it (-j 0).
+///
+/// Compute is const and allocates its buffers per call, so one computer
+/// can be shared by threads working on different utterances.
+class McepComputer {
+ public:
+  explicit McepComputer(const McepOptions &opts);
+
+  int32 Dim() const { return opts_.mcep_order + 1; }
+
+  /// Output has a row per frame, throws if no frame fits in the waveform
+  void Compute(const VectorBase<BaseFloat> &wave,
+               Matrix<BaseFloat> *output) const;
+
+ private:
+  // The all-pass frequency transform of cepstrum into mcep (SPTK freqt),
+  // d and g are work space
+  void FrequencyWarp(const VectorBase<double> &cepstrum,
+                     VectorBase<double> *mcep, Vector<double> *d,
+                     Vector<double> *g) const;
+
+  McepOptions opts_;
+  FeatureWindowFunction feature_window_function_;
+  SplitRadixRealFft<double> srfft_;
+  double window_scale_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(McepComputer);
+};
 
 /// @} End of "addtogroup feat"
 }  // namespace kaldi
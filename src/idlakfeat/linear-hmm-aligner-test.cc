@@ -0,0 +1,189 @@
+// idlakfeat/linear-hmm-aligner-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include "idlakfeat/linear-hmm-aligner.h"
+#include "tree/context-dep.h"
+
+namespace kaldi {
+
+// A left-to-right topology with one or two states per pdf-class, self-loops,
+// and skips over one state.
+static HmmTopology GenLeftToRightTopology(
+    const std::vector<int32> &phones,
+    const std::vector<int32> &num_pdf_classes) {
+  std::ostringstream os;
+  os << "<Topology>\n";
+  for (size_t i = 0; i < phones.size(); i++) {
+    os << "<TopologyEntry>\n<ForPhones> " << phones[i] << " </ForPhones>\n";
+    std::vector<int32> state_to_pdf_class;
+    for (int32 c = 0; c < num_pdf_classes[phones[i]]; c++)
+      for (int32 j = RandInt(1, 2); j > 0; j--)
+        state_to_pdf_class.push_back(c);
+    int32 num_states = state_to_pdf_class.size();
+    for (int32 s = 0; s < num_states; s++) {
+      os << "<State> " << s << " <PdfClass> " << state_to_pdf_class[s] << "\n"
+         << "<Transition> " << s << " 0.5\n";
+      if (s + 2 <= num_states)
+        os << "<Transition> " << (s + 1) << " 0.3\n"
+           << "<Transition> " << (s + 2) << " 0.2\n";
+      else
+        os << "<Transition> " << (s + 1) << " 0.5\n";
+      os << "</State>\n";
+    }
+    os << "<State> " << num_states << " </State>\n</TopologyEntry>\n";
+  }
+  os << "</Topology>\n";
+  HmmTopology topo;
+  std::istringstream is(os.str());
+  topo.Read(is, false);
+  return topo;
+}
+
+class TestDecodable: public DecodableInterface {
+ public:
+  TestDecodable(const TransitionModel &trans_model,
+                const Matrix<BaseFloat> &loglikes):
+      trans_model_(trans_model), loglikes_(loglikes) { }
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index) {
+    return loglikes_(frame, trans_model_.TransitionIdToPdf(index));
+  }
+  virtual bool IsLastFrame(int32 frame) const {
+    return frame == loglikes_.NumRows() - 1;
+  }
+  virtual int32 NumFramesReady() const { return loglikes_.NumRows(); }
+  virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+ private:
+  const TransitionModel &trans_model_;
+  const Matrix<BaseFloat> &loglikes_;
+};
+
+// The best score by a plain Viterbi over (phone position, HMM-state), with
+// transition-scale == self-loop-scale == 1.
+static BaseFloat ReferenceViterbi(const TransitionModel &trans_model,
+                                  const ContextDependency &ctx_dep,
+                                  const std::vector<int32> &phones,
+                                  DecodableInterface *decodable) {
+  const BaseFloat kLogZero = -std::numeric_limits<BaseFloat>::infinity();
+  const HmmTopology &topo = trans_model.GetTopo();
+  int32 num_phones = phones.size(), N = ctx_dep.ContextWidth(),
+      P = ctx_dep.CentralPosition();
+  // score[p][h]; p == num_phones, h == 0 is the end.
+  std::vector<std::vector<BaseFloat> > score(num_phones + 1);
+  for (int32 p = 0; p <= num_phones; p++)
+    score[p].resize(p < num_phones ?
+                    topo.TopologyForPhone(phones[p]).size() - 1 : 1, kLogZero);
+  score[0][0] = 0.0;
+  for (int32 t = 0; t < decodable->NumFramesReady(); t++) {
+    std::vector<std::vector<BaseFloat> > next(score);
+    for (int32 p = 0; p <= num_phones; p++)
+      std::fill(next[p].begin(), next[p].end(), kLogZero);
+    for (int32 p = 0; p < num_phones; p++) {
+      std::vector<int32> window(N);
+      for (int32 i = 0; i < N; i++) {
+        int32 pos = p + i - P;
+        window[i] = (pos >= 0 && pos < num_phones ? phones[pos] : 0);
+      }
+      const HmmTopology::TopologyEntry &entry =
+          topo.TopologyForPhone(phones[p]);
+      for (size_t h = 0; h + 1 < entry.size(); h++) {
+        if (score[p][h] == kLogZero) continue;
+        int32 forward_pdf, self_loop_pdf;
+        KALDI_ASSERT(ctx_dep.Compute(window, entry[h].forward_pdf_class,
+                                     &forward_pdf) &&
+                     ctx_dep.Compute(window, entry[h].self_loop_pdf_class,
+                                     &self_loop_pdf));
+        int32 tstate = trans_model.TupleToTransitionState(
+            phones[p], h, forward_pdf, self_loop_pdf);
+        for (size_t k = 0; k < entry[h].transitions.size(); k++) {
+          int32 tid = trans_model.PairToTransitionId(tstate, k),
+              dest = entry[h].transitions[k].first;
+          BaseFloat s = score[p][h] + trans_model.GetTransitionLogProb(tid) +
+              decodable->LogLikelihood(t, tid);
+          BaseFloat &d = (dest + 1 == static_cast<int32>(entry.size()) ?
+                          next[p + 1][0] : next[p][dest]);
+          d = std::max(d, s);
+        }
+      }
+    }
+    score.swap(next);
+  }
+  return score[num_phones][0];
+}
+
+void TestLinearHmmAligner() {
+  std::vector<int32> phone_ids;
+  for (int32 i = 1; i < 10; i++)
+    if (i == 1 || Rand() % 2 == 0)
+      phone_ids.push_back(i);
+  int32 N = RandInt(1, 3), P = RandInt(0, N - 1);
+  std::vector<int32> num_pdf_classes;
+  ContextDependency *ctx_dep = GenRandContextDependencyLarge(
+      phone_ids, N, P, true, &num_pdf_classes);
+  HmmTopology topo = GenLeftToRightTopology(phone_ids, num_pdf_classes);
+  TransitionModel trans_model(*ctx_dep, topo);
+
+  LinearHmmAlignerOptions opts;
+  LinearHmmAligner aligner(trans_model, *ctx_dep, opts);
+  for (int32 u = 0; u < 10; u++) {
+    std::vector<int32> phones(RandInt(1, 6));
+    for (size_t i = 0; i < phones.size(); i++)
+      phones[i] = phone_ids[Rand() % phone_ids.size()];
+    Matrix<BaseFloat> loglikes(RandInt(1, 40), trans_model.NumPdfs());
+    loglikes.SetRandn();
+    TestDecodable decodable(trans_model, loglikes);
+
+    BaseFloat ref_like = ReferenceViterbi(trans_model, *ctx_dep, phones,
+                                          &decodable);
+    std::vector<int32> alignment;
+    BaseFloat like;
+    bool ans = aligner.Align(phones, &decodable, &alignment, &like);
+    KALDI_ASSERT(ans == (ref_like != -std::numeric_limits<BaseFloat>::infinity()));
+    if (!ans) continue;
+    KALDI_ASSERT(ApproxEqual(like, ref_like));
+    KALDI_ASSERT(alignment.size() == static_cast<size_t>(loglikes.NumRows()));
+
+    // The alignment goes through the phones in order, and its score is
+    // "like".
+    BaseFloat check_like = 0.0;
+    std::vector<int32> seen_phones;
+    for (size_t t = 0; t < alignment.size(); t++) {
+      int32 tid = alignment[t], phone = trans_model.TransitionIdToPhone(tid);
+      check_like += trans_model.GetTransitionLogProb(tid) +
+          loglikes(t, trans_model.TransitionIdToPdf(tid));
+      int32 tstate = trans_model.TransitionIdToTransitionState(tid),
+          hmm_state = trans_model.TransitionStateToHmmState(tstate);
+      if (t == 0 || (hmm_state == 0 && trans_model.IsFinal(alignment[t - 1])))
+        seen_phones.push_back(phone);
+    }
+    KALDI_ASSERT(seen_phones == phones);
+    KALDI_ASSERT(trans_model.IsFinal(alignment.back()));
+    KALDI_ASSERT(ApproxEqual(check_like, like));
+  }
+  delete ctx_dep;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    TestLinearHmmAligner();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,269 @@
+// idlakfeat/linear-hmm-aligner.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include "base/cpu-dispatch.h"
+#include "idlakfeat/linear-hmm-aligner.h"
+
+namespace kaldi {
+
+namespace {
+
+// One step of the Viterbi recursion for the arcs with one jump: the sources
+// are prev[0 ... dim-1], and the destinations cur[0 ... dim-1] (the caller
+// offsets the pointers by the jump).  Ties go to the arc group seen first.
+template<CpuIsa isa> struct LinearViterbiKernel {
+  static KALDI_CPU_INLINE void Run(const BaseFloat *prev,
+                                   const BaseFloat *arc_score, int32 dim,
+                                   int32 arc_group, BaseFloat *cur,
+                                   int32 *back) {
+    for (int32 i = 0; i < dim; i++) {
+      BaseFloat score = prev[i] + arc_score[i];
+      bool better = (score > cur[i]);
+      cur[i] = (better ? score : cur[i]);
+      back[i] = (better ? arc_group : back[i]);
+    }
+  }
+};
+
+}  // namespace
+
+
+LinearHmmAligner::LinearHmmAligner(const TransitionModel &trans_model,
+                                   const ContextDependencyInterface &ctx_dep,
+                                   const LinearHmmAlignerOptions &opts):
+    trans_model_(trans_model), ctx_dep_(ctx_dep), opts_(opts),
+    num_states_(0) { }
+
+// As GetScaledTransitionLogProb() in hmm/hmm-utils.cc, which is what
+// AddTransitionProbs() uses for gmm-align-compiled.
+BaseFloat LinearHmmAligner::ScaledLogProb(int32 trans_id) const {
+  BaseFloat transition_scale = opts_.transition_scale,
+      self_loop_scale = opts_.self_loop_scale;
+  if (transition_scale == self_loop_scale) {
+    return trans_model_.GetTransitionLogProb(trans_id) * transition_scale;
+  } else if (trans_model_.IsSelfLoop(trans_id)) {
+    return self_loop_scale * trans_model_.GetTransitionLogProb(trans_id);
+  } else {
+    int32 trans_state = trans_model_.TransitionIdToTransitionState(trans_id);
+    return self_loop_scale * trans_model_.GetNonSelfLoopLogProb(trans_state)
+        + transition_scale *
+        trans_model_.GetTransitionLogProbIgnoringSelfLoops(trans_id);
+  }
+}
+
+bool LinearHmmAligner::InitChain(const std::vector<int32> &phones) {
+  const HmmTopology &topo = trans_model_.GetTopo();
+  int32 num_phones = phones.size(),
+      context_width = ctx_dep_.ContextWidth(),
+      central_pos = ctx_dep_.CentralPosition();
+
+  // The first state of each phone; the last HMM-state of each topology entry
+  // is the final state, which is not a state of the chain: arcs to it go to
+  // the first state of the next phone.
+  std::vector<int32> phone_begin(num_phones + 1);
+  num_states_ = 0;
+  for (int32 p = 0; p < num_phones; p++) {
+    const HmmTopology::TopologyEntry &entry = topo.TopologyForPhone(phones[p]);
+    int32 final_state = entry.size() - 1;
+    if (!entry[final_state].transitions.empty())
+      KALDI_ERR << "LinearHmmAligner: the last HMM-state of phone "
+                << phones[p] << " has transitions.";
+    for (int32 h = 0; h < final_state; h++)
+      if (entry[h].forward_pdf_class == kNoPdf)
+        KALDI_ERR << "LinearHmmAligner: non-emitting HMM-states (phone "
+                  << phones[p] << ") are not supported.";
+    phone_begin[p] = num_states_;
+    num_states_ += final_state;
+  }
+  phone_begin[num_phones] = num_states_;
+
+  struct Arc {
+    int32 jump, source, trans_id;
+    bool operator < (const Arc &other) const { return jump < other.jump; }
+  };
+  std::vector<Arc> arcs;
+  std::vector<int32> phone_window(context_width);
+  for (int32 p = 0; p < num_phones; p++) {
+    int32 phone = phones[p];
+    for (int32 i = 0; i < context_width; i++) {
+      int32 pos = p + i - central_pos;
+      phone_window[i] = (pos >= 0 && pos < num_phones ? phones[pos] : 0);
+    }
+    const HmmTopology::TopologyEntry &entry = topo.TopologyForPhone(phone);
+    int32 final_state = entry.size() - 1;
+    for (int32 h = 0; h < final_state; h++) {
+      int32 forward_pdf, self_loop_pdf;
+      if (!ctx_dep_.Compute(phone_window, entry[h].forward_pdf_class,
+                            &forward_pdf) ||
+          !ctx_dep_.Compute(phone_window, entry[h].self_loop_pdf_class,
+                            &self_loop_pdf)) {
+        KALDI_WARN << "LinearHmmAligner: the tree gives no pdf for phone "
+                   << phone << " (position " << p << ")";
+        return false;
+      }
+      int32 trans_state = trans_model_.TupleToTransitionState(
+          phone, h, forward_pdf, self_loop_pdf);
+      for (size_t k = 0; k < entry[h].transitions.size(); k++) {
+        int32 dest_h = entry[h].transitions[k].first;
+        Arc arc;
+        arc.source = phone_begin[p] + h;
+        arc.jump = (dest_h == final_state ? phone_begin[p + 1] :
+                    phone_begin[p] + dest_h) - arc.source;
+        arc.trans_id = trans_model_.PairToTransitionId(trans_state, k);
+        arcs.push_back(arc);
+      }
+    }
+  }
+
+  std::stable_sort(arcs.begin(), arcs.end());
+  jumps_.clear();
+  arc_trans_ids_.clear();
+  arc_log_probs_.clear();
+  for (size_t a = 0; a < arcs.size(); a++) {
+    if (jumps_.empty() || arcs[a].jump != jumps_.back()) {
+      jumps_.push_back(arcs[a].jump);
+      arc_trans_ids_.push_back(std::vector<int32>(num_states_, 0));
+      arc_log_probs_.push_back(std::vector<BaseFloat>(
+          num_states_, -std::numeric_limits<BaseFloat>::infinity()));
+    }
+    int32 j = jumps_.size() - 1;
+    if (arc_trans_ids_[j][arcs[a].source] != 0)
+      KALDI_ERR << "LinearHmmAligner: two transitions between the same "
+                << "HMM-states are not supported.";
+    arc_trans_ids_[j][arcs[a].source] = arcs[a].trans_id;
+    arc_log_probs_[j][arcs[a].source] = ScaledLogProb(arcs[a].trans_id);
+  }
+
+  // The least number of frames from the start to each state, and from each
+  // state to the end (every arc takes a frame); these give the band of states
+  // to visit on each frame.
+  int32 num_jumps = jumps_.size(), unreachable = std::numeric_limits<int32>::max();
+  frames_from_start_.assign(num_states_ + 1, unreachable);
+  frames_to_end_.assign(num_states_ + 1, unreachable);
+  std::vector<int32> queue(1, 0);
+  frames_from_start_[0] = 0;
+  for (size_t q = 0; q < queue.size(); q++) {
+    int32 s = queue[q];
+    if (s == num_states_) continue;
+    for (int32 j = 0; j < num_jumps; j++) {
+      int32 d = s + jumps_[j];
+      if (arc_trans_ids_[j][s] != 0 && frames_from_start_[d] == unreachable) {
+        frames_from_start_[d] = frames_from_start_[s] + 1;
+        queue.push_back(d);
+      }
+    }
+  }
+  queue.assign(1, num_states_);
+  frames_to_end_[num_states_] = 0;
+  for (size_t q = 0; q < queue.size(); q++) {
+    int32 d = queue[q];
+    for (int32 j = 0; j < num_jumps; j++) {
+      int32 s = d - jumps_[j];
+      if (s >= 0 && s < num_states_ && arc_trans_ids_[j][s] != 0 &&
+          frames_to_end_[s] == unreachable) {
+        frames_to_end_[s] = frames_to_end_[d] + 1;
+        queue.push_back(s);
+      }
+    }
+  }
+  return true;
+}
+
+bool LinearHmmAligner::Align(const std::vector<int32> &phones,
+                             DecodableInterface *decodable,
+                             std::vector<int32> *alignment,
+                             BaseFloat *like) {
+  KALDI_ASSERT(alignment != NULL);
+  alignment->clear();
+  if (phones.empty()) {
+    KALDI_WARN << "LinearHmmAligner: empty phone sequence.";
+    return false;
+  }
+  if (!InitChain(phones))
+    return false;
+  int32 num_frames = decodable->NumFramesReady();
+  if (frames_to_end_[0] > num_frames) {
+    KALDI_WARN << "LinearHmmAligner: " << num_frames << " frames is too few "
+               << "for " << phones.size() << " phones (need at least "
+               << frames_to_end_[0] << ")";
+    return false;
+  }
+
+  const BaseFloat kLogZero = -std::numeric_limits<BaseFloat>::infinity();
+  int32 num_jumps = jumps_.size(), stride = num_states_ + 1;
+  std::vector<BaseFloat> prev(stride, kLogZero), cur(stride),
+      arc_score(num_states_);
+  // back[t * stride + s] is the arc group of the best arc into state s on
+  // frame t.
+  std::vector<int32> back(static_cast<size_t>(num_frames) * stride, 0);
+  prev[0] = 0.0;
+
+  for (int32 t = 0; t < num_frames; t++) {
+    // The band: the emitting states that can be reached on this frame and
+    // still get to the end.
+    int32 lo = num_states_, hi = -1;
+    for (int32 s = 0; s < num_states_; s++) {
+      if (frames_from_start_[s] <= t && frames_to_end_[s] <= num_frames - t) {
+        lo = std::min(lo, s);
+        hi = s;
+      }
+    }
+    std::fill(cur.begin(), cur.end(), kLogZero);
+    int32 *this_back = &(back[static_cast<size_t>(t) * stride]);
+    for (int32 j = 0; j < num_jumps; j++) {
+      int32 jump = jumps_[j],
+          begin = std::max(lo, -jump),
+          end = std::min(hi + 1, stride - jump);
+      if (begin >= end) continue;
+      const int32 *trans_ids = &(arc_trans_ids_[j][0]);
+      const BaseFloat *log_probs = &(arc_log_probs_[j][0]);
+      for (int32 s = begin; s < end; s++)
+        arc_score[s] = (trans_ids[s] != 0 ?
+                        log_probs[s] + decodable->LogLikelihood(t, trans_ids[s]) :
+                        kLogZero);
+      CpuDispatch<LinearViterbiKernel>(
+          static_cast<const BaseFloat*>(&(prev[begin])),
+          static_cast<const BaseFloat*>(&(arc_score[begin])), end - begin, j,
+          &(cur[begin + jump]), this_back + begin + jump);
+    }
+    prev.swap(cur);
+  }
+
+  BaseFloat tot_like = prev[num_states_];
+  if (tot_like == kLogZero || tot_like != tot_like) {
+    KALDI_WARN << "LinearHmmAligner: no path through the HMMs.";
+    return false;
+  }
+  alignment->resize(num_frames);
+  int32 s = num_states_;
+  for (int32 t = num_frames - 1; t >= 0; t--) {
+    int32 j = back[static_cast<size_t>(t) * stride + s];
+    s -= jumps_[j];
+    KALDI_ASSERT(s >= 0 && s < num_states_ && arc_trans_ids_[j][s] != 0);
+    (*alignment)[t] = arc_trans_ids_[j][s];
+  }
+  KALDI_ASSERT(s == 0);
+  if (like != NULL)
+    *like = tot_like;
+  return true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,108 @@
+// idlakfeat/linear-hmm-aligner.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_IDLAKFEAT_LINEAR_HMM_ALIGNER_H_
+#define KALDI_IDLAKFEAT_LINEAR_HMM_ALIGNER_H_
+
+#include <vector>
+#include "base/kaldi-common.h"
+#include "hmm/transition-model.h"
+#include "itf/context-dep-itf.h"
+#include "itf/decodable-itf.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+struct LinearHmmAlignerOptions {
+  BaseFloat transition_scale;
+  BaseFloat self_loop_scale;
+
+  LinearHmmAlignerOptions(): transition_scale(1.0), self_loop_scale(1.0) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("transition-scale", &transition_scale,
+                   "Transition-probability scale [relative to acoustics]");
+    opts->Register("self-loop-scale", &self_loop_scale,
+                   "Scale of self-loop versus non-self-loop log probs "
+                   "[relative to acoustics]");
+  }
+};
+
+/**
+   LinearHmmAligner does forced alignment when the transcription is a known
+   sequence of phones (no optional silence or pronunciation alternatives), as
+   is the case for TTS corpora.  The HMMs of the phones are then a single
+   chain, and instead of compiling a graph and running the generic decoder we
+   run a Viterbi directly on the chain.  The states that cannot be on any path
+   that starts at the first state at frame zero and ends at the end of the last
+   phone at the last frame are skipped, which makes this a banded search, and
+   the arcs of the chain are grouped by how many states they jump, so that the
+   recursion is a few vectorized loops over the states per frame.
+
+   The scores are those that compile-train-graphs and gmm-align-compiled would
+   use with the same scales, so the alignment is the best path of the same
+   graph (the decoder's beam aside).  Topologies with non-emitting states other
+   than the final one are not supported.
+*/
+class LinearHmmAligner {
+ public:
+  LinearHmmAligner(const TransitionModel &trans_model,
+                   const ContextDependencyInterface &ctx_dep,
+                   const LinearHmmAlignerOptions &opts);
+
+  /// Aligns "decodable" to the HMMs of "phones", writing one transition-id per
+  /// frame to "alignment" and the total log-likelihood (acoustic plus scaled
+  /// transition log-probs, as they come from "decodable") to "like" if
+  /// non-NULL.  Returns false (with a warning) if there is no alignment, e.g.
+  /// if there are too few frames or the tree gives no pdf for some context.
+  bool Align(const std::vector<int32> &phones,
+             DecodableInterface *decodable,
+             std::vector<int32> *alignment,
+             BaseFloat *like);
+
+ private:
+  // Sets up the chain for "phones": num_states_ and the arrays of arcs.
+  // Returns false if the tree gives no pdf for some context.
+  bool InitChain(const std::vector<int32> &phones);
+
+  BaseFloat ScaledLogProb(int32 trans_id) const;
+
+  const TransitionModel &trans_model_;
+  const ContextDependencyInterface &ctx_dep_;
+  LinearHmmAlignerOptions opts_;
+
+  // The emitting states of the chain are numbered 0 ... num_states_ - 1, and
+  // num_states_ is the end of the last phone.  Every arc takes one frame.
+  int32 num_states_;
+  // The different values of (destination state - source state) over the
+  // arcs, sorted; the arcs with jump jumps_[j] are in arc_trans_ids_[j] and
+  // arc_log_probs_[j], indexed by source state (transition-id 0 where there is
+  // none).
+  std::vector<int32> jumps_;
+  std::vector<std::vector<int32> > arc_trans_ids_;
+  std::vector<std::vector<BaseFloat> > arc_log_probs_;
+  // For each state (including num_states_), the least number of frames to
+  // get to it from state 0, and to get from it to num_states_.
+  std::vector<int32> frames_from_start_;
+  std::vector<int32> frames_to_end_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKFEAT_LINEAR_HMM_ALIGNER_H_
@@ -16,6 +16,7 @@
 // limitations under the License.
 
 #include "idlakfeat/minmax.h"
+#include "util/kaldi-io.h"
 
 namespace kaldi {
 
@@ -68,6 +69,41 @@ void AccMinmaxStats(const MatrixBase<BaseFloat> &feats,
   }
 }
 
+void AddMinmaxStats(const MatrixBase<double> &other,
+                    MatrixBase<double> *stats) {
+  KALDI_ASSERT(stats != NULL);
+  KALDI_ASSERT(stats->NumRows() == 2 && other.NumRows() == 2 &&
+               stats->NumCols() == other.NumCols());
+  int32 dim = stats->NumCols() - 1;
+  for (int32 d = 0; d < dim; d++) {
+    if (other(0, d) < (*stats)(0, d)) (*stats)(0, d) = other(0, d);
+    if (other(1, d) > (*stats)(1, d)) (*stats)(1, d) = other(1, d);
+  }
+  (*stats)(0, dim) += other(0, dim);
+}
+
+void MinmaxStatsAccumulator::Accumulate(const MatrixBase<BaseFloat> &feats) {
+  if (feats.NumRows() == 0) return;
+  if (stats_.NumRows() == 0)
+    InitMinmaxStats(feats.NumCols(), &stats_);
+  else if (stats_.NumCols() != feats.NumCols() + 1)
+    KALDI_ERR << "Features of dimension " << feats.NumCols()
+              << " do not match minmax stats of dimension "
+              << stats_.NumCols() - 1;
+  AccMinmaxStats(feats, NULL, &stats_);
+}
+
+void MinmaxStatsAccumulator::Write(const std::string &wxfilename,
+                                   bool binary) const {
+  if (Empty()) {
+    KALDI_WARN << "No features for minmax stats, not writing " << wxfilename;
+    return;
+  }
+  Matrix<float> fstats(stats_);
+  Output ko(wxfilename, binary);
+  fstats.Write(ko.Stream(), binary);
+}
+
 void ApplyMinmax(const MatrixBase<double> &stats,
 		 bool var_norm,
 		 MatrixBase<BaseFloat> *feats) {
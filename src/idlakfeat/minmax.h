@@ -20,6 +20,8 @@
 #ifndef KALDI_TRANSFORM_MINMAX_H_
 #define KALDI_TRANSFORM_MINMAX_H_
 
+#include <string>
+
 #include "base/kaldi-common.h"
 #include "matrix/matrix-lib.h"
 
@@ -41,6 +43,28 @@ void AccMinmaxStats(const MatrixBase<BaseFloat> &feats,
                   const VectorBase<BaseFloat> *weights,  // or NULL
                   MatrixBase<double> *stats);
 
+/// Adds stats accumulated separately, e.g. on another thread, to stats
+void AddMinmaxStats(const MatrixBase<double> &other,
+                    MatrixBase<double> *stats);
+
+/// Global stats accumulated one utterance at a time, e.g. while the
+/// features are extracted, so no separate pass over them is needed. Stats
+/// of parallel jobs are merged with sum-minmax-stats.
+class MinmaxStatsAccumulator {
+ public:
+  MinmaxStatsAccumulator() { }
+  /// The dimension is set by the first features
+  void Accumulate(const MatrixBase<BaseFloat> &feats);
+  bool Empty() const { return stats_.NumRows() == 0; }
+  const Matrix<double> &Stats() const { return stats_; }
+  /// Written in the same format as compute-minmax-stats, warns and writes
+  /// nothing if no features were accumulated
+  void Write(const std::string &wxfilename, bool binary) const;
+
+ private:
+  Matrix<double> stats_;
+};
+
 /// Apply cepstral mean and variance normalization to a matrix of features.
 /// If norm_vars == true, expects stats to be of dimension 2 by (dim+1), but
 /// if norm_vars == false, will accept stats of dimension 1 by (dim+1); these
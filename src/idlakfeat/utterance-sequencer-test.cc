@@ -0,0 +1,93 @@
+// idlakfeat/utterance-sequencer-test.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <iostream>
+#include <vector>
+
+#include "base/kaldi-math.h"
+#include "idlakfeat/utterance-sequencer.h"
+
+namespace kaldi {
+
+class SquareTask {
+ public:
+  SquareTask(int32 n, bool fail, std::vector<int32> *output)
+      : n_(n), fail_(fail), square_(0), output_(output) { }
+  void Compute() {
+    if (fail_) KALDI_ERR << "Failed on " << n_;
+    // uneven compute times so that tasks finish out of order
+    Sleep(0.001 * RandInt(0, 3));
+    square_ = n_ * n_;
+  }
+  void Output() { output_->push_back(square_); }
+
+ private:
+  int32 n_;
+  bool fail_;
+  int32 square_;
+  std::vector<int32> *output_;
+};
+
+static void UnitTestUtteranceSequencerOrder() {
+  for (int32 num_threads = 0; num_threads <= 4; num_threads++) {
+    TaskSequencerConfig config;
+    config.num_threads = num_threads;
+    config.num_threads_total = num_threads ? num_threads + 2 : 0;
+    std::vector<int32> output;
+    UtteranceSequencer<SquareTask> sequencer(config);
+    for (int32 n = 0; n < 50; n++)
+      sequencer.Run(new SquareTask(n, false, &output));
+    sequencer.Wait();
+    KALDI_ASSERT(output.size() == 50);
+    for (int32 n = 0; n < 50; n++)
+      KALDI_ASSERT(output[n] == n * n);
+  }
+}
+
+static void UnitTestUtteranceSequencerError() {
+  TaskSequencerConfig config;
+  config.num_threads = 3;
+  std::vector<int32> output;
+  bool thrown = false;
+  try {
+    UtteranceSequencer<SquareTask> sequencer(config);
+    for (int32 n = 0; n < 20; n++)
+      sequencer.Run(new SquareTask(n, n == 5, &output));
+    sequencer.Wait();
+  } catch(const std::exception &e) {
+    thrown = true;
+  }
+  KALDI_ASSERT(thrown);
+  // the failed task is not output
+  for (size_t i = 0; i < output.size(); i++)
+    KALDI_ASSERT(output[i] != 25);
+}
+
+}  // namespace kaldi
+
+int main() {
+  try {
+    kaldi::UnitTestUtteranceSequencerOrder();
+    kaldi::UnitTestUtteranceSequencerError();
+    std::cout << "Tests succeeded.\n";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return 1;
+  }
+}
@@ -0,0 +1,123 @@
+// idlakfeat/utterance-sequencer.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKFEAT_UTTERANCE_SEQUENCER_H_
+#define KALDI_IDLAKFEAT_UTTERANCE_SEQUENCER_H_
+
+#include <mutex>
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+/// Runs the per utterance work of a table processing program on several
+/// threads, with the output in the order the utterances were read.
+///
+/// Task is given each utterance's input by the caller, which has to copy
+/// anything it needs from the table readers as they move on. Task::Compute()
+/// is called on a worker thread. Task::Output() is then called for each task
+/// one at a time, in the order of Run, so it can write to table writers and
+/// update counts without locking. The number of tasks queued or running is
+/// bounded by --num-threads-total, which bounds the memory held.
+///
+/// Exceptions are not allowed to leave a thread, so one thrown by Compute or
+/// Output is kept and thrown from the next Run or from Wait.
+/// Register the options with TaskSequencerConfig::Register, which adds
+/// --num-threads and --num-threads-total.
+template<class Task>
+class UtteranceSequencer {
+ public:
+  explicit UtteranceSequencer(const TaskSequencerConfig &config)
+      : failed_(false), sequencer_(config) { }
+
+  /// Takes ownership of task
+  void Run(Task *task) {
+    CheckError();
+    sequencer_.Run(new SequencedTask(task, this));
+  }
+
+  /// Waits for all the tasks to be output
+  void Wait() {
+    sequencer_.Wait();
+    CheckError();
+  }
+
+ private:
+  class SequencedTask {
+   public:
+    SequencedTask(Task *task, UtteranceSequencer *sequencer)
+        : task_(task), sequencer_(sequencer), failed_(false) { }
+    void operator() () {
+      try {
+        task_->Compute();
+      } catch(const std::exception &e) {
+        failed_ = true;
+        error_ = e.what();
+      }
+    }
+    ~SequencedTask() {
+      if (!failed_) {
+        try {
+          task_->Output();
+        } catch(const std::exception &e) {
+          failed_ = true;
+          error_ = e.what();
+        }
+      }
+      if (failed_) sequencer_->SetError(error_);
+      delete task_;
+    }
+
+   private:
+    Task *task_;
+    UtteranceSequencer *sequencer_;
+    // KALDI_ERR has already logged its message and throws an empty one
+    bool failed_;
+    std::string error_;
+  };
+
+  // Only the first error is kept
+  void SetError(const std::string &error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!failed_) {
+      failed_ = true;
+      error_ = error;
+    }
+  }
+
+  void CheckError() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_)
+      KALDI_ERR << "Processing an utterance failed"
+                << (error_.empty() ? "" : ": ") << error_;
+  }
+
+  std::mutex mutex_;
+  bool failed_;
+  std::string error_;
+  // last so that it waits for the tasks before the rest is destroyed
+  TaskSequencer<SequencedTask> sequencer_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(UtteranceSequencer);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKFEAT_UTTERANCE_SEQUENCER_H_
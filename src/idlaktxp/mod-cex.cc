@@ -16,6 +16,8 @@
 // limitations under the License.
 //
 
+#include <cstdio>
+#include <map>
 #include "idlaktxp/mod-cex.h"
 
 namespace kaldi {
@@ -28,27 +30,23 @@ TxpCex::~TxpCex() {
 bool TxpCex::Init(const TxpParseOptions &opts) {
   opts_ = &opts;
   tpdb_ = opts.GetTpdb();
-  cexspec_.Init(opts, std::string(GetOptValue("arch")));
-  return cexspec_.Parse(tpdb_);
+  cexspec_ = TxpTpdbStore::Get<TxpCexspec>(opts,
+                                            std::string(GetOptValue("arch")));
+  return cexspec_ != nullptr;
 }
 
 bool TxpCex::Process(pugi::xml_document* input) {
+  KALDI_PROFILE_SCOPE("TxpCex::Process");
   std::string* model = new std::string();
   std::string cexfunctions;
   pugi::xml_node header = GetHeader(input);
-  cexspec_.GetFunctionSpec(&header);
-  cexspec_.AddPauseNodes(input);
-  pugi::xpath_node_set tks =
-      input->document_element().select_nodes("//phon");
-  tks.sort();
-  TxpCexspecContext context(*input,  cexspec_.GetPauseHandling());
-  kaldi::int32 i = 0;
-  for (pugi::xpath_node_set::const_iterator it = tks.begin();
-       it != tks.end();
-       ++it, i++, context.Next()) {
-    pugi::xml_node phon = (*it).node();
+  cexspec_->GetFunctionSpec(&header);
+  cexspec_->AddPauseNodes(input);
+  TxpCexspecContext context(*input,  cexspec_->GetPauseHandling());
+  for (kaldi::int32 i = 0; i < context.NumPhones(); i++, context.Next()) {
+    pugi::xml_node phon = context.GetPhone(0, true);
     model->clear();
-    cexspec_.ExtractFeatures(context, model);
+    cexspec_->ExtractFeatures(context, model);
     phon.text() = model->c_str();
   }
   delete model;
@@ -57,8 +55,84 @@ bool TxpCex::Process(pugi::xml_document* input) {
 }
 
 bool TxpCex::IsSptPauseHandling() {
-  if (cexspec_.GetPauseHandling() == CEXSPECPAU_HANDLER_SPURT) return true;
+  if (cexspec_->GetPauseHandling() == CEXSPECPAU_HANDLER_SPURT) return true;
   return false;
 }
 
+bool TxpCex::SetDnnEncoding(
+    const std::vector<std::vector<std::string> > &values) {
+  return encoding_.Init(*cexspec_, values);
+}
+
+bool TxpCex::ProcessDnnFeatures(pugi::xml_document* input,
+                                std::vector<std::string>* ids,
+                                std::vector<Matrix<BaseFloat> >* feats) {
+  std::map<pugi::xml_node, int32> spurt_lkp;
+  std::vector<int32> spurt_rows, phone_spurts, codes;
+  std::vector<const char*> phone_vals;
+  // untitled spurts are numbered from 1
+  int32 untitled = 1;
+  char name[16];
+  bool rval = true;
+  if (!encoding_.Dim()) {
+    KALDI_WARN << "DNN encoding has not been set";
+    return false;
+  }
+  cexspec_->AddPauseNodes(input);
+  TxpCexspecContext context(*input,  cexspec_->GetPauseHandling());
+  const char* group =
+      input->document_element().child("fileid") ? "fileid" : "spt";
+  pugi::xpath_node_set spts =
+      input->document_element().select_nodes((std::string("//") +
+                                              group).c_str());
+  spts.sort();
+  ids->clear();
+  for (pugi::xpath_node_set::const_iterator it = spts.begin();
+       it != spts.end(); ++it) {
+    pugi::xml_node spt = (*it).node();
+    spurt_lkp[spt] = ids->size();
+    if (spt.attribute("id")) {
+      ids->push_back(spt.attribute("id").value());
+    } else {
+      snprintf(name, sizeof(name), "test%03d", untitled++);
+      ids->push_back(name);
+    }
+  }
+  // count the rows of each spurt and find the spurt of each phone, -1 if
+  // the phone is dropped
+  spurt_rows.assign(ids->size(), 0);
+  const char* prev = "";
+  int32 prev_spurt = -1;
+  for (int32 i = 0; i < context.NumPhones(); i++) {
+    pugi::xml_node phon = context.GetPhoneNode(i);
+    const char* val = phon.attribute("val") ?
+        phon.attribute("val").value() : "pau";
+    std::map<pugi::xml_node, int32>::const_iterator spt =
+        spurt_lkp.find(context.GetContextUp(phon, group));
+    int32 s = (spt == spurt_lkp.end()) ? -1 : spt->second;
+    if (s != prev_spurt) prev = "";
+    prev_spurt = s;
+    // split pauses within an utterance only give one input
+    if (s >= 0 && !(!strcmp(prev, "pau") && !strcmp(val, "pau")))
+      spurt_rows[s]++;
+    else
+      s = -1;
+    prev = val;
+    phone_spurts.push_back(s);
+    phone_vals.push_back(val);
+  }
+  feats->resize(ids->size());
+  for (size_t s = 0; s < ids->size(); s++)
+    (*feats)[s].Resize(spurt_rows[s], encoding_.Dim());
+  spurt_rows.assign(ids->size(), 0);
+  for (size_t i = 0; i < phone_spurts.size(); i++, context.Next()) {
+    int32 s = phone_spurts[i];
+    if (s < 0) continue;
+    if (!cexspec_->ExtractFeatures(context, &codes)) rval = false;
+    SubVector<BaseFloat> row((*feats)[s], spurt_rows[s]++);
+    encoding_.Encode(phone_vals[i], codes, &row);
+  }
+  return rval;
+}
+
 }  // namespace kaldi
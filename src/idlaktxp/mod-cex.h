@@ -23,8 +23,12 @@
 // either text, tox (token oriented xml) tokens, or spurts (phrases)
 // containing tox tokens.
 
+#include <memory>
 #include <string>
+#include <vector>
+#include "matrix/kaldi-matrix.h"
 #include "idlaktxp/txpmodule.h"
+#include "idlaktxp/txptpdbstore.h"
 #include "idlaktxp/txpcexspec.h"
 
 namespace kaldi {
@@ -40,11 +44,22 @@ class TxpCex : public TxpModule {
   /// Returns true if the system is splitting mid phrase pauses to allow
   /// spurt processing of model names
   bool IsSptPauseHandling();
+  /// Set the values each feature took in training, see
+  /// TxpCexspecDnnEncoding. Required by ProcessDnnFeatures
+  bool SetDnnEncoding(const std::vector<std::vector<std::string> > &values);
+  /// Extract DNN input features without writing model names. Returns a
+  /// matrix with a row per phone for each spurt, or each fileid if the
+  /// document has them, in the same way as gen/cex.py
+  bool ProcessDnnFeatures(pugi::xml_document* input,
+                          std::vector<std::string>* ids,
+                          std::vector<Matrix<BaseFloat> >* feats);
 
  private:
   /// Object containing specification for feature extraction
-  TxpCexspec cexspec_;
+  std::shared_ptr<TxpCexspec> cexspec_;
   TxpCexspecModels models_;
+  /// Conversion from feature codes to DNN input features
+  TxpCexspecDnnEncoding encoding_;
 };
 
 }  // namespace kaldi
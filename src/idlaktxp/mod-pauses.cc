@@ -26,16 +26,18 @@ static void _insert_break_after(pugi::xml_node* tk,
 static void _insert_break_before(pugi::xml_node* tk,
                                  const TxpPbreakInfo* pbreak);
 
-TxpPauses::TxpPauses() : TxpModule("pauses") {}
+TxpPauses::TxpPauses()
+    : TxpModule("pauses"), infile_(false), breakitem_(false),
+      newline_(false), newline2_(false) {}
 
 bool TxpPauses::Init(const TxpParseOptions &opts) {
   opts_ = &opts;
   tpdb_ = opts.GetTpdb();
-  pbreak_.Init(opts, std::string(GetOptValue("arch")));
+  pbreak_ = TxpTpdbStore::Get<TxpPbreak>(opts, std::string(GetOptValue("arch")));
   hzone_ = GetOptValueBool("hzone");
   hzone_start_ = atoi(GetOptValue("hzone-start"));
   hzone_end_ = atoi(GetOptValue("hzone-end"));
-  return pbreak_.Parse(tpdb_);
+  return pbreak_ != nullptr;
 }
 
 TxpPauses::~TxpPauses() {
@@ -44,6 +46,7 @@ TxpPauses::~TxpPauses() {
 // If fileids are present in the document it breaks the
 // document up by them
 bool TxpPauses::Process(pugi::xml_document* input) {
+  KALDI_PROFILE_SCOPE("TxpPauses::Process");
   pugi::xpath_node_set files;
   files = input->document_element().select_nodes("//fileid");
   if (files.size()) {
@@ -63,99 +66,110 @@ bool TxpPauses::Process(pugi::xml_document* input) {
 // Adds breaks as required and ensures all documents/fileids
 // have a break initial and final
 bool TxpPauses::ProcessFile(pugi::xml_node* file) {
-  pugi::xml_node *breakitem = NULL, *ptk = NULL, pretk;
-  const TxpPbreakInfo* pbreak;
-  TxpPbreakInfo pbreakpunc;
-  bool prebreak, pstbreak, newline = false, newline2 = false;
-  pugi::xpath_node_set files;
   pugi::xpath_node_set tks =
       file->select_nodes(".//tk|.//break|.//ws");
   tks.sort();
+  StartFile(*file);
   for (pugi::xpath_node_set::const_iterator it = tks.begin();
        it != tks.end();
        ++it) {
-    pugi::xml_node tk = (*it).node();
-    if (!strcmp(tk.name(), "break")) {
-      if (!tk.attribute("type")) tk.append_attribute("type");
-      if (!tk.attribute("time")) tk.append_attribute("time");
-      if (!tk.attribute("strength").empty()) {
-        pbreak = pbreak_.GetPbreakPst(tk.attribute("strength").value());
-        if (pbreak) {
-          tk.attribute("type").set_value(pbreak->type);
-          tk.attribute("time").set_value(pbreak->time);
-        }
-      }
-      // break tags override punctuation so keep a record of what happened
-      // before tk
-      if (!*tk.attribute("type").value()) {
-        tk.attribute("type").set_value(pbreak_.get_default_type());
-      }
-      if (!*tk.attribute("time").value()) {
-        tk.attribute("time").set_value(pbreak_.get_default_time());
+    VisitToken((*it).node());
+  }
+  EndFile(*file);
+  return true;
+}
+
+void TxpPauses::StartFile(pugi::xml_node file) {
+  infile_ = true;
+  breakitem_ = false;
+  ptk_ = pugi::xml_node();
+  newline_ = false;
+  newline2_ = false;
+  pbreakpunc_.Clear();
+}
+
+void TxpPauses::VisitToken(pugi::xml_node tk) {
+  const TxpPbreakInfo* pbreak;
+  bool prebreak, pstbreak;
+  if (!infile_) return;
+  if (!strcmp(tk.name(), "break")) {
+    if (!tk.attribute("type")) tk.append_attribute("type");
+    if (!tk.attribute("time")) tk.append_attribute("time");
+    if (!tk.attribute("strength").empty()) {
+      pbreak = pbreak_->GetPbreakPst(tk.attribute("strength").value());
+      if (pbreak) {
+        tk.attribute("type").set_value(pbreak->type);
+        tk.attribute("time").set_value(pbreak->time);
       }
-      breakitem = &tk;
-      // tk.print(std::cout);
-    } else if (!strcmp(tk.name(), "ws")) {
-      pbreak_.GetWhitespaceBreaks(tk.first_child().value(),
-                                  tk.attribute("col").as_int(0),
-                                  hzone_, hzone_start_, hzone_end_,
-                                  &newline, &newline2);
-    } else if (!strcmp(tk.name(), "tk")) {
-      // std::cout << "!" << tk.attribute("norm").value() << "\n";
-      // if (ptk) std::cout << "P:" << ptk->attribute("norm").value() << " - ";
-      // std::cout << "L:" << tk.attribute("norm").value() << std::endl;
-      pbreakpunc.Clear();
-      // Only add breaks if no break is present
-      if (!breakitem) {
-        // first token
-        if (!ptk) {
-          if (pbreak_.GetPbreak(tk.attribute("prepunc").value(),
-                                TXPPBREAK_POS_PRE, pbreakpunc)) {
-            pbreak = &pbreakpunc;
-          } else {
-            // Insert default document start break
-            pbreak = pbreak_.GetPbreakPre("DEFAULT");
-          }
-          _insert_break_before(&tk, pbreak);
+    }
+    // break tags override punctuation so keep a record of what happened
+    // before tk
+    if (!*tk.attribute("type").value()) {
+      tk.attribute("type").set_value(pbreak_->get_default_type());
+    }
+    if (!*tk.attribute("time").value()) {
+      tk.attribute("time").set_value(pbreak_->get_default_time());
+    }
+    breakitem_ = true;
+  } else if (!strcmp(tk.name(), "ws")) {
+    pbreak_->GetWhitespaceBreaks(tk.first_child().value(),
+                                tk.attribute("col").as_int(0),
+                                hzone_, hzone_start_, hzone_end_,
+                                &newline_, &newline2_);
+  } else if (!strcmp(tk.name(), "tk")) {
+    pbreakpunc_.Clear();
+    // Only add breaks if no break is present
+    if (!breakitem_) {
+      // first token
+      if (!ptk_) {
+        if (pbreak_->GetPbreak(tk.attribute("prepunc").value(),
+                              TXPPBREAK_POS_PRE, pbreakpunc_)) {
+          pbreak = &pbreakpunc_;
         } else {
-          // Between tokens
-          // break caused by punctuation
-          // std::cout << "X:" << tk.attribute("prepunc").value() << std::endl;
-          pstbreak = pbreak_.GetPbreak(ptk->attribute("pstpunc").value(),
-                                       TXPPBREAK_POS_PST, pbreakpunc);
-          prebreak = pbreak_.GetPbreak(tk.attribute("prepunc").value(),
-                                       TXPPBREAK_POS_PRE, pbreakpunc);
-          pbreak = &pbreakpunc;
-          if (!prebreak && !pstbreak) {
-            // Break caused by whitespace
-            if (newline2) {
-            pbreak = pbreak_.GetPbreakPst("newlineX2");
-            } else if (newline) {
-              pbreak = pbreak_.GetPbreakPst("newlineX2");
-            } else {
-              pbreak = NULL;
-            }
+          // Insert default document start break
+          pbreak = pbreak_->GetPbreakPre("DEFAULT");
+        }
+        _insert_break_before(&tk, pbreak);
+      } else {
+        // Between tokens
+        // break caused by punctuation
+        pstbreak = pbreak_->GetPbreak(ptk_.attribute("pstpunc").value(),
+                                     TXPPBREAK_POS_PST, pbreakpunc_);
+        prebreak = pbreak_->GetPbreak(tk.attribute("prepunc").value(),
+                                     TXPPBREAK_POS_PRE, pbreakpunc_);
+        pbreak = &pbreakpunc_;
+        if (!prebreak && !pstbreak) {
+          // Break caused by whitespace
+          if (newline2_) {
+            pbreak = pbreak_->GetPbreakPst("newlineX2");
+          } else if (newline_) {
+            pbreak = pbreak_->GetPbreakPst("newlineX2");
+          } else {
+            pbreak = NULL;
           }
-          _insert_break_after(ptk, pbreak);
         }
+        _insert_break_after(&ptk_, pbreak);
       }
-      pretk = (*it).node();
-      ptk = &pretk;
-      breakitem = NULL;
     }
+    ptk_ = tk;
+    breakitem_ = false;
   }
+}
+
+void TxpPauses::EndFile(pugi::xml_node file) {
+  const TxpPbreakInfo* pbreak;
+  infile_ = false;
   // last item
-  if (!breakitem && ptk) {
-    if (pbreak_.GetPbreak(ptk->attribute("pstpunc").value(),
-                          TXPPBREAK_POS_PST, pbreakpunc)) {
-      pbreak = &pbreakpunc;
+  if (!breakitem_ && ptk_) {
+    if (pbreak_->GetPbreak(ptk_.attribute("pstpunc").value(),
+                          TXPPBREAK_POS_PST, pbreakpunc_)) {
+      pbreak = &pbreakpunc_;
     } else {
       // Insert default document end break
-      pbreak = pbreak_.GetPbreakPst("DEFAULT");
+      pbreak = pbreak_->GetPbreakPst("DEFAULT");
     }
-    _insert_break_after(ptk, pbreak);
+    _insert_break_after(&ptk_, pbreak);
   }
-  return true;
 }
 
 static void _insert_break_after(pugi::xml_node* tk,
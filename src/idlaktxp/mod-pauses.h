@@ -23,12 +23,14 @@
 // either text, tox (token oriented xml) tokens, or spurts (phrases)
 // containing tox tokens.
 
+#include <memory>
 #include <string>
 #include "pugixml.hpp"
 
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpmodule.h"
+#include "idlaktxp/txptpdbstore.h"
 #include "idlaktxp/txppbreak.h"
 
 namespace kaldi {
@@ -41,14 +43,31 @@ class TxpPauses : public TxpModule {
   ~TxpPauses();
   bool Init(const TxpParseOptions &opts);
   bool Process(pugi::xml_document* input);
+  bool IsTokenVisitor() const {return true;}
+  void StartFile(pugi::xml_node file);
+  void EndFile(pugi::xml_node file);
+  void VisitToken(pugi::xml_node tk);
 
  private:
   /// Process a file (documents may have several files of information separated
   /// within file id elements).
   bool ProcessFile(pugi::xml_node* file);
+  // State while visiting the elements of a file
+  /// True between StartFile and EndFile
+  bool infile_;
+  /// True if a break element has been seen since the last token
+  bool breakitem_;
+  /// The last token in the file
+  pugi::xml_node ptk_;
+  /// Line breaks found in the whitespace so far
+  bool newline_;
+  bool newline2_;
+  /// Punctuation break of the last token, also used for the file final
+  /// break
+  TxpPbreakInfo pbreakpunc_;
   /// Object containing lookup between punctuation and break strength
   /// and time
-  TxpPbreak pbreak_;
+  std::shared_ptr<TxpPbreak> pbreak_;
   /// If true tries distinguish real line breaks from those at page left
   /// A hypenation zone (hzone) can then be used to remove phantom line breaks
   /// and reappend soft hypenation
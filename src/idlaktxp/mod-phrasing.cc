@@ -16,17 +16,35 @@
 // limitations under the License.
 //
 
+#include <vector>
+
 #include "idlaktxp/mod-phrasing.h"
 
 namespace kaldi {
 
-static bool _copy_until_break(pugi::xml_node* parent,
-                              pugi::xml_node* phrasenode,
-                              pugi::xml_node* firstbreak,
-                              pugi::xml_node* lastbreak,
-                              int32* wordid);
+// State of the single pass over a file which splits it into phrases
+struct _PhraseState {
+  pugi::xml_node rootnode;
+  pugi::xml_node uttnode;
+  pugi::xml_node phrasenode;
+  pugi::xml_node firstbreak;
+  pugi::xml_node lastbreak;
+  // last break copied into the current phrase
+  pugi::xml_node phrasebreak;
+  int32 phraseid;
+  int32 uttid;
+  int32 wordid;
+  // the elements being copied and their copies in the current phrase
+  std::vector<pugi::xml_node> ancestors;
+  std::vector<pugi::xml_node> copies;
+};
 
-static bool _is_utt_final(const pugi::xml_node &spt);
+static void _find_breaks(const pugi::xml_node &rootnode,
+                         pugi::xml_node* firstbreak,
+                         pugi::xml_node* lastbreak);
+static void _start_phrase(_PhraseState* state);
+static void _end_phrase(_PhraseState* state, bool final);
+static void _copy_to_phrases(_PhraseState* state, pugi::xml_node child);
 
 TxpPhrasing::TxpPhrasing() : TxpModule("phrasing") {}
 
@@ -40,6 +58,7 @@ bool TxpPhrasing::Init(const TxpParseOptions &opts) {
 }
 
 bool TxpPhrasing::Process(pugi::xml_document* input) {
+  KALDI_PROFILE_SCOPE("TxpPhrasing::Process");
   pugi::xml_node rootnode;
   pugi::xpath_node_set files;
   files = input->document_element().select_nodes("//fileid");
@@ -57,113 +76,133 @@ bool TxpPhrasing::Process(pugi::xml_document* input) {
   return true;
 }
 
+// Every break except the first and last ends a phrase, its time is split
+// between the end of that phrase and the start of the next. Nodes are copied
+// into the phrases in one pass in document order, the elements a phrase break
+// falls inside are copied, without their children, into both phrases.
 bool TxpPhrasing::ProcessFile(pugi::xml_node* rootnode) {
-  bool final = false;
-  pugi::xml_node uttnode, phrasenode, lastbreak, firstbreak;
-  int32 phraseid = 1;
-  int32 uttid = 1;
-  int32 wordid = 1;
-  pugi::xpath_node_set breaks;
+  _PhraseState state;
+  pugi::xml_node child, nextchild, firstutt;
   // Handle empty spurt
-  breaks = rootnode->select_nodes(".//break");
-  if (breaks.size() == 0) return true;
-  
-  uttnode = rootnode->append_child("utt");
-  uttnode.append_attribute("uttid").set_value(uttid);
-  
-  lastbreak = rootnode->select_nodes("(.//break)[last()]").first().node();
-  firstbreak = rootnode->select_nodes("(.//break)[1]").first().node();
-  while (!final) {
-    phrasenode = uttnode.append_child("spt");
-    phrasenode.append_attribute("phraseid").set_value(phraseid);
-    wordid = 1;
-    final = _copy_until_break(rootnode, &phrasenode,
-                              &firstbreak, &lastbreak, &wordid);
-    firstbreak = rootnode->select_nodes(".//break[1]").first().node();
-    phrasenode.append_attribute("no_wrds").set_value(wordid - 1);
-    if (_is_utt_final(phrasenode)) {
-      uttnode.append_attribute("no_phrases").set_value(phraseid);
-      phraseid = 0;
-      if (!final) {
-        uttnode = rootnode->append_child("utt");
-        uttid++;
-        uttnode.append_attribute("uttid").set_value(uttid);
-      }
-    }
-    phraseid++;
+  _find_breaks(*rootnode, &state.firstbreak, &state.lastbreak);
+  if (!state.firstbreak) return true;
+
+  state.rootnode = *rootnode;
+  state.phraseid = 1;
+  state.uttid = 1;
+  state.uttnode = rootnode->append_child("utt");
+  state.uttnode.append_attribute("uttid").set_value(state.uttid);
+  firstutt = state.uttnode;
+  _start_phrase(&state);
+  for (child = rootnode->first_child(); child != firstutt; child = nextchild) {
+    nextchild = child.next_sibling();
+    if (child.type() == pugi::node_element && !strcmp(child.name(), "utt"))
+      continue;
+    _copy_to_phrases(&state, child);
+    rootnode->remove_child(child);
   }
+  _end_phrase(&state, true);
   return true;
 }
 
-static bool _copy_until_break(pugi::xml_node* parent,
-                              pugi::xml_node* phrasenode,
-                              pugi::xml_node* firstbreak,
-                              pugi::xml_node* lastbreak,
-            int32* wordid) {
-  pugi::xml_node child, nextchild, childcopy;
-  for (child = parent->first_child(); child; child = nextchild) {
-    // get next child before current child is deleted
-    nextchild = child.next_sibling();
-    if (child.type() != pugi::node_element) {
-      phrasenode->append_copy(child);
-      parent->remove_child(child);
+static void _find_breaks(const pugi::xml_node &rootnode,
+                         pugi::xml_node* firstbreak,
+                         pugi::xml_node* lastbreak) {
+  pugi::xml_node node = rootnode.first_child();
+  *firstbreak = pugi::xml_node();
+  *lastbreak = pugi::xml_node();
+  while (node) {
+    if (node.type() == pugi::node_element && !strcmp(node.name(), "break")) {
+      if (!*firstbreak) *firstbreak = node;
+      *lastbreak = node;
+    }
+    if (node.first_child()) {
+      node = node.first_child();
     } else {
-      if (!strcmp(child.name(), "utt")) {
-        continue;
-      } else if (!strcmp(child.name(), "break")) {
-        if (child == *firstbreak) {
-          childcopy = phrasenode->append_copy(child);
-          parent->remove_child(child);
-        } else {
-          childcopy = phrasenode->append_copy(child);
-          // Split the break
-          if (child != *lastbreak) {
-            childcopy.attribute("time").set_value(
-                child.attribute("time").as_float() / 2.0f);
-            child.attribute("time").set_value(
-                childcopy.attribute("time").as_float());
-            return false;
-          } else {
-            parent->remove_child(child);
-          }
-        }
-      } else if (!strcmp(child.name(), "tk") || !strcmp(child.name(), "ws")) {
-        if (!strcmp(child.name(), "tk")) {
-            child.append_attribute("wordid").set_value(*wordid);
-            *wordid = *wordid + 1;
-        }
-        //  std::cout << child.attribute("norm").value() << "\n";
-        childcopy = phrasenode->append_copy(child);
-        parent->remove_child(child);
-      } else {
-        childcopy = phrasenode->append_child(child.name());
-        for (pugi::xml_attribute a = child.first_attribute();
-            a;
-            a = a.next_attribute()) {
-          childcopy.append_attribute(a.name()).set_value(a.value());
-        }
-        if (_copy_until_break(&child, &childcopy,
-                              firstbreak, lastbreak, wordid)) {
-          parent->remove_child(child);
-        } else {
-          return false;
-        }
-      }
+      while (node != rootnode && !node.next_sibling()) node = node.parent();
+      if (node == rootnode) break;
+      node = node.next_sibling();
     }
   }
-  return true;
 }
 
-static bool _is_utt_final(const pugi::xml_node &spt) {
-  pugi::xml_node lastbreak;
-  pugi::xpath_node_set breaks;
-  breaks = spt.select_nodes(".//break");
-  breaks.sort();
-  lastbreak = breaks[breaks.size() - 1].node();
-  // lastbreak.print(std::cout);
-  // std::cout << "!" << lastbreak.attribute("type").value() << "\n";
-  if (lastbreak.attribute("type").as_int(0) == 4) return true;
-  return false;
+static void _start_phrase(_PhraseState* state) {
+  pugi::xml_node childcopy;
+  state->phrasenode = state->uttnode.append_child("spt");
+  state->phrasenode.append_attribute("phraseid").set_value(state->phraseid);
+  state->phrasebreak = pugi::xml_node();
+  state->wordid = 1;
+  state->copies.clear();
+  state->copies.push_back(state->phrasenode);
+  for (size_t i = 0; i < state->ancestors.size(); i++) {
+    const pugi::xml_node &child = state->ancestors[i];
+    childcopy = state->copies.back().append_child(child.name());
+    for (pugi::xml_attribute a = child.first_attribute();
+         a;
+         a = a.next_attribute()) {
+      childcopy.append_attribute(a.name()).set_value(a.value());
+    }
+    state->copies.push_back(childcopy);
+  }
+}
+
+static void _end_phrase(_PhraseState* state, bool final) {
+  state->phrasenode.append_attribute("no_wrds").set_value(state->wordid - 1);
+  if (state->phrasebreak.attribute("type").as_int(0) == 4) {
+    state->uttnode.append_attribute("no_phrases").set_value(state->phraseid);
+    state->phraseid = 0;
+    if (!final) {
+      state->uttnode = state->rootnode.append_child("utt");
+      state->uttid++;
+      state->uttnode.append_attribute("uttid").set_value(state->uttid);
+    }
+  }
+  state->phraseid++;
+}
+
+static void _copy_to_phrases(_PhraseState* state, pugi::xml_node child) {
+  pugi::xml_node childcopy;
+  pugi::xml_node parentcopy = state->copies.back();
+  if (child.type() != pugi::node_element) {
+    parentcopy.append_copy(child);
+  } else if (!strcmp(child.name(), "utt")) {
+    return;
+  } else if (!strcmp(child.name(), "break")) {
+    childcopy = parentcopy.append_copy(child);
+    state->phrasebreak = childcopy;
+    if (child != state->firstbreak && child != state->lastbreak) {
+      // Split the break
+      childcopy.attribute("time").set_value(
+          child.attribute("time").as_float() / 2.0f);
+      child.attribute("time").set_value(
+          childcopy.attribute("time").as_float());
+      _end_phrase(state, false);
+      _start_phrase(state);
+      state->phrasebreak = state->copies.back().append_copy(child);
+    }
+  } else if (!strcmp(child.name(), "tk") || !strcmp(child.name(), "ws")) {
+    if (!strcmp(child.name(), "tk")) {
+      child.append_attribute("wordid").set_value(state->wordid);
+      state->wordid++;
+    }
+    parentcopy.append_copy(child);
+  } else {
+    childcopy = parentcopy.append_child(child.name());
+    for (pugi::xml_attribute a = child.first_attribute();
+         a;
+         a = a.next_attribute()) {
+      childcopy.append_attribute(a.name()).set_value(a.value());
+    }
+    state->ancestors.push_back(child);
+    state->copies.push_back(childcopy);
+    for (pugi::xml_node grandchild = child.first_child();
+         grandchild;
+         grandchild = grandchild.next_sibling()) {
+      _copy_to_phrases(state, grandchild);
+    }
+    state->ancestors.pop_back();
+    state->copies.pop_back();
+  }
 }
 
 }  // namespace kaldi
@@ -28,36 +28,43 @@ TxpPosTag::~TxpPosTag() {
 bool TxpPosTag::Init(const TxpParseOptions &opts) {
   opts_ = &opts;
   tpdb_ = opts.GetTpdb();
-  tagger_.Init(opts, std::string(GetOptValue("arch")));
-  posset_.Init(opts, std::string(GetOptValue("arch")));
-  if (tagger_.Parse(tpdb_) && posset_.Parse(tpdb_)) return true;
+  tagger_ = TxpTpdbStore::Get<TxpPos>(opts, std::string(GetOptValue("arch")));
+  posset_ = TxpTpdbStore::Get<TxpPosSet>(opts, std::string(GetOptValue("arch")));
+  if (tagger_ && posset_) return true;
   return false;
 }
 
 bool TxpPosTag::Process(pugi::xml_document* input) {
-    const char *ptag = "", *tag, *set;
+  KALDI_PROFILE_SCOPE("TxpPosTag::Process");
   pugi::xpath_node_set tks = input->document_element().select_nodes("//tk");
   tks.sort();
+  StartDocument(input);
   for (pugi::xpath_node_set::const_iterator it = tks.begin();
        it != tks.end();
        ++it) {
-    pugi::xml_node node = (*it).node();
-    if (it == tks.begin()) {
-      ptag = "#";
-    } else {
-      pugi::xml_node pnode = (*(it - 1)).node();
-      ptag = pnode.attribute("pos").value();
-    }
-    tag = tagger_.GetPos(ptag, node.attribute("tknorm").value());
-    if (!node.attribute("pos")) node.append_attribute("pos");
-    node.attribute("pos").set_value(tag);
-    set = posset_.GetPosSet(tag);
-    if (set) {
-      if (!node.attribute("posset")) node.append_attribute("posset");
-      node.attribute("posset").set_value(set);
-    }
+    VisitToken((*it).node());
   }
   return true;
 }
 
+void TxpPosTag::StartDocument(pugi::xml_document* input) {
+  ptk_ = pugi::xml_node();
+}
+
+// Tags are chosen from the previous token's tag and the token itself
+void TxpPosTag::VisitToken(pugi::xml_node node) {
+  const char *ptag, *tag, *set;
+  if (strcmp(node.name(), "tk")) return;
+  ptag = ptk_ ? ptk_.attribute("pos").value() : "#";
+  tag = tagger_->GetPos(ptag, node.attribute("tknorm").value());
+  if (!node.attribute("pos")) node.append_attribute("pos");
+  node.attribute("pos").set_value(tag);
+  set = posset_->GetPosSet(tag);
+  if (set) {
+    if (!node.attribute("posset")) node.append_attribute("posset");
+    node.attribute("posset").set_value(set);
+  }
+  ptk_ = node;
+}
+
 }  // namespace kaldi
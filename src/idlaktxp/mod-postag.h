@@ -23,8 +23,10 @@
 // either text, tox (token oriented xml) tokens, or spurts (phrases)
 // containing tox tokens.
 
+#include <memory>
 #include <string>
 #include "idlaktxp/txpmodule.h"
+#include "idlaktxp/txptpdbstore.h"
 #include "idlaktxp/txppos.h"
 
 namespace kaldi {
@@ -37,12 +39,17 @@ class TxpPosTag : public TxpModule {
   ~TxpPosTag();
   bool Init(const TxpParseOptions &opts);
   bool Process(pugi::xml_document* input);
+  bool IsTokenVisitor() const {return true;}
+  void StartDocument(pugi::xml_document* input);
+  void VisitToken(pugi::xml_node node);
 
  private:
+  /// The last token tagged
+  pugi::xml_node ptk_;
   /// Greedy regex and bigram tagger
-  TxpPos tagger_;
+  std::shared_ptr<TxpPos> tagger_;
   /// Tagger set
-  TxpPosSet posset_;
+  std::shared_ptr<TxpPosSet> posset_;
 };
 
 }  // namespace kaldi
@@ -16,11 +16,15 @@
 // limitations under the License.
 //
 
+#include <set>
+#include <string>
+#include <vector>
 #include "idlaktxp/mod-pronounce.h"
 
 namespace kaldi {
 
-TxpPronounce::TxpPronounce() : TxpModule("pronounce") {}
+TxpPronounce::TxpPronounce()
+    : TxpModule("pronounce"), lex_version_(0), cache_stats_(false) {}
 
 TxpPronounce::~TxpPronounce() {
 }
@@ -28,103 +32,177 @@ TxpPronounce::~TxpPronounce() {
 bool TxpPronounce::Init(const TxpParseOptions &opts) {
   opts_ = &opts;
   tpdb_ = opts.GetTpdb();
-  lex_.Init(opts, std::string(GetOptValue("arch")));
-  lts_.Init(opts, std::string(GetOptValue("arch")));
-  phone_.Init(opts, std::string(GetOptValue("arch")));
-  if (lex_.Parse(tpdb_) && lts_.Parse(tpdb_) && phone_.Parse(tpdb_)) return true;
+  lex_ = TxpTpdbStore::Get<TxpLexicon>(opts, std::string(GetOptValue("arch")));
+  lts_ = TxpTpdbStore::Get<TxpLts>(opts, std::string(GetOptValue("arch")));
+  phone_ = TxpTpdbStore::Get<TxpPhone>(opts, std::string(GetOptValue("arch")));
+  cache_.SetCapacity(atoi(GetOptValue("cache-size")));
+  cache_stats_ = GetOptValueBool("cache-stats");
+  if (lex_) lex_version_ = lex_->UserVersion();
+  if (lex_ && lts_ && phone_) return true;
   return false;
 }
 
 bool TxpPronounce::Process(pugi::xml_document* input) {
-  pugi::xml_node parent, child;
+  KALDI_PROFILE_SCOPE("TxpPronounce::Process");
   pugi::xpath_node_set tks = input->document_element().select_nodes("//tk");
-  const char* lex_entry;
-  const char* lex_pron;
-  const char* word;
-  std::string utfchar, word_str, altprons;
-  TxpLexiconLkp lexlkp;
-  int32 i;
   tks.sort();
   for (pugi::xpath_node_set::const_iterator it = tks.begin();
        it != tks.end();
        ++it) {
-    pugi::xml_node node = (*it).node();
-    word = node.attribute("norm").value();
-    if (std::string(word).compare("") == 0)
-        word = node.attribute("tknorm").value();
-    lexlkp.Reset();
-    // Check to see if token is first daughter of a lex tag
-    parent = node.parent();
-    lex_entry = NULL;
-    lex_pron = NULL;
-    while (parent) {
-      if (!strcmp(parent.name(), "lex")) {
-        if ((*(parent.select_nodes("descendant::tk[1]").begin())).node()
-            == node) {
-          lex_entry = parent.attribute("entry").value();
-          lex_pron = parent.attribute("pron").value();
-        }
+    VisitToken((*it).node());
+  }
+  EndDocument(input);
+  return true;
+}
+
+namespace {
+
+struct IsTk {
+  bool operator()(pugi::xml_node node) const {
+    return !strcmp(node.name(), "tk");
+  }
+};
+
+}  // namespace
+
+void TxpPronounce::VisitToken(pugi::xml_node node) {
+  pugi::xml_node parent;
+  const char* lex_entry;
+  const char* lex_pron;
+  const char* word;
+  if (strcmp(node.name(), "tk")) return;
+  word = node.attribute("norm").value();
+  if (std::string(word).compare("") == 0)
+      word = node.attribute("tknorm").value();
+  // Check to see if token is first daughter of a lex tag
+  parent = node.parent();
+  lex_entry = NULL;
+  lex_pron = NULL;
+  while (parent) {
+    if (!strcmp(parent.name(), "lex")) {
+      if (parent.find_node(IsTk()) == node) {
+        lex_entry = parent.attribute("entry").value();
+        lex_pron = parent.attribute("pron").value();
       }
-      parent = parent.parent();
     }
-    word_str = std::string(word);
-    // If pron is set use that pron
-    if (lex_pron && *lex_pron) {
-      node.append_attribute("pron").set_value(lex_pron);
-    } else {
-      // standard lookup of word
-      AppendPron(lex_entry, std::string(word), &lexlkp);
-      // in the received pronounciation lookup phonemes and check if they
-      // exist in the phoneme set
-      int32 st_phon_pos = 0, end_phon_pos = 0;
-      std::string sub_word = lexlkp.pron.substr(st_phon_pos);
-      std::string phone_2_chk = "";
-      while (sub_word.length() > 0) {
-        end_phon_pos = sub_word.find(" ");
-        if (end_phon_pos == std::string::npos) {
-          end_phon_pos = sub_word.length()-1;
-          phone_2_chk = sub_word;
-        } else
-          phone_2_chk = sub_word.substr(0, end_phon_pos);
-
-        // if the phoneme has a stress, remove it
-        if (isdigit(phone_2_chk.substr(phone_2_chk.length()-1)[0])) {
-          phone_2_chk = phone_2_chk.substr(0, phone_2_chk.length()-1);
-        }
-
-        // if a phoneme turns out to be an empty string, then it is wrong and
-        // the pronounciation is removed.
-        if (phone_2_chk.compare("") == 0) {
-            lexlkp.pron = "";
-            break;
-        }
-
-        // if no phoneme is found, pronounciation is removed
-        const TxpPhoneDescr* found_phone = phone_.GetPhone(phone_2_chk.c_str());
-        if (found_phone == NULL) {
-          KALDI_ERR << "Phoneme " << phone_2_chk << " from word " << word << " could not be found";
-          lexlkp.pron = "";
-          break;
-        }
-
-        st_phon_pos = end_phon_pos + 1;
-        sub_word = sub_word.substr(st_phon_pos);
-      }
+    parent = parent.parent();
+  }
+  // If pron is set use that pron
+  if (lex_pron && *lex_pron) {
+    node.append_attribute("pron").set_value(lex_pron);
+  } else {
+    const TxpPronounceResult &result = Lookup(lex_entry, std::string(word));
+    node.append_attribute("pron").set_value(result.pron.c_str());
+    if (result.lts) {
+      node.append_attribute("lts").set_value("true");
+    } else if (!result.altprons.empty()) {
+      node.append_attribute("altprons").set_value(result.altprons.c_str());
+    }
+  }
+}
 
-      node.append_attribute("pron").set_value(lexlkp.pron.c_str());
-      if (lexlkp.lts) {
-        node.append_attribute("lts").set_value("true");
-      } else if (!lexlkp.lts && lexlkp.altprons.size() > 1) {
-        altprons.clear();
-        for (i = 0; i < lexlkp.altprons.size(); i++) {
-          if (i) altprons = altprons + ", ";
-          altprons = altprons + lexlkp.altprons[i];
-        }
-        node.append_attribute("altprons").set_value(altprons.c_str());
-      }
+void TxpPronounce::EndDocument(pugi::xml_document* input) {
+  if (cache_stats_) {
+    pugi::xml_node header = GetHeader(input);
+    header.append_attribute("cache_lookups").set_value(
+        static_cast<double>(cache_.Lookups()));
+    header.append_attribute("cache_hits").set_value(
+        static_cast<double>(cache_.Hits()));
+  }
+}
+
+// Cache keys start with the word followed by a null
+struct TxpPronounceKeyHasWord {
+  explicit TxpPronounceKeyHasWord(const std::set<std::string> &words)
+      : words_(words) {}
+  bool operator()(const std::string &key) const {
+    return words_.count(key.substr(0, key.find('\0'))) > 0;
+  }
+  const std::set<std::string> &words_;
+};
+
+static bool TxpPronounceAnyKey(const std::string &) { return true; }
+
+void TxpPronounce::CheckLexicon() {
+  uint64 version = lex_->UserVersion();
+  if (version == lex_version_) return;
+  std::vector<std::string> changed;
+  if (lex_->UserChangesSince(lex_version_, &changed)) {
+    std::set<std::string> words(changed.begin(), changed.end());
+    cache_.EraseIf(TxpPronounceKeyHasWord(words));
+  } else {
+    cache_.EraseIf(TxpPronounceAnyKey);
+  }
+  lex_version_ = version;
+}
+
+const TxpPronounceResult &TxpPronounce::Lookup(const char* entry,
+                                               const std::string &word) {
+  const TxpPronounceResult* cached;
+  CheckLexicon();
+  std::string key(word);
+  key.push_back('\0');
+  if (entry) key += entry;
+  cached = cache_.Find(key);
+  if (cached) return *cached;
+  // a phone set error throws before anything is added
+  GetResult(entry, word, &uncached_);
+  cache_.Insert(key, uncached_);
+  return uncached_;
+}
+
+void TxpPronounce::GetResult(const char* entry, const std::string &word,
+                             TxpPronounceResult* result) {
+  TxpLexiconLkp lexlkp;
+  int32 i;
+  lexlkp.Reset();
+  // standard lookup of word
+  AppendPron(entry, word, &lexlkp);
+  // in the received pronounciation lookup phonemes and check if they
+  // exist in the phoneme set
+  int32 st_phon_pos = 0, end_phon_pos = 0;
+  std::string sub_word = lexlkp.pron.substr(st_phon_pos);
+  std::string phone_2_chk = "";
+  while (sub_word.length() > 0) {
+    end_phon_pos = sub_word.find(" ");
+    if (end_phon_pos == std::string::npos) {
+      end_phon_pos = sub_word.length()-1;
+      phone_2_chk = sub_word;
+    } else
+      phone_2_chk = sub_word.substr(0, end_phon_pos);
+
+    // if the phoneme has a stress, remove it
+    if (isdigit(phone_2_chk.substr(phone_2_chk.length()-1)[0])) {
+      phone_2_chk = phone_2_chk.substr(0, phone_2_chk.length()-1);
+    }
+
+    // if a phoneme turns out to be an empty string, then it is wrong and
+    // the pronounciation is removed.
+    if (phone_2_chk.compare("") == 0) {
+        lexlkp.pron = "";
+        break;
+    }
+
+    // if no phoneme is found, pronounciation is removed
+    const TxpPhoneDescr* found_phone = phone_->GetPhone(phone_2_chk.c_str());
+    if (found_phone == NULL) {
+      KALDI_ERR << "Phoneme " << phone_2_chk << " from word " << word << " could not be found";
+      lexlkp.pron = "";
+      break;
+    }
+
+    st_phon_pos = end_phon_pos + 1;
+    sub_word = sub_word.substr(st_phon_pos);
+  }
+  result->pron = lexlkp.pron;
+  result->lts = lexlkp.lts;
+  result->altprons.clear();
+  if (!lexlkp.lts && lexlkp.altprons.size() > 1) {
+    for (i = 0; i < lexlkp.altprons.size(); i++) {
+      if (i) result->altprons += ", ";
+      result->altprons += lexlkp.altprons[i];
     }
   }
-  return true;
 }
 
 void TxpPronounce::AppendPron(const char* entry,
@@ -133,15 +211,15 @@ void TxpPronounce::AppendPron(const char* entry,
   bool found = false;
   if (!lexlkp->pron.empty()) lexlkp->pron += " ";
   if (entry) {
-    found = lex_.GetPron(word, std::string(entry), lexlkp);
+    found = lex_->GetPron(word, std::string(entry), lexlkp);
     if (!found) {
-      found = lex_.GetPron(word, std::string(""), lexlkp);
+      found = lex_->GetPron(word, std::string(""), lexlkp);
     }
   } else {
-    found = lex_.GetPron(word, std::string(""), lexlkp);
+    found = lex_->GetPron(word, std::string(""), lexlkp);
   }
   if (!found)
-    found = lts_.GetPron(word, lexlkp);
+    found = lts_->GetPron(word, lexlkp);
 }
 
 }  // namespace kaldi
@@ -23,6 +23,7 @@
 // either text, tox (token oriented xml) tokens, or spurts (phrases)
 // containing tox tokens.
 
+#include <memory>
 #include <string>
 #include <cctype>
 #include "pugixml.hpp"
@@ -30,34 +31,72 @@
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpmodule.h"
+#include "idlaktxp/txptpdbstore.h"
 #include "idlaktxp/txpnrules.h"
 #include "idlaktxp/txplexicon.h"
 #include "idlaktxp/txplts.h"
 #include "idlaktxp/txpphone.h"
+#include "idlaktxp/txplrucache.h"
 
 namespace kaldi {
 
+/// Pronunciation attributes written for a token
+struct TxpPronounceResult {
+  std::string pron;
+  /// true if the pronunciation came from lts
+  bool lts;
+  /// comma separated lexicon alternatives, empty if fewer than two
+  std::string altprons;
+};
+
 /// Convert tokens into pronunications based on lexicons and
 /// lts rules. Currently only one lexicon is supported. A user lexicon
 /// and ability to add bilingual lexicons may be added. /ref idlaktxp_pron
+///
+/// Results are cached by word and lexicon entry so that repeated words skip
+/// the lexicon and lts. The cache (--pronounce-cache-size entries, 0 to
+/// disable) belongs to the module object, which is never shared between
+/// threads. Results for words whose user lexicon entries change are
+/// dropped before the next lookup. With --pronounce-cache-stats the lookup and hit counts since
+/// Init are written to the txpheader.
 class TxpPronounce : public TxpModule {
  public:
   explicit TxpPronounce();
   ~TxpPronounce();
   bool Init(const TxpParseOptions &opts);
   bool Process(pugi::xml_document* input);
+  bool IsTokenVisitor() const {return true;}
+  /// The lexicon, shared with the other modules using the same tpdb, to
+  /// which user entries can be added
+  TxpLexicon* Lexicon() {return lex_.get();}
+  void VisitToken(pugi::xml_node node);
+  void EndDocument(pugi::xml_document* input);
 
  private:
   /// Checks lexicon and lts to determine pronuciations
   /// and appends it to the lex lookup structure
   void AppendPron(const char* entry, const std::string &word,
                   TxpLexiconLkp* lexlkp);
+  /// Looks up word and checks its phones against the phone set
+  void GetResult(const char* entry, const std::string &word,
+                 TxpPronounceResult* result);
+  /// Drops cached results of words whose user entries changed
+  void CheckLexicon();
+  /// Returns the cached or new result for word with entry
+  const TxpPronounceResult &Lookup(const char* entry, const std::string &word);
   /// A pronuciation lexicon object
-  TxpLexicon lex_;
+  std::shared_ptr<TxpLexicon> lex_;
   /// A cart based letter to sound rul object
-  TxpLts lts_;
+  std::shared_ptr<TxpLts> lts_;
   /// Phoneme set
-  TxpPhone phone_;
+  std::shared_ptr<TxpPhone> phone_;
+  /// Result cache, keyed on the word and entry separated by a null
+  TxpLruCache<TxpPronounceResult> cache_;
+  /// Result of the last lookup that is not in the cache
+  TxpPronounceResult uncached_;
+  /// User entry version of the lexicon the cache is up to date with
+  uint64 lex_version_;
+  bool cache_stats_;
 };
 
 }  // namespace kaldi
@@ -24,7 +24,7 @@ const char* txpsyllabletype[] = {"onset", "nucleus", "coda"};
 
 static void _add_sylxml(const char* spron, pugi::xml_node* node);
 
-TxpSyllabify::TxpSyllabify() : TxpModule("syllabify") {}
+TxpSyllabify::TxpSyllabify() : TxpModule("syllabify"), cache_stats_(false) {}
 
 TxpSyllabify::~TxpSyllabify() {
 }
@@ -32,49 +32,44 @@ TxpSyllabify::~TxpSyllabify() {
 bool TxpSyllabify::Init(const TxpParseOptions &opts) {
   opts_ = &opts;
   tpdb_ = opts.GetTpdb();
-  sylmax_.Init(opts, std::string(GetOptValue("arch")));
-  return sylmax_.Parse(tpdb_);
+  sylmax_ = TxpTpdbStore::Get<TxpSylmax>(opts, std::string(GetOptValue("arch")));
+  cache_.SetCapacity(atoi(GetOptValue("cache-size")));
+  cache_stats_ = GetOptValueBool("cache-stats");
+  return sylmax_ != nullptr;
 }
 
 bool TxpSyllabify::Process(pugi::xml_document* input) {
-  std::string sylpron;
-  PhoneVector pvector;
+  KALDI_PROFILE_SCOPE("TxpSyllabify::Process");
+  std::vector<const char*> prons;
+  std::vector<std::string> sprons;
   pugi::xpath_node_set spts = input->document_element().select_nodes("//spt");
   spts.sort();
   for (pugi::xpath_node_set::const_iterator it = spts.begin();
        it != spts.end();
        ++it) {
-    pugi::xml_node pre_node;
     pugi::xml_node spt = (*it).node();
     pugi::xpath_node_set tks = spt.select_nodes("descendant::tk");
     tks.sort();
+    prons.clear();
     for (pugi::xpath_node_set::const_iterator it2 = tks.begin();
          it2 != tks.end();
-         ++it2) {
-      pugi::xml_node node = (*it2).node();
-      if (!node.attribute("pron").empty() && strlen(node.attribute("pron").value()) > 0) {
-        sylmax_.GetPhoneVector(node.attribute("pron").value(), &pvector);
-        if (it2 == tks.end() - 1) pvector[pvector.size() - 1].cross_word = false;
-        sylmax_.Maxonset(&pvector);
-        if (it2 != tks.begin()) {
-          sylmax_.Writespron(&pvector, &sylpron);
-          pre_node.append_attribute("spron").set_value(sylpron.c_str());
-          // add syllabic xml structure
-          _add_sylxml(sylpron.c_str(), &pre_node);
-        }
-        pre_node = node;
-      }
-      else {
-          node.append_attribute("spron").set_value("");
-      }
-    }
-    if (!pre_node.empty()) {
-      sylmax_.Writespron(&pvector, &sylpron);
-      pre_node.append_attribute("spron").set_value(sylpron.c_str());
+         ++it2)
+      prons.push_back((*it2).node().attribute("pron").value());
+    sylmax_->Syllabify(prons, &sprons, &cache_);
+    for (size_t i = 0; i < tks.size(); i++) {
+      pugi::xml_node node = tks[i].node();
+      node.append_attribute("spron").set_value(sprons[i].c_str());
       // add syllabic xml structure
-      _add_sylxml(sylpron.c_str(), &pre_node);
+      if (*prons[i]) _add_sylxml(sprons[i].c_str(), &node);
     }
   }
+  if (cache_stats_) {
+    pugi::xml_node header = GetHeader(input);
+    header.append_attribute("cache_lookups").set_value(
+        static_cast<double>(cache_.Lookups()));
+    header.append_attribute("cache_hits").set_value(
+        static_cast<double>(cache_.Hits()));
+  }
   return true;
 }
 
@@ -23,18 +23,21 @@
 // either text, tox (token oriented xml) tokens, or spurts (phrases)
 // containing tox tokens.
 
+#include <memory>
 #include <string>
 #include "pugixml.hpp"
 
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpmodule.h"
+#include "idlaktxp/txptpdbstore.h"
 #include "idlaktxp/txpsylmax.h"
 
 namespace kaldi {
 
 /// Syllabifies pronunciations into onset, nucleus, coda items
 /// Allows laison from left to right. /ref idlaktxp_syll
+/// Syllabifies the pronunciation of each token a spurt at a time
 class TxpSyllabify : public TxpModule {
  public:
   explicit TxpSyllabify();
@@ -45,7 +48,11 @@ class TxpSyllabify : public TxpModule {
  private:
   /// Object containing specifications of valid nucleus and onset
   /// phone sequences
-  TxpSylmax sylmax_;
+  std::shared_ptr<TxpSylmax> sylmax_;
+  /// Syllabification steps seen before, --syllabify-cache-size entries
+  TxpSylCache cache_;
+  /// If true write the cache counters to the txpheader
+  bool cache_stats_;
 };
 
 }  // namespace kaldi
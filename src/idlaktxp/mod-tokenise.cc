@@ -25,12 +25,14 @@ TxpTokenise::TxpTokenise() : TxpModule("tokenise") {}
 bool TxpTokenise::Init(const TxpParseOptions &opts) {
   opts_ = &opts;
   tpdb_ = opts.GetTpdb();
-  trules_.Init(opts, std::string(opts_->GetValue(GetName().c_str(), "arch")));
-  abbrev_.Init(opts, std::string(GetOptValue("arch")));
-  return trules_.Parse(tpdb_) && abbrev_.Parse(tpdb_);
+  trules_ = TxpTpdbStore::Get<TxpTrules>(
+      opts, std::string(opts_->GetValue(GetName().c_str(), "arch")));
+  abbrev_ = TxpTpdbStore::Get<TxpAbbrev>(opts, std::string(GetOptValue("arch")));
+  return trules_ && abbrev_;
 }
 
 bool TxpTokenise::Process(pugi::xml_document* input) {
+  KALDI_PROFILE_SCOPE("TxpTokenise::Process");
   const char* p;
   int32 n = 0;
   int32 offset, col = 0;
@@ -49,17 +51,17 @@ bool TxpTokenise::Process(pugi::xml_document* input) {
     p = node.value();
     while (*p) {
       // break off tokens and spacing and add as an element
-      p = trules_.ConsumeWhitespaceToken(p, &token, &wspace);
+      p = trules_->ConsumeWhitespaceToken(p, &token, &wspace);
       if (token.length()) {
         col += token.length();
         tkroot = tk = node.parent().insert_child_before("tk", node);
         ntxt = tk.append_child(pugi::node_pcdata);
         ntxt.set_value(token.c_str());
         n += 1;
-        trules_.ReplaceUtf8Punc(token, &tmp);
+        trules_->ReplaceUtf8Punc(token, &tmp);
         /// check for full token matches without partial punctuation
         /// i.e. :-) but not (US)
-        abbrev_info = abbrev_.LookupAbbrev(token.c_str());
+        abbrev_info = abbrev_->LookupAbbrev(token.c_str());
         if (abbrev_info) {
           for(int32 i = 0; i < abbrev_info->expansions.size(); i++) {
             if (!i) {
@@ -132,20 +134,20 @@ int32 TxpTokenise::SetPuncCaseInfo(std::string* tkin, pugi::xml_node* tk) {
   TxpAbbrevInfo * abbrev_info;
   p = tkin->c_str();
   while (*p) {
-    p = trules_.ConsumePunc(p, &prepunc);
-    p = trules_.ConsumeToken(p, &token);
-    p = trules_.ConsumePunc(p, &pstpunc);
+    p = trules_->ConsumePunc(p, &prepunc);
+    p = trules_->ConsumeToken(p, &token);
+    p = trules_->ConsumePunc(p, &pstpunc);
     if (n) {
       *tk = tk->parent().insert_child_after("tk", *tk);
     }
     // check to see if there is an abbreviation that matches the token and
     // completely or partially matches the punctuation
-    abbrev_info = abbrev_.LookupAbbrev(token.c_str(), prepunc.c_str(), pstpunc.c_str());
+    abbrev_info = abbrev_->LookupAbbrev(token.c_str(), prepunc.c_str(), pstpunc.c_str());
     if (abbrev_info) {
       // trim punctuation as appropriate
-      prepunc = prepunc.substr(0, prepunc.size() - abbrev_.CheckPrePunc(prepunc.c_str(), abbrev_info));
-      pstpunc = pstpunc.substr(abbrev_.CheckPstPunc(pstpunc.c_str(), abbrev_info),
-                                                    pstpunc.size() - abbrev_.CheckPstPunc(pstpunc.c_str(),
+      prepunc = prepunc.substr(0, prepunc.size() - abbrev_->CheckPrePunc(prepunc.c_str(), abbrev_info));
+      pstpunc = pstpunc.substr(abbrev_->CheckPstPunc(pstpunc.c_str(), abbrev_info),
+                                                    pstpunc.size() - abbrev_->CheckPstPunc(pstpunc.c_str(),
                                                                                           abbrev_info));
       for(int32 i = 0; i < abbrev_info->expansions.size(); i++) {
         if (!i) {
@@ -189,7 +191,7 @@ int32 TxpTokenise::SetPuncCaseInfo(std::string* tkin, pugi::xml_node* tk) {
       }
       if (token.length()) {
         tk->append_attribute("tknorm");
-        trules_.NormCaseCharacter(&token, caseinfo);
+        trules_->NormCaseCharacter(&token, caseinfo);
         tk->attribute("tknorm").set_value(token.c_str());
       }
       if (pstpunc.length()) {
@@ -23,8 +23,10 @@
 // either text, tox (token oriented xml) tokens, or spurts (phrases)
 // containing tox tokens.
 
+#include <memory>
 #include <string>
 #include "idlaktxp/txpmodule.h"
+#include "idlaktxp/txptpdbstore.h"
 #include "idlaktxp/txptrules.h"
 #include "idlaktxp/txpabbrev.h"
 
@@ -44,13 +46,12 @@ class TxpTokenise : public TxpModule {
   /// charcater info
   int32 SetPuncCaseInfo(std::string *tkin, pugi::xml_node *tk);
   /// A normalisation rule database used to decide case etc.
-  /// Currently this data will be loaded muliple times across
-  /// multiple modules
-  TxpTrules trules_;
+  /// Shared with other modules through TxpTpdbStore
+  std::shared_ptr<TxpTrules> trules_;
   /// Abbreviation data. This overides normalisation by directly
   /// replacing matching tokens with normalised results
   /// i.e. Dr. -> doctor
-  TxpAbbrev abbrev_;
+  std::shared_ptr<TxpAbbrev> abbrev_;
 };
 
 }  // namespace kaldi
@@ -28,39 +28,42 @@ TxpAbbrev::~TxpAbbrev() {
     delete(abbreviations_[i]);
   }
 }
+// The token is found with one walk of the trie, only the abbreviations with
+// that token have their punctuation checked
 TxpAbbrevInfo * TxpAbbrev::LookupAbbrev(const char * tk,
                                         const char * prepunc,
                                         const char * pstpunc) {
-  for (AbbrevVector::const_iterator it = abbreviations_.begin();
-       it != abbreviations_.end();
+  int32 index = tokens_.Find(tk);
+  if (index == TxpTrie::kNoValue) return NULL;
+  const AbbrevVector &abbs = by_token_[index];
+  for (AbbrevVector::const_iterator it = abbs.begin(); it != abbs.end();
        ++it) {
-    if (!strcmp(tk, (*it)->token.c_str())) {
-      if (CheckPrePunc(prepunc, (*it)) != NO_INDEX &&
-          (CheckPstPunc(pstpunc, (*it)) != NO_INDEX))
-        return (*it);
-    }
+    if (CheckPrePunc(prepunc, (*it)) != NO_INDEX &&
+        (CheckPstPunc(pstpunc, (*it)) != NO_INDEX))
+      return (*it);
   }
   return NULL;
 }
 
 TxpAbbrevInfo * TxpAbbrev::LookupAbbrev(const char * tk) {
-  for (AbbrevVector::const_iterator it = abbreviations_.begin();
-       it != abbreviations_.end();
+  int32 index = tokens_.Find(tk);
+  if (index == TxpTrie::kNoValue) return NULL;
+  const AbbrevVector &abbs = by_token_[index];
+  for (AbbrevVector::const_iterator it = abbs.begin(); it != abbs.end();
        ++it) {
-    if (!strcmp(tk, (*it)->token.c_str())) {
-      if ((*it)->prepunc.empty() && (*it)->pstpunc.empty())
-        return (*it);
-    }
+    if ((*it)->prepunc.empty() && (*it)->pstpunc.empty())
+      return (*it);
   }
   return NULL;
 }
 
 int32 TxpAbbrev::CheckPrePunc(const char * prepunc, TxpAbbrevInfo * abb) {
+  size_t len = strlen(prepunc);
   // no prepunc specified
   if (abb->prepunc.empty()) return 0;
   // prepunc matches
-  if (!strcmp(prepunc + strlen(prepunc) - abb->prepunc.size(),
-              abb->prepunc.c_str()))
+  if (len >= abb->prepunc.size() &&
+      !strcmp(prepunc + len - abb->prepunc.size(), abb->prepunc.c_str()))
     return abb->prepunc.size();
   // prepunc does not match
   return NO_INDEX;
@@ -108,6 +111,13 @@ void TxpAbbrev::EndElement(const char* name) {
     current_lexentry_ = "";
   } else if (!strcmp(name, "abb")) {
     abbreviations_.push_back(current_abbrev_);
+    int32 index = tokens_.Find(current_abbrev_->token);
+    if (index == TxpTrie::kNoValue) {
+      index = by_token_.size();
+      by_token_.push_back(AbbrevVector());
+      tokens_.Insert(current_abbrev_->token, index);
+    }
+    by_token_[index].push_back(current_abbrev_);
   }
 }
 
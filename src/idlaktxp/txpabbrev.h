@@ -26,6 +26,7 @@
 #include <string>
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
+#include "idlaktxp/txptrie.h"
 #include "idlaktxp/txpxmldata.h"
 #include "idlaktxp/txputf8.h"
 
@@ -59,6 +60,10 @@ class TxpAbbrev: public TxpXmlData {
   void CharHandler(const char* data, int32 len);
   /// vector of abbreviations to expand before normalisation
   AbbrevVector abbreviations_;
+  /// Abbreviations sharing each token in file order, indexed by the token
+  /// trie
+  std::vector<AbbrevVector> by_token_;
+  TxpTrie tokens_;
   /// Parser status currently operating on this abbreviation
   TxpAbbrevInfo * current_abbrev_;
   /// Parser status in this lex tag
@@ -0,0 +1,160 @@
+// idlaktxp/txpbinxml.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cstring>
+#include "idlaktxp/txpbinxml.h"
+#include "idlaktxp/txpsymbols.h"
+
+namespace kaldi {
+
+namespace {
+
+const char kMagic[4] = {'T', 'X', 'P', 'B'};
+const uint32 kVersion = 1;
+// magic, version, numbers of strings, nodes and attributes, string bytes
+const size_t kHeaderSize = 24;
+const int32 kNodeSize = 6;
+
+void AppendUint32(uint32 v, std::string* out) {
+  char b[4] = {static_cast<char>(v & 0xff), static_cast<char>((v >> 8) & 0xff),
+               static_cast<char>((v >> 16) & 0xff),
+               static_cast<char>((v >> 24) & 0xff)};
+  out->append(b, 4);
+}
+
+struct TxpBinaryXmlWriter {
+  TxpSymbolTable strings;
+  std::vector<uint32> nodes;
+  std::vector<uint32> attrs;
+  void Save(const pugi::xml_node &node) {
+    size_t n = nodes.size();
+    uint32 nattrs = 0;
+    nodes.push_back(node.type());
+    nodes.push_back(strings.Intern(node.name()));
+    nodes.push_back(strings.Intern(node.value()));
+    nodes.push_back(attrs.size() / 2);
+    for (pugi::xml_attribute a = node.first_attribute(); a;
+         a = a.next_attribute(), nattrs++) {
+      attrs.push_back(strings.Intern(a.name()));
+      attrs.push_back(strings.Intern(a.value()));
+    }
+    nodes.push_back(nattrs);
+    nodes.push_back(0);
+    for (pugi::xml_node child = node.first_child(); child;
+         child = child.next_sibling())
+      Save(child);
+    nodes[n + kNodeSize - 1] = nodes.size() / kNodeSize;
+  }
+};
+
+}  // namespace
+
+void TxpSaveBinaryXml(const pugi::xml_node &node, std::string* out) {
+  TxpBinaryXmlWriter writer;
+  std::vector<uint32> offsets;
+  std::string blob;
+  size_t i;
+  writer.Save(node);
+  for (i = 0; i < static_cast<size_t>(writer.strings.Size()); i++) {
+    offsets.push_back(blob.size());
+    blob.append(writer.strings.Name(i).c_str(),
+                writer.strings.Name(i).size() + 1);
+  }
+  out->clear();
+  out->append(kMagic, 4);
+  AppendUint32(kVersion, out);
+  AppendUint32(offsets.size(), out);
+  AppendUint32(writer.nodes.size() / kNodeSize, out);
+  AppendUint32(writer.attrs.size() / 2, out);
+  AppendUint32(blob.size(), out);
+  for (i = 0; i < offsets.size(); i++) AppendUint32(offsets[i], out);
+  for (i = 0; i < writer.nodes.size(); i++) AppendUint32(writer.nodes[i], out);
+  for (i = 0; i < writer.attrs.size(); i++) AppendUint32(writer.attrs[i], out);
+  out->append(blob);
+}
+
+bool TxpBinaryXml::Open(const char* data, size_t size) {
+  const uint32* header;
+  uint32 blobsize;
+  size_t tables;
+  int32 i;
+  nstrings_ = nnodes_ = nattrs_ = 0;
+  if (size < kHeaderSize || memcmp(data, kMagic, 4)) return false;
+  if (reinterpret_cast<size_t>(data) % sizeof(uint32)) {
+    aligned_.resize((size + sizeof(uint32) - 1) / sizeof(uint32));
+    memcpy(&(aligned_[0]), data, size);
+    data = reinterpret_cast<const char*>(&(aligned_[0]));
+  }
+  header = reinterpret_cast<const uint32*>(data);
+  // also rejects big endian hosts
+  if (header[1] != kVersion) return false;
+  tables = static_cast<size_t>(header[2]) + header[3] * kNodeSize +
+      header[4] * 2;
+  blobsize = header[5];
+  if (size != kHeaderSize + tables * sizeof(uint32) + blobsize) return false;
+  offsets_ = header + kHeaderSize / sizeof(uint32);
+  nodes_ = offsets_ + header[2];
+  attrs_ = nodes_ + header[3] * kNodeSize;
+  strings_ = reinterpret_cast<const char*>(attrs_ + header[4] * 2);
+  if (!header[3] || !blobsize || strings_[blobsize - 1]) return false;
+  for (i = 0; i < static_cast<int32>(header[2]); i++)
+    if (offsets_[i] >= blobsize) return false;
+  for (i = 0; i < static_cast<int32>(header[4] * 2); i++)
+    if (attrs_[i] >= header[2]) return false;
+  for (i = 0; i < static_cast<int32>(header[3]); i++) {
+    const uint32* n = nodes_ + i * kNodeSize;
+    if (n[kName] >= header[2] || n[kValue] >= header[2] ||
+        n[kAttr] + n[kNumAttrs] > header[4] ||
+        n[kEnd] <= static_cast<uint32>(i) || n[kEnd] > header[3])
+      return false;
+  }
+  nstrings_ = header[2];
+  nnodes_ = header[3];
+  nattrs_ = header[4];
+  return true;
+}
+
+const char* TxpBinaryXml::Attribute(int32 node, const char* name) const {
+  for (int32 a = 0; a < NumAttributes(node); a++)
+    if (!strcmp(AttributeName(node, a), name)) return AttributeValue(node, a);
+  return NULL;
+}
+
+void TxpBinaryXml::Load(pugi::xml_document* doc) const {
+  doc->reset();
+  if (nnodes_) LoadNode(0, *doc);
+}
+
+// The saved node may be a whole document or a node below it
+void TxpBinaryXml::LoadNode(int32 node, pugi::xml_node parent) const {
+  pugi::xml_node xnode = parent;
+  int32 child;
+  if (Type(node) != pugi::node_document) {
+    xnode = parent.append_child(Type(node));
+    if (*Name(node)) xnode.set_name(Name(node));
+    if (*Value(node)) xnode.set_value(Value(node));
+    for (int32 a = 0; a < NumAttributes(node); a++)
+      xnode.append_attribute(AttributeName(node, a)).set_value(
+          AttributeValue(node, a));
+  }
+  for (child = FirstChild(node); child != kNoNode;
+       child = NextSibling(node, child))
+    LoadNode(child, xnode);
+}
+
+}  // namespace kaldi
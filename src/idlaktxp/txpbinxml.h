@@ -0,0 +1,98 @@
+// idlaktxp/txpbinxml.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPBINXML_H_
+#define KALDI_IDLAKTXP_TXPBINXML_H_
+
+// This file defines a binary form of a txp document, for passing
+// processed documents between processes without printing and parsing XML
+
+#include <string>
+#include <vector>
+#include "pugixml.hpp"
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Write the document (or any node and its descendants) in binary form.
+///
+/// The layout is a header, string offsets, nodes in document order, then
+/// attributes and a table of null terminated strings in which each distinct
+/// name and value is stored once. All numbers are 32 bit little endian, so
+/// a buffer read into 4 byte aligned memory can be used in place.
+void TxpSaveBinaryXml(const pugi::xml_node &node, std::string* out);
+
+/// Read access to a binary document without copying it.
+///
+/// Nodes are numbered in document order with 0 the node that was saved,
+/// the children of a node run from node + 1 to its end. Strings returned
+/// point into the buffer, which must outlive the reader.
+class TxpBinaryXml {
+ public:
+  /// Returned for a missing child, sibling or attribute index
+  static const int32 kNoNode = -1;
+  TxpBinaryXml() : nstrings_(0), nnodes_(0), nattrs_(0) {}
+  ~TxpBinaryXml() {}
+  /// Check the buffer and use it, false if it is not a valid binary document
+  bool Open(const char* data, size_t size);
+  int32 NumNodes() const {return nnodes_;}
+  /// The pugixml node type
+  pugi::xml_node_type Type(int32 node) const {
+    return static_cast<pugi::xml_node_type>(Node(node)[kType]);
+  }
+  const char* Name(int32 node) const {return String(Node(node)[kName]);}
+  const char* Value(int32 node) const {return String(Node(node)[kValue]);}
+  int32 FirstChild(int32 node) const {
+    return node + 1 < End(node) ? node + 1 : kNoNode;
+  }
+  /// Next sibling of a child of parent
+  int32 NextSibling(int32 parent, int32 node) const {
+    return End(node) < End(parent) ? End(node) : kNoNode;
+  }
+  int32 NumAttributes(int32 node) const {return Node(node)[kNumAttrs];}
+  const char* AttributeName(int32 node, int32 a) const {
+    return String(attrs_[2 * (Node(node)[kAttr] + a)]);
+  }
+  const char* AttributeValue(int32 node, int32 a) const {
+    return String(attrs_[2 * (Node(node)[kAttr] + a) + 1]);
+  }
+  /// The value of the named attribute or NULL
+  const char* Attribute(int32 node, const char* name) const;
+  /// Rebuild the document as pugixml
+  void Load(pugi::xml_document* doc) const;
+
+ private:
+  // fields of each node record
+  enum {kType = 0, kName, kValue, kAttr, kNumAttrs, kEnd, kNodeSize};
+  const uint32* Node(int32 node) const {return nodes_ + node * kNodeSize;}
+  int32 End(int32 node) const {return Node(node)[kEnd];}
+  const char* String(uint32 id) const {return strings_ + offsets_[id];}
+  void LoadNode(int32 node, pugi::xml_node parent) const;
+  // copy of a buffer which was not 4 byte aligned
+  std::vector<uint32> aligned_;
+  int32 nstrings_, nnodes_, nattrs_;
+  const uint32* offsets_;
+  const uint32* nodes_;
+  const uint32* attrs_;
+  const char* strings_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPBINXML_H_
@@ -16,11 +16,52 @@
 // limitations under the License.
 //
 
+#include <algorithm>
+#include "util/text-utils.h"
 #include "idlaktxp/txpcexspec.h"
 #include "idlaktxp/cexfunctions.h"
 
 namespace kaldi {
 
+// compiled equivalents of the catalog feature functions
+struct TxpCexspecOpDef {
+  const char* name;
+  enum CEXSPEC_OP op;
+  int32 offset;
+  // type of the values the op reads, which must be the type of the feature
+  enum CEXSPEC_TYPE type;
+};
+
+static const TxpCexspecOpDef CEXSPEC_OPS[] = {
+  {"BackwardBackwardPhone", CEXSPEC_OP_PHONE, -2, CEXSPEC_TYPE_STR},
+  {"BackwardPhone", CEXSPEC_OP_PHONE, -1, CEXSPEC_TYPE_STR},
+  {"Phone", CEXSPEC_OP_PHONE, 0, CEXSPEC_TYPE_STR},
+  {"ForwardPhone", CEXSPEC_OP_PHONE, 1, CEXSPEC_TYPE_STR},
+  {"ForwardForwardPhone", CEXSPEC_OP_PHONE, 2, CEXSPEC_TYPE_STR},
+  {"SegmentLocationFromFront", CEXSPEC_OP_SEG_FRONT, 0, CEXSPEC_TYPE_INT},
+  {"SegmentLocationFromBack", CEXSPEC_OP_SEG_BACK, 0, CEXSPEC_TYPE_INT},
+  {"BackwardSyllableNumPhones", CEXSPEC_OP_SYL_NOPHONS, -1, CEXSPEC_TYPE_INT},
+  {"SyllableNumPhones", CEXSPEC_OP_SYL_NOPHONS, 0, CEXSPEC_TYPE_INT},
+  {"ForwardSyllableNumPhones", CEXSPEC_OP_SYL_NOPHONS, 1, CEXSPEC_TYPE_INT},
+  {"BackwardSyllableStress", CEXSPEC_OP_SYL_STRESS, -1, CEXSPEC_TYPE_INT},
+  {"SyllableStress", CEXSPEC_OP_SYL_STRESS, 0, CEXSPEC_TYPE_INT},
+  {"ForwardSyllableStress", CEXSPEC_OP_SYL_STRESS, 1, CEXSPEC_TYPE_INT},
+  {"BackwardWordPosTag", CEXSPEC_OP_WORD_POS, -1, CEXSPEC_TYPE_STR},
+  {"WordPosTag", CEXSPEC_OP_WORD_POS, 0, CEXSPEC_TYPE_STR},
+  {"ForwardWordPosTag", CEXSPEC_OP_WORD_POS, 1, CEXSPEC_TYPE_STR},
+  {"BackwardWordNumSyls", CEXSPEC_OP_WORD_NOSYL, -1, CEXSPEC_TYPE_INT},
+  {"WordNumSyls", CEXSPEC_OP_WORD_NOSYL, 0, CEXSPEC_TYPE_INT},
+  {"ForwardWordNumSyls", CEXSPEC_OP_WORD_NOSYL, 1, CEXSPEC_TYPE_INT},
+  {"PhraseNumWords", CEXSPEC_OP_SPT_NOWORDS, 0, CEXSPEC_TYPE_INT},
+  {"PhraseTobiEndTone", CEXSPEC_OP_SPT_TONE, 0, CEXSPEC_TYPE_STR},
+  {"BackwardBackwardPhoneKaldi", CEXSPEC_OP_PHONE_KALDI, -2, CEXSPEC_TYPE_STR},
+  {"BackwardPhoneKaldi", CEXSPEC_OP_PHONE_KALDI, -1, CEXSPEC_TYPE_STR},
+  {"PhoneKaldi", CEXSPEC_OP_PHONE_KALDI, 0, CEXSPEC_TYPE_STR},
+  {"ForwardPhoneKaldi", CEXSPEC_OP_PHONE_KALDI, 1, CEXSPEC_TYPE_STR},
+  {"ForwardForwardPhoneKaldi", CEXSPEC_OP_PHONE_KALDI, 2, CEXSPEC_TYPE_STR},
+  {NULL, CEXSPEC_OP_FUNC, 0, CEXSPEC_TYPE_STR}
+};
+
 // parse file into Cexspec class adding feature specification and
 // feature functions to architecture
 void TxpCexspec::StartElement(const char* name, const char** atts) {
@@ -106,6 +147,17 @@ void TxpCexspec::StartElement(const char* name, const char** atts) {
     }
     feat.delim = att;
     feat.func = CEXFUNC[featidx];
+    feat.op = CEXSPEC_OP_FUNC;
+    feat.offset = 0;
+    const TxpCexspecOpDef* opdef = NULL;
+    for (const TxpCexspecOpDef* op = CEXSPEC_OPS; op->name; op++) {
+      if (curfunc_ == op->name) {
+        feat.op = op->op;
+        feat.offset = op->offset;
+        opdef = op;
+      }
+    }
+    feat.min = 0;
     feat.pause_context = false;
     SetAttribute("pauctx", atts, &att);
     if (att == "true" || att == "True" || att == "TRUE") {
@@ -113,6 +165,12 @@ void TxpCexspec::StartElement(const char* name, const char** atts) {
     }
     SetAttribute("pauctx", atts, &att2);
     feat.type = CEXFUNCTYPE[featidx];
+    if (opdef && opdef->type != feat.type) {
+      // IntCode and StringCode give the error value for every phone
+      KALDI_WARN << "Feature architecture " << curfunc_ << " is declared as "
+                 << (feat.type == CEXSPEC_TYPE_INT ? "integer" : "string")
+                 << " but its values are not";
+    }
     if (feat.type == CEXSPEC_TYPE_STR) {
       SetAttribute("set", atts, &att);
       if (att.empty()) {
@@ -172,6 +230,41 @@ void TxpCexspec::StartElement(const char* name, const char** atts) {
   }
 }
 
+// a feature is complete, with its mappings, at the end of its element
+void TxpCexspec::EndElement(const char* name) {
+  if (!strcmp(name, "feat") && !cexspecfeats_.empty() &&
+      cexspecfeats_.back().outputs.empty())
+    CompileFeature(&(cexspecfeats_.back()));
+}
+
+// pre-compute the output of every value the feature can take so extraction
+// only looks up codes
+void TxpCexspec::CompileFeature(TxpCexspecFeat* feat) {
+  std::stringstream stream;
+  feat->codes.clear();
+  feat->outputs.clear();
+  feat->code_min = 0;
+  if (feat->type == CEXSPEC_TYPE_STR) {
+    const StringSet &set = sets_.find(feat->set)->second;
+    for (StringSet::const_iterator i = set.begin(); i != set.end(); ++i) {
+      feat->codes.insert(LookupCode::value_type(*i, feat->outputs.size()));
+      feat->outputs.push_back(feat->delim + Mapping(*feat, *i));
+    }
+  } else if (feat->type == CEXSPEC_TYPE_INT) {
+    // values are clipped to min then max
+    feat->code_min = std::min(feat->min, feat->max);
+    for (int32 i = feat->code_min; i <= feat->max; i++) {
+      stream.str("");
+      stream << i;
+      feat->outputs.push_back(feat->delim + Mapping(*feat, stream.str()));
+    }
+  }
+  feat->null_code = feat->outputs.size();
+  feat->outputs.push_back(feat->delim + Mapping(*feat, feat->nullvalue));
+  feat->error_code = feat->outputs.size();
+  feat->outputs.push_back(feat->delim + CEXSPEC_ERROR);
+}
+
 /// return maximum width in bytes of feature string
 int32 TxpCexspec::MaxFeatureSize() {
   int32 maxsize = 0;
@@ -244,19 +337,113 @@ int32 TxpCexspec::AddPauseNodes(pugi::xml_document* doc) {
 }
 
 // call the feature functions
-bool TxpCexspec::ExtractFeatures(const TxpCexspecContext &context, std::string* buf) {
-  TxpCexspecFeatVector::iterator iter;
-  struct TxpCexspecFeat feat;
+bool TxpCexspec::ExtractFeatures(const TxpCexspecContext &context,
+                                 std::string* buf) const {
+  TxpCexspecFeatVector::const_iterator iter;
   bool rval = true;
+  int32 code;
   // iterate through features inserting nulls when required
   for (iter = cexspecfeats_.begin(); iter != cexspecfeats_.end(); ++iter) {
-    feat = *iter;
-    if (!feat.func(this, &feat, &context, buf))
-      rval = false;
+    const TxpCexspecFeat &feat = *iter;
+    if (feat.op == CEXSPEC_OP_FUNC) {
+      if (!feat.func(this, &feat, &context, buf))
+        rval = false;
+    } else {
+      code = FeatureCode(feat, context);
+      buf->append(feat.outputs[code]);
+      if (code == feat.error_code) rval = false;
+    }
+  }
+  return rval;
+}
+
+bool TxpCexspec::ExtractFeatures(const TxpCexspecContext &context,
+                                 std::vector<int32>* codes) const {
+  TxpCexspecFeatVector::const_iterator iter;
+  std::string buf;
+  bool rval = true;
+  int32 code;
+  codes->clear();
+  for (iter = cexspecfeats_.begin(); iter != cexspecfeats_.end(); ++iter) {
+    const TxpCexspecFeat &feat = *iter;
+    if (feat.op == CEXSPEC_OP_FUNC) {
+      // recover the code from the text the function appends
+      buf.clear();
+      feat.func(this, &feat, &context, &buf);
+      code = std::find(feat.outputs.begin(), feat.outputs.end(), buf) -
+          feat.outputs.begin();
+      if (code == feat.outputs.size()) code = feat.error_code;
+    } else {
+      code = FeatureCode(feat, context);
+    }
+    if (code == feat.error_code) rval = false;
+    codes->push_back(code);
   }
   return rval;
 }
 
+// compiled versions of the functions in cexfunctions.cc
+int32 TxpCexspec::FeatureCode(const TxpCexspecFeat &feat,
+                              const TxpCexspecContext &context) const {
+  int32 i, j;
+  const char* s;
+  switch (feat.op) {
+    case CEXSPEC_OP_PHONE:
+      i = context.GetPhoneIndex(feat.offset, feat.pause_context);
+      if (i < 0) return feat.null_code;
+      return StringCode(feat, context.GetPhoneItem(i).val);
+    case CEXSPEC_OP_PHONE_KALDI:
+      i = context.GetPhoneIndex(feat.offset, feat.pause_context);
+      if (i < 0) return feat.null_code;
+      return StringCode(feat, context.GetPhoneItem(i).kaldi.c_str());
+    case CEXSPEC_OP_SEG_FRONT:
+      // ids start at 1 in the xml, but we want them to start at 0
+      i = context.GetPhoneIndex(0, feat.pause_context);
+      return IntCode(feat, context.GetPhoneItem(i).phonid - 1);
+    case CEXSPEC_OP_SEG_BACK:
+      i = context.GetPhoneIndex(0, feat.pause_context);
+      j = context.GetSyllableIndex(0);
+      return IntCode(feat, (j < 0 ? 0 : context.GetSyllableNumPhones(j)) -
+                     context.GetPhoneItem(i).phonid);
+    case CEXSPEC_OP_SYL_NOPHONS:
+      i = context.GetSyllableIndex(feat.offset);
+      return IntCode(feat, i < 0 ? 0 : context.GetSyllableNumPhones(i));
+    case CEXSPEC_OP_SYL_STRESS:
+      i = context.GetSyllableIndex(feat.offset);
+      return IntCode(feat, i < 0 ? 0 : context.GetSyllableStress(i));
+    case CEXSPEC_OP_WORD_POS:
+      i = context.GetWordIndex(feat.offset);
+      return StringCode(feat, i < 0 ? "PAU" : context.GetWordPosTag(i));
+    case CEXSPEC_OP_WORD_NOSYL:
+      i = context.GetWordIndex(feat.offset);
+      return IntCode(feat, i < 0 ? 0 : context.GetWordNumSyls(i));
+    case CEXSPEC_OP_SPT_NOWORDS:
+      i = context.GetSpurtIndex(feat.offset);
+      return IntCode(feat, i < 0 ? 0 : context.GetSpurtNumWords(i));
+    case CEXSPEC_OP_SPT_TONE:
+      i = context.GetSpurtIndex(feat.offset);
+      s = (i < 0) ? NULL : context.GetSpurtTobiEndTone(i);
+      if (!s) return feat.null_code;
+      return StringCode(feat, s);
+    default:
+      return feat.error_code;
+  }
+}
+
+int32 TxpCexspec::StringCode(const TxpCexspecFeat &feat, const char* s) const {
+  if (feat.type != CEXSPEC_TYPE_STR) return feat.error_code;
+  LookupCode::const_iterator i = feat.codes.find(std::string(s));
+  if (i == feat.codes.end()) return feat.error_code;
+  return i->second;
+}
+
+int32 TxpCexspec::IntCode(const TxpCexspecFeat &feat, int32 i) const {
+  if (feat.type != CEXSPEC_TYPE_INT) return feat.error_code;
+  if (i < feat.min) i = feat.min;
+  if (i > feat.max) i = feat.max;
+  return i - feat.code_min;
+}
+
 /// utility to return index of a feature function
 int32 TxpCexspec::GetFeatureIndex(const std::string &name) {
   for (int i = 0; i < CEX_NO_FEATURES; i++) {
@@ -345,47 +532,129 @@ char* TxpCexspecModels::Append() {
 
 TxpCexspecContext::TxpCexspecContext(const pugi::xml_document &doc,
                        enum CEXSPECPAU_HANDLER pauhand) : pauhand_(pauhand) {
-  phones_ = doc.document_element().select_nodes("//phon");
-  syllables_ = doc.document_element().select_nodes("//syl");
-  words_ = doc.document_element().select_nodes("//tk");
-  spurts_ = doc.document_element().select_nodes("//spt");
-  utterances_ = doc.document_element().select_nodes("//utt");
-  phones_.sort();
-  syllables_.sort();
-  words_.sort();
-  spurts_.sort();
-  utterances_.sort();
-  current_phone_ = phones_.begin();
-  current_syllable_ = syllables_.begin();
-  current_word_ = words_.begin();
-  current_spurt_ = spurts_.begin();
-  current_utterance_ = utterances_.begin();
+  Flatten(doc, -1, -1, -1, -1);
+  phone_idx_ = 0;
+  syllable_idx_ = 0;
+  word_idx_ = 0;
+  spurt_idx_ = 0;
+  utterance_idx_ = 0;
+  if (!phones_.empty()) SetParents();
+  // read the values used by compiled features once for each item
+  pugi::xml_node node, sylnode, tknode, brk;
+  pugi::xml_attribute attribute;
+  size_t i;
+  for (i = 0; i < phones_.size(); i++) {
+    TxpCexspecPhoneItem item;
+    node = phones_[i];
+    item.val = node.attribute("val").value();
+    item.pau = !strcmp("pau", item.val);
+    item.phonid = atoi(node.attribute("phonid").value());
+    // kaldi style name, see CexFuncStringPhoneKaldi
+    item.kaldi = item.val;
+    sylnode = (phone_syllables_[i] < 0) ? pugi::xml_node() :
+        syllables_[phone_syllables_[i]];
+    tknode = GetContextUp(sylnode, "tk");
+    if (!strcmp("nucleus", node.attribute("type").value())) {
+      item.kaldi += sylnode.attribute("stress").value();
+    }
+    // standalone phone or a pause (has no nosyls attribute)
+    if (tknode.attribute("nosyl").empty() ||
+        (!strcmp("1", tknode.attribute("nosyl").value()) &&
+         !strcmp("1", sylnode.attribute("nophons").value())))
+      item.kaldi += "_S";
+    else if (!strcmp("1", sylnode.attribute("sylid").value()) &&
+             !strcmp("1", node.attribute("phonid").value()))
+      item.kaldi += "_B";
+    else if (!strcmp(sylnode.attribute("sylid").value(),
+                tknode.attribute("nosyl").value()) &&
+        !strcmp(node.attribute("phonid").value(),
+                sylnode.attribute("nophons").value()))
+      item.kaldi += "_E";
+    else
+      item.kaldi += "_I";
+    phone_items_.push_back(item);
+  }
+  for (i = 0; i < syllables_.size(); i++) {
+    node = syllables_[i];
+    syl_nophons_.push_back(atoi(node.attribute("nophons").value()));
+    syl_stress_.push_back(atoi(node.attribute("stress").value()));
+  }
+  for (i = 0; i < words_.size(); i++) {
+    node = words_[i];
+    attribute = node.attribute("pos");
+    word_pos_.push_back(attribute.empty() ? "PAU" : attribute.value());
+    word_nosyl_.push_back(atoi(node.attribute("nosyl").value()));
+  }
+  for (i = 0; i < spurts_.size(); i++) {
+    // ToBI end tone from the type of the last break in the spurt
+    // LH for every type except 4 and 0, identical behaviour to the
+    // commercial front-end
+    brk = spurts_[i].last_child();
+    while (!brk.empty() && strcmp(brk.name(), "break"))
+      brk = brk.previous_sibling();
+    const char* tone = NULL;
+    if (!brk.empty()) {
+      int32 break_type = atoi(brk.attribute("type").value());
+      if (break_type >= 1 && break_type <= 3) tone = "LH";
+      else if (break_type == 4) tone = "LL";
+    }
+    spurt_nowords_.push_back(atoi(spurts_[i].attribute("no_wrds").value()));
+    spurt_tone_.push_back(tone);
+  }
+}
+
+void TxpCexspecContext::Flatten(const pugi::xml_node &node, int32 syl,
+                                int32 wrd, int32 spt, int32 utt) {
+  pugi::xml_node child;
+  const char* name;
+  for (child = node.first_child(); !child.empty();
+       child = child.next_sibling()) {
+    if (child.type() != pugi::node_element) continue;
+    name = child.name();
+    if (!strcmp(name, "phon")) {
+      phones_.push_back(child);
+      phone_syllables_.push_back(syl);
+      phone_words_.push_back(wrd);
+      phone_spurts_.push_back(spt);
+      phone_utterances_.push_back(utt);
+      Flatten(child, syl, wrd, spt, utt);
+    } else if (!strcmp(name, "syl")) {
+      syllables_.push_back(child);
+      Flatten(child, syllables_.size() - 1, wrd, spt, utt);
+    } else if (!strcmp(name, "tk")) {
+      words_.push_back(child);
+      Flatten(child, syl, words_.size() - 1, spt, utt);
+    } else if (!strcmp(name, "spt")) {
+      spurts_.push_back(child);
+      Flatten(child, syl, wrd, spurts_.size() - 1, utt);
+    } else if (!strcmp(name, "utt")) {
+      utterances_.push_back(child);
+      Flatten(child, syl, wrd, spt, utterances_.size() - 1);
+    } else {
+      Flatten(child, syl, wrd, spt, utt);
+    }
+  }
+}
+
+// dummy pau items already added for tk and syl levels so every phone
+// normally has a parent at each level, if not keep the previous one
+void TxpCexspecContext::SetParents() {
+  if (phone_syllables_[phone_idx_] >= 0)
+    syllable_idx_ = phone_syllables_[phone_idx_];
+  if (phone_words_[phone_idx_] >= 0)
+    word_idx_ = phone_words_[phone_idx_];
+  if (phone_spurts_[phone_idx_] >= 0)
+    spurt_idx_ = phone_spurts_[phone_idx_];
+  if (phone_utterances_[phone_idx_] >= 0)
+    utterance_idx_ = phone_utterances_[phone_idx_];
 }
 
 bool TxpCexspecContext::Next() {
-  pugi::xml_node node, phon, empty;
-
-  // std::cout << (current_phone_->node()).attribute("val").value() << ":"
-  //           << (current_syllable_->node()).attribute("val").value() << ":"
-  //           << (current_word_->node()).attribute("norm").value() << ":"
-  //           << (current_spurt_->node()).attribute("phraseid").value() << ":"
-  //           << (current_utterance_->node()).attribute("uttid").value() << " "
-  //           << (current_phone_->node()).attribute("type").value() << "\n";
   // iterate over phone/break items
-  current_phone_++;
-  if (current_phone_ == phones_.end()) return false;
-  phon = current_phone_->node();
-  // update other iterators as required
-  // dummy pau items already added for tk and syl levels
-  node = GetContextUp(phon, "syl");
-  while (node != current_syllable_->node()) current_syllable_++;
-  node = GetContextUp(phon, "tk");
-  while (node != current_word_->node()) current_word_++;
-  node = GetContextUp(phon, "spt");
-  while (node != current_spurt_->node()) current_spurt_++;
-  node = GetContextUp(phon, "utt");
-  while (node != current_utterance_->node()) current_utterance_++;
-
+  phone_idx_++;
+  if (phone_idx_ >= static_cast<int32>(phones_.size())) return false;
+  // update other indices as required
+  SetParents();
   return true;
 }
 
@@ -405,102 +674,127 @@ pugi::xml_node TxpCexspecContext::GetContextUp(const pugi::xml_node &node,
 // return phon back or forwards from current phone
 pugi::xml_node TxpCexspecContext::GetPhone(const int32 idx,
                                            const bool pause_context) const {
-  int32 i;
-  int32 pau_found = 0;
-  pugi::xml_node empty;
-  if (idx >= 0) {
-    for (i = 0; i < idx; i++) {
-      if ((current_phone_ + i) == phones_.end()) return empty;
-      if (!strcmp("pau", (current_phone_ + i)->node().attribute("val").value()))
-        pau_found++;
-    }
-  } else {
-    for (i = 0; i > idx; i--) {
-      if ((current_phone_ + i) == phones_.begin()) return empty;
-      if (!strcmp("pau", (current_phone_ + i)->node().attribute("val").value()))
-        pau_found++;
-    }
-  }
-  if ((current_phone_ + i) == phones_.end()) return empty;
-  if (pau_found == 2 && !pause_context) return empty;
-  return (current_phone_ + i)->node();
+  int32 i = GetPhoneIndex(idx, pause_context);
+  return (i < 0) ? pugi::xml_node() : phones_[i];
+}
+
+// phones are empty if the context crosses two pauses, unless pause_context
+int32 TxpCexspecContext::GetPhoneIndex(const int32 idx,
+                                       const bool pause_context) const {
+  int32 i, target = phone_idx_ + idx, pau_found = 0;
+  if (ContextIndex(target, phone_items_.size()) < 0) return -1;
+  for (i = phone_idx_; i != target; i += (idx > 0) ? 1 : -1)
+    if (phone_items_[i].pau) pau_found++;
+  if (pau_found == 2 && !pause_context) return -1;
+  return target;
 }
 
 // return parent syllable back or forwards from current phone
 pugi::xml_node TxpCexspecContext::GetSyllable(const int32 idx,
                                               const bool pause_context) const {
-  int32 i;
-  // int32 pau_found = 0;
-  pugi::xml_node empty;
-  // Get the parent syllable node of the current phone.
-  if (idx >= 0) {
-    for (i = 0; i < idx; i++) {
-      if ((current_syllable_ + i) == syllables_.end()) return empty;
-      // if (!strcmp("pau", (cur_phon_ + i)->node().attribute("val").value()))
-        // pau_found++;
-    }
-  } else {
-    for (i = 0; i > idx; i--) {
-      if ((current_syllable_ + i) == syllables_.begin()) return empty;
-      // if (!strcmp("pau", (cur_phon_ + i)->node().attribute("val").value()))
-        // pau_found++;
-    }
-  }
-  if ((current_syllable_ + i) == syllables_.end()) return empty;
-  // if (pau_found == 2 && !pauctx) return empty;
-  return (current_syllable_ + i)->node();
+  int32 i = GetSyllableIndex(idx);
+  return (i < 0) ? pugi::xml_node() : syllables_[i];
 }
 
 // return parent token back or forwards from current phone
 pugi::xml_node TxpCexspecContext::GetWord(const int32 idx,
                                           const bool pause_context) const {
-  int32 i;
-  // int32 pau_found = 0;
-  pugi::xml_node empty;
-  // Get the parent token node of the current phone.
-  if (idx >= 0) {
-    for (i = 0; i < idx; i++) {
-      if ((current_word_ + i) == words_.end()) return empty;
-      // if (!strcmp("pau", (cur_phon_ + i)->node().attribute("val").value()))
-        // pau_found++;
-    }
-  } else {
-    for (i = 0; i > idx; i--) {
-      if ((current_word_ + i) == words_.begin()) return empty;
-      // if (!strcmp("pau", (cur_phon_ + i)->node().attribute("val").value()))
-        // pau_found++;
-    }
-  }
-  if ((current_word_ + i) == words_.end()) return empty;
-  // if (pau_found == 2 && !pauctx) return empty;
-  return (current_word_ + i)->node();
+  int32 i = GetWordIndex(idx);
+  return (i < 0) ? pugi::xml_node() : words_[i];
 }
 
 // return parent spurt back or forwards from current phone
 pugi::xml_node TxpCexspecContext::GetSpurt(const int32 idx,
                                            const bool pause_context) const {
-  int32 i;
-  // int32 pau_found = 0;
-  pugi::xml_node empty;
-  // Get the parent token node of the current phone.
-  if (idx >= 0) {
-    for (i = 0; i < idx; i++) {
-      if ((current_spurt_ + i) == spurts_.end()) return empty;
-      // if (!strcmp("pau", (cur_phon_ + i)->node().attribute("val").value()))
-        // pau_found++;
-    }
-  } else {
-    for (i = 0; i > idx; i--) {
-      if ((current_spurt_ + i) == spurts_.begin()) return empty;
-      // if (!strcmp("pau", (cur_phon_ + i)->node().attribute("val").value()))
-        // pau_found++;
-    }
+  int32 i = GetSpurtIndex(idx);
+  return (i < 0) ? pugi::xml_node() : spurts_[i];
+}
+
+
+// string values are sorted and numbered from column 0, '0' has no column
+static int32 DnnColumns(const std::vector<std::string> &values, int32 zero,
+                        LookupCode* cols) {
+  std::vector<std::string> sorted(values);
+  std::sort(sorted.begin(), sorted.end());
+  int32 dim = 0;
+  cols->clear();
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (sorted[i] == "0")
+      (*cols)[sorted[i]] = zero;
+    else
+      (*cols)[sorted[i]] = dim++;
   }
-  if ((current_spurt_ + i) == spurts_.end()) return empty;
-  // if (pau_found == 2 && !pauctx) return empty;
-  return (current_spurt_ + i)->node();
+  return dim;
 }
 
+bool TxpCexspecDnnEncoding::Init(
+    const TxpCexspec &cexspec,
+    const std::vector<std::vector<std::string> > &values) {
+  int32 nfeats = cexspec.NumFeatures();
+  LookupCode cols;
+  LookupCode::const_iterator col;
+  std::string val;
+  if (values.size() != static_cast<size_t>(nfeats + 1)) {
+    KALDI_WARN << "DNN encoding has values for " << values.size()
+               << " features, the architecture has " << nfeats + 1;
+    return false;
+  }
+  phone_dim_ = DnnColumns(values[0], kZero, &phone_cols_);
+  dim_ = phone_dim_;
+  offsets_.resize(nfeats);
+  values_.resize(nfeats);
+  is_int_.resize(nfeats);
+  names_.resize(nfeats);
+  for (int32 f = 0; f < nfeats; f++) {
+    const TxpCexspecFeat &feat = cexspec.GetFeature(f);
+    offsets_[f] = dim_;
+    is_int_[f] = feat.type == CEXSPEC_TYPE_INT;
+    if (is_int_[f])
+      dim_++;
+    else
+      dim_ += DnnColumns(values[f + 1], kZero, &cols);
+    values_[f].resize(feat.outputs.size());
+    names_[f].resize(feat.outputs.size());
+    // the value is the model name text after the delimiter
+    for (size_t code = 0; code < feat.outputs.size(); code++) {
+      val = feat.outputs[code].substr(feat.delim.size());
+      Trim(&val);
+      names_[f][code] = val;
+      if (is_int_[f]) {
+        values_[f][code] = atoi(val.c_str());
+      } else {
+        col = cols.find(val);
+        values_[f][code] = (col == cols.end()) ? kUnknown : col->second;
+      }
+    }
+  }
+  return true;
+}
 
+void TxpCexspecDnnEncoding::Encode(const char* phone,
+                                   const std::vector<int32> &codes,
+                                   VectorBase<BaseFloat>* row) const {
+  LookupCode::const_iterator col;
+  int32 val;
+  KALDI_ASSERT(row->Dim() == dim_ && codes.size() == offsets_.size());
+  row->SetZero();
+  col = phone_cols_.find(phone);
+  if (col == phone_cols_.end())
+    KALDI_WARN << "Unknown phone for DNN features: " << phone;
+  else if (col->second != kZero)
+    (*row)(col->second) = 1.0;
+  for (size_t f = 0; f < codes.size(); f++) {
+    val = values_[f][codes[f]];
+    if (is_int_[f]) {
+      (*row)(offsets_[f]) = val;
+    } else if (val == kUnknown) {
+      KALDI_WARN << "Unknown value '" << names_[f][codes[f]]
+                 << "' for DNN features, phone " << phone << " feature "
+                 << f + 1;
+    } else if (val != kZero) {
+      (*row)(offsets_[f] + val) = 1.0;
+    }
+  }
+}
 
 }  // namespace kaldi
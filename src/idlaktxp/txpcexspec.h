@@ -22,13 +22,14 @@
 // This file defines the feature extraction system
 
 #include <pugixml.hpp>
-#include <deque>
 #include <utility>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 
 #include "base/kaldi-common.h"
+#include "matrix/kaldi-vector.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpxmldata.h"
 
@@ -44,6 +45,20 @@ enum CEXSPEC_TYPE {CEXSPEC_TYPE_STR = 0,
                    CEXSPEC_TYPE_INT = 1};
 
 
+// How a compiled feature finds its value. Features without a compiled
+// equivalent call their function from the catalog
+enum CEXSPEC_OP {CEXSPEC_OP_FUNC = 0,
+                 CEXSPEC_OP_PHONE = 1,
+                 CEXSPEC_OP_PHONE_KALDI = 2,
+                 CEXSPEC_OP_SEG_FRONT = 3,
+                 CEXSPEC_OP_SEG_BACK = 4,
+                 CEXSPEC_OP_SYL_NOPHONS = 5,
+                 CEXSPEC_OP_SYL_STRESS = 6,
+                 CEXSPEC_OP_WORD_POS = 7,
+                 CEXSPEC_OP_WORD_NOSYL = 8,
+                 CEXSPEC_OP_SPT_NOWORDS = 9,
+                 CEXSPEC_OP_SPT_TONE = 10};
+
 // Default maximum size of a feature in bytes
 // (can be set in cex-<architecture>.xml)
 #define CEXSPEC_MAXFIELDLEN 5
@@ -63,9 +78,7 @@ class TxpCexspec;
 struct TxpCexspecFeat;
 class TxpCexspecModels;
 class TxpCexspecContext;
-
-// moving vector which keeps context for each context level
-typedef std::deque<pugi::xml_node> XmlNodeVector;
+struct TxpCexspecPhoneItem;
 
 // a feature function
 typedef bool (* cexfunction)
@@ -85,6 +98,8 @@ typedef std::map<std::string, StringSet> LookupMapSet;
 typedef std::pair<std::string, StringSet> LookupMapSetItem;
 /// vector feature structures in architecture
 typedef std::vector<TxpCexspecFeat> TxpCexspecFeatVector;
+/// lookup from a valid value to its feature code
+typedef std::unordered_map<std::string, int32> LookupCode;
 
 class TxpCexspec: public TxpXmlData {
  public:
@@ -103,7 +118,18 @@ class TxpCexspec: public TxpXmlData {
   // add pause structure to an XML document
   int32 AddPauseNodes(pugi::xml_document* doc);
   // call feature function and deal with pause behaviour
-  bool ExtractFeatures(const TxpCexspecContext &context, std::string* buf);
+  bool ExtractFeatures(const TxpCexspecContext &context,
+                       std::string* buf) const;
+  // as above but return the integer code of each feature, see
+  // TxpCexspecFeat::outputs for the meaning of the codes
+  bool ExtractFeatures(const TxpCexspecContext &context,
+                       std::vector<int32>* codes) const;
+  // number of features in the architecture
+  int32 NumFeatures() const {return cexspecfeats_.size();}
+  // return a feature specification
+  const TxpCexspecFeat &GetFeature(int32 idx) const {
+    return cexspecfeats_[idx];
+  }
   // check and append value - function string
   bool AppendValue(const TxpCexspecFeat &feat, bool error,
                    const char* s, std::string* buf) const;
@@ -123,6 +149,17 @@ class TxpCexspec: public TxpXmlData {
  private:
   // Parser for tpdb xml cex setup
   void StartElement(const char* name, const char** atts);
+  // Compiles each feature once its specification is complete
+  void EndElement(const char* name);
+  // fill in the code tables of a feature
+  void CompileFeature(TxpCexspecFeat* feat);
+  // integer code of a compiled feature
+  int32 FeatureCode(const TxpCexspecFeat &feat,
+                    const TxpCexspecContext &context) const;
+  // code of a string value, the error code if not in the set
+  int32 StringCode(const TxpCexspecFeat &feat, const char* s) const;
+  // code of an integer value after clipping to min/max
+  int32 IntCode(const TxpCexspecFeat &feat, int32 i) const;
   // return index of a feature function by name
   int32 GetFeatureIndex(const std::string &name);
   // stores valid values for string based features
@@ -170,6 +207,72 @@ struct TxpCexspecFeat {
   // mapping from specific feature extraction values
   // to architecture specific values
   LookupMap mapping;
+  // compiled replacement for func, CEXSPEC_OP_FUNC if none
+  enum CEXSPEC_OP op;
+  // context offset (phone, syllable etc.) read by op
+  int32 offset;
+  // code for each valid value if a string type function
+  LookupCode codes;
+  // lowest value if an integer type function, its code is 0
+  int32 code_min;
+  // text appended to the model name for each code: the set items in set
+  // order or the values from min to max, followed by the null and error
+  // values. Each includes the delimiter and mapping.
+  std::vector<std::string> outputs;
+  // code of the null value
+  int32 null_code;
+  // code of the error value
+  int32 error_code;
+};
+
+// per phone values read by compiled features
+struct TxpCexspecPhoneItem {
+  // phone name
+  const char* val;
+  // phone name in kaldi style, see CexFuncStringPhoneKaldi
+  std::string kaldi;
+  // true if the phone is a pause
+  bool pau;
+  // position of the phone in its syllable, starting from 1
+  int32 phonid;
+};
+
+// converts feature codes into DNN input features using the values each
+// feature took in training (the keys of the cex frequency table). This is
+// the encoding of gen/cex.py: string features become a one of many vector
+// over their sorted values, with '0' encoded as all zeros, and integer
+// features are their value.
+class TxpCexspecDnnEncoding {
+ public:
+  explicit TxpCexspecDnnEncoding() : phone_dim_(0), dim_(0) {}
+  ~TxpCexspecDnnEncoding() {}
+  // values[0] holds the phone names and values[i] the values of feature
+  // i - 1 of the architecture
+  bool Init(const TxpCexspec &cexspec,
+            const std::vector<std::vector<std::string> > &values);
+  // number of DNN input features
+  int32 Dim() const {return dim_;}
+  // write the features for a phone and its feature codes into row
+  void Encode(const char* phone, const std::vector<int32> &codes,
+              VectorBase<BaseFloat>* row) const;
+
+ private:
+  // a value that is not in the training values, warned about when used
+  static const int32 kUnknown = -2;
+  // a value encoded as all zeros
+  static const int32 kZero = -1;
+  // column of each phone name within the phone features
+  LookupCode phone_cols_;
+  int32 phone_dim_;
+  // first column of each feature
+  std::vector<int32> offsets_;
+  // for each feature and code the column within the feature (string
+  // features) or the value (integer features)
+  std::vector<std::vector<int32> > values_;
+  std::vector<bool> is_int_;
+  // feature value of each code, for warnings
+  std::vector<std::vector<std::string> > names_;
+  int32 dim_;
 };
 
 // container for a feature output full context HMM modelnames
@@ -194,7 +297,11 @@ class TxpCexspecModels {
   int32 buflen_;
 };
 
-// iterator for accessing linguistic structure in the XML document
+// iterator for accessing linguistic structure in the XML document. The
+// document is flattened once into arrays of phones, syllables, words, spurts
+// and utterances in document order, with the index of the parent of each
+// phone, so moving through the document and looking at neighbours does not
+// touch the XML tree.
 class TxpCexspecContext {
  public:
   explicit TxpCexspecContext(const pugi::xml_document &doc,
@@ -210,6 +317,8 @@ class TxpCexspecContext {
   bool isEndBreak() {return endbreak_;}
   // is the break between sentences
   bool isUttBreak() {return uttbreak_;}
+  // number of phones in the document
+  int32 NumPhones() const {return phones_.size();}
   // return phon back or forwards from current phone
   pugi::xml_node GetPhone(const int32 idx, const bool pause_context) const;
   // return parent syllable back or forwards from current phone
@@ -221,33 +330,76 @@ class TxpCexspecContext {
   // look up from the node until we find the correct current context node
   pugi::xml_node GetContextUp(const pugi::xml_node &node,
                               const char* name) const;
-  
+  // as GetPhone but return the index of the phone, -1 if empty
+  int32 GetPhoneIndex(const int32 idx, const bool pause_context) const;
+  // as GetSyllable, GetWord and GetSpurt but return the index, -1 if empty
+  int32 GetSyllableIndex(const int32 idx) const {
+    return ContextIndex(syllable_idx_ + idx, syllables_.size());
+  }
+  int32 GetWordIndex(const int32 idx) const {
+    return ContextIndex(word_idx_ + idx, words_.size());
+  }
+  int32 GetSpurtIndex(const int32 idx) const {
+    return ContextIndex(spurt_idx_ + idx, spurts_.size());
+  }
+  int32 GetUtteranceIndex(const int32 idx) const {
+    return ContextIndex(utterance_idx_ + idx, utterances_.size());
+  }
+  // phone in document order
+  pugi::xml_node GetPhoneNode(int32 i) const {return phones_[i];}
+  // values extracted from the document once for the compiled features
+  const TxpCexspecPhoneItem &GetPhoneItem(int32 i) const {
+    return phone_items_[i];
+  }
+  int32 GetSyllableNumPhones(int32 i) const {return syl_nophons_[i];}
+  int32 GetSyllableStress(int32 i) const {return syl_stress_[i];}
+  const char* GetWordPosTag(int32 i) const {return word_pos_[i];}
+  int32 GetWordNumSyls(int32 i) const {return word_nosyl_[i];}
+  int32 GetSpurtNumWords(int32 i) const {return spurt_nowords_[i];}
+  // tone name of the last break in the spurt, NULL if none
+  const char* GetSpurtTobiEndTone(int32 i) const {return spurt_tone_[i];}
+
  private:
+  static int32 ContextIndex(int32 i, size_t size) {
+    return (i >= 0 && i < static_cast<int32>(size)) ? i : -1;
+  }
+  // add the node and its descendants to the arrays, the indices are those
+  // of the closest enclosing syllable, word, spurt and utterance
+  void Flatten(const pugi::xml_node &node, int32 syl, int32 wrd, int32 spt,
+               int32 utt);
+  // set the parent indices from the current phone
+  void SetParents();
   bool isbreak_;
   bool endbreak_;
   bool internalbreak_;
   bool uttbreak_;
   enum CEXSPECPAU_HANDLER pauhand_;
-  pugi::xpath_node_set phones_;
-  pugi::xpath_node_set syllables_;
-  pugi::xpath_node_set words_;
-  pugi::xpath_node_set spurts_;
-  pugi::xpath_node_set utterances_;
-  pugi::xpath_node_set::const_iterator current_phone_;
-  pugi::xpath_node_set::const_iterator current_syllable_;
-  pugi::xpath_node_set::const_iterator current_word_;
-  pugi::xpath_node_set::const_iterator current_spurt_;
-  pugi::xpath_node_set::const_iterator current_utterance_;
-  // phone contexts
-  XmlNodeVector phone_contexts_;
-  // syl contexts
-  XmlNodeVector syllable_contexts_;
-  // wrd contexts
-  XmlNodeVector word_contexts_;
-  // spt contexts
-  XmlNodeVector spurt_contexts_;
-  // utt contexts
-  XmlNodeVector utterance_contexts_;
+  // items in document order
+  std::vector<pugi::xml_node> phones_;
+  std::vector<pugi::xml_node> syllables_;
+  std::vector<pugi::xml_node> words_;
+  std::vector<pugi::xml_node> spurts_;
+  std::vector<pugi::xml_node> utterances_;
+  // index of the syllable, word, spurt and utterance of each phone, -1 if
+  // the phone is not in one
+  std::vector<int32> phone_syllables_;
+  std::vector<int32> phone_words_;
+  std::vector<int32> phone_spurts_;
+  std::vector<int32> phone_utterances_;
+  // index of the current phone, syllable, word, spurt and utterance
+  int32 phone_idx_;
+  int32 syllable_idx_;
+  int32 word_idx_;
+  int32 spurt_idx_;
+  int32 utterance_idx_;
+  // values for the compiled features
+  std::vector<TxpCexspecPhoneItem> phone_items_;
+  std::vector<int32> syl_nophons_;
+  std::vector<int32> syl_stress_;
+  std::vector<const char*> word_pos_;
+  std::vector<int32> word_nosyl_;
+  std::vector<int32> spurt_nowords_;
+  std::vector<const char*> spurt_tone_;
 };
 
 }  // namespace kaldi
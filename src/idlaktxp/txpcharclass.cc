@@ -0,0 +1,127 @@
+// idlaktxp/txpcharclass.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cctype>
+#include <cstring>
+#include "idlaktxp/txpcharclass.h"
+
+namespace kaldi {
+
+TxpCharClass::TxpCharClass()
+    : valid_(false), grouped_(false), negated_(false), end_anchored_(false),
+      quantifier_(0) {
+  memset(ascii_, 0, sizeof(ascii_));
+}
+
+bool TxpCharClass::Parse(const std::string &rgx) {
+  const char* p = rgx.c_str();
+  uint32 lo, hi;
+  bool first = true;
+  valid_ = grouped_ = negated_ = end_anchored_ = false;
+  quantifier_ = 0;
+  memset(ascii_, 0, sizeof(ascii_));
+  wide_.clear();
+  if (*p++ != '^') return false;
+  if (*p == '(') {
+    grouped_ = true;
+    p++;
+  }
+  if (*p++ != '[') return false;
+  if (*p == '^') {
+    negated_ = true;
+    p++;
+  }
+  // a ] straight after the opening bracket is a literal
+  while (first || *p != ']') {
+    if (!*p || !ParseItem(&p, &lo)) return false;
+    first = false;
+    hi = lo;
+    if (p[0] == '-' && p[1] && p[1] != ']') {
+      p++;
+      if (!ParseItem(&p, &hi) || hi < lo) return false;
+    }
+    for (uint32 cp = lo; cp <= hi && cp < 128; cp++) ascii_[cp] = true;
+    if (hi >= 128) wide_.push_back(std::make_pair(std::max(lo, 128u), hi));
+  }
+  p++;
+  if (*p == '+' || *p == '*') quantifier_ = *p++;
+  if (grouped_ && *p++ != ')') return false;
+  if (*p == '$') {
+    end_anchored_ = true;
+    p++;
+  }
+  if (*p) return false;
+  valid_ = true;
+  return true;
+}
+
+bool TxpCharClass::ParseItem(const char** p, uint32* cp) {
+  TxpUtf8 utf8;
+  const char* s = *p;
+  if (*s == '\\') {
+    s++;
+    switch (*s) {
+      case 'n': *cp = '\n'; break;
+      case 't': *cp = '\t'; break;
+      case 'r': *cp = '\r'; break;
+      case 'f': *cp = '\f'; break;
+      default:
+        // other letter and digit escapes are classes, octal or hex
+        if (!*s || isalnum(static_cast<unsigned char>(*s))) return false;
+        *cp = utf8.Codepoint(s);
+        *p = s + utf8.Clen(s);
+        return true;
+    }
+    *p = s + 1;
+    return true;
+  }
+  // posix classes, collating elements and equivalence classes
+  if (s[0] == '[' && (s[1] == ':' || s[1] == '.' || s[1] == '=')) return false;
+  *cp = utf8.Codepoint(s);
+  *p = s + utf8.Clen(s);
+  return true;
+}
+
+bool TxpCharClass::ContainsWide(uint32 cp) const {
+  for (size_t i = 0; i < wide_.size(); i++)
+    if (cp >= wide_[i].first && cp <= wide_[i].second) return true;
+  return false;
+}
+
+int32 TxpCharClass::Match(const char* input, int32 len) const {
+  TxpUtf8 utf8;
+  const char *p = input, *end = (len < 0) ? NULL : input + len;
+  int32 clen, i, n = 0;
+  while (end ? p < end : *p) {
+    clen = utf8.Clen(p);
+    // a character cut short by the end of the input
+    for (i = 1; i < clen && p[i] && (!end || p + i < end); i++) {}
+    if (i < clen || !Contains(utf8.Codepoint(p))) break;
+    p += clen;
+    n++;
+    if (!quantifier_) break;
+  }
+  if (!n && quantifier_ != '*') return -1;
+  // $ also matches before a final newline
+  if (end_anchored_ && (end ? p < end : *p) &&
+      !(*p == '\n' && (end ? p + 1 == end : !p[1])))
+    return -1;
+  return p - input;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,79 @@
+// idlaktxp/txpcharclass.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPCHARCLASS_H_
+#define KALDI_IDLAKTXP_TXPCHARCLASS_H_
+
+// This file defines a character class table built from the simple regular
+// expressions used for tokenisation so they can be matched without pcre
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "idlaktxp/txputf8.h"
+
+namespace kaldi {
+
+/// A regular expression which is a single bracketed character class run,
+/// e.g. ^([ \n\t\r]+) or ^[a-zA-Z_']+$ as found in the trules data.
+///
+/// Parse accepts ^, an optional capture group around a class with an
+/// optional + or * and an optional $. Escapes other than \n \t \r \f \v and
+/// escaped punctuation are not accepted, and neither is anything else, so a
+/// pattern which parses matches exactly as pcre in utf8 mode would.
+class TxpCharClass {
+ public:
+  TxpCharClass();
+  ~TxpCharClass() {}
+  /// Build the class from a pattern, false (and not valid) if the pattern
+  /// is not a form Parse accepts
+  bool Parse(const std::string &rgx);
+  /// True if the last Parse succeeded
+  bool Valid() const {return valid_;}
+  /// True if the class is wrapped in a capture group, i.e. match 0 of the
+  /// pcre pattern is the whole match
+  bool Grouped() const {return grouped_;}
+  /// True if the unicode code point is in the class
+  bool Contains(uint32 cp) const {
+    if (cp < 128) return ascii_[cp] != negated_;
+    return ContainsWide(cp) != negated_;
+  }
+  /// Match at the start of input, which ends at len bytes or at a null if
+  /// len is negative. Returns the match length in bytes or -1 if the
+  /// pattern does not match
+  int32 Match(const char* input, int32 len = -1) const;
+
+ private:
+  bool ContainsWide(uint32 cp) const;
+  // read one class item at p, advancing p, false if it is not accepted
+  bool ParseItem(const char** p, uint32* cp);
+  bool valid_;
+  bool grouped_;
+  bool negated_;
+  bool end_anchored_;
+  // '+', '*' or 0 for exactly one character
+  char quantifier_;
+  bool ascii_[128];
+  // inclusive code point ranges above ascii
+  std::vector<std::pair<uint32, uint32> > wide_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPCHARCLASS_H_
@@ -0,0 +1,137 @@
+// idlaktxp/txplexicon-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks user lexicon entries over xml and binary lexicons
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "idlaktxp/txpparse-options.h"
+#include "idlaktxp/txplexicon.h"
+
+namespace kaldi {
+
+static const char *kLexiconXml =
+    "<lexicon>\n"
+    "<lex pron=\"r eh1 d\" entry=\"full\" default=\"true\">read</lex>\n"
+    "<lex pron=\"r iy1 d\" entry=\"past\">read</lex>\n"
+    "<lex pron=\"k ae1 t\" entry=\"full\" default=\"true\">cat</lex>\n"
+    "</lexicon>\n";
+
+static std::string Pron(TxpLexicon *lex, const std::string &word,
+                        const std::string &entry, int32 *num_alt = NULL) {
+  TxpLexiconLkp lkp;
+  if (!lex->GetPron(word, entry, &lkp)) return "-";
+  if (num_alt) *num_alt = lkp.altprons.size();
+  return lkp.pron;
+}
+
+static void TestUserEntries(TxpLexicon *lex) {
+  std::vector<std::string> changed;
+  int32 num_alt;
+  KALDI_ASSERT(lex->UserVersion() == 0);
+  KALDI_ASSERT(Pron(lex, "read", "", &num_alt) == "r eh1 d" && num_alt == 2);
+  KALDI_ASSERT(Pron(lex, "dog", "") == "-");
+  // a new word gets its first entry as default
+  KALDI_ASSERT(lex->AddUserEntry("dog", "full", "d ao1 g", false));
+  KALDI_ASSERT(Pron(lex, "dog", "") == "d ao1 g");
+  KALDI_ASSERT(Pron(lex, "dog", "full") == "d ao1 g");
+  // a word of the lexicon keeps its other entries
+  KALDI_ASSERT(lex->AddUserEntry("read", "past", "r eh1 d", true));
+  KALDI_ASSERT(Pron(lex, "read", "past") == "r eh1 d");
+  KALDI_ASSERT(Pron(lex, "read", "full") == "r eh1 d");
+  KALDI_ASSERT(lex->AddUserEntry("read", "full", "r iy1 d", false));
+  KALDI_ASSERT(Pron(lex, "read", "full") == "r iy1 d");
+  KALDI_ASSERT(Pron(lex, "read", "") == "r eh1 d");
+  KALDI_ASSERT(lex->UserVersion() == 3);
+  KALDI_ASSERT(lex->UserChangesSince(1, &changed));
+  KALDI_ASSERT(changed.size() == 2 && changed[0] == "read");
+  // removing the default entry makes another one the default
+  KALDI_ASSERT(lex->RemoveUserEntry("read", "past"));
+  KALDI_ASSERT(Pron(lex, "read", "past") == "-");
+  KALDI_ASSERT(Pron(lex, "read", "") == "r iy1 d");
+  KALDI_ASSERT(!lex->RemoveUserEntry("read", "past"));
+  KALDI_ASSERT(lex->RemoveUserEntry("cat", ""));
+  KALDI_ASSERT(Pron(lex, "cat", "") == "-");
+  KALDI_ASSERT(!lex->AddUserEntry("a:b", "full", "ey1", false));
+  KALDI_ASSERT(!lex->AddUserEntry("a", "", "ey1", false));
+  // clearing brings back the lexicon
+  uint64 version = lex->UserVersion();
+  lex->ClearUserEntries();
+  KALDI_ASSERT(lex->UserVersion() == version + 1);
+  changed.clear();
+  KALDI_ASSERT(lex->UserChangesSince(version, &changed));
+  KALDI_ASSERT(changed.size() == 3);
+  KALDI_ASSERT(Pron(lex, "cat", "") == "k ae1 t");
+  KALDI_ASSERT(Pron(lex, "read", "past") == "r iy1 d");
+  KALDI_ASSERT(Pron(lex, "dog", "") == "-");
+}
+
+static void UnitTestTxpLexiconUser() {
+  const char *usage = "";
+  // a tpdb for the default language, en
+  std::string dir = "txplexicon-test.tpdb", lang = dir + "/en";
+  std::string xml = lang + "/lexicon-default.xml",
+      bin = lang + "/lexicon-default.bin";
+  KALDI_ASSERT(system(("mkdir -p " + lang).c_str()) == 0);
+  { std::ofstream os(xml.c_str()); os << kLexiconXml; }
+  TxpParseOptions po(usage);
+  po.SetTpdb(dir);
+  {
+    TxpLexicon lex;
+    lex.Init(po, "default");
+    KALDI_ASSERT(lex.ParseXml(dir));
+    TestUserEntries(&lex);
+    std::ofstream os(bin.c_str(), std::ios::binary);
+    KALDI_ASSERT(lex.WriteBinary(os));
+  }
+  {
+    TxpLexicon lex;
+    lex.Init(po, "default");
+    KALDI_ASSERT(lex.Parse(dir) && lex.IsBinary());
+    TestUserEntries(&lex);
+  }
+  // the image is not used once the xml has been edited
+  {
+    std::string edited(kLexiconXml);
+    edited.replace(edited.find("k ae1 t"), 7, "k ae1 t s");
+    std::ofstream os(xml.c_str());
+    os << edited;
+  }
+  {
+    TxpLexicon lex;
+    lex.Init(po, "default");
+    KALDI_ASSERT(lex.Parse(dir) && !lex.IsBinary());
+    KALDI_ASSERT(Pron(&lex, "cat", "") == "k ae1 t s");
+  }
+  std::remove(bin.c_str());
+  std::remove(xml.c_str());
+  std::remove(lang.c_str());
+  std::remove(dir.c_str());
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestTxpLexiconUser();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -17,9 +17,325 @@
 //
 
 #include "idlaktxp/txplexicon.h"
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace kaldi {
 
+// Binary image layout, native byte order:
+//   TxpLexiconBinHeader
+//   TxpLexiconBinWord[num_words]
+//   TxpLexiconBinRecord[num_records]
+//   string pool of pool_size bytes, each string null terminated
+static const char kLexBinMagic[8] = {'I', 'D', 'L', 'K', 'L', 'E', 'X', '2'};
+static const uint32 kLexBinByteOrder = 0x01020304;
+
+struct TxpLexiconBinHeader {
+  char magic[8];
+  uint32 byte_order;
+  uint32 num_words;
+  uint32 num_records;
+  uint32 pool_size;
+  // size and modification time of the xml the image was compiled from
+  uint64 xml_size;
+  int64 xml_mtime;
+};
+
+struct TxpLexiconBinWord {
+  uint32 word, word_len;
+  uint32 first_record, num_records;
+};
+
+struct TxpLexiconBinRecord {
+  uint32 entry, entry_len;
+  uint32 pron, pron_len;
+};
+
+// User entries: the <word>:<entry> lookups of each word with user entries,
+// empty if the word was removed, and the words changed by each version from
+// first_version on
+struct TxpLexiconUser {
+  TxpLexiconUser() : first_version(1) {}
+  std::map<std::string, LookupLex> words;
+  std::deque<std::pair<uint64, std::string> > changes;
+  uint64 first_version;
+};
+
+// Number of changed words remembered for UserChangesSince
+static const size_t kLexMaxUserChanges = 4096;
+
+TxpLexicon::TxpLexicon() : image_(NULL), image_size_(0), image_mapped_(false),
+                           words_(NULL), num_words_(0), records_(NULL),
+                           num_records_(0), pool_(NULL), xml_size_(0),
+                           xml_mtime_(0), user_version_(0), inlex_(false) {}
+
+TxpLexicon::~TxpLexicon() {
+  UnloadBinary();
+}
+
+bool TxpLexicon::Parse(const std::string &tpdb) {
+  std::string pathname;
+  if (FindFile(tpdb, type_ + "-" + name_ + ".bin", &pathname)) {
+    if (LoadBinary(pathname)) {
+      uint64 xml_size;
+      int64 xml_mtime;
+      // without the xml the image is all there is
+      if (!StatXml(tpdb, &xml_size, &xml_mtime) ||
+          (xml_size == xml_size_ && xml_mtime == xml_mtime_)) {
+        KALDI_VLOG(1) << "Loaded binary lexicon: " << pathname;
+        return true;
+      }
+      KALDI_WARN << "Binary lexicon was not compiled from the current xml "
+                 << "(run idlaklexcompile again), using xml: " << pathname;
+    } else {
+      KALDI_WARN << "Invalid binary lexicon, using xml: " << pathname;
+    }
+  }
+  return ParseXml(tpdb);
+}
+
+bool TxpLexicon::ParseXml(const std::string &tpdb) {
+  UnloadBinary();
+  bool r = TxpXmlData::Parse(tpdb);
+  BuildIndex();
+  if (!StatXml(tpdb, &xml_size_, &xml_mtime_))
+    xml_size_ = xml_mtime_ = 0;
+  return r;
+}
+
+bool TxpLexicon::StatXml(const std::string &tpdb, uint64 *size,
+                         int64 *mtime) {
+  std::string pathname;
+  if (!FindFile(tpdb, type_ + "-" + name_ + ".xml", &pathname)) return false;
+#ifndef _MSC_VER
+  struct stat st;
+  if (stat(pathname.c_str(), &st) != 0) return false;
+  *size = st.st_size;
+  *mtime = st.st_mtime;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void TxpLexicon::BuildIndex() {
+  index_entries_.clear();
+  index_words_.clear();
+  index_.Clear();
+  std::string word;
+  for (LookupLex::const_iterator it = lookup_.begin(); it != lookup_.end();
+       ++it) {
+    std::size_t pos = it->first.find(":");
+    if (index_words_.empty() || it->first.compare(0, pos, word)) {
+      word = it->first.substr(0, pos);
+      index_.Insert(word, index_words_.size());
+      index_words_.push_back(std::make_pair(
+          static_cast<int32>(index_entries_.size()), 0));
+    }
+    index_entries_.push_back(it);
+    index_words_.back().second++;
+  }
+}
+
+// Adds a string to the pool, strings are stored once however often they
+// are used
+static uint32 LexBinPoolString(const std::string &str, std::string *pool,
+                               LookupInt *pooled) {
+  LookupInt::iterator it = pooled->find(str);
+  if (it != pooled->end()) return it->second;
+  uint32 off = pool->size();
+  pool->append(str);
+  pool->push_back('\0');
+  pooled->insert(LookupIntItem(str, off));
+  return off;
+}
+
+bool TxpLexicon::WriteBinary(std::ostream &os) const {
+  if (IsBinary()) {
+    KALDI_WARN << "Lexicon must be loaded from xml to write a binary image";
+    return false;
+  }
+  std::vector<TxpLexiconBinWord> words;
+  std::vector<TxpLexiconBinRecord> records;
+  std::string pool;
+  LookupInt pooled;
+  for (LookupLex::const_iterator it = lookup_.begin(); it != lookup_.end();
+       ++it) {
+    std::size_t pos = it->first.find(":");
+    std::string word = it->first.substr(0, pos),
+        entry = it->first.substr(pos + 1);
+    if (words.empty() ||
+        word != std::string(pool.c_str() + words.back().word)) {
+      TxpLexiconBinWord w;
+      w.word = LexBinPoolString(word, &pool, &pooled);
+      w.word_len = word.size();
+      w.first_record = records.size();
+      w.num_records = 0;
+      words.push_back(w);
+    }
+    TxpLexiconBinRecord rec;
+    rec.entry = LexBinPoolString(entry, &pool, &pooled);
+    rec.entry_len = entry.size();
+    rec.pron = LexBinPoolString(it->second, &pool, &pooled);
+    rec.pron_len = it->second.size();
+    records.push_back(rec);
+    words.back().num_records++;
+  }
+  TxpLexiconBinHeader header;
+  memcpy(header.magic, kLexBinMagic, sizeof(kLexBinMagic));
+  header.byte_order = kLexBinByteOrder;
+  header.num_words = words.size();
+  header.num_records = records.size();
+  header.pool_size = pool.size();
+  header.xml_size = xml_size_;
+  header.xml_mtime = xml_mtime_;
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!words.empty())
+    os.write(reinterpret_cast<const char*>(&words[0]),
+             words.size() * sizeof(TxpLexiconBinWord));
+  if (!records.empty())
+    os.write(reinterpret_cast<const char*>(&records[0]),
+             records.size() * sizeof(TxpLexiconBinRecord));
+  os.write(pool.data(), pool.size());
+  return os.good();
+}
+
+bool TxpLexicon::LoadBinary(const std::string &pathname) {
+  UnloadBinary();
+#ifndef _MSC_VER
+  int fd = open(pathname.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      image_ = static_cast<const char*>(addr);
+      image_size_ = st.st_size;
+      image_mapped_ = true;
+    }
+  }
+  close(fd);
+#endif
+  if (!image_) {
+    std::ifstream is(pathname.c_str(), std::ios::binary);
+    std::ostringstream buf;
+    buf << is.rdbuf();
+    if (!is) return false;
+    image_buffer_ = buf.str();
+    image_ = image_buffer_.data();
+    image_size_ = image_buffer_.size();
+  }
+  // check the image is complete before using it
+  const TxpLexiconBinHeader *header =
+      reinterpret_cast<const TxpLexiconBinHeader*>(image_);
+  bool valid = image_size_ >= sizeof(TxpLexiconBinHeader) &&
+      !memcmp(header->magic, kLexBinMagic, sizeof(kLexBinMagic)) &&
+      header->byte_order == kLexBinByteOrder;
+  size_t size = sizeof(TxpLexiconBinHeader);
+  if (valid) {
+    size += static_cast<size_t>(header->num_words) * sizeof(TxpLexiconBinWord) +
+        static_cast<size_t>(header->num_records) * sizeof(TxpLexiconBinRecord);
+    valid = image_size_ == size + header->pool_size;
+  }
+  if (valid) {
+    words_ = reinterpret_cast<const TxpLexiconBinWord*>(
+        image_ + sizeof(TxpLexiconBinHeader));
+    records_ = reinterpret_cast<const TxpLexiconBinRecord*>(
+        words_ + header->num_words);
+    pool_ = image_ + size;
+    num_words_ = header->num_words;
+    num_records_ = header->num_records;
+    xml_size_ = header->xml_size;
+    xml_mtime_ = header->xml_mtime;
+    uint32 pool_size = header->pool_size;
+    for (int32 i = 0; valid && i < num_words_; i++)
+      valid = words_[i].word + words_[i].word_len < pool_size &&
+          words_[i].first_record + words_[i].num_records <=
+          static_cast<uint32>(num_records_);
+    for (int32 i = 0; valid && i < num_records_; i++)
+      valid = records_[i].entry + records_[i].entry_len < pool_size &&
+          records_[i].pron + records_[i].pron_len < pool_size;
+  }
+  if (!valid) UnloadBinary();
+  return valid;
+}
+
+void TxpLexicon::UnloadBinary() {
+#ifndef _MSC_VER
+  if (image_mapped_)
+    munmap(const_cast<char*>(image_), image_size_);
+#endif
+  image_ = NULL;
+  image_size_ = 0;
+  image_mapped_ = false;
+  image_buffer_.clear();
+  words_ = NULL;
+  records_ = NULL;
+  pool_ = NULL;
+  num_words_ = num_records_ = 0;
+}
+
+// Byte order comparison of a pooled string with a std::string
+static int32 LexBinCompare(const char *x, uint32 xlen, const std::string &y) {
+  int32 r = memcmp(x, y.data(), std::min<size_t>(xlen, y.size()));
+  if (r) return r;
+  if (xlen == y.size()) return 0;
+  return xlen < y.size() ? -1 : 1;
+}
+
+// Binary search of the sorted words of an image, returns -1 if not found
+static int32 LexBinFindWord(const TxpLexiconBinWord *words, int32 num_words,
+                            const char *pool, const std::string &word) {
+  int32 lo = 0, hi = num_words;
+  while (lo < hi) {
+    int32 mid = lo + (hi - lo) / 2;
+    if (LexBinCompare(pool + words[mid].word, words[mid].word_len, word) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == num_words ||
+      LexBinCompare(pool + words[lo].word, words[lo].word_len, word))
+    return -1;
+  return lo;
+}
+
+int TxpLexicon::GetPronBinary(const std::string &word,
+                              const std::string &entry,
+                              TxpLexiconLkp* lkp) const {
+  static const std::string kDefault("default");
+  int32 lo = LexBinFindWord(words_, num_words_, pool_, word);
+  if (lo < 0) return false;
+  const TxpLexiconBinRecord *begin = records_ + words_[lo].first_record,
+      *end = begin + words_[lo].num_records, *rec, *def = NULL;
+  const std::string &target = entry.empty() ? kDefault : entry;
+  for (rec = begin; rec != end; ++rec)
+    if (!LexBinCompare(pool_ + rec->entry, rec->entry_len, target)) break;
+  if (rec == end) return false;
+  lkp->pron.append(pool_ + rec->pron, rec->pron_len);
+  // other pronunciations are the entries after the default one
+  for (rec = begin; rec != end; ++rec) {
+    if (!LexBinCompare(pool_ + rec->entry, rec->entry_len, kDefault)) {
+      def = rec;
+      break;
+    }
+  }
+  if (def) {
+    for (rec = def + 1; rec != end; ++rec)
+      lkp->altprons.push_back(std::string(pool_ + rec->pron, rec->pron_len));
+  }
+  return true;
+}
+
 void TxpLexicon::StartElement(const char* name, const char** atts) {
   if (!strcmp(name, "lex")) {
     inlex_ = true;
@@ -64,28 +380,184 @@ void TxpLexicon:: EndElement(const char* name) {
 int TxpLexicon::GetPron(const std::string &word,
                         const std::string &entry,
                         TxpLexiconLkp* lkp) {
-  LookupMap::iterator it;
-  std::size_t pos;
-  if (!entry.empty())
-    it = lookup_.find(word + std::string(":") + entry);
-  else
-    it = lookup_.find(word + std::string(":default"));
-  if (it != lookup_.end()) {
-    lkp->pron += it->second;
-    // Extract other pronunciations
-    it = lookup_.find(word + std::string(":default"));
-    ++it;
-    pos = (it->first).find(":");
-    while ((it->first).substr(0, pos) == word) {
+  static const std::string kDefault("default");
+  if (user_version_.load()) {
+    std::shared_ptr<const TxpLexiconUser> user = std::atomic_load(&user_);
+    std::map<std::string, LookupLex>::const_iterator it =
+        user->words.find(word);
+    if (it != user->words.end())
+      return GetPronUser(it->second, word, entry, lkp);
+  }
+  if (image_) return GetPronBinary(word, entry, lkp);
+  int32 w = index_.Find(word);
+  if (w == TxpTrie::kNoValue) return false;
+  // lookup keys are <word>:<entry>, compare the part after the word
+  std::size_t pos = word.size() + 1;
+  int32 begin = index_words_[w].first, end = begin + index_words_[w].second;
+  const std::string &target = entry.empty() ? kDefault : entry;
+  int32 i, def;
+  for (i = begin; i < end; i++)
+    if (!index_entries_[i]->first.compare(pos, std::string::npos, target))
+      break;
+  if (i == end) return false;
+  lkp->pron += index_entries_[i]->second;
+  // other pronunciations are the entries after the default one
+  for (def = begin; def < end; def++)
+    if (!index_entries_[def]->first.compare(pos, std::string::npos,
+                                            kDefault))
+      break;
+  for (i = def + 1; i < end; i++)
+    lkp->altprons.push_back(index_entries_[i]->second);
+  return true;
+}
+
+int TxpLexicon::GetPronUser(const LookupLex &entries,
+                            const std::string &word,
+                            const std::string &entry,
+                            TxpLexiconLkp* lkp) const {
+  static const std::string kDefault("default");
+  std::size_t pos = word.size() + 1;
+  const std::string &target = entry.empty() ? kDefault : entry;
+  LookupLex::const_iterator it, def;
+  for (it = entries.begin(); it != entries.end(); ++it)
+    if (!it->first.compare(pos, std::string::npos, target)) break;
+  if (it == entries.end()) return false;
+  lkp->pron += it->second;
+  // other pronunciations are the entries after the default one
+  for (def = entries.begin(); def != entries.end(); ++def)
+    if (!def->first.compare(pos, std::string::npos, kDefault)) break;
+  if (def != entries.end()) {
+    for (it = ++def; it != entries.end(); ++it)
       lkp->altprons.push_back(it->second);
-      ++it;
-      if (it == lookup_.end()) break;
-      pos = (it->first).find(":");
-    }
-    return true;
+  }
+  return true;
+}
+
+void TxpLexicon::GetEntries(const std::string &word,
+                            LookupLex *entries) const {
+  if (image_) {
+    int32 w = LexBinFindWord(words_, num_words_, pool_, word);
+    if (w < 0) return;
+    const TxpLexiconBinRecord *rec = records_ + words_[w].first_record,
+        *end = rec + words_[w].num_records;
+    for (; rec != end; ++rec)
+      entries->insert(LookupItem(
+          word + ":" + std::string(pool_ + rec->entry, rec->entry_len),
+          std::string(pool_ + rec->pron, rec->pron_len)));
   } else {
+    int32 w = index_.Find(word);
+    if (w == TxpTrie::kNoValue) return;
+    int32 begin = index_words_[w].first, end = begin + index_words_[w].second;
+    for (int32 i = begin; i < end; i++)
+      entries->insert(*index_entries_[i]);
+  }
+}
+
+// Make sure a word that still has entries has a default one
+static void LexUserCheckDefault(const std::string &word, LookupLex *entries) {
+  std::string defkey = word + ":default";
+  if (!entries->empty() && entries->find(defkey) == entries->end())
+    entries->insert(LookupItem(defkey, entries->begin()->second));
+}
+
+bool TxpLexicon::AddUserEntry(const std::string &word,
+                              const std::string &entry,
+                              const std::string &pron, bool isdefault) {
+  if (word.empty() || word.find(":") != std::string::npos || entry.empty()) {
+    KALDI_WARN << "Invalid user lexicon entry '" << entry << "' for word: "
+               << word;
     return false;
   }
+  std::lock_guard<std::mutex> lock(user_mutex_);
+  std::shared_ptr<TxpLexiconUser> user(
+      user_ ? new TxpLexiconUser(*user_) : new TxpLexiconUser);
+  std::map<std::string, LookupLex>::iterator it = user->words.find(word);
+  if (it == user->words.end()) {
+    it = user->words.insert(std::make_pair(word, LookupLex())).first;
+    GetEntries(word, &it->second);
+  }
+  LookupLex &entries = it->second;
+  std::string key = word + ":" + entry, defkey = word + ":default";
+  entries.erase(key);
+  entries.insert(LookupItem(key, pron));
+  if (isdefault) {
+    entries.erase(defkey);
+    entries.insert(LookupItem(defkey, pron));
+  }
+  LexUserCheckDefault(word, &entries);
+  SetUser(user, std::vector<std::string>(1, word));
+  return true;
+}
+
+bool TxpLexicon::RemoveUserEntry(const std::string &word,
+                                 const std::string &entry) {
+  if (word.find(":") != std::string::npos) return false;
+  std::lock_guard<std::mutex> lock(user_mutex_);
+  std::shared_ptr<TxpLexiconUser> user(
+      user_ ? new TxpLexiconUser(*user_) : new TxpLexiconUser);
+  std::map<std::string, LookupLex>::iterator it = user->words.find(word);
+  if (it == user->words.end()) {
+    it = user->words.insert(std::make_pair(word, LookupLex())).first;
+    GetEntries(word, &it->second);
+  }
+  LookupLex &entries = it->second;
+  if (entry.empty()) {
+    if (entries.empty()) return false;
+    entries.clear();
+  } else {
+    std::string key = word + ":" + entry, defkey = word + ":default";
+    LookupLex::iterator e = entries.find(key);
+    if (e == entries.end()) return false;
+    std::string pron = e->second;
+    entries.erase(key);
+    // the default goes with the entry it was copied from
+    LookupLex::iterator d = entries.find(defkey);
+    if (d != entries.end() && d->second == pron) entries.erase(d);
+    LexUserCheckDefault(word, &entries);
+  }
+  SetUser(user, std::vector<std::string>(1, word));
+  return true;
+}
+
+void TxpLexicon::ClearUserEntries() {
+  std::lock_guard<std::mutex> lock(user_mutex_);
+  if (!user_ || user_->words.empty()) return;
+  std::shared_ptr<TxpLexiconUser> user(new TxpLexiconUser);
+  std::vector<std::string> changed;
+  for (std::map<std::string, LookupLex>::const_iterator it =
+           user_->words.begin(); it != user_->words.end(); ++it)
+    changed.push_back(it->first);
+  user->changes = user_->changes;
+  user->first_version = user_->first_version;
+  SetUser(user, changed);
+}
+
+void TxpLexicon::SetUser(std::shared_ptr<TxpLexiconUser> user,
+                         const std::vector<std::string> &changed) {
+  uint64 version = user_version_.load() + 1;
+  for (size_t i = 0; i < changed.size(); i++)
+    user->changes.push_back(std::make_pair(version, changed[i]));
+  // forget old versions as a whole
+  while (user->changes.size() > kLexMaxUserChanges) {
+    user->first_version = user->changes.front().first + 1;
+    while (!user->changes.empty() &&
+           user->changes.front().first < user->first_version)
+      user->changes.pop_front();
+  }
+  std::atomic_store(&user_, std::shared_ptr<const TxpLexiconUser>(user));
+  // after the entries, so that a reader of the version finds its changes
+  user_version_.store(version);
+}
+
+bool TxpLexicon::UserChangesSince(uint64 since,
+                                  std::vector<std::string> *words) const {
+  std::shared_ptr<const TxpLexiconUser> user = std::atomic_load(&user_);
+  if (!user) return true;
+  if (since + 1 < user->first_version) return false;
+  for (std::deque<std::pair<uint64, std::string> >::const_iterator it =
+           user->changes.begin(); it != user->changes.end(); ++it)
+    if (it->first > since) words->push_back(it->second);
+  return true;
 }
 
 }  // namespace kaldi
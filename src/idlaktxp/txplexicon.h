@@ -21,16 +21,26 @@
 
 // This file defines the lexicon class to hold pronunciation dictionaries
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
+#include "idlaktxp/txptrie.h"
 #include "idlaktxp/txpxmldata.h"
 
 namespace kaldi {
 
 struct TxpLexiconEntry;
 struct TxpLexiconLkp;
+struct TxpLexiconBinWord;
+struct TxpLexiconBinRecord;
+struct TxpLexiconUser;
 
 /// Custom comparison function to order lex items by default followed by
 /// other entries.
@@ -65,24 +75,116 @@ typedef std::multimap<std::string, std::string, TxpLexCompare> LookupLex;
 
 /// Hold pronunciations for words by entry.
 /// There must be at least one default pronunciation for every word
+///
+/// The lexicon can also be loaded from a binary image written by
+/// idlaklexcompile (lexicon-<name>.bin next to the xml). The image holds the
+/// entries in the same order as the lookup map, sorted by word, with all
+/// strings in one pool, and is memory mapped so that loading does no
+/// parsing and lookups do not allocate. The image records the size and
+/// modification time of the xml it was compiled from, and the xml is parsed
+/// instead if it has changed since. A lexicon parsed from xml indexes its
+/// words with a trie, so lookups walk the word once instead of comparing
+/// <word>:<entry> strings.
+///
+/// User entries can be added and removed while the lexicon is in use, e.g.
+/// to fix the pronunciation of a name without reloading the voice. They are
+/// held in a layer over the parsed or binary lexicon: a word with user
+/// entries is looked up there only, and the first change to a word copies
+/// its lexicon entries into the layer. Changes copy the layer and swap it
+/// in, so lookups running on other threads see it as it was either before
+/// or after a change. Each change increments UserVersion(), and
+/// UserChangesSince() tells holders of cached pronunciations which words to
+/// forget.
 class TxpLexicon: public TxpXmlData {
  public:
-  explicit TxpLexicon() : inlex_(false) {}
-  ~TxpLexicon() {}
+  explicit TxpLexicon();
+  ~TxpLexicon();
   void Init(const TxpParseOptions &opts, const std::string &name) {
     TxpXmlData::Init(opts, "lexicon", name);
   }
+  /// Load the binary image if there is one and the xml has not changed since
+  /// it was compiled, otherwise parse the xml
+  bool Parse(const std::string &tpdb);
+  /// Parse the xml lexicon ignoring any binary image
+  bool ParseXml(const std::string &tpdb);
+  /// Write the lexicon as a binary image, it must have been loaded from xml
+  bool WriteBinary(std::ostream &os) const;
+  /// True if the lexicon is a memory mapped binary image
+  bool IsBinary() const { return image_ != NULL; }
   /// Fill the lexicon lookup structure with the correct pronunciation
   int GetPron(const std::string &word,
               const std::string &entry,
               TxpLexiconLkp* lkp);
+  /// Add a user pronunciation for entry of word, replacing any the word has
+  /// for the entry. It becomes the default if isdefault is true or the word
+  /// has no default. Returns false if the word or entry is invalid
+  bool AddUserEntry(const std::string &word, const std::string &entry,
+                    const std::string &pron, bool isdefault);
+  /// Remove entry of word, or the whole word if entry is empty so that it
+  /// is no longer found. Returns false if there is no such entry
+  bool RemoveUserEntry(const std::string &word, const std::string &entry);
+  /// Remove all user entries, back to the lexicon as loaded
+  void ClearUserEntries();
+  /// Number of changes made to the user entries
+  uint64 UserVersion() const { return user_version_.load(); }
+  /// Append the words changed after version since. Returns false if the
+  /// changes are no longer known, then any word may have changed
+  bool UserChangesSince(uint64 since, std::vector<std::string> *words) const;
 
  private:
   void StartElement(const char* name, const char** atts);
   void EndElement(const char*);
   void CharHandler(const char* data, const int32 len);
+  /// Map a binary image, returns false if it is not a valid image
+  bool LoadBinary(const std::string &pathname);
+  /// Release the binary image
+  void UnloadBinary();
+  /// Size and modification time of the xml lexicon, false if there is none
+  bool StatXml(const std::string &tpdb, uint64 *size, int64 *mtime);
+  /// Lookup in the binary image
+  int GetPronBinary(const std::string &word,
+                    const std::string &entry,
+                    TxpLexiconLkp* lkp) const;
+  /// Index the words of the lookup map once it has been parsed
+  void BuildIndex();
+  /// Copy the lexicon entries of word as <word>:<entry> lookups
+  void GetEntries(const std::string &word, LookupLex *entries) const;
+  /// Lookup in the user entries of a word
+  int GetPronUser(const LookupLex &entries, const std::string &word,
+                  const std::string &entry, TxpLexiconLkp* lkp) const;
+  /// Swap in a changed copy of the user entries, recording the changed words
+  void SetUser(std::shared_ptr<TxpLexiconUser> user,
+               const std::vector<std::string> &changed);
+  /// Binary image, either memory mapped or read into image_buffer_
+  const char* image_;
+  size_t image_size_;
+  bool image_mapped_;
+  std::string image_buffer_;
+  /// Words sorted by byte order, each with a range of records
+  const TxpLexiconBinWord* words_;
+  int32 num_words_;
+  /// Entry and pronunciation of each record, in lookup map order
+  const TxpLexiconBinRecord* records_;
+  int32 num_records_;
+  /// String pool the words and records point into
+  const char* pool_;
+  /// Size and modification time of the xml the lexicon (or the image) was
+  /// made from, 0 if unknown
+  uint64 xml_size_;
+  int64 xml_mtime_;
   /// Holds <entry>:<word> and default:<word> pronunciation lookups
   LookupLex lookup_;
+  /// Entries of the lookup map in order, with the first entry and number of
+  /// entries of each word indexed by the word trie
+  std::vector<LookupLex::const_iterator> index_entries_;
+  std::vector<std::pair<int32, int32> > index_words_;
+  TxpTrie index_;
+  /// User entries, replaced as a whole by each change, NULL if none were
+  /// ever added
+  std::shared_ptr<const TxpLexiconUser> user_;
+  std::atomic<uint64> user_version_;
+  /// Serialises changes to the user entries
+  std::mutex user_mutex_;
   /// Holds parser status in lex item
   bool inlex_;
   /// Hold current entry value during parse
@@ -93,6 +195,7 @@ class TxpLexicon: public TxpXmlData {
   std::string pron_;
   /// Holds current word during parse
   std::string word_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TxpLexicon);
 };
 
 /// This structure is used to find the pronunciation of a word
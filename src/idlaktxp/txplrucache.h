@@ -0,0 +1,107 @@
+// idlaktxp/txplrucache.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPLRUCACHE_H_
+#define KALDI_IDLAKTXP_TXPLRUCACHE_H_
+
+// This file defines a bounded least recently used cache used by modules to
+// remember results for repeated input
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Bounded cache of values keyed on strings. Not thread safe, a cache
+/// belongs to a module object and module objects are not shared between
+/// threads.
+template <class V>
+class TxpLruCache {
+ public:
+  explicit TxpLruCache(int32 capacity = 0)
+      : capacity_(capacity), lookups_(0), hits_(0) {}
+  ~TxpLruCache() {}
+  /// Set the maximum number of entries, 0 disables the cache. Also clears it
+  void SetCapacity(int32 capacity) {
+    capacity_ = capacity;
+    Clear();
+  }
+  int32 Capacity() const {return capacity_;}
+  /// Remove all entries and reset the counters
+  void Clear() {
+    entries_.clear();
+    index_.clear();
+    lookups_ = hits_ = 0;
+  }
+  /// Return the value for key or NULL, the pointer is valid until the next
+  /// Insert
+  const V* Find(const std::string &key) {
+    typename Index::iterator it;
+    lookups_++;
+    it = index_.find(key);
+    if (it == index_.end()) return NULL;
+    hits_++;
+    // move to the front of the list
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &(it->second->second);
+  }
+  /// Add value for key, which must not be present, removing the least
+  /// recently used entry if the cache is full
+  void Insert(const std::string &key, const V &value) {
+    if (capacity_ <= 0) return;
+    if (entries_.size() >= capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.push_front(std::make_pair(key, value));
+    index_[key] = entries_.begin();
+  }
+  /// Remove the entries whose key satisfies pred, keeping the counters
+  template <class P>
+  void EraseIf(P pred) {
+    typename Entries::iterator it = entries_.begin();
+    while (it != entries_.end()) {
+      if (pred(it->first)) {
+        index_.erase(it->first);
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  /// Number of calls to Find and how many found a value
+  int64 Lookups() const {return lookups_;}
+  int64 Hits() const {return hits_;}
+
+ private:
+  /// Entries in least recently used order, most recent first
+  typedef std::list<std::pair<std::string, V> > Entries;
+  typedef std::unordered_map<std::string, typename Entries::iterator> Index;
+  Entries entries_;
+  Index index_;
+  int32 capacity_;
+  int64 lookups_;
+  int64 hits_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPLRUCACHE_H_
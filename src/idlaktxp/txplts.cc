@@ -16,111 +16,177 @@
 // limitations under the License.
 //
 
+#include <algorithm>
 #include "idlaktxp/txplts.h"
 #include "idlaktxp/txputf8.h"
 
 namespace kaldi {
 
 static int32 pos2int(const std::string &pos);
-static bool ApplyQuestion(const char* word, const int32 pos, const char* utfchar);
-static const char* ApplyTree(const TxpLtsTree &tree,
-                              const char* word,
-                              const int32 pos);
+
+TxpLts::TxpLts() : stress_root_(-1), tree_base_(0), tree_letter_(-1) {
+  for (int32 i = 0; i < 128; i++) ascii_ids_[i] = kLtsNoLetter;
+}
 
 void TxpLts::StartElement(const char* name, const char** atts) {
+  std::string ltr;
   std::string terminal;
   std::string nonterminal;
-  LtsMap::iterator it;
+  TxpUtf8 utf8;
   if (!strcmp(name, "tree")) {
-    SetAttribute("ltr", atts, &ltr_);
+    SetAttribute("ltr", atts, &ltr);
     SetAttribute("terminal", atts, &terminal);
     SetAttribute("nonterminal", atts, &nonterminal);
-    TxpLtsTree tree;
-    if (atoi(nonterminal.c_str()) == 0) tree.root = 0;
-    else tree.root = atoi(terminal.c_str());
-    ltslkp_.insert(LtsItem(ltr_, tree));
+    // node indexes in the tree are relative to its first node
+    tree_base_ = nodes_.size();
+    tree_letter_ = AddLetter(ltr.c_str(), ltr.size());
+    if (roots_[tree_letter_] >= 0) {
+      KALDI_WARN << "Duplicate LTS tree ignored: " << ltr;
+      tree_letter_ = -1;
+      return;
+    }
+    if (atoi(nonterminal.c_str()) == 0)
+      roots_[tree_letter_] = tree_base_;
+    else
+      roots_[tree_letter_] = tree_base_ + atoi(terminal.c_str());
+    if (ltr == "0") stress_root_ = roots_[tree_letter_];
   } else if (!strcmp(name, "node")) {
+    if (tree_letter_ < 0) return;
     TxpLtsNode node;
     std::string pos;
+    std::string posval;
     std::string yes;
     std::string no;
+    std::string val;
     SetAttribute("pos", atts, &pos);
-    SetAttribute("posval", atts, &(node.posval));
+    SetAttribute("posval", atts, &posval);
     SetAttribute("yes", atts, &yes);
     SetAttribute("no", atts, &no);
-    SetAttribute("val", atts, &(node.val));
-    if (!pos.empty()) {
-      // non terminal node
-      node.yes = atoi(yes.c_str());
-      node.no = atoi(no.c_str());
+    SetAttribute("val", atts, &val);
+    node.pos = 0;
+    node.letter = kLtsNoLetter;
+    node.phone = -1;
+    node.yes = -1;
+    node.no = -1;
+    if (!val.empty()) {
+      // terminal node
+      node.phone = PhoneId(val);
+    } else {
+      // non terminal node, questions are about a single letter
+      if (posval == "#") {
+        node.letter = kLtsBoundary;
+      } else {
+        node.letter = AddLetter(posval.c_str(),
+                                std::min<int32>(utf8.Clen(posval.c_str()),
+                                                posval.size()));
+      }
+      node.yes = tree_base_ + atoi(yes.c_str());
+      node.no = tree_base_ + atoi(no.c_str());
       node.pos = pos2int(pos);
     }
-    it = ltslkp_.find(ltr_);
-    (it->second).nodes.push_back(node);
+    nodes_.push_back(node);
   }
 }
 
 int TxpLts::GetPron(const std::string &word, TxpLexiconLkp* lkp) {
   TxpUtf8 utf8;
-  int32 clen, pos = 0;
-  const char *p, *phone, *stress;
-  std::string ltr;
-  LtsMap::iterator it;
-  TxpLtsTree stress_tree;
-  bool stress_tree_present = true;
-  
-  // get stress lookup
-  it = ltslkp_.find(std::string("0"));
-  if (it == ltslkp_.end()) {
-    stress_tree_present = false;
-    KALDI_WARN << "No stress lookup tree: name='0'";
-  } else {
-    stress_tree = it->second;
+  int32 clen, num_letters;
+  const char *p, *end;
+  std::vector<int32> letters, offsets;
+
+  if (stress_root_ < 0) KALDI_WARN << "No stress lookup tree: name='0'";
+  // convert the word to letter ids once, questions then compare ids
+  p = word.c_str();
+  end = p + strlen(p);
+  while (p < end) {
+    clen = std::min<int32>(utf8.Clen(p), end - p);
+    letters.push_back(LetterId(p, clen));
+    offsets.push_back(p - word.c_str());
+    p += clen;
   }
+  num_letters = letters.size();
+  offsets.push_back(end - word.c_str());
   // process each letter
-  p = word.c_str();
-  while (*p) {
-    clen = utf8.Clen(p);
-    ltr = std::string(p, clen);
-    it = ltslkp_.find(ltr);
-    if (it != ltslkp_.end()) {
-      phone = ApplyTree(it->second, word.c_str(), pos);
-      const char * orig = phone;
-      // If not a null result
-      if (strcmp("0", phone)) {
-        const char *sep = strchr(phone, '_');
-        if (!lkp->pron.empty()) lkp->pron += " ";
-        // Split the phone on "_" as LTS can return multiphone
-        while (sep) {
-          lkp->pron += std::string(phone, sep - phone);
-          lkp->pron += " ";
-          phone = sep + 1;
-          sep = strchr(phone, '_');
-        }
-
-        // Check is syllabic and if so get stress
-        if (phone[strlen(phone) - 1] == '0' && stress_tree_present) {
-            stress = ApplyTree(stress_tree, word.c_str(), pos);
-            lkp->pron += std::string(phone, strlen(phone) - 1);
-            lkp->pron += stress;
-            free((void *)stress);
-        } else {
-          lkp->pron += phone;
-        }
-      }
-      free((void *)orig);
-    } else {
+  for (int32 pos = 0; pos < num_letters; pos++) {
+    int32 root = (letters[pos] >= 0) ? roots_[letters[pos]] : -1;
+    if (root < 0) {
+      std::string ltr(word, offsets[pos], offsets[pos + 1] - offsets[pos]);
       // HACKY: Remove annoying warning for English possessive form
       if (ltr.compare("'"))
         KALDI_WARN << "Letter not in LTS tree: " << ltr;
+      continue;
+    }
+    const TxpLtsPhone &phone =
+        phones_[ApplyTree(root, &(letters[0]), num_letters, pos)];
+    // If not a null result
+    if (phone.val == "0") continue;
+    if (!lkp->pron.empty()) lkp->pron += " ";
+    // Check is syllabic and if so get stress
+    if (phone.syllabic && stress_root_ >= 0) {
+      lkp->pron.append(phone.pron, 0, phone.pron.size() - 1);
+      lkp->pron += phones_[ApplyTree(stress_root_, &(letters[0]), num_letters,
+                                     pos)].val;
+    } else {
+      lkp->pron += phone.pron;
     }
-    p += clen;
-    pos++;
   }
   lkp->lts = true;
   return true;
 }
 
+int32 TxpLts::LetterId(const char* p, int32 clen) const {
+  if (clen == 1 && !(p[0] & 0x80))
+    return ascii_ids_[static_cast<int32>(p[0])];
+  std::unordered_map<std::string, int32>::const_iterator it =
+      letter_ids_.find(std::string(p, clen));
+  if (it == letter_ids_.end()) return kLtsNoLetter;
+  return it->second;
+}
+
+int32 TxpLts::AddLetter(const char* p, int32 clen) {
+  int32 id = LetterId(p, clen);
+  if (id != kLtsNoLetter) return id;
+  id = roots_.size();
+  roots_.push_back(-1);
+  if (clen == 1 && !(p[0] & 0x80))
+    ascii_ids_[static_cast<int32>(p[0])] = id;
+  else
+    letter_ids_[std::string(p, clen)] = id;
+  return id;
+}
+
+int32 TxpLts::PhoneId(const std::string &val) {
+  std::unordered_map<std::string, int32>::iterator it = phone_ids_.find(val);
+  if (it != phone_ids_.end()) return it->second;
+  TxpLtsPhone phone;
+  // LTS can return multiphone separated by "_"
+  phone.val = val;
+  phone.pron = val;
+  std::replace(phone.pron.begin(), phone.pron.end(), '_', ' ');
+  phone.syllabic = val[val.size() - 1] == '0';
+  phone_ids_[val] = phones_.size();
+  phones_.push_back(phone);
+  return phones_.size() - 1;
+}
+
+int32 TxpLts::ApplyTree(int32 root, const int32* letters, int32 num_letters,
+                        int32 pos) const {
+  const TxpLtsNode *node = &(nodes_[root]);
+  while (node->phone < 0) {
+    int32 idx = pos + node->pos;
+    bool match;
+    if (node->letter == kLtsBoundary) {
+      // as the string based questions did, '#' matches any position
+      // before the end of the word
+      match = idx < num_letters;
+    } else {
+      match = idx >= 0 && idx < num_letters && letters[idx] == node->letter;
+    }
+    node = &(nodes_[match ? node->yes : node->no]);
+  }
+  return node->phone;
+}
+
 static int32 pos2int(const std::string &pos) {
   int32 loc = 0, idx = 0;
   while ((loc = pos.find("n.", loc)) != std::string::npos) {
@@ -135,44 +201,4 @@ static int32 pos2int(const std::string &pos) {
   return idx;
 }
 
-static bool ApplyQuestion(const char* word, const int32 pos, const char* utfchar) {
-  TxpUtf8 utf8;
-  int32 clen = 0, idx = 0;
-  const char* p = word;
-  // position before word start
-  if (pos < 0 && !strcmp(utfchar, "#")) return true;
-  while (*p) {
-    clen = utf8.Clen(p);
-    if (idx == pos) break;
-    p += clen;
-    idx++;
-  }
-  // position after word end
-  if (*p &&  !strcmp(utfchar, "#")) return true;
-  // matches utf8char at pos
-  if (!strncmp(p, utfchar, clen)) return true;
-  return false;
-}
-
-static const char* ApplyTree(const TxpLtsTree &tree,
-                              const char* word,
-			     const int32 pos) {
-  int32 currentnode = tree.root;
-  TxpLtsNode node;
-  while (1) {
-    node = tree.nodes[currentnode];
-    // check for non terminal node
-    if (!node.val.empty()) {
-      break;
-    } else {
-      if (ApplyQuestion(word, pos + node.pos, node.posval.c_str())) {
-        currentnode = node.yes;
-      } else {
-        currentnode = node.no;
-      }
-    }
-  }
-  return strdup(node.val.c_str());
-}
-
 }  // namespace kaldi
@@ -21,10 +21,9 @@
 
 // This file defines the cart letter to sound system
 
-#include <map>
-#include <utility>
-#include <vector>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpxmldata.h"
@@ -33,22 +32,24 @@
 namespace kaldi {
 
 struct TxpLtsNode;
-struct TxpLtsTree;
+struct TxpLtsPhone;
 
-/// Array of nodes used in the cart tree
+/// Array of nodes used in the cart forest
 typedef std::vector<TxpLtsNode> TxpLtsNodes;
-/// Lookup for letter to tree
-typedef std::map<std::string, TxpLtsTree> LtsMap;
-/// letter/tree pair
-typedef std::pair<std::string, TxpLtsTree> LtsItem;
 
 /// Contains a cart tree for each letter
 /// Questions are left and right context letters
 /// Trees are typically built from a source lexicon using speechtools
 /// wagon
+///
+/// All trees are flattened into a single node array as they are parsed.
+/// Letters and phones are interned to integer ids, each letter id indexes
+/// its tree root directly, and a word is converted to letter ids once so
+/// questions compare integers. Phones are returned as references into the
+/// phone table.
 class TxpLts: public TxpXmlData {
  public:
-  explicit TxpLts() {}
+  explicit TxpLts();
   ~TxpLts() {}
   void Init(const TxpParseOptions &opts, const std::string &name) {
     TxpXmlData::Init(opts, "ccart", name);
@@ -57,30 +58,50 @@ class TxpLts: public TxpXmlData {
   /// of each letter in a cart tree
   int GetPron(const std::string &word, TxpLexiconLkp* lkp);
 
+  /// Letter id used in questions about the word boundary ('#')
+  static const int32 kLtsBoundary = -2;
+  /// Letter id of letters not used by any tree or question
+  static const int32 kLtsNoLetter = -1;
+
  private:
   void StartElement(const char* name, const char** atts);
-  /// Lookup from letter to cart tree
-  LtsMap ltslkp_;
-  /// holds parser status of current letter
-  std::string ltr_;
-};
-
-/// A cart tree
-struct TxpLtsTree {
-  /// the index of the root node in the node array
-  int32 root;
-  /// Array of terminal and non-terminal nodes
-  TxpLtsNodes nodes;
+  /// Letter id for the utf8 character at p of length clen
+  int32 LetterId(const char* p, int32 clen) const;
+  /// As LetterId but unknown letters are given a new id
+  int32 AddLetter(const char* p, int32 clen);
+  /// Follows the tree from root for the letter at pos in a word of
+  /// num_letters letter ids and returns the phone id at the leaf
+  int32 ApplyTree(int32 root, const int32* letters, int32 num_letters,
+                  int32 pos) const;
+  /// Phone id for val, interning it if new
+  int32 PhoneId(const std::string &val);
+  /// Nodes of all trees
+  TxpLtsNodes nodes_;
+  /// Root node of the tree for each letter id, -1 if no tree
+  std::vector<int32> roots_;
+  /// Root node of the stress tree (letter '0'), -1 if not present
+  int32 stress_root_;
+  /// Phones returned by terminal nodes, indexed by phone id
+  std::vector<TxpLtsPhone> phones_;
+  std::unordered_map<std::string, int32> phone_ids_;
+  /// Letter ids of ASCII characters
+  int32 ascii_ids_[128];
+  /// Letter ids of other characters keyed on their utf8 bytes
+  std::unordered_map<std::string, int32> letter_ids_;
+  /// holds parser status of current tree, offset of its first node
+  int32 tree_base_;
+  /// letter id of current tree, -1 if its nodes are ignored
+  int32 tree_letter_;
 };
 
 /// Structure for terminal and non-terminal nodes
 struct TxpLtsNode {
   /// if non-terminal offset of context letter
   int32 pos;
-  /// if non-terminal the value of the context letter
-  std::string posval;
-  /// if terminal the value of the phone
-  std::string val;
+  /// if non-terminal the letter id of the context letter or kLtsBoundary
+  int32 letter;
+  /// if terminal the phone id, -1 otherwise
+  int32 phone;
   /// if non-terminal the index of the node to go to if the
   /// context matches
   int32 yes;
@@ -89,6 +110,17 @@ struct TxpLtsNode {
   int32 no;
 };
 
+/// Phone (or '_' separated phones) returned by a cart tree
+struct TxpLtsPhone {
+  /// value as it appears in the tree, "0" is no phone
+  std::string val;
+  /// val with '_' replaced by spaces
+  std::string pron;
+  /// true if the last phone ends in '0' and takes its stress from the
+  /// stress tree
+  bool syllabic;
+};
+
 }  // namespace kaldi
 
 #endif  // KALDI_IDLAKTXP_TXPLTS_H_
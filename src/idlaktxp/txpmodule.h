@@ -47,6 +47,20 @@ class TxpModule {
   /// Process the XML, modifying the XML to reflect linguistic
   /// information
   virtual bool Process(pugi::xml_document* input) {return true;}
+  /// True if the module can instead be run from a TxpTokenPass, which walks
+  /// the document once calling the functions below for several modules
+  virtual bool IsTokenVisitor() const {return false;}
+  /// Called before the document is walked
+  virtual void StartDocument(pugi::xml_document* input) {}
+  /// Called before and after the elements of each fileid are visited, or of
+  /// the document element if there are no fileids
+  virtual void StartFile(pugi::xml_node file) {}
+  virtual void EndFile(pugi::xml_node file) {}
+  /// Called for each tk, break and ws element in document order. Elements
+  /// may only be added before node or inside the current file
+  virtual void VisitToken(pugi::xml_node node) {}
+  /// Called after the document is walked
+  virtual void EndDocument(pugi::xml_document* input) {}
   /// Return a configuration value for this module as a string (rendundant)
   const std::string GetConfigValue(const std::string &key);
   /// Return an option value for this module as a string
@@ -36,24 +36,15 @@ TxpNRules::TxpNRules()
     rgxalpha_default_(NULL) {
 }
 
+// regular expressions belong to the TxpPcre registry
 TxpNRules::~TxpNRules() {
-  RgxMap::iterator it;
   LookupMapMap::iterator itmap;
-  for (it = rgxs_.begin(); it != rgxs_.end(); it++) {
-    pcre_free(const_cast<pcre *>(it->second));
-  }
   for (itmap = lkps_.begin(); itmap != lkps_.end(); itmap++) {
     delete (itmap->second);
   }
   for (itmap = locallkps_.begin(); itmap != locallkps_.end(); itmap++) {
     delete (itmap->second);
   }
-  pcre_free(const_cast<pcre *>(lkp_item_));
-  pcre_free(const_cast<pcre *>(lkp_open_));
-  pcre_free(const_cast<pcre *>(rgxwspace_default_));
-  pcre_free(const_cast<pcre *>(rgxsep_default_));
-  pcre_free(const_cast<pcre *>(rgxpunc_default_));
-  pcre_free(const_cast<pcre *>(rgxalpha_default_));
 }
 
 void TxpNRules::Init(const TxpParseOptions &opts, const std::string &name) {
@@ -279,15 +270,12 @@ void TxpNRules::StartCData() {
 
 // TODO(MPA): Add checking (i.e. max match on regex, duplications, empty keys)
 void TxpNRules::EndCData() {
-  const char* error;
-  int erroffset;
+  TxpPcre pcre;
   incdata_ = false;
   if (elementtype_ == "lookup") {
     MakeLkp(&lkps_, elementname_, cdata_buffer_);
   } else if (elementtype_ == "regex") {
-    rgxs_.insert(RgxItem(elementname_, pcre_compile(cdata_buffer_.c_str(),
-                                                    PCRE_UTF8, &error,
-                                                    &erroffset, NULL)));
+    rgxs_.insert(RgxItem(elementname_, pcre.Compile(cdata_buffer_.c_str())));
   }
 }
 
@@ -47,8 +47,12 @@ const std::string txpconfigdefault =
     "--normalise-arch=default\n"
     "--pronounce-arch=default\n"
     "--pronounce-novowel-spell=True\n"
+    "--pronounce-cache-size=20000\n"
+    "--pronounce-cache-stats=False\n"
     "--syllabify-arch=default\n"
     "--syllabify-slang=\n"
+    "--syllabify-cache-size=20000\n"
+    "--syllabify-cache-stats=False\n"
     "--cex-arch=default\n";
 
 TxpParseOptions::TxpParseOptions(const char *usage)
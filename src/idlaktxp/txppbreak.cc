@@ -18,6 +18,8 @@
 
 // This file hold information that relates punctuation to pause insertion
 
+#include <algorithm>
+
 #include "idlaktxp/txppbreak.h"
 
 namespace kaldi {
@@ -27,34 +29,78 @@ bool TxpPbreak::Parse(const std::string &tpdb) {
   r = TxpXmlData::Parse(tpdb);
   if (!r)
     KALDI_WARN << "Error reading phrase break file: " << tpdb;
+  pre_table_.Build(pre_pbreak_);
+  pst_table_.Build(pst_pbreak_);
   return r;
 }
 
 bool TxpPbreak::GetPbreak(const char* punc,
                           enum TXPPBREAK_POS pos,
                           TxpPbreakInfo &info) {
-  PbreakMap::iterator lkp;
+  const PuncTable &table = (pos == TXPPBREAK_POS_PRE) ? pre_table_ : pst_table_;
+  const TxpPbreakInfo* pbreak;
   const char* p;
   TxpUtf8 utf8;
-  int32 clen;
+  int32 clen, i;
   bool found = false;
   p = punc;
   while (*p) {
     clen = utf8.Clen(p);
-    if (pos == TXPPBREAK_POS_PRE) {
-      lkp = pre_pbreak_.find(std::string(p, clen));
-      if (lkp != pre_pbreak_.end()) found = true;
-    } else {
-      lkp = pst_pbreak_.find(std::string(p, clen));
-      if (lkp != pst_pbreak_.end()) found = true;
+    pbreak = table.Find(utf8.Codepoint(p));
+    if (pbreak) {
+      found = true;
+      if (pbreak->time > info.time) info.time = pbreak->time;
+      if (pbreak->type > info.type) info.type = pbreak->type;
     }
-    if (found && lkp->second.time > info.time) info.time = lkp->second.time;
-    if (found && lkp->second.type > info.type) info.type = lkp->second.type;
-    p += clen;
+    // do not step over the end of a character cut short
+    for (i = 1; i < clen && p[i]; i++) {}
+    p += i;
   }
   return found;
 }
 
+void TxpPbreak::PuncTable::Clear() {
+  for (int32 i = 0; i < 128; i++) {
+    ascii_set_[i] = false;
+    ascii_[i].Clear();
+  }
+  wide_.clear();
+}
+
+static bool _by_codepoint(const std::pair<uint32, TxpPbreakInfo> &a,
+                          const std::pair<uint32, TxpPbreakInfo> &b) {
+  return a.first < b.first;
+}
+
+void TxpPbreak::PuncTable::Build(const PbreakMap &pbreaks) {
+  PbreakMap::const_iterator it;
+  TxpUtf8 utf8;
+  uint32 cp;
+  Clear();
+  for (it = pbreaks.begin(); it != pbreaks.end(); ++it) {
+    const std::string &punc = it->first;
+    if (punc.empty() ||
+        utf8.Clen(punc.c_str()) != static_cast<int32>(punc.size()))
+      continue;
+    cp = utf8.Codepoint(punc.c_str());
+    if (cp < 128) {
+      ascii_set_[cp] = true;
+      ascii_[cp] = it->second;
+    } else {
+      wide_.push_back(std::make_pair(cp, it->second));
+    }
+  }
+  std::sort(wide_.begin(), wide_.end(), _by_codepoint);
+}
+
+const TxpPbreakInfo* TxpPbreak::PuncTable::FindWide(uint32 cp) const {
+  std::vector<std::pair<uint32, TxpPbreakInfo> >::const_iterator it;
+  it = std::lower_bound(wide_.begin(), wide_.end(),
+                        std::make_pair(cp, TxpPbreakInfo()), _by_codepoint);
+  if (it != wide_.end() && it->first == cp) return &(it->second);
+  return NULL;
+}
+
 void TxpPbreak::GetWhitespaceBreaks(const char* ws, int32 col,
                                     bool hzone,
                                     int32 hzone_start, int32 hzone_end,
@@ -32,7 +32,17 @@
 
 namespace kaldi {
 
-struct TxpPbreakInfo;
+/// Structure which holds break type (strength) and break time
+struct TxpPbreakInfo {
+ public:
+  TxpPbreakInfo() : type(0), time(0.0f) {}
+  void Clear() {
+    type = 0;
+    time = 0.0f;
+  }
+  int32 type;
+  float32 time;
+};
 
 /// Position of break is when punctuation is before (PRE) or after (PST) token
 enum TXPPBREAK_POS {TXPPBREAK_POS_PRE = 0,
@@ -77,29 +87,42 @@ class TxpPbreak: public TxpXmlData {
 
 
  private:
+  /// Break information of the single character entries of a map by unicode
+  /// code point, so that GetPbreak does not build and look up a string for
+  /// each character of the punctuation
+  class PuncTable {
+   public:
+    PuncTable() { Clear(); }
+    void Clear();
+    /// Copies the single character entries of pbreaks
+    void Build(const PbreakMap &pbreaks);
+    /// NULL if the code point has no entry
+    const TxpPbreakInfo* Find(uint32 cp) const {
+      if (cp < 128) return ascii_set_[cp] ? &ascii_[cp] : NULL;
+      return FindWide(cp);
+    }
+   private:
+    const TxpPbreakInfo* FindWide(uint32 cp) const;
+    bool ascii_set_[128];
+    TxpPbreakInfo ascii_[128];
+    // sorted by code point
+    std::vector<std::pair<uint32, TxpPbreakInfo> > wide_;
+  };
   void StartElement(const char* name, const char** atts);
   /// Map of punctuation characters that fire breaks before tokens
   PbreakMap pre_pbreak_;
   /// Map of punctuation characters that fire breaks after tokens
   PbreakMap pst_pbreak_;
+  /// Table of pre_pbreak_
+  PuncTable pre_table_;
+  /// Table of pst_pbreak_
+  PuncTable pst_table_;
   /// Default break strength
   int32 default_type_;
   /// Default break time
   float32 default_time_;
 };
 
-/// Structure which holds break type (strength) and break time
-struct TxpPbreakInfo {
- public:
-  TxpPbreakInfo() : type(0), time(0.0f) {}
-  void Clear() {
-    type = 0;
-    time = 0.0f;
-  }
-  int32 type;
-  float32 time;
-};
-
 }  // namespace kaldi
 
 #endif  // KALDI_IDLAKTXP_TXPPBREAK_H_
@@ -0,0 +1,119 @@
+// idlaktxp/txppcre-speed-test.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Tokens per second through the tokenisation regular expressions, run with
+// pcre's interpreter (no study data) and through TxpPcre (studied / JIT).
+// Tokens are taken from the text of the test_data/mod-testNNN.xml files.
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "util/common-utils.h"
+#include "idlaktxp/txppcre.h"
+#include "idlaktxp/txptrules.h"
+
+static void ReadTokens(const std::string &dirin,
+                       std::vector<std::string> *tokens) {
+  for (kaldi::int32 fno = 0; ; fno++) {
+    std::ostringstream fname;
+    fname << dirin << "/mod-test" << std::setw(3) << std::setfill('0') << fno
+          << ".xml";
+    std::ifstream is(fname.str().c_str());
+    if (!is.is_open()) break;
+    std::stringstream buf;
+    buf << is.rdbuf();
+    // drop the markup and split the text on whitespace
+    std::string text = buf.str(), token;
+    bool intag = false;
+    for (size_t i = 0; i < text.size(); i++) {
+      char c = text[i];
+      if (c == '<') intag = true;
+      if (intag || isspace(static_cast<unsigned char>(c))) {
+        if (!token.empty()) tokens->push_back(token);
+        token.clear();
+      } else {
+        token.push_back(c);
+      }
+      if (c == '>') intag = false;
+    }
+    if (!token.empty()) tokens->push_back(token);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const char *usage =
+      "Benchmark the tokenisation regular expressions\n"
+      "Usage:  txppcre-speed-test [xml_input_dir]\n";
+  std::string dirin = "test_data";
+  std::string tpdb = "../../idlak-data/";
+  kaldi::int32 repeats = 200;
+
+  try {
+    kaldi::TxpParseOptions po(usage);
+    po.SetTpdb(tpdb);
+    po.Register("repeats", &repeats, "Number of passes over the tokens");
+    po.Read(argc, argv);
+    if (po.NumArgs() == 1) dirin = po.GetArg(1);
+
+    kaldi::TxpTrules trules;
+    trules.Init(po, std::string(po.GetValue("tokenise", "arch")));
+    if (!trules.Parse(po.GetTpdb()))
+      KALDI_ERR << "Can't load tokenisation rules from " << po.GetTpdb();
+    std::vector<const pcre*> rgxs;
+    const char *names[] = {"whitespace", "punctuation", "alpha"};
+    for (kaldi::int32 i = 0; i < 3; i++)
+      if (trules.GetRgx(names[i])) rgxs.push_back(trules.GetRgx(names[i]));
+
+    std::vector<std::string> tokens;
+    ReadTokens(dirin, &tokens);
+    if (tokens.empty()) KALDI_ERR << "No test data in " << dirin;
+
+    int ovector[KALDI_TXPPCRE_MAXMATCH * 3];
+    kaldi::int64 interp_matches = 0, jit_matches = 0;
+    kaldi::Timer timer;
+    for (kaldi::int32 r = 0; r < repeats; r++)
+      for (size_t t = 0; t < tokens.size(); t++)
+        for (size_t i = 0; i < rgxs.size(); i++)
+          if (pcre_exec(rgxs[i], NULL, tokens[t].c_str(), tokens[t].size(), 0,
+                        PCRE_NO_UTF8_CHECK, ovector,
+                        KALDI_TXPPCRE_MAXMATCH * 3) >= 0)
+            interp_matches++;
+    double interp = timer.Elapsed();
+
+    kaldi::TxpPcre pcre;
+    timer.Reset();
+    for (kaldi::int32 r = 0; r < repeats; r++)
+      for (size_t t = 0; t < tokens.size(); t++)
+        for (size_t i = 0; i < rgxs.size(); i++)
+          if (pcre.Execute(rgxs[i], tokens[t])) jit_matches++;
+    double jit = timer.Elapsed();
+
+    KALDI_ASSERT(interp_matches == jit_matches);
+    double ntokens = static_cast<double>(tokens.size()) * repeats;
+    KALDI_LOG << tokens.size() << " tokens, " << rgxs.size()
+              << " regexes, interpreted: " << ntokens / interp
+              << " tokens/sec, studied/JIT: " << ntokens / jit
+              << " tokens/sec";
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+  return 0;
+}
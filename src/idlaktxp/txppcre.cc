@@ -17,20 +17,94 @@
 //
 
 #include "idlaktxp/txppcre.h"
+#include <map>
+#include <mutex>
+#include <unordered_map>
 
 namespace kaldi {
 
+namespace {
+
+// Compiled patterns shared by every TxpPcre
+struct TxpPcreRegistry {
+  std::mutex mutex;
+  std::map<std::string, const pcre*> patterns;
+  std::unordered_map<const pcre*, const pcre_extra*> extras;
+};
+
+// Never deleted so that patterns stay valid during static destruction
+TxpPcreRegistry* GetRegistry() {
+  static TxpPcreRegistry* registry = new TxpPcreRegistry;
+  return registry;
+}
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+// The default JIT stack lives on the machine stack and is small, each
+// thread gets its own larger one the first time it runs a JIT pattern
+struct TxpJitStack {
+  TxpJitStack() : stack(pcre_jit_stack_alloc(32 * 1024, 1024 * 1024)) {}
+  ~TxpJitStack() { if (stack) pcre_jit_stack_free(stack); }
+  pcre_jit_stack* stack;
+};
+
+pcre_jit_stack* TxpJitStackCB(void* data) {
+  static thread_local TxpJitStack jit_stack;
+  return jit_stack.stack;
+}
+#endif
+
+// Study data for a pattern, cached per thread so executing does not lock
+const pcre_extra* GetExtra(const pcre* rgx) {
+  static thread_local std::unordered_map<const pcre*, const pcre_extra*> cache;
+  std::unordered_map<const pcre*, const pcre_extra*>::iterator it =
+      cache.find(rgx);
+  if (it != cache.end()) return it->second;
+  TxpPcreRegistry* registry = GetRegistry();
+  const pcre_extra* extra = NULL;
+  {
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    std::unordered_map<const pcre*, const pcre_extra*>::iterator e =
+        registry->extras.find(rgx);
+    if (e != registry->extras.end()) extra = e->second;
+  }
+  cache[rgx] = extra;
+  return extra;
+}
+
+}  // namespace
+
 // Convert string into a pcre regular expression
 const pcre* TxpPcre::Compile(const char* rgx) {
   const char* error;
   int erroffset;
-  return pcre_compile(rgx, PCRE_UTF8, &error, &erroffset, NULL);
+  TxpPcreRegistry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  std::map<std::string, const pcre*>::iterator it =
+      registry->patterns.find(rgx);
+  if (it != registry->patterns.end()) return it->second;
+  pcre* code = pcre_compile(rgx, PCRE_UTF8, &error, &erroffset, NULL);
+  if (!code) {
+    KALDI_WARN << "Invalid regular expression: " << error << " at offset "
+               << erroffset << " in " << rgx;
+    return NULL;
+  }
+  pcre_extra* extra;
+#ifdef PCRE_STUDY_JIT_COMPILE
+  extra = pcre_study(code, PCRE_STUDY_JIT_COMPILE, &error);
+  if (extra) pcre_assign_jit_stack(extra, TxpJitStackCB, NULL);
+#else
+  extra = pcre_study(code, 0, &error);
+#endif
+  registry->patterns.insert(std::make_pair(std::string(rgx), code));
+  registry->extras.insert(std::make_pair(code, extra));
+  return code;
 }
 
 // Apply a regular expression to some input
 bool TxpPcre::Execute(const pcre* rgx, const std::string &input) {
   input_ = input.c_str();
-  n_ = pcre_exec(rgx, NULL, input_, input.length(), 0, PCRE_NO_UTF8_CHECK,
+  n_ = pcre_exec(rgx, GetExtra(rgx), input_, input.length(), 0,
+                 PCRE_NO_UTF8_CHECK,
                  ovector_,
                  KALDI_TXPPCRE_MAXMATCH * 3);
   if (n_ >= 0) return true;
@@ -40,7 +114,7 @@ bool TxpPcre::Execute(const pcre* rgx, const std::string &input) {
 // Apply a regular expression to a string and return remaining unmatched string
 const char* TxpPcre::Consume(const pcre* rgx, const char* input, int32 len) {
   input_ = input;
-  n_ = pcre_exec(rgx, NULL, input, len, 0, PCRE_NO_UTF8_CHECK,
+  n_ = pcre_exec(rgx, GetExtra(rgx), input, len, 0, PCRE_NO_UTF8_CHECK,
                  ovector_,
                  KALDI_TXPPCRE_MAXMATCH * 3);
   if (n_ >= 0) {
@@ -34,9 +34,16 @@ namespace kaldi {
 /// @{
 
 /// Simple C++ wrapper around pcre
+///
+/// Regular expressions are compiled through a process wide registry so that
+/// the same pattern used by several modules or voices is compiled once. Each
+/// pattern is studied, and JIT compiled where pcre supports it, and the
+/// study data is used whenever the expression is executed, with a JIT stack
+/// per thread. Registry patterns live until the process exits and must not
+/// be freed by the caller.
 class TxpPcre {
  public:
-  /// Convert string into a pcre regular expression
+  /// Convert string into a pcre regular expression, NULL if it is invalid
   const pcre* Compile(const char* rgx);
   /// Apply a regular expression to some input
   bool Execute(const pcre* rgx, const std::string &input);
@@ -19,6 +19,7 @@
 // This is a very simple part of speech tagger. It could be improved by taking
 // note of breaks caused by punctuation
 
+#include <algorithm>
 #include "idlaktxp/txppos.h"
 
 namespace kaldi {
@@ -32,36 +33,36 @@ bool TxpPos::Parse(const std::string &tpdb) {
 }
 
 const char* TxpPos::GetPos(const char* ptag, const char* word) {
-  PosRgxVector::iterator it;
   LookupMap::iterator lkp;
+  PosRgxIndex::const_iterator rule;
   const char* current_tag;
+  std::string wrd(word);
+  size_t len = wrd.size(), i;
+  int32 first = rgxtagger_.size();
   current_tag =  most_common_.c_str();
-  // Regex tagger
-  for (it = rgxtagger_.begin(); it != rgxtagger_.end(); ++it) {
-    if ((*it).pos == TXPPOSRGX_POS_WORD &&
-        !strcmp((*it).pattern.c_str(), word)) {
-      current_tag = (*it).tag.c_str();
-      break;
-    } else if ((*it).pos == TXPPOSRGX_POS_PREFIX &&
-             !strncmp((*it).pattern.c_str(), word, (*it).pattern.length())) {
-      current_tag = (*it).tag.c_str();
-      break;
-    } else if ((*it).pos == TXPPOSRGX_POS_SUFFIX &&
-             (*it).pattern.length() < strlen(word) &&
-             !strcmp((*it).pattern.c_str(),
-                     word + (strlen(word) - (*it).pattern.length()))) {
-      current_tag = (*it).tag.c_str();
-      break;
-    }
+  // Regex tagger, earliest matching rule
+  rule = rgxwords_.find(wrd);
+  if (rule != rgxwords_.end()) first = rule->second;
+  for (i = 0; i < prefix_lengths_.size() && prefix_lengths_[i] <= len; i++) {
+    rule = rgxprefixes_.find(wrd.substr(0, prefix_lengths_[i]));
+    if (rule != rgxprefixes_.end() && rule->second < first)
+      first = rule->second;
+  }
+  // a suffix must be shorter than the word
+  for (i = 0; i < suffix_lengths_.size() && suffix_lengths_[i] < len; i++) {
+    rule = rgxsuffixes_.find(wrd.substr(len - suffix_lengths_[i]));
+    if (rule != rgxsuffixes_.end() && rule->second < first)
+      first = rule->second;
   }
+  if (first < rgxtagger_.size()) current_tag = rgxtagger_[first].tag.c_str();
   // Pattern tagger: unigram
-  lkp = patterntagger_.find(std::string(word));
+  lkp = patterntagger_.find(wrd);
   if (lkp != patterntagger_.end()) {
     current_tag = (lkp->second).c_str();
   }
   // bigram
   if (*ptag) {
-    lkp = patterntagger_.find(std::string(ptag) + "_" + std::string(word));
+    lkp = patterntagger_.find(std::string(ptag) + "_" + wrd);
     if (lkp != patterntagger_.end()) {
       current_tag = lkp->second.c_str();
     }
@@ -79,11 +80,22 @@ void TxpPos::StartElement(const char* name, const char** atts) {
   }
   if (!strcmp(name, "r")) {
     SetAttribute("pos", atts, &pos);
-    if (pos == "WORD") rgx.pos = TXPPOSRGX_POS_WORD;
-    else if (pos == "PREFIX") rgx.pos = TXPPOSRGX_POS_PREFIX;
-    else if (pos == "SUFFIX") rgx.pos = TXPPOSRGX_POS_SUFFIX;
     SetAttribute("pat", atts, &(rgx.pattern));
     SetAttribute("tag", atts, &(rgx.tag));
+    // rules of an unknown type never match
+    if (pos == "WORD") {
+      rgx.pos = TXPPOSRGX_POS_WORD;
+      if (!rgxwords_.count(rgx.pattern))
+        rgxwords_[rgx.pattern] = rgxtagger_.size();
+    } else if (pos == "PREFIX") {
+      rgx.pos = TXPPOSRGX_POS_PREFIX;
+      AddRgxPattern(rgx.pattern, rgxtagger_.size(), &rgxprefixes_,
+                    &prefix_lengths_);
+    } else if (pos == "SUFFIX") {
+      rgx.pos = TXPPOSRGX_POS_SUFFIX;
+      AddRgxPattern(rgx.pattern, rgxtagger_.size(), &rgxsuffixes_,
+                    &suffix_lengths_);
+    }
     rgxtagger_.push_back(rgx);
   } else if (!strcmp(name, "w")) {
     SetAttribute("name", atts, &word_);
@@ -97,6 +109,16 @@ void TxpPos::StartElement(const char* name, const char** atts) {
   }
 }
 
+void TxpPos::AddRgxPattern(const std::string &pattern, int32 rule,
+                           PosRgxIndex* index, std::vector<size_t>* lengths) {
+  std::vector<size_t>::iterator it;
+  if (index->count(pattern)) return;
+  (*index)[pattern] = rule;
+  it = std::lower_bound(lengths->begin(), lengths->end(), pattern.size());
+  if (it == lengths->end() || *it != pattern.size())
+    lengths->insert(it, pattern.size());
+}
+
 bool TxpPosSet::Parse(const std::string &tpdb) {
   bool r;
   r = TxpXmlData::Parse(tpdb);
@@ -24,6 +24,7 @@
 // class which hold definitions of tag types
 
 #include <map>
+#include <unordered_map>
 #include <utility>
 #include <string>
 #include <vector>
@@ -43,6 +44,8 @@ enum TXPPOSRGX_POS {TXPPOSRGX_POS_WORD = 0,
 
 /// An array of tagger regular expressions
 typedef std::vector<TxpPosRgx> PosRgxVector;
+/// Tagger regular expression pattern to the index of its first rule
+typedef std::unordered_map<std::string, int32> PosRgxIndex;
 
 /// Part of speech tagger
 /// see /ref idlaktxp_pos
@@ -60,6 +63,9 @@ class TxpPos: public TxpXmlData {
 
  private:
   void StartElement(const char* name, const char** atts);
+  /// Index a regular expression pattern and keep its length in lengths
+  void AddRgxPattern(const std::string &pattern, int32 rule,
+                     PosRgxIndex* index, std::vector<size_t>* lengths);
   /// For loading pattern tagger
   std::string word_;
   // Tagger data
@@ -68,6 +74,15 @@ class TxpPos: public TxpXmlData {
   /// Array of regular expression taggers. Note this doesn't use pcre
   /// because the regexs are only ever whole words, prefixes or suffixes
   PosRgxVector rgxtagger_;
+  /// The first matching rule wins. Rules are indexed by type so a word is
+  /// tagged with one lookup per distinct prefix and suffix length rather
+  /// than a scan over all the rules
+  PosRgxIndex rgxwords_;
+  PosRgxIndex rgxprefixes_;
+  PosRgxIndex rgxsuffixes_;
+  /// Distinct prefix and suffix pattern lengths in ascending order
+  std::vector<size_t> prefix_lengths_;
+  std::vector<size_t> suffix_lengths_;
   /// unigram and POS_word bigram patterns.
   LookupMap patterntagger_;
 };
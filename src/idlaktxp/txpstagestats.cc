@@ -0,0 +1,124 @@
+// idlaktxp/txpstagestats.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include <map>
+#include <mutex>
+#include "idlaktxp/txpstagestats.h"
+
+namespace kaldi {
+
+namespace {
+
+struct TxpStageStatsTable {
+  std::mutex mutex;
+  std::vector<TxpStageStat> stats;
+  // index of each stage in stats
+  std::map<std::string, size_t> index;
+  double audio_seconds = 0.0;
+};
+
+// Never destroyed, so stages may still be timed during static destruction
+TxpStageStatsTable &GetTable() {
+  static TxpStageStatsTable* table = new TxpStageStatsTable;
+  return *table;
+}
+
+// Prometheus label values escape backslash, quote and newline
+std::string EscapeLabel(const std::string &value) {
+  std::string escaped;
+  for (size_t i = 0; i < value.size(); i++) {
+    if (value[i] == '\\' || value[i] == '"') escaped += '\\';
+    if (value[i] == '\n') escaped += "\\n";
+    else escaped += value[i];
+  }
+  return escaped;
+}
+
+}  // namespace
+
+void TxpStageStatsAdd(const std::string &stage, double seconds,
+                      int64 items, const std::string &unit) {
+  TxpStageStatsTable &table = GetTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  std::map<std::string, size_t>::iterator it = table.index.find(stage);
+  if (it == table.index.end()) {
+    it = table.index.insert(std::make_pair(stage, table.stats.size())).first;
+    TxpStageStat stat = {stage, unit, 0, 0.0, 0};
+    table.stats.push_back(stat);
+  }
+  TxpStageStat &stat = table.stats[it->second];
+  stat.calls++;
+  stat.seconds += seconds;
+  stat.items += items;
+  if (stat.unit.empty()) stat.unit = unit;
+}
+
+void TxpStageStatsAddAudio(double seconds) {
+  TxpStageStatsTable &table = GetTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  table.audio_seconds += seconds;
+}
+
+void TxpStageStatsGet(std::vector<TxpStageStat>* stats,
+                      double* audio_seconds) {
+  TxpStageStatsTable &table = GetTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  *stats = table.stats;
+  if (audio_seconds) *audio_seconds = table.audio_seconds;
+}
+
+void TxpStageStatsReset() {
+  TxpStageStatsTable &table = GetTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  table.stats.clear();
+  table.index.clear();
+  table.audio_seconds = 0.0;
+}
+
+void TxpStageStatsWritePrometheus(std::ostream &os) {
+  std::vector<TxpStageStat> stats;
+  double audio_seconds;
+  TxpStageStatsGet(&stats, &audio_seconds);
+  size_t i;
+  os << "# HELP idlak_stage_calls_total Number of runs of each stage\n"
+     << "# TYPE idlak_stage_calls_total counter\n";
+  for (i = 0; i < stats.size(); i++)
+    os << "idlak_stage_calls_total{stage=\"" << EscapeLabel(stats[i].stage)
+       << "\"} " << stats[i].calls << "\n";
+  os << "# HELP idlak_stage_seconds_total Wall clock time spent in each "
+     << "stage\n"
+     << "# TYPE idlak_stage_seconds_total counter\n";
+  for (i = 0; i < stats.size(); i++)
+    os << "idlak_stage_seconds_total{stage=\"" << EscapeLabel(stats[i].stage)
+       << "\"} " << stats[i].seconds << "\n";
+  os << "# HELP idlak_stage_items_total Tokens, phones, frames or samples "
+     << "processed by each stage\n"
+     << "# TYPE idlak_stage_items_total counter\n";
+  for (i = 0; i < stats.size(); i++) {
+    if (stats[i].unit.empty()) continue;
+    os << "idlak_stage_items_total{stage=\"" << EscapeLabel(stats[i].stage)
+       << "\",unit=\"" << EscapeLabel(stats[i].unit) << "\"} "
+       << stats[i].items << "\n";
+  }
+  os << "# HELP idlak_audio_seconds_total Length of the audio synthesised\n"
+     << "# TYPE idlak_audio_seconds_total counter\n"
+     << "idlak_audio_seconds_total " << audio_seconds << "\n";
+}
+
+}  // namespace kaldi
@@ -0,0 +1,87 @@
+// idlaktxp/txpstagestats.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef KALDI_IDLAKTXP_TXPSTAGESTATS_H_
+#define KALDI_IDLAKTXP_TXPSTAGESTATS_H_
+
+// This file defines process wide timings and counts for the stages of
+// text processing and synthesis, so the time taken by each stage can be
+// monitored without a profiler
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "pugixml.hpp"
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "idlaktxp/txpmodule.h"
+
+namespace kaldi {
+
+/// Totals for one stage
+struct TxpStageStat {
+  std::string stage;
+  /// What items counts, e.g. tokens, phones, frames or samples
+  std::string unit;
+  int64 calls;
+  double seconds;
+  int64 items;
+};
+
+/// Add one run of a stage to the totals. Safe to call from any thread
+void TxpStageStatsAdd(const std::string &stage, double seconds,
+                      int64 items = 0, const std::string &unit = "");
+/// Add to the total length of the audio synthesised, which the stage times
+/// can be divided by for a real time factor
+void TxpStageStatsAddAudio(double seconds);
+/// Copy of the totals in the order the stages first ran
+void TxpStageStatsGet(std::vector<TxpStageStat>* stats, double* audio_seconds);
+void TxpStageStatsReset();
+/// Write the totals as counters in the Prometheus text format
+void TxpStageStatsWritePrometheus(std::ostream &os);
+
+/// Adds the time from construction to destruction as one run of a stage
+class TxpStageTimer {
+ public:
+  explicit TxpStageTimer(const std::string &stage) : stage_(stage), items_(0) {}
+  ~TxpStageTimer() {TxpStageStatsAdd(stage_, timer_.Elapsed(), items_, unit_);}
+  /// Set the number of items processed in this run
+  void SetItems(int64 items, const std::string &unit) {
+    items_ = items;
+    unit_ = unit;
+  }
+
+ private:
+  Timer timer_;
+  std::string stage_;
+  int64 items_;
+  std::string unit_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TxpStageTimer);
+};
+
+/// Run a module on the document as a stage named after the module
+inline bool TxpProcessTimed(TxpModule* module, pugi::xml_document* input) {
+  TxpStageTimer timer(module->GetName());
+  return module->Process(input);
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPSTAGESTATS_H_
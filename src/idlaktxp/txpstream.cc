@@ -0,0 +1,187 @@
+// idlaktxp/txpstream.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cctype>
+#include <cstring>
+#include "idlaktxp/txpstream.h"
+
+namespace kaldi {
+
+// size of each read from the input stream
+static const size_t kTxpStreamBlock = 65536;
+
+static bool IsSpace(char c) {
+  return isspace(static_cast<unsigned char>(c));
+}
+
+bool TxpStreamReader::Fill() {
+  char buf[kTxpStreamBlock];
+  if (!is_.good()) return false;
+  is_.read(buf, kTxpStreamBlock);
+  if (is_.gcount() <= 0) return false;
+  buffer_.append(buf, is_.gcount());
+  return true;
+}
+
+size_t TxpStreamReader::Find(const char* str, size_t pos) {
+  size_t found, len = strlen(str);
+  while ((found = buffer_.find(str, pos)) == std::string::npos) {
+    // the match may start in the part already searched
+    if (buffer_.size() >= pos + len) pos = buffer_.size() - len + 1;
+    if (!Fill()) return std::string::npos;
+  }
+  return found;
+}
+
+size_t TxpStreamReader::MarkupEnd(size_t pos) {
+  size_t found;
+  char quote = 0;
+  // enough input to recognise the longest opening, <![CDATA[
+  while (buffer_.size() < pos + 9 && Fill()) {}
+  if (!buffer_.compare(pos, 4, "<!--")) {
+    found = Find("-->", pos + 4);
+    return (found == std::string::npos) ? found : found + 3;
+  }
+  if (!buffer_.compare(pos, 9, "<![CDATA[")) {
+    found = Find("]]>", pos + 9);
+    return (found == std::string::npos) ? found : found + 3;
+  }
+  if (!buffer_.compare(pos, 2, "<?")) {
+    found = Find("?>", pos + 2);
+    return (found == std::string::npos) ? found : found + 2;
+  }
+  // a tag, attribute values may contain '>'
+  for (size_t i = pos + 1; ; i++) {
+    if (i >= buffer_.size() && !Fill()) return std::string::npos;
+    if (quote) {
+      if (buffer_[i] == quote) quote = 0;
+    } else if (buffer_[i] == '"' || buffer_[i] == '\'') {
+      quote = buffer_[i];
+    } else if (buffer_[i] == '>') {
+      return i + 1;
+    }
+  }
+}
+
+bool TxpStreamReader::ReadRoot() {
+  size_t end, len;
+  while (true) {
+    if (pos_ >= buffer_.size() && !Fill()) return false;
+    // skip whitespace (and a byte order mark) between prolog items
+    if (buffer_[pos_] != '<') {
+      pos_++;
+      continue;
+    }
+    end = MarkupEnd(pos_);
+    if (end == std::string::npos) return false;
+    // declaration, processing instruction, comment or doctype
+    if (buffer_[pos_ + 1] == '?' || buffer_[pos_ + 1] == '!') {
+      pos_ = end;
+      continue;
+    }
+    root_tag_ = buffer_.substr(pos_, end - pos_);
+    len = root_tag_.find_first_of(" \t\r\n/>", 1);
+    root_name_ = root_tag_.substr(1, len - 1);
+    // an empty root has nothing to process
+    if (root_tag_[root_tag_.size() - 2] == '/') {
+      root_tag_.erase(root_tag_.size() - 2, 1);
+      finished_ = true;
+    }
+    buffer_.erase(0, end);
+    pos_ = 0;
+    depth_ = 1;
+    return true;
+  }
+}
+
+bool TxpStreamReader::Next(pugi::xml_document* doc, unsigned int options) {
+  size_t end = std::string::npos, close, len;
+  bool content = false, sentence_end = false;
+  std::string name, text;
+  char c;
+  if (!started_) {
+    started_ = true;
+    if (!ReadRoot()) KALDI_ERR << "No root element in input stream";
+  }
+  if (finished_) return false;
+  while (end == std::string::npos) {
+    if (pos_ >= buffer_.size() && !Fill()) {
+      KALDI_WARN << "Input stream ends before the root element is closed";
+      finished_ = true;
+      end = buffer_.size();
+      break;
+    }
+    c = buffer_[pos_];
+    if (c == '<') {
+      close = MarkupEnd(pos_);
+      if (close == std::string::npos)
+        KALDI_ERR << "Unterminated markup in input stream";
+      if (buffer_[pos_ + 1] == '/') {
+        depth_--;
+        if (!depth_) {
+          // end of the root, the rest of the input is ignored
+          finished_ = true;
+          end = pos_;
+          break;
+        }
+        len = buffer_.find_first_of(" \t\r\n>", pos_ + 2);
+        name = buffer_.substr(pos_ + 2, len - pos_ - 2);
+        if (depth_ == 1 && name == "fileid") end = close;
+      } else if (!buffer_.compare(pos_, 9, "<![CDATA[")) {
+        content = true;
+      } else if (buffer_[pos_ + 1] != '!' && buffer_[pos_ + 1] != '?') {
+        content = true;
+        if (buffer_[close - 2] != '/') depth_++;
+      }
+      sentence_end = false;
+      pos_ = close;
+    } else {
+      // a line break after a full stop, question or exclamation mark, which
+      // may be followed by closing quotes or brackets
+      if (depth_ == 1) {
+        if (c == '.' || c == '?' || c == '!') {
+          sentence_end = true;
+        } else if (c == '\n') {
+          if (sentence_end && content) end = pos_ + 1;
+        } else if (!IsSpace(c) && !strchr("\"')]", c)) {
+          sentence_end = false;
+        }
+      }
+      if (!IsSpace(c)) content = true;
+      pos_++;
+    }
+  }
+  if (content) {
+    text = root_tag_;
+    text.append(buffer_, 0, end);
+    text += "</" + root_name_ + ">";
+  }
+  buffer_.erase(0, finished_ ? buffer_.size() : end);
+  pos_ = 0;
+  // trailing whitespace is not a chunk
+  if (!content) return false;
+  pugi::xml_parse_result r = doc->load_buffer(text.data(), text.size(),
+                                              options, pugi::encoding_utf8);
+  if (!r) {
+    KALDI_ERR << "PugiXML Parse Error in Input Stream " << r.description()
+              << " Error offset: " << r.offset;
+  }
+  return true;
+}
+
+}  // namespace kaldi
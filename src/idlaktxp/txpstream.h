@@ -0,0 +1,77 @@
+// idlaktxp/txpstream.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPSTREAM_H_
+#define KALDI_IDLAKTXP_TXPSTREAM_H_
+
+// This file defines a reader which splits input XML into chunks that can
+// each be run through the txp modules as a separate document
+
+#include <pugixml.hpp>
+#include <istream>
+#include <string>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Reads an XML document from a stream one chunk at a time.
+///
+/// A chunk ends after a fileid element, or after sentence final punctuation
+/// followed by a line break in text directly below the root element. Markup
+/// deeper in the document is never split. Each chunk is loaded as a document
+/// under a copy of the input root element, so only one chunk of the input is
+/// held in memory.
+class TxpStreamReader {
+ public:
+  explicit TxpStreamReader(std::istream &is)
+      : is_(is), pos_(0), depth_(0), started_(false), finished_(false) {}
+  ~TxpStreamReader() {}
+  /// Load the next chunk into doc, returns false at the end of the input
+  bool Next(pugi::xml_document* doc,
+            unsigned int options = pugi::parse_default);
+  /// The root element start tag as it appears in the input
+  const std::string &GetRootStartTag() const {return root_tag_;}
+  /// The name of the root element
+  const std::string &GetRootName() const {return root_name_;}
+
+ private:
+  // append more input to the buffer, false at the end of the input
+  bool Fill();
+  // position of str in the buffer from pos reading input as required,
+  // std::string::npos if the input ends first
+  size_t Find(const char* str, size_t pos);
+  // position after the end of the markup starting at pos
+  size_t MarkupEnd(size_t pos);
+  // skip the prolog and read the root start tag
+  bool ReadRoot();
+  std::istream &is_;
+  // unread input, a chunk always starts at the beginning
+  std::string buffer_;
+  std::string root_tag_;
+  std::string root_name_;
+  // scan position in the buffer
+  size_t pos_;
+  // element depth at pos_, 1 directly below the root
+  int32 depth_;
+  bool started_;
+  bool finished_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPSTREAM_H_
@@ -32,10 +32,8 @@ bool TxpSylmax::Parse(const std::string &tpdb) {
 }
 
 void TxpSylmax::Maxonset(PhoneVector *pronptr) {
-  std::string pat;
   int32 nlen, olen, pos, i;
   PhoneVector &pron = *pronptr;
-  StringSet::iterator it;
   // move forwards trying to find the nucleus
   for (pos = 0; pos < pron.size(); pos++) {
     // try largest nuclei first
@@ -133,28 +131,22 @@ int32 TxpSylmax::AddSylBound(PhoneVector *pronptr) {
 
 int32 TxpSylmax::FindNucleus(const PhoneVector &pron, int32 pos) {
   int len;
-  std::string pat;
-  StringSet::iterator it;
+  std::vector<int32> pat;
   for (len = max_nucleus_; len > 0; len--) {
-    if (GetPhoneNucleusPattern(pron, pos, len, stress_, &pat)) {
-      it = nuclei_.find(pat);
-      if (it != nuclei_.end())
-        return len;
-    }
+    if (GetPhoneNucleusPattern(pron, pos, len, stress_, &pat) &&
+        nuclei_.count(pat))
+      return len;
   }
   return 0;
 }
 
 int32 TxpSylmax::FindOnset(const PhoneVector &pron, int32 pos) {
   int len;
-  std::string pat;
-  StringSet::iterator it;
+  std::vector<int32> pat;
   for (len = max_onset_; len > 0; len--) {
-    if (GetPhoneOnsetPattern(pron, pos, len, &pat)) {
-      it = onsets_.find(pat);
-      if (it != onsets_.end())
-        return len;
-    }
+    if (GetPhoneOnsetPattern(pron, pos, len, &pat) &&
+        onsets_.count(pat))
+      return len;
   }
   return 0;
 }
@@ -203,61 +195,128 @@ void TxpSylmax::InsertPhone(PhoneVector *phonevectorptr,
   } else {
     item.name = std::string(p, len);
   }
+  item.id = items_.Find(item.name);
+  if (item.stress.empty())
+    item.stress_id = item.id;
+  else
+    item.stress_id = items_.Find(item.name + item.stress);
   phonevector.push_back(item);
 }
 
 bool TxpSylmax::GetPhoneNucleusPattern(const PhoneVector &pron,
                                        int32 pos, int32 len,
-                                       bool with_stress, std::string *pat) {
-  PhoneVector::const_iterator it;
-  int32 i;
+                                       bool with_stress,
+                                       std::vector<int32> *pat) {
+  int32 i, id;
   pat->clear();
-  for (i = 0, it = pron.begin() + pos; i < len; ++it, ++i) {
-    if (it == pron.end()) {
-      pat->clear();
-      return false;
-    }
-    if (!pat->empty()) *pat += " ";
+  if (pos + len > pron.size()) return false;
+  for (i = pos; i < pos + len; i++) {
     // Remove stress marks if required (forward only for nucleus)
-    if (!with_stress)
-      *pat += it->name;
-    else
-      *pat += it->name + it->stress;
+    id = with_stress ? pron[i].stress_id : pron[i].id;
+    // a phone in no pattern can't match
+    if (id == TxpSymbolTable::kNoSymbol) return false;
+    pat->push_back(id);
   }
   return true;
 }
 
 bool TxpSylmax::GetPhoneOnsetPattern(const PhoneVector &pron,
                                      int32 pos, int32 len,
-                                     std::string *pat) {
-  PhoneVector::const_reverse_iterator it;
+                                     std::vector<int32> *pat) {
   int32 i;
   pat->clear();
-  for (i = 0, it = pron.rbegin() + (pron.size() - pos); i < len; ++it, ++i) {
-    if (it == pron.rend()) {
-      pat->clear();
-      return false;
-    }
+  if (len > pos) return false;
+  pat->resize(len);
+  for (i = 0; i < len; i++) {
+    const TxpSylItem &item = pron[pos - 1 - i];
     // word boundary blocks onset pattern
-    if (it->wrdb && !it->cross_word) {
-      pat->clear();
-      return false;
-    }
-    if (!pat->empty()) *pat = " " + *pat;
-    *pat = it->name + *pat;
+    if (item.wrdb && !item.cross_word) return false;
+    if (item.id == TxpSymbolTable::kNoSymbol) return false;
+    (*pat)[len - 1 - i] = item.id;
   }
   return true;
 }
 
 bool TxpSylmax::IsSyllabic(const char *phone) {
   StringSet::iterator it = syllabic_.find(std::string(phone));
-  return (it != onsets_.end());
+  return (it != syllabic_.end());
+}
+
+void TxpSylmax::Syllabify(const std::vector<const char*> &prons,
+                          std::vector<std::string> *sprons,
+                          TxpSylCache *cache) {
+  PhoneVector pvector;
+  std::string sylpron;
+  int32 i, pre = -1;
+  sprons->assign(prons.size(), std::string());
+  for (i = 0; i < prons.size(); i++) {
+    if (!prons[i] || !*prons[i]) continue;
+    GetPhoneVector(prons[i], &pvector);
+    // no liaison out of the spurt
+    if (i == prons.size() - 1) pvector[pvector.size() - 1].cross_word = false;
+    // the previous word is written once the next is known, after the first
+    // token of the spurt
+    SyllabifyStep(&pvector, i > 0, &sylpron, cache);
+    if (i > 0 && pre >= 0) (*sprons)[pre] = sylpron;
+    pre = i;
+  }
+  if (pre >= 0) {
+    Writespron(&pvector, &sylpron);
+    (*sprons)[pre] = sylpron;
+  }
+}
+
+void TxpSylmax::SyllabifyStep(PhoneVector *pron, bool write,
+                              std::string *sylpron, TxpSylCache *cache) {
+  std::string key;
+  const TxpSylStep* cached;
+  PhoneVector::const_iterator it;
+  if (!cache || cache->Capacity() <= 0) {
+    Maxonset(pron);
+    if (write) Writespron(pron, sylpron);
+    return;
+  }
+  // the step only depends on the phones and their flags
+  for (it = pron->begin(); it != pron->end(); ++it) {
+    key += it->name;
+    key.push_back('\0');
+    key += it->stress;
+    key.push_back('\0');
+    key.push_back('A' + it->type + (it->wrdb << 2) + (it->sylb << 3) +
+                  (it->codab << 4) + (it->cross_word << 5));
+  }
+  key.push_back(write ? 'w' : 'n');
+  cached = cache->Find(key);
+  if (cached) {
+    *pron = cached->rest;
+    if (write) *sylpron = cached->sylpron;
+    return;
+  }
+  TxpSylStep step;
+  Maxonset(pron);
+  if (write) Writespron(pron, &step.sylpron);
+  step.rest = *pron;
+  cache->Insert(key, step);
+  if (write) *sylpron = step.sylpron;
+}
+
+int32 TxpSylmax::AddPattern(const std::string &pat,
+                            SylPatternSet *patterns) {
+  std::vector<int32> ids;
+  size_t start = 0, end;
+  do {
+    end = pat.find(' ', start);
+    if (end == std::string::npos) end = pat.size();
+    ids.push_back(items_.Intern(pat.substr(start, end - start)));
+    start = end + 1;
+  } while (end < pat.size());
+  patterns->insert(ids);
+  return ids.size();
 }
 
 
 void TxpSylmax::StartElement(const char *name, const char ** atts) {
   std::string item;
-  PhoneVector pv;
   int32 size;
   if (!strcmp("nuclei", name)) {
     SetAttribute("stress", atts, &item);
@@ -277,8 +336,7 @@ void TxpSylmax::StartElement(const char *name, const char ** atts) {
       KALDI_ERR << fname_ << ": error missing 'pat' attribute on line " << GetCurrentLineNumber();
       return;
     }
-    onsets_.insert(item);
-    size = GetPhoneVector(item.c_str(), &pv);
+    size = AddPattern(item, &onsets_);
     if (size > max_onset_) max_onset_ = size;
   } else if (!strcmp("n", name)) {
     SetAttribute("pat", atts, &item);
@@ -286,8 +344,7 @@ void TxpSylmax::StartElement(const char *name, const char ** atts) {
       KALDI_ERR << fname_ << ": error missing 'pat' attribute on line " << GetCurrentLineNumber();
       return;
     }
-    nuclei_.insert(item);
-    size = GetPhoneVector(item.c_str(), &pv);
+    size = AddPattern(item, &nuclei_);
     if (size > max_nucleus_) max_nucleus_ = size;
   }
 }
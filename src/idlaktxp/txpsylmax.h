@@ -22,11 +22,14 @@
 // This file contains functions which carry out maximal onset
 // syllabification
 
+#include <set>
 #include <vector>
 #include <string>
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpxmldata.h"
+#include "idlaktxp/txpsymbols.h"
+#include "idlaktxp/txplrucache.h"
 #include "idlaktxp/txputf8.h"
 
 namespace kaldi {
@@ -43,6 +46,15 @@ struct TxpSylItem;
 /// pronunication loaded after the word being syllabified.
 typedef std::vector<TxpSylItem> PhoneVector;
 
+/// Onset and nucleus patterns as sequences of pattern item ids
+typedef std::set<std::vector<int32> > SylPatternSet;
+
+struct TxpSylStep;
+
+/// Results of syllabification steps keyed on the phone array they started
+/// from, see TxpSylmax::Syllabify
+typedef TxpLruCache<TxpSylStep> TxpSylCache;
+
 /// Applies maximal onset rule to create syllables
 /// see \ref idlaktxp_syll
 class TxpSylmax: public TxpXmlData {
@@ -61,10 +73,20 @@ class TxpSylmax: public TxpXmlData {
   int32 GetPhoneVector(const char* pron, PhoneVector* phonevectorptr);
   /// Decide if a phone is syllabic or not
   bool IsSyllabic(const char* phone);
+  /// Syllabify the pronunciations of the tokens of a spurt in one call.
+  /// sprons[i] is set to the syllabified pronunciation of prons[i], empty
+  /// for an empty pron. A word's syllables can depend on its neighbours
+  /// (liaison, nuclei across word boundaries), so each step is cached on
+  /// the whole phone array it starts from, not on the word alone.
+  void Syllabify(const std::vector<const char*> &prons,
+                 std::vector<std::string>* sprons, TxpSylCache* cache = NULL);
 
 
  private:
   void StartElement(const char* name, const char** atts);
+  /// Maxonset and, if write, Writespron, using the cache if one is given
+  void SyllabifyStep(PhoneVector* pron, bool write, std::string* sylpron,
+                     TxpSylCache* cache);
   /// Based on codas, onsets and nuclei set syllable boundaries in phone array
   int32 AddSylBound(PhoneVector *pron);
   /// Find if a valid nucleus begins here
@@ -74,24 +96,28 @@ class TxpSylmax: public TxpXmlData {
   /// Append a phone starting at p into the phone array
   void InsertPhone(PhoneVector *phonevectorptr,
                    const char* p, int32 len, bool wbnd);
+  /// Add a space separated pattern to patterns, returns its length
+  int32 AddPattern(const std::string &pat, SylPatternSet* patterns);
   /// Set nucleus pattern based on position and length in phone array
   /// return true if not blocked by a word boundary and sufficient items
   /// are available
   bool GetPhoneNucleusPattern(const PhoneVector &pron,
                               int32 pos, int32 len,
-                              bool with_stress, std::string* pat);
+                              bool with_stress, std::vector<int32>* pat);
   /// Set onset pattern based on position and length backwards in phone array
   /// return true if not blocked by a word boundary and sufficient items
   /// are available
   bool GetPhoneOnsetPattern(const PhoneVector &pron,
                             int32 pos, int32 len,
-                            std::string* pat);
+                            std::vector<int32>* pat);
   /// phones which are syllabic
   StringSet syllabic_;
+  /// phones (with stress for stressed nuclei) used in the patterns
+  TxpSymbolTable items_;
   /// valid nucleus patterns
-  StringSet nuclei_;
+  SylPatternSet nuclei_;
   /// valid onset patterns
-  StringSet onsets_;
+  SylPatternSet onsets_;
   /// If stress true nucleus patterns must match correct stress
   bool stress_;
   /// longest onset pattern
@@ -107,6 +133,8 @@ struct TxpSylItem {
   void Clear() {
     name = "";
     stress = "";
+    id = TxpSymbolTable::kNoSymbol;
+    stress_id = TxpSymbolTable::kNoSymbol;
     type = TXPSYLMAX_TYPE_CODA;
     wrdb = false;
     sylb = false;
@@ -117,6 +145,10 @@ struct TxpSylItem {
   std::string name;
   /// Stress value
   std::string stress;
+  /// Pattern item id of the phone name, kNoSymbol if in no pattern
+  int32 id;
+  /// Pattern item id of the phone name with its stress
+  int32 stress_id;
   /// syllable subtype
   enum TXPSYLMAX_TYPE type;
   /// word boundary following
@@ -129,6 +161,14 @@ struct TxpSylItem {
   bool cross_word;
 };
 
+/// The outcome of one syllabification step
+struct TxpSylStep {
+  /// Syllabified pronunciation written by the step
+  std::string sylpron;
+  /// Phone array left for the next step
+  PhoneVector rest;
+};
+
 }  // namespace kaldi
 
 #endif  // KALDI_IDLAKTXP_TXPSYLMAX_H_
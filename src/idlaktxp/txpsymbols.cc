@@ -0,0 +1,38 @@
+// idlaktxp/txpsymbols.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "idlaktxp/txpsymbols.h"
+
+namespace kaldi {
+
+int32 TxpSymbolTable::Intern(const std::string &name) {
+  std::unordered_map<std::string, int32>::iterator it = ids_.find(name);
+  if (it != ids_.end()) return it->second;
+  int32 id = names_.size();
+  ids_.insert(std::make_pair(name, id));
+  names_.push_back(name);
+  return id;
+}
+
+int32 TxpSymbolTable::Find(const std::string &name) const {
+  std::unordered_map<std::string, int32>::const_iterator it = ids_.find(name);
+  if (it == ids_.end()) return kNoSymbol;
+  return it->second;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,56 @@
+// idlaktxp/txpsymbols.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPSYMBOLS_H_
+#define KALDI_IDLAKTXP_TXPSYMBOLS_H_
+
+// This file defines a table which maps names (phones, pattern items etc.)
+// to dense integer ids so that lookups compare integers instead of strings
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Interns names as ids 0..Size()-1 in the order they are first seen.
+/// A table is filled while its tpdb data is parsed and only read afterwards,
+/// so it can be shared between threads.
+class TxpSymbolTable {
+ public:
+  /// Returned by Find for a name not in the table
+  static const int32 kNoSymbol = -1;
+  TxpSymbolTable() {}
+  ~TxpSymbolTable() {}
+  /// Return the id of name, adding it if it is not already present
+  int32 Intern(const std::string &name);
+  /// Return the id of name or kNoSymbol
+  int32 Find(const std::string &name) const;
+  /// Return the name of a valid id
+  const std::string &Name(int32 id) const {return names_[id];}
+  int32 Size() const {return names_.size();}
+
+ private:
+  std::unordered_map<std::string, int32> ids_;
+  std::vector<std::string> names_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPSYMBOLS_H_
@@ -0,0 +1,83 @@
+// idlaktxp/txptokenpass.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cstring>
+#include "idlaktxp/txptokenpass.h"
+#include "idlaktxp/txpstagestats.h"
+
+namespace kaldi {
+
+namespace {
+
+struct IsFileId {
+  bool operator()(pugi::xml_node node) const {
+    return !strcmp(node.name(), "fileid");
+  }
+};
+
+bool IsToken(const char* name) {
+  return !strcmp(name, "tk") || !strcmp(name, "break") || !strcmp(name, "ws");
+}
+
+}  // namespace
+
+void TxpTokenPass::Add(TxpModule* module) {
+  KALDI_ASSERT(module->IsTokenVisitor());
+  modules_.push_back(module);
+  if (!name_.empty()) name_ += "+";
+  name_ += module->GetName();
+}
+
+bool TxpTokenPass::Process(pugi::xml_document* input) {
+  TxpStageTimer timer(name_);
+  pugi::xml_node root = input->document_element();
+  bool files = root.find_node(IsFileId());
+  size_t i;
+  for (i = 0; i < modules_.size(); i++) modules_[i]->StartDocument(input);
+  if (!files)
+    for (i = 0; i < modules_.size(); i++) modules_[i]->StartFile(root);
+  ntokens_ = 0;
+  Walk(root, files);
+  timer.SetItems(ntokens_, "tokens");
+  if (!files)
+    for (i = 0; i < modules_.size(); i++) modules_[i]->EndFile(root);
+  for (i = 0; i < modules_.size(); i++) modules_[i]->EndDocument(input);
+  return true;
+}
+
+// Elements added by the modules are before the current element or inside
+// the current file, so the walk never reaches them
+void TxpTokenPass::Walk(pugi::xml_node node, bool files) {
+  size_t i;
+  for (pugi::xml_node child = node.first_child(); child;
+       child = child.next_sibling()) {
+    if (child.type() != pugi::node_element) continue;
+    bool file = files && !strcmp(child.name(), "fileid");
+    if (file)
+      for (i = 0; i < modules_.size(); i++) modules_[i]->StartFile(child);
+    if (IsToken(child.name())) {
+      if (!strcmp(child.name(), "tk")) ntokens_++;
+      for (i = 0; i < modules_.size(); i++) modules_[i]->VisitToken(child);
+    }
+    Walk(child, files);
+    if (file)
+      for (i = 0; i < modules_.size(); i++) modules_[i]->EndFile(child);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,61 @@
+// idlaktxp/txptokenpass.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPTOKENPASS_H_
+#define KALDI_IDLAKTXP_TXPTOKENPASS_H_
+
+// This file defines a single walk over a document shared by the modules
+// which work token by token
+
+#include <string>
+#include <vector>
+#include "pugixml.hpp"
+
+#include "base/kaldi-common.h"
+#include "idlaktxp/txpmodule.h"
+
+namespace kaldi {
+
+/// Runs several token visitor modules (see TxpModule::IsTokenVisitor) in
+/// one walk of the document instead of one XPath query and node set per
+/// module. At each tk, break and ws element every module is called in the
+/// order it was added, the output is the same as calling Process on each
+/// module in turn. The walk is timed as one stage (see txpstagestats.h)
+/// named after the modules, e.g. postag+pauses.
+class TxpTokenPass {
+ public:
+  TxpTokenPass() : ntokens_(0) {}
+  ~TxpTokenPass() {}
+  /// Add a module, which must be a token visitor and is not owned
+  void Add(TxpModule* module);
+  /// Walk the document calling each module
+  bool Process(pugi::xml_document* input);
+
+ private:
+  // visit the elements below node, starting files at fileid elements when
+  // the document has them
+  void Walk(pugi::xml_node node, bool files);
+  std::vector<TxpModule*> modules_;
+  std::string name_;
+  // tk elements visited in the current walk
+  int64 ntokens_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPTOKENPASS_H_
@@ -0,0 +1,57 @@
+// idlaktxp/txptpdbstore.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "idlaktxp/txptpdbstore.h"
+
+namespace kaldi {
+
+std::mutex TxpTpdbStore::mutex_;
+std::map<std::string, std::weak_ptr<void> > TxpTpdbStore::entries_;
+
+static std::string OptString(const char *val) {
+  return val ? std::string(val) : std::string("");
+}
+
+std::string TxpTpdbStore::Key(const TxpParseOptions &opts, const char *type,
+                              const std::string &name) {
+  // fields are separated by a character that can't appear in a path name
+  std::string key = std::string(type) + '\0' + name + '\0' +
+      OptString(opts.GetTpdb());
+  const char *general[] = {"lang", "region", "acc", "spk"};
+  for (int32 i = 0; i < 4; i++)
+    key += '\0' + OptString(opts.GetValue("general", general[i]));
+  return key;
+}
+
+void TxpTpdbStore::Prune() {
+  std::map<std::string, std::weak_ptr<void> >::iterator it = entries_.begin();
+  while (it != entries_.end()) {
+    if (it->second.expired())
+      entries_.erase(it++);
+    else
+      ++it;
+  }
+}
+
+int32 TxpTpdbStore::NumEntries() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Prune();
+  return entries_.size();
+}
+
+}  // namespace kaldi
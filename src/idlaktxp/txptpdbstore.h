@@ -0,0 +1,86 @@
+// idlaktxp/txptpdbstore.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPTPDBSTORE_H_
+#define KALDI_IDLAKTXP_TXPTPDBSTORE_H_
+
+// This file defines a process wide store of parsed tpdb data so that
+// modules initialised with the same voice share one copy of each file
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include "base/kaldi-common.h"
+#include "idlaktxp/idlak-common.h"
+#include "idlaktxp/txpparse-options.h"
+
+namespace kaldi {
+
+/// Reference counted store of TxpXmlData objects
+///
+/// Objects are keyed on their class, name, tpdb directory and the general
+/// lang, region, acc and spk options, which are all that decide which file
+/// is read. An object stays in the store while any module holds it, so a
+/// second module (or a second worker) initialised with the same voice
+/// gets the already parsed data instead of reading the xml again.
+///
+/// Shared objects are only used through their lookup functions after
+/// parsing and must not be re-initialised or re-parsed by their holders.
+class TxpTpdbStore {
+ public:
+  /// Return the object T of the given name for the voice in opts, parsing
+  /// it if no module holds it. Returns an empty pointer if parsing fails.
+  template<class T>
+  static std::shared_ptr<T> Get(const TxpParseOptions &opts,
+                                const std::string &name);
+  /// Number of objects currently held by modules
+  static int32 NumEntries();
+
+ private:
+  static std::string Key(const TxpParseOptions &opts, const char *type,
+                         const std::string &name);
+  /// Removes entries no module holds any more
+  static void Prune();
+  static std::mutex mutex_;
+  static std::map<std::string, std::weak_ptr<void> > entries_;
+};
+
+template<class T>
+std::shared_ptr<T> TxpTpdbStore::Get(const TxpParseOptions &opts,
+                                     const std::string &name) {
+  std::string key = Key(opts, typeid(T).name(), name);
+  // held while parsing so that concurrent workers only parse a file once
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, std::weak_ptr<void> >::iterator it =
+      entries_.find(key);
+  if (it != entries_.end()) {
+    std::shared_ptr<void> entry = it->second.lock();
+    if (entry) return std::static_pointer_cast<T>(entry);
+  }
+  std::shared_ptr<T> data(new T());
+  data->Init(opts, name);
+  if (!data->Parse(opts.GetTpdb())) return std::shared_ptr<T>();
+  Prune();
+  entries_[key] = data;
+  return data;
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPTPDBSTORE_H_
@@ -0,0 +1,87 @@
+// idlaktxp/txptrie-test.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Checks the trie against a map of random keys
+
+#include <map>
+#include <string>
+#include "base/kaldi-common.h"
+#include "idlaktxp/txptrie.h"
+
+namespace kaldi {
+
+static std::string RandomKey() {
+  // few distinct bytes so keys share prefixes, including UTF-8 bytes
+  static const char bytes[] = {'a', 'b', 'c', '.', '\xc3', '\xa9'};
+  std::string key;
+  int32 len = Rand() % 6;
+  for (int32 i = 0; i < len; i++) key.push_back(bytes[Rand() % 6]);
+  return key;
+}
+
+static void UnitTestTxpTrie() {
+  for (int32 iter = 0; iter < 20; iter++) {
+    TxpTrie trie;
+    std::map<std::string, int32> ref;
+    for (int32 i = 0; i < 200; i++) {
+      std::string key = RandomKey();
+      trie.Insert(key, i);
+      ref[key] = i;
+    }
+    KALDI_ASSERT(trie.Size() == static_cast<int32>(ref.size()));
+    for (int32 i = 0; i < 500; i++) {
+      std::string text = RandomKey() + RandomKey();
+      std::map<std::string, int32>::const_iterator it = ref.find(text);
+      KALDI_ASSERT(trie.Find(text) ==
+                   (it == ref.end() ? TxpTrie::kNoValue : it->second));
+      // the longest prefix by brute force
+      int32 value = TxpTrie::kNoValue;
+      size_t matched = 0, found;
+      for (size_t len = 0; len <= text.size(); len++) {
+        it = ref.find(text.substr(0, len));
+        if (it != ref.end()) {
+          value = it->second;
+          matched = len;
+        }
+      }
+      KALDI_ASSERT(trie.LongestPrefix(text.data(), text.size(), &found) ==
+                   value);
+      KALDI_ASSERT(found == matched);
+    }
+  }
+  TxpTrie trie;
+  trie.Insert("Mr", 0);
+  trie.Insert("Mrs", 1);
+  KALDI_ASSERT(trie.Find("Mr") == 0 && trie.Find("Mrs") == 1);
+  KALDI_ASSERT(trie.Find("M") == TxpTrie::kNoValue);
+  KALDI_ASSERT(trie.Find("Mrs.") == TxpTrie::kNoValue);
+  size_t matched;
+  KALDI_ASSERT(trie.LongestPrefix("Mrs.", 4, &matched) == 1 && matched == 3);
+  KALDI_ASSERT(trie.LongestPrefix("Ms", 2, &matched) == TxpTrie::kNoValue &&
+               matched == 0);
+  trie.Clear();
+  KALDI_ASSERT(trie.Size() == 0 && trie.Find("Mr") == TxpTrie::kNoValue);
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestTxpTrie();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
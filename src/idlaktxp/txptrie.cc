@@ -0,0 +1,89 @@
+// idlaktxp/txptrie.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "idlaktxp/txptrie.h"
+
+namespace kaldi {
+
+void TxpTrie::Clear() {
+  Node root = {-1, -1, kNoValue, 0};
+  nodes_.assign(1, root);
+  for (int32 i = 0; i < 256; i++) root_children_[i] = -1;
+  num_keys_ = 0;
+}
+
+int32 TxpTrie::Child(int32 node, unsigned char byte) const {
+  if (!node) return root_children_[byte];
+  int32 child = nodes_[node].child;
+  while (child >= 0 && nodes_[child].byte < byte)
+    child = nodes_[child].sibling;
+  if (child >= 0 && nodes_[child].byte == byte) return child;
+  return -1;
+}
+
+void TxpTrie::Insert(const char* key, size_t len, int32 value) {
+  KALDI_ASSERT(value >= 0);
+  int32 node = 0;
+  for (size_t i = 0; i < len; i++) {
+    unsigned char byte = static_cast<unsigned char>(key[i]);
+    int32 next = Child(node, byte);
+    if (next < 0) {
+      Node n = {-1, -1, kNoValue, byte};
+      next = nodes_.size();
+      if (!node) {
+        root_children_[byte] = next;
+      } else {
+        // keep the children in byte order
+        int32 *link = &nodes_[node].child;
+        while (*link >= 0 && nodes_[*link].byte < byte)
+          link = &nodes_[*link].sibling;
+        n.sibling = *link;
+        *link = next;
+      }
+      nodes_.push_back(n);
+    }
+    node = next;
+  }
+  if (nodes_[node].value == kNoValue) num_keys_++;
+  nodes_[node].value = value;
+}
+
+int32 TxpTrie::Find(const char* key, size_t len) const {
+  int32 node = 0;
+  for (size_t i = 0; i < len && node >= 0; i++)
+    node = Child(node, static_cast<unsigned char>(key[i]));
+  return node >= 0 ? nodes_[node].value : kNoValue;
+}
+
+int32 TxpTrie::LongestPrefix(const char* text, size_t len,
+                             size_t* matched) const {
+  int32 node = 0, value = nodes_[0].value;
+  size_t found = 0;
+  for (size_t i = 0; i < len; i++) {
+    node = Child(node, static_cast<unsigned char>(text[i]));
+    if (node < 0) break;
+    if (nodes_[node].value != kNoValue) {
+      value = nodes_[node].value;
+      found = i + 1;
+    }
+  }
+  if (matched) *matched = found;
+  return value;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,80 @@
+// idlaktxp/txptrie.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPTRIE_H_
+#define KALDI_IDLAKTXP_TXPTRIE_H_
+
+// This file defines a byte trie used by the abbreviation and lexicon lookups
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Maps byte strings (UTF-8 words and tokens) to integer values.
+///
+/// Nodes hold one byte each and are stored in a single vector, the children
+/// of a node are a linked list in byte order and the children of the root
+/// are indexed by their first byte. A lookup is one walk along the key with
+/// no copies or allocation, and longest prefix matches come from the same
+/// walk. Lookups can be made concurrently once the trie is built.
+class TxpTrie {
+ public:
+  /// Returned for keys which are not in the trie
+  static const int32 kNoValue = -1;
+  TxpTrie() { Clear(); }
+  ~TxpTrie() {}
+  /// Add a key with a value of 0 or more, replacing any value it had
+  void Insert(const char* key, size_t len, int32 value);
+  void Insert(const std::string &key, int32 value) {
+    Insert(key.data(), key.size(), value);
+  }
+  /// The value of the key or kNoValue
+  int32 Find(const char* key, size_t len) const;
+  int32 Find(const char* key) const { return Find(key, strlen(key)); }
+  int32 Find(const std::string &key) const {
+    return Find(key.data(), key.size());
+  }
+  /// The value of the longest key that starts text, kNoValue if there is
+  /// none. Its length is put in matched if given
+  int32 LongestPrefix(const char* text, size_t len, size_t* matched) const;
+  /// Number of keys
+  int32 Size() const { return num_keys_; }
+  void Clear();
+
+ private:
+  struct Node {
+    int32 child;
+    int32 sibling;
+    int32 value;
+    unsigned char byte;
+  };
+  // the child of node holding byte, -1 if there is none
+  int32 Child(int32 node, unsigned char byte) const;
+  // node 0 is the root
+  std::vector<Node> nodes_;
+  // first child of the root for each byte
+  int32 root_children_[256];
+  int32 num_keys_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPTRIE_H_
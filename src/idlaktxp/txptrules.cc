@@ -30,24 +30,18 @@ TxpTrules::TxpTrules()
       rgxsep_(NULL),
       rgxpunc_(NULL),
       rgxalpha_(NULL),
-      rgxwspace_default_(NULL) {
+      rgxwspace_default_(NULL),
+      utfpunc2ascii_(NULL),
+      convertillegal_(NULL),
+      downcase_(NULL) {
 }
 
+// regular expressions belong to the TxpPcre registry
 TxpTrules::~TxpTrules() {
-  RgxMap::iterator it;
-  RgxVector::iterator itv;
   LookupMapMap::iterator itmap;
-  for (it = rgxs_.begin(); it != rgxs_.end(); it++) {
-    pcre_free(const_cast<pcre *>(it->second));
-  }
   for (itmap = lkps_.begin(); itmap != lkps_.end(); itmap++) {
     delete (itmap->second);
   }
-  for (itv = tokrgxs_.begin(); itv != tokrgxs_.end(); itv++) {
-    pcre_free(const_cast<pcre *>(*itv));
-  }
-  pcre_free(const_cast<pcre *>(lkp_item_));
-  pcre_free(const_cast<pcre *>(lkp_open_));
 }
 
 void TxpTrules::Init(const TxpParseOptions &opts, const std::string &name) {
@@ -56,29 +50,45 @@ void TxpTrules::Init(const TxpParseOptions &opts, const std::string &name) {
   lkp_item_ = pcre.Compile("[\n\\s]*(u?[\\'\\\"](.*?)[\\'\\\"]\\s*:\\s*u?[\\'\\\"](.*?)[\\'\\\"])[\n\\s]*[,}][\n\\s]*");// NOLINT
   lkp_open_ = pcre.Compile("[\n\\s]*{");
 
-  rgxs_.insert(RgxItem("whitespace", pcre.Compile("^([ \n\t\r]+)")));
-  rgxs_.insert(RgxItem("punctuation", pcre.Compile("^([\\(\\)\\[\\]\\{\\}\\\"'!\\?\\.,;:\\|]*)(.*?)([\\(\\)\\[\\]\\{\\}\\\"'!\\?\\.,;:\\|]*)$")));
-  rgxs_.insert(RgxItem("alpha", pcre.Compile("^[a-zA-Z_']+$")));
+  AddRgx("whitespace", "^([ \n\t\r]+)");
+  AddRgx("punctuation", "^([\\(\\)\\[\\]\\{\\}\\\"'!\\?\\.,;:\\|]*)(.*?)([\\(\\)\\[\\]\\{\\}\\\"'!\\?\\.,;:\\|]*)$");
+  AddRgx("alpha", "^[a-zA-Z_']+$");
   MakeLkp(&lkps_, "downcase", "{\"A\":\"a\", \"B\":\"b\", \"C\":\"c\", \"D\":\"d\", \"E\":\"e\", \"F\":\"f\", \"G\":\"g\", \"H\":\"h\", \"I\":\"i\", \"J\":\"j\", \"K\":\"k\", \"L\":\"l\", \"M\":\"m\", \"N\":\"n\", \"O\":\"o\", \"P\":\"p\", \"Q\":\"q\", \"R\":\"r\", \"S\":\"s\", \"T\":\"t\", \"U\":\"u\", \"V\":\"v\", \"W\":\"w\", \"X\":\"x\", \"Y\":\"y\", \"Z\":\"z\"}");// NOLINT
   MakeLkp(&lkps_, "convertillegal", "{\"À\":\"A\", \"Á\":\"A\", \"Â\":\"A\", \"Ã\":\"A\", \"Å\":\"A\", \"Æ\":\"AE\", \"à\":\"a\", \"á\":\"a\", \"â\":\"a\", \"ã\":\"a\", \"å\":\"a\", \"æ\":\"ae\", \"Ç\":\"C\", \"ç\":\"c\", \"È\":\"E\", \"É\":\"E\", \"Ê\":\"E\", \"Ë\":\"E\", \"è\":\"e\", \"é\":\"e\", \"ê\":\"e\", \"ë\":\"e\", \"Ì\":\"I\", \"Í\":\"I\", \"Î\":\"I\", \"Ï\":\"I\", \"ì\":\"i\", \"í\":\"i\", \"î\":\"i\", \"ï\":\"i\", \"Ñ\":\"N\", \"ñ\":\"n\", \"Ò\":\"O\", \"Ó\":\"O\", \"Ô\":\"O\", \"Õ\":\"O\", \"Ø\":\"O\", \"ò\":\"o\", \"ó\":\"o\", \"ô\":\"o\", \"õ\":\"o\", \"ø\":\"o\", \"Ù\":\"U\", \"Ú\":\"U\", \"Û\":\"U\", \"Ű\":u\"Ü\", \"ù\":\"u\", \"ú\":\"u\", \"û\":\"u\", \"ű\":u\"ü\", \"Ý\":\"Y\", \"ý\":\"y\"}");// NOLINT
   MakeLkp(&lkps_, "utfpunc2ascii", "{\"‘\":\"'\", \"’\":\"'\", \"‛\":\"'\", '“':'\"', '”':'\"',\"΄\":\"'\", \"´\":\"'\", \"`\":\"'\", \"…\":\".\", \"„\":'\"', '–':'-', '–':'-', '–':'-', '—':'-', \"＇\":\"'\"}");// NOLINT
+  SetCharLkps();
 }
 
 
+// A class used in place of a regex whose match 0 is copied out must have
+// its capture group
+static void SetConsumeClass(const std::string &rgx, TxpCharClass* cls) {
+  if (!cls->Parse(rgx) || !cls->Grouped()) *cls = TxpCharClass();
+}
+
 bool TxpTrules::Parse(const std::string &tpdb) {
-  TxpPcre pcre_funcs;
   const pcre* rgx;
   bool r;
   r = TxpXmlData::Parse(tpdb);
   if (r) {
     rgx = GetRgx("whitespace");
-    if (rgx) rgxwspace_ = rgx;
+    if (rgx) {
+      rgxwspace_ = rgx;
+      SetConsumeClass(rgxsrcs_["whitespace"], &wspace_class_);
+    }
     rgx = GetRgx("punctuation");
-    if (rgx) rgxpunc_ = rgx;
+    if (rgx) {
+      rgxpunc_ = rgx;
+      SetConsumeClass(rgxsrcs_["punctuation"], &punc_class_);
+    }
     rgx = GetRgx("alpha");
-    if (rgx) rgxalpha_ = rgx;
+    if (rgx) {
+      rgxalpha_ = rgx;
+      alpha_class_.Parse(rgxsrcs_["alpha"]);
+    }
     // default to tokenising on whitespace only
-    tokrgxs_.push_back(pcre_funcs.Compile("^(.*)"));
+    AddTokenRgx("^(.*)");
+    SetCharLkps();
  } else {
     KALDI_WARN << "Error reading normaliser rule file: " << tpdb;
   }
@@ -99,6 +109,42 @@ const std::string* TxpTrules::Lkp(const std::string & name,
   return NULL;
 }
 
+// Tables looked up once per character are found once here
+void TxpTrules::SetCharLkps() {
+  LookupMapMap::iterator itmap;
+  itmap = lkps_.find("utfpunc2ascii");
+  utfpunc2ascii_ = (itmap != lkps_.end()) ? itmap->second : NULL;
+  itmap = lkps_.find("convertillegal");
+  convertillegal_ = (itmap != lkps_.end()) ? itmap->second : NULL;
+  itmap = lkps_.find("downcase");
+  downcase_ = (itmap != lkps_.end()) ? itmap->second : NULL;
+}
+
+// Lookup of a single character in a table which may be missing
+static const std::string* LkpChar(const LookupMap* lkp, const std::string &c) {
+  if (!lkp) return NULL;
+  LookupMap::const_iterator it = lkp->find(c);
+  if (it != lkp->end()) return &(it->second);
+  return NULL;
+}
+
+void TxpTrules::AddRgx(const std::string &name, const std::string &rgx) {
+  TxpPcre pcre;
+  RgxMap::iterator it;
+  // if already present replace
+  it = rgxs_.find(name);
+  if (it != rgxs_.end()) rgxs_.erase(it);
+  rgxs_.insert(RgxItem(name, pcre.Compile(rgx.c_str())));
+  rgxsrcs_[name] = rgx;
+}
+
+void TxpTrules::AddTokenRgx(const std::string &rgx) {
+  TxpPcre pcre;
+  tokrgxs_.push_back(pcre.Compile(rgx.c_str()));
+  tokclasses_.push_back(TxpCharClass());
+  SetConsumeClass(rgx, &tokclasses_.back());
+}
+
 const pcre* TxpTrules::GetRgx(const std::string & name) {
   RgxMap::iterator it;
   it = rgxs_.find(name);
@@ -114,11 +160,20 @@ const char* TxpTrules::ConsumeWhitespaceToken(const char* input,
                                               std::string* wspace) {
   TxpPcre pcre;
   TxpUtf8 utf8;
-  int32 clen;
+  int32 clen, wlen;
   const char *p, *w;
+  wspace->clear();
+  token->clear();
+  if (wspace_class_.Valid()) {
+    // scan to the first whitespace then copy the token and whitespace spans
+    for (p = input; (wlen = wspace_class_.Match(p)) < 0 && *p;
+         p += utf8.Clen(p)) {}
+    token->assign(input, p - input);
+    if (wlen < 0) return p;
+    wspace->assign(p, wlen);
+    return p + wlen;
+  }
   // Check for initial whitespace
-  *wspace = "";
-  *token = "";
   w = pcre.Consume(rgxwspace_, input);
   if (w) {
     pcre.SetMatch(0, wspace);
@@ -144,13 +199,15 @@ void TxpTrules::ReplaceUtf8Punc(const std::string & tkin,
                                 std::string* tkout) {
   const char* p;
   const std::string* r;
+  std::string c;
   TxpUtf8 utf8;
   int32 clen;
   p = tkin.c_str();
-  *tkout = "";
+  tkout->clear();
   while (*p) {
     clen = utf8.Clen(p);
-    r = Lkp(std::string("utfpunc2ascii"), std::string(p, clen));
+    c.assign(p, clen);
+    r = LkpChar(utfpunc2ascii_, c);
     if (r)
       tkout->append(*r);
     else
@@ -163,6 +220,13 @@ const char* TxpTrules::ConsumePunc(const char* input,
                                    std::string* punc) {
   TxpPcre pcre;
   const char* p;
+  int32 len;
+  if (punc_class_.Valid()) {
+    len = punc_class_.Match(input);
+    if (len < 0) return NULL;
+    punc->assign(input, len);
+    return input + len;
+  }
   p = pcre.Consume(rgxpunc_, input);
   if (p) {
     pcre.SetMatch(0, punc);
@@ -177,15 +241,22 @@ const char* TxpTrules::ConsumeToken(const char* input,
   TxpPcre pcre;
   const char* p;
   TxpUtf8 utf8;
-  int32 clen;
-  RgxVector::iterator it;
+  int32 clen, len;
   // go through token regexes until we match
-  for(it = tokrgxs_.begin(); it != tokrgxs_.end(); it++) {
-    p = pcre.Consume(*(it), input);
+  for (size_t i = 0; i < tokrgxs_.size(); i++) {
+    if (tokclasses_[i].Valid()) {
+      len = tokclasses_[i].Match(input);
+      if (len >= 0) {
+        token->assign(input, len);
+        return input + len;
+      }
+      continue;
+    }
+    p = pcre.Consume(tokrgxs_[i], input);
     if (p) {
       pcre.SetMatch(0, token);
       return p;
-    } 
+    }
   }
   // otherwise throw out the first character as a token
   clen = utf8.Clen(input);
@@ -208,18 +279,19 @@ void TxpTrules::NormCaseCharacter(std::string* norm,
   while (*p) {
     alpha = false;
     clen = utf8.Clen(p);
-    c = std::string(p, clen);
-    if (pcre.Execute(GetRgx(std::string("alpha")), c)) {
+    c.assign(p, clen);
+    if (alpha_class_.Valid() ? alpha_class_.Match(p, clen) >= 0 :
+        pcre.Execute(GetRgx(std::string("alpha")), c)) {
       alpha = true;
       caseinfo.lowercase = true;
     }
-    r = Lkp(std::string("convertillegal"), c);
+    r = LkpChar(convertillegal_, c);
     if (r) {
       c = *r;
       caseinfo.foreign = true;
       alpha = true;
     }
-    r = Lkp(std::string("downcase"), c);
+    r = LkpChar(downcase_, c);
     if (r) {
       caseinfo.uppercase = true;
       alpha = true;
@@ -240,6 +312,8 @@ void TxpTrules::NormCaseCharacter(std::string* norm,
 
 bool TxpTrules::IsAlpha(const std::string &token) {
   TxpPcre pcre;
+  if (alpha_class_.Valid())
+    return alpha_class_.Match(token.c_str(), token.length()) >= 0;
   if (pcre.Execute(rgxalpha_, token.c_str())) return true;
   return false;
 }
@@ -262,27 +336,14 @@ void TxpTrules::StartCData() {
 
 // TODO(MPA): Add checking (i.e. max match on regex, duplications, empty keys)
 void TxpTrules::EndCData() {
-  const char* error;
-  int erroffset;
   incdata_ = false;
-  RgxMap::iterator it;
   if (elementtype_ == "lookup") {
     MakeLkp(&lkps_, elementname_, cdata_buffer_);
   } else if (elementtype_ == "regex") {
     if (elementname_.find("token", 0) == 0) {
-      tokrgxs_.push_back(pcre_compile(cdata_buffer_.c_str(),
-                                      PCRE_UTF8, &error,
-                                      &erroffset, NULL));
+      AddTokenRgx(cdata_buffer_);
     } else {
-      // if already present replace
-      it = rgxs_.find(elementname_);
-      if (it != rgxs_.end()) {
-        pcre_free(const_cast<pcre *>(it->second));
-        rgxs_.erase(it);
-      }
-      rgxs_.insert(RgxItem(elementname_, pcre_compile(cdata_buffer_.c_str(),
-                                                      PCRE_UTF8, &error,
-                                                      &erroffset, NULL)));
+      AddRgx(elementname_, cdata_buffer_);
     }
   }
 }
@@ -25,9 +25,11 @@
 #include <map>
 #include <utility>
 #include <string>
+#include <vector>
 #include "base/kaldi-common.h"
 #include "idlaktxp/idlak-common.h"
 #include "idlaktxp/txpxmldata.h"
+#include "idlaktxp/txpcharclass.h"
 #include "idlaktxp/txppcre.h"
 #include "idlaktxp/txputf8.h"
 
@@ -114,6 +116,12 @@ class TxpTrules: public TxpXmlData {
   int32 MakeLkp(LookupMapMap *lkps,
                 const std::string &name,
                 const std::string &cdata);
+  /// Compiles a regex and adds (or replaces) it in rgxs_
+  void AddRgx(const std::string &name, const std::string &rgx);
+  /// Compiles a token regex and adds it to tokrgxs_
+  void AddTokenRgx(const std::string &rgx);
+  /// Points the per character lookups at their tables in lkps_
+  void SetCharLkps();
   /// Parser status currently in cdata element
   bool incdata_;
   /// Buffer for cdata data
@@ -141,6 +149,25 @@ class TxpTrules: public TxpXmlData {
   RgxMap rgxs_;
   /// List of valid tokens for tokeinisation
   RgxVector tokrgxs_;
+  /// Source of each regex in rgxs_
+  LookupMap rgxsrcs_;
+  // Character class tables for the tokenisation regexs which are a single
+  // class, these are used in place of pcre when valid
+  /// Table for rgxwspace_
+  TxpCharClass wspace_class_;
+  /// Table for rgxpunc_
+  TxpCharClass punc_class_;
+  /// Table for rgxalpha_
+  TxpCharClass alpha_class_;
+  /// Table for each of tokrgxs_
+  std::vector<TxpCharClass> tokclasses_;
+  // Lookups used for every character of a token
+  /// Lookup table utfpunc2ascii
+  const LookupMap* utfpunc2ascii_;
+  /// Lookup table convertillegal
+  const LookupMap* convertillegal_;
+  /// Lookup table downcase
+  const LookupMap* downcase_;
   /// Records type of ellement during expat parse
   std::string elementtype_;
   /// Records element name during expat parse
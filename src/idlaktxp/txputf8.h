@@ -38,6 +38,19 @@ class TxpUtf8 {
     return trailingBytesForUTF8_[static_cast<unsigned int>(
         static_cast<unsigned const char>(input[0]))] + 1;
   }
+  /// Return the unicode code point of the next utf8 character, a character
+  /// cut short by the end of the string decodes as its lead byte
+  uint32 Codepoint(const char* input) {
+    static const uint32 kLeadMask[6] = {0x7f, 0x1f, 0x0f, 0x07, 0x03, 0x01};
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(input);
+    int32 trail = trailingBytesForUTF8_[p[0]];
+    uint32 cp = p[0] & kLeadMask[trail];
+    for (int32 i = 1; i <= trail; i++) {
+      if (!p[i]) return p[0];
+      cp = (cp << 6) | (p[i] & 0x3f);
+    }
+    return cp;
+  }
 
  private:
   /// Lookup table for determining number of trailing characters
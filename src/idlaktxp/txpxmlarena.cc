@@ -0,0 +1,129 @@
+// idlaktxp/txpxmlarena.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <pugixml.hpp>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include "idlaktxp/txpxmlarena.h"
+
+namespace kaldi {
+
+// Blocks are sized in powers of two from 256 bytes, pugixml pages (32k plus
+// a header) and parse buffers of most inputs fall in the cached classes
+static const int32 kTxpXmlArenaMinShift = 8;
+static const int32 kTxpXmlArenaClasses = 10;
+// the most memory a thread keeps cached
+static const size_t kTxpXmlArenaMaxCached = 16 * 1024 * 1024;
+
+// Stored in front of each block, keeps the block aligned as malloc does
+union TxpXmlArenaHeader {
+  int32 cls;
+  long double align;
+};
+
+struct TxpXmlArenaCache {
+  std::vector<void*> blocks[kTxpXmlArenaClasses];
+  size_t cached;
+  TxpXmlArenaCache();
+  ~TxpXmlArenaCache();
+  void Trim();
+};
+
+// false once the cache of this thread has been destroyed, pugixml memory
+// freed after that (e.g. by static documents) goes straight back to free
+static thread_local bool txp_xml_arena_alive = false;
+static thread_local TxpXmlArenaCache txp_xml_arena_cache;
+
+TxpXmlArenaCache::TxpXmlArenaCache() : cached(0) {
+  txp_xml_arena_alive = true;
+}
+
+TxpXmlArenaCache::~TxpXmlArenaCache() {
+  Trim();
+  txp_xml_arena_alive = false;
+}
+
+void TxpXmlArenaCache::Trim() {
+  for (int32 c = 0; c < kTxpXmlArenaClasses; c++) {
+    for (size_t i = 0; i < blocks[c].size(); i++) free(blocks[c][i]);
+    blocks[c].clear();
+  }
+  cached = 0;
+}
+
+static size_t TxpXmlArenaClassSize(int32 cls) {
+  return static_cast<size_t>(1) << (cls + kTxpXmlArenaMinShift);
+}
+
+static void* TxpXmlArenaAllocate(size_t size) {
+  TxpXmlArenaHeader* block;
+  int32 cls = 0;
+  size += sizeof(TxpXmlArenaHeader);
+  while (cls < kTxpXmlArenaClasses && TxpXmlArenaClassSize(cls) < size) cls++;
+  if (cls == kTxpXmlArenaClasses) {
+    // too big to cache
+    block = static_cast<TxpXmlArenaHeader*>(malloc(size));
+    if (!block) return NULL;
+    block->cls = -1;
+    return block + 1;
+  }
+  // referencing the cache constructs it on first use in a thread
+  TxpXmlArenaCache &cache = txp_xml_arena_cache;
+  if (txp_xml_arena_alive && !cache.blocks[cls].empty()) {
+    block = static_cast<TxpXmlArenaHeader*>(cache.blocks[cls].back());
+    cache.blocks[cls].pop_back();
+    cache.cached -= TxpXmlArenaClassSize(cls);
+  } else {
+    block = static_cast<TxpXmlArenaHeader*>(
+        malloc(TxpXmlArenaClassSize(cls)));
+    if (!block) return NULL;
+    block->cls = cls;
+  }
+  return block + 1;
+}
+
+static void TxpXmlArenaDeallocate(void* ptr) {
+  if (!ptr) return;
+  TxpXmlArenaHeader* block = static_cast<TxpXmlArenaHeader*>(ptr) - 1;
+  int32 cls = block->cls;
+  TxpXmlArenaCache &cache = txp_xml_arena_cache;
+  if (cls < 0 || !txp_xml_arena_alive ||
+      cache.cached + TxpXmlArenaClassSize(cls) > kTxpXmlArenaMaxCached) {
+    free(block);
+    return;
+  }
+  cache.blocks[cls].push_back(block);
+  cache.cached += TxpXmlArenaClassSize(cls);
+}
+
+static std::once_flag txp_xml_arena_once;
+
+void TxpXmlArenaInstall() {
+  std::call_once(txp_xml_arena_once, []() {
+      pugi::set_memory_management_functions(TxpXmlArenaAllocate,
+                                            TxpXmlArenaDeallocate);
+    });
+}
+
+void TxpXmlArenaTrim() {
+  TxpXmlArenaCache &cache = txp_xml_arena_cache;
+  if (txp_xml_arena_alive) cache.Trim();
+}
+
+}  // namespace kaldi
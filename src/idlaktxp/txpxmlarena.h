@@ -0,0 +1,43 @@
+// idlaktxp/txpxmlarena.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPXMLARENA_H_
+#define KALDI_IDLAKTXP_TXPXMLARENA_H_
+
+// This file defines a page cache used as the pugixml allocator so that the
+// memory of a finished document is reused by the next one
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// Set the pugixml allocation functions to use the arena. Freed pugixml
+/// pages and buffers are kept in a cache for the thread that frees them and
+/// handed out again by the next allocation of the same size class on that
+/// thread, so a worker processing one document after another reaches a
+/// steady state without calls to malloc and free.
+/// Must be called before any pugixml document is created, later calls do
+/// nothing.
+void TxpXmlArenaInstall();
+
+/// Free the memory held in the cache of the calling thread
+void TxpXmlArenaTrim();
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPXMLARENA_H_
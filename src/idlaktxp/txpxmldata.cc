@@ -18,6 +18,8 @@
 
 #include "idlaktxp/txpxmldata.h"
 #include <math.h>
+#include <fstream>
+#include <vector>
 
 namespace kaldi {
 
@@ -205,6 +207,33 @@ bool TxpXmlData::Parse(const std::string &tpdb, const std::string &fname) {
   return true;
 }
 
+bool TxpXmlData::FindFile(const std::string &tpdb, const std::string &fname,
+                          std::string *pathname) {
+  const char *lang = GetOptValue("lang"), *region = GetOptValue("region"),
+      *acc = GetOptValue("acc"), *spk = GetOptValue("spk");
+  std::vector<std::string> dirs;
+  std::ifstream test;
+  test.open((tpdb + "/idlak-data-flat").c_str());
+  if (test.is_open()) {
+    dirs.push_back(tpdb);
+  } else {
+    if (!lang) return false;
+    if (spk && *spk && acc)
+      dirs.push_back(tpdb + "/" + lang + "/" + acc + "/" + spk);
+    if (acc && *acc) dirs.push_back(tpdb + "/" + lang + "/" + acc);
+    if (region && *region) dirs.push_back(tpdb + "/" + lang + "/" + region);
+    dirs.push_back(tpdb + "/" + lang);
+  }
+  for (size_t i = 0; i < dirs.size(); i++) {
+    std::ifstream in((dirs[i] + "/" + fname).c_str());
+    if (in.is_open()) {
+      *pathname = dirs[i] + "/" + fname;
+      return true;
+    }
+  }
+  return false;
+}
+
 int32 TxpXmlData::SetAttribute(const char* name, const char** atts,
                          std::string* val) {
   int32 i = 0;
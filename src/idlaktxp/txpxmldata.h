@@ -77,6 +77,11 @@ class TxpXmlData {
   /// the system first searches spk then acc then region then lang directories
   /// unless marked as an idlak-data-flat with a dummy file of that name
   bool Parse(const std::string &tpdb, const std::string &fname);
+  /// Find a file belonging to the object without parsing it, searching the
+  /// same spk, acc, region then lang directories (or the flat directory).
+  /// Returns false if the file is not found.
+  bool FindFile(const std::string &tpdb, const std::string &fname,
+                std::string *pathname);
   int GetCurrentLineNumber() {return XML_GetCurrentLineNumber(parser_);}
   /// Utility to set a named attribute from an expat array of attribute
   /// key value pairs
@@ -0,0 +1,144 @@
+// idlaktxp/txpxmlholder.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cctype>
+#include <cstring>
+#include "base/io-funcs.h"
+#include "idlaktxp/txpxmlholder.h"
+
+namespace kaldi {
+
+// Append characters to xml until it ends with the terminator, false if the
+// input ends first
+static bool ReadUntil(std::istream &is, const char* terminator,
+                      std::string* xml) {
+  size_t len = strlen(terminator);
+  int c;
+  while ((c = is.get()) != EOF) {
+    xml->push_back(static_cast<char>(c));
+    if (xml->size() >= len &&
+        !xml->compare(xml->size() - len, len, terminator))
+      return true;
+  }
+  return false;
+}
+
+// kinds of markup
+enum {kTxpXmlOther, kTxpXmlStart, kTxpXmlEnd, kTxpXmlEmpty};
+
+// Read the markup after a '<' into xml and set its kind
+static bool ReadMarkup(std::istream &is, int32* kind, std::string* xml) {
+  int c = is.get();
+  if (c == EOF) return false;
+  xml->push_back(static_cast<char>(c));
+  *kind = kTxpXmlOther;
+  if (c == '?') return ReadUntil(is, "?>", xml);
+  if (c == '!') {
+    if (is.peek() == '-') return ReadUntil(is, "-->", xml);
+    if (is.peek() == '[') return ReadUntil(is, "]]>", xml);
+    return ReadUntil(is, ">", xml);
+  }
+  bool end = (c == '/');
+  // a '>' in a quoted attribute value does not end the tag
+  char quote = 0, last = 0;
+  while ((c = is.get()) != EOF) {
+    xml->push_back(static_cast<char>(c));
+    if (quote) {
+      if (c == quote) quote = 0;
+    } else if (c == '"' || c == '\'') {
+      quote = static_cast<char>(c);
+    } else if (c == '>') {
+      if (end) *kind = kTxpXmlEnd;
+      else if (last == '/') *kind = kTxpXmlEmpty;
+      else *kind = kTxpXmlStart;
+      return true;
+    }
+    last = static_cast<char>(c);
+  }
+  return false;
+}
+
+bool TxpXmlHolder::Write(std::ostream &os, bool binary, const T &t) {
+  InitKaldiOutputStream(os, binary);
+  if (binary) {
+    WriteBasicType(os, true, static_cast<int64>(t.size()));
+    os.write(t.data(), t.size());
+  } else {
+    os << t;
+    if (t.empty() || t[t.size() - 1] != '\n') os << '\n';
+  }
+  if (!os.good()) {
+    KALDI_WARN << "Error writing XML document to stream";
+    return false;
+  }
+  return true;
+}
+
+bool TxpXmlHolder::Read(std::istream &is) {
+  t_.clear();
+  bool binary;
+  if (!InitKaldiInputStream(is, &binary)) {
+    KALDI_WARN << "Reading XML document, failed to initialise stream";
+    return false;
+  }
+  if (binary) {
+    try {
+      int64 size;
+      ReadBasicType(is, true, &size);
+      if (size < 0) KALDI_ERR << "Bad XML document size " << size;
+      t_.resize(size);
+      if (size) is.read(&t_[0], size);
+    } catch (const std::exception &e) {
+      KALDI_WARN << "Exception caught reading XML document. " << e.what();
+      return false;
+    }
+    if (!is.good()) {
+      KALDI_WARN << "Reading XML document, input ended early";
+      return false;
+    }
+    return true;
+  }
+  // text: the prolog and the root element, then the rest of its line
+  int32 depth = 0;
+  bool root = false;
+  int c;
+  while (isspace(c = is.peek())) is.get();
+  while (!root || depth > 0) {
+    c = is.get();
+    if (c == EOF) {
+      KALDI_WARN << "Reading XML document, input ended before the end of "
+                 << "the root element";
+      return false;
+    }
+    t_.push_back(static_cast<char>(c));
+    if (c != '<') continue;
+    int32 kind;
+    if (!ReadMarkup(is, &kind, &t_)) {
+      KALDI_WARN << "Reading XML document, input ended inside markup";
+      return false;
+    }
+    if (kind == kTxpXmlStart) depth++;
+    else if (kind == kTxpXmlEnd) depth--;
+    if (kind == kTxpXmlStart || kind == kTxpXmlEmpty) root = true;
+  }
+  while ((c = is.peek()) != EOF && c != '\n' && isspace(c)) is.get();
+  if (is.peek() == '\n') is.get();
+  return true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,76 @@
+// idlaktxp/txpxmlholder.h
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_IDLAKTXP_TXPXMLHOLDER_H_
+#define KALDI_IDLAKTXP_TXPXMLHOLDER_H_
+
+// This file defines a Kaldi table holder for XML documents, so that the txp
+// tools can read and write tables of documents such as scp:text.scp or
+// ark:out.ark
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include "base/kaldi-common.h"
+#include "util/kaldi-table.h"
+
+namespace kaldi {
+
+/// Holds an XML document as its text.
+///
+/// In binary mode the document is written after the Kaldi binary header as
+/// its length and bytes. In text mode the document is written as it is and
+/// read up to the end of its root element, so an scp entry can be any XML
+/// file and documents in a text archive may span lines.
+class TxpXmlHolder {
+ public:
+  typedef std::string T;
+
+  TxpXmlHolder() {}
+
+  static bool Write(std::ostream &os, bool binary, const T &t);
+
+  void Clear() { t_.clear(); }
+
+  bool Read(std::istream &is);
+
+  static bool IsReadInBinary() { return true; }
+
+  T &Value() { return t_; }
+
+  void Swap(TxpXmlHolder *other) { t_.swap(other->t_); }
+
+  bool ExtractRange(const TxpXmlHolder &other, const std::string &range) {
+    KALDI_ERR << "ExtractRange is not defined for this type of holder.";
+    return false;
+  }
+
+  ~TxpXmlHolder() {}
+
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TxpXmlHolder);
+  T t_;
+};
+
+typedef TableWriter<TxpXmlHolder> TxpXmlWriter;
+typedef SequentialTableReader<TxpXmlHolder> SequentialTxpXmlReader;
+typedef RandomAccessTableReader<TxpXmlHolder> RandomAccessTxpXmlReader;
+
+}  // namespace kaldi
+
+#endif  // KALDI_IDLAKTXP_TXPXMLHOLDER_H_
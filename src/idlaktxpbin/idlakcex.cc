@@ -17,9 +17,101 @@
 //
 
 #include <pugixml.hpp>
+#include <mutex>
+#include <sstream>
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "idlaktxp/idlaktxp.h"
+#include "idlaktxp/txpxmlholder.h"
+
+// Cex modules not currently in use by a worker thread, as the module sets of
+// idlaktxp. The first is created up front so that errors loading the tpdb
+// are reported from the main thread
+class TxpCexPool {
+ public:
+  explicit TxpCexPool(const kaldi::TxpParseOptions &po) : po_(po) {
+    Release(Acquire());
+  }
+  ~TxpCexPool() {
+    for (size_t i = 0; i < cexs_.size(); i++) delete cexs_[i];
+  }
+  kaldi::TxpCex* Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!cexs_.empty()) {
+        kaldi::TxpCex* cx = cexs_.back();
+        cexs_.pop_back();
+        return cx;
+      }
+    }
+    kaldi::TxpCex* cx = new kaldi::TxpCex;
+    cx->Init(po_);
+    return cx;
+  }
+  void Release(kaldi::TxpCex* cx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cexs_.push_back(cx);
+  }
+
+ private:
+  const kaldi::TxpParseOptions &po_;
+  std::vector<kaldi::TxpCex*> cexs_;
+  std::mutex mutex_;
+};
+
+// Table output state, only used from task destructors which the
+// TaskSequencer calls one at a time in input order
+struct TxpTableOutput {
+  kaldi::TxpXmlWriter* writer;
+  bool pretty;
+  kaldi::int32 num_done;
+  kaldi::int32 num_err;
+};
+
+// Processes one document of a table, the output is written in the destructor
+class TxpCexTask {
+ public:
+  TxpCexTask(const std::string &key, const std::string &xml,
+             TxpCexPool* pool, TxpTableOutput* out)
+      : key_(key), xml_(xml), pool_(pool), out_(out), ok_(false) {}
+  void operator() () {
+    pugi::xml_document doc;
+    pugi::xml_parse_result r = doc.load_buffer(xml_.data(), xml_.size(),
+                                               pugi::encoding_utf8);
+    if (!r) {
+      KALDI_WARN << "PugiXML Parse Error in " << key_ << ": "
+                 << r.description() << " Error offset: " << r.offset;
+      return;
+    }
+    kaldi::TxpCex* cx = pool_->Acquire();
+    cx->Process(&doc);
+    pool_->Release(cx);
+    std::ostringstream os;
+    if (!out_->pretty)
+      doc.save(os, "", pugi::format_raw);
+    else
+      doc.save(os, "\t");
+    xml_ = os.str();
+    ok_ = true;
+  }
+  ~TxpCexTask() {
+    if (ok_) {
+      out_->writer->Write(key_, xml_);
+      out_->num_done++;
+    } else {
+      out_->num_err++;
+    }
+  }
+
+ private:
+  std::string key_;
+  // the input, replaced by the output once processed
+  std::string xml_;
+  TxpCexPool* pool_;
+  TxpTableOutput* out_;
+  bool ok_;
+};
 
 /// Takes output from idalktxp adds structure for pauses
 /// and creates full context model names for each phone
@@ -31,7 +123,9 @@ int main(int argc, char *argv[]) {
       "Tokenise utf8 input xml\n"
       "Usage:  idlakcex [options] xml_input xml_output\n"
       "e.g.: ./idlakcex --pretty --tpdb=../../idlak-data/en/ga ../idlaktxp/test_data/mod-syllabify-out002.xml output.xml\n" //NOLINT
-      "e.g.: cat  ../idlaktxp/test_data/mod-syllabify-out002.xml output.xml | idlakcex --pretty --tpdb=../../idlak-data/en/ga - - > output.xml\n"; //NOLINT
+      "e.g.: cat  ../idlaktxp/test_data/mod-syllabify-out002.xml output.xml | idlakcex --pretty --tpdb=../../idlak-data/en/ga - - > output.xml\n" //NOLINT
+      "or:  idlakcex [options] <xml-rspecifier> <xml-wspecifier>\n"
+      "e.g.: ./idlakcex --num-threads=8 --tpdb=../../idlak-data/en/ga ark:txp.ark ark,t:cex.ark\n"; //NOLINT
   // input output variables
   std::string filein;
   std::string fileout;
@@ -41,12 +135,15 @@ int main(int argc, char *argv[]) {
   std::ofstream fout;
   // defaults to non-pretty XML output
   bool pretty = false;
+  kaldi::TaskSequencerConfig sequencer_config;
 
   try {
     kaldi::TxpParseOptions po(usage);
     po.SetTpdb(tpdb);
     po.Register("pretty", &pretty,
                 "Output XML with tabbing and line breaks to make it readable");
+    // with tables, the number of documents processed at the same time
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
     // Must have input and output filenames for XML
     if (po.NumArgs() != 2) {
@@ -55,6 +152,27 @@ int main(int argc, char *argv[]) {
     }
     filein = po.GetArg(1);
     fileout = po.GetArg(2);
+    if (kaldi::ClassifyRspecifier(filein, NULL, NULL) !=
+        kaldi::kNoRspecifier) {
+      // a table of documents, the tpdb is loaded once for all of them
+      if (kaldi::ClassifyWspecifier(fileout, NULL, NULL, NULL) ==
+          kaldi::kNoWspecifier)
+        KALDI_ERR << "Output must be a wspecifier when the input is an "
+                  << "rspecifier, got " << fileout;
+      kaldi::SequentialTxpXmlReader reader(filein);
+      kaldi::TxpXmlWriter writer(fileout);
+      TxpCexPool pool(po);
+      TxpTableOutput out = {&writer, pretty, 0, 0};
+      {
+        kaldi::TaskSequencer<TxpCexTask> sequencer(sequencer_config);
+        for (; !reader.Done(); reader.Next())
+          sequencer.Run(new TxpCexTask(reader.Key(), reader.Value(), &pool,
+                                       &out));
+      }
+      KALDI_LOG << "Processed " << out.num_done << " documents, "
+                << out.num_err << " failed.";
+      return (out.num_done != 0 ? 0 : 1);
+    }
     // Set up input/output streams
     bool binary;
     kaldi::Input ki(filein, &binary);
@@ -0,0 +1,63 @@
+// idlaktxpbin/idlaklexcompile.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "idlaktxp/txplexicon.h"
+#include "idlaktxp/txpparse-options.h"
+
+/// Compiles an xml lexicon into the binary image loaded by TxpLexicon.
+/// Put the output next to the xml lexicon as lexicon-<name>.bin for the
+/// voice to use it.
+int main(int argc, char *argv[]) {
+  const char *usage =
+      "Compile an xml lexicon into a memory mappable binary image\n"
+      "Usage:  idlaklexcompile --tpdb=<idlak-data-root> --general-lang=<language iso code> [options] binary_output\n"
+      "e.g.: ./idlaklexcompile --tpdb=../../idlak-data --general-lang=en --general-acc=ga ../../idlak-data/en/ga/lexicon-default.bin\n" //NOLINT
+      "The lexicon name defaults to the arch option of the pronounce module"; //NOLINT
+  std::string name;
+
+  try {
+    kaldi::TxpParseOptions po(usage);
+    po.Register("lexicon-name", &name,
+                "Name of the lexicon (lexicon-<name>.xml) if not the "
+                "pronounce module arch");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 1) {
+      po.PrintUsage();
+      exit(1);
+    }
+    std::string fileout = po.GetArg(1);
+    if (name.empty()) {
+      const char *arch = po.GetValue("pronounce", "arch");
+      name = arch ? arch : "default";
+    }
+    kaldi::TxpLexicon lex;
+    lex.Init(po, name);
+    if (!lex.ParseXml(po.GetTpdb()))
+      KALDI_ERR << "Failed to parse lexicon " << name;
+    kaldi::Output ko(fileout, true, false);
+    if (!lex.WriteBinary(ko.Stream()))
+      KALDI_ERR << "Failed to write binary lexicon to " << fileout;
+    ko.Close();
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -0,0 +1,503 @@
+// idlaktxpbin/idlakltstrain.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+
+// Trains the letter to sound cart trees read by TxpLts (ccart-<name>.xml)
+// from a Phonetisaurus alignment of the lexicon. This does what
+// idlak-misc/cart_lts did with phonet2cart.py, wagon and carttree2xml.py:
+// one tree per letter predicting its phone (or '_' joined phones, or 0) from
+// the letters around it, and a stress tree (letter 0) predicting the stress
+// of the last vowel of each letter's phones.
+
+namespace kaldi {
+
+// Context values other than letter ids, as offsets from the number of letters
+enum {kLtsPadBefore = 0, kLtsPadAfter = 1, kLtsNumPads = 2};
+
+/// Training examples of one tree, contexts are letter ids or pads
+struct LtsTreeData {
+  std::string letter;
+  std::vector<int32> contexts;  // context_size values per example
+  std::vector<int32> targets;   // class of each example
+  std::vector<std::string> classes;
+  std::map<std::string, int32> class_ids;
+  int32 AddClass(const std::string &c) {
+    std::map<std::string, int32>::iterator it = class_ids.find(c);
+    if (it != class_ids.end()) return it->second;
+    class_ids[c] = classes.size();
+    classes.push_back(c);
+    return classes.size() - 1;
+  }
+};
+
+/// All the trees' examples with the letters interned
+struct LtsData {
+  int32 width;  // letters of context either side
+  std::vector<std::string> letters;
+  std::map<std::string, int32> letter_ids;
+  std::map<std::string, LtsTreeData> trees;
+  int32 LetterId(const std::string &l) {
+    std::map<std::string, int32>::iterator it = letter_ids.find(l);
+    if (it != letter_ids.end()) return it->second;
+    letter_ids[l] = letters.size();
+    letters.push_back(l);
+    return letters.size() - 1;
+  }
+};
+
+static void SplitString(const std::string &s, char delim,
+                        std::vector<std::string> *out) {
+  out->clear();
+  size_t start = 0, pos;
+  while ((pos = s.find(delim, start)) != std::string::npos) {
+    out->push_back(s.substr(start, pos - start));
+    start = pos + 1;
+  }
+  out->push_back(s.substr(start));
+}
+
+// Adds the examples of one alignment line, as phonet2cart.py did: groups of
+// '|' separated letters '}' '|' separated phones, '_' for no letter or no
+// phone. Words with an apostrophe are skipped.
+static void AddAlignment(const std::string &line, LtsData *data) {
+  std::vector<std::string> groups, letters, parts, graphemes, phones;
+  SplitStringToVector(line, " \t\r", true, &groups);
+  for (size_t g = 0; g < groups.size(); g++) {
+    SplitString(groups[g], '}', &parts);
+    if (parts.size() != 2) {
+      KALDI_WARN << "Bad alignment group " << groups[g] << " in: " << line;
+      return;
+    }
+    if (parts[0] == "_") continue;
+    SplitString(parts[0], '|', &graphemes);
+    for (size_t i = 0; i < graphemes.size(); i++) {
+      if (graphemes[i] == "'") return;
+      letters.push_back(graphemes[i]);
+    }
+  }
+  int32 w = data->width, num_letters = letters.size(), offset = 0;
+  std::vector<int32> ids(num_letters);
+  for (int32 i = 0; i < num_letters; i++) ids[i] = data->LetterId(letters[i]);
+  LtsTreeData &stress_tree = data->trees["0"];
+  stress_tree.letter = "0";
+  for (size_t g = 0; g < groups.size(); g++) {
+    SplitString(groups[g], '}', &parts);
+    if (parts[0] == "_") continue;
+    SplitString(parts[0], '|', &graphemes);
+    SplitString(parts[1] == "_" ? std::string("0") : parts[1], '|', &phones);
+    // the stress of the last vowel is predicted separately
+    std::string stress("0");
+    bool vowel = false;
+    for (int32 p = phones.size() - 1; p >= 0 && !vowel; p--) {
+      if (phones[p] == "0") continue;
+      for (const char *level = "012"; *level && !vowel; level++) {
+        if (phones[p].find(*level) != std::string::npos) {
+          vowel = true;
+          std::replace(phones[p].begin(), phones[p].end(), *level, '0');
+          stress = std::string(1, *level);
+        }
+      }
+    }
+    std::string output = phones[0];
+    for (size_t p = 1; p < phones.size(); p++) output += "_" + phones[p];
+    for (size_t i = 0; i < graphemes.size(); i++, offset++) {
+      LtsTreeData &tree = data->trees[graphemes[i]];
+      tree.letter = graphemes[i];
+      // pads are stored as -1 (before) and -2 (after) until the number of
+      // letters is known
+      for (int32 c = offset - w; c <= offset + w; c++) {
+        int32 v = c < 0 ? -1 : (c >= num_letters ? -2 : ids[c]);
+        tree.contexts.push_back(v);
+        if (vowel) stress_tree.contexts.push_back(v);
+      }
+      tree.targets.push_back(
+          tree.AddClass(i + 1 < graphemes.size() ? std::string("0")
+                                                 : output));
+      if (vowel) stress_tree.targets.push_back(stress_tree.AddClass(stress));
+    }
+  }
+}
+
+/// A node of a tree being grown
+struct LtsTrainNode {
+  int32 pos;     // context offset of the question
+  int32 value;   // letter id, or kLtsBoundary
+  int32 yes, no;
+  int32 cls;     // class of a leaf, -1 otherwise
+};
+
+static const int32 kLtsBoundary = -2;
+
+// sum of c log c, for the entropy of a split
+static double CLogC(const std::vector<int32> &counts, int32 begin,
+                    int32 end) {
+  double r = 0.0;
+  for (int32 i = begin; i < end; i++)
+    if (counts[i] > 0) r += counts[i] * std::log(static_cast<double>(counts[i]));
+  return r;
+}
+
+static double NLogN(double n) { return n > 0 ? n * std::log(n) : 0.0; }
+
+/// Best question about one context position
+struct LtsQuestion {
+  double score;  // total entropy times count of the two sides
+  int32 pos, value;
+};
+
+/// Grows the tree of one letter
+class LtsTreeGrower {
+ public:
+  LtsTreeGrower(const LtsTreeData &data, int32 width, int32 num_letters,
+                int32 min_leaf)
+      : data_(data), width_(width), context_size_(2 * width + 1),
+        num_letters_(num_letters), min_leaf_(min_leaf) {}
+
+  void Grow() {
+    std::vector<int32> examples(data_.targets.size());
+    for (size_t i = 0; i < examples.size(); i++) examples[i] = i;
+    Grow(&examples[0], &examples[0] + examples.size());
+    std::reverse(nodes_.begin(), nodes_.end());  // root first
+    int32 n = nodes_.size();
+    for (int32 i = 0; i < n; i++) {
+      if (nodes_[i].cls >= 0) continue;
+      nodes_[i].yes = n - 1 - nodes_[i].yes;
+      nodes_[i].no = n - 1 - nodes_[i].no;
+    }
+  }
+
+  // Best question for the examples at positions pos ≡ first mod step
+  void BestQuestions(const int32 *begin, const int32 *end, int32 first,
+                     int32 step, std::vector<LtsQuestion> *best) const;
+
+  const std::vector<LtsTrainNode> &Nodes() const { return nodes_; }
+
+ private:
+  // index of the node grown from the examples, nodes are added children
+  // first
+  int32 Grow(int32 *begin, int32 *end);
+  int32 Value(int32 example, int32 pos) const {
+    int32 v = data_.contexts[example * context_size_ + pos];
+    if (v == -1) return num_letters_ + kLtsPadBefore;
+    if (v == -2) return num_letters_ + kLtsPadAfter;
+    return v;
+  }
+  bool Matches(int32 example, int32 pos, int32 value) const {
+    int32 v = Value(example, pos);
+    // as TxpLts applies it, # matches anything before the end of the word
+    if (value == kLtsBoundary) return v != num_letters_ + kLtsPadAfter;
+    return v == value;
+  }
+
+  const LtsTreeData &data_;
+  int32 width_, context_size_, num_letters_, min_leaf_;
+  std::vector<LtsTrainNode> nodes_;
+};
+
+// Evaluates positions in parallel for the larger nodes
+class LtsQuestionTask: public MultiThreadable {
+ public:
+  LtsQuestionTask(const LtsTreeGrower *grower, const int32 *begin,
+                  const int32 *end, std::vector<LtsQuestion> *best)
+      : grower_(grower), begin_(begin), end_(end), best_(best) {}
+  void operator() () {
+    grower_->BestQuestions(begin_, end_, thread_id_, num_threads_, best_);
+  }
+
+ private:
+  const LtsTreeGrower *grower_;
+  const int32 *begin_, *end_;
+  std::vector<LtsQuestion> *best_;
+};
+
+// nodes with fewer examples are evaluated in the calling thread
+static const int32 kLtsParallelExamples = 5000;
+
+void LtsTreeGrower::BestQuestions(const int32 *begin, const int32 *end,
+                                  int32 first, int32 step,
+                                  std::vector<LtsQuestion> *best) const {
+  int32 num_values = num_letters_ + kLtsNumPads;
+  // classes and values are renumbered to those at this node so the count
+  // table is no bigger than the node
+  std::vector<int32> cls_index(data_.classes.size(), -1), value_index,
+      classes;
+  for (const int32 *e = begin; e != end; ++e) {
+    int32 c = data_.targets[*e];
+    if (cls_index[c] < 0) {
+      cls_index[c] = classes.size();
+      classes.push_back(c);
+    }
+  }
+  int32 nc = classes.size(), n = end - begin;
+  std::vector<int32> total(nc, 0);
+  for (const int32 *e = begin; e != end; ++e)
+    total[cls_index[data_.targets[*e]]]++;
+  std::vector<int32> counts, values, yes(nc);
+  for (int32 pos = first; pos < context_size_; pos += step) {
+    LtsQuestion &q = (*best)[pos];
+    q.score = HUGE_VAL;
+    q.pos = pos;
+    q.value = -1;
+    value_index.assign(num_values, -1);
+    values.clear();
+    counts.clear();
+    for (const int32 *e = begin; e != end; ++e) {
+      int32 v = Value(*e, pos);
+      if (value_index[v] < 0) {
+        value_index[v] = values.size();
+        values.push_back(v);
+        counts.resize(counts.size() + nc, 0);
+      }
+      counts[value_index[v] * nc + cls_index[data_.targets[*e]]]++;
+    }
+    // letter questions, then # which is every value but the padding after
+    int32 nv = values.size();
+    std::vector<int32> order(values);
+    std::sort(order.begin(), order.end());
+    for (int32 k = 0; k <= nv; k++) {
+      int32 value;
+      if (k < nv) {
+        value = order[k];
+        if (value >= num_letters_) continue;
+        const int32 *row = &counts[value_index[value] * nc];
+        for (int32 c = 0; c < nc; c++) yes[c] = row[c];
+      } else {
+        value = kLtsBoundary;
+        int32 after = value_index[num_letters_ + kLtsPadAfter];
+        for (int32 c = 0; c < nc; c++)
+          yes[c] = total[c] - (after >= 0 ? counts[after * nc + c] : 0);
+      }
+      int32 ny = 0;
+      for (int32 c = 0; c < nc; c++) ny += yes[c];
+      if (ny < min_leaf_ || n - ny < min_leaf_) continue;
+      double score = NLogN(ny) - CLogC(yes, 0, nc) + NLogN(n - ny);
+      for (int32 c = 0; c < nc; c++) {
+        int32 no = total[c] - yes[c];
+        if (no > 0) score -= no * std::log(static_cast<double>(no));
+      }
+      if (score < q.score) {
+        q.score = score;
+        q.value = value;
+      }
+    }
+  }
+}
+
+int32 LtsTreeGrower::Grow(int32 *begin, int32 *end) {
+  int32 n = end - begin;
+  std::vector<int32> total(data_.classes.size(), 0);
+  for (int32 *e = begin; e != end; ++e) total[data_.targets[*e]]++;
+  int32 cls = std::max_element(total.begin(), total.end()) - total.begin();
+  double parent = NLogN(n) - CLogC(total, 0, total.size());
+  LtsQuestion q = {HUGE_VAL, 0, -1};
+  if (n >= 2 * min_leaf_ && parent > 1.0e-9) {
+    std::vector<LtsQuestion> best(context_size_);
+    if (n >= kLtsParallelExamples && g_num_threads > 1)
+      RunMultiThreaded(LtsQuestionTask(this, begin, end, &best));
+    else
+      BestQuestions(begin, end, 0, 1, &best);
+    // the first of equal questions, so the tree does not depend on threads
+    for (int32 pos = 0; pos < context_size_; pos++)
+      if (best[pos].value != -1 && best[pos].score < q.score - 1.0e-9)
+        q = best[pos];
+  }
+  LtsTrainNode node = {0, -1, -1, -1, cls};
+  if (q.value == -1 || q.score >= parent - 1.0e-9) {
+    nodes_.push_back(node);
+    return nodes_.size() - 1;
+  }
+  int32 *mid = std::stable_partition(
+      begin, end, [this, &q](int32 e) { return Matches(e, q.pos, q.value); });
+  node.pos = q.pos - width_;
+  node.value = q.value;
+  node.cls = -1;
+  // reversed at the end, so children are added before their parent
+  node.no = Grow(mid, end);
+  node.yes = Grow(begin, mid);
+  nodes_.push_back(node);
+  return nodes_.size() - 1;
+}
+
+static std::string PosName(int32 pos) {
+  std::string name;
+  for (int32 i = 0; i < std::abs(pos); i++) name += pos < 0 ? "p." : "n.";
+  return name + "name";
+}
+
+static std::string XmlEscape(const std::string &s) {
+  std::string r;
+  for (size_t i = 0; i < s.size(); i++) {
+    switch (s[i]) {
+      case '&': r += "&amp;"; break;
+      case '<': r += "&lt;"; break;
+      case '>': r += "&gt;"; break;
+      case '\'': r += "&apos;"; break;
+      case '"': r += "&quot;"; break;
+      default: r += s[i];
+    }
+  }
+  return r;
+}
+
+// Writes a tree in the ccart xml TxpLts reads, with identical subtrees
+// stored once as carttree2xml.py did. Returns the number of nodes written
+static int32 WriteTree(const LtsData &data, const LtsTreeData &tree,
+                       const std::vector<LtsTrainNode> &nodes,
+                       std::ostream &os) {
+  // merge identical subtrees, children before parents
+  std::map<std::vector<int32>, int32> uniq;
+  std::vector<int32> merged(nodes.size());
+  std::vector<std::vector<int32> > keys;
+  for (int32 i = nodes.size() - 1; i >= 0; i--) {
+    std::vector<int32> key;
+    // a question whose answers lead to the same subtree is dropped
+    if (nodes[i].cls < 0 && merged[nodes[i].yes] == merged[nodes[i].no]) {
+      merged[i] = merged[nodes[i].yes];
+      continue;
+    }
+    if (nodes[i].cls >= 0) {
+      key.push_back(nodes[i].cls);
+    } else {
+      key.push_back(nodes[i].pos);
+      key.push_back(nodes[i].value);
+      key.push_back(merged[nodes[i].yes]);
+      key.push_back(merged[nodes[i].no]);
+    }
+    std::map<std::vector<int32>, int32>::iterator it = uniq.find(key);
+    if (it == uniq.end()) {
+      it = uniq.insert(std::make_pair(key, static_cast<int32>(keys.size())))
+          .first;
+      keys.push_back(key);
+    }
+    merged[i] = it->second;
+  }
+  // terminals first, then the root and the other non terminals
+  int32 root = merged[0], num_terms = 0;
+  std::vector<int32> ids(keys.size(), -1), order;
+  for (size_t k = 0; k < keys.size(); k++)
+    if (keys[k].size() == 1) {
+      ids[k] = order.size();
+      order.push_back(k);
+    }
+  num_terms = order.size();
+  if (keys[root].size() != 1) {
+    ids[root] = order.size();
+    order.push_back(root);
+  }
+  for (size_t k = 0; k < keys.size(); k++)
+    if (ids[k] < 0) {
+      ids[k] = order.size();
+      order.push_back(k);
+    }
+  int32 num_nonterms = order.size() - num_terms;
+  os << "\t<tree ltr='" << XmlEscape(tree.letter) << "' rootnode='"
+     << (num_nonterms ? "N" : "T") << (num_nonterms ? num_terms : ids[root])
+     << "' terminal='" << num_terms << "' nonterminal='" << num_nonterms
+     << "'>\n";
+  for (size_t i = 0; i < order.size(); i++) {
+    const std::vector<int32> &key = keys[order[i]];
+    if (key.size() == 1) {
+      os << "\t\t<node id='T" << i << "' val='"
+         << XmlEscape(tree.classes[key[0]]) << "'/>\n";
+    } else {
+      std::string posval = key[1] == kLtsBoundary ? std::string("#")
+                                                  : data.letters[key[1]];
+      os << "\t\t<node id='N" << i << "' pos='" << PosName(key[0])
+         << "' posval='" << XmlEscape(posval) << "' yes='" << ids[key[2]]
+         << "' no='" << ids[key[3]] << "'/>\n";
+    }
+  }
+  os << "\t</tree>\n";
+  return order.size();
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  const char *usage =
+      "Train letter to sound cart trees from a Phonetisaurus alignment of a\n"
+      "lexicon (see idlak-misc/cart_lts/run.sh), writing the ccart xml read\n"
+      "by the pronounce module\n"
+      "Usage:  idlakltstrain [options] <alignment-rxfilename> <ccart-wxfilename>\n"
+      "e.g.: ./idlakltstrain --num-threads=8 converted-default.align ../../idlak-data/en/ga/ccart-default.xml\n"; //NOLINT
+  int32 width = 8, min_leaf = 50;
+
+  try {
+    ParseOptions po(usage);
+    po.Register("context", &width,
+                "Letters of context either side of each letter the questions "
+                "may ask about");
+    po.Register("min-leaf", &min_leaf,
+                "Fewest examples in a leaf, as wagon's -stop");
+    po.Register("num-threads", &g_num_threads,
+                "Number of threads evaluating questions");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (width < 0 || min_leaf < 1)
+      KALDI_ERR << "Bad --context or --min-leaf";
+
+    LtsData data;
+    data.width = width;
+    {
+      Input ki(po.GetArg(1));
+      std::string line;
+      int32 num_words = 0;
+      while (std::getline(ki.Stream(), line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        AddAlignment(line, &data);
+        num_words++;
+      }
+      KALDI_LOG << "Read " << num_words << " aligned words with "
+                << data.letters.size() << " letters";
+    }
+
+    Output ko(po.GetArg(2), false);
+    std::ostream &os = ko.Stream();
+    os << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<lts>\n";
+    for (std::map<std::string, LtsTreeData>::const_iterator it =
+             data.trees.begin(); it != data.trees.end(); ++it) {
+      const LtsTreeData &tree = it->second;
+      if (tree.targets.empty()) continue;
+      LtsTreeGrower grower(tree, width, data.letters.size(), min_leaf);
+      grower.Grow();
+      int32 written = WriteTree(data, tree, grower.Nodes(), os);
+      KALDI_LOG << "Letter " << tree.letter << ": " << tree.targets.size()
+                << " examples, " << grower.Nodes().size() << " nodes, "
+                << written << " after merging identical subtrees";
+    }
+    os << "</lts>\n";
+    ko.Close();
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
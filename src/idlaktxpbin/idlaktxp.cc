@@ -18,8 +18,197 @@
 
 #include <pugixml.hpp>
 #include "base/kaldi-common.h"
+#include <mutex>
+#include <sstream>
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "idlaktxp/idlaktxp.h"
+#include "idlaktxp/txpstream.h"
+#include "idlaktxp/txpxmlholder.h"
+#include "idlaktxp/txpstagestats.h"
+#include "idlaktxp/txptokenpass.h"
+
+// In streaming mode utterances are numbered within each chunk, continue the
+// numbering from the previous chunks unless it restarts for each fileid
+static kaldi::int32 RenumberUtterances(const pugi::xml_node &root,
+                                       kaldi::int32 offset) {
+  kaldi::int32 nutts = 0;
+  if (root.child("fileid")) return 0;
+  for (pugi::xml_node utt = root.child("utt"); utt;
+       utt = utt.next_sibling("utt"), nutts++)
+    utt.attribute("uttid").set_value(utt.attribute("uttid").as_int() + offset);
+  return nutts;
+}
+
+// One set of the txp modules. The tpdb data behind the modules is shared
+// between sets and is only read while processing, so each worker thread can
+// run its own set without locking
+struct TxpModuleSet {
+  kaldi::TxpTokenise t;
+  kaldi::TxpPosTag p;
+  kaldi::TxpPauses pz;
+  kaldi::TxpPhrasing ph;
+  kaldi::TxpPronounce pr;
+  kaldi::TxpSyllabify sy;
+  // part of speech and pauses share one walk of the tokens
+  kaldi::TxpTokenPass tokens;
+  void Init(const kaldi::TxpParseOptions &po) {
+    t.Init(po);
+    p.Init(po);
+    pz.Init(po);
+    ph.Init(po);
+    pr.Init(po);
+    sy.Init(po);
+    tokens.Add(&p);
+    tokens.Add(&pz);
+  }
+  void Process(pugi::xml_document* doc) {
+    kaldi::TxpProcessTimed(&t, doc);
+    tokens.Process(doc);
+    kaldi::TxpProcessTimed(&ph, doc);
+    kaldi::TxpProcessTimed(&pr, doc);
+    kaldi::TxpProcessTimed(&sy, doc);
+  }
+};
+
+// Module sets not currently in use by a worker thread, a set is only created
+// when all existing sets are busy. The first set is created up front so that
+// errors loading the tpdb are reported from the main thread
+class TxpModuleSetPool {
+ public:
+  explicit TxpModuleSetPool(const kaldi::TxpParseOptions &po) : po_(po) {
+    Release(Acquire());
+  }
+  ~TxpModuleSetPool() {
+    for (size_t i = 0; i < sets_.size(); i++) delete sets_[i];
+  }
+  TxpModuleSet* Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!sets_.empty()) {
+        TxpModuleSet* set = sets_.back();
+        sets_.pop_back();
+        return set;
+      }
+    }
+    TxpModuleSet* set = new TxpModuleSet;
+    set->Init(po_);
+    return set;
+  }
+  void Release(TxpModuleSet* set) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sets_.push_back(set);
+  }
+
+ private:
+  const kaldi::TxpParseOptions &po_;
+  std::vector<TxpModuleSet*> sets_;
+  std::mutex mutex_;
+};
+
+// Streaming output state, only used from task destructors which the
+// TaskSequencer calls one at a time in input order
+struct TxpStreamOutput {
+  std::ostream* os;
+  const kaldi::TxpStreamReader* reader;
+  bool pretty;
+  bool started;
+  kaldi::int32 nutts;
+};
+
+// Processes one chunk of a stream, the output is written in the destructor
+class TxpChunkTask {
+ public:
+  TxpChunkTask(pugi::xml_document* doc, TxpModuleSetPool* pool,
+               TxpStreamOutput* out) : doc_(doc), pool_(pool), out_(out) {}
+  void operator() () {
+    TxpModuleSet* set = pool_->Acquire();
+    set->Process(doc_);
+    pool_->Release(set);
+  }
+  ~TxpChunkTask() {
+    std::ostream &os = *(out_->os);
+    out_->nutts += RenumberUtterances(doc_->document_element(), out_->nutts);
+    if (!out_->started) {
+      os << "<?xml version=\"1.0\"?>" << (out_->pretty ? "\n" : "")
+         << out_->reader->GetRootStartTag() << (out_->pretty ? "\n" : "");
+      out_->started = true;
+    }
+    for (pugi::xml_node child = doc_->document_element().first_child();
+         child; child = child.next_sibling()) {
+      if (!out_->pretty)
+        child.print(os, "", pugi::format_raw);
+      else
+        child.print(os, "\t", pugi::format_default, pugi::encoding_auto, 1);
+    }
+    os.flush();
+    delete doc_;
+  }
+
+ private:
+  pugi::xml_document* doc_;
+  TxpModuleSetPool* pool_;
+  TxpStreamOutput* out_;
+};
+
+// Table output state, only used from task destructors as for streaming
+struct TxpTableOutput {
+  kaldi::TxpXmlWriter* writer;
+  bool pretty;
+  kaldi::int32 num_done;
+  kaldi::int32 num_err;
+};
+
+// Processes one document of a table, the output is written in the destructor
+class TxpDocumentTask {
+ public:
+  TxpDocumentTask(const std::string &key, const std::string &xml,
+                  TxpModuleSetPool* pool, TxpTableOutput* out)
+      : key_(key), xml_(xml), pool_(pool), out_(out), ok_(false) {}
+  void operator() () {
+    pugi::xml_document doc;
+    pugi::xml_parse_result r = doc.load_buffer(
+        xml_.data(), xml_.size(), pugi::encoding_utf8 | pugi::parse_escapes);
+    if (!r) {
+      KALDI_WARN << "PugiXML Parse Error in " << key_ << ": "
+                 << r.description() << " Error offset: " << r.offset;
+      return;
+    }
+    TxpModuleSet* set = pool_->Acquire();
+    set->Process(&doc);
+    pool_->Release(set);
+    std::ostringstream os;
+    if (!out_->pretty)
+      doc.save(os, "", pugi::format_raw);
+    else
+      doc.save(os, "\t");
+    xml_ = os.str();
+    ok_ = true;
+  }
+  ~TxpDocumentTask() {
+    if (ok_) {
+      out_->writer->Write(key_, xml_);
+      out_->num_done++;
+    } else {
+      out_->num_err++;
+    }
+  }
+
+ private:
+  std::string key_;
+  // the input, replaced by the output once processed
+  std::string xml_;
+  TxpModuleSetPool* pool_;
+  TxpTableOutput* out_;
+  bool ok_;
+};
+
+// Write the time taken by each module if a file was given
+static void WriteStageStats(const std::string &wxfilename) {
+  if (wxfilename.empty()) return;
+  kaldi::Output ko(wxfilename, false);
+  kaldi::TxpStageStatsWritePrometheus(ko.Stream());
+}
 
 /// Example program that runs all modules in idlaktxp and produces
 /// XML output
@@ -31,6 +220,10 @@ int main(int argc, char *argv[]) {
       "Usage:  idlaktxp --tpdb=<idlak-data-root> --general-lang=<language iso code> [options] xml_input xml_output\n"
       "e.g.: ./idlaktxp --pretty --tpdb=../../idlak-data --general-lang=en ../idlaktxp/test_data/mod-test001.xml output.xml\n" //NOLINT
       "e.g.: cat  ../idlaktxp/test_data/mod-test001.xml output.xml | idlaktxp --pretty --tpdb=../../idlak-data --general-lang=en --general-acc=ga - - > output.xml\n" //NOLINT
+      "e.g.: ./idlaktxp --stream --tpdb=../../idlak-data --general-lang=en book.xml output.xml\n" //NOLINT
+      "e.g.: ./idlaktxp --stream --num-threads=4 --tpdb=../../idlak-data --general-lang=en book.xml output.xml\n" //NOLINT
+      "or:  idlaktxp [options] <xml-rspecifier> <xml-wspecifier>\n"
+      "e.g.: ./idlaktxp --num-threads=8 --tpdb=../../idlak-data --general-lang=en scp:text.scp ark:txp.ark\n" //NOLINT
       "language and tpdb must be set and for most modules with accent specific data accent must also be set"; //NOLINT
   // input output variables
   std::string filein;
@@ -40,12 +233,27 @@ int main(int argc, char *argv[]) {
   std::ofstream fout;
   // defaults to non-pretty XML output
   bool pretty = false;
+  // defaults to processing the whole input as one document
+  bool stream = false;
+  std::string stage_stats;
+  kaldi::TaskSequencerConfig sequencer_config;
 
   try {
     kaldi::TxpParseOptions po(usage);
     //po.SetTpdb(tpdb);
     po.Register("pretty", &pretty,
                 "Output XML with tabbing and line breaks to make it readable");
+    po.Register("stream", &stream,
+                "Process and output the input a sentence (or fileid) at a "
+                "time to limit memory use. Pauses at chunk boundaries are "
+                "those of a document start and end");
+    po.Register("stage-stats", &stage_stats,
+                "Write the time spent in each module and the tokens "
+                "processed to this file at the end, in Prometheus text "
+                "format");
+    // with --stream or tables, the number of chunks or documents processed
+    // at the same time
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
     // Must have input and output filenames for XML
     if (po.NumArgs() != 2) {
@@ -54,43 +262,74 @@ int main(int argc, char *argv[]) {
     }
     filein = po.GetArg(1);
     fileout = po.GetArg(2);
+    if (kaldi::ClassifyRspecifier(filein, NULL, NULL) !=
+        kaldi::kNoRspecifier) {
+      // a table of documents, the modules are loaded once for all of them
+      if (kaldi::ClassifyWspecifier(fileout, NULL, NULL, NULL) ==
+          kaldi::kNoWspecifier)
+        KALDI_ERR << "Output must be a wspecifier when the input is an "
+                  << "rspecifier, got " << fileout;
+      if (stream)
+        KALDI_ERR << "--stream cannot be used with tables";
+      kaldi::SequentialTxpXmlReader reader(filein);
+      kaldi::TxpXmlWriter writer(fileout);
+      TxpModuleSetPool pool(po);
+      TxpTableOutput out = {&writer, pretty, 0, 0};
+      {
+        kaldi::TaskSequencer<TxpDocumentTask> sequencer(sequencer_config);
+        for (; !reader.Done(); reader.Next())
+          sequencer.Run(new TxpDocumentTask(reader.Key(), reader.Value(),
+                                            &pool, &out));
+      }
+      KALDI_LOG << "Processed " << out.num_done << " documents, "
+                << out.num_err << " failed.";
+      WriteStageStats(stage_stats);
+      return (out.num_done != 0 ? 0 : 1);
+    }
     // Set up input/output streams
     bool binary;
     kaldi::Input ki(filein, &binary);
     kaldi::Output kio(fileout, binary);
+    if (stream) {
+      kaldi::TxpStreamReader reader(ki.Stream());
+      TxpModuleSetPool pool(po);
+      TxpStreamOutput out = {&kio.Stream(), &reader, pretty, false, 0};
+      {
+        // chunks are processed in parallel and written in input order
+        kaldi::TaskSequencer<TxpChunkTask> sequencer(sequencer_config);
+        pugi::xml_document* doc = new pugi::xml_document;
+        while (reader.Next(doc, pugi::encoding_utf8 | pugi::parse_escapes)) {
+          sequencer.Run(new TxpChunkTask(doc, &pool, &out));
+          doc = new pugi::xml_document;
+        }
+        delete doc;
+      }
+      std::ostream &os = kio.Stream();
+      if (!out.started)
+        os << "<?xml version=\"1.0\"?>" << (pretty ? "\n" : "")
+           << reader.GetRootStartTag();
+      os << "</" << reader.GetRootName() << ">" << (pretty ? "\n" : "");
+      WriteStageStats(stage_stats);
+      return 0;
+    }
     // Set up each module
-    kaldi::TxpTokenise t;
-    kaldi::TxpPosTag p;
-    kaldi::TxpPauses pz;
-    kaldi::TxpPhrasing ph;
-    kaldi::TxpPronounce pr;
-    kaldi::TxpSyllabify sy;
-    // Use pujiXMl to read input file
+    TxpModuleSet modules;
+    modules.Init(po);
     pugi::xml_document doc;
+    // Use pujiXMl to read input file
     pugi::xml_parse_result r = doc.load(ki.Stream(), pugi::encoding_utf8 | pugi::parse_escapes);
     if (!r) {
       KALDI_ERR << "PugiXML Parse Error in Input Stream" << r.description()
                 << "Error offset: " << r.offset;
     }
-    // Initialise each module
-    t.Init(po);
-    p.Init(po);
-    pz.Init(po);
-    ph.Init(po);
-    pr.Init(po);
-    sy.Init(po);
     // Run each module on the input XML
-    t.Process(&doc);
-    p.Process(&doc);
-    pz.Process(&doc);
-    ph.Process(&doc);
-    pr.Process(&doc);
-    sy.Process(&doc);
+    modules.Process(&doc);
     // Output result
     if (!pretty)
       doc.save(kio.Stream(), "", pugi::format_raw);
     else
       doc.save(kio.Stream(), "\t");
+    WriteStageStats(stage_stats);
     return 0;
   } catch(const std::exception &e) {
     std::cerr << e.what() << '\n';
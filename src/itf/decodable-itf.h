@@ -114,6 +114,13 @@ class DecodableInterface {
   /// this is for compatibility with OpenFst).
   virtual int32 NumIndices() const = 0;
 
+  /// Returns true if, once LogLikelihood() has returned for some frame, other
+  /// calls to LogLikelihood() for that same frame may be made from several
+  /// threads at once.  LatticeFasterDecoder relies on this for its
+  /// --expand-threads option.  Most decodables cache things inside
+  /// LogLikelihood(), so the default is false.
+  virtual bool LogLikelihoodIsThreadSafe() const { return false; }
+
   virtual ~DecodableInterface() {}
 };
 /// @}
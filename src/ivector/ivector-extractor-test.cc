@@ -107,6 +107,13 @@ void TestIvectorExtraction(const IvectorExtractor &extractor,
   IvectorExtractorUtteranceStats utt_stats(num_gauss, feat_dim,
                                            false);
   utt_stats.AccStats(feats, post);
+  {
+    // The stats from posteriors in CSR form should be the same.
+    IvectorExtractorUtteranceStats utt_stats_csr(num_gauss, feat_dim,
+                                                 false);
+    utt_stats_csr.AccStats(feats, PosteriorCsr(post));
+    KALDI_ASSERT(ApproxEqual(utt_stats_csr.NumFrames(), utt_stats.NumFrames()));
+  }
 
   OnlineIvectorEstimationStats online_stats(extractor.IvectorDim(),
                                             extractor.PriorOffset(),
@@ -139,6 +146,53 @@ void TestIvectorExtraction(const IvectorExtractor &extractor,
             << ", objf_change2 = " << objf_change2;
   
   KALDI_ASSERT(ivector1.ApproxEqual(ivector2));
+
+  // Estimating it again with a tolerance, warm-started from the exact answer,
+  // should leave it (nearly) unchanged; and from the default value it should
+  // get to within the tolerance of the best objective function.
+  Vector<double> ivector3(ivector2), ivector4(ivector_dim);
+  online_stats.GetIvector(num_cg_iters, 1.0e-04, &ivector3);
+  KALDI_ASSERT(ivector3.ApproxEqual(ivector2, 1.0e-04));
+  online_stats.GetIvector(num_cg_iters, 1.0e-04, &ivector4);
+  double objf_change4 = online_stats.ObjfChange(ivector4) *
+      utt_stats.NumFrames();
+  KALDI_LOG << "objf_change2 = " << objf_change2
+            << ", objf_change4 = " << objf_change4;
+  KALDI_ASSERT(objf_change4 <= objf_change2 + 1.0e-06 &&
+               objf_change4 >= objf_change2 - 1.0e-04 - 1.0e-06);
+}
+
+
+void TestIvectorExtractionBatch(const IvectorExtractor &extractor,
+                                const std::vector<Matrix<BaseFloat> > &all_feats,
+                                const FullGmm &fgmm) {
+  int32 num_utts = all_feats.size();
+  std::vector<IvectorExtractorUtteranceStats*> utt_stats(num_utts);
+  std::vector<const IvectorExtractorUtteranceStats*> utt_stats_const(num_utts);
+  Matrix<double> ivectors1(num_utts, extractor.IvectorDim()),
+      ivectors2(num_utts, extractor.IvectorDim());
+  for (int32 utt = 0; utt < num_utts; utt++) {
+    const Matrix<BaseFloat> &feats = all_feats[utt];
+    Posterior post(feats.NumRows());
+    for (int32 t = 0; t < feats.NumRows(); t++) {
+      Vector<BaseFloat> posterior(fgmm.NumGauss(), kUndefined);
+      fgmm.ComponentPosteriors(feats.Row(t), &posterior);
+      for (int32 i = 0; i < posterior.Dim(); i++)
+        if (Rand() % 4 != 0)  // leave some Gaussians without counts.
+          post[t].push_back(std::make_pair(i, posterior(i)));
+    }
+    utt_stats[utt] = new IvectorExtractorUtteranceStats(
+        extractor.NumGauss(), extractor.FeatDim(), false);
+    utt_stats[utt]->AccStats(feats, post);
+    utt_stats_const[utt] = utt_stats[utt];
+    SubVector<double> ivector1(ivectors1, utt);
+    ivector1(0) = extractor.PriorOffset();
+    extractor.GetIvectorDistribution(*(utt_stats[utt]), &ivector1, NULL);
+  }
+  extractor.GetIvectorDistributionBatch(utt_stats_const, &ivectors2);
+  KALDI_ASSERT(ivectors1.ApproxEqual(ivectors2, 1.0e-06));
+  for (int32 utt = 0; utt < num_utts; utt++)
+    delete utt_stats[utt];
 }
 
 
@@ -184,6 +238,7 @@ void UnitTestIvectorExtractor() {
       stats.AccStatsForUtterance(extractor, feats, fgmm);
       TestIvectorExtraction(extractor, feats, fgmm);
     }
+    TestIvectorExtractionBatch(extractor, all_feats, fgmm);
     TestIvectorExtractorStatsIO(stats);
     
     IvectorExtractorEstimationOptions estimation_opts;
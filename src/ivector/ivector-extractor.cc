@@ -218,6 +218,60 @@ void IvectorExtractor::ComputeDerivedVars(int32 i) {
 }
 
 
+void IvectorExtractor::GetIvectorDistributionBatch(
+    const std::vector<const IvectorExtractorUtteranceStats*> &utt_stats,
+    MatrixBase<double> *means) const {
+  int32 num_utts = utt_stats.size(), I = NumGauss(), D = FeatDim(),
+      S = IvectorDim();
+  KALDI_ASSERT(means->NumRows() == num_utts && means->NumCols() == S);
+  if (num_utts == 0)
+    return;
+  if (IvectorDependentWeights()) {
+    // The weight terms are iterated per utterance around the current estimate,
+    // so there is nothing to gain from batching.
+    for (int32 n = 0; n < num_utts; n++) {
+      SubVector<double> mean(*means, n);
+      GetIvectorDistribution(*(utt_stats[n]), &mean, NULL);
+    }
+    return;
+  }
+  // Row n of "gamma" is utt_stats[n]->gamma_, and row n of "quadratic" will be
+  // the packed quadratic term of utterance n, as in GetIvectorDistMean().
+  Matrix<double> gamma(num_utts, I);
+  for (int32 n = 0; n < num_utts; n++)
+    gamma.Row(n).CopyFromVec(utt_stats[n]->gamma_);
+  Matrix<double> quadratic(num_utts, S * (S + 1) / 2);
+  quadratic.AddMatMat(1.0, gamma, kNoTrans, U_, kNoTrans, 0.0);
+
+  // linear.Row(n) += \gamma_{ni} \M_i^T \Sigma_i^{-1} \m_{ni} for each i.
+  Matrix<double> linear(num_utts, S), x(num_utts, D);
+  for (int32 i = 0; i < I; i++) {
+    bool any_nonzero = false;
+    for (int32 n = 0; n < num_utts; n++) {
+      if (gamma(n, i) != 0.0) {
+        x.Row(n).CopyFromVec(utt_stats[n]->X_.Row(i));
+        any_nonzero = true;
+      } else {
+        x.Row(n).SetZero();
+      }
+    }
+    if (any_nonzero)
+      linear.AddMatMat(1.0, x, kNoTrans, Sigma_inv_M_[i], kNoTrans, 1.0);
+  }
+
+  SpMatrix<double> this_quadratic(S);
+  SubVector<double> this_quadratic_vec(this_quadratic.Data(),
+                                       S * (S + 1) / 2);
+  for (int32 n = 0; n < num_utts; n++) {
+    SubVector<double> this_linear(linear, n), mean(*means, n);
+    this_quadratic_vec.CopyFromVec(quadratic.Row(n));
+    GetIvectorDistPrior(*(utt_stats[n]), &this_linear, &this_quadratic);
+    this_quadratic.Invert();
+    mean.AddSpVec(1.0, this_quadratic, this_linear, 0.0);
+  }
+}
+
+
 void IvectorExtractor::GetIvectorDistWeight(
     const IvectorExtractorUtteranceStats &utt_stats,
     const VectorBase<double> &mean,
@@ -619,6 +673,9 @@ void OnlineIvectorEstimationStats::AccStats(
   std::unordered_map<int32, GaussInfo> gauss_info;
   ConvertPostToGaussInfo(gauss_post, &gauss_info);
 
+  // Converting the features once here lets the sums below be done in double
+  // by BLAS, rather than converting each frame once per Gaussian.
+  Matrix<double> features_dbl(features);
   Vector<double> weighted_feats(feat_dim, kUndefined);
   double tot_weight = 0.0;
   int32 ivector_dim = this->IvectorDim(),
@@ -632,18 +689,25 @@ void OnlineIvectorEstimationStats::AccStats(
     int32 gauss_idx = iter->first;
     const GaussInfo &info = iter->second;
 
-    weighted_feats.SetZero();
-    std::vector<std::pair<int32, BaseFloat> >::const_iterator
-        f_iter = info.frame_weights.begin(), f_end = info.frame_weights.end();
-    for (; f_iter != f_end; ++f_iter) {
-      int32 t = f_iter->first;
-      BaseFloat weight = f_iter->second;
-      weighted_feats.AddVec(weight, features.Row(t));
-    }
     BaseFloat this_tot_weight = info.tot_weight;
-
-    linear_term_.AddMatVec(1.0, extractor.Sigma_inv_M_[gauss_idx], kTrans,
-                           weighted_feats, 1.0);
+    if (info.frame_weights.size() == 1) {
+      // a single frame: no need to form the weighted sum.
+      const std::pair<int32, BaseFloat> &frame_weight = info.frame_weights[0];
+      linear_term_.AddMatVec(frame_weight.second,
+                             extractor.Sigma_inv_M_[gauss_idx], kTrans,
+                             features_dbl.Row(frame_weight.first), 1.0);
+    } else {
+      weighted_feats.SetZero();
+      std::vector<std::pair<int32, BaseFloat> >::const_iterator
+          f_iter = info.frame_weights.begin(), f_end = info.frame_weights.end();
+      for (; f_iter != f_end; ++f_iter) {
+        int32 t = f_iter->first;
+        BaseFloat weight = f_iter->second;
+        weighted_feats.AddVec(weight, features_dbl.Row(t));
+      }
+      linear_term_.AddMatVec(1.0, extractor.Sigma_inv_M_[gauss_idx], kTrans,
+                             weighted_feats, 1.0);
+    }
     SubVector<double> U_g(extractor.U_, gauss_idx);
     quadratic_term_vec.AddVec(this_tot_weight, U_g);
     tot_weight += this_tot_weight;
@@ -732,8 +796,15 @@ void OnlineIvectorEstimationStats::Read(std::istream &is, bool binary) {
 void OnlineIvectorEstimationStats::GetIvector(
     int32 num_cg_iters,
     VectorBase<double> *ivector) const {
+  GetIvector(num_cg_iters, 0.0, ivector);
+}
+
+void OnlineIvectorEstimationStats::GetIvector(
+    int32 num_cg_iters,
+    BaseFloat cg_tolerance,
+    VectorBase<double> *ivector) const {
   KALDI_ASSERT(ivector != NULL && ivector->Dim() ==
-               this->IvectorDim());
+               this->IvectorDim() && cg_tolerance >= 0.0);
 
   if (num_frames_ > 0.0) {
     // could be done exactly as follows:
@@ -744,7 +815,11 @@ void OnlineIvectorEstimationStats::GetIvector(
       (*ivector)(0) = prior_offset_;  // better initial guess.
     LinearCgdOptions opts;
     opts.max_iters = num_cg_iters;
-    LinearCgd(opts, quadratic_term_, linear_term_, ivector);
+    if (cg_tolerance > 0.0)
+      opts.max_error = std::sqrt(2.0 * cg_tolerance);
+    int32 num_iters = LinearCgd(opts, quadratic_term_, linear_term_, ivector);
+    KALDI_VLOG(5) << "Estimated iVector with " << num_iters
+                  << " iterations of conjugate gradient.";
   } else {
     // Use 'default' value.
     ivector->SetZero();
@@ -849,36 +924,53 @@ void IvectorExtractor::Read(std::istream &is, bool binary) {
 }
 
 
+void IvectorExtractorUtteranceStats::AccStatsForFrame(
+    const VectorBase<BaseFloat> &frame,
+    const std::pair<int32, BaseFloat> *begin,
+    const std::pair<int32, BaseFloat> *end,
+    SpMatrix<double> *outer_prod) {
+  int32 num_gauss = X_.NumRows();
+  bool update_variance = (!S_.empty());
+  if (update_variance) {
+    outer_prod->SetZero();
+    outer_prod->AddVec2(1.0, frame);
+  }
+  for (const std::pair<int32, BaseFloat> *iter = begin; iter != end; ++iter) {
+    int32 i = iter->first; // Gaussian index.
+    KALDI_ASSERT(i >= 0 && i < num_gauss &&
+                 "Out-of-range Gaussian (mismatched posteriors?)");
+    double weight = iter->second;
+    gamma_(i) += weight;
+    X_.Row(i).AddVec(weight, frame);
+    if (update_variance)
+      S_[i].AddSp(weight, *outer_prod);
+  }
+}
+
 void IvectorExtractorUtteranceStats::AccStats(
     const MatrixBase<BaseFloat> &feats,
     const Posterior &post) {
-  typedef std::vector<std::pair<int32, BaseFloat> > VecType;
   int32 num_frames = feats.NumRows(),
-      num_gauss = X_.NumRows(),
       feat_dim = feats.NumCols();
   KALDI_ASSERT(X_.NumCols() == feat_dim);
   KALDI_ASSERT(feats.NumRows() == static_cast<int32>(post.size()));
-  bool update_variance = (!S_.empty());
-  SpMatrix<double> outer_prod(feat_dim);
-  for (int32 t = 0; t < num_frames; t++) {
-    SubVector<BaseFloat> frame(feats, t);
-    const VecType &this_post(post[t]);
-    if (update_variance) {
-      outer_prod.SetZero();
-      outer_prod.AddVec2(1.0, frame);
-    }
-    for (VecType::const_iterator iter = this_post.begin();
-         iter != this_post.end(); ++iter) {
-      int32 i = iter->first; // Gaussian index.
-      KALDI_ASSERT(i >= 0 && i < num_gauss &&
-                   "Out-of-range Gaussian (mismatched posteriors?)");
-      double weight = iter->second;
-      gamma_(i) += weight;
-      X_.Row(i).AddVec(weight, frame);
-      if (update_variance)
-        S_[i].AddSp(weight, outer_prod);
-    }
-  }
+  SpMatrix<double> outer_prod(S_.empty() ? 0 : feat_dim);
+  for (int32 t = 0; t < num_frames; t++)
+    AccStatsForFrame(feats.Row(t), post[t].data(),
+                     post[t].data() + post[t].size(), &outer_prod);
+}
+
+void IvectorExtractorUtteranceStats::AccStats(
+    const MatrixBase<BaseFloat> &feats,
+    const PosteriorCsr &post) {
+  int32 num_frames = feats.NumRows(),
+      feat_dim = feats.NumCols();
+  KALDI_ASSERT(X_.NumCols() == feat_dim);
+  KALDI_ASSERT(feats.NumRows() == post.NumFrames());
+  SpMatrix<double> outer_prod(S_.empty() ? 0 : feat_dim);
+  for (int32 t = 0; t < num_frames; t++)
+    AccStatsForFrame(feats.Row(t), post.FrameBegin(t), post.FrameEnd(t),
+                     &outer_prod);
 }
 
 void IvectorExtractorUtteranceStats::Scale(double scale) {
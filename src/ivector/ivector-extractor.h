@@ -91,11 +91,22 @@ class IvectorExtractorUtteranceStats {
   void AccStats(const MatrixBase<BaseFloat> &feats,
                 const Posterior &post);
 
+  /// As AccStats() above, for posteriors in CSR form.
+  void AccStats(const MatrixBase<BaseFloat> &feats,
+                const PosteriorCsr &post);
+
   void Scale(double scale); // Used to apply acoustic scale.
 
   double NumFrames() { return gamma_.Sum(); }
 
  protected:
+  // Accumulates the frame 'frame' with the posterior entries begin ... end - 1;
+  // outer_prod is a buffer, only used if we have 2nd order stats.
+  void AccStatsForFrame(const VectorBase<BaseFloat> &frame,
+                        const std::pair<int32, BaseFloat> *begin,
+                        const std::pair<int32, BaseFloat> *end,
+                        SpMatrix<double> *outer_prod);
+
   friend class IvectorExtractor;
   friend class IvectorExtractorStats;
   Vector<double> gamma_; // zeroth-order stats (summed posteriors), dimension [I]
@@ -153,6 +164,17 @@ class IvectorExtractor {
       VectorBase<double> *mean,
       SpMatrix<double> *var) const;
 
+  /// Gets the means of the distributions over ivectors of a batch of
+  /// utterances, as GetIvectorDistribution() would for each, into the rows of
+  /// "means" (which must be utt_stats.size() by this->IvectorDim()).  Without
+  /// ivector-dependent weights this is much faster than separate calls, as the
+  /// terms that involve every Gaussian are computed for the whole batch with
+  /// matrix-matrix multiplications, which read U_ and Sigma_inv_M_ once per
+  /// batch instead of once per utterance.
+  void GetIvectorDistributionBatch(
+      const std::vector<const IvectorExtractorUtteranceStats*> &utt_stats,
+      MatrixBase<double> *means) const;
+
   /// The distribution over iVectors, in our formulation, is not centered at
   /// zero; its first dimension has a nonzero offset.  This function returns
   /// that offset.
@@ -352,6 +374,18 @@ class OnlineIvectorEstimationStats {
   void GetIvector(int32 num_cg_iters,
                   VectorBase<double> *ivector) const;
 
+  /// As GetIvector() above, but conjugate gradient also stops as soon as the
+  /// objective function (summed over frames, not per frame) is guaranteed to
+  /// be within cg_tolerance of its maximum.  Because the eigenvalues of the
+  /// quadratic term are at least 1, this is so once the residual r satisfies
+  /// 0.5 r^T r <= cg_tolerance.  When *ivector is the estimate from a few
+  /// frames before, this often takes just a few iterations, and none if the
+  /// stats have not changed.  cg_tolerance == 0.0 is the same as the version
+  /// above.
+  void GetIvector(int32 num_cg_iters,
+                  BaseFloat cg_tolerance,
+                  VectorBase<double> *ivector) const;
+
   double NumFrames() const { return num_frames_; }
 
   double PriorOffset() const { return prior_offset_; }
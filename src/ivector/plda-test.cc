@@ -87,6 +87,42 @@ void UnitTestPldaEstimation(int32 dim) {
               << "should be: " << s;
   }
 
+  { // Check that PldaScorer gives the same scores as LogLikelihoodRatio().
+    PldaConfig plda_config;
+    int32 num_train = 1 + Rand() % 10, num_test = 1 + Rand() % 10;
+    Matrix<double> train(num_train, dim), test(num_test, dim);
+    std::vector<int32> num_train_utts(num_train);
+    for (int32 j = 0; j < num_train; j++) {
+      Vector<double> ivector(dim);
+      ivector.SetRandn();
+      ivector.AddVec(1.0, global_mean);
+      num_train_utts[j] = 1 + Rand() % 5;
+      SubVector<double> transformed_ivector(train, j);
+      plda.TransformIvector(plda_config, ivector, num_train_utts[j],
+                            &transformed_ivector);
+    }
+    for (int32 k = 0; k < num_test; k++) {
+      Vector<double> ivector(dim);
+      ivector.SetRandn();
+      ivector.AddVec(1.0, global_mean);
+      SubVector<double> transformed_ivector(test, k);
+      plda.TransformIvector(plda_config, ivector, 1, &transformed_ivector);
+    }
+    PldaScorer scorer(plda, train, num_train_utts, test);
+    int32 train_begin = Rand() % num_train, test_begin = Rand() % num_test;
+    Matrix<double> scores(num_train - train_begin, num_test - test_begin);
+    scorer.LogLikelihoodRatios(train_begin, test_begin, &scores);
+    for (int32 j = train_begin; j < num_train; j++) {
+      for (int32 k = test_begin; k < num_test; k++) {
+        double score = plda.LogLikelihoodRatio(train.Row(j),
+                                               num_train_utts[j],
+                                               test.Row(k));
+        AssertEqual(score, scorer.LogLikelihoodRatio(j, k), 1.0e-08);
+        AssertEqual(score, scores(j - train_begin, k - test_begin), 1.0e-08);
+      }
+    }
+  }
+
 }
 
 }
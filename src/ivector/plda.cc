@@ -192,6 +192,69 @@ double Plda::LogLikelihoodRatio(
 }
 
 
+PldaScorer::PldaScorer(const Plda &plda,
+                       const MatrixBase<double> &transformed_train_ivectors,
+                       const std::vector<int32> &num_train_utts,
+                       const MatrixBase<double> &transformed_test_ivectors) {
+  int32 dim = plda.Dim(), num_train = transformed_train_ivectors.NumRows(),
+      num_test = transformed_test_ivectors.NumRows();
+  KALDI_ASSERT(transformed_train_ivectors.NumCols() == dim &&
+               transformed_test_ivectors.NumCols() == dim &&
+               static_cast<int32>(num_train_utts.size()) == num_train);
+  const Vector<double> &psi = plda.psi_;
+  // Expanding LogLikelihoodRatio(), with u the train iVector, n the number of
+  // train utterances, w = 1 / (1 + \Psi/(n \Psi + I)) and
+  // m = (n \Psi)/(n \Psi + I) u, the ratio is
+  //   - 0.5 (w - 1 / (I + \Psi)) . v^2 + (w m) . v
+  //   - 0.5 [ w . m^2 + logdet(I + \Psi/(n \Psi + I)) - logdet(I + \Psi) ].
+  double logdet_without_class = 0.0;
+  Vector<double> inv_var_without_class(dim);
+  for (int32 i = 0; i < dim; i++) {
+    logdet_without_class += Log(1.0 + psi(i));
+    inv_var_without_class(i) = 1.0 / (1.0 + psi(i));
+  }
+  train_coefs_.Resize(num_train, 2 * dim, kUndefined);
+  train_offsets_.Resize(num_train, kUndefined);
+  for (int32 j = 0; j < num_train; j++) {
+    int32 n = num_train_utts[j];
+    const double *u = transformed_train_ivectors.RowData(j);
+    double *linear = train_coefs_.RowData(j), *quadratic = linear + dim;
+    double offset = -logdet_without_class;
+    for (int32 i = 0; i < dim; i++) {
+      double variance = 1.0 + psi(i) / (n * psi(i) + 1.0),
+          inv_var = 1.0 / variance,
+          mean = n * psi(i) / (n * psi(i) + 1.0) * u[i];
+      linear[i] = inv_var * mean;
+      quadratic[i] = -0.5 * (inv_var - inv_var_without_class(i));
+      offset += inv_var * mean * mean + Log(variance);
+    }
+    train_offsets_(j) = -0.5 * offset;
+  }
+  test_feats_.Resize(num_test, 2 * dim, kUndefined);
+  for (int32 k = 0; k < num_test; k++) {
+    SubVector<double> v(transformed_test_ivectors, k),
+        v_sq(test_feats_.RowData(k) + dim, dim);
+    test_feats_.Row(k).Range(0, dim).CopyFromVec(v);
+    v_sq.CopyFromVec(v);
+    v_sq.ApplyPow(2.0);
+  }
+}
+
+void PldaScorer::LogLikelihoodRatios(int32 train_begin, int32 test_begin,
+                                     MatrixBase<double> *scores) const {
+  int32 num_train = scores->NumRows(), num_test = scores->NumCols();
+  KALDI_ASSERT(train_begin >= 0 && train_begin + num_train <= NumTrain() &&
+               test_begin >= 0 && test_begin + num_test <= NumTest());
+  if (num_train == 0 || num_test == 0)
+    return;
+  SubMatrix<double> train_coefs(train_coefs_, train_begin, num_train,
+                                0, train_coefs_.NumCols()),
+      test_feats(test_feats_, test_begin, num_test, 0, test_feats_.NumCols());
+  scores->AddMatMat(1.0, train_coefs, kNoTrans, test_feats, kTrans, 0.0);
+  scores->AddVecToCols(1.0, train_offsets_.Range(train_begin, num_train));
+}
+
+
 void Plda::SmoothWithinClassCovariance(double smoothing_factor) {
   KALDI_ASSERT(smoothing_factor >= 0.0 && smoothing_factor <= 1.0);
   // smoothing_factor > 1.0 is possible but wouldn't really make sense.
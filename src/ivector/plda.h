@@ -144,6 +144,7 @@ class Plda {
   void ComputeDerivedVars(); // computes offset_.
   friend class PldaEstimator;
   friend class PldaUnsupervisedAdaptor;
+  friend class PldaScorer;
 
   Vector<double> mean_;  // mean of samples in original space.
   Matrix<double> transform_; // of dimension Dim() by Dim();
@@ -169,6 +170,47 @@ class Plda {
 };
 
 
+/// This class gives the same log-likelihood ratios as
+/// Plda::LogLikelihoodRatio(), but is much faster for many trials.  For a
+/// given train iVector and number of train utterances, the log-likelihood
+/// ratio is a linear function of the test iVector v and its elementwise square
+/// v^2, plus an offset; the constructor works out those coefficients for every
+/// train iVector and [ v, v^2 ] for every test iVector, so a score is one dot
+/// product, and a block of scores is one matrix multiplication.
+class PldaScorer {
+ public:
+  /// All the iVectors must have been transformed by Plda::TransformIvector().
+  /// Row j of transformed_train_ivectors is an average over num_train_utts[j]
+  /// utterances.
+  PldaScorer(const Plda &plda,
+             const MatrixBase<double> &transformed_train_ivectors,
+             const std::vector<int32> &num_train_utts,
+             const MatrixBase<double> &transformed_test_ivectors);
+
+  int32 NumTrain() const { return train_coefs_.NumRows(); }
+  int32 NumTest() const { return test_feats_.NumRows(); }
+
+  /// Returns the log-likelihood ratio for train iVector "train_index" and test
+  /// iVector "test_index".
+  double LogLikelihoodRatio(int32 train_index, int32 test_index) const {
+    return VecVec(train_coefs_.Row(train_index), test_feats_.Row(test_index))
+        + train_offsets_(train_index);
+  }
+
+  /// Sets (*scores)(j, k) to the log-likelihood ratio for train iVector
+  /// train_begin + j and test iVector test_begin + k, for all j and k in the
+  /// dimensions of "scores".
+  void LogLikelihoodRatios(int32 train_begin, int32 test_begin,
+                           MatrixBase<double> *scores) const;
+
+ private:
+  Matrix<double> train_coefs_;  // [train][2 * dim]: the coefficients of
+                                // [ v, v^2 ].
+  Vector<double> train_offsets_;  // [train]
+  Matrix<double> test_feats_;  // [test][2 * dim]: [ v, v^2 ].
+};
+
+
 class PldaStats {
  public:
   PldaStats(): dim_(0) { } /// The dimension is set up the first time you add samples.
@@ -28,65 +28,85 @@ namespace kaldi {
 
 // This class will be used to parallelize over multiple threads the job
 // that this program does.  The work happens in the operator (), the
-// output happens in the destructor.
+// output happens in the destructor.  Each task handles a batch of
+// utterances, so that their iVectors can be computed together by
+// IvectorExtractor::GetIvectorDistributionBatch().
 class IvectorExtractTask {
  public:
   IvectorExtractTask(const IvectorExtractor &extractor,
-                     std::string utt,
-                     const Matrix<BaseFloat> &feats,
-                     const Posterior &posterior,
                      BaseFloatVectorWriter *writer,
                      double *tot_auxf_change):
-      extractor_(extractor), utt_(utt), feats_(feats), posterior_(posterior),
-      writer_(writer), tot_auxf_change_(tot_auxf_change) { }
+      extractor_(extractor), writer_(writer),
+      tot_auxf_change_(tot_auxf_change) { }
+
+  void AddUtterance(const std::string &utt,
+                    const Matrix<BaseFloat> &feats,
+                    const PosteriorCsr &posterior) {
+    utts_.push_back(utt);
+    feats_.push_back(feats);
+    posteriors_.push_back(posterior);
+  }
+
+  int32 NumUtterances() const { return utts_.size(); }
 
   void operator () () {
     bool need_2nd_order_stats = false;
+    int32 num_utts = utts_.size();
+
+    std::vector<IvectorExtractorUtteranceStats> utt_stats(
+        num_utts, IvectorExtractorUtteranceStats(extractor_.NumGauss(),
+                                                 extractor_.FeatDim(),
+                                                 need_2nd_order_stats));
+    std::vector<const IvectorExtractorUtteranceStats*> utt_stats_ptrs(
+        num_utts);
+    for (int32 n = 0; n < num_utts; n++) {
+      utt_stats[n].AccStats(feats_[n], posteriors_[n]);
+      utt_stats_ptrs[n] = &(utt_stats[n]);
+    }
 
-    IvectorExtractorUtteranceStats utt_stats(extractor_.NumGauss(),
-                                             extractor_.FeatDim(),
-                                             need_2nd_order_stats);
-
-    utt_stats.AccStats(feats_, posterior_);
-
-    ivector_.Resize(extractor_.IvectorDim());
-    ivector_(0) = extractor_.PriorOffset();
-
+    ivectors_.Resize(num_utts, extractor_.IvectorDim());
+    auxf_change_.resize(num_utts, 0.0);
     if (tot_auxf_change_ != NULL) {
-      double old_auxf = extractor_.GetAuxf(utt_stats, ivector_);
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
-      double new_auxf = extractor_.GetAuxf(utt_stats, ivector_);
-      auxf_change_ = new_auxf - old_auxf;
-    } else {
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+      Vector<double> default_ivector(extractor_.IvectorDim());
+      default_ivector(0) = extractor_.PriorOffset();
+      for (int32 n = 0; n < num_utts; n++)
+        auxf_change_[n] = -extractor_.GetAuxf(utt_stats[n], default_ivector);
+    }
+    extractor_.GetIvectorDistributionBatch(utt_stats_ptrs, &ivectors_);
+    if (tot_auxf_change_ != NULL) {
+      for (int32 n = 0; n < num_utts; n++)
+        auxf_change_[n] += extractor_.GetAuxf(utt_stats[n], ivectors_.Row(n));
     }
   }
   ~IvectorExtractTask() {
-    if (tot_auxf_change_ != NULL) {
-      double T = TotalPosterior(posterior_);
-      *tot_auxf_change_ += auxf_change_;
-      KALDI_VLOG(2) << "Auxf change for utterance " << utt_ << " was "
-                    << (auxf_change_ / T) << " per frame over " << T
-                    << " frames (weighted)";
+    for (size_t n = 0; n < utts_.size(); n++) {
+      if (tot_auxf_change_ != NULL) {
+        double T = posteriors_[n].Sum();
+        *tot_auxf_change_ += auxf_change_[n];
+        KALDI_VLOG(2) << "Auxf change for utterance " << utts_[n] << " was "
+                      << (auxf_change_[n] / T) << " per frame over " << T
+                      << " frames (weighted)";
+      }
+      // We actually write out the offset of the iVectors from the mean of the
+      // prior distribution; this is the form we'll need it in for scoring.
+      // (most formulations of iVectors have zero-mean priors so this is not
+      // normally an issue).
+      SubVector<double> ivector(ivectors_, n);
+      ivector(0) -= extractor_.PriorOffset();
+      KALDI_VLOG(2) << "Ivector norm for utterance " << utts_[n]
+                    << " was " << ivector.Norm(2.0);
+      writer_->Write(utts_[n], Vector<BaseFloat>(ivector));
     }
-    // We actually write out the offset of the iVectors from the mean of the
-    // prior distribution; this is the form we'll need it in for scoring.  (most
-    // formulations of iVectors have zero-mean priors so this is not normally an
-    // issue).
-    ivector_(0) -= extractor_.PriorOffset();
-    KALDI_VLOG(2) << "Ivector norm for utterance " << utt_
-                  << " was " << ivector_.Norm(2.0);
-    writer_->Write(utt_, Vector<BaseFloat>(ivector_));
   }
  private:
   const IvectorExtractor &extractor_;
-  std::string utt_;
-  Matrix<BaseFloat> feats_;
-  Posterior posterior_;
+  std::vector<std::string> utts_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<PosteriorCsr> posteriors_;
   BaseFloatVectorWriter *writer_;
   double *tot_auxf_change_; // if non-NULL we need the auxf change.
-  Vector<double> ivector_;
-  double auxf_change_;
+  Matrix<double> ivectors_;
+  std::vector<double> auxf_change_;
 };
 
 int32 RunPerSpeaker(const std::string &ivector_extractor_rxfilename,
@@ -100,7 +120,7 @@ int32 RunPerSpeaker(const std::string &ivector_extractor_rxfilename,
   ReadKaldiObject(ivector_extractor_rxfilename, &extractor);
   SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
   RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
-  RandomAccessPosteriorReader posterior_reader(posterior_rspecifier);
+  RandomAccessPosteriorCsrReader posterior_reader(posterior_rspecifier);
   BaseFloatVectorWriter ivector_writer(ivector_wspecifier);
 
   double tot_auxf_change = 0.0, tot_post = 0.0, tot_norm = 0.0;
@@ -130,15 +150,15 @@ int32 RunPerSpeaker(const std::string &ivector_extractor_rxfilename,
         num_utt_err++;
         continue;
       }
-      Posterior posterior = posterior_reader.Value(utt);
-      if (feats.NumRows() != posterior.size()) {
-        KALDI_WARN << "Posterior has wrong size " << posterior.size()
+      PosteriorCsr posterior = posterior_reader.Value(utt);
+      if (feats.NumRows() != posterior.NumFrames()) {
+        KALDI_WARN << "Posterior has wrong size " << posterior.NumFrames()
                    << " vs. feats " << feats.NumRows() << " for "
                    << utt;
         num_utt_err++;
         continue;
       }
-      ScalePosterior(opts.acoustic_weight, &posterior);
+      posterior.Scale(opts.acoustic_weight);
       num_utt_done++;
       utt_stats.AccStats(feats, posterior);
     }
@@ -225,6 +245,7 @@ int main(int argc, char *argv[]) {
     bool compute_objf_change = true;
     IvectorEstimationOptions opts;
     std::string spk2utt_rspecifier;
+    int32 batch_size = 16;
     TaskSequencerConfig sequencer_config;
     po.Register("compute-objf-change", &compute_objf_change,
                 "If true, compute the change in objective function from using "
@@ -236,6 +257,10 @@ int main(int argc, char *argv[]) {
                 "is not the normal way iVectors are obtained for speaker-id. "
                 "This option will cause the program to ignore the --num-threads "
                 "option.");
+    po.Register("batch-size", &batch_size, "Number of utterances whose "
+                "iVectors are computed together; larger batches are faster "
+                "but need more memory (each thread holds the features of a "
+                "batch).");
 
     opts.Register(&po);
     sequencer_config.Register(&po);
@@ -246,6 +271,8 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    if (batch_size < 1)
+      KALDI_ERR << "--batch-size must be at least 1";
 
     std::string ivector_extractor_rxfilename = po.GetArg(1),
         feature_rspecifier = po.GetArg(2),
@@ -264,11 +291,14 @@ int main(int argc, char *argv[]) {
       int32 num_done = 0, num_err = 0;
 
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-      RandomAccessPosteriorReader posterior_reader(posterior_rspecifier);
+      RandomAccessPosteriorCsrReader posterior_reader(posterior_rspecifier);
       BaseFloatVectorWriter ivector_writer(ivectors_wspecifier);
 
+      double *auxf_ptr = (compute_objf_change ? &tot_auxf_change : NULL );
+
       {
         TaskSequencer<IvectorExtractTask> sequencer(sequencer_config);
+        IvectorExtractTask *task = NULL;
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
           if (!posterior_reader.HasKey(utt)) {
@@ -277,19 +307,17 @@ int main(int argc, char *argv[]) {
             continue;
           }
           const Matrix<BaseFloat> &mat = feature_reader.Value();
-          Posterior posterior = posterior_reader.Value(utt);
+          PosteriorCsr posterior = posterior_reader.Value(utt);
 
-          if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
-            KALDI_WARN << "Size mismatch between posterior " << posterior.size()
+          if (posterior.NumFrames() != mat.NumRows()) {
+            KALDI_WARN << "Size mismatch between posterior " << posterior.NumFrames()
                        << " and features " << mat.NumRows() << " for utterance "
                        << utt;
             num_err++;
             continue;
           }
 
-          double *auxf_ptr = (compute_objf_change ? &tot_auxf_change : NULL );
-
-          double this_t = opts.acoustic_weight * TotalPosterior(posterior),
+          double this_t = opts.acoustic_weight * posterior.Sum(),
               max_count_scale = 1.0;
           if (opts.max_count > 0 && this_t > opts.max_count) {
             max_count_scale = opts.max_count / this_t;
@@ -298,16 +326,22 @@ int main(int argc, char *argv[]) {
                       << opts.max_count;
             this_t = opts.max_count;
           }
-          ScalePosterior(opts.acoustic_weight * max_count_scale,
-                         &posterior);
+          posterior.Scale(opts.acoustic_weight * max_count_scale);
           // note: now, this_t == sum of posteriors.
 
-          sequencer.Run(new IvectorExtractTask(extractor, utt, mat, posterior,
-                                               &ivector_writer, auxf_ptr));
+          if (task == NULL)
+            task = new IvectorExtractTask(extractor, &ivector_writer, auxf_ptr);
+          task->AddUtterance(utt, mat, posterior);
+          if (task->NumUtterances() == batch_size) {
+            sequencer.Run(task);
+            task = NULL;
+          }
 
           tot_t += this_t;
           num_done++;
         }
+        if (task != NULL)
+          sequencer.Run(task);
         // Destructor of "sequencer" will wait for any remaining tasks.
       }
 
@@ -197,13 +197,13 @@ int main(int argc, char *argv[]) {
           TransformIvectors(ivector_mat, plda_config, this_plda,
           &ivector_mat_plda);
         }
-        for (int32 i = 0; i < ivector_mat_plda.NumRows(); i++) {
-          for (int32 j = 0; j < ivector_mat_plda.NumRows(); j++) {
-            scores(i, j) = this_plda.LogLikelihoodRatio(Vector<double>(
-              ivector_mat_plda.Row(i)), 1.0,
-              Vector<double>(ivector_mat_plda.Row(j)));
-          }
-        }
+        Matrix<double> ivector_mat_plda_dbl(ivector_mat_plda),
+                       scores_dbl(ivectors.size(), ivectors.size());
+        std::vector<int32> num_utts(ivectors.size(), 1);
+        PldaScorer scorer(this_plda, ivector_mat_plda_dbl, num_utts,
+          ivector_mat_plda_dbl);
+        scorer.LogLikelihoodRatios(0, 0, &scores_dbl);
+        scores.CopyFromMat(scores_dbl);
         scores_writer.Write(reco, scores);
         num_reco_done++;
       }
@@ -85,21 +85,24 @@ int main(int argc, char *argv[]) {
     SequentialBaseFloatVectorReader test_ivector_reader(test_ivector_rspecifier);
     RandomAccessInt32Reader num_utts_reader(num_utts_rspecifier);
 
-    typedef unordered_map<string, Vector<BaseFloat>*, StringHasher> HashType;
+    typedef unordered_map<string, int32, StringHasher> HashType;
 
-    // These hashes will contain the iVectors in the PLDA subspace
-    // (that makes the within-class variance unit and diagonalizes the
-    // between-class covariance).  They will also possibly be length-normalized,
-    // depending on the config.
-    HashType train_ivectors, test_ivectors;
+    // These hashes map the keys to rows of train_ivectors and test_ivectors,
+    // which will contain the iVectors in the PLDA subspace (that makes the
+    // within-class variance unit and diagonalizes the between-class
+    // covariance).  They will also possibly be length-normalized, depending on
+    // the config.
+    HashType train_index, test_index;
+    std::vector<Vector<double> > train_ivectors, test_ivectors;
+    std::vector<int32> num_train_utts;
 
     KALDI_LOG << "Reading train iVectors";
     for (; !train_ivector_reader.Done(); train_ivector_reader.Next()) {
       std::string spk = train_ivector_reader.Key();
-      if (train_ivectors.count(spk) != 0) {
+      if (train_index.count(spk) != 0) {
         KALDI_ERR << "Duplicate training iVector found for speaker " << spk;
       }
-      const Vector<BaseFloat> &ivector = train_ivector_reader.Value();
+      Vector<double> ivector(train_ivector_reader.Value());
       int32 num_examples;
       if (!num_utts_rspecifier.empty()) {
         if (!num_utts_reader.HasKey(spk)) {
@@ -111,12 +114,14 @@ int main(int argc, char *argv[]) {
       } else {
         num_examples = 1;
       }
-      Vector<BaseFloat> *transformed_ivector = new Vector<BaseFloat>(dim);
+      Vector<double> transformed_ivector(dim);
 
       tot_train_renorm_scale += plda.TransformIvector(plda_config, ivector,
                                                       num_examples,
-                                                      transformed_ivector);
-      train_ivectors[spk] = transformed_ivector;
+                                                      &transformed_ivector);
+      train_index[spk] = train_ivectors.size();
+      train_ivectors.push_back(transformed_ivector);
+      num_train_utts.push_back(num_examples);
       num_train_ivectors++;
     }
     KALDI_LOG << "Read " << num_train_ivectors << " training iVectors, "
@@ -129,19 +134,20 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << "Reading test iVectors";
     for (; !test_ivector_reader.Done(); test_ivector_reader.Next()) {
       std::string utt = test_ivector_reader.Key();
-      if (test_ivectors.count(utt) != 0) {
+      if (test_index.count(utt) != 0) {
         KALDI_ERR << "Duplicate test iVector found for utterance " << utt;
       }
-      const Vector<BaseFloat> &ivector = test_ivector_reader.Value();
+      Vector<double> ivector(test_ivector_reader.Value());
       int32 num_examples = 1; // this value is always used for test (affects the
                               // length normalization in the TransformIvector
                               // function).
-      Vector<BaseFloat> *transformed_ivector = new Vector<BaseFloat>(dim);
+      Vector<double> transformed_ivector(dim);
 
       tot_test_renorm_scale += plda.TransformIvector(plda_config, ivector,
                                                      num_examples,
-                                                     transformed_ivector);
-      test_ivectors[utt] = transformed_ivector;
+                                                     &transformed_ivector);
+      test_index[utt] = test_ivectors.size();
+      test_ivectors.push_back(transformed_ivector);
       num_test_ivectors++;
     }
     KALDI_LOG << "Read " << num_test_ivectors << " test iVectors.";
@@ -150,6 +156,17 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << "Average renormalization scale on test iVectors was "
               << (tot_test_renorm_scale / num_test_ivectors);
 
+    Matrix<double> train_mat(num_train_ivectors, dim, kUndefined),
+        test_mat(num_test_ivectors, dim, kUndefined);
+    for (int32 j = 0; j < num_train_ivectors; j++)
+      train_mat.Row(j).CopyFromVec(train_ivectors[j]);
+    for (int32 k = 0; k < num_test_ivectors; k++)
+      test_mat.Row(k).CopyFromVec(test_ivectors[k]);
+    train_ivectors.clear();
+    test_ivectors.clear();
+    // This gives the same scores as plda.LogLikelihoodRatio(), but with the
+    // per-iVector work done once instead of for each trial.
+    PldaScorer scorer(plda, train_mat, num_train_utts, test_mat);
 
     Input ki(trials_rxfilename);
     bool binary = false;
@@ -166,48 +183,26 @@ int main(int argc, char *argv[]) {
                   << "in input (expected two fields: key1 key2): " << line;
       }
       std::string key1 = fields[0], key2 = fields[1];
-      if (train_ivectors.count(key1) == 0) {
+      HashType::const_iterator train_iter = train_index.find(key1),
+          test_iter = test_index.find(key2);
+      if (train_iter == train_index.end()) {
         KALDI_WARN << "Key " << key1 << " not present in training iVectors.";
         num_trials_err++;
         continue;
       }
-      if (test_ivectors.count(key2) == 0) {
+      if (test_iter == test_index.end()) {
         KALDI_WARN << "Key " << key2 << " not present in test iVectors.";
         num_trials_err++;
         continue;
       }
-      const Vector<BaseFloat> *train_ivector = train_ivectors[key1],
-          *test_ivector = test_ivectors[key2];
-
-      Vector<double> train_ivector_dbl(*train_ivector),
-          test_ivector_dbl(*test_ivector);
-
-      int32 num_train_examples;
-      if (!num_utts_rspecifier.empty()) {
-        // we already checked that it has this key.
-        num_train_examples = num_utts_reader.Value(key1);
-      } else {
-        num_train_examples = 1;
-      }
-
-
-      BaseFloat score = plda.LogLikelihoodRatio(train_ivector_dbl,
-                                                num_train_examples,
-                                                test_ivector_dbl);
+      BaseFloat score = scorer.LogLikelihoodRatio(train_iter->second,
+                                                  test_iter->second);
       sum += score;
       sumsq += score * score;
       num_trials_done++;
       ko.Stream() << key1 << ' ' << key2 << ' ' << score << std::endl;
     }
 
-    for (HashType::iterator iter = train_ivectors.begin();
-         iter != train_ivectors.end(); ++iter)
-      delete iter->second;
-    for (HashType::iterator iter = test_ivectors.begin();
-         iter != test_ivectors.end(); ++iter)
-      delete iter->second;
-
-
     if (num_trials_done != 0) {
       BaseFloat mean = sum / num_trials_done, scatter = sumsq / num_trials_done,
           variance = scatter - mean * mean, stddev = sqrt(variance);
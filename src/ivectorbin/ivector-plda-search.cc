@@ -0,0 +1,239 @@
+// ivectorbin/ivector-plda-search.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <functional>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+#include "ivector/plda.h"
+
+namespace kaldi {
+
+// Finds the best train iVectors for a block of test iVectors.  The work
+// happens in the operator (), the output happens in the destructor.  The
+// scores are computed for block_size by block_size blocks of trials at a time,
+// keeping a heap of the best top_k for each test iVector, so the memory used
+// does not depend on the number of train iVectors.
+class PldaSearchTask {
+ public:
+  PldaSearchTask(const PldaScorer &scorer,
+                 const std::vector<std::string> &train_keys,
+                 const std::vector<std::string> &test_keys,
+                 int32 test_begin, int32 num_test, int32 top_k,
+                 int32 block_size, std::ostream *os):
+      scorer_(scorer), train_keys_(train_keys), test_keys_(test_keys),
+      test_begin_(test_begin), num_test_(num_test), top_k_(top_k),
+      block_size_(block_size), os_(os) { }
+
+  void operator () () {
+    // The heaps are min-heaps on the score, so the worst of the best top_k is
+    // at the front.
+    best_.resize(num_test_);
+    int32 num_train = scorer_.NumTrain();
+    Matrix<double> scores;
+    for (int32 train_begin = 0; train_begin < num_train;
+         train_begin += block_size_) {
+      int32 this_num_train = std::min(block_size_, num_train - train_begin);
+      scores.Resize(this_num_train, num_test_, kUndefined);
+      scorer_.LogLikelihoodRatios(train_begin, test_begin_, &scores);
+      for (int32 k = 0; k < num_test_; k++) {
+        std::vector<std::pair<double, int32> > &best = best_[k];
+        for (int32 j = 0; j < this_num_train; j++) {
+          std::pair<double, int32> p(scores(j, k), train_begin + j);
+          if (static_cast<int32>(best.size()) < top_k_) {
+            best.push_back(p);
+            std::push_heap(best.begin(), best.end(),
+                           std::greater<std::pair<double, int32> >());
+          } else if (p.first > best.front().first) {
+            std::pop_heap(best.begin(), best.end(),
+                          std::greater<std::pair<double, int32> >());
+            best.back() = p;
+            std::push_heap(best.begin(), best.end(),
+                           std::greater<std::pair<double, int32> >());
+          }
+        }
+      }
+    }
+    for (int32 k = 0; k < num_test_; k++)
+      std::sort(best_[k].begin(), best_[k].end(),
+                std::greater<std::pair<double, int32> >());
+  }
+
+  ~PldaSearchTask() {
+    for (int32 k = 0; k < num_test_; k++) {
+      const std::string &test_key = test_keys_[test_begin_ + k];
+      for (size_t b = 0; b < best_[k].size(); b++)
+        *os_ << train_keys_[best_[k][b].second] << ' ' << test_key << ' '
+             << static_cast<BaseFloat>(best_[k][b].first) << std::endl;
+    }
+  }
+
+ private:
+  const PldaScorer &scorer_;
+  const std::vector<std::string> &train_keys_;
+  const std::vector<std::string> &test_keys_;
+  int32 test_begin_;
+  int32 num_test_;
+  int32 top_k_;
+  int32 block_size_;
+  std::ostream *os_;
+  std::vector<std::vector<std::pair<double, int32> > > best_;
+};
+
+}  // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  typedef kaldi::int32 int32;
+  try {
+    const char *usage =
+        "For each test iVector, finds the train iVectors with the highest PLDA\n"
+        "log-likelihood ratios, without needing a list of trials.  The output\n"
+        "has lines of the form\n"
+        "<train-key> <test-key> <log-likelihood-ratio>\n"
+        "as for ivector-plda-scoring, with the --top-k best train iVectors for\n"
+        "each test iVector, best first.  The train iVectors are averaged over\n"
+        "speakers, as for ivector-plda-scoring, and --num-utts has the same\n"
+        "meaning.\n"
+        "\n"
+        "Usage: ivector-plda-search <plda> <train-ivector-rspecifier> "
+        "<test-ivector-rspecifier>\n"
+        " <scores-wxfilename>\n"
+        "\n"
+        "e.g.: ivector-plda-search --top-k=5 --num-threads=4 "
+        "--num-utts=ark:exp/train/num_utts.ark plda\n"
+        " ark:exp/train/spk_ivectors.ark ark:exp/test/ivectors.ark scores\n"
+        "See also: ivector-plda-scoring\n";
+
+    ParseOptions po(usage);
+
+    std::string num_utts_rspecifier;
+    int32 top_k = 10, block_size = 256;
+    PldaConfig plda_config;
+    TaskSequencerConfig sequencer_config;
+    plda_config.Register(&po);
+    sequencer_config.Register(&po);
+    po.Register("num-utts", &num_utts_rspecifier, "Table to read the number of "
+                "utterances per speaker, e.g. ark:num_utts.ark\n");
+    po.Register("top-k", &top_k, "Number of train iVectors to output for each "
+                "test iVector.");
+    po.Register("block-size", &block_size, "The scores are computed for this "
+                "many train by this many test iVectors at a time.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (top_k < 1 || block_size < 1)
+      KALDI_ERR << "--top-k and --block-size must be at least 1.";
+
+    std::string plda_rxfilename = po.GetArg(1),
+        train_ivector_rspecifier = po.GetArg(2),
+        test_ivector_rspecifier = po.GetArg(3),
+        scores_wxfilename = po.GetArg(4);
+
+    Plda plda;
+    ReadKaldiObject(plda_rxfilename, &plda);
+    int32 dim = plda.Dim();
+
+    SequentialBaseFloatVectorReader train_ivector_reader(
+        train_ivector_rspecifier);
+    SequentialBaseFloatVectorReader test_ivector_reader(
+        test_ivector_rspecifier);
+    RandomAccessInt32Reader num_utts_reader(num_utts_rspecifier);
+
+    // The iVectors in the PLDA subspace, possibly length-normalized depending
+    // on the config (as in ivector-plda-scoring).
+    std::vector<std::string> train_keys, test_keys;
+    std::vector<Vector<double> > train_ivectors, test_ivectors;
+    std::vector<int32> num_train_utts;
+    int64 num_train_errs = 0;
+
+    for (; !train_ivector_reader.Done(); train_ivector_reader.Next()) {
+      std::string spk = train_ivector_reader.Key();
+      int32 num_examples = 1;
+      if (!num_utts_rspecifier.empty()) {
+        if (!num_utts_reader.HasKey(spk)) {
+          KALDI_WARN << "Number of utterances not given for speaker " << spk;
+          num_train_errs++;
+          continue;
+        }
+        num_examples = num_utts_reader.Value(spk);
+      }
+      Vector<double> ivector(train_ivector_reader.Value()),
+          transformed_ivector(dim);
+      plda.TransformIvector(plda_config, ivector, num_examples,
+                            &transformed_ivector);
+      train_keys.push_back(spk);
+      train_ivectors.push_back(transformed_ivector);
+      num_train_utts.push_back(num_examples);
+    }
+    KALDI_LOG << "Read " << train_keys.size() << " training iVectors, "
+              << "errors on " << num_train_errs;
+    if (train_keys.empty())
+      KALDI_ERR << "No training iVectors present.";
+
+    for (; !test_ivector_reader.Done(); test_ivector_reader.Next()) {
+      Vector<double> ivector(test_ivector_reader.Value()),
+          transformed_ivector(dim);
+      plda.TransformIvector(plda_config, ivector, 1, &transformed_ivector);
+      test_keys.push_back(test_ivector_reader.Key());
+      test_ivectors.push_back(transformed_ivector);
+    }
+    KALDI_LOG << "Read " << test_keys.size() << " test iVectors.";
+    if (test_keys.empty())
+      KALDI_ERR << "No test iVectors present.";
+
+    int32 num_train = train_keys.size(), num_test = test_keys.size();
+    Matrix<double> train_mat(num_train, dim, kUndefined),
+        test_mat(num_test, dim, kUndefined);
+    for (int32 j = 0; j < num_train; j++)
+      train_mat.Row(j).CopyFromVec(train_ivectors[j]);
+    for (int32 k = 0; k < num_test; k++)
+      test_mat.Row(k).CopyFromVec(test_ivectors[k]);
+    train_ivectors.clear();
+    test_ivectors.clear();
+    PldaScorer scorer(plda, train_mat, num_train_utts, test_mat);
+
+    bool binary = false;
+    Output ko(scores_wxfilename, binary);
+    {
+      TaskSequencer<PldaSearchTask> sequencer(sequencer_config);
+      for (int32 test_begin = 0; test_begin < num_test;
+           test_begin += block_size)
+        sequencer.Run(new PldaSearchTask(
+            scorer, train_keys, test_keys, test_begin,
+            std::min(block_size, num_test - test_begin), top_k, block_size,
+            &ko.Stream()));
+      // Destructor of "sequencer" will wait for any remaining tasks.
+    }
+    KALDI_LOG << "Searched " << num_train << " train iVectors for each of "
+              << num_test << " test iVectors.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
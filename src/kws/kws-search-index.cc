@@ -0,0 +1,127 @@
+// kws/kws-search-index.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "kws/kws-search-index.h"
+
+#include <vector>
+
+#include "fst/fstlib.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+
+void PrepareIndexForSearch(KwsLexicographicFst *index,
+                           unordered_map<uint32, uint64> *label_decoder) {
+  typedef KwsLexicographicArc Arc;
+  typedef Arc::Weight Weight;
+  // Note that in Dogan and Murat's original paper, they simply remove the
+  // disambiguation symbol on the input symbol side, which will not allow us
+  // to do epsilon removal after composition with the keyword FST. They have
+  // to traverse the resulting FST.
+  uint32 label_count = 1;
+  unordered_map<uint64, uint32> label_encoder;
+  label_decoder->clear();
+  for (fst::StateIterator<KwsLexicographicFst> siter(*index);
+       !siter.Done(); siter.Next()) {
+    Arc::StateId state_id = siter.Value();
+    for (fst::MutableArcIterator<KwsLexicographicFst> aiter(index, state_id);
+         !aiter.Done(); aiter.Next()) {
+      Arc arc = aiter.Value();
+      // Skip the non-final arcs
+      if (index->Final(arc.nextstate) == Weight::Zero())
+        continue;
+      // Encode the input and output label of the final arc, and this is the
+      // new output label for this arc; set the input label to <epsilon>
+      uint64 osymbol = EncodeLabel(arc.ilabel, arc.olabel);
+      arc.ilabel = 0;
+      unordered_map<uint64, uint32>::const_iterator iter =
+          label_encoder.find(osymbol);
+      if (iter == label_encoder.end()) {
+        arc.olabel = label_count;
+        label_encoder[osymbol] = label_count;
+        (*label_decoder)[label_count] = osymbol;
+        label_count++;
+      } else {
+        arc.olabel = iter->second;
+      }
+      aiter.SetValue(arc);
+    }
+  }
+  fst::ArcSort(index, fst::ILabelCompare<Arc>());
+}
+
+void WriteKwsSearchIndex(const KwsLexicographicFst &index,
+                         const unordered_map<uint32, uint64> &label_decoder,
+                         const std::string &wxfilename) {
+  // the labels are numbered from one.
+  std::vector<uint64> decoder(label_decoder.size());
+  for (unordered_map<uint32, uint64>::const_iterator iter =
+           label_decoder.begin(); iter != label_decoder.end(); ++iter) {
+    KALDI_ASSERT(iter->first >= 1 && iter->first <= decoder.size());
+    decoder[iter->first - 1] = iter->second;
+  }
+
+  bool binary = true;
+  Output ko(wxfilename, binary);
+  WriteToken(ko.Stream(), binary, "<KwsSearchIndex>");
+  WriteIntegerVector(ko.Stream(), binary, decoder);
+  WriteToken(ko.Stream(), binary, "<Fst>");
+  fst::ConstFst<KwsLexicographicArc> const_index(index);
+  fst::FstWriteOptions write_opts(PrintableWxfilename(wxfilename));
+  // the arrays have to be aligned to be mapped.
+  write_opts.align = true;
+  if (!const_index.Write(ko.Stream(), write_opts))
+    KALDI_ERR << "Error writing the search index to "
+              << PrintableWxfilename(wxfilename)
+              << " (it has to be written to a file, not a pipe)";
+  ko.Close();
+}
+
+fst::Fst<KwsLexicographicArc> *ReadKwsSearchIndex(
+    const std::string &rxfilename,
+    unordered_map<uint32, uint64> *label_decoder) {
+  bool binary;
+  Input ki(rxfilename, &binary);
+  if (!binary)
+    KALDI_ERR << "Expected a search index (from kws-index-to-search-index) in "
+              << PrintableRxfilename(rxfilename);
+  ExpectToken(ki.Stream(), binary, "<KwsSearchIndex>");
+  std::vector<uint64> decoder;
+  ReadIntegerVector(ki.Stream(), binary, &decoder);
+  label_decoder->clear();
+  for (size_t i = 0; i < decoder.size(); i++)
+    (*label_decoder)[i + 1] = decoder[i];
+  ExpectToken(ki.Stream(), binary, "<Fst>");
+
+  fst::FstReadOptions read_opts(PrintableRxfilename(rxfilename));
+  if (ClassifyRxfilename(rxfilename) == kFileInput) {
+    // the FST is then mapped from the file at the current position of the
+    // stream.
+    read_opts.source = rxfilename;
+    read_opts.mode = fst::FstReadOptions::MAP;
+  }
+  fst::ConstFst<KwsLexicographicArc> *index =
+      fst::ConstFst<KwsLexicographicArc>::Read(ki.Stream(), read_opts);
+  if (index == NULL)
+    KALDI_ERR << "Error reading the search index from "
+              << PrintableRxfilename(rxfilename);
+  return index;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,69 @@
+// kws/kws-search-index.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_KWS_KWS_SEARCH_INDEX_H_
+#define KALDI_KWS_KWS_SEARCH_INDEX_H_
+
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "util/stl-utils.h"
+#include "kws/kaldi-kws.h"
+
+namespace kaldi {
+
+/// Encodes the (ilabel, olabel) pair of a final arc of the index, i.e. the
+/// disambiguation symbol and the utterance id, as a single 64-bit symbol.
+inline uint64 EncodeLabel(int32 ilabel, int32 olabel) {
+  return (static_cast<int64>(olabel) << 32) + static_cast<int64>(ilabel);
+}
+
+/// The utterance id of a symbol from EncodeLabel().
+inline int32 DecodeLabelUid(uint64 osymbol) {
+  return static_cast<int32>(osymbol >> 32);
+}
+
+/// Prepares the index (as output by kws-index-union) for kws-search: the
+/// disambiguation symbols are not removed, but moved from the input side of
+/// the final arcs to the output side, each output label being replaced by a
+/// new label for the (disambiguation symbol, utterance id) pair, so that
+/// epsilon removal can still be done after composing with a keyword.
+/// label_decoder is set to map the new labels back to the pairs, as encoded
+/// by EncodeLabel().  Then the index is sorted on its input labels.
+void PrepareIndexForSearch(KwsLexicographicFst *index,
+                           unordered_map<uint32, uint64> *label_decoder);
+
+/// Writes a search index: label_decoder from PrepareIndexForSearch(), then
+/// the index as a ConstFst with its arrays aligned, so that it can be mapped
+/// into memory by ReadKwsSearchIndex() instead of being read.
+void WriteKwsSearchIndex(const KwsLexicographicFst &index,
+                         const unordered_map<uint32, uint64> &label_decoder,
+                         const std::string &wxfilename);
+
+/// Reads a search index as written by WriteKwsSearchIndex().  If rxfilename
+/// is a file, the FST is mapped into memory rather than copied, so it is
+/// loaded in no time whatever its size, and its pages are shared by all the
+/// processes that search it.  The caller owns the returned FST.
+fst::Fst<KwsLexicographicArc> *ReadKwsSearchIndex(
+    const std::string &rxfilename,
+    unordered_map<uint32, uint64> *label_decoder);
+
+}  // namespace kaldi
+
+#endif  // KALDI_KWS_KWS_SEARCH_INDEX_H_
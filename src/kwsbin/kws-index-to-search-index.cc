@@ -0,0 +1,75 @@
+// kwsbin/kws-index-to-search-index.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fstext/kaldi-fst-io.h"
+#include "kws/kaldi-kws.h"
+#include "kws/kws-search-index.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    typedef kaldi::uint32 uint32;
+    typedef kaldi::uint64 uint64;
+
+    const char *usage =
+        "Convert the index from kws-index-union to the form searched by\n"
+        "kws-search as it is written: with the disambiguation symbols moved\n"
+        "to the output side, sorted, and as a ConstFst whose arrays kws-search\n"
+        "maps into memory instead of reading, so that searches of a large\n"
+        "index do not have to wait for it to be loaded.  The output has to be\n"
+        "a file, and is in the byte order of this machine.\n"
+        "\n"
+        "Usage: kws-index-to-search-index [options] <index-rspecifier> "
+        "<search-index-out>\n"
+        " e.g.: kws-index-to-search-index ark:global.idx global.sidx\n"
+        "See also: kws-index-union, kws-search\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string index_rspecifier = po.GetArg(1),
+        search_index_wxfilename = po.GetArg(2);
+
+    RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> >
+                                                index_reader(index_rspecifier);
+    // Index has key "global"
+    KwsLexicographicFst index = index_reader.Value("global");
+
+    unordered_map<uint32, uint64> label_decoder;
+    PrepareIndexForSearch(&index, &label_decoder);
+    WriteKwsSearchIndex(index, label_decoder, search_index_wxfilename);
+
+    KALDI_LOG << "Wrote search index with " << index.NumStates()
+              << " states and " << label_decoder.size() << " final labels to "
+              << PrintableWxfilename(search_index_wxfilename);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
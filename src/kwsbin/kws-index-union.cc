@@ -23,6 +23,47 @@
 #include "fstext/fstext-utils.h"
 #include "kws/kaldi-kws.h"
 #include "kws/kws-functions.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// Does the encoded epsilon removal, determinization and minimization of the
+// index.
+void OptimizeIndex(int32 max_states, KwsLexicographicFst *index) {
+  using namespace fst;
+  KwsLexicographicFst ifst = *index;
+  EncodeMapper<KwsLexicographicArc> encoder(kEncodeLabels, ENCODE);
+  Encode(&ifst, &encoder);
+  try {
+    DeterminizeStar(ifst, index, kDelta, NULL, max_states);
+  } catch(const std::exception &e) {
+    KALDI_WARN << e.what()
+               << " (should affect speed of search but not results)";
+    *index = ifst;
+  }
+  Minimize(index, static_cast<KwsLexicographicFst*>(NULL), kDelta, true);
+  Decode(index, encoder);
+}
+
+// Optimizes the shards of the index, shared out among the threads.
+class OptimizeShardsClass: public MultiThreadable {
+ public:
+  OptimizeShardsClass(int32 max_states,
+                      std::vector<KwsLexicographicFst> *shards):
+      max_states_(max_states), shards_(shards) { }
+
+  void operator () () {
+    for (size_t i = thread_id_; i < shards_->size(); i += num_threads_)
+      if ((*shards_)[i].Start() != fst::kNoStateId)  // there may be no indices.
+        OptimizeIndex(max_states_, &((*shards_)[i]));
+  }
+
+ private:
+  int32 max_states_;
+  std::vector<KwsLexicographicFst> *shards_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -39,19 +80,25 @@ int main(int argc, char *argv[]) {
         "epsilon removal, determinization and minimization will be applied.\n"
         "\n"
         "Usage: kws-index-union [options]  index-rspecifier index-wspecifier\n"
-        " e.g.: kws-index-union ark:input.idx ark:global.idx\n";
+        " e.g.: kws-index-union ark:input.idx ark:global.idx\n"
+        "With --num-threads=N, the indices are shared out among N shards\n"
+        "whose unions are optimized in parallel, before the optimization of\n"
+        "their union, which is then much smaller than that of the indices.\n";
 
     ParseOptions po(usage);
 
     bool strict = true;
     bool skip_opt = false;
     int32 max_states = -1;
+    int32 num_threads = 1;
     po.Register("strict", &strict,
         "Will allow 0 lattice if it is set to false.");
     po.Register("skip-optimization", &skip_opt,
         "Skip optimization if it's set to true.");
     po.Register("max-states", &max_states,
         "Maximum states for DeterminizeStar.");
+    po.Register("num-threads", &num_threads,
+        "Number of threads (and shards of the index) to optimize with.");
 
     po.Read(argc, argv);
 
@@ -68,32 +115,37 @@ int main(int argc, char *argv[]) {
     TableWriter< VectorFstTplHolder<KwsLexicographicArc> >
                                                 index_writer(index_wspecifier);
 
+    if (skip_opt)
+      num_threads = 1;
+    KALDI_ASSERT(num_threads >= 1);
+
     int32 n_done = 0;
-    KwsLexicographicFst global_index;
+    // with one thread, there is a single shard, which is the global index.
+    std::vector<KwsLexicographicFst> shards(num_threads);
     for (; !index_reader.Done(); index_reader.Next()) {
       std::string key = index_reader.Key();
       KwsLexicographicFst index = index_reader.Value();
       index_reader.FreeCurrent();
 
-      Union(&global_index, index);
+      Union(&(shards[n_done % num_threads]), index);
 
       n_done++;
     }
 
-    if (skip_opt == false) {
-      // Do the encoded epsilon removal, determinization and minimization
-      KwsLexicographicFst ifst = global_index;
-      EncodeMapper<KwsLexicographicArc> encoder(kEncodeLabels, ENCODE);
-      Encode(&ifst, &encoder);
-      try {
-        DeterminizeStar(ifst, &global_index, kDelta, NULL, max_states);
-      } catch(const std::exception &e) {
-        KALDI_WARN << e.what()
-                   << " (should affect speed of search but not results)";
-        global_index = ifst;
+    KwsLexicographicFst global_index;
+    if (num_threads == 1) {
+      global_index = shards[0];
+    } else {
+      OptimizeShardsClass c(max_states, &shards);
+      { MultiThreader<OptimizeShardsClass> m(num_threads, c); }
+      for (int32 i = 0; i < num_threads; i++) {
+        Union(&global_index, shards[i]);
+        shards[i].DeleteStates();
       }
-      Minimize(&global_index, static_cast<KwsLexicographicFst*>(NULL), kDelta, true);
-      Decode(&global_index, encoder);
+    }
+
+    if (skip_opt == false) {
+      OptimizeIndex(max_states, &global_index);
     } else {
       KALDI_LOG << "Skipping index optimization...";
     }
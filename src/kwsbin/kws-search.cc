@@ -24,6 +24,7 @@
 #include "util/common-utils.h"
 #include "fstext/kaldi-fst-io.h"
 #include "kws/kaldi-kws.h"
+#include "kws/kws-search-index.h"
 
 namespace kaldi {
 
@@ -31,18 +32,6 @@ typedef KwsLexicographicArc Arc;
 typedef Arc::Weight Weight;
 typedef Arc::StateId StateId;
 
-// encode ilabel, olabel pair as a single 64bit (output) symbol
-uint64 EncodeLabel(StateId ilabel, StateId olabel) {
-  return (static_cast<int64>(olabel) << 32) + static_cast<int64>(ilabel);
-}
-
-// extract the osymbol from the 64bit symbol. That represents the utterance id
-// in this setup -- we throw away the isymbol which is typically 0 or an
-// disambiguation symbol
-StateId DecodeLabelUid(uint64 osymbol) {
-  return static_cast<StateId>(osymbol >> 32);
-}
-
 // this is a mapper adapter that helps converting
 // between the StdArc FST (i.e. tropical semiring FST)
 // to the KwsLexicographic FST. Structure will be kept,
@@ -167,7 +156,9 @@ int main(int argc, char *argv[]) {
         "Search the keywords over the index. This program can be executed\n"
         "in parallel, either on the index side or the keywords side; we use\n"
         "a script to combine the final search results. Note that the index\n"
-        "archive has a single key \"global\".\n\n"
+        "archive has a single key \"global\".  If <index-rspecifier> is a\n"
+        "filename rather than an rspecifier, it is a search index from\n"
+        "kws-index-to-search-index, which is mapped into memory.\n\n"
         "Search has one or two outputs. The first one is mandatory and will\n"
         "contain the seach output, i.e. list of all found keyword instances\n"
         "The file is in the following format:\n"
@@ -188,7 +179,8 @@ int main(int argc, char *argv[]) {
         "Usage: kws-search [options] <index-rspecifier> <keywords-rspecifier> "
         "<results-wspecifier> [<stats_wspecifier>]\n"
         " e.g.: kws-search ark:index.idx ark:keywords.fsts "
-                           "ark:results ark:stats\n";
+                           "ark:results ark:stats\n"
+        "   or: kws-search index.sidx ark:keywords.fsts ark:results\n";
 
     ParseOptions po(usage);
 
@@ -238,52 +230,29 @@ int main(int argc, char *argv[]) {
         result_wspecifier = po.GetArg(3),
         stats_wspecifier = po.GetOptArg(4);
 
-    RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> >
-                                                index_reader(index_rspecifier);
     SequentialTableReader<VectorFstHolder> keyword_reader(keyword_rspecifier);
     VectorOfDoublesWriter result_writer(result_wspecifier);
     VectorOfDoublesWriter stats_writer(stats_wspecifier);
 
-
-    // Index has key "global"
-    KwsLexicographicFst index = index_reader.Value("global");
-
     // First we have to remove the disambiguation symbols. But rather than
     // removing them totally, we actually move them from input side to output
     // side, making the output symbol a "combined" symbol of the disambiguation
-    // symbols and the utterance id's.
-    // Note that in Dogan and Murat's original paper, they simply remove the
-    // disambiguation symbol on the input symbol side, which will not allow us
-    // to do epsilon removal after composition with the keyword FST. They have
-    // to traverse the resulting FST.
-    int32 label_count = 1;
-    unordered_map<uint64, uint32> label_encoder;
+    // symbols and the utterance id's.  A search index from
+    // kws-index-to-search-index has had this done already, and is mapped
+    // into memory rather than read.
+    Fst<KwsLexicographicArc> *index = NULL;
     unordered_map<uint32, uint64> label_decoder;
-    for (StateIterator<KwsLexicographicFst> siter(index);
-                                           !siter.Done(); siter.Next()) {
-      StateId state_id = siter.Value();
-      for (MutableArcIterator<KwsLexicographicFst>
-           aiter(&index, state_id); !aiter.Done(); aiter.Next()) {
-        KwsLexicographicArc arc = aiter.Value();
-        // Skip the non-final arcs
-        if (index.Final(arc.nextstate) == Weight::Zero())
-          continue;
-        // Encode the input and output label of the final arc, and this is the
-        // new output label for this arc; set the input label to <epsilon>
-        uint64 osymbol = EncodeLabel(arc.ilabel, arc.olabel);
-        arc.ilabel = 0;
-        if (label_encoder.find(osymbol) == label_encoder.end()) {
-          arc.olabel = label_count;
-          label_encoder[osymbol] = label_count;
-          label_decoder[label_count] = osymbol;
-          label_count++;
-        } else {
-          arc.olabel = label_encoder[osymbol];
-        }
-        aiter.SetValue(arc);
-      }
+    if (ClassifyRspecifier(index_rspecifier, NULL, NULL) == kNoRspecifier) {
+      index = ReadKwsSearchIndex(index_rspecifier, &label_decoder);
+    } else {
+      RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> >
+          index_reader(index_rspecifier);
+      // Index has key "global"
+      KwsLexicographicFst *vector_index =
+          new KwsLexicographicFst(index_reader.Value("global"));
+      PrepareIndexForSearch(vector_index, &label_decoder);
+      index = vector_index;
     }
-    ArcSort(&index, fst::ILabelCompare<KwsLexicographicArc>());
 
     int32 n_done = 0;
     int32 n_fail = 0;
@@ -305,7 +274,7 @@ int main(int argc, char *argv[]) {
       KwsLexicographicFst keyword_fst;
       KwsLexicographicFst result_fst;
       Map(keyword, &keyword_fst, VectorFstToKwsLexicographicFstMapper());
-      Compose(keyword_fst, index, &result_fst);
+      Compose(keyword_fst, *index, &result_fst);
 
       if (stats_wspecifier != "") {
         KwsLexicographicFst matched_seq(result_fst);
@@ -362,6 +331,7 @@ int main(int argc, char *argv[]) {
       n_done++;
     }
 
+    delete index;
     KALDI_LOG << "Done " << n_done << " keywords";
     if (strict == true)
       return (n_done != 0 ? 0 : 1);
@@ -27,6 +27,22 @@
 #include "kws/kaldi-kws.h"
 #include "kws/kws-functions.h"
 #include "fstext/epsilon-property.h"
+#include "lat/lattice-table-driver.h"
+#include <mutex>
+
+namespace kaldi {
+
+// The index of a lattice.
+struct KwsIndexResult {
+  bool ok;
+  // it is still indexed if the factor transducer could not be made, but this
+  // counts as a failure too.
+  bool factor_transducer_failed;
+  KwsLexicographicFst index;
+  KwsIndexResult(): ok(false), factor_transducer_failed(false) { }
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -44,7 +60,8 @@ int main(int argc, char *argv[]) {
         "Usage: lattice-to-kws-index [options]  "
         " <utter-symtab-rspecifier> <lattice-rspecifier> <index-wspecifier>\n"
         "e.g.: \n"
-        " lattice-to-kws-index ark:utter.symtab ark:1.lats ark:global.idx\n";
+        " lattice-to-kws-index ark:utter.symtab ark:1.lats ark:global.idx\n"
+        "With --num-threads, the lattices are indexed in parallel.\n";
 
     ParseOptions po(usage);
 
@@ -69,6 +86,8 @@ int main(int argc, char *argv[]) {
                 "limit on the number of states.");
     po.Register("allow-partial", &allow_partial, "Allow partial output if fails"
                 " to determinize, otherwise skip determinization if it fails.");
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -96,24 +115,31 @@ int main(int argc, char *argv[]) {
     int32 n_done = 0;
     int32 n_fail = 0;
 
-    int32 max_states = -1;
+    // the random-access reader is used from the threads.
+    std::mutex reader_mutex;
 
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
+    ProcessLatticeTable<CompactLatticeHolder, KwsIndexResult>(
+        sequencer_config, &clat_reader,
+        [&](const std::string &key, CompactLattice *clat_in,
+            KwsIndexResult *result) {
+      CompactLattice &clat = *clat_in;
       KALDI_LOG << "Processing lattice " << key;
 
+      int32 max_states = -1;
       if (max_states_scale > 0) {
         max_states = static_cast<int32>(
             max_states_scale * static_cast<BaseFloat>(clat.NumStates()));
       }
 
       // Check if we have the corresponding utterance id.
-      if (!usymtab_reader.HasKey(key)) {
-        KALDI_WARN << "Cannot find utterance id for " << key;
-        n_fail++;
-        continue;
+      int32 utterance_id;
+      {
+        std::lock_guard<std::mutex> lock(reader_mutex);
+        if (!usymtab_reader.HasKey(key)) {
+          KALDI_WARN << "Cannot find utterance id for " << key;
+          return;
+        }
+        utterance_id = usymtab_reader.Value(key);
       }
 
       // Topologically sort the lattice, if not already sorted.
@@ -121,8 +147,7 @@ int main(int argc, char *argv[]) {
       if (!(props & fst::kTopSorted)) {
         if (fst::TopSort(&clat) == false) {
           KALDI_WARN << "Cycles detected in lattice " << key;
-          n_fail++;
-          continue;
+          return;
         }
       }
 
@@ -142,8 +167,7 @@ int main(int argc, char *argv[]) {
       if (!success) {
         KALDI_WARN << "State id's and alignments do not match for lattice "
                    << key;
-        n_fail++;
-        continue;
+        return;
       }
 
       // The next part is something new, not in the Dogan and Can paper.  It is
@@ -169,14 +193,13 @@ int main(int argc, char *argv[]) {
       // this function as we have to compute the alphas and betas anyway.
       KALDI_VLOG(1) << "Generating factor transducer...";
       KwsProductFst factor_transducer;
-      int32 utterance_id = usymtab_reader.Value(key);
       success = kaldi::CreateFactorTransducer(clat,
                                               state_times,
                                               utterance_id,
                                               &factor_transducer);
       if (!success) {
         KALDI_WARN << "Cannot generate factor transducer for lattice " << key;
-        n_fail++;
+        result->factor_transducer_failed = true;
       }
 
       MaybeDoSanityCheck(factor_transducer);
@@ -192,7 +215,7 @@ int main(int argc, char *argv[]) {
       // Do factor merging, and return a transducer in T*T*T semiring. This step
       // corresponds to the "Factor Merging" part in Dogan and Murat's paper.
       KALDI_VLOG(1) << "Merging factors...";
-      KwsLexicographicFst index_transducer;
+      KwsLexicographicFst &index_transducer = result->index;
       DoFactorMerging(&factor_transducer, &index_transducer);
 
       MaybeDoSanityCheck(index_transducer);
@@ -210,12 +233,17 @@ int main(int argc, char *argv[]) {
       OptimizeFactorTransducer(&index_transducer, max_states, allow_partial);
 
       MaybeDoSanityCheck(index_transducer);
-
+      result->ok = true;
+    },
+        [&](const std::string &key, KwsIndexResult *result) {
+      if (result->factor_transducer_failed || !result->ok)
+        n_fail++;
+      if (!result->ok)
+        return;
       // Write result
-      index_writer.Write(key, index_transducer);
-
+      index_writer.Write(key, result->index);
       n_done++;
-    }
+    });
 
     KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
     if (strict == true)
@@ -0,0 +1,141 @@
+// lat/const-compact-lattice-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "lat/const-compact-lattice.h"
+#include "fstext/rand-fst.h"
+
+
+namespace kaldi {
+
+
+CompactLattice *RandCompactLattice() {
+  Lattice *fst = fst::RandPairFst<LatticeArc>();
+  CompactLattice *cfst = new CompactLattice;
+  ConvertLattice(*fst, cfst);
+  delete fst;
+  return cfst;
+}
+
+void TestConstCompactLatticeCopy() {
+  CompactLattice *clat = RandCompactLattice();
+  ConstCompactLattice cclat(*clat);
+  // the generic Fst interface.
+  KALDI_ASSERT(fst::Equal(*clat, cclat));
+  KALDI_ASSERT(cclat.NumStates() == clat->NumStates() &&
+               cclat.Start() == clat->Start());
+  for (int32 s = 0; s < clat->NumStates(); s++) {
+    KALDI_ASSERT(cclat.NumArcs(s) == clat->NumArcs(s) &&
+                 cclat.NumInputEpsilons(s) == clat->NumInputEpsilons(s) &&
+                 cclat.NumOutputEpsilons(s) == clat->NumOutputEpsilons(s) &&
+                 cclat.Final(s) == clat->Final(s));
+  }
+  KALDI_ASSERT(cclat.Properties(fst::kAcceptor, true) ==
+               clat->Properties(fst::kAcceptor, true));
+
+  CompactLattice clat2;
+  cclat.CopyTo(&clat2);
+  KALDI_ASSERT(fst::Equal(*clat, clat2));
+
+  // Copies share the data.
+  fst::Fst<CompactLatticeArc> *copy = cclat.Copy();
+  KALDI_ASSERT(fst::Equal(*clat, *copy));
+  delete copy;
+  delete clat;
+}
+
+void TestConstCompactLatticeIo(bool binary) {
+  CompactLattice *clat = RandCompactLattice();
+  std::ostringstream os1, os2;
+  WriteCompactLattice(os1, binary, *clat);
+  ConstCompactLattice cclat(*clat);
+  cclat.Write(os2, binary);
+  if (binary)  // the output is the same as that of VectorFst.
+    KALDI_ASSERT(os1.str() == os2.str());
+
+  std::istringstream is(os1.str());
+  ConstCompactLattice cclat2;
+  KALDI_ASSERT(cclat2.Read(is, binary));
+  KALDI_ASSERT(fst::Equal(*clat, cclat2));
+  delete clat;
+}
+
+// Write as CompactLattice, read as ConstCompactLattice, and the other way.
+void TestConstCompactLatticeTable(bool binary) {
+  int N = 10;
+  std::vector<CompactLattice*> lat_vec(N);
+  {
+    CompactLatticeWriter writer(binary ? "ark:tmpf" : "ark,t:tmpf");
+    for (int i = 0; i < N; i++) {
+      std::string key = "key" + std::to_string(i);
+      lat_vec[i] = RandCompactLattice();
+      writer.Write(key, *(lat_vec[i]));
+    }
+  }
+  {
+    SequentialConstCompactLatticeReader reader("ark:tmpf");
+    ConstCompactLatticeWriter writer(binary ? "ark:tmpf2" : "ark,t:tmpf2");
+    for (int i = 0; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(fst::Equal(reader.Value(), *(lat_vec[i])));
+      writer.Write(reader.Key(), reader.Value());
+    }
+  }
+  RandomAccessCompactLatticeReader reader("ark:tmpf2");
+  for (int i = 0; i < N; i++) {
+    std::string key = "key" + std::to_string(i);
+    KALDI_ASSERT(fst::Equal(reader.Value(key), *(lat_vec[i])));
+    delete lat_vec[i];
+  }
+}
+
+// A lattice in double precision is read through the general code.
+void TestConstCompactLatticeDouble() {
+  CompactLattice *clat = RandCompactLattice();
+  fst::VectorFst<fst::ArcTpl<fst::CompactLatticeWeightTpl<
+    fst::LatticeWeightTpl<double>, int32> > > dclat;
+  ConvertLattice(*clat, &dclat);
+  std::ostringstream os;
+  dclat.Write(os, fst::FstWriteOptions());
+  std::istringstream is(os.str());
+  ConstCompactLattice cclat;
+  KALDI_ASSERT(cclat.Read(is, true));
+  KALDI_ASSERT(fst::Equal(*clat, cclat));
+  delete clat;
+}
+
+
+} // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 10; i++) {
+    TestConstCompactLatticeCopy();
+    TestConstCompactLatticeDouble();
+  }
+  for (int i = 0; i < 2; i++) {
+    bool binary = (i%2 == 0);
+    for (int j = 0; j < 5; j++)
+      TestConstCompactLatticeIo(binary);
+    TestConstCompactLatticeTable(binary);
+  }
+  std::cout << "Test OK\n";
+
+  unlink("tmpf");
+  unlink("tmpf2");
+}
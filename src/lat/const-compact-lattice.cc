@@ -0,0 +1,316 @@
+// lat/const-compact-lattice.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fst/test-properties.h>
+
+#include "lat/const-compact-lattice.h"
+
+namespace kaldi {
+
+namespace {
+
+// The iterator that InitArcIterator() gives to the code that only knows the
+// FST as an fst::Fst<CompactLatticeArc>.
+class ConstCompactLatticeArcIterator:
+      public fst::ArcIteratorBase<CompactLatticeArc> {
+ public:
+  ConstCompactLatticeArcIterator(const ConstCompactLattice &fst,
+                                 ConstCompactLattice::StateId s):
+      aiter_(fst, s) { }
+  bool Done() const override { return aiter_.Done(); }
+  const CompactLatticeArc &Value() const override { return aiter_.Value(); }
+  void Next() override { aiter_.Next(); }
+  size_t Position() const override { return aiter_.Position(); }
+  void Reset() override { aiter_.Reset(); }
+  void Seek(size_t a) override { aiter_.Seek(a); }
+  uint32 Flags() const override { return aiter_.Flags(); }
+  void SetFlags(uint32 flags, uint32 mask) override { }
+ private:
+  fst::ArcIterator<ConstCompactLattice> aiter_;
+};
+
+}  // namespace
+
+
+ConstCompactLattice::ConstCompactLattice(): data_(new Data()) { }
+
+void ConstCompactLattice::CopyFrom(const CompactLattice &clat) {
+  Data *data = new Data();
+  data->start = clat.Start();
+  data->properties = (clat.Properties(fst::kFstProperties, false) &
+                      fst::kCopyProperties) | fst::kExpanded;
+  StateId num_states = clat.NumStates();
+  size_t num_arcs = 0;
+  for (StateId s = 0; s < num_states; s++)
+    num_arcs += clat.NumArcs(s);
+  data->states.resize(num_states);
+  data->arcs.reserve(num_arcs);
+  for (StateId s = 0; s < num_states; s++) {
+    FlatState &state = data->states[s];
+    const Weight &final = clat.Final(s);
+    state.final_weight = final.Weight();
+    state.final_string_begin = data->strings.size();
+    state.final_string_length = final.String().size();
+    data->strings.insert(data->strings.end(), final.String().begin(),
+                         final.String().end());
+    state.arc_begin = data->arcs.size();
+    state.num_arcs = clat.NumArcs(s);
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      FlatArc flat_arc;
+      flat_arc.ilabel = arc.ilabel;
+      flat_arc.olabel = arc.olabel;
+      flat_arc.nextstate = arc.nextstate;
+      flat_arc.weight = arc.weight.Weight();
+      flat_arc.string_begin = data->strings.size();
+      flat_arc.string_length = arc.weight.String().size();
+      data->strings.insert(data->strings.end(), arc.weight.String().begin(),
+                           arc.weight.String().end());
+      data->arcs.push_back(flat_arc);
+    }
+  }
+  CountEpsilons(data);
+  data_.reset(data);
+}
+
+void ConstCompactLattice::CopyTo(CompactLattice *clat) const {
+  clat->DeleteStates();
+  StateId num_states = NumStates();
+  clat->ReserveStates(num_states);
+  for (StateId s = 0; s < num_states; s++)
+    clat->AddState();
+  for (StateId s = 0; s < num_states; s++) {
+    clat->SetFinal(s, Final(s));
+    clat->ReserveArcs(s, NumArcs(s));
+    for (fst::ArcIterator<ConstCompactLattice> aiter(*this, s); !aiter.Done();
+         aiter.Next())
+      clat->AddArc(s, aiter.Value());
+  }
+  if (data_->start != fst::kNoStateId)
+    clat->SetStart(data_->start);
+}
+
+void ConstCompactLattice::GetWeight(const FlatArc &arc, Weight *weight) const {
+  weight->SetWeight(arc.weight);
+  const int32 *begin = StringData() + arc.string_begin;
+  weight->MutableString()->assign(begin, begin + arc.string_length);
+}
+
+ConstCompactLattice::Weight ConstCompactLattice::Final(StateId s) const {
+  const FlatState &state = data_->states[s];
+  const int32 *begin = StringData() + state.final_string_begin;
+  return Weight(state.final_weight,
+                std::vector<int32>(begin, begin + state.final_string_length));
+}
+
+uint64 ConstCompactLattice::Properties(uint64 mask, bool test) const {
+  if (test) {
+    // The data may be shared with other copies, so the answer is not stored.
+    uint64 known;
+    return fst::TestProperties(*this, mask, &known) & mask;
+  } else {
+    return data_->properties & mask;
+  }
+}
+
+const std::string &ConstCompactLattice::Type() const {
+  static const std::string type = "const-compact-lattice";
+  return type;
+}
+
+void ConstCompactLattice::InitArcIterator(
+    StateId s, fst::ArcIteratorData<Arc> *data) const {
+  data->base = new ConstCompactLatticeArcIterator(*this, s);
+}
+
+void ConstCompactLattice::CountEpsilons(Data *data) {
+  for (size_t s = 0; s < data->states.size(); s++) {
+    FlatState &state = data->states[s];
+    state.num_input_epsilons = 0;
+    state.num_output_epsilons = 0;
+    const FlatArc *arcs = data->arcs.data() + state.arc_begin;
+    for (int32 i = 0; i < state.num_arcs; i++) {
+      if (arcs[i].ilabel == 0) state.num_input_epsilons++;
+      if (arcs[i].olabel == 0) state.num_output_epsilons++;
+    }
+  }
+}
+
+// This follows the layout of VectorFst::Read() (and of the Read() functions
+// of LatticeWeight and CompactLatticeWeight): for each state, the final
+// weight and the number of arcs, then for each arc the labels, the weight and
+// the next state.
+bool ConstCompactLattice::ReadVectorFstBody(std::istream &is,
+                                            const fst::FstHeader &hdr,
+                                            Data *data) {
+  data->start = hdr.Start();
+  data->properties = (hdr.Properties() & fst::kCopyProperties) |
+      fst::kExpanded;
+  int64 num_states = hdr.NumStates();
+  data->states.resize(num_states);
+  if (hdr.NumArcs() > 0)
+    data->arcs.reserve(hdr.NumArcs());
+  for (int64 s = 0; s < num_states; s++) {
+    FlatState &state = data->states[s];
+    state.final_weight.Read(is);
+    int32 string_length;
+    fst::ReadType(is, &string_length);
+    if (!is || string_length < 0) return false;
+    state.final_string_begin = data->strings.size();
+    state.final_string_length = string_length;
+    data->strings.resize(data->strings.size() + string_length);
+    if (string_length > 0)
+      is.read(reinterpret_cast<char*>(&(data->strings[state.final_string_begin])),
+              string_length * sizeof(int32));
+    int64 num_arcs;
+    fst::ReadType(is, &num_arcs);
+    if (!is || num_arcs < 0) return false;
+    state.arc_begin = data->arcs.size();
+    state.num_arcs = num_arcs;
+    for (int64 i = 0; i < num_arcs; i++) {
+      FlatArc arc;
+      fst::ReadType(is, &arc.ilabel);
+      fst::ReadType(is, &arc.olabel);
+      arc.weight.Read(is);
+      fst::ReadType(is, &string_length);
+      if (!is || string_length < 0) return false;
+      arc.string_begin = data->strings.size();
+      arc.string_length = string_length;
+      data->strings.resize(data->strings.size() + string_length);
+      if (string_length > 0)
+        is.read(reinterpret_cast<char*>(&(data->strings[arc.string_begin])),
+                string_length * sizeof(int32));
+      fst::ReadType(is, &arc.nextstate);
+      if (!is || arc.nextstate < 0 || arc.nextstate >= num_states)
+        return false;
+      data->arcs.push_back(arc);
+    }
+  }
+  CountEpsilons(data);
+  return true;
+}
+
+bool ConstCompactLattice::Read(std::istream &is, bool binary) {
+  if (binary) {
+    fst::FstHeader hdr;
+    if (!hdr.Read(is, "<unknown>")) {
+      KALDI_WARN << "Reading compact lattice: error reading FST header.";
+      return false;
+    }
+    if (hdr.FstType() == "vector" && hdr.ArcType() == Arc::Type() &&
+        (hdr.GetFlags() & (fst::FstHeader::HAS_ISYMBOLS |
+                           fst::FstHeader::HAS_OSYMBOLS |
+                           fst::FstHeader::IS_ALIGNED)) == 0 &&
+        hdr.NumStates() >= 0) {
+      std::shared_ptr<Data> data(new Data());
+      if (!ReadVectorFstBody(is, hdr, data.get())) {
+        KALDI_WARN << "Error reading compact lattice (after reading header).";
+        return false;
+      }
+      data_ = data;
+      return true;
+    }
+    // Anything else, e.g. lattices in double precision, is left to the
+    // general code.
+    CompactLattice *clat = NULL;
+    if (!ReadCompactLattice(is, hdr, &clat))
+      return false;
+    CopyFrom(*clat);
+    delete clat;
+    return true;
+  } else {
+    CompactLattice *clat = NULL;
+    if (!ReadCompactLattice(is, false, &clat))
+      return false;
+    CopyFrom(*clat);
+    delete clat;
+    return true;
+  }
+}
+
+bool ConstCompactLattice::Write(std::ostream &os, bool binary) const {
+  if (binary) {
+    // The same output as VectorFst::Write() with the default options.
+    const std::vector<FlatState> &states = data_->states;
+    fst::FstHeader hdr;
+    hdr.SetFstType("vector");
+    hdr.SetArcType(Arc::Type());
+    hdr.SetVersion(2);  // the version of the VectorFst format.
+    hdr.SetFlags(0);
+    hdr.SetProperties(data_->properties | fst::kExpanded | fst::kMutable);
+    hdr.SetStart(data_->start);
+    hdr.SetNumStates(states.size());
+    hdr.SetNumArcs(data_->arcs.size());
+    if (!hdr.Write(os, "<unspecified>"))
+      return false;
+    const int32 *strings = StringData();
+    for (size_t s = 0; s < states.size(); s++) {
+      const FlatState &state = states[s];
+      state.final_weight.Write(os);
+      fst::WriteType(os, state.final_string_length);
+      os.write(reinterpret_cast<const char*>(strings +
+                                             state.final_string_begin),
+               state.final_string_length * sizeof(int32));
+      int64 num_arcs = state.num_arcs;
+      fst::WriteType(os, num_arcs);
+      const FlatArc *arcs = Arcs(s);
+      for (int64 i = 0; i < num_arcs; i++) {
+        const FlatArc &arc = arcs[i];
+        fst::WriteType(os, arc.ilabel);
+        fst::WriteType(os, arc.olabel);
+        arc.weight.Write(os);
+        fst::WriteType(os, arc.string_length);
+        os.write(reinterpret_cast<const char*>(strings + arc.string_begin),
+                 arc.string_length * sizeof(int32));
+        fst::WriteType(os, arc.nextstate);
+      }
+    }
+    if (!os) {
+      KALDI_WARN << "Stream failure detected.";
+      return false;
+    }
+    return true;
+  } else {
+    CompactLattice clat;
+    CopyTo(&clat);
+    return WriteCompactLattice(os, false, clat);
+  }
+}
+
+
+bool ConstCompactLatticeHolder::Read(std::istream &is) {
+  Clear();
+  int c = is.peek();
+  if (c == -1) {
+    KALDI_WARN << "End of stream detected reading CompactLattice.";
+    return false;
+  } else if (isspace(c)) {  // text form; see CompactLatticeHolder::Read().
+    return t_.Read(is, false);
+  } else if (c != 214) {  // 214 is the first char of the FST magic number.
+    KALDI_WARN << "Reading compact lattice: does not appear to be an FST "
+               << " [non-space but no magic number detected], file pos is "
+               << is.tellg();
+    return false;
+  } else {
+    return t_.Read(is, true);
+  }
+}
+
+}  // namespace kaldi
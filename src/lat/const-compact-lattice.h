@@ -0,0 +1,257 @@
+// lat/const-compact-lattice.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_LAT_CONST_COMPACT_LATTICE_H_
+#define KALDI_LAT_CONST_COMPACT_LATTICE_H_
+
+#include <memory>
+
+#include "lat/kaldi-lattice.h"
+
+
+namespace kaldi {
+
+/**
+   ConstCompactLattice is an immutable CompactLattice whose states, arcs and
+   the strings of the weights are held in three flat arrays, instead of one
+   arc vector per state and one std::vector<int32> per weight as in a
+   VectorFst; reading it from disk costs three allocations instead of a few per
+   arc, and it is a read-only fst::ExpandedFst<CompactLatticeArc>, so that the
+   OpenFst and Kaldi algorithms that take a "const Fst<Arc>&" can be given it
+   directly.  Use CopyTo() to get a CompactLattice when it has to be modified.
+
+   The data is shared between copies (the Fst Copy() function and the copy
+   constructor are cheap).  It is read and written in the same format as a
+   CompactLattice, so that the tables of either type can be read as the other
+   (see ConstCompactLatticeHolder).
+*/
+class ConstCompactLattice: public fst::ExpandedFst<CompactLatticeArc> {
+ public:
+  typedef CompactLatticeArc Arc;
+  typedef Arc::Label Label;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  /// An arc in the flat form: the string of its weight is the 'string_length'
+  /// symbols from StringData() + string_begin.
+  struct FlatArc {
+    Label ilabel;
+    Label olabel;
+    StateId nextstate;
+    LatticeWeight weight;
+    int32 string_begin;
+    int32 string_length;
+  };
+
+  /// The empty lattice (no states).
+  ConstCompactLattice();
+
+  explicit ConstCompactLattice(const CompactLattice &clat) { CopyFrom(clat); }
+
+  ConstCompactLattice(const ConstCompactLattice &other): data_(other.data_) { }
+
+  ConstCompactLattice &operator = (const ConstCompactLattice &other) {
+    data_ = other.data_;
+    return *this;
+  }
+
+  void CopyFrom(const CompactLattice &clat);
+
+  /// Outputs the lattice as a (mutable) CompactLattice.
+  void CopyTo(CompactLattice *clat) const;
+
+  /// Reads in the format of ReadCompactLattice().  Returns false (and warns)
+  /// on error, like ReadCompactLattice().  In binary mode, a CompactLattice
+  /// as Kaldi writes it is read directly into the flat arrays; anything else
+  /// (other arc types, symbol tables) goes through ReadCompactLattice().
+  bool Read(std::istream &is, bool binary);
+
+  /// Writes in the format of WriteCompactLattice().
+  bool Write(std::ostream &os, bool binary) const;
+
+  void Swap(ConstCompactLattice *other) { data_.swap(other->data_); }
+
+  /// Direct access, for code that is written for this type: the arcs of
+  /// state s are Arcs(s)[0] ... Arcs(s)[NumArcs(s) - 1].
+  const FlatArc *Arcs(StateId s) const {
+    return data_->arcs.data() + data_->states[s].arc_begin;
+  }
+  const int32 *StringData() const { return data_->strings.data(); }
+
+  /// Sets *weight to the weight of the flat arc, reusing the memory of its
+  /// string.
+  void GetWeight(const FlatArc &arc, Weight *weight) const;
+
+  // The functions of fst::Fst and fst::ExpandedFst.
+  StateId Start() const override { return data_->start; }
+  Weight Final(StateId s) const override;
+  size_t NumArcs(StateId s) const override {
+    return data_->states[s].num_arcs;
+  }
+  size_t NumInputEpsilons(StateId s) const override {
+    return data_->states[s].num_input_epsilons;
+  }
+  size_t NumOutputEpsilons(StateId s) const override {
+    return data_->states[s].num_output_epsilons;
+  }
+  StateId NumStates() const override { return data_->states.size(); }
+  uint64 Properties(uint64 mask, bool test) const override;
+  const std::string &Type() const override;
+  ConstCompactLattice *Copy(bool safe = false) const override {
+    return new ConstCompactLattice(*this);
+  }
+  const fst::SymbolTable *InputSymbols() const override { return NULL; }
+  const fst::SymbolTable *OutputSymbols() const override { return NULL; }
+  void InitStateIterator(fst::StateIteratorData<Arc> *data) const override {
+    data->base = NULL;
+    data->nstates = NumStates();
+  }
+  void InitArcIterator(StateId s,
+                       fst::ArcIteratorData<Arc> *data) const override;
+
+ private:
+  struct FlatState {
+    int32 arc_begin;
+    int32 num_arcs;
+    int32 num_input_epsilons;
+    int32 num_output_epsilons;
+    LatticeWeight final_weight;  // LatticeWeight::Zero() if not final.
+    int32 final_string_begin;
+    int32 final_string_length;
+  };
+  struct Data {
+    StateId start;
+    uint64 properties;
+    std::vector<FlatState> states;
+    std::vector<FlatArc> arcs;
+    std::vector<int32> strings;
+    Data(): start(fst::kNoStateId), properties(0) { }
+  };
+
+  // Reads the body of a binary CompactLattice in the VectorFst format (the
+  // header has been read).  Returns false on stream error.
+  static bool ReadVectorFstBody(std::istream &is, const fst::FstHeader &hdr,
+                                Data *data);
+  // Sets num_input_epsilons and num_output_epsilons of the states.
+  static void CountEpsilons(Data *data);
+
+  std::shared_ptr<const Data> data_;
+};
+
+
+/// A Holder for ConstCompactLattice, for use in tables; it reads and writes
+/// the same archives as CompactLatticeHolder.
+class ConstCompactLatticeHolder {
+ public:
+  typedef ConstCompactLattice T;
+
+  ConstCompactLatticeHolder() { }
+
+  static bool Write(std::ostream &os, bool binary, const T &t) {
+    return t.Write(os, binary);
+  }
+
+  bool Read(std::istream &is);
+
+  static bool IsReadInBinary() { return true; }
+
+  T &Value() { return t_; }
+
+  void Clear() { T empty; t_.Swap(&empty); }
+
+  void Swap(ConstCompactLatticeHolder *other) { t_.Swap(&(other->t_)); }
+
+  bool ExtractRange(const ConstCompactLatticeHolder &other,
+                    const std::string &range) {
+    KALDI_ERR << "ExtractRange is not defined for this type of holder.";
+    return false;
+  }
+ private:
+  T t_;
+};
+
+typedef TableWriter<ConstCompactLatticeHolder> ConstCompactLatticeWriter;
+typedef SequentialTableReader<ConstCompactLatticeHolder>
+    SequentialConstCompactLatticeReader;
+typedef RandomAccessTableReader<ConstCompactLatticeHolder>
+    RandomAccessConstCompactLatticeReader;
+
+}  // namespace kaldi
+
+
+namespace fst {
+
+// Specializations of the iterators, so that the algorithms that are
+// templated on the FST type do not go through the virtual functions.
+
+template<>
+class StateIterator<kaldi::ConstCompactLattice> {
+ public:
+  typedef kaldi::ConstCompactLattice::StateId StateId;
+
+  explicit StateIterator(const kaldi::ConstCompactLattice &fst):
+      nstates_(fst.NumStates()), s_(0) { }
+  bool Done() const { return s_ >= nstates_; }
+  StateId Value() const { return s_; }
+  void Next() { ++s_; }
+  void Reset() { s_ = 0; }
+ private:
+  StateId nstates_;
+  StateId s_;
+};
+
+template<>
+class ArcIterator<kaldi::ConstCompactLattice> {
+ public:
+  typedef kaldi::ConstCompactLattice::Arc Arc;
+  typedef kaldi::ConstCompactLattice::StateId StateId;
+
+  ArcIterator(const kaldi::ConstCompactLattice &fst, StateId s):
+      fst_(fst), arcs_(fst.Arcs(s)), narcs_(fst.NumArcs(s)), i_(0) { }
+
+  bool Done() const { return i_ >= narcs_; }
+
+  // The arc is formed when it is asked for; the memory of the string of its
+  // weight is reused from one arc to the next.
+  const Arc &Value() const {
+    const kaldi::ConstCompactLattice::FlatArc &arc = arcs_[i_];
+    arc_.ilabel = arc.ilabel;
+    arc_.olabel = arc.olabel;
+    arc_.nextstate = arc.nextstate;
+    fst_.GetWeight(arc, &arc_.weight);
+    return arc_;
+  }
+  void Next() { ++i_; }
+  void Reset() { i_ = 0; }
+  void Seek(size_t a) { i_ = a; }
+  size_t Position() const { return i_; }
+  uint32 Flags() const { return kArcValueFlags; }
+  void SetFlags(uint32 flags, uint32 mask) { }
+ private:
+  const kaldi::ConstCompactLattice &fst_;
+  const kaldi::ConstCompactLattice::FlatArc *arcs_;
+  size_t narcs_;
+  size_t i_;
+  mutable Arc arc_;
+};
+
+}  // namespace fst
+
+#endif  // KALDI_LAT_CONST_COMPACT_LATTICE_H_
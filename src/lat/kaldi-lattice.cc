@@ -301,6 +301,48 @@ Lattice *ReadLatticeText(std::istream &is) {
   }
 }
 
+bool ReadCompactLattice(std::istream &is, const fst::FstHeader &hdr,
+                        CompactLattice **clat) {
+  KALDI_ASSERT(*clat == NULL);
+  if (hdr.FstType() != "vector") {
+    KALDI_WARN << "Reading compact lattice: unsupported FST type: "
+               << hdr.FstType();
+    return false;
+  }
+  fst::FstReadOptions ropts("<unspecified>",
+                            &hdr);
+
+  typedef fst::CompactLatticeWeightTpl<fst::LatticeWeightTpl<float>, int32> T1;
+  typedef fst::CompactLatticeWeightTpl<fst::LatticeWeightTpl<double>, int32> T2;
+  typedef fst::LatticeWeightTpl<float> T3;
+  typedef fst::LatticeWeightTpl<double> T4;
+  typedef fst::VectorFst<fst::ArcTpl<T1> > F1;
+  typedef fst::VectorFst<fst::ArcTpl<T2> > F2;
+  typedef fst::VectorFst<fst::ArcTpl<T3> > F3;
+  typedef fst::VectorFst<fst::ArcTpl<T4> > F4;
+
+  CompactLattice *ans = NULL;
+  if (hdr.ArcType() == T1::Type()) {
+    ans = ConvertToCompactLattice(F1::Read(is, ropts));
+  } else if (hdr.ArcType() == T2::Type()) {
+    ans = ConvertToCompactLattice(F2::Read(is, ropts));
+  } else if (hdr.ArcType() == T3::Type()) {
+    ans = ConvertToCompactLattice(F3::Read(is, ropts));
+  } else if (hdr.ArcType() == T4::Type()) {
+    ans = ConvertToCompactLattice(F4::Read(is, ropts));
+  } else {
+    KALDI_WARN << "FST with arc type " << hdr.ArcType()
+               << " cannot be converted to CompactLattice.\n";
+    return false;
+  }
+  if (ans == NULL) {
+    KALDI_WARN << "Error reading compact lattice (after reading header).";
+    return false;
+  }
+  *clat = ans;
+  return true;
+}
+
 bool ReadCompactLattice(std::istream &is, bool binary,
                         CompactLattice **clat) {
   KALDI_ASSERT(*clat == NULL);
@@ -310,43 +352,7 @@ bool ReadCompactLattice(std::istream &is, bool binary,
       KALDI_WARN << "Reading compact lattice: error reading FST header.";
       return false;
     }
-    if (hdr.FstType() != "vector") {
-      KALDI_WARN << "Reading compact lattice: unsupported FST type: "
-                 << hdr.FstType();
-      return false;
-    }
-    fst::FstReadOptions ropts("<unspecified>",
-                              &hdr);
-
-    typedef fst::CompactLatticeWeightTpl<fst::LatticeWeightTpl<float>, int32> T1;
-    typedef fst::CompactLatticeWeightTpl<fst::LatticeWeightTpl<double>, int32> T2;
-    typedef fst::LatticeWeightTpl<float> T3;
-    typedef fst::LatticeWeightTpl<double> T4;
-    typedef fst::VectorFst<fst::ArcTpl<T1> > F1;
-    typedef fst::VectorFst<fst::ArcTpl<T2> > F2;
-    typedef fst::VectorFst<fst::ArcTpl<T3> > F3;
-    typedef fst::VectorFst<fst::ArcTpl<T4> > F4;
-
-    CompactLattice *ans = NULL;
-    if (hdr.ArcType() == T1::Type()) {
-      ans = ConvertToCompactLattice(F1::Read(is, ropts));
-    } else if (hdr.ArcType() == T2::Type()) {
-      ans = ConvertToCompactLattice(F2::Read(is, ropts));
-    } else if (hdr.ArcType() == T3::Type()) {
-      ans = ConvertToCompactLattice(F3::Read(is, ropts));
-    } else if (hdr.ArcType() == T4::Type()) {
-      ans = ConvertToCompactLattice(F4::Read(is, ropts));
-    } else {
-      KALDI_WARN << "FST with arc type " << hdr.ArcType()
-                 << " cannot be converted to CompactLattice.\n";
-      return false;
-    }
-    if (ans == NULL) {
-      KALDI_WARN << "Error reading compact lattice (after reading header).";
-      return false;
-    }
-    *clat = ans;
-    return true;
+    return ReadCompactLattice(is, hdr, clat);
   } else {
     // The next line would normally consume the \r on Windows, plus any
     // extra spaces that might have got in there somehow.
@@ -60,6 +60,10 @@ bool WriteLattice(std::ostream &os, bool binary,
 // NULL when called.
 bool ReadCompactLattice(std::istream &is, bool binary,
                         CompactLattice **clat);
+// This reads the rest of a binary compact lattice whose FST header has already
+// been read from the stream as 'hdr'; *clat must be NULL when called.
+bool ReadCompactLattice(std::istream &is, const fst::FstHeader &hdr,
+                        CompactLattice **clat);
 // the following function requires that *lat be
 // NULL when called.
 bool ReadLattice(std::istream &is, bool binary,
@@ -0,0 +1,102 @@
+// lat/lattice-table-driver.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_LATTICE_TABLE_DRIVER_H_
+#define KALDI_LAT_LATTICE_TABLE_DRIVER_H_
+
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+namespace internal {
+
+// The task ProcessLatticeTable() gives TaskSequencer for each item: it
+// processes the item in operator (), on a thread, and outputs the result in
+// its destructor, which TaskSequencer calls in the order of the items.
+template <class Holder, class Result, class ProcessFunction,
+          class OutputFunction>
+class LatticeTableTask {
+ public:
+  LatticeTableTask(const std::string &key, const typename Holder::T &value,
+                   const ProcessFunction &process,
+                   const OutputFunction &output):
+      key_(key), value_(value), process_(process), output_(output) { }
+
+  void operator () () { process_(key_, &value_, &result_); }
+
+  ~LatticeTableTask() { output_(key_, &result_); }
+
+ private:
+  std::string key_;
+  typename Holder::T value_;
+  const ProcessFunction &process_;
+  const OutputFunction &output_;
+  Result result_;
+};
+
+}  // namespace internal
+
+/**
+   The table loop of the lattice-processing programs, run on
+   config.num_threads threads (--num-threads, with TaskSequencerConfig) with the
+   output in the order of the input.  For each item of reader,
+   process(key, &value, &result) is called on one of the threads, with a copy
+   of the item (for lattices, which share their contents until they are
+   changed, this is cheap) that it may change, and a default-constructed
+   Result.  Then output(key, &result) is called, for one item at a time and in
+   the order of reader, to write the result and gather any statistics.
+
+   So that the work is done in parallel, process should do all of the
+   computation, and should change nothing but its arguments: counts of
+   warnings and the like go in Result, for output to add up.  As with
+   TaskSequencer, an error (KALDI_ERR) in process is not caught by the
+   program's usual handler, but is still reported and ends the program.
+
+   E.g.:
+     ProcessLatticeTable<CompactLatticeHolder, CompactLattice>(
+         sequencer_config, &clat_reader,
+         [&](const std::string &key, CompactLattice *clat,
+             CompactLattice *result) { ... },
+         [&](const std::string &key, CompactLattice *result) {
+           clat_writer.Write(key, *result);
+         });
+*/
+template <class Holder, class Result, class ProcessFunction,
+          class OutputFunction>
+void ProcessLatticeTable(const TaskSequencerConfig &config,
+                         SequentialTableReader<Holder> *reader,
+                         const ProcessFunction &process,
+                         const OutputFunction &output) {
+  typedef internal::LatticeTableTask<Holder, Result, ProcessFunction,
+                                     OutputFunction> Task;
+  TaskSequencer<Task> sequencer(config);
+  for (; !reader->Done(); reader->Next()) {
+    sequencer.Run(new Task(reader->Key(), reader->Value(), process, output));
+    reader->FreeCurrent();  // the task has its own copy.
+  }
+  sequencer.Wait();
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_LATTICE_TABLE_DRIVER_H_
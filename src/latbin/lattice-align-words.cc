@@ -23,6 +23,17 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/word-align-lattice.h"
 #include "lat/lattice-functions.h"
+#include "lat/lattice-table-driver.h"
+
+namespace kaldi {
+
+struct WordAlignResult {
+  CompactLattice aligned_clat;
+  bool ok;
+  WordAlignResult(): ok(false) { }
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -40,7 +51,8 @@ int main(int argc, char *argv[]) {
         "Note: word-boundary file has format (on each line):\n"
         "<integer-phone-id> [begin|end|singleton|internal|nonword]\n"
         "See also: lattice-align-words-lexicon, for use in cases where phones\n"
-        "don't have word-position information.\n";
+        "don't have word-position information.  With --num-threads, the\n"
+        "lattices are aligned in parallel.\n";
     
     ParseOptions po(usage);
     BaseFloat max_expand = 0.0;
@@ -57,6 +69,8 @@ int main(int argc, char *argv[]) {
     
     WordBoundaryInfoNewOpts opts;
     opts.Register(&po);
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -81,21 +95,26 @@ int main(int argc, char *argv[]) {
     
     int32 num_done = 0, num_err = 0;
     
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      const CompactLattice &clat = clat_reader.Value();
-
-      CompactLattice aligned_clat;
+    ProcessLatticeTable<CompactLatticeHolder, WordAlignResult>(
+        sequencer_config, &clat_reader,
+        [&](const std::string &key, CompactLattice *clat,
+            WordAlignResult *result) {
+      CompactLattice &aligned_clat = result->aligned_clat;
       int32 max_states;
-      if (max_expand > 0) max_states = 1000 + max_expand * clat.NumStates();
+      if (max_expand > 0) max_states = 1000 + max_expand * clat->NumStates();
       else max_states = 0;
-      
-      bool ok = WordAlignLattice(clat, tmodel, info, max_states, &aligned_clat);
-      
-      if (do_test && ok)
-        TestWordAlignedLattice(clat, tmodel, info, aligned_clat);
 
-      if (!ok) {
+      result->ok = WordAlignLattice(*clat, tmodel, info, max_states,
+                                    &aligned_clat);
+
+      if (do_test && result->ok)
+        TestWordAlignedLattice(*clat, tmodel, info, aligned_clat);
+      if (aligned_clat.Start() != fst::kNoStateId)
+        TopSortCompactLatticeIfNeeded(&aligned_clat);
+    },
+        [&](const std::string &key, WordAlignResult *result) {
+      const CompactLattice &aligned_clat = result->aligned_clat;
+      if (!result->ok) {
         num_err++;
         if (!output_if_error)
           KALDI_WARN << "Lattice for " << key
@@ -103,7 +122,6 @@ int main(int argc, char *argv[]) {
         else {
           if (aligned_clat.Start() != fst::kNoStateId) {
             KALDI_WARN << "Outputting partial lattice for " << key;
-            TopSortCompactLatticeIfNeeded(&aligned_clat);
             clat_writer.Write(key, aligned_clat);
           } else {
             KALDI_WARN << "Empty aligned lattice for " << key
@@ -117,11 +135,10 @@ int main(int argc, char *argv[]) {
         } else {
           num_done++;
           KALDI_VLOG(2) << "Aligned lattice for " << key;
-          TopSortCompactLatticeIfNeeded(&aligned_clat);
           clat_writer.Write(key, aligned_clat);
         }
       }
-    }
+    });
     KALDI_LOG << "Successfully aligned " << num_done << " lattices; "
               << num_err << " had errors.";
     return (num_done > num_err ? 0 : 1); // We changed the error condition slightly here,
@@ -23,6 +23,22 @@
 #include "lat/lattice-functions.h"
 #include "lat/push-lattice.h"
 #include "lat/minimize-lattice.h"
+#include "lat/lattice-table-driver.h"
+
+namespace kaldi {
+
+// What lattice-determinize-pruned outputs for a lattice.
+struct DeterminizePrunedResult {
+  CompactLattice det_clat;
+  Lattice out_lat;  // with --write-compact=false.
+  int32 num_warn;
+  // depth stats (for diagnostics).
+  double depth_in, depth_out, num_frames;
+  DeterminizePrunedResult(): num_warn(0), depth_in(0.0), depth_out(0.0),
+                             num_frames(0.0) { }
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -35,6 +51,8 @@ int main(int argc, char *argv[]) {
         "determinization algorithm, which is more efficient and prevents blowup.\n"
         "See http://kaldi-asr.org/doc/lattices.html for more information on lattices.\n"
         "\n"
+        "With --num-threads, the lattices are determinized in parallel.\n"
+        "\n"
         "Usage: lattice-determinize-pruned [options] lattice-rspecifier lattice-wspecifier\n"
         " e.g.: lattice-determinize-pruned --acoustic-scale=0.1 --beam=6.0 ark:in.lats ark:det.lats\n";
 
@@ -48,6 +66,7 @@ int main(int argc, char *argv[]) {
     // being more part of "fst world", so we register its elements independently.
     opts.max_mem = 50000000;
     opts.max_loop = 0; // was 500000;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
 
     po.Register("write-compact", &write_compact, 
                 "If true, write in normal (compact) form. "
@@ -61,6 +80,7 @@ int main(int argc, char *argv[]) {
     po.Register("minimize", &minimize,
                 "If true, push and minimize after determinization");
     opts.Register(&po);
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -93,38 +113,37 @@ int main(int argc, char *argv[]) {
     if (acoustic_scale == 0.0)
       KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted)";
 
-    for (; !lat_reader.Done(); lat_reader.Next()) {
-      std::string key = lat_reader.Key();
-      Lattice lat = lat_reader.Value();
-
+    ProcessLatticeTable<LatticeHolder, DeterminizePrunedResult>(
+        sequencer_config, &lat_reader,
+        [&](const std::string &key, Lattice *lat,
+            DeterminizePrunedResult *result) {
       KALDI_VLOG(2) << "Processing lattice " << key;
 
       // Compute a map from each (t, tid) to (sum_of_acoustic_scores, count)
       unordered_map<std::pair<int32,int32>, std::pair<BaseFloat, int32>,
                                           PairHasher<int32> > acoustic_scores;
       if (!write_compact)
-        ComputeAcousticScoresMap(lat, &acoustic_scores);
+        ComputeAcousticScoresMap(*lat, &acoustic_scores);
 
-      Invert(&lat); // so word labels are on the input side.
-      lat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &lat);
-      if (!TopSort(&lat)) {
+      Invert(lat); // so word labels are on the input side.
+      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), lat);
+      if (!TopSort(lat)) {
         KALDI_WARN << "Could not topologically sort lattice: this probably means it"
             " has bad properties e.g. epsilon cycles.  Your LM or lexicon might "
             "be broken, e.g. LM with epsilon cycles or lexicon with empty words.";
       }
-      fst::ArcSort(&lat, fst::ILabelCompare<LatticeArc>());
-      CompactLattice det_clat;
-      if (!DeterminizeLatticePruned(lat, beam, &det_clat, opts)) {
+      fst::ArcSort(lat, fst::ILabelCompare<LatticeArc>());
+      CompactLattice &det_clat = result->det_clat;
+      if (!DeterminizeLatticePruned(*lat, beam, &det_clat, opts)) {
         KALDI_WARN << "For key " << key << ", determinization did not succeed"
             "(partial output will be pruned tighter than the specified beam.)";
-        n_warn++;
+        result->num_warn++;
       }
       fst::Connect(&det_clat);
       if (det_clat.NumStates() == 0) {
         KALDI_WARN << "For key " << key << ", determinized and trimmed lattice "
             "was empty.";
-        n_warn++;
+        result->num_warn++;
       }
       if (minimize) {
         PushCompactLatticeStrings(&det_clat);
@@ -135,25 +154,32 @@ int main(int argc, char *argv[]) {
       int32 t;
       TopSortCompactLatticeIfNeeded(&det_clat);
       double depth = CompactLatticeDepth(det_clat, &t);
-      sum_depth_in += lat.NumStates();
-      sum_depth_out += depth * t;
-      sum_t += t;
+      result->depth_in = lat->NumStates();
+      result->depth_out = depth * t;
+      result->num_frames = t;
 
       if (write_compact) {
         fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale), &det_clat);
-        compact_lat_writer.Write(key, det_clat);
       } else {
-        Lattice out_lat;
-        fst::ConvertLattice(det_clat, &out_lat);
+        fst::ConvertLattice(det_clat, &(result->out_lat));
+        det_clat.DeleteStates();
 
         // Replace each arc (t, tid) with the averaged acoustic score from
         // the computed map
-        ReplaceAcousticScoresFromMap(acoustic_scores, &out_lat);
-        lat_writer.Write(key, out_lat);
+        ReplaceAcousticScoresFromMap(acoustic_scores, &(result->out_lat));
       }
-
+    },
+        [&](const std::string &key, DeterminizePrunedResult *result) {
+      if (write_compact)
+        compact_lat_writer.Write(key, result->det_clat);
+      else
+        lat_writer.Write(key, result->out_lat);
+      n_warn += result->num_warn;
+      sum_depth_in += result->depth_in;
+      sum_depth_out += result->depth_out;
+      sum_t += result->num_frames;
       n_done++;
-    }
+    });
 
     if (sum_t != 0.0) {
       KALDI_LOG << "Average input-lattice depth (measured at at state level) is "
@@ -24,6 +24,73 @@
 #include "lat/lattice-functions.h"
 #include "lm/const-arpa-lm.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// Rescores one lattice; the lattices are written, in order, as the tasks are
+// destroyed.
+class ConstArpaRescoreTask {
+ public:
+  ConstArpaRescoreTask(const ConstArpaLm &const_arpa, ConstArpaLmCache *cache,
+                       BaseFloat lm_scale, const std::string &key,
+                       const CompactLattice &clat,
+                       CompactLatticeWriter *writer,
+                       int32 *n_done, int32 *n_fail)
+      : const_arpa_(const_arpa), cache_(cache), lm_scale_(lm_scale),
+        key_(key), clat_(clat), writer_(writer), n_done_(n_done),
+        n_fail_(n_fail) { }
+
+  void operator () () {
+    CompactLattice &clat = clat_;
+    // Before composing with the LM FST, we scale the lattice weights
+    // by the inverse of "lm_scale".  We'll later scale by "lm_scale".
+    // We do it this way so we can determinize and it will give the
+    // right effect (taking the "best path" through the LM) regardless
+    // of the sign of lm_scale.
+    fst::ScaleLattice(fst::GraphLatticeScale(1.0/lm_scale_), &clat);
+    ArcSort(&clat, fst::OLabelCompare<CompactLatticeArc>());
+
+    // Wraps the ConstArpaLm format language model into FST. We re-create it
+    // for each lattice to prevent memory usage increasing with time; the
+    // n-gram lookups are kept in the shared cache, if any.
+    ConstArpaLmDeterministicFst const_arpa_fst(const_arpa_, cache_);
+
+    // Composes lattice with language model.
+    CompactLattice composed_clat;
+    ComposeCompactLatticeDeterministic(clat,
+                                       &const_arpa_fst, &composed_clat);
+
+    // Determinizes the composed lattice.
+    Lattice composed_lat;
+    ConvertLattice(composed_clat, &composed_lat);
+    Invert(&composed_lat);
+    DeterminizeLattice(composed_lat, &clat_);
+    fst::ScaleLattice(fst::GraphLatticeScale(lm_scale_), &clat_);
+  }
+
+  ~ConstArpaRescoreTask() {
+    if (clat_.Start() == fst::kNoStateId) {
+      KALDI_WARN << "Empty lattice for utterance " << key_
+          << " (incompatible LM?)";
+      (*n_fail_)++;
+    } else {
+      writer_->Write(key_, clat_);
+      (*n_done_)++;
+    }
+  }
+
+ private:
+  const ConstArpaLm &const_arpa_;
+  ConstArpaLmCache *cache_;
+  BaseFloat lm_scale_;
+  std::string key_;
+  CompactLattice clat_;  // the input, then the rescored lattice.
+  CompactLatticeWriter *writer_;
+  int32 *n_done_, *n_fail_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -36,7 +103,10 @@ int main(int argc, char *argv[]) {
         "will be wrapped into the DeterministicOnDemandFst interface and the\n"
         "rescoring is done by composing with the wrapped LM using a special\n"
         "type of composition algorithm. Determinization will be applied on\n"
-        "the composed lattice.\n"
+        "the composed lattice.  A language model written by\n"
+        "make-mapped-const-arpa is mapped into memory rather than read.\n"
+        "Lattices are rescored by --num-threads threads, which share a cache\n"
+        "of the n-gram lookups (see --lm-cache-size).\n"
         "\n"
         "Usage: lattice-lmrescore-const-arpa [options] lattice-rspecifier \\\n"
         "                                   const-arpa-in lattice-wspecifier\n"
@@ -45,9 +115,15 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     BaseFloat lm_scale = 1.0;
+    int64 lm_cache_size = 1000000;
+    TaskSequencerConfig sequencer_config;
 
     po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
                 "costs; frequently 1.0 or -1.0");
+    po.Register("lm-cache-size", &lm_cache_size, "Number of n-gram lookups "
+                "kept for all the lattices (shared by the threads); 0 to "
+                "look every n-gram up in the LM.");
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -62,57 +138,38 @@ int main(int argc, char *argv[]) {
 
     // Reads the language model in ConstArpaLm format.
     ConstArpaLm const_arpa;
-    ReadKaldiObject(lm_rxfilename, &const_arpa);
+    const_arpa.ReadMapped(lm_rxfilename);
 
     // Reads and writes as compact lattice.
     SequentialCompactLatticeReader compact_lattice_reader(lats_rspecifier);
     CompactLatticeWriter compact_lattice_writer(lats_wspecifier);
 
+    std::unique_ptr<ConstArpaLmCache> cache;
+    if (lm_cache_size > 0)
+      cache.reset(new ConstArpaLmCache(const_arpa, lm_cache_size));
+
     int32 n_done = 0, n_fail = 0;
-    for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
-      std::string key = compact_lattice_reader.Key();
-      CompactLattice clat = compact_lattice_reader.Value();
-      compact_lattice_reader.FreeCurrent();
-
-      if (lm_scale != 0.0) {
-        // Before composing with the LM FST, we scale the lattice weights
-        // by the inverse of "lm_scale".  We'll later scale by "lm_scale".
-        // We do it this way so we can determinize and it will give the
-        // right effect (taking the "best path" through the LM) regardless
-        // of the sign of lm_scale.
-        fst::ScaleLattice(fst::GraphLatticeScale(1.0/lm_scale), &clat);
-        ArcSort(&clat, fst::OLabelCompare<CompactLatticeArc>());
-
-        // Wraps the ConstArpaLm format language model into FST. We re-create it
-        // for each lattice to prevent memory usage increasing with time.
-        ConstArpaLmDeterministicFst const_arpa_fst(const_arpa);
-
-        // Composes lattice with language model.
-        CompactLattice composed_clat;
-        ComposeCompactLatticeDeterministic(clat,
-                                           &const_arpa_fst, &composed_clat);
-
-        // Determinizes the composed lattice.
-        Lattice composed_lat;
-        ConvertLattice(composed_clat, &composed_lat);
-        Invert(&composed_lat);
-        CompactLattice determinized_clat;
-        DeterminizeLattice(composed_lat, &determinized_clat);
-        fst::ScaleLattice(fst::GraphLatticeScale(lm_scale), &determinized_clat);
-        if (determinized_clat.Start() == fst::kNoStateId) {
-          KALDI_WARN << "Empty lattice for utterance " << key
-              << " (incompatible LM?)";
-          n_fail++;
+    {
+      TaskSequencer<ConstArpaRescoreTask> sequencer(sequencer_config);
+      for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
+        std::string key = compact_lattice_reader.Key();
+        CompactLattice clat = compact_lattice_reader.Value();
+        compact_lattice_reader.FreeCurrent();
+
+        if (lm_scale != 0.0) {
+          sequencer.Run(new ConstArpaRescoreTask(const_arpa, cache.get(),
+                                                 lm_scale, key, clat,
+                                                 &compact_lattice_writer,
+                                                 &n_done, &n_fail));
         } else {
-          compact_lattice_writer.Write(key, determinized_clat);
+          // Zero scale so nothing to do.
           n_done++;
+          compact_lattice_writer.Write(key, clat);
         }
-      } else {
-        // Zero scale so nothing to do.
-        n_done++;
-        compact_lattice_writer.Write(key, clat);
       }
+      sequencer.Wait();
     }
+    if (cache) cache->PrintStats();
 
     KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
     return (n_done != 0 ? 0 : 1);
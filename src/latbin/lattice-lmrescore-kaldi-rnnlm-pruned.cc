@@ -62,6 +62,7 @@ int main(int argc, char *argv[]) {
     ComposeLatticePrunedOptions compose_opts;
 
     int32 max_ngram_order = 3;
+    int32 max_cached_states = 0;
     BaseFloat lm_scale = 0.5;
     BaseFloat acoustic_scale = 0.1;
     bool use_carpa = false;
@@ -71,6 +72,11 @@ int main(int argc, char *argv[]) {
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic "
                 "probabilities (e.g. 0.1 for non-chain systems); important because "
                 "of its effect on pruning.");
+    po.Register("max-cached-states", &max_cached_states, "If positive, keep "
+                "up to this many RNNLM history states from one lattice to the "
+                "next, sharing the computation of the histories the lattices "
+                "have in common (results then depend slightly on the order "
+                "of the lattices; see also --max-ngram-order).");
     po.Register("max-ngram-order", &max_ngram_order,
         "If positive, allow RNNLM histories longer than this to be identified "
         "with each other for rescoring purposes (an approximation that "
@@ -145,7 +151,8 @@ int main(int argc, char *argv[]) {
     int32 num_done = 0, num_err = 0;
 
     rnnlm::KaldiRnnlmDeterministicFst* lm_to_add_orig = 
-         new rnnlm::KaldiRnnlmDeterministicFst(max_ngram_order, info);
+         new rnnlm::KaldiRnnlmDeterministicFst(max_ngram_order, info,
+                                               max_cached_states);
 
     for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
       fst::DeterministicOnDemandFst<StdArc> *lm_to_add =
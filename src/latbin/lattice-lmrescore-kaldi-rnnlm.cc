@@ -51,10 +51,16 @@ int main(int argc, char *argv[]) {
     rnnlm::RnnlmComputeStateComputationOptions opts;
 
     int32 max_ngram_order = 3;
+    int32 max_cached_states = 0;
     BaseFloat lm_scale = 1.0;
 
     po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
                 "costs");
+    po.Register("max-cached-states", &max_cached_states, "If positive, keep "
+                "up to this many RNNLM history states from one lattice to the "
+                "next, sharing the computation of the histories the lattices "
+                "have in common (results then depend slightly on the order "
+                "of the lattices; see also --max-ngram-order).");
     po.Register("max-ngram-order", &max_ngram_order,
         "If positive, allow RNNLM histories longer than this to be identified "
         "with each other for rescoring purposes (an approximation that "
@@ -93,7 +99,8 @@ int main(int argc, char *argv[]) {
 
     int32 n_done = 0, n_fail = 0;
 
-    rnnlm::KaldiRnnlmDeterministicFst rnnlm_fst(max_ngram_order, info);
+    rnnlm::KaldiRnnlmDeterministicFst rnnlm_fst(max_ngram_order, info,
+                                                max_cached_states);
 
     for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
       std::string key = compact_lattice_reader.Key();
@@ -89,7 +89,7 @@ int main(int argc, char *argv[]) {
     VectorFst<StdArc> *lm_to_add_fst = NULL;
     ConstArpaLm const_arpa;
     if (add_const_arpa) {
-      ReadKaldiObject(lm_to_add_rxfilename, &const_arpa);
+      const_arpa.ReadMapped(lm_to_add_rxfilename);
     } else {
       lm_to_add_fst = fst::ReadAndPrepareLmFst(lm_to_add_rxfilename);
     }
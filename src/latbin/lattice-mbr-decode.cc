@@ -20,6 +20,18 @@
 #include "util/common-utils.h"
 #include "lat/sausages.h"
 #include "hmm/posterior.h"
+#include "lat/lattice-table-driver.h"
+
+namespace kaldi {
+
+struct MbrDecodeResult {
+  MinimumBayesRisk *mbr;
+  MbrDecodeResult(): mbr(NULL) { }
+  ~MbrDecodeResult() { delete mbr; }
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MbrDecodeResult);
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -38,7 +50,8 @@ int main(int argc, char *argv[]) {
         "Note: use ark:/dev/null or the empty string for unwanted outputs.\n"
         "Note: times will only be very meaningful if you first use lattice-word-align.\n"
         "If you need ctm-format output, don't use this program but use lattice-to-ctm-conf\n"
-        "with --decode-mbr=true.\n"
+        "with --decode-mbr=true.  With --num-threads, the lattices are decoded\n"
+        "in parallel.\n"
         "\n"
         "Usage: lattice-mbr-decode [options]  lattice-rspecifier "
         "transcriptions-wspecifier [ bayes-risk-wspecifier "
@@ -60,6 +73,8 @@ int main(int argc, char *argv[]) {
                 "words [for debug output]");
     po.Register("one-best-times", &one_best_times, "If true, output times "
                 "corresponding to one-best, not whole sausage.");
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -94,13 +109,15 @@ int main(int argc, char *argv[]) {
     int32 n_done = 0, n_words = 0;
     BaseFloat tot_bayes_risk = 0.0;
 
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
-
-      MinimumBayesRisk mbr(clat);
+    ProcessLatticeTable<CompactLatticeHolder, MbrDecodeResult>(
+        sequencer_config, &clat_reader,
+        [&](const std::string &key, CompactLattice *clat,
+            MbrDecodeResult *result) {
+      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), clat);
+      result->mbr = new MinimumBayesRisk(*clat);
+    },
+        [&](const std::string &key, MbrDecodeResult *result) {
+      const MinimumBayesRisk &mbr = *(result->mbr);
 
       if (trans_wspecifier != "")
         trans_writer.Write(key, mbr.GetOneBest());
@@ -115,7 +132,7 @@ int main(int argc, char *argv[]) {
       n_done++;
       n_words += mbr.GetOneBest().size();
       tot_bayes_risk += mbr.GetBayesRisk();
-    }
+    });
 
     KALDI_LOG << "Done " << n_done << " lattices.";
     KALDI_LOG << "Average Bayes Risk per sentence is "
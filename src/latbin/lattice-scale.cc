@@ -23,6 +23,7 @@
 #include "util/common-utils.h"
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
+#include "lat/lattice-table-driver.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -34,7 +35,8 @@ int main(int argc, char *argv[]) {
     using fst::StdArc;
 
     const char *usage =
-        "Apply scaling to lattice weights\n"
+        "Apply scaling to lattice weights.  With --num-threads, the lattices\n"
+        "are scaled in parallel.\n"
         "Usage: lattice-scale [options] lattice-rspecifier lattice-wspecifier\n"
         " e.g.: lattice-scale --lm-scale=0.0 ark:1.lats ark:scaled.lats\n";
 
@@ -53,6 +55,8 @@ int main(int argc, char *argv[]) {
     po.Register("lm-scale", &lm_scale, "Scaling factor for graph/lm costs");
     po.Register("acoustic2lm-scale", &acoustic2lm_scale, "Add this times original acoustic costs to LM costs");
     po.Register("lm2acoustic-scale", &lm2acoustic_scale, "Add this times original LM costs to acoustic costs");
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -84,24 +88,33 @@ int main(int argc, char *argv[]) {
       // Write as compact lattice.
       CompactLatticeWriter compact_lattice_writer(lats_wspecifier);
 
-      for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
-        CompactLattice lat = compact_lattice_reader.Value();
-        ScaleLattice(scale, &lat);
-        compact_lattice_writer.Write(compact_lattice_reader.Key(), lat);
+      ProcessLatticeTable<CompactLatticeHolder, CompactLattice>(
+          sequencer_config, &compact_lattice_reader,
+          [&](const std::string &key, CompactLattice *lat,
+              CompactLattice *result) {
+        ScaleLattice(scale, lat);
+        *result = *lat;
+      },
+          [&](const std::string &key, CompactLattice *result) {
+        compact_lattice_writer.Write(key, *result);
         n_done++;
-      }
+      });
     } else {
       SequentialLatticeReader lattice_reader(lats_rspecifier);
 
       // Write as regular lattice.
       LatticeWriter lattice_writer(lats_wspecifier);
 
-      for (; !lattice_reader.Done(); lattice_reader.Next()) {
-        Lattice lat = lattice_reader.Value();
-        ScaleLattice(scale, &lat);
-        lattice_writer.Write(lattice_reader.Key(), lat);
+      ProcessLatticeTable<LatticeHolder, Lattice>(
+          sequencer_config, &lattice_reader,
+          [&](const std::string &key, Lattice *lat, Lattice *result) {
+        ScaleLattice(scale, lat);
+        *result = *lat;
+      },
+          [&](const std::string &key, Lattice *result) {
+        lattice_writer.Write(key, *result);
         n_done++;
-      }
+      });
     }
 
     KALDI_LOG << "Done " << n_done << " lattices.";
@@ -21,8 +21,24 @@
 #include "util/common-utils.h"
 #include "util/kaldi-table.h"
 #include "lat/sausages.h"
+#include "lat/lattice-table-driver.h"
+#include <mutex>
 #include <numeric>
 
+namespace kaldi {
+
+// The MBR decoding of a lattice, for the ctm.
+struct CtmConfResult {
+  bool ok;
+  std::vector<int32> words;
+  std::vector<BaseFloat> conf;
+  std::vector<std::pair<BaseFloat, BaseFloat> > times;
+  BaseFloat bayes_risk;
+  CtmConfResult(): ok(false), bayes_risk(0.0) { }
+};
+
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
@@ -55,7 +71,8 @@ int main(int argc, char *argv[]) {
         "   or: lattice-to-ctm-conf --acoustic-scale=0.1 --decode-mbr=false\\\n"
         "                                      ark:1.lats ark:1.1best 1.ctm\n"
         "See also: lattice-mbr-decode, nbest-to-ctm, lattice-arc-post,\n"
-        " steps/get_ctm.sh, steps/get_train_ctm.sh and utils/convert_ctm.pl.\n";
+        " steps/get_ctm.sh, steps/get_train_ctm.sh and utils/convert_ctm.pl.\n"
+        "With --num-threads, the lattices are decoded in parallel.\n";
 
     ParseOptions po(usage);
     BaseFloat acoustic_scale = 1.0, inv_acoustic_scale = 1.0, lm_scale = 1.0;
@@ -75,6 +92,8 @@ int main(int argc, char *argv[]) {
 
     MinimumBayesRiskOptions mbr_opts;
     mbr_opts.Register(&po);
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -129,42 +148,60 @@ int main(int argc, char *argv[]) {
     int32 n_done = 0, n_words = 0;
     BaseFloat tot_bayes_risk = 0.0;
 
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
+    // the random-access readers are used from the threads.
+    std::mutex reader_mutex;
+
+    ProcessLatticeTable<CompactLatticeHolder, CtmConfResult>(
+        sequencer_config, &clat_reader,
+        [&](const std::string &key, CompactLattice *clat,
+            CtmConfResult *result) {
+      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), clat);
 
       MinimumBayesRisk *mbr = NULL;
 
       if (one_best_rspecifier == "") {
-        mbr = new MinimumBayesRisk(clat, mbr_opts);
+        mbr = new MinimumBayesRisk(*clat, mbr_opts);
       } else {
-        // check,
-        if (!one_best_reader.HasKey(key)) {
-          KALDI_WARN << "No 1-best present for utterance " << key;
-          continue;
-        }
-        if (times_rspecifier != "" && !times_reader.HasKey(key)) {
-          KALDI_WARN << "No 'times' present for utterance " << key;
-          continue;
+        std::vector<int32> one_best;
+        std::vector<std::pair<BaseFloat,BaseFloat> > times;
+        {
+          std::lock_guard<std::mutex> lock(reader_mutex);
+          // check,
+          if (!one_best_reader.HasKey(key)) {
+            KALDI_WARN << "No 1-best present for utterance " << key;
+            return;
+          }
+          if (times_rspecifier != "" && !times_reader.HasKey(key)) {
+            KALDI_WARN << "No 'times' present for utterance " << key;
+            return;
+          }
+          one_best = one_best_reader.Value(key);
+          if (times_rspecifier != "")
+            times = times_reader.Value(key);
         }
         // get the 'mbr' decoding object,
         if (times_rspecifier == "") {
-          const std::vector<int32> &one_best = one_best_reader.Value(key);
-          mbr = new MinimumBayesRisk(clat, one_best, mbr_opts); // no 'times',
+          mbr = new MinimumBayesRisk(*clat, one_best, mbr_opts); // no 'times',
         } else {
           // with initial 'times' of the bins,
-          const std::vector<int32> &one_best = one_best_reader.Value(key);
-          const std::vector<std::pair<BaseFloat,BaseFloat> > &times = times_reader.Value(key);
-          mbr = new MinimumBayesRisk(clat, one_best, times, mbr_opts);
+          mbr = new MinimumBayesRisk(*clat, one_best, times, mbr_opts);
         }
       }
 
-      const std::vector<BaseFloat> &conf = mbr->GetOneBestConfidences();
-      const std::vector<int32> &words = mbr->GetOneBest();
+      result->ok = true;
+      result->conf = mbr->GetOneBestConfidences();
+      result->words = mbr->GetOneBest();
+      result->times = mbr->GetOneBestTimes();
+      result->bayes_risk = mbr->GetBayesRisk();
+      delete mbr;
+    },
+        [&](const std::string &key, CtmConfResult *result) {
+      if (!result->ok)
+        return;
+      const std::vector<BaseFloat> &conf = result->conf;
+      const std::vector<int32> &words = result->words;
       const std::vector<std::pair<BaseFloat, BaseFloat> > &times =
-          mbr->GetOneBestTimes();
+          result->times;
       KALDI_ASSERT(conf.size() == words.size() && words.size() == times.size());
       for (size_t i = 0; i < words.size(); i++) {
         KALDI_ASSERT(words[i] != 0 || mbr_opts.print_silence); // Should not have epsilons.
@@ -173,13 +210,12 @@ int main(int argc, char *argv[]) {
                     << words[i] << ' ' << conf[i] << '\n';
       }
       KALDI_LOG << "For utterance " << key << ", Bayes Risk "
-                << mbr->GetBayesRisk() << ", avg. confidence per-word "
+                << result->bayes_risk << ", avg. confidence per-word "
                 << std::accumulate(conf.begin(),conf.end(),0.0) / words.size();
       n_done++;
-      n_words += mbr->GetOneBest().size();
-      tot_bayes_risk += mbr->GetBayesRisk();
-      delete mbr;
-    }
+      n_words += words.size();
+      tot_bayes_risk += result->bayes_risk;
+    });
 
     KALDI_LOG << "Done " << n_done << " lattices.";
     KALDI_LOG << "Overall average Bayes Risk per sentence is "
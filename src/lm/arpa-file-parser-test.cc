@@ -154,6 +154,9 @@ void TestableArpaFileParser::Validate(
                           expect_ngrams.array, CompareNgrams));
 }
 
+// Threads the parser is run with, all tests are run with 1 and several.
+int32 test_num_threads = 1;
+
 // Read integer LM (no symbols) with log base conversion.
 void ReadIntegerLmLogconvExpectSuccess() {
   KALDI_LOG << "ReadIntegerLmLogconvExpectSuccess()";
@@ -196,6 +199,7 @@ ngram 3=2\n\
   ArpaParseOptions options;
   options.bos_symbol = 1;
   options.eos_symbol = 2;
+  options.num_threads = test_num_threads;
 
   TestableArpaFileParser parser(options, NULL);
   std::istringstream stm(integer_lm, std::ios_base::in);
@@ -269,6 +273,7 @@ void ReadSymbolicLmNoOovImpl(ArpaParseOptions::OovHandling oov) {
   ArpaParseOptions options;
   options.bos_symbol = 1;
   options.eos_symbol = 2;
+  options.num_threads = test_num_threads;
   options.unk_symbol = 3;
   options.oov_handling = oov;
   TestableArpaFileParser parser(options, &symbols);
@@ -299,6 +304,7 @@ void ReadSymbolicLmWithOovImpl(
   ArpaParseOptions options;
   options.bos_symbol = 1;
   options.eos_symbol = 2;
+  options.num_threads = test_num_threads;
   options.unk_symbol = 3;
   options.oov_handling = oov;
   TestableArpaFileParser parser(options, symbols);
@@ -366,7 +372,10 @@ void ReadSymbolicLmWithOovTests() {
 }  // namespace kaldi
 
 int main(int argc, char *argv[]) {
-  kaldi::ReadIntegerLmLogconvExpectSuccess();
-  kaldi::ReadSymbolicLmNoOovTests();
-  kaldi::ReadSymbolicLmWithOovTests();
+  for (int num_threads = 1; num_threads <= 3; num_threads += 2) {
+    kaldi::test_num_threads = num_threads;
+    kaldi::ReadIntegerLmLogconvExpectSuccess();
+    kaldi::ReadSymbolicLmNoOovTests();
+    kaldi::ReadSymbolicLmWithOovTests();
+  }
 }
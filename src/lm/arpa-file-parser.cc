@@ -20,15 +20,55 @@
 
 #include <fst/fstlib.h>
 
+#include <memory>
 #include <sstream>
 
 #include "base/kaldi-error.h"
 #include "base/kaldi-math.h"
 #include "lm/arpa-file-parser.h"
+#include "util/kaldi-thread.h"
 #include "util/text-utils.h"
 
 namespace kaldi {
 
+// Number of n-gram lines parsed together.
+static const size_t kArpaBlockLines = 20000;
+
+/// An n-gram line of the file and what parsing it found.
+struct ArpaFileParser::NGramLine {
+  enum Status {
+    kOk, kBadColumns, kBadLogprob, kBadBackoff, kBadSymbol, kEpsilon
+  };
+  int32 line_number;
+  std::string text;
+  Status status;
+  std::string bad_token;  // the column the status is about
+  NGram ngram;
+  // Words not in the symbol table, as (index, word).  Their ngram.words are
+  // -1 until ConsumeNGramLines() decides what to do with them, since that
+  // may add them to the table.
+  std::vector<std::pair<int32, std::string> > oov_words;
+};
+
+/// Parses a share of a block of lines.
+class ArpaFileParser::NGramLineParser: public MultiThreadable {
+ public:
+  NGramLineParser(const ArpaFileParser *parser, int32 order,
+                  std::vector<NGramLine> *lines)
+      : parser_(parser), order_(order), lines_(lines) { }
+  void operator() () {
+    size_t n = lines_->size(),
+        begin = n * thread_id_ / num_threads_,
+        end = n * (thread_id_ + 1) / num_threads_;
+    for (size_t i = begin; i < end; i++)
+      parser_->ParseNGramLine(order_, &(*lines_)[i]);
+  }
+ private:
+  const ArpaFileParser *parser_;
+  int32 order_;
+  std::vector<NGramLine> *lines_;
+};
+
 ArpaFileParser::ArpaFileParser(ArpaParseOptions options,
                                fst::SymbolTable* symbols)
     : options_(options), symbols_(symbols),
@@ -129,8 +169,12 @@ void ArpaFileParser::Read(std::istream &is) {
   // Signal that grammar order and n-gram counts are known.
   HeaderAvailable();
 
-  NGram ngram;
-  ngram.words.reserve(ngram_counts_.size());
+  // Lines are parsed a block at a time. With several threads, a block is
+  // parsed while the next one is read; it is consumed before the next one is
+  // parsed, so symbols are never added to the table while it is searched.
+  std::vector<NGramLine> block, pending_block;
+  std::unique_ptr<MultiThreader<NGramLineParser> > pending;
+  bool parallel = options_.num_threads > 1;
 
   // Processes "\N-grams:" section.
   for (int32 cur_order = 1; cur_order <= ngram_counts_.size(); ++cur_order) {
@@ -149,6 +193,37 @@ void ArpaFileParser::Read(std::istream &is) {
     KALDI_LOG << "Reading " << current_line_ << " section.";
 
     int32 ngram_count = 0;
+    // Consumes the block being parsed in the background, if there is one.
+    auto finish_pending = [&] () {
+      if (pending) {
+        pending.reset();  // waits for the parsing to finish.
+        ConsumeNGramLines(cur_order, &pending_block, &ngram_count);
+      }
+    };
+    // Parses and consumes the block, or with several threads, consumes the
+    // previous block and starts parsing this one.  Consuming sets the line
+    // number and line for diagnostics, they are put back for the reading.
+    auto flush = [&] (bool wait) {
+      int32 line_number = line_number_;
+      std::string line(current_line_);
+      finish_pending();
+      if (!block.empty()) {
+        if (parallel) {
+          pending_block.swap(block);
+          pending.reset(new MultiThreader<NGramLineParser>(
+              options_.num_threads,
+              NGramLineParser(this, cur_order, &pending_block)));
+          if (wait) finish_pending();
+        } else {
+          for (size_t i = 0; i < block.size(); i++)
+            ParseNGramLine(cur_order, &block[i]);
+          ConsumeNGramLines(cur_order, &block, &ngram_count);
+        }
+        block.clear();
+      }
+      line_number_ = line_number;
+      current_line_.swap(line);
+    };
     while (++line_number_, getline(is, current_line_) && !is.eof()) {
       if (current_line_.find_first_not_of(" \n\t\r") == std::string::npos) {
         continue;
@@ -157,6 +232,9 @@ void ArpaFileParser::Read(std::istream &is) {
         TrimTrailingWhitespace(&current_line_);
         std::ostringstream next_keyword;
         next_keyword << "\\" << cur_order + 1 << "-grams:";
+        // Everything before the directive is consumed first, so that
+        // diagnostics come in file order.
+        flush(true);
         if ((current_line_ != next_keyword.str()) &&
             (current_line_ != "\\end\\")) {
           if (ShouldWarn()) {
@@ -176,73 +254,12 @@ void ArpaFileParser::Read(std::istream &is) {
         }
       }
 
-      std::vector<std::string> col;
-      SplitStringToVector(current_line_, " \t", true, &col);
-
-      if (col.size() < 1 + cur_order ||
-          col.size() > 2 + cur_order ||
-          (cur_order == ngram_counts_.size() && col.size() != 1 + cur_order)) {
-        PARSE_ERR << "Invalid n-gram data line";
-      }
-      ++ngram_count;
-
-      // Parse out n-gram logprob and, if present, backoff weight.
-      if (!ConvertStringToReal(col[0], &ngram.logprob)) {
-        PARSE_ERR << "invalid n-gram logprob '" << col[0] << "'";
-      }
-      ngram.backoff = 0.0;
-      if (col.size() > cur_order + 1) {
-        if (!ConvertStringToReal(col[cur_order + 1], &ngram.backoff))
-          PARSE_ERR << "invalid backoff weight '" << col[cur_order + 1] << "'";
-      }
-      // Convert to natural log.
-      ngram.logprob *= M_LN10;
-      ngram.backoff *= M_LN10;
-
-      ngram.words.resize(cur_order);
-      bool skip_ngram = false;
-      for (int32 index = 0; !skip_ngram && index < cur_order; ++index) {
-        int32 word;
-        if (symbols_) {
-          // Symbol table provided, so symbol labels are expected.
-          if (options_.oov_handling == ArpaParseOptions::kAddToSymbols) {
-            word = symbols_->AddSymbol(col[1 + index]);
-          } else {
-            word = symbols_->Find(col[1 + index]);
-            if (word == -1) { // fst::kNoSymbol
-              switch (options_.oov_handling) {
-                case ArpaParseOptions::kReplaceWithUnk:
-                  word = options_.unk_symbol;
-                  break;
-                case ArpaParseOptions::kSkipNGram:
-                  if (ShouldWarn())
-                    KALDI_WARN << LineReference() << " skipped: word '"
-                               << col[1 + index] << "' not in symbol table";
-                  skip_ngram = true;
-                  break;
-                default:
-                  PARSE_ERR << "word '"  << col[1 + index]
-                            << "' not in symbol table";
-              }
-            }
-          }
-        } else {
-          // Symbols not provided, LM file should contain integers.
-          if (!ConvertStringToInteger(col[1 + index], &word) || word < 0) {
-            PARSE_ERR << "invalid symbol '" << col[1 + index] << "'";
-          }
-        }
-        // Whichever way we got it, an epsilon is invalid.
-        if (word == 0) {
-          PARSE_ERR << "epsilon symbol '" << col[1 + index]
-                    << "' is illegal in ARPA LM";
-        }
-        ngram.words[index] = word;
-      }
-      if (!skip_ngram) {
-        ConsumeNGram(ngram);
-      }
+      block.resize(block.size() + 1);
+      block.back().line_number = line_number_;
+      block.back().text = current_line_;
+      if (block.size() == kArpaBlockLines) flush(false);
     }
+    flush(true);
     if (ngram_count > ngram_counts_[cur_order - 1]) {
       PARSE_ERR << "header said there would be " << ngram_counts_[cur_order - 1]
                 << " n-grams of order " << cur_order
@@ -267,6 +284,132 @@ void ArpaFileParser::Read(std::istream &is) {
 #undef PARSE_ERR
 }
 
+void ArpaFileParser::ParseNGramLine(int32 order, NGramLine *line) const {
+  line->status = NGramLine::kOk;
+  line->oov_words.clear();
+  std::vector<std::string> col;
+  SplitStringToVector(line->text, " \t", true, &col);
+
+  if (col.size() < 1 + order ||
+      col.size() > 2 + order ||
+      (order == ngram_counts_.size() && col.size() != 1 + order)) {
+    line->status = NGramLine::kBadColumns;
+    return;
+  }
+
+  // Parse out n-gram logprob and, if present, backoff weight.
+  NGram &ngram = line->ngram;
+  if (!ConvertStringToReal(col[0], &ngram.logprob)) {
+    line->status = NGramLine::kBadLogprob;
+    line->bad_token = col[0];
+    return;
+  }
+  ngram.backoff = 0.0;
+  if (col.size() > order + 1) {
+    if (!ConvertStringToReal(col[order + 1], &ngram.backoff)) {
+      line->status = NGramLine::kBadBackoff;
+      line->bad_token = col[order + 1];
+      return;
+    }
+  }
+  // Convert to natural log.
+  ngram.logprob *= M_LN10;
+  ngram.backoff *= M_LN10;
+
+  ngram.words.resize(order);
+  for (int32 index = 0; index < order; ++index) {
+    int32 word;
+    if (symbols_) {
+      // Symbol table provided, so symbol labels are expected.  OOVs and
+      // epsilons are dealt with in ConsumeNGramLines(), in order.
+      word = symbols_->Find(col[1 + index]);
+      if (word == -1)  // fst::kNoSymbol
+        line->oov_words.push_back(std::make_pair(index, col[1 + index]));
+    } else {
+      // Symbols not provided, LM file should contain integers.
+      if (!ConvertStringToInteger(col[1 + index], &word) || word < 0) {
+        line->status = NGramLine::kBadSymbol;
+        line->bad_token = col[1 + index];
+        return;
+      }
+      if (word == 0) {
+        line->status = NGramLine::kEpsilon;
+        line->bad_token = col[1 + index];
+        return;
+      }
+    }
+    ngram.words[index] = word;
+  }
+}
+
+void ArpaFileParser::ConsumeNGramLines(int32 order,
+                                       std::vector<NGramLine> *lines,
+                                       int32 *ngram_count) {
+#define PARSE_ERR (KALDI_ERR << LineReference() << ": ")
+  for (size_t i = 0; i < lines->size(); i++) {
+    NGramLine &line = (*lines)[i];
+    line_number_ = line.line_number;
+    current_line_.swap(line.text);
+    switch (line.status) {
+      case NGramLine::kBadColumns:
+        PARSE_ERR << "Invalid n-gram data line";
+      case NGramLine::kBadLogprob:
+        PARSE_ERR << "invalid n-gram logprob '" << line.bad_token << "'";
+      case NGramLine::kBadBackoff:
+        PARSE_ERR << "invalid backoff weight '" << line.bad_token << "'";
+      case NGramLine::kBadSymbol:
+        PARSE_ERR << "invalid symbol '" << line.bad_token << "'";
+      case NGramLine::kEpsilon:
+        PARSE_ERR << "epsilon symbol '" << line.bad_token
+                  << "' is illegal in ARPA LM";
+      default:
+        break;
+    }
+    ++*ngram_count;
+
+    NGram &ngram = line.ngram;
+    bool skip_ngram = false;
+    if (symbols_) {
+      size_t oov = 0;
+      for (int32 index = 0; !skip_ngram && index < order; ++index) {
+        int32 &word = ngram.words[index];
+        if (oov < line.oov_words.size() &&
+            line.oov_words[oov].first == index) {
+          const std::string &text = line.oov_words[oov++].second;
+          switch (options_.oov_handling) {
+            case ArpaParseOptions::kAddToSymbols:
+              word = symbols_->AddSymbol(text);
+              break;
+            case ArpaParseOptions::kReplaceWithUnk:
+              word = options_.unk_symbol;
+              break;
+            case ArpaParseOptions::kSkipNGram:
+              if (ShouldWarn())
+                KALDI_WARN << LineReference() << " skipped: word '"
+                           << text << "' not in symbol table";
+              skip_ngram = true;
+              break;
+            default:
+              PARSE_ERR << "word '"  << text << "' not in symbol table";
+          }
+        }
+        // Whichever way we got it, an epsilon is invalid.
+        if (!skip_ngram && word == 0) {
+          std::vector<std::string> col;
+          SplitStringToVector(current_line_, " \t", true, &col);
+          PARSE_ERR << "epsilon symbol '" << col[1 + index]
+                    << "' is illegal in ARPA LM";
+        }
+      }
+    }
+    if (!skip_ngram) {
+      ConsumeNGram(ngram);
+    }
+  }
+  lines->clear();
+#undef PARSE_ERR
+}
+
 std::string ArpaFileParser::LineReference() const {
   std::stringstream ss;
   ss << "line " << line_number_ << " [" << current_line_ << "]";
@@ -44,15 +44,19 @@ struct ArpaParseOptions {
 
   ArpaParseOptions():
       bos_symbol(-1), eos_symbol(-1), unk_symbol(-1),
-      oov_handling(kRaiseError), max_warnings(30) { }
+      oov_handling(kRaiseError), max_warnings(30), num_threads(1) { }
 
   void Register(OptionsItf *opts) {
-    // Registering only the max_warnings count, since other options are
-    // treated differently by client programs: some want integer symbols,
-    // while other are passed words in their command line.
+    // Registering only the max_warnings count and the threads, since other
+    // options are treated differently by client programs: some want integer
+    // symbols, while other are passed words in their command line.
     opts->Register("max-arpa-warnings", &max_warnings,
                    "Maximum warnings to report on ARPA parsing, "
                    "0 to disable, -1 to show all");
+    opts->Register("num-threads", &num_threads,
+                   "Number of threads parsing the n-gram lines of the ARPA "
+                   "file (the file is read, and the n-grams used, in order "
+                   "in the calling thread)");
   }
 
   int32 bos_symbol;  ///< Symbol for <s>, Required non-epsilon.
@@ -60,6 +64,7 @@ struct ArpaParseOptions {
   int32 unk_symbol;  ///< Symbol for <unk>, Required for kReplaceWithUnk.
   OovHandling oov_handling;  ///< How to handle OOV words in the file.
   int32 max_warnings;  ///< Maximum warnings to report, <0 unlimited.
+  int32 num_threads;  ///< Threads parsing blocks of n-gram lines.
 };
 
 /**
@@ -133,6 +138,19 @@ class ArpaFileParser {
   const std::vector<int32>& NgramCounts() const { return ngram_counts_; }
 
  private:
+  // N-gram lines are read in blocks, which are parsed (in parallel if
+  // options_.num_threads > 1) and then consumed in order. See
+  // arpa-file-parser.cc.
+  struct NGramLine;
+  class NGramLineParser;
+  // Parses the line as far as it can without changing the parser, the
+  // symbol table is only searched.
+  void ParseNGramLine(int32 order, NGramLine *line) const;
+  // Reports the errors and warnings of the parsed lines and passes their
+  // n-grams to ConsumeNGram(), all in order.
+  void ConsumeNGramLines(int32 order, std::vector<NGramLine> *lines,
+                         int32 *ngram_count);
+
   ArpaParseOptions options_;
   fst::SymbolTable* symbols_;  // the pointer is not owned here.
   int32 line_number_;
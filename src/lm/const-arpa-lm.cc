@@ -18,9 +18,17 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <limits>
 #include <sstream>
 #include <utility>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "base/kaldi-math.h"
 #include "lm/arpa-file-parser.h"
@@ -570,6 +578,277 @@ void ConstArpaLm::Write(std::ostream &os, bool binary) const {
   WriteToken(os, binary, "</ConstArpaLm>");
 }
 
+// The mapped format (see ConstArpaLm::WriteMapped()), in the byte order of
+// the machine that wrote it:
+//   "\0B" (the binary header, so ReadKaldiObject() also reads it)
+//   ConstArpaLmMappedHeader
+//   padding, up to lm_states_offset, which is a multiple of the page size
+//   int32 lm_states[lm_states_size]
+//   padding, up to unigram_offset, a multiple of 8
+//   int64 unigram_addresses[num_words]
+//   int64 overflow_addresses[overflow_buffer_size]
+// The addresses are relative to lm_states, as in the other formats.
+static const char kMappedMagic[8] = {'K', 'C', 'A', 'R', 'P', 'A', 'M', '1'};
+static const uint32 kMappedByteOrder = 0x01020304;
+static const int64 kMappedPageSize = 4096;
+static const int64 kBinaryHeaderSize = 2;
+
+struct ConstArpaLmMappedHeader {
+  char magic[8];
+  uint32 byte_order;
+  int32 bos_symbol;
+  int32 eos_symbol;
+  int32 unk_symbol;
+  int32 ngram_order;
+  int32 num_words;
+  int32 overflow_buffer_size;
+  int32 reserved;
+  int64 lm_states_size;
+  int64 lm_states_offset;
+  int64 unigram_offset;
+  int64 overflow_offset;
+  int64 file_size;
+};
+
+static int64 RoundUp(int64 n, int64 m) { return (n + m - 1) / m * m; }
+
+// Sets the offsets of the header from its sizes.
+static void SetMappedLayout(ConstArpaLmMappedHeader *header) {
+  header->lm_states_offset =
+      RoundUp(kBinaryHeaderSize + sizeof(ConstArpaLmMappedHeader),
+              kMappedPageSize);
+  header->unigram_offset = RoundUp(header->lm_states_offset +
+                                   sizeof(int32) * header->lm_states_size,
+                                   sizeof(int64));
+  header->overflow_offset = header->unigram_offset +
+      sizeof(int64) * header->num_words;
+  header->file_size = header->overflow_offset +
+      sizeof(int64) * header->overflow_buffer_size;
+}
+
+static bool MappedHeaderIsValid(const ConstArpaLmMappedHeader &header) {
+  if (memcmp(header.magic, kMappedMagic, sizeof(kMappedMagic)) ||
+      header.byte_order != kMappedByteOrder || header.num_words <= 0 ||
+      header.overflow_buffer_size < 0 || header.lm_states_size <= 0)
+    return false;
+  ConstArpaLmMappedHeader layout = header;
+  SetMappedLayout(&layout);
+  return layout.lm_states_offset == header.lm_states_offset &&
+      layout.unigram_offset == header.unigram_offset &&
+      layout.overflow_offset == header.overflow_offset &&
+      layout.file_size == header.file_size;
+}
+
+ConstArpaLm::~ConstArpaLm() {
+  if (memory_assigned_) {
+    if (mapped_ == NULL)
+      delete[] lm_states_;
+    delete[] unigram_states_;
+    delete[] overflow_buffer_;
+  }
+#ifndef _MSC_VER
+  if (mapped_ != NULL)
+    munmap(const_cast<char*>(mapped_), mapped_size_);
+#endif
+}
+
+void ConstArpaLm::WriteMapped(std::ostream &os) const {
+  KALDI_ASSERT(initialized_);
+  ConstArpaLmMappedHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMappedMagic, sizeof(kMappedMagic));
+  header.byte_order = kMappedByteOrder;
+  header.bos_symbol = bos_symbol_;
+  header.eos_symbol = eos_symbol_;
+  header.unk_symbol = unk_symbol_;
+  header.ngram_order = ngram_order_;
+  header.num_words = num_words_;
+  header.overflow_buffer_size = overflow_buffer_size_;
+  header.lm_states_size = lm_states_size_;
+  SetMappedLayout(&header);
+
+  os.write("\0B", kBinaryHeaderSize);
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  std::string padding(header.lm_states_offset - kBinaryHeaderSize -
+                      sizeof(header), '\0');
+  os.write(padding.data(), padding.size());
+  os.write(reinterpret_cast<const char*>(lm_states_),
+           sizeof(int32) * lm_states_size_);
+  padding.assign(header.unigram_offset - header.lm_states_offset -
+                 sizeof(int32) * lm_states_size_, '\0');
+  os.write(padding.data(), padding.size());
+  // The relative addresses, as in Write().
+  std::vector<int64> addresses(num_words_);
+  for (int32 i = 0; i < num_words_; ++i)
+    addresses[i] = (unigram_states_[i] == NULL) ? 0 :
+        unigram_states_[i] - lm_states_ + 1;
+  os.write(reinterpret_cast<const char*>(&addresses[0]),
+           sizeof(int64) * num_words_);
+  addresses.resize(overflow_buffer_size_);
+  for (int32 i = 0; i < overflow_buffer_size_; ++i)
+    addresses[i] = (overflow_buffer_[i] == NULL) ? 0 :
+        overflow_buffer_[i] - lm_states_ + 1;
+  if (overflow_buffer_size_ > 0)
+    os.write(reinterpret_cast<const char*>(&addresses[0]),
+             sizeof(int64) * overflow_buffer_size_);
+  if (!os.good()) {
+    KALDI_ERR << "ConstArpaLm writing in the mapped format failed.";
+  }
+}
+
+bool ConstArpaLm::IsMappedFile(const std::string &rxfilename) {
+  if (ClassifyRxfilename(rxfilename) != kFileInput)
+    return false;
+  std::ifstream is(rxfilename.c_str(), std::ios::binary);
+  char start[kBinaryHeaderSize + sizeof(kMappedMagic)];
+  is.read(start, sizeof(start));
+  return is.good() && start[0] == '\0' && start[1] == 'B' &&
+      !memcmp(start + kBinaryHeaderSize, kMappedMagic, sizeof(kMappedMagic));
+}
+
+void ConstArpaLm::ReadMapped(const std::string &rxfilename) {
+  KALDI_ASSERT(!initialized_);
+#ifndef _MSC_VER
+  if (IsMappedFile(rxfilename)) {
+    int fd = open(rxfilename.c_str(), O_RDONLY);
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+      addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+      close(fd);
+    if (addr != MAP_FAILED) {
+      // the n-grams are looked up all over the array, so reading ahead of the
+      // pages that are used would mostly read pages that are not.
+      madvise(addr, st.st_size, MADV_RANDOM);
+      if (!SetFromMappedImage(static_cast<const char*>(addr), st.st_size)) {
+        munmap(addr, st.st_size);
+        KALDI_ERR << "Not a valid ConstArpaLm in the mapped format: "
+                  << rxfilename;
+      }
+      mapped_ = static_cast<const char*>(addr);
+      mapped_size_ = st.st_size;
+      KALDI_VLOG(1) << "Mapped ConstArpaLm with " << lm_states_size_
+                    << " words of LmStates from " << rxfilename;
+      return;
+    }
+    KALDI_WARN << "Could not map " << rxfilename << " into memory, reading it";
+  }
+#endif
+  ReadKaldiObject(rxfilename, this);
+}
+
+bool ConstArpaLm::SetFromMappedImage(const char *image, size_t size) {
+  ConstArpaLmMappedHeader header;
+  if (size < kBinaryHeaderSize + sizeof(header) || image[0] != '\0' ||
+      image[1] != 'B')
+    return false;
+  memcpy(&header, image + kBinaryHeaderSize, sizeof(header));
+  if (!MappedHeaderIsValid(header) ||
+      header.file_size != static_cast<int64>(size))
+    return false;
+  bos_symbol_ = header.bos_symbol;
+  eos_symbol_ = header.eos_symbol;
+  unk_symbol_ = header.unk_symbol;
+  ngram_order_ = header.ngram_order;
+  num_words_ = header.num_words;
+  overflow_buffer_size_ = header.overflow_buffer_size;
+  lm_states_size_ = header.lm_states_size;
+  // The mapping is read-only, but nothing writes through <lm_states_>.
+  lm_states_ = reinterpret_cast<int32*>(
+      const_cast<char*>(image + header.lm_states_offset));
+
+  const int64 *unigram_address =
+      reinterpret_cast<const int64*>(image + header.unigram_offset);
+  const int64 *overflow_address =
+      reinterpret_cast<const int64*>(image + header.overflow_offset);
+  for (int32 i = 0; i < num_words_; ++i)
+    if (unigram_address[i] < 0 || unigram_address[i] > lm_states_size_)
+      return false;
+  for (int32 i = 0; i < overflow_buffer_size_; ++i)
+    if (overflow_address[i] < 0 || overflow_address[i] > lm_states_size_)
+      return false;
+  if (ngram_order_ <= 0 || bos_symbol_ >= num_words_ || bos_symbol_ <= 0 ||
+      eos_symbol_ >= num_words_ || eos_symbol_ <= 0 ||
+      unk_symbol_ >= num_words_ || (unk_symbol_ <= 0 && unk_symbol_ != -1))
+    return false;
+
+  unigram_states_ = new int32*[num_words_];
+  for (int32 i = 0; i < num_words_; ++i) {
+    // Check out how we compute the relative address in ConstArpaLm::Write().
+    unigram_states_[i] = (unigram_address[i] == 0) ? NULL
+        : lm_states_ + unigram_address[i] - 1;
+  }
+  overflow_buffer_ = new int32*[overflow_buffer_size_];
+  for (int32 i = 0; i < overflow_buffer_size_; ++i) {
+    overflow_buffer_[i] = (overflow_address[i] == 0) ? NULL
+        : lm_states_ + overflow_address[i] - 1;
+  }
+  lm_states_end_ = lm_states_ + lm_states_size_ - 1;
+  memory_assigned_ = true;
+  initialized_ = true;
+  return true;
+}
+
+void ConstArpaLm::ReadInternalMapped(std::istream &is) {
+  KALDI_ASSERT(!initialized_);
+  ConstArpaLmMappedHeader header;
+  is.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!is.good() || !MappedHeaderIsValid(header)) {
+    KALDI_ERR << "ConstArpaLm header reading failed (or it was written on a "
+              << "machine of another byte order).";
+  }
+  bos_symbol_ = header.bos_symbol;
+  eos_symbol_ = header.eos_symbol;
+  unk_symbol_ = header.unk_symbol;
+  ngram_order_ = header.ngram_order;
+  num_words_ = header.num_words;
+  overflow_buffer_size_ = header.overflow_buffer_size;
+  lm_states_size_ = header.lm_states_size;
+
+  // The stream is after the header; we skip the padding.
+  is.ignore(header.lm_states_offset - kBinaryHeaderSize - sizeof(header));
+  lm_states_ = new int32[lm_states_size_];
+  is.read(reinterpret_cast<char *>(lm_states_),
+          sizeof(int32) * lm_states_size_);
+  is.ignore(header.unigram_offset - header.lm_states_offset -
+            sizeof(int32) * lm_states_size_);
+  std::vector<int64> addresses(num_words_);
+  is.read(reinterpret_cast<char *>(&addresses[0]),
+          sizeof(int64) * num_words_);
+  if (!is.good()) {
+    KALDI_ERR << "ConstArpaLm <LmStates> or <LmUnigram> section reading "
+              << "failed.";
+  }
+  unigram_states_ = new int32*[num_words_];
+  for (int32 i = 0; i < num_words_; ++i) {
+    // Check out how we compute the relative address in ConstArpaLm::Write().
+    unigram_states_[i] = (addresses[i] == 0) ? NULL
+        : lm_states_ + addresses[i] - 1;
+  }
+  addresses.resize(overflow_buffer_size_);
+  if (overflow_buffer_size_ > 0)
+    is.read(reinterpret_cast<char *>(&addresses[0]),
+            sizeof(int64) * overflow_buffer_size_);
+  if (!is.good()) {
+    KALDI_ERR << "ConstArpaLm <LmOverflow> section reading failed.";
+  }
+  overflow_buffer_ = new int32*[overflow_buffer_size_];
+  for (int32 i = 0; i < overflow_buffer_size_; ++i) {
+    overflow_buffer_[i] = (addresses[i] == 0) ? NULL
+        : lm_states_ + addresses[i] - 1;
+  }
+
+  KALDI_ASSERT(ngram_order_ > 0);
+  KALDI_ASSERT(bos_symbol_ < num_words_ && bos_symbol_ > 0);
+  KALDI_ASSERT(eos_symbol_ < num_words_ && eos_symbol_ > 0);
+  KALDI_ASSERT(unk_symbol_ < num_words_ &&
+               (unk_symbol_ > 0 || unk_symbol_ == -1));
+  lm_states_end_ = lm_states_ + lm_states_size_ - 1;
+  memory_assigned_ = true;
+  initialized_ = true;
+}
+
 void ConstArpaLm::Read(std::istream &is, bool binary) {
   KALDI_ASSERT(!initialized_);
   if (!binary) {
@@ -579,6 +858,8 @@ void ConstArpaLm::Read(std::istream &is, bool binary) {
   int first_char = is.peek();
   if (first_char == 4) {  // Old on-disk format starts with length of int32.
     ReadInternalOldFormat(is, binary);
+  } else if (first_char == kMappedMagic[0]) {  // Written by WriteMapped().
+    ReadInternalMapped(is);
   } else {                // New on-disk format starts with token <ConstArpaLm>.
     ReadInternal(is, binary);
   }
@@ -1010,8 +1291,80 @@ void ConstArpaLm::WriteArpa(std::ostream &os) const {
   os << std::endl << "\\end\\" << std::endl;
 }
 
+// Puts in next_hist the longest history state of the LM which ends
+// "hist word", the state ConstArpaLmDeterministicFst goes to on the word.
+static void GetNextHistoryState(const ConstArpaLm &lm,
+                                const std::vector<int32> &hist, int32 word,
+                                std::vector<int32> *next_hist) {
+  *next_hist = hist;
+  next_hist->push_back(word);
+  while (next_hist->size() >= lm.NgramOrder()) {
+    // History state has at most lm.NgramOrder() -1 words in the state.
+    next_hist->erase(next_hist->begin(), next_hist->begin() + 1);
+  }
+  // Note that OOV and backoff have been taken care of in ConstArpaLm.
+  while (!lm.HistoryStateExists(*next_hist)) {
+    KALDI_ASSERT(next_hist->size() > 0);
+    next_hist->erase(next_hist->begin(), next_hist->begin() + 1);
+  }
+}
+
+ConstArpaLmCache::ConstArpaLmCache(const ConstArpaLm &lm, int64 max_entries)
+    : lm_(lm), num_hits_(0), num_misses_(0), num_evictions_(0) {
+  KALDI_ASSERT(max_entries > 0);
+  max_shard_entries_ = std::max<int64>(1, max_entries / kNumShards);
+  for (int32 i = 0; i < kNumShards; i++)
+    shards_.push_back(std::unique_ptr<Shard>(new Shard));
+}
+
+float ConstArpaLmCache::GetNgramLogprob(int32 word,
+                                        const std::vector<int32> &hist,
+                                        std::vector<int32> *next_hist) {
+  std::vector<int32> key(hist);
+  key.push_back(word);
+  VectorHasher<int32> hasher;
+  Shard &shard = *shards_[hasher(key) % kNumShards];
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    MapType::const_iterator iter = shard.map.find(key);
+    if (iter != shard.map.end()) {
+      num_hits_++;
+      if (next_hist != NULL) *next_hist = iter->second.next_hist;
+      return iter->second.logprob;
+    }
+  }
+  // The lookup is done without the lock; two threads may both do it.
+  num_misses_++;
+  Entry entry;
+  entry.logprob = lm_.GetNgramLogprob(word, hist);
+  if (entry.logprob != std::numeric_limits<float>::min())
+    GetNextHistoryState(lm_, hist, word, &entry.next_hist);
+  if (next_hist != NULL) *next_hist = entry.next_hist;
+  float logprob = entry.logprob;
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.map.size() >= max_shard_entries_) {
+    num_evictions_ += shard.map.size();
+    MapType empty;
+    shard.map.swap(empty);  // frees its memory too.
+  }
+  Entry &cached = shard.map[key];
+  cached.logprob = logprob;
+  cached.next_hist.swap(entry.next_hist);
+  return logprob;
+}
+
+void ConstArpaLmCache::PrintStats() const {
+  int64 num_lookups = num_hits_ + num_misses_;
+  KALDI_LOG << "ConstArpaLm cache: " << num_hits_ << " hits in "
+            << num_lookups << " lookups ("
+            << (num_lookups ? 100.0 * num_hits_ / num_lookups : 0.0)
+            << "%), " << num_evictions_ << " evictions.";
+}
+
 ConstArpaLmDeterministicFst::ConstArpaLmDeterministicFst(
-    const ConstArpaLm& lm) : lm_(lm) {
+    const ConstArpaLm& lm, ConstArpaLmCache *cache)
+    : lm_(lm), cache_(cache) {
+  KALDI_ASSERT(cache == NULL || &(cache->Lm()) == &lm);
   // Creates a history state for <s>.
   std::vector<Label> bos_state(1, lm_.BosSymbol());
   state_to_wseq_.push_back(bos_state);
@@ -1023,7 +1376,9 @@ fst::StdArc::Weight ConstArpaLmDeterministicFst::Final(StateId s) {
   // At this point, we should have created the state.
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
   const std::vector<Label>& wseq = state_to_wseq_[s];
-  float logprob = lm_.GetNgramLogprob(lm_.EosSymbol(), wseq);
+  float logprob = cache_ != NULL ?
+      cache_->GetNgramLogprob(lm_.EosSymbol(), wseq, NULL) :
+      lm_.GetNgramLogprob(lm_.EosSymbol(), wseq);
   return Weight(-logprob);
 }
 
@@ -1031,23 +1386,21 @@ bool ConstArpaLmDeterministicFst::GetArc(StateId s,
                                          Label ilabel, fst::StdArc *oarc) {
   // At this point, we should have created the state.
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
-  std::vector<Label> wseq = state_to_wseq_[s];
-
-  float logprob = lm_.GetNgramLogprob(ilabel, wseq);
-  if (logprob == std::numeric_limits<float>::min()) {
-    return false;
-  }
+  std::vector<Label> wseq;
 
-  // Locates the next state in ConstArpaLm. Note that OOV and backoff have been
-  // taken care of in ConstArpaLm.
-  wseq.push_back(ilabel);
-  while (wseq.size() >= lm_.NgramOrder()) {
-    // History state has at most lm_.NgramOrder() -1 words in the state.
-    wseq.erase(wseq.begin(), wseq.begin() + 1);
-  }
-  while (!lm_.HistoryStateExists(wseq)) {
-    KALDI_ASSERT(wseq.size() > 0);
-    wseq.erase(wseq.begin(), wseq.begin() + 1);
+  float logprob;
+  if (cache_ != NULL) {
+    logprob = cache_->GetNgramLogprob(ilabel, state_to_wseq_[s], &wseq);
+    if (logprob == std::numeric_limits<float>::min()) {
+      return false;
+    }
+  } else {
+    logprob = lm_.GetNgramLogprob(ilabel, state_to_wseq_[s]);
+    if (logprob == std::numeric_limits<float>::min()) {
+      return false;
+    }
+    // Locates the next state in ConstArpaLm.
+    GetNextHistoryState(lm_, state_to_wseq_[s], ilabel, &wseq);
   }
 
   std::pair<const std::vector<Label>, StateId> wseq_state_pair(
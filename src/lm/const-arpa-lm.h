@@ -20,6 +20,9 @@
 #ifndef KALDI_LM_CONST_ARPA_LM_H_
 #define KALDI_LM_CONST_ARPA_LM_H_
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -219,6 +222,8 @@ class ConstArpaLm {
     overflow_buffer_ = NULL;
     memory_assigned_ = false;
     initialized_ = false;
+    mapped_ = NULL;
+    mapped_size_ = 0;
   }
 
   // Special constructor, will be used when you initialize ConstArpaLm from
@@ -244,15 +249,11 @@ class ConstArpaLm {
     lm_states_end_ = lm_states_ + lm_states_size_ - 1;
     memory_assigned_ = false;
     initialized_ = true;
+    mapped_ = NULL;
+    mapped_size_ = 0;
   }
 
-  ~ConstArpaLm() {
-    if (memory_assigned_) {
-      delete[] lm_states_;
-      delete[] unigram_states_;
-      delete[] overflow_buffer_;
-    }
-  }
+  ~ConstArpaLm();
 
   // Reads the ConstArpaLm format language model. It calls ReadInternal() or
   // ReadInternalOldFormat() to do the actual reading.
@@ -261,6 +262,23 @@ class ConstArpaLm {
   // Writes the language model in ConstArpaLm format.
   void Write(std::ostream &os, bool binary) const;
 
+  // Writes the language model in the mapped ConstArpaLm format, which
+  // ReadMapped() maps into memory instead of reading: the <LmStates> array
+  // starts on a page boundary of the file and is written as it is laid out in
+  // memory (so in the byte order of this machine).  It writes the whole file,
+  // binary header included, so the stream should be opened without one (see
+  // make-mapped-const-arpa).  Read() also reads this format, e.g. from a pipe.
+  void WriteMapped(std::ostream &os) const;
+
+  // Reads the language model from rxfilename.  If it is a file in the mapped
+  // format it is mapped into memory, so that its pages are only read from disk
+  // as they are used, and are shared by the processes that use the same file;
+  // else it is read with Read().
+  void ReadMapped(const std::string &rxfilename);
+
+  // True if rxfilename is a file in the mapped format.
+  static bool IsMappedFile(const std::string &rxfilename);
+
   // Creates Arpa format language model from ConstArpaLm format, and writes it
   // to output stream. This will be useful in testing.
   void WriteArpa(std::ostream &os) const;
@@ -288,6 +306,14 @@ class ConstArpaLm {
   // format, ReadInternal() will be called.
   void ReadInternalOldFormat(std::istream &is, bool binary);
 
+  // Function that loads data in the mapped format, after its binary header,
+  // from stream to the class.
+  void ReadInternalMapped(std::istream &is);
+
+  // Sets up the class from the image of a file in the mapped format, which
+  // <lm_states_> will point into.  Returns false if it is not a valid image.
+  bool SetFromMappedImage(const char *image, size_t size);
+
   // Loops up n-gram probability for given word sequence. Backoff is handled by
   // recursively calling this function.
   float GetNgramLogprobRecurse(const int32 word,
@@ -328,6 +354,12 @@ class ConstArpaLm {
   // Makes sure that the language model has been loaded before using it.
   bool initialized_;
 
+  // If the language model is mapped from a file, the mapping, which
+  // <lm_states_> points into; else NULL.  <unigram_states_> and
+  // <overflow_buffer_> are still assigned.
+  const char *mapped_;
+  size_t mapped_size_;
+
   // Integer corresponds to <s>.
   int32 bos_symbol_;
 
@@ -388,6 +420,53 @@ class ConstArpaLm {
  This class wraps a ConstArpaLm format language model with the interface defined
  in DeterministicOnDemandFst.
  */
+/**
+   Caches the n-gram lookups of ConstArpaLmDeterministicFst, so that FSTs
+   made for different lattices (possibly in different threads) share them.
+   It is keyed by history and word, since state ids are local to each FST,
+   and holds the log-prob and the history state the word leads to.  The
+   cache is split into separately locked shards; a shard that is full is
+   emptied, which bounds the memory used.
+*/
+class ConstArpaLmCache {
+ public:
+  /// Caches about max_entries lookups, must be > 0.
+  ConstArpaLmCache(const ConstArpaLm &lm, int64 max_entries = 1000000);
+
+  /// Returns lm.GetNgramLogprob(word, hist), and if next_hist is not NULL
+  /// puts there the longest history state of the LM which ends "hist word".
+  float GetNgramLogprob(int32 word, const std::vector<int32> &hist,
+                        std::vector<int32> *next_hist);
+
+  int64 NumHits() const { return num_hits_; }
+  int64 NumMisses() const { return num_misses_; }
+
+  /// Logs the hit rate and number of evictions.
+  void PrintStats() const;
+
+  const ConstArpaLm &Lm() const { return lm_; }
+
+ private:
+  struct Entry {
+    float logprob;
+    std::vector<int32> next_hist;
+  };
+  typedef unordered_map<std::vector<int32>, Entry,
+                        VectorHasher<int32> > MapType;
+  struct Shard {
+    std::mutex mutex;
+    MapType map;
+  };
+  static const int32 kNumShards = 64;
+
+  const ConstArpaLm &lm_;
+  size_t max_shard_entries_;
+  std::vector<std::unique_ptr<Shard> > shards_;
+  std::atomic<int64> num_hits_, num_misses_, num_evictions_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ConstArpaLmCache);
+};
+
 class ConstArpaLmDeterministicFst
   : public fst::DeterministicOnDemandFst<fst::StdArc> {
  public:
@@ -395,7 +474,10 @@ class ConstArpaLmDeterministicFst
   typedef fst::StdArc::StateId StateId;
   typedef fst::StdArc::Label Label;
 
-  explicit ConstArpaLmDeterministicFst(const ConstArpaLm& lm);
+  /// If cache is not NULL (it is not owned), the n-gram lookups go through
+  /// it; it must have been made for the same LM.
+  explicit ConstArpaLmDeterministicFst(const ConstArpaLm& lm,
+                                       ConstArpaLmCache *cache = NULL);
 
   // We cannot use "const" because the pure virtual function in the interface is
   // not const.
@@ -414,6 +496,7 @@ class ConstArpaLmDeterministicFst
   MapType wseq_to_state_;
   std::vector<std::vector<Label> > state_to_wseq_;
   const ConstArpaLm& lm_;
+  ConstArpaLmCache *cache_;
 };
 
 // Reads in an Arpa format language model and converts it into ConstArpaLm
@@ -0,0 +1,67 @@
+// lmbin/make-mapped-const-arpa.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lm/const-arpa-lm.h"
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  try {
+    const char *usage =
+        "Converts a ConstArpaLm format language model (as written by\n"
+        "arpa-to-const-arpa) into the mapped ConstArpaLm format, which the\n"
+        "rescoring programs map into memory instead of reading it: its pages\n"
+        "are read from disk as they are used and are shared by the processes\n"
+        "that use the same file.  The output is in the byte order of this\n"
+        "machine.  Programs that read ConstArpaLm still read both formats.\n"
+        "\n"
+        "Usage: make-mapped-const-arpa <const-arpa-in> <mapped-const-arpa-out>\n"
+        " e.g.: make-mapped-const-arpa data/lang_test_fg/G.carpa \\\n"
+        "                              data/lang_test_fg/G.mapped.carpa\n"
+        "See also: arpa-to-const-arpa, lattice-lmrescore-const-arpa\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string const_arpa_rxfilename = po.GetArg(1),
+        mapped_wxfilename = po.GetArg(2);
+
+    ConstArpaLm const_arpa;
+    ReadKaldiObject(const_arpa_rxfilename, &const_arpa);
+
+    // WriteMapped() writes the binary header itself.
+    bool binary = true, write_binary_header = false;
+    Output ko(mapped_wxfilename, binary, write_binary_header);
+    const_arpa.WriteMapped(ko.Stream());
+    ko.Close();
+
+    KALDI_LOG << "Wrote language model in the mapped format to "
+              << PrintableWxfilename(mapped_wxfilename);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
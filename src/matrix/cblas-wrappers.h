@@ -221,6 +221,143 @@ inline void Xgemv_sparsevec(MatrixTransposeType trans, MatrixIndexT num_rows,
   }
 }
 
+// Below these sizes (of num-rows * num-cols of the matrix, for gemv, and of
+// num-rows * num-cols * the inner dimension, for gemm), MatrixBase::AddMatMat()
+// and VectorBase::AddMatVec() use Xgemv_small() and Xgemm_small() instead of
+// BLAS, whose overhead per call dominates for such small matrices; see
+// UnitTestSmallMatMatSpeed() in matrix-lib-speed-test.cc.  (With OpenBLAS,
+// BLAS is faster from about 16x16 for gemv and 8x8x8 for gemm.)
+const MatrixIndexT kSmallGemvSize = 256;
+const MatrixIndexT kSmallGemmSize = 256;
+
+// Whether to use Xgemv_small() and Xgemm_small().  Each dimension is checked
+// on its own first, so that the product (which for real sizes would overflow
+// MatrixIndexT) is only computed when it is small.
+inline bool IsSmallGemv(MatrixIndexT num_rows, MatrixIndexT num_cols) {
+  return num_rows <= kSmallGemvSize && num_cols <= kSmallGemvSize &&
+      num_rows * num_cols <= kSmallGemvSize;
+}
+inline bool IsSmallGemm(MatrixIndexT num_rows, MatrixIndexT num_cols,
+                        MatrixIndexT inner) {
+  return num_rows <= kSmallGemmSize && num_cols <= kSmallGemmSize &&
+      inner <= kSmallGemmSize && num_rows * num_cols * inner <= kSmallGemmSize;
+}
+
+// The dot product of a and b (of dimension n, with a having stride
+// a_stride); it has four partial sums, so as not to be limited by the latency
+// of the additions.
+template<typename Real, bool Strided>
+inline Real Xdot_small(MatrixIndexT n, const Real *a, MatrixIndexT a_stride,
+                       const Real *b) {
+  Real sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+  MatrixIndexT k = 0, s = (Strided ? a_stride : 1);
+  for (; k + 4 <= n; k += 4) {
+    sum0 += a[k * s] * b[k];
+    sum1 += a[(k + 1) * s] * b[k + 1];
+    sum2 += a[(k + 2) * s] * b[k + 2];
+    sum3 += a[(k + 3) * s] * b[k + 3];
+  }
+  for (; k < n; k++)
+    sum0 += a[k * s] * b[k];
+  return (sum0 + sum1) + (sum2 + sum3);
+}
+
+// y = alpha M x + beta y, like cblas_Xgemv() with incX == incY == 1 (so like
+// BLAS it ignores the contents of y if beta == 0).
+template<typename Real>
+inline void Xgemv_small(MatrixTransposeType trans, MatrixIndexT num_rows,
+                        MatrixIndexT num_cols, Real alpha, const Real *Mdata,
+                        MatrixIndexT stride, const Real *xdata, Real beta,
+                        Real *ydata) {
+  if (trans == kNoTrans) {
+    for (MatrixIndexT i = 0; i < num_rows; i++) {
+      Real sum = Xdot_small<Real, false>(num_cols, Mdata + i * stride, 1,
+                                         xdata);
+      ydata[i] = alpha * sum + (beta == 0.0 ? 0.0 : beta * ydata[i]);
+    }
+  } else {
+    if (beta == 0.0) {
+      for (MatrixIndexT j = 0; j < num_cols; j++) ydata[j] = 0.0;
+    } else if (beta != 1.0) {
+      for (MatrixIndexT j = 0; j < num_cols; j++) ydata[j] *= beta;
+    }
+    for (MatrixIndexT i = 0; i < num_rows; i++) {
+      const Real *row = Mdata + i * stride;
+      Real x_i = alpha * xdata[i];
+      for (MatrixIndexT j = 0; j < num_cols; j++)
+        ydata[j] += x_i * row[j];
+    }
+  }
+}
+
+// The kernel of Xgemm_small(), with the transposes known at compile time so
+// that the inner loops have constant strides.  "inner" is the inner
+// dimension, i.e. num-cols of op(A).
+template<typename Real, bool TransA, bool TransB>
+inline void Xgemm_small_internal(Real alpha, const Real *Adata,
+                                 MatrixIndexT a_stride, const Real *Bdata,
+                                 MatrixIndexT b_stride, Real beta, Real *Mdata,
+                                 MatrixIndexT num_rows, MatrixIndexT num_cols,
+                                 MatrixIndexT inner, MatrixIndexT stride) {
+  for (MatrixIndexT i = 0; i < num_rows; i++) {
+    Real *row = Mdata + i * stride;
+    if (!TransB) {
+      // add alpha * op(A)(i, k) times the k'th row of B, for each k.
+      if (beta == 0.0) {
+        for (MatrixIndexT j = 0; j < num_cols; j++) row[j] = 0.0;
+      } else if (beta != 1.0) {
+        for (MatrixIndexT j = 0; j < num_cols; j++) row[j] *= beta;
+      }
+      for (MatrixIndexT k = 0; k < inner; k++) {
+        Real a = alpha * (TransA ? Adata[k * a_stride + i] :
+                          Adata[i * a_stride + k]);
+        const Real *b_row = Bdata + k * b_stride;
+        for (MatrixIndexT j = 0; j < num_cols; j++)
+          row[j] += a * b_row[j];
+      }
+    } else {
+      // the dot product of row i of op(A) with row j of B.
+      const Real *a_row = (TransA ? Adata + i : Adata + i * a_stride);
+      for (MatrixIndexT j = 0; j < num_cols; j++) {
+        Real sum = Xdot_small<Real, TransA>(inner, a_row, a_stride,
+                                            Bdata + j * b_stride);
+        row[j] = alpha * sum + (beta == 0.0 ? 0.0 : beta * row[j]);
+      }
+    }
+  }
+}
+
+// M = alpha op(A) op(B) + beta M, with the same arguments as cblas_Xgemm().
+template<typename Real>
+inline void Xgemm_small(Real alpha, MatrixTransposeType transA,
+                        const Real *Adata, MatrixIndexT a_num_rows,
+                        MatrixIndexT a_num_cols, MatrixIndexT a_stride,
+                        MatrixTransposeType transB, const Real *Bdata,
+                        MatrixIndexT b_stride, Real beta, Real *Mdata,
+                        MatrixIndexT num_rows, MatrixIndexT num_cols,
+                        MatrixIndexT stride) {
+  MatrixIndexT inner = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  if (transA == kNoTrans) {
+    if (transB == kNoTrans)
+      Xgemm_small_internal<Real, false, false>(alpha, Adata, a_stride, Bdata,
+                                               b_stride, beta, Mdata, num_rows,
+                                               num_cols, inner, stride);
+    else
+      Xgemm_small_internal<Real, false, true>(alpha, Adata, a_stride, Bdata,
+                                              b_stride, beta, Mdata, num_rows,
+                                              num_cols, inner, stride);
+  } else {
+    if (transB == kNoTrans)
+      Xgemm_small_internal<Real, true, false>(alpha, Adata, a_stride, Bdata,
+                                              b_stride, beta, Mdata, num_rows,
+                                              num_cols, inner, stride);
+    else
+      Xgemm_small_internal<Real, true, true>(alpha, Adata, a_stride, Bdata,
+                                             b_stride, beta, Mdata, num_rows,
+                                             num_cols, inner, stride);
+  }
+}
+
 inline void cblas_Xgemm(const float alpha,
                         MatrixTransposeType transA,
                         const float *Adata,
@@ -21,9 +21,195 @@
 
 #include "matrix/compressed-matrix.h"
 #include <algorithm>
+#include "base/cpu-dispatch.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace kaldi {
 
+// The functions below decompress the formats kTwoByte and kOneByte (one row at
+// a time) and kOneByteWithColHeaders (a group of columns at a time); there are
+// SSE2 versions for float.  The rows are decompressed by a kernel that
+// CpuDispatch() runs compiled for the instruction set of the CPU (see
+// base/cpu-dispatch.h), which uses the SSE2 versions when AVX2 isn't there.
+
+template<typename Int, typename Real>
+static KALDI_CPU_INLINE void IntRowToFloat(const Int *src, int32 dim,
+                                           float min_value, float increment,
+                                           Real *dest) {
+  for (int32 c = 0; c < dim; c++)
+    dest[c] = min_value + src[c] * increment;
+}
+
+namespace {
+
+template<CpuIsa isa> struct IntRowToFloatKernel {
+  template<typename Int, typename Real>
+  static KALDI_CPU_INLINE void Run(const Int *src, int32 dim, float min_value,
+                                   float increment, Real *dest) {
+    IntRowToFloat(src, dim, min_value, increment, dest);
+  }
+};
+
+}  // namespace
+
+// In the format kOneByteWithColHeaders, CopyToMat() computes the
+// piecewise-linear map of CharToFloat() as a[r] + s[r] * value, where r is the
+// range (0, 1 or 2) that the value is in; this computes the a and s of a
+// column from its p0, p25, p75 and p100.
+static inline void ByteColumnParams(const float *percentiles, float *a,
+                                    float *s) {
+  s[0] = (percentiles[1] - percentiles[0]) / 64.0f;
+  a[0] = percentiles[0];
+  s[1] = (percentiles[2] - percentiles[1]) / 128.0f;
+  a[1] = percentiles[1] - 64.0f * s[1];
+  s[2] = (percentiles[3] - percentiles[2]) / 63.0f;
+  a[2] = percentiles[2] - 192.0f * s[2];
+}
+
+static inline float ByteToFloat(const float *a, const float *s, uint8 value) {
+  int32 r = (value <= 64 ? 0 : (value <= 192 ? 1 : 2));
+  return a[r] + s[r] * value;
+}
+
+// Decompresses rows [0, num_rows) of the first columns of "dest" from data in
+// format kOneByteWithColHeaders, where "percentiles" has the p0, p25, p75 and
+// p100 of each column and "byte_data" is the data of the first of them, whose
+// columns are "col_stride" bytes apart.  Returns the number of columns done,
+// which the generic version leaves to the caller.
+template<typename Real>
+static int32 ByteColumnsToFloat(const float *percentiles,
+                                const uint8 *byte_data, int32 col_stride,
+                                int32 num_rows, int32 num_cols,
+                                MatrixBase<Real> *dest) {
+  return 0;
+}
+
+#if defined(__SSE2__)
+static void Uint16RowToFloatSse2(const uint16 *src, int32 dim, float min_value,
+                                 float increment, float *dest) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 min4 = _mm_set1_ps(min_value), inc4 = _mm_set1_ps(increment);
+  int32 c = 0;
+  for (; c + 8 <= dim; c += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c));
+    _mm_storeu_ps(dest + c, _mm_add_ps(min4, _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), inc4)));
+    _mm_storeu_ps(dest + c + 4, _mm_add_ps(min4, _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), inc4)));
+  }
+  for (; c < dim; c++)
+    dest[c] = min_value + src[c] * increment;
+}
+
+static void Uint8RowToFloatSse2(const uint8 *src, int32 dim, float min_value,
+                                float increment, float *dest) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 min4 = _mm_set1_ps(min_value), inc4 = _mm_set1_ps(increment);
+  int32 c = 0;
+  for (; c + 16 <= dim; c += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c)),
+        v16[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+    for (int32 i = 0; i < 2; i++) {
+      _mm_storeu_ps(dest + c + 8 * i, _mm_add_ps(min4, _mm_mul_ps(
+          _mm_cvtepi32_ps(_mm_unpacklo_epi16(v16[i], zero)), inc4)));
+      _mm_storeu_ps(dest + c + 8 * i + 4, _mm_add_ps(min4, _mm_mul_ps(
+          _mm_cvtepi32_ps(_mm_unpackhi_epi16(v16[i], zero)), inc4)));
+    }
+  }
+  for (; c < dim; c++)
+    dest[c] = min_value + src[c] * increment;
+}
+
+namespace {
+
+template<> struct IntRowToFloatKernel<kCpuIsaDefault> {
+  template<typename Int, typename Real>
+  static KALDI_CPU_INLINE void Run(const Int *src, int32 dim, float min_value,
+                                   float increment, Real *dest) {
+    IntRowToFloat(src, dim, min_value, increment, dest);
+  }
+  static void Run(const uint16 *src, int32 dim, float min_value,
+                  float increment, float *dest) {
+    Uint16RowToFloatSse2(src, dim, min_value, increment, dest);
+  }
+  static void Run(const uint8 *src, int32 dim, float min_value,
+                  float increment, float *dest) {
+    Uint8RowToFloatSse2(src, dim, min_value, increment, dest);
+  }
+};
+
+}  // namespace
+
+// Decompresses the columns four at a time: four rows of each of the four
+// columns are decompressed into a register each, and transposed to give four
+// rows of the output.
+template<>
+int32 ByteColumnsToFloat(const float *percentiles, const uint8 *byte_data,
+                         int32 col_stride, int32 num_rows, int32 num_cols,
+                         MatrixBase<float> *dest) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 v64 = _mm_set1_ps(64.0f), v192 = _mm_set1_ps(192.0f);
+  int32 c = 0;
+  for (; c + 4 <= num_cols; c += 4) {
+    __m128 a[4][3], s[4][3];  // (offset, slope) of each range of each column.
+    float tail_a[4][3], tail_s[4][3];
+    for (int32 k = 0; k < 4; k++) {
+      ByteColumnParams(percentiles + 4 * (c + k), tail_a[k], tail_s[k]);
+      for (int32 r = 0; r < 3; r++) {
+        a[k][r] = _mm_set1_ps(tail_a[k][r]);
+        s[k][r] = _mm_set1_ps(tail_s[k][r]);
+      }
+    }
+    const uint8 *col_data[4];
+    for (int32 k = 0; k < 4; k++)
+      col_data[k] = byte_data + (c + k) * col_stride;
+    int32 j = 0;
+    for (; j + 4 <= num_rows; j += 4) {
+      __m128 f[4];
+      for (int32 k = 0; k < 4; k++) {
+        int32 bytes;
+        memcpy(&bytes, col_data[k] + j, 4);
+        __m128 v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+            _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero));
+        __m128 low = _mm_cmple_ps(v, v64), high = _mm_cmpgt_ps(v, v192),
+            mid = _mm_andnot_ps(_mm_or_ps(low, high), _mm_castsi128_ps(
+                _mm_set1_epi32(-1)));
+        __m128 this_a = _mm_or_ps(_mm_or_ps(_mm_and_ps(low, a[k][0]),
+                                             _mm_and_ps(mid, a[k][1])),
+                                   _mm_and_ps(high, a[k][2])),
+            this_s = _mm_or_ps(_mm_or_ps(_mm_and_ps(low, s[k][0]),
+                                         _mm_and_ps(mid, s[k][1])),
+                               _mm_and_ps(high, s[k][2]));
+        f[k] = _mm_add_ps(this_a, _mm_mul_ps(this_s, v));
+      }
+      _MM_TRANSPOSE4_PS(f[0], f[1], f[2], f[3]);
+      for (int32 k = 0; k < 4; k++)
+        _mm_storeu_ps(dest->RowData(j + k) + c, f[k]);
+    }
+    for (; j < num_rows; j++) {
+      float *dest_row = dest->RowData(j) + c;
+      for (int32 k = 0; k < 4; k++)
+        dest_row[k] = ByteToFloat(tail_a[k], tail_s[k], col_data[k][j]);
+    }
+  }
+  return c;
+}
+#endif
+
+template<typename Real>
+static void Uint16RowToFloat(const uint16 *src, int32 dim, float min_value,
+                             float increment, Real *dest) {
+  CpuDispatch<IntRowToFloatKernel>(src, dim, min_value, increment, dest);
+}
+
+template<typename Real>
+static void Uint8RowToFloat(const uint8 *src, int32 dim, float min_value,
+                            float increment, Real *dest) {
+  CpuDispatch<IntRowToFloatKernel>(src, dim, min_value, increment, dest);
+}
+
 //static
 MatrixIndexT CompressedMatrix::DataSize(const GlobalHeader &header) {
   // Returns size in bytes of the data.
@@ -34,6 +220,10 @@ MatrixIndexT CompressedMatrix::DataSize(const GlobalHeader &header) {
   } else if (format == kTwoByte) {
     return sizeof(GlobalHeader) +
         2 * header.num_rows * header.num_cols;
+  } else if (format == kFourBitBlocks) {
+    return sizeof(GlobalHeader) +
+        header.num_cols * (sizeof(BlockHeader) * NumBlocks(header.num_rows) +
+                           NumColBytes(header.num_rows));
   } else {
     KALDI_ASSERT(format == kOneByte);
     return sizeof(GlobalHeader) +
@@ -72,6 +262,9 @@ void CompressedMatrix::ComputeGlobalHeader(
     case kOneByteAuto: case kOneByteUnsignedInteger: case kOneByteZeroOne:
       header->format = static_cast<int32>(kOneByte);  // 3.
       break;
+    case kFourBitBlockwise:
+      header->format = static_cast<int32>(kFourBitBlocks);  // 4.
+      break;
     default:
       KALDI_ERR << "Invalid compression type: "
                 << static_cast<int32>(method);
@@ -82,7 +275,8 @@ void CompressedMatrix::ComputeGlobalHeader(
 
   // Now compute 'min_value' and 'range'.
   switch (method) {
-    case kSpeechFeature: case kTwoByteAuto: case kOneByteAuto: {
+    case kSpeechFeature: case kTwoByteAuto: case kOneByteAuto:
+    case kFourBitBlockwise: {
       float min_value = mat.Min(), max_value = mat.Max();
       // ensure that max_value is strictly greater than min_value, even if matrix is
       // constant; this avoids crashes in ComputeColHeader when compressing speech
@@ -162,6 +356,20 @@ void CompressedMatrix::CopyFromMat(
       header_data++;
       byte_data += global_header.num_rows;
     }
+  } else if (format == kFourBitBlocks) {
+    int32 num_rows = global_header.num_rows,
+        num_blocks = NumBlocks(num_rows), col_bytes = NumColBytes(num_rows);
+    BlockHeader *header_data =
+        reinterpret_cast<BlockHeader*>(static_cast<char*>(data_) +
+                                       sizeof(GlobalHeader));
+    uint8 *nibble_data = reinterpret_cast<uint8*>(
+        header_data + num_blocks * global_header.num_cols);
+    for (int32 col = 0; col < global_header.num_cols; col++) {
+      CompressColumnBlocks(global_header, mat.Data() + col, mat.Stride(),
+                           num_rows, header_data, nibble_data);
+      header_data += num_blocks;
+      nibble_data += col_bytes;
+    }
   } else if (format == kTwoByte) {
     uint16 *data = reinterpret_cast<uint16*>(static_cast<char*>(data_) +
                                              sizeof(GlobalHeader));
@@ -223,11 +431,31 @@ CompressedMatrix::CompressedMatrix(
   bool padding_is_used = (row_offset < 0 ||
                           row_offset + num_rows > old_num_rows);
 
+  GlobalHeader *old_global_header = reinterpret_cast<GlobalHeader*>(cmat.Data());
+
+  if (old_global_header->format == kFourBitBlocks &&
+      (padding_is_used || row_offset % kBlockRows != 0)) {
+    // The blocks would not line up with the old ones, so we uncompress the
+    // rows and re-compress them.
+    int32 first_row = std::max<int32>(row_offset, 0),
+        end_row = std::min<int32>(row_offset + num_rows, old_num_rows);
+    Matrix<float> rows(end_row - first_row, num_cols, kUndefined),
+        temp(num_rows, num_cols, kUndefined);
+    cmat.CopyToMat(first_row, col_offset, &rows);
+    for (int32 row = 0; row < num_rows; row++) {
+      int32 old_row = row + row_offset;
+      if (old_row < first_row) old_row = first_row;
+      else if (old_row >= end_row) old_row = end_row - 1;
+      temp.Row(row).CopyFromVec(rows.Row(old_row - first_row));
+    }
+    CompressedMatrix temp_cmat(temp, kFourBitBlockwise);
+    this->Swap(&temp_cmat);
+    return;
+  }
+
   GlobalHeader new_global_header;
   KALDI_COMPILE_TIME_ASSERT(sizeof(new_global_header) == 20);
 
-  GlobalHeader *old_global_header = reinterpret_cast<GlobalHeader*>(cmat.Data());
-
   new_global_header = *old_global_header;
   new_global_header.num_cols = num_cols;
   new_global_header.num_rows = num_rows;
@@ -281,6 +509,29 @@ CompressedMatrix::CompressedMatrix(
         old_start_of_col += old_num_rows;
       }
     }
+  } else if (format == kFourBitBlocks) {
+    // row_offset is a multiple of kBlockRows, so we copy whole blocks.
+    int32 old_num_blocks = NumBlocks(old_num_rows),
+        new_num_blocks = NumBlocks(num_rows),
+        old_col_bytes = NumColBytes(old_num_rows),
+        new_col_bytes = NumColBytes(num_rows);
+    const BlockHeader *old_headers =
+        reinterpret_cast<const BlockHeader*>(old_global_header + 1);
+    const uint8 *old_nibble_data = reinterpret_cast<const uint8*>(
+        old_headers + old_num_blocks * old_num_cols);
+    BlockHeader *new_headers = reinterpret_cast<BlockHeader*>(
+        reinterpret_cast<GlobalHeader*>(data_) + 1);
+    uint8 *new_nibble_data =
+        reinterpret_cast<uint8*>(new_headers + new_num_blocks * num_cols);
+    for (int32 i = 0; i < num_cols; i++) {
+      int32 old_col = col_offset + i;
+      memcpy(new_headers + i * new_num_blocks,
+             old_headers + old_col * old_num_blocks + row_offset / kBlockRows,
+             sizeof(BlockHeader) * new_num_blocks);
+      memcpy(new_nibble_data + i * new_col_bytes,
+             old_nibble_data + old_col * old_col_bytes + row_offset / 2,
+             new_col_bytes);
+    }
   } else if (format == kTwoByte) {
     const uint16 *old_data =
         reinterpret_cast<const uint16*>(old_global_header + 1);
@@ -520,6 +771,60 @@ void CompressedMatrix::CompressColumn(
   }
 }
 
+template<typename Real>  // static
+void CompressedMatrix::CompressColumnBlocks(
+    const GlobalHeader &global_header,
+    const Real *data, MatrixIndexT stride,
+    int32 num_rows, CompressedMatrix::BlockHeader *headers,
+    uint8 *nibble_data) {
+  memset(nibble_data, 0, NumColBytes(num_rows));
+  for (int32 begin = 0; begin < num_rows; begin += kBlockRows, headers++) {
+    int32 end = std::min<int32>(begin + kBlockRows, num_rows);
+    Real min_value = data[begin * stride], max_value = min_value;
+    for (int32 i = begin + 1; i < end; i++) {
+      Real value = data[i * stride];
+      if (value < min_value) min_value = value;
+      if (value > max_value) max_value = value;
+    }
+    uint16 lo = FloatToUint16(global_header, min_value),
+        hi = FloatToUint16(global_header, max_value);
+    if (hi <= lo) {  // e.g. if the block is constant.
+      if (lo < 65535) hi = lo + 1;
+      else lo = hi - 1;
+    }
+    headers->min_value = lo;
+    headers->max_value = hi;
+    float lo_value = Uint16ToFloat(global_header, lo),
+        scale = 15.0 / (Uint16ToFloat(global_header, hi) - lo_value);
+    for (int32 i = begin; i < end; i++) {
+      int32 q = static_cast<int32>((data[i * stride] - lo_value) * scale + 0.5);
+      if (q < 0) q = 0;
+      if (q > 15) q = 15;
+      nibble_data[i / 2] |= (i % 2 == 0 ? q : q << 4);
+    }
+  }
+}
+
+template<typename Real>  // static
+void CompressedMatrix::DecompressColumnBlocks(
+    const GlobalHeader &global_header,
+    const CompressedMatrix::BlockHeader *headers, const uint8 *nibble_data,
+    int32 row_begin, int32 row_end, Real *dest, MatrixIndexT stride) {
+  int32 i = row_begin;
+  while (i < row_end) {
+    const BlockHeader &header = headers[i / kBlockRows];
+    int32 block_end = std::min<int32>((i / kBlockRows + 1) * kBlockRows,
+                                      row_end);
+    float lo = Uint16ToFloat(global_header, header.min_value),
+        increment = (Uint16ToFloat(global_header, header.max_value) - lo) *
+        (1.0 / 15.0);
+    for (; i < block_end; i++, dest += stride) {
+      uint8 byte = nibble_data[i / 2];
+      *dest = lo + increment * (i % 2 == 0 ? byte & 15 : byte >> 4);
+    }
+  }
+}
+
 // static
 void* CompressedMatrix::AllocateData(int32 num_bytes) {
   KALDI_ASSERT(num_bytes > 0);
@@ -539,6 +844,8 @@ void CompressedMatrix::Write(std::ostream &os, bool binary) const {
         WriteToken(os, binary, "CM2");
       } else if (format == kOneByte) {
         WriteToken(os, binary, "CM3");
+      } else if (format == kFourBitBlocks) {
+        WriteToken(os, binary, "CM4");
       }
       MatrixIndexT size = DataSize(h);  // total size of data in data_
       // We don't write out the "int32 format", hence the + 4, - 4.
@@ -577,8 +884,10 @@ void CompressedMatrix::Read(std::istream &is, bool binary) {
       if (tok == "CM") { h.format = 1; } //  kOneByteWithColHeaders
       else if (tok == "CM2") { h.format = 2; }  // kTwoByte
       else if (tok == "CM3") { h.format = 3; }  // kOneByte
+      else if (tok == "CM4") { h.format = 4; }  // kFourBitBlocks
       else {
-        KALDI_ERR << "Unexpected token " << tok << ", expecting CM, CM2 or CM3";
+        KALDI_ERR << "Unexpected token " << tok
+                  << ", expecting CM, CM2, CM3 or CM4";
       }
       // don't read the "format" -> hence + 4, - 4.
       is.read(reinterpret_cast<char*>(&h) + 4, sizeof(h) - 4);
@@ -625,48 +934,9 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
     KALDI_ASSERT(mat->NumCols() == 0);
     return;
   }
-  GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
-  int32 num_cols = h->num_cols, num_rows = h->num_rows;
-  KALDI_ASSERT(mat->NumRows() == num_rows);
-  KALDI_ASSERT(mat->NumCols() == num_cols);
-
-  DataFormat format = static_cast<DataFormat>(h->format);
-  if (format == kOneByteWithColHeaders) {
-    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-    uint8 *byte_data = reinterpret_cast<uint8*>(per_col_header +
-                                                h->num_cols);
-    for (int32 i = 0; i < num_cols; i++, per_col_header++) {
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < num_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*mat)(j, i) = f;
-      }
-    }
-  } else if (format == kTwoByte) {
-    const uint16 *data = reinterpret_cast<const uint16*>(h + 1);
-    float min_value = h->min_value,
-        increment = h->range * (1.0 / 65535.0);
-    for (int32 i = 0; i < num_rows; i++) {
-      Real *row_data = mat->RowData(i);
-      for (int32 j = 0; j < num_cols; j++)
-        row_data[j] = min_value + data[j] * increment;
-      data += num_cols;
-    }
-  } else {
-    KALDI_ASSERT(format == kOneByte);
-    float min_value = h->min_value, increment = h->range * (1.0 / 255.0);
-
-    const uint8 *data = reinterpret_cast<const uint8*>(h + 1);
-    for (int32 i = 0; i < num_rows; i++) {
-      Real *row_data = mat->RowData(i);
-      for (int32 j = 0; j < num_cols; j++)
-        row_data[j] = min_value + data[j] * increment;
-      data += num_cols;
-    }
-  }
+  KALDI_ASSERT(mat->NumRows() == this->NumRows());
+  KALDI_ASSERT(mat->NumCols() == this->NumCols());
+  CopyToMat(0, 0, mat);
 }
 
 // Instantiate the template for float and double.
@@ -705,18 +975,25 @@ void CompressedMatrix::CopyRowToVec(MatrixIndexT row,
     float min_value = h->min_value,
         increment = h->range * (1.0 / 65535.0);
     const uint16 *row_data = reinterpret_cast<uint16*>(h + 1) + (num_cols * row);
+    Uint16RowToFloat(row_data, num_cols, min_value, increment, v->Data());
+  } else if (format == kFourBitBlocks) {
+    int32 num_blocks = NumBlocks(h->num_rows),
+        col_bytes = NumColBytes(h->num_rows);
+    const BlockHeader *headers = reinterpret_cast<const BlockHeader*>(h + 1);
+    const uint8 *nibble_data = reinterpret_cast<const uint8*>(
+        headers + num_blocks * h->num_cols);
     Real *v_data = v->Data();
-    for (int32 c = 0; c < num_cols; c++)
-      v_data[c] = min_value + row_data[c] * increment;
+    for (int32 c = 0; c < h->num_cols; c++)
+      DecompressColumnBlocks(*h, headers + c * num_blocks,
+                             nibble_data + c * col_bytes, row, row + 1,
+                             v_data + c, 1);
   } else {
     KALDI_ASSERT(format == kOneByte);
     int32 num_cols = h->num_cols;
     float min_value = h->min_value,
         increment = h->range * (1.0 / 255.0);
     const uint8 *row_data = reinterpret_cast<uint8*>(h + 1) + (num_cols * row);
-    Real *v_data = v->Data();
-    for (int32 c = 0; c < num_cols; c++)
-      v_data[c] = min_value + row_data[c] * increment;
+    Uint8RowToFloat(row_data, num_cols, min_value, increment, v->Data());
   }
 }
 
@@ -744,6 +1021,15 @@ void CompressedMatrix::CopyColToVec(MatrixIndexT col,
       float f = CharToFloat(p0, p25, p75, p100, *byte_data);
       (*v)(i) = f;
     }
+  } else if (format == kFourBitBlocks) {
+    int32 num_blocks = NumBlocks(h->num_rows),
+        col_bytes = NumColBytes(h->num_rows);
+    const BlockHeader *headers = reinterpret_cast<const BlockHeader*>(h + 1);
+    const uint8 *nibble_data = reinterpret_cast<const uint8*>(
+        headers + num_blocks * h->num_cols);
+    DecompressColumnBlocks(*h, headers + col * num_blocks,
+                           nibble_data + col * col_bytes, 0, h->num_rows,
+                           v->Data(), 1);
   } else if (format == kTwoByte) {
     int32 num_rows = h->num_rows, num_cols = h->num_cols;
     float min_value = h->min_value,
@@ -801,18 +1087,26 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
 
     per_col_header += col_offset;  // skip the appropriate number of headers
 
-    for (int32 i = 0;
-         i < tgt_cols;
-         i++, per_col_header++, start_of_subcol+=num_rows) {
-      byte_data = start_of_subcol;
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < tgt_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*dest)(j, i) = f;
-      }
+    std::vector<float> percentiles(4 * tgt_cols);
+    for (int32 i = 0; i < tgt_cols; i++) {
+      const PerColHeader &col_header = per_col_header[i];
+      percentiles[4 * i] = Uint16ToFloat(*h, col_header.percentile_0);
+      percentiles[4 * i + 1] = Uint16ToFloat(*h, col_header.percentile_25);
+      percentiles[4 * i + 2] = Uint16ToFloat(*h, col_header.percentile_75);
+      percentiles[4 * i + 3] = Uint16ToFloat(*h, col_header.percentile_100);
+    }
+    // This does the columns it can with SIMD.
+    int32 cols_done = ByteColumnsToFloat(percentiles.data(), start_of_subcol,
+                                         num_rows, tgt_rows, tgt_cols, dest);
+    start_of_subcol += cols_done * num_rows;
+
+    // the same map as ByteColumnsToFloat(), so that the values do not depend
+    // on which columns it did.
+    for (int32 i = cols_done; i < tgt_cols; i++, start_of_subcol += num_rows) {
+      float a[3], s[3];
+      ByteColumnParams(&(percentiles[4 * i]), a, s);
+      for (int32 j = 0; j < tgt_rows; j++)
+        (*dest)(j, i) = ByteToFloat(a, s, start_of_subcol[j]);
     }
   } else if (format == kTwoByte) {
     const uint16 *data = reinterpret_cast<const uint16*>(h+1) + col_offset +
@@ -821,11 +1115,20 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
         increment = h->range * (1.0 / 65535.0);
 
     for (int32 row = 0; row < tgt_rows; row++) {
-      Real *dest_row = dest->RowData(row);
-      for (int32 col = 0; col < tgt_cols; col++)
-        dest_row[col] = min_value + increment * data[col];
+      Uint16RowToFloat(data, tgt_cols, min_value, increment,
+                       dest->RowData(row));
       data += num_cols;
     }
+  } else if (format == kFourBitBlocks) {
+    int32 num_blocks = NumBlocks(num_rows), col_bytes = NumColBytes(num_rows);
+    const BlockHeader *headers = reinterpret_cast<const BlockHeader*>(h + 1);
+    const uint8 *nibble_data = reinterpret_cast<const uint8*>(
+        headers + num_blocks * num_cols);
+    for (int32 col = 0; col < tgt_cols; col++)
+      DecompressColumnBlocks(*h, headers + (col_offset + col) * num_blocks,
+                             nibble_data + (col_offset + col) * col_bytes,
+                             row_offset, row_offset + tgt_rows,
+                             dest->Data() + col, dest->Stride());
   } else {
     KALDI_ASSERT(format == kOneByte);
     const uint8 *data = reinterpret_cast<const uint8*>(h+1) + col_offset +
@@ -833,9 +1136,8 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
     float min_value = h->min_value,
         increment = h->range * (1.0 / 255.0);
     for (int32 row = 0; row < tgt_rows; row++) {
-      Real *dest_row = dest->RowData(row);
-      for (int32 col = 0; col < tgt_cols; col++)
-        dest_row[col] = min_value + increment * data[col];
+      Uint8RowToFloat(data, tgt_cols, min_value, increment,
+                      dest->RowData(row));
       data += num_cols;
     }
   }
@@ -67,6 +67,16 @@ namespace kaldi {
                         one byte as a uint8, with the representable range of
                         values equal to [0.0, 1.0].  Suitable for image data
                         that has previously been compressed as int8.
+    kFourBitBlockwise = 8 Each element is stored in four bits, and each block
+                        of 32 rows of each column has its own range (as two
+                        uint16's relative to the range of the matrix, like the
+                        column headers of kSpeechFeature), so it takes about 5
+                        bits per element.  Designed for features such as the
+                        high-dimensional acoustic features of TTS, which change
+                        slowly so that each block needs only a small range.
+                        Note: taking a range of rows that does not begin at a
+                        multiple of 32 (or that has padding) re-compresses the
+                        data, losing more precision.
 
     // We can add new methods here as needed: if they just imply different ways
     // of selecting the min_value and range, and a num-bytes = 1 or 2, they will
@@ -79,7 +89,8 @@ enum CompressionMethod {
   kTwoByteSignedInteger = 4,
   kOneByteAuto = 5,
   kOneByteUnsignedInteger = 6,
-  kOneByteZeroOne = 7
+  kOneByteZeroOne = 7,
+  kFourBitBlockwise = 8
 };
 
 
@@ -127,6 +138,18 @@ class CompressedMatrix {
 
   CompressedMatrix(const CompressedMatrix &mat);
 
+  /// Move constructor; leaves "mat" empty.
+  CompressedMatrix(CompressedMatrix &&mat) noexcept: data_(NULL) { Swap(&mat); }
+
+  /// Move assignment; leaves "mat" empty.
+  CompressedMatrix &operator = (CompressedMatrix &&mat) noexcept {
+    if (this != &mat) {
+      Clear();
+      Swap(&mat);
+    }
+    return *this;
+  }
+
   CompressedMatrix &operator = (const CompressedMatrix &mat); // assignment operator.
 
   template<typename Real>
@@ -178,6 +201,8 @@ class CompressedMatrix {
 
   friend class Matrix<float>;
   friend class Matrix<double>;
+  friend class CuMatrixBase<float>;  // for decompressing on the GPU.
+  friend class CuMatrixBase<double>;
  private:
 
   // This enum describes the different compressed-data formats: these are
@@ -198,12 +223,25 @@ class CompressedMatrix {
   //    order and is decompressed as:
   //       uint8 i;  GlobalHeader g;
   //       float f = g.min_value + i * (g.range / 255.0)
+  //  kFourBitBlocks means there is a global header, then a BlockHeader for
+  //    each block of kBlockRows rows of each column (column by column), then
+  //    the data in four bits per element, in column-major order with each
+  //    column starting on a new byte (and the even rows in the low bits); it's
+  //    decompressed as:
+  //       uint4 i;  BlockHeader b;
+  //       float lo = Uint16ToFloat(g, b.min_value),
+  //          hi = Uint16ToFloat(g, b.max_value),
+  //          f = lo + i * ((hi - lo) / 15.0)
   enum DataFormat {
     kOneByteWithColHeaders = 1,
     kTwoByte = 2,
-    kOneByte = 3
+    kOneByte = 3,
+    kFourBitBlocks = 4
   };
 
+  // the number of rows in each block, in format kFourBitBlocks.
+  enum { kBlockRows = 32 };
+
 
   // allocates data using new [], ensures byte alignment
   // sufficient for float.
@@ -238,6 +276,37 @@ class CompressedMatrix {
     uint16 percentile_100;
   };
 
+  // This struct is only used in format kFourBitBlocks.
+  struct BlockHeader {
+    uint16 min_value;
+    uint16 max_value;
+  };
+
+  // Used in format kFourBitBlocks: the number of blocks in each column, and
+  // the number of bytes of the data of each column.
+  static inline int32 NumBlocks(int32 num_rows) {
+    return (num_rows + kBlockRows - 1) / kBlockRows;
+  }
+  static inline int32 NumColBytes(int32 num_rows) {
+    return (num_rows + 1) / 2;
+  }
+
+  // Compresses a column in format kFourBitBlocks.
+  template<typename Real>
+  static void CompressColumnBlocks(const GlobalHeader &global_header,
+                                   const Real *data, MatrixIndexT stride,
+                                   int32 num_rows, BlockHeader *headers,
+                                   uint8 *nibble_data);
+
+  // Decompresses rows [row_begin, row_end) of a column in format
+  // kFourBitBlocks; "headers" and "nibble_data" are those of the column.
+  template<typename Real>
+  static void DecompressColumnBlocks(const GlobalHeader &global_header,
+                                     const BlockHeader *headers,
+                                     const uint8 *nibble_data,
+                                     int32 row_begin, int32 row_end,
+                                     Real *dest, MatrixIndexT stride);
+
   template<typename Real>
   static void CompressColumn(const GlobalHeader &global_header,
                              const Real *data, MatrixIndexT stride,
@@ -27,6 +27,8 @@
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/matrix-allocator.h"
+#include "matrix/simd-math.h"
 
 static_assert(int(kaldi::kNoTrans) == int(CblasNoTrans) && int(kaldi::kTrans) == int(CblasTrans), 
     "kaldi::kNoTrans and kaldi::kTrans must be equal to the appropriate CBLAS library constants!");
@@ -36,6 +38,7 @@ namespace kaldi {
 template<typename Real>
 void MatrixBase<Real>::Invert(Real *log_det, Real *det_sign,
                               bool inverse_needed) {
+  KALDI_PROFILE_SCOPE("MatrixBase::Invert");
   KALDI_ASSERT(num_rows_ == num_cols_);
   if (num_rows_ == 0) {
     if (det_sign) *det_sign = 1;
@@ -173,14 +176,22 @@ void MatrixBase<Real>::AddMatMat(const Real alpha,
                                   const MatrixBase<Real>& B,
                                   MatrixTransposeType transB,
                                   const Real beta) {
+  KALDI_PROFILE_SCOPE("MatrixBase::AddMatMat");
   KALDI_ASSERT((transA == kNoTrans && transB == kNoTrans && A.num_cols_ == B.num_rows_ && A.num_rows_ == num_rows_ && B.num_cols_ == num_cols_)
                || (transA == kTrans && transB == kNoTrans && A.num_rows_ == B.num_rows_ && A.num_cols_ == num_rows_ && B.num_cols_ == num_cols_)
                || (transA == kNoTrans && transB == kTrans && A.num_cols_ == B.num_cols_ && A.num_rows_ == num_rows_ && B.num_rows_ == num_cols_)
                || (transA == kTrans && transB == kTrans && A.num_rows_ == B.num_cols_ && A.num_cols_ == num_rows_ && B.num_rows_ == num_cols_));
   KALDI_ASSERT(&A !=  this && &B != this);
   if (num_rows_ == 0) return;
-  cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
-              transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_, stride_);
+  MatrixIndexT inner = (transA == kNoTrans ? A.num_cols_ : A.num_rows_);
+  if (IsSmallGemm(num_rows_, num_cols_, inner))
+    Xgemm_small(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
+                transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_,
+                stride_);
+  else
+    cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
+                transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_,
+                stride_);
 
 }
 
@@ -793,25 +804,20 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   KALDI_ASSERT(rows > 0 && cols > 0);
   MatrixIndexT skip, stride;
   size_t size;
-  void *data;  // aligned memory block
-  void *temp;  // memory block to be really freed
 
-  // compute the size of skip and real cols
-  skip = ((16 / sizeof(Real)) - cols % (16 / sizeof(Real)))
-      % (16 / sizeof(Real));
+  // compute the size of skip and real cols, so the rows are aligned.
+  MatrixIndexT align = MatrixAlignment() / sizeof(Real);
+  skip = (align - cols % align) % align;
   stride = cols + skip;
   size = static_cast<size_t>(rows) * static_cast<size_t>(stride)
       * sizeof(Real);
 
-  // allocate the memory and set the right dimensions and parameters
-  if (NULL != (data = KALDI_MEMALIGN(16, size, &temp))) {
-    MatrixBase<Real>::data_        = static_cast<Real *> (data);
-    MatrixBase<Real>::num_rows_      = rows;
-    MatrixBase<Real>::num_cols_      = cols;
-    MatrixBase<Real>::stride_  = (stride_type == kDefaultStride ? stride : cols);
-  } else {
-    throw std::bad_alloc();
-  }
+  // allocate the memory (this throws on failure) and set the right dimensions
+  // and parameters
+  MatrixBase<Real>::data_ = static_cast<Real*>(MatrixAllocate(size));
+  MatrixBase<Real>::num_rows_ = rows;
+  MatrixBase<Real>::num_cols_ = cols;
+  MatrixBase<Real>::stride_ = (stride_type == kDefaultStride ? stride : cols);
 }
 
 template<typename Real>
@@ -1127,7 +1133,7 @@ template<typename Real>
 void Matrix<Real>::Destroy() {
   // we need to free the data block if it was defined
   if (NULL != MatrixBase<Real>::data_)
-    KALDI_MEMALIGN_FREE( MatrixBase<Real>::data_);
+    MatrixFree(MatrixBase<Real>::data_);
   MatrixBase<Real>::data_ = NULL;
   MatrixBase<Real>::num_rows_ = MatrixBase<Real>::num_cols_
       = MatrixBase<Real>::stride_ = 0;
@@ -1140,29 +1146,19 @@ void MatrixBase<Real>::MulElements(const MatrixBase<Real> &a) {
   KALDI_ASSERT(a.NumRows() == num_rows_ && a.NumCols() == num_cols_);
 
   if (num_cols_ == stride_ && num_cols_ == a.stride_) {
-    mul_elements(num_rows_ * num_cols_, a.data_, data_);
+    SubVector<Real>(data_, num_rows_ * num_cols_).MulElements(
+        SubVector<Real>(a.data_, num_rows_ * num_cols_));
   } else {
-    MatrixIndexT a_stride = a.stride_, stride = stride_;
-    Real *data = data_, *a_data = a.data_;
-    for (MatrixIndexT i = 0; i < num_rows_; i++) {
-      mul_elements(num_cols_, a_data, data);
-      a_data += a_stride;
-      data += stride;
-    }
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      Row(i).MulElements(a.Row(i));
   }
 }
 
 template<typename Real>
 void MatrixBase<Real>::DivElements(const MatrixBase<Real> &a) {
   KALDI_ASSERT(a.NumRows() == num_rows_ && a.NumCols() == num_cols_);
-  MatrixIndexT i;
-  MatrixIndexT j;
-
-  for (i = 0; i < num_rows_; i++) {
-    for (j = 0; j < num_cols_; j++) {
-      (*this)(i, j) /= a(i, j);
-    }
-  }
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    Row(i).DivElements(a.Row(i));
 }
 
 template<typename Real>
@@ -1352,26 +1348,19 @@ void MatrixBase<Real>::SetUnit() {
 
 template<typename Real>
 void MatrixBase<Real>::SetRandn() {
+  // one state for all the rows, unless the thread has its own generator.
   kaldi::RandomState rstate;
-  for (MatrixIndexT row = 0; row < num_rows_; row++) {
-    Real *row_data = this->RowData(row);
-    MatrixIndexT nc = (num_cols_ % 2 == 1) ? num_cols_ - 1 : num_cols_;
-    for (MatrixIndexT col = 0; col < nc; col += 2) {
-      kaldi::RandGauss2(row_data + col, row_data + col + 1, &rstate);
-    }
-    if (nc != num_cols_) row_data[nc] = static_cast<Real>(kaldi::RandGauss(&rstate));
-  }
+  kaldi::RandomState *state = (kaldi::HasThreadRandSeed() ? NULL : &rstate);
+  for (MatrixIndexT row = 0; row < num_rows_; row++)
+    kaldi::RandGaussFill(this->RowData(row), num_cols_, state);
 }
 
 template<typename Real>
 void MatrixBase<Real>::SetRandUniform() {
   kaldi::RandomState rstate;
-  for (MatrixIndexT row = 0; row < num_rows_; row++) {
-    Real *row_data = this->RowData(row);
-    for (MatrixIndexT col = 0; col < num_cols_; col++, row_data++) {
-      *row_data = static_cast<Real>(kaldi::RandUniform(&rstate));
-    }
-  }
+  kaldi::RandomState *state = (kaldi::HasThreadRandSeed() ? NULL : &rstate);
+  for (MatrixIndexT row = 0; row < num_rows_; row++)
+    kaldi::RandUniformFill(this->RowData(row), num_cols_, state);
 }
 
 template<typename Real>
@@ -1674,11 +1663,8 @@ SubMatrix<Real>::SubMatrix(Real *data,
 
 template<typename Real>
 void MatrixBase<Real>::Add(const Real alpha) {
-  Real *data = data_;
-  MatrixIndexT stride = stride_;
   for (MatrixIndexT r = 0; r < num_rows_; r++)
-    for (MatrixIndexT c = 0; c < num_cols_; c++)
-      data[c + stride*r] += alpha;
+    Row(r).Add(alpha);
 }
 
 template<typename Real>
@@ -2099,22 +2085,14 @@ void Matrix<Real>::Transpose() {
 
 template<typename Real>
 void MatrixBase<Real>::ApplyFloor(Real floor_val) {
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  for (MatrixIndexT i = 0; i < num_rows; i++) {
-    Real *data = this->RowData(i);
-    for (MatrixIndexT j = 0; j < num_cols; j++)
-      data[j] = (data[j] < floor_val ? floor_val : data[j]);
-  }
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    Row(i).ApplyFloor(floor_val);
 }
 
 template<typename Real>
 void MatrixBase<Real>::ApplyCeiling(Real ceiling_val) {
-  MatrixIndexT num_rows = num_rows_, num_cols = num_cols_;
-  for (MatrixIndexT i = 0; i < num_rows; i++) {
-    Real *data = this->RowData(i);
-    for (MatrixIndexT j = 0; j < num_cols; j++)
-      data[j] = (data[j] > ceiling_val ? ceiling_val : data[j]);
-  }
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    Row(i).ApplyCeiling(ceiling_val);
 }
 
 template<typename Real>
@@ -2701,6 +2679,19 @@ Real MatrixBase<Real>::LogSumExp(Real prune) const {
   return max_elem + Log(sum_relto_max_elem);
 }
 
+// The float versions of the functions below use the vectorized functions of
+// simd-math.h.
+template<>
+float MatrixBase<float>::LogSumExp(float prune) const {
+  float max_elem = Max(), cutoff = max_elem + kMinLogDiffFloat;
+  if (prune > 0.0 && max_elem - prune > cutoff) // explicit pruning...
+    cutoff = max_elem - prune;
+  double sum_relto_max_elem = 0.0;
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    sum_relto_max_elem += SimdSumExp(RowData(i), max_elem, cutoff, num_cols_);
+  return max_elem + Log(sum_relto_max_elem);
+}
+
 template<typename Real>
 Real MatrixBase<Real>::ApplySoftMax() {
   Real max = this->Max(), sum = 0.0;
@@ -2712,6 +2703,16 @@ Real MatrixBase<Real>::ApplySoftMax() {
   return max + Log(sum);
 }
 
+template<>
+float MatrixBase<float>::ApplySoftMax() {
+  float max = this->Max();
+  double sum = 0.0;
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    sum += SimdApplyExpAndSum(max, RowData(i), num_cols_);
+  this->Scale(1.0 / sum);
+  return max + Log(sum);
+}
+
 template<typename Real>
 void MatrixBase<Real>::Tanh(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
@@ -2745,6 +2746,13 @@ void MatrixBase<Real>::SoftHinge(const MatrixBase<Real> &src) {
   }
 }
 
+template<>
+void MatrixBase<float>::SoftHinge(const MatrixBase<float> &src) {
+  KALDI_ASSERT(SameDim(*this, src));
+  for (MatrixIndexT r = 0; r < num_rows_; r++)
+    SimdSoftHinge(src.RowData(r), this->RowData(r), num_cols_);
+}
+
 template<typename Real>
 void MatrixBase<Real>::GroupPnorm(const MatrixBase<Real> &src, Real power) {
   KALDI_ASSERT(src.NumCols() % this->NumCols() == 0 &&
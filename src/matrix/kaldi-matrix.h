@@ -809,6 +809,12 @@ class Matrix : public MatrixBase<Real> {
   /// Same as above, but need to avoid default copy constructor.
   Matrix(const Matrix<Real> & M);  //  (cannot make explicit)
 
+  /// Move constructor: takes the memory of M, which is left empty.
+  Matrix(Matrix<Real> &&M) noexcept: MatrixBase<Real>() {
+    this->num_cols_ = this->num_rows_ = this->stride_ = 0;
+    Swap(&M);
+  }
+
   /// Copy constructor: as above, but from another type.
   template<typename OtherReal>
   explicit Matrix(const MatrixBase<OtherReal> & M,
@@ -887,6 +893,15 @@ class Matrix : public MatrixBase<Real> {
     return *this;
   }
 
+  /// Move assignment: takes the memory of "other", which is left empty.
+  Matrix<Real> &operator = (Matrix<Real> &&other) noexcept {
+    if (this != &other) {
+      Destroy();
+      Swap(&other);
+    }
+    return *this;
+  }
+
 
  private:
   /// Deallocates memory and sets to empty matrix (dimension 0, 0).
@@ -25,14 +25,84 @@
 
 #include <algorithm>
 #include <string>
+#include "base/cpu-dispatch.h"
 #include "matrix/cblas-wrappers.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/matrix-allocator.h"
+#include "matrix/simd-math.h"
 
 namespace kaldi {
 
+namespace {
+
+// The element-wise loops, which CpuDispatch() runs compiled for the
+// instruction set of the CPU (see base/cpu-dispatch.h).
+template<CpuIsa isa> struct AddKernel {
+  template<typename Real>
+  static KALDI_CPU_INLINE void Run(Real c, Real *data, MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] += c;
+  }
+};
+
+template<CpuIsa isa> struct AbsKernel {
+  template<typename Real>
+  static KALDI_CPU_INLINE void Run(Real *data, MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] = std::abs(data[i]);
+  }
+};
+
+template<CpuIsa isa> struct FloorKernel {
+  template<typename Real>
+  static KALDI_CPU_INLINE void Run(Real floor_val, Real *data,
+                                   MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] = std::max(data[i], floor_val);
+  }
+};
+
+template<CpuIsa isa> struct CeilingKernel {
+  template<typename Real>
+  static KALDI_CPU_INLINE void Run(Real ceil_val, Real *data,
+                                   MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] = std::min(data[i], ceil_val);
+  }
+};
+
+template<CpuIsa isa> struct MulElementsKernel {
+  template<typename Real, typename OtherReal>
+  static KALDI_CPU_INLINE void Run(const OtherReal *other, Real *data,
+                                   MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] *= other[i];
+  }
+};
+
+template<CpuIsa isa> struct DivElementsKernel {
+  template<typename Real, typename OtherReal>
+  static KALDI_CPU_INLINE void Run(const OtherReal *other, Real *data,
+                                   MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] /= other[i];
+  }
+};
+
+template<CpuIsa isa> struct AddVecDivVecKernel {
+  template<typename Real>
+  static KALDI_CPU_INLINE void Run(Real alpha, const Real *v, const Real *r,
+                                   Real beta, Real *data, MatrixIndexT dim) {
+    for (MatrixIndexT i = 0; i < dim; i++)
+      data[i] = alpha * v[i] / r[i] + beta * data[i];
+  }
+};
+
+}  // namespace
+
 template<typename Real>
 Real VecVec(const VectorBase<Real> &a,
             const VectorBase<Real> &b) {
@@ -97,8 +167,12 @@ void VectorBase<Real>::AddMatVec(const Real alpha,
   KALDI_ASSERT((trans == kNoTrans && M.NumCols() == v.dim_ && M.NumRows() == dim_)
                || (trans == kTrans && M.NumRows() == v.dim_ && M.NumCols() == dim_));
   KALDI_ASSERT(&v != this);
-  cblas_Xgemv(trans, M.NumRows(), M.NumCols(), alpha, M.Data(), M.Stride(),
-              v.Data(), 1, beta, data_, 1);
+  if (IsSmallGemv(M.NumRows(), M.NumCols()))
+    Xgemv_small(trans, M.NumRows(), M.NumCols(), alpha, M.Data(), M.Stride(),
+                v.Data(), beta, data_);
+  else
+    cblas_Xgemv(trans, M.NumRows(), M.NumCols(), alpha, M.Data(), M.Stride(),
+                v.Data(), 1, beta, data_, 1);
 }
 
 template<typename Real>
@@ -171,18 +245,9 @@ inline void Vector<Real>::Init(const MatrixIndexT dim) {
     this->data_ = NULL;
     return;
   }
-  MatrixIndexT size;
-  void *data;
-  void *free_data;
-
-  size = dim * sizeof(Real);
-
-  if ((data = KALDI_MEMALIGN(16, size, &free_data)) != NULL) {
-    this->data_ = static_cast<Real*> (data);
-    this->dim_ = dim;
-  } else {
-    throw std::bad_alloc();
-  }
+  // this throws on failure.
+  this->data_ = static_cast<Real*>(MatrixAllocate(dim * sizeof(Real)));
+  this->dim_ = dim;
 }
 
 
@@ -279,7 +344,7 @@ template<typename Real>
 void Vector<Real>::Destroy() {
   /// we need to free the data block if it was defined
   if (this->data_ != NULL)
-    KALDI_MEMALIGN_FREE(this->data_);
+    MatrixFree(this->data_);
   this->data_ = NULL;
   this->dim_ = 0;
 }
@@ -299,20 +364,12 @@ bool VectorBase<Real>::IsZero(Real cutoff) const {
 
 template<typename Real>
 void VectorBase<Real>::SetRandn() {
-  kaldi::RandomState rstate;
-  MatrixIndexT last = (Dim() % 2 == 1) ? Dim() - 1 : Dim();
-  for (MatrixIndexT i = 0; i < last; i += 2) {
-    kaldi::RandGauss2(data_ + i, data_ + i +1, &rstate);
-  }
-  if (Dim() != last) data_[last] = static_cast<Real>(kaldi::RandGauss(&rstate));
+  kaldi::RandGaussFill(data_, dim_);
 }
 
 template<typename Real>
 void VectorBase<Real>::SetRandUniform() {
-  kaldi::RandomState rstate;
-  for (MatrixIndexT i = 0; i < Dim(); i++) {
-    *(data_+i) = RandUniform(&rstate);
-  }
+  kaldi::RandUniformFill(data_, dim_);
 }
 
 template<typename Real>
@@ -777,6 +834,16 @@ Real VectorBase<Real>::LogSumExp(Real prune) const {
   return max_elem + Log(sum_relto_max_elem);
 }
 
+// The float versions of the functions below use the vectorized functions of
+// simd-math.h.
+template<>
+float VectorBase<float>::LogSumExp(float prune) const {
+  float max_elem = Max(), cutoff = max_elem + kMinLogDiffFloat;
+  if (prune > 0.0 && max_elem - prune > cutoff) // explicit pruning...
+    cutoff = max_elem - prune;
+  return max_elem + Log(SimdSumExp(data_, max_elem, cutoff, dim_));
+}
+
 template<typename Real>
 void VectorBase<Real>::InvertElements() {
   for (MatrixIndexT i = 0; i < dim_; i++) {
@@ -793,6 +860,14 @@ void VectorBase<Real>::ApplyLog() {
   }
 }
 
+template<>
+void VectorBase<float>::ApplyLog() {
+  for (MatrixIndexT i = 0; i < dim_; i++)
+    if (data_[i] < 0.0)
+      KALDI_ERR << "Trying to take log of a negative number.";
+  SimdLog(data_, data_, dim_);
+}
+
 template<typename Real>
 void VectorBase<Real>::ApplyLogAndCopy(const VectorBase<Real> &v) {
   KALDI_ASSERT(dim_ == v.Dim());
@@ -808,17 +883,20 @@ void VectorBase<Real>::ApplyExp() {
   }
 }
 
+template<>
+void VectorBase<float>::ApplyExp() {
+  SimdExp(data_, data_, dim_);
+}
+
 template<typename Real>
 void VectorBase<Real>::ApplyAbs() {
-  for (MatrixIndexT i = 0; i < dim_; i++) { data_[i] = std::abs(data_[i]); }
+  CpuDispatch<AbsKernel>(data_, dim_);
 }
 
 template<typename Real>
 void VectorBase<Real>::ApplyFloor(Real floor_val, MatrixIndexT *floored_count) {
   if (floored_count == nullptr) {
-    for (MatrixIndexT i = 0; i < dim_; i++) {
-      data_[i] = std::max(data_[i], floor_val);
-    }
+    CpuDispatch<FloorKernel>(floor_val, data_, dim_);
   } else {
     MatrixIndexT num_floored = 0;
     for (MatrixIndexT i = 0; i < dim_; i++) {
@@ -834,9 +912,7 @@ void VectorBase<Real>::ApplyFloor(Real floor_val, MatrixIndexT *floored_count) {
 template<typename Real>
 void VectorBase<Real>::ApplyCeiling(Real ceil_val, MatrixIndexT *ceiled_count) {
   if (ceiled_count == nullptr) {
-    for (MatrixIndexT i = 0; i < dim_; i++) {
-      data_[i] = std::min(data_[i], ceil_val);
-    }
+    CpuDispatch<CeilingKernel>(ceil_val, data_, dim_);
   } else {
     MatrixIndexT num_changed = 0;
     for (MatrixIndexT i = 0; i < dim_; i++) {
@@ -872,6 +948,13 @@ Real VectorBase<Real>::ApplySoftMax() {
   return max + Log(sum);
 }
 
+template<>
+float VectorBase<float>::ApplySoftMax() {
+  float max = this->Max(), sum = SimdApplyExpAndSum(max, data_, dim_);
+  this->Scale(1.0 / sum);
+  return max + Log(sum);
+}
+
 template<typename Real>
 Real VectorBase<Real>::ApplyLogSoftMax() {
   Real max = this->Max(), sum = 0.0;
@@ -883,6 +966,16 @@ Real VectorBase<Real>::ApplyLogSoftMax() {
   return max + sum;
 }
 
+template<>
+float VectorBase<float>::ApplyLogSoftMax() {
+  float max = this->Max();
+  this->Add(-max);
+  const float inf = std::numeric_limits<float>::infinity();
+  float sum = Log(SimdSumExp(data_, 0.0, -inf, dim_));
+  this->Add(-1.0 * sum);
+  return max + sum;
+}
+
 #ifdef HAVE_MKL
 template<>
 void VectorBase<float>::Tanh(const VectorBase<float> &src) {
@@ -910,6 +1003,12 @@ void VectorBase<Real>::Tanh(const VectorBase<Real> &src) {
     data_[i] = x;
   }
 }
+
+template<>
+void VectorBase<float>::Tanh(const VectorBase<float> &src) {
+  KALDI_ASSERT(dim_ == src.dim_);
+  SimdTanh(src.data_, data_, dim_);
+}
 #endif
 
 #ifdef HAVE_MKL
@@ -948,14 +1047,18 @@ void VectorBase<Real>::Sigmoid(const VectorBase<Real> &src) {
     data_[i] = x;
   }
 }
+
+template<>
+void VectorBase<float>::Sigmoid(const VectorBase<float> &src) {
+  KALDI_ASSERT(dim_ == src.dim_);
+  SimdSigmoid(src.data_, data_, dim_);
+}
 #endif
 
 
 template<typename Real>
 void VectorBase<Real>::Add(Real c) {
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] += c;
-  }
+  CpuDispatch<AddKernel>(c, data_, dim_);
 }
 
 template<typename Real>
@@ -966,9 +1069,7 @@ void VectorBase<Real>::Scale(Real alpha) {
 template<typename Real>
 void VectorBase<Real>::MulElements(const VectorBase<Real> &v) {
   KALDI_ASSERT(dim_ == v.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] *= v.data_[i];
-  }
+  CpuDispatch<MulElementsKernel>(v.data_, data_, dim_);
 }
 
 template<typename Real>  // Set each element to y = (x == orig ? changed : x).
@@ -983,10 +1084,7 @@ template<typename Real>
 template<typename OtherReal>
 void VectorBase<Real>::MulElements(const VectorBase<OtherReal> &v) {
   KALDI_ASSERT(dim_ == v.Dim());
-  const OtherReal *other_ptr = v.Data();
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] *= other_ptr[i];
-  }
+  CpuDispatch<MulElementsKernel>(v.Data(), data_, dim_);
 }
 // instantiate template.
 template
@@ -1009,19 +1107,14 @@ void VectorBase<Real>::AddVecVec(Real alpha, const VectorBase<Real> &v,
 template<typename Real>
 void VectorBase<Real>::DivElements(const VectorBase<Real> &v) {
   KALDI_ASSERT(dim_ == v.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] /= v.data_[i];
-  }
+  CpuDispatch<DivElementsKernel>(v.data_, data_, dim_);
 }
 
 template<typename Real>
 template<typename OtherReal>
 void VectorBase<Real>::DivElements(const VectorBase<OtherReal> &v) {
   KALDI_ASSERT(dim_ == v.Dim());
-  const OtherReal *other_ptr = v.Data();
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] /= other_ptr[i];
-  }
+  CpuDispatch<DivElementsKernel>(v.Data(), data_, dim_);
 }
 // instantiate template.
 template
@@ -1033,9 +1126,8 @@ template<typename Real>
 void VectorBase<Real>::AddVecDivVec(Real alpha, const VectorBase<Real> &v,
                                     const VectorBase<Real> &rr, Real beta) {
   KALDI_ASSERT((dim_ == v.dim_ && dim_ == rr.dim_));
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] = alpha * v.data_[i]/rr.data_[i] + beta * data_[i] ;
-  }
+  CpuDispatch<AddVecDivVecKernel>(alpha, v.data_, rr.data_, beta, data_,
+                                  dim_);
 }
 
 template<typename Real>
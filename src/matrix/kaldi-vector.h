@@ -409,6 +409,9 @@ class Vector: public VectorBase<Real> {
     this->CopyFromVec(v);
   }
 
+  /// Move constructor: takes the memory of v, which is left empty.
+  Vector(Vector<Real> &&v) noexcept: VectorBase<Real>() { Swap(&v); }
+
   /// Copy-constructor from base-class, needed to copy from SubVector.
   explicit Vector(const VectorBase<Real> &v) : VectorBase<Real>() {
     Resize(v.Dim(), kUndefined);
@@ -460,6 +463,15 @@ class Vector: public VectorBase<Real> {
     return *this;
   }
 
+  /// Move assignment: takes the memory of "other", which is left empty.
+  Vector<Real> &operator = (Vector<Real> &&other) noexcept {
+    if (this != &other) {
+      Destroy();
+      Swap(&other);
+    }
+    return *this;
+  }
+
   /// Assignment operator that takes VectorBase.
   Vector<Real> &operator = (const VectorBase<Real> &other) {
     Resize(other.Dim(), kUndefined);
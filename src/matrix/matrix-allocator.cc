@@ -0,0 +1,181 @@
+// matrix/matrix-allocator.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "matrix/matrix-allocator.h"
+
+namespace kaldi {
+
+MatrixAllocatorOptions g_matrix_allocator_options;
+
+namespace {
+
+// Each block starts with as many bytes as the alignment it was allocated with,
+// the last of which hold this header, and the data follows.
+struct BlockHeader {
+  void *base;  // what was returned by KALDI_MEMALIGN.
+  size_t num_bytes;  // the size of the data.
+};
+
+const size_t kHugePageSize = 2 << 20;
+
+inline BlockHeader *HeaderOf(void *data) {
+  return reinterpret_cast<BlockHeader*>(data) - 1;
+}
+
+// The pool of freed blocks, by size, and the statistics.  This is never
+// destroyed, as matrices in static objects may be freed after it would be.
+struct MatrixPool {
+  std::mutex mutex;
+  std::map<size_t, std::vector<void*> > blocks;
+  size_t num_bytes;  // the total size of the blocks in the pool.
+
+  std::atomic<int64> num_allocations, num_pool_hits, num_huge;
+  std::atomic<int64> bytes_in_use, max_bytes_in_use;
+
+  MatrixPool(): num_bytes(0), num_allocations(0), num_pool_hits(0),
+                num_huge(0), bytes_in_use(0), max_bytes_in_use(0) { }
+};
+
+MatrixPool &GetPool() {
+  static MatrixPool *pool = new MatrixPool();
+  return *pool;
+}
+
+}  // namespace
+
+int32 MatrixAlignment() {
+  return g_matrix_allocator_options.alignment;
+}
+
+static void *AllocateBlock(size_t num_bytes) {
+  const MatrixAllocatorOptions &opts = g_matrix_allocator_options;
+  size_t alignment = opts.alignment, block_alignment = alignment;
+  bool huge = (opts.huge_page_threshold_mb > 0 &&
+               num_bytes >= (static_cast<size_t>(opts.huge_page_threshold_mb)
+                             << 20));
+  if (huge)
+    block_alignment = kHugePageSize;
+  size_t total_bytes = alignment + num_bytes;
+  void *base, *aligned;
+  if ((aligned = KALDI_MEMALIGN(block_alignment, total_bytes, &base)) == NULL)
+    throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (huge)  // failure (e.g. if THP is not enabled) is harmless.
+    madvise(base, (total_bytes + kHugePageSize - 1) & ~(kHugePageSize - 1),
+            MADV_HUGEPAGE);
+#endif
+  void *data = static_cast<char*>(aligned) + alignment;
+  BlockHeader *header = HeaderOf(data);
+  header->base = base;
+  header->num_bytes = num_bytes;
+  if (opts.print_stats && huge)
+    GetPool().num_huge++;
+  return data;
+}
+
+void *MatrixAllocate(size_t num_bytes) {
+  KALDI_ASSERT(num_bytes > 0);
+  const MatrixAllocatorOptions &opts = g_matrix_allocator_options;
+  opts.Check();
+  MatrixPool &pool = GetPool();
+  if (opts.print_stats) {
+    pool.num_allocations++;
+    int64 in_use = (pool.bytes_in_use += num_bytes),
+        max_in_use = pool.max_bytes_in_use;
+    while (in_use > max_in_use &&
+           !pool.max_bytes_in_use.compare_exchange_weak(max_in_use, in_use));
+  }
+  if (opts.pool_mb > 0) {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    std::map<size_t, std::vector<void*> >::iterator iter =
+        pool.blocks.find(num_bytes);
+    while (iter != pool.blocks.end() && !iter->second.empty()) {
+      void *data = iter->second.back();
+      iter->second.pop_back();
+      pool.num_bytes -= num_bytes;
+      if (reinterpret_cast<size_t>(data) % opts.alignment == 0) {
+        if (opts.print_stats)
+          pool.num_pool_hits++;
+        return data;
+      }
+      // it was allocated with a smaller alignment than is now required.
+      KALDI_MEMALIGN_FREE(HeaderOf(data)->base);
+    }
+  }
+  return AllocateBlock(num_bytes);
+}
+
+void MatrixFree(void *data) {
+  if (data == NULL)
+    return;
+  const MatrixAllocatorOptions &opts = g_matrix_allocator_options;
+  BlockHeader *header = HeaderOf(data);
+  size_t num_bytes = header->num_bytes;
+  MatrixPool &pool = GetPool();
+  if (opts.print_stats)
+    pool.bytes_in_use -= num_bytes;
+  if (opts.pool_mb > 0) {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.num_bytes + num_bytes <=
+        (static_cast<size_t>(opts.pool_mb) << 20)) {
+      pool.blocks[num_bytes].push_back(data);
+      pool.num_bytes += num_bytes;
+      return;
+    }
+  }
+  KALDI_MEMALIGN_FREE(header->base);
+}
+
+void ReleaseMatrixPool() {
+  MatrixPool &pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  std::map<size_t, std::vector<void*> >::iterator iter = pool.blocks.begin();
+  for (; iter != pool.blocks.end(); ++iter)
+    for (size_t i = 0; i < iter->second.size(); i++)
+      KALDI_MEMALIGN_FREE(HeaderOf(iter->second[i])->base);
+  pool.blocks.clear();
+  pool.num_bytes = 0;
+}
+
+void PrintMatrixAllocatorStats() {
+  if (!g_matrix_allocator_options.print_stats)
+    return;
+  MatrixPool &pool = GetPool();
+  int64 num_allocations = pool.num_allocations,
+      num_pool_hits = pool.num_pool_hits, num_huge = pool.num_huge,
+      max_bytes_in_use = pool.max_bytes_in_use,
+      bytes_in_use = pool.bytes_in_use;
+  KALDI_LOG << "Matrix allocator: " << num_allocations << " allocations, of "
+            << "which " << num_pool_hits << " reused memory from the pool and "
+            << num_huge << " used huge pages; at most "
+            << (max_bytes_in_use / 1048576.0) << " MB in use at once, "
+            << (bytes_in_use / 1048576.0) << " MB still in use.";
+}
+
+}  // namespace kaldi
@@ -0,0 +1,108 @@
+// matrix/matrix-allocator.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_MATRIX_ALLOCATOR_H_
+#define KALDI_MATRIX_MATRIX_ALLOCATOR_H_
+
+#include <cstddef>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+// The options of the allocator of the data of Matrix, Vector and
+// PackedMatrix (and of CuMatrix etc. when not using a GPU).  The defaults
+// give the same behavior as plain aligned malloc and free.
+struct MatrixAllocatorOptions {
+  // The alignment in bytes of the data (and of the rows of a Matrix, whose
+  // stride is rounded up to a multiple of it); a power of two, at least 16.
+  // 64 suits AVX-512 and cache lines.
+  int32 alignment;
+
+  // Allocations of at least this many megabytes are aligned to huge pages
+  // and, on Linux, advised to use transparent huge pages (madvise), which
+  // reduces TLB misses on large feature or egs matrices.  0 disables it.
+  int32 huge_page_threshold_mb;
+
+  // The maximum size in megabytes of the freed blocks kept for reuse by
+  // allocations of the same size, which saves the cost of malloc and free
+  // (and of page faults) for programs that repeatedly allocate matrices of
+  // the same sizes.  0 disables the pool.
+  int32 pool_mb;
+
+  // If true, the allocator counts its allocations, pool hits and sizes, and
+  // PrintMatrixAllocatorStats() prints them.
+  bool print_stats;
+
+  MatrixAllocatorOptions(): alignment(16), huge_page_threshold_mb(0),
+                            pool_mb(0), print_stats(false) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("matrix-alignment", &alignment, "Alignment in bytes of the "
+                 "data of CPU matrices and vectors (a power of two >= 16).");
+    po->Register("matrix-huge-page-threshold-mb", &huge_page_threshold_mb,
+                 "CPU matrices and vectors of at least this many MB use "
+                 "transparent huge pages where supported; 0 to disable.");
+    po->Register("matrix-pool-mb", &pool_mb, "Size in MB of the pool of "
+                 "freed CPU matrix and vector memory kept for reuse by "
+                 "allocations of the same size; 0 to disable.");
+    po->Register("matrix-allocator-stats", &print_stats, "If true, collect "
+                 "and print statistics of CPU matrix and vector allocations.");
+  }
+
+  void Check() const {
+    KALDI_ASSERT(alignment >= 16 && (alignment & (alignment - 1)) == 0);
+    KALDI_ASSERT(huge_page_threshold_mb >= 0 && pool_mb >= 0);
+  }
+};
+
+// The options of the allocator.  They are read at each allocation, so they
+// can be changed at any time (before the program uses more than one thread);
+// memory allocated before is still freed correctly.
+extern MatrixAllocatorOptions g_matrix_allocator_options;
+
+inline void RegisterMatrixAllocatorOptions(OptionsItf *po) {
+  g_matrix_allocator_options.Register(po);
+}
+
+/// Returns the current alignment, in bytes.
+int32 MatrixAlignment();
+
+/// Allocates "num_bytes" (> 0) bytes aligned to MatrixAlignment(), and throws
+/// std::bad_alloc on failure.  The memory must be freed with MatrixFree().
+void *MatrixAllocate(size_t num_bytes);
+
+/// Frees memory from MatrixAllocate(); does nothing if "data" is NULL.
+void MatrixFree(void *data);
+
+/// Frees the memory kept in the pool.
+void ReleaseMatrixPool();
+
+/// Prints the statistics of the allocator, if --matrix-allocator-stats=true.
+void PrintMatrixAllocatorStats();
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_MATRIX_ALLOCATOR_H_
@@ -23,6 +23,7 @@
 
 #include "matrix/matrix-functions.h"
 #include "matrix/sp-matrix.h"
+#include "matrix/kaldi-blas.h"
 
 namespace kaldi {
 
@@ -769,5 +770,18 @@ void AddOuterProductPlusMinus<double>(double alpha,
                                       MatrixBase<double> *plus,
                                       MatrixBase<double> *minus);
 
+bool SetBlasNumThreads(int32 num_threads) {
+  KALDI_ASSERT(num_threads > 0);
+#if defined(HAVE_OPENBLAS)
+  openblas_set_num_threads(num_threads);
+  return true;
+#elif defined(HAVE_MKL)
+  mkl_set_num_threads(num_threads);
+  return true;
+#else
+  return false;
+#endif
+}
+
 
 } // end namespace kaldi
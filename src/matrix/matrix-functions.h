@@ -163,6 +163,11 @@ inline void AssertSameDim(const MatrixBase<Real1> &mat1, const MatrixBase<Real2>
                && mat1.NumCols() == mat2.NumCols());
 }
 
+/// Limits the threads the BLAS uses for each call (OpenBLAS and MKL), for
+/// programs that run their own threads; returns false if this BLAS cannot
+/// be told (ATLAS and CLAPACK, which are built single or multi threaded).
+bool SetBlasNumThreads(int32 num_threads);
+
 
 /// @} end of "addtogroup matrix_funcs_misc"
 
@@ -22,6 +22,8 @@
 // limitations under the License.
 
 #include "matrix/matrix-lib.h"
+#include "matrix/cblas-wrappers.h"
+#include "matrix/simd-math.h"
 #include "base/timer.h"
 #include <numeric>
 
@@ -132,6 +134,58 @@ static void UnitTestAddMatMatSpeed() {
   CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
 }
 
+// Compares Xgemm_small() and Xgemv_small() with BLAS for small square
+// matrices, to show where kSmallGemmSize and kSmallGemvSize should be.
+template<typename Real>
+static void UnitTestSmallMatMatSpeed() {
+  Timer t;
+  int32 sizes[] = { 2, 4, 8, 12, 16, 20, 24, 32, 40, 64 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    MatrixIndexT size = sizes[i];
+    int32 num_iters = 20000000 / (size * size * size) + 10;
+    Matrix<Real> A(size, size), B(size, size), C(size, size);
+    A.SetRandn(); B.SetRandn();
+    Vector<Real> x(size), y(size);
+    x.SetRandn();
+    {
+      Timer t1;
+      for (int32 j = 0; j < num_iters; j++)
+        cblas_Xgemm(Real(1.0), kNoTrans, A.Data(), size, size, A.Stride(),
+                    kTrans, B.Data(), B.Stride(), Real(0.5), C.Data(), size,
+                    size, C.Stride());
+      CsvResult<Real>("AddMatMat with BLAS (us per call)", size,
+                      1.0e+06 * t1.Elapsed() / num_iters, "microseconds");
+    }
+    {
+      Timer t1;
+      for (int32 j = 0; j < num_iters; j++)
+        Xgemm_small(Real(1.0), kNoTrans, A.Data(), size, size, A.Stride(),
+                    kTrans, B.Data(), B.Stride(), Real(0.5), C.Data(), size,
+                    size, C.Stride());
+      CsvResult<Real>("AddMatMat with Xgemm_small (us per call)", size,
+                      1.0e+06 * t1.Elapsed() / num_iters, "microseconds");
+    }
+    num_iters *= size;
+    {
+      Timer t1;
+      for (int32 j = 0; j < num_iters; j++)
+        cblas_Xgemv(kNoTrans, size, size, Real(1.0), A.Data(), A.Stride(),
+                    x.Data(), 1, Real(0.5), y.Data(), 1);
+      CsvResult<Real>("AddMatVec with BLAS (us per call)", size,
+                      1.0e+06 * t1.Elapsed() / num_iters, "microseconds");
+    }
+    {
+      Timer t1;
+      for (int32 j = 0; j < num_iters; j++)
+        Xgemv_small(kNoTrans, size, size, Real(1.0), A.Data(), A.Stride(),
+                    x.Data(), Real(0.5), y.Data());
+      CsvResult<Real>("AddMatVec with Xgemv_small (us per call)", size,
+                      1.0e+06 * t1.Elapsed() / num_iters, "microseconds");
+    }
+  }
+  CsvResult<Real>(__func__, 0, t.Elapsed(), "seconds");
+}
+
 template<typename Real>
 static void UnitTestAddRowSumMatSpeed() {
   Timer t;
@@ -254,15 +308,56 @@ static void UnitTestAddVecToColsSpeed() {
   CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
 }
 
+// The element-wise functions, which for float use simd-math.h.
+template<typename Real>
+static void UnitTestElementwiseFunctionSpeed() {
+  KALDI_LOG << "The functions of simd-math.h use "
+            << SimdMathInstructionSet();
+  Timer t;
+  std::vector<MatrixIndexT> sizes;
+  sizes.push_back(16);
+  sizes.push_back(128);
+  sizes.push_back(1024);
+  const char *names[] = { "Sigmoid", "Tanh", "ApplyExp", "SoftHinge",
+                          "ApplySoftMax", "LogSumExp" };
+  for (size_t s = 0; s < sizes.size(); s++) {
+    MatrixIndexT size = sizes[s];
+    Matrix<Real> M(size, size), N(size, size);
+    M.SetRandn();
+    for (int32 f = 0; f < 6; f++) {
+      BaseFloat time_in_secs = 0.05;
+      Timer t1;
+      int32 iter = 0;
+      for (; t1.Elapsed() < time_in_secs; iter++) {
+        switch (f) {
+          case 0: N.Sigmoid(M); break;
+          case 1: N.Tanh(M); break;
+          case 2: N.CopyFromMat(M); N.ApplyExp(); break;
+          case 3: N.SoftHinge(M); break;
+          case 4: N.CopyFromMat(M); N.ApplySoftMax(); break;
+          default: M.LogSumExp();
+        }
+      }
+      BaseFloat fdim = size;
+      BaseFloat ns_per_element = 1.0e+09 * t1.Elapsed() /
+          (fdim * fdim * iter);
+      CsvResult<Real>(names[f], size, ns_per_element, "ns per element");
+    }
+  }
+  CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
+}
+
 template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestRealFftSpeed<Real>();
   UnitTestSplitRadixRealFftSpeed<Real>();
   UnitTestSvdSpeed<Real>();
   UnitTestAddMatMatSpeed<Real>();
+  UnitTestSmallMatMatSpeed<Real>();
   UnitTestAddRowSumMatSpeed<Real>();
   UnitTestAddColSumMatSpeed<Real>();
   UnitTestAddVecToRowsSpeed<Real>();
   UnitTestAddVecToColsSpeed<Real>();
+  UnitTestElementwiseFunctionSpeed<Real>();
 }
 
 } // namespace kaldi
@@ -29,6 +29,9 @@
 #include <time.h> // This is only needed for UnitTestSvdSpeed, you can
 // comment it (and that function) out if it causes problems.  
 #include <matrix/cblas-wrappers.h>
+#include "base/cpu-dispatch.h"
+#include "matrix/matrix-allocator.h"
+#include "matrix/simd-math.h"
 
 namespace kaldi {
 
@@ -1895,6 +1898,31 @@ static void UnitTestResizeCopyDataDifferentStrideType() {
 }
 
 
+template<typename Real>
+static void UnitTestMove() {
+  Matrix<Real> M(RandInt(1, 10), RandInt(1, 10));
+  M.SetRandn();
+  Matrix<Real> Mcopy(M), N(std::move(M));
+  AssertEqual(N, Mcopy);
+  KALDI_ASSERT(M.NumRows() == 0 && M.NumCols() == 0);
+  M = std::move(N);
+  AssertEqual(M, Mcopy);
+  KALDI_ASSERT(N.NumRows() == 0 && N.Data() == NULL);
+
+  Vector<Real> v(RandInt(1, 10));
+  v.SetRandn();
+  Vector<Real> vcopy(v), w(std::move(v));
+  AssertEqual(w, vcopy);
+  KALDI_ASSERT(v.Dim() == 0);
+  v = std::move(w);
+  AssertEqual(v, vcopy);
+  KALDI_ASSERT(w.Dim() == 0 && w.Data() == NULL);
+
+  CompressedMatrix C(Mcopy), Cmoved(std::move(C));
+  KALDI_ASSERT(C.NumRows() == 0 && Cmoved.NumRows() == Mcopy.NumRows());
+}
+
+
 template<typename Real>
 static void UnitTestResize() {
   for (size_t i = 0; i < 10; i++) {
@@ -4054,6 +4082,93 @@ template<typename Real> static void UnitTestCompressedMatrix2() {
 }
 
 
+template<typename Real> static void UnitTestCompressedMatrixFourBit() {
+  for (int32 n = 0; n < 20; n++) {
+    int32 num_rows = RandInt(1, 100), num_cols = RandInt(1, 20);
+    Matrix<Real> mat(num_rows, num_cols);
+    mat.SetRandn();
+    if (RandInt(0, 1) == 0)  // a slowly changing column.
+      for (int32 r = 0; r < num_rows; r++)
+        mat(r, 0) = 0.1 * r;
+    CompressedMatrix cmat(mat, kFourBitBlockwise);
+    Matrix<Real> mat2(cmat);
+    // Each element is within half a step (of 15 per block) of the original;
+    // we allow a little more for the rounding of the block range.
+    float range = mat.Max() - mat.Min();
+    for (int32 c = 0; c < num_cols; c++) {
+      for (int32 begin = 0; begin < num_rows; begin += 32) {
+        int32 end = std::min(begin + 32, num_rows);
+        SubMatrix<Real> block(mat, begin, end - begin, c, 1);
+        float tolerance = (block.Max() - block.Min()) / 30.0 + 0.001 * range;
+        for (int32 r = begin; r < end; r++)
+          KALDI_ASSERT(std::abs(mat(r, c) - mat2(r, c)) <= tolerance);
+      }
+    }
+    for (int32 r = 0; r < num_rows; r++) {
+      Vector<Real> row(num_cols);
+      cmat.CopyRowToVec(r, &row);
+      KALDI_ASSERT(row.ApproxEqual(mat2.Row(r), 0.0));
+    }
+    for (int32 c = 0; c < num_cols; c++) {
+      Vector<Real> col(num_rows);
+      cmat.CopyColToVec(c, &col);
+      Vector<Real> col2(num_rows);
+      col2.CopyColFromMat(mat2, c);
+      KALDI_ASSERT(col.ApproxEqual(col2, 0.0));
+    }
+    {  // I/O.
+      std::ostringstream os;
+      cmat.Write(os, true);
+      CompressedMatrix cmat2;
+      std::istringstream is(os.str());
+      cmat2.Read(is, true);
+      Matrix<Real> mat3(cmat2);
+      KALDI_ASSERT(mat3.ApproxEqual(mat2, 0.0));
+    }
+    {  // sub-matrices: exact if the row offset is a multiple of 32, else
+       // re-compressed.
+      int32 row_offset = (RandInt(0, 1) == 0 ? 32 * RandInt(0, (num_rows - 1) / 32) :
+                          RandInt(0, num_rows - 1)),
+          col_offset = RandInt(0, num_cols - 1),
+          sub_rows = RandInt(1, num_rows - row_offset),
+          sub_cols = RandInt(1, num_cols - col_offset);
+      CompressedMatrix cmat_sub(cmat, row_offset, sub_rows, col_offset,
+                                sub_cols);
+      Matrix<Real> mat_sub(cmat_sub);
+      SubMatrix<Real> mat2_sub(mat2, row_offset, sub_rows, col_offset,
+                               sub_cols);
+      if (row_offset % 32 == 0)
+        KALDI_ASSERT(mat_sub.ApproxEqual(mat2_sub, 0.0));
+      else
+        KALDI_ASSERT(mat_sub.ApproxEqual(mat2_sub, 0.2));
+    }
+  }
+}
+
+// Checks that the (SIMD) decompression into float gives the same as the one
+// into double.
+static void UnitTestCompressedMatrixFloatDouble() {
+  for (int32 n = 0; n < 20; n++) {
+    int32 num_rows = RandInt(1, 70), num_cols = RandInt(1, 40);
+    Matrix<float> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CompressionMethod methods[] = { kSpeechFeature, kTwoByteAuto,
+                                    kOneByteAuto, kFourBitBlockwise };
+    CompressedMatrix cmat(mat, methods[RandInt(0, 3)]);
+    Matrix<float> mat_float(cmat);
+    Matrix<double> mat_double(cmat);
+    Matrix<float> mat_double_float(mat_double);
+    KALDI_ASSERT(mat_float.ApproxEqual(mat_double_float, 1.0e-06));
+    int32 row_offset = RandInt(0, num_rows - 1),
+        col_offset = RandInt(0, num_cols - 1);
+    Matrix<float> sub_float(num_rows - row_offset, num_cols - col_offset);
+    cmat.CopyToMat(row_offset, col_offset, &sub_float);
+    SubMatrix<float> sub(mat_float, row_offset, num_rows - row_offset,
+                         col_offset, num_cols - col_offset);
+    KALDI_ASSERT(sub_float.ApproxEqual(sub, 0.0));
+  }
+}
+
 template<typename Real> static void UnitTestCompressedMatrix() {
   // This is the basic test.
 
@@ -4514,6 +4629,210 @@ static void UnitTestAddMatMatNans() {
   }
 }
 
+static void UnitTestMatrixAllocator() {
+  MatrixAllocatorOptions old_opts = g_matrix_allocator_options;
+  g_matrix_allocator_options.alignment = 64;
+  g_matrix_allocator_options.pool_mb = 1;
+  g_matrix_allocator_options.huge_page_threshold_mb = 1;
+  g_matrix_allocator_options.print_stats = true;
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 20);
+    const float *data;
+    {
+      Matrix<float> mat(num_rows, num_cols);
+      Matrix<double> dmat(num_rows, num_cols);
+      Vector<float> vec(num_cols);
+      data = mat.Data();
+      for (MatrixIndexT r = 0; r < num_rows; r++) {
+        KALDI_ASSERT(reinterpret_cast<size_t>(mat.RowData(r)) % 64 == 0);
+        KALDI_ASSERT(reinterpret_cast<size_t>(dmat.RowData(r)) % 64 == 0);
+      }
+      KALDI_ASSERT(reinterpret_cast<size_t>(vec.Data()) % 64 == 0);
+      mat.SetRandn();
+    }
+    // the same size gets the block back from the pool.
+    Matrix<float> mat(num_rows, num_cols);
+    KALDI_ASSERT(mat.Data() == data);
+  }
+  {
+    Matrix<double> big(400, 400);  // above the huge-page threshold.
+    big.SetRandn();
+    Matrix<double> big2(big);
+    AssertEqual(big, big2);
+  }
+  PrintMatrixAllocatorStats();
+  ReleaseMatrixPool();
+  g_matrix_allocator_options = old_opts;
+  // memory from before is freed correctly with the old options.
+  Matrix<float> mat(10, 10);
+  g_matrix_allocator_options.alignment = 128;
+  mat.Resize(0, 0);
+  g_matrix_allocator_options = old_opts;
+}
+
+// Checks the functions of simd-math.h against the double-precision ones, to
+// the error bounds documented there.
+static void UnitTestSimdMath() {
+  KALDI_LOG << "The functions of simd-math.h use "
+            << SimdMathInstructionSet();
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT dim = RandInt(1, 1000);
+    Vector<float> x(dim), y(dim), positive(dim);
+    for (MatrixIndexT j = 0; j < dim; j++) {
+      x(j) = (i < 5 ? 10.0 : 100.0) * (RandUniform() - 0.5);
+      positive(j) = std::exp(x(j));
+    }
+    for (int32 f = 0; f < 5; f++) {
+      const Vector<float> &in = (f == 1 ? positive : x);
+      switch (f) {
+        case 0: SimdExp(in.Data(), y.Data(), dim); break;
+        case 1: SimdLog(in.Data(), y.Data(), dim); break;
+        case 2: SimdSigmoid(in.Data(), y.Data(), dim); break;
+        case 3: SimdTanh(in.Data(), y.Data(), dim); break;
+        default: SimdSoftHinge(in.Data(), y.Data(), dim);
+      }
+      for (MatrixIndexT j = 0; j < dim; j++) {
+        double d = in(j), ref;
+        switch (f) {
+          case 0: ref = std::exp(d); break;
+          case 1: ref = std::log(d); break;
+          case 2: ref = 1.0 / (1.0 + std::exp(-d)); break;
+          case 3: ref = std::tanh(d); break;
+          default: ref = (d > 10.0 ? d : std::log1p(std::exp(d)));
+        }
+        if (std::abs(ref) < std::numeric_limits<float>::min())
+          continue;  // denormal.
+        KALDI_ASSERT(std::abs(y(j) - ref) <=
+                     (f < 2 ? 2.0e-07 : 4.0e-07) * std::abs(ref));
+      }
+    }
+    // SimdApplyExpAndSum() and SimdSumExp(), through the vector functions.
+    float max = x.Max(), log_sum = 0.0;
+    for (MatrixIndexT j = 0; j < dim; j++)
+      log_sum += std::exp(static_cast<double>(x(j)) - max);
+    log_sum = max + std::log(log_sum);
+    AssertEqual(x.LogSumExp(), log_sum);
+    y.CopyFromVec(x);
+    AssertEqual(y.ApplySoftMax(), log_sum);
+    AssertEqual(y.Sum(), 1.0);
+  }
+  float special[] = { 0.0, -0.0, std::numeric_limits<float>::infinity(),
+                      -std::numeric_limits<float>::infinity() };
+  float out[4];
+  SimdExp(special, out, 4);
+  KALDI_ASSERT(out[0] == 1.0 && out[1] == 1.0 && KALDI_ISINF(out[2]) &&
+               out[3] == 0.0);
+  SimdLog(special, out, 4);
+  KALDI_ASSERT(KALDI_ISINF(out[0]) && out[0] < 0 && KALDI_ISINF(out[1]) &&
+               KALDI_ISINF(out[2]) && out[2] > 0 && KALDI_ISNAN(out[3]));
+  SimdTanh(special, out, 4);
+  KALDI_ASSERT(out[0] == 0.0 && out[2] == 1.0 && out[3] == -1.0);
+  SimdSigmoid(special, out, 4);
+  KALDI_ASSERT(out[0] == 0.5 && out[2] == 1.0 && out[3] == 0.0);
+}
+
+// The versions that CpuDispatch() chooses from must give the same results.
+template<typename Real>
+static void UnitTestCpuDispatch() {
+  CpuIsa best = GetCpuIsa();
+  KALDI_LOG << "CpuDispatch() uses " << CpuIsaName(best);
+  for (int32 i = 0; i < 5; i++) {
+    MatrixIndexT rows = RandInt(1, 20), cols = RandInt(1, 100),
+        fft_dim = 1 << RandInt(2, 11);
+    Matrix<Real> m(rows, cols), n(rows, cols);
+    m.SetRandn();
+    n.SetRandn();
+    n.Add(5.0);
+    CompressedMatrix cmat2(m, kTwoByteAuto), cmat1(m, kOneByteAuto);
+    Vector<Real> wave(fft_dim);
+    wave.SetRandn();
+    std::vector<Matrix<Real> > results;
+    for (int32 isa = kCpuIsaDefault; isa <= best; isa++) {
+      SetCpuIsa(static_cast<CpuIsa>(isa));
+      Matrix<Real> r(m);
+      r.MulElements(n);
+      r.DivElements(m);
+      r.Add(-2.0);
+      r.ApplyFloor(-1.0);
+      r.ApplyCeiling(3.0);
+      r.Row(0).ApplyAbs();
+      r.Row(0).AddVecDivVec(0.5, m.Row(0), n.Row(0), 2.0);
+      Matrix<Real> c2(rows, cols), c1(rows, cols);
+      cmat2.CopyToMat(&c2);
+      cmat1.CopyToMat(&c1);
+      Vector<Real> fft(wave);
+      SplitRadixRealFft<Real> srfft(fft_dim);
+      srfft.Compute(fft.Data(), true);
+      Matrix<Real> all(3 * rows + 1, std::max(cols, fft_dim));
+      all.Range(0, rows, 0, cols).CopyFromMat(r);
+      all.Range(rows, rows, 0, cols).CopyFromMat(c2);
+      all.Range(2 * rows, rows, 0, cols).CopyFromMat(c1);
+      all.Row(3 * rows).Range(0, fft_dim).CopyFromVec(fft);
+      if (!results.empty())
+        KALDI_ASSERT(results[0].Equal(all));
+      results.push_back(all);
+    }
+    SetCpuIsa(best);
+  }
+}
+
+// Tests Xgemm_small() and Xgemv_small() against BLAS.
+template <class Real>
+static void UnitTestSmallMatMat() {
+  for (int32 i = 0; i < 100; i++) {
+    int32 num_rows = RandInt(1, 8), mid = RandInt(1, 8),
+        num_cols = RandInt(1, 8);
+    MatrixTransposeType transA = (RandInt(0, 1) == 0 ? kNoTrans : kTrans),
+        transB = (RandInt(0, 1) == 0 ? kNoTrans : kTrans);
+    Matrix<Real> A(transA == kNoTrans ? num_rows : mid,
+                   transA == kNoTrans ? mid : num_rows),
+        B(transB == kNoTrans ? mid : num_cols,
+          transB == kNoTrans ? num_cols : mid),
+        C(num_rows, num_cols);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    Real alpha = RandGauss(), beta = (RandInt(0, 2) == 0 ? 0.0 : RandGauss());
+    if (beta == 0.0)  // which should be ignored, as in BLAS.
+      C(0, 0) = std::numeric_limits<Real>::quiet_NaN();
+    Matrix<Real> D(C);
+    cblas_Xgemm(alpha, transA, A.Data(), A.NumRows(), A.NumCols(), A.Stride(),
+                transB, B.Data(), B.Stride(), beta, C.Data(), num_rows,
+                num_cols, C.Stride());
+    Xgemm_small(alpha, transA, A.Data(), A.NumRows(), A.NumCols(), A.Stride(),
+                transB, B.Data(), B.Stride(), beta, D.Data(), num_rows,
+                num_cols, D.Stride());
+    AssertEqual(C, D);
+
+    Vector<Real> x(transA == kNoTrans ? A.NumCols() : A.NumRows()),
+        y(transA == kNoTrans ? A.NumRows() : A.NumCols());
+    x.SetRandn();
+    y.SetRandn();
+    if (beta == 0.0)
+      y(0) = std::numeric_limits<Real>::quiet_NaN();
+    Vector<Real> z(y);
+    cblas_Xgemv(transA, A.NumRows(), A.NumCols(), alpha, A.Data(), A.Stride(),
+                x.Data(), 1, beta, y.Data(), 1);
+    Xgemv_small(transA, A.NumRows(), A.NumCols(), alpha, A.Data(), A.Stride(),
+                x.Data(), beta, z.Data());
+    AssertEqual(y, z);
+  }
+}
+
+// The choice between Xgemm_small() and BLAS must not overflow for the large
+// shapes used in training.
+static void UnitTestIsSmallGemm() {
+  KALDI_ASSERT(IsSmallGemm(4, 8, 8) && IsSmallGemm(1, 1, 256) &&
+               IsSmallGemm(0, 5, 5));
+  KALDI_ASSERT(!IsSmallGemm(8, 8, 8) && !IsSmallGemm(1, 1, 257));
+  KALDI_ASSERT(!IsSmallGemm(1024, 2048, 2048));  // 2^32, which wraps to 0.
+  KALDI_ASSERT(!IsSmallGemm(512, 2048, 2048));  // 2^31, which wraps to INT_MIN.
+  KALDI_ASSERT(!IsSmallGemm(65536, 65536, 1) && !IsSmallGemm(1, 65536, 65536));
+  KALDI_ASSERT(IsSmallGemv(16, 16) && IsSmallGemv(1, 256) &&
+               !IsSmallGemv(16, 17) && !IsSmallGemv(1, 257));
+  KALDI_ASSERT(!IsSmallGemv(46341, 46341) && !IsSmallGemv(65536, 65536));
+}
+
 template<class Real>
 static void UnitTestTopEigs() {
   for (MatrixIndexT i = 0; i < 2; i++) {
@@ -4602,8 +4921,14 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   // UnitTestSvdBad<Real>(); // test bug in Jama SVD code.
   UnitTestCompressedMatrix<Real>();
   UnitTestCompressedMatrix2<Real>();
+  UnitTestCompressedMatrixFourBit<Real>();
+  UnitTestCompressedMatrixFloatDouble();
+  UnitTestMatrixAllocator();
+  UnitTestSimdMath();
+  UnitTestCpuDispatch<Real>();
   UnitTestExtractCompressedMatrix<Real>();
   UnitTestResize<Real>();
+  UnitTestMove<Real>();
   UnitTestResizeCopyDataDifferentStrideType<Real>();
   UnitTestNonsymmetricPower<Real>();
   UnitTestEigSymmetric<Real>();
@@ -4723,6 +5048,8 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestAddMatDiagVec<Real>();
   UnitTestAddMatMatElements<Real>();
   UnitTestAddMatMatNans<Real>();
+  UnitTestSmallMatMat<Real>();
+  UnitTestIsSmallGemm();
   UnitTestAddToDiagMatrix<Real>();
   UnitTestAddToDiag<Real>();
   UnitTestMaxAbsEig<Real>();
@@ -483,8 +483,11 @@ int32 LinearCgd(const LinearCgdOptions &opts,
   // after M iterations, in practice (due to roundoff) it does not always
   // converge to good precision after that many iterations so we let the maximum
   // be M + 5 instead.
+  // If x is already good enough (e.g. it was warm-started from the solution
+  // of a similar problem), we don't iterate at all.
   int32 k = 0;
-  for (; k < M + 5 && k != opts.max_iters; k++) {
+  for (; k < M + 5 && k != opts.max_iters && r_cur_norm_sq > max_error_sq;
+       k++) {
     // Note: we'll break from this loop if we converge sooner due to
     // max_error.
     Ap.AddSpVec(1.0, A, p, 0.0);  // Ap = A p
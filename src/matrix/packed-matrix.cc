@@ -26,6 +26,7 @@
 #include "matrix/cblas-wrappers.h"
 #include "matrix/packed-matrix.h"
 #include "matrix/kaldi-vector.h"
+#include "matrix/matrix-allocator.h"
 
 namespace kaldi {
 
@@ -66,15 +67,9 @@ inline void PackedMatrix<Real>::Init(MatrixIndexT r) {
                << "in MatrixIndexT: not all code is tested for this case.";
   }
 
-  void *data;  // aligned memory block
-  void *temp;
-
-  if ((data = KALDI_MEMALIGN(16, size * sizeof(Real), &temp)) != NULL) {
-    this->data_ = static_cast<Real *> (data);
-    this->num_rows_ = r;
-  } else {
-    throw std::bad_alloc();
-  }
+  // this throws on failure.
+  this->data_ = static_cast<Real*>(MatrixAllocate(size * sizeof(Real)));
+  this->num_rows_ = r;
 }
 
 template<typename Real>
@@ -226,7 +221,7 @@ Real PackedMatrix<Real>::Trace() const {
 template<typename Real>
 void PackedMatrix<Real>::Destroy() {
   // we need to free the data block if it was defined
-  if (data_ != NULL) KALDI_MEMALIGN_FREE(data_);
+  if (data_ != NULL) MatrixFree(data_);
   data_ = NULL;
   num_rows_ = 0;
 }
@@ -0,0 +1,128 @@
+// matrix/quantized-matrix-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include <sstream>
+
+#include "matrix/quantized-matrix.h"
+
+namespace kaldi {
+
+void UnitTestHalfConversion() {
+  float exact[] = { 0.0, 1.0, -2.0, 0.5, 65504.0, -65504.0,
+                    6.103515625e-05,  // smallest normal
+                    5.9604644775390625e-08 };  // smallest subnormal
+  for (size_t i = 0; i < sizeof(exact) / sizeof(exact[0]); i++)
+    KALDI_ASSERT(HalfToFloat(FloatToHalf(exact[i])) == exact[i]);
+  float inf = std::numeric_limits<float>::infinity();
+  KALDI_ASSERT(HalfToFloat(FloatToHalf(inf)) == inf);
+  KALDI_ASSERT(HalfToFloat(FloatToHalf(-1.0e6)) == -inf);
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  KALDI_ASSERT(KALDI_ISNAN(HalfToFloat(FloatToHalf(nan))));
+  // halfway between 1 and the next half, rounds to even
+  KALDI_ASSERT(HalfToFloat(FloatToHalf(1.0 + 1.0 / 2048)) == 1.0);
+  KALDI_ASSERT(HalfToFloat(FloatToHalf(1.0 + 3.0 / 2048)) ==
+               static_cast<float>(1.0 + 4.0 / 2048));
+  for (int32 i = 0; i < 1000; i++) {
+    float f = RandGauss() * 100;
+    KALDI_ASSERT(std::abs(HalfToFloat(FloatToHalf(f)) - f) <=
+                 std::abs(f) / 2048);
+  }
+  // every half that is a number survives, and the expansion of a matrix
+  // gives the same as HalfToFloat
+  Matrix<BaseFloat> halves(1, 65536 - 2 * 1023);
+  int32 n = 0;
+  for (int32 h = 0; h < 65536; h++) {
+    float f = HalfToFloat(h);
+    if (KALDI_ISNAN(f)) continue;
+    KALDI_ASSERT(FloatToHalf(f) == h);
+    halves(0, n++) = f;
+  }
+  KALDI_ASSERT(n == halves.NumCols());
+  QuantizedMatrix qhalves(halves, kFloat16);
+  Matrix<BaseFloat> expanded(halves.NumRows(), halves.NumCols());
+  qhalves.CopyToMat(&expanded);
+  for (int32 c = 0; c < n; c++)
+    KALDI_ASSERT(expanded(0, c) == halves(0, c));
+}
+
+void UnitTestQuantizedMatrixCopy(QuantizationMethod method) {
+  int32 num_rows = 1 + Rand() % 40, num_cols = 1 + Rand() % 60;
+  Matrix<BaseFloat> mat(num_rows, num_cols);
+  mat.SetRandn();
+  mat.Row(0).Scale(1000.0);
+  if (num_rows > 1) mat.Row(1).SetZero();
+  QuantizedMatrix qmat(mat, method);
+  KALDI_ASSERT(qmat.NumRows() == num_rows && qmat.NumCols() == num_cols);
+  Matrix<BaseFloat> expanded(num_rows, num_cols);
+  qmat.CopyToMat(&expanded);
+  for (int32 r = 0; r < num_rows; r++) {
+    // the error is relative to the row, the large first row does not matter
+    BaseFloat max_abs = std::max(mat.Row(r).Max(), -mat.Row(r).Min()),
+        max_error = max_abs / (method == kFloat16 ? 2048 : 254);
+    for (int32 c = 0; c < num_cols; c++)
+      KALDI_ASSERT(std::abs(expanded(r, c) - mat(r, c)) <=
+                   max_error * 1.001 + 1.0e-07);
+  }
+  for (int32 binary = 0; binary < 2; binary++) {
+    std::ostringstream os;
+    qmat.Write(os, binary == 1);
+    QuantizedMatrix qmat2;
+    std::istringstream is(os.str());
+    qmat2.Read(is, binary == 1);
+    KALDI_ASSERT(qmat2.Method() == method);
+    Matrix<BaseFloat> expanded2(num_rows, num_cols);
+    qmat2.CopyToMat(&expanded2);
+    AssertEqual(expanded, expanded2, 1.0e-05);
+  }
+}
+
+void UnitTestQuantizedMatrixProduct(QuantizationMethod method) {
+  // more rows than are expanded at a time
+  int32 num_rows = 1 + Rand() % 2000, num_cols = 1 + Rand() % 300,
+      num_frames = 1 + Rand() % 50;
+  Matrix<BaseFloat> weights(num_rows, num_cols), in(num_frames, num_cols);
+  weights.SetRandn();
+  in.SetRandn();
+  QuantizedMatrix qweights(weights, method);
+  Matrix<BaseFloat> expanded(num_rows, num_cols);
+  qweights.CopyToMat(&expanded);
+  Matrix<BaseFloat> out(num_frames, num_rows), ref(num_frames, num_rows);
+  out.SetRandn();
+  ref.CopyFromMat(out);
+  ref.AddMatMat(0.5, in, kNoTrans, expanded, kTrans, 2.0);
+  qweights.AddMatMatTrans<BaseFloat>(0.5, in, 2.0, &out);
+  AssertEqual(ref, out, 1.0e-05);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestHalfConversion();
+  for (int32 i = 0; i < 10; i++) {
+    UnitTestQuantizedMatrixCopy(kInt8RowScale);
+    UnitTestQuantizedMatrixCopy(kFloat16);
+    UnitTestQuantizedMatrixProduct(kInt8RowScale);
+    UnitTestQuantizedMatrixProduct(kFloat16);
+  }
+  KALDI_ASSERT(QuantizationMethodFromString("fp16") == kFloat16);
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
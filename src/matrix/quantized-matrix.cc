@@ -0,0 +1,362 @@
+// matrix/quantized-matrix.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "matrix/quantized-matrix.h"
+
+namespace kaldi {
+
+// Keeps the expanded block of rows of AddMatMatTrans to about this size
+static const size_t kQuantizedBlockBytes = 256 * 1024;
+
+QuantizationMethod QuantizationMethodFromString(const std::string &method) {
+  if (method == "int8") return kInt8RowScale;
+  if (method == "fp16") return kFloat16;
+  KALDI_ERR << "Unknown quantization method '" << method
+            << "', expected int8 or fp16";
+  return kInt8RowScale;
+}
+
+std::string QuantizationMethodToString(QuantizationMethod method) {
+  return method == kFloat16 ? "fp16" : "int8";
+}
+
+uint16 FloatToHalf(float f) {
+  uint32 b;
+  std::memcpy(&b, &f, sizeof(b));
+  uint32 sign = (b >> 16) & 0x8000, exponent = (b >> 23) & 0xff,
+      mantissa = b & 0x7fffff;
+  if (exponent == 0xff)  // inf or nan
+    return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+  int32 e = static_cast<int32>(exponent) - 127 + 15;
+  if (e >= 31) return sign | 0x7c00;  // overflows to inf
+  uint32 h, rem, halfway;
+  if (e <= 0) {  // subnormal, or too small
+    if (e < -10) return sign;
+    mantissa |= 0x800000;
+    int32 shift = 14 - e;
+    h = mantissa >> shift;
+    rem = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  } else {
+    h = (e << 10) | (mantissa >> 13);
+    rem = mantissa & 0x1fff;
+    halfway = 0x1000;
+  }
+  // to nearest even, a carry into the exponent is still right
+  if (rem > halfway || (rem == halfway && (h & 1))) h++;
+  return sign | h;
+}
+
+float HalfToFloat(uint16 h) {
+  uint32 sign = static_cast<uint32>(h & 0x8000) << 16,
+      exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff, b;
+  if (exponent == 0) {
+    float f = mantissa * (1.0f / 16777216.0f);  // mantissa * 2^-24
+    return sign ? -f : f;
+  } else if (exponent == 31) {
+    b = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    b = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  float f;
+  std::memcpy(&f, &b, sizeof(f));
+  return f;
+}
+
+// The expansion of the weights is most of the extra cost of AddMatMatTrans,
+// so for float it is done four or eight elements at a time where SSE2 is
+// available (it is part of x86-64), and one at a time otherwise.
+template<typename Real>
+static void ExpandInt8Row(const int8 *src, float scale, MatrixIndexT dim,
+                          Real *dst) {
+  for (MatrixIndexT c = 0; c < dim; c++)
+    dst[c] = scale * src[c];
+}
+
+template<typename Real>
+static void ExpandHalfRow(const uint16 *src, MatrixIndexT dim, Real *dst) {
+  for (MatrixIndexT c = 0; c < dim; c++)
+    dst[c] = HalfToFloat(src[c]);
+}
+
+#if defined(__SSE2__)
+template<>
+void ExpandInt8Row(const int8 *src, float scale, MatrixIndexT dim,
+                   float *dst) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale4 = _mm_set1_ps(scale);
+  MatrixIndexT c = 0;
+  for (; c + 16 <= dim; c += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c)),
+        sign = _mm_cmpgt_epi8(zero, v),
+        lo = _mm_unpacklo_epi8(v, sign), hi = _mm_unpackhi_epi8(v, sign);
+    // sign extend the int16 to int32 by shifting them down from the top
+    __m128i v32[4] = { _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16),
+                       _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16),
+                       _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16),
+                       _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16) };
+    for (int32 i = 0; i < 4; i++)
+      _mm_storeu_ps(dst + c + 4 * i,
+                    _mm_mul_ps(_mm_cvtepi32_ps(v32[i]), scale4));
+  }
+  for (; c < dim; c++)
+    dst[c] = scale * src[c];
+}
+
+template<>
+void ExpandHalfRow(const uint16 *src, MatrixIndexT dim, float *dst) {
+  // Moves the exponent and mantissa into place and rescales the exponent
+  // with a multiply, which also normalises subnormals; inf and nan get
+  // their exponent set afterwards.
+  const __m128i zero = _mm_setzero_si128(),
+      mask_nosign = _mm_set1_epi32(0x7fff),
+      was_infnan = _mm_set1_epi32(0x7bff);
+  const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)),
+      exp_infnan = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+  MatrixIndexT c = 0;
+  for (; c + 8 <= dim; c += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c));
+    __m128i h[2] = { _mm_unpacklo_epi16(v, zero), _mm_unpackhi_epi16(v, zero) };
+    for (int32 i = 0; i < 2; i++) {
+      __m128i expmant = _mm_and_si128(h[i], mask_nosign),
+          sign = _mm_slli_epi32(_mm_xor_si128(h[i], expmant), 16);
+      __m128 scaled = _mm_mul_ps(
+          _mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), magic);
+      __m128 infnan = _mm_and_ps(
+          _mm_castsi128_ps(_mm_cmpgt_epi32(expmant, was_infnan)), exp_infnan);
+      _mm_storeu_ps(dst + c + 4 * i, _mm_or_ps(
+          scaled, _mm_or_ps(_mm_castsi128_ps(sign), infnan)));
+    }
+  }
+  for (; c < dim; c++)
+    dst[c] = HalfToFloat(src[c]);
+}
+#endif
+
+template<typename Real>
+void QuantizedMatrix::CopyFromMat(const MatrixBase<Real> &mat,
+                                  QuantizationMethod method) {
+  Clear();
+  method_ = method;
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  size_t num_elements = static_cast<size_t>(num_rows_) * num_cols_;
+  if (method == kFloat16) {
+    half_data_.resize(num_elements);
+    for (MatrixIndexT r = 0; r < num_rows_; r++) {
+      const Real *row = mat.RowData(r);
+      uint16 *dst = &half_data_[static_cast<size_t>(r) * num_cols_];
+      for (MatrixIndexT c = 0; c < num_cols_; c++)
+        dst[c] = FloatToHalf(static_cast<float>(row[c]));
+    }
+    return;
+  }
+  KALDI_ASSERT(method == kInt8RowScale);
+  int8_data_.resize(num_elements);
+  row_scales_.resize(num_rows_);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    const Real *row = mat.RowData(r);
+    int8 *dst = &int8_data_[static_cast<size_t>(r) * num_cols_];
+    Real max_abs = 0.0;
+    for (MatrixIndexT c = 0; c < num_cols_; c++)
+      max_abs = std::max(max_abs, std::abs(row[c]));
+    float scale = max_abs / 127.0, inv_scale = scale > 0.0 ? 1.0 / scale : 0.0;
+    row_scales_[r] = scale;
+    for (MatrixIndexT c = 0; c < num_cols_; c++) {
+      long q = lrint(row[c] * inv_scale);
+      dst[c] = static_cast<int8>(std::max(-127L, std::min(127L, q)));
+    }
+  }
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  CopyRowsToMat(0, mat);
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyRowsToMat(MatrixIndexT row_offset,
+                                    MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(row_offset >= 0 && row_offset + mat->NumRows() <= num_rows_ &&
+               mat->NumCols() == num_cols_);
+  for (MatrixIndexT r = 0; r < mat->NumRows(); r++) {
+    size_t offset = static_cast<size_t>(row_offset + r) * num_cols_;
+    if (method_ == kFloat16)
+      ExpandHalfRow(&half_data_[offset], num_cols_, mat->RowData(r));
+    else
+      ExpandInt8Row(&int8_data_[offset], row_scales_[row_offset + r],
+                    num_cols_, mat->RowData(r));
+  }
+}
+
+template<typename Real>
+void QuantizedMatrix::AddMatMatTrans(Real alpha, const MatrixBase<Real> &in,
+                                     Real beta,
+                                     MatrixBase<Real> *out) const {
+  KALDI_ASSERT(in.NumCols() == num_cols_ && out->NumRows() == in.NumRows() &&
+               out->NumCols() == num_rows_);
+  if (in.NumRows() == 0 || num_rows_ == 0) return;
+  if (num_cols_ == 0) {
+    out->Scale(beta);
+    return;
+  }
+  MatrixIndexT block_rows = std::max<MatrixIndexT>(
+      8, kQuantizedBlockBytes / (sizeof(Real) * num_cols_));
+  block_rows = std::min(block_rows, num_rows_);
+  Matrix<Real> block(block_rows, num_cols_, kUndefined);
+  for (MatrixIndexT r = 0; r < num_rows_; r += block_rows) {
+    MatrixIndexT n = std::min(block_rows, num_rows_ - r);
+    SubMatrix<Real> weights(block, 0, n, 0, num_cols_);
+    CopyRowsToMat(r, &weights);
+    SubMatrix<Real> out_cols(*out, 0, out->NumRows(), r, n);
+    out_cols.AddMatMat(alpha, in, kNoTrans, weights, kTrans, beta);
+  }
+}
+
+void QuantizedMatrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, method_ == kFloat16 ? "<Float16>" : "<Int8RowScale>");
+  WriteBasicType(os, binary, num_rows_);
+  WriteBasicType(os, binary, num_cols_);
+  if (binary) {
+    if (method_ == kFloat16) {
+      os.write(reinterpret_cast<const char*>(half_data_.data()),
+               half_data_.size() * sizeof(uint16));
+    } else {
+      os.write(reinterpret_cast<const char*>(row_scales_.data()),
+               row_scales_.size() * sizeof(float));
+      os.write(reinterpret_cast<const char*>(int8_data_.data()),
+               int8_data_.size());
+    }
+  } else {
+    for (MatrixIndexT r = 0; r < num_rows_; r++) {
+      os << "\n";
+      size_t offset = static_cast<size_t>(r) * num_cols_;
+      if (method_ == kFloat16) {
+        for (MatrixIndexT c = 0; c < num_cols_; c++)
+          WriteBasicType(os, false, half_data_[offset + c]);
+      } else {
+        WriteBasicType(os, false, row_scales_[r]);
+        for (MatrixIndexT c = 0; c < num_cols_; c++)
+          WriteBasicType(os, false, int8_data_[offset + c]);
+      }
+    }
+    os << "\n";
+  }
+  if (os.fail())
+    KALDI_ERR << "Error writing quantized matrix to stream.";
+}
+
+void QuantizedMatrix::Read(std::istream &is, bool binary) {
+  Clear();
+  std::string token;
+  ReadToken(is, binary, &token);
+  if (token == "<Float16>") {
+    method_ = kFloat16;
+  } else if (token == "<Int8RowScale>") {
+    method_ = kInt8RowScale;
+  } else {
+    KALDI_ERR << "Expected <Int8RowScale> or <Float16>, got " << token;
+  }
+  ReadBasicType(is, binary, &num_rows_);
+  ReadBasicType(is, binary, &num_cols_);
+  KALDI_ASSERT(num_rows_ >= 0 && num_cols_ >= 0);
+  size_t num_elements = static_cast<size_t>(num_rows_) * num_cols_;
+  if (method_ == kFloat16) {
+    half_data_.resize(num_elements);
+  } else {
+    int8_data_.resize(num_elements);
+    row_scales_.resize(num_rows_);
+  }
+  if (binary) {
+    if (method_ == kFloat16) {
+      is.read(reinterpret_cast<char*>(half_data_.data()),
+              half_data_.size() * sizeof(uint16));
+    } else {
+      is.read(reinterpret_cast<char*>(row_scales_.data()),
+              row_scales_.size() * sizeof(float));
+      is.read(reinterpret_cast<char*>(int8_data_.data()), int8_data_.size());
+    }
+  } else {
+    for (MatrixIndexT r = 0; r < num_rows_; r++) {
+      size_t offset = static_cast<size_t>(r) * num_cols_;
+      if (method_ == kFloat16) {
+        for (MatrixIndexT c = 0; c < num_cols_; c++)
+          ReadBasicType(is, false, &half_data_[offset + c]);
+      } else {
+        ReadBasicType(is, false, &row_scales_[r]);
+        for (MatrixIndexT c = 0; c < num_cols_; c++)
+          ReadBasicType(is, false, &int8_data_[offset + c]);
+      }
+    }
+  }
+  if (is.fail())
+    KALDI_ERR << "Failed to read quantized matrix from stream";
+}
+
+void QuantizedMatrix::Swap(QuantizedMatrix *other) {
+  std::swap(method_, other->method_);
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  int8_data_.swap(other->int8_data_);
+  row_scales_.swap(other->row_scales_);
+  half_data_.swap(other->half_data_);
+}
+
+void QuantizedMatrix::Clear() {
+  num_rows_ = num_cols_ = 0;
+  std::vector<int8>().swap(int8_data_);
+  std::vector<float>().swap(row_scales_);
+  std::vector<uint16>().swap(half_data_);
+}
+
+template
+void QuantizedMatrix::CopyFromMat(const MatrixBase<float> &mat,
+                                  QuantizationMethod method);
+template
+void QuantizedMatrix::CopyFromMat(const MatrixBase<double> &mat,
+                                  QuantizationMethod method);
+template
+void QuantizedMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template
+void QuantizedMatrix::CopyToMat(MatrixBase<double> *mat) const;
+template
+void QuantizedMatrix::CopyRowsToMat(MatrixIndexT row_offset,
+                                    MatrixBase<float> *mat) const;
+template
+void QuantizedMatrix::CopyRowsToMat(MatrixIndexT row_offset,
+                                    MatrixBase<double> *mat) const;
+template
+void QuantizedMatrix::AddMatMatTrans(float alpha, const MatrixBase<float> &in,
+                                     float beta,
+                                     MatrixBase<float> *out) const;
+template
+void QuantizedMatrix::AddMatMatTrans(double alpha,
+                                     const MatrixBase<double> &in,
+                                     double beta,
+                                     MatrixBase<double> *out) const;
+
+}  // namespace kaldi
@@ -0,0 +1,121 @@
+// matrix/quantized-matrix.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_QUANTIZED_MATRIX_H_
+#define KALDI_MATRIX_QUANTIZED_MATRIX_H_ 1
+
+#include <string>
+#include <vector>
+
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/*
+  The enum QuantizationMethod says how the elements of a QuantizedMatrix are
+  stored.
+
+    kInt8RowScale = 1   Each element is stored in one byte as an int8, with a
+                        float scale per row chosen so that the largest absolute
+                        value of the row is 127.  A quarter of the memory.
+    kFloat16 = 2        Each element is stored in two bytes as an IEEE half
+                        precision float.  Half the memory.
+*/
+enum QuantizationMethod {
+  kInt8RowScale = 1,
+  kFloat16 = 2
+};
+
+/// Parses "int8" or "fp16"
+QuantizationMethod QuantizationMethodFromString(const std::string &method);
+std::string QuantizationMethodToString(QuantizationMethod method);
+
+/*
+  This class stores the weights of a layer in less memory, for inference.
+  Unlike CompressedMatrix, which is for features, rows are quantized on their
+  own (the rows of a weight matrix go to separate outputs), and the matrix can
+  be multiplied by without expanding all of it: AddMatMatTrans expands a block
+  of rows at a time into a buffer that stays in cache and multiplies by that,
+  so it runs at about the speed of the BLAS while holding a quarter or half of
+  the memory.
+*/
+class QuantizedMatrix {
+ public:
+  QuantizedMatrix(): method_(kInt8RowScale), num_rows_(0), num_cols_(0) { }
+
+  template<typename Real>
+  explicit QuantizedMatrix(const MatrixBase<Real> &mat,
+                           QuantizationMethod method = kInt8RowScale):
+      method_(method), num_rows_(0), num_cols_(0) {
+    CopyFromMat(mat, method);
+  }
+
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat,
+                   QuantizationMethod method = kInt8RowScale);
+
+  /// mat must be of the same size
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  /// Copies rows [row_offset, row_offset + mat->NumRows()) to mat
+  template<typename Real>
+  void CopyRowsToMat(MatrixIndexT row_offset, MatrixBase<Real> *mat) const;
+
+  /// out = alpha * in * this^T + beta * out, as out->AddMatMat(alpha, in,
+  /// kNoTrans, this, kTrans, beta); the usual product for a weight matrix.
+  template<typename Real>
+  void AddMatMatTrans(Real alpha, const MatrixBase<Real> &in, Real beta,
+                      MatrixBase<Real> *out) const;
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+  QuantizationMethod Method() const { return method_; }
+  /// The memory held by the elements and scales
+  size_t SizeInBytes() const {
+    return int8_data_.size() + row_scales_.size() * sizeof(float) +
+        half_data_.size() * sizeof(uint16);
+  }
+
+  void Swap(QuantizedMatrix *other);
+  void Clear();
+
+ private:
+  QuantizationMethod method_;
+  MatrixIndexT num_rows_, num_cols_;
+  std::vector<int8> int8_data_;  // kInt8RowScale, row major
+  std::vector<float> row_scales_;  // kInt8RowScale
+  std::vector<uint16> half_data_;  // kFloat16, row major
+};
+
+/// IEEE half precision conversions, rounding to the nearest
+uint16 FloatToHalf(float f);
+float HalfToFloat(uint16 h);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_QUANTIZED_MATRIX_H_
@@ -0,0 +1,407 @@
+// matrix/simd-math.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <limits>
+
+#include "base/cpu-dispatch.h"
+#include "base/kaldi-math.h"
+#include "matrix/simd-math.h"
+
+// The functions are written with the vector extensions of GCC and clang,
+// which the compiler turns into the instructions of the target, e.g. SSE2 by
+// default on x86-64 and NEON on ARM.  On x86-64 they are also compiled for
+// AVX2 and AVX-512, and CpuDispatch() chooses the version for the CPU.
+#if defined(__GNUC__)
+#define KALDI_SIMD_VECTORS 1
+// The parameters of the inline functions below are references, and they
+// are always inlined, so the warnings about the ABI of passing vectors when
+// AVX is not enabled don't apply.
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace kaldi {
+
+#ifdef KALDI_SIMD_VECTORS
+
+namespace {
+
+// The vectors of floats of SSE2 and NEON, AVX2 and AVX-512.  Each version uses
+// the vectors of its instruction set, as GCC does comparisons one element at
+// a time for vectors wider than those of the target.  The functions below
+// are templates on the type of vector, "F"; comparisons of them give vectors
+// of int32 with -1 where true and 0 where false, of type I<F>.
+typedef float Vf4 __attribute__((vector_size(16)));
+typedef float Vf8 __attribute__((vector_size(32)));
+typedef float Vf16 __attribute__((vector_size(64)));
+
+template<class F> struct Mask { typedef decltype(F() < F()) Type; };
+
+#define KALDI_SIMD_INLINE inline __attribute__((always_inline))
+
+// The floats whose int32 bit patterns are offset from that of this one by n
+// are equal to it plus n, for |n| < 2^22; this turns floats into ints and
+// back without conversion instructions.
+const float kMagic = 12582912.0f;  // 1.5 * 2^23
+const int32 kMagicBits = 0x4B400000;
+
+template<class F> KALDI_SIMD_INLINE F Broadcast(float f) {
+  F zero = { };
+  return zero + f;
+}
+
+template<class F> KALDI_SIMD_INLINE F Load(const float *data) {
+  F v;
+  memcpy(&v, data, sizeof(v));
+  return v;
+}
+
+template<class F> KALDI_SIMD_INLINE void Store(const F &v, float *data) {
+  memcpy(data, &v, sizeof(v));
+}
+
+// Loads "dim" (< the width of F) elements, with "pad" in the rest.
+template<class F>
+KALDI_SIMD_INLINE F LoadPartial(const float *data, int32 dim, float pad) {
+  float buffer[sizeof(F) / sizeof(float)];
+  for (int32 k = 0; k < static_cast<int32>(sizeof(F) / sizeof(float)); k++)
+    buffer[k] = (k < dim ? data[k] : pad);
+  return Load<F>(buffer);
+}
+
+template<class F>
+KALDI_SIMD_INLINE void StorePartial(const F &v, int32 dim, float *data) {
+  float buffer[sizeof(F) / sizeof(float)];
+  Store(v, buffer);
+  memcpy(data, buffer, dim * sizeof(float));
+}
+
+// Returns a where "mask" is true, else b.
+template<class F>
+KALDI_SIMD_INLINE F Select(const typename Mask<F>::Type &mask, const F &a,
+                           const F &b) {
+  typedef typename Mask<F>::Type I;
+  return (F)(((I)a & mask) | ((I)b & ~mask));
+}
+
+template<class F> KALDI_SIMD_INLINE F Abs(const F &x) {
+  typedef typename Mask<F>::Type I;
+  return (F)((I)x & 0x7fffffff);
+}
+
+template<class F> KALDI_SIMD_INLINE double HorizontalSum(const F &v) {
+  double sum = 0.0;
+  for (int32 k = 0; k < static_cast<int32>(sizeof(F) / sizeof(float)); k++)
+    sum += v[k];
+  return sum;
+}
+
+// exp(x), from Cephes' expf: x = n log(2) + r with |r| <= log(2) / 2, and
+// exp(r) is a polynomial.  2^n is applied as two factors so that results
+// near the overflow and underflow thresholds are right (and denormals are
+// rounded as usual).
+template<class F> KALDI_SIMD_INLINE F Exp(const F &x_in) {
+  typedef typename Mask<F>::Type I;
+  F x = Select(x_in < -110.0f, Broadcast<F>(-110.0f), x_in);
+  x = Select(x > 89.0f, Broadcast<F>(89.0f), x);
+  F t = x * 1.44269504088896341f + kMagic;
+  I n = (I)t - kMagicBits;
+  F fn = t - kMagic;
+  F r = x - fn * 0.693359375f;
+  r = r + fn * 2.12194440e-4f;
+  F y = r * 1.9875691500e-4f + 1.3981999507e-3f;
+  y = y * r + 8.3334519073e-3f;
+  y = y * r + 4.1665795894e-2f;
+  y = y * r + 1.6666665459e-1f;
+  y = y * r + 5.0000001201e-1f;
+  y = y * r * r + r + 1.0f;
+  I n1 = n >> 1, n2 = n - n1;
+  return y * (F)((n1 + 127) << 23) * (F)((n2 + 127) << 23);
+}
+
+// log(x), from Cephes' logf: x = 2^e m with sqrt(1/2) <= m < sqrt(2), and
+// log(m) is a polynomial in m - 1.
+template<class F> KALDI_SIMD_INLINE F Log(const F &x_in) {
+  typedef typename Mask<F>::Type I;
+  // denormals are scaled by 2^23 to get a normalized mantissa.
+  I denormal = x_in < std::numeric_limits<float>::min();
+  F x = Select(denormal, x_in * 8388608.0f, x_in);
+  I bits = (I)x;
+  I e = ((bits >> 23) & 0xff) - 126 - (denormal & 23);
+  F m = (F)((bits & 0x007fffff) | 0x3f000000);  // in [0.5, 1).
+  I small = m < 0.707106781186547524f;
+  e = e + small;  // i.e. e - 1 where small.
+  m = m - 1.0f + Select(small, m, Broadcast<F>(0.0f));
+  F fe = (F)(e + kMagicBits) - kMagic;
+  F z = m * m;
+  F y = m * 7.0376836292e-2f - 1.1514610310e-1f;
+  y = y * m + 1.1676998740e-1f;
+  y = y * m - 1.2420140846e-1f;
+  y = y * m + 1.4249322787e-1f;
+  y = y * m - 1.6668057665e-1f;
+  y = y * m + 2.0000714765e-1f;
+  y = y * m - 2.4999993993e-1f;
+  y = y * m + 3.3333331174e-1f;
+  y = y * m * z;
+  y = y - fe * 2.12194440e-4f;
+  y = y - z * 0.5f;
+  F ans = m + y + fe * 0.693359375f;
+  const float inf = std::numeric_limits<float>::infinity();
+  ans = Select(x_in == 0.0f, Broadcast<F>(-inf), ans);
+  ans = Select(x_in == inf, Broadcast<F>(inf), ans);
+  // negative numbers and NaNs.
+  return Select(~(x_in >= 0.0f), Broadcast<F>(
+      std::numeric_limits<float>::quiet_NaN()), ans);
+}
+
+template<class F> KALDI_SIMD_INLINE F Sigmoid(const F &x) {
+  // as in VectorBase::Sigmoid(), we only exponentiate negative numbers.
+  F e = Exp(-Abs(x)), s = 1.0f / (1.0f + e);
+  return Select(x > 0.0f, s, e * s);
+}
+
+template<class F> KALDI_SIMD_INLINE F Tanh(const F &x) {
+  typedef typename Mask<F>::Type I;
+  // For |x| < 0.625 the polynomial of Cephes' tanhf, else
+  // (1 - exp(-2|x|)) / (1 + exp(-2|x|)), which doesn't lose precision there.
+  F a = Abs(x), z = a * a;
+  F p = z * -5.70498872745e-3f + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  p = p * z * a + a;
+  F e = Exp(a * -2.0f);
+  F t = Select(a < 0.625f, p, (1.0f - e) / (1.0f + e));
+  return (F)((I)t | ((I)x & ~0x7fffffff));
+}
+
+template<class F> KALDI_SIMD_INLINE F SoftHinge(const F &x) {
+  typedef typename Mask<F>::Type I;
+  // log(1 + exp(x)) = max(x, 0) + log1p(exp(-|x|)), and log1p(t) is
+  // log(u) t / (u - 1) with u = 1 + t (which corrects for the rounding of
+  // u), or t if u == 1.
+  F t = Exp(-Abs(x)), u = 1.0f + t, d = u - 1.0f;
+  I exact = (d == 0.0f);
+  F log1p = Select(exact, t,
+                   Log(u) * (t / Select(exact, Broadcast<F>(1.0f), d)));
+  F y = Select(x > 0.0f, x, Broadcast<F>(0.0f)) + log1p;
+  return Select(x > 10.0f, x, y);
+}
+
+// The accumulation of sums in float is for at most this many vectors at a
+// time, after which they are added to a double.
+const int32 kSumBlock = 32;
+
+#define KALDI_SIMD_MAP(name, function, pad)                                 \
+  template<class F>                                                         \
+  KALDI_SIMD_INLINE void name(const float *in, float *out,                  \
+                              MatrixIndexT dim) {                           \
+    const int32 width = sizeof(F) / sizeof(float);                          \
+    MatrixIndexT i = 0;                                                     \
+    for (; i + width <= dim; i += width)                                    \
+      Store(function(Load<F>(in + i)), out + i);                            \
+    if (i < dim)                                                            \
+      StorePartial(function(LoadPartial<F>(in + i, dim - i, pad)), dim - i, \
+                   out + i);                                                \
+  }
+
+KALDI_SIMD_MAP(ExpImpl, Exp, 0.0f)
+KALDI_SIMD_MAP(LogImpl, Log, 1.0f)
+KALDI_SIMD_MAP(SigmoidImpl, Sigmoid, 0.0f)
+KALDI_SIMD_MAP(TanhImpl, Tanh, 0.0f)
+KALDI_SIMD_MAP(SoftHingeImpl, SoftHinge, 0.0f)
+
+#undef KALDI_SIMD_MAP
+
+template<class F>
+KALDI_SIMD_INLINE double ApplyExpAndSumImpl(float offset, float *data,
+                                            MatrixIndexT dim) {
+  const int32 width = sizeof(F) / sizeof(float);
+  double sum = 0.0;
+  MatrixIndexT i = 0;
+  while (i + width <= dim) {
+    F block_sum = Broadcast<F>(0.0f);
+    for (int32 b = 0; b < kSumBlock && i + width <= dim; b++, i += width) {
+      F e = Exp(Load<F>(data + i) - offset);
+      Store(e, data + i);
+      block_sum += e;
+    }
+    sum += HorizontalSum(block_sum);
+  }
+  if (i < dim) {
+    const float inf = std::numeric_limits<float>::infinity();
+    // the padding, exp(-inf), is zero.
+    F e = Exp(LoadPartial<F>(data + i, dim - i, -inf) - offset);
+    StorePartial(e, dim - i, data + i);
+    sum += HorizontalSum(e);
+  }
+  return sum;
+}
+
+template<class F>
+KALDI_SIMD_INLINE double SumExpImpl(const float *data, float offset,
+                                    float cutoff, MatrixIndexT dim) {
+  const int32 width = sizeof(F) / sizeof(float);
+  const float inf = std::numeric_limits<float>::infinity();
+  double sum = 0.0;
+  MatrixIndexT i = 0;
+  while (i < dim) {
+    F block_sum = Broadcast<F>(0.0f);
+    for (int32 b = 0; b < kSumBlock && i < dim; b++, i += width) {
+      F x = (i + width <= dim ? Load<F>(data + i) :
+             LoadPartial<F>(data + i, dim - i, -inf));
+      block_sum += Select(x >= cutoff, Exp(x - offset), Broadcast<F>(0.0f));
+    }
+    sum += HorizontalSum(block_sum);
+  }
+  return sum;
+}
+
+// The vectors of each instruction set.
+template<CpuIsa isa> struct NativeVector { typedef Vf4 Type; };
+template<> struct NativeVector<kCpuIsaAvx2> { typedef Vf8 Type; };
+template<> struct NativeVector<kCpuIsaAvx512> { typedef Vf16 Type; };
+
+// Defines name##Kernel, for CpuDispatch(), which calls name##Impl for the
+// vectors of the instruction set.
+#define KALDI_SIMD_KERNEL(name)                                             \
+  template<CpuIsa isa> struct name##Kernel {                                \
+    template<typename... Args>                                              \
+    static KALDI_SIMD_INLINE auto Run(Args... args) -> decltype(            \
+        name##Impl<Vf4>(args...)) {                                         \
+      return name##Impl<typename NativeVector<isa>::Type>(args...);         \
+    }                                                                       \
+  };
+
+KALDI_SIMD_KERNEL(Exp)
+KALDI_SIMD_KERNEL(Log)
+KALDI_SIMD_KERNEL(Sigmoid)
+KALDI_SIMD_KERNEL(Tanh)
+KALDI_SIMD_KERNEL(SoftHinge)
+KALDI_SIMD_KERNEL(ApplyExpAndSum)
+KALDI_SIMD_KERNEL(SumExp)
+
+#undef KALDI_SIMD_KERNEL
+
+}  // namespace
+
+void SimdExp(const float *in, float *out, MatrixIndexT dim) {
+  CpuDispatch<ExpKernel>(in, out, dim);
+}
+
+void SimdLog(const float *in, float *out, MatrixIndexT dim) {
+  CpuDispatch<LogKernel>(in, out, dim);
+}
+
+void SimdSigmoid(const float *in, float *out, MatrixIndexT dim) {
+  CpuDispatch<SigmoidKernel>(in, out, dim);
+}
+
+void SimdTanh(const float *in, float *out, MatrixIndexT dim) {
+  CpuDispatch<TanhKernel>(in, out, dim);
+}
+
+void SimdSoftHinge(const float *in, float *out, MatrixIndexT dim) {
+  CpuDispatch<SoftHingeKernel>(in, out, dim);
+}
+
+double SimdApplyExpAndSum(float offset, float *data, MatrixIndexT dim) {
+  return CpuDispatch<ApplyExpAndSumKernel>(offset, data, dim);
+}
+
+double SimdSumExp(const float *data, float offset, float cutoff,
+                  MatrixIndexT dim) {
+  return CpuDispatch<SumExpKernel>(data, offset, cutoff, dim);
+}
+
+const char *SimdMathInstructionSet() {
+  return CpuIsaName(GetCpuIsa());
+}
+
+#else  // KALDI_SIMD_VECTORS
+
+// Without the vector extensions, these are the loops of kaldi-vector.cc.
+
+void SimdExp(const float *in, float *out, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++)
+    out[i] = Exp(in[i]);
+}
+
+void SimdLog(const float *in, float *out, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++)
+    out[i] = Log(in[i]);
+}
+
+void SimdSigmoid(const float *in, float *out, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    float x = in[i];
+    if (x > 0.0) {
+      x = 1.0 / (1.0 + Exp(-x));
+    } else {
+      float ex = Exp(x);
+      x = ex / (ex + 1.0);
+    }
+    out[i] = x;
+  }
+}
+
+void SimdTanh(const float *in, float *out, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    float x = in[i];
+    if (x > 0.0) {
+      float inv_expx = Exp(-x);
+      x = -1.0 + 2.0 / (1.0 + inv_expx * inv_expx);
+    } else {
+      float expx = Exp(x);
+      x = 1.0 - 2.0 / (1.0 + expx * expx);
+    }
+    out[i] = x;
+  }
+}
+
+void SimdSoftHinge(const float *in, float *out, MatrixIndexT dim) {
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    float x = in[i];
+    out[i] = (x > 10.0 ? x : Log1p(Exp(x)));
+  }
+}
+
+double SimdApplyExpAndSum(float offset, float *data, MatrixIndexT dim) {
+  double sum = 0.0;
+  for (MatrixIndexT i = 0; i < dim; i++)
+    sum += (data[i] = Exp(data[i] - offset));
+  return sum;
+}
+
+double SimdSumExp(const float *data, float offset, float cutoff,
+                  MatrixIndexT dim) {
+  double sum = 0.0;
+  for (MatrixIndexT i = 0; i < dim; i++)
+    if (data[i] >= cutoff)
+      sum += Exp(data[i] - offset);
+  return sum;
+}
+
+const char *SimdMathInstructionSet() {
+  return "none";
+}
+
+#endif  // KALDI_SIMD_VECTORS
+
+}  // namespace kaldi
@@ -0,0 +1,81 @@
+// matrix/simd-math.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SIMD_MATH_H_
+#define KALDI_MATRIX_SIMD_MATH_H_
+
+#include "base/kaldi-common.h"
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/**
+   Vectorized single-precision versions of the element-wise functions of
+   kaldi-math.h, which the float versions of VectorBase::ApplyExp(), Sigmoid(),
+   Tanh(), ApplySoftMax() etc. use.  They use the polynomial approximations of
+   the Cephes library, on vectors of 4, 8 or 16 elements.  With GCC or clang
+   on x86-64 they are compiled for AVX-512, AVX2 and SSE2, and the version for
+   the CPU is chosen at run time; elsewhere (e.g. NEON on ARM) they use the
+   instructions the compiler targets.
+
+   The maximum errors, relative to the exact results, are 2e-7 for SimdExp()
+   and SimdLog() and 4e-7 for the others (as checked by matrix-lib-test),
+   except that denormal results (below about 1.2e-38) lose precision.
+   Infinities and NaNs give the results that std::exp() etc. would.
+
+   For all of them "out" may be the same as "in".
+*/
+
+/// out[i] = exp(in[i]).
+void SimdExp(const float *in, float *out, MatrixIndexT dim);
+
+/// out[i] = log(in[i]).
+void SimdLog(const float *in, float *out, MatrixIndexT dim);
+
+/// out[i] = 1 / (1 + exp(-in[i])).
+void SimdSigmoid(const float *in, float *out, MatrixIndexT dim);
+
+/// out[i] = tanh(in[i]).
+void SimdTanh(const float *in, float *out, MatrixIndexT dim);
+
+/// out[i] = log(1 + exp(in[i])), or in[i] for in[i] > 10 as in
+/// MatrixBase::SoftHinge().
+void SimdSoftHinge(const float *in, float *out, MatrixIndexT dim);
+
+/// Sets data[i] to exp(data[i] - offset) and returns their sum (accumulated
+/// in double precision), for the softmax.
+double SimdApplyExpAndSum(float offset, float *data, MatrixIndexT dim);
+
+/// Returns the sum of exp(data[i] - offset) over the elements with
+/// data[i] >= cutoff, for LogSumExp().
+double SimdSumExp(const float *data, float offset, float cutoff,
+                  MatrixIndexT dim);
+
+/// Returns the name of the instruction set the above use on this CPU, e.g.
+/// "avx2", for logging.
+const char *SimdMathInstructionSet();
+
+/// @} end of \addtogroup matrix_funcs_misc
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SIMD_MATH_H_
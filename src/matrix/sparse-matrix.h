@@ -373,6 +373,16 @@ class GeneralMatrix {
   GeneralMatrix &operator =(const GeneralMatrix &other);
   // Copy constructor
   GeneralMatrix(const GeneralMatrix &other) { *this = other; }
+  // Move constructor; leaves "other" empty.
+  GeneralMatrix(GeneralMatrix &&other) noexcept { Swap(&other); }
+  // Move assignment; leaves "other" empty.
+  GeneralMatrix &operator =(GeneralMatrix &&other) noexcept {
+    if (this != &other) {
+      Clear();
+      Swap(&other);
+    }
+    return *this;
+  }
   // Sets to the empty matrix.
   void Clear();
   // shallow swap
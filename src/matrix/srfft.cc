@@ -25,6 +25,9 @@
 // License v2.0.
 
 
+#include <mutex>
+
+#include "base/cpu-dispatch.h"
 #include "matrix/srfft.h"
 #include "matrix/matrix-functions.h"
 
@@ -42,32 +45,30 @@ SplitRadixComplexFft<Real>::SplitRadixComplexFft(MatrixIndexT N) {
     N >>= 1;
     logn_ ++;
   }
-  ComputeTables();
+  GetTables();
 }
 
 template <typename Real>
 SplitRadixComplexFft<Real>::SplitRadixComplexFft(
     const SplitRadixComplexFft<Real> &other):
-    N_(other.N_), logn_(other.logn_) {
-  // This code duplicates tables from a previously computed object.
-  // Compare with the code in ComputeTables().
-  MatrixIndexT lg2 = logn_ >> 1;
-  if (logn_ & 1) lg2++;
-  MatrixIndexT brseed_size = 1 << lg2;
-  brseed_ = new MatrixIndexT[brseed_size];
-  std::memcpy(brseed_, other.brseed_, sizeof(MatrixIndexT) * brseed_size);
+    N_(other.N_), logn_(other.logn_), brseed_(other.brseed_),
+    tab_(other.tab_) { }
 
-  if (logn_ < 4) {
-    tab_ = NULL;
+template<typename Real>
+void SplitRadixComplexFft<Real>::GetTables() {
+  // The tables of each size; N is at most 2^30.
+  static std::mutex mutex;
+  static MatrixIndexT *brseeds[32];
+  static Real **tabs[32];
+  KALDI_ASSERT(logn_ < 32);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (brseeds[logn_] == NULL) {
+    ComputeTables();
+    brseeds[logn_] = brseed_;
+    tabs[logn_] = tab_;
   } else {
-    tab_ = new Real*[logn_ - 3];
-    for (MatrixIndexT i = logn_; i >= 4 ; i--) {
-      MatrixIndexT m = 1 << i, m2 = m / 2, m4 = m2 / 2;
-      MatrixIndexT this_array_size = 6 * (m4 - 2);
-      tab_[i-4] = new Real[this_array_size];
-      std::memcpy(tab_[i-4], other.tab_[i-4],
-                  sizeof(Real) * this_array_size);
-    }
+    brseed_ = brseeds[logn_];
+    tab_ = tabs[logn_];
   }
 }
 
@@ -123,17 +124,11 @@ void SplitRadixComplexFft<Real>::ComputeTables() {
 }
 
 template<typename Real>
-SplitRadixComplexFft<Real>::~SplitRadixComplexFft() {
-  delete [] brseed_;
-  if (tab_ != NULL) {
-    for (MatrixIndexT i = 0; i < logn_-3; i++)
-      delete [] tab_[i];
-    delete [] tab_;
-  }
-}
+SplitRadixComplexFft<Real>::~SplitRadixComplexFft() { }
 
 template<typename Real>
 void SplitRadixComplexFft<Real>::Compute(Real *xr, Real *xi, bool forward) const {
+  KALDI_PROFILE_SCOPE("SplitRadixComplexFft::Compute");
   if (!forward) {  // reverse real and imaginary parts for complex FFT.
     Real *tmp = xr;
     xr = xi;
@@ -207,15 +202,105 @@ void SplitRadixComplexFft<Real>::BitReversePermute(Real *x, MatrixIndexT logn) c
 }
 
 
+namespace {
+
+// Steps 1, 2 and (for "count" elements, with the twiddle factors cn etc.) 3
+// and 4 of the butterflies below.
+template<typename Real>
+static KALDI_CPU_INLINE void SplitRadixStep1(
+    Real *__restrict__ xr1, Real *__restrict__ xr2, Real *__restrict__ xi1,
+    Real *__restrict__ xi2, MatrixIndexT count) {
+  for (MatrixIndexT n = 0; n < count; n++) {
+    Real tmp1 = xr1[n] + xr2[n];
+    xr2[n] = xr1[n] - xr2[n];
+    xr1[n] = tmp1;
+    Real tmp2 = xi1[n] + xi2[n];
+    xi2[n] = xi1[n] - xi2[n];
+    xi1[n] = tmp2;
+  }
+}
+
+template<typename Real>
+static KALDI_CPU_INLINE void SplitRadixStep2(
+    Real *__restrict__ xr1, Real *__restrict__ xr2, Real *__restrict__ xi1,
+    Real *__restrict__ xi2, MatrixIndexT count) {
+  for (MatrixIndexT n = 0; n < count; n++) {
+    Real tmp1 = xr1[n] + xi2[n];
+    Real tmp2 = xi1[n] + xr2[n];
+    xi1[n] = xi1[n] - xr2[n];
+    xr2[n] = xr1[n] - xi2[n];
+    xr1[n] = tmp1;
+    xi2[n] = tmp2;
+  }
+}
+
+template<typename Real>
+static KALDI_CPU_INLINE void SplitRadixTwiddle(
+    Real *__restrict__ xr1, Real *__restrict__ xi1, Real *__restrict__ xr2,
+    Real *__restrict__ xi2, const Real *cn, const Real *spcn,
+    const Real *smcn, const Real *c3n, const Real *spc3n, const Real *smc3n,
+    MatrixIndexT count) {
+  for (MatrixIndexT n = 0; n < count; n++) {
+    Real tmp2 = cn[n] * (xr1[n] + xi1[n]);
+    Real tmp1 = spcn[n] * xr1[n] + tmp2;
+    xr1[n] = smcn[n] * xi1[n] + tmp2;
+    xi1[n] = tmp1;
+    tmp2 = c3n[n] * (xr2[n] + xi2[n]);
+    tmp1 = spc3n[n] * xr2[n] + tmp2;
+    xr2[n] = smc3n[n] * xi2[n] + tmp2;
+    xi2[n] = tmp1;
+  }
+}
+
+// Steps 1 to 4 of SplitRadixComplexFft::ComputeRecursive() for logn >= 3,
+// which CpuDispatch() runs compiled for the instruction set of the CPU (see
+// base/cpu-dispatch.h); "tab" is tab_[logn-4], or NULL if logn == 3.
+template<CpuIsa isa> struct SplitRadixButterflyKernel {
+  template<typename Real>
+  static KALDI_CPU_INLINE void Run(Real *xr, Real *xi, MatrixIndexT logn,
+                                   const Real *tab) {
+    MatrixIndexT m = 1 << logn, m2 = m / 2, m4 = m2 / 2, m8 = m4 / 2;
+    const Real sqhalf = M_SQRT1_2;
+
+    /* Step 1 */
+    SplitRadixStep1(xr, xr + m2, xi, xi + m2, m2);
+
+    /* Step 2 */
+    Real *xr1 = xr + m2, *xr2 = xr1 + m4, *xi1 = xi + m2, *xi2 = xi1 + m4;
+    SplitRadixStep2(xr1, xr2, xi1, xi2, m4);
+
+    /* Steps 3 & 4, for n = 1 ... m4 - 1; the twiddle factors skip n = m8,
+       where they are sqrt(1/2). */
+    const Real *cn = tab, *spcn = NULL, *smcn = NULL, *c3n = NULL,
+        *spc3n = NULL, *smc3n = NULL;
+    if (tab != NULL) {
+      MatrixIndexT nel = m4 - 2;
+      spcn = cn + nel; smcn = spcn + nel;
+      c3n = smcn + nel; spc3n = c3n + nel; smc3n = spc3n + nel;
+      SplitRadixTwiddle(xr1 + 1, xi1 + 1, xr2 + 1, xi2 + 1, cn, spcn, smcn,
+                        c3n, spc3n, smc3n, m8 - 1);
+      MatrixIndexT k = m8 - 1;
+      SplitRadixTwiddle(xr1 + m8 + 1, xi1 + m8 + 1, xr2 + m8 + 1,
+                        xi2 + m8 + 1, cn + k, spcn + k, smcn + k, c3n + k,
+                        spc3n + k, smc3n + k, m4 - m8 - 1);
+    }
+    Real tmp1 =  sqhalf * (xr1[m8] + xi1[m8]);
+    xi1[m8] =  sqhalf * (xi1[m8] - xr1[m8]);
+    xr1[m8] =  tmp1;
+    Real tmp2 =  sqhalf * (xi2[m8] - xr2[m8]);
+    xi2[m8] = -sqhalf * (xr2[m8] + xi2[m8]);
+    xr2[m8] =  tmp2;
+  }
+};
+
+}  // namespace
+
 template<typename Real>
 void SplitRadixComplexFft<Real>::ComputeRecursive(Real *xr, Real *xi, MatrixIndexT logn) const {
 
-  MatrixIndexT    m, m2, m4, m8, nel, n;
+  MatrixIndexT    m, m2, m4;
   Real    *xr1, *xr2, *xi1, *xi2;
-  Real    *cn = nullptr, *spcn = nullptr, *smcn = nullptr, *c3n = nullptr,
-    *spc3n = nullptr, *smc3n = nullptr;
   Real    tmp1, tmp2;
-  Real   sqhalf = M_SQRT1_2;
 
   /* Check range of logn */
   if (logn < 0)
@@ -276,68 +361,10 @@ void SplitRadixComplexFft<Real>::ComputeRecursive(Real *xr, Real *xi, MatrixInde
     else if (logn == 0) return;   /* length m = 1 */
   }
 
-  /* Compute a few constants */
-  m = 1 << logn; m2 = m / 2; m4 = m2 / 2; m8 = m4 /2;
-
-
-  /* Step 1 */
-  xr1 = xr; xr2 = xr1 + m2;
-  xi1 = xi; xi2 = xi1 + m2;
-  for (n = 0; n < m2; n++) {
-    tmp1 = *xr1 + *xr2;
-    *xr2 = *xr1 - *xr2;
-    xr2++;
-    *xr1++ = tmp1;
-    tmp2 = *xi1 + *xi2;
-    *xi2 = *xi1 - *xi2;
-    xi2++;
-    *xi1++ = tmp2;
-  }
-
-  /* Step 2 */
-  xr1 = xr + m2; xr2 = xr1 + m4;
-  xi1 = xi + m2; xi2 = xi1 + m4;
-  for (n = 0; n < m4; n++) {
-    tmp1 = *xr1 + *xi2;
-    tmp2 = *xi1 + *xr2;
-    *xi1 = *xi1 - *xr2;
-    xi1++;
-    *xr2++ = *xr1 - *xi2;
-    *xr1++ = tmp1;
-    *xi2++ = tmp2;
-    // xr1++; xr2++; xi1++; xi2++;
-  }
-
-  /* Steps 3 & 4 */
-  xr1 = xr + m2; xr2 = xr1 + m4;
-  xi1 = xi + m2; xi2 = xi1 + m4;
-  if (logn >= 4) {
-    nel = m4 - 2;
-    cn  = tab_[logn-4]; spcn  = cn + nel;  smcn  = spcn + nel;
-    c3n = smcn + nel;  spc3n = c3n + nel; smc3n = spc3n + nel;
-  }
-  xr1++; xr2++; xi1++; xi2++;
-  // xr1++; xi1++;
-  for (n = 1; n < m4; n++) {
-    if (n == m8) {
-      tmp1 =  sqhalf * (*xr1 + *xi1);
-      *xi1 =  sqhalf * (*xi1 - *xr1);
-      *xr1 =  tmp1;
-      tmp2 =  sqhalf * (*xi2 - *xr2);
-      *xi2 = -sqhalf * (*xr2 + *xi2);
-      *xr2 =  tmp2;
-    } else {
-      tmp2 = *cn++ * (*xr1 + *xi1);
-      tmp1 = *spcn++ * *xr1 + tmp2;
-      *xr1 = *smcn++ * *xi1 + tmp2;
-      *xi1 = tmp1;
-      tmp2 = *c3n++ * (*xr2 + *xi2);
-      tmp1 = *spc3n++ * *xr2 + tmp2;
-      *xr2 = *smc3n++ * *xi2 + tmp2;
-      *xi2 = tmp1;
-    }
-    xr1++; xr2++; xi1++; xi2++;
-  }
+  /* Steps 1 to 4 */
+  const Real *tab = (logn >= 4 ? tab_[logn-4] : NULL);
+  CpuDispatch<SplitRadixButterflyKernel>(xr, xi, logn, tab);
+  m = 1 << logn; m2 = m / 2;
 
   /* Call ssrec again with half DFT length */
   ComputeRecursive(xr, xi, logn-1);
@@ -352,6 +379,28 @@ void SplitRadixComplexFft<Real>::ComputeRecursive(Real *xr, Real *xi, MatrixInde
 }
 
 
+template<typename Real>
+void SplitRadixRealFft<Real>::GetTwiddles() {
+  static std::mutex mutex;
+  static Real *twiddles[32];
+  MatrixIndexT logn = 0;
+  while ((1 << logn) < N_)
+    logn++;
+  KALDI_ASSERT(logn < 32);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (twiddles[logn] == NULL) {
+    MatrixIndexT N4 = N_ / 4;
+    Real *table = new Real[2 * (N4 + 1)];
+    for (MatrixIndexT k = 0; k <= N4; k++) {
+      double angle = M_2PI * k / N_;
+      table[k] = std::cos(angle);
+      table[N4 + 1 + k] = std::sin(angle);
+    }
+    twiddles[logn] = table;
+  }
+  twiddles_ = twiddles[logn];
+}
+
 template<typename Real>
 void SplitRadixRealFft<Real>::Compute(Real *data, bool forward) {
   Compute(data, forward, &this->temp_buffer_);
@@ -363,18 +412,20 @@ void SplitRadixRealFft<Real>::Compute(Real *data, bool forward) {
 template<typename Real>
 void SplitRadixRealFft<Real>::Compute(Real *data, bool forward,
                                       std::vector<Real> *temp_buffer) const {
+  KALDI_PROFILE_SCOPE("SplitRadixRealFft::Compute");
   MatrixIndexT N = N_, N2 = N/2;
   KALDI_ASSERT(N%2 == 0);
   if (forward) // call to base class
     SplitRadixComplexFft<Real>::Compute(data, true, temp_buffer);
 
-  Real rootN_re, rootN_im;  // exp(-2pi/N), forward; exp(2pi/N), backward
-  int forward_sign = forward ? -1 : 1;
-  ComplexImExp(static_cast<Real>(M_2PI/N *forward_sign), &rootN_re, &rootN_im);
-  Real kN_re = -forward_sign, kN_im = 0.0;  // exp(-2pik/N), forward; exp(-2pik/N), backward
-  // kN starts out as 1.0 for forward algorithm but -1.0 for backward.
+  // The twiddle factor kN = 1^(k/N) is exp(-2pik/N), forward, and
+  // -exp(2pik/N), backward.  It comes from the table rather than from
+  // repeated complex multiplication, which is a serial chain of operations
+  // and loses precision for large N.
+  const Real *cos_table = twiddles_, *sin_table = twiddles_ + N / 4 + 1;
+  const Real re_sign = (forward ? 1 : -1);
   for (MatrixIndexT k = 1; 2*k <= N2; k++) {
-    ComplexMul(rootN_re, rootN_im, &kN_re, &kN_im);
+    Real kN_re = re_sign * cos_table[k], kN_im = -sin_table[k];
 
     Real Ck_re, Ck_im, Dk_re, Dk_im;
     // C_k = 1/2 (B_k + B_{N/2 - k}^*) :
@@ -44,14 +44,17 @@ namespace kaldi {
 // (declared in matrix-functios.h), but it only works for powers of 2.
 // Note: in multi-threaded code, you would need to have one of these objects per
 // thread, because multiple calls to Compute in parallel would not work.
+// (The const versions of Compute(), with a temporary buffer, may be called in
+// parallel.)  The tables of each size are computed the first time an object
+// of that size is constructed and are shared by all such objects, so
+// constructing and copying these objects is cheap.
 template<typename Real>
 class SplitRadixComplexFft {
  public:
   typedef MatrixIndexT Integer;
 
   // N is the number of complex points (must be a power of two, or this
-  // will crash).  Note that the constructor does some work so it's best to
-  // initialize the object once and do the computation many times.
+  // will crash).
   SplitRadixComplexFft(Integer N);
 
   // Copy constructor
@@ -84,6 +87,9 @@ class SplitRadixComplexFft {
   // argument and we need a temporary buffer while creating interleaved data.
   std::vector<Real> temp_buffer_;
  private:
+  // Sets brseed_ and tab_ to the shared tables for logn_, computing them with
+  // ComputeTables() if this is the first object of this size.
+  void GetTables();
   void ComputeTables();
   void ComputeRecursive(Real *xr, Real *xi, Integer logn) const;
   void BitReversePermute(Real *x, Integer logn) const;
@@ -91,6 +97,7 @@ class SplitRadixComplexFft {
   Integer N_;
   Integer logn_;  // log(N)
 
+  // The tables are owned by the cache of GetTables(), and never freed.
   Integer *brseed_;
   // brseed is Evans' seed table, ref:  (Ref: D. M. W.
   // Evans, "An improved digit-reversal permutation algorithm ...",
@@ -105,11 +112,12 @@ template<typename Real>
 class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
  public:
   SplitRadixRealFft(MatrixIndexT N):  // will fail unless N>=4 and N is a power of 2.
-      SplitRadixComplexFft<Real> (N/2), N_(N) { }
+      SplitRadixComplexFft<Real> (N/2), N_(N) { GetTwiddles(); }
 
   // Copy constructor
   SplitRadixRealFft(const SplitRadixRealFft<Real> &other):
-      SplitRadixComplexFft<Real>(other), N_(other.N_) { }
+      SplitRadixComplexFft<Real>(other), N_(other.N_),
+      twiddles_(other.twiddles_) { }
 
   /// If forward == true, this function transforms from a sequence of N real points to its complex fourier
   /// transform; otherwise it goes in the reverse direction.  If you call it
@@ -126,9 +134,16 @@ class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
   void Compute(Real *x, bool forward, std::vector<Real> *temp_buffer) const;
 
  private:
+  // Sets twiddles_ to the shared table for N_.
+  void GetTwiddles();
+
   // Disallow assignment.
   SplitRadixRealFft &operator =(const SplitRadixRealFft<Real> &other);
   int N_;
+  // cos(2 pi k / N) for k = 0 ... N/4, followed by sin(2 pi k / N), which
+  // combine the two halves of the complex FFT; owned by the cache of
+  // GetTwiddles().
+  const Real *twiddles_;
 };
 
 
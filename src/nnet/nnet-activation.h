@@ -28,7 +28,6 @@
 #include "nnet/nnet-component.h"
 #include "nnet/nnet-utils.h"
 #include "cudamatrix/cu-math.h"
-#include "cudamatrix/cu-rand.h"
 #include "util/text-utils.h"
 
 namespace kaldi {
@@ -270,7 +269,8 @@ class Dropout : public Component {
  public:
   Dropout(int32 dim_in, int32 dim_out):
       Component(dim_in, dim_out),
-      dropout_rate_(0.5)
+      dropout_rate_(0.5),
+      mask_seed_(0)
   { }
 
   ~Dropout()
@@ -328,26 +328,24 @@ class Dropout : public Component {
 
   void PropagateFnc(const CuMatrixBase<BaseFloat> &in,
                     CuMatrixBase<BaseFloat> *out) {
-    out->CopyFromMat(in);
-    // set N inputs to zero, according to the 'dropout_rate_' ...
-    dropout_mask_.Resize(out->NumRows(), out->NumCols());
-    rand_.RandUniform(&dropout_mask_);  // [0..1]
-    dropout_mask_.Add(-dropout_rate_);  // [(-rate)..(1-rate)]
-    dropout_mask_.Heaviside(dropout_mask_); // (x > 0.0 ? 1 : 0)
-    out->MulElements(dropout_mask_);
-    // rescale to keep the same dynamic range as w/o dropout,
-    out->Scale(1.0 / (1.0 - dropout_rate_));
+    // set N inputs to zero, according to the 'dropout_rate_', and
+    // rescale to keep the same dynamic range as w/o dropout;
+    // only the seed of the mask is kept for the backprop.
+    mask_seed_ = (static_cast<uint64>(RandInt(0, 0x7fffffff)) << 32) ^
+        static_cast<uint64>(RandInt(0, 0x7fffffff));
+    cu::PhiloxDropout(in, dropout_rate_, BaseFloat(1.0 / (1.0 - dropout_rate_)),
+                      mask_seed_, false, out);
   }
 
   void BackpropagateFnc(const CuMatrixBase<BaseFloat> &in,
                         const CuMatrixBase<BaseFloat> &out,
                         const CuMatrixBase<BaseFloat> &out_diff,
                         CuMatrixBase<BaseFloat> *in_diff) {
-    in_diff->CopyFromMat(out_diff);
-    // use same mask on the error derivatives...
-    in_diff->MulElements(dropout_mask_);
-    // enlarge the output to fit same dynamic range as w/o dropout
-    in_diff->Scale(1.0 / (1.0 - dropout_rate_));
+    // use same mask on the error derivatives (the same seed gives the same
+    // mask), enlarge the output to fit same dynamic range as w/o dropout.
+    cu::PhiloxDropout(out_diff, dropout_rate_,
+                      BaseFloat(1.0 / (1.0 - dropout_rate_)),
+                      mask_seed_, false, in_diff);
   }
 
   BaseFloat GetDropoutRate() { return dropout_rate_; }
@@ -360,10 +358,8 @@ class Dropout : public Component {
  private:
   BaseFloat dropout_rate_;  ///< probability that a neuron is dropped,
 
-  CuRand<BaseFloat> rand_;  ///< generator of random numbers,
-
-  CuMatrix<BaseFloat> dropout_mask_;  // random binary mask,
-                                      // 1 = keep neuron, 0 = drop neuron,
+  uint64 mask_seed_;  ///< seed of the random binary mask of the last
+                     ///< PropagateFnc(), see cu::PhiloxDropout(),
 };
 
 }  // namespace nnet1
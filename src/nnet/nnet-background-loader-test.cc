@@ -0,0 +1,101 @@
+// nnet/nnet-background-loader-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <vector>
+
+#include "nnet/nnet-background-loader.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// The items come in the order read, and no more than the bound (plus the
+// item being read, plus the one being waited on) are read ahead
+void UnitTestBackgroundLoaderOrder() {
+  int32 num_items = 200, max_queued = 10;
+  std::atomic<int32> num_read(0);
+  auto read = [&](std::vector<int32> *item) -> bool {
+    if (num_read == num_items) return false;
+    item->assign(1 + num_read % 3, num_read);
+    num_read++;
+    return true;
+  };
+  auto size = [](const std::vector<int32> &item) -> int64 {
+    return item.size();
+  };
+  BackgroundLoader<std::vector<int32> > loader(read, size, max_queued);
+  int32 num_taken = 0;
+  std::vector<int32> *item;
+  while ((item = loader.Next()) != NULL) {
+    KALDI_ASSERT(item->size() == 1 + num_taken % 3 &&
+                 (*item)[0] == num_taken);
+    KALDI_ASSERT(num_read - num_taken <= max_queued + 2);
+    num_taken++;
+    delete item;
+  }
+  KALDI_ASSERT(num_taken == num_items);
+  KALDI_ASSERT(loader.Next() == NULL);
+}
+
+// An error of the loader comes after the items read before it
+void UnitTestBackgroundLoaderError() {
+  int32 num_read = 0;
+  auto read = [&](int32 *item) -> bool {
+    if (num_read == 5) KALDI_ERR << "Bad utterance";
+    *item = num_read++;
+    return true;
+  };
+  BackgroundLoader<int32> loader(read,
+      [](const int32 &item) -> int64 { return 1; }, 100);
+  for (int32 i = 0; i < 5; i++) {
+    int32 *item = loader.Next();
+    KALDI_ASSERT(item != NULL && *item == i);
+    delete item;
+  }
+  bool failed = false;
+  try {
+    loader.Next();
+  } catch(const std::runtime_error &e) {
+    failed = true;
+  }
+  KALDI_ASSERT(failed);
+}
+
+// The loader is stopped when it goes before the data is all taken
+void UnitTestBackgroundLoaderStop() {
+  auto read = [](int32 *item) -> bool { *item = 1; return true; };
+  BackgroundLoader<int32> loader(read,
+      [](const int32 &item) -> int64 { return 1; }, 3);
+  delete loader.Next();
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+  for (int32 i = 0; i < 10; i++) {
+    UnitTestBackgroundLoaderOrder();
+    UnitTestBackgroundLoaderError();
+    UnitTestBackgroundLoaderStop();
+  }
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,159 @@
+// nnet/nnet-background-loader.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET_NNET_BACKGROUND_LOADER_H_
+#define KALDI_NNET_NNET_BACKGROUND_LOADER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * Reads the training data on a thread of its own, so the reading (and
+ * decompressing, and feature transform, and copying to the GPU) of the next
+ * utterances overlaps the training on the ones before.
+ *
+ * 'read' is called on the loader thread, it fills in the next Item and
+ * returns true, or returns false at the end of the data. The items are
+ * queued until the queue holds 'max_queued' of 'size' (e.g. frames), so the
+ * memory held is bounded; Next() gives them in the order they were read.
+ * Items are passed by pointer, so nothing is copied.
+ * With a GPU each thread has its own CUDA stream, the copies to the GPU
+ * made by 'read' go on the loader's stream, which 'read' should synchronize
+ * before it returns, so the item is complete when the trainer gets it.
+ *
+ * An exception thrown by 'read' stops the loader, and is thrown (as a
+ * KALDI_ERR) from Next once the items before it are taken.
+ */
+template<class Item>
+class BackgroundLoader {
+ public:
+  typedef std::function<bool(Item*)> ReadFunction;
+  typedef std::function<int64(const Item&)> SizeFunction;
+
+  BackgroundLoader(const ReadFunction &read, const SizeFunction &size,
+                   int64 max_queued)
+      : read_(read), size_(size), max_queued_(max_queued), queued_(0),
+        done_(false), failed_(false), stop_(false) {
+    KALDI_ASSERT(max_queued > 0);
+    thread_ = std::thread(&BackgroundLoader::Run, this);
+  }
+
+  /// Stops the loader early if the items have not all been taken
+  ~BackgroundLoader() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    not_full_.notify_all();
+    thread_.join();
+    for (size_t i = 0; i < queue_.size(); i++)
+      delete queue_[i].first;
+  }
+
+  /// Waits for the next item, returns NULL when there are no more. The
+  /// caller takes ownership of the item.
+  Item* Next() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() { return !queue_.empty() || done_; });
+    if (queue_.empty()) {
+      if (failed_)
+        KALDI_ERR << "Reading the training data failed"
+                  << (error_.empty() ? "" : ": ") << error_;
+      return NULL;
+    }
+    Item *item = queue_.front().first;
+    queued_ -= queue_.front().second;
+    queue_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return item;
+  }
+
+ private:
+  void Run() {
+    try {
+      while (true) {
+        Item *item = new Item();
+        bool read = false;
+        try {
+          read = read_(item);
+        } catch(...) {
+          delete item;
+          throw;
+        }
+        if (!read) {
+          delete item;
+          break;
+        }
+        int64 size = size_(*item);
+        std::unique_lock<std::mutex> lock(mutex_);
+        // an item larger than the queue still goes in, on its own
+        not_full_.wait(lock, [this]() {
+            return stop_ || queued_ < max_queued_; });
+        if (stop_) {
+          delete item;
+          break;
+        }
+        queue_.push_back(std::make_pair(item, size));
+        queued_ += size;
+        lock.unlock();
+        not_empty_.notify_one();
+      }
+    } catch(const std::exception &e) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      failed_ = true;
+      // KALDI_ERR has already logged its message and throws an empty one
+      error_ = e.what();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    not_empty_.notify_all();
+  }
+
+  ReadFunction read_;
+  SizeFunction size_;
+  int64 max_queued_;
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_, not_full_;
+  std::deque<std::pair<Item*, int64> > queue_;  // the items, owned, and sizes
+  int64 queued_;
+  bool done_, failed_, stop_;
+  std::string error_;
+  // last, it runs on the members above
+  std::thread thread_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BackgroundLoader);
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+#endif  // KALDI_NNET_NNET_BACKGROUND_LOADER_H_
@@ -28,6 +28,7 @@
 #include "nnet/nnet-max-pooling-component.h"
 #include "nnet/nnet-max-pooling-2d-component.h"
 #include "nnet/nnet-average-pooling-2d-component.h"
+#include "nnet/nnet-quantized-affine-transform.h"
 #include "util/common-utils.h"
 
 namespace kaldi {
@@ -412,6 +413,44 @@ namespace nnet1 {
     delete c;
   }
 
+  void UnitTestQuantizedAffineTransform() {
+    Component* c = Component::Init(
+      "<AffineTransform> <InputDim> 30 <OutputDim> 20 <ParamStddev> 0.5"
+    );
+    AffineTransform* aff = dynamic_cast<AffineTransform*>(c);
+    CuMatrix<BaseFloat> in(15, 30), out, quant_out;
+    in.SetRandn();
+    c->Propagate(in, &out);
+    for (int32 m = 0; m < 2; m++) {
+      QuantizedAffineTransform quant(30, 20);
+      quant.Init(aff->GetLinearity(), aff->GetBias(),
+                 m == 0 ? kInt8RowScale : kFloat16);
+      quant.Propagate(in, &quant_out);
+      AssertEqual(out, quant_out, 0.02);
+      // write and read back, the same weights give the same output,
+      for (int32 binary = 0; binary < 2; binary++) {
+        std::ostringstream os;
+        quant.Write(os, binary == 1);
+        std::istringstream is(os.str());
+        Component* c2 = Component::Read(is, binary == 1);
+        KALDI_ASSERT(c2->GetType() == Component::kQuantizedAffineTransform);
+        CuMatrix<BaseFloat> read_out;
+        c2->Propagate(in, &read_out);
+        AssertEqual(quant_out, read_out, 1.0e-05);
+        delete c2;
+      }
+      // copies share the quantized weights,
+      Component* copy = quant.Copy();
+      KALDI_ASSERT(&dynamic_cast<QuantizedAffineTransform*>(copy)->
+                   GetLinearity() == &quant.GetLinearity());
+      CuMatrix<BaseFloat> copy_out;
+      copy->Propagate(in, &copy_out);
+      AssertEqual(quant_out, copy_out);
+      delete copy;
+    }
+    delete c;
+  }
+
 }  // namespace nnet1
 }  // namespace kaldi
 
@@ -438,6 +477,7 @@ int main() {
     UnitTestMaxPooling2DComponent();
     UnitTestAveragePooling2DComponent();
     UnitTestDropoutComponent();
+    UnitTestQuantizedAffineTransform();
     // end of unit-tests,
     if (loop == 0)
         KALDI_LOG << "Tests without GPU use succeeded.";
@@ -48,6 +48,7 @@
 #include "nnet/nnet-parallel-component.h"
 #include "nnet/nnet-multibasis-component.h"
 #include "nnet/nnet-parametric-relu.h"
+#include "nnet/nnet-quantized-affine-transform.h"
 
 namespace kaldi {
 namespace nnet1 {
@@ -75,6 +76,7 @@ const struct Component::key_value Component::kMarkerMap[] = {
   { Component::kCopy, "<Copy>" },
   { Component::kAddShift, "<AddShift>" },
   { Component::kRescale, "<Rescale>" },
+  { Component::kQuantizedAffineTransform, "<QuantizedAffineTransform>" },
   { Component::kKlHmm, "<KlHmm>" },
   { Component::kAveragePoolingComponent, "<AveragePoolingComponent>" },
   { Component::kAveragePooling2DComponent, "<AveragePooling2DComponent>" },
@@ -178,6 +180,9 @@ Component* Component::NewComponentOfType(ComponentType comp_type,
     case Component::kRescale :
       ans = new Rescale(input_dim, output_dim);
       break;
+    case Component::kQuantizedAffineTransform :
+      ans = new QuantizedAffineTransform(input_dim, output_dim);
+      break;
     case Component::kKlHmm :
       ans = new KlHmm(input_dim, output_dim);
       break;
@@ -74,6 +74,7 @@ class Component {
     kBlockLinearity,
     kAddShift,
     kRescale,
+    kQuantizedAffineTransform,
 
     kKlHmm = 0x0800,
     kSentenceAveragingComponent, /* deprecated */
@@ -0,0 +1,106 @@
+// nnet/nnet-data-parallel-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string>
+#include <vector>
+
+#include "nnet/nnet-data-parallel.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+static Nnet TestNnet() {
+  Nnet nnet;
+  nnet.AppendComponentPointer(Component::Init(
+      "<AffineTransform> <InputDim> 6 <OutputDim> 10 <ParamStddev> 0.5"));
+  nnet.AppendComponentPointer(Component::Init(
+      "<Sigmoid> <InputDim> 10 <OutputDim> 10"));
+  nnet.AppendComponentPointer(Component::Init(
+      "<AffineTransform> <InputDim> 10 <OutputDim> 4 <ParamStddev> 0.5"));
+  NnetTrainOptions opts;
+  opts.learn_rate = 0.01;
+  opts.momentum = 0.9;
+  opts.l2_penalty = 0.001;
+  nnet.SetTrainOptions(opts);
+  return nnet;
+}
+
+// The steps of the replicas are steps on all of their frames at once,
+void UnitTestDataParallelTrainer() {
+  Nnet nnet = TestNnet();
+  int32 num_replicas = 3, minibatch = 7;
+  DataParallelTrainer trainer(nnet, num_replicas);
+  KALDI_ASSERT(trainer.NumReplicas() == num_replicas);
+  // fewer at the end, (where the momentum of the others is not applied)
+  int32 num_active[] = { 3, 3, 3, 2 };
+  for (int32 s = 0; s < 4; s++) {
+    std::vector<CuMatrix<BaseFloat> > in(num_active[s]);
+    CuMatrix<BaseFloat> all_in(num_active[s] * minibatch, 6);
+    for (int32 r = 0; r < num_active[s]; r++) {
+      in[r].Resize(minibatch, 6);
+      in[r].SetRandn();
+      all_in.RowRange(r * minibatch, minibatch).CopyFromMat(in[r]);
+    }
+    // the loss is the sum of squares of the outputs,
+    trainer.Step(num_active[s], [&in](int32 r, Nnet *replica) {
+        CuMatrix<BaseFloat> out;
+        replica->Propagate(in[r], &out);
+        replica->Backpropagate(out, NULL);
+      });
+    CuMatrix<BaseFloat> out;
+    nnet.Propagate(all_in, &out);
+    nnet.Backpropagate(out, NULL);
+    Vector<BaseFloat> ref, params;
+    if (num_active[s] == num_replicas)
+      nnet.GetParams(&ref);
+    else
+      trainer.GetNnet().GetParams(&ref);
+    for (int32 r = 0; r < num_replicas; r++) {
+      trainer.GetReplica(r).GetParams(&params);
+      AssertEqual(ref, params, 1.0e-04);
+    }
+  }
+}
+
+// The error of a replica reaches the caller, and the trainer carries on,
+void UnitTestDataParallelTrainerError() {
+  DataParallelTrainer trainer(TestNnet(), 2);
+  bool thrown = false;
+  try {
+    trainer.Step(2, [](int32 r, Nnet *replica) {
+        if (r == 1) KALDI_ERR << "Replica " << r << " fails";
+      });
+  } catch(const std::exception &e) {
+    thrown = true;
+  }
+  KALDI_ASSERT(thrown);
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+  UnitTestDataParallelTrainer();
+  UnitTestDataParallelTrainerError();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,128 @@
+// nnet/nnet-data-parallel.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nnet/nnet-data-parallel.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// With a GPU each thread has its own CUDA stream, what a thread has queued
+// on the weights is finished before another thread reads them,
+static void SynchronizeThreadStream() {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+#endif
+}
+
+DataParallelTrainer::DataParallelTrainer(const Nnet &nnet,
+                                         int32 num_replicas):
+    step_(NULL), step_id_(0), num_active_(0), num_running_(0), stop_(false),
+    failed_(false) {
+  KALDI_ASSERT(num_replicas > 0);
+  for (int32 r = 0; r < num_replicas; r++)
+    replicas_.push_back(new Nnet(nnet));
+  for (int32 r = 1; r < num_replicas; r++)
+    threads_.push_back(std::thread(&DataParallelTrainer::RunWorker, this, r));
+}
+
+DataParallelTrainer::~DataParallelTrainer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (size_t t = 0; t < threads_.size(); t++)
+    threads_[t].join();
+  for (size_t r = 0; r < replicas_.size(); r++)
+    delete replicas_[r];
+}
+
+void DataParallelTrainer::RunStep(int32 r) {
+  try {
+    (*step_)(r, replicas_[r]);
+    SynchronizeThreadStream();
+  } catch(const std::exception &e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // KALDI_ERR has already logged its message and throws an empty one
+    if (!failed_) error_ = e.what();
+    failed_ = true;
+  }
+}
+
+void DataParallelTrainer::RunWorker(int32 r) {
+  int64 last_step = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, last_step]() {
+          return stop_ || step_id_ != last_step; });
+      if (stop_) return;
+      last_step = step_id_;
+      if (r >= num_active_) continue;
+    }
+    RunStep(r);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      num_running_--;
+    }
+    finished_.notify_one();
+  }
+}
+
+void DataParallelTrainer::Step(int32 num_active, const StepFunction &step) {
+  KALDI_ASSERT(num_active > 0 && num_active <= NumReplicas());
+  if (NumReplicas() > 1) replicas_[0]->GetParams(&params_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    step_ = &step;
+    num_active_ = num_active;
+    num_running_ = num_active - 1;
+    step_id_++;
+  }
+  start_.notify_all();
+  RunStep(0);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return num_running_ == 0; });
+    step_ = NULL;
+    if (failed_)
+      KALDI_ERR << "Training a replica failed"
+                << (error_.empty() ? "" : ": ") << error_;
+  }
+  if (NumReplicas() > 1) ReduceUpdates(num_active);
+}
+
+void DataParallelTrainer::ReduceUpdates(int32 num_active) {
+  // params + sum_r (params_r - params), inactive replicas have not changed,
+  Vector<BaseFloat> sum(params_);
+  sum.Scale(1 - num_active);
+  for (int32 r = 0; r < num_active; r++) {
+    replicas_[r]->GetParams(&replica_params_);
+    sum.AddVec(1.0, replica_params_);
+  }
+  for (int32 r = 0; r < NumReplicas(); r++)
+    replicas_[r]->SetParams(sum);
+  SynchronizeThreadStream();
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
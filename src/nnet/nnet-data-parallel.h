@@ -0,0 +1,98 @@
+// nnet/nnet-data-parallel.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET_NNET_DATA_PARALLEL_H_
+#define KALDI_NNET_NNET_DATA_PARALLEL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "nnet/nnet-nnet.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * Synchronous data-parallel training of a Nnet. There are 'num_replicas'
+ * copies of the network, each trains on a mini-batch of its own on a thread
+ * of its own (the first on the calling thread), and then the changes made
+ * to the weights are summed over the replicas and every replica is set to
+ * the sum, so they all start the next step from the same weights.
+ *
+ * The weight change of SGD (with momentum and the L2 penalty, which the
+ * components scale by the frames) is linear in the gradient, so one step
+ * of N replicas is one step on a mini-batch of all their frames, the same
+ * learning rate applies. The replicas share the GPU selected (with a CUDA
+ * stream each), or run on the cores of the CPU.
+ */
+class DataParallelTrainer {
+ public:
+  /// Trains replica 'replica' on its mini-batch (Propagate, the loss,
+  /// Backpropagate), on the replica's thread
+  typedef std::function<void(int32 replica, Nnet *nnet)> StepFunction;
+
+  DataParallelTrainer(const Nnet &nnet, int32 num_replicas);
+  /// Stops the threads
+  ~DataParallelTrainer();
+
+  int32 NumReplicas() const { return replicas_.size(); }
+
+  /// The first replica, which has the weights trained
+  const Nnet& GetNnet() const { return *replicas_[0]; }
+  Nnet& GetReplica(int32 r) { return *replicas_[r]; }
+
+  /// Runs 'step' for the replicas 0 .. num_active - 1 at once, (fewer at the
+  /// end of the data, the momentum of the others is then held over to their
+  /// next step), waits for them and sums their weight changes. An
+  /// exception thrown by 'step' is thrown (as a KALDI_ERR) from here.
+  void Step(int32 num_active, const StepFunction &step);
+
+ private:
+  void RunWorker(int32 r);
+  void RunStep(int32 r);
+  // Sets all the replicas to the sum of the weight changes of the active,
+  void ReduceUpdates(int32 num_active);
+
+  std::vector<Nnet*> replicas_;  // owned
+  Vector<BaseFloat> params_;  // the weights at the start of the step,
+  Vector<BaseFloat> replica_params_;
+
+  std::mutex mutex_;
+  std::condition_variable start_, finished_;
+  const StepFunction *step_;
+  int64 step_id_;  // counts the steps, tells the workers of a new one,
+  int32 num_active_, num_running_;
+  bool stop_;
+  std::string error_;  // of the first step that failed,
+  bool failed_;
+  std::vector<std::thread> threads_;  // for the replicas 1 .., last
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DataParallelTrainer);
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+#endif  // KALDI_NNET_NNET_DATA_PARALLEL_H_
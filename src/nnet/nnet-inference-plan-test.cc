@@ -0,0 +1,219 @@
+// nnet/nnet-inference-plan-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nnet/nnet-inference-plan.h"
+#include "nnet/nnet-nnet.h"
+#include "nnet/nnet-quantized-affine-transform.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// Random parameters, so that folding the shifts and scales is tested
+static void AppendRandomComponent(const std::string &conf_line, Nnet *nnet) {
+  Component *comp = Component::Init(conf_line);
+  if (comp->IsUpdatable()) {
+    UpdatableComponent *upd = dynamic_cast<UpdatableComponent*>(comp);
+    Vector<BaseFloat> params(upd->NumParams());
+    params.SetRandn();
+    if (comp->GetType() == Component::kRescale ||
+        comp->GetType() == Component::kParametricRelu)
+      params.Add(2.0);
+    upd->SetParams(params);
+  }
+  nnet->AppendComponentPointer(comp);
+}
+
+static void CheckPlan(Nnet *nnet, int32 num_ops, int32 block_rows,
+                      BaseFloat tolerance = 1.0e-04) {
+  InferencePlan plan;
+  plan.Init(*nnet, block_rows);
+  KALDI_LOG << "Plan:\n" << plan.Info();
+  KALDI_ASSERT(plan.NumOps() == num_ops);
+  KALDI_ASSERT(plan.InputDim() == nnet->InputDim());
+  KALDI_ASSERT(plan.OutputDim() == nnet->OutputDim());
+  // a plan sharing the weights gives the same, with buffers of its own
+  InferencePlan shared;
+  shared.ShareParams(plan);
+  KALDI_ASSERT(shared.NumOps() == num_ops);
+  KALDI_ASSERT(shared.SharedParamsSizeInBytes() ==
+               plan.SharedParamsSizeInBytes());
+  // a plan written and read back gives the same, (in text with a tolerance)
+  InferencePlan read[2];
+  for (int32 binary = 0; binary < 2; binary++) {
+    std::ostringstream os;
+    plan.Write(os, binary == 1);
+    std::istringstream is(os.str());
+    KALDI_ASSERT(InferencePlan::IsPlan(is, binary == 1));
+    read[binary].Read(is, binary == 1);
+    KALDI_ASSERT(read[binary].NumOps() == num_ops);
+    KALDI_ASSERT(read[binary].InputDim() == nnet->InputDim());
+    KALDI_ASSERT(read[binary].OutputDim() == nnet->OutputDim());
+  }
+  // the same buffers are used by forward passes of different lengths
+  int32 num_rows[] = { 1, 3 * block_rows + 5, 2 * block_rows, 17 };
+  for (int32 i = 0; i < 4; i++) {
+    CuMatrix<BaseFloat> in(num_rows[i], nnet->InputDim()), ref, out,
+        shared_out;
+    in.SetRandn();
+    nnet->Feedforward(in, &ref);
+    plan.Feedforward(in, &out);
+    AssertEqual(ref, out, tolerance);
+    shared.Feedforward(in, &shared_out);
+    AssertEqual(out, shared_out);
+    CuMatrix<BaseFloat> text_out, binary_out;
+    read[0].Feedforward(in, &text_out);
+    AssertEqual(out, text_out, 1.0e-04);
+    read[1].Feedforward(in, &binary_out);
+    AssertEqual(out, binary_out, 0.0);
+  }
+  // sparse input goes into the first layer if it is affine, else it is made
+  // dense; the plan that was not prepared makes it dense
+  InferencePlan sparse;
+  sparse.Init(*nnet, block_rows);
+  sparse.PrepareSparseInput();
+  for (int32 i = 0; i < 4; i++) {
+    SparseMatrix<BaseFloat> smat(num_rows[i], nnet->InputDim());
+    smat.SetRandn(0.8);
+    CuSparseMatrix<BaseFloat> in(smat);
+    CuMatrix<BaseFloat> dense(num_rows[i], nnet->InputDim()), ref, out,
+        dense_out;
+    in.CopyToMat(&dense);
+    nnet->Feedforward(dense, &ref);
+    sparse.Feedforward(in, &out);
+    AssertEqual(ref, out, tolerance);
+    plan.Feedforward(in, &dense_out);
+    AssertEqual(ref, dense_out, tolerance);
+  }
+}
+
+void UnitTestInferencePlanFolding() {
+  Nnet nnet;
+  // cmvn and minmax style input transform, folded into the first affine
+  AppendRandomComponent("<AddShift> <InputDim> 8 <OutputDim> 8", &nnet);
+  AppendRandomComponent("<Rescale> <InputDim> 8 <OutputDim> 8", &nnet);
+  AppendRandomComponent("<AffineTransform> <InputDim> 8 <OutputDim> 16 "
+                        "<ParamStddev> 0.5", &nnet);
+  AppendRandomComponent("<Sigmoid> <InputDim> 16 <OutputDim> 16", &nnet);
+  AppendRandomComponent("<AffineTransform> <InputDim> 16 <OutputDim> 12 "
+                        "<ParamStddev> 0.5", &nnet);
+  AppendRandomComponent("<ParametricRelu> <InputDim> 12 <OutputDim> 12",
+                        &nnet);
+  // a scale after an activation is folded into the next linear transform
+  AppendRandomComponent("<Rescale> <InputDim> 12 <OutputDim> 12", &nnet);
+  AppendRandomComponent("<LinearTransform> <InputDim> 12 <OutputDim> 10 "
+                        "<ParamStddev> 0.5", &nnet);
+  AppendRandomComponent("<Tanh> <InputDim> 10 <OutputDim> 10", &nnet);
+  AppendRandomComponent("<AffineTransform> <InputDim> 10 <OutputDim> 6 "
+                        "<ParamStddev> 0.5", &nnet);
+  // un-normalisation of the output, folded into the last affine
+  AppendRandomComponent("<Rescale> <InputDim> 6 <OutputDim> 6", &nnet);
+  AppendRandomComponent("<AddShift> <InputDim> 6 <OutputDim> 6", &nnet);
+  CheckPlan(&nnet, 4, 64);
+  CheckPlan(&nnet, 4, 1);
+  InferencePlan plan;
+  plan.Init(nnet);
+  plan.PrepareSparseInput();
+  KALDI_ASSERT(plan.SparseInputPrepared());
+}
+
+void UnitTestInferencePlanComponents() {
+  Nnet nnet;
+  AppendRandomComponent("<Splice> <InputDim> 4 <OutputDim> 12 "
+                        "<BuildVector> -1:1 </BuildVector>\n", &nnet);
+  AppendRandomComponent("<AffineTransform> <InputDim> 12 <OutputDim> 8 "
+                        "<ParamStddev> 0.5", &nnet);
+  AppendRandomComponent("<Softmax> <InputDim> 8 <OutputDim> 8", &nnet);
+  AppendRandomComponent("<AddShift> <InputDim> 8 <OutputDim> 8", &nnet);
+  AppendRandomComponent("<AffineTransform> <InputDim> 8 <OutputDim> 5 "
+                        "<ParamStddev> 0.5", &nnet);
+  AppendRandomComponent("<Sigmoid> <InputDim> 5 <OutputDim> 5", &nnet);
+  AppendRandomComponent("<Softmax> <InputDim> 5 <OutputDim> 5", &nnet);
+  CheckPlan(&nnet, 5, 7);
+
+  // quantized weights are not folded into, the scale-shift before the
+  // second affine is an operation of its own
+  for (int32 m = 0; m < 2; m++) {
+    Nnet quantized(nnet);
+    KALDI_ASSERT(QuantizeAffineTransforms(m == 0 ? kInt8RowScale : kFloat16,
+                                          &quantized) == 2);
+    CheckPlan(&quantized, 6, 7, 1.0e-03);
+    // and it is near the unquantized network
+    CuMatrix<BaseFloat> in(20, nnet.InputDim()), ref, out;
+    in.SetRandn();
+    nnet.Feedforward(in, &ref);
+    quantized.Feedforward(in, &out);
+    AssertEqual(ref, out, 0.05);
+  }
+
+  // the weights outlive the plan they were shared from
+  InferencePlan shared;
+  {
+    InferencePlan plan;
+    plan.Init(nnet);
+    shared.ShareParams(plan);
+  }
+  CuMatrix<BaseFloat> feats(9, nnet.InputDim()), ref, shared_out;
+  feats.SetRandn();
+  nnet.Feedforward(feats, &ref);
+  shared.Feedforward(feats, &shared_out);
+  AssertEqual(ref, shared_out, 1.0e-04);
+
+  // an empty network copies its input
+  Nnet empty;
+  InferencePlan plan;
+  plan.Init(empty);
+  CuMatrix<BaseFloat> in(3, 4), out;
+  in.SetRandn();
+  plan.Feedforward(in, &out);
+  AssertEqual(in, out);
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+
+  for (kaldi::int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      // use no GPU,
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      // use GPU when available,
+      CuDevice::Instantiate().SelectGpuId("optional");
+#endif
+    UnitTestInferencePlanFolding();
+    UnitTestInferencePlanComponents();
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+  }
+#if HAVE_CUDA == 1
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  return 0;
+}
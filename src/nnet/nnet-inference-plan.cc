@@ -0,0 +1,543 @@
+// nnet/nnet-inference-plan.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <sstream>
+
+#include "cudamatrix/cu-device.h"
+#include "nnet/nnet-inference-plan.h"
+#include "nnet/nnet-affine-transform.h"
+#include "nnet/nnet-linear-transform.h"
+#include "nnet/nnet-quantized-affine-transform.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// A view of the top left rows x cols of buf, which only ever grows
+static CuSubMatrix<BaseFloat> BufferView(int32 rows, int32 cols,
+                                         CuMatrix<BaseFloat> *buf) {
+  if (buf->NumRows() < rows || buf->NumCols() < cols)
+    buf->Resize(std::max(rows, buf->NumRows()),
+                std::max(cols, buf->NumCols()), kUndefined);
+  return buf->Range(0, rows, 0, cols);
+}
+
+InferencePlan::~InferencePlan() {
+  Clear();
+}
+
+void InferencePlan::Clear() {
+  for (size_t i = 0; i < components_.size(); i++)
+    delete components_[i];
+  ops_.clear();
+  components_.clear();
+  outputs_.clear();
+  input_dim_ = output_dim_ = 0;
+}
+
+void InferencePlan::Init(const Nnet &nnet, int32 block_rows) {
+  KALDI_ASSERT(block_rows > 0);
+  Clear();
+  block_rows_ = block_rows;
+  if (nnet.NumComponents() == 0) return;
+  for (int32 c = 0; c < nnet.NumComponents(); c++)
+    AddComponent(nnet.GetComponent(c));
+  input_dim_ = nnet.InputDim();
+  output_dim_ = nnet.OutputDim();
+  KALDI_VLOG(1) << "Compiled " << nnet.NumComponents() << " components into "
+                << ops_.size() << " operations";
+}
+
+void InferencePlan::ShareParams(const InferencePlan &other) {
+  if (&other == this) return;
+  Clear();
+  block_rows_ = other.block_rows_;
+  input_dim_ = other.input_dim_;
+  output_dim_ = other.output_dim_;
+  ops_ = other.ops_;
+  components_.resize(ops_.size(), NULL);
+  outputs_.resize(ops_.size());
+  for (size_t i = 0; i < ops_.size(); i++)
+    if (other.components_[i] != NULL)
+      components_[i] = other.components_[i]->Copy();
+}
+
+size_t InferencePlan::SharedParamsSizeInBytes() const {
+  size_t size = 0;
+  for (size_t i = 0; i < ops_.size(); i++) {
+    const Op &op = *ops_[i];
+    size += op.qlinearity.SizeInBytes() + sizeof(BaseFloat) *
+        (op.linearity.NumRows() * op.linearity.NumCols() + op.bias.Dim() +
+         op.linearity_trans.NumRows() * op.linearity_trans.NumCols() +
+         op.scale.Dim() + op.alpha.Dim() + op.beta.Dim());
+  }
+  return size;
+}
+
+void InferencePlan::AddOp(Op *op, Component *component) {
+  ops_.push_back(std::shared_ptr<Op>(op));
+  components_.push_back(component);
+  outputs_.resize(ops_.size());
+}
+
+void InferencePlan::AddComponent(const Component &comp) {
+  Op *last = ops_.empty() ? NULL : ops_.back().get();
+  Component::ComponentType type = comp.GetType();
+
+  if (type == Component::kAffineTransform ||
+      type == Component::kLinearTransform ||
+      type == Component::kQuantizedAffineTransform) {
+    Op *op = new Op;
+    op->type = kAffineOp;
+    op->input_dim = comp.InputDim();
+    op->output_dim = comp.OutputDim();
+    if (type == Component::kAffineTransform) {
+      const AffineTransform &aff = dynamic_cast<const AffineTransform&>(comp);
+      op->linearity = aff.GetLinearity();
+      op->bias = aff.GetBias();
+    } else if (type == Component::kLinearTransform) {
+      const LinearTransform &lin = dynamic_cast<const LinearTransform&>(comp);
+      op->linearity = lin.GetLinearity();
+      op->bias.Resize(op->output_dim, kSetZero);
+    } else {
+      const QuantizedAffineTransform &quant =
+          dynamic_cast<const QuantizedAffineTransform&>(comp);
+      op->bias = quant.GetBias();
+      bool expand = false;
+#if HAVE_CUDA == 1
+      // there is no GPU kernel for the quantized weights
+      expand = CuDevice::Instantiate().Enabled();
+#endif
+      if (expand) {
+        Matrix<BaseFloat> linearity(op->output_dim, op->input_dim);
+        quant.GetLinearity().CopyToMat(&linearity);
+        op->linearity = linearity;
+      } else {
+        op->qlinearity = quant.GetLinearity();
+        op->quantized = true;
+      }
+    }
+    // the quantized weights cannot be rescaled by column
+    if (last != NULL && last->type == kScaleShiftOp && !op->quantized) {
+      // (x .* s + t) W^T + b = x (W diag(s))^T + (W t + b)
+      op->bias.AddMatVec(1.0, op->linearity, kNoTrans, last->bias, 1.0);
+      op->linearity.MulColsVec(last->scale);
+      ops_.back().reset(op);
+    } else {
+      AddOp(op);
+    }
+    return;
+  }
+
+  if (type == Component::kAddShift || type == Component::kRescale) {
+    const UpdatableComponent &upd =
+        dynamic_cast<const UpdatableComponent&>(comp);
+    Vector<BaseFloat> params(upd.NumParams());
+    upd.GetParams(&params);
+    CuVector<BaseFloat> scale(comp.OutputDim()), shift(comp.OutputDim());
+    if (type == Component::kAddShift) {
+      scale.Set(1.0);
+      shift.CopyFromVec(params);
+    } else {
+      scale.CopyFromVec(params);
+    }
+    if (last != NULL && last->type == kScaleShiftOp) {
+      // (x .* s1 + t1) .* s2 + t2
+      last->scale.MulElements(scale);
+      last->bias.MulElements(scale);
+      last->bias.AddVec(1.0, shift);
+    } else if (last != NULL && last->type == kAffineOp &&
+               last->activation == kNoActivation && !last->quantized) {
+      // (x W^T + b) .* s + t = x (diag(s) W)^T + (b .* s + t)
+      last->linearity.MulRowsVec(scale);
+      last->bias.MulElements(scale);
+      last->bias.AddVec(1.0, shift);
+    } else {
+      Op *op = new Op;
+      op->type = kScaleShiftOp;
+      op->input_dim = op->output_dim = comp.OutputDim();
+      op->scale.Swap(&scale);
+      op->bias.Swap(&shift);
+      AddOp(op);
+    }
+    return;
+  }
+
+  if ((type == Component::kSigmoid || type == Component::kTanh ||
+       type == Component::kParametricRelu) &&
+      last != NULL && last->type == kAffineOp &&
+      last->activation == kNoActivation) {
+    if (type == Component::kSigmoid) {
+      last->activation = kSigmoidActivation;
+    } else if (type == Component::kTanh) {
+      last->activation = kTanhActivation;
+    } else {
+      // the parameters are alpha then beta
+      const UpdatableComponent &upd =
+          dynamic_cast<const UpdatableComponent&>(comp);
+      Vector<BaseFloat> params(upd.NumParams());
+      upd.GetParams(&params);
+      int32 dim = comp.OutputDim();
+      KALDI_ASSERT(params.Dim() == 2 * dim);
+      last->alpha = params.Range(0, dim);
+      last->beta = params.Range(dim, dim);
+      last->activation = kParametricReluActivation;
+    }
+    return;
+  }
+
+  Op *op = new Op;
+  op->type = kComponentOp;
+  op->input_dim = comp.InputDim();
+  op->output_dim = comp.OutputDim();
+  AddOp(op, comp.Copy());
+}
+
+void InferencePlan::RunOp(const Op &op, const CuMatrixBase<BaseFloat> &in,
+                          CuMatrixBase<BaseFloat> *out) const {
+  if (op.type == kScaleShiftOp) {
+    if (out->Data() != in.Data()) out->CopyFromMat(in);
+    out->MulColsVec(op.scale);
+    out->AddVecToRows(1.0, op.bias, 1.0);
+    return;
+  }
+  KALDI_ASSERT(op.type == kAffineOp);
+  out->AddVecToRows(1.0, op.bias, 0.0);
+  if (op.quantized)  // only on the CPU
+    op.qlinearity.AddMatMatTrans<BaseFloat>(1.0, in.Mat(), 1.0, &out->Mat());
+  else
+    out->AddMatMat(1.0, in, kNoTrans, op.linearity, kTrans, 1.0);
+  RunActivation(op, out);
+}
+
+void InferencePlan::RunActivation(const Op &op,
+                                  CuMatrixBase<BaseFloat> *out) const {
+  // elementwise, so in place while the output is still in cache
+  switch (op.activation) {
+    case kSigmoidActivation: out->Sigmoid(*out); break;
+    case kTanhActivation: out->Tanh(*out); break;
+    case kParametricReluActivation:
+      out->ParametricRelu(*out, op.alpha, op.beta);
+      break;
+    default: break;
+  }
+}
+
+void InferencePlan::RunFused(int32 begin, int32 end,
+                             const CuMatrixBase<BaseFloat> &in,
+                             CuMatrixBase<BaseFloat> *out) {
+  int32 num_rows = in.NumRows(), block_rows = block_rows_;
+#if HAVE_CUDA == 1
+  // the GPU is better off with as many rows as it can get
+  if (CuDevice::Instantiate().Enabled()) block_rows = num_rows;
+#endif
+  for (int32 r = 0; r < num_rows; r += block_rows) {
+    int32 n = std::min(block_rows, num_rows - r);
+    for (int32 i = begin; i < end; i++) {
+      // the input is the block of in, or the buffer written by the last op
+      CuSubMatrix<BaseFloat> src(i == begin ? in.RowRange(r, n) :
+          BufferView(n, ops_[i - 1]->output_dim,
+                     &block_buf_[(i - begin - 1) % 2]));
+      CuSubMatrix<BaseFloat> dst(i + 1 == end ? out->RowRange(r, n) :
+          BufferView(n, ops_[i]->output_dim, &block_buf_[(i - begin) % 2]));
+      RunOp(*ops_[i], src, &dst);
+    }
+  }
+}
+
+void InferencePlan::Feedforward(const CuMatrixBase<BaseFloat> &in,
+                                CuMatrix<BaseFloat> *out) {
+  KALDI_ASSERT(NULL != out);
+  if (ops_.empty()) {
+    (*out) = in;
+    return;
+  }
+  if (in.NumCols() != input_dim_)
+    KALDI_ERR << "Non-matching dims on the input of the nnet, the input-dim is "
+              << input_dim_ << ", the data had " << in.NumCols() << " dims.";
+  if (in.NumRows() == 0) {
+    out->Resize(0, 0);
+    return;
+  }
+  KALDI_ASSERT(in.Data() != out->Data());
+  RunFrom(0, in, out);
+}
+
+void InferencePlan::Feedforward(const CuSparseMatrix<BaseFloat> &in,
+                                CuMatrix<BaseFloat> *out) {
+  KALDI_ASSERT(NULL != out);
+  if (!SparseInputPrepared()) {
+    CuMatrix<BaseFloat> dense(in.NumRows(), in.NumCols(), kUndefined);
+    in.CopyToMat(&dense);
+    Feedforward(dense, out);
+    return;
+  }
+  if (in.NumCols() != input_dim_)
+    KALDI_ERR << "Non-matching dims on the input of the nnet, the input-dim is "
+              << input_dim_ << ", the data had " << in.NumCols() << " dims.";
+  int32 num_rows = in.NumRows(), num_ops = ops_.size();
+  if (num_rows == 0) {
+    out->Resize(0, 0);
+    return;
+  }
+  const Op &op = *ops_[0];
+  if (num_ops == 1)
+    out->Resize(num_rows, op.output_dim, kUndefined);
+  CuSubMatrix<BaseFloat> first_out(num_ops == 1 ? out->RowRange(0, num_rows) :
+      BufferView(num_rows, op.output_dim, &sparse_buf_));
+  // each row is the bias plus the rows of linearity^T of its nonzero
+  // elements, scaled by them
+  first_out.AddVecToRows(1.0, op.bias, 0.0);
+  first_out.AddSmatMat(1.0, in, kNoTrans, op.linearity_trans, 1.0);
+  RunActivation(op, &first_out);
+  if (num_ops > 1)
+    RunFrom(1, first_out, out);
+}
+
+void InferencePlan::PrepareSparseInput() {
+  if (ops_.empty() || ops_[0]->type != kAffineOp || ops_[0]->quantized)
+    return;
+  Op &op = *ops_[0];
+  op.linearity_trans.Resize(op.input_dim, op.output_dim, kUndefined);
+  op.linearity_trans.CopyFromMat(op.linearity, kTrans);
+}
+
+void InferencePlan::RunFrom(int32 first, const CuMatrixBase<BaseFloat> &in,
+                            CuMatrix<BaseFloat> *out) {
+  int32 num_rows = in.NumRows(), num_ops = ops_.size();
+  for (int32 begin = first, stage = 0; begin < num_ops; stage++) {
+    // the input is in, or what the stage before wrote
+    const Op *prev = begin == first ? NULL : ops_[begin - 1].get();
+    CuSubMatrix<BaseFloat> src(prev == NULL ? in.RowRange(0, num_rows) :
+        prev->type == kComponentOp ?
+        outputs_[begin - 1].RowRange(0, num_rows) :
+        BufferView(num_rows, prev->output_dim, &stage_buf_[(stage - 1) % 2]));
+    int32 end = begin + 1;
+    if (ops_[begin]->type == kComponentOp) {
+      components_[begin]->Propagate(src,
+          end == num_ops ? out : &outputs_[begin]);
+    } else {
+      while (end < num_ops && ops_[end]->type != kComponentOp) end++;
+      int32 dim = ops_[end - 1]->output_dim;
+      if (end == num_ops) {
+        out->Resize(num_rows, dim, kUndefined);
+        RunFused(begin, end, src, out);
+      } else {
+        CuSubMatrix<BaseFloat> dst(
+            BufferView(num_rows, dim, &stage_buf_[stage % 2]));
+        RunFused(begin, end, src, &dst);
+      }
+    }
+    begin = end;
+  }
+}
+
+static const char *ActivationToken(int32 activation) {
+  static const char *tokens[] = { "<None>", "<Sigmoid>", "<Tanh>",
+                                  "<ParametricRelu>" };
+  KALDI_ASSERT(activation >= 0 && activation < 4);
+  return tokens[activation];
+}
+
+void InferencePlan::WriteOp(const Op &op, const Component *component,
+                            std::ostream &os, bool binary) const {
+  if (op.type == kComponentOp) {
+    WriteToken(os, binary, "<ComponentOp>");
+    component->Write(os, binary);
+    return;
+  }
+  if (op.type == kScaleShiftOp) {
+    WriteToken(os, binary, "<ScaleShiftOp>");
+    WriteBasicType(os, binary, op.output_dim);
+    op.scale.Write(os, binary);
+    op.bias.Write(os, binary);
+    return;
+  }
+  WriteToken(os, binary, "<AffineOp>");
+  WriteBasicType(os, binary, op.input_dim);
+  WriteBasicType(os, binary, op.output_dim);
+  WriteToken(os, binary, ActivationToken(op.activation));
+  if (op.activation == kParametricReluActivation) {
+    op.alpha.Write(os, binary);
+    op.beta.Write(os, binary);
+  }
+  if (op.quantized) {
+    WriteToken(os, binary, "<Quantized>");
+    op.qlinearity.Write(os, binary);
+  } else {
+    WriteToken(os, binary, "<Linearity>");
+    op.linearity.Write(os, binary);
+  }
+  op.bias.Write(os, binary);
+}
+
+void InferencePlan::ReadOp(std::istream &is, bool binary) {
+  std::string token;
+  ReadToken(is, binary, &token);
+  if (token == "<ComponentOp>") {
+    Component *comp = Component::Read(is, binary);
+    if (comp == NULL) KALDI_ERR << "Missing the component of an operation";
+    Op *op = new Op;
+    op->input_dim = comp->InputDim();
+    op->output_dim = comp->OutputDim();
+    AddOp(op, comp);
+    return;
+  }
+  Op *op = new Op;
+  AddOp(op);
+  if (token == "<ScaleShiftOp>") {
+    op->type = kScaleShiftOp;
+    ReadBasicType(is, binary, &op->output_dim);
+    op->input_dim = op->output_dim;
+    op->scale.Read(is, binary);
+    op->bias.Read(is, binary);
+    KALDI_ASSERT(op->scale.Dim() == op->output_dim &&
+                 op->bias.Dim() == op->output_dim);
+    return;
+  }
+  if (token != "<AffineOp>")
+    KALDI_ERR << "Expected an operation of a plan, got " << token;
+  op->type = kAffineOp;
+  ReadBasicType(is, binary, &op->input_dim);
+  ReadBasicType(is, binary, &op->output_dim);
+  ReadToken(is, binary, &token);
+  for (int32 a = 0; a < 4; a++)
+    if (token == ActivationToken(a))
+      op->activation = static_cast<Activation>(a);
+  if (token != ActivationToken(op->activation))
+    KALDI_ERR << "Unknown activation " << token;
+  if (op->activation == kParametricReluActivation) {
+    op->alpha.Read(is, binary);
+    op->beta.Read(is, binary);
+  }
+  ReadToken(is, binary, &token);
+  if (token == "<Quantized>") {
+    op->qlinearity.Read(is, binary);
+    op->quantized = true;
+#if HAVE_CUDA == 1
+    // there is no GPU kernel for the quantized weights
+    if (CuDevice::Instantiate().Enabled()) {
+      Matrix<BaseFloat> linearity(op->qlinearity.NumRows(),
+                                  op->qlinearity.NumCols());
+      op->qlinearity.CopyToMat(&linearity);
+      op->linearity = linearity;
+      op->qlinearity.Clear();
+      op->quantized = false;
+    }
+#endif
+  } else if (token == "<Linearity>") {
+    op->linearity.Read(is, binary);
+  } else {
+    KALDI_ERR << "Expected <Linearity> or <Quantized>, got " << token;
+  }
+  op->bias.Read(is, binary);
+  int32 rows = op->quantized ? op->qlinearity.NumRows() :
+      op->linearity.NumRows(),
+      cols = op->quantized ? op->qlinearity.NumCols() :
+      op->linearity.NumCols();
+  KALDI_ASSERT(rows == op->output_dim && cols == op->input_dim &&
+               op->bias.Dim() == op->output_dim);
+}
+
+void InferencePlan::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<InferencePlan>");
+  WriteToken(os, binary, "<BlockRows>");
+  WriteBasicType(os, binary, block_rows_);
+  WriteToken(os, binary, "<NumOps>");
+  WriteBasicType(os, binary, static_cast<int32>(ops_.size()));
+  if (!binary) os << "\n";
+  for (size_t i = 0; i < ops_.size(); i++) {
+    WriteOp(*ops_[i], components_[i], os, binary);
+    if (!binary) os << "\n";
+  }
+  WriteToken(os, binary, "</InferencePlan>");
+  if (!binary) os << "\n";
+  if (os.fail())
+    KALDI_ERR << "Error writing the inference plan";
+}
+
+void InferencePlan::Write(const std::string &wxfilename, bool binary) const {
+  Output out(wxfilename, binary, true);
+  Write(out.Stream(), binary);
+  out.Close();
+}
+
+void InferencePlan::Read(std::istream &is, bool binary) {
+  Clear();
+  int32 num_ops = 0;
+  ExpectToken(is, binary, "<InferencePlan>");
+  ExpectToken(is, binary, "<BlockRows>");
+  ReadBasicType(is, binary, &block_rows_);
+  ExpectToken(is, binary, "<NumOps>");
+  ReadBasicType(is, binary, &num_ops);
+  KALDI_ASSERT(block_rows_ > 0 && num_ops >= 0);
+  for (int32 i = 0; i < num_ops; i++) {
+    ReadOp(is, binary);
+    if (i > 0 && ops_[i]->input_dim != ops_[i - 1]->output_dim)
+      KALDI_ERR << "Operation " << (i + 1) << " has input-dim "
+                << ops_[i]->input_dim << ", the one before output-dim "
+                << ops_[i - 1]->output_dim;
+  }
+  ExpectToken(is, binary, "</InferencePlan>");
+  if (num_ops > 0) {
+    input_dim_ = ops_.front()->input_dim;
+    output_dim_ = ops_.back()->output_dim;
+  }
+}
+
+void InferencePlan::Read(const std::string &rxfilename) {
+  bool binary;
+  Input in(rxfilename, &binary);
+  Read(in.Stream(), binary);
+  in.Close();
+}
+
+bool InferencePlan::IsPlan(std::istream &is, bool binary) {
+  // the first character of the token, after the '<',
+  return PeekToken(is, binary) == 'I';
+}
+
+std::string InferencePlan::Info() const {
+  std::ostringstream os;
+  for (size_t i = 0; i < ops_.size(); i++) {
+    const Op &op = *ops_[i];
+    os << "op " << (i + 1) << ": ";
+    if (op.type == kComponentOp) {
+      os << Component::TypeToMarker(components_[i]->GetType());
+    } else if (op.type == kScaleShiftOp) {
+      os << "scale-shift";
+    } else {
+      os << (op.quantized ? "quantized affine" : "affine");
+      if (op.linearity_trans.NumRows() > 0) os << " (sparse input)";
+      switch (op.activation) {
+        case kSigmoidActivation: os << " + sigmoid"; break;
+        case kTanhActivation: os << " + tanh"; break;
+        case kParametricReluActivation: os << " + parametric-relu"; break;
+        default: break;
+      }
+    }
+    os << ", input-dim " << op.input_dim << ", output-dim " << op.output_dim
+       << "\n";
+  }
+  return os.str();
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
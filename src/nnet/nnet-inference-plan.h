@@ -0,0 +1,184 @@
+// nnet/nnet-inference-plan.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET_NNET_INFERENCE_PLAN_H_
+#define KALDI_NNET_NNET_INFERENCE_PLAN_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-sparse-matrix.h"
+#include "cudamatrix/cu-vector.h"
+#include "matrix/quantized-matrix.h"
+#include "nnet/nnet-component.h"
+#include "nnet/nnet-nnet.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * An inference only form of a Nnet, giving the same output as
+ * Nnet::Feedforward with fewer passes over memory.
+ *
+ * When the plan is compiled:
+ *  - <AddShift> and <Rescale> (as written by cmvn-to-nnet and
+ *    minmax-to-nnet) are folded into the weights and bias of the
+ *    <AffineTransform> or <LinearTransform> next to them,
+ *  - <Sigmoid>, <Tanh> and <ParametricRelu> after an affine transform are
+ *    applied in place on its output,
+ *  - the bias is added by the GEMM, as AffineTransform does,
+ *  - <QuantizedAffineTransform> keeps its weights quantized on the CPU, and
+ *    is not folded into.
+ * Any other component is run as it is, whole-matrix.
+ *
+ * On the CPU consecutive fused layers are run on blocks of rows, so each
+ * block goes through all of them while it is in cache. Buffers are kept
+ * between calls and only grow, so forward passes of at most the same
+ * number of rows allocate nothing. Not thread safe, one plan per thread:
+ * the plans of the threads can share the weights of one (ShareParams).
+ *
+ * A compiled plan can be written (nnet-pack) and read back, which loads the
+ * folded weights as they are used, without reading the Nnet and compiling
+ * it again.
+ *
+ * Input that is mostly zeros, such as the one-hot linguistic features of the
+ * TTS networks, can be given as a sparse matrix: after PrepareSparseInput the
+ * first affine layer sums the rows of its transposed weights selected by the
+ * nonzero elements of each frame, instead of a dense GEMM over all the
+ * columns.
+ */
+class InferencePlan {
+ public:
+  InferencePlan() : block_rows_(256), input_dim_(0), output_dim_(0) { }
+  ~InferencePlan();
+
+  /// Compiles nnet; the plan copies what it needs and does not refer to
+  /// nnet afterwards. block_rows is the number of rows the CPU runs through
+  /// the fused layers at a time.
+  void Init(const Nnet &nnet, int32 block_rows = 256);
+
+  /// Makes this the plan of other, sharing the weights of its fused layers,
+  /// which are not changed after Init, so they are held once however many
+  /// plans there are. The buffers, and the components run as they are
+  /// (which keep buffers of their own), are this plan's.
+  void ShareParams(const InferencePlan &other);
+
+  /// Writes the compiled plan: the weights of the fused layers as they are
+  /// multiplied by, and the components run as they are
+  void Write(std::ostream &os, bool binary) const;
+  void Write(const std::string &wxfilename, bool binary) const;
+  /// Reads a plan written by Write, in place of Init
+  void Read(std::istream &is, bool binary);
+  void Read(const std::string &rxfilename);
+  /// True if the next object in is a plan, rather than e.g. a Nnet
+  static bool IsPlan(std::istream &is, bool binary);
+
+  /// Same as Nnet::Feedforward, in and out must not be the same matrix
+  void Feedforward(const CuMatrixBase<BaseFloat> &in,
+                   CuMatrix<BaseFloat> *out);
+  /// The same for sparse input; without PrepareSparseInput it is made dense
+  void Feedforward(const CuSparseMatrix<BaseFloat> &in,
+                   CuMatrix<BaseFloat> *out);
+
+  /// Keeps a transposed copy of the weights of the first operation, if it is
+  /// an unquantized affine one, for the sparse Feedforward. Call it after
+  /// Init or Read and before ShareParams, which shares the copy too.
+  void PrepareSparseInput();
+  /// True if the sparse Feedforward goes straight into the first layer
+  bool SparseInputPrepared() const {
+    return !ops_.empty() && ops_[0]->linearity_trans.NumRows() > 0;
+  }
+
+  int32 InputDim() const { return input_dim_; }
+  int32 OutputDim() const { return output_dim_; }
+  int32 NumOps() const { return ops_.size(); }
+  /// The memory of the weights of the fused layers, that are shared
+  size_t SharedParamsSizeInBytes() const;
+  /// One line per operation, for logging
+  std::string Info() const;
+
+ private:
+  enum OpType { kAffineOp, kScaleShiftOp, kComponentOp };
+  enum Activation { kNoActivation, kSigmoidActivation, kTanhActivation,
+                    kParametricReluActivation };
+  struct Op {
+    Op() : type(kComponentOp), activation(kNoActivation), quantized(false),
+           input_dim(0), output_dim(0) { }
+    OpType type;
+    Activation activation;  // applied in place after a kAffineOp
+    // kAffineOp: out = in * linearity^T + bias
+    // kScaleShiftOp: out = in .* scale + bias
+    CuMatrix<BaseFloat> linearity;
+    // linearity^T, of the first op after PrepareSparseInput
+    CuMatrix<BaseFloat> linearity_trans;
+    bool quantized;  // the linearity is qlinearity, on the CPU
+    QuantizedMatrix qlinearity;
+    CuVector<BaseFloat> bias;
+    CuVector<BaseFloat> scale;
+    CuVector<BaseFloat> alpha, beta;  // of kParametricReluActivation
+    int32 input_dim, output_dim;
+  };
+
+  void Clear();
+  void WriteOp(const Op &op, const Component *component, std::ostream &os,
+               bool binary) const;
+  void ReadOp(std::istream &is, bool binary);
+  // Adds a component to the end of the plan, folding it into the last
+  // operation when it can
+  void AddComponent(const Component &comp);
+  void AddOp(Op *op, Component *component = NULL);
+  // Runs ops [begin, end), which are all fused, on in; in and out must not
+  // overlap
+  void RunFused(int32 begin, int32 end, const CuMatrixBase<BaseFloat> &in,
+                CuMatrixBase<BaseFloat> *out);
+  // Runs one fused op from in to out, which may be the same for
+  // kScaleShiftOp
+  void RunOp(const Op &op, const CuMatrixBase<BaseFloat> &in,
+             CuMatrixBase<BaseFloat> *out) const;
+  // The activation of a kAffineOp, in place
+  void RunActivation(const Op &op, CuMatrixBase<BaseFloat> *out) const;
+  // Runs the ops from first to the end on in, the input of op first
+  void RunFrom(int32 first, const CuMatrixBase<BaseFloat> &in,
+               CuMatrix<BaseFloat> *out);
+
+  // shared between the plans of ShareParams, only changed by Init
+  std::vector<std::shared_ptr<Op> > ops_;
+  // this plan's copy of the component of each kComponentOp (NULL for the
+  // fused ops), and its output when it is not the last op
+  std::vector<Component*> components_;
+  std::vector<CuMatrix<BaseFloat> > outputs_;
+  int32 block_rows_;
+  int32 input_dim_, output_dim_;
+  // ping-pong buffers of the fused layers, and between the stages of fused
+  // layers
+  CuMatrix<BaseFloat> block_buf_[2];
+  CuMatrix<BaseFloat> stage_buf_[2];
+  // the output of the first layer for sparse input
+  CuMatrix<BaseFloat> sparse_buf_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(InferencePlan);
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+#endif  // KALDI_NNET_NNET_INFERENCE_PLAN_H_
@@ -0,0 +1,181 @@
+// nnet/nnet-length-bucketer-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <vector>
+
+#include "nnet/nnet-length-bucketer.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// An item is its index and length,
+typedef std::pair<int32, int32> TestItem;
+
+// Lengths spread like TTS spurts (0.3s to 15s at 200 frames/s),
+static std::vector<int32> RandomLengths(int32 num_items) {
+  std::vector<int32> lengths(num_items);
+  for (int32 i = 0; i < num_items; i++)
+    lengths[i] = RandInt(60, 3000);
+  return lengths;
+}
+
+// Padding efficiency of groups of 'num_streams' in archive order,
+static double ArchiveOrderEfficiency(const std::vector<int32> &lengths,
+                                     int32 num_streams) {
+  StreamPaddingStats stats;
+  for (size_t i = 0; i < lengths.size(); i += num_streams) {
+    std::vector<int32> group(lengths.begin() + i,
+        lengths.begin() + std::min(lengths.size(), i + num_streams));
+    stats.Add(group, *std::max_element(group.begin(), group.end()));
+  }
+  return stats.Efficiency();
+}
+
+// Every item comes once, groups keep to the limits, and they waste less on
+// padding than the archive order
+void UnitTestLengthBucketerGroups() {
+  int32 num_items = 2000, num_streams = 16;
+  int64 max_frames = 20000;
+  std::vector<int32> lengths = RandomLengths(num_items);
+  LengthBucketerOptions opts;
+  opts.bucket_window = 200;
+  LengthBucketer<TestItem> bucketer(opts);
+  StreamPaddingStats stats;
+  std::vector<int32> taken;
+  int32 next = 0;
+  while (true) {
+    for (; next < num_items && !bucketer.Full(); next++)
+      bucketer.Add(new TestItem(next, lengths[next]), lengths[next]);
+    if (bucketer.Empty()) break;
+    std::vector<TestItem*> group;
+    bucketer.TakeGroup(num_streams, max_frames, &group);
+    KALDI_ASSERT(!group.empty() && group.size() <= num_streams);
+    std::vector<int32> frame_num_utt;
+    for (size_t i = 0; i < group.size(); i++) {
+      KALDI_ASSERT(group[i]->second == lengths[group[i]->first]);
+      taken.push_back(group[i]->first);
+      frame_num_utt.push_back(group[i]->second);
+      delete group[i];
+    }
+    int32 longest = *std::max_element(frame_num_utt.begin(),
+                                      frame_num_utt.end());
+    KALDI_ASSERT(group.size() == 1 || longest * group.size() <= max_frames);
+    stats.Add(frame_num_utt, longest);
+  }
+  KALDI_ASSERT(taken.size() == num_items);
+  std::vector<int32> sorted(taken);
+  std::sort(sorted.begin(), sorted.end());
+  for (int32 i = 0; i < num_items; i++)
+    KALDI_ASSERT(sorted[i] == i);
+  // (the batches are shuffled)
+  KALDI_ASSERT(sorted != taken);
+  KALDI_LOG << "Bucketed: " << stats.Report() << "; archive order "
+            << 100.0 * ArchiveOrderEfficiency(lengths, num_streams) << "%";
+  KALDI_ASSERT(stats.Efficiency() > 0.9);
+  KALDI_ASSERT(stats.Efficiency() > ArchiveOrderEfficiency(lengths,
+                                                           num_streams));
+}
+
+// TakeNearest takes the nearest length, and with a window of one the
+// archive order
+void UnitTestLengthBucketerNearest() {
+  LengthBucketerOptions opts;
+  opts.bucket_width = 10;
+  {
+    LengthBucketer<TestItem> bucketer(opts);
+    int32 lengths[] = { 5, 100, 250, 251, 1000 };
+    for (int32 i = 0; i < 5; i++)
+      bucketer.Add(new TestItem(i, lengths[i]), lengths[i]);
+    TestItem *item = bucketer.TakeNearest(180);  // 250 is nearer than 100,
+    KALDI_ASSERT(item->second == 250 || item->second == 251);
+    delete item;
+    item = bucketer.TakeNearest(2000);
+    KALDI_ASSERT(item->second == 1000);
+    delete item;
+    item = bucketer.TakeNearest(0);
+    KALDI_ASSERT(item->second == 5);
+    delete item;
+    item = bucketer.TakeNearest(120);
+    KALDI_ASSERT(item->second == 100);
+    delete item;
+    KALDI_ASSERT(bucketer.NumItems() == 1);
+    // the destructor deletes the last one,
+  }
+  {
+    opts.bucket_window = 1;
+    LengthBucketer<TestItem> bucketer(opts);
+    for (int32 i = 0; i < 50; i++) {
+      int32 length = RandInt(1, 500);
+      bucketer.Add(new TestItem(i, length), length);
+      KALDI_ASSERT(bucketer.Full());
+      TestItem *item = bucketer.TakeNearest(RandInt(-1, 500));
+      KALDI_ASSERT(item->first == i && bucketer.Empty());
+      delete item;
+    }
+  }
+}
+
+// The same seed gives the same groups
+void UnitTestLengthBucketerSeed() {
+  std::vector<int32> lengths = RandomLengths(300);
+  std::vector<int32> order[2];
+  for (int32 n = 0; n < 2; n++) {
+    LengthBucketerOptions opts;
+    LengthBucketer<TestItem> bucketer(opts);
+    for (size_t i = 0; i < lengths.size(); i++)
+      bucketer.Add(new TestItem(i, lengths[i]), lengths[i]);
+    while (!bucketer.Empty()) {
+      std::vector<TestItem*> group;
+      bucketer.TakeGroup(8, 10000, &group);
+      for (size_t i = 0; i < group.size(); i++) {
+        order[n].push_back(group[i]->first);
+        delete group[i];
+      }
+    }
+  }
+  KALDI_ASSERT(order[0] == order[1]);
+}
+
+void UnitTestStreamPaddingStats() {
+  StreamPaddingStats stats;
+  KALDI_ASSERT(stats.Efficiency() == 1.0);
+  std::vector<int32> frame_num_utt;
+  frame_num_utt.push_back(10);
+  frame_num_utt.push_back(5);
+  frame_num_utt.push_back(0);  // an idle stream,
+  stats.Add(frame_num_utt, 10);
+  KALDI_ASSERT(stats.num_batches == 1 && stats.num_frames == 15 &&
+               stats.num_slots == 30);
+  KALDI_ASSERT(ApproxEqual(stats.Efficiency(), 0.5));
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+  UnitTestLengthBucketerGroups();
+  UnitTestLengthBucketerNearest();
+  UnitTestLengthBucketerSeed();
+  UnitTestStreamPaddingStats();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,259 @@
+// nnet/nnet-length-bucketer.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET_NNET_LENGTH_BUCKETER_H_
+#define KALDI_NNET_NNET_LENGTH_BUCKETER_H_
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+struct LengthBucketerOptions {
+  int32 bucket_window;
+  int32 bucket_width;
+  int32 bucket_seed;
+
+  LengthBucketerOptions():
+    bucket_window(1000),
+    bucket_width(10),
+    bucket_seed(777)
+  { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("bucket-window", &bucket_window,
+       "Number of utterances read ahead and grouped by length, so the "
+       "streams of a batch have similar lengths (and finish together); "
+       "1 keeps the archive order. Holds this many utterances in memory.");
+    opts->Register("bucket-width", &bucket_width,
+       "Width of the length buckets (frames), utterances within a bucket "
+       "are taken in random order");
+    opts->Register("bucket-seed", &bucket_seed,
+       "Seed of the random choice of buckets and utterances");
+  }
+};
+
+
+/**
+ * A window of utterances (or any Item) sorted into buckets by length,
+ * for the multi-stream trainers: the streams of a batch are padded to the
+ * longest one, so the less their lengths differ the less time goes on
+ * padding. Items are owned by the bucketer until they are taken.
+ *
+ * The buckets are chosen at random, weighted by the frames in them, so
+ * the batches still come in a shuffled order (within the window).
+ * With a window of one item the items come in the order they were added.
+ */
+template<class Item>
+class LengthBucketer {
+ public:
+  explicit LengthBucketer(const LengthBucketerOptions &opts)
+      : opts_(opts), num_items_(0), num_frames_(0) {
+    KALDI_ASSERT(opts.bucket_window > 0 && opts.bucket_width > 0);
+    rand_state_.seed = opts.bucket_seed;
+  }
+
+  ~LengthBucketer() {
+    typename BucketMap::iterator it;
+    for (it = buckets_.begin(); it != buckets_.end(); ++it)
+      for (size_t i = 0; i < it->second.items.size(); i++)
+        delete it->second.items[i].first;
+  }
+
+  /// Adds an item of 'length' frames, the bucketer takes ownership.
+  void Add(Item *item, int32 length) {
+    KALDI_ASSERT(item != NULL && length >= 0);
+    Bucket &bucket = buckets_[length / opts_.bucket_width];
+    bucket.items.push_back(std::make_pair(item, length));
+    bucket.frames += length;
+    num_items_++;
+    num_frames_ += length;
+  }
+
+  /// True once the window holds 'bucket_window' items.
+  bool Full() const { return num_items_ >= opts_.bucket_window; }
+  bool Empty() const { return num_items_ == 0; }
+  int32 NumItems() const { return num_items_; }
+
+  /// Takes a group of similar length for per-utterance training: at least
+  /// one item, at most 'max_items', and (past the first) only as many as
+  /// fit 'max_frames' once padded to the longest. The caller owns them.
+  void TakeGroup(int32 max_items, int64 max_frames, std::vector<Item*> *items) {
+    KALDI_ASSERT(!Empty() && max_items > 0);
+    items->clear();
+    typename BucketMap::iterator first = PickBucket();
+    int32 longest = 0;
+    // the shorter buckets first, they do not add to the padded length,
+    typename BucketMap::iterator it = first;
+    while (static_cast<int32>(items->size()) < max_items) {
+      if (!TakeFits(it, max_items, max_frames, &longest, items))
+        break;
+      if (it == buckets_.begin())
+        break;
+      --it;
+    }
+    for (it = first, ++it;
+         static_cast<int32>(items->size()) < max_items && it != buckets_.end();
+         ++it) {
+      if (!TakeFits(it, max_items, max_frames, &longest, items))
+        break;
+    }
+    // take the emptied buckets out,
+    for (it = buckets_.begin(); it != buckets_.end(); ) {
+      if (it->second.items.empty()) buckets_.erase(it++);
+      else ++it;
+    }
+  }
+
+  /// Takes the item whose length is nearest to 'length', or (if 'length' is
+  /// negative) one from a random bucket. The caller owns it.
+  Item *TakeNearest(int32 length) {
+    KALDI_ASSERT(!Empty());
+    typename BucketMap::iterator it;
+    if (length < 0) {
+      it = PickBucket();
+    } else {
+      int32 b = length / opts_.bucket_width;
+      it = buckets_.lower_bound(b);
+      if (it == buckets_.end()) {
+        --it;
+      } else if (it->first != b && it != buckets_.begin()) {
+        // the nearer of the buckets either side,
+        typename BucketMap::iterator prev = it;
+        --prev;
+        if (length - ((prev->first + 1) * opts_.bucket_width - 1) <
+            it->first * opts_.bucket_width - length)
+          it = prev;
+      }
+    }
+    Item *item = TakeRandom(it);
+    if (it->second.items.empty())
+      buckets_.erase(it);
+    return item;
+  }
+
+ private:
+  struct Bucket {
+    std::vector<std::pair<Item*, int32> > items;  // with their lengths,
+    int64 frames;
+    Bucket(): frames(0) { }
+  };
+  typedef std::map<int32, Bucket> BucketMap;  // by length / bucket_width,
+
+  /// Random bucket, weighted by the frames in it (as nnet1::MatrixBuffer
+  /// does), so long utterances are not all left to the end.
+  typename BucketMap::iterator PickBucket() {
+    typename BucketMap::iterator it = buckets_.begin();
+    if (num_frames_ == 0) return it;
+    int64 frame = static_cast<int64>(RandUniform(&rand_state_) * num_frames_);
+    for (; it != buckets_.end(); ++it) {
+      if (frame < it->second.frames) return it;
+      frame -= it->second.frames;
+    }
+    return --it;
+  }
+
+  Item *TakeRandom(typename BucketMap::iterator it) {
+    KALDI_ASSERT(!it->second.items.empty());
+    return TakeAt(it, RandInt(0, it->second.items.size() - 1, &rand_state_));
+  }
+
+  Item *TakeAt(typename BucketMap::iterator it, int32 i) {
+    std::vector<std::pair<Item*, int32> > &items = it->second.items;
+    std::swap(items[i], items.back());
+    Item *item = items.back().first;
+    it->second.frames -= items.back().second;
+    num_frames_ -= items.back().second;
+    num_items_--;
+    items.pop_back();
+    return item;
+  }
+
+  /// Takes items of the bucket in random order while they fit, returns
+  /// false once one does not (the group is complete).
+  bool TakeFits(typename BucketMap::iterator it, int32 max_items,
+                int64 max_frames, int32 *longest, std::vector<Item*> *items) {
+    std::vector<std::pair<Item*, int32> > &bucket = it->second.items;
+    while (!bucket.empty() && static_cast<int32>(items->size()) < max_items) {
+      int32 i = RandInt(0, bucket.size() - 1, &rand_state_),
+          padded = std::max(*longest, bucket[i].second);
+      if (!items->empty() &&
+          static_cast<int64>(padded) * (items->size() + 1) > max_frames)
+        return false;
+      *longest = padded;
+      items->push_back(TakeAt(it, i));
+    }
+    return true;
+  }
+
+  LengthBucketerOptions opts_;
+  BucketMap buckets_;
+  int32 num_items_;
+  int64 num_frames_;
+  RandomState rand_state_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LengthBucketer);
+};
+
+
+/**
+ * Counts how much of the multi-stream batches is real data and how much
+ * is padding (or idle streams).
+ */
+struct StreamPaddingStats {
+  int64 num_batches;
+  int64 num_frames;  ///< real frames,
+  int64 num_slots;  ///< streams x padded length, summed over the batches,
+
+  StreamPaddingStats(): num_batches(0), num_frames(0), num_slots(0) { }
+
+  /// A batch of frame_num_utt.size() streams, each padded to 'padded_length'.
+  void Add(const std::vector<int32> &frame_num_utt, int32 padded_length) {
+    num_batches++;
+    for (size_t i = 0; i < frame_num_utt.size(); i++)
+      num_frames += frame_num_utt[i];
+    num_slots += static_cast<int64>(frame_num_utt.size()) * padded_length;
+  }
+
+  /// Fraction of the batch frames that are real data.
+  double Efficiency() const {
+    return (num_slots == 0 ? 1.0 : static_cast<double>(num_frames) / num_slots);
+  }
+
+  std::string Report() const {
+    std::ostringstream os;
+    os << "Padding efficiency " << 100.0 * Efficiency() << "% ("
+       << num_frames << " frames in " << num_slots << " stream-frames of "
+       << num_batches << " batches)";
+    return os.str();
+  }
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+#endif  // KALDI_NNET_NNET_LENGTH_BUCKETER_H_
@@ -191,7 +191,7 @@ class LinearTransform : public UpdatableComponent {
   }
 
   /// Accessors to the component parameters
-  const CuMatrixBase<BaseFloat>& GetLinearity() { return linearity_; }
+  const CuMatrixBase<BaseFloat>& GetLinearity() const { return linearity_; }
 
   void SetLinearity(const CuMatrixBase<BaseFloat>& linearity) {
     KALDI_ASSERT(linearity.NumRows() == linearity_.NumRows());
@@ -179,6 +179,22 @@ void Xent::Eval(const VectorBase<BaseFloat> &frame_weights,
 }
 
 
+void Xent::Eval(const VectorBase<BaseFloat> &frame_weights,
+                const CuMatrixBase<BaseFloat> &net_out,
+                const PosteriorCsr &post,
+                CuMatrix<BaseFloat> *diff) {
+  int32 num_frames = net_out.NumRows(),
+    num_pdf = net_out.NumCols();
+  KALDI_ASSERT(num_frames == post.NumFrames());
+
+  // convert posterior to matrix,
+  PosteriorToMatrix(post, num_pdf, &tgt_mat_);
+
+  // call the other eval function,
+  Eval(frame_weights, net_out, tgt_mat_, diff);
+}
+
+
 std::string Xent::Report() {
   double loss_value =
     (xentropy_.Sum() - entropy_.Sum()) / frames_.Sum();
@@ -296,6 +312,22 @@ void Mse::Eval(const VectorBase<BaseFloat> &frame_weights,
 }
 
 
+void Mse::Eval(const VectorBase<BaseFloat> &frame_weights,
+               const CuMatrixBase<BaseFloat>& net_out,
+               const PosteriorCsr& post,
+               CuMatrix<BaseFloat>* diff) {
+  int32 num_frames = net_out.NumRows(),
+    num_nn_outputs = net_out.NumCols();
+  KALDI_ASSERT(num_frames == post.NumFrames());
+
+  // convert posterior to matrix,
+  PosteriorToMatrix(post, num_nn_outputs, &tgt_mat_);
+
+  // call the other eval function,
+  Eval(frame_weights, net_out, tgt_mat_, diff);
+}
+
+
 std::string Mse::Report() {
   // compute root mean square,
   int32 num_tgt = diff_pow_2_.NumCols();
@@ -362,6 +394,28 @@ void MultiTaskLoss::InitFromString(const std::string& s) {
   KALDI_ASSERT(loss_vec_.size() == loss_weights_.size());
 }
 
+void MultiTaskLoss::MaskFrameWeights(
+    int32 f,
+    const std::pair<int32, BaseFloat> *begin,
+    const std::pair<int32, BaseFloat> *end,
+    std::vector<Vector<BaseFloat> > *frmwei_have_tgt) const {
+  for (int32 l = 0; l < loss_vec_.size(); l++) {
+    // We need to mask-out the frames for which the 'posterior' is not defined (= is empty):
+    int32 loss_beg = loss_dim_offset_[l];   // first column of loss target,
+    int32 loss_end = loss_dim_offset_[l+1]; // (last+1) column of loss target,
+    bool tgt_defined = false;
+    for (const std::pair<int32, BaseFloat> *p = begin; p != end; ++p) {
+      if (p->first >= loss_beg && p->first < loss_end) {
+        tgt_defined = true;
+        break;
+      }
+    }
+    if (!tgt_defined) {
+      (*frmwei_have_tgt)[l](f) = 0.0; // set zero_weight for the frame with no targets!
+    }
+  }
+}
+
 void MultiTaskLoss::Eval(const VectorBase<BaseFloat> &frame_weights,
             const CuMatrixBase<BaseFloat>& net_out,
             const Posterior& post,
@@ -374,32 +428,46 @@ void MultiTaskLoss::Eval(const VectorBase<BaseFloat> &frame_weights,
   // convert posterior to matrix,
   PosteriorToMatrix(post, num_output, &tgt_mat_);
 
-  // allocate diff matrix,
-  diff->Resize(num_frames, num_output);
-
   /// One vector of frame_weights per loss-function,
   /// The original frame weights are multiplied with
   /// a mask of `defined targets' according to the 'Posterior'.
-  std::vector<Vector<BaseFloat> > frmwei_have_tgt;
-  for (int32 l = 0; l < loss_vec_.size(); l++) {
-    // copy original weights,
-    frmwei_have_tgt.push_back(Vector<BaseFloat>(frame_weights));
-    // We need to mask-out the frames for which the 'posterior' is not defined (= is empty):
-    int32 loss_beg = loss_dim_offset_[l];   // first column of loss target,
-    int32 loss_end = loss_dim_offset_[l+1]; // (last+1) column of loss target,
-    for (int32 f = 0; f < num_frames; f++) {
-      bool tgt_defined = false;
-      for (int32 p = 0; p < post[f].size(); p++) {
-        if (post[f][p].first >= loss_beg && post[f][p].first < loss_end) {
-          tgt_defined = true;
-          break;
-        }
-      }
-      if (!tgt_defined) {
-        frmwei_have_tgt[l](f) = 0.0; // set zero_weight for the frame with no targets!
-      }
-    }
-  }
+  std::vector<Vector<BaseFloat> > frmwei_have_tgt(loss_vec_.size(),
+                                                  Vector<BaseFloat>(frame_weights));
+  for (int32 f = 0; f < num_frames; f++)
+    MaskFrameWeights(f, post[f].data(), post[f].data() + post[f].size(),
+                     &frmwei_have_tgt);
+
+  EvalTargetMatrix(frmwei_have_tgt, net_out, diff);
+}
+
+void MultiTaskLoss::Eval(const VectorBase<BaseFloat> &frame_weights,
+            const CuMatrixBase<BaseFloat>& net_out,
+            const PosteriorCsr& post,
+            CuMatrix<BaseFloat>* diff) {
+  int32 num_frames = net_out.NumRows(),
+    num_output = net_out.NumCols();
+  KALDI_ASSERT(num_frames == post.NumFrames());
+  KALDI_ASSERT(num_output == loss_dim_offset_.back());  // sum of loss-dims,
+
+  // convert posterior to matrix,
+  PosteriorToMatrix(post, num_output, &tgt_mat_);
+
+  // the frame weights per loss-function, see the other Eval(),
+  std::vector<Vector<BaseFloat> > frmwei_have_tgt(loss_vec_.size(),
+                                                  Vector<BaseFloat>(frame_weights));
+  for (int32 f = 0; f < num_frames; f++)
+    MaskFrameWeights(f, post.FrameBegin(f), post.FrameEnd(f),
+                     &frmwei_have_tgt);
+
+  EvalTargetMatrix(frmwei_have_tgt, net_out, diff);
+}
+
+void MultiTaskLoss::EvalTargetMatrix(
+    const std::vector<Vector<BaseFloat> > &frmwei_have_tgt,
+    const CuMatrixBase<BaseFloat>& net_out,
+    CuMatrix<BaseFloat>* diff) {
+  // allocate diff matrix,
+  diff->Resize(net_out.NumRows(), net_out.NumCols());
 
   // call the vector of loss functions,
   CuMatrix<BaseFloat> diff_aux;
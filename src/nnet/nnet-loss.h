@@ -67,6 +67,12 @@ class LossItf {
             const Posterior &target,
             CuMatrix<BaseFloat> *diff) = 0;
 
+  /// Evaluate cross entropy using target-posteriors in CSR form,
+  virtual void Eval(const VectorBase<BaseFloat> &frame_weights,
+            const CuMatrixBase<BaseFloat> &net_out,
+            const PosteriorCsr &target,
+            CuMatrix<BaseFloat> *diff) = 0;
+
   /// Generate string with error report,
   virtual std::string Report() = 0;
 
@@ -104,6 +110,12 @@ class Xent : public LossItf {
             const Posterior &target,
             CuMatrix<BaseFloat> *diff);
 
+  /// Evaluate cross entropy using target-posteriors in CSR form,
+  void Eval(const VectorBase<BaseFloat> &frame_weights,
+            const CuMatrixBase<BaseFloat> &net_out,
+            const PosteriorCsr &target,
+            CuMatrix<BaseFloat> *diff);
+
   /// Generate string with error report,
   std::string Report();
 
@@ -171,6 +183,12 @@ class Mse : public LossItf {
             const Posterior& target,
             CuMatrix<BaseFloat>* diff);
 
+  /// Evaluate mean square error using target-posteriors in CSR form,
+  void Eval(const VectorBase<BaseFloat> &frame_weights,
+            const CuMatrixBase<BaseFloat>& net_out,
+            const PosteriorCsr& target,
+            CuMatrix<BaseFloat>* diff);
+
   /// Generate string with error report
   std::string Report();
 
@@ -228,6 +246,12 @@ class MultiTaskLoss : public LossItf {
             const Posterior& target,
             CuMatrix<BaseFloat>* diff);
 
+  /// Evaluate mean square error using target-posteriors in CSR form,
+  void Eval(const VectorBase<BaseFloat> &frame_weights,
+            const CuMatrixBase<BaseFloat>& net_out,
+            const PosteriorCsr& target,
+            CuMatrix<BaseFloat>* diff);
+
   /// Generate string with error report
   std::string Report();
 
@@ -242,6 +266,20 @@ class MultiTaskLoss : public LossItf {
   std::vector<int32>     loss_dim_offset_;
 
   CuMatrix<BaseFloat>    tgt_mat_;
+
+  // Zeroes the weight of frame f for the losses which have no target among
+  // the posterior entries begin ... end - 1 (used by the Eval()s taking
+  // posteriors).
+  void MaskFrameWeights(int32 f,
+                        const std::pair<int32, BaseFloat> *begin,
+                        const std::pair<int32, BaseFloat> *end,
+                        std::vector<Vector<BaseFloat> > *frmwei_have_tgt) const;
+
+  // The rest of the Eval()s taking posteriors, once the targets are in
+  // tgt_mat_.
+  void EvalTargetMatrix(const std::vector<Vector<BaseFloat> > &frmwei_have_tgt,
+                        const CuMatrixBase<BaseFloat>& net_out,
+                        CuMatrix<BaseFloat>* diff);
 };
 
 }  // namespace nnet1
@@ -468,8 +468,17 @@ class LstmProjected : public MultistreamComponent {
     // set the 'projection layer' output as the LSTM output,
     out->CopyFromMat(YR.RowRange(1*S, T*S));
 
-    // the state in the last 'frame' is transferred (can be zero vector)
-    prev_nnet_state_.CopyFromMat(propagate_buf_.RowRange(T*S, S));
+    // the state in the last 'frame' is transferred (can be zero vector),
+    if (sequence_lengths_.size() > 0) {
+      // of each stream, which may have ended before 'T' (or have 0 frames,
+      // keeping the state it had),
+      for (int s = 0; s < S; s++) {
+        int32 t = std::min(sequence_lengths_[s], T);
+        prev_nnet_state_.Row(s).CopyFromVec(propagate_buf_.Row(t*S + s));
+      }
+    } else {
+      prev_nnet_state_.CopyFromMat(propagate_buf_.RowRange(T*S, S));
+    }
   }
 
   void BackpropagateFnc(const CuMatrixBase<BaseFloat> &in,
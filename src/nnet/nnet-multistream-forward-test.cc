@@ -0,0 +1,136 @@
+// nnet/nnet-multistream-forward-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nnet/nnet-multistream-forward.h"
+#include "nnet/nnet-nnet.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+static void AppendComponent(const std::string &conf_line, Nnet *nnet) {
+  nnet->AppendComponentPointer(Component::Init(conf_line + "\n"));
+}
+
+static void MakeLstmNnet(Nnet *nnet) {
+  AppendComponent("<AffineTransform> <InputDim> 5 <OutputDim> 8 "
+                  "<ParamStddev> 0.5", nnet);
+  AppendComponent("<Sigmoid> <InputDim> 8 <OutputDim> 8", nnet);
+  AppendComponent("<LstmProjected> <InputDim> 8 <OutputDim> 6 "
+                  "<CellDim> 10 <ParamRange> 0.5", nnet);
+  AppendComponent("<LstmProjected> <InputDim> 6 <OutputDim> 4 "
+                  "<CellDim> 7 <ParamRange> 0.5", nnet);
+  AppendComponent("<AffineTransform> <InputDim> 4 <OutputDim> 3 "
+                  "<ParamStddev> 0.5", nnet);
+}
+
+// Sequences of different lengths, started at different times on 3 streams
+// and fed in chunks of random sizes, give the output of the whole sequences
+void UnitTestMultistreamForwardChunks() {
+  Nnet nnet;
+  MakeLstmNnet(&nnet);
+  int32 num_streams = 3, num_seqs = 7;
+  MultistreamForward forward;
+  forward.Init(nnet, num_streams);
+
+  std::vector<Matrix<BaseFloat> > seqs(num_seqs), refs(num_seqs);
+  for (int32 i = 0; i < num_seqs; i++) {
+    seqs[i].Resize(1 + Rand() % 40, nnet.InputDim());
+    seqs[i].SetRandn();
+    CuMatrix<BaseFloat> ref;
+    nnet.Feedforward(CuMatrix<BaseFloat>(seqs[i]), &ref);
+    refs[i].Resize(ref.NumRows(), ref.NumCols());
+    ref.CopyToMat(&refs[i]);
+  }
+
+  // the sequence on each stream (-1 for idle), how far through it is
+  std::vector<int32> seq(num_streams, -1), pos(num_streams, 0);
+  std::vector<Matrix<BaseFloat> > outs(num_seqs);
+  int32 next_seq = 0, num_done = 0;
+  while (num_done < num_seqs) {
+    std::vector<Matrix<BaseFloat> > chunks(num_streams);
+    std::vector<const MatrixBase<BaseFloat>*> chunk_ptrs(num_streams, NULL);
+    for (int32 s = 0; s < num_streams; s++) {
+      if (seq[s] < 0 && next_seq < num_seqs && Rand() % 2 == 0) {
+        seq[s] = next_seq++;
+        pos[s] = 0;
+        forward.ResetStream(s);
+      }
+      if (seq[s] < 0 || Rand() % 4 == 0) continue;  // idle
+      const Matrix<BaseFloat> &x = seqs[seq[s]];
+      int32 len = std::min(1 + Rand() % 6, x.NumRows() - pos[s]);
+      chunks[s] = x.RowRange(pos[s], len);
+      chunk_ptrs[s] = &chunks[s];
+    }
+    std::vector<Matrix<BaseFloat> > out;
+    forward.Forward(chunk_ptrs, &out);
+    KALDI_ASSERT(out.size() == num_streams);
+    for (int32 s = 0; s < num_streams; s++) {
+      if (chunk_ptrs[s] == NULL) {
+        KALDI_ASSERT(out[s].NumRows() == 0);
+        continue;
+      }
+      Matrix<BaseFloat> &y = outs[seq[s]];
+      Matrix<BaseFloat> grown(y.NumRows() + out[s].NumRows(), out[s].NumCols());
+      if (y.NumRows() > 0) grown.RowRange(0, y.NumRows()).CopyFromMat(y);
+      grown.RowRange(y.NumRows(), out[s].NumRows()).CopyFromMat(out[s]);
+      y.Swap(&grown);
+      pos[s] += chunks[s].NumRows();
+      if (pos[s] == seqs[seq[s]].NumRows()) {
+        seq[s] = -1;
+        num_done++;
+      }
+    }
+  }
+  for (int32 i = 0; i < num_seqs; i++)
+    AssertEqual(refs[i], outs[i], 1.0e-04);
+}
+
+void UnitTestMultistreamForwardRefuses() {
+  Nnet nnet;
+  AppendComponent("<Splice> <InputDim> 5 <OutputDim> 15 "
+                  "<BuildVector> -1 0 1 </BuildVector>", &nnet);
+  AppendComponent("<AffineTransform> <InputDim> 15 <OutputDim> 3 "
+                  "<ParamStddev> 0.5", &nnet);
+  MultistreamForward forward;
+  bool refused = false;
+  try {
+    forward.Init(nnet, 2);
+  } catch (const std::runtime_error &e) {
+    refused = true;
+  }
+  KALDI_ASSERT(refused);
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+  for (int32 i = 0; i < 5; i++)
+    UnitTestMultistreamForwardChunks();
+  UnitTestMultistreamForwardRefuses();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,107 @@
+// nnet/nnet-multistream-forward.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "nnet/nnet-multistream-forward.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+void MultistreamForward::Init(const Nnet &nnet, int32 num_streams) {
+  KALDI_ASSERT(num_streams > 0);
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    Component::ComponentType type = nnet.GetComponent(c).GetType();
+    switch (type) {
+      case Component::kSplice:
+      case Component::kBlstmProjected:
+      case Component::kRecurrentComponent:
+      case Component::kSentenceAveragingComponent:
+      case Component::kSimpleSentenceAveragingComponent:
+      case Component::kParallelComponent:
+        KALDI_ERR << "Component " << c + 1 << " "
+                  << Component::TypeToMarker(type)
+                  << " looks across frames, the network cannot be run in "
+                  << "chunks";
+      default:
+        break;
+    }
+  }
+  nnet_ = nnet;
+  nnet_.SetDropoutRate(0.0);
+  num_streams_ = num_streams;
+  reset_flags_.assign(num_streams, 1);
+}
+
+void MultistreamForward::ResetStream(int32 s) {
+  KALDI_ASSERT(s >= 0 && s < num_streams_);
+  reset_flags_[s] = 1;
+}
+
+void MultistreamForward::Forward(
+    const std::vector<const MatrixBase<BaseFloat>*> &chunks,
+    std::vector<Matrix<BaseFloat> > *out) {
+  int32 S = num_streams_;
+  KALDI_ASSERT(S > 0 && "Init() first");
+  KALDI_ASSERT(chunks.size() == S);
+  std::vector<int32> lengths(S, 0);
+  int32 T = 0;
+  for (int32 s = 0; s < S; s++) {
+    if (chunks[s] == NULL) continue;
+    if (chunks[s]->NumRows() > 0 && chunks[s]->NumCols() != InputDim())
+      KALDI_ERR << "Chunk of stream " << s << " has dim "
+                << chunks[s]->NumCols() << ", the network " << InputDim();
+    lengths[s] = chunks[s]->NumRows();
+    T = std::max(T, lengths[s]);
+  }
+  out->resize(S);
+  for (int32 s = 0; s < S; s++) {
+    if (lengths[s] > 0) (*out)[s].Resize(lengths[s], OutputDim(), kUndefined);
+    else (*out)[s].Resize(0, 0);
+  }
+  if (T == 0) return;
+
+  // interleave, the padding of the shorter chunks is zero
+  host_in_.Resize(T * S, InputDim());
+  for (int32 s = 0; s < S; s++)
+    for (int32 t = 0; t < lengths[s]; t++)
+      host_in_.Row(t * S + s).CopyFromVec(chunks[s]->Row(t));
+  in_ = host_in_;
+
+  nnet_.SetSeqLengths(lengths);
+  // only the streams that have frames start their new sequence now
+  std::vector<int32> flags(S, 0);
+  for (int32 s = 0; s < S; s++) {
+    if (lengths[s] > 0 && reset_flags_[s] == 1) {
+      flags[s] = 1;
+      reset_flags_[s] = 0;
+    }
+  }
+  nnet_.ResetStreams(flags);
+  nnet_.Feedforward(in_, &out_);
+
+  host_out_.Resize(out_.NumRows(), out_.NumCols(), kUndefined);
+  out_.CopyToMat(&host_out_);
+  for (int32 s = 0; s < S; s++)
+    for (int32 t = 0; t < lengths[s]; t++)
+      (*out)[s].Row(t).CopyFromVec(host_out_.Row(t * S + s));
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
@@ -0,0 +1,81 @@
+// nnet/nnet-multistream-forward.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET_NNET_MULTISTREAM_FORWARD_H_
+#define KALDI_NNET_NNET_MULTISTREAM_FORWARD_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "cudamatrix/cu-matrix.h"
+#include "matrix/kaldi-matrix.h"
+#include "nnet/nnet-nnet.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * Runs a unidirectional network (<LstmProjected> layers between frame by
+ * frame components) over several sequences at once, a chunk of frames of
+ * each at a time, keeping the state of the LSTMs of each stream between
+ * chunks. Running a sequence through in chunks gives the same output as
+ * Nnet::Feedforward on the whole of it, so the output of a sentence can be
+ * generated as its input arrives, with as much lookahead as the chunks.
+ *
+ * Each stream is a fixed slot of the LSTM state; the chunks of all the
+ * streams are interleaved and go through the network in one pass, and a
+ * stream with no frames in a pass keeps its state. Components that look
+ * across frames (<Splice>, <BlstmProjected>, <RecurrentComponent>, ...) can
+ * not be run in chunks, and are refused by Init.
+ */
+class MultistreamForward {
+ public:
+  MultistreamForward() : num_streams_(0) { }
+
+  /// Copies nnet for num_streams streams, all at the start of a sequence
+  void Init(const Nnet &nnet, int32 num_streams);
+
+  /// Starts a new sequence on stream s, from its next chunk
+  void ResetStream(int32 s);
+
+  /// Runs chunks[s], the next frames of stream s, through the network to
+  /// (*out)[s]. chunks must have NumStreams() entries; a stream with a NULL
+  /// or empty chunk is idle and keeps its state.
+  void Forward(const std::vector<const MatrixBase<BaseFloat>*> &chunks,
+               std::vector<Matrix<BaseFloat> > *out);
+
+  int32 NumStreams() const { return num_streams_; }
+  int32 InputDim() const { return nnet_.InputDim(); }
+  int32 OutputDim() const { return nnet_.OutputDim(); }
+
+ private:
+  Nnet nnet_;
+  int32 num_streams_;
+  std::vector<int32> reset_flags_;  // 1 for a stream starting a sequence
+  Matrix<BaseFloat> host_in_;  // the interleaved chunks, frame t * S + s
+  CuMatrix<BaseFloat> in_, out_;
+  Matrix<BaseFloat> host_out_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MultistreamForward);
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+#endif  // KALDI_NNET_NNET_MULTISTREAM_FORWARD_H_
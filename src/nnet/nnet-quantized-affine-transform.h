@@ -0,0 +1,170 @@
+// nnet/nnet-quantized-affine-transform.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET_NNET_QUANTIZED_AFFINE_TRANSFORM_H_
+#define KALDI_NNET_NNET_QUANTIZED_AFFINE_TRANSFORM_H_
+
+#include <memory>
+#include <string>
+
+#include "nnet/nnet-component.h"
+#include "nnet/nnet-affine-transform.h"
+#include "nnet/nnet-linear-transform.h"
+#include "nnet/nnet-nnet.h"
+#include "nnet/nnet-utils.h"
+#include "cudamatrix/cu-device.h"
+#include "matrix/quantized-matrix.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * An <AffineTransform> (or <LinearTransform>, with a zero bias) with its
+ * weights held in int8 with a scale per row, or in fp16, for inference only.
+ * Made by nnet-quantize from a trained network; it cannot be trained.
+ *
+ * On the CPU the weights stay quantized and are expanded a block of rows
+ * at a time as they are multiplied by (QuantizedMatrix::AddMatMatTrans).
+ * On a GPU they are expanded once, on the first forward pass.
+ * The quantized weights are never changed once made, so the copies of the
+ * component (Copy(), and so the copies of a Nnet) share them.
+ */
+class QuantizedAffineTransform : public Component {
+ public:
+  QuantizedAffineTransform(int32 dim_in, int32 dim_out):
+    Component(dim_in, dim_out), linearity_(new QuantizedMatrix()),
+    bias_(dim_out)
+  { }
+  ~QuantizedAffineTransform()
+  { }
+
+  Component* Copy() const { return new QuantizedAffineTransform(*this); }
+  ComponentType GetType() const { return kQuantizedAffineTransform; }
+
+  /// Quantizes the weights, the bias stays as it is
+  void Init(const CuMatrixBase<BaseFloat> &linearity,
+            const CuVectorBase<BaseFloat> &bias,
+            QuantizationMethod method) {
+    KALDI_ASSERT(linearity.NumRows() == output_dim_ &&
+                 linearity.NumCols() == input_dim_ &&
+                 bias.Dim() == output_dim_);
+    QuantizedMatrix *quantized = new QuantizedMatrix();
+    quantized->CopyFromMat(Matrix<BaseFloat>(linearity), method);
+    linearity_.reset(quantized);
+    bias_ = bias;
+    linearity_expanded_.Resize(0, 0);
+  }
+
+  void InitData(std::istream &is) {
+    KALDI_ERR << "<QuantizedAffineTransform> is made from a trained network "
+              << "by nnet-quantize, it cannot be initialized";
+  }
+
+  void ReadData(std::istream &is, bool binary) {
+    QuantizedMatrix *quantized = new QuantizedMatrix();
+    quantized->Read(is, binary);
+    linearity_.reset(quantized);
+    bias_.Read(is, binary);
+    linearity_expanded_.Resize(0, 0);
+
+    KALDI_ASSERT(linearity_->NumRows() == output_dim_);
+    KALDI_ASSERT(linearity_->NumCols() == input_dim_);
+    KALDI_ASSERT(bias_.Dim() == output_dim_);
+  }
+
+  void WriteData(std::ostream &os, bool binary) const {
+    if (!binary) os << "\n";
+    linearity_->Write(os, binary);
+    bias_.Write(os, binary);
+  }
+
+  std::string Info() const {
+    return std::string("\n  linearity ") +
+      QuantizationMethodToString(linearity_->Method()) + ", " +
+      ToString(linearity_->SizeInBytes()) + " bytes" +
+      "\n  bias" + MomentStatistics(bias_);
+  }
+
+  void PropagateFnc(const CuMatrixBase<BaseFloat> &in,
+                    CuMatrixBase<BaseFloat> *out) {
+    // precopy bias
+    out->AddVecToRows(1.0, bias_, 0.0);
+#if HAVE_CUDA == 1
+    if (CuDevice::Instantiate().Enabled()) {
+      if (linearity_expanded_.NumRows() == 0) {
+        Matrix<BaseFloat> linearity(linearity_->NumRows(),
+                                    linearity_->NumCols(), kUndefined);
+        linearity_->CopyToMat(&linearity);
+        linearity_expanded_ = linearity;
+      }
+      out->AddMatMat(1.0, in, kNoTrans, linearity_expanded_, kTrans, 1.0);
+      return;
+    }
+#endif
+    // multiply by weights^t
+    linearity_->AddMatMatTrans<BaseFloat>(1.0, in.Mat(), 1.0, &out->Mat());
+  }
+
+  void BackpropagateFnc(const CuMatrixBase<BaseFloat> &in,
+                        const CuMatrixBase<BaseFloat> &out,
+                        const CuMatrixBase<BaseFloat> &out_diff,
+                        CuMatrixBase<BaseFloat> *in_diff) {
+    KALDI_ERR << "<QuantizedAffineTransform> is for inference only, "
+              << "train the network before nnet-quantize";
+  }
+
+  const QuantizedMatrix& GetLinearity() const { return *linearity_; }
+  const CuVectorBase<BaseFloat>& GetBias() const { return bias_; }
+
+ protected:
+  // shared by the copies, not changed once made
+  std::shared_ptr<const QuantizedMatrix> linearity_;
+  CuVector<BaseFloat> bias_;
+  // the weights expanded on the GPU, on the first forward pass there
+  CuMatrix<BaseFloat> linearity_expanded_;
+};
+
+/// Replaces every <AffineTransform> and <LinearTransform> of nnet by a
+/// <QuantizedAffineTransform>, returns how many were replaced
+inline int32 QuantizeAffineTransforms(QuantizationMethod method, Nnet *nnet) {
+  int32 num_quantized = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    const Component &comp = nnet->GetComponent(c);
+    QuantizedAffineTransform quant(comp.InputDim(), comp.OutputDim());
+    if (comp.GetType() == Component::kAffineTransform) {
+      const AffineTransform &aff = dynamic_cast<const AffineTransform&>(comp);
+      quant.Init(aff.GetLinearity(), aff.GetBias(), method);
+    } else if (comp.GetType() == Component::kLinearTransform) {
+      const LinearTransform &lin = dynamic_cast<const LinearTransform&>(comp);
+      CuVector<BaseFloat> zero_bias(comp.OutputDim());
+      quant.Init(lin.GetLinearity(), zero_bias, method);
+    } else {
+      continue;
+    }
+    nnet->ReplaceComponent(c, quant);
+    num_quantized++;
+  }
+  return num_quantized;
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+#endif  // KALDI_NNET_NNET_QUANTIZED_AFFINE_TRANSFORM_H_
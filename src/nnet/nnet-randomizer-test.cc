@@ -228,12 +228,100 @@ void UnitTestStdVectorRandomizer() {
   KALDI_ASSERT(i == 22);  // 22 minibatches
 }
 
+void UnitTestSplicedMatrixRandomizer() {
+  // config
+  NnetDataRandomizerOptions c;
+  c.randomizer_size = 300;
+  c.minibatch_size = 32;
+  std::vector<int32> offsets;
+  offsets.push_back(-2);
+  offsets.push_back(0);
+  offsets.push_back(1);
+  offsets.push_back(3);
+  CuArray<int32> offsets_gpu(offsets);
+  // the spliced randomizer must give what a randomizer of the spliced
+  // frames gives,
+  SplicedMatrixRandomizer r;
+  r.Init(c, offsets);
+  MatrixRandomizer ref;
+  ref.Init(c);
+  RandomizerMask mask_gen(c);
+  int32 num_minibatches = 0;
+  for (int32 fill = 0; fill < 4; fill++) {
+    while (!r.IsFull()) {
+      // an utterance, of which some of the frames are trained on,
+      Matrix<BaseFloat> m(1 + Rand() % 50, 5);
+      InitRand(&m);
+      CuMatrix<BaseFloat> m2(m);
+      std::vector<int32> frames;
+      for (int32 i = 0; i < m.NumRows(); i++)
+        if (Rand() % 4 != 0) frames.push_back(i);
+      if (frames.empty()) frames.push_back(m.NumRows() - 1);
+      r.AddData(m2, frames);
+      CuMatrix<BaseFloat> spliced(m.NumRows(), m.NumCols() * offsets.size());
+      cu::Splice(m2, offsets_gpu, &spliced);
+      CuMatrix<BaseFloat> kept(frames.size(), spliced.NumCols());
+      kept.CopyRows(spliced, CuArray<MatrixIndexT>(frames));
+      ref.AddData(kept);
+      KALDI_ASSERT(r.NumFrames() == ref.NumFrames());
+    }
+    KALDI_ASSERT(ref.IsFull());
+    const std::vector<int32> &mask = mask_gen.Generate(r.NumFrames());
+    r.Randomize(mask);
+    ref.Randomize(mask);
+    for ( ; !r.Done(); r.Next(), ref.Next(), num_minibatches++) {
+      KALDI_ASSERT(!ref.Done());
+      Matrix<BaseFloat> m3(r.Value()), m4(ref.Value());
+      AssertEqual(m3, m4);
+    }
+    KALDI_ASSERT(ref.Done());
+  }
+  KALDI_ASSERT(num_minibatches >= 4 * (300 / 32));
+}
+
+void UnitTestPosteriorCsrRandomizer() {
+  // config
+  NnetDataRandomizerOptions c;
+  c.randomizer_size = 300;
+  c.minibatch_size = 32;
+  // the CSR randomizer must give what the PosteriorRandomizer gives,
+  PosteriorCsrRandomizer r(c);
+  PosteriorRandomizer ref(c);
+  RandomizerMask mask_gen(c);
+  int32 num_minibatches = 0;
+  for (int32 fill = 0; fill < 4; fill++) {
+    while (!r.IsFull()) {
+      Posterior post(1 + Rand() % 50);
+      for (size_t t = 0; t < post.size(); t++)
+        for (int32 i = Rand() % 3; i >= 0; i--)
+          post[t].push_back(std::make_pair(Rand() % 10, RandUniform()));
+      r.AddData(PosteriorCsr(post));
+      ref.AddData(post);
+      KALDI_ASSERT(r.NumFrames() == ref.NumFrames());
+    }
+    KALDI_ASSERT(ref.IsFull());
+    const std::vector<int32> &mask = mask_gen.Generate(r.NumFrames());
+    r.Randomize(mask);
+    ref.Randomize(mask);
+    for ( ; !r.Done(); r.Next(), ref.Next(), num_minibatches++) {
+      KALDI_ASSERT(!ref.Done());
+      Posterior post;
+      r.Value().CopyToPosterior(&post);
+      KALDI_ASSERT(post == ref.Value());
+    }
+    KALDI_ASSERT(ref.Done());
+  }
+  KALDI_ASSERT(num_minibatches >= 4 * (300 / 32));
+}
+
 
 int main() {
   UnitTestRandomizerMask();
   UnitTestMatrixRandomizer();
   UnitTestVectorRandomizer();
   UnitTestStdVectorRandomizer();
+  UnitTestSplicedMatrixRandomizer();
+  UnitTestPosteriorCsrRandomizer();
 
   std::cout << "Tests succeeded.\n";
 }
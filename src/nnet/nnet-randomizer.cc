@@ -109,6 +109,105 @@ const CuMatrixBase<BaseFloat>& MatrixRandomizer::Value() {
 }
 
 
+/* SplicedMatrixRandomizer:: */
+
+void SplicedMatrixRandomizer::AddData(const CuMatrixBase<BaseFloat>& m,
+                                      const std::vector<int32> &frames) {
+  // optionally put previous left-over to front, with the utterances
+  // they need as context,
+  if (data_begin_ > 0) {
+    KALDI_ASSERT(data_begin_ <= NumFrames());  // sanity check,
+    std::vector<Frame> leftover(frames_.begin() + data_begin_, frames_.end());
+    // the utterances (begin, end) in the order of their rows,
+    std::vector<std::pair<int32, int32> > utts;
+    for (size_t i = 0; i < leftover.size(); i++)
+      utts.push_back(std::make_pair(leftover[i].begin, leftover[i].end));
+    std::sort(utts.begin(), utts.end());
+    utts.erase(std::unique(utts.begin(), utts.end()), utts.end());
+    // they are moved towards the front, in order, so never onto a row
+    // that is still to be moved,
+    int32 row = 0;
+    std::vector<int32> new_begin(utts.size());
+    for (size_t u = 0; u < utts.size(); u++) {
+      int32 len = utts[u].second - utts[u].first;
+      if (row != utts[u].first) {
+        CuMatrix<BaseFloat> tmp(feats_.RowRange(utts[u].first, len));
+        feats_.RowRange(row, len).CopyFromMat(tmp);
+      }
+      new_begin[u] = row;
+      row += len;
+    }
+    for (size_t i = 0; i < leftover.size(); i++) {
+      size_t u = std::lower_bound(utts.begin(), utts.end(),
+          std::make_pair(leftover[i].begin, leftover[i].end)) - utts.begin();
+      int32 shift = new_begin[u] - leftover[i].begin;
+      leftover[i].row += shift;
+      leftover[i].begin += shift;
+      leftover[i].end += shift;
+    }
+    frames_.swap(leftover);
+    feats_end_ = row;
+    data_begin_ = 0;
+  }
+  // extend the buffer if necessary,
+  if (feats_.NumCols() == 0) {
+    feats_.Resize(std::max(conf_.randomizer_size, m.NumRows()), m.NumCols());
+  } else if (feats_.NumRows() < feats_end_ + m.NumRows()) {
+    // CuMatrix -> Matrix -> CuMatrix (needs less GPU memory),
+    Matrix<BaseFloat> feats_aux(feats_.RowRange(0, feats_end_));
+    // Add extra 3% rows, so we don't reallocate soon:
+    int32 extra_rows = 0.03 * feats_.NumRows();
+    feats_.Resize(feats_end_ + m.NumRows() + extra_rows, feats_.NumCols());
+    if (feats_end_ > 0)
+      feats_.RowRange(0, feats_end_).CopyFromMat(feats_aux);
+  }
+  KALDI_ASSERT(m.NumCols() == feats_.NumCols());
+  // copy the data
+  feats_.RowRange(feats_end_, m.NumRows()).CopyFromMat(m);
+  for (size_t i = 0; i < frames.size(); i++) {
+    KALDI_ASSERT(frames[i] >= 0 && frames[i] < m.NumRows());
+    Frame f = { feats_end_ + frames[i], feats_end_, feats_end_ + m.NumRows() };
+    frames_.push_back(f);
+  }
+  feats_end_ += m.NumRows();
+}
+
+void SplicedMatrixRandomizer::Randomize(const std::vector<int32>& mask) {
+  KALDI_ASSERT(data_begin_ == 0);
+  KALDI_ASSERT(NumFrames() > 0);
+  KALDI_ASSERT(NumFrames() == mask.size());
+  // the frames are shuffled, not the data,
+  std::vector<Frame> frames(frames_.size());
+  for (size_t i = 0; i < mask.size(); i++)
+    frames[i] = frames_[mask[i]];
+  frames_.swap(frames);
+}
+
+void SplicedMatrixRandomizer::Next() {
+  data_begin_ += conf_.minibatch_size;
+}
+
+const CuMatrixBase<BaseFloat>& SplicedMatrixRandomizer::Value() {
+  // make sure we have data for next minibatch,
+  KALDI_ASSERT(NumFrames() - data_begin_ >= conf_.minibatch_size);
+  int32 n = conf_.minibatch_size, dim = feats_.NumCols();
+  // prepare the mini-batch buffer,
+  minibatch_.Resize(n, dim * offsets_.size(), kUndefined);
+  rows_.resize(n);
+  // gather the rows of each offset, as cu::Splice does,
+  for (size_t k = 0; k < offsets_.size(); k++) {
+    for (int32 i = 0; i < n; i++) {
+      const Frame &f = frames_[data_begin_ + i];
+      rows_[i] = std::min(std::max(f.row + offsets_[k], f.begin), f.end - 1);
+    }
+    rows_gpu_ = rows_;
+    CuSubMatrix<BaseFloat> block(minibatch_.ColRange(k * dim, dim));
+    block.CopyRows(feats_, rows_gpu_);
+  }
+  return minibatch_;
+}
+
+
 /* VectorRandomizer */
 
 void VectorRandomizer::AddData(const Vector<BaseFloat>& v) {
@@ -230,5 +329,41 @@ template class StdVectorRandomizer<int32>;
 // - PosteriorRandomizer:
 template class StdVectorRandomizer<std::vector<std::pair<int32, BaseFloat> > >;
 
+
+/* PosteriorCsrRandomizer */
+
+void PosteriorCsrRandomizer::AddData(const PosteriorCsr& post) {
+  // optionally put previous left-over to front
+  if (data_begin_ > 0) {
+    KALDI_ASSERT(data_begin_ <= data_.NumFrames());  // sanity check
+    int32 leftover = data_.NumFrames() - data_begin_;
+    data_aux_.CopyRange(data_, data_begin_, leftover);
+    data_.Swap(&data_aux_);
+    data_begin_ = 0;
+  }
+  // append the data
+  data_.Append(post);
+}
+
+void PosteriorCsrRandomizer::Randomize(const std::vector<int32>& mask) {
+  KALDI_ASSERT(data_begin_ == 0);
+  KALDI_ASSERT(data_.NumFrames() > 0);
+  KALDI_ASSERT(data_.NumFrames() == mask.size());
+  // the mask is used to index frames in the unshuffled data
+  data_aux_.CopyRows(data_, mask);
+  data_.Swap(&data_aux_);
+}
+
+void PosteriorCsrRandomizer::Next() {
+  data_begin_ += conf_.minibatch_size;
+}
+
+const PosteriorCsr& PosteriorCsrRandomizer::Value() {
+  // make sure we have enough data for minibatch,
+  KALDI_ASSERT(data_.NumFrames() - data_begin_ >= conf_.minibatch_size);
+  minibatch_.CopyRange(data_, data_begin_, conf_.minibatch_size);
+  return minibatch_;
+}
+
 }  // namespace nnet1
 }  // namespace kaldi
@@ -28,6 +28,7 @@
 #include "itf/options-itf.h"
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cu-math.h"
+#include "hmm/posterior.h"
 
 namespace kaldi {
 namespace nnet1 {
@@ -144,6 +145,84 @@ class MatrixRandomizer {
 };
 
 
+/**
+ * Shuffles the frames of utterances and splices them as <Splice> would,
+ * while keeping the frames unspliced: the buffer holds (on the GPU) the
+ * rows of the utterances as they are, and the spliced mini-batch is
+ * gathered from it (CopyRows with the offsets, clamped at the ends of the
+ * utterance), so it takes about 1/(number of offsets) of the memory of a
+ * MatrixRandomizer of the spliced frames. Randomize() only shuffles the
+ * index of the frames.
+ *
+ * With the same mask, the mini-batches are the same as those of a
+ * MatrixRandomizer given the utterances spliced, and the frames chosen.
+ */
+class SplicedMatrixRandomizer {
+ public:
+  SplicedMatrixRandomizer():
+    feats_end_(0),
+    data_begin_(0)
+  { }
+
+  /// Set the randomizer parameters (size), and the offsets of <Splice>
+  void Init(const NnetDataRandomizerOptions& conf,
+            const std::vector<int32> &offsets) {
+    KALDI_ASSERT(!offsets.empty());
+    conf_ = conf;
+    offsets_ = offsets;
+  }
+
+  /// Add the unspliced rows of an utterance to the buffer, of which the
+  /// rows 'frames' are the frames that go in the mini-batches (the others
+  /// are only context)
+  void AddData(const CuMatrixBase<BaseFloat>& m,
+               const std::vector<int32> &frames);
+
+  /// Returns true, when capacity is full
+  bool IsFull() {
+    return ((data_begin_ == 0) && (NumFrames() > conf_.randomizer_size ));
+  }
+
+  /// Number of frames stored inside the Randomizer
+  int32 NumFrames() {
+    return frames_.size();
+  }
+
+  /// Randomize frame order using mask
+  void Randomize(const std::vector<int32>& mask);
+
+  /// Returns true, if no more data for another mini-batch (after current one)
+  bool Done() {
+    return (NumFrames() - data_begin_ < conf_.minibatch_size);
+  }
+
+  /// Sets cursor to next mini-batch
+  void Next();
+
+  /// Returns the next mini-batch, spliced
+  const CuMatrixBase<BaseFloat>& Value();
+
+ private:
+  // A frame, its row in 'feats_' and the rows of its utterance,
+  struct Frame {
+    int32 row, begin, end;
+  };
+
+  std::vector<int32> offsets_;
+  CuMatrix<BaseFloat> feats_;  // unspliced, can be larger than used
+  int32 feats_end_;  // the rows of 'feats_' in use,
+  std::vector<Frame> frames_;  // the frames of the mini-batches,
+  CuMatrix<BaseFloat> minibatch_;  // buffer for mini-batch
+  std::vector<int32> rows_;  // the rows gathered for one offset,
+  CuArray<int32> rows_gpu_;
+
+  /// A cursor, pointing to the frame where the next mini-batch begins,
+  int32 data_begin_;
+
+  NnetDataRandomizerOptions conf_;
+};
+
+
 /// Randomizes elements of a vector according to a mask
 class VectorRandomizer {
  public:
@@ -268,6 +347,64 @@ typedef StdVectorRandomizer<int32> Int32VectorRandomizer;
 typedef StdVectorRandomizer<std::vector<std::pair<int32, BaseFloat> > > PosteriorRandomizer;
 
 
+/// Randomizes the frames of posteriors in PosteriorCsr form according to a
+/// mask; same as PosteriorRandomizer, but without a heap allocation per frame.
+class PosteriorCsrRandomizer {
+ public:
+  PosteriorCsrRandomizer():
+    data_begin_(0)
+  { }
+
+  explicit PosteriorCsrRandomizer(const NnetDataRandomizerOptions &conf):
+    data_begin_(0)
+  {
+    Init(conf);
+  }
+
+  /// Set the randomizer parameters (size)
+  void Init(const NnetDataRandomizerOptions& conf) {
+    conf_ = conf;
+  }
+
+  /// Add data to randomization buffer
+  void AddData(const PosteriorCsr& post);
+
+  /// Returns true, when capacity is full
+  bool IsFull() {
+    return ((data_begin_ == 0) && (data_.NumFrames() > conf_.randomizer_size ));
+  }
+
+  /// Number of frames stored inside the Randomizer
+  int32 NumFrames() {
+    return data_.NumFrames();
+  }
+
+  /// Randomize frame-order using mask
+  void Randomize(const std::vector<int32>& mask);
+
+  /// Returns true, if no more data for another mini-batch (after current one)
+  bool Done() {
+    return (data_.NumFrames() - data_begin_ < conf_.minibatch_size);
+  }
+
+  /// Sets cursor to next mini-batch
+  void Next();
+
+  /// Returns the posteriors of the next mini-batch
+  const PosteriorCsr& Value();
+
+ private:
+  PosteriorCsr data_;  // can be larger than 'randomizer_size'
+  PosteriorCsr data_aux_;  // buffer for randomizing and for the left-over
+  PosteriorCsr minibatch_;  // buffer for mini-batch
+
+  /// A cursor, pointing to the frame where the next mini-batch begins,
+  int32 data_begin_;
+
+  NnetDataRandomizerOptions conf_;
+};
+
+
 }  // namespace nnet1
 }  // namespace kaldi
 
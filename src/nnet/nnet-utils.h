@@ -297,6 +297,18 @@ void PosteriorToMatrix(const Posterior &post,
 }
 
 
+/**
+ * Wrapper of PosteriorToMatrix with PosteriorCsr and CuMatrix arguments.
+ */
+template <typename Real>
+void PosteriorToMatrix(const PosteriorCsr &post,
+                       const int32 post_dim, CuMatrix<Real> *mat) {
+  Matrix<Real> m;
+  PosteriorToMatrix(post, post_dim, &m);
+  (*mat) = m;
+}
+
+
 /**
  * Wrapper of PosteriorToMatrixMapped with CuMatrix argument.
  */
@@ -135,6 +135,12 @@ class Splice: public Component {
     }
   }
 
+  /// The offsets of the frames spliced, in order
+  void GetFrameOffsets(std::vector<int32> *offsets) const {
+    offsets->resize(frame_offsets_.Dim());
+    frame_offsets_.CopyToVec(offsets);
+  }
+
  protected:
   CuArray<int32> frame_offsets_;
 };
@@ -22,6 +22,7 @@
 #include <sstream>
 #include <iomanip>
 #include "nnet3/attention.h"
+#include "cudamatrix/cu-math.h"
 #include "nnet3/nnet-parse.h"
 
 namespace kaldi {
@@ -41,15 +42,17 @@ void GetAttentionDotProducts(BaseFloat alpha,
       context_dim = C->NumCols();
   KALDI_ASSERT(num_extra_rows > 0 && num_extra_rows % (context_dim - 1) == 0);
   int32 row_shift = num_extra_rows / (context_dim - 1);
-  CuMatrix<BaseFloat> Ctrans(C->NumCols(),
-                             C->NumRows());
-  for (int32 o = 0; o < context_dim; o++) {
-    CuSubVector<BaseFloat> c_col(Ctrans, o);
-    CuSubMatrix<BaseFloat> B_part(B, o * row_shift, num_output_rows,
-                                  0, input_num_cols);
-    c_col.AddDiagMatMat(alpha, A, kNoTrans, B_part, kTrans, 0.0);
-  }
-  C->CopyFromMat(Ctrans, kTrans);
+  // Row i of C is alpha times row i of A times the transpose of the matrix
+  // B_i made of rows i, i + row_shift, ... of B, so all the rows are done by
+  // one strided-batched multiplication, B_i being B_0 (whose stride is
+  // row_shift rows of B) moved down i rows.
+  CuSubMatrix<BaseFloat> A_row(A, 0, 1, 0, input_num_cols),
+      B_rows(B.Data(), context_dim, input_num_cols, row_shift * B.Stride()),
+      C_row(*C, 0, 1, 0, context_dim);
+  AddMatMatStridedBatched<BaseFloat>(alpha, &C_row, C->Stride(),
+                                     A_row, A.Stride(), kNoTrans,
+                                     B_rows, B.Stride(), kTrans,
+                                     0.0, num_output_rows);
 }
 
 void ApplyScalesToOutput(BaseFloat alpha,
@@ -64,13 +67,15 @@ void ApplyScalesToOutput(BaseFloat alpha,
       context_dim = C.NumCols();
   KALDI_ASSERT(num_extra_rows > 0 && num_extra_rows % (context_dim - 1) == 0);
   int32 row_shift = num_extra_rows / (context_dim - 1);
-  CuMatrix<BaseFloat> Ctrans(C, kTrans);
-  for (int32 o = 0; o < context_dim; o++) {
-    CuSubVector<BaseFloat> c_col(Ctrans, o);
-    CuSubMatrix<BaseFloat> B_part(B, o * row_shift, num_output_rows,
-                                  0, input_num_cols);
-    A->AddDiagVecMat(alpha, c_col, B_part, kNoTrans, 1.0);
-  }
+  // As in GetAttentionDotProducts(), row i of A gets alpha times row i of C
+  // times the rows i, i + row_shift, ... of B, in one batched multiplication.
+  CuSubMatrix<BaseFloat> A_row(*A, 0, 1, 0, input_num_cols),
+      B_rows(B.Data(), context_dim, input_num_cols, row_shift * B.Stride()),
+      C_row(C, 0, 1, 0, context_dim);
+  AddMatMatStridedBatched<BaseFloat>(alpha, &A_row, A->Stride(),
+                                     C_row, C.Stride(), kNoTrans,
+                                     B_rows, B.Stride(), kNoTrans,
+                                     1.0, num_output_rows);
 }
 
 void ApplyScalesToInput(BaseFloat alpha,
@@ -85,6 +90,8 @@ void ApplyScalesToInput(BaseFloat alpha,
       context_dim = C.NumCols();
   KALDI_ASSERT(num_extra_rows > 0 && num_extra_rows % (context_dim - 1) == 0);
   int32 row_shift = num_extra_rows / (context_dim - 1);
+  // This can't be one batched multiplication like ApplyScalesToOutput(), as
+  // the rows of B that different rows of A are added to overlap.
   CuMatrix<BaseFloat> Ctrans(C, kTrans);
   for (int32 o = 0; o < context_dim; o++) {
     CuSubVector<BaseFloat> c_col(Ctrans, o);
@@ -118,6 +125,14 @@ void AttentionForward(BaseFloat key_scale,
                (output->NumCols() == value_dim ||
                 output->NumCols() == value_dim + context_dim));
 
+  if (context_dim <= CU1DBLOCK) {
+    // The dot products, the softmax and the weighted sum of the values in
+    // one pass, which avoids writing 'b' to memory and reading it back.
+    cu::ComputeRestrictedAttention(key_scale, keys, queries, values,
+                                   c, output);
+    return;
+  }
+
   CuSubMatrix<BaseFloat> queries_key_part(
       queries, 0, num_output_rows,
       0, key_dim),
@@ -183,6 +198,13 @@ void AttentionBackward(BaseFloat key_scale,
                (output_deriv.NumCols() == value_dim ||
                 output_deriv.NumCols() == value_dim + context_dim));
 
+  if (context_dim <= CU1DBLOCK) {
+    cu::BackpropRestrictedAttention(key_scale, keys, queries, values, c,
+                                    output_deriv, keys_deriv, queries_deriv,
+                                    values_deriv);
+    return;
+  }
+
   CuMatrix<BaseFloat> c_deriv(num_output_rows, context_dim,
                               kUndefined);
 
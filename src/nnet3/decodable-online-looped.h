@@ -146,6 +146,9 @@ class DecodableNnetLoopedOnline: public DecodableNnetLoopedOnlineBase {
   // returns the output-dim of the neural net.
   virtual int32 NumIndices() const { return info_.output_dim; }
 
+  // Once a frame is computed, LogLikelihood() only reads it.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   // 'subsampled_frame' is a frame, but if frame-subsampling-factor != 1, it's a
   // reduced-rate output frame (e.g. a 't' index divided by 3).  'index'
   // represents the pdf-id (or other output of the network) PLUS ONE.
@@ -178,6 +181,9 @@ class DecodableAmNnetLoopedOnline: public DecodableNnetLoopedOnlineBase {
   // returns the output-dim of the neural net.
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  // Once a frame is computed, LogLikelihood() only reads it.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   // 'subsampled_frame' is a frame, but if frame-subsampling-factor != 1, it's a
   // reduced-rate output frame (e.g. a 't' index divided by 3).
   virtual BaseFloat LogLikelihood(int32 subsampled_frame,
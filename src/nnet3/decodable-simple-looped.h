@@ -310,6 +310,9 @@ class DecodableAmNnetSimpleLooped: public DecodableInterface {
 
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  // Once a frame is computed, LogLikelihood() only reads it.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   virtual bool IsLastFrame(int32 frame) const {
     KALDI_ASSERT(frame < NumFramesReady());
     return (frame == NumFramesReady() - 1);
@@ -172,19 +172,27 @@ void OnlineNaturalGradient::PreconditionDirections(
     Init(*X_t);
 
   int32 R = W_t_.NumRows(), D = W_t_.NumCols();
-  // space for W_t, J_t, K_t, L_t.
-  CuMatrix<BaseFloat> WJKL_t(2 * R, D + R);
-  WJKL_t.Range(0, R, 0, D).CopyFromMat(W_t_);
-  BaseFloat rho_t(rho_t_);
-  Vector<BaseFloat> d_t(d_t_);
-
   bool updating = Updating();
 
   BaseFloat initial_product;
   initial_product = TraceMatMat(*X_t, *X_t, kTrans);
 
-  PreconditionDirectionsInternal(rho_t, initial_product,
-                                 updating, d_t, &WJKL_t, X_t);
+  if (!updating) {
+    // We're not updating the estimate of the Fisher matrix; we just apply the
+    // preconditioning, which only needs W_t.
+    // X_hat_t = X_t - H_t W_t, with H_t = X_t W_t^T.
+    CuMatrix<BaseFloat> H_t(X_t->NumRows(), R, kUndefined);
+    H_t.AddMatMat(1.0, *X_t, kNoTrans, W_t_, kTrans, 0.0);
+    X_t->AddMatMat(-1.0, H_t, kNoTrans, W_t_, kNoTrans, 1.0);
+  } else {
+    // space for W_t, J_t, K_t, L_t.
+    CuMatrix<BaseFloat> WJKL_t(2 * R, D + R);
+    WJKL_t.Range(0, R, 0, D).CopyFromMat(W_t_);
+    BaseFloat rho_t(rho_t_);
+    Vector<BaseFloat> d_t(d_t_);
+    PreconditionDirectionsInternal(rho_t, initial_product,
+                                   d_t, &WJKL_t, X_t);
+  }
 
   if (scale) {
     if (initial_product <= 0.0) {
@@ -323,7 +331,6 @@ void OnlineNaturalGradient::SelfTest() const {
 void OnlineNaturalGradient::PreconditionDirectionsInternal(
     const BaseFloat rho_t,
     const BaseFloat tr_X_Xt,
-    bool updating,
     const Vector<BaseFloat> &d_t,
     CuMatrixBase<BaseFloat> *WJKL_t,
     CuMatrixBase<BaseFloat> *X_t) {
@@ -345,13 +352,6 @@ void OnlineNaturalGradient::PreconditionDirectionsInternal(
 
   H_t.AddMatMat(1.0, *X_t, kNoTrans, W_t, kTrans, 0.0);  // H_t = X_t W_t^T
 
-  if (!updating) {
-    // We're not updating the estimate of the Fisher matrix; we just apply the
-    // preconditioning and return.
-    // X_hat_t = X_t - H_t W_t
-    X_t->AddMatMat(-1.0, H_t, kNoTrans, W_t, kNoTrans, 1.0);
-    return;
-  }
   J_t.AddMatMat(1.0, H_t, kTrans, *X_t, kNoTrans, 0.0);  // J_t = H_t^T X_t
 
   bool compute_lk_together = (N > D);
@@ -433,7 +433,7 @@ void OnlineNaturalGradient::PreconditionDirectionsInternal(
 
   CuMatrix<BaseFloat> W_t1(R, D);  // W_{t+1}
   ComputeWt1(N, d_t, d_t1, rho_t, rho_t1, U_t, sqrt_c_t, inv_sqrt_e_t,
-             W_t, &J_t, &W_t1);
+             WJ_t, &W_t1);
 
   if (must_reorthogonalize) {
     if (self_debug_) {
@@ -487,11 +487,11 @@ void OnlineNaturalGradient::ComputeWt1(int32 N,
                                        const MatrixBase<BaseFloat> &U_t,
                                        const VectorBase<BaseFloat> &sqrt_c_t,
                                        const VectorBase<BaseFloat> &inv_sqrt_e_t,
-                                       const CuMatrixBase<BaseFloat> &W_t,
-                                       CuMatrixBase<BaseFloat> *J_t,
+                                       const CuMatrixBase<BaseFloat> &WJ_t,
                                        CuMatrixBase<BaseFloat> *W_t1) const {
 
-  int32 R = d_t.Dim(), D = W_t.NumCols();
+  int32 R = d_t.Dim(), D = WJ_t.NumCols();
+  KALDI_ASSERT(WJ_t.NumRows() == 2 * R);
   BaseFloat eta = Eta(N);
 
   // \beta_{t+1} = \rho_{t+1} (1+\alpha) + \alpha/D tr(D_{t+1})
@@ -506,22 +506,24 @@ void OnlineNaturalGradient::ComputeWt1(int32 N,
   Vector<BaseFloat> w_t_coeff(R);
   for (int32 i = 0; i < R; i++)
     w_t_coeff(i) = (1.0 - eta) / (eta/N) * (d_t(i) + rho_t);
-  CuVector<BaseFloat> w_t_coeff_gpu(w_t_coeff);
-  // B_t = J_t + (1-\eta)/(\eta/N) (D_t + \rho_t I) W_t
-  J_t->AddDiagVecMat(1.0, w_t_coeff_gpu, W_t, kNoTrans, 1.0);
 
-  // A_t = (\eta/N) E_{t+1}^{0.5} C_t^{-0.5} U_t^T E_t^{-0.5} B_t
-  Matrix<BaseFloat> A_t(U_t, kTrans);
+  // A_t = (\eta/N) E_{t+1}^{0.5} C_t^{-0.5} U_t^T E_t^{-0.5}
+  // and, with B_t = J_t + (1-\eta)/(\eta/N) (D_t + \rho_t I) W_t,
+  // W_{t+1} = A_t B_t = [ A_t diag(w_t_coeff)  A_t ] [ W_t; J_t ],
+  // which is one transfer to the GPU and one multiplication.
+  Matrix<BaseFloat> AwA_t(R, 2 * R, kUndefined);
+  SubMatrix<BaseFloat> Aw_t(AwA_t, 0, R, 0, R), A_t(AwA_t, 0, R, R, R);
+  A_t.CopyFromMat(U_t, kTrans);
   for (int32 i = 0; i < R; i++) {
     BaseFloat i_factor = (eta / N) * sqrt_e_t1(i) * inv_sqrt_c_t(i);
     for (int32 j = 0; j < R; j++) {
       BaseFloat j_factor = inv_sqrt_e_t(j);
       A_t(i, j) *= i_factor * j_factor;
+      Aw_t(i, j) = A_t(i, j) * w_t_coeff(j);
     }
   }
-  // W_{t+1} = A_t B_t
-  CuMatrix<BaseFloat> A_t_gpu(A_t);
-  W_t1->AddMatMat(1.0, A_t_gpu, kNoTrans, *J_t, kNoTrans, 0.0);
+  CuMatrix<BaseFloat> AwA_t_gpu(AwA_t);
+  W_t1->AddMatMat(1.0, AwA_t_gpu, kNoTrans, WJ_t, kNoTrans, 0.0);
 }
 
 void OnlineNaturalGradient::ComputeZt(int32 N,
@@ -472,11 +472,11 @@ class OnlineNaturalGradient {
  private:
 
 
-  // This is an internal function called from PreconditionDirections().
+  // This is an internal function called from PreconditionDirections() when
+  // the Fisher matrix estimate is being updated.
   // Note: WJKL_t (dimension 2*R by D + R) is [ W_t L_t; J_t K_t ].
   void PreconditionDirectionsInternal(const BaseFloat rho_t,
                                       const BaseFloat tr_X_Xt,
-                                      bool updating,
                                       const Vector<BaseFloat> &d_t,
                                       CuMatrixBase<BaseFloat> *WJKL_t,
                                       CuMatrixBase<BaseFloat> *X_t);
@@ -499,7 +499,7 @@ class OnlineNaturalGradient {
                  const MatrixBase<BaseFloat> &K_t,
                  const MatrixBase<BaseFloat> &L_t,
                  SpMatrix<double> *Z_t) const;
-  // Computes W_{t+1}.  Overwrites J_t.
+  // Computes W_{t+1}.  WJ_t is [ W_t; J_t ].
   void ComputeWt1(int32 N,
                   const VectorBase<BaseFloat> &d_t,
                   const VectorBase<BaseFloat> &d_t1,
@@ -508,8 +508,7 @@ class OnlineNaturalGradient {
                   const MatrixBase<BaseFloat> &U_t,
                   const VectorBase<BaseFloat> &sqrt_c_t,
                   const VectorBase<BaseFloat> &inv_sqrt_e_t,
-                  const CuMatrixBase<BaseFloat> &W_t,
-                  CuMatrixBase<BaseFloat> *J_t,
+                  const CuMatrixBase<BaseFloat> &WJ_t,
                   CuMatrixBase<BaseFloat> *W_t1) const;
 
   // This function is called if C_t has high condition number; it makes sure
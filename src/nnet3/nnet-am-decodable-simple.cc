@@ -124,6 +124,22 @@ void DecodableNnetSimple::EnsureFrameIsComputed(int32 subsampled_frame) {
   // the output-frame numbers are the subsampled-frame numbers
   int32 first_output_frame = start_subsampled_frame * subsampling_factor,
       last_output_frame = last_subsampled_frame * subsampling_factor;
+  // With --chunk-length-quantum the last (short) chunk is computed as if the
+  // features continued (by repeating the last frame), to a multiple of the
+  // quantum, and the extra output frames are never used.
+  int32 num_computed_subsampled_frames = num_subsampled_frames;
+  if (opts_.chunk_length_quantum > 0 &&
+      num_subsampled_frames < subsampled_frames_per_chunk) {
+    int32 subsampled_quantum = std::max<int32>(
+        1, opts_.chunk_length_quantum / subsampling_factor);
+    num_computed_subsampled_frames = std::min<int32>(
+        subsampled_frames_per_chunk,
+        (num_subsampled_frames + subsampled_quantum - 1) /
+        subsampled_quantum * subsampled_quantum);
+  }
+  int32 last_computed_output_frame =
+      (start_subsampled_frame + num_computed_subsampled_frames - 1) *
+      subsampling_factor;
 
   KALDI_ASSERT(opts_.extra_left_context >= 0 && opts_.extra_right_context >= 0);
   int32 extra_left_context = opts_.extra_left_context,
@@ -136,7 +152,7 @@ void DecodableNnetSimple::EnsureFrameIsComputed(int32 subsampled_frame) {
   int32 left_context = nnet_left_context_ + extra_left_context,
       right_context = nnet_right_context_ + extra_right_context;
   int32 first_input_frame = first_output_frame - left_context,
-      last_input_frame = last_output_frame + right_context,
+      last_input_frame = last_computed_output_frame + right_context,
       num_input_frames = last_input_frame + 1 - first_input_frame;
   Vector<BaseFloat> ivector;
   GetCurrentIvector(first_output_frame,
@@ -149,7 +165,7 @@ void DecodableNnetSimple::EnsureFrameIsComputed(int32 subsampled_frame) {
     SubMatrix<BaseFloat> input_feats(feats_.RowRange(first_input_frame,
                                                      num_input_frames));
     DoNnetComputation(first_input_frame, input_feats, ivector,
-                      first_output_frame, num_subsampled_frames);
+                      first_output_frame, num_computed_subsampled_frames);
   } else {
     Matrix<BaseFloat> feats_block(num_input_frames, feats_.NumCols());
     int32 tot_input_feats = feats_.NumRows();
@@ -162,7 +178,7 @@ void DecodableNnetSimple::EnsureFrameIsComputed(int32 subsampled_frame) {
       dest.CopyFromVec(src);
     }
     DoNnetComputation(first_input_frame, feats_block, ivector,
-                      first_output_frame, num_subsampled_frames);
+                      first_output_frame, num_computed_subsampled_frames);
   }
 }
 
@@ -47,6 +47,7 @@ struct NnetSimpleComputationOptions {
   int32 extra_right_context_final;
   int32 frame_subsampling_factor;
   int32 frames_per_chunk;
+  int32 chunk_length_quantum;
   BaseFloat acoustic_scale;
   bool debug_computation;
   NnetOptimizeOptions optimize_config;
@@ -60,6 +61,7 @@ struct NnetSimpleComputationOptions {
       extra_right_context_final(-1),
       frame_subsampling_factor(1),
       frames_per_chunk(50),
+      chunk_length_quantum(0),
       acoustic_scale(0.1),
       debug_computation(false) {
     compiler_config.cache_capacity += frames_per_chunk;
@@ -92,8 +94,20 @@ struct NnetSimpleComputationOptions {
                    "by the neural net.  Measured before any subsampling, if the "
                    "--frame-subsampling-factor options is used (i.e. counts "
                    "input frames");
+    opts->Register("chunk-length-quantum", &chunk_length_quantum,
+                   "If >0, the last chunk of an utterance (which is usually "
+                   "shorter than --frames-per-chunk) is computed with its "
+                   "length rounded up to a multiple of this many frames, by "
+                   "repeating the last frame, so that fewer distinct "
+                   "computations are compiled.  The output is unchanged for "
+                   "networks without recurrence or whole-utterance "
+                   "statistics.");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
+    opts->Register("compile-cache-dir", &compiler_config.cache_dir,
+                   "If set, a directory in which compiled computations are kept "
+                   "between runs, shared by all processes using the same model "
+                   "(see also nnet3-compile-warmup)");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -300,6 +314,9 @@ class DecodableAmNnetSimple: public DecodableInterface {
 
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  // Once a frame is computed, LogLikelihood() only reads it.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   virtual bool IsLastFrame(int32 frame) const {
     KALDI_ASSERT(frame < NumFramesReady());
     return (frame == NumFramesReady() - 1);
@@ -371,6 +388,9 @@ class DecodableAmNnetSimpleParallel: public DecodableInterface {
 
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  // Once a frame is computed, LogLikelihood() only reads it.
+  virtual bool LogLikelihoodIsThreadSafe() const { return true; }
+
   virtual bool IsLastFrame(int32 frame) const {
     KALDI_ASSERT(frame < NumFramesReady());
     return (frame == NumFramesReady() - 1);
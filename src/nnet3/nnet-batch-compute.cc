@@ -22,6 +22,7 @@
 #include <iomanip>
 #include "nnet3/nnet-batch-compute.h"
 #include "nnet3/nnet-utils.h"
+#include "cudamatrix/cu-device.h"
 #include "decoder/decodable-matrix.h"
 
 namespace kaldi {
@@ -34,7 +35,7 @@ NnetBatchComputer::NnetBatchComputer(
     const VectorBase<BaseFloat> &priors):
     opts_(opts),
     nnet_(nnet),
-    compiler_(nnet_, opts.optimize_config),
+    compiler_(nnet_, opts.optimize_config, opts.compiler_config),
     log_priors_(priors),
     num_full_minibatches_(0) {
   log_priors_.ApplyLog();
@@ -136,31 +137,54 @@ NnetBatchComputer::GetHighestPriorityComputation(
     std::vector<NnetInferenceTask*> *tasks) {
   tasks->clear();
   std::unique_lock<std::mutex> lock(mutex_);
-  MapType::iterator iter = tasks_.begin(), end = tasks_.end(),
-      best_iter = tasks_.end();
-  double highest_priority = -std::numeric_limits<double>::infinity();
-
-  for (; iter != end; ++iter) {
-    ComputationGroupInfo &info = iter->second;
-    double this_priority = GetPriority(allow_partial_minibatch, info);
-    if (this_priority > highest_priority) {
-      highest_priority = this_priority;
-      best_iter = iter;
+  while (true) {
+    MapType::iterator iter = tasks_.begin(), end = tasks_.end(),
+        best_iter = tasks_.end();
+    double highest_priority = -std::numeric_limits<double>::infinity();
+
+    for (; iter != end; ++iter) {
+      ComputationGroupInfo &info = iter->second;
+      double this_priority = GetPriority(allow_partial_minibatch, info);
+      if (this_priority > highest_priority) {
+        highest_priority = this_priority;
+        best_iter = iter;
+      }
     }
+    if (best_iter == tasks_.end()) {
+      // either allow_partial_minibatch == false and there were no full
+      // minibatches, or there were no pending tasks at all.
+      return NULL;
+    }
+    ComputationGroupInfo &info = best_iter->second;
+    int32 actual_minibatch_size = GetActualMinibatchSize(info);
+    MinibatchSizeInfo *minfo = &(info.minibatch_info[actual_minibatch_size]);
+    if (minfo->computation != NULL) {
+      *minibatch_size_out = actual_minibatch_size;
+      GetHighestPriorityTasks(actual_minibatch_size, &info, tasks);
+      return minfo;
+    }
+    if (minfo->is_compiling) {
+      // Another thread is compiling it; wait for that, then look again.
+      while (minfo->is_compiling)
+        compiled_cond_.wait(lock);
+      continue;
+    }
+    // Compile without holding the mutex, so that other threads can run
+    // minibatches and AcceptTask() is not blocked meanwhile.  (Note: elements
+    // of tasks_ and of minibatch_info are never erased, so 'minfo' stays
+    // valid.)  The tasks may have changed by the time we have the lock again,
+    // so we then look again for the highest-priority group.
+    minfo->is_compiling = true;
+    ComputationRequest request;
+    GetComputationRequest(*(info.tasks[0]), actual_minibatch_size, &request);
+    lock.unlock();
+    std::shared_ptr<const NnetComputation> computation =
+        compiler_.Compile(request);
+    lock.lock();
+    minfo->computation = computation;
+    minfo->is_compiling = false;
+    compiled_cond_.notify_all();
   }
-  if (best_iter == tasks_.end()) {
-    // either allow_partial_minibatch == false and there were no full
-    // minibatches, or there were no pending tasks at all.
-    return NULL;
-  }
-  ComputationGroupInfo &info = best_iter->second;
-  int32 actual_minibatch_size = GetActualMinibatchSize(info);
-  *minibatch_size_out = actual_minibatch_size;
-  MinibatchSizeInfo *minfo = &(info.minibatch_info[actual_minibatch_size]);
-  if (minfo->computation == NULL)
-    minfo->computation = GetComputation(info, actual_minibatch_size);
-  GetHighestPriorityTasks(actual_minibatch_size, &info, tasks);
-  return minfo;
 }
 
 
@@ -249,19 +273,6 @@ int32 NnetBatchComputer::GetActualMinibatchSize(
 }
 
 
-std::shared_ptr<const NnetComputation> NnetBatchComputer::GetComputation(
-    const ComputationGroupInfo &info,
-    int32 minibatch_size) {
-  KALDI_ASSERT(!info.tasks.empty());
-  // note: all the tasks will have the same structure, in the respects that
-  // would affect the computation.
-  NnetInferenceTask *example_task = info.tasks[0];
-  ComputationRequest request;
-  GetComputationRequest(*example_task, minibatch_size, &request);
-  return compiler_.Compile(request);
-}
-
-
 double NnetBatchComputer::GetPriority(bool allow_partial_minibatch,
                                       const ComputationGroupInfo &info) const {
   if (info.tasks.empty())
@@ -395,8 +406,8 @@ void NnetBatchComputer::FormatInputs(
   KALDI_ASSERT(num_tasks > 0 && num_tasks <= minibatch_size);
 
   // We first aggregate the input frames and i-vectors in matrices on the CPU,
-  // and then transfer them to the GPU.  Later on we'll change this code to
-  // used pinned memory.
+  // and then transfer them to the GPU, asynchronously (via pinned memory) so
+  // that we can go on with the rest of the setup while they are copied.
   Matrix<BaseFloat> input_cpu(num_tasks * num_input_frames, input_dim,
                               kUndefined);
 
@@ -409,7 +420,8 @@ void NnetBatchComputer::FormatInputs(
   }
   input->Resize(minibatch_size * num_input_frames, input_dim,
                 kUndefined);
-  input->RowRange(0, num_tasks * num_input_frames).CopyFromMat(input_cpu);
+  input->RowRange(0, num_tasks * num_input_frames).CopyFromMatAsync(
+      input_cpu);
   if (num_tasks < minibatch_size) {
     // The following will make things easier to debug if something fails, but
     // shouldn't be strictly necessary.
@@ -424,7 +436,7 @@ void NnetBatchComputer::FormatInputs(
       ivectors_cpu.Row(n).CopyFromVec(tasks[n]->ivector);
 
     ivector->Resize(minibatch_size, ivector_dim, kUndefined);
-    ivector->RowRange(0, num_tasks).CopyFromMat(ivectors_cpu);
+    ivector->RowRange(0, num_tasks).CopyFromMatAsync(ivectors_cpu);
 
     if (num_tasks < minibatch_size) {
       // The following will make things easier to debug if something fails, but
@@ -444,13 +456,10 @@ void NnetBatchComputer::FormatOutputs(
       num_tasks = tasks.size();
   bool did_output_to_gpu = false;
 
-  // Note: it may not be optimal to do so many individual calls to copy the
-  // output to CPU; we'd have to test that, as I'm not sure how much the latency
-  // of a GPU call is.  On the other hand, the downsides of one big call are
-  // that we'd have to make another copy in CPU memory; and also we might not be
-  // able to take advantage if not all frames of the output are used.
-
-  // Also, we should probably used pinned memory.
+  // The copies of the output to CPU are queued asynchronously (via pinned
+  // memory) and waited for together by FinishAsyncCopies() below, so the
+  // latency of each is not paid separately; and this way we don't copy the
+  // frames of the output that are not used.
 
   // We don't bother zeroing frames of the output that are unused, but you could
   // un-comment the commented lines of code below to do so.
@@ -461,13 +470,20 @@ void NnetBatchComputer::FormatOutputs(
         used = task->num_used_output_frames;
      // int32 right_unused = num_output_frames - used - left_unused;
 
-    if (task->output_to_cpu) {
+    if (task->output_to_cpu && task->output_to_pinned) {
+      // nothing waits for this copy here: the user of the task does.
+      task->output_pinned.Resize(used, output_dim);
+      task->output_pinned.CopyRowsFromCuMatAsync(
+          output.RowRange(n * num_output_frames + left_unused, used), 0);
+    } else if (task->output_to_cpu) {
       task->output_cpu.Resize(num_output_frames, output_dim,
                               kUndefined);
       // if (left_unused > 0)
       //   task->output_cpu.RowRange(0, left_unused).SetZero();
-      task->output_cpu.RowRange(left_unused, used).CopyFromMat(
-          output.RowRange(n * num_output_frames + left_unused, used));
+      SubMatrix<BaseFloat> output_part(task->output_cpu.RowRange(left_unused,
+                                                                 used));
+      output.RowRange(n * num_output_frames + left_unused,
+                      used).CopyToMatAsync(&output_part);
       // if (right_unused > 0)
       //   task->output_cpu.RowRange(0, left_unused + used, right_unused).SetZero();
     } else {
@@ -482,6 +498,7 @@ void NnetBatchComputer::FormatOutputs(
       //   task->output.RowRange(0, left_unused + used, right_unused).SetZero();
     }
   }
+  FinishAsyncCopies();
   // The output of this function will likely be consumed by another thread.
   // The following call will make sure the relevant kernels complete before
   // any kernels from the other thread use the output.
@@ -545,10 +562,14 @@ bool NnetBatchComputer::Compute(bool allow_partial_minibatch) {
   output.Scale(opts_.acoustic_scale);
   FormatOutputs(output, tasks);
 
-  // Update the stats, for diagnostics.
-  minfo->num_done++;
-  minfo->tot_num_tasks += static_cast<int64>(tasks.size());
-  minfo->seconds_taken += tim.Elapsed();
+  // Update the stats, for diagnostics.  Several threads may be in Compute()
+  // at once, so this is done under the mutex.
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    minfo->num_done++;
+    minfo->tot_num_tasks += static_cast<int64>(tasks.size());
+    minfo->seconds_taken += tim.Elapsed();
+  }
 
 
   SynchronizeGpu();
@@ -822,6 +843,7 @@ void NnetBatchComputer::SplitUtteranceIntoTasks(
 
   for (size_t i = 0; i < tasks->size(); i++) {
     (*tasks)[i].output_to_cpu = output_to_cpu;
+    (*tasks)[i].output_to_pinned = false;
     // The priority will be set by the user; this just avoids undefined
     // behavior.
     (*tasks)[i].priority = 0.0;
@@ -837,6 +859,8 @@ void MergeTaskOutput(
       output_dim = -1;
   for (int32 i = 0; i < num_tasks; i++) {
     const NnetInferenceTask &task = tasks[i];
+    KALDI_ASSERT(!(task.output_to_cpu && task.output_to_pinned) &&
+                 "MergeTaskOutput() does not support output_to_pinned");
     num_output_frames += task.num_used_output_frames;
     if (i == 0) {
       output_dim = (task.output_to_cpu ?
@@ -864,6 +888,43 @@ void MergeTaskOutput(
   KALDI_ASSERT(cur_output_frame == num_output_frames);
 }
 
+void MergeTaskOutput(
+    const std::vector<NnetInferenceTask> &tasks,
+    CuMatrix<BaseFloat> *output) {
+  int32 num_tasks = tasks.size(),
+      num_output_frames = 0,
+      output_dim = -1;
+  for (int32 i = 0; i < num_tasks; i++) {
+    const NnetInferenceTask &task = tasks[i];
+    KALDI_ASSERT(!(task.output_to_cpu && task.output_to_pinned) &&
+                 "MergeTaskOutput() does not support output_to_pinned");
+    num_output_frames += task.num_used_output_frames;
+    if (i == 0) {
+      output_dim = (task.output_to_cpu ?
+                    task.output_cpu.NumCols() :
+                    task.output.NumCols());
+    }
+  }
+  KALDI_ASSERT(num_output_frames != 0 && output_dim != 0);
+  int32 cur_output_frame = 0;
+  output->Resize(num_output_frames, output_dim, kUndefined);
+  for (int32 i = 0; i < num_tasks; i++) {
+    const NnetInferenceTask &task = tasks[i];
+    int32 skip = task.num_initial_unused_output_frames,
+        num_used = task.num_used_output_frames;
+    KALDI_ASSERT(cur_output_frame == task.first_used_output_frame_index);
+    if (task.output_to_cpu) {
+      output->RowRange(cur_output_frame, num_used).CopyFromMat(
+          task.output_cpu.RowRange(skip, num_used));
+    } else {
+      output->RowRange(cur_output_frame, num_used).CopyFromMat(
+          task.output.RowRange(skip, num_used));
+    }
+    cur_output_frame += num_used;
+  }
+  KALDI_ASSERT(cur_output_frame == num_output_frames);
+}
+
 
 NnetBatchInference::NnetBatchInference(
     const NnetBatchComputerOptions &opts,
@@ -872,8 +933,11 @@ NnetBatchInference::NnetBatchInference(
     computer_(opts, nnet, priors),
     is_finished_(false),
     utterance_counter_(0) {
-  // 'thread_' will run the Compute() function in the background.
-  compute_thread_ = std::thread(ComputeFunc, this);
+  // 'compute_threads_' will run the Compute() function in the background.
+  int32 num_compute_threads = opts.num_compute_threads;
+  KALDI_ASSERT(num_compute_threads > 0);
+  for (int32 i = 0; i < num_compute_threads; i++)
+    compute_threads_.push_back(std::thread(ComputeFunc, this));
 }
 
 
@@ -944,12 +1008,15 @@ NnetBatchInference::~NnetBatchInference() {
     KALDI_ERR << "Object destroyed before Finished() was called.";
   if (!utts_.empty())
     KALDI_ERR << "You should get all output before destroying this object.";
-  compute_thread_.join();
+  for (size_t i = 0; i < compute_threads_.size(); i++)
+    compute_threads_[i].join();
 }
 
 void NnetBatchInference::Finished() {
   is_finished_ = true;
-  tasks_ready_semaphore_.Signal();
+  // wake every compute thread, so they all flush and exit.
+  for (size_t i = 0; i < compute_threads_.size(); i++)
+    tasks_ready_semaphore_.Signal();
 }
 
 // This is run as the thread of class NnetBatchInference.
@@ -987,7 +1054,10 @@ NnetBatchDecoder::NnetBatchDecoder(
   KALDI_ASSERT(num_threads > 0);
   for (int32 i = 0; i < num_threads; i++)
     decode_threads_.push_back(new std::thread(DecodeFunc, this));
-  compute_thread_ = std::thread(ComputeFunc, this);
+  int32 num_compute_threads = computer_->GetOptions().num_compute_threads;
+  KALDI_ASSERT(num_compute_threads > 0);
+  for (int32 i = 0; i < num_compute_threads; i++)
+    compute_threads_.push_back(std::thread(ComputeFunc, this));
 }
 
 void NnetBatchDecoder::SetPriorities(std::vector<NnetInferenceTask> *tasks) {
@@ -1042,8 +1112,10 @@ int32 NnetBatchDecoder::Finished() {
   // compute timing.
 
   tasks_finished_ = true;
-  tasks_ready_semaphore_.Signal();
-  compute_thread_.join();
+  for (size_t i = 0; i < compute_threads_.size(); i++)
+    tasks_ready_semaphore_.Signal();
+  for (size_t i = 0; i < compute_threads_.size(); i++)
+    compute_threads_[i].join();
   return num_success_;
 }
 
@@ -1141,6 +1213,10 @@ void NnetBatchDecoder::Decode() {
                                          input_utterance.online_ivectors,
                                          input_utterance.online_ivector_period,
                                          &tasks);
+      // the GPU copies the output straight to pinned memory that we decode
+      // from, and the computation does not wait for the copies.
+      for (size_t i = 0; i < tasks.size(); i++)
+        tasks[i].output_to_pinned = true;
       KALDI_ASSERT(output_utterance->utterance_id == utterance_id);
       input_consumed_semaphore_.Signal();
       // Now let input_utterance go out of scope; it's no longer valid as it may
@@ -1163,14 +1239,12 @@ void NnetBatchDecoder::Decode() {
         task.semaphore.Wait();
         UpdatePriorityOffset(task.priority);
 
-        SubMatrix<BaseFloat> post(task.output_cpu,
-                                  task.num_initial_unused_output_frames,
-                                  task.num_used_output_frames,
-                                  0, task.output_cpu.NumCols());
+        task.output_pinned.Wait();
+        SubMatrix<BaseFloat> post(task.output_pinned.Mat());
         DecodableMatrixMapped decodable(trans_model_, post, frame_offset);
         frame_offset += post.NumRows();
         decoder.AdvanceDecoding(&decodable);
-        task.output.Resize(0, 0);  // Free some memory.
+        task.output_pinned.Resize(0, 0);  // Free some memory.
       }
 
       bool use_final_probs = true;
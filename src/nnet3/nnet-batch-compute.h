@@ -34,6 +34,7 @@
 #include "nnet3/nnet-compute.h"
 #include "nnet3/am-nnet-simple.h"
 #include "nnet3/nnet-am-decodable-simple.h"
+#include "cudamatrix/cu-pinned-matrix.h"
 #include "decoder/lattice-faster-decoder.h"
 #include "util/stl-utils.h"
 
@@ -53,7 +54,7 @@ struct NnetInferenceTask {
   NnetInferenceTask(const NnetInferenceTask &other) {
     KALDI_ERR << "NnetInferenceTask was not designed to be copied.";
   }
-  NnetInferenceTask() { }
+  NnetInferenceTask(): output_to_pinned(false) { }
 
 
   // The input frames, which are treated as being numbered t=0, t=1, etc.  (If
@@ -138,6 +139,16 @@ struct NnetInferenceTask {
 
   // The output goes here instead of 'output_to_cpu' is false.
   CuMatrix<BaseFloat> output;
+
+  // If the caller sets this to true (it is set to false by
+  // SplitUtteranceIntoTasks()) and 'output_to_cpu' is true, the used output
+  // frames (only those: num_used_output_frames rows, starting from the row
+  // numbered num_initial_unused_output_frames of the output) go to
+  // 'output_pinned' instead of 'output_cpu'.  The GPU copies them there
+  // directly, and the semaphore is signaled as soon as the copy is queued, so
+  // the user must call output_pinned.Wait() before reading them.
+  bool output_to_pinned;
+  CuPinnedMatrix output_pinned;
 };
 
 
@@ -146,11 +157,13 @@ struct NnetBatchComputerOptions: public NnetSimpleComputationOptions {
   int32 edge_minibatch_size;
   bool ensure_exact_final_context;
   BaseFloat partial_minibatch_factor;
+  int32 num_compute_threads;
 
   NnetBatchComputerOptions(): minibatch_size(128),
                               edge_minibatch_size(32),
                               ensure_exact_final_context(false),
-                              partial_minibatch_factor(0.5) {
+                              partial_minibatch_factor(0.5),
+                              num_compute_threads(1) {
   }
 
   void Register(OptionsItf *po) {
@@ -174,6 +187,12 @@ struct NnetBatchComputerOptions: public NnetSimpleComputationOptions {
                  "for sizes: int(partial_minibatch_factor^n * minibatch_size "
                  ", for n = 0, 1, 2....  Set it to 0.0 if you want to use "
                  "only the specified minibatch sizes.");
+    po->Register("num-compute-threads", &num_compute_threads,
+                 "Number of threads that run minibatches of the neural net "
+                 "(used by NnetBatchInference and NnetBatchDecoder).  With "
+                 "more than one, each thread has its own GPU stream, so the "
+                 "formatting and compilation of one minibatch on the CPU "
+                 "overlap with the computation of another on the GPU.");
   }
 };
 
@@ -194,6 +213,12 @@ void MergeTaskOutput(
     const std::vector<NnetInferenceTask> &tasks,
     Matrix<BaseFloat> *output);
 
+/// As the other MergeTaskOutput(), but into a GPU matrix, for when the output
+/// is to stay on the GPU (e.g. for CudaLatticeBatchDecoder).
+void MergeTaskOutput(
+    const std::vector<NnetInferenceTask> &tasks,
+    CuMatrix<BaseFloat> *output);
+
 /**
    This class does neural net inference in a way that is optimized for GPU use:
    it combines chunks of multiple utterances into minibatches for more efficient
@@ -234,7 +259,9 @@ class NnetBatchComputer {
       Does some kind of computation, choosing the highest-priority thing to
       compute.  It returns true if it did some kind of computation, and false
       otherwise.  This function locks the class, but not for the entire time
-      it's being called: only at the beginning and at the end.
+      it's being called: only at the beginning and at the end, so it may
+      be called from several threads at once (see num_compute_threads in
+      NnetBatchComputerOptions).
         @param [in] allow_partial_minibatch  If false, then this will only
               do the computation if a full minibatch is ready; if true, it
               is allowed to do computation on partial (not-full) minibatches.
@@ -285,8 +312,11 @@ class NnetBatchComputer {
     // how 'full', on average, these minibatches were.
     double seconds_taken;  // The total time elapsed in computation for this
                           // minibatch type.
+    bool is_compiling;  // True while a thread compiles 'computation' (without
+                        // holding mutex_).
     MinibatchSizeInfo(): computation(NULL), num_done(0),
-                         tot_num_tasks(0), seconds_taken(0.0) { }
+                         tot_num_tasks(0), seconds_taken(0.0),
+                         is_compiling(false) { }
   };
 
 
@@ -354,14 +384,6 @@ class NnetBatchComputer {
   inline int32 GetMinibatchSize(const ComputationGroupInfo &info) const;
 
 
-  // This function compiles, and returns, a computation for tasks of
-  // the structure present in info.tasks[0], and the specified minibatch
-  // size.
-  std::shared_ptr<const NnetComputation> GetComputation(
-      const ComputationGroupInfo &info,
-      int32 minibatch_size);
-
-
   // Returns the actual minibatch size we'll use for this computation.  In most
   // cases it will be opts_.minibatch_size (or opts_.edge_minibatch_size if
   // appropriate; but if the number of available tasks is much less than the
@@ -427,8 +449,9 @@ class NnetBatchComputer {
                     CuMatrix<BaseFloat> *ivector);
 
 
-  // Copies 'output', piece by piece, to the 'output_cpu' or 'output'
-  // members of 'tasks', depending on their 'output_to_cpu' value.
+  // Copies 'output', piece by piece, to the 'output_cpu', 'output_pinned' or
+  // 'output' members of 'tasks', depending on their 'output_to_cpu' and
+  // 'output_to_pinned' values.
   void FormatOutputs(const CuMatrix<BaseFloat> &output,
                      const std::vector<NnetInferenceTask*> &tasks);
 
@@ -453,9 +476,13 @@ class NnetBatchComputer {
   CuVector<BaseFloat> log_priors_;
 
   // Mutex that guards this object.  It is only held for fairly quick operations
-  // (not while the actual computation is being done).
+  // (not while computations are being compiled or done).
   std::mutex mutex_;
 
+  // Notified when a thread has finished compiling a computation (see
+  // MinibatchSizeInfo::is_compiling).
+  std::condition_variable compiled_cond_;
+
   // tasks_ contains all the queued tasks.
   // Each key contains a vector of NnetInferenceTask* pointers, of the same
   // structure (i.e., IsCompatible() returns true).
@@ -588,8 +615,9 @@ class NnetBatchInference {
 
   int32 utterance_counter_;  // counter that increases on every utterance.
 
-  // The thread running the Compute() process.
-  std::thread compute_thread_;
+  // The threads running the Compute() process; there are
+  // opts.num_compute_threads of them.
+  std::vector<std::thread> compute_threads_;
 };
 
 
@@ -770,7 +798,9 @@ class NnetBatchDecoder {
   bool allow_partial_;
   NnetBatchComputer *computer_;
   std::vector<std::thread*> decode_threads_;
-  std::thread compute_thread_;  // Thread that calls computer_->Compute().
+  // Threads that call computer_->Compute(); there are
+  // computer_->GetOptions().num_compute_threads of them.
+  std::vector<std::thread> compute_threads_;
 
 
   // 'input_utterance', together with utterance_ready_semaphore_ and
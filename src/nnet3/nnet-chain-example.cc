@@ -455,6 +455,12 @@ ChainExampleMerger::ChainExampleMerger(const ExampleMergingConfig &config,
     finished_(false), num_egs_written_(0),
     config_(config), writer_(writer) { }
 
+ChainExampleMerger::ChainExampleMerger(
+    const ExampleMergingConfig &config,
+    const std::function<void(NnetChainExample*)> &output):
+    finished_(false), num_egs_written_(0),
+    config_(config), writer_(NULL), output_(output) { }
+
 
 void ChainExampleMerger::AcceptExample(NnetChainExample *eg) {
   KALDI_ASSERT(!finished_);
@@ -497,6 +503,13 @@ void ChainExampleMerger::WriteMinibatch(
   stats_.WroteExample(eg_size, structure_hash, minibatch_size);
   NnetChainExample merged_eg;
   MergeChainExamples(config_.compress, egs, &merged_eg);
+  if (writer_ == NULL) {
+    num_egs_written_++;
+    NnetChainExample *eg = new NnetChainExample();
+    eg->Swap(&merged_eg);
+    output_(eg);
+    return;
+  }
   std::ostringstream key;
   key << "merged-" << (num_egs_written_++) << "-" << minibatch_size;
   writer_->Write(key.str(), merged_eg);
@@ -26,6 +26,7 @@
 #include "util/table-types.h"
 #include "nnet3/nnet-example.h"
 #include "nnet3/nnet-example-utils.h"
+#include "nnet3/nnet-example-loader.h"
 #include "chain/chain-supervision.h"
 
 namespace kaldi {
@@ -236,6 +237,11 @@ class ChainExampleMerger {
   ChainExampleMerger(const ExampleMergingConfig &config,
                      NnetChainExampleWriter *writer);
 
+  // As above, but the merged examples are passed to 'output' (which takes
+  // ownership of them) instead of being written.
+  ChainExampleMerger(const ExampleMergingConfig &config,
+                     const std::function<void(NnetChainExample*)> &output);
+
   // This function accepts an example, and if possible, writes a merged example
   // out.  The ownership of the pointer 'a' is transferred to this class when
   // you call this function.
@@ -263,6 +269,7 @@ class ChainExampleMerger {
   int32 num_egs_written_;
   const ExampleMergingConfig &config_;
   NnetChainExampleWriter *writer_;
+  std::function<void(NnetChainExample*)> output_;
   ExampleMergingStats stats_;
 
   // Note: the "key" into the egs is the first element of the vector.
@@ -273,6 +280,12 @@ class ChainExampleMerger {
 MapType eg_to_egs_;
 };
 
+/// Reads, shuffles and merges chain examples in background threads, see
+/// GenericExampleLoader in nnet-example-loader.h.
+typedef GenericExampleLoader<NnetChainExample,
+                             SequentialNnetChainExampleReader,
+                             ChainExampleMerger> NnetChainExampleLoader;
+
 
 
 } // namespace nnet3
@@ -77,12 +77,12 @@ void NnetChainTrainer::Train(const NnetChainExample &chain_eg) {
     KALDI_ASSERT(nnet_config.momentum == 0.0);
     FreezeNaturalGradient(true, delta_nnet_);
     bool is_backstitch_step1 = true;
-    srand(srand_seed_ + num_minibatches_processed_);
+    RandSeed(srand_seed_ + num_minibatches_processed_);
     ResetGenerators(nnet_);
     TrainInternalBackstitch(chain_eg, *computation, is_backstitch_step1);
     FreezeNaturalGradient(false, delta_nnet_); // un-freeze natural gradient
     is_backstitch_step1 = false;
-    srand(srand_seed_ + num_minibatches_processed_);
+    RandSeed(srand_seed_ + num_minibatches_processed_);
     ResetGenerators(nnet_);
     TrainInternalBackstitch(chain_eg, *computation, is_backstitch_step1);
   } else { // conventional training
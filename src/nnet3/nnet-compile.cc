@@ -22,6 +22,7 @@
 #include "nnet3/nnet-compile.h"
 #include "nnet3/nnet-compile-utils.h"
 #include "nnet3/nnet-optimize.h"  // just for ConsolidateIoOperations().
+#include "base/timer.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -50,6 +51,7 @@ Compiler::Compiler(
 void Compiler::CreateComputation(const CompilerOptions &opts,
                                  NnetComputation *computation) {
   computation->Clear();
+  Timer timer;
   ComputationGraphBuilder builder(nnet_, &graph_);
   // note: there are only >1 segments in a 'looped' computation.
   for (size_t segment = 0; segment < requests_.size(); segment++) {
@@ -60,6 +62,8 @@ void Compiler::CreateComputation(const CompilerOptions &opts,
     }
     builder.Prune();
   }
+  KALDI_VLOG(2) << "Built the computation graph (" << graph_.cindexes.size()
+                << " cindexes) in " << timer.Elapsed() << " seconds";
   // see function declaration's comment for more on the meaning of "phases" (a
   // phase will later be decomposed into one or more steps).  for each segment
   // s, phases_per_segment[s] is a list of phases; each phase is a list of
@@ -28,6 +28,7 @@
 #include "nnet3/nnet-general-component.h"
 #include "nnet3/nnet-convolutional-component.h"
 #include "nnet3/nnet-attention-component.h"
+#include "nnet3/nnet-quantized-component.h"
 #include "nnet3/nnet-parse.h"
 #include "nnet3/nnet-computation-graph.h"
 
@@ -185,6 +186,10 @@ Component* Component::NewComponentOfType(const std::string &component_type) {
     ans = new OutputGruNonlinearityComponent();
   } else if (component_type == "ScaleAndOffsetComponent") {
     ans = new ScaleAndOffsetComponent();
+  } else if (component_type == "QuantizedAffineComponent") {
+    ans = new QuantizedAffineComponent();
+  } else if (component_type == "QuantizedTdnnComponent") {
+    ans = new QuantizedTdnnComponent();
   }
   if (ans != NULL) {
     KALDI_ASSERT(component_type == ans->Type());
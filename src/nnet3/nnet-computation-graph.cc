@@ -25,15 +25,42 @@ namespace kaldi {
 namespace nnet3 {
 
 
+size_t ComputationGraph::FindSlot(const Cindex &cindex) const {
+  KALDI_PARANOID_ASSERT(!cindex_hash_.empty());
+  // CindexHasher is a linear function of the members, so its low bits are a
+  // poor key for a power-of-two table; the multiplication (by 2^64 over the
+  // golden ratio) mixes them into the high bits, which we use.
+  CindexHasher hasher;
+  uint64 hash = static_cast<uint64>(hasher(cindex)) * 11400714819323198485ULL;
+  size_t mask = cindex_hash_.size() - 1,
+      slot = static_cast<size_t>(hash >> 32) & mask;
+  while (true) {
+    int32 cindex_id = cindex_hash_[slot];
+    if (cindex_id == -1 || cindexes[cindex_id] == cindex)
+      return slot;
+    slot = (slot + 1) & mask;
+  }
+}
+
+void ComputationGraph::Rehash(size_t num_cindexes) {
+  size_t size = 16;
+  while (size < 2 * num_cindexes)
+    size *= 2;
+  cindex_hash_.assign(size, -1);
+  for (size_t c = 0; c < cindexes.size(); c++)
+    cindex_hash_[FindSlot(cindexes[c])] = c;
+}
+
 int32 ComputationGraph::GetCindexId(const Cindex &cindex,
                                     bool input, bool *is_new) {
-  typedef unordered_map<Cindex, int32, CindexHasher> map_type;
-  int32 new_index = cindexes.size();  // we'll add this if we don't find it.
-  std::pair<map_type::iterator, bool> p = cindex_to_cindex_id_.insert(
-      std::pair<Cindex, int32>(cindex, new_index));
-  if (p.second == true) {  // We added something to the hash.
+  if (2 * (cindexes.size() + 1) > cindex_hash_.size())
+    Rehash(2 * (cindexes.size() + 1));
+  size_t slot = FindSlot(cindex);
+  if (cindex_hash_[slot] == -1) {  // We add it.
+    int32 new_index = cindexes.size();
     *is_new = true;
     KALDI_ASSERT(is_input.size() == cindexes.size());
+    cindex_hash_[slot] = new_index;
     cindexes.push_back(cindex);
     is_input.push_back(input);
     // make room for this "dependencies" entry.
@@ -41,16 +68,13 @@ int32 ComputationGraph::GetCindexId(const Cindex &cindex,
     return new_index;
   } else { // We did not add anything.
     *is_new = false;
-    return p.first->second;
+    return cindex_hash_[slot];
   }
 }
 int32 ComputationGraph::GetCindexId(const Cindex &cindex) const {
-  typedef unordered_map<Cindex, int32, CindexHasher> map_type;
-  map_type::const_iterator iter = cindex_to_cindex_id_.find(cindex);
-  if (iter == cindex_to_cindex_id_.end())
+  if (cindex_hash_.empty())
     return -1;
-  else
-    return iter->second;
+  return cindex_hash_[FindSlot(cindex)];
 }
 
 
@@ -79,17 +103,6 @@ void ComputationGraph::Renumber(int32 start_cindex_id,
     return;
   }
 
-  for (int32 old_cindex_id = start_cindex_id;
-       old_cindex_id < old_num_cindex_ids; old_cindex_id++) {
-    int32 new_cindex_id = old2new[old_cindex_id - start_cindex_id];
-    Cindex &cindex = cindexes[old_cindex_id];
-    if (new_cindex_id == -1) {
-      cindex_to_cindex_id_.erase(cindex);
-    } else if (new_cindex_id != old_cindex_id) {
-      cindex_to_cindex_id_[cindex] = new_cindex_id;
-    }
-  }
-
   std::vector<int32> temp;
   for (int32 c = start_cindex_id; c < new_num_cindex_ids; c++) {
     int32 d = new2old[c - start_cindex_id];
@@ -120,6 +133,9 @@ void ComputationGraph::Renumber(int32 start_cindex_id,
   cindexes.resize(new_num_cindex_ids);
   is_input.resize(new_num_cindex_ids);
   dependencies.resize(new_num_cindex_ids);
+  // removing entries from a linear-probing table is awkward, and this loop
+  // is no slower than the one above.
+  Rehash(new_num_cindex_ids);
 }
 
 void ComputationGraphBuilder::PrintCindexId(std::ostream &os,
@@ -644,7 +660,9 @@ void ComputationGraphBuilder::AddDependencies(int32 cindex_id) {
   const Index &index = cindex.second;
   const NetworkNode &node = nnet_.GetNode(node_index);
 
-  std::vector<Cindex> input_cindexes;
+  // input_cindexes_ and input_indexes_ are members only so that their memory
+  // is reused; this is called for every cindex in the graph.
+  std::vector<Cindex> &input_cindexes = input_cindexes_;
 
   // the following switch statement sets up "input_cindexes".
   switch (node.node_type) {
@@ -657,7 +675,7 @@ void ComputationGraphBuilder::AddDependencies(int32 cindex_id) {
     case kComponent: {
       int32 c = node.u.component_index;
       const Component *component = nnet_.GetComponent(c);
-      std::vector<Index> input_indexes;
+      std::vector<Index> &input_indexes = input_indexes_;
       component->GetInputIndexes(request_->misc_info, index,
                                  &input_indexes);
       input_cindexes.resize(input_indexes.size());
@@ -673,6 +691,7 @@ void ComputationGraphBuilder::AddDependencies(int32 cindex_id) {
       break;
     }
     case kInput:
+      input_cindexes.clear();
       break;  // There will be no dependencies.
     default:
       KALDI_ERR << "Invalid node type";
@@ -732,6 +751,20 @@ void ComputationGraphBuilder::AddDependencies(int32 cindex_id) {
 }
 
 
+bool ComputationGraphBuilder::AllDependenciesComputable(
+    int32 cindex_id) const {
+  const std::vector<int32> &dependencies = graph_->dependencies[cindex_id];
+  // with no inputs, only the descriptor or component can tell.
+  if (dependencies.empty())
+    return false;
+  std::vector<int32>::const_iterator iter = dependencies.begin(),
+      end = dependencies.end();
+  for (; iter != end; ++iter)
+    if (computable_info_[*iter] != kComputable)
+      return false;
+  return true;
+}
+
 ComputationGraphBuilder::ComputableInfo
 ComputationGraphBuilder::ComputeComputableInfo(int32 cindex_id)
     const {
@@ -739,6 +772,13 @@ ComputationGraphBuilder::ComputeComputableInfo(int32 cindex_id)
   int32 node_id = cindex.first;
   const Index &index = cindex.second;
   const NetworkNode &node = nnet_.GetNode(node_id);
+  if ((node.node_type == kDescriptor || node.node_type == kComponent) &&
+      AllDependenciesComputable(cindex_id)) {
+    // a descriptor or component can compute its output from all of the inputs
+    // it asked for, so there is no need to evaluate it again; this is called
+    // each time the computable status of an input changes.
+    return kComputable;
+  }
   switch (node.node_type) {
     case kDescriptor: {
       const Descriptor &desc = node.descriptor;
@@ -106,9 +106,22 @@ struct ComputationGraph {
   void Print(std::ostream &os, const std::vector<std::string> &node_names);
 
  private:
+  /// Returns the slot of "cindex" in cindex_hash_: the one holding its
+  /// cindex_id, or else the empty slot where it would go.
+  size_t FindSlot(const Cindex &cindex) const;
+
+  /// Rebuilds cindex_hash_ from "cindexes", with room for at least
+  /// "num_cindexes" of them.
+  void Rehash(size_t num_cindexes);
+
   /// Maps each Cindex to an integer cindex_id: reverse mapping of "cindexes".
-  /// Must be accessed via the GetCindexId() functions.
-  unordered_map<Cindex, int32, CindexHasher> cindex_to_cindex_id_;
+  /// Must be accessed via the GetCindexId() functions.  It is a flat hash
+  /// table with linear probing, of cindex_ids (the Cindexes themselves are
+  /// only stored in "cindexes"), with -1 in the empty slots; its size is a
+  /// power of two and it is at most half full.  Large graphs have millions of
+  /// cindexes, and this is much faster to build than an unordered_map, which
+  /// allocates a node for each of them.
+  std::vector<int32> cindex_hash_;
 };
 
 
@@ -206,6 +219,10 @@ class ComputationGraphBuilder {
   // kComputable or kNotComputable).
   ComputableInfo ComputeComputableInfo(int32 cindex_id) const;
 
+  // returns true if this cindex_id has dependencies and they are all
+  // kComputable; a quick test used by ComputeComputableInfo().
+  bool AllDependenciesComputable(int32 cindex_id) const;
+
   // To be called when this cindex_id has just been newly added to graph_, this
   // function adds various initial variables associated with it, to *this.
   // is_input should be set to true if this cindex-id is being added as an input
@@ -252,6 +269,10 @@ class ComputationGraphBuilder {
   const ComputationRequest *request_;
   ComputationGraph *graph_;
 
+  // temporaries of AddDependencies().
+  std::vector<Cindex> input_cindexes_;
+  std::vector<Index> input_indexes_;
+
   // this is the transpose of graph_->dependencies; it tells us
   // for each cindex_id, which other cindex_ids depend on it.
   std::vector<std::vector<int32> > depend_on_this_;
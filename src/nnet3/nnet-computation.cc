@@ -549,7 +549,10 @@ static void PrintCommand(std::ostream &os_out,
       if (c.arg2 == 0) os << "NULL, ";
       else os << "precomputed_indexes[" << c.arg2 << "], ";
       os << submatrix_strings[c.arg3] << ", &" << submatrix_strings[c.arg4]
-         << ")\n";
+         << ")";
+      if (c.arg7 > 1)
+        os << " [chain of " << c.arg7 << " commands]";
+      os << "\n";
       break;
     case kBackprop:
     case kBackpropNoModelUpdate: {
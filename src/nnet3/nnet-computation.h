@@ -205,6 +205,9 @@ struct ComputationRequestPtrEqual {
      - arg6 is 1 if we need to call StoreStats() after the Propagate, or 0
        if we don't.  We used to have a separate command for storing the
        stats, but that has been removed.
+     - arg7 is, if >1, the number of consecutive kPropagate commands starting
+       here that form a chain run a tile of rows at a time on the CPU (see
+       FusePropagateChains()); otherwise it is unused.
    - kBackprop: Do the back-propagation operation, see Component::Backprop()
      - arg1 is index of component in neural net
      - arg2 is index into ComponentPrecomputedIndexes (0 if NULL; always 0
@@ -103,6 +103,10 @@ void TestNnetDecodable(Nnet *nnet) {
   {
     NnetSimpleComputationOptions opts;
     opts.frames_per_chunk = RandInt(5, 25);
+    // the padded last chunk must give the same output as the looped
+    // computation below.
+    if (RandInt(0, 1) == 0)
+      opts.chunk_length_quantum = RandInt(1, 10);
     CachingOptimizingCompiler compiler(*nnet);
     DecodableNnetSimple decodable(opts, *nnet, priors, input, &compiler,
                                   (ivector_dim != 0 ? &ivector : NULL));
@@ -20,10 +20,40 @@
 #include <iterator>
 #include <sstream>
 #include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-simple-component.h"
+#include "cudamatrix/cu-device.h"
 
 namespace kaldi {
 namespace nnet3 {
 
+struct NnetComputer::CudaGraphSegment {
+  // The index of the I/O command (or the end of the computation) at which
+  // this part of the computation ends.
+  int32 end;
+  // False if this part cannot be captured.
+  bool capturable;
+  // Number of times this part has been run.
+  int32 num_runs;
+#if HAVE_CUDA == 1
+  // The graphs captured so far, each with the matrix addresses it was
+  // captured with (see GetMatrixAddresses()).
+  std::vector<std::pair<std::vector<const BaseFloat*>, cudaGraphExec_t> >
+      graphs;
+#endif
+  CudaGraphSegment(): end(-1), capturable(false), num_runs(0) { }
+  ~CudaGraphSegment() {
+#if HAVE_CUDA == 1
+    for (size_t i = 0; i < graphs.size(); i++)
+      cudaGraphExecDestroy(graphs[i].second);
+#endif
+  }
+};
+
+// More graphs than this per part of the computation would mean its matrices
+// are at different addresses every time it is run, e.g. because the caller
+// keeps giving it different inputs; we then just run it normally.
+static const size_t kMaxCudaGraphsPerSegment = 4;
+
 
 NnetComputer::NnetComputer(const NnetComputeOptions &options,
                            const NnetComputation &computation,
@@ -52,6 +82,22 @@ void NnetComputer::Init() {
                "executing the computation.");
   matrices_.resize(computation_.matrices.size());
   debug_ = (options_.debug || GetVerboseLevel() >= 5);
+  use_cuda_graph_ = false;
+#if HAVE_CUDA == 1
+  // with --verbose >= 1 the GPU is synchronized after each operation for
+  // profiling, which is not allowed while capturing; and with several
+  // threads, the caching allocator may need to synchronize too.
+  use_cuda_graph_ = options_.use_cuda_graph && !debug_ &&
+      GetVerboseLevel() < 1 && CuDevice::Instantiate().Enabled() &&
+      !CuDevice::Instantiate().MultithreadingAllowed();
+#endif
+  if (use_cuda_graph_)
+    retained_matrices_.resize(computation_.matrices.size());
+  fuse_propagate_ = !debug_;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    fuse_propagate_ = false;
+#endif
   if (debug_) {
     ComputationVariables variables;
     variables.Init(computation_);
@@ -199,7 +245,10 @@ NnetComputer::NnetComputer(const NnetComputer &other):
     submatrix_strings_(other.submatrix_strings_),
     command_strings_(other.command_strings_),
     matrices_(other.matrices_),
-    memos_(other.memos_) {
+    memos_(other.memos_),
+    use_cuda_graph_(other.use_cuda_graph_),
+    retained_matrices_(other.retained_matrices_),
+    fuse_propagate_(other.fuse_propagate_) {
   // Note: this is the same as the default copy constructor, except for the check below.
   if (!memos_.empty()) {
     KALDI_ERR << "You cannot use the copy constructor of NnetComputer if "
@@ -207,21 +256,63 @@ NnetComputer::NnetComputer(const NnetComputer &other):
   }
 }
 
+void NnetComputer::ExecutePropagateChain() {
+  const std::vector<NnetComputation::Command> &commands = computation_.commands;
+  const NnetComputation::Command &first = commands[program_counter_];
+  int32 chain_length = first.arg7;
+  KALDI_ASSERT(program_counter_ + chain_length <= commands.size() &&
+               first.arg5 == 0 && first.arg6 == 0);
+
+  CuSubMatrix<BaseFloat> first_output(GetSubMatrix(first.arg4));
+  const Component *component = nnet_.GetComponent(first.arg1);
+  const AffineComponent *affine =
+      dynamic_cast<const AffineComponent*>(component);
+  if (affine != NULL) {
+    first_output.AddMatMat(1.0, GetSubMatrix(first.arg3), kNoTrans,
+                           affine->LinearParams(), kTrans, 0.0);
+  } else {
+    ComponentPrecomputedIndexes *indexes =
+        computation_.component_precomputed_indexes[first.arg2].data;
+    component->Propagate(indexes, GetSubMatrix(first.arg3), &first_output);
+  }
+
+  // the rest of the chain are simple components, so all the matrices have
+  // the same number of rows.  A tile is at most 128KB of the widest matrix.
+  int32 num_rows = first_output.NumRows(), max_cols = first_output.NumCols();
+  for (int32 i = 1; i < chain_length; i++) {
+    int32 output = commands[program_counter_ + i].arg4;
+    max_cols = std::max(max_cols, computation_.submatrices[output].num_cols);
+  }
+  int32 tile_rows = std::max<int32>(
+      1, (128 * 1024) / (max_cols * sizeof(BaseFloat)));
+
+  for (int32 row = 0; row < num_rows; row += tile_rows) {
+    int32 this_tile_rows = std::min(tile_rows, num_rows - row);
+    if (affine != NULL)
+      first_output.RowRange(row, this_tile_rows).AddVecToRows(
+          1.0, affine->BiasParams());
+    for (int32 i = 1; i < chain_length; i++) {
+      const NnetComputation::Command &c = commands[program_counter_ + i];
+      const CuSubMatrix<BaseFloat> input(
+          GetSubMatrix(c.arg3).RowRange(row, this_tile_rows));
+      CuSubMatrix<BaseFloat> output(
+          GetSubMatrix(c.arg4).RowRange(row, this_tile_rows));
+      nnet_.GetComponent(c.arg1)->Propagate(NULL, input, &output);
+    }
+  }
+  program_counter_ += chain_length - 1;
+}
+
 void NnetComputer::ExecuteCommand() {
   const NnetComputation::Command &c = computation_.commands[program_counter_];
   int32 m1, m2;
   try {
     switch (c.command_type) {
       case kAllocMatrix:
-        m1 = computation_.submatrices[c.arg1].matrix_index;
-        matrices_[m1].Resize(computation_.matrices[m1].num_rows,
-                             computation_.matrices[m1].num_cols,
-                             kUndefined,
-                             computation_.matrices[m1].stride_type);
+        AllocateMatrix(computation_.submatrices[c.arg1].matrix_index);
         break;
       case kDeallocMatrix:
-        m1 = computation_.submatrices[c.arg1].matrix_index;
-        matrices_[m1].Resize(0, 0);
+        DeallocateMatrix(computation_.submatrices[c.arg1].matrix_index);
         break;
       case kSwapMatrix:
         m1 = computation_.submatrices[c.arg1].matrix_index;
@@ -235,6 +326,10 @@ void NnetComputer::ExecuteCommand() {
         break;
       }
       case kPropagate: {
+        if (c.arg7 > 1 && fuse_propagate_) {
+          ExecutePropagateChain();
+          break;
+        }
         const Component *component = nnet_.GetComponent(c.arg1);
         ComponentPrecomputedIndexes *indexes =
             computation_.component_precomputed_indexes[c.arg2].data;
@@ -506,6 +601,7 @@ void NnetComputer::GetPointers(int32 indexes_multi_index,
 }
 
 void NnetComputer::Run() {
+  KALDI_PROFILE_SCOPE("NnetComputer::Run");
   const std::vector<NnetComputation::Command> &c = computation_.commands;
   int32 num_commands = c.size();
 
@@ -516,6 +612,9 @@ void NnetComputer::Run() {
   }
   CheckNoPendingIo();
 
+  if (use_cuda_graph_ && RunCudaGraph())
+    return;
+
   CommandDebugInfo info;
   Timer timer;
   double total_elapsed_previous = 0.0;
@@ -558,7 +657,12 @@ void NnetComputer::AcceptInput(const std::string &node_name,
               <<  " in computation-request, " << input->NumCols()
               << " provided.";
   }
-  if (matrix_info.stride_type == kDefaultStride ||
+  if (use_cuda_graph_) {
+    // keep the input at a fixed address, for the CUDA graphs.
+    AllocateMatrix(matrix_index);
+    matrices_[matrix_index].CopyFromMat(*input);
+    input->Resize(0, 0);
+  } else if (matrix_info.stride_type == kDefaultStride ||
       input->Stride() == input->NumCols()) {
     matrices_[matrix_index].Swap(input);
   } else {
@@ -584,10 +688,166 @@ void NnetComputer::GetOutputDestructive(const std::string &node_name,
   bool is_output = true;
   int32 matrix_index = GetIoMatrixIndex(node_name, is_output);
   KALDI_ASSERT(matrices_[matrix_index].NumRows() != 0);
+  if (use_cuda_graph_) {
+    // keep the matrix at its address, for the CUDA graphs.
+    output->Resize(matrices_[matrix_index].NumRows(),
+                   matrices_[matrix_index].NumCols(), kUndefined);
+    output->CopyFromMat(matrices_[matrix_index]);
+    DeallocateMatrix(matrix_index);
+    return;
+  }
   matrices_[matrix_index].Swap(output);
   matrices_[matrix_index].Resize(0, 0);
 }
 
+void NnetComputer::AllocateMatrix(int32 m) {
+  const NnetComputation::MatrixInfo &info = computation_.matrices[m];
+  if (use_cuda_graph_ && matrices_[m].NumRows() == 0 &&
+      retained_matrices_[m].NumRows() == info.num_rows &&
+      retained_matrices_[m].NumCols() == info.num_cols)
+    matrices_[m].Swap(&(retained_matrices_[m]));
+  matrices_[m].Resize(info.num_rows, info.num_cols, kUndefined,
+                      info.stride_type);
+}
+
+void NnetComputer::DeallocateMatrix(int32 m) {
+  if (use_cuda_graph_ && matrices_[m].NumRows() != 0) {
+    retained_matrices_[m].Swap(&(matrices_[m]));
+    // if another matrix was retained (this can only be after a
+    // kSwapMatrix), it is freed here.
+  }
+  matrices_[m].Resize(0, 0);
+}
+
+bool NnetComputer::CanCaptureCommand(int32 command) const {
+  const NnetComputation::Command &c = computation_.commands[command];
+  switch (c.command_type) {
+    case kAllocMatrix: case kDeallocMatrix: case kSwapMatrix: case kSetConst:
+    case kMatrixCopy: case kMatrixAdd: case kCopyRows: case kAddRows:
+    case kAddRowRanges:
+    case kNoOperation: case kNoOperationPermanent: case kNoOperationMarker:
+      return true;
+    case kPropagate: {
+      // no stats or memos, and only components whose Propagate() is known
+      // to just launch kernels and cuBLAS calls.  Anything that allocated
+      // memory would anyway be detected in RunCudaGraph().
+      if (c.arg5 != 0 || c.arg6 != 0)
+        return false;
+      static const char *capturable_types[] = {
+        "AffineComponent", "NaturalGradientAffineComponent",
+        "LinearComponent", "FixedAffineComponent", "TdnnComponent",
+        "QuantizedAffineComponent", "QuantizedTdnnComponent",
+        "RectifiedLinearComponent", "SigmoidComponent", "TanhComponent",
+        "BatchNormComponent", "ScaleAndOffsetComponent", "NoOpComponent",
+        "FixedScaleComponent", "FixedBiasComponent",
+        "PerElementScaleComponent", "PerElementOffsetComponent",
+        "SoftmaxComponent", "LogSoftmaxComponent" };
+      std::string type = nnet_.GetComponent(c.arg1)->Type();
+      for (size_t i = 0;
+           i < sizeof(capturable_types) / sizeof(capturable_types[0]); i++)
+        if (type == capturable_types[i])
+          return true;
+      return false;
+    }
+    default:
+      // the *Multi commands upload pointers to the GPU every time, and
+      // the others are for backprop, compression or control flow.
+      return false;
+  }
+}
+
+void NnetComputer::ExecuteHostSideCommands(int32 begin, int32 end) {
+  for (int32 command = begin; command < end; command++) {
+    const NnetComputation::Command &c = computation_.commands[command];
+    switch (c.command_type) {
+      case kAllocMatrix:
+        AllocateMatrix(computation_.submatrices[c.arg1].matrix_index);
+        break;
+      case kDeallocMatrix:
+        DeallocateMatrix(computation_.submatrices[c.arg1].matrix_index);
+        break;
+      case kSwapMatrix:
+        matrices_[computation_.submatrices[c.arg1].matrix_index].Swap(
+            &(matrices_[computation_.submatrices[c.arg2].matrix_index]));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void NnetComputer::GetMatrixAddresses(
+    std::vector<const BaseFloat*> *addresses) const {
+  addresses->resize(2 * matrices_.size());
+  for (size_t m = 0; m < matrices_.size(); m++) {
+    (*addresses)[2 * m] = matrices_[m].Data();
+    (*addresses)[2 * m + 1] = retained_matrices_[m].Data();
+  }
+}
+
+bool NnetComputer::RunCudaGraph() {
+#if HAVE_CUDA == 1
+  const std::vector<NnetComputation::Command> &c = computation_.commands;
+  int32 begin = program_counter_, num_commands = c.size();
+  CudaGraphSegment *&segment = graph_segments_[begin];
+  if (segment == NULL) {
+    segment = new CudaGraphSegment();
+    int32 end = begin;
+    segment->capturable = true;
+    for (; end < num_commands && c[end].command_type != kAcceptInput &&
+             c[end].command_type != kProvideOutput; end++)
+      if (!CanCaptureCommand(end))
+        segment->capturable = false;
+    segment->end = end;
+  }
+  // the first run is done normally: it allocates the matrices that are then
+  // retained, and does any lazy initialization (e.g. of cuBLAS), neither of
+  // which can be captured.
+  if (!segment->capturable || segment->num_runs++ == 0)
+    return false;
+
+  std::vector<const BaseFloat*> addresses;
+  GetMatrixAddresses(&addresses);
+  for (size_t i = 0; i < segment->graphs.size(); i++) {
+    if (segment->graphs[i].first == addresses) {
+      CU_SAFE_CALL(cudaGraphLaunch(segment->graphs[i].second,
+                                   cudaStreamPerThread));
+      ExecuteHostSideCommands(begin, segment->end);
+      program_counter_ = segment->end;
+      return true;
+    }
+  }
+  if (segment->graphs.size() >= kMaxCudaGraphsPerSegment)
+    return false;
+
+  size_t num_mallocs = g_cuda_allocator.GetNumMallocs();
+  cudaGraph_t graph;
+  CU_SAFE_CALL(cudaStreamBeginCapture(cudaStreamPerThread,
+                                      cudaStreamCaptureModeRelaxed));
+  for (; program_counter_ < segment->end; program_counter_++)
+    ExecuteCommand();
+  CU_SAFE_CALL(cudaStreamEndCapture(cudaStreamPerThread, &graph));
+  cudaGraphExec_t graph_exec;
+  CU_SAFE_CALL(cudaGraphInstantiate(&graph_exec, graph, NULL, NULL, 0));
+  CU_SAFE_CALL(cudaGraphDestroy(graph));
+  // the captured work has not been done yet.
+  CU_SAFE_CALL(cudaGraphLaunch(graph_exec, cudaStreamPerThread));
+  if (g_cuda_allocator.GetNumMallocs() != num_mallocs) {
+    // something allocated memory while being captured, so the graph may
+    // refer to memory that is given to something else by the time it would
+    // be replayed.  It was fine to run it this once, straight away.
+    CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+    CU_SAFE_CALL(cudaGraphExecDestroy(graph_exec));
+    segment->capturable = false;
+  } else {
+    segment->graphs.push_back(std::make_pair(addresses, graph_exec));
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
 
 void NnetComputer::CheckNoPendingIo() {
   const std::vector<NnetComputation::Command> &c = computation_.commands;
@@ -679,6 +939,9 @@ NnetComputer::~NnetComputer() {
   // the forward propagation but not the backprop.
   for (size_t i = 0; i < compressed_matrices_.size(); i++)
     delete compressed_matrices_[i];
+  for (std::map<int32, CudaGraphSegment*>::iterator iter =
+           graph_segments_.begin(); iter != graph_segments_.end(); ++iter)
+    delete iter->second;
 }
 
 } // namespace nnet3
@@ -38,11 +38,19 @@ namespace nnet3 {
 
 struct NnetComputeOptions {
   bool debug;
-  NnetComputeOptions(): debug(false) { }
+  bool use_cuda_graph;
+  NnetComputeOptions(): debug(false), use_cuda_graph(false) { }
   void Register(OptionsItf *opts) {
     opts->Register("debug", &debug, "If true, turn on "
                    "debug for the neural net computation (very verbose!) "
                    "Will be turned on regardless if --verbose >= 5");
+    opts->Register("use-cuda-graph", &use_cuda_graph, "If true and using a "
+                   "GPU, capture the parts of the computation that are run "
+                   "repeatedly (e.g. the chunks of a looped computation) into "
+                   "CUDA graphs and replay them.  Matrices are then kept "
+                   "allocated at fixed addresses, which uses more memory.  "
+                   "Ignored with --verbose >= 1, debug, or if the GPU is "
+                   "used from several threads.");
   }
 
 };
@@ -84,7 +92,8 @@ class NnetComputer {
   /// (which is only a possibility if backprop will take place, and in these
   /// situations you won't normally be wanting to use the copy constructor
   /// anyway; the copy constructor is more useful for things like RNNLM lattice
-  /// rescoring).
+  /// rescoring).  The CUDA graphs (see options.use_cuda_graph) are not
+  /// copied.
   NnetComputer(const NnetComputer &other);
 
   /// e.g. AcceptInput ("input", &input_mat), or for derivatives w.r.t. the
@@ -172,6 +181,60 @@ class NnetComputer {
   // happens.
   std::vector<CuCompressedMatrixBase*> compressed_matrices_;
 
+  // True if options_.use_cuda_graph is set and CUDA graphs can be used (see
+  // Init()).  Then each part of the computation between two I/O commands is,
+  // from the second time it is run, captured into a CUDA graph and replayed.
+  // A graph refers to the matrices by address, so in this mode matrices the
+  // computation deallocates are kept in retained_matrices_ to be reused the
+  // next time they are allocated, inputs are copied into them, and outputs
+  // are copied out.
+  bool use_cuda_graph_;
+  // Only used if use_cuda_graph_ (and indexed by matrix index).
+  std::vector<CuMatrix<BaseFloat> > retained_matrices_;
+  // The graphs of a part of the computation; defined in the .cc file.
+  struct CudaGraphSegment;
+  // Indexed by the command index at which each part starts.  Owned here.
+  std::map<int32, CudaGraphSegment*> graph_segments_;
+
+  // Executes kAllocMatrix for matrix m (reusing retained_matrices_[m] if
+  // use_cuda_graph_).
+  void AllocateMatrix(int32 m);
+  // Executes kDeallocMatrix for matrix m (keeping the memory in
+  // retained_matrices_[m] if use_cuda_graph_).
+  void DeallocateMatrix(int32 m);
+
+  // Called from Run() if use_cuda_graph_; runs the part of the computation
+  // from program_counter_ up to the next I/O command by capturing or replaying
+  // a CUDA graph.  Returns false, having done nothing, if that part cannot be
+  // run this way (or not yet).
+  bool RunCudaGraph();
+
+  // True if computation_.commands[command] may be captured in a CUDA graph:
+  // it must do nothing on the host other than launch work on the GPU, and
+  // must not allocate memory.
+  bool CanCaptureCommand(int32 command) const;
+
+  // Does the host side (allocation and swapping of matrices) of the commands
+  // in [begin, end); used when a graph is replayed in place of them.
+  void ExecuteHostSideCommands(int32 begin, int32 end);
+
+  // Outputs the addresses of all the matrices; a graph may only be replayed
+  // if these are what they were when it was captured.
+  void GetMatrixAddresses(std::vector<const BaseFloat*> *addresses) const;
+
+
+  // True if the chains of Propagate commands marked by FusePropagateChains()
+  // are to be run by ExecutePropagateChain(): on the CPU, and not in debug
+  // mode, where we want to see each command.
+  bool fuse_propagate_;
+
+  // Runs the chain of computation_.commands[program_counter_].arg7 Propagate
+  // commands starting at program_counter_, and leaves program_counter_ at the
+  // last of them.  The first command is run whole, and then the others a tile
+  // of rows at a time, so that each tile is still in the cache when the next
+  // command reads it.  If the first is an AffineComponent, its bias is
+  // added to each tile too, rather than copied to the output beforehand.
+  void ExecutePropagateChain();
 
   // executes the command in computation_.commands[program_counter_].
   void ExecuteCommand();
@@ -560,7 +560,8 @@ class TdnnComponent: public UpdatableComponent {
   BaseFloat OrthonormalConstraint() const { return orthonormal_constraint_; }
 
   void ConsolidateMemory();
- private:
+ protected:
+  // (protected, not private, for QuantizedTdnnComponent.)
 
   // This static function is a utility function that extracts a CuSubMatrix
   // representing a subset of rows of 'input_matrix'.
@@ -0,0 +1,155 @@
+// nnet3/nnet-example-loader-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include "nnet3/nnet-example-loader.h"
+#include "base/kaldi-math.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Writes 'num_egs' examples of one frame to 'filename'; the input of the
+// i'th one is i (in both columns), so it can be traced through the loader.
+static void WriteTestExamples(const std::string &filename, int32 num_egs) {
+  NnetExampleWriter writer("ark:" + filename);
+  for (int32 i = 0; i < num_egs; i++) {
+    Matrix<BaseFloat> input(1, 2), output(1, 3);
+    input.Set(i);
+    output(0, i % 3) = 1.0;
+    NnetExample eg;
+    eg.io.push_back(NnetIo("input", 0, input));
+    eg.io.push_back(NnetIo("output", 0, output));
+    std::ostringstream key;
+    key << "eg-" << i;
+    writer.Write(key.str(), eg);
+  }
+}
+
+// Appends the indexes of the examples (from the input features) in 'eg'.
+static void GetExampleIndexes(const NnetExample &eg,
+                              std::vector<int32> *indexes) {
+  Matrix<BaseFloat> input;
+  eg.io[0].features.GetMatrix(&input);
+  for (int32 r = 0; r < input.NumRows(); r++)
+    indexes->push_back(static_cast<int32>(input(r, 0)));
+}
+
+void UnitTestExampleLoader(const std::string &filename, int32 num_egs) {
+  for (int32 n = 0; n < 10; n++) {
+    ExampleLoaderOptions loader_opts;
+    ExampleMergingConfig merging_config;
+    loader_opts.buffer_size = RandInt(0, 1) * RandInt(1, 30);
+    loader_opts.srand = n;
+    loader_opts.prefetch = RandInt(1, 4);
+    loader_opts.merge = (RandInt(0, 1) == 0);
+    // all the examples have the same structure, so with a minibatch size
+    // that divides num_egs no partial minibatch is discarded.
+    int32 minibatch_size;
+    do {
+      minibatch_size = RandInt(1, 8);
+    } while (num_egs % minibatch_size != 0);
+    std::ostringstream os;
+    os << minibatch_size;
+    merging_config.minibatch_size = os.str();
+    merging_config.ComputeDerived();
+
+    NnetExampleLoader loader(loader_opts, merging_config, "ark:" + filename);
+    std::vector<int32> indexes;
+    int32 num_minibatches = 0;
+    while (const NnetExample *eg = loader.Next()) {
+      int32 size_before = indexes.size();
+      GetExampleIndexes(*eg, &indexes);
+      if (!loader_opts.merge)
+        KALDI_ASSERT(indexes.size() == size_before + 1);
+      else
+        KALDI_ASSERT(indexes.size() <= size_before + minibatch_size);
+      num_minibatches++;
+    }
+    KALDI_ASSERT(loader.NumRead() == num_egs);
+    KALDI_ASSERT(loader.Next() == NULL);
+    if (loader_opts.merge)
+      KALDI_ASSERT(num_minibatches == num_egs / minibatch_size);
+
+    // Without a shuffle the examples come in order; either way each of them
+    // comes once.
+    std::vector<int32> sorted_indexes(indexes);
+    std::sort(sorted_indexes.begin(), sorted_indexes.end());
+    for (int32 i = 0; i < num_egs; i++)
+      KALDI_ASSERT(sorted_indexes[i] == i);
+    if (loader_opts.buffer_size == 0)
+      KALDI_ASSERT(sorted_indexes == indexes);
+
+    // The same seed gives the same order.
+    NnetExampleLoader loader2(loader_opts, merging_config, "ark:" + filename);
+    std::vector<int32> indexes2;
+    while (const NnetExample *eg = loader2.Next())
+      GetExampleIndexes(*eg, &indexes2);
+    KALDI_ASSERT(indexes2 == indexes);
+  }
+  {
+    // Stopping early must not hang or leak.
+    ExampleLoaderOptions loader_opts;
+    ExampleMergingConfig merging_config;
+    loader_opts.buffer_size = 10;
+    loader_opts.prefetch = 1;
+    loader_opts.merge = true;
+    merging_config.minibatch_size = "2";
+    merging_config.ComputeDerived();
+    NnetExampleLoader loader(loader_opts, merging_config, "ark:" + filename);
+    KALDI_ASSERT(loader.Next() != NULL);
+  }
+}
+
+void UnitTestExampleLoaderError(const std::string &filename, int32 num_egs) {
+  {
+    std::ofstream os(filename.c_str(), std::ios::app);
+    os << "eg-bad this is not an example\n";
+  }
+  ExampleLoaderOptions loader_opts;
+  ExampleMergingConfig merging_config;
+  loader_opts.merge = true;
+  merging_config.ComputeDerived();
+  NnetExampleLoader loader(loader_opts, merging_config, "ark:" + filename);
+  bool threw = false;
+  try {
+    while (loader.Next() != NULL) { }
+  } catch (const std::exception &e) {
+    threw = true;
+  }
+  KALDI_ASSERT(threw);
+}
+
+} // namespace nnet3
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet3;
+
+  std::string filename = "tmp-nnet-example-loader.ark";
+  int32 num_egs = 120;
+  WriteTestExamples(filename, num_egs);
+  UnitTestExampleLoader(filename, num_egs);
+  UnitTestExampleLoaderError(filename, num_egs);
+  unlink(filename.c_str());
+
+  KALDI_LOG << "Nnet-example-loader tests succeeded.";
+
+  return 0;
+}
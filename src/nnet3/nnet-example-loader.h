@@ -0,0 +1,321 @@
+// nnet3/nnet-example-loader.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_EXAMPLE_LOADER_H_
+#define KALDI_NNET3_NNET_EXAMPLE_LOADER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "nnet3/nnet-example-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/**
+   The example loader does, inside the training program, what the
+   "nnet3-shuffle-egs --buffer-size=N ... | nnet3-merge-egs ..." part of an
+   egs pipeline does: the examples are read, shuffled and merged into
+   minibatches in background threads, and the trainer takes the minibatches
+   from a queue of ready ones.  With the default options it only reads
+   ahead, so the input must already be merged as before.
+ */
+struct ExampleLoaderOptions {
+  int32 buffer_size;
+  int32 srand;
+  int32 prefetch;
+  bool merge;
+
+  ExampleLoaderOptions(): buffer_size(0), srand(0), prefetch(4),
+                          merge(false) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("buffer-size", &buffer_size, "If >0, the examples are "
+                   "shuffled with a buffer of this many examples, as "
+                   "nnet3-shuffle-egs --buffer-size does");
+    opts->Register("srand", &srand, "Seed of the shuffle");
+    opts->Register("prefetch", &prefetch, "Number of (merged) examples that "
+                   "are kept ready for the trainer");
+    opts->Register("merge", &merge, "If true, the examples are merged into "
+                   "minibatches as nnet3-merge-egs does (see --minibatch-size "
+                   "and --compress)");
+  }
+};
+
+/// A queue between the threads of the loader, of at most 'capacity'
+/// examples; it owns the examples in it.
+template<class Example>
+class ExampleLoaderQueue {
+ public:
+  explicit ExampleLoaderQueue(size_t capacity):
+      capacity_(std::max<size_t>(capacity, 1)), done_(false),
+      aborted_(false) { }
+
+  /// Waits until there is room and adds 'eg' (which the queue takes
+  /// ownership of).  Returns false, and deletes 'eg', once the queue has been
+  /// aborted.
+  bool Push(Example *eg) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] {
+        return aborted_ || queue_.size() < capacity_; });
+    if (aborted_) {
+      delete eg;
+      return false;
+    }
+    queue_.push_back(eg);
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /// Waits for an example and returns it (the caller takes ownership);
+  /// returns NULL once the queue is empty and Done() has been called, or
+  /// once it has been aborted.
+  Example *Pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] {
+        return aborted_ || done_ || !queue_.empty(); });
+    if (aborted_ || queue_.empty())
+      return NULL;
+    Example *eg = queue_.front();
+    queue_.pop_front();
+    not_full_.notify_one();
+    return eg;
+  }
+
+  /// Called by the producer once there are no more examples.
+  void Done() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+    not_empty_.notify_all();
+  }
+
+  /// Wakes up both sides for good, e.g. on an error or in the destructor of
+  /// the loader.
+  void Abort() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  ~ExampleLoaderQueue() {
+    for (size_t i = 0; i < queue_.size(); i++)
+      delete queue_[i];
+  }
+
+ private:
+  size_t capacity_;
+  bool done_;
+  bool aborted_;
+  std::deque<Example*> queue_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+/**
+   Reads examples from an rspecifier in a background thread, shuffles them
+   if opts.buffer_size > 0 and, if opts.merge, merges them into minibatches
+   in a second thread.  Usage:
+
+     NnetExampleLoader loader(loader_opts, merging_config, rspecifier);
+     while (const NnetExample *eg = loader.Next())
+       trainer.Train(*eg);
+
+   Errors in the background threads (e.g. a corrupt archive) are reported
+   by Next().  'opts' and 'merging_config' (on which ComputeDerived() must
+   have been called if opts.merge) must outlive the loader.  The examples
+   stay in CPU memory; the trainer copies them to the GPU, since it is the
+   thread that uses the CUDA device.
+ */
+template<class Example, class Reader, class Merger>
+class GenericExampleLoader {
+ public:
+  GenericExampleLoader(const ExampleLoaderOptions &opts,
+                       const ExampleMergingConfig &merging_config,
+                       const std::string &rspecifier);
+
+  /// Returns the next (merged) example, or NULL at the end of the input.  It
+  /// is owned by the loader and is valid until the next call.
+  const Example *Next();
+
+  /// The number of examples read so far (before merging).
+  int64 NumRead() const { return num_read_; }
+
+  ~GenericExampleLoader();
+
+ private:
+  void ReadExamples();
+  void MergeExamples();
+  // Called in the threads on an error: saves it for Next() and stops
+  // everything.
+  void SetError(const std::string &what);
+  void AbortAll();
+
+  const ExampleLoaderOptions &opts_;
+  const ExampleMergingConfig &merging_config_;
+  // The number of single examples the reader thread gets ahead of the
+  // merging thread.
+  static const int32 kReadAhead = 256;
+
+  std::string rspecifier_;
+  Reader reader_;
+  // The output of the reader thread; it is ready_ too if there is no
+  // merging.
+  ExampleLoaderQueue<Example> read_;
+  ExampleLoaderQueue<Example> ready_;
+  std::thread read_thread_;
+  std::thread merge_thread_;
+  Example *current_;
+  std::atomic<int64> num_read_;
+  std::mutex error_mutex_;
+  bool failed_;
+  std::string error_;
+};
+
+typedef GenericExampleLoader<NnetExample, SequentialNnetExampleReader,
+                             ExampleMerger> NnetExampleLoader;
+// NnetChainExampleLoader is in nnet-chain-example.h.
+
+
+template<class Example, class Reader, class Merger>
+GenericExampleLoader<Example, Reader, Merger>::GenericExampleLoader(
+    const ExampleLoaderOptions &opts,
+    const ExampleMergingConfig &merging_config,
+    const std::string &rspecifier):
+    opts_(opts), merging_config_(merging_config), rspecifier_(rspecifier),
+    reader_(rspecifier),
+    read_(kReadAhead), ready_(opts.prefetch), current_(NULL), num_read_(0),
+    failed_(false) {
+  KALDI_ASSERT(opts.buffer_size >= 0);
+  read_thread_ = std::thread(&GenericExampleLoader::ReadExamples, this);
+  if (opts.merge)
+    merge_thread_ = std::thread(&GenericExampleLoader::MergeExamples, this);
+}
+
+template<class Example, class Reader, class Merger>
+void GenericExampleLoader<Example, Reader, Merger>::ReadExamples() {
+  ExampleLoaderQueue<Example> *output = (opts_.merge ? &read_ : &ready_);
+  std::vector<Example*> buffer(opts_.buffer_size, NULL);
+  RandomState rand_state;
+  rand_state.seed = opts_.srand;
+  bool ok = true;
+  try {
+    for (; ok && !reader_.Done(); reader_.Next()) {
+      Example *eg = new Example(reader_.Value());
+      num_read_++;
+      if (buffer.empty()) {
+        ok = output->Push(eg);
+        continue;
+      }
+      // as nnet3-shuffle-egs with --buffer-size.
+      int32 index = RandInt(0, opts_.buffer_size - 1, &rand_state);
+      std::swap(buffer[index], eg);
+      if (eg != NULL)
+        ok = output->Push(eg);
+    }
+    for (size_t i = 0; i < buffer.size(); i++) {
+      if (buffer[i] != NULL && ok)
+        ok = output->Push(buffer[i]);
+      else
+        delete buffer[i];
+      buffer[i] = NULL;
+    }
+    // a corrupt archive only ends the input, the error comes from Close().
+    if (ok && !reader_.Close())
+      KALDI_ERR << "Error reading examples from " << rspecifier_;
+  } catch (const std::exception &e) {
+    for (size_t i = 0; i < buffer.size(); i++)
+      delete buffer[i];
+    SetError(e.what());
+    return;
+  }
+  output->Done();
+}
+
+template<class Example, class Reader, class Merger>
+void GenericExampleLoader<Example, Reader, Merger>::MergeExamples() {
+  bool ok = true;
+  try {
+    Merger merger(merging_config_, [this, &ok](Example *eg) {
+        if (ok) ok = ready_.Push(eg);
+        else delete eg;
+      });
+    while (Example *eg = read_.Pop())
+      merger.AcceptExample(eg);
+    // the merger's destructor would flush the rest as well, but errors there
+    // must be caught here.
+    if (ok)
+      merger.Finish();
+  } catch (const std::exception &e) {
+    SetError(e.what());
+    return;
+  }
+  ready_.Done();
+}
+
+template<class Example, class Reader, class Merger>
+void GenericExampleLoader<Example, Reader, Merger>::SetError(
+    const std::string &what) {
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (!failed_)
+      error_ = what;
+    failed_ = true;
+  }
+  AbortAll();
+}
+
+template<class Example, class Reader, class Merger>
+void GenericExampleLoader<Example, Reader, Merger>::AbortAll() {
+  read_.Abort();
+  ready_.Abort();
+}
+
+template<class Example, class Reader, class Merger>
+const Example *GenericExampleLoader<Example, Reader, Merger>::Next() {
+  delete current_;
+  current_ = ready_.Pop();
+  if (current_ == NULL) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    // (KALDI_ERR throws with an empty message, it has printed it already.)
+    if (failed_)
+      KALDI_ERR << "Error loading examples from " << rspecifier_
+                << (error_.empty() ? "" : ": ") << error_;
+  }
+  return current_;
+}
+
+template<class Example, class Reader, class Merger>
+GenericExampleLoader<Example, Reader, Merger>::~GenericExampleLoader() {
+  AbortAll();
+  if (read_thread_.joinable())
+    read_thread_.join();
+  if (merge_thread_.joinable())
+    merge_thread_.join();
+  delete current_;
+}
+
+} // namespace nnet3
+} // namespace kaldi
+
+#endif // KALDI_NNET3_NNET_EXAMPLE_LOADER_H_
@@ -1190,6 +1190,11 @@ ExampleMerger::ExampleMerger(const ExampleMergingConfig &config,
     finished_(false), num_egs_written_(0),
     config_(config), writer_(writer) { }
 
+ExampleMerger::ExampleMerger(const ExampleMergingConfig &config,
+                             const std::function<void(NnetExample*)> &output):
+    finished_(false), num_egs_written_(0),
+    config_(config), writer_(NULL), output_(output) { }
+
 
 void ExampleMerger::AcceptExample(NnetExample *eg) {
   KALDI_ASSERT(!finished_);
@@ -1231,6 +1236,13 @@ void ExampleMerger::WriteMinibatch(const std::vector<NnetExample> &egs) {
   stats_.WroteExample(eg_size, structure_hash, minibatch_size);
   NnetExample merged_eg;
   MergeExamples(egs, config_.compress, &merged_eg);
+  if (writer_ == NULL) {
+    num_egs_written_++;
+    NnetExample *eg = new NnetExample();
+    eg->Swap(&merged_eg);
+    output_(eg);
+    return;
+  }
   std::ostringstream key;
   key << "merged-" << (num_egs_written_++) << "-" << minibatch_size;
   writer_->Write(key.str(), merged_eg);
@@ -20,6 +20,7 @@
 #ifndef KALDI_NNET3_NNET_EXAMPLE_UTILS_H_
 #define KALDI_NNET3_NNET_EXAMPLE_UTILS_H_
 
+#include <functional>
 #include "nnet3/nnet-example.h"
 #include "nnet3/nnet-computation.h"
 #include "nnet3/nnet-compute.h"
@@ -482,6 +483,11 @@ class ExampleMerger {
   ExampleMerger(const ExampleMergingConfig &config,
                 NnetExampleWriter *writer);
 
+  // As above, but the merged examples are passed to 'output' (which takes
+  // ownership of them) instead of being written.
+  ExampleMerger(const ExampleMergingConfig &config,
+                const std::function<void(NnetExample*)> &output);
+
   // This function accepts an example, and if possible, writes a merged example
   // out.  The ownership of the pointer 'a' is transferred to this class when
   // you call this function.
@@ -507,6 +513,7 @@ class ExampleMerger {
   int32 num_egs_written_;
   const ExampleMergingConfig &config_;
   NnetExampleWriter *writer_;
+  std::function<void(NnetExample*)> output_;
   ExampleMergingStats stats_;
 
   // Note: the "key" into the egs is the first element of the vector.
@@ -122,6 +122,19 @@ struct NnetExample {
 
   NnetExample(const NnetExample &other): io(other.io) { }
 
+  NnetExample(NnetExample &&other) noexcept: io(std::move(other.io)) { }
+
+  NnetExample &operator = (const NnetExample &other) {
+    io = other.io;
+    return *this;
+  }
+
+  NnetExample &operator = (NnetExample &&other) noexcept {
+    io.swap(other.io);
+    other.io.clear();
+    return *this;
+  }
+
   void Swap(NnetExample *other) { io.swap(other->io); }
 
   /// Compresses any (input) features that are not sparse.
@@ -200,6 +200,8 @@ static void UnitTestNnetOptimizeInternal(int32 srand_seed) {
   // (without really changing anything).
   if (RandInt(0, 3) == 0) optimize_all.min_deriv_time = -200;
   if (RandInt(0, 3) == 0) optimize_all.max_deriv_time = 1000;
+  // a tiny budget recomputes everything that can be recomputed.
+  if (RandInt(0, 1) == 0) optimize_all.recompute_memory_budget = 1.0e-06;
 
   // this is useful for debugging as it removes nans:
   // optimize_all.initialize_undefined = false;
@@ -265,6 +267,16 @@ static void UnitTestNnetOptimizeInternal(int32 srand_seed) {
                                                               compiler);
   optimize = optimize_all;
 
+  optimize.fuse_propagate = false;
+  bool succ_no_fuse_propagate = UnitTestNnetOptimizeWithOptions(srand_seed, optimize,
+                                                                compiler);
+  optimize = optimize_all;
+
+  optimize.recompute_memory_budget = 0.0;
+  bool succ_no_recompute = UnitTestNnetOptimizeWithOptions(srand_seed, optimize,
+                                                           compiler);
+  optimize = optimize_all;
+
 
   optimize.min_deriv_time = std::numeric_limits<int32>::min();
   optimize.max_deriv_time = std::numeric_limits<int32>::max();
@@ -288,6 +300,8 @@ static void UnitTestNnetOptimizeInternal(int32 srand_seed) {
     << "\n  allocate_from_other  ... " << KALDI_SUCCFAIL(succ_no_allocate_from_other)
     << "\n  move_sizing_commands ... " << KALDI_SUCCFAIL(succ_no_move_sizing_commands)
     << "\n  snip_row_ops         ... " << KALDI_SUCCFAIL(succ_no_snip_row_ops)
+    << "\n  fuse_propagate       ... " << KALDI_SUCCFAIL(succ_no_fuse_propagate)
+    << "\n  recompute            ... " << KALDI_SUCCFAIL(succ_no_recompute)
     << "\n  no_deriv_time        ... " << KALDI_SUCCFAIL(succ_no_deriv_time);
 #undef KALDI_SUCCFAIL
 }
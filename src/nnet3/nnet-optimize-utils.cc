@@ -17,6 +17,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <map>
 #include "nnet3/nnet-optimize-utils.h"
 #include "nnet3/nnet-optimize.h"
@@ -4579,6 +4580,96 @@ void FixGotoLabel(NnetComputation *computation) {
   }
 }
 
+// Returns true if 'command' is a Propagate that may be run a tile of rows at a
+// time as part of a chain, reading submatrix 'input_submatrix' (the output of
+// the previous command of the chain).  'chain_matrices' are the matrices the
+// chain writes to so far.
+static bool IsFusablePropagate(const Nnet &nnet,
+                               const NnetComputation &computation,
+                               const NnetComputation::Command &command,
+                               int32 input_submatrix,
+                               const std::vector<int32> &chain_matrices) {
+  if (command.command_type != kPropagate || command.arg3 != input_submatrix ||
+      command.arg5 != 0 || command.arg6 != 0)
+    return false;
+  const Component *component = nnet.GetComponent(command.arg1);
+  // BatchNormComponent uses a memo, and normalizes with the stats of the
+  // whole minibatch, unless it is in test mode.
+  if (!(component->Properties() & kSimpleComponent) ||
+      (component->Properties() & kUsesMemo))
+    return false;
+  // only element-wise components; a tile of rows is not worth it for a
+  // matrix multiplication, as the parameters would be read once per tile.
+  static const char *fusable_types[] = {
+    "RectifiedLinearComponent", "SigmoidComponent", "TanhComponent",
+    "BatchNormComponent", "ScaleAndOffsetComponent", "NoOpComponent",
+    "FixedScaleComponent", "FixedBiasComponent",
+    "PerElementScaleComponent", "PerElementOffsetComponent" };
+  std::string type = component->Type();
+  bool fusable = false;
+  for (size_t i = 0; i < sizeof(fusable_types) / sizeof(fusable_types[0]); i++)
+    if (type == fusable_types[i])
+      fusable = true;
+  if (!fusable)
+    return false;
+  if (command.arg4 == command.arg3)
+    return true;
+  // If not in-place, the output must not share a matrix with anything else in
+  // the chain, or writing one tile could overwrite rows that another command
+  // of the chain has not read yet.
+  int32 output_matrix = computation.submatrices[command.arg4].matrix_index;
+  return output_matrix !=
+      computation.submatrices[command.arg3].matrix_index &&
+      std::find(chain_matrices.begin(), chain_matrices.end(),
+                output_matrix) == chain_matrices.end();
+}
+
+void FusePropagateChains(const Nnet &nnet, NnetComputation *computation) {
+  std::vector<NnetComputation::Command> &commands = computation->commands;
+  int32 num_commands = commands.size();
+  for (int32 c = 0; c < num_commands; c++) {
+    // the first command of a chain is run whole, but still without memos or
+    // stats, for simplicity.
+    if (commands[c].command_type != kPropagate || commands[c].arg5 != 0 ||
+        commands[c].arg6 != 0)
+      continue;
+    // 'chain' are the Propagate commands; 'others' the deallocations and
+    // no-ops before the last of them, which are moved after the chain.
+    std::vector<int32> chain(1, c), others, chain_matrices;
+    std::vector<int32> pending_others;
+    chain_matrices.push_back(
+        computation->submatrices[commands[c].arg4].matrix_index);
+    for (int32 d = c + 1; d < num_commands; d++) {
+      const NnetComputation::Command &command = commands[d];
+      if (command.command_type == kDeallocMatrix ||
+          command.command_type == kNoOperation) {
+        pending_others.push_back(d);
+        continue;
+      }
+      if (!IsFusablePropagate(nnet, *computation, command,
+                              commands[chain.back()].arg4, chain_matrices))
+        break;
+      chain.push_back(d);
+      chain_matrices.push_back(
+          computation->submatrices[command.arg4].matrix_index);
+      others.insert(others.end(), pending_others.begin(),
+                    pending_others.end());
+      pending_others.clear();
+    }
+    if (chain.size() < 2)
+      continue;
+    std::vector<NnetComputation::Command> reordered;
+    reordered.reserve(chain.size() + others.size());
+    for (size_t i = 0; i < chain.size(); i++)
+      reordered.push_back(commands[chain[i]]);
+    for (size_t i = 0; i < others.size(); i++)
+      reordered.push_back(commands[others[i]]);
+    std::copy(reordered.begin(), reordered.end(), commands.begin() + c);
+    commands[c].arg7 = chain.size();
+    c += reordered.size() - 1;
+  }
+}
+
 bool MatrixIsUnused(const Analyzer &analyzer,
                     const NnetComputation &computation,
                     int32 m) {
@@ -4682,6 +4773,25 @@ void InsertCommands(
   FixGotoLabel(computation);
 }
 
+// Returns the index of the command of type kNoOperationMarker that separates
+// the forward and backward passes of a non-looped computation, or -1 if there
+// is none (no backprop) or there is more than one (which is not expected).
+static int32 FindMiddleCommand(const NnetComputation &computation) {
+  int32 middle_command = -1;
+  for (size_t i = 0; i < computation.commands.size(); i++) {
+    if (computation.commands[i].command_type == kNoOperationMarker) {
+      if (middle_command < 0) {
+        middle_command = static_cast<int32>(i);
+      } else {
+        KALDI_WARN << "Found more than one command of type kNoOperationMarker "
+            "in non-looped computation.";
+        return -1;
+      }
+    }
+  }
+  return middle_command;
+}
+
 /**
    This class is used in the function OptimizeMemoryCompression(),
    once we determine that there is some potential to do memory compression
@@ -4907,22 +5017,8 @@ void OptimizeMemoryCompression(const Nnet &nnet,
 
   // 'middle_command' will be the index of the command of type
   // 'kNoOperationMarker' that separates the forward and backward
-  // passes.  If it doesn't exist, it means this computation doesn't
-  // include
-  int32 middle_command = -1;
-  for (size_t i = 0; i < computation->commands.size(); i++) {
-    if (computation->commands[i].command_type == kNoOperationMarker) {
-      if (middle_command < 0) {
-        middle_command = static_cast<int32>(i);
-      } else {
-        KALDI_WARN << "Found more than one command of type kNoOperationMarker "
-            "in non-looped computation.";
-        // there are more than one command of this type... this wasn't expected.
-        // return (i.e. do nothing).
-        return;
-      }
-    }
-  }
+  // passes.
+  int32 middle_command = FindMiddleCommand(*computation);
   if (middle_command == -1) {
     return;  // This computation doesn't have a backprop pass.
   }
@@ -4948,6 +5044,351 @@ void OptimizeMemoryCompression(const Nnet &nnet,
 }
 
 
+/**
+   This class is used in the function OptimizeRecomputation().  It finds
+   matrices of values that are computed in the forward pass and needed again
+   only by Backprop commands, and that can be computed again, just before the
+   first such Backprop, by repeating the forward commands that wrote them: the
+   matrix is freed after its last access in the forward pass, and the
+   backward pass uses a new matrix holding the recomputed values.
+
+   Recomputing matrix m repeats the commands that wrote it (there may be
+   several, e.g. an affine component and a ReLU that was propagated in place),
+   which read other matrices.  Those must still hold the same values when the
+   backward pass reaches m; since they are themselves kept, the kept matrices
+   are the boundaries of the segments of the forward pass that are computed
+   twice.  Matrices are chosen, largest first, among those that are unused at
+   the point where the memory use peaks, until the peak is within the budget.
+*/
+class RecomputationOptimizer {
+ public:
+  /** @param [in] nnet         The neural net the computation is for.
+      @param [in] memory_budget  The memory use, in bytes, that we would like
+                               the computation to stay within.
+      @param [in] middle_command  Must be the command-index of the
+          command of type kNoOperationMarker in 'computation'.
+      @param [in,out] computation  The computation we're optimizing.
+  */
+  RecomputationOptimizer(const Nnet &nnet,
+                         int64 memory_budget,
+                         int32 middle_command,
+                         NnetComputation *computation):
+      nnet_(nnet), memory_budget_(memory_budget),
+      middle_command_(middle_command), computation_(computation) { }
+
+  void Optimize();
+
+ private:
+  // A matrix that may be recomputed.
+  struct RecomputeInfo {
+    int32 m;  // the matrix-index.
+    // the last command of the forward pass that accesses m; m is freed after
+    // it.
+    int32 last_forward_command;
+    // the first command of the backward pass that accesses m (a Backprop);
+    // the recomputation goes just before it.
+    int32 first_backward_command;
+    // the commands of the forward pass that write to m, in order.
+    std::vector<int32> write_commands;
+    // the matrices other than m that those commands read.
+    std::vector<int32> sources;
+    int64 num_bytes;
+  };
+
+  // Returns true if the values of matrix m may be recomputed, and if so
+  // outputs the details to 'info'.
+  bool GetRecomputeInfo(int32 m, RecomputeInfo *info) const;
+
+  // Returns true if command c, which writes to matrix m, may be repeated in the
+  // backward pass.
+  bool CommandIsRepeatable(int32 c, int32 m) const;
+
+  // Sets memory_use_ to the memory in use while each command runs.
+  void ComputeMemoryUse();
+
+  // Modifies the commands in '*computation_' to recompute the matrices in
+  // 'selected_'.
+  void ModifyComputation();
+
+  const Nnet &nnet_;
+  int64 memory_budget_;
+  int32 middle_command_;
+  NnetComputation *computation_;
+  Analyzer analyzer_;
+  std::vector<int64> memory_use_;
+  std::vector<RecomputeInfo> selected_;
+};
+
+
+bool RecomputationOptimizer::CommandIsRepeatable(int32 c, int32 m) const {
+  const NnetComputation::Command &command = computation_->commands[c];
+  const CommandAttributes &attr = analyzer_.command_attributes[c];
+  if (attr.matrices_written.size() != 1 || attr.matrices_written[0] != m)
+    return false;
+  switch (command.command_type) {
+    case kSetConst: case kMatrixCopy: case kMatrixAdd:
+    case kCopyRows: case kAddRows: case kAddRowRanges:
+      return true;
+    case kCopyRowsMulti: case kAddRowsMulti: {
+      // the rows it reads are listed in indexes_multi, which we do not remap,
+      // so it must not read from m itself.
+      const std::vector<std::pair<int32, int32> > &pairs =
+          computation_->indexes_multi[command.arg2];
+      for (size_t i = 0; i < pairs.size(); i++)
+        if (pairs[i].first > 0 &&
+            computation_->submatrices[pairs[i].first].matrix_index == m)
+          return false;
+      return true;
+    }
+    case kPropagate:
+      // random components, e.g. dropout, would not give the same output
+      // again.
+      return !(nnet_.GetComponent(command.arg1)->Properties() &
+               kRandomComponent);
+    default:
+      return false;
+  }
+}
+
+
+bool RecomputationOptimizer::GetRecomputeInfo(int32 m,
+                                              RecomputeInfo *info) const {
+  const MatrixAccesses &ma = analyzer_.matrix_accesses[m];
+  if (ma.is_input || ma.is_output || ma.allocate_command < 0 ||
+      ma.deallocate_command < 0)
+    return false;
+  const std::vector<Access> &accesses = ma.accesses;
+  Access middle_access(middle_command_, kReadAccess);
+  std::vector<Access>::const_iterator iter = std::lower_bound(accesses.begin(),
+                                                              accesses.end(),
+                                                              middle_access);
+  if (iter == accesses.begin() || iter == accesses.end())
+    return false;  // not accessed in both the forward and the backward pass.
+  info->m = m;
+  info->last_forward_command = iter[-1].command_index;
+  info->first_backward_command = iter->command_index;
+  if (info->first_backward_command - info->last_forward_command < 2)
+    return false;  // nothing to gain.
+  // in the backward pass, m must only be read by Backprop commands, which
+  // are the commands we know how to point to the recomputed matrix.
+  for (; iter != accesses.end(); ++iter) {
+    CommandType type = computation_->commands[iter->command_index].command_type;
+    if (iter->access_type != kReadAccess ||
+        (type != kBackprop && type != kBackpropNoModelUpdate))
+      return false;
+  }
+  if (accesses[0].access_type != kWriteAccess)
+    return false;  // the forward pass must start by setting it.
+  info->write_commands.clear();
+  info->sources.clear();
+  for (iter = accesses.begin(); iter->command_index < middle_command_; ++iter) {
+    if (iter->access_type == kReadAccess)
+      continue;
+    int32 c = iter->command_index;
+    if (!CommandIsRepeatable(c, m))
+      return false;
+    info->write_commands.push_back(c);
+    const std::vector<int32> &read = analyzer_.command_attributes[c].matrices_read;
+    for (size_t i = 0; i < read.size(); i++)
+      if (read[i] != m)
+        info->sources.push_back(read[i]);
+  }
+  SortAndUniq(&info->sources);
+  // the sources must still hold the same values at the first Backprop.
+  int32 first_write = info->write_commands[0];
+  for (size_t i = 0; i < info->sources.size(); i++) {
+    const MatrixAccesses &source_accesses =
+        analyzer_.matrix_accesses[info->sources[i]];
+    if (source_accesses.deallocate_command >= 0 &&
+        source_accesses.deallocate_command < info->first_backward_command)
+      return false;
+    const std::vector<Access> &a = source_accesses.accesses;
+    for (size_t j = 0; j < a.size(); j++)
+      if (a[j].access_type != kReadAccess &&
+          a[j].command_index > first_write &&
+          a[j].command_index < info->first_backward_command)
+        return false;
+  }
+  const NnetComputation::MatrixInfo &matrix_info = computation_->matrices[m];
+  info->num_bytes = static_cast<int64>(sizeof(BaseFloat)) *
+      matrix_info.num_rows * matrix_info.num_cols;
+  return true;
+}
+
+
+void RecomputationOptimizer::ComputeMemoryUse() {
+  // this counts memory the same way as GetMaxMemoryUse().
+  int32 num_commands = computation_->commands.size();
+  memory_use_.resize(num_commands);
+  int64 cur_memory_use = 0;
+  for (int32 c = 0; c < num_commands; c++) {
+    const NnetComputation::Command &command = computation_->commands[c];
+    if (command.command_type == kAllocMatrix ||
+        command.command_type == kAcceptInput ||
+        command.command_type == kDeallocMatrix) {
+      const NnetComputation::SubMatrixInfo &info =
+          computation_->submatrices[command.arg1];
+      int64 num_bytes = static_cast<int64>(sizeof(BaseFloat)) *
+          info.num_rows * info.num_cols;
+      cur_memory_use += (command.command_type == kDeallocMatrix ?
+                         -num_bytes : num_bytes);
+    }
+    memory_use_[c] = cur_memory_use;
+  }
+}
+
+
+void RecomputationOptimizer::Optimize() {
+  analyzer_.Init(nnet_, *computation_);
+  ComputeMemoryUse();
+  std::vector<RecomputeInfo> candidates;
+  int32 num_matrices = computation_->matrices.size();
+  for (int32 m = 1; m < num_matrices; m++) {
+    RecomputeInfo info;
+    if (GetRecomputeInfo(m, &info))
+      candidates.push_back(info);
+  }
+  // is_selected[m] is true if m will be recomputed; is_source[m] is true if a
+  // recomputation reads m.  A matrix cannot be both, as the recomputation
+  // would read a matrix that is not there any more.
+  std::vector<bool> is_selected(num_matrices, false),
+      is_source(num_matrices, false), is_used(candidates.size(), false);
+  while (true) {
+    int32 peak = std::max_element(memory_use_.begin(), memory_use_.end()) -
+        memory_use_.begin();
+    if (memory_use_[peak] <= memory_budget_)
+      break;
+    int32 best = -1;
+    for (size_t i = 0; i < candidates.size(); i++) {
+      const RecomputeInfo &info = candidates[i];
+      if (is_used[i] || info.last_forward_command >= peak ||
+          info.first_backward_command <= peak || is_source[info.m] ||
+          (best >= 0 && info.num_bytes <= candidates[best].num_bytes))
+        continue;
+      bool ok = true;
+      for (size_t j = 0; j < info.sources.size(); j++)
+        if (is_selected[info.sources[j]])
+          ok = false;
+      if (ok)
+        best = i;
+    }
+    if (best < 0)
+      break;  // nothing more can be freed at the peak.
+    const RecomputeInfo &info = candidates[best];
+    is_used[best] = true;
+    is_selected[info.m] = true;
+    for (size_t j = 0; j < info.sources.size(); j++)
+      is_source[info.sources[j]] = true;
+    for (int32 c = info.last_forward_command + 1;
+         c < info.first_backward_command; c++)
+      memory_use_[c] -= info.num_bytes;
+    selected_.push_back(info);
+  }
+  if (!selected_.empty())
+    ModifyComputation();
+}
+
+
+void RecomputationOptimizer::ModifyComputation() {
+  std::vector<int32> whole_submatrices;
+  computation_->GetWholeSubmatrices(&whole_submatrices);
+  int32 num_commands = computation_->commands.size();
+
+  // 'pairs_to_insert' will be a list of pairs (command-index, command),
+  // meaning: (command-index just before which to insert this command; command
+  // to insert).
+  std::vector<std::pair<int32, NnetComputation::Command> > pairs_to_insert;
+  for (size_t i = 0; i < selected_.size(); i++) {
+    const RecomputeInfo &info = selected_[i];
+    int32 m = info.m, old_whole = whole_submatrices[m];
+    NnetComputation::MatrixInfo matrix_info = computation_->matrices[m];
+    int32 new_whole = computation_->NewMatrix(matrix_info.num_rows,
+                                              matrix_info.num_cols,
+                                              matrix_info.stride_type),
+        new_m = computation_->submatrices[new_whole].matrix_index;
+    if (!computation_->matrix_debug_info.empty())
+      computation_->matrix_debug_info[new_m] =
+          computation_->matrix_debug_info[m];
+    // maps the submatrices of m to the same parts of new_m.
+    std::map<int32, int32> submatrix_map;
+    submatrix_map[old_whole] = new_whole;
+
+    pairs_to_insert.push_back(std::pair<int32, NnetComputation::Command>(
+        info.last_forward_command + 1,
+        NnetComputation::Command(kDeallocMatrix, old_whole)));
+    pairs_to_insert.push_back(std::pair<int32, NnetComputation::Command>(
+        info.first_backward_command,
+        NnetComputation::Command(kAllocMatrix, new_whole)));
+
+    // the repeated commands, and the rest of the backward pass, use new_m.
+    std::vector<NnetComputation::Command> repeated_commands;
+    for (size_t j = 0; j < info.write_commands.size(); j++) {
+      NnetComputation::Command command =
+          computation_->commands[info.write_commands[j]];
+      if (command.command_type == kPropagate) {
+        command.arg5 = 0;  // the memo of the first Propagate is the one used.
+        command.arg6 = 0;  // don't store the stats twice.
+      }
+      repeated_commands.push_back(command);
+    }
+    std::vector<int32*> submatrix_args, this_submatrix_args;
+    IdentifySubmatrixArgs(&repeated_commands, &submatrix_args);
+    for (int32 c = info.first_backward_command; c < num_commands; c++) {
+      IdentifySubmatrixArgs(&(computation_->commands[c]),
+                            &this_submatrix_args);
+      submatrix_args.insert(submatrix_args.end(), this_submatrix_args.begin(),
+                            this_submatrix_args.end());
+    }
+    for (size_t j = 0; j < submatrix_args.size(); j++) {
+      int32 *s = submatrix_args[j];
+      if (*s <= 0 || computation_->submatrices[*s].matrix_index != m)
+        continue;
+      std::map<int32, int32>::iterator iter = submatrix_map.find(*s);
+      if (iter == submatrix_map.end()) {
+        NnetComputation::SubMatrixInfo sub_info = computation_->submatrices[*s];
+        int32 new_s = computation_->NewSubMatrix(new_whole,
+                                                 sub_info.row_offset,
+                                                 sub_info.num_rows,
+                                                 sub_info.col_offset,
+                                                 sub_info.num_cols);
+        iter = submatrix_map.insert(std::make_pair(*s, new_s)).first;
+      }
+      *s = iter->second;
+    }
+    for (size_t j = 0; j < repeated_commands.size(); j++)
+      pairs_to_insert.push_back(std::pair<int32, NnetComputation::Command>(
+          info.first_backward_command, repeated_commands[j]));
+  }
+  InsertCommands(&pairs_to_insert, computation_);
+}
+
+
+void OptimizeRecomputation(const Nnet &nnet,
+                           BaseFloat memory_budget_mb,
+                           NnetComputation *computation) {
+  if (memory_budget_mb <= 0.0 || computation->commands.empty())
+    return;
+  // don't apply this optimization to looped computations.
+  if (computation->commands.back().command_type == kGotoLabel)
+    return;
+  int32 middle_command = FindMiddleCommand(*computation);
+  if (middle_command == -1)
+    return;  // This computation doesn't have a backprop pass.
+  int64 memory_budget = static_cast<int64>(memory_budget_mb * 1048576.0);
+  int64 bytes_used_initial = GetMaxMemoryUse(*computation);
+  if (bytes_used_initial <= memory_budget)
+    return;
+  RecomputationOptimizer opt(nnet, memory_budget, middle_command, computation);
+  opt.Optimize();
+  if (GetVerboseLevel() >= 2) {
+    int64 bytes_used_final = GetMaxMemoryUse(*computation);
+    KALDI_VLOG(2) << "Recomputation reduced memory use from "
+                  << bytes_used_initial << " to " << bytes_used_final
+                  << " bytes (budget was " << memory_budget << ").";
+  }
+}
+
+
 std::shared_ptr<const NnetComputation> ComputationCache::Find(
     const ComputationRequest &in_request) {
   std::lock_guard<std::mutex> lock(mutex_);
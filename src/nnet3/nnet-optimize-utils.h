@@ -593,6 +593,23 @@ void OptimizeMemoryCompression(const Nnet &nnet,
                                int32 memory_compression_level,
                                NnetComputation *computation);
 
+/// This optimization trades computation for memory in training computations
+/// ("activation checkpointing").  If the computation's maximum memory use is
+/// more than memory_budget_mb megabytes, it frees some of the matrices of
+/// values that are kept from the forward pass only because Backprop needs
+/// them, and recomputes them just before that Backprop, by repeating the
+/// forward commands that wrote them from the matrices that are kept.  It
+/// chooses the matrices, largest first, among those that can be freed where
+/// the memory use peaks, until the peak is within the budget or nothing more
+/// can be freed there.  The results are the same, except that components of
+/// type kRandomComponent are never recomputed.  It does nothing if
+/// memory_budget_mb <= 0, or for looped computations.  Like
+/// OptimizeMemoryCompression(), it should be done after most other
+/// optimizations.
+void OptimizeRecomputation(const Nnet &nnet,
+                           BaseFloat memory_budget_mb,
+                           NnetComputation *computation);
+
 
 /// This function tries to optimize computation 'computation' for an 'looped'
 /// computation.  It expects as input a computation with no backprop but with
@@ -616,6 +633,21 @@ void OptimizeLoopedComputation(const Nnet &nnet,
 void FixGotoLabel(NnetComputation *computation);
 
 
+/// This function finds chains of kPropagate commands in which a Propagate is
+/// followed by element-wise Propagates of simple components (ReLU, sigmoid,
+/// tanh, batch-norm in test mode, fixed or learned scales and offsets...),
+/// each reading the output of the one before, as in the Affine->ReLU->BatchNorm
+/// of TDNN-F layers.  It moves any kDeallocMatrix commands out of the way, so
+/// the commands of a chain are consecutive, and sets arg7 of the first command
+/// of each chain to the number of commands in it.  On the CPU, NnetComputer
+/// then runs the element-wise part of the chain a tile of rows at a time, so
+/// that each tile stays in the cache (see NnetComputer::ExecutePropagateChain()).
+/// Other code ignores arg7 of kPropagate, so the computation is still correct
+/// as it was.  Should be the last optimization, as the others would not keep
+/// the chains consecutive.
+void FusePropagateChains(const Nnet &nnet, NnetComputation *computation);
+
+
 /// Class ComputationCache is used inside class CachingOptimizingCompiler to
 /// cache previously computed computations.  The code was moved from class
 /// CachingOptimizingCompiler to this separate class for clarity when adding
@@ -18,7 +18,10 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
+#include <thread>
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-optimize-utils.h"
 #include "nnet3/nnet-utils.h"
@@ -79,6 +82,14 @@ void NnetOptimizeOptions::Read(std::istream &is, bool binary) {
     ExpectToken(is, binary, "<MemoryCompressionLevel>");
     ReadBasicType(is, binary, &memory_compression_level);
   }
+  if (PeekToken(is, binary) == 'R') {
+    ExpectToken(is, binary, "<RecomputeMemoryBudget>");
+    ReadBasicType(is, binary, &recompute_memory_budget);
+  }
+  if (PeekToken(is, binary) == 'F') {
+    ExpectToken(is, binary, "<FusePropagate>");
+    ReadBasicType(is, binary, &fuse_propagate);
+  }
   ExpectToken(is, binary, "</NnetOptimizeOptions>");
 }
 
@@ -122,6 +133,10 @@ void NnetOptimizeOptions::Write(std::ostream &os, bool binary) const {
   WriteBasicType(os, binary, snip_row_ops);
   WriteToken(os, binary, "<MemoryCompressionLevel>");
   WriteBasicType(os, binary, memory_compression_level);
+  WriteToken(os, binary, "<RecomputeMemoryBudget>");
+  WriteBasicType(os, binary, recompute_memory_budget);
+  WriteToken(os, binary, "<FusePropagate>");
+  WriteBasicType(os, binary, fuse_propagate);
   WriteToken(os, binary, "</NnetOptimizeOptions>");
 }
 
@@ -143,7 +158,9 @@ bool NnetOptimizeOptions::operator == (const NnetOptimizeOptions &other) const {
           other.max_deriv_time == max_deriv_time &&
           other.max_deriv_time_relative == max_deriv_time_relative &&
           other.snip_row_ops == snip_row_ops &&
-          other.memory_compression_level == memory_compression_level);
+          other.memory_compression_level == memory_compression_level &&
+          other.recompute_memory_budget == recompute_memory_budget &&
+          other.fuse_propagate == fuse_propagate);
 }
 
 // move commands that resize and zero matrices to as late/early as possible.
@@ -498,10 +515,21 @@ int32 MaxOutputTimeInRequest(const ComputationRequest &request) {
 }
 
 
+// At --verbose=2 and above, logs the time taken by an optimization pass (since
+// 'timer' was last reset) and resets the timer.
+static void LogPassTime(const char *pass, Timer *timer) {
+  if (GetVerboseLevel() >= 2) {
+    KALDI_VLOG(2) << "Optimization pass " << pass << " took "
+                  << timer->Elapsed() << " seconds";
+    timer->Reset();
+  }
+}
+
 void Optimize(const NnetOptimizeOptions &config,
               const Nnet &nnet,
               int32 max_output_time_in_request,
               NnetComputation *computation) {
+  Timer timer;
   if (GetVerboseLevel() >= 3) {
     CheckComputation(nnet, *computation, true);
     KALDI_LOG << "Before optimization, max memory use (bytes) = "
@@ -518,9 +546,11 @@ void Optimize(const NnetOptimizeOptions &config,
       max_deriv_time = config.max_deriv_time_relative +
           max_output_time_in_request;
     if (config.min_deriv_time != std::numeric_limits<int32>::min() ||
-        max_deriv_time != std::numeric_limits<int32>::max())
+        max_deriv_time != std::numeric_limits<int32>::max()) {
       LimitDerivativeTimes(nnet, config.min_deriv_time,
                            max_deriv_time, computation);
+      LogPassTime("LimitDerivativeTimes", &timer);
+    }
   }
 
   if (GetVerboseLevel() >= 3)
@@ -528,6 +558,7 @@ void Optimize(const NnetOptimizeOptions &config,
 
   if (config.optimize && config.consolidate_model_update) {
     ConsolidateModelUpdate(nnet, computation);
+    LogPassTime("ConsolidateModelUpdate", &timer);
 
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, true);
@@ -535,6 +566,7 @@ void Optimize(const NnetOptimizeOptions &config,
 
   if (config.optimize && config.convert_addition) {
     ConvertAdditionToAssignment(nnet, computation);
+    LogPassTime("ConvertAdditionToAssignment", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, true);
   }
@@ -550,8 +582,10 @@ void Optimize(const NnetOptimizeOptions &config,
     if (config.optimize_row_ops && ReplaceRowWithMatrixOps(computation))
       must_renumber = true;
 
+    LogPassTime("row-ops", &timer);
     if (must_renumber) {
       RenumberComputation(computation);
+      LogPassTime("RenumberComputation", &timer);
       if (GetVerboseLevel() >= 3)
         CheckComputation(nnet, *computation, false);
     }
@@ -560,6 +594,7 @@ void Optimize(const NnetOptimizeOptions &config,
   if (config.optimize && config.extend_matrices &&
       !config.optimize_looped_computation) {
     ExtendMatrices(computation);
+    LogPassTime("ExtendMatrices", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
@@ -569,12 +604,14 @@ void Optimize(const NnetOptimizeOptions &config,
       (config.remove_assignments || config.backprop_in_place ||
        config.propagate_in_place)) {
     VariableMergingOptimization(config, nnet, computation);
+    LogPassTime("VariableMergingOptimization", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
 
   if (config.optimize && config.initialize_undefined) {
     RemoveUnnecessaryZeroing(nnet, computation);
+    LogPassTime("RemoveUnnecessaryZeroing", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
@@ -583,6 +620,7 @@ void Optimize(const NnetOptimizeOptions &config,
   if ((config.optimize && config.move_sizing_commands) ||
       config.optimize_looped_computation) {
     MoveSizingCommands(nnet, computation);
+    LogPassTime("MoveSizingCommands", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
@@ -592,6 +630,7 @@ void Optimize(const NnetOptimizeOptions &config,
   // because it's necessary for looped computation to run.
   if (config.optimize_looped_computation) {
     OptimizeLoopedComputation(nnet, computation);
+    LogPassTime("OptimizeLoopedComputation", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
@@ -602,6 +641,7 @@ void Optimize(const NnetOptimizeOptions &config,
     // would be correct in that case, as written.  In any case the performance
     // benefit is tiny.
     RemoveUnnecessaryAllocation(nnet, computation);
+    LogPassTime("RemoveUnnecessaryAllocation", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
@@ -616,14 +656,34 @@ void Optimize(const NnetOptimizeOptions &config,
     FixGotoLabel(computation);
 
 
+  // this goes before the memory compression, which then leaves alone the
+  // matrices that are recomputed.
+  if (config.optimize && config.recompute_memory_budget > 0.0 &&
+      !config.optimize_looped_computation) {
+    OptimizeRecomputation(nnet, config.recompute_memory_budget, computation);
+    LogPassTime("OptimizeRecomputation", &timer);
+    if (GetVerboseLevel() >= 3)
+      CheckComputation(nnet, *computation, false);
+  }
+
   if (config.memory_compression_level > 0 &&
       !config.optimize_looped_computation) {
     OptimizeMemoryCompression(nnet, config.memory_compression_level,
                               computation);
+    LogPassTime("OptimizeMemoryCompression", &timer);
     if (GetVerboseLevel() >= 3)
       CheckComputation(nnet, *computation, false);
   }
 
+  // This has to be last, as other optimizations would not keep the chains of
+  // commands it marks together.
+  if (config.optimize && config.fuse_propagate) {
+    FusePropagateChains(nnet, computation);
+    if (config.optimize_looped_computation)
+      FixGotoLabel(computation);
+    LogPassTime("FusePropagateChains", &timer);
+  }
+
   if (GetVerboseLevel() >= 3) {
     CheckComputation(nnet, *computation, false);
     KALDI_LOG << "After optimization, max memory use (bytes) = "
@@ -632,6 +692,45 @@ void Optimize(const NnetOptimizeOptions &config,
 }
 
 
+// Returns a description of everything besides the ComputationRequest that the
+// compiled computation depends on, for the key of the files in
+// CachingOptimizingCompilerOptions::cache_dir.
+static std::string CacheDirSignature(const Nnet &nnet,
+                                     const NnetOptimizeOptions &opt_config,
+                                     bool use_shortcut) {
+  std::ostringstream os;
+  opt_config.Write(os, false);
+  os << "use-shortcut=" << use_shortcut << "\n";
+  std::vector<std::string> config_lines;
+  bool include_dim = true;
+  nnet.GetConfigLines(include_dim, &config_lines);
+  for (size_t i = 0; i < config_lines.size(); i++)
+    os << config_lines[i] << "\n";
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    const Component *component = nnet.GetComponent(c);
+    os << nnet.GetComponentName(c) << " " << component->Properties()
+       << " " << component->Info() << "\n";
+  }
+  return os.str();
+}
+
+// 64-bit FNV-1a hash; unlike std::hash it is the same in every program, which
+// is needed as the hashes name files shared between programs.
+static uint64 Fnv1aHash(const std::string &str, uint64 hash) {
+  for (size_t i = 0; i < str.size(); i++) {
+    hash ^= static_cast<unsigned char>(str[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The hash of CacheDirSignature() as a token, written in the cached files.
+static std::string SignatureToken(const std::string &signature) {
+  std::ostringstream os;
+  os << std::hex << Fnv1aHash(signature, 14695981039346656037ULL);
+  return os.str();
+}
+
 CachingOptimizingCompiler::CachingOptimizingCompiler(
     const Nnet &nnet,
     const CachingOptimizingCompilerOptions config):
@@ -640,7 +739,11 @@ CachingOptimizingCompiler::CachingOptimizingCompiler(
     seconds_taken_optimize_(0.0), seconds_taken_expand_(0.0),
     seconds_taken_check_(0.0), seconds_taken_indexes_(0.0),
     seconds_taken_io_(0.0), cache_(config.cache_capacity),
-    nnet_left_context_(-1), nnet_right_context_(-1) { }
+    nnet_left_context_(-1), nnet_right_context_(-1) {
+  if (!config_.cache_dir.empty())
+    cache_dir_signature_ = CacheDirSignature(nnet_, opt_config_,
+                                             config_.use_shortcut);
+}
 
 CachingOptimizingCompiler::CachingOptimizingCompiler(
     const Nnet &nnet,
@@ -651,7 +754,11 @@ CachingOptimizingCompiler::CachingOptimizingCompiler(
     seconds_taken_optimize_(0.0), seconds_taken_expand_(0.0),
     seconds_taken_check_(0.0), seconds_taken_indexes_(0.0),
     seconds_taken_io_(0.0), cache_(config.cache_capacity),
-    nnet_left_context_(-1), nnet_right_context_(-1) { }
+    nnet_left_context_(-1), nnet_right_context_(-1) {
+  if (!config_.cache_dir.empty())
+    cache_dir_signature_ = CacheDirSignature(nnet_, opt_config_,
+                                             config_.use_shortcut);
+}
 
 void CachingOptimizingCompiler::GetSimpleNnetContext(
     int32 *nnet_left_context, int32 *nnet_right_context) {
@@ -728,29 +835,127 @@ std::shared_ptr<const NnetComputation> CachingOptimizingCompiler::CompileInterna
     return ans;
   } else {
     const NnetComputation *computation = NULL;
+    if (!config_.cache_dir.empty()) {
+      computation = ReadFromCacheDir(request);
+      if (computation != NULL)
+        return cache_.Insert(request, computation);
+    }
     if (config_.use_shortcut)
       computation = CompileViaShortcut(request);
     if (computation == NULL)
       computation = CompileNoShortcut(request);
     KALDI_ASSERT(computation != NULL);
+    if (!config_.cache_dir.empty())
+      WriteToCacheDir(request, *computation);
     return cache_.Insert(request, computation);
   }
 }
 
+std::string CachingOptimizingCompiler::CacheDirFilename(
+    const ComputationRequest &request) const {
+  std::ostringstream request_os;
+  request.Write(request_os, true);
+  uint64 hash = Fnv1aHash(cache_dir_signature_, 14695981039346656037ULL);
+  hash = Fnv1aHash(request_os.str(), hash);
+  std::ostringstream os;
+  os << config_.cache_dir << "/" << std::hex << std::setw(16)
+     << std::setfill('0') << hash << ".computation";
+  return os.str();
+}
+
+const NnetComputation *CachingOptimizingCompiler::ReadFromCacheDir(
+    const ComputationRequest &request) {
+  Timer timer;
+  std::string filename = CacheDirFilename(request);
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!is.is_open())
+    return NULL;  // not cached yet.
+  NnetComputation *computation = new NnetComputation();
+  try {
+    bool binary;
+    if (!InitKaldiInputStream(is, &binary))
+      KALDI_ERR << "Could not read the header";
+    std::string signature;
+    ExpectToken(is, binary, "<CachedComputation>");
+    ReadToken(is, binary, &signature);
+    ComputationRequest cached_request;
+    cached_request.Read(is, binary);
+    // the file name is only a hash, so make sure it is for this request.
+    if (signature != SignatureToken(cache_dir_signature_) ||
+        !(cached_request == request)) {
+      KALDI_WARN << "Hash collision in the cache of compiled computations: "
+                 << filename << " is for a different computation";
+      delete computation;
+      return NULL;
+    }
+    computation->Read(is, binary);
+    ExpectToken(is, binary, "</CachedComputation>");
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Could not read cached computation from " << filename
+               << ", compiling it instead: " << e.what();
+    delete computation;
+    return NULL;
+  }
+  if (GetVerboseLevel() >= 2) {
+    CheckComputationOptions check_config;
+    ComputationChecker checker(check_config, nnet_, *computation);
+    checker.Check();
+  }
+  seconds_taken_io_ += timer.Elapsed();
+  return computation;
+}
+
+void CachingOptimizingCompiler::WriteToCacheDir(
+    const ComputationRequest &request,
+    const NnetComputation &computation) {
+  Timer timer;
+  std::string filename = CacheDirFilename(request);
+  // another process may be writing the same file, so write to a name of our
+  // own and then rename, which replaces the file atomically.
+  std::ostringstream tmp_os;
+  tmp_os << filename << ".tmp." << std::this_thread::get_id() << "."
+         << RandInt(0, 1 << 30);
+  std::string tmp_filename = tmp_os.str();
+  {
+    std::ofstream os(tmp_filename.c_str(), std::ios::out | std::ios::binary);
+    bool binary = true;
+    InitKaldiOutputStream(os, binary);
+    WriteToken(os, binary, "<CachedComputation>");
+    WriteToken(os, binary, SignatureToken(cache_dir_signature_));
+    request.Write(os, binary);
+    computation.Write(os, binary);
+    WriteToken(os, binary, "</CachedComputation>");
+    os.close();
+    if (os.fail()) {
+      KALDI_WARN << "Could not write compiled computation to " << tmp_filename;
+      std::remove(tmp_filename.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    KALDI_WARN << "Could not rename " << tmp_filename << " to " << filename;
+    std::remove(tmp_filename.c_str());
+  }
+  seconds_taken_io_ += timer.Elapsed();
+}
+
 
 const NnetComputation *CachingOptimizingCompiler::CompileNoShortcut(
     const ComputationRequest &request) {
 
+  Timer total_timer;
   Compiler compiler(request, nnet_);
   // note: 'opts' only contains 'output_debug_info', which is true by default.
   // There may be situations where we'd prefer not to keep it, for speed.
   CompilerOptions opts;
   NnetComputation *computation = new NnetComputation;
+  double seconds_compile, seconds_optimize;
 
   {
     Timer timer;
     compiler.CreateComputation(opts, computation);
-    seconds_taken_compile_ += timer.Elapsed();
+    seconds_compile = timer.Elapsed();
+    seconds_taken_compile_ += seconds_compile;
   }
 
   int32 verbose_cutoff = 4;
@@ -779,7 +984,8 @@ const NnetComputation *CachingOptimizingCompiler::CompileNoShortcut(
     Optimize(opt_config_, nnet_,
              MaxOutputTimeInRequest(request),
              computation);
-    seconds_taken_optimize_ += timer.Elapsed();
+    seconds_optimize = timer.Elapsed();
+    seconds_taken_optimize_ += seconds_optimize;
   }
 
   if (GetVerboseLevel() >= verbose_cutoff) {
@@ -801,6 +1007,13 @@ const NnetComputation *CachingOptimizingCompiler::CompileNoShortcut(
     computation->ComputeCudaIndexes();
     seconds_taken_indexes_ += timer.Elapsed();
   }
+  // a computation compiled while serving requests (e.g. for a new chunk size)
+  // stalls them, so say which ones are slow.
+  KALDI_VLOG(1) << "Compiled a computation with "
+                << computation->commands.size() << " commands and "
+                << computation->matrices.size() << " matrices in "
+                << total_timer.Elapsed() << " seconds (" << seconds_compile
+                << " compilation, " << seconds_optimize << " optimization)";
   return computation;
 }
 
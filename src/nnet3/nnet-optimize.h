@@ -54,6 +54,8 @@ struct NnetOptimizeOptions {
   int32 max_deriv_time_relative;
   bool snip_row_ops;
   int32 memory_compression_level;
+  BaseFloat recompute_memory_budget;
+  bool fuse_propagate;
   // optimize_looped_computation is a 'hidden config' not available from
   // the command line; it's set to true to enable the optimization for
   // looped computation that turns a linear computation into a loop.
@@ -79,6 +81,8 @@ struct NnetOptimizeOptions {
       max_deriv_time_relative(std::numeric_limits<int32>::max()),
       snip_row_ops(true),
       memory_compression_level(1),
+      recompute_memory_budget(0.0),
+      fuse_propagate(true),
       optimize_looped_computation(false) { }
 
   void Register(OptionsItf *opts) {
@@ -145,6 +149,18 @@ struct NnetOptimizeOptions {
                    "potentially at the expense of speed and the accuracy "
                    "of derivatives.  0 means no compression at all; 1 means "
                    "compression that shouldn't affect results at all.");
+    opts->Register("recompute-memory-budget", &recompute_memory_budget,
+                   "This is only relevant to training, not decoding.  If >0, "
+                   "and the computation would use more than this many "
+                   "megabytes of memory, values needed for backprop are "
+                   "freed after the forward pass and recomputed from the "
+                   "values that are kept just before the backprop needs them, "
+                   "until the memory use is within this budget; this trades "
+                   "computation for memory, e.g. to allow larger minibatches.");
+    opts->Register("fuse-propagate", &fuse_propagate, "Set to false to "
+                   "disable the optimization that marks chains of element-wise "
+                   "Propagate commands (e.g. ReLU then batch-norm), to be run "
+                   "a cache-sized tile of rows at a time on the CPU");
 
   }
   void Read(std::istream &is, bool binary);
@@ -192,6 +208,7 @@ void Optimize(const NnetOptimizeOptions &config,
 struct CachingOptimizingCompilerOptions {
   bool use_shortcut;
   int32 cache_capacity;
+  std::string cache_dir;
 
   CachingOptimizingCompilerOptions():
       use_shortcut(true),
@@ -208,6 +225,10 @@ struct CachingOptimizingCompilerOptions {
     opts->Register("cache-capacity", &cache_capacity,
                    "Determines how many computations the computation-cache will "
                    "store (most-recently-used).");
+    opts->Register("cache-dir", &cache_dir,
+                   "If set, a directory in which compiled computations are "
+                   "kept between runs, shared by all processes using the same "
+                   "model; see CachingOptimizingCompiler.");
   }
 };
 
@@ -216,6 +237,16 @@ struct CachingOptimizingCompilerOptions {
 /// one, the compilation process is not repeated.
 /// It is safe to call Compile() from multiple parallel threads without additional
 /// synchronization; synchronization is managed internally by class ComputationCache.
+///
+/// If config.cache_dir is set, computations that are not in the in-memory cache
+/// are looked for in that directory before being compiled, and newly compiled
+/// ones are written there, one file per computation.  The file name is a hash
+/// of the ComputationRequest, the optimization options and the network's
+/// structure and component configuration (as printed by Component::Info(), so
+/// a retrained model gets its own entries); the request itself is stored in the
+/// file too and checked on reading.  Files are written to a temporary name and
+/// renamed, so several processes may share the directory.  See also
+/// nnet3-compile-warmup, which fills it in ahead of time.
 class CachingOptimizingCompiler {
  public:
   CachingOptimizingCompiler(const Nnet &nnet,
@@ -285,6 +316,18 @@ class CachingOptimizingCompiler {
   // the computation cache).
   const NnetComputation *CompileNoShortcut(const ComputationRequest &request);
 
+  // Returns the file in config_.cache_dir for this request.
+  std::string CacheDirFilename(const ComputationRequest &request) const;
+
+  // Reads the computation for this request from config_.cache_dir; returns NULL
+  // if it is not there (or could not be read).
+  const NnetComputation *ReadFromCacheDir(const ComputationRequest &request);
+
+  // Writes the computation for this request to config_.cache_dir.  Failures are
+  // only warned about.
+  void WriteToCacheDir(const ComputationRequest &request,
+                       const NnetComputation &computation);
+
   const Nnet &nnet_;
   CachingOptimizingCompilerOptions config_;
   NnetOptimizeOptions opt_config_;
@@ -301,6 +344,10 @@ class CachingOptimizingCompiler {
 
   ComputationCache cache_;
 
+  // Only set if config_.cache_dir is set: a description of the network and
+  // the optimization options, part of the key of the files in that directory.
+  std::string cache_dir_signature_;
+
   // These following two variables are only used by the function GetSimpleNnetContext().
   int32 nnet_left_context_;
   int32 nnet_right_context_;
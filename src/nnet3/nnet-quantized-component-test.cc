@@ -0,0 +1,146 @@
+// nnet3/nnet-quantized-component-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "nnet3/nnet-nnet.h"
+#include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-optimize.h"
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Runs 'nnet' on 'input', whose rows are the frames t = 0, 1, ... and puts
+// the output for the frames with t in [left_context, num-rows - right_context)
+// in 'output'.
+static void RunNnet(const Nnet &nnet, const CuMatrix<BaseFloat> &input,
+                    int32 left_context, int32 right_context,
+                    CuMatrix<BaseFloat> *output) {
+  ComputationRequest request;
+  request.inputs.resize(1);
+  request.outputs.resize(1);
+  request.inputs[0].name = "input";
+  request.outputs[0].name = "output";
+  for (int32 t = 0; t < input.NumRows(); t++)
+    request.inputs[0].indexes.push_back(Index(0, t));
+  for (int32 t = left_context; t < input.NumRows() - right_context; t++)
+    request.outputs[0].indexes.push_back(Index(0, t));
+  CachingOptimizingCompiler compiler(nnet);
+  std::shared_ptr<const NnetComputation> computation =
+      compiler.Compile(request);
+  NnetComputer computer(NnetComputeOptions(), *computation, nnet, NULL);
+  CuMatrix<BaseFloat> input_copy(input);
+  computer.AcceptInput("input", &input_copy);
+  computer.Run();
+  computer.GetOutputDestructive("output", output);
+}
+
+void UnitTestQuantizeNnet(QuantizationMethod method) {
+  std::string config =
+    "input-node name=input dim=40\n"
+    "component name=affine1 type=NaturalGradientAffineComponent "
+    "input-dim=120 output-dim=256\n"
+    "component-node name=affine1 component=affine1 "
+    "input=Append(Offset(input,-1),input,Offset(input,1))\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=256\n"
+    "component-node name=relu1 component=relu1 input=affine1\n"
+    "component name=linear2 type=LinearComponent input-dim=256 "
+    "output-dim=64\n"
+    "component-node name=linear2 component=linear2 input=relu1\n"
+    "component name=tdnn3 type=TdnnComponent input-dim=64 output-dim=200 "
+    "time-offsets=-2,0,2 bias-stddev=1.0\n"
+    "component-node name=tdnn3 component=tdnn3 input=linear2\n"
+    "component name=relu3 type=RectifiedLinearComponent dim=200\n"
+    "component-node name=relu3 component=relu3 input=tdnn3\n"
+    "component name=tdnn4 type=TdnnComponent input-dim=200 output-dim=100 "
+    "time-offsets=-1,0 use-bias=false\n"
+    "component-node name=tdnn4 component=tdnn4 input=relu3\n"
+    "component name=block5 type=BlockAffineComponent input-dim=100 "
+    "output-dim=50 num-blocks=5 bias-stddev=1.0\n"
+    "component-node name=block5 component=block5 input=tdnn4\n"
+    "component name=affine6 type=FixedAffineComponent input-dim=50 "
+    "output-dim=10\n"
+    "component-node name=affine6 component=affine6 input=block5\n"
+    "output-node name=output input=affine6\n";
+  Nnet nnet;
+  std::istringstream is(config);
+  nnet.ReadConfig(is);
+
+  CuMatrix<BaseFloat> input(50, 40), output;
+  input.SetRandn();
+  // the context is 1 + 2 + 1 frames on the left and 1 + 2 on the right.
+  RunNnet(nnet, input, 4, 3, &output);
+
+  Nnet quantized(nnet);
+  KALDI_ASSERT(QuantizeNnet(method, &quantized) == 6);
+  for (int32 c = 0; c < quantized.NumComponents(); c++) {
+    std::string type = quantized.GetComponent(c)->Type();
+    KALDI_ASSERT(type == "RectifiedLinearComponent" ||
+                 type == "QuantizedAffineComponent" ||
+                 type == "QuantizedTdnnComponent");
+  }
+  KALDI_LOG << "Quantized nnet info: " << quantized.Info();
+  CuMatrix<BaseFloat> quantized_output;
+  RunNnet(quantized, input, 4, 3, &quantized_output);
+  CuMatrix<BaseFloat> error(quantized_output);
+  error.AddMat(-1.0, output);
+  BaseFloat relative_error = error.FrobeniusNorm() / output.FrobeniusNorm();
+  KALDI_LOG << "Relative error of the quantized nnet ("
+            << QuantizationMethodToString(method) << ") is "
+            << relative_error;
+  KALDI_ASSERT(relative_error < (method == kFloat16 ? 0.005 : 0.05));
+
+  // written and read, gives the same output.
+  for (int32 binary = 0; binary < 2; binary++) {
+    std::ostringstream os;
+    quantized.Write(os, binary == 1);
+    Nnet quantized2;
+    std::istringstream is(os.str());
+    quantized2.Read(is, binary == 1);
+    CuMatrix<BaseFloat> quantized2_output;
+    RunNnet(quantized2, input, 4, 3, &quantized2_output);
+    AssertEqual(quantized_output, quantized2_output, 1.0e-04);
+  }
+}
+
+} // namespace nnet3
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet3;
+#if HAVE_CUDA == 1
+  kaldi::int32 loop = 0;
+  for (loop = 0; loop < 2; loop++) {
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("yes");
+#endif
+    UnitTestQuantizeNnet(kInt8RowScale);
+    UnitTestQuantizeNnet(kFloat16);
+#if HAVE_CUDA == 1
+  } // No for loop if 'HAVE_CUDA != 1',
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  KALDI_LOG << "Nnet quantized component tests succeeded.";
+
+  return 0;
+}
@@ -0,0 +1,330 @@
+// nnet3/nnet-quantized-component.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <sstream>
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-parse.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+
+QuantizedParams::QuantizedParams(const CuMatrixBase<BaseFloat> &params,
+                                 QuantizationMethod method):
+    shared_(new Shared()) {
+  shared_->quantized.CopyFromMat(Matrix<BaseFloat>(params), method);
+}
+
+void QuantizedParams::AddMatMatTrans(const CuMatrixBase<BaseFloat> &in,
+                                     CuMatrixBase<BaseFloat> *out) const {
+  KALDI_ASSERT(shared_);
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Shared *shared = shared_.get();
+    std::call_once(shared->expand_once, [shared]() {
+        Matrix<BaseFloat> expanded(shared->quantized.NumRows(),
+                                   shared->quantized.NumCols(), kUndefined);
+        shared->quantized.CopyToMat(&expanded);
+        shared->expanded = expanded;
+      });
+    out->AddMatMat(1.0, in, kNoTrans, shared->expanded, kTrans, 1.0);
+    return;
+  }
+#endif
+  shared_->quantized.AddMatMatTrans<BaseFloat>(1.0, in.Mat(), 1.0,
+                                               &(out->Mat()));
+}
+
+void QuantizedParams::Read(std::istream &is, bool binary) {
+  shared_.reset(new Shared());
+  shared_->quantized.Read(is, binary);
+}
+
+void QuantizedParams::Write(std::ostream &os, bool binary) const {
+  KALDI_ASSERT(shared_);
+  shared_->quantized.Write(os, binary);
+}
+
+// Appends to 'os' the method and size of 'params'.
+static void PrintQuantizedStats(std::ostringstream &os,
+                                const std::string &name,
+                                const std::vector<QuantizedParams> &params) {
+  size_t size = 0;
+  for (size_t i = 0; i < params.size(); i++)
+    size += params[i].SizeInBytes();
+  os << ", " << name << "-method="
+     << (params.empty() ? "none" :
+         QuantizationMethodToString(params[0].Method()))
+     << ", " << name << "-bytes=" << size;
+}
+
+
+QuantizedAffineComponent::QuantizedAffineComponent(const Component &component,
+                                                   QuantizationMethod method) {
+  KALDI_ASSERT(CanQuantize(component));
+  std::string type = component.Type();
+  if (type == "AffineComponent" || type == "NaturalGradientAffineComponent") {
+    const AffineComponent &affine =
+        dynamic_cast<const AffineComponent&>(component);
+    blocks_.push_back(QuantizedParams(affine.LinearParams(), method));
+    bias_params_ = affine.BiasParams();
+  } else if (type == "FixedAffineComponent") {
+    const FixedAffineComponent &affine =
+        dynamic_cast<const FixedAffineComponent&>(component);
+    blocks_.push_back(QuantizedParams(affine.LinearParams(), method));
+    bias_params_ = affine.BiasParams();
+  } else if (type == "LinearComponent") {
+    const LinearComponent &linear =
+        dynamic_cast<const LinearComponent&>(component);
+    blocks_.push_back(QuantizedParams(linear.Params(), method));
+  } else {
+    const BlockAffineComponent &block_affine =
+        dynamic_cast<const BlockAffineComponent&>(component);
+    const CuMatrix<BaseFloat> &linear_params = block_affine.LinearParams();
+    int32 num_blocks = block_affine.NumBlocks(),
+        num_rows_in_block = linear_params.NumRows() / num_blocks;
+    for (int32 b = 0; b < num_blocks; b++)
+      blocks_.push_back(QuantizedParams(
+          linear_params.RowRange(b * num_rows_in_block, num_rows_in_block),
+          method));
+    bias_params_ = block_affine.BiasParams();
+  }
+}
+
+bool QuantizedAffineComponent::CanQuantize(const Component &component) {
+  std::string type = component.Type();
+  return type == "AffineComponent" ||
+      type == "NaturalGradientAffineComponent" ||
+      type == "FixedAffineComponent" || type == "LinearComponent" ||
+      type == "BlockAffineComponent";
+}
+
+std::string QuantizedAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info();
+  if (blocks_.size() > 1)
+    stream << ", num-blocks=" << blocks_.size();
+  PrintQuantizedStats(stream, "linear-params", blocks_);
+  if (bias_params_.Dim() != 0)
+    PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void QuantizedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  KALDI_ERR << "QuantizedAffineComponent is made from a trained component "
+            << "by QuantizeNnet() (e.g. nnet3-am-copy --quantize), it cannot "
+            << "be initialized from a config.";
+}
+
+void* QuantizedAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  // if bias_params_.Dim() == 0 we set the flag kPropagateAdds, so 'out' will
+  // have been zeroed.
+  if (bias_params_.Dim() != 0)
+    out->CopyRowsFromVec(bias_params_);
+  if (blocks_.size() == 1) {
+    blocks_[0].AddMatMatTrans(in, out);
+    return NULL;
+  }
+  int32 num_rows_in_block = blocks_[0].NumRows(),
+      num_cols_in_block = blocks_[0].NumCols();
+  for (size_t b = 0; b < blocks_.size(); b++) {
+    CuSubMatrix<BaseFloat> out_block(out->ColRange(b * num_rows_in_block,
+                                                   num_rows_in_block));
+    blocks_[b].AddMatMatTrans(in.ColRange(b * num_cols_in_block,
+                                          num_cols_in_block), &out_block);
+  }
+  return NULL;
+}
+
+void QuantizedAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  KALDI_ERR << "QuantizedAffineComponent is for inference only, it cannot "
+            << "be backpropagated through (" << debug_info << ")";
+}
+
+Component* QuantizedAffineComponent::Copy() const {
+  QuantizedAffineComponent *ans = new QuantizedAffineComponent();
+  ans->blocks_ = blocks_;  // the quantized weights are shared.
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void QuantizedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedAffineComponent>");
+  WriteToken(os, binary, "<NumBlocks>");
+  WriteBasicType(os, binary, static_cast<int32>(blocks_.size()));
+  WriteToken(os, binary, "<LinearParams>");
+  for (size_t b = 0; b < blocks_.size(); b++)
+    blocks_[b].Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedAffineComponent>");
+}
+
+void QuantizedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedAffineComponent>",
+                       "<NumBlocks>");
+  int32 num_blocks;
+  ReadBasicType(is, binary, &num_blocks);
+  KALDI_ASSERT(num_blocks > 0);
+  ExpectToken(is, binary, "<LinearParams>");
+  blocks_.resize(num_blocks);
+  for (int32 b = 0; b < num_blocks; b++) {
+    blocks_[b].Read(is, binary);
+    KALDI_ASSERT(blocks_[b].NumRows() == blocks_[0].NumRows() &&
+                 blocks_[b].NumCols() == blocks_[0].NumCols());
+  }
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  KALDI_ASSERT(bias_params_.Dim() == 0 || bias_params_.Dim() == OutputDim());
+  ExpectToken(is, binary, "</QuantizedAffineComponent>");
+}
+
+
+QuantizedTdnnComponent::QuantizedTdnnComponent(const TdnnComponent &tdnn,
+                                               QuantizationMethod method):
+    TdnnComponent(tdnn) {
+  int32 input_dim = tdnn.InputDim();
+  for (size_t i = 0; i < time_offsets_.size(); i++)
+    offset_params_.push_back(QuantizedParams(
+        linear_params_.ColRange(i * input_dim, input_dim), method));
+  // the float parameters are not needed any more.
+  linear_params_.Resize(0, 0);
+  orthonormal_constraint_ = 0.0;
+}
+
+std::string QuantizedTdnnComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info();
+  stream << ", time-offsets=";
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    if (i != 0) stream << ',';
+    stream << time_offsets_[i];
+  }
+  PrintQuantizedStats(stream, "linear-params", offset_params_);
+  if (bias_params_.Dim() != 0)
+    PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void QuantizedTdnnComponent::InitFromConfig(ConfigLine *cfl) {
+  KALDI_ERR << "QuantizedTdnnComponent is made from a trained component "
+            << "by QuantizeNnet() (e.g. nnet3-am-copy --quantize), it cannot "
+            << "be initialized from a config.";
+}
+
+void* QuantizedTdnnComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes_in,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  // as TdnnComponent::Propagate().
+  const PrecomputedIndexes *indexes =
+      dynamic_cast<const PrecomputedIndexes*>(indexes_in);
+  KALDI_ASSERT(indexes != NULL &&
+               indexes->row_offsets.size() == time_offsets_.size());
+  if (bias_params_.Dim() != 0)
+    out->CopyRowsFromVec(bias_params_);
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    CuSubMatrix<BaseFloat> in_part = GetInputPart(in, out->NumRows(),
+                                                  indexes->row_stride,
+                                                  indexes->row_offsets[i]);
+    offset_params_[i].AddMatMatTrans(in_part, out);
+  }
+  return NULL;
+}
+
+void QuantizedTdnnComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  KALDI_ERR << "QuantizedTdnnComponent is for inference only, it cannot "
+            << "be backpropagated through (" << debug_info << ")";
+}
+
+void QuantizedTdnnComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedTdnnComponent>");
+  WriteToken(os, binary, "<TimeOffsets>");
+  WriteIntegerVector(os, binary, time_offsets_);
+  WriteToken(os, binary, "<LinearParams>");
+  for (size_t i = 0; i < offset_params_.size(); i++)
+    offset_params_[i].Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedTdnnComponent>");
+}
+
+void QuantizedTdnnComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedTdnnComponent>",
+                       "<TimeOffsets>");
+  ReadIntegerVector(is, binary, &time_offsets_);
+  KALDI_ASSERT(!time_offsets_.empty());
+  ExpectToken(is, binary, "<LinearParams>");
+  offset_params_.resize(time_offsets_.size());
+  for (size_t i = 0; i < offset_params_.size(); i++) {
+    offset_params_[i].Read(is, binary);
+    KALDI_ASSERT(offset_params_[i].NumRows() == offset_params_[0].NumRows() &&
+                 offset_params_[i].NumCols() == offset_params_[0].NumCols());
+  }
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  KALDI_ASSERT(bias_params_.Dim() == 0 || bias_params_.Dim() == OutputDim());
+  ExpectToken(is, binary, "</QuantizedTdnnComponent>");
+}
+
+
+int32 QuantizeNnet(QuantizationMethod method, Nnet *nnet) {
+  int32 num_quantized = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    const Component *component = nnet->GetComponent(c);
+    Component *quantized = NULL;
+    if (QuantizedAffineComponent::CanQuantize(*component)) {
+      quantized = new QuantizedAffineComponent(*component, method);
+    } else if (component->Type() == "TdnnComponent") {
+      quantized = new QuantizedTdnnComponent(
+          dynamic_cast<const TdnnComponent&>(*component), method);
+    } else {
+      continue;
+    }
+    nnet->SetComponent(c, quantized);  // takes ownership.
+    num_quantized++;
+  }
+  return num_quantized;
+}
+
+
+} // namespace nnet3
+} // namespace kaldi
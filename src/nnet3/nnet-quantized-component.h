@@ -0,0 +1,199 @@
+// nnet3/nnet-quantized-component.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET3_NNET_QUANTIZED_COMPONENT_H_
+#define KALDI_NNET3_NNET_QUANTIZED_COMPONENT_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nnet3/nnet-common.h"
+#include "nnet3/nnet-component-itf.h"
+#include "nnet3/nnet-convolutional-component.h"
+#include "nnet3/nnet-nnet.h"
+#include "matrix/quantized-matrix.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-quantized-component.h
+///
+/// This file contains components whose weights are held in int8, with a scale
+/// per output channel (row of the weights), or in fp16, for inference only.
+/// They are made from trained components by QuantizeNnet() (e.g.
+/// nnet3-am-copy --quantize=int8), and cannot be initialized from a config
+/// or trained.
+
+
+/**
+   QuantizedParams is a weight matrix held as a QuantizedMatrix, which is
+   never changed once made and so is shared by the copies of a component (and
+   so the copies of an Nnet).  On the CPU it is multiplied by without being
+   expanded (QuantizedMatrix::AddMatMatTrans() expands a block of rows at a
+   time, in the cache); on a GPU it is expanded once, the first time it is
+   used.
+*/
+class QuantizedParams {
+ public:
+  QuantizedParams() { }
+  QuantizedParams(const CuMatrixBase<BaseFloat> &params,
+                  QuantizationMethod method);
+
+  /// out += in * params^T, as out->AddMatMat(1.0, in, kNoTrans, params,
+  /// kTrans, 1.0).
+  void AddMatMatTrans(const CuMatrixBase<BaseFloat> &in,
+                      CuMatrixBase<BaseFloat> *out) const;
+
+  int32 NumRows() const { return shared_ ? shared_->quantized.NumRows() : 0; }
+  int32 NumCols() const { return shared_ ? shared_->quantized.NumCols() : 0; }
+  QuantizationMethod Method() const { return shared_->quantized.Method(); }
+  size_t SizeInBytes() const {
+    return shared_ ? shared_->quantized.SizeInBytes() : 0;
+  }
+
+  void Read(std::istream &is, bool binary);
+  void Write(std::ostream &os, bool binary) const;
+
+ private:
+  struct Shared {
+    QuantizedMatrix quantized;
+    std::once_flag expand_once;
+    // the expanded weights, only on a GPU.
+    CuMatrix<BaseFloat> expanded;
+  };
+  std::shared_ptr<Shared> shared_;
+};
+
+
+/**
+   QuantizedAffineComponent is the quantized form of AffineComponent,
+   NaturalGradientAffineComponent, FixedAffineComponent, of LinearComponent
+   (which has no bias) and of BlockAffineComponent, whose blocks are each
+   quantized on their own.  It is a simple component, like them.
+*/
+class QuantizedAffineComponent: public Component {
+ public:
+  QuantizedAffineComponent() { }
+  /// 'component' must be one that CanQuantize() accepts.
+  QuantizedAffineComponent(const Component &component,
+                           QuantizationMethod method);
+
+  /// True if 'component' is of one of the types above.
+  static bool CanQuantize(const Component &component);
+
+  virtual int32 InputDim() const {
+    return blocks_.size() * (blocks_.empty() ? 0 : blocks_[0].NumCols());
+  }
+  virtual int32 OutputDim() const {
+    return blocks_.size() * (blocks_.empty() ? 0 : blocks_[0].NumRows());
+  }
+
+  virtual std::string Info() const;
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "QuantizedAffineComponent"; }
+  virtual int32 Properties() const {
+    return kSimpleComponent|(bias_params_.Dim() == 0 ? kPropagateAdds : 0);
+  }
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+  virtual Component* Copy() const;
+
+ private:
+  // One per block (just one unless made from a BlockAffineComponent), each of
+  // dimension OutputDim() / num-blocks by InputDim() / num-blocks.
+  std::vector<QuantizedParams> blocks_;
+  // Empty if made from a LinearComponent.
+  CuVector<BaseFloat> bias_params_;
+};
+
+
+/**
+   QuantizedTdnnComponent is the quantized form of TdnnComponent.  The weights
+   for each time offset are quantized on their own.  It inherits the handling
+   of the indexes from TdnnComponent, but it is not updatable.
+*/
+class QuantizedTdnnComponent: public TdnnComponent {
+ public:
+  QuantizedTdnnComponent() { }
+  QuantizedTdnnComponent(const TdnnComponent &tdnn, QuantizationMethod method);
+
+  virtual int32 InputDim() const {
+    return offset_params_.empty() ? 0 : offset_params_[0].NumCols();
+  }
+  virtual int32 OutputDim() const {
+    return offset_params_.empty() ? 0 : offset_params_[0].NumRows();
+  }
+
+  virtual std::string Info() const;
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual std::string Type() const { return "QuantizedTdnnComponent"; }
+  virtual int32 Properties() const {
+    return kReordersIndexes|(bias_params_.Dim() == 0 ? kPropagateAdds : 0);
+  }
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+  virtual Component* Copy() const {
+    return new QuantizedTdnnComponent(*this);
+  }
+
+ private:
+  // One per time offset, each of dimension OutputDim() by InputDim().
+  std::vector<QuantizedParams> offset_params_;
+};
+
+
+/// Replaces each component of 'nnet' that QuantizedAffineComponent or
+/// QuantizedTdnnComponent can be made from by its quantized form, and returns
+/// how many were replaced.  This is for inference, so call it after
+/// CollapseModel(), which does not know about the quantized components.
+int32 QuantizeNnet(QuantizationMethod method, Nnet *nnet);
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+
+#endif
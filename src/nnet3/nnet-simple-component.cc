@@ -144,51 +144,41 @@ void* DropoutComponent::Propagate(const ComponentPrecomputedIndexes *indexes,
   BaseFloat dropout = dropout_proportion_;
   KALDI_ASSERT(dropout >= 0.0 && dropout <= 1.0);
   if (test_mode_) {
-    out->CopyFromMat(in);
+    if (out->Data() != in.Data())
+      out->CopyFromMat(in);
     out->Scale(1.0 - dropout);
     return NULL;
   }
-  if (!dropout_per_frame_) {
-    // This const_cast is only safe assuming you don't attempt
-    // to use multi-threaded code with the GPU.
-    const_cast<CuRand<BaseFloat>&>(random_generator_).RandUniform(out);
-
-    out->Add(-dropout);  // now, a proportion "dropout" will be <0.0
-    // apply the function (x>0?1:0).  Now, a proportion
-    // "dropout" will be zero and (1 - dropout) will be 1.0.
-    out->ApplyHeaviside();
-
-    out->MulElements(in);
-  } else {
-    // randomize the dropout matrix by row,
-    // i.e. [[1,1,1,1],[0,0,0,0],[0,0,0,0],[1,1,1,1],[0,0,0,0]]
-    CuMatrix<BaseFloat> tmp(1, out->NumRows(), kUndefined);
-    // This const_cast is only safe assuming you don't attempt
-    // to use multi-threaded code with the GPU.
-    const_cast<CuRand<BaseFloat>&>(random_generator_).RandUniform(&tmp);
-    tmp.Add(-dropout);
-    tmp.ApplyHeaviside();
-    out->CopyColsFromVec(tmp.Row(0));
-    out->MulElements(in);
-  }
-  return NULL;
+  // If dropout_per_frame_, whole rows are dropped,
+  // i.e. [[1,1,1,1],[0,0,0,0],[0,0,0,0],[1,1,1,1],[0,0,0,0]]
+  uint64 *seed = new uint64((static_cast<uint64>(Rand()) << 32) ^
+                            static_cast<uint64>(Rand()));
+  cu::PhiloxDropout(in, dropout, BaseFloat(1.0), *seed, dropout_per_frame_,
+                    out);
+  return seed;
 }
 
 
 void DropoutComponent::Backprop(const std::string &debug_info,
                                 const ComponentPrecomputedIndexes *indexes,
-                                const CuMatrixBase<BaseFloat> &in_value,
-                                const CuMatrixBase<BaseFloat> &out_value,
+                                const CuMatrixBase<BaseFloat> &, // in_value
+                                const CuMatrixBase<BaseFloat> &, // out_value
                                 const CuMatrixBase<BaseFloat> &out_deriv,
                                 void *memo,
                                 Component *to_update,
                                 CuMatrixBase<BaseFloat> *in_deriv) const {
-  KALDI_ASSERT(in_value.NumRows() == out_value.NumRows() &&
-               in_value.NumCols() == out_value.NumCols());
-
-  KALDI_ASSERT(in_value.NumRows() == out_deriv.NumRows() &&
-               in_value.NumCols() == out_deriv.NumCols());
-  in_deriv->SetMatMatDivMat(out_deriv, out_value, in_value);
+  KALDI_ASSERT(in_deriv != NULL && SameDim(*in_deriv, out_deriv));
+  if (memo == NULL) {
+    // test mode.
+    if (in_deriv->Data() != out_deriv.Data())
+      in_deriv->CopyFromMat(out_deriv);
+    in_deriv->Scale(1.0 - dropout_proportion_);
+    return;
+  }
+  // the same seed gives the same mask as in the Propagate().
+  cu::PhiloxDropout(out_deriv, dropout_proportion_, BaseFloat(1.0),
+                    *static_cast<uint64*>(memo), dropout_per_frame_,
+                    in_deriv);
 }
 
 
@@ -1736,30 +1726,17 @@ void* BlockAffineComponent::Propagate(const ComponentPrecomputedIndexes *indexes
   // of a block.
   int32 num_rows_in_block = linear_params_.NumRows() / num_blocks_;
   int32 num_cols_in_block = linear_params_.NumCols();
-  std::vector<CuSubMatrix<BaseFloat> *> in_batch, out_batch,
-    linear_params_batch;
-  for(int block_counter = 0; block_counter < num_blocks_; block_counter++) {
-    CuSubMatrix<BaseFloat> *in_block =
-      new CuSubMatrix<BaseFloat>(in.ColRange(block_counter * num_cols_in_block,
-                                   num_cols_in_block));
-    in_batch.push_back(in_block);
-
-    CuSubMatrix<BaseFloat> *out_block =
-      new CuSubMatrix<BaseFloat>(out->ColRange(block_counter * num_rows_in_block,
-                                    num_rows_in_block));
-    out_batch.push_back(out_block);
-
-    CuSubMatrix<BaseFloat> *linear_params_block =
-      new CuSubMatrix<BaseFloat>(linear_params_.RowRange(block_counter * num_rows_in_block,
-                                              num_rows_in_block));
-    linear_params_batch.push_back(linear_params_block);
-  }
-  AddMatMatBatched<BaseFloat>(1.0, out_batch, in_batch, kNoTrans,
-                              linear_params_batch, kTrans, 1.0);
-
-  DeletePointers(&in_batch);
-  DeletePointers(&out_batch);
-  DeletePointers(&linear_params_batch);
+  // The blocks are equally spaced, so one strided-batched multiplication
+  // does them all: block b of "out" gets block b of "in" times the
+  // transpose of block b of the parameters.
+  CuSubMatrix<BaseFloat> in_block(in.ColRange(0, num_cols_in_block)),
+      out_block(out->ColRange(0, num_rows_in_block)),
+      linear_params_block(linear_params_.RowRange(0, num_rows_in_block));
+  AddMatMatStridedBatched<BaseFloat>(
+      1.0, &out_block, num_rows_in_block,
+      in_block, num_cols_in_block, kNoTrans,
+      linear_params_block, num_rows_in_block * linear_params_.Stride(), kTrans,
+      1.0, num_blocks_);
   return NULL;
 }
 
@@ -1781,65 +1758,30 @@ void BlockAffineComponent::Backprop(const std::string &debug_info,
   // If we wanted to add with coefficient 0.0 we'd need to zero the
   // in_deriv, in case of infinities.
   if (in_deriv) {
-    std::vector<CuSubMatrix<BaseFloat> *> in_deriv_batch, out_deriv_batch, linear_params_batch;
-
-    for(int block_counter = 0; block_counter < num_blocks_; block_counter++) {
-      CuSubMatrix<BaseFloat> *in_deriv_block =
-        new CuSubMatrix<BaseFloat>(in_deriv->ColRange(block_counter * num_cols_in_block,
-                                                      num_cols_in_block));
-      in_deriv_batch.push_back(in_deriv_block);
-
-      CuSubMatrix<BaseFloat> *out_deriv_block =
-        new CuSubMatrix<BaseFloat>(out_deriv.ColRange(block_counter * num_rows_in_block,
-                                                       num_rows_in_block));
-      out_deriv_batch.push_back(out_deriv_block);
-
-      CuSubMatrix<BaseFloat> *linear_params_block =
-        new CuSubMatrix<BaseFloat>(linear_params_.RowRange(block_counter * num_rows_in_block,
-                                                          num_rows_in_block));
-      linear_params_batch.push_back(linear_params_block);
-    }
-
-    AddMatMatBatched<BaseFloat>(1.0, in_deriv_batch, out_deriv_batch, kNoTrans,
-                                linear_params_batch, kNoTrans, 1.0);
-
-    DeletePointers(&in_deriv_batch);
-    DeletePointers(&out_deriv_batch);
-    DeletePointers(&linear_params_batch);
+    CuSubMatrix<BaseFloat> in_deriv_block(in_deriv->ColRange(
+        0, num_cols_in_block)),
+        out_deriv_block(out_deriv.ColRange(0, num_rows_in_block)),
+        linear_params_block(linear_params_.RowRange(0, num_rows_in_block));
+    AddMatMatStridedBatched<BaseFloat>(
+        1.0, &in_deriv_block, num_cols_in_block,
+        out_deriv_block, num_rows_in_block, kNoTrans,
+        linear_params_block, num_rows_in_block * linear_params_.Stride(),
+        kNoTrans, 1.0, num_blocks_);
   }
 
   if (to_update != NULL) {
 
     { // linear params update
-
-      std::vector<CuSubMatrix<BaseFloat> *> in_value_batch,
-        out_deriv_batch, linear_params_batch;
-
-      for (int block_counter = 0; block_counter < num_blocks_; block_counter++) {
-        CuSubMatrix<BaseFloat> *in_value_block =
-          new CuSubMatrix<BaseFloat>(in_value.ColRange(block_counter * num_cols_in_block,
-                                                       num_cols_in_block));
-        in_value_batch.push_back(in_value_block);
-
-        CuSubMatrix<BaseFloat> *out_deriv_block =
-          new CuSubMatrix<BaseFloat>(out_deriv.ColRange(block_counter * num_rows_in_block,
-                                                        num_rows_in_block));
-        out_deriv_batch.push_back(out_deriv_block);
-
-        CuSubMatrix<BaseFloat> *linear_params_block =
-          new CuSubMatrix<BaseFloat>(to_update->linear_params_.RowRange(block_counter * num_rows_in_block,
-                                                                        num_rows_in_block));
-        linear_params_batch.push_back(linear_params_block);
-      }
-
-      AddMatMatBatched<BaseFloat>(to_update->learning_rate_,
-                                  linear_params_batch,
-                                  out_deriv_batch, kTrans,
-                                  in_value_batch, kNoTrans, 1.0);
-
-      DeletePointers(&in_value_batch);
-      DeletePointers(&out_deriv_batch);
-      DeletePointers(&linear_params_batch);
+      CuSubMatrix<BaseFloat> in_value_block(in_value.ColRange(
+          0, num_cols_in_block)),
+          out_deriv_block(out_deriv.ColRange(0, num_rows_in_block)),
+          linear_params_block(to_update->linear_params_.RowRange(
+              0, num_rows_in_block));
+      AddMatMatStridedBatched<BaseFloat>(
+          to_update->learning_rate_, &linear_params_block,
+          num_rows_in_block * to_update->linear_params_.Stride(),
+          out_deriv_block, num_rows_in_block, kTrans,
+          in_value_block, num_cols_in_block, kNoTrans, 1.0, num_blocks_);
     } // end linear params update
 
     { // bias update
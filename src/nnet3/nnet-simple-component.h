@@ -89,6 +89,9 @@ class PnormComponent: public Component {
 // Typically this component used during training but not in test time.
 // The idea is described under the name Dropout, in the paper
 // "Dropout: A Simple Way to Prevent Neural Networks from Overfitting".
+// The dropout mask is not stored: the memo is just the seed from which
+// cu::PhiloxDropout() computes it, in the forward and again in the backward
+// pass, so the backprop needs neither the input nor the output.
 class DropoutComponent : public RandomComponent {
  public:
   void Init(int32 dim, BaseFloat dropout_proportion = 0.0,
@@ -105,8 +108,8 @@ class DropoutComponent : public RandomComponent {
   DropoutComponent(const DropoutComponent &other);
 
   virtual int32 Properties() const {
-    return kBackpropInPlace|kSimpleComponent|kBackpropNeedsInput|
-        kBackpropNeedsOutput|kRandomComponent;
+    return kPropagateInPlace|kBackpropInPlace|kSimpleComponent|
+        kRandomComponent|kUsesMemo;
   }
   virtual std::string Type() const { return "DropoutComponent"; }
 
@@ -133,6 +136,11 @@ class DropoutComponent : public RandomComponent {
                         Component *to_update,
                         CuMatrixBase<BaseFloat> *in_deriv) const;
 
+  // the memo is the seed of the mask, or NULL in test mode.
+  virtual void DeleteMemo(void *memo) const {
+    delete static_cast<uint64*>(memo);
+  }
+
   virtual Component* Copy() const;
 
   virtual std::string Info() const;
@@ -546,6 +554,10 @@ class BlockAffineComponent : public UpdatableComponent {
 
   explicit BlockAffineComponent(const BlockAffineComponent &other);
   explicit BlockAffineComponent(const RepeatedAffineComponent &rac);
+
+  const CuMatrix<BaseFloat> &LinearParams() const { return linear_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+  int32 NumBlocks() const { return num_blocks_; }
  protected:
   // The matrix linear_params_ has a block structure, with num_blocks_ blocks of
   // equal size.  The blocks are stored in linear_params_ as
@@ -30,12 +30,15 @@ NnetTrainer::NnetTrainer(const NnetTrainerOptions &config,
     nnet_(nnet),
     compiler_(*nnet, config_.optimize_config, config_.compiler_config),
     num_minibatches_processed_(0),
-    srand_seed_(RandInt(0, 100000)) {
+    srand_seed_(RandInt(0, 100000)),
+    loss_scale_(config.loss_scale),
+    num_good_updates_(0) {
   if (config.zero_component_stats)
     ZeroComponentStats(nnet);
   KALDI_ASSERT(config.momentum >= 0.0 &&
                config.max_param_change >= 0.0 &&
-               config.backstitch_training_interval > 0);
+               config.backstitch_training_interval > 0 &&
+               config.loss_scale > 0.0);
   delta_nnet_ = nnet_->Copy();
   ScaleNnet(0.0, delta_nnet_);
   const int32 num_updatable = NumUpdatableComponents(*delta_nnet_);
@@ -71,12 +74,12 @@ void NnetTrainer::Train(const NnetExample &eg) {
     KALDI_ASSERT(config_.momentum == 0.0);
     FreezeNaturalGradient(true, delta_nnet_);
     bool is_backstitch_step1 = true;
-    srand(srand_seed_ + num_minibatches_processed_);
+    RandSeed(srand_seed_ + num_minibatches_processed_);
     ResetGenerators(nnet_);
     TrainInternalBackstitch(eg, *computation, is_backstitch_step1);
     FreezeNaturalGradient(false, delta_nnet_); // un-freeze natural gradient
     is_backstitch_step1 = false;
-    srand(srand_seed_ + num_minibatches_processed_);
+    RandSeed(srand_seed_ + num_minibatches_processed_);
     ResetGenerators(nnet_);
     TrainInternalBackstitch(eg, *computation, is_backstitch_step1);
   } else { // conventional training
@@ -102,7 +105,7 @@ void NnetTrainer::TrainInternal(const NnetExample &eg,
   computer.Run();
 
   this->ProcessOutputs(false, eg, &computer);
-  computer.Run();
+  Backward(&computer);
 
   // If relevant, add in the part of the gradient that comes from L2
   // regularization.
@@ -123,6 +126,8 @@ void NnetTrainer::TrainInternal(const NnetExample &eg,
   // or AffineComponent with orthonormal-constraint set to a nonzero value.
   ConstrainOrthonormal(nnet_);
 
+  UpdateLossScale(success);
+
   // Scale deta_nnet
   if (success)
     ScaleNnet(config_.momentum, delta_nnet_);
@@ -144,7 +149,7 @@ void NnetTrainer::TrainInternalBackstitch(const NnetExample &eg,
 
   bool is_backstitch_step2 = !is_backstitch_step1;
   this->ProcessOutputs(is_backstitch_step2, eg, &computer);
-  computer.Run();
+  Backward(&computer);
 
   BaseFloat max_change_scale, scale_adding;
   if (is_backstitch_step1) {
@@ -167,9 +172,10 @@ void NnetTrainer::TrainInternalBackstitch(const NnetExample &eg,
   }
 
   // Updates the parameters of nnet
-  UpdateNnetWithMaxChange(*delta_nnet_, config_.max_param_change,
-      max_change_scale, scale_adding, nnet_,
+  bool success = UpdateNnetWithMaxChange(*delta_nnet_,
+      config_.max_param_change, max_change_scale, scale_adding, nnet_,
       &num_max_change_per_component_applied_, &num_max_change_global_applied_);
+  UpdateLossScale(success);
 
   if (is_backstitch_step1) {
     // The following will only do something if we have a LinearComponent or
@@ -209,7 +215,7 @@ void NnetTrainer::ProcessOutputs(bool is_backstitch_step2,
       bool supply_deriv = true;
       ComputeObjectiveFunction(io.features, obj_type, io.name,
                                supply_deriv, computer,
-                               &tot_weight, &tot_objf);
+                               &tot_weight, &tot_objf, loss_scale_);
       objf_info_[io.name + suffix].UpdateStats(io.name + suffix,
                                       config_.print_interval,
                                       num_minibatches_processed_,
@@ -218,6 +224,38 @@ void NnetTrainer::ProcessOutputs(bool is_backstitch_step2,
   }
 }
 
+void NnetTrainer::Backward(NnetComputer *computer) {
+  if (loss_scale_ == 1.0) {
+    computer->Run();
+    return;
+  }
+  // The parameter change is accumulated onto delta_nnet_, which (with
+  // momentum) is not zero, so we scale it up first, so that scaling it back
+  // afterwards leaves it as it would have been without the loss scale.
+  if (config_.momentum != 0.0)
+    ScaleNnet(loss_scale_, delta_nnet_);
+  computer->Run();
+  ScaleNnet(1.0 / loss_scale_, delta_nnet_);
+}
+
+void NnetTrainer::UpdateLossScale(bool success) {
+  if (config_.loss_scale <= 1.0)
+    return;
+  if (!success) {
+    if (loss_scale_ > 1.0) {
+      loss_scale_ = std::max<BaseFloat>(1.0, 0.5 * loss_scale_);
+      KALDI_LOG << "Parameter change was not finite; reducing the loss scale "
+                << "to " << loss_scale_;
+    }
+    num_good_updates_ = 0;
+  } else if (config_.loss_scale_growth_interval > 0 &&
+             ++num_good_updates_ >= config_.loss_scale_growth_interval) {
+    loss_scale_ *= 2.0;
+    num_good_updates_ = 0;
+    KALDI_VLOG(1) << "Increasing the loss scale to " << loss_scale_;
+  }
+}
+
 bool NnetTrainer::PrintTotalStats() const {
   unordered_map<std::string, ObjectiveFunctionInfo, StringHasher>::const_iterator
       iter = objf_info_.begin(),
@@ -373,7 +411,8 @@ void ComputeObjectiveFunction(const GeneralMatrix &supervision,
                               bool supply_deriv,
                               NnetComputer *computer,
                               BaseFloat *tot_weight,
-                              BaseFloat *tot_objf) {
+                              BaseFloat *tot_objf,
+                              BaseFloat deriv_scale) {
   const CuMatrixBase<BaseFloat> &output = computer->GetOutput(output_name);
 
   if (output.NumCols() != supervision.NumCols())
@@ -397,6 +436,8 @@ void ComputeObjectiveFunction(const GeneralMatrix &supervision,
             CuMatrix<BaseFloat> output_deriv(output.NumRows(), output.NumCols(),
                                              kUndefined);
             cu_post.CopyToMat(&output_deriv);
+            if (deriv_scale != 1.0)
+              output_deriv.Scale(deriv_scale);
             computer->AcceptInput(output_name, &output_deriv);
           }
           break;
@@ -407,8 +448,11 @@ void ComputeObjectiveFunction(const GeneralMatrix &supervision,
           CuMatrix<BaseFloat> cu_post(supervision.GetFullMatrix());
           *tot_weight = cu_post.Sum();
           *tot_objf = TraceMatMat(output, cu_post, kTrans);
-          if (supply_deriv)
+          if (supply_deriv) {
+            if (deriv_scale != 1.0)
+              cu_post.Scale(deriv_scale);
             computer->AcceptInput(output_name, &cu_post);
+          }
           break;
         }
         case kCompressedMatrix: {
@@ -418,8 +462,11 @@ void ComputeObjectiveFunction(const GeneralMatrix &supervision,
           cu_post.Swap(&post);
           *tot_weight = cu_post.Sum();
           *tot_objf = TraceMatMat(output, cu_post, kTrans);
-          if (supply_deriv)
+          if (supply_deriv) {
+            if (deriv_scale != 1.0)
+              cu_post.Scale(deriv_scale);
             computer->AcceptInput(output_name, &cu_post);
+          }
           break;
         }
       }
@@ -434,8 +481,11 @@ void ComputeObjectiveFunction(const GeneralMatrix &supervision,
       diff.AddMat(-1.0, output);
       *tot_weight = diff.NumRows();
       *tot_objf = -0.5 * TraceMatMat(diff, diff, kTrans);
-      if (supply_deriv)
+      if (supply_deriv) {
+        if (deriv_scale != 1.0)
+          diff.Scale(deriv_scale);
         computer->AcceptInput(output_name, &diff);
+      }
       break;
     }
     default:
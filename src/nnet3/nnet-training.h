@@ -44,6 +44,8 @@ struct NnetTrainerOptions {
   std::string write_cache;
   bool binary_write_cache;
   BaseFloat max_param_change;
+  BaseFloat loss_scale;
+  int32 loss_scale_growth_interval;
   NnetOptimizeOptions optimize_config;
   NnetComputeOptions compute_config;
   CachingOptimizingCompilerOptions compiler_config;
@@ -58,7 +60,9 @@ struct NnetTrainerOptions {
       backstitch_training_interval(1),
       batchnorm_stats_scale(0.8),
       binary_write_cache(true),
-      max_param_change(2.0) { }
+      max_param_change(2.0),
+      loss_scale(1.0),
+      loss_scale_growth_interval(2000) { }
   void Register(OptionsItf *opts) {
     opts->Register("store-component-stats", &store_component_stats,
                    "If true, store activations and derivatives for nonlinear "
@@ -104,6 +108,16 @@ struct NnetTrainerOptions {
                    "the cached computation.");
     opts->Register("binary-write-cache", &binary_write_cache, "Write "
                    "computation cache in binary mode");
+    opts->Register("loss-scale", &loss_scale, "Initial scale of the "
+                   "derivatives backpropagated (the parameter change is scaled "
+                   "back), which keeps small derivatives from underflowing "
+                   "with --cuda-gemm-precision=half.  If >1, it is halved "
+                   "whenever the parameter change is not finite (and that "
+                   "minibatch is skipped).");
+    opts->Register("loss-scale-growth-interval", &loss_scale_growth_interval,
+                   "If >0 and --loss-scale > 1, the loss scale is doubled "
+                   "after this many minibatches in a row with a finite "
+                   "parameter change.");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -207,6 +221,15 @@ class NnetTrainer {
   void ProcessOutputs(bool is_backstitch_step2, const NnetExample &eg,
                       NnetComputer *computer);
 
+  // Runs the backward pass of "computer", whose output derivatives
+  // ProcessOutputs() has scaled by loss_scale_, then scales the
+  // parameter change back.
+  void Backward(NnetComputer *computer);
+
+  // Adjusts loss_scale_ after an update, which failed if "success" is false
+  // (i.e. the parameter change was not finite).
+  void UpdateLossScale(bool success);
+
   const NnetTrainerOptions config_;
   Nnet *nnet_;
   Nnet *delta_nnet_;  // nnet representing parameter-change for this minibatch
@@ -229,6 +252,11 @@ class NnetTrainer {
   // consistent dropout masks.  It's set to a value derived from rand()
   // when the class is initialized.
   int32 srand_seed_;
+
+  // The current loss scale (see NnetTrainerOptions::loss_scale), and the
+  // number of minibatches since it was last changed or the update failed.
+  BaseFloat loss_scale_;
+  int32 num_good_updates_;
 };
 
 /**
@@ -264,6 +292,9 @@ class NnetTrainer {
                              this is not supported.
   @param [out] tot_objf      The total objective function; divide this by the
                              tot_weight to get the normalized objective function.
+  @param [in] deriv_scale    The derivative supplied is multiplied by this
+                             (used for loss scaling; see
+                             NnetTrainerOptions::loss_scale).
 */
 void ComputeObjectiveFunction(const GeneralMatrix &supervision,
                               ObjectiveType objective_type,
@@ -271,7 +302,8 @@ void ComputeObjectiveFunction(const GeneralMatrix &supervision,
                               bool supply_deriv,
                               NnetComputer *computer,
                               BaseFloat *tot_weight,
-                              BaseFloat *tot_objf);
+                              BaseFloat *tot_objf,
+                              BaseFloat deriv_scale = 1.0);
 
 
 
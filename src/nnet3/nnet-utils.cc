@@ -1861,8 +1861,11 @@ class ModelCollapser {
         dynamic_cast<const AffineComponent*>(component);
     const LinearComponent *linear_component =
         dynamic_cast<const LinearComponent*>(component);
+    // (not QuantizedTdnnComponent, which is derived from TdnnComponent but
+    // has no float parameters.)
     const TdnnComponent *tdnn_component =
-        dynamic_cast<const TdnnComponent*>(component);
+        (component->Type() == "TdnnComponent" ?
+         dynamic_cast<const TdnnComponent*>(component) : NULL);
 
     Component *new_component = NULL;
     if (affine_component != NULL) {
@@ -24,6 +24,7 @@
 #include "hmm/transition-model.h"
 #include "nnet3/am-nnet-simple.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-quantized-component.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -51,6 +52,7 @@ int main(int argc, char *argv[]) {
     bool convert_repeated_to_block = false;
     BaseFloat scale = 1.0;
     bool prepare_for_test = false;
+    std::string quantize;
     std::string nnet_config, edits_config, edits_str;
 
     ParseOptions po(usage);
@@ -87,6 +89,11 @@ int main(int argc, char *argv[]) {
                 "slightly.  Involves setting test mode in dropout and batch-norm "
                 "components, and calling CollapseModel() which may remove some "
                 "components.");
+    po.Register("quantize", &quantize, "If set to int8 or fp16, replaces the "
+                "affine, linear, block-affine and TDNN components by quantized "
+                "forms for inference, with their weights in int8 (with a scale "
+                "per output dimension) or fp16.  Use it with "
+                "--prepare-for-test=true; the result cannot be trained.");
 
     po.Read(argc, argv);
 
@@ -146,6 +153,13 @@ int main(int argc, char *argv[]) {
       CollapseModel(CollapseModelConfig(), &am_nnet.GetNnet());
     }
 
+    if (!quantize.empty()) {
+      int32 num_quantized = QuantizeNnet(QuantizationMethodFromString(quantize),
+                                         &(am_nnet.GetNnet()));
+      KALDI_LOG << "Quantized " << num_quantized << " components to "
+                << quantize;
+    }
+
     if (raw) {
       WriteKaldiObject(am_nnet.GetNnet(), nnet_wxfilename, binary_write);
       KALDI_LOG << "Copied neural net from " << nnet_rxfilename
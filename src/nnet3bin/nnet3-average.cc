@@ -17,10 +17,12 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fstream>
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "hmm/transition-model.h"
 #include "nnet3/nnet-utils.h"
+#include "base/timer.h"
 
 
 namespace kaldi {
@@ -51,20 +53,44 @@ void GetWeights(const std::string &weights_str,
   }
 }
 
+// Reads a model; if wait_timeout > 0 and it cannot be read (it does not exist
+// yet or is still being written), retries every second until it can or
+// wait_timeout seconds have passed.
+void ReadModelWhenReady(const std::string &rxfilename,
+                        BaseFloat wait_timeout, nnet3::Nnet *nnet) {
+  Timer timer;
+  while (true) {
+    bool exists = (ClassifyRxfilename(rxfilename) != kFileInput ||
+                   std::ifstream(rxfilename.c_str()).is_open());
+    if (exists || timer.Elapsed() > wait_timeout) {
+      try {
+        ReadKaldiObject(rxfilename, nnet);
+        return;
+      } catch (...) {
+        if (timer.Elapsed() > wait_timeout)
+          throw;
+        KALDI_WARN << "Could not read " << rxfilename << ", retrying.";
+      }
+    }
+    Sleep(1.0);
+  }
+}
+
 // This job is run in a spawned thread; it reads a subset of models with
 // specified weights.  Sets *success to 1 for success and 0 for failure.  (We
 // don't use bool because of the weird implementation of std::vector<bool>).
 void ReadModels(std::vector<std::pair<std::string, BaseFloat> > models_and_weights,
+                BaseFloat wait_timeout,
                 nnet3::Nnet *output_nnet,
                 int32 *success) {
   using namespace nnet3;
   try {
     int32 n = models_and_weights.size();
-    ReadKaldiObject(models_and_weights[0].first, output_nnet);
+    ReadModelWhenReady(models_and_weights[0].first, wait_timeout, output_nnet);
     ScaleNnet(models_and_weights[0].second, output_nnet);
     for (int32 i = 1; i < n; i++) {
       Nnet nnet;
-      ReadKaldiObject(models_and_weights[i].first, &nnet);
+      ReadModelWhenReady(models_and_weights[i].first, wait_timeout, &nnet);
       AddNnet(nnet, models_and_weights[i].second, output_nnet);
     }
     *success = 1;
@@ -89,10 +115,13 @@ int main(int argc, char *argv[]) {
         "Usage:  nnet3-average [options] <model1> <model2> ... <modelN> <model-out>\n"
         "\n"
         "e.g.:\n"
-        " nnet3-average 1.1.nnet 1.2.nnet 1.3.nnet 2.nnet\n";
+        " nnet3-average 1.1.nnet 1.2.nnet 1.3.nnet 2.nnet\n"
+        "With --wait-timeout it can be started before the models have all been\n"
+        "written; each model is averaged in as soon as it can be read.\n";
 
     bool binary_write = true;
     int32 num_threads = -1;
+    BaseFloat wait_timeout = 0.0;
 
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -101,6 +130,10 @@ int main(int argc, char *argv[]) {
                 "for each input model.  These will be normalized to sum to one.");
     po.Register("num-threads", &num_threads, "Number of threads to read the "
                 "models (will be set automatically if not set.");
+    po.Register("wait-timeout", &wait_timeout, "If >0, an input model that "
+                "does not exist yet or cannot be read (e.g. because it is still "
+                "being written) is retried every second for up to this many "
+                "seconds.");
 
     po.Read(argc, argv);
 
@@ -141,6 +174,7 @@ int main(int argc, char *argv[]) {
             po.GetArg(j), model_weights[j - 1]));
       }
       threads[thread_id] = new std::thread(ReadModels, this_models_and_weights,
+                                           wait_timeout,
                                            &(nnets[thread_id]),
                                            &(return_statuses[thread_id]));
     }
@@ -18,6 +18,8 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <future>
+#include <memory>
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet3/nnet-utils.h"
@@ -29,36 +31,30 @@ namespace kaldi {
 namespace nnet3 {
 
 // Computes and returns the objective function for the examples in 'egs' given
-// the model in 'nnet'. If either of batchnorm/dropout test modes is true, we
-// make a copy of 'nnet', set test modes on that and evaluate its objective.
-// Note: the object that prob_computer->nnet_ refers to should be 'nnet'.
-double ComputeObjf(bool batchnorm_test_mode, bool dropout_test_mode,
-                   const std::vector<NnetExample> &egs, const Nnet &nnet,
+// the nnet that prob_computer->nnet_ refers to.
+double ComputeObjf(const std::vector<NnetExample> &egs,
                    NnetComputeProb *prob_computer) {
-  if (batchnorm_test_mode || dropout_test_mode) {
-    Nnet nnet_copy(nnet);
-    if (batchnorm_test_mode)
-      SetBatchnormTestMode(true, &nnet_copy);
-    if (dropout_test_mode)
-      SetDropoutTestMode(true, &nnet_copy);
-    NnetComputeProbOptions compute_prob_opts;
-    NnetComputeProb prob_computer_test(compute_prob_opts, nnet_copy);
-    return ComputeObjf(false, false, egs, nnet_copy, &prob_computer_test);
-  } else {
-    prob_computer->Reset();
-    std::vector<NnetExample>::const_iterator iter = egs.begin(),
-                                              end = egs.end();
-    for (; iter != end; ++iter)
-      prob_computer->Compute(*iter);
-    double tot_weights,
-        tot_objf = prob_computer->GetTotalObjective(&tot_weights);
-    KALDI_ASSERT(tot_weights > 0.0);
-    // inf/nan tot_objf->return -inf objective.
-    if (!(tot_objf == tot_objf && tot_objf - tot_objf == 0))
-      return -std::numeric_limits<double>::infinity();
-    // we prefer to deal with normalized objective functions.
-    return tot_objf / tot_weights;
-  }
+  prob_computer->Reset();
+  std::vector<NnetExample>::const_iterator iter = egs.begin(),
+                                            end = egs.end();
+  for (; iter != end; ++iter)
+    prob_computer->Compute(*iter);
+  double tot_weights,
+      tot_objf = prob_computer->GetTotalObjective(&tot_weights);
+  KALDI_ASSERT(tot_weights > 0.0);
+  // inf/nan tot_objf->return -inf objective.
+  if (!(tot_objf == tot_objf && tot_objf - tot_objf == 0))
+    return -std::numeric_limits<double>::infinity();
+  // we prefer to deal with normalized objective functions.
+  return tot_objf / tot_weights;
+}
+
+// Reads the nnet in 'rxfilename'; run via std::async so the next model is read
+// while the current average is being evaluated.
+Nnet *ReadNnet(const std::string &rxfilename) {
+  Nnet *nnet = new Nnet();
+  ReadKaldiObject(rxfilename, nnet);
+  return nnet;
 }
 
 // Updates moving average over num_models nnets, given the average over
@@ -123,6 +119,8 @@ int main(int argc, char *argv[]) {
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
+    // the models are read in a background thread.
+    CuDevice::Instantiate().AllowMultithreading();
 #endif
 
     std::string
@@ -130,9 +128,22 @@ int main(int argc, char *argv[]) {
         valid_examples_rspecifier = po.GetArg(po.NumArgs() - 1),
         nnet_wxfilename = po.GetArg(po.NumArgs());
 
+    int32 num_nnets = po.NumArgs() - 2;
+    std::future<Nnet*> next_nnet;
+    if (num_nnets > 1)
+      next_nnet = std::async(std::launch::async, ReadNnet, po.GetArg(2));
+
     Nnet nnet;
     ReadKaldiObject(nnet_rxfilename, &nnet);
-    Nnet moving_average_nnet(nnet), best_nnet(nnet);
+    // The test modes are set on the moving average itself (they do not
+    // affect the averaging), so that the same prob computer, and the
+    // computations it has compiled, are used for every evaluation.
+    Nnet moving_average_nnet(nnet);
+    if (batchnorm_test_mode)
+      SetBatchnormTestMode(true, &moving_average_nnet);
+    if (dropout_test_mode)
+      SetDropoutTestMode(true, &moving_average_nnet);
+    Nnet best_nnet(moving_average_nnet);
     NnetComputeProbOptions compute_prob_opts;
     NnetComputeProb prob_computer(compute_prob_opts, moving_average_nnet);
 
@@ -152,25 +163,25 @@ int main(int argc, char *argv[]) {
     // first evaluates the objective using the last model.
     int32 best_num_to_combine = 1;
     double
-        init_objf = ComputeObjf(batchnorm_test_mode, dropout_test_mode,
-            egs, moving_average_nnet, &prob_computer),
+        init_objf = ComputeObjf(egs, &prob_computer),
         best_objf = init_objf;
     KALDI_LOG << "objective function using the last model is " << init_objf;
 
-    int32 num_nnets = po.NumArgs() - 2;
     // then each time before we re-evaluate the objective function, we will add
     // num_to_add models to the moving average.
     int32 num_to_add = (num_nnets + max_objective_evaluations - 1) /
                        max_objective_evaluations;
     for (int32 n = 1; n < num_nnets; n++) {
-      ReadKaldiObject(po.GetArg(1 + n), &nnet);
+      std::unique_ptr<Nnet> this_nnet(next_nnet.get());
+      if (n + 1 < num_nnets)
+        next_nnet = std::async(std::launch::async, ReadNnet,
+                               po.GetArg(2 + n));
       // updates the moving average
-      UpdateNnetMovingAverage(n + 1, nnet, &moving_average_nnet);
+      UpdateNnetMovingAverage(n + 1, *this_nnet, &moving_average_nnet);
       // evaluates the objective everytime after adding num_to_add model or
       // all the models to the moving average.
       if ((n - 1) % num_to_add == num_to_add - 1 || n == num_nnets - 1) {
-        double objf = ComputeObjf(batchnorm_test_mode, dropout_test_mode,
-            egs, moving_average_nnet, &prob_computer);
+        double objf = ComputeObjf(egs, &prob_computer);
         KALDI_LOG << "Combining last " << n + 1
                   << " models, objective function is " << objf;
         if (objf > best_objf) {
@@ -184,6 +195,10 @@ int main(int argc, char *argv[]) {
               << " nnets, objective function changed from " << init_objf
               << " to " << best_objf;
 
+    if (batchnorm_test_mode)
+      SetBatchnormTestMode(false, &best_nnet);
+    if (dropout_test_mode)
+      SetDropoutTestMode(false, &best_nnet);
     if (HasBatchnorm(nnet))
       RecomputeStats(egs, &best_nnet);
 
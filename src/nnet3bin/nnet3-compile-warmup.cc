@@ -0,0 +1,185 @@
+// nnet3bin/nnet3-compile-warmup.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/nnet-batch-compute.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Zero input of 'num_frames' frames for 'nnet', with an iVector per utterance
+// or, if online_ivector_period > 0, online iVectors, if it has an ivector input.
+static void GetWarmupInput(const Nnet &nnet, int32 num_frames,
+                           int32 online_ivector_period,
+                           Matrix<BaseFloat> *features,
+                           Vector<BaseFloat> *ivector,
+                           Matrix<BaseFloat> *online_ivectors) {
+  KALDI_ASSERT(num_frames > 0);
+  features->Resize(num_frames, nnet.InputDim("input"));
+  int32 ivector_dim = nnet.InputDim("ivector");
+  if (ivector_dim <= 0)
+    return;
+  if (online_ivector_period > 0)
+    online_ivectors->Resize((num_frames + online_ivector_period - 1) /
+                            online_ivector_period, ivector_dim);
+  else
+    ivector->Resize(ivector_dim);
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Fill in the cache of compiled computations (--compile-cache-dir) for\n"
+        "a model ahead of time, so that the programs using it (nnet3-compute,\n"
+        "nnet3-latgen-faster and their -batch versions) do not have to compile\n"
+        "on startup.  The network is run on zero features of each of the\n"
+        "--utterance-lengths, with the same options as those programs; use\n"
+        "--batch=false for the programs that are not -batch.\n"
+        "\n"
+        "Usage: nnet3-compile-warmup [options] <nnet-in>\n"
+        " e.g.: nnet3-compile-warmup --compile-cache-dir=exp/compile_cache \\\n"
+        "   --frames-per-chunk=150 --utterance-lengths=100,500,2000 final.raw\n";
+
+    ParseOptions po(usage);
+
+    NnetBatchComputerOptions opts;
+    bool batch = true, use_priors = false;
+    std::string use_gpu = "yes", utterance_lengths_str = "100,300,1000,3000";
+    int32 online_ivector_period = 0;
+    opts.Register(&po);
+
+    po.Register("batch", &batch, "If true, compile the computations of the "
+                "-batch programs (nnet3-compute-batch, nnet3-latgen-faster-batch); "
+                "otherwise those of nnet3-compute and nnet3-latgen-faster.");
+    po.Register("utterance-lengths", &utterance_lengths_str, "Comma-separated "
+                "list of utterance lengths, in input frames, to compile the "
+                "computations for.");
+    po.Register("online-ivector-period", &online_ivector_period, "If the "
+                "network has an ivector input and the programs will be given "
+                "online iVectors, the --online-ivector-period they use; by "
+                "default a single iVector per utterance is assumed.");
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional|wait, only has effect if compiled with CUDA");
+    po.Register("use-priors", &use_priors, "If true, the model is a .mdl file "
+                "(with a transition model), rather than a raw network.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 1) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (opts.compiler_config.cache_dir.empty())
+      KALDI_ERR << "--compile-cache-dir must be set";
+    std::vector<int32> utterance_lengths;
+    if (!SplitStringToIntegers(utterance_lengths_str, ",", false,
+                               &utterance_lengths) ||
+        utterance_lengths.empty())
+      KALDI_ERR << "Invalid --utterance-lengths option: "
+                << utterance_lengths_str;
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().AllowMultithreading();
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
+    std::string nnet_rxfilename = po.GetArg(1);
+
+    // the same preparation of the network as in the programs we warm up for,
+    // since the compiled computations depend on it.
+    Nnet raw_nnet;
+    AmNnetSimple am_nnet;
+    if (use_priors) {
+      bool binary;
+      TransitionModel trans_model;
+      Input ki(nnet_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    } else {
+      ReadKaldiObject(nnet_rxfilename, &raw_nnet);
+    }
+    Nnet &nnet = (use_priors ? am_nnet.GetNnet() : raw_nnet);
+    SetBatchnormTestMode(true, &nnet);
+    SetDropoutTestMode(true, &nnet);
+    CollapseModel(CollapseModelConfig(), &nnet);
+
+    // priors don't affect the computations.
+    Vector<BaseFloat> priors;
+
+    if (batch) {
+      NnetBatchInference inference(opts, nnet, priors);
+      for (size_t i = 0; i < utterance_lengths.size(); i++) {
+        Matrix<BaseFloat> features, online_ivectors;
+        Vector<BaseFloat> ivector;
+        GetWarmupInput(nnet, utterance_lengths[i], online_ivector_period,
+                       &features, &ivector, &online_ivectors);
+        // enough copies of the utterance to fill whole minibatches of each
+        // kind of chunk.
+        for (int32 n = 0; n < opts.minibatch_size; n++) {
+          inference.AcceptInput("warmup", features,
+                                (ivector.Dim() != 0 ? &ivector : NULL),
+                                (online_ivectors.NumRows() != 0 ?
+                                 &online_ivectors : NULL),
+                                online_ivector_period);
+          std::string utt;
+          Matrix<BaseFloat> output;
+          while (inference.GetOutput(&utt, &output));
+        }
+      }
+      inference.Finished();
+      std::string utt;
+      Matrix<BaseFloat> output;
+      while (inference.GetOutput(&utt, &output));
+    } else {
+      CachingOptimizingCompiler compiler(nnet, opts.optimize_config,
+                                         opts.compiler_config);
+      for (size_t i = 0; i < utterance_lengths.size(); i++) {
+        Matrix<BaseFloat> features, online_ivectors;
+        Vector<BaseFloat> ivector;
+        GetWarmupInput(nnet, utterance_lengths[i], online_ivector_period,
+                       &features, &ivector, &online_ivectors);
+        DecodableNnetSimple nnet_computer(
+            opts, nnet, priors, features, &compiler,
+            (ivector.Dim() != 0 ? &ivector : NULL),
+            (online_ivectors.NumRows() != 0 ? &online_ivectors : NULL),
+            online_ivector_period);
+        Vector<BaseFloat> row(nnet_computer.OutputDim());
+        for (int32 t = 0; t < nnet_computer.NumFrames(); t++)
+          nnet_computer.GetOutputForFrame(t, &row);
+      }
+    }
+    KALDI_LOG << "Compiled computations for " << utterance_lengths.size()
+              << " utterance lengths into " << opts.compiler_config.cache_dir;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
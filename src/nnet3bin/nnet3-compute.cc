@@ -74,6 +74,7 @@ int main(int argc, char *argv[]) {
                 "output");
     po.Register("use-gpu", &use_gpu,
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
+    RegisterCuGemmOptions(&po);
     po.Register("use-priors", &use_priors, "If true, subtract the logs of the "
                 "priors stored with the model (in this case, "
                 "a .mdl file is expected as input).");
@@ -118,7 +119,8 @@ int main(int argc, char *argv[]) {
     RandomAccessBaseFloatVectorReaderMapped ivector_reader(
         ivector_rspecifier, utt2spk_rspecifier);
 
-    CachingOptimizingCompiler compiler(nnet, opts.optimize_config);
+    CachingOptimizingCompiler compiler(nnet, opts.optimize_config,
+                                       opts.compiler_config);
 
     BaseFloatMatrixWriter matrix_writer(matrix_wspecifier);
 
@@ -352,6 +352,7 @@ int main(int argc, char *argv[]) {
                 "output name, e.g. 'output-0'.  If provided, the NnetIo with "
                 "name 'output' will be renamed to the provided name. Used in "
                 "multilingual training.");
+    RegisterIoOptions(&po);
     po.Read(argc, argv);
 
     srand(srand_seed);
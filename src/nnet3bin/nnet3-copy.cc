@@ -24,6 +24,7 @@
 #include "hmm/transition-model.h"
 #include "nnet3/am-nnet-simple.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-quantized-component.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -45,6 +46,7 @@ int main(int argc, char *argv[]) {
     std::string nnet_config, edits_config, edits_str;
     BaseFloat scale = 1.0;
     bool prepare_for_test = false;
+    std::string quantize;
 
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -70,6 +72,11 @@ int main(int argc, char *argv[]) {
                 "slightly.  Involves setting test mode in dropout and batch-norm "
                 "components, and calling CollapseModel() which may remove some "
                 "components.");
+    po.Register("quantize", &quantize, "If set to int8 or fp16, replaces the "
+                "affine, linear, block-affine and TDNN components by quantized "
+                "forms for inference, with their weights in int8 (with a scale "
+                "per output dimension) or fp16.  Use it with "
+                "--prepare-for-test=true; the result cannot be trained.");
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -110,6 +117,13 @@ int main(int argc, char *argv[]) {
       SetDropoutTestMode(true, &nnet);
       CollapseModel(CollapseModelConfig(), &nnet);
     }
+
+    if (!quantize.empty()) {
+      int32 num_quantized = QuantizeNnet(QuantizationMethodFromString(quantize),
+                                         &nnet);
+      KALDI_LOG << "Quantized " << num_quantized << " components to "
+                << quantize;
+    }
     WriteKaldiObject(nnet, raw_nnet_wxfilename, binary_write);
     KALDI_LOG << "Copied raw neural net from " << raw_nnet_rxfilename
               << " to " << raw_nnet_wxfilename;
@@ -25,45 +25,122 @@
 #include "hmm/posterior.h"
 #include "nnet3/nnet-example.h"
 #include "nnet3/nnet-example-utils.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 namespace nnet3 {
 
 
-static bool ProcessFile(const GeneralMatrix &feats,
-                        const MatrixBase<BaseFloat> *ivector_feats,
-                        int32 ivector_period,
-                        const Posterior &pdf_post,
-                        const std::string &utt_id,
-                        bool compress,
-                        int32 num_pdfs,
-                        int32 length_tolerance,
-                        UtteranceSplitter *utt_splitter,
-                        NnetExampleWriter *example_writer) {
+/**
+   This class does the processing for one utterance: the chunks are chosen in
+   the constructor, which is called in the main thread in the order of the
+   input, together with anything random, so the egs do not depend on the
+   number of threads; the examples are created (and compressed) in
+   operator (), which may run in parallel with other utterances, and they are
+   written in the destructor, which TaskSequencer calls in the order of the
+   input.  The egs are written to the archives in 'example_writers' in turn.
+
+   The inputs are copied, as far as needed.  After construction, Ok() is false
+   if the utterance cannot be processed (a warning has been printed) and the
+   task should just be deleted.
+*/
+class ExampleTask {
+ public:
+  ExampleTask(const GeneralMatrix &feats,
+              const MatrixBase<BaseFloat> *ivector_feats,
+              int32 ivector_period,
+              const Posterior &pdf_post,
+              const std::string &utt_id,
+              bool compress,
+              int32 num_pdfs,
+              int32 length_tolerance,
+              UtteranceSplitter *utt_splitter,
+              std::vector<NnetExampleWriter*> *example_writers,
+              int64 *num_written);
+
+  bool Ok() const { return ok_; }
+
+  void operator () ();
+
+  ~ExampleTask();
+
+ private:
+  bool ok_;
+  GeneralMatrix feats_;
+  Posterior pdf_post_;
+  std::string utt_id_;
+  bool compress_;
+  int32 num_pdfs_;
+  int32 frame_subsampling_factor_;
+  std::vector<NnetExampleWriter*> *example_writers_;
+  int64 *num_written_;
+  std::vector<ChunkTimeInfo> chunks_;
+  // the iVector of each chunk (if there are iVectors); they are chosen from a
+  // random frame in the chunk.
+  std::vector<Vector<BaseFloat> > chunk_ivectors_;
+  // the output of operator ().
+  std::vector<NnetExample> egs_;
+};
+
+ExampleTask::ExampleTask(const GeneralMatrix &feats,
+                         const MatrixBase<BaseFloat> *ivector_feats,
+                         int32 ivector_period,
+                         const Posterior &pdf_post,
+                         const std::string &utt_id,
+                         bool compress,
+                         int32 num_pdfs,
+                         int32 length_tolerance,
+                         UtteranceSplitter *utt_splitter,
+                         std::vector<NnetExampleWriter*> *example_writers,
+                         int64 *num_written):
+    ok_(false), utt_id_(utt_id), compress_(compress), num_pdfs_(num_pdfs),
+    frame_subsampling_factor_(utt_splitter->Config().frame_subsampling_factor),
+    example_writers_(example_writers), num_written_(num_written) {
   int32 num_input_frames = feats.NumRows();
   if (!utt_splitter->LengthsMatch(utt_id, num_input_frames,
                                   static_cast<int32>(pdf_post.size()),
                                   length_tolerance))
-    return false;  // LengthsMatch() will have printed a warning.
+    return;  // LengthsMatch() will have printed a warning.
+  ok_ = true;
 
-  std::vector<ChunkTimeInfo> chunks;
+  utt_splitter->GetChunksForUtterance(num_input_frames, &chunks_);
 
-  utt_splitter->GetChunksForUtterance(num_input_frames, &chunks);
-
-  if (chunks.empty()) {
+  if (chunks_.empty()) {
     KALDI_WARN << "Not producing egs for utterance " << utt_id
                << " because it is too short: "
                << num_input_frames << " frames.";
+    return;
+  }
+
+  if (ivector_feats != NULL) {
+    chunk_ivectors_.resize(chunks_.size());
+    for (size_t c = 0; c < chunks_.size(); c++) {
+      const ChunkTimeInfo &chunk = chunks_[c];
+      int32 start_frame = chunk.first_frame - chunk.left_context;
+      // choose iVector from a random frame in the chunk
+      int32 ivector_frame = RandInt(start_frame,
+                                    start_frame + num_input_frames - 1),
+          ivector_frame_subsampled = ivector_frame / ivector_period;
+      if (ivector_frame_subsampled < 0)
+        ivector_frame_subsampled = 0;
+      if (ivector_frame_subsampled >= ivector_feats->NumRows())
+        ivector_frame_subsampled = ivector_feats->NumRows() - 1;
+      chunk_ivectors_[c] = ivector_feats->Row(ivector_frame_subsampled);
+    }
   }
+  feats_ = feats;
+  pdf_post_ = pdf_post;
+}
 
+void ExampleTask::operator () () {
   // 'frame_subsampling_factor' is not used in any recipes at the time of
   // writing, this is being supported to unify the code with the 'chain' recipes
   // and in case we need it for some reason in future.
-  int32 frame_subsampling_factor =
-      utt_splitter->Config().frame_subsampling_factor;
+  int32 frame_subsampling_factor = frame_subsampling_factor_;
 
-  for (size_t c = 0; c < chunks.size(); c++) {
-    const ChunkTimeInfo &chunk = chunks[c];
+  egs_.resize(chunks_.size());
+  for (size_t c = 0; c < chunks_.size(); c++) {
+    const ChunkTimeInfo &chunk = chunks_[c];
 
     int32 tot_input_frames = chunk.left_context + chunk.num_frames +
         chunk.right_context;
@@ -71,7 +148,7 @@ static bool ProcessFile(const GeneralMatrix &feats,
     int32 start_frame = chunk.first_frame - chunk.left_context;
 
     GeneralMatrix input_frames;
-    ExtractRowRangeWithPadding(feats, start_frame, tot_input_frames,
+    ExtractRowRangeWithPadding(feats_, start_frame, tot_input_frames,
                                &input_frames);
 
     // 'input_frames' now stores the relevant rows (maybe with padding) from the
@@ -79,22 +156,14 @@ static bool ProcessFile(const GeneralMatrix &feats,
     // it does this without un-compressing and re-compressing, so there is no loss
     // of accuracy.
 
-    NnetExample eg;
+    NnetExample &eg = egs_[c];
     // call the regular input "input".
     eg.io.push_back(NnetIo("input", -chunk.left_context, input_frames));
 
-    if (ivector_feats != NULL) {
+    if (!chunk_ivectors_.empty()) {
       // if applicable, add the iVector feature.
-      // choose iVector from a random frame in the chunk
-      int32 ivector_frame = RandInt(start_frame,
-                                    start_frame + num_input_frames - 1),
-          ivector_frame_subsampled = ivector_frame / ivector_period;
-      if (ivector_frame_subsampled < 0)
-        ivector_frame_subsampled = 0;
-      if (ivector_frame_subsampled >= ivector_feats->NumRows())
-        ivector_frame_subsampled = ivector_feats->NumRows() - 1;
-      Matrix<BaseFloat> ivector(1, ivector_feats->NumCols());
-      ivector.Row(0).CopyFromVec(ivector_feats->Row(ivector_frame_subsampled));
+      Matrix<BaseFloat> ivector(1, chunk_ivectors_[c].Dim());
+      ivector.Row(0).CopyFromVec(chunk_ivectors_[c]);
       eg.io.push_back(NnetIo("ivector", 0, ivector));
     }
 
@@ -112,26 +181,31 @@ static bool ProcessFile(const GeneralMatrix &feats,
     // helpful.
     for (int32 i = 0; i < num_frames_subsampled; i++) {
       int32 t = i + start_frame_subsampled;
-      if (t < pdf_post.size())
-        labels[i] = pdf_post[t];
+      if (t < pdf_post_.size())
+        labels[i] = pdf_post_[t];
       for (std::vector<std::pair<int32, BaseFloat> >::iterator
                iter = labels[i].begin(); iter != labels[i].end(); ++iter)
         iter->second *= chunk.output_weights[i];
     }
 
-    eg.io.push_back(NnetIo("output", num_pdfs, 0, labels, frame_subsampling_factor));
+    eg.io.push_back(NnetIo("output", num_pdfs_, 0, labels,
+                           frame_subsampling_factor));
 
-    if (compress)
+    if (compress_)
       eg.Compress();
+  }
+}
 
+ExampleTask::~ExampleTask() {
+  for (size_t c = 0; c < egs_.size(); c++) {
     std::ostringstream os;
-    os << utt_id << "-" << chunk.first_frame;
+    os << utt_id_ << "-" << chunks_[c].first_frame;
 
     std::string key = os.str(); // key is <utt_id>-<frame_id>
 
-    example_writer->Write(key, eg);
+    int32 index = (*num_written_)++ % example_writers_->size();
+    (*example_writers_)[index]->Write(key, egs_[c]);
   }
-  return true;
 }
 
 } // namespace nnet3
@@ -155,12 +229,17 @@ int main(int argc, char *argv[]) {
         "general)\n"
         "\n"
         "Usage:  nnet3-get-egs [options] <features-rspecifier> "
-        "<pdf-post-rspecifier> <egs-out>\n"
+        "<pdf-post-rspecifier> <egs-out1> [<egs-out2> ...]\n"
         "\n"
         "An example [where $feats expands to the actual features]:\n"
         "nnet3-get-egs --num-pdfs=2658 --left-context=12 --right-context=9 --num-frames=8 \"$feats\"\\\n"
         "\"ark:gunzip -c exp/nnet/ali.1.gz | ali-to-pdf exp/nnet/1.nnet ark:- ark:- | ali-to-post ark:- ark:- |\" \\\n"
         "   ark:- \n"
+        "With more than one output, the egs are written to them in turn\n"
+        "(round-robin).  With --num-threads, utterances are processed in\n"
+        "parallel; the egs are the same, and in the same order, as with one\n"
+        "thread.  --num-threads-total limits the number of utterances in\n"
+        "memory at once.\n"
         "See also: nnet3-chain-get-egs, nnet3-get-egs-simple\n";
 
 
@@ -171,6 +250,7 @@ int main(int argc, char *argv[]) {
 
     ExampleGenerationConfig eg_config;  // controls num-frames,
                                         // left/right-context, etc.
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     std::string online_ivector_rspecifier;
 
@@ -197,10 +277,11 @@ int main(int argc, char *argv[]) {
                 "difference in num-frames (after subsampling) between "
                 "feature matrix and posterior");
     eg_config.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
-    if (po.NumArgs() != 3) {
+    if (po.NumArgs() < 3) {
       po.PrintUsage();
       exit(1);
     }
@@ -212,8 +293,7 @@ int main(int argc, char *argv[]) {
     UtteranceSplitter utt_splitter(eg_config);
 
     std::string feature_rspecifier = po.GetArg(1),
-        pdf_post_rspecifier = po.GetArg(2),
-        examples_wspecifier = po.GetArg(3);
+        pdf_post_rspecifier = po.GetArg(2);
 
     // SequentialGeneralMatrixReader can read either a Matrix or
     // CompressedMatrix (or SparseMatrix, but not as relevant here),
@@ -221,11 +301,18 @@ int main(int argc, char *argv[]) {
     // the feature matrices without uncompressing and re-compressing.
     SequentialGeneralMatrixReader feat_reader(feature_rspecifier);
     RandomAccessPosteriorReader pdf_post_reader(pdf_post_rspecifier);
-    NnetExampleWriter example_writer(examples_wspecifier);
+    int32 num_outputs = po.NumArgs() - 2;
+    std::vector<NnetExampleWriter*> example_writers(num_outputs);
+    for (int32 i = 0; i < num_outputs; i++)
+      example_writers[i] = new NnetExampleWriter(po.GetArg(i + 3));
+    int64 num_written = 0;
     RandomAccessBaseFloatMatrixReader online_ivector_reader(
         online_ivector_rspecifier);
 
     int32 num_err = 0;
+    // the destructor waits for all the tasks, so it must come after the
+    // things the tasks use.
+    TaskSequencer<ExampleTask> sequencer(sequencer_config);
 
     for (; !feat_reader.Done(); feat_reader.Next()) {
       std::string key = feat_reader.Key();
@@ -259,13 +346,20 @@ int main(int argc, char *argv[]) {
           continue;
         }
 
-        if (!ProcessFile(feats, online_ivector_feats, online_ivector_period,
-                         pdf_post, key, compress, num_pdfs, 
-                         targets_length_tolerance,
-                         &utt_splitter, &example_writer))
+        ExampleTask *task = new ExampleTask(
+            feats, online_ivector_feats, online_ivector_period,
+            pdf_post, key, compress, num_pdfs, targets_length_tolerance,
+            &utt_splitter, &example_writers, &num_written);
+        if (task->Ok()) {
+          sequencer.Run(task);
+        } else {
+          delete task;
           num_err++;
+        }
       }
     }
+    sequencer.Wait();
+    DeletePointers(&example_writers);
     if (num_err > 0)
       KALDI_WARN << num_err << " utterances had errors and could "
           "not be processed.";
@@ -107,6 +107,7 @@ int main(int argc, char *argv[]) {
                 "is always 1; this is optimized for use with the GPU.");
     po.Register("use-gpu", &use_gpu,
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
+    RegisterCuGemmOptions(&po);
 
     po.Read(argc, argv);
 
@@ -0,0 +1,312 @@
+// nnet3bin/nnet3-latgen-faster-lanes.cc
+
+// Copyright      2018   Johns Hopkins University (author: Daniel Povey)
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "tree/context-dep.h"
+#include "hmm/transition-model.h"
+#include "fstext/fstext-lib.h"
+#include "decoder/decoder-wrappers.h"
+#include "decoder/csr-fst.h"
+#include "decoder/lattice-batch-decoder.h"
+#include "decoder/lattice-batch-decoder-cuda.h"
+#include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/nnet-batch-compute.h"
+#include "nnet3/nnet-utils.h"
+#include "base/timer.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// The input of an utterance of a batch, kept until the batch is decoded.
+struct LaneInput {
+  std::string utt;
+  Matrix<BaseFloat> features;
+  Vector<BaseFloat> ivector;
+  Matrix<BaseFloat> online_ivectors;
+};
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+    using fst::Fst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Generate lattices using nnet3 neural net model, decoding --num-lanes\n"
+        "utterances at a time together, frame by frame, with a decoder laid out\n"
+        "for data-parallel token passing over the graph in CSR form.  The\n"
+        "output is as for nnet3-latgen-faster.  <fst-in> may be an FST or a\n"
+        "graph written by make-csr-fst.  With --use-gpu, the neural net and\n"
+        "the token passing both run on the GPU.\n"
+        "Usage: nnet3-latgen-faster-lanes [options] <nnet-in> <fst-in> "
+        "<features-rspecifier> <lattice-wspecifier> [ <words-wspecifier> "
+        "[<alignments-wspecifier>] ]\n"
+        "See also: nnet3-latgen-faster, nnet3-latgen-faster-batch\n";
+    ParseOptions po(usage);
+    Timer timer;
+    bool allow_partial = false;
+    int32 num_lanes = 16;
+    LatticeFasterDecoderConfig config;
+    NnetBatchComputerOptions decodable_opts;
+    std::string use_gpu = "no";
+#if HAVE_CUDA == 1
+    CudaLatticeBatchDecoderConfig cuda_config;
+#endif
+
+    std::string word_syms_filename;
+    std::string ivector_rspecifier,
+        online_ivector_rspecifier,
+        utt2spk_rspecifier;
+    int32 online_ivector_period = 0;
+    config.Register(&po);
+    decodable_opts.Register(&po);
+#if HAVE_CUDA == 1
+    cuda_config.Register(&po);
+#endif
+    po.Register("num-lanes", &num_lanes,
+                "Number of utterances decoded together.");
+    po.Register("word-symbol-table", &word_syms_filename,
+                "Symbol table for words [for debug output]");
+    po.Register("allow-partial", &allow_partial,
+                "If true, produce output even if end state was not reached.");
+    po.Register("ivectors", &ivector_rspecifier, "Rspecifier for "
+                "iVectors as vectors (i.e. not estimated online); per utterance "
+                "by default, or per speaker if you provide the --utt2spk option.");
+    po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for "
+                "utt2spk option used to get ivectors per speaker");
+    po.Register("online-ivectors", &online_ivector_rspecifier, "Rspecifier for "
+                "iVectors estimated online, as matrices.  If you supply this,"
+                " you must set the --online-ivector-period option.");
+    po.Register("online-ivector-period", &online_ivector_period, "Number of frames "
+                "between iVectors in matrices supplied to the --online-ivectors "
+                "option");
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional|wait, only has effect if compiled with CUDA");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 4 || po.NumArgs() > 6 || num_lanes <= 0) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_in_filename = po.GetArg(1),
+        fst_in_filename = po.GetArg(2),
+        feature_rspecifier = po.GetArg(3),
+        lattice_wspecifier = po.GetArg(4),
+        words_wspecifier = po.GetOptArg(5),
+        alignment_wspecifier = po.GetOptArg(6);
+
+#if HAVE_CUDA == 1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
+    TransitionModel trans_model;
+    AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(model_in_filename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+      SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
+      SetDropoutTestMode(true, &(am_nnet.GetNnet()));
+      CollapseModel(CollapseModelConfig(), &(am_nnet.GetNnet()));
+    }
+
+    bool determinize = config.determinize_lattice;
+    CompactLatticeWriter compact_lattice_writer;
+    LatticeWriter lattice_writer;
+    if (! (determinize ? compact_lattice_writer.Open(lattice_wspecifier)
+           : lattice_writer.Open(lattice_wspecifier)))
+      KALDI_ERR << "Could not open table for writing lattices: "
+                 << lattice_wspecifier;
+
+    RandomAccessBaseFloatMatrixReader online_ivector_reader(
+        online_ivector_rspecifier);
+    RandomAccessBaseFloatVectorReaderMapped ivector_reader(
+        ivector_rspecifier, utt2spk_rspecifier);
+
+    Int32VectorWriter words_writer(words_wspecifier);
+    Int32VectorWriter alignment_writer(alignment_wspecifier);
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_filename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                   << word_syms_filename;
+
+    double tot_like = 0.0;
+    kaldi::int64 frame_count = 0;
+    int num_success = 0, num_fail = 0;
+    CachingOptimizingCompiler compiler(am_nnet.GetNnet(),
+                                       decodable_opts.optimize_config,
+                                       decodable_opts.compiler_config);
+
+    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    {
+      CsrFst *csr_fst = ReadCsrFstGeneric(fst_in_filename);
+      timer.Reset();
+
+      LatticeBatchDecoder decoder(*csr_fst, config);
+#if HAVE_CUDA == 1
+      // On the GPU the log-likelihoods stay there, from NnetBatchComputer to
+      // CudaLatticeBatchDecoder.
+      NnetBatchComputer *computer = NULL;
+      CudaLatticeBatchDecoder *cuda_decoder = NULL;
+      if (CuDevice::Instantiate().Enabled()) {
+        computer = new NnetBatchComputer(decodable_opts, am_nnet.GetNnet(),
+                                         am_nnet.Priors());
+        cuda_decoder = new CudaLatticeBatchDecoder(*csr_fst, trans_model,
+                                                   config, cuda_config);
+      }
+#endif
+      std::vector<LaneInput*> inputs;
+      while (!feature_reader.Done() || !inputs.empty()) {
+        for (; !feature_reader.Done() &&
+                 static_cast<int32>(inputs.size()) < num_lanes;
+             feature_reader.Next()) {
+          std::string utt = feature_reader.Key();
+          if (feature_reader.Value().NumRows() == 0) {
+            KALDI_WARN << "Zero-length utterance: " << utt;
+            num_fail++;
+            continue;
+          }
+          if (!ivector_rspecifier.empty() && !ivector_reader.HasKey(utt)) {
+            KALDI_WARN << "No iVector available for utterance " << utt;
+            num_fail++;
+            continue;
+          }
+          if (!online_ivector_rspecifier.empty() &&
+              !online_ivector_reader.HasKey(utt)) {
+            KALDI_WARN << "No online iVector available for utterance " << utt;
+            num_fail++;
+            continue;
+          }
+          LaneInput *input = new LaneInput();
+          input->utt = utt;
+          input->features = feature_reader.Value();
+          if (!ivector_rspecifier.empty())
+            input->ivector = ivector_reader.Value(utt);
+          if (!online_ivector_rspecifier.empty())
+            input->online_ivectors = online_ivector_reader.Value(utt);
+          inputs.push_back(input);
+        }
+        if (inputs.empty())
+          break;
+
+        std::vector<std::string> utts;
+#if HAVE_CUDA == 1
+        if (cuda_decoder != NULL) {
+          std::vector<std::vector<NnetInferenceTask> > tasks(inputs.size());
+          for (size_t i = 0; i < inputs.size(); i++) {
+            const LaneInput &input = *(inputs[i]);
+            utts.push_back(input.utt);
+            computer->SplitUtteranceIntoTasks(
+                false, input.features,
+                ivector_rspecifier.empty() ? NULL : &input.ivector,
+                online_ivector_rspecifier.empty() ? NULL :
+                &input.online_ivectors,
+                online_ivector_period, &(tasks[i]));
+            for (size_t j = 0; j < tasks[i].size(); j++)
+              computer->AcceptTask(&(tasks[i][j]));
+          }
+          while (computer->Compute(true));
+          std::vector<CuMatrix<BaseFloat> > loglikes(inputs.size());
+          std::vector<const CuMatrixBase<BaseFloat>*> loglike_ptrs;
+          for (size_t i = 0; i < inputs.size(); i++) {
+            for (size_t j = 0; j < tasks[i].size(); j++)
+              tasks[i][j].semaphore.Wait();
+            MergeTaskOutput(tasks[i], &(loglikes[i]));
+            loglike_ptrs.push_back(&(loglikes[i]));
+          }
+          cuda_decoder->Decode(loglike_ptrs);
+          int32 batch_success = OutputLatticeBatch(
+              *cuda_decoder, utts, trans_model, word_syms,
+              decodable_opts.acoustic_scale, determinize, allow_partial,
+              &alignment_writer, &words_writer, &compact_lattice_writer,
+              &lattice_writer, &tot_like, &frame_count);
+          num_success += batch_success;
+          num_fail += inputs.size() - batch_success;
+          for (size_t i = 0; i < inputs.size(); i++)
+            delete inputs[i];
+          inputs.clear();
+          continue;
+        }
+#endif
+        std::vector<DecodableInterface*> decodables;
+        for (size_t i = 0; i < inputs.size(); i++) {
+          const LaneInput &input = *(inputs[i]);
+          utts.push_back(input.utt);
+          decodables.push_back(new DecodableAmNnetSimple(
+              decodable_opts, trans_model, am_nnet, input.features,
+              ivector_rspecifier.empty() ? NULL : &input.ivector,
+              online_ivector_rspecifier.empty() ? NULL : &input.online_ivectors,
+              online_ivector_period, &compiler));
+        }
+        int32 batch_success = DecodeUtteranceLatticeBatch(
+            decoder, decodables, utts, trans_model, word_syms,
+            decodable_opts.acoustic_scale, determinize, allow_partial,
+            &alignment_writer, &words_writer, &compact_lattice_writer,
+            &lattice_writer, &tot_like, &frame_count);
+        num_success += batch_success;
+        num_fail += inputs.size() - batch_success;
+        for (size_t i = 0; i < inputs.size(); i++) {
+          delete decodables[i];
+          delete inputs[i];
+        }
+        inputs.clear();
+      }
+#if HAVE_CUDA == 1
+      delete cuda_decoder;
+      delete computer;
+#endif
+      delete csr_fst;
+    }
+
+    kaldi::int64 input_frame_count =
+        frame_count * decodable_opts.frame_subsampling_factor;
+
+    double elapsed = timer.Elapsed();
+    KALDI_LOG << "Time taken "<< elapsed
+              << "s: real-time factor assuming 100 frames/sec is "
+              << (elapsed * 100.0 / input_frame_count);
+    KALDI_LOG << "Done " << num_success << " utterances, failed for "
+              << num_fail;
+    KALDI_LOG << "Overall log-likelihood per frame is "
+              << (tot_like / frame_count) << " over "
+              << frame_count << " frames.";
+
+    delete word_syms;
+#if HAVE_CUDA == 1
+    CuDevice::Instantiate().PrintProfile();
+#endif
+    if (num_success != 0) return 0;
+    else return 1;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
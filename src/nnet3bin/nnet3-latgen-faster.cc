@@ -43,7 +43,8 @@ int main(int argc, char *argv[]) {
     using fst::StdArc;
 
     const char *usage =
-        "Generate lattices using nnet3 neural net model.\n"
+        "Generate lattices using nnet3 neural net model.  <fst-in> may also be\n"
+        "a graph written by make-csr-fst, which is mapped into memory.\n"
         "Usage: nnet3-latgen-faster [options] <nnet-in> <fst-in|fsts-rspecifier> <features-rspecifier>"
         " <lattice-wspecifier> [ <words-wspecifier> [<alignments-wspecifier>] ]\n"
         "See also: nnet3-latgen-faster-parallel, nnet3-latgen-faster-batch\n";
@@ -51,6 +52,7 @@ int main(int argc, char *argv[]) {
     Timer timer;
     bool allow_partial = false;
     LatticeFasterDecoderConfig config;
+    LatticeIncrementalDeterminizerConfig incremental_config;
     NnetSimpleComputationOptions decodable_opts;
 
     std::string word_syms_filename;
@@ -59,6 +61,7 @@ int main(int argc, char *argv[]) {
         utt2spk_rspecifier;
     int32 online_ivector_period = 0;
     config.Register(&po);
+    incremental_config.Register(&po);
     decodable_opts.Register(&po);
     po.Register("word-symbol-table", &word_syms_filename,
                 "Symbol table for words [for debug output]");
@@ -130,17 +133,39 @@ int main(int argc, char *argv[]) {
     // this compiler object allows caching of computations across
     // different utterances.
     CachingOptimizingCompiler compiler(am_nnet.GetNnet(),
-                                       decodable_opts.optimize_config);
+                                       decodable_opts.optimize_config,
+                                       decodable_opts.compiler_config);
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
-      // Input FST is just one FST, not a table of FSTs.
-      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      // Input FST is just one FST, not a table of FSTs.  A graph written by
+      // make-csr-fst is mapped and decoded as it is.
+      Fst<StdArc> *decode_fst = NULL;
+      CsrFst *csr_fst = NULL;
+      if (CsrFst::IsCsrFstFile(fst_in_str)) {
+        csr_fst = new CsrFst();
+        csr_fst->Read(fst_in_str);
+      } else {
+        decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      }
       timer.Reset();
 
       {
-        LatticeFasterDecoder decoder(*decode_fst, config);
+        LatticeFasterDecoder *decoder = NULL;
+        LatticeFasterDecoderTpl<CsrFst> *csr_decoder = NULL;
+        if (csr_fst != NULL)
+          csr_decoder = new LatticeFasterDecoderTpl<CsrFst>(*csr_fst, config);
+        else
+          decoder = new LatticeFasterDecoder(*decode_fst, config);
+        // with --determinize-chunk-size, the lattice is determinized as the
+        // utterance is decoded.
+        bool incremental = determinize && incremental_config.chunk_size > 0;
+        fst::DeterminizeLatticePrunedOptions incremental_det_opts;
+        incremental_det_opts.max_mem = config.det_opts.max_mem;
+        LatticeIncrementalDeterminizer determinizer(incremental_config,
+                                                    config.lattice_beam,
+                                                    incremental_det_opts);
 
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
@@ -177,19 +202,44 @@ int main(int argc, char *argv[]) {
               online_ivector_period, &compiler);
 
           double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, nnet_decodable, trans_model, word_syms, utt,
-                  decodable_opts.acoustic_scale, determinize, allow_partial,
-                  &alignment_writer, &words_writer, &compact_lattice_writer,
-                  &lattice_writer,
-                  &like)) {
+          bool ok;
+          if (incremental) {
+            ok = (csr_decoder != NULL ?
+                DecodeUtteranceLatticeIncremental(
+                    *csr_decoder, determinizer, nnet_decodable, trans_model,
+                    word_syms, utt, decodable_opts.acoustic_scale,
+                    allow_partial, &alignment_writer, &words_writer,
+                    &compact_lattice_writer, &like) :
+                DecodeUtteranceLatticeIncremental(
+                    *decoder, determinizer, nnet_decodable, trans_model,
+                    word_syms, utt, decodable_opts.acoustic_scale,
+                    allow_partial, &alignment_writer, &words_writer,
+                    &compact_lattice_writer, &like));
+          } else {
+            ok = (csr_decoder != NULL ?
+                DecodeUtteranceLatticeFaster(
+                    *csr_decoder, nnet_decodable, trans_model, word_syms, utt,
+                    decodable_opts.acoustic_scale, determinize, allow_partial,
+                    &alignment_writer, &words_writer, &compact_lattice_writer,
+                    &lattice_writer, &like) :
+                DecodeUtteranceLatticeFaster(
+                    *decoder, nnet_decodable, trans_model, word_syms, utt,
+                    decodable_opts.acoustic_scale, determinize, allow_partial,
+                    &alignment_writer, &words_writer, &compact_lattice_writer,
+                    &lattice_writer, &like));
+          }
+          if (ok) {
             tot_like += like;
             frame_count += nnet_decodable.NumFramesReady();
             num_success++;
           } else num_fail++;
         }
+        delete decoder;
+        delete csr_decoder;
       }
-      delete decode_fst; // delete this only after decoder goes out of scope.
+      // delete these only after the decoder is deleted.
+      delete decode_fst;
+      delete csr_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
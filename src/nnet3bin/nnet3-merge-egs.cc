@@ -60,6 +60,7 @@ int main(int argc, char *argv[]) {
 
     ExampleMergingConfig merging_config;
     merging_config.Register(&po);
+    RegisterIoOptions(&po);
 
     po.Read(argc, argv);
 
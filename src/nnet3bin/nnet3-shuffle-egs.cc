@@ -47,6 +47,7 @@ int main(int argc, char *argv[]) {
     po.Register("buffer-size", &buffer_size, "If >0, size of a buffer we use "
                 "to do limited-memory partial randomization.  Otherwise, do "
                 "full randomization.");
+    RegisterIoOptions(&po);
 
     po.Read(argc, argv);
 
@@ -72,7 +73,7 @@ int main(int argc, char *argv[]) {
 
       for (; !example_reader.Done(); example_reader.Next())
         egs.push_back(std::make_pair(example_reader.Key(),
-                                    new NnetExample(example_reader.Value())));
+                                    new NnetExample(std::move(example_reader.Value()))));
 
       std::random_shuffle(egs.begin(), egs.end());
     } else {
@@ -83,18 +84,19 @@ int main(int argc, char *argv[]) {
         int32 index = RandInt(0, buffer_size - 1);
         if (egs[index].second == NULL) {
           egs[index] = std::make_pair(example_reader.Key(),
-                                    new NnetExample(example_reader.Value()));
+                                    new NnetExample(std::move(example_reader.Value())));
         } else {
-          example_writer.Write(egs[index].first, *(egs[index].second));
+          example_writer.Write(egs[index].first,
+                               std::move(*(egs[index].second)));
           egs[index].first = example_reader.Key();
-          *(egs[index].second) = example_reader.Value();
+          *(egs[index].second) = std::move(example_reader.Value());
           num_done++;
         }
       }
     }
     for (size_t i = 0; i < egs.size(); i++) {
       if (egs[i].second != NULL) {
-        example_writer.Write(egs[i].first, *(egs[i].second));
+        example_writer.Write(egs[i].first, std::move(*(egs[i].second)));
         delete egs[i].second;
         num_done++;
       }
@@ -20,7 +20,9 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet3/nnet-training.h"
+#include "nnet3/nnet-example-loader.h"
 #include "cudamatrix/cu-allocator.h"
+#include "matrix/matrix-allocator.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -32,19 +34,24 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Train nnet3 neural network parameters with backprop and stochastic\n"
         "gradient descent.  Minibatches are to be created by nnet3-merge-egs in\n"
-        "the input pipeline.  This training program is single-threaded (best to\n"
+        "the input pipeline, or by this program with --egs.merge (and shuffled\n"
+        "with --egs.buffer-size).  This training program is single-threaded (best to\n"
         "use it with a GPU); see nnet3-train-parallel for multi-threaded training\n"
         "that is better suited to CPUs.\n"
         "\n"
         "Usage:  nnet3-train [options] <raw-model-in> <training-examples-in> <raw-model-out>\n"
         "\n"
         "e.g.:\n"
-        "nnet3-train 1.raw 'ark:nnet3-merge-egs 1.egs ark:-|' 2.raw\n";
+        "nnet3-train 1.raw 'ark:nnet3-merge-egs 1.egs ark:-|' 2.raw\n"
+        "nnet3-train --egs.merge --egs.buffer-size=5000 --egs.minibatch-size=256 \\\n"
+        "  1.raw ark:1.egs 2.raw\n";
 
     int32 srand_seed = 0;
     bool binary_write = true;
     std::string use_gpu = "yes";
     NnetTrainerOptions train_config;
+    ExampleLoaderOptions loader_opts;
+    ExampleMergingConfig merging_config;
 
     ParseOptions po(usage);
     po.Register("srand", &srand_seed, "Seed for random number generator ");
@@ -53,9 +60,19 @@ int main(int argc, char *argv[]) {
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
 
     train_config.Register(&po);
+    // the loader's options are prefixed, e.g. --egs.buffer-size, so that
+    // --egs.minibatch-size and --egs.compress do not clash with anything.
+    ParseOptions egs_opts("egs", &po);
+    loader_opts.Register(&egs_opts);
+    merging_config.Register(&egs_opts);
     RegisterCuAllocatorOptions(&po);
+    RegisterCuGemmOptions(&po);
+    RegisterMatrixAllocatorOptions(&po);
+    RegisterIoOptions(&po);
 
     po.Read(argc, argv);
+    if (loader_opts.merge)
+      merging_config.ComputeDerived();
 
     srand(srand_seed);
 
@@ -77,16 +94,18 @@ int main(int argc, char *argv[]) {
 
     NnetTrainer trainer(train_config, &nnet);
 
-    SequentialNnetExampleReader example_reader(examples_rspecifier);
+    NnetExampleLoader example_loader(loader_opts, merging_config,
+                                     examples_rspecifier);
 
-    for (; !example_reader.Done(); example_reader.Next())
-      trainer.Train(example_reader.Value());
+    while (const NnetExample *eg = example_loader.Next())
+      trainer.Train(*eg);
 
     bool ok = trainer.PrintTotalStats();
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    PrintMatrixAllocatorStats();
     WriteKaldiObject(nnet, nnet_wxfilename, binary_write);
     KALDI_LOG << "Wrote model to " << nnet_wxfilename;
     return (ok ? 0 : 1);
@@ -20,6 +20,8 @@
 // limitations under the License.
 
 
+#include <deque>
+#include <map>
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet3/nnet-am-decodable-simple.h"
@@ -29,34 +31,173 @@
 namespace kaldi {
 namespace nnet3 {
 
-// Computes an xvector from a chunk of speech features.
-static void RunNnetComputation(const MatrixBase<BaseFloat> &features,
+// Computes the xvectors of chunks of speech features which all have the same
+// number of frames, in one computation: chunk i is given 'n' index i.  Row i
+// of 'xvectors' is the xvector of chunk i.
+static void RunNnetComputation(
+    const std::vector<const MatrixBase<BaseFloat>*> &chunks,
     const Nnet &nnet, CachingOptimizingCompiler *compiler,
-    Vector<BaseFloat> *xvector) {
+    Matrix<BaseFloat> *xvectors) {
+  KALDI_ASSERT(!chunks.empty());
+  int32 num_chunks = chunks.size(), num_rows = chunks[0]->NumRows(),
+      feat_dim = chunks[0]->NumCols();
   ComputationRequest request;
   request.need_model_derivative = false;
   request.store_component_stats = false;
-  request.inputs.push_back(
-    IoSpecification("input", 0, features.NumRows()));
+  IoSpecification input_spec;
+  input_spec.name = "input";
+  input_spec.indexes.resize(num_chunks * num_rows);
+  for (int32 n = 0; n < num_chunks; n++)
+    for (int32 t = 0; t < num_rows; t++)
+      input_spec.indexes[n * num_rows + t] = Index(n, t);
+  request.inputs.resize(1);
+  request.inputs[0].Swap(&input_spec);
   IoSpecification output_spec;
   output_spec.name = "output";
   output_spec.has_deriv = false;
-  output_spec.indexes.resize(1);
+  output_spec.indexes.resize(num_chunks);
+  for (int32 n = 0; n < num_chunks; n++)
+    output_spec.indexes[n] = Index(n, 0);
   request.outputs.resize(1);
   request.outputs[0].Swap(&output_spec);
   std::shared_ptr<const NnetComputation> computation(std::move(compiler->Compile(request)));
   Nnet *nnet_to_update = NULL;  // we're not doing any update.
   NnetComputer computer(NnetComputeOptions(), *computation,
                   nnet, nnet_to_update);
-  CuMatrix<BaseFloat> input_feats_cu(features);
+  Matrix<BaseFloat> input_feats(num_chunks * num_rows, feat_dim,
+                                kUndefined);
+  for (int32 n = 0; n < num_chunks; n++) {
+    KALDI_ASSERT(chunks[n]->NumRows() == num_rows);
+    input_feats.RowRange(n * num_rows, num_rows).CopyFromMat(*chunks[n]);
+  }
+  CuMatrix<BaseFloat> input_feats_cu;
+  input_feats_cu.Swap(&input_feats);
   computer.AcceptInput("input", &input_feats_cu);
   computer.Run();
   CuMatrix<BaseFloat> cu_output;
   computer.GetOutputDestructive("output", &cu_output);
-  xvector->Resize(cu_output.NumCols());
-  xvector->CopyFromVec(cu_output.Row(0));
+  xvectors->Resize(0, 0);
+  cu_output.Swap(xvectors);
 }
 
+// Collects the chunks of utterances and computes chunks of the same length
+// together, up to 'batch_size' at a time; the xvector of each utterance (the
+// weighted average of those of its chunks) is written once all of its chunks
+// are done, in the order of the input.
+class BatchedXvectorComputer {
+ public:
+  BatchedXvectorComputer(const Nnet &nnet,
+                         CachingOptimizingCompiler *compiler,
+                         int32 batch_size,
+                         BaseFloatVectorWriter *writer):
+      nnet_(nnet), compiler_(compiler), batch_size_(batch_size),
+      writer_(writer), xvector_dim_(nnet.OutputDim("output")) {
+    KALDI_ASSERT(batch_size > 0);
+  }
+
+  // Takes the chunks of an utterance (by swapping their contents) and the
+  // weight of each of them.
+  void AcceptUtterance(const std::string &utt,
+                       std::vector<Matrix<BaseFloat> > *chunks,
+                       const std::vector<BaseFloat> &weights) {
+    KALDI_ASSERT(chunks->size() == weights.size() && !chunks->empty());
+    Utterance *utterance = new Utterance();
+    utterance->key = utt;
+    utterance->xvector_sum.Resize(xvector_dim_);
+    utterance->tot_weight = 0.0;
+    utterance->num_pending = chunks->size();
+    utterances_.push_back(utterance);
+    for (size_t i = 0; i < chunks->size(); i++) {
+      Chunk *chunk = new Chunk();
+      chunk->feats.Swap(&((*chunks)[i]));
+      chunk->weight = weights[i];
+      chunk->utterance = utterance;
+      std::vector<Chunk*> &bucket = buckets_[chunk->feats.NumRows()];
+      bucket.push_back(chunk);
+      if (static_cast<int32>(bucket.size()) == batch_size_)
+        ComputeBucket(&bucket);
+    }
+    // Chunks of a length that is seldom seen would otherwise keep everything
+    // after them waiting.
+    if (static_cast<int32>(utterances_.size()) > batch_size_)
+      ComputeAll();
+    WriteFinished();
+  }
+
+  void Finish() {
+    ComputeAll();
+    WriteFinished();
+    KALDI_ASSERT(utterances_.empty());
+  }
+
+  ~BatchedXvectorComputer() {
+    for (std::map<int32, std::vector<Chunk*> >::iterator
+             iter = buckets_.begin(); iter != buckets_.end(); ++iter)
+      for (size_t i = 0; i < iter->second.size(); i++)
+        delete iter->second[i];
+    for (size_t i = 0; i < utterances_.size(); i++)
+      delete utterances_[i];
+  }
+
+ private:
+  struct Utterance {
+    std::string key;
+    Vector<BaseFloat> xvector_sum;
+    BaseFloat tot_weight;
+    int32 num_pending;
+  };
+  struct Chunk {
+    Matrix<BaseFloat> feats;
+    BaseFloat weight;
+    Utterance *utterance;
+  };
+
+  void ComputeBucket(std::vector<Chunk*> *bucket) {
+    if (bucket->empty())
+      return;
+    std::vector<const MatrixBase<BaseFloat>*> feats(bucket->size());
+    for (size_t i = 0; i < bucket->size(); i++)
+      feats[i] = &((*bucket)[i]->feats);
+    Matrix<BaseFloat> xvectors;
+    RunNnetComputation(feats, nnet_, compiler_, &xvectors);
+    for (size_t i = 0; i < bucket->size(); i++) {
+      Chunk *chunk = (*bucket)[i];
+      Utterance *utterance = chunk->utterance;
+      utterance->xvector_sum.AddVec(chunk->weight, xvectors.Row(i));
+      utterance->tot_weight += chunk->weight;
+      utterance->num_pending--;
+      delete chunk;
+    }
+    bucket->clear();
+  }
+
+  void ComputeAll() {
+    for (std::map<int32, std::vector<Chunk*> >::iterator
+             iter = buckets_.begin(); iter != buckets_.end(); ++iter)
+      ComputeBucket(&(iter->second));
+  }
+
+  void WriteFinished() {
+    while (!utterances_.empty() && utterances_.front()->num_pending == 0) {
+      Utterance *utterance = utterances_.front();
+      utterance->xvector_sum.Scale(1.0 / utterance->tot_weight);
+      writer_->Write(utterance->key, utterance->xvector_sum);
+      delete utterance;
+      utterances_.pop_front();
+    }
+  }
+
+  const Nnet &nnet_;
+  CachingOptimizingCompiler *compiler_;
+  int32 batch_size_;
+  BaseFloatVectorWriter *writer_;
+  int32 xvector_dim_;
+  // the chunks waiting to be computed, by number of frames.
+  std::map<int32, std::vector<Chunk*> > buckets_;
+  // the utterances not written yet, in input order.
+  std::deque<Utterance*> utterances_;
+};
+
 } // namespace nnet3
 } // namespace kaldi
 
@@ -79,7 +220,10 @@ int main(int argc, char *argv[]) {
         "output layer after the statistics pooling layer.  By default, one\n"
         "xvector is extracted directly from the set of features for each\n"
         "utterance.  Optionally, xvectors are extracted from chunks of input\n"
-        "features and averaged, to produce a single vector.\n"
+        "features and averaged, to produce a single vector.  Chunks of the\n"
+        "same length are computed together, --batch-size at a time, and with\n"
+        "--chunk-length-quantum short chunks are padded to fewer lengths so\n"
+        "that fewer distinct computations have to be compiled.\n"
         "\n"
         "Usage: nnet3-xvector-compute [options] <raw-nnet-in> "
         "<features-rspecifier> <vector-wspecifier>\n"
@@ -97,7 +241,9 @@ int main(int argc, char *argv[]) {
 
     std::string use_gpu = "no";
     int32 chunk_size = -1,
-      min_chunk_size = 100;
+      min_chunk_size = 100,
+      batch_size = 32,
+      chunk_length_quantum = 0;
     bool pad_input = true;
 
     opts.Register(&po);
@@ -112,6 +258,15 @@ int main(int argc, char *argv[]) {
       "Minimum chunk-size allowed when extracting xvectors.");
     po.Register("pad-input", &pad_input, "If true, duplicate the first and "
       "last frames of the input features as required to equal min-chunk-size.");
+    po.Register("batch-size", &batch_size, "Number of chunks of the same "
+      "length that are computed together (chunks of different utterances "
+      "are batched, an utterance is written once all its chunks are done).");
+    po.Register("chunk-length-quantum", &chunk_length_quantum, "If >0 and "
+      "--pad-input=true, chunks shorter than --chunk-size (or, without "
+      "--chunk-size, whole utterances) are padded (as for "
+      "--min-chunk-size) to a multiple of this many frames, so that fewer "
+      "shapes are compiled and more chunks are batched together.  This "
+      "changes the xvectors of those chunks slightly.");
 
     po.Read(argc, argv);
 
@@ -119,6 +274,12 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    if (batch_size <= 0 || chunk_length_quantum < 0)
+      KALDI_ERR << "Invalid --batch-size or --chunk-length-quantum";
+    // --compile-cache-dir (of the NnetSimpleComputationOptions) is the same
+    // as --cache-dir here.
+    if (compiler_config.cache_dir.empty())
+      compiler_config.cache_dir = opts.compiler_config.cache_dir;
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
@@ -137,10 +298,11 @@ int main(int argc, char *argv[]) {
     CachingOptimizingCompiler compiler(nnet, opts.optimize_config, compiler_config);
 
     BaseFloatVectorWriter vector_writer(vector_wspecifier);
+    BatchedXvectorComputer xvector_computer(nnet, &compiler, batch_size,
+                                            &vector_writer);
 
     int32 num_success = 0, num_fail = 0;
     int64 frame_count = 0;
-    int32 xvector_dim = nnet.OutputDim("output");
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
@@ -172,8 +334,8 @@ int main(int argc, char *argv[]) {
 
       int32 num_chunks = ceil(
         num_rows / static_cast<BaseFloat>(this_chunk_size));
-      Vector<BaseFloat> xvector_avg(xvector_dim, kSetZero);
-      BaseFloat tot_weight = 0.0;
+      std::vector<Matrix<BaseFloat> > chunks;
+      std::vector<BaseFloat> weights;
 
       // Iterate over the feature chunks.
       for (int32 chunk_indx = 0; chunk_indx < num_chunks; chunk_indx++) {
@@ -186,34 +348,51 @@ int main(int argc, char *argv[]) {
           continue;
         SubMatrix<BaseFloat> sub_features(
           features, chunk_indx * this_chunk_size, offset, 0, feat_dim);
-        Vector<BaseFloat> xvector;
-        tot_weight += offset;
-
-        // Pad input if the offset is less than the minimum chunk size
-        if (pad_input && offset < min_chunk_size) {
-          Matrix<BaseFloat> padded_features(min_chunk_size, feat_dim);
-          int32 left_context = (min_chunk_size - offset) / 2;
-          int32 right_context = min_chunk_size - offset - left_context;
+        weights.push_back(offset);
+
+        int32 padded_size = offset;
+        if (pad_input) {
+          if (chunk_length_quantum > 0 &&
+              (chunk_size == -1 || offset < chunk_size)) {
+            padded_size = (offset + chunk_length_quantum - 1) /
+                chunk_length_quantum * chunk_length_quantum;
+            if (chunk_size != -1)
+              padded_size = std::min(padded_size, chunk_size);
+          }
+          padded_size = std::max(padded_size, min_chunk_size);
+        }
+        chunks.resize(chunks.size() + 1);
+        Matrix<BaseFloat> &padded_features = chunks.back();
+        // Pad input if the offset is less than the padded size
+        if (padded_size > offset) {
+          padded_features.Resize(padded_size, feat_dim, kUndefined);
+          int32 left_context = (padded_size - offset) / 2;
+          int32 right_context = padded_size - offset - left_context;
           for (int32 i = 0; i < left_context; i++) {
             padded_features.Row(i).CopyFromVec(sub_features.Row(0));
           }
           for (int32 i = 0; i < right_context; i++) {
-            padded_features.Row(min_chunk_size - i - 1).CopyFromVec(sub_features.Row(offset - 1));
+            padded_features.Row(padded_size - i - 1).CopyFromVec(sub_features.Row(offset - 1));
           }
           padded_features.Range(left_context, offset, 0, feat_dim).CopyFromMat(sub_features);
-          RunNnetComputation(padded_features, nnet, &compiler, &xvector);
         } else {
-          RunNnetComputation(sub_features, nnet, &compiler, &xvector);
+          padded_features = sub_features;
         }
-        xvector_avg.AddVec(offset, xvector);
       }
-      xvector_avg.Scale(1.0 / tot_weight);
-      vector_writer.Write(utt, xvector_avg);
+      if (chunks.empty()) {
+        KALDI_WARN << "No chunk of at least " << min_chunk_size
+                   << " frames in utterance: " << utt;
+        num_fail++;
+        continue;
+      }
+      xvector_computer.AcceptUtterance(utt, &chunks, weights);
 
       frame_count += features.NumRows();
       num_success++;
     }
 
+    xvector_computer.Finish();
+
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
@@ -38,10 +38,14 @@ int main(int argc, char *argv[]) {
 
     bool binary_write = false;
     float learn_rate_coef = 0.0;
+    int32 num_copies = 1;
     
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("learn-rate-coef", &learn_rate_coef, "Initialize learning-rate coefficient to a value.");
+    po.Register("num-copies", &num_copies, "Repeat the shift and scale this "
+                "many times, for stats of the features before a transform "
+                "that splices them, e.g. stats written during extraction");
 
     po.Read(argc, argv);
 
@@ -63,12 +67,14 @@ int main(int argc, char *argv[]) {
     KALDI_ASSERT(minmax_stats.NumRows() == 2);
     KALDI_ASSERT(minmax_stats.NumCols() > 1);
 
+    KALDI_ASSERT(num_copies > 0);
+
     int32 num_dims = minmax_stats.NumCols() - 1;
     double count = minmax_stats(0, minmax_stats.NumCols()-1);
    
     // buffers for shift and scale 
-    Vector<BaseFloat> shift(num_dims);
-    Vector<BaseFloat> scale(num_dims);
+    Vector<BaseFloat> shift(num_dims * num_copies);
+    Vector<BaseFloat> scale(num_dims * num_copies);
     
     // Make this configurable?
     double ca = 0.01;
@@ -83,6 +89,12 @@ int main(int argc, char *argv[]) {
         scale(d) = (da - ca) / (max - min);
         std::cerr << d << ": " <<  shift(d) << "," << scale(d) << '\n';
     }
+    // splicing copies the frames, so each copy has the same range
+    for (int32 c = 1; c < num_copies; c++) {
+      int32 offset = c * num_dims;
+      shift.Range(offset, num_dims).CopyFromVec(shift.Range(0, num_dims));
+      scale.Range(offset, num_dims).CopyFromVec(scale.Range(0, num_dims));
+    }
 
     // we will put the shift and scale to the nnet
     Nnet nnet;
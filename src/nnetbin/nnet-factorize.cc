@@ -0,0 +1,188 @@
+// nnetbin/nnet-factorize.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet/nnet-nnet.h"
+#include "nnet/nnet-affine-transform.h"
+#include "nnet/nnet-linear-transform.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// The rank of the factors of a weight matrix with singular values 's'
+// (sorted, decreasing): 'rank' if it is set, or the fewest singular values
+// that hold 'energy' of the sum of the squares,
+static int32 ChooseRank(const VectorBase<BaseFloat> &s, int32 rank,
+                        BaseFloat energy) {
+  if (rank > 0) return std::min(rank, s.Dim());
+  double total = VecVec(s, s), kept = 0.0;
+  for (int32 k = 0; k < s.Dim(); k++) {
+    kept += s(k) * s(k);
+    if (kept >= energy * total) return k + 1;
+  }
+  return s.Dim();
+}
+
+// Appends the factors of the weights W = U diag(s) Vt of an affine layer,
+// a <LinearTransform> of diag(s)^1/2 Vt to 'rank' dims and an
+// <AffineTransform> of U diag(s)^1/2 with the bias (the square roots keep
+// the two factors of the same scale, for training them further),
+static void AppendFactors(const Matrix<BaseFloat> &U,
+                          const Vector<BaseFloat> &s,
+                          const Matrix<BaseFloat> &Vt,
+                          const CuVectorBase<BaseFloat> &bias,
+                          int32 rank, Nnet *nnet) {
+  Vector<BaseFloat> sqrt_s(s.Range(0, rank));
+  sqrt_s.ApplyPow(0.5);
+  Matrix<BaseFloat> in_factor(Vt.RowRange(0, rank)),
+      out_factor(U.ColRange(0, rank));
+  in_factor.MulRowsVec(sqrt_s);
+  out_factor.MulColsVec(sqrt_s);
+  LinearTransform lin(Vt.NumCols(), rank);
+  lin.SetLinearity(in_factor);
+  AffineTransform aff(rank, U.NumRows());
+  aff.SetLinearity(CuMatrix<BaseFloat>(out_factor));
+  aff.SetBias(bias);
+  nnet->AppendComponent(lin);
+  nnet->AppendComponent(aff);
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet1;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+      "Factorize the <AffineTransform> components of a network by SVD into\n"
+      "a <LinearTransform> to a lower rank followed by an <AffineTransform>,\n"
+      "which is faster for inference when rank * (in + out) < in * out.\n"
+      "The rank is --rank, or the fewest singular values that hold\n"
+      "--energy of the weights (sum of squares); layers that would not get\n"
+      "smaller are kept as they are. The factors are ordinary components,\n"
+      "so nnet-forward and pyIdlak run the result as any network, and it\n"
+      "can be fine-tuned with a short run of nnet-train-frmshuff (with a\n"
+      "small --learn-rate) to recover the accuracy lost.\n"
+      "Usage:  nnet-factorize [options] <model-in> <model-out>\n"
+      "e.g.:\n"
+      " nnet-factorize --energy=0.95 final.nnet final_lowrank.nnet\n";
+
+    bool binary_write = true;
+    int32 rank = 0;
+    BaseFloat energy = 0.9;
+    std::string components_str;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("rank", &rank, "Rank of the factors (if > 0, else --energy "
+                "chooses it for each layer)");
+    po.Register("energy", &energy, "Fraction of the energy of the singular "
+                "values kept, when --rank is not set");
+    po.Register("components", &components_str, "Colon-separated list of the "
+                "components to factorize (1-based), e.g. 3:5 (default: all "
+                "<AffineTransform>)");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (rank <= 0 && (energy <= 0.0 || energy > 1.0))
+      KALDI_ERR << "--energy must be in (0, 1], not " << energy;
+
+    std::string model_in_filename = po.GetArg(1),
+        model_out_filename = po.GetArg(2);
+
+    std::vector<int32> components;
+    if (!SplitStringToIntegers(components_str, ":", false, &components))
+      KALDI_ERR << "Invalid --components " << components_str;
+
+    Nnet nnet;
+    nnet.Read(model_in_filename);
+
+    Nnet factorized;
+    int32 num_factorized = 0;
+    int64 params_in = 0, params_out = 0;
+    for (int32 c = 0; c < nnet.NumComponents(); c++) {
+      const Component &comp = nnet.GetComponent(c);
+      bool selected = components.empty() ||
+          std::find(components.begin(), components.end(), c + 1) !=
+          components.end();
+      if (comp.GetType() != Component::kAffineTransform || !selected) {
+        if (!components.empty() && selected)
+          KALDI_WARN << "Component " << c + 1 << " is not an "
+                     << "<AffineTransform>, it is kept as it is";
+        factorized.AppendComponent(comp);
+        continue;
+      }
+      const AffineTransform &aff = dynamic_cast<const AffineTransform&>(comp);
+      int32 dim_out = aff.OutputDim(), dim_in = aff.InputDim(),
+          dim_min = std::min(dim_out, dim_in);
+      Matrix<BaseFloat> W(aff.GetLinearity()), U(dim_out, dim_min),
+          Vt(dim_min, dim_in);
+      Vector<BaseFloat> s(dim_min);
+      W.Svd(&s, &U, &Vt);
+      SortSvd(&s, &U, &Vt);
+      int32 k = ChooseRank(s, rank, energy);
+      params_in += dim_out * dim_in;
+      if (k * (dim_in + dim_out) >= dim_out * dim_in) {
+        KALDI_LOG << "Component " << c + 1 << " " << dim_in << " -> "
+                  << dim_out << ", rank " << k << " would not be smaller, "
+                  << "kept";
+        factorized.AppendComponent(comp);
+        params_out += dim_out * dim_in;
+        continue;
+      }
+      Vector<BaseFloat> s_kept(s.Range(0, k));
+      KALDI_LOG << "Component " << c + 1 << " " << dim_in << " -> " << dim_out
+                << ", rank " << k << ", energy kept "
+                << (VecVec(s_kept, s_kept) / VecVec(s, s)) << ", "
+                << (dim_out * dim_in) << " weights to "
+                << k * (dim_in + dim_out);
+      AppendFactors(U, s, Vt, aff.GetBias(), k, &factorized);
+      params_out += k * (dim_in + dim_out);
+      num_factorized++;
+    }
+    if (num_factorized == 0)
+      KALDI_WARN << "No <AffineTransform> in " << model_in_filename
+                 << " was factorized";
+    KALDI_LOG << "Factorized " << num_factorized << " components, "
+              << params_in << " weights to " << params_out << " ("
+              << (params_in > 0 ? 100.0 * params_out / params_in : 100.0)
+              << "%)";
+
+    {
+      Output ko(model_out_filename, binary_write);
+      factorized.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Written factorized 'nnet1' to " << model_out_filename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -18,14 +18,150 @@
 // limitations under the License.
 
 #include <limits>
+#include <mutex>
+#include <vector>
 
+#include "nnet/nnet-inference-plan.h"
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-loss.h"
 #include "nnet/nnet-pdf-prior.h"
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "base/timer.h"
+#include "matrix/matrix-functions.h"
+#include "idlakfeat/utterance-sequencer.h"
 
+namespace kaldi {
+namespace nnet1 {
+
+// A plan of the networks, with the buffers of a forward pass
+class ForwardWorker {
+ public:
+  ForwardWorker(bool apply_log, PdfPrior *pdf_prior):
+    apply_log_(apply_log), pdf_prior_(pdf_prior)
+  { }
+
+  InferencePlan& Plan() { return plan_; }
+
+  void Forward(const std::string &utt, const Matrix<BaseFloat> &mat,
+               Matrix<BaseFloat> *nnet_out_host) {
+    if (!KALDI_ISFINITE(mat.Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in features for " << utt;
+    }
+
+    // push it to gpu,
+    feats_ = mat;
+
+    // fwd-pass, feature transform and nnet,
+    plan_.Feedforward(feats_, &nnet_out_);
+    if (!KALDI_ISFINITE(nnet_out_.Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in nn-output for " << utt;
+    }
+
+    // convert posteriors to log-posteriors,
+    if (apply_log_) {
+      if (!(nnet_out_.Min() >= 0.0 && nnet_out_.Max() <= 1.0)) {
+        KALDI_WARN << "Applying 'log()' to data which don't seem to be "
+                   << "probabilities," << utt;
+      }
+      nnet_out_.Add(1e-20);  // avoid log(0),
+      nnet_out_.ApplyLog();
+    }
+
+    // subtract log-priors from log-posteriors or pre-softmax,
+    if (pdf_prior_ != NULL) {
+      pdf_prior_->SubtractOnLogpost(&nnet_out_);
+    }
+
+    // download from GPU,
+    nnet_out_host->Resize(nnet_out_.NumRows(), nnet_out_.NumCols(),
+                          kUndefined);
+    nnet_out_.CopyToMat(nnet_out_host);
+
+    if (!KALDI_ISFINITE(nnet_out_host->Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in final output nn-output for " << utt;
+    }
+  }
+
+ private:
+  InferencePlan plan_;
+  bool apply_log_;
+  PdfPrior *pdf_prior_;  // not owned, NULL for none
+  CuMatrix<BaseFloat> feats_, nnet_out_;
+};
+
+// The workers not being used by a thread. There is one per thread, as the
+// sequencer runs no more than --num-threads tasks at once.
+class WorkerPool {
+ public:
+  ~WorkerPool() {
+    for (size_t i = 0; i < free_.size(); i++) delete free_[i];
+  }
+  /// Takes ownership of worker
+  void Release(ForwardWorker *worker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(worker);
+  }
+  ForwardWorker* Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    KALDI_ASSERT(!free_.empty());
+    ForwardWorker *worker = free_.back();
+    free_.pop_back();
+    return worker;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<ForwardWorker*> free_;
+};
+
+// The forward pass of one utterance, written in the order read
+class ForwardTask {
+ public:
+  ForwardTask(const std::string &utt, const Matrix<BaseFloat> &mat,
+              WorkerPool *pool, BaseFloatMatrixWriter *feature_writer,
+              int32 *num_done, int64 *tot_t, Timer *time):
+    utt_(utt), mat_(mat), pool_(pool), feature_writer_(feature_writer),
+    num_done_(num_done), tot_t_(tot_t), time_(time)
+  { }
+
+  void Compute() {
+    ForwardWorker *worker = pool_->Acquire();
+    try {
+      worker->Forward(utt_, mat_, &nnet_out_);
+    } catch(...) {
+      pool_->Release(worker);
+      throw;
+    }
+    pool_->Release(worker);
+  }
+
+  void Output() {
+    feature_writer_->Write(utt_, nnet_out_);
+    // progress log,
+    if (*num_done_ % 100 == 0) {
+      double time_now = time_->Elapsed();
+      KALDI_VLOG(1) << "After " << *num_done_ << " utterances: time elapsed = "
+                    << time_now/60 << " min; processed " << *tot_t_/time_now
+                    << " frames per second.";
+    }
+    (*num_done_)++;
+    *tot_t_ += mat_.NumRows();
+  }
+
+ private:
+  std::string utt_;
+  Matrix<BaseFloat> mat_, nnet_out_;
+  WorkerPool *pool_;
+  BaseFloatMatrixWriter *feature_writer_;
+  int32 *num_done_;
+  int64 *tot_t_;
+  Timer *time_;
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
@@ -33,6 +169,10 @@ int main(int argc, char *argv[]) {
   try {
     const char *usage =
       "Perform forward pass through Neural Network.\n"
+      "On the CPU, --num-threads runs utterances in parallel, the threads\n"
+      "sharing the weights of the network, the output in the input order.\n"
+      "<nnet1-in> may also be a plan packed by nnet-pack, which has the\n"
+      "feature transform and --no-softmax in it already.\n"
       "Usage: nnet-forward [options] <nnet1-in> <feature-rspecifier> <feature-wspecifier>\n"
       "e.g.: nnet-forward final.nnet ark:input.ark ark:output.ark\n";
 
@@ -60,6 +200,11 @@ int main(int argc, char *argv[]) {
     std::string use_gpu="no";
     po.Register("use-gpu", &use_gpu,
         "yes|no|optional, only has effect if compiled with CUDA");
+    RegisterCuGemmOptions(&po);
+
+    // --num-threads and --num-threads-total,
+    TaskSequencerConfig sequencer_config;
+    sequencer_config.Register(&po);
 
     using namespace kaldi;
     using namespace kaldi::nnet1;
@@ -79,26 +224,39 @@ int main(int argc, char *argv[]) {
     // Select the GPU
 #if HAVE_CUDA == 1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
+    if (CuDevice::Instantiate().Enabled() && sequencer_config.num_threads > 1)
+      KALDI_ERR << "--num-threads is for the CPU, use --use-gpu=no";
 #endif
 
+    // a packed plan is loaded as it is,
+    bool binary_model;
+    Input model_input(model_filename, &binary_model);
+    bool packed = InferencePlan::IsPlan(model_input.Stream(), binary_model);
+    if (packed && (feature_transform != "" || no_softmax))
+      KALDI_ERR << model_filename << " is packed, give --feature-transform "
+                << "and --no-softmax to nnet-pack";
+
     Nnet nnet_transf;
     if (feature_transform != "") {
       nnet_transf.Read(feature_transform);
     }
 
     Nnet nnet;
-    nnet.Read(model_filename);
-    // optionally remove softmax,
-    Component::ComponentType last_comp_type = nnet.GetLastComponent().GetType();
-    if (no_softmax) {
-      if (last_comp_type == Component::kSoftmax ||
-          last_comp_type == Component::kBlockSoftmax) {
-        KALDI_LOG << "Removing " << Component::TypeToMarker(last_comp_type)
-                  << " from the nnet " << model_filename;
-        nnet.RemoveLastComponent();
-      } else {
-        KALDI_WARN << "Last component 'NOT-REMOVED' by --no-softmax=true, "
-          << "the component was " << Component::TypeToMarker(last_comp_type);
+    if (!packed) {
+      nnet.Read(model_input.Stream(), binary_model);
+      // optionally remove softmax,
+      Component::ComponentType last_comp_type =
+          nnet.GetLastComponent().GetType();
+      if (no_softmax) {
+        if (last_comp_type == Component::kSoftmax ||
+            last_comp_type == Component::kBlockSoftmax) {
+          KALDI_LOG << "Removing " << Component::TypeToMarker(last_comp_type)
+                    << " from the nnet " << model_filename;
+          nnet.RemoveLastComponent();
+        } else {
+          KALDI_WARN << "Last component 'NOT-REMOVED' by --no-softmax=true, "
+            << "the component was " << Component::TypeToMarker(last_comp_type);
+        }
       }
     }
 
@@ -116,93 +274,70 @@ int main(int argc, char *argv[]) {
     nnet.SetDropoutRate(0.0);
 
     kaldi::int64 tot_t = 0;
+    int32 num_done = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     BaseFloatMatrixWriter feature_writer(feature_wspecifier);
 
-    CuMatrix<BaseFloat> feats, feats_transf, nnet_out;
-    Matrix<BaseFloat> nnet_out_host;
+    // the transform and network as one, in the order they are applied,
+    Nnet combined;
+    if (!reverse_transform) {
+      combined.AppendNnet(nnet_transf);
+      combined.AppendNnet(nnet);
+    } else {
+      combined.AppendNnet(nnet);
+      combined.AppendNnet(nnet_transf);
+    }
+
+    // a plan per thread, sharing the weights of the first, the BLAS is kept
+    // to one thread each so the threads do not compete for the cores,
+    PdfPrior *pdf_prior_ptr =
+        (prior_opts.class_frame_counts != "" ? &pdf_prior : NULL);
+    int32 num_threads = std::max(1, sequencer_config.num_threads);
+    WorkerPool pool;
+    ForwardWorker *first = new ForwardWorker(apply_log, pdf_prior_ptr);
+    if (packed)
+      first->Plan().Read(model_input.Stream(), binary_model);
+    else
+      first->Plan().Init(combined);
+    model_input.Close();
+    KALDI_VLOG(1) << "Inference plan:\n" << first->Plan().Info();
+    for (int32 i = 1; i < num_threads; i++) {
+      ForwardWorker *worker = new ForwardWorker(apply_log, pdf_prior_ptr);
+      worker->Plan().ShareParams(first->Plan());
+      pool.Release(worker);
+    }
+    pool.Release(first);
+    if (num_threads > 1)
+      KALDI_LOG << num_threads << " threads share "
+                << first->Plan().SharedParamsSizeInBytes()
+                << " bytes of weights";
+    if (num_threads > 1 && !SetBlasNumThreads(1))
+      KALDI_VLOG(1) << "This BLAS cannot be set to one thread, use a single "
+                    << "threaded build with --num-threads";
 
     Timer time;
-    double time_now = 0;
-    int32 num_done = 0;
 
     // main loop,
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      // read
-      Matrix<BaseFloat> mat = feature_reader.Value();
-      std::string utt = feature_reader.Key();
-      KALDI_VLOG(2) << "Processing utterance " << num_done+1
-                    << ", " << utt
-                    << ", " << mat.NumRows() << "frm";
-
-
-      if (!KALDI_ISFINITE(mat.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in features for " << utt;
-      }
-
-      // push it to gpu,
-      feats = mat;
-
-      // fwd-pass, feature transform,
-      if (!reverse_transform) {
-          nnet_transf.Feedforward(feats, &feats_transf);
-          if (!KALDI_ISFINITE(feats_transf.Sum())) {  // check there's no nan/inf,
-              KALDI_ERR << "NaN or inf found in transformed-features for " << utt;
-          }
-
-          // fwd-pass, nnet,
-          nnet.Feedforward(feats_transf, &nnet_out);
-          if (!KALDI_ISFINITE(nnet_out.Sum())) {  // check there's no nan/inf,
-              KALDI_ERR << "NaN or inf found in nn-output for " << utt;
-          }
-      }
-      else {
-          nnet.Feedforward(feats, &feats_transf);
-          if (!KALDI_ISFINITE(feats_transf.Sum())) {  // check there's no nan/inf,
-              KALDI_ERR << "NaN or inf found in transformed-features for " << utt;
-          }
-
-          // fwd-pass, nnet,
-          nnet_transf.Feedforward(feats_transf, &nnet_out);
-          if (!KALDI_ISFINITE(nnet_out.Sum())) {  // check there's no nan/inf,
-              KALDI_ERR << "NaN or inf found in nn-output for " << utt;
-          }
-      }
-
-      // convert posteriors to log-posteriors,
-      if (apply_log) {
-        if (!(nnet_out.Min() >= 0.0 && nnet_out.Max() <= 1.0)) {
-          KALDI_WARN << "Applying 'log()' to data which don't seem to be "
-                     << "probabilities," << utt;
-        }
-        nnet_out.Add(1e-20);  // avoid log(0),
-        nnet_out.ApplyLog();
-      }
-
-      // subtract log-priors from log-posteriors or pre-softmax,
-      if (prior_opts.class_frame_counts != "") {
-        pdf_prior.SubtractOnLogpost(&nnet_out);
-      }
-
-      // download from GPU,
-      nnet_out_host = Matrix<BaseFloat>(nnet_out);
-
-      // write,
-      if (!KALDI_ISFINITE(nnet_out_host.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in final output nn-output for " << utt;
+    if (num_threads == 1) {
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        KALDI_VLOG(2) << "Processing utterance " << num_done+1
+                      << ", " << feature_reader.Key()
+                      << ", " << feature_reader.Value().NumRows() << "frm";
+        ForwardTask task(feature_reader.Key(), feature_reader.Value(), &pool,
+                         &feature_writer, &num_done, &tot_t, &time);
+        task.Compute();
+        task.Output();
       }
-      feature_writer.Write(feature_reader.Key(), nnet_out_host);
-
-      // progress log,
-      if (num_done % 100 == 0) {
-        time_now = time.Elapsed();
-        KALDI_VLOG(1) << "After " << num_done << " utterances: time elapsed = "
-                      << time_now/60 << " min; processed " << tot_t/time_now
-                      << " frames per second.";
+    } else {
+      UtteranceSequencer<ForwardTask> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        sequencer.Run(new ForwardTask(feature_reader.Key(),
+                                      feature_reader.Value(), &pool,
+                                      &feature_writer, &num_done, &tot_t,
+                                      &time));
       }
-      num_done++;
-      tot_t += mat.NumRows();
+      sequencer.Wait();
     }
 
     // final message,
@@ -0,0 +1,107 @@
+// nnetbin/nnet-pack.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet/nnet-nnet.h"
+#include "nnet/nnet-inference-plan.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet1;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+      "Compile a network (with its feature transform) for inference and\n"
+      "write the compiled plan: the shifts and scales folded into the\n"
+      "weights and the activations fused, as nnet-forward would compute\n"
+      "them at each start. nnet-forward loads the packed plan as it is.\n"
+      "It cannot be trained further; keep the network for that.\n"
+      "Usage:  nnet-pack [options] <model-in> <packed-out>\n"
+      "e.g.:\n"
+      " nnet-pack --feature-transform=final.feature_transform final.nnet "
+      "final.packed\n";
+
+    bool binary_write = true;
+    std::string feature_transform;
+    bool reverse_transform = false, no_softmax = false;
+    int32 block_rows = 256;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("feature-transform", &feature_transform,
+        "Feature transform in front of main network (in nnet format)");
+    po.Register("reverse-transform", &reverse_transform,
+        "Feature transform applied in reverse on output");
+    po.Register("no-softmax", &no_softmax,
+        "Removes the last component with Softmax, if found");
+    po.Register("block-rows", &block_rows, "Rows the CPU runs through the "
+                "fused layers at a time");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_in_filename = po.GetArg(1),
+        model_out_filename = po.GetArg(2);
+
+    Nnet nnet_transf;
+    if (feature_transform != "") nnet_transf.Read(feature_transform);
+    Nnet nnet;
+    nnet.Read(model_in_filename);
+    if (no_softmax) {
+      Component::ComponentType type = nnet.GetLastComponent().GetType();
+      if (type == Component::kSoftmax || type == Component::kBlockSoftmax) {
+        KALDI_LOG << "Removing " << Component::TypeToMarker(type)
+                  << " from the nnet " << model_in_filename;
+        nnet.RemoveLastComponent();
+      } else {
+        KALDI_WARN << "Last component 'NOT-REMOVED' by --no-softmax=true, "
+          << "the component was " << Component::TypeToMarker(type);
+      }
+    }
+    nnet_transf.SetDropoutRate(0.0);
+    nnet.SetDropoutRate(0.0);
+
+    Nnet combined;
+    if (!reverse_transform) {
+      combined.AppendNnet(nnet_transf);
+      combined.AppendNnet(nnet);
+    } else {
+      combined.AppendNnet(nnet);
+      combined.AppendNnet(nnet_transf);
+    }
+    InferencePlan plan;
+    plan.Init(combined, block_rows);
+    KALDI_LOG << "Compiled " << combined.NumComponents() << " components into "
+              << plan.NumOps() << " operations:\n" << plan.Info();
+
+    plan.Write(model_out_filename, binary_write);
+    KALDI_LOG << "Written packed plan to " << model_out_filename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,157 @@
+// nnetbin/nnet-quantize.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet/nnet-nnet.h"
+#include "nnet/nnet-quantized-affine-transform.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// Size of the network as written in binary
+static size_t NnetSizeInBytes(const Nnet &nnet) {
+  std::ostringstream os;
+  nnet.Write(os, true);
+  return os.str().size();
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet1;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+      "Quantize the weights of the <AffineTransform> and <LinearTransform>\n"
+      "components of a network for inference, to int8 with a scale per row\n"
+      "or to fp16. The quantized network cannot be trained further.\n"
+      "With --compare-feats the quantized and original networks are run on\n"
+      "the features and the error of each output dimension is reported,\n"
+      "relative to its standard deviation; for an acoustic model these are\n"
+      "the normalised MCEP, F0 and BAP streams it generates.\n"
+      "Usage:  nnet-quantize [options] <model-in> <model-out>\n"
+      "e.g.:\n"
+      " nnet-quantize --method=int8 --compare-feats=scp:dev/feats.scp "
+      "final.nnet final_int8.nnet\n";
+
+    bool binary_write = true;
+    std::string method_str = "int8";
+    std::string compare_feats, feature_transform;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("method", &method_str, "How to store the weights, "
+                "int8 (a quarter of the memory) or fp16 (half)");
+    po.Register("compare-feats", &compare_feats, "Features (rspecifier) to "
+                "report the error of the quantized network on");
+    po.Register("feature-transform", &feature_transform, "Feature transform "
+                "applied to --compare-feats before both networks");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_in_filename = po.GetArg(1),
+        model_out_filename = po.GetArg(2);
+    QuantizationMethod method = QuantizationMethodFromString(method_str);
+
+    Nnet nnet;
+    nnet.Read(model_in_filename);
+    Nnet quantized(nnet);
+    int32 num_quantized = QuantizeAffineTransforms(method, &quantized);
+    if (num_quantized == 0)
+      KALDI_WARN << "No <AffineTransform> or <LinearTransform> in "
+                 << model_in_filename << ", nothing quantized";
+    size_t size_in = NnetSizeInBytes(nnet),
+        size_out = NnetSizeInBytes(quantized);
+    KALDI_LOG << "Quantized " << num_quantized << " components to "
+              << method_str << ", " << size_in << " bytes to " << size_out
+              << " (" << (100.0 * size_out / size_in) << "%)";
+
+    if (!compare_feats.empty()) {
+      Nnet nnet_transf;
+      if (!feature_transform.empty()) nnet_transf.Read(feature_transform);
+      nnet.SetDropoutRate(0.0);
+      quantized.SetDropoutRate(0.0);
+
+      int32 dim = nnet.OutputDim(), num_utts = 0;
+      int64 num_frames = 0;
+      // per output dimension
+      Vector<double> sum(dim), sumsq(dim), err_sumsq(dim), err_max(dim);
+      SequentialBaseFloatMatrixReader feature_reader(compare_feats);
+      CuMatrix<BaseFloat> feats, feats_transf, out, quant_out;
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        feats = feature_reader.Value();
+        nnet_transf.Feedforward(feats, &feats_transf);
+        nnet.Feedforward(feats_transf, &out);
+        quantized.Feedforward(feats_transf, &quant_out);
+        Matrix<BaseFloat> ref(out), err(quant_out);
+        err.AddMat(-1.0, ref);
+        for (int32 r = 0; r < ref.NumRows(); r++) {
+          for (int32 d = 0; d < dim; d++) {
+            sum(d) += ref(r, d);
+            sumsq(d) += ref(r, d) * ref(r, d);
+            err_sumsq(d) += err(r, d) * err(r, d);
+            err_max(d) = std::max<double>(err_max(d), std::abs(err(r, d)));
+          }
+        }
+        num_frames += ref.NumRows();
+        num_utts++;
+      }
+      if (num_frames == 0) KALDI_ERR << "No frames in " << compare_feats;
+
+      std::ostringstream report;
+      report << "dim rmse max-abs-error rmse/stddev";
+      double total_err = 0.0, total_var = 0.0;
+      for (int32 d = 0; d < dim; d++) {
+        double mean = sum(d) / num_frames,
+            var = std::max(sumsq(d) / num_frames - mean * mean, 0.0),
+            mse = err_sumsq(d) / num_frames;
+        report << "\n" << d << " " << std::sqrt(mse) << " " << err_max(d)
+               << " " << (var > 0.0 ? std::sqrt(mse / var) : 0.0);
+        total_err += mse;
+        total_var += var;
+      }
+      KALDI_LOG << "Error of the quantized network over " << num_utts
+                << " utterances, " << num_frames << " frames:\n"
+                << report.str();
+      KALDI_LOG << "Overall rmse/stddev " << (total_var > 0.0 ?
+                   std::sqrt(total_err / total_var) : 0.0);
+    }
+
+    {
+      Output ko(model_out_filename, binary_write);
+      quantized.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Written quantized 'nnet1' to " << model_out_filename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -17,15 +17,81 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+#include <mutex>
+
 #include "nnet/nnet-trnopts.h"
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-loss.h"
 #include "nnet/nnet-randomizer.h"
+#include "nnet/nnet-background-loader.h"
+#include "nnet/nnet-various.h"
+#include "nnet/nnet-data-parallel.h"
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "base/timer.h"
 #include "cudamatrix/cu-device.h"
 
+namespace kaldi {
+namespace nnet1 {
+
+// An utterance ready for the randomizers, transformed and on the GPU,
+struct TrainingUtterance {
+  CuMatrix<BaseFloat> feats;
+  PosteriorCsr targets;
+  Vector<BaseFloat> weights;
+  // with --splice-minibatches, the rows of 'feats' that are trained on,
+  std::vector<int32> frames;
+};
+
+// A mini-batch of a replica, and its buffers,
+struct Minibatch {
+  const CuMatrixBase<BaseFloat> *nnet_in;  // 'feats', or the randomizer's,
+  CuMatrix<BaseFloat> feats;
+  PosteriorCsr nnet_tgt;
+  Vector<BaseFloat> frm_weights;
+  CuMatrix<BaseFloat> nnet_out, obj_diff;
+};
+
+// Splits a feature transform at its <Splice>, when the components around
+// it each transform a frame on its own (so it makes no difference whether
+// they run on utterances or on mini-batches), false if it is not so,
+static bool SplitAtSplice(const Nnet &transf, Nnet *before,
+                          std::vector<int32> *offsets, Nnet *after) {
+  int32 splice = -1;
+  for (int32 c = 0; c < transf.NumComponents(); c++) {
+    switch (transf.GetComponent(c).GetType()) {
+      case Component::kSplice:
+        if (splice != -1) return false;
+        splice = c;
+        break;
+      case Component::kAddShift:
+      case Component::kRescale:
+      case Component::kAffineTransform:
+      case Component::kLinearTransform:
+      case Component::kCopy:
+      case Component::kSigmoid:
+      case Component::kTanh:
+        break;
+      default:
+        return false;
+    }
+  }
+  if (splice == -1) return false;
+  before->Destroy();
+  after->Destroy();
+  for (int32 c = 0; c < transf.NumComponents(); c++) {
+    if (c < splice) before->AppendComponent(transf.GetComponent(c));
+    if (c > splice) after->AppendComponent(transf.GetComponent(c));
+  }
+  dynamic_cast<const Splice&>(transf.GetComponent(splice)).
+    GetFrameOffsets(offsets);
+  return true;
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   using namespace kaldi;
   using namespace kaldi::nnet1;
@@ -87,6 +153,26 @@ int main(int argc, char *argv[]) {
     std::string use_gpu="yes";
     po.Register("use-gpu", &use_gpu,
         "yes|no|optional, only has effect if compiled with CUDA");
+    RegisterCuGemmOptions(&po);
+
+    bool background_load = true;
+    po.Register("background-load", &background_load,
+        "Read and transform the features for the next fill of the "
+        "randomizer on a thread of its own, while training on this one "
+        "(holds up to --randomizer-size more frames on the GPU)");
+
+    bool splice_minibatches = true;
+    po.Register("splice-minibatches", &splice_minibatches,
+        "When the feature transform has a <Splice> among per-frame "
+        "components, keep the frames unspliced in the randomizer and "
+        "splice each mini-batch from them (the randomizer then holds "
+        "1/(number of offsets) of the memory)");
+
+    int32 num_replicas = 1;
+    po.Register("num-replicas", &num_replicas,
+        "Train this many copies of the network on mini-batches of their own "
+        "at once (on threads sharing the GPU, or on the CPU cores), summing "
+        "their updates after each (as one mini-batch of all their frames)");
 
     po.Read(argc, argv);
 
@@ -110,6 +196,8 @@ int main(int argc, char *argv[]) {
 
 #if HAVE_CUDA == 1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
+    if (background_load || num_replicas > 1)
+      CuDevice::Instantiate().AllowMultithreading();
 #endif
 
     Nnet nnet_transf;
@@ -117,19 +205,36 @@ int main(int argc, char *argv[]) {
       nnet_transf.Read(feature_transform);
     }
 
+    // with --splice-minibatches, 'nnet_transf' is what runs before the
+    // <Splice>, and 'nnet_transf_minibatch' what runs after it,
+    Nnet nnet_transf_minibatch;
+    std::vector<int32> splice_offsets;
+    if (splice_minibatches) {
+      Nnet transf_before;
+      splice_minibatches = SplitAtSplice(nnet_transf, &transf_before,
+                                         &splice_offsets,
+                                         &nnet_transf_minibatch);
+      if (splice_minibatches) {
+        nnet_transf = transf_before;
+        KALDI_LOG << "Splicing the mini-batches with " << splice_offsets.size()
+                  << " offsets, the randomizer holds the frames unspliced";
+      }
+    }
+
     Nnet nnet;
     nnet.Read(model_filename);
     nnet.SetTrainOptions(trn_opts);
 
     if (crossvalidate) {
       nnet_transf.SetDropoutRate(0.0);
+      nnet_transf_minibatch.SetDropoutRate(0.0);
       nnet.SetDropoutRate(0.0);
     }
 
     kaldi::int64 total_frames = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-    RandomAccessPosteriorReader targets_reader(targets_rspecifier);
+    RandomAccessPosteriorCsrReader targets_reader(targets_rspecifier);
     RandomAccessBaseFloatVectorReader weights_reader;
     if (frame_weights != "") {
       weights_reader.Open(frame_weights);
@@ -141,7 +246,10 @@ int main(int argc, char *argv[]) {
 
     RandomizerMask randomizer_mask(rnd_opts);
     MatrixRandomizer feature_randomizer(rnd_opts);
-    PosteriorRandomizer targets_randomizer(rnd_opts);
+    SplicedMatrixRandomizer spliced_randomizer;
+    spliced_randomizer.Init(rnd_opts, splice_offsets.empty() ?
+                            std::vector<int32>(1, 0) : splice_offsets);
+    PosteriorCsrRandomizer targets_randomizer(rnd_opts);
     VectorRandomizer weights_randomizer(rnd_opts);
 
     Xent xent(loss_opts);
@@ -157,7 +265,46 @@ int main(int argc, char *argv[]) {
       multitask.InitFromString(objective_function);
     }
 
-    CuMatrix<BaseFloat> feats_transf, nnet_out, obj_diff;
+    CuMatrix<BaseFloat> feats_minibatch;
+
+    // the replicas, which train on the mini-batches at once,
+    KALDI_ASSERT(num_replicas > 0);
+    std::unique_ptr<DataParallelTrainer> trainer;
+    if (num_replicas > 1) {
+      trainer.reset(new DataParallelTrainer(nnet, num_replicas));
+      KALDI_LOG << "Training " << num_replicas << " replicas of the network";
+    }
+    std::vector<Minibatch> minibatches(num_replicas);
+    // the losses gather statistics, they are evaluated one at a time,
+    std::mutex loss_mutex;
+    auto train_minibatch = [&](int32 r, Nnet *nnet) {
+      Minibatch &mb = minibatches[r];
+      // forward pass,
+      nnet->Propagate(*mb.nnet_in, &mb.nnet_out);
+
+      // evaluate objective function we've chosen,
+      {
+        std::lock_guard<std::mutex> lock(loss_mutex);
+        if (objective_function == "xent") {
+          // gradients re-scaled by weights in Eval,
+          xent.Eval(mb.frm_weights, mb.nnet_out, mb.nnet_tgt, &mb.obj_diff);
+        } else if (objective_function == "mse") {
+          // gradients re-scaled by weights in Eval,
+          mse.Eval(mb.frm_weights, mb.nnet_out, mb.nnet_tgt, &mb.obj_diff);
+        } else if (0 == objective_function.compare(0, 9, "multitask")) {
+          // gradients re-scaled by weights in Eval,
+          multitask.Eval(mb.frm_weights, mb.nnet_out, mb.nnet_tgt,
+                         &mb.obj_diff);
+        } else {
+          KALDI_ERR << "Unknown objective function code : " << objective_function;
+        }
+      }
+
+      if (!crossvalidate) {
+        // back-propagate, and do the update,
+        nnet->Backpropagate(mb.obj_diff, NULL);
+      }
+    };
 
     Timer time, time_io;
     KALDI_LOG << (crossvalidate ? "CROSS-VALIDATION" : "TRAINING")
@@ -169,20 +316,11 @@ int main(int argc, char *argv[]) {
 
     double time_io_accu = 0.0;
 
-    // main loop,
-    while (!feature_reader.Done()) {
-#if HAVE_CUDA == 1
-      // check that GPU computes accurately,
-      CuDevice::Instantiate().CheckGpuHealth();
-#endif
-      // fill the randomizer,
-      time_io.Reset();
+    // reads the next utterance that can be trained on, false at the end,
+    // (on the loader thread with --background-load)
+    CuMatrix<BaseFloat> feats_transf;
+    auto read_utterance = [&](TrainingUtterance *out) -> bool {
       for ( ; !feature_reader.Done(); feature_reader.Next()) {
-        if (feature_randomizer.IsFull()) {
-          // break the loop without calling Next(),
-          // we keep the 'utt' for next round,
-          break;
-        }
         std::string utt = feature_reader.Key();
         KALDI_VLOG(3) << "Reading " << utt;
         // check that we have targets,
@@ -205,9 +343,10 @@ int main(int argc, char *argv[]) {
         }
         // get feature / target pair,
         Matrix<BaseFloat> mat = feature_reader.Value();
-        Posterior targets = targets_reader.Value(utt);
+        PosteriorCsr &targets = out->targets;
+        targets = targets_reader.Value(utt);
         // get per-frame weights,
-        Vector<BaseFloat> weights;
+        Vector<BaseFloat> &weights = out->weights;
         if (frame_weights != "") {
           weights = weights_reader.Value(utt);
         } else {  // all per-frame weights are 1.0,
@@ -222,10 +361,6 @@ int main(int argc, char *argv[]) {
           weights.Scale(w);
         }
 
-        // accumulate the I/O time,
-        time_io_accu += time_io.Elapsed();
-        time_io.Reset(); // to be sure we don't count 2x,
-
         // skip too long utterances (or we run out of memory),
         if (mat.NumRows() > max_frames) {
           KALDI_WARN << "Utterance too long, skipping! " << utt
@@ -240,7 +375,7 @@ int main(int argc, char *argv[]) {
           // add lengths to vector,
           std::vector<int32> length;
           length.push_back(mat.NumRows());
-          length.push_back(targets.size());
+          length.push_back(targets.NumFrames());
           length.push_back(weights.Dim());
           // find min, max,
           int32 min = *std::min_element(length.begin(), length.end());
@@ -249,10 +384,10 @@ int main(int argc, char *argv[]) {
           if (max - min < length_tolerance) {
             // we truncate to shortest,
             if (mat.NumRows() != min) mat.Resize(min, mat.NumCols(), kCopyData);
-            if (targets.size() != min) targets.resize(min);
+            if (targets.NumFrames() != min) targets.Truncate(min);
             if (weights.Dim() != min) weights.Resize(min, kCopyData);
           } else {
-            KALDI_WARN << "Length mismatch! Targets " << targets.size()
+            KALDI_WARN << "Length mismatch! Targets " << targets.NumFrames()
                        << ", features " << mat.NumRows() << ", " << utt;
             num_other_error++;
             continue;
@@ -262,13 +397,15 @@ int main(int argc, char *argv[]) {
         nnet_transf.Feedforward(CuMatrix<BaseFloat>(mat), &feats_transf);
 
         // remove frames with '0' weight from training,
+        // (with --splice-minibatches the frames stay as context)
+        std::vector<MatrixIndexT> &keep_frames = out->frames;
+        keep_frames.clear();
         {
           // are there any frames to be removed? (frames with zero weight),
           BaseFloat weight_min = weights.Min();
           KALDI_ASSERT(weight_min >= 0.0);
           if (weight_min == 0.0) {
             // create vector with frame-indices to keep,
-            std::vector<MatrixIndexT> keep_frames;
             for (int32 i = 0; i < weights.Dim(); i++) {
               if (weights(i) > 0.0) {
                 keep_frames.push_back(i);
@@ -279,16 +416,16 @@ int main(int argc, char *argv[]) {
             if (keep_frames.size() == 0) continue;
 
             // filter feature-frames,
-            CuMatrix<BaseFloat> tmp_feats(keep_frames.size(), feats_transf.NumCols());
-            tmp_feats.CopyRows(feats_transf, CuArray<MatrixIndexT>(keep_frames));
-            tmp_feats.Swap(&feats_transf);
+            if (!splice_minibatches) {
+              CuMatrix<BaseFloat> tmp_feats(keep_frames.size(), feats_transf.NumCols());
+              tmp_feats.CopyRows(feats_transf, CuArray<MatrixIndexT>(keep_frames));
+              tmp_feats.Swap(&feats_transf);
+            }
 
             // filter targets,
-            Posterior tmp_targets;
-            for (int32 i = 0; i < keep_frames.size(); i++) {
-              tmp_targets.push_back(targets[keep_frames[i]]);
-            }
-            tmp_targets.swap(targets);
+            PosteriorCsr tmp_targets;
+            tmp_targets.CopyRows(targets, keep_frames);
+            tmp_targets.Swap(&targets);
 
             // filter weights,
             Vector<BaseFloat> tmp_weights(keep_frames.size());
@@ -296,100 +433,174 @@ int main(int argc, char *argv[]) {
               tmp_weights(i) = weights(keep_frames[i]);
             }
             tmp_weights.Swap(&weights);
+          } else if (splice_minibatches) {
+            for (int32 i = 0; i < weights.Dim(); i++) keep_frames.push_back(i);
           }
         }
-
-        // pass data to randomizers,
-        KALDI_ASSERT(feats_transf.NumRows() == targets.size());
-        feature_randomizer.AddData(feats_transf);
-        targets_randomizer.AddData(targets);
-        weights_randomizer.AddData(weights);
+        KALDI_ASSERT((splice_minibatches ? keep_frames.size() :
+                      feats_transf.NumRows()) == targets.NumFrames());
+        out->feats.Swap(&feats_transf);
+#if HAVE_CUDA == 1
+        // the copies and transform ran on this thread's stream, finish them
+        // before the trainer's stream reads the features,
+        if (CuDevice::Instantiate().Enabled())
+          CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+#endif
         num_done++;
+        feature_reader.Next();
+        return true;
+      }
+      return false;
+    };
+
+    // the loader queues up to a fill of the randomizer, (it is stopped
+    // before the readers it uses are destroyed)
+    std::unique_ptr<BackgroundLoader<TrainingUtterance> > loader;
+    if (background_load)
+      loader.reset(new BackgroundLoader<TrainingUtterance>(read_utterance,
+          [](const TrainingUtterance &u) -> int64 { return u.feats.NumRows(); },
+          rnd_opts.randomizer_size));
 
-        time_io.Reset(); // reset before reading next feature matrix,
+    // main loop,
+    bool more_data = true;
+    while (more_data) {
+#if HAVE_CUDA == 1
+      // check that GPU computes accurately,
+      CuDevice::Instantiate().CheckGpuHealth();
+#endif
+      // fill the randomizer,
+      int32 num_added = 0;
+      while (!(splice_minibatches ? spliced_randomizer.IsFull() :
+               feature_randomizer.IsFull())) {
+        // the time spent waiting for data is the I/O time,
+        time_io.Reset();
+        TrainingUtterance *u = NULL;
+        if (loader) {
+          u = loader->Next();
+        } else {
+          u = new TrainingUtterance;
+          if (!read_utterance(u)) {
+            delete u;
+            u = NULL;
+          }
+        }
+        time_io_accu += time_io.Elapsed();
+        if (u == NULL) {
+          more_data = false;
+          break;
+        }
+        // pass data to randomizers,
+        if (splice_minibatches)
+          spliced_randomizer.AddData(u->feats, u->frames);
+        else
+          feature_randomizer.AddData(u->feats);
+        targets_randomizer.AddData(u->targets);
+        weights_randomizer.AddData(u->weights);
+        delete u;
+        num_added++;
       }
+      if (num_added == 0) break;
 
       // randomize,
       if (!crossvalidate && randomize) {
         const std::vector<int32>& mask =
-          randomizer_mask.Generate(feature_randomizer.NumFrames());
-        feature_randomizer.Randomize(mask);
+          randomizer_mask.Generate(targets_randomizer.NumFrames());
+        if (splice_minibatches)
+          spliced_randomizer.Randomize(mask);
+        else
+          feature_randomizer.Randomize(mask);
         targets_randomizer.Randomize(mask);
         weights_randomizer.Randomize(mask);
       }
 
-      // train with data from randomizers (using mini-batches),
-      for ( ; !feature_randomizer.Done(); feature_randomizer.Next(),
-                                          targets_randomizer.Next(),
-                                          weights_randomizer.Next()) {
-        // get block of feature/target pairs,
-        const CuMatrixBase<BaseFloat>& nnet_in = feature_randomizer.Value();
-        const Posterior& nnet_tgt = targets_randomizer.Value();
-        const Vector<BaseFloat>& frm_weights = weights_randomizer.Value();
-
-        // forward pass,
-        nnet.Propagate(nnet_in, &nnet_out);
-
-        // evaluate objective function we've chosen,
-        if (objective_function == "xent") {
-          // gradients re-scaled by weights in Eval,
-          xent.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
-        } else if (objective_function == "mse") {
-          // gradients re-scaled by weights in Eval,
-          mse.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
-        } else if (0 == objective_function.compare(0, 9, "multitask")) {
-          // gradients re-scaled by weights in Eval,
-          multitask.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
-        } else {
-          KALDI_ERR << "Unknown objective function code : " << objective_function;
+      // train with data from randomizers (using mini-batches, one for each
+      // replica at a time),
+      while (!targets_randomizer.Done()) {
+        int32 num_active = 0;
+        for ( ; num_active < num_replicas && !targets_randomizer.Done();
+              num_active++, targets_randomizer.Next(),
+                            weights_randomizer.Next()) {
+          // get block of feature/target pairs,
+          const CuMatrixBase<BaseFloat>* nnet_in_ptr = NULL;
+          if (splice_minibatches) {
+            const CuMatrixBase<BaseFloat>& spliced = spliced_randomizer.Value();
+            spliced_randomizer.Next();
+            if (nnet_transf_minibatch.NumComponents() == 0) {
+              nnet_in_ptr = &spliced;
+            } else {
+              nnet_transf_minibatch.Feedforward(spliced, &feats_minibatch);
+              nnet_in_ptr = &feats_minibatch;
+            }
+          } else {
+            nnet_in_ptr = &feature_randomizer.Value();
+            feature_randomizer.Next();
+          }
+          Minibatch &mb = minibatches[num_active];
+          // the randomizers re-use their buffers, so the mini-batches of
+          // the replicas are copied,
+          if (num_replicas == 1) {
+            mb.nnet_in = nnet_in_ptr;
+          } else {
+            mb.feats = *nnet_in_ptr;
+            mb.nnet_in = &mb.feats;
+          }
+          mb.nnet_tgt = targets_randomizer.Value();
+          mb.frm_weights = weights_randomizer.Value();
         }
 
-        if (!crossvalidate) {
-          // back-propagate, and do the update,
-          nnet.Backpropagate(obj_diff, NULL);
-        }
+        if (trainer)
+          trainer->Step(num_active, train_minibatch);
+        else
+          train_minibatch(0, &nnet);
+        Nnet &nnet_trained = trainer ? trainer->GetReplica(0) : nnet;
 
         // 1st mini-batch : show what happens in network,
         if (total_frames == 0) {
           KALDI_LOG << "### After " << total_frames << " frames,";
-          KALDI_LOG << nnet.InfoPropagate();
+          KALDI_LOG << nnet_trained.InfoPropagate();
           if (!crossvalidate) {
-            KALDI_LOG << nnet.InfoBackPropagate();
-            KALDI_LOG << nnet.InfoGradient();
+            KALDI_LOG << nnet_trained.InfoBackPropagate();
+            KALDI_LOG << nnet_trained.InfoGradient();
           }
         }
 
-        // VERBOSE LOG
-        // monitor the NN training (--verbose=2),
-        if (GetVerboseLevel() >= 2) {
-          static int32 counter = 0;
-          counter += nnet_in.NumRows();
-          // print every 25k frames,
-          if (counter >= 25000) {
-            KALDI_VLOG(2) << "### After " << total_frames << " frames,";
-            KALDI_VLOG(2) << nnet.InfoPropagate();
-            if (!crossvalidate) {
-              KALDI_VLOG(2) << nnet.InfoBackPropagate();
-              KALDI_VLOG(2) << nnet.InfoGradient();
+        for (int32 r = 0; r < num_active; r++) {
+          const CuMatrixBase<BaseFloat>& nnet_in = *minibatches[r].nnet_in;
+
+          // VERBOSE LOG
+          // monitor the NN training (--verbose=2),
+          if (GetVerboseLevel() >= 2) {
+            static int32 counter = 0;
+            counter += nnet_in.NumRows();
+            // print every 25k frames,
+            if (counter >= 25000) {
+              KALDI_VLOG(2) << "### After " << total_frames << " frames,";
+              KALDI_VLOG(2) << nnet_trained.InfoPropagate();
+              if (!crossvalidate) {
+                KALDI_VLOG(2) << nnet_trained.InfoBackPropagate();
+                KALDI_VLOG(2) << nnet_trained.InfoGradient();
+              }
+              counter = 0;
             }
-            counter = 0;
           }
-        }
 
-        total_frames += nnet_in.NumRows();
+          total_frames += nnet_in.NumRows();
+        }
       }
     }  // main loop,
+    loader.reset();
+    const Nnet &nnet_trained = trainer ? trainer->GetNnet() : nnet;
 
     // after last mini-batch : show what happens in network,
     KALDI_LOG << "### After " << total_frames << " frames,";
-    KALDI_LOG << nnet.InfoPropagate();
+    KALDI_LOG << nnet_trained.InfoPropagate();
     if (!crossvalidate) {
-      KALDI_LOG << nnet.InfoBackPropagate();
-      KALDI_LOG << nnet.InfoGradient();
+      KALDI_LOG << nnet_trained.InfoBackPropagate();
+      KALDI_LOG << nnet_trained.InfoGradient();
     }
 
     if (!crossvalidate) {
-      nnet.Write(target_model_filename, binary);
+      nnet_trained.Write(target_model_filename, binary);
     }
 
     KALDI_LOG << "Done " << num_done << " files, "
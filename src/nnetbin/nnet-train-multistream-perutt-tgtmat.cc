@@ -21,7 +21,7 @@
 #include "nnet/nnet-trnopts.h"
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-loss.h"
-#include "nnet/nnet-matrix-buffer.h"
+#include "nnet/nnet-length-bucketer.h"
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
@@ -31,6 +31,19 @@
 #include <numeric>
 #include <algorithm>
 
+namespace kaldi {
+namespace nnet1 {
+
+// An utterance waiting in the LengthBucketer, before the feature transform,
+struct TrainUtterance {
+  Matrix<BaseFloat> feats;
+  Matrix<BaseFloat> targets;
+  Vector<BaseFloat> weights;
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   using namespace kaldi;
   using namespace kaldi::nnet1;
@@ -88,6 +101,9 @@ int main(int argc, char *argv[]) {
     po.Register("max-frames", &max_frames,
         "Max number of frames to be processed");
 
+    LengthBucketerOptions bucket_opts;
+    bucket_opts.Register(&po);
+
     bool dummy = false;
     po.Register("randomize", &dummy, "Dummy option.");
 
@@ -157,95 +173,99 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << (crossvalidate ? "CROSS-VALIDATION" : "TRAINING")
               << " STARTED";
 
-    // Buffer for input features, used for choosing utt's with similar length,
-    MatrixBuffer matrix_buffer;
-    matrix_buffer.Init(&feature_reader);
+    // Utterances read ahead and grouped by length, so the streams of
+    // a group finish together,
+    LengthBucketer<TrainUtterance> bucketer(bucket_opts);
+    int32 window = std::max(bucket_opts.bucket_window, num_streams);
+    StreamPaddingStats padding_stats;
 
     int32 num_done = 0,
           num_no_tgt_mat = 0,
           num_other_error = 0;
 
-    while (!matrix_buffer.Done()) {
-
-      // Fill the parallel data into 'std::vector',
-      std::vector<Matrix<BaseFloat> > feats_utt;
-      std::vector<Matrix<BaseFloat> > targets_utt;
-      std::vector<Vector<BaseFloat> > weights_utt;
-      std::vector<int32> frame_num_utt;
-      {
-        matrix_buffer.ResetLength();  ///< reset the 'preferred' length,
-        for (matrix_buffer.Next(); !matrix_buffer.Done(); matrix_buffer.Next()) {
-          std::string utt = matrix_buffer.Key();
-          // Check that we have targets,
-          if (!targets_reader.HasKey(utt)) {
-            KALDI_WARN << utt << ", missing targets";
-            num_no_tgt_mat++;
-            continue;
-          }
-          // Do we have frame-weights?
-          if (frame_weights != "" && !weights_reader.HasKey(utt)) {
-            KALDI_WARN << utt << ", missing frame-weights";
-            num_other_error++;
-            continue;
-          }
+    while (1) {
+
+      // Re-fill the window,
+      for ( ; !feature_reader.Done() && bucketer.NumItems() < window;
+           feature_reader.Next()) {
+        std::string utt = feature_reader.Key();
+        // Check that we have targets,
+        if (!targets_reader.HasKey(utt)) {
+          KALDI_WARN << utt << ", missing targets";
+          num_no_tgt_mat++;
+          continue;
+        }
+        // Do we have frame-weights?
+        if (frame_weights != "" && !weights_reader.HasKey(utt)) {
+          KALDI_WARN << utt << ", missing frame-weights";
+          num_other_error++;
+          continue;
+        }
 
-          // Get feature / target pair,
-          Matrix<BaseFloat> mat = matrix_buffer.Value();
-          Matrix<BaseFloat> targets  = targets_reader.Value(utt);
+        // Get feature / target pair,
+        Matrix<BaseFloat> mat = feature_reader.Value();
+        Matrix<BaseFloat> targets  = targets_reader.Value(utt);
 
-          // Skip too long sentences,
-          if (mat.NumRows() > max_frames) continue;
+        // Skip too long sentences,
+        if (mat.NumRows() > max_frames) continue;
 
-          Vector<BaseFloat> weights;
-          if (frame_weights != "") {
-            weights = weights_reader.Value(utt);
-          } else {  // all per-frame weights are 1.0
-            weights.Resize(mat.NumRows());
-            weights.Set(1.0);
-          }
+        Vector<BaseFloat> weights;
+        if (frame_weights != "") {
+          weights = weights_reader.Value(utt);
+        } else {  // all per-frame weights are 1.0
+          weights.Resize(mat.NumRows());
+          weights.Set(1.0);
+        }
 
-          // correct small length mismatch ... or drop sentence
-          {
-            // add lengths to vector
-            std::vector<int32> length;
-            length.push_back(mat.NumRows());
-            length.push_back(targets.NumRows());
-            length.push_back(weights.Dim());
-            // find min, max
-            int32 min = *std::min_element(length.begin(), length.end());
-            int32 max = *std::max_element(length.begin(), length.end());
-            // fix or drop ?
-            if (max - min < length_tolerance) {
-              if (mat.NumRows() != min) mat.Resize(min, mat.NumCols(), kCopyData);
-              if (targets.NumRows() != min) targets.Resize(min, targets.NumCols(), kCopyData);
-              if (weights.Dim() != min) weights.Resize(min, kCopyData);
-            } else {
-              KALDI_WARN << "Length mismatch! Targets " << targets.NumRows()
-                         << ", features " << mat.NumRows() << ", " << utt;
-              num_other_error++;
-              continue;
-            }
+        // correct small length mismatch ... or drop sentence
+        {
+          // add lengths to vector
+          std::vector<int32> length;
+          length.push_back(mat.NumRows());
+          length.push_back(targets.NumRows());
+          length.push_back(weights.Dim());
+          // find min, max
+          int32 min = *std::min_element(length.begin(), length.end());
+          int32 max = *std::max_element(length.begin(), length.end());
+          // fix or drop ?
+          if (max - min < length_tolerance) {
+            if (mat.NumRows() != min) mat.Resize(min, mat.NumCols(), kCopyData);
+            if (targets.NumRows() != min) targets.Resize(min, targets.NumCols(), kCopyData);
+            if (weights.Dim() != min) weights.Resize(min, kCopyData);
+          } else {
+            KALDI_WARN << "Length mismatch! Targets " << targets.NumRows()
+                       << ", features " << mat.NumRows() << ", " << utt;
+            num_other_error++;
+            continue;
           }
-
-          // input transform may contain splicing,
-          nnet_transf.Feedforward(CuMatrix<BaseFloat>(mat), &feats_transf);
-          out_nnet_transf.Feedforward(CuMatrix<BaseFloat>(targets), &nnet_tgt);
-
-          // store,
-          feats_utt.push_back(Matrix<BaseFloat>(feats_transf));
-          targets_utt.push_back(Matrix<BaseFloat>(nnet_tgt));
-          weights_utt.push_back(weights);
-          frame_num_utt.push_back(feats_transf.NumRows());
-
-          if (frame_num_utt.size() == num_streams) break;
-
-          // See how many frames we'd have (after padding), if we add one more utterance,
-          int32 max = (*std::max_element(frame_num_utt.begin(), frame_num_utt.end()));
-          if (max * (frame_num_utt.size() + 1) > max_frames) break;
         }
+        TrainUtterance *train_utt = new TrainUtterance;
+        train_utt->feats.Swap(&mat);
+        train_utt->targets.Swap(&targets);
+        train_utt->weights.Swap(&weights);
+        bucketer.Add(train_utt, train_utt->feats.NumRows());
+      }
+      if (bucketer.Empty()) break;
+
+      // Fill the parallel data into 'std::vector',
+      std::vector<Matrix<BaseFloat> > feats_utt;
+      std::vector<Matrix<BaseFloat> > targets_utt;
+      std::vector<Vector<BaseFloat> > weights_utt;
+      std::vector<int32> frame_num_utt;
+      std::vector<TrainUtterance*> group;
+      bucketer.TakeGroup(num_streams, static_cast<int64>(max_frames), &group);
+      for (size_t i = 0; i < group.size(); i++) {
+        TrainUtterance *utt = group[i];
+        // input transform may contain splicing,
+        nnet_transf.Feedforward(CuMatrix<BaseFloat>(utt->feats), &feats_transf);
+        out_nnet_transf.Feedforward(CuMatrix<BaseFloat>(utt->targets), &nnet_tgt);
+        // store,
+        feats_utt.push_back(Matrix<BaseFloat>(feats_transf));
+        targets_utt.push_back(Matrix<BaseFloat>(nnet_tgt));
+        weights_utt.push_back(utt->weights);
+        frame_num_utt.push_back(feats_transf.NumRows());
+        delete utt;
       }
-      // Having no data? Skip the cycle...
-      if (frame_num_utt.size() == 0) continue;
 
       // Pack the parallel data,
       Matrix<BaseFloat> feat_mat_host;
@@ -255,6 +275,7 @@ int main(int argc, char *argv[]) {
         // Number of sequences,
         int32 n_streams = frame_num_utt.size();
         int32 frame_num_padded = (*std::max_element(frame_num_utt.begin(), frame_num_utt.end()));
+        padding_stats.Add(frame_num_utt, frame_num_padded);
         int32 feat_dim = feats_utt.front().NumCols();
         int32 target_dim = targets_utt.front().NumCols();
 
@@ -389,6 +410,7 @@ int main(int argc, char *argv[]) {
       << "[" << (crossvalidate ? "CROSS-VALIDATION" : "TRAINING")
       << ", " << time.Elapsed() / 60 << " min, processing "
       << total_frames / time.Elapsed() << " frames per sec.]";
+    KALDI_LOG << padding_stats.Report();
 
     if (objective_function == "xent") {
       KALDI_LOG << xent.Report();
@@ -18,11 +18,13 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
 #include <numeric>
 
 #include "nnet/nnet-trnopts.h"
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-loss.h"
+#include "nnet/nnet-length-bucketer.h"
 #include "nnet/nnet-randomizer.h"
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
@@ -32,6 +34,13 @@
 
 namespace kaldi {
 
+// An utterance waiting in the LengthBucketer, before the feature transform,
+struct TrainUtterance {
+  Matrix<BaseFloat> feats;
+  Posterior targets;
+  Vector<BaseFloat> weights;
+};
+
 bool ReadData(SequentialBaseFloatMatrixReader& feature_reader,
               RandomAccessPosteriorReader& target_reader,
               RandomAccessBaseFloatVectorReader& weights_reader,
@@ -158,6 +167,9 @@ int main(int argc, char *argv[]) {
     po.Register("num-streams", &num_streams,
       "Number of streams in the Multi-stream training");
 
+    LengthBucketerOptions bucket_opts;
+    bucket_opts.Register(&po);
+
     bool dummy = false;
     po.Register("randomize", &dummy, "Dummy option.");
 
@@ -223,6 +235,10 @@ int main(int argc, char *argv[]) {
           num_no_tgt_mat = 0,
           num_other_error = 0;
 
+    // Utterances read ahead and grouped by length,
+    LengthBucketer<TrainUtterance> bucketer(bucket_opts);
+    StreamPaddingStats padding_stats;
+
     // book-keeping for multi-stream training,
     std::vector<Matrix<BaseFloat> > feats_utt(num_streams);
     std::vector<Posterior> labels_utt(num_streams);
@@ -239,31 +255,51 @@ int main(int argc, char *argv[]) {
       for (int s = 0; s < num_streams; s++) {
         // Need a new utterance for stream 's'?
         if (feats_utt[s].NumRows() == 0) {
-          Matrix<BaseFloat> feats;
-          Posterior targets;
-          Vector<BaseFloat> weights;
-          // get the data from readers,
-          if (ReadData(feature_reader, target_reader, weights_reader,
-                       length_tolerance,
-                       &feats, &targets, &weights,
-                       &num_no_tgt_mat, &num_other_error)) {
-
-            // input transform may contain splicing,
-            nnet_transf.Feedforward(CuMatrix<BaseFloat>(feats), &feats_transf);
-
-            /* Here we could do the 'targets_delay', BUT...
-             * It is better to do it by a <Splice> component!
-             *
-             * The prototype would look like this (6th frame becomes 1st frame, etc.):
-             * '<Splice> <InputDim> dim1 <OutputDim> dim1 <BuildVector> 5 </BuildVector>'
-             */
-
-            // store,
-            feats_utt[s] = Matrix<BaseFloat>(feats_transf);
-            labels_utt[s] = targets;
-            weights_utt[s] = weights;
-            new_utt_flags[s] = 1;
+          // keep the window of utterances full,
+          while (!bucketer.Full()) {
+            TrainUtterance *utt = new TrainUtterance;
+            // get the data from readers,
+            if (!ReadData(feature_reader, target_reader, weights_reader,
+                          length_tolerance,
+                          &utt->feats, &utt->targets, &utt->weights,
+                          &num_no_tgt_mat, &num_other_error)) {
+              delete utt;
+              break;
+            }
+            bucketer.Add(utt, utt->feats.NumRows());
+          }
+          if (bucketer.Empty()) continue;
+
+          // take the utterance that ends nearest to the longest of the
+          // other streams, so they finish together (any, if none is busy);
+          // once the rest of the data is in the window the longest go first
+          // (the last window is not shuffled), so at the end the streams do
+          // not run idle waiting for a long one,
+          int32 length = -1;
+          for (int32 t = 0; t < num_streams; t++) {
+            if (feats_utt[t].NumRows() > 0)
+              length = std::max(length, feats_utt[t].NumRows());
           }
+          if (feature_reader.Done())
+            length = std::numeric_limits<int32>::max();
+          TrainUtterance *utt = bucketer.TakeNearest(length);
+
+          // input transform may contain splicing,
+          nnet_transf.Feedforward(CuMatrix<BaseFloat>(utt->feats), &feats_transf);
+
+          /* Here we could do the 'targets_delay', BUT...
+           * It is better to do it by a <Splice> component!
+           *
+           * The prototype would look like this (6th frame becomes 1st frame, etc.):
+           * '<Splice> <InputDim> dim1 <OutputDim> dim1 <BuildVector> 5 </BuildVector>'
+           */
+
+          // store,
+          feats_utt[s] = Matrix<BaseFloat>(feats_transf);
+          labels_utt[s].swap(utt->targets);
+          weights_utt[s].Swap(&utt->weights);
+          new_utt_flags[s] = 1;
+          delete utt;
         }
       }
 
@@ -296,6 +332,7 @@ int main(int argc, char *argv[]) {
           int32 num_rows = feats_utt[s].NumRows();
           frame_num_utt[s] = std::min(batch_size, num_rows);
         }
+        padding_stats.Add(frame_num_utt, batch_size);
 
         // pack the data,
         {
@@ -439,6 +476,7 @@ int main(int argc, char *argv[]) {
       << "[" << (crossvalidate ? "CROSS-VALIDATION" : "TRAINING")
       << ", " << time.Elapsed() / 60 << " min, processing "
       << total_frames / time.Elapsed() << " frames per sec.]";
+    KALDI_LOG << padding_stats.Report();
 
     if (objective_function == "xent") {
       KALDI_LOG << xent.Report();
@@ -0,0 +1,360 @@
+// online2/online-audio-server.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-audio-server.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace kaldi {
+
+// The size of the reads from the sockets.
+static const int32 kReadSize = 65536;
+
+OnlineAudioServer::OnlineAudioServer(const OnlineAudioServerConfig &config):
+    config_(config), listen_fd_(-1), epoll_fd_(-1), wake_fd_(-1), stop_(false),
+    num_streams_(0), next_id_(0) {
+  KALDI_ASSERT(config_.max_streams > 0 && config_.buffer_size > 0);
+}
+
+OnlineAudioServer::~OnlineAudioServer() {
+  if (thread_.joinable()) {
+    stop_.store(true);
+    Wake();
+    thread_.join();
+  }
+  std::vector<Stream*> streams(new_streams_);
+  streams.insert(streams.end(), streams_to_close_.begin(),
+                 streams_to_close_.end());
+  for (std::map<int32, Stream*>::iterator iter = streams_.begin();
+       iter != streams_.end(); ++iter)
+    streams.push_back(iter->second);
+  for (size_t i = 0; i < streams.size(); i++) {
+    close(streams[i]->fd);
+    delete streams[i];
+  }
+  if (listen_fd_ != -1) close(listen_fd_);
+  if (epoll_fd_ != -1) close(epoll_fd_);
+  if (wake_fd_ != -1) close(wake_fd_);
+}
+
+void OnlineAudioServer::Start(int32 port) {
+  KALDI_ASSERT(listen_fd_ == -1 && "Start() called twice");
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (listen_fd_ == -1)
+    KALDI_ERR << "Cannot create TCP socket: " << strerror(errno);
+  int32 flag = 1;
+  if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &flag,
+                 sizeof(flag)) == -1)
+    KALDI_ERR << "Cannot set socket options: " << strerror(errno);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = INADDR_ANY;
+  addr.sin_port = htons(port);
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) == -1)
+    KALDI_ERR << "Cannot bind to port " << port << " (is it taken?): "
+              << strerror(errno);
+  if (listen(listen_fd_, SOMAXCONN) == -1)
+    KALDI_ERR << "Cannot listen on port " << port << ": " << strerror(errno);
+
+  epoll_fd_ = epoll_create1(0);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK);
+  if (epoll_fd_ == -1 || wake_fd_ == -1)
+    KALDI_ERR << "Cannot create epoll instance: " << strerror(errno);
+  // The events of the listening socket have a NULL pointer, and those of
+  // wake_fd_ a pointer to it; the others are those of streams.
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = NULL;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) == -1)
+    KALDI_ERR << "epoll_ctl failed: " << strerror(errno);
+  event.data.ptr = &wake_fd_;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == -1)
+    KALDI_ERR << "epoll_ctl failed: " << strerror(errno);
+
+  KALDI_LOG << "Listening on port " << port;
+  thread_ = std::thread(&OnlineAudioServer::Run, this);
+}
+
+void OnlineAudioServer::Run() {
+  const int32 kMaxEvents = 64;
+  struct epoll_event events[kMaxEvents];
+  while (!stop_.load()) {
+    // Resume reading from the clients whose buffers have space again.  While
+    // any are paused we check every 10ms.
+    for (size_t i = 0; i < paused_.size(); ) {
+      Stream *stream = paused_[i];
+      if (stream->samples.FreeSpace() == 0) {
+        i++;
+        continue;
+      }
+      struct epoll_event event;
+      event.events = EPOLLIN;
+      event.data.ptr = stream;
+      if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stream->fd, &event) == -1) {
+        KALDI_WARN << "epoll_ctl failed: " << strerror(errno);
+        stream->closed.store(true, std::memory_order_release);
+        stream->receiving = false;
+      }
+      stream->paused = false;
+      paused_[i] = paused_.back();
+      paused_.pop_back();
+    }
+    int32 num_events = epoll_wait(epoll_fd_, events, kMaxEvents,
+                                  paused_.empty() ? -1 : 10);
+    if (num_events == -1) {
+      if (errno == EINTR) continue;
+      KALDI_WARN << "epoll_wait failed, no more audio will be received: "
+                 << strerror(errno);
+      break;
+    }
+    for (int32 i = 0; i < num_events; i++) {
+      void *ptr = events[i].data.ptr;
+      if (ptr == NULL) {
+        AcceptClients();
+      } else if (ptr == &wake_fd_) {
+        uint64 value;
+        if (read(wake_fd_, &value, sizeof(value)) == -1 && errno != EAGAIN)
+          KALDI_WARN << "Error reading eventfd: " << strerror(errno);
+      } else {
+        Stream *stream = static_cast<Stream*>(ptr);
+        if (!Receive(stream))
+          StopReceiving(stream);
+      }
+    }
+    CloseStreams();
+  }
+}
+
+void OnlineAudioServer::AcceptClients() {
+  while (true) {
+    int32 fd = accept4(listen_fd_, NULL, NULL, SOCK_NONBLOCK);
+    if (fd == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        KALDI_WARN << "Error accepting connection: " << strerror(errno);
+      return;
+    }
+    if (num_streams_ >= config_.max_streams) {
+      KALDI_WARN << "Refusing connection, as there are already "
+                 << num_streams_ << " streams (see --max-streams)";
+      close(fd);
+      continue;
+    }
+    int32 flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    Stream *stream = new Stream(next_id_++, fd, config_.buffer_size);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = stream;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1) {
+      KALDI_WARN << "epoll_ctl failed: " << strerror(errno);
+      close(fd);
+      delete stream;
+      continue;
+    }
+    num_streams_++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_streams_.push_back(stream);
+  }
+}
+
+bool OnlineAudioServer::Receive(Stream *stream) {
+  size_t free_space = stream->samples.FreeSpace();
+  if (free_space == 0) {
+    // Stop waiting on the socket until the decoder reads some samples, so
+    // that the client is held back by TCP flow control.  (It is removed from
+    // epoll, as a hang-up would still be reported.)
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, stream->fd, NULL);
+    stream->paused = true;
+    paused_.push_back(stream);
+    return true;
+  }
+  // We read at most two bytes per sample there is space for, so that all the
+  // samples in them can be written.
+  char bytes[kReadSize];
+  int16 samples[kReadSize / 2 + 1];
+  ssize_t num_bytes = read(stream->fd, bytes,
+                           std::min<size_t>(kReadSize, 2 * free_space));
+  if (num_bytes == 0)
+    return false;
+  if (num_bytes == -1)
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+  int32 num_samples = ParseBytes(stream, bytes, num_bytes, samples);
+  if (num_samples == -1)
+    return false;
+  size_t num_written = stream->samples.Write(samples, num_samples);
+  KALDI_ASSERT(num_written == static_cast<size_t>(num_samples));
+  return true;
+}
+
+int32 OnlineAudioServer::ParseBytes(Stream *stream, const char *bytes,
+                                    int32 num_bytes, int16 *samples) {
+  int32 num_samples = 0;
+  for (int32 i = 0; i < num_bytes; ) {
+    if (stream->header_bytes < 4) {
+      stream->header[stream->header_bytes++] = bytes[i++];
+      if (stream->header_bytes == 4) {
+        int32 packet_bytes;
+        memcpy(&packet_bytes, stream->header, 4);
+        if (packet_bytes < 0 || packet_bytes % 2 != 0) {
+          KALDI_WARN << "Closing connection of stream " << stream->id
+                     << ", as it sent a packet of " << packet_bytes
+                     << " bytes (must be even)";
+          return -1;
+        }
+        stream->packet_bytes = packet_bytes;
+        if (packet_bytes == 0)
+          stream->header_bytes = 0;
+      }
+    } else {
+      int32 n = std::min(stream->packet_bytes, num_bytes - i);
+      for (int32 j = 0; j < n; j++) {
+        if (stream->has_odd_byte) {
+          char sample[2] = { stream->odd_byte, bytes[i + j] };
+          memcpy(samples + num_samples++, sample, 2);
+          stream->has_odd_byte = false;
+        } else {
+          stream->odd_byte = bytes[i + j];
+          stream->has_odd_byte = true;
+        }
+      }
+      i += n;
+      stream->packet_bytes -= n;
+      if (stream->packet_bytes == 0)
+        stream->header_bytes = 0;
+    }
+  }
+  return num_samples;
+}
+
+void OnlineAudioServer::StopReceiving(Stream *stream) {
+  if (!stream->receiving)
+    return;
+  if (stream->paused) {
+    paused_.erase(std::find(paused_.begin(), paused_.end(), stream));
+    stream->paused = false;
+  } else {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, stream->fd, NULL);
+  }
+  stream->receiving = false;
+  stream->closed.store(true, std::memory_order_release);
+}
+
+void OnlineAudioServer::CloseStreams() {
+  std::vector<Stream*> streams;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams.swap(streams_to_close_);
+  }
+  for (size_t i = 0; i < streams.size(); i++) {
+    StopReceiving(streams[i]);
+    close(streams[i]->fd);
+    delete streams[i];
+    num_streams_--;
+  }
+}
+
+void OnlineAudioServer::Wake() {
+  uint64 value = 1;
+  if (write(wake_fd_, &value, sizeof(value)) == -1)
+    KALDI_WARN << "Error writing eventfd: " << strerror(errno);
+}
+
+void OnlineAudioServer::GetNewStreams(std::vector<int32> *streams) {
+  std::vector<Stream*> new_streams;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_streams.swap(new_streams_);
+  }
+  streams->clear();
+  for (size_t i = 0; i < new_streams.size(); i++) {
+    streams_[new_streams[i]->id] = new_streams[i];
+    streams->push_back(new_streams[i]->id);
+  }
+}
+
+bool OnlineAudioServer::Read(int32 stream, Vector<BaseFloat> *samples) {
+  std::map<int32, Stream*>::iterator iter = streams_.find(stream);
+  KALDI_ASSERT(iter != streams_.end() && "Read() of a stream not open");
+  Stream *s = iter->second;
+  // If "closed" is set, all the samples have been written before it was.
+  bool closed = s->closed.load(std::memory_order_acquire);
+  read_buffer_.resize(s->samples.Size());
+  size_t num_samples = s->samples.Read(read_buffer_.data(),
+                                       read_buffer_.size());
+  samples->Resize(num_samples, kUndefined);
+  for (size_t i = 0; i < num_samples; i++)
+    (*samples)(i) = read_buffer_[i];
+  return !(closed && num_samples == 0);
+}
+
+bool OnlineAudioServer::WriteLine(int32 stream, const std::string &line) {
+  std::map<int32, Stream*>::iterator iter = streams_.find(stream);
+  KALDI_ASSERT(iter != streams_.end() && "WriteLine() to a stream not open");
+  int32 fd = iter->second->fd;
+  std::string text = line + "\n";
+  size_t num_written = 0;
+  while (num_written < text.size()) {
+    ssize_t ret = send(fd, text.data() + num_written,
+                       text.size() - num_written, MSG_NOSIGNAL);
+    if (ret == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        return false;
+      // The socket is non-blocking; wait (a while) until it can be written.
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLOUT;
+      if (poll(&pfd, 1, 5000) <= 0)
+        return false;
+      continue;
+    }
+    num_written += ret;
+  }
+  return true;
+}
+
+void OnlineAudioServer::CloseStream(int32 stream) {
+  std::map<int32, Stream*>::iterator iter = streams_.find(stream);
+  KALDI_ASSERT(iter != streams_.end() && "CloseStream() of a stream not open");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_to_close_.push_back(iter->second);
+  }
+  streams_.erase(iter);
+  Wake();
+}
+
+}  // namespace kaldi
+
+#endif  // defined(__linux__)
@@ -0,0 +1,182 @@
+// online2/online-audio-server.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE2_ONLINE_AUDIO_SERVER_H_
+#define KALDI_ONLINE2_ONLINE_AUDIO_SERVER_H_
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "matrix/kaldi-vector.h"
+#include "util/spsc-ring-buffer.h"
+
+namespace kaldi {
+
+struct OnlineAudioServerConfig {
+  int32 max_streams;
+  int32 buffer_size;
+
+  OnlineAudioServerConfig(): max_streams(256), buffer_size(160000) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("max-streams", &max_streams, "Maximum number of clients "
+                   "connected at once; more are refused.");
+    opts->Register("stream-buffer-size", &buffer_size, "Number of samples "
+                   "of each stream that are buffered until they are decoded; "
+                   "when it is full, no more are read from the client until "
+                   "there is space.");
+  }
+};
+
+/**
+   OnlineAudioServer receives audio from many TCP clients at once, in the
+   format that OnlineTcpVectorSource reads (packets of an int32 byte count
+   followed by that many bytes of 16-bit samples), for a decoder that serves
+   all of them, e.g. with OnlineNnet3BatchDecoder.
+
+   One thread of its own waits on all the sockets with epoll, and writes the
+   samples of each client to a SpscRingBuffer of its own, from which the
+   decoding thread reads them with Read(); so the samples are passed between
+   the threads with no lock.  (Only the rarer events, of clients connecting and
+   streams being closed, go through a mutex.)  The decoding thread is the only
+   one that is allowed to call the public functions other than the
+   constructor and destructor.
+
+   This is only available on Linux, as it uses epoll.
+*/
+class OnlineAudioServer {
+ public:
+  explicit OnlineAudioServer(const OnlineAudioServerConfig &config);
+
+  /// Stops the receiving thread and closes all the connections.
+  ~OnlineAudioServer();
+
+  /// Starts listening on the port, and receiving in a thread of its own.
+  /// Throws on error.
+  void Start(int32 port);
+
+  /// Outputs the streams (clients) that have connected since the last call.
+  /// The stream ids are never reused.
+  void GetNewStreams(std::vector<int32> *streams);
+
+  /// Outputs to "samples" all the samples of the stream received and not yet
+  /// read.  Returns false if the client has closed the connection (or it was
+  /// lost) and there are no more samples, in which case "samples" is empty.
+  bool Read(int32 stream, Vector<BaseFloat> *samples);
+
+  /// Sends a line of text (with a newline added) to the client of the
+  /// stream.  Returns false on error.
+  bool WriteLine(int32 stream, const std::string &line);
+
+  /// Closes the connection of the stream, and forgets it.
+  void CloseStream(int32 stream);
+
+ private:
+  struct Stream {
+    Stream(int32 id, int32 fd, int32 buffer_size):
+        id(id), fd(fd), samples(buffer_size), closed(false), receiving(true),
+        header_bytes(0), packet_bytes(0), has_odd_byte(false), paused(false) { }
+    int32 id;
+    int32 fd;
+    SpscRingBuffer<int16> samples;
+    // set by the receiving thread once the client has gone; no samples are
+    // written after it.
+    std::atomic<bool> closed;
+
+    // The rest is only used by the receiving thread.  True while its socket
+    // is waited on.
+    bool receiving;
+    // The bytes of the size of the packet read so far (if header_bytes < 4),
+    // and then the number of bytes of the packet still to be read.
+    char header[4];
+    int32 header_bytes;
+    int32 packet_bytes;
+    // if the last read ended in the middle of a sample, its first byte.
+    bool has_odd_byte;
+    char odd_byte;
+    // true if the buffer was full and we stopped reading from the socket.
+    bool paused;
+  };
+
+  // The main loop of the receiving thread.
+  void Run();
+
+  // Accepts the clients that are waiting.
+  void AcceptClients();
+
+  // Reads what there is space for from the socket of the stream, and returns
+  // false if the client has gone.
+  bool Receive(Stream *stream);
+
+  // Parses the bytes read from the client, outputs the samples in them to
+  // "samples" and returns how many there are, or -1 if they are not in the
+  // expected format.
+  int32 ParseBytes(Stream *stream, const char *bytes, int32 num_bytes,
+                   int16 *samples);
+
+  // Stops waiting on the socket of the stream, after the client has gone or
+  // the stream was closed.
+  void StopReceiving(Stream *stream);
+
+  // Closes the streams the decoding thread has asked to be closed.
+  void CloseStreams();
+
+  // Wakes up the receiving thread.
+  void Wake();
+
+  OnlineAudioServerConfig config_;
+
+  int32 listen_fd_;
+  int32 epoll_fd_;
+  int32 wake_fd_;  // an eventfd, for Wake().
+  std::thread thread_;
+  std::atomic<bool> stop_;
+
+  // Only used by the receiving thread: the streams that are paused, and the
+  // number of streams not yet closed.
+  std::vector<Stream*> paused_;
+  int32 num_streams_;
+  int32 next_id_;
+
+  // Owned by the decoding thread: the streams, by id, and a buffer for Read().
+  std::map<int32, Stream*> streams_;
+  std::vector<int16> read_buffer_;
+
+  // Passed from the receiving thread to the decoding one and back, under
+  // mutex_, are new streams and streams to close.
+  std::mutex mutex_;
+  std::vector<Stream*> new_streams_;
+  std::vector<Stream*> streams_to_close_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineAudioServer);
+};
+
+}  // namespace kaldi
+
+#endif  // defined(__linux__)
+
+#endif  // KALDI_ONLINE2_ONLINE_AUDIO_SERVER_H_
@@ -34,6 +34,7 @@ void OnlineIvectorExtractionInfo::Init(
   posterior_scale = config.posterior_scale;
   max_count = config.max_count;
   num_cg_iters = config.num_cg_iters;
+  cg_tolerance = config.cg_tolerance;
   use_most_recent_ivector = config.use_most_recent_ivector;
   greedy_ivector_extractor = config.greedy_ivector_extractor;
   if (greedy_ivector_extractor && !use_most_recent_ivector) {
@@ -88,6 +89,7 @@ void OnlineIvectorExtractionInfo::Check() const {
 // The class constructed in this way should never be used.
 OnlineIvectorExtractionInfo::OnlineIvectorExtractionInfo():
     ivector_period(0), num_gselect(0), min_post(0.0), posterior_scale(0.0),
+    max_count(0.0), num_cg_iters(0), cg_tolerance(0.0),
     use_most_recent_ivector(true), greedy_ivector_extractor(false),
     max_remembered_frames(0) { }
 
@@ -248,7 +250,8 @@ void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
       //  UpdateStatsForFrame(cur_start_frame + i, frame_weights[i])
       UpdateStatsForFrames(frame_weights);
       frame_weights.clear();
-      ivector_stats_.GetIvector(num_cg_iters, &current_ivector_);
+      ivector_stats_.GetIvector(num_cg_iters, info_.cg_tolerance,
+                                &current_ivector_);
       if (!info_.use_most_recent_ivector) {  // need to cache iVectors.
         int32 ivec_index = t / ivector_period;
         KALDI_ASSERT(ivec_index == static_cast<int32>(ivectors_history_.size()));
@@ -293,7 +296,8 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
         (info_.use_most_recent_ivector && t == frame)) {
       UpdateStatsForFrames(frame_weights);
       frame_weights.clear();
-      ivector_stats_.GetIvector(num_cg_iters, &current_ivector_);
+      ivector_stats_.GetIvector(num_cg_iters, info_.cg_tolerance,
+                                &current_ivector_);
       if (!info_.use_most_recent_ivector) {  // need to cache iVectors.
         int32 ivec_index = t / ivector_period;
         KALDI_ASSERT(ivec_index == static_cast<int32>(ivectors_history_.size()));
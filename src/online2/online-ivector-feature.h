@@ -80,6 +80,12 @@ struct OnlineIvectorExtractionConfig {
   int32 num_cg_iters;  // set to 15.  I don't believe this is very important, so it's
                        // not configurable from the command line for now.
 
+  // If nonzero, conjugate gradient stops early once the iVector objective
+  // function is known to be within this much of its maximum (see
+  // OnlineIvectorEstimationStats::GetIvector()); since it starts from the
+  // previous iVector it then mostly takes only a few iterations.
+  BaseFloat cg_tolerance;
+
 
   // If use_most_recent_ivector is true, we always return the most recent
   // available iVector rather than the one for the current frame.  This means
@@ -102,6 +108,7 @@ struct OnlineIvectorExtractionConfig {
   OnlineIvectorExtractionConfig(): ivector_period(10), num_gselect(5),
                                    min_post(0.025), posterior_scale(0.1),
                                    max_count(0.0), num_cg_iters(15),
+                                   cg_tolerance(0.0),
                                    use_most_recent_ivector(true),
                                    greedy_ivector_extractor(false),
                                    max_remembered_frames(1000) { }
@@ -139,6 +146,11 @@ struct OnlineIvectorExtractionConfig {
                    "iVectors from long utterances look more typical.  Interpret "
                    "as a frame-count times --posterior-scale, typically 1/10 of "
                    "a number of frames.  Suggest 100.");
+    opts->Register("cg-tolerance", &cg_tolerance, "If nonzero, stop the "
+                   "conjugate gradient iterations of iVector estimation once "
+                   "the objective function (summed over frames) is within "
+                   "this much of its maximum, e.g. 0.01.  Saves time, since "
+                   "each estimate starts from the previous one.");
     opts->Register("use-most-recent-ivector", &use_most_recent_ivector, "If true, "
                    "always use most recent available iVector, rather than the "
                    "one for the designated frame.");
@@ -176,6 +188,7 @@ struct OnlineIvectorExtractionInfo {
   BaseFloat posterior_scale;
   BaseFloat max_count;
   int32 num_cg_iters;
+  BaseFloat cg_tolerance;
   bool use_most_recent_ivector;
   bool greedy_ivector_extractor;
   BaseFloat max_remembered_frames;
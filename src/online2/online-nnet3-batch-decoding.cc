@@ -0,0 +1,418 @@
+// online2/online-nnet3-batch-decoding.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "online2/online-nnet3-batch-decoding.h"
+#include "nnet3/nnet-compile-looped.h"
+#include "lat/lattice-functions.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "decoder/grammar-fst.h"
+
+namespace kaldi {
+
+void DecodableAmNnetBatchStream::AcceptChunk(
+    const MatrixBase<BaseFloat> &log_post, int32 num_frames_total) {
+  KALDI_ASSERT(!is_finished_);
+  offset_ += log_post_.NumRows();
+  log_post_ = log_post;
+  num_frames_ready_ = offset_ + log_post_.NumRows();
+  if (num_frames_total >= 0) {
+    KALDI_ASSERT(num_frames_total >= offset_);
+    num_frames_ready_ = std::min(num_frames_ready_, num_frames_total);
+    is_finished_ = (num_frames_ready_ == num_frames_total);
+  }
+}
+
+
+template <typename FST>
+OnlineNnet3BatchDecoderTpl<FST>::OnlineNnet3BatchDecoderTpl(
+    const OnlineNnet3BatchDecodingConfig &config,
+    const LatticeFasterDecoderConfig &decoder_opts,
+    const TransitionModel &trans_model,
+    const nnet3::DecodableNnetSimpleLoopedInfo &info,
+    const FST &fst):
+    config_(config), decoder_opts_(decoder_opts), trans_model_(trans_model),
+    info_(info), fst_(fst), next_stream_id_(0) {
+  config_.Check();
+}
+
+template <typename FST>
+OnlineNnet3BatchDecoderTpl<FST>::~OnlineNnet3BatchDecoderTpl() {
+  for (size_t i = 0; i < cohorts_.size(); i++)
+    delete cohorts_[i];
+  for (typename std::map<int32, Stream*>::iterator iter = streams_.begin();
+       iter != streams_.end(); ++iter)
+    delete iter->second;
+  for (typename std::map<int32, BatchComputation*>::iterator iter =
+           computations_.begin(); iter != computations_.end(); ++iter)
+    delete iter->second;
+}
+
+template <typename FST>
+const typename OnlineNnet3BatchDecoderTpl<FST>::Stream&
+OnlineNnet3BatchDecoderTpl<FST>::GetStream(int32 stream) const {
+  typename std::map<int32, Stream*>::const_iterator iter =
+      streams_.find(stream);
+  if (iter == streams_.end())
+    KALDI_ERR << "No stream with id " << stream;
+  return *(iter->second);
+}
+
+template <typename FST>
+typename OnlineNnet3BatchDecoderTpl<FST>::Stream&
+OnlineNnet3BatchDecoderTpl<FST>::GetStream(int32 stream) {
+  typename std::map<int32, Stream*>::iterator iter = streams_.find(stream);
+  if (iter == streams_.end())
+    KALDI_ERR << "No stream with id " << stream;
+  return *(iter->second);
+}
+
+template <typename FST>
+int32 OnlineNnet3BatchDecoderTpl<FST>::AddStream(
+    OnlineNnet2FeaturePipeline *features) {
+  KALDI_ASSERT(features != NULL);
+  if (features->InputFeature()->Dim() != info_.nnet.InputDim("input"))
+    KALDI_ERR << "Input feature dimension mismatch: got "
+              << features->InputFeature()->Dim() << " but network expects "
+              << info_.nnet.InputDim("input");
+  if (info_.has_ivectors != (features->IvectorFeature() != NULL))
+    KALDI_ERR << "The network " << (info_.has_ivectors ? "needs" : "has no")
+              << " iVectors but the feature pipeline "
+              << (info_.has_ivectors ? "has none" : "has them");
+  int32 stream = next_stream_id_++;
+  streams_[stream] = new Stream(trans_model_, fst_, decoder_opts_, features);
+  pending_.push_back(stream);
+  return stream;
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::RemoveStream(int32 stream) {
+  typename std::map<int32, Stream*>::iterator iter = streams_.find(stream);
+  if (iter == streams_.end())
+    KALDI_ERR << "No stream with id " << stream;
+  pending_.erase(std::remove(pending_.begin(), pending_.end(), stream),
+                 pending_.end());
+  for (size_t i = 0; i < cohorts_.size(); i++)
+    std::replace(cohorts_[i]->streams.begin(), cohorts_[i]->streams.end(),
+                 stream, -1);
+  delete iter->second;
+  streams_.erase(iter);
+}
+
+template <typename FST>
+const typename OnlineNnet3BatchDecoderTpl<FST>::BatchComputation&
+OnlineNnet3BatchDecoderTpl<FST>::GetComputation(int32 num_sequences) {
+  typename std::map<int32, BatchComputation*>::iterator iter =
+      computations_.find(num_sequences);
+  if (iter != computations_.end())
+    return *(iter->second);
+
+  BatchComputation *computation = new BatchComputation();
+  computation->num_sequences = num_sequences;
+  nnet3::ComputationRequest request3;
+  // as in DecodableNnetSimpleLoopedInfo, the ivector period is the chunk size.
+  nnet3::CreateLoopedComputationRequest(info_.nnet, info_.frames_per_chunk,
+                                        info_.opts.frame_subsampling_factor,
+                                        info_.frames_per_chunk,
+                                        info_.frames_left_context,
+                                        info_.frames_right_context,
+                                        num_sequences,
+                                        &(computation->request1),
+                                        &(computation->request2), &request3);
+  nnet3::CompileLooped(info_.nnet, info_.opts.optimize_config,
+                       computation->request1, computation->request2, request3,
+                       &(computation->computation));
+  computation->computation.ComputeCudaIndexes();
+  KALDI_VLOG(2) << "Compiled the looped computation for " << num_sequences
+                << " sequences";
+  computations_[num_sequences] = computation;
+  return *computation;
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::ChunkInputFrames(
+    int32 chunk, int32 *begin_input_frame, int32 *end_input_frame) const {
+  // the same as DecodableNnetLoopedOnlineBase::AdvanceChunk().
+  if (chunk == 0) {
+    *begin_input_frame = -info_.frames_left_context;
+    *end_input_frame = info_.frames_per_chunk + info_.frames_right_context;
+  } else {
+    *begin_input_frame = chunk * info_.frames_per_chunk +
+        info_.frames_right_context;
+    *end_input_frame = *begin_input_frame + info_.frames_per_chunk;
+  }
+}
+
+template <typename FST>
+int32 OnlineNnet3BatchDecoderTpl<FST>::NumFramesTotal(
+    const Stream &stream) const {
+  OnlineFeatureInterface *input = stream.features->InputFeature();
+  int32 num_feature_frames_ready = input->NumFramesReady(),
+      sf = info_.opts.frame_subsampling_factor;
+  if (!input->IsLastFrame(num_feature_frames_ready - 1))
+    return -1;
+  return (num_feature_frames_ready + sf - 1) / sf;
+}
+
+template <typename FST>
+bool OnlineNnet3BatchDecoderTpl<FST>::ChunkIsReady(const Stream &stream,
+                                                   int32 chunk) const {
+  int32 begin_input_frame, end_input_frame;
+  ChunkInputFrames(chunk, &begin_input_frame, &end_input_frame);
+  // past the end of the input we pad with copies of the last frame.
+  return end_input_frame <= stream.features->InputFeature()->NumFramesReady() ||
+      NumFramesTotal(stream) >= 0;
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::StartCohorts() {
+  std::vector<int32> ready, still_pending;
+  for (size_t i = 0; i < pending_.size(); i++) {
+    Stream &stream = GetStream(pending_[i]);
+    if (!ChunkIsReady(stream, 0)) {
+      still_pending.push_back(pending_[i]);
+    } else if (NumFramesTotal(stream) == 0) {
+      // finished before any features, there is nothing to compute.
+      stream.decodable.AcceptChunk(Matrix<BaseFloat>(), 0);
+      stream.computed = true;
+    } else {
+      ready.push_back(pending_[i]);
+    }
+  }
+  pending_.swap(still_pending);
+
+  for (size_t i = 0; i < ready.size(); i += config_.max_batch_size) {
+    int32 num_streams = std::min<int32>(config_.max_batch_size,
+                                        ready.size() - i),
+        num_sequences = 1;
+    while (num_sequences < num_streams)
+      num_sequences *= 2;
+    num_sequences = std::min(num_sequences, config_.max_batch_size);
+    Cohort *cohort = new Cohort(info_.opts.compute_config,
+                                GetComputation(num_sequences), info_.nnet);
+    for (int32 n = 0; n < num_streams; n++)
+      cohort->streams[n] = ready[i + n];
+    cohorts_.push_back(cohort);
+  }
+}
+
+template <typename FST>
+bool OnlineNnet3BatchDecoderTpl<FST>::CohortIsReady(
+    const Cohort &cohort) const {
+  bool any_stream = false;
+  for (size_t n = 0; n < cohort.streams.size(); n++) {
+    if (cohort.streams[n] < 0)
+      continue;
+    if (!ChunkIsReady(GetStream(cohort.streams[n]),
+                      cohort.num_chunks_computed))
+      return false;
+    any_stream = true;
+  }
+  return any_stream;
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::AdvanceCohort(Cohort *cohort) {
+  const BatchComputation &computation = cohort->computation;
+  int32 num_sequences = computation.num_sequences,
+      chunk = cohort->num_chunks_computed,
+      begin_input_frame, end_input_frame;
+  ChunkInputFrames(chunk, &begin_input_frame, &end_input_frame);
+  int32 num_input_frames = end_input_frame - begin_input_frame;
+
+  // the 'n' index has the larger stride in the request, so each sequence has a
+  // block of rows.  The sequences without a stream are left zero.
+  Matrix<BaseFloat> feats(num_sequences * num_input_frames,
+                          info_.nnet.InputDim("input"));
+  for (int32 n = 0; n < num_sequences; n++) {
+    if (cohort->streams[n] < 0)
+      continue;
+    OnlineFeatureInterface *input =
+        GetStream(cohort->streams[n]).features->InputFeature();
+    int32 num_feature_frames_ready = input->NumFramesReady();
+    for (int32 i = begin_input_frame; i < end_input_frame; i++) {
+      SubVector<BaseFloat> this_row(feats,
+                                    n * num_input_frames + i - begin_input_frame);
+      int32 input_frame = std::max<int32>(
+          0, std::min<int32>(i, num_feature_frames_ready - 1));
+      input->GetFrame(input_frame, &this_row);
+    }
+  }
+  CuMatrix<BaseFloat> feats_chunk;
+  feats_chunk.Swap(&feats);
+  cohort->computer.AcceptInput("input", &feats_chunk);
+
+  if (info_.has_ivectors) {
+    const nnet3::ComputationRequest &request =
+        (chunk == 0 ? computation.request1 : computation.request2);
+    KALDI_ASSERT(request.inputs.size() == 2);
+    int32 num_ivectors = request.inputs[1].indexes.size() / num_sequences;
+    KALDI_ASSERT(num_ivectors > 0);
+    Matrix<BaseFloat> ivectors(num_sequences * num_ivectors,
+                               info_.nnet.InputDim("ivector"));
+    for (int32 n = 0; n < num_sequences; n++) {
+      if (cohort->streams[n] < 0)
+        continue;
+      const Stream &stream = GetStream(cohort->streams[n]);
+      OnlineFeatureInterface *ivector_feature =
+          stream.features->IvectorFeature();
+      // as in DecodableNnetLoopedOnlineBase, we use the iVector of the most
+      // recent input frame there is one for, or zero if there is none yet.
+      int32 most_recent_input_frame =
+          stream.features->InputFeature()->NumFramesReady() - 1,
+          num_ivector_frames_ready = ivector_feature->NumFramesReady();
+      if (num_ivector_frames_ready > 0) {
+        SubMatrix<BaseFloat> these_ivectors(ivectors, n * num_ivectors,
+                                            num_ivectors, 0,
+                                            ivectors.NumCols());
+        Vector<BaseFloat> ivector(ivectors.NumCols());
+        ivector_feature->GetFrame(std::min<int32>(most_recent_input_frame,
+                                                  num_ivector_frames_ready - 1),
+                                  &ivector);
+        these_ivectors.CopyRowsFromVec(ivector);
+      }
+    }
+    CuMatrix<BaseFloat> cu_ivectors;
+    cu_ivectors.Swap(&ivectors);
+    cohort->computer.AcceptInput("ivector", &cu_ivectors);
+  }
+  cohort->computer.Run();
+
+  Matrix<BaseFloat> log_post;
+  {
+    CuMatrix<BaseFloat> output;
+    cohort->computer.GetOutputDestructive("output", &output);
+    if (info_.log_priors.Dim() != 0) {
+      // subtract log-prior (divide by prior)
+      output.AddVecToRows(-1.0, info_.log_priors);
+    }
+    // apply the acoustic scale
+    output.Scale(info_.opts.acoustic_scale);
+    output.Swap(&log_post);
+  }
+  int32 frames_per_chunk_out =
+      info_.frames_per_chunk / info_.opts.frame_subsampling_factor;
+  KALDI_ASSERT(log_post.NumRows() == num_sequences * frames_per_chunk_out &&
+               log_post.NumCols() == info_.output_dim);
+  cohort->num_chunks_computed++;
+
+  for (int32 n = 0; n < num_sequences; n++) {
+    if (cohort->streams[n] < 0)
+      continue;
+    Stream &stream = GetStream(cohort->streams[n]);
+    int32 num_frames_total = NumFramesTotal(stream);
+    stream.decodable.AcceptChunk(
+        log_post.RowRange(n * frames_per_chunk_out, frames_per_chunk_out),
+        num_frames_total);
+    stream.decoder.AdvanceDecoding(&stream.decodable);
+    if (stream.decodable.NumFramesReady() == num_frames_total) {
+      stream.computed = true;
+      cohort->streams[n] = -1;
+    }
+  }
+}
+
+template <typename FST>
+int32 OnlineNnet3BatchDecoderTpl<FST>::AdvanceDecoding() {
+  StartCohorts();
+  int32 num_chunks = 0;
+  bool advanced = true;
+  while (advanced) {
+    advanced = false;
+    for (size_t i = 0; i < cohorts_.size(); i++) {
+      if (CohortIsReady(*cohorts_[i])) {
+        num_chunks += cohorts_[i]->streams.size() -
+            std::count(cohorts_[i]->streams.begin(),
+                       cohorts_[i]->streams.end(), -1);
+        AdvanceCohort(cohorts_[i]);
+        advanced = true;
+      }
+    }
+  }
+  // the cohorts all of whose streams have finished or been removed are done.
+  std::vector<Cohort*> cohorts;
+  for (size_t i = 0; i < cohorts_.size(); i++) {
+    if (std::count(cohorts_[i]->streams.begin(), cohorts_[i]->streams.end(),
+                   -1) == static_cast<int32>(cohorts_[i]->streams.size()))
+      delete cohorts_[i];
+    else
+      cohorts.push_back(cohorts_[i]);
+  }
+  cohorts_.swap(cohorts);
+  return num_chunks;
+}
+
+template <typename FST>
+bool OnlineNnet3BatchDecoderTpl<FST>::IsFinished(int32 stream) const {
+  // the decoder is advanced over each chunk as soon as it is computed.
+  return GetStream(stream).computed;
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::FinalizeDecoding(int32 stream) {
+  GetStream(stream).decoder.FinalizeDecoding();
+}
+
+template <typename FST>
+int32 OnlineNnet3BatchDecoderTpl<FST>::NumFramesDecoded(int32 stream) const {
+  return GetStream(stream).decoder.NumFramesDecoded();
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::GetLattice(int32 stream,
+                                                 bool end_of_utterance,
+                                                 CompactLattice *clat) const {
+  if (NumFramesDecoded(stream) == 0)
+    KALDI_ERR << "You cannot get a lattice if you decoded no frames.";
+  Lattice raw_lat;
+  GetStream(stream).decoder.GetRawLattice(&raw_lat, end_of_utterance);
+
+  if (!decoder_opts_.determinize_lattice)
+    KALDI_ERR << "--determinize-lattice=false option is not supported at the moment";
+
+  BaseFloat lat_beam = decoder_opts_.lattice_beam;
+  DeterminizeLatticePhonePrunedWrapper(
+      trans_model_, &raw_lat, lat_beam, clat, decoder_opts_.det_opts);
+}
+
+template <typename FST>
+void OnlineNnet3BatchDecoderTpl<FST>::GetBestPath(int32 stream,
+                                                  bool end_of_utterance,
+                                                  Lattice *best_path) const {
+  GetStream(stream).decoder.GetBestPath(best_path, end_of_utterance);
+}
+
+template <typename FST>
+bool OnlineNnet3BatchDecoderTpl<FST>::EndpointDetected(
+    int32 stream, const OnlineEndpointConfig &config) {
+  const Stream &this_stream = GetStream(stream);
+  BaseFloat output_frame_shift =
+      this_stream.features->FrameShiftInSeconds() *
+      info_.opts.frame_subsampling_factor;
+  return kaldi::EndpointDetected(config, trans_model_,
+                                 output_frame_shift, this_stream.decoder);
+}
+
+
+// Instantiate the template for the types needed.
+template class OnlineNnet3BatchDecoderTpl<fst::Fst<fst::StdArc> >;
+template class OnlineNnet3BatchDecoderTpl<fst::GrammarFst>;
+
+}  // namespace kaldi
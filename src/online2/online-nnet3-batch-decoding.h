@@ -0,0 +1,261 @@
+// online2/online-nnet3-batch-decoding.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE2_ONLINE_NNET3_BATCH_DECODING_H_
+#define KALDI_ONLINE2_ONLINE_NNET3_BATCH_DECODING_H_
+
+#include <map>
+#include <vector>
+
+#include "nnet3/decodable-simple-looped.h"
+#include "nnet3/nnet-compute.h"
+#include "matrix/matrix-lib.h"
+#include "util/common-utils.h"
+#include "base/kaldi-error.h"
+#include "itf/decodable-itf.h"
+#include "online2/online-endpoint.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "decoder/lattice-faster-online-decoder.h"
+#include "hmm/transition-model.h"
+
+namespace kaldi {
+/// @addtogroup  onlinedecoding OnlineDecoding
+/// @{
+
+
+struct OnlineNnet3BatchDecodingConfig {
+  int32 max_batch_size;
+
+  OnlineNnet3BatchDecodingConfig(): max_batch_size(32) { }
+
+  void Check() const { KALDI_ASSERT(max_batch_size > 0); }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("max-batch-size", &max_batch_size,
+                   "Maximum number of streams whose chunks are computed by "
+                   "one run of the neural net.");
+  }
+};
+
+
+/**
+   The decodable object of one stream of OnlineNnet3BatchDecoderTpl.  It does
+   no computation itself, it holds the log-likelihoods of the last chunk the
+   batch decoder computed for it (the decoder is advanced over each chunk
+   as soon as it is computed, so earlier chunks are not needed).
+*/
+class DecodableAmNnetBatchStream: public DecodableInterface {
+ public:
+  explicit DecodableAmNnetBatchStream(const TransitionModel &trans_model):
+      trans_model_(trans_model), offset_(0), num_frames_ready_(0),
+      is_finished_(false) { }
+
+  virtual BaseFloat LogLikelihood(int32 subsampled_frame,
+                                  int32 transition_id) {
+    KALDI_ASSERT(subsampled_frame >= offset_ &&
+                 subsampled_frame < num_frames_ready_ &&
+                 "Frames must be accessed in order.");
+    return log_post_(subsampled_frame - offset_,
+                     trans_model_.TransitionIdToPdfFast(transition_id));
+  }
+
+  virtual int32 NumFramesReady() const { return num_frames_ready_; }
+
+  virtual bool IsLastFrame(int32 subsampled_frame) const {
+    return is_finished_ && subsampled_frame == num_frames_ready_ - 1;
+  }
+
+  virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+
+  /// Takes the (scaled) log-likelihoods of the next chunk.  If
+  /// num_frames_total >= 0 it is the number of frames of the whole
+  /// utterance, the input has finished and the frames of the chunk past it
+  /// are padding.
+  void AcceptChunk(const MatrixBase<BaseFloat> &log_post,
+                   int32 num_frames_total);
+
+ private:
+  const TransitionModel &trans_model_;
+  Matrix<BaseFloat> log_post_;
+  // the frame of the first row of log_post_
+  int32 offset_;
+  int32 num_frames_ready_;
+  bool is_finished_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetBatchStream);
+};
+
+
+/**
+   Decodes many concurrent streams (for a server), running one looped neural
+   net computation for the next chunk of a group of streams, instead of one
+   small computation per stream as SingleUtteranceNnet3DecoderTpl does.  Each
+   stream keeps its own OnlineNnet2FeaturePipeline, LatticeFasterOnlineDecoder
+   and endpointing.
+
+   In a looped computation the recurrent state of sequence 'n' lives in the
+   rows of the computer's matrices, so a stream cannot join a computation that
+   has already run.  The streams whose first chunk becomes ready at the same
+   call of AdvanceDecoding() therefore form a cohort that shares a computation
+   (compiled for the power of two at or above its size, at most
+   --max-batch-size, and cached) until all of its streams have finished; the
+   slots of the streams that finish first are fed zeros.  A chunk of a cohort
+   is computed when all of its unfinished streams have the features for it,
+   so streams fed at very different rates should not be decoded together.
+
+   Not thread safe: the server loop adds the audio to the feature pipelines,
+   calls AdvanceDecoding() and then deals with the streams that are finished
+   or at an endpoint.
+*/
+template <typename FST>
+class OnlineNnet3BatchDecoderTpl {
+ public:
+  OnlineNnet3BatchDecoderTpl(const OnlineNnet3BatchDecodingConfig &config,
+                             const LatticeFasterDecoderConfig &decoder_opts,
+                             const TransitionModel &trans_model,
+                             const nnet3::DecodableNnetSimpleLoopedInfo &info,
+                             const FST &fst);
+
+  /// Adds a stream, returns its id.  The pointer 'features' is not being given
+  /// to this class to own, it must live until RemoveStream() is called.
+  int32 AddStream(OnlineNnet2FeaturePipeline *features);
+
+  /// Removes a stream, e.g. after its lattice has been got or when the client
+  /// has gone.
+  void RemoveStream(int32 stream);
+
+  int32 NumStreams() const { return streams_.size(); }
+
+  /// Computes every chunk that is ready for all the streams and advances their
+  /// decoders over them.  Returns the number of chunks of streams computed.
+  int32 AdvanceDecoding();
+
+  /// True once the input of the stream has finished and all of it is decoded.
+  bool IsFinished(int32 stream) const;
+
+  /// The same as in SingleUtteranceNnet3DecoderTpl, for one stream.
+  void FinalizeDecoding(int32 stream);
+
+  int32 NumFramesDecoded(int32 stream) const;
+
+  void GetLattice(int32 stream, bool end_of_utterance,
+                  CompactLattice *clat) const;
+
+  void GetBestPath(int32 stream, bool end_of_utterance,
+                   Lattice *best_path) const;
+
+  bool EndpointDetected(int32 stream, const OnlineEndpointConfig &config);
+
+  const LatticeFasterOnlineDecoderTpl<FST> &Decoder(int32 stream) const {
+    return GetStream(stream).decoder;
+  }
+
+  ~OnlineNnet3BatchDecoderTpl();
+
+ private:
+  struct Stream {
+    Stream(const TransitionModel &trans_model,
+           const FST &fst, const LatticeFasterDecoderConfig &decoder_opts,
+           OnlineNnet2FeaturePipeline *features):
+        features(features), decodable(trans_model), decoder(fst, decoder_opts),
+        computed(false) { decoder.InitDecoding(); }
+
+    OnlineNnet2FeaturePipeline *features;
+    DecodableAmNnetBatchStream decodable;
+    LatticeFasterOnlineDecoderTpl<FST> decoder;
+    // true when all of its frames have been computed
+    bool computed;
+  };
+
+  // the looped computation for a number of sequences
+  struct BatchComputation {
+    int32 num_sequences;
+    nnet3::ComputationRequest request1, request2;
+    nnet3::NnetComputation computation;
+  };
+
+  struct Cohort {
+    Cohort(const nnet3::NnetComputeOptions &opts,
+           const BatchComputation &computation, const nnet3::Nnet &nnet):
+        computation(computation),
+        computer(opts, computation.computation, nnet, NULL),
+        streams(computation.num_sequences, -1), num_chunks_computed(0) { }
+
+    const BatchComputation &computation;
+    nnet3::NnetComputer computer;
+    // the stream of each sequence of the computation, -1 for none
+    std::vector<int32> streams;
+    int32 num_chunks_computed;
+  };
+
+  const Stream &GetStream(int32 stream) const;
+  Stream &GetStream(int32 stream);
+
+  // compiles the computation for num_sequences if it is not cached
+  const BatchComputation &GetComputation(int32 num_sequences);
+
+  // the input frames of a chunk, 'end' is one past the last
+  void ChunkInputFrames(int32 chunk, int32 *begin_input_frame,
+                        int32 *end_input_frame) const;
+
+  // true if the features of the chunk of the stream are ready (or its input
+  // has finished)
+  bool ChunkIsReady(const Stream &stream, int32 chunk) const;
+
+  // the number of frames (after subsampling) of the stream if its input has
+  // finished, else -1
+  int32 NumFramesTotal(const Stream &stream) const;
+
+  // puts the streams whose first chunk is ready into new cohorts
+  void StartCohorts();
+
+  // true if all the unfinished streams of the cohort have the features of its
+  // next chunk, and there is at least one
+  bool CohortIsReady(const Cohort &cohort) const;
+
+  // computes the next chunk of the cohort and advances the decoders
+  void AdvanceCohort(Cohort *cohort);
+
+  const OnlineNnet3BatchDecodingConfig &config_;
+  const LatticeFasterDecoderConfig &decoder_opts_;
+  const TransitionModel &trans_model_;
+  const nnet3::DecodableNnetSimpleLoopedInfo &info_;
+  const FST &fst_;
+
+  std::map<int32, Stream*> streams_;
+  int32 next_stream_id_;
+  // the streams not yet in a cohort, in the order they were added
+  std::vector<int32> pending_;
+  std::vector<Cohort*> cohorts_;
+  std::map<int32, BatchComputation*> computations_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineNnet3BatchDecoderTpl);
+};
+
+
+typedef OnlineNnet3BatchDecoderTpl<fst::Fst<fst::StdArc> >
+    OnlineNnet3BatchDecoder;
+
+/// @} End of "addtogroup onlinedecoding"
+
+}  // namespace kaldi
+
+
+
+#endif  // KALDI_ONLINE2_ONLINE_NNET3_BATCH_DECODING_H_
@@ -0,0 +1,268 @@
+// online2bin/online2-tcp-nnet3-latgen-batch.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-audio-server.h"
+#include "online2/online-nnet3-batch-decoding.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/onlinebin-util.h"
+#include "online2/online-endpoint.h"
+#include "fstext/fstext-lib.h"
+#include "lat/lattice-functions.h"
+#include "util/kaldi-thread.h"
+#include "nnet3/nnet-utils.h"
+
+#if defined(__linux__)
+
+namespace kaldi {
+
+// A client of the server.  Its utterances (segmented by endpointing, if
+// enabled) are decoded one after the other as one of the streams of the
+// decoder, with the iVector adaptation state carried over between them.
+struct Client {
+  Client(int32 connection,
+         const OnlineNnet2FeaturePipelineInfo &feature_info):
+      connection(connection), adaptation_state(
+          feature_info.ivector_extractor_info),
+      feature_pipeline(NULL), stream(-1), input_finished(false) { }
+
+  ~Client() { delete feature_pipeline; }
+
+  int32 connection;  // the stream id of the OnlineAudioServer.
+  OnlineIvectorExtractorAdaptationState adaptation_state;
+  OnlineNnet2FeaturePipeline *feature_pipeline;
+  int32 stream;  // the stream id of the decoder.
+  bool input_finished;
+};
+
+static void StartUtterance(const OnlineNnet2FeaturePipelineInfo &feature_info,
+                           OnlineNnet3BatchDecoder *decoder, Client *client) {
+  delete client->feature_pipeline;
+  client->feature_pipeline = new OnlineNnet2FeaturePipeline(feature_info);
+  client->feature_pipeline->SetAdaptationState(client->adaptation_state);
+  client->stream = decoder->AddStream(client->feature_pipeline);
+}
+
+// Sends the words of the best path of the utterance to the client, as
+// online2-audio-nnet3-latgen-faster does: a RESULT line with the number of
+// words, the words one per line, then RESULT:DONE.  Returns false on error.
+static bool WriteResult(const OnlineNnet3BatchDecoder &decoder,
+                        const fst::SymbolTable *word_syms,
+                        const Client &client, OnlineAudioServer *server) {
+  std::vector<int32> words;
+  if (decoder.NumFramesDecoded(client.stream) > 0) {
+    Lattice best_path;
+    bool end_of_utterance = true;
+    decoder.GetBestPath(client.stream, end_of_utterance, &best_path);
+    std::vector<int32> alignment, all_words;
+    LatticeWeight weight;
+    GetLinearSymbolSequence(best_path, &alignment, &all_words, &weight);
+    for (size_t i = 0; i < all_words.size(); i++)
+      if (all_words[i] != 0)
+        words.push_back(all_words[i]);
+  }
+  std::ostringstream header;
+  header << "RESULT:NUM=" << words.size() << ",FORMAT=W";
+  if (!server->WriteLine(client.connection, header.str()))
+    return false;
+  for (size_t i = 0; i < words.size(); i++) {
+    std::string word;
+    if (word_syms != NULL)
+      word = word_syms->Find(words[i]);
+    if (word.empty()) {
+      std::ostringstream id;
+      id << words[i];
+      word = id.str();
+    }
+    if (!server->WriteLine(client.connection, word))
+      return false;
+  }
+  return server->WriteLine(client.connection, "RESULT:DONE");
+}
+
+}  // namespace kaldi
+
+#endif  // defined(__linux__)
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Listens on the given port for audio from any number of clients at "
+        "once,\n"
+        "in the format online2-audio-nnet3-latgen-faster takes, and decodes "
+        "them\n"
+        "online with neural nets (nnet3 setup) as the streams of one batched\n"
+        "decoder (see online2-wav-nnet3-latgen-batch), with iVector-based\n"
+        "speaker adaptation per client and optional endpointing.  The words\n"
+        "of each utterance are sent back to its client as they are decoded.\n"
+        "The audio is received by a thread of its own (Linux only).\n"
+        "\n"
+        "Usage: online2-tcp-nnet3-latgen-batch [options] <nnet3-in> <fst-in> "
+        "<port>\n";
+
+    ParseOptions po(usage);
+
+    OnlineNnet2FeaturePipelineConfig feature_opts;
+    nnet3::NnetSimpleLoopedComputationOptions decodable_opts;
+    LatticeFasterDecoderConfig decoder_opts;
+    OnlineEndpointConfig endpoint_opts;
+    OnlineNnet3BatchDecodingConfig batch_opts;
+    OnlineAudioServerConfig server_opts;
+
+    std::string word_syms_rxfilename;
+    BaseFloat samp_freq = 16000.0;
+    bool do_endpointing = false;
+
+    po.Register("word-symbol-table", &word_syms_rxfilename,
+                "Symbol table for words (else the word ids are sent)");
+    po.Register("samp-freq", &samp_freq,
+                "Sampling frequency of the audio the clients send");
+    po.Register("do-endpointing", &do_endpointing,
+                "If true, apply endpoint detection");
+    po.Register("num-threads-startup", &g_num_threads,
+                "Number of threads used when initializing iVector extractor.");
+
+    feature_opts.Register(&po);
+    decodable_opts.Register(&po);
+    decoder_opts.Register(&po);
+    endpoint_opts.Register(&po);
+    batch_opts.Register(&po);
+    server_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      return 1;
+    }
+#if !defined(__linux__)
+    KALDI_ERR << "online2-tcp-nnet3-latgen-batch is only supported on Linux.";
+#else
+    std::string nnet3_rxfilename = po.GetArg(1),
+        fst_rxfilename = po.GetArg(2);
+    int32 port = strtol(po.GetArg(3).c_str(), 0, 10);
+
+    OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
+
+    TransitionModel trans_model;
+    nnet3::AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(nnet3_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+      SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
+      SetDropoutTestMode(true, &(am_nnet.GetNnet()));
+      nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
+    }
+
+    nnet3::DecodableNnetSimpleLoopedInfo decodable_info(decodable_opts,
+                                                        &am_nnet);
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename);
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_rxfilename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_rxfilename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                  << word_syms_rxfilename;
+
+    OnlineNnet3BatchDecoder decoder(batch_opts, decoder_opts, trans_model,
+                                    decodable_info, *decode_fst);
+
+    OnlineAudioServer server(server_opts);
+    server.Start(port);
+
+    std::vector<Client*> clients;
+    std::vector<int32> new_connections;
+    Vector<BaseFloat> samples;
+    while (true) {
+      server.GetNewStreams(&new_connections);
+      for (size_t i = 0; i < new_connections.size(); i++) {
+        Client *client = new Client(new_connections[i], feature_info);
+        StartUtterance(feature_info, &decoder, client);
+        clients.push_back(client);
+        KALDI_LOG << "Client " << client->connection << " connected; "
+                  << clients.size() << " clients.";
+      }
+
+      // each client's stream gets the audio received since the last time.
+      int64 num_samples = 0;
+      for (size_t i = 0; i < clients.size(); i++) {
+        Client *client = clients[i];
+        if (client->input_finished)
+          continue;
+        if (!server.Read(client->connection, &samples)) {
+          client->input_finished = true;
+          client->feature_pipeline->InputFinished();
+          continue;
+        }
+        if (samples.Dim() > 0)
+          client->feature_pipeline->AcceptWaveform(samp_freq, samples);
+        num_samples += samples.Dim();
+      }
+
+      int32 num_chunks = decoder.AdvanceDecoding();
+
+      // the utterances that are done
+      std::vector<Client*> active;
+      for (size_t i = 0; i < clients.size(); i++) {
+        Client *client = clients[i];
+        int32 stream = client->stream;
+        if (!decoder.IsFinished(stream) &&
+            !(do_endpointing &&
+              decoder.EndpointDetected(stream, endpoint_opts))) {
+          active.push_back(client);
+          continue;
+        }
+        if (decoder.NumFramesDecoded(stream) > 0)
+          decoder.FinalizeDecoding(stream);
+        bool ok = WriteResult(decoder, word_syms, *client, &server);
+        client->feature_pipeline->GetAdaptationState(
+            &(client->adaptation_state));
+        decoder.RemoveStream(stream);
+        if (ok && !client->input_finished) {
+          StartUtterance(feature_info, &decoder, client);
+          active.push_back(client);
+          continue;
+        }
+        KALDI_LOG << "Client " << client->connection << " disconnected.";
+        server.CloseStream(client->connection);
+        delete client;
+      }
+      clients.swap(active);
+
+      // wait for more audio if there was nothing to do.
+      if (num_chunks == 0 && num_samples == 0 && new_connections.empty())
+        Sleep(0.01);
+    }
+    delete word_syms;
+    delete decode_fst;
+    return 0;
+#endif  // defined(__linux__)
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()
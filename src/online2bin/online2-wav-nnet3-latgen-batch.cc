@@ -0,0 +1,222 @@
+// online2bin/online2-wav-nnet3-latgen-batch.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/wave-reader.h"
+#include "online2/online-nnet3-batch-decoding.h"
+#include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/onlinebin-util.h"
+#include "online2/online-endpoint.h"
+#include "fstext/fstext-lib.h"
+#include "lat/lattice-functions.h"
+#include "util/kaldi-thread.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+
+// An utterance being decoded as one of the streams.
+struct Utterance {
+  Utterance(const std::string &utt, const WaveData &wave_data,
+            const OnlineNnet2FeaturePipelineInfo &feature_info):
+      utt(utt), wave_data(wave_data), feature_pipeline(feature_info),
+      samp_offset(0), stream(-1) { }
+
+  std::string utt;
+  WaveData wave_data;
+  OnlineNnet2FeaturePipeline feature_pipeline;
+  int32 samp_offset;
+  int32 stream;
+};
+
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Reads in wav file(s) and simulates a server decoding many concurrent\n"
+        "streams online with neural nets (nnet3 setup): up to --num-streams\n"
+        "utterances are fed a chunk of audio each in turn, and the next chunks\n"
+        "of the streams are computed together, by one looped computation per\n"
+        "group of streams that started together.  Each utterance is decoded\n"
+        "with the iVector adaptation state reset, as a separate client.\n"
+        "\n"
+        "Usage: online2-wav-nnet3-latgen-batch [options] <nnet3-in> <fst-in> "
+        "<wav-rspecifier> <lattice-wspecifier>\n";
+
+    ParseOptions po(usage);
+
+    OnlineNnet2FeaturePipelineConfig feature_opts;
+    nnet3::NnetSimpleLoopedComputationOptions decodable_opts;
+    LatticeFasterDecoderConfig decoder_opts;
+    OnlineEndpointConfig endpoint_opts;
+    OnlineNnet3BatchDecodingConfig batch_opts;
+
+    BaseFloat chunk_length_secs = 0.18;
+    int32 num_streams = 64;
+    bool do_endpointing = false;
+
+    po.Register("chunk-length", &chunk_length_secs,
+                "Length of the chunk of audio each stream is fed in turn, in "
+                "seconds.");
+    po.Register("num-streams", &num_streams,
+                "Number of utterances decoded concurrently.");
+    po.Register("do-endpointing", &do_endpointing,
+                "If true, apply endpoint detection");
+    po.Register("num-threads-startup", &g_num_threads,
+                "Number of threads used when initializing iVector extractor.");
+
+    feature_opts.Register(&po);
+    decodable_opts.Register(&po);
+    decoder_opts.Register(&po);
+    endpoint_opts.Register(&po);
+    batch_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4 || chunk_length_secs <= 0 || num_streams <= 0) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string nnet3_rxfilename = po.GetArg(1),
+        fst_rxfilename = po.GetArg(2),
+        wav_rspecifier = po.GetArg(3),
+        clat_wspecifier = po.GetArg(4);
+
+    OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
+
+    TransitionModel trans_model;
+    nnet3::AmNnetSimple am_nnet;
+    {
+      bool binary;
+      Input ki(nnet3_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+      SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
+      SetDropoutTestMode(true, &(am_nnet.GetNnet()));
+      nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
+    }
+
+    nnet3::DecodableNnetSimpleLoopedInfo decodable_info(decodable_opts,
+                                                        &am_nnet);
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldiGeneric(fst_rxfilename);
+
+    OnlineNnet3BatchDecoder decoder(batch_opts, decoder_opts, trans_model,
+                                    decodable_info, *decode_fst);
+
+    int32 num_done = 0, num_err = 0;
+    int64 num_frames = 0;
+    int64 num_stream_chunks = 0, num_batch_steps = 0;
+
+    SequentialTableReader<WaveHolder> wav_reader(wav_rspecifier);
+    CompactLatticeWriter clat_writer(clat_wspecifier);
+
+    std::vector<Utterance*> utterances;
+    Timer timer;
+    while (!wav_reader.Done() || !utterances.empty()) {
+      // new clients
+      for (; !wav_reader.Done() &&
+               static_cast<int32>(utterances.size()) < num_streams;
+           wav_reader.Next()) {
+        Utterance *utterance = new Utterance(wav_reader.Key(),
+                                             wav_reader.Value(), feature_info);
+        utterance->stream = decoder.AddStream(&(utterance->feature_pipeline));
+        utterances.push_back(utterance);
+      }
+
+      // each stream gets the next chunk of its audio
+      for (size_t i = 0; i < utterances.size(); i++) {
+        Utterance *utterance = utterances[i];
+        // get the data for channel zero (if the signal is not mono, we only
+        // take the first channel).
+        SubVector<BaseFloat> data(utterance->wave_data.Data(), 0);
+        BaseFloat samp_freq = utterance->wave_data.SampFreq();
+        if (utterance->samp_offset == data.Dim())
+          continue;
+        int32 chunk_length = std::max<int32>(1, samp_freq * chunk_length_secs),
+            num_samp = std::min(chunk_length,
+                                data.Dim() - utterance->samp_offset);
+        SubVector<BaseFloat> wave_part(data, utterance->samp_offset, num_samp);
+        utterance->feature_pipeline.AcceptWaveform(samp_freq, wave_part);
+        utterance->samp_offset += num_samp;
+        if (utterance->samp_offset == data.Dim()) {
+          // no more input. flush out last frames
+          utterance->feature_pipeline.InputFinished();
+        }
+      }
+
+      int32 num_chunks = decoder.AdvanceDecoding();
+      if (num_chunks > 0) {
+        num_stream_chunks += num_chunks;
+        num_batch_steps++;
+      }
+
+      // the streams that are done
+      std::vector<Utterance*> active;
+      for (size_t i = 0; i < utterances.size(); i++) {
+        Utterance *utterance = utterances[i];
+        int32 stream = utterance->stream;
+        if (!decoder.IsFinished(stream) &&
+            !(do_endpointing &&
+              decoder.EndpointDetected(stream, endpoint_opts))) {
+          active.push_back(utterance);
+          continue;
+        }
+        if (decoder.NumFramesDecoded(stream) == 0) {
+          KALDI_WARN << "No frames decoded for utterance " << utterance->utt;
+          num_err++;
+        } else {
+          decoder.FinalizeDecoding(stream);
+          CompactLattice clat;
+          bool end_of_utterance = true;
+          decoder.GetLattice(stream, end_of_utterance, &clat);
+          num_frames += decoder.NumFramesDecoded(stream);
+          // we want to output the lattice with un-scaled acoustics.
+          BaseFloat inv_acoustic_scale =
+              1.0 / decodable_opts.acoustic_scale;
+          ScaleLattice(AcousticLatticeScale(inv_acoustic_scale), &clat);
+          clat_writer.Write(utterance->utt, clat);
+          KALDI_LOG << "Decoded utterance " << utterance->utt;
+          num_done++;
+        }
+        decoder.RemoveStream(stream);
+        delete utterance;
+      }
+      utterances.swap(active);
+    }
+    double elapsed = timer.Elapsed();
+
+    KALDI_LOG << "Decoded " << num_done << " utterances, "
+              << num_err << " with errors.";
+    KALDI_LOG << "Decoded " << num_frames << " frames in " << elapsed
+              << " seconds; " << num_stream_chunks << " chunks of streams were "
+              << "computed in " << num_batch_steps << " steps";
+    delete decode_fst;
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()
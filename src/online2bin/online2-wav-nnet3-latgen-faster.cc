@@ -28,24 +28,15 @@
 #include "lat/lattice-functions.h"
 #include "util/kaldi-thread.h"
 #include "nnet3/nnet-utils.h"
+#include "util/const-integer-set.h"
 
 namespace kaldi {
 
-void GetDiagnosticsAndPrintOutput(const std::string &utt,
-                                  const fst::SymbolTable *word_syms,
-                                  const CompactLattice &clat,
-                                  int64 *tot_num_frames,
-                                  double *tot_like) {
-  if (clat.NumStates() == 0) {
-    KALDI_WARN << "Empty lattice.";
-    return;
-  }
-  CompactLattice best_path_clat;
-  CompactLatticeShortestPath(clat, &best_path_clat);
-
-  Lattice best_path_lat;
-  ConvertLattice(best_path_clat, &best_path_lat);
-
+void PrintBestPathDiagnostics(const std::string &utt,
+                              const fst::SymbolTable *word_syms,
+                              const Lattice &best_path_lat,
+                              int64 *tot_num_frames,
+                              double *tot_like) {
   double likelihood;
   LatticeWeight weight;
   int32 num_frames;
@@ -72,6 +63,55 @@ void GetDiagnosticsAndPrintOutput(const std::string &utt,
   }
 }
 
+void GetDiagnosticsAndPrintOutput(const std::string &utt,
+                                  const fst::SymbolTable *word_syms,
+                                  const CompactLattice &clat,
+                                  int64 *tot_num_frames,
+                                  double *tot_like) {
+  if (clat.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice.";
+    return;
+  }
+  CompactLattice best_path_clat;
+  CompactLatticeShortestPath(clat, &best_path_clat);
+
+  Lattice best_path_lat;
+  ConvertLattice(best_path_clat, &best_path_lat);
+  PrintBestPathDiagnostics(utt, word_syms, best_path_lat, tot_num_frames,
+                           tot_like);
+}
+
+// Writes the words of the best path to the ctm, with their confidences, as
+// lattice-to-ctm-conf does; the silence at the end of each word is trimmed
+// off.
+void WriteCtmFromDecoder(const std::string &utt,
+                         const LatticeFasterOnlineDecoder &decoder,
+                         const TransitionModel &trans_model,
+                         const ConstIntegerSet<int32> &silence_phones,
+                         BaseFloat frame_shift,
+                         std::ostream &os) {
+  std::vector<int32> words, alignment;
+  std::vector<std::pair<int32, int32> > times;
+  std::vector<BaseFloat> confidences;
+  bool use_final_probs = true;
+  if (!decoder.GetBestPathWordConfidences(use_final_probs, &words, &times,
+                                          &confidences, &alignment)) {
+    KALDI_WARN << "No best path for utterance " << utt;
+    return;
+  }
+  for (size_t i = 0; i < words.size(); i++) {
+    int32 begin = times[i].first, end = times[i].second;
+    while (end - 1 > begin &&
+           static_cast<size_t>(end - 1) < alignment.size() &&
+           silence_phones.count(
+               trans_model.TransitionIdToPhone(alignment[end - 1])))
+      end--;
+    os << utt << " 1 " << (frame_shift * begin) << ' '
+       << (frame_shift * (end - begin)) << ' ' << words[i] << ' '
+       << confidences[i] << '\n';
+  }
+}
+
 }
 
 int main(int argc, char *argv[]) {
@@ -89,13 +129,19 @@ int main(int argc, char *argv[]) {
         "set via config files whose filenames are passed as options\n"
         "\n"
         "Usage: online2-wav-nnet3-latgen-faster [options] <nnet3-in> <fst-in> "
-        "<spk2utt-rspecifier> <wav-rspecifier> <lattice-wspecifier>\n"
+        "<spk2utt-rspecifier> <wav-rspecifier> [<lattice-wspecifier>]\n"
         "The spk2utt-rspecifier can just be <utterance-id> <utterance-id> if\n"
-        "you want to decode utterance by utterance.\n";
+        "you want to decode utterance by utterance.\n"
+        "With --ctm-wxfilename, a ctm with confidences is written straight\n"
+        "from the decoder (see GetBestPathWordConfidences()), and\n"
+        "<lattice-wspecifier> may be left out, in which case no lattices are\n"
+        "made at all.\n";
 
     ParseOptions po(usage);
 
     std::string word_syms_rxfilename;
+    std::string ctm_wxfilename, silence_phones_str;
+    BaseFloat frame_shift = 0.01;
 
     // feature_opts includes configuration for the iVector adaptation,
     // as well as the basic features.
@@ -124,6 +170,15 @@ int main(int argc, char *argv[]) {
                 "--use-most-recent-ivector=true and --greedy-ivector-extractor=true "
                 "in the file given to --ivector-extraction-config, and "
                 "--chunk-length=-1.");
+    po.Register("ctm-wxfilename", &ctm_wxfilename,
+                "If set, write a ctm with word confidences, as from "
+                "lattice-to-ctm-conf but without making lattices, to this "
+                "file.");
+    po.Register("silence-phones", &silence_phones_str,
+                "Colon-separated list of silence phones, trimmed off the end "
+                "of the words in the --ctm-wxfilename output.");
+    po.Register("frame-shift", &frame_shift, "Time in seconds between the "
+                "input frames, for --ctm-wxfilename and --target-rtf.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
 
@@ -134,8 +189,11 @@ int main(int argc, char *argv[]) {
 
 
     po.Read(argc, argv);
+    // the decoder's frames are the subsampled ones.
+    decoder_opts.rtf_frame_shift =
+        frame_shift * decodable_opts.frame_subsampling_factor;
 
-    if (po.NumArgs() != 5) {
+    if (po.NumArgs() != 5 && !(po.NumArgs() == 4 && ctm_wxfilename != "")) {
       po.PrintUsage();
       return 1;
     }
@@ -144,7 +202,13 @@ int main(int argc, char *argv[]) {
         fst_rxfilename = po.GetArg(2),
         spk2utt_rspecifier = po.GetArg(3),
         wav_rspecifier = po.GetArg(4),
-        clat_wspecifier = po.GetArg(5);
+        clat_wspecifier = po.GetOptArg(5);
+
+    std::vector<int32> silence_phones;
+    if (!SplitStringToIntegers(silence_phones_str, ":", false,
+                               &silence_phones))
+      KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
+    ConstIntegerSet<int32> silence_phone_set(silence_phones);
 
     OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
 
@@ -187,7 +251,15 @@ int main(int argc, char *argv[]) {
 
     SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
     RandomAccessTableReader<WaveHolder> wav_reader(wav_rspecifier);
-    CompactLatticeWriter clat_writer(clat_wspecifier);
+    CompactLatticeWriter clat_writer;
+    if (clat_wspecifier != "")
+      clat_writer.Open(clat_wspecifier);
+    Output *ctm_output = NULL;
+    if (ctm_wxfilename != "") {
+      ctm_output = new Output(ctm_wxfilename, false);
+      ctm_output->Stream() << std::fixed;
+      ctm_output->Stream().precision(2);
+    }
 
     OnlineTimingStats timing_stats;
 
@@ -263,13 +335,36 @@ int main(int argc, char *argv[]) {
           }
         }
         decoder.FinalizeDecoding();
+        if (decoder_opts.target_rtf > 0.0)
+          decoder.Decoder().RtfStats().Print(utt, decoder_opts.rtf_frame_shift);
+
+        if (ctm_output != NULL)
+          WriteCtmFromDecoder(utt, decoder.Decoder(), trans_model,
+                              silence_phone_set,
+                              frame_shift *
+                              decodable_opts.frame_subsampling_factor,
+                              ctm_output->Stream());
 
-        CompactLattice clat;
         bool end_of_utterance = true;
-        decoder.GetLattice(end_of_utterance, &clat);
+        if (clat_wspecifier != "") {
+          CompactLattice clat;
+          decoder.GetLattice(end_of_utterance, &clat);
 
-        GetDiagnosticsAndPrintOutput(utt, word_syms, clat,
-                                     &num_frames, &tot_like);
+          GetDiagnosticsAndPrintOutput(utt, word_syms, clat,
+                                       &num_frames, &tot_like);
+
+          // we want to output the lattice with un-scaled acoustics.
+          BaseFloat inv_acoustic_scale =
+              1.0 / decodable_opts.acoustic_scale;
+          ScaleLattice(AcousticLatticeScale(inv_acoustic_scale), &clat);
+
+          clat_writer.Write(utt, clat);
+        } else {
+          Lattice best_path_lat;
+          decoder.GetBestPath(end_of_utterance, &best_path_lat);
+          PrintBestPathDiagnostics(utt, word_syms, best_path_lat,
+                                   &num_frames, &tot_like);
+        }
 
         decoding_timer.OutputStats(&timing_stats);
 
@@ -277,12 +372,6 @@ int main(int argc, char *argv[]) {
         // you felt the utterance had low confidence.  See lat/confidence.h
         feature_pipeline.GetAdaptationState(&adaptation_state);
 
-        // we want to output the lattice with un-scaled acoustics.
-        BaseFloat inv_acoustic_scale =
-            1.0 / decodable_opts.acoustic_scale;
-        ScaleLattice(AcousticLatticeScale(inv_acoustic_scale), &clat);
-
-        clat_writer.Write(utt, clat);
         KALDI_LOG << "Decoded utterance " << utt;
         num_done++;
       }
@@ -293,6 +382,7 @@ int main(int argc, char *argv[]) {
               << num_err << " with errors.";
     KALDI_LOG << "Overall likelihood per frame was " << (tot_like / num_frames)
               << " per frame over " << num_frames << " frames.";
+    delete ctm_output;
     delete decode_fst;
     delete word_syms; // will delete if non-NULL.
     return (num_done != 0 ? 0 : 1);
@@ -18,7 +18,8 @@
 from . import txp
 from . import vocoder
 from . import gen
+from . import synth
 
 from .voice import TangleVoice
 
-__all__ = ['gen', 'txp', 'vocoder']
+__all__ = ['gen', 'synth', 'txp', 'vocoder']
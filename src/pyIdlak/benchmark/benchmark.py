@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+""" End to end throughput and latency benchmark of a Tangle voice
+
+    Each category of the corpus (short prompts, long paragraphs and number
+    heavy text) is synthesised with each vocoder thread count, and the
+    results are written as JSON:
+
+        latency        seconds to synthesise a text with speak (p50, p99,
+                       mean, max)
+        first_audio    seconds until the first spurt from speak_spurts
+        rtf            synthesis time over audio length, end to end and for
+                       each stage from txp.stagestats
+        peak_rss_kb    high water mark of the process' resident memory
+
+    The DNNs run on the GPU with --use-gpu yes. A process can only select
+    a GPU once, so CPU and GPU results come from separate runs.
+"""
+
+import argparse
+import json
+import logging
+import os
+import platform
+import resource
+import sys
+import time
+
+here = os.path.abspath(os.path.dirname(__file__))
+
+sys.path.insert(0, os.path.join(here, '..', '..'))
+from pyIdlak import TangleVoice
+from pyIdlak import txp
+
+default_voice = os.path.join(here, '..', '..', '..', 'idlak-voices',
+                             'tangle', 'en', 'ga', 'slt')
+default_corpus = os.path.join(here, 'corpus.json')
+
+
+def percentile(values, p):
+    """ Nearest rank percentile of a list of numbers """
+    values = sorted(values)
+    if not values:
+        return 0.
+    rank = max(1, (p * len(values) + 99) // 100)
+    return values[min(rank, len(values)) - 1]
+
+
+def summary(values):
+    return {'p50': percentile(values, 50), 'p99': percentile(values, 99),
+            'mean': sum(values) / len(values) if values else 0.,
+            'max': max(values) if values else 0.}
+
+
+def peak_rss_kb():
+    """ Peak resident memory of the process (ru_maxrss is in bytes on
+        macOS and kilobytes elsewhere) """
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    if sys.platform == 'darwin':
+        rss //= 1024
+    return rss
+
+
+def time_to_first_audio(voice, text):
+    start = time.perf_counter()
+    spurts = voice.speak_spurts(text)
+    next(spurts, None)
+    elapsed = time.perf_counter() - start
+    spurts.close()
+    return elapsed
+
+
+def run_category(voice, texts, repeats):
+    """ Benchmark the texts of one category with the voice as it is set up
+
+        Returns:
+            (dict): the results of the category
+    """
+    txp.stagestats.reset()
+    latencies = []
+    rtfs = []
+    audio_seconds = 0.
+    for _ in range(repeats):
+        for text in texts:
+            start = time.perf_counter()
+            waveform = voice.speak(text)
+            elapsed = time.perf_counter() - start
+            seconds = len(waveform) / float(voice.srate)
+            latencies.append(elapsed)
+            if seconds > 0.:
+                rtfs.append(elapsed / seconds)
+            audio_seconds += seconds
+    stagestats = txp.stagestats.stats()
+
+    first_audio = [time_to_first_audio(voice, text)
+                   for _ in range(repeats) for text in texts]
+
+    stages = {}
+    for stage, stat in sorted(stagestats['stages'].items()):
+        stages[stage] = {
+            'calls': stat['calls'], 'seconds': stat['seconds'],
+            'rtf': (stat['seconds'] / audio_seconds if audio_seconds
+                    else 0.)}
+        if stat['unit']:
+            stages[stage]['items'] = stat['items']
+            stages[stage]['unit'] = stat['unit']
+    return {'texts': len(texts), 'repeats': repeats,
+            'audio_seconds': audio_seconds,
+            'synthesis_seconds': sum(latencies),
+            'rtf': (sum(latencies) / audio_seconds if audio_seconds else 0.),
+            'utterance_rtf': summary(rtfs),
+            'latency': summary(latencies),
+            'first_audio': summary(first_audio),
+            'stages': stages,
+            'peak_rss_kb': peak_rss_kb()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description = __doc__.split('\n')[0])
+    parser.add_argument('--voice', default = default_voice,
+                        help = 'voice directory')
+    parser.add_argument('--corpus', default = default_corpus,
+                        help = 'JSON file of lists of texts by category')
+    parser.add_argument('--categories', default = '',
+                        help = 'comma separated categories to run, '
+                               'default all')
+    parser.add_argument('--threads', default = '1,0',
+                        help = 'comma separated vocoder thread counts '
+                               '(0 for one per core)')
+    parser.add_argument('--use-gpu', default = 'no',
+                        help = "nnet-forward's --use-gpu for the DNNs")
+    parser.add_argument('--repeats', type = int, default = 3,
+                        help = 'times each text is synthesised')
+    parser.add_argument('--output', default = '-',
+                        help = 'JSON output file, - for stdout')
+    args = parser.parse_args()
+
+    with open(args.corpus) as fin:
+        corpus = json.load(fin)
+    categories = ([c for c in args.categories.split(',') if c]
+                  or sorted(corpus))
+    for category in categories:
+        if category not in corpus:
+            parser.error('no category {0} in {1}'.format(category,
+                                                         args.corpus))
+    threads = [int(t) for t in args.threads.split(',') if t]
+
+    rss_before = peak_rss_kb()
+    start = time.perf_counter()
+    voice = TangleVoice(use_gpu = args.use_gpu, loglvl = logging.ERROR)
+    voice.load_voice(args.voice)
+    load_seconds = time.perf_counter() - start
+
+    # the first synthesis compiles the regular expressions and allocates the
+    # model buffers, it is not part of the results
+    start = time.perf_counter()
+    voice.speak(corpus[categories[0]][0])
+    warmup_seconds = time.perf_counter() - start
+
+    results = {'voice': os.path.abspath(args.voice),
+               'corpus': os.path.abspath(args.corpus),
+               'use_gpu': args.use_gpu,
+               'host': platform.node(), 'cpus': os.cpu_count(),
+               'python': platform.python_version(),
+               'load_seconds': load_seconds,
+               'warmup_seconds': warmup_seconds,
+               'load_rss_kb': peak_rss_kb() - rss_before,
+               'runs': []}
+    for num_threads in threads:
+        voice.vocoder_threads = num_threads
+        run = {'vocoder_threads': num_threads, 'categories': {}}
+        for category in categories:
+            run['categories'][category] = run_category(
+                voice, corpus[category], args.repeats)
+        results['runs'].append(run)
+
+    if args.output == '-':
+        json.dump(results, sys.stdout, indent = 2, sort_keys = True)
+        sys.stdout.write('\n')
+    else:
+        with open(args.output, 'w') as fout:
+            json.dump(results, fout, indent = 2, sort_keys = True)
+            fout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
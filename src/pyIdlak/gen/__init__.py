@@ -20,3 +20,4 @@ from .cex import (CEXParser, cex_to_feat, load_cexfreqtable, save_cexfreqtable,
                  feat_to_ark)
 
 from .nnet import NNet
+from .batcher import NNetBatcher
@@ -0,0 +1,220 @@
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+""" Dynamic batching of forward passes from several threads
+
+    Requests that each need a forward pass through the same model are
+    queued and run together, so concurrent requests share one pass with a
+    larger batch instead of competing with many small ones. A batch is run
+    once it has max_batch_frames frames or its oldest request has waited
+    max_delay seconds. This plays the part of nnet3's NnetBatchComputer for
+    the nnet1 TTS models.
+"""
+
+import collections
+import os
+import threading
+import time
+import weakref
+
+
+class _Task:
+    """ One call to forward_batch waiting for its output """
+    def __init__(self, features_list):
+        self.features_list = features_list
+        self.frames = sum(len(features) for features in features_list)
+        self.queued = time.time()
+        self.done = threading.Event()
+        self.output = None
+        self.error = None
+
+
+class _BatchQueue:
+    """ State shared with the worker thread, kept apart from NNetBatcher so
+        that the batcher can be garbage collected while the worker runs """
+    def __init__(self, nnet, max_batch_frames, max_delay):
+        self.nnet = nnet
+        self.max_batch_frames = max_batch_frames
+        self.max_delay = max_delay
+        self.queue = collections.deque()
+        self.cond = threading.Condition()
+        self.closed = False
+        self.stats = {'batches': 0, 'requests': 0, 'frames': 0,
+                      'max_queue_depth': 0, 'queue_time': 0.,
+                      'forward_time': 0.}
+
+
+    def next_batch(self):
+        """ Waits for a batch to be ready, None once closed and empty """
+        with self.cond:
+            while True:
+                if self.queue:
+                    frames = sum(task.frames for task in self.queue)
+                    wait = self.queue[0].queued + self.max_delay - time.time()
+                    if frames >= self.max_batch_frames or wait <= 0 or self.closed:
+                        break
+                    self.cond.wait(wait)
+                elif self.closed:
+                    return None
+                else:
+                    self.cond.wait()
+            # always take the oldest request even if it is over the limit
+            batch = [self.queue.popleft()]
+            frames = batch[0].frames
+            while (self.queue and
+                   frames + self.queue[0].frames <= self.max_batch_frames):
+                task = self.queue.popleft()
+                frames += task.frames
+                batch.append(task)
+            return batch
+
+
+    def run(self):
+        while True:
+            batch = self.next_batch()
+            if batch is None:
+                return
+            start = time.time()
+            features_list = [features for task in batch
+                             for features in task.features_list]
+            try:
+                outputs = self.nnet.forward_batch(features_list)
+                error = None
+            except Exception as e:
+                error = e
+            end = time.time()
+            offset = 0
+            for task in batch:
+                if error is None:
+                    task.output = outputs[offset:offset + len(task.features_list)]
+                    offset += len(task.features_list)
+                task.error = error
+                task.done.set()
+            with self.cond:
+                self.stats['batches'] += 1
+                self.stats['requests'] += len(batch)
+                self.stats['frames'] += sum(task.frames for task in batch)
+                self.stats['queue_time'] += sum(start - task.queued
+                                                for task in batch)
+                self.stats['forward_time'] += end - start
+
+
+# batchers whose worker has to be restarted in a forked child
+_batchers = weakref.WeakSet()
+
+
+def _restart_after_fork():
+    """ Threads do not survive fork, a child process gets a new worker and
+        condition for each batcher. Requests queued in the parent are
+        dropped, they belong to the parent's threads """
+    for batcher in list(_batchers):
+        batcher._start()
+
+
+if hasattr(os, 'register_at_fork'):
+    os.register_at_fork(after_in_child = _restart_after_fork)
+
+
+class NNetBatcher:
+    """ Runs the forward passes of a NNet for several threads in batches
+
+        The model is only used from the batcher's worker thread, so it can be
+        shared by threads which would otherwise need exclusive use of it.
+        forward and forward_batch are the same as NNet's.
+    """
+    def __init__(self, nnet, max_batch_frames = 4096, max_delay = 0.005):
+        if max_batch_frames <= 0:
+            raise ValueError("max_batch_frames must be positive")
+        if max_delay < 0:
+            raise ValueError("max_delay must not be negative")
+        self._queue = _BatchQueue(nnet, max_batch_frames, max_delay)
+        self._start()
+        _batchers.add(self)
+
+
+    def _start(self):
+        queue = self._queue
+        if queue.closed:
+            return
+        queue.queue = collections.deque()
+        queue.cond = threading.Condition()
+        self._worker = threading.Thread(target = queue.run,
+                                        daemon = True, name = 'NNetBatcher')
+        self._worker.start()
+
+
+    def __del__(self):
+        self.close()
+
+
+    @property
+    def nnet(self):
+        """ The model being batched """
+        return self._queue.nnet
+
+
+    @property
+    def max_batch_frames(self):
+        return self._queue.max_batch_frames
+
+
+    @property
+    def max_delay(self):
+        return self._queue.max_delay
+
+
+    def close(self):
+        """ Stop the worker once the queued requests have run """
+        queue = getattr(self, '_queue', None)
+        if queue is None:
+            return
+        with queue.cond:
+            queue.closed = True
+            queue.cond.notify_all()
+
+
+    def forward(self, features_in):
+        return self.forward_batch([features_in])[0]
+
+
+    def forward_batch(self, features_list):
+        """ Queues the sequences and waits for their output """
+        task = _Task(list(features_list))
+        if not task.frames:
+            return [[] for features in task.features_list]
+        queue = self._queue
+        with queue.cond:
+            if queue.closed:
+                raise RuntimeError("batcher has been closed")
+            queue.queue.append(task)
+            queue.stats['max_queue_depth'] = max(
+                queue.stats['max_queue_depth'], len(queue.queue))
+            queue.cond.notify_all()
+        task.done.wait()
+        if task.error is not None:
+            raise task.error
+        return task.output
+
+
+    def stats(self):
+        """ Number of batches, requests and frames run, the current and
+            largest number of queued requests, and the total seconds
+            requests spent queued and in forward passes """
+        queue = self._queue
+        with queue.cond:
+            ret = dict(queue.stats)
+            ret['queue_depth'] = len(queue.queue)
+        return ret
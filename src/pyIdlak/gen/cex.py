@@ -35,7 +35,7 @@ class CEXParser:
         self.log = logging.getLogger('cexparse')
         if type(cexspec) == str:
             _cexspec = etree.parse(cexspec)
-        elif (type(cexspec) not in [etree._Element, etree._ElementTree]):
+        elif not _is_element(cexspec):
             raise ValueError('CEX spec', type(cexspec), 'is not an etree element or string')
         else:
             _cexspec = cexspec
@@ -58,7 +58,7 @@ class CEXParser:
             the the strings in pron tags contain valid phone information
             in either Kaldi or HTS form
         """
-        if (type(xml) not in [etree._Element, etree._ElementTree]):
+        if not _is_element(xml):
             raise ValueError('CEX spec is not an etree element or string')
 
         self._parse_err = False
@@ -288,6 +288,12 @@ class CEXParser:
 
 ###############################################################
 
+def _is_element(xml):
+    """ lxml elements, or the elements of a txp XMLDoc """
+    from .. import txp
+    return type(xml) in [etree._Element, etree._ElementTree, txp.XMLNode]
+
+
 def load_cexfreqtable(fname):
     """ Loads a Context Feature frequency table """
     with open(fname) as fp:
@@ -307,9 +313,10 @@ def cex_to_feat(doc, cexfreqtable):
     if not type(doc) == txp.XMLDoc:
         raise ValueError("doc must be a txp XMLDoc")
 
-    xmlparser = etree.XMLParser(encoding = 'utf8')
-    xml = etree.fromstring(doc.to_string(), parser = xmlparser)
-
+    # read from the document itself rather than saving and parsing it again
+    xml = doc.root
+    if xml is None:
+        raise ValueError("doc is empty")
     cex_parser = CEXParser(xml)
     cex_features = cex_parser.parse(xml)
 
@@ -30,8 +30,12 @@ class NNet:
                     input_transform = False,
                     out_cmvn_speaker_mat = False, out_cmvn_speaker_opts = False,
                     out_cmvn_global_mat = False, out_cmvn_global_opts = False,
-                    loglvl = logging.WARN):
-        """ Load a NNet model """
+                    use_gpu = 'no', loglvl = logging.WARN):
+        """ Load a NNet model
+
+            use_gpu is as nnet-forward's --use-gpu (no, yes, optional or
+            wait), the GPU is selected by the first model to load
+        """
         logging.basicConfig(level = loglvl)
         self.log = logging.getLogger('pynnet')
         self.log.debug('Initialising NNet')
@@ -49,6 +53,9 @@ class NNet:
         self._fwd_opts.set('model-filename', nnet_model_fn)
         self._fwd_opts.set('reverse-transform', True)
         self._fwd_opts.set('feature-transform', self._feat_transform_fn)
+        self._fwd_opts.set('use-gpu', use_gpu)
+        self._model = None
+        self._in_transform_model = None
 
         self.log.debug('Loading options')
         # Pre-processing options
@@ -75,6 +82,7 @@ class NNet:
             self._in_transform_opts = pylib.PyOptions(
                 pylib.PdfPriorOptions, pylib.NnetForwardOptions)
             self._in_transform_opts.set("model-filename", input_transform)
+            self._in_transform_model = self._load_model(self._in_transform_opts)
         else:
             self._in_transform = False
 
@@ -101,40 +109,140 @@ class NNet:
         else:
             self._out_cmvn_global_mat = False
 
+        self.log.debug('Loading model')
+        self._model = self._load_model(self._fwd_opts)
+        self._fuse_processing()
+
+
+    def __del__(self):
+        """ Free the loaded models """
+        if getattr(self, '_model', None) is not None:
+            pyIdlak_gen.PyNnetModel_delete(self._model)
+            self._model = None
+        if getattr(self, '_in_transform_model', None) is not None:
+            pyIdlak_gen.PyNnetModel_delete(self._in_transform_model)
+            self._in_transform_model = None
+
 
     def forward(self, features_in):
         """ Runs a forward pass through the features """
-        mat = pylib.PyKaldiMatrixBaseFloat_frmlist(features_in)
+        return self.forward_batch([features_in])[0]
 
-        if self._in_delta_opts:
-            self.log.debug('Applying deltas on labels')
-            mat = pyIdlak_gen.PyAddDeltas(self._in_delta_opts.kaldiopts, mat)
 
-        if self._in_cmvn_global_mat:
-            self.log.debug('Applying global cmvn on labels')
-            mat = pyIdlak_gen.PyApplyCMVN(self._in_cmvn_global_opts.kaldiopts,
-                 mat, self._in_cmvn_global_mat)
+    def forward_batch(self, features_list):
+        """ Runs a single forward pass over several sequences of features
+
+            The frames of all the sequences are stacked into one matrix so
+            the network is only run once, the output is split back into a
+            list with one entry per input sequence.
+        """
+        lengths = [len(features) for features in features_list]
+        if not sum(lengths):
+            return [[] for features in features_list]
+        rows = [row for features in features_list for row in features]
+        mat = self.forward_matrix(pylib.PyKaldiMatrixBaseFloat_frmlist(rows),
+                                  lengths)
+        return _split_rows(pylib.PyKaldiMatrixBaseFloat_tolist(mat), lengths)
+
+
+    def forward_matrix(self, mat, lengths):
+        """ As forward_batch on a kaldi matrix of the sequences stacked by
+            row, lengths gives the number of rows of each. Returns the
+            output as a kaldi matrix """
+        if self._in_delta_opts and not self._in_deltas_fused:
+            # deltas look across frames so are computed for each sequence
+            self.log.debug('Applying deltas on labels')
+            rows = []
+            for features in _split_rows(
+                    pylib.PyKaldiMatrixBaseFloat_tolist(mat), lengths):
+                if not features:
+                    continue
+                seqmat = pylib.PyKaldiMatrixBaseFloat_frmlist(features)
+                seqmat = pyIdlak_gen.PyAddDeltas(self._in_delta_opts.kaldiopts,
+                                                 seqmat)
+                rows.extend(pylib.PyKaldiMatrixBaseFloat_tolist(seqmat))
+            mat = pylib.PyKaldiMatrixBaseFloat_frmlist(rows)
+        mat = self._apply_in_cmvn(mat)
 
         if self._in_transform:
             self.log.debug('Applying feature transform on labels')
-            mat = pyIdlak_gen.PyGenNnetForwardPass(
-                self._in_transform_opts.kaldiopts, mat)
+            mat = pyIdlak_gen.PyNnetModel_ForwardBatch(
+                self._in_transform_model, mat, lengths)
+            if mat is None:
+                raise RuntimeError("forward pass failed for input transform: " +
+                                   self._in_transform)
 
         self.log.debug('Forward DNN pass')
-        mat = pyIdlak_gen.PyGenNnetForwardPass(self._fwd_opts.kaldiopts, mat)
+        mat = pyIdlak_gen.PyNnetModel_ForwardBatch(self._model, mat, lengths)
+        if mat is None:
+            raise RuntimeError("forward pass failed for model: " +
+                               self._nnet_model_fn)
+
+        return self._apply_out_cmvn(mat)
+
+
+    def stream(self, num_streams):
+        """ A NNetStream running this network over num_streams sequences """
+        return NNetStream(self, num_streams)
+
+
+    def _fuse_processing(self):
+        """ Moves the deltas and the CMVN into the forward passes of the
+            models: the deltas go straight into the input buffer and the
+            CMVN is folded into the first and last layers. What does not fit
+            the models stays in Python, keeping the order of the steps. """
+        first = (self._in_transform_model if self._in_transform
+                 else self._model)
+        self._in_deltas_fused = bool(self._in_delta_opts) and \
+            pyIdlak_gen.PyNnetModel_SetInputDeltas(
+                first, self._in_delta_opts.kaldiopts)
+        self._in_cmvn_fused = bool(self._in_cmvn_global_mat) and \
+            (self._in_deltas_fused or not self._in_delta_opts) and \
+            pyIdlak_gen.PyNnetModel_AddInputCmvn(
+                first, self._in_cmvn_global_opts.kaldiopts,
+                self._in_cmvn_global_mat)
+        self._out_cmvn_speaker_fused = bool(self._out_cmvn_speaker_mat) and \
+            pyIdlak_gen.PyNnetModel_AddOutputCmvn(
+                self._model, self._out_cmvn_speaker_opts.kaldiopts,
+                self._out_cmvn_speaker_mat)
+        self._out_cmvn_global_fused = bool(self._out_cmvn_global_mat) and \
+            (self._out_cmvn_speaker_fused or not self._out_cmvn_speaker_mat) \
+            and pyIdlak_gen.PyNnetModel_AddOutputCmvn(
+                self._model, self._out_cmvn_global_opts.kaldiopts,
+                self._out_cmvn_global_mat)
+
+
+    def _apply_in_cmvn(self, mat):
+        """ Global cmvn on the input frames, if there is one """
+        if self._in_cmvn_global_mat and not self._in_cmvn_fused:
+            self.log.debug('Applying global cmvn on labels')
+            mat = pyIdlak_gen.PyApplyCMVN(self._in_cmvn_global_opts.kaldiopts,
+                 mat, self._in_cmvn_global_mat)
+        return mat
+
 
+    def _apply_out_cmvn(self, mat):
+        """ Reversed speaker and global cmvn on the output frames """
         ## "Applying (reversed) fmllr transformation per-speaker"
-        if self._out_cmvn_speaker_mat:
+        if self._out_cmvn_speaker_mat and not self._out_cmvn_speaker_fused:
             self.log.debug('Applying (reversed) per-speaker cmvn on output features')
             mat = pyIdlak_gen.PyApplyCMVN(self._out_cmvn_speaker_opts.kaldiopts,
                  mat, self._out_cmvn_speaker_mat)
 
-        if self._out_cmvn_global_mat:
+        if self._out_cmvn_global_mat and not self._out_cmvn_global_fused:
             self.log.debug('Applying (reversed) global cmvn on output feature')
             mat = pyIdlak_gen.PyApplyCMVN(self._out_cmvn_global_opts.kaldiopts,
                  mat, self._out_cmvn_global_mat)
+        return mat
 
-        return pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+
+    def _load_model(self, pyopts):
+        """ Load a DNN model once so it can be reused for every forward pass """
+        model = pyIdlak_gen.PyNnetModel_new(pyopts.kaldiopts)
+        if model is None:
+            raise IOError("cannot load model: " +
+                          pyopts.get('model-filename'))
+        return model
 
 
     def _load_delta(self, pyopts, delta_opts):
@@ -175,3 +283,90 @@ class NNet:
         if val.startswith('--'): # catches flags
             return 'true'
         return val
+
+
+
+class NNetStream:
+    def __init__(self, nnet, num_streams):
+        """ Runs a unidirectional (LSTM) NNet over num_streams sequences at
+            once, a chunk of frames of each at a time, keeping the state of
+            each stream between chunks.
+
+            The output of a sequence fed in chunks is the same as NNet.forward
+            on the whole of it, so synthesis can start before all the input
+            of a sentence is known. Deltas of the input look across frames
+            and cannot be streamed.
+        """
+        if nnet._in_delta_opts:
+            raise ValueError('cannot stream a network with input deltas')
+        self._nnet = nnet
+        self._num_streams = num_streams
+        self._in_transform_stream = None
+        if nnet._in_transform:
+            self._in_transform_stream = self._new_stream(
+                nnet._in_transform_model, nnet._in_transform)
+        self._stream = self._new_stream(nnet._model, nnet._nnet_model_fn)
+
+
+    def __del__(self):
+        """ Free the stream states """
+        for name in ['_stream', '_in_transform_stream']:
+            if getattr(self, name, None) is not None:
+                pyIdlak_gen.PyNnetStream_delete(getattr(self, name))
+                setattr(self, name, None)
+
+
+    def reset(self, s):
+        """ Starts a new sequence on stream s, from its next chunk """
+        if s < 0 or s >= self._num_streams:
+            raise IndexError('no stream {0}'.format(s))
+        pyIdlak_gen.PyNnetStream_Reset(self._stream, s)
+        if self._in_transform_stream is not None:
+            pyIdlak_gen.PyNnetStream_Reset(self._in_transform_stream, s)
+
+
+    def forward(self, chunks):
+        """ Runs the next chunk of every stream through the network
+
+            chunks has one list of frames per stream, empty for a stream
+            that is idle this step. All the streams go through the network
+            in one pass; the output has one list of frames per stream.
+        """
+        if len(chunks) != self._num_streams:
+            raise ValueError('{0} chunks for {1} streams'.format(
+                len(chunks), self._num_streams))
+        lengths = [len(chunk) for chunk in chunks]
+        if not sum(lengths):
+            return [[] for chunk in chunks]
+
+        rows = [row for chunk in chunks for row in chunk]
+        mat = self._nnet._apply_in_cmvn(pylib.PyKaldiMatrixBaseFloat_frmlist(rows))
+        if self._in_transform_stream is not None:
+            mat = pyIdlak_gen.PyNnetStream_Forward(
+                self._in_transform_stream, mat, lengths)
+            if mat is None:
+                raise RuntimeError("forward pass failed for input transform: " +
+                                   self._nnet._in_transform)
+        mat = pyIdlak_gen.PyNnetStream_Forward(self._stream, mat, lengths)
+        if mat is None:
+            raise RuntimeError("forward pass failed for model: " +
+                               self._nnet._nnet_model_fn)
+        mat = self._nnet._apply_out_cmvn(mat)
+        return _split_rows(pylib.PyKaldiMatrixBaseFloat_tolist(mat), lengths)
+
+
+    def _new_stream(self, model, model_fn):
+        stream = pyIdlak_gen.PyNnetStream_new(model, self._num_streams)
+        if stream is None:
+            raise ValueError("cannot stream model: " + model_fn)
+        return stream
+
+
+def _split_rows(rows, lengths):
+    """ Splits stacked rows back into a list of the given lengths """
+    outputs = []
+    offset = 0
+    for length in lengths:
+        outputs.append(rows[offset:offset + length])
+        offset += length
+    return outputs
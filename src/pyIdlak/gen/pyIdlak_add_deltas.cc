@@ -31,7 +31,7 @@
 #include "python-gen-api.h"
 
 kaldi::Matrix<kaldi::BaseFloat> * PyAddDeltas(PySimpleOptions * pyopts,
-    const kaldi::Matrix<kaldi::BaseFloat> &input) {
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input) {
 
   if (!pyopts)
     throw std::invalid_argument("PyAddDeltas called without options.");
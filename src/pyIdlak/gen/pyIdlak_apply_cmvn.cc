@@ -31,8 +31,8 @@
 #include "python-gen-api.h"
 
 kaldi::Matrix<kaldi::BaseFloat> * PyApplyCMVN(PySimpleOptions * pyopts,
-    const kaldi::Matrix<kaldi::BaseFloat> &input,
-    const kaldi::Matrix<double> &cmvn_stats) {
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const kaldi::MatrixBase<double> &cmvn_stats) {
 
   if (!pyopts)
     throw std::invalid_argument("PyApplyCMVN called without options.");
@@ -0,0 +1,181 @@
+// pyIdlak/gen/pyIdlak_combine_durations.cc
+// Copyright 2018 CereProc Ltd.  (Authors: David Braude
+//                                         Matthew Aylett
+//                                         Skaiste Butkute)
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+
+#include "pyIdlak/pylib/pyIdlak_internal.h"
+#include "python-gen-api.h"
+
+// Number of columns appended to the phone features for each frame:
+// state index, state duration, fuzzy state position, phone duration and
+// fuzzy phone position.
+static const kaldi::int32 kNumPositionFeatures = 5;
+
+// Same as TangleVoice._fuzzy_position
+static inline kaldi::BaseFloat FuzzyPosition(double fuzzy_factor,
+                                             kaldi::int32 position,
+                                             kaldi::int32 duration) {
+  double real_position = static_cast<double>(position) / duration;
+  return static_cast<kaldi::BaseFloat>(std::ceil(real_position / fuzzy_factor));
+}
+
+kaldi::Matrix<kaldi::BaseFloat> * PyCombineDurationsAndFeatures(
+    const kaldi::MatrixBase<kaldi::BaseFloat> &phone_features,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &state_durations,
+    double state_pos_fuzz, double phone_pos_fuzz) {
+  using kaldi::int32;
+  using kaldi::BaseFloat;
+
+  if (phone_features.NumRows() != state_durations.NumRows()) {
+    KALDI_WARN << "PyCombineDurationsAndFeatures has " << phone_features.NumRows()
+               << " phones of features but " << state_durations.NumRows()
+               << " phones of durations";
+    return nullptr;
+  }
+  if (state_pos_fuzz <= 0.0 || phone_pos_fuzz <= 0.0) {
+    KALDI_WARN << "PyCombineDurationsAndFeatures fuzzy factors must be positive";
+    return nullptr;
+  }
+
+  int32 num_phones = state_durations.NumRows(),
+      num_states = state_durations.NumCols(),
+      feat_dim = phone_features.NumCols();
+
+  // durations are whole frames, validate them and count the output rows
+  int32 num_frames = 0;
+  for (int32 p = 0; p < num_phones; p++) {
+    for (int32 s = 0; s < num_states; s++) {
+      BaseFloat dur = state_durations(p, s);
+      if (dur < 0.0 || dur != std::floor(dur)) {
+        KALDI_WARN << "PyCombineDurationsAndFeatures invalid duration " << dur
+                   << " for state " << s << " of phone " << p;
+        return nullptr;
+      }
+      num_frames += static_cast<int32>(dur);
+    }
+  }
+
+  auto output = new kaldi::Matrix<BaseFloat>(num_frames,
+                                             feat_dim + kNumPositionFeatures,
+                                             kaldi::kUndefined);
+  int32 frame = 0;
+  for (int32 p = 0; p < num_phones; p++) {
+    const BaseFloat *phone_feats = phone_features.RowData(p);
+    int32 phone_dur = 0;
+    for (int32 s = 0; s < num_states; s++)
+      phone_dur += static_cast<int32>(state_durations(p, s));
+
+    int32 phone_pos = 0;  // running frame position within the phone
+    for (int32 s = 0; s < num_states; s++) {
+      int32 state_dur = static_cast<int32>(state_durations(p, s));
+      for (int32 state_pos = 0; state_pos < state_dur;
+           state_pos++, phone_pos++, frame++) {
+        BaseFloat *row = output->RowData(frame);
+        std::copy(phone_feats, phone_feats + feat_dim, row);
+        row += feat_dim;
+        row[0] = s;
+        row[1] = state_dur;
+        row[2] = FuzzyPosition(state_pos_fuzz, state_pos, state_dur);
+        row[3] = phone_dur;
+        row[4] = FuzzyPosition(phone_pos_fuzz, phone_pos, phone_dur);
+      }
+    }
+  }
+  return output;
+}
+
+kaldi::Matrix<kaldi::BaseFloat> * PyAddStateFeature(
+    const kaldi::MatrixBase<kaldi::BaseFloat> &phone_features,
+    int num_states) {
+  using kaldi::int32;
+  using kaldi::BaseFloat;
+
+  if (num_states <= 0) {
+    KALDI_WARN << "PyAddStateFeature number of states must be positive";
+    return nullptr;
+  }
+  int32 num_phones = phone_features.NumRows(),
+      feat_dim = phone_features.NumCols();
+  auto output = new kaldi::Matrix<BaseFloat>(num_phones * num_states,
+                                             feat_dim + 1, kaldi::kUndefined);
+  for (int32 p = 0; p < num_phones; p++) {
+    const BaseFloat *phone_feats = phone_features.RowData(p);
+    for (int32 s = 0; s < num_states; s++) {
+      BaseFloat *row = output->RowData(p * num_states + s);
+      std::copy(phone_feats, phone_feats + feat_dim, row);
+      row[feat_dim] = s;
+    }
+  }
+  return output;
+}
+
+kaldi::Matrix<kaldi::BaseFloat> * PyPostDurationProcessing(
+    const kaldi::MatrixBase<kaldi::BaseFloat> &durations, int num_states) {
+  using kaldi::int32;
+  using kaldi::BaseFloat;
+
+  if (num_states <= 0 || durations.NumRows() % num_states != 0 ||
+      durations.NumCols() < 2) {
+    KALDI_WARN << "PyPostDurationProcessing needs " << num_states
+               << " rows per phone and at least two columns, got "
+               << durations.NumRows() << " x " << durations.NumCols();
+    return nullptr;
+  }
+  const int32 state_col = 0, phone_col = 1;
+  int32 num_phones = durations.NumRows() / num_states;
+  auto output = new kaldi::Matrix<BaseFloat>(num_phones, num_states,
+                                             kaldi::kUndefined);
+  std::vector<double> state_durs(num_states);
+  for (int32 p = 0; p < num_phones; p++) {
+    double mean_phone = 0.0, total_states = 0.0;
+    for (int32 s = 0; s < num_states; s++) {
+      const BaseFloat *row = durations.RowData(p * num_states + s);
+      state_durs[s] = std::max<double>(row[state_col], 0.0);
+      total_states += state_durs[s];
+      mean_phone += row[phone_col];
+    }
+    mean_phone = std::max(mean_phone / num_states, 0.0);
+
+    // if all the state durations are zero then only the first and last
+    // states get a frame, avoiding a division by zero
+    if (total_states > 0.0 && mean_phone > 0.0) {
+      double ratio = std::ceil((mean_phone + total_states) / 2) / total_states;
+      for (int32 s = 0; s < num_states; s++)
+        state_durs[s] = std::ceil(state_durs[s] * ratio);
+    } else {
+      KALDI_WARN << "In phone: " << p
+                 << (total_states == 0.0 ? " all states have 0 duration" : "")
+                 << (mean_phone == 0.0 ? " mean phone duration is 0" : "");
+    }
+    // the first and last states model the transitions so need at least
+    // one frame
+    state_durs[0] = std::max(state_durs[0], 1.0);
+    state_durs[num_states - 1] = std::max(state_durs[num_states - 1], 1.0);
+    for (int32 s = 0; s < num_states; s++)
+      (*output)(p, s) = state_durs[s];
+  }
+  return output;
+}
@@ -25,4 +25,18 @@
 #include "python-gen-api.h"
 %}
 
+%idlak_allow_threads(PyNnetModel_new)
+%idlak_allow_threads(PyNnetModel_Forward)
+%idlak_allow_threads(PyNnetModel_ForwardBatch)
+%idlak_allow_threads(PyNnetModel_AddInputCmvn)
+%idlak_allow_threads(PyNnetModel_AddOutputCmvn)
+%idlak_allow_threads(PyNnetStream_new)
+%idlak_allow_threads(PyNnetStream_Forward)
+%idlak_allow_threads(PyGenNnetForwardPass)
+%idlak_allow_threads(PyApplyCMVN)
+%idlak_allow_threads(PyAddDeltas)
+%idlak_allow_threads(PyCombineDurationsAndFeatures)
+%idlak_allow_threads(PyAddStateFeature)
+%idlak_allow_threads(PyPostDurationProcessing)
+
 %include "python-gen-api.h"
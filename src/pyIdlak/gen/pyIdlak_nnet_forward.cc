@@ -21,69 +21,178 @@
 #include <cfloat>
 #include <string>
 #include <stdexcept>
+#include <mutex>
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cu-vector.h"
+#include "feat/feature-functions.h"
+#include "nnet/nnet-inference-plan.h"
+#include "nnet/nnet-multistream-forward.h"
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-loss.h"
 #include "nnet/nnet-pdf-prior.h"
+#include "nnet/nnet-various.h"
 
 #include "pyIdlak/pylib/pyIdlak_internal.h"
 #include "matrix/matrix-lib.h"
 #include "python-gen-api.h"
 
 
-// Maybe would be better to pass the Neural net as a parameter, but there may
-// changes made to the NNet in the forward call.
+// A loaded network together with its feature transform and pdf prior. The
+// models are read once in PyNnetModel_new and reused for every forward pass.
+struct PyNnetModel {
+  PyNnetForwardOptions opts_;
+  kaldi::nnet1::PdfPriorOptions prior_opts_;
+  kaldi::nnet1::Nnet nnet_transf_;
+  kaldi::nnet1::Nnet nnet_;
+  kaldi::nnet1::PdfPrior * pdf_prior_ = nullptr;
+  // the feature transform and the network compiled together, the forward
+  // passes go through this
+  kaldi::nnet1::InferencePlan plan_;
+  // CMVN of the input and (reversed) of the output as <Rescale> and
+  // <AddShift>, which the plan folds into the first and last affine layers
+  kaldi::nnet1::Nnet in_norm_;
+  kaldi::nnet1::Nnet out_norm_;
+  // deltas computed straight into the input buffer, NULL for none
+  kaldi::DeltaFeatures * deltas_ = nullptr;
+  kaldi::int32 delta_order_ = 0;
+  kaldi::int32 delta_truncate_ = 0;
+  // the input of the forward pass, kept between calls
+  kaldi::CuMatrix<kaldi::BaseFloat> feats_;
+  // The plan keeps its buffers between forward passes, so concurrent forward
+  // passes on the same model are serialised.
+  std::mutex mutex_;
+};
 
-kaldi::Matrix<kaldi::BaseFloat> * PyGenNnetForwardPass(PySimpleOptions * pyopts,
-    const kaldi::Matrix<kaldi::BaseFloat> &input) {
-  try {
-    using namespace kaldi;
-    using namespace kaldi::nnet1;
-    typedef kaldi::int32 int32;
 
+// CuDevice::SelectGpuId may only be called once per process, by whichever
+// model loads first. Forward passes may run on several threads, each gets
+// its own CuDevice on the selected GPU, so the allocator has to lock.
+static void PyNnetSelectGpu(const std::string &use_gpu) {
+#if HAVE_CUDA == 1
+  static std::once_flag selected;
+  std::call_once(selected, [&use_gpu]() {
+      kaldi::CuDevice::Instantiate().SelectGpuId(use_gpu);
+      kaldi::CuDevice::Instantiate().AllowMultithreading();
+    });
+#endif
+}
+
+
+// The transform and network as one, in the order they are applied
+static void PyNnetModelCombined(const PyNnetModel * model,
+    kaldi::nnet1::Nnet * combined) {
+  if (model->in_norm_.NumComponents())
+    combined->AppendNnet(model->in_norm_);
+  if (!model->opts_.reverse_transform) {
+    combined->AppendNnet(model->nnet_transf_);
+    combined->AppendNnet(model->nnet_);
+  } else {
+    combined->AppendNnet(model->nnet_);
+    combined->AppendNnet(model->nnet_transf_);
+  }
+  if (model->out_norm_.NumComponents())
+    combined->AppendNnet(model->out_norm_);
+}
+
+
+// The per dimension scale and offset that PyApplyCMVN applies, found by
+// applying it to rows of zeros and ones. False if the options or stats are
+// bad.
+static bool PyCmvnAffine(PySimpleOptions * pyopts,
+    const kaldi::MatrixBase<double> &cmvn_stats,
+    kaldi::Vector<kaldi::BaseFloat> * scale,
+    kaldi::Vector<kaldi::BaseFloat> * offset) {
+  using namespace kaldi;
+  if (cmvn_stats.NumCols() < 2)
+    return false;
+  Matrix<BaseFloat> probe(2, cmvn_stats.NumCols() - 1);
+  probe.Row(1).Set(1.0);
+  Matrix<BaseFloat> * applied = PyApplyCMVN(pyopts, probe, cmvn_stats);
+  if (!applied)
+    return false;
+  offset->Resize(probe.NumCols());
+  offset->CopyFromVec(applied->Row(0));
+  scale->Resize(probe.NumCols());
+  scale->CopyFromVec(applied->Row(1));
+  scale->AddVec(-1.0, *offset);
+  delete applied;
+  return true;
+}
+
+
+// Appends x .* scale + offset to norm
+static void PyNnetAppendAffineNorm(const kaldi::VectorBase<kaldi::BaseFloat> &scale,
+    const kaldi::VectorBase<kaldi::BaseFloat> &offset,
+    kaldi::nnet1::Nnet * norm) {
+  using namespace kaldi::nnet1;
+  Rescale * rescale = new Rescale(scale.Dim(), scale.Dim());
+  rescale->SetParams(scale);
+  norm->AppendComponentPointer(rescale);
+  AddShift * shift = new AddShift(offset.Dim(), offset.Dim());
+  shift->SetParams(offset);
+  norm->AppendComponentPointer(shift);
+}
+
+
+// Compiles the plan again after the normalisation changed
+static void PyNnetModelReplan(PyNnetModel * model) {
+  kaldi::nnet1::Nnet combined;
+  PyNnetModelCombined(model, &combined);
+  model->plan_.Init(combined);
+  if (model->opts_.sparse_input_density > 0.0)
+    model->plan_.PrepareSparseInput();
+  KALDI_VLOG(1) << "Inference plan of " << model->opts_.model_filename
+                << ":\n" << model->plan_.Info();
+}
+
+
+PyNnetModel * PyNnetModel_new(PySimpleOptions * pyopts) {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+  PyNnetModel * model = nullptr;
+  try {
     auto prior_opts = pyopts->pdf_prior_;
     auto nnet_fwd_opts = pyopts->nnet_fwd_;
 
     // check if required parameters are provided
-    bool option_err = false;
     if (!prior_opts) {
       KALDI_ERR << "PySimpleOptions does not have PdfPriorOptions registered";
-      option_err = true;
     }
     if (!nnet_fwd_opts) {
       KALDI_ERR << "PySimpleOptions does not have NnetForwardOptions registered";
-      option_err = true;
     }
     if (nnet_fwd_opts->model_filename.empty()) {
       KALDI_ERR << "Argument model_filename is missing or is empty";
-      option_err = true;
     }
-    if (option_err)
-      throw std::invalid_argument("PyGenNnetForwardPass called with invalid options.");
+    // avoid some bad option combinations,
+    if (nnet_fwd_opts->apply_log && nnet_fwd_opts->no_softmax) {
+      KALDI_ERR << "Cannot use both --apply-log=true --no-softmax=true, "
+        << "use only one of the two!";
+    }
 
-    // Select the GPU
-#if HAVE_CUDA == 1
-    CuDevice::Instantiate().SelectGpuId(nnet_fwd_opts->use_gpu);
-#endif
+    PyNnetSelectGpu(nnet_fwd_opts->use_gpu);
+
+    model = new PyNnetModel;
+    model->opts_ = *nnet_fwd_opts;
+    model->prior_opts_ = *prior_opts;
 
-    Nnet nnet_transf;
-    if (nnet_fwd_opts->feature_transform != "") {
-      nnet_transf.Read(nnet_fwd_opts->feature_transform);
+    if (model->opts_.feature_transform != "") {
+      model->nnet_transf_.Read(model->opts_.feature_transform);
     }
 
-    Nnet nnet;
-    nnet.Read(nnet_fwd_opts->model_filename);
+    Nnet &nnet = model->nnet_;
+    nnet.Read(model->opts_.model_filename);
     // optionally remove softmax,
     Component::ComponentType last_comp_type = nnet.GetLastComponent().GetType();
-    if (nnet_fwd_opts->no_softmax) {
+    if (model->opts_.no_softmax) {
       if (last_comp_type == Component::kSoftmax ||
         last_comp_type == Component::kBlockSoftmax) {
           KALDI_LOG << "Removing " << Component::TypeToMarker(last_comp_type)
-          << " from the nnet " << nnet_fwd_opts->model_filename;
+          << " from the nnet " << model->opts_.model_filename;
           nnet.RemoveLastComponent();
       } else {
         KALDI_WARN << "Last component 'NOT-REMOVED' by --no-softmax=true, "
@@ -91,71 +200,309 @@ kaldi::Matrix<kaldi::BaseFloat> * PyGenNnetForwardPass(PySimpleOptions * pyopts,
       }
     }
 
-    // avoid some bad option combinations,
-    if (nnet_fwd_opts->apply_log && nnet_fwd_opts->no_softmax) {
-      KALDI_ERR << "Cannot use both --apply-log=true --no-softmax=true, "
-        << "use only one of the two!";
-      throw std::invalid_argument("PyGenNnetForwardPass called with invalid options.");
-    }
-
     // we will subtract log-priors later,
-    PdfPrior pdf_prior(*prior_opts);
+    model->pdf_prior_ = new PdfPrior(model->prior_opts_);
 
     // disable dropout,
-    nnet_transf.SetDropoutRate(0.0);
+    model->nnet_transf_.SetDropoutRate(0.0);
     nnet.SetDropoutRate(0.0);
 
-    CuMatrix<BaseFloat> feats, feats_transf, nnet_out;
+    PyNnetModelReplan(model);
+    return model;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    PyNnetModel_delete(model);
+    return nullptr;
+  }
+}
 
-    Timer time;
 
-    KALDI_VLOG(2) << "Processing " << input.NumRows() << "frames";
+void PyNnetModel_delete(PyNnetModel * model) {
+  if (model) {
+    delete model->pdf_prior_;
+    delete model->deltas_;
+    delete model;
+  }
+}
 
 
-    if (!KALDI_ISFINITE(input.Sum())) {  // check there's no nan/inf,
-      KALDI_ERR << "NaN or inf found in features";
+bool PyNnetModel_AddInputCmvn(PyNnetModel * model, PySimpleOptions * pyopts,
+    const kaldi::MatrixBase<double> &cmvn_stats) {
+  try {
+    using namespace kaldi;
+    if (!model) {
+      KALDI_ERR << "PyNnetModel_AddInputCmvn called without a model";
     }
+    Vector<BaseFloat> scale, offset;
+    if (!PyCmvnAffine(pyopts, cmvn_stats, &scale, &offset))
+      return false;
+    std::lock_guard<std::mutex> lock(model->mutex_);
+    if (scale.Dim() != model->plan_.InputDim()) {
+      KALDI_WARN << "Input CMVN of dimension " << scale.Dim()
+                 << " for a network with input dimension "
+                 << model->plan_.InputDim();
+      return false;
+    }
+    PyNnetAppendAffineNorm(scale, offset, &model->in_norm_);
+    PyNnetModelReplan(model);
+    return true;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return false;
+  }
+}
 
-    // push it to gpu,
-    feats = input;
 
-    // fwd-pass, feature transform,
-    if (!nnet_fwd_opts->reverse_transform) {
-      nnet_transf.Feedforward(feats, &feats_transf);
-      if (!KALDI_ISFINITE(feats_transf.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in transformed-features";
-      }
+bool PyNnetModel_AddOutputCmvn(PyNnetModel * model, PySimpleOptions * pyopts,
+    const kaldi::MatrixBase<double> &cmvn_stats) {
+  try {
+    using namespace kaldi;
+    if (!model) {
+      KALDI_ERR << "PyNnetModel_AddOutputCmvn called without a model";
+    }
+    Vector<BaseFloat> scale, offset;
+    if (!PyCmvnAffine(pyopts, cmvn_stats, &scale, &offset))
+      return false;
+    std::lock_guard<std::mutex> lock(model->mutex_);
+    if (scale.Dim() != model->plan_.OutputDim()) {
+      KALDI_WARN << "Output CMVN of dimension " << scale.Dim()
+                 << " for a network with output dimension "
+                 << model->plan_.OutputDim();
+      return false;
+    }
+    PyNnetAppendAffineNorm(scale, offset, &model->out_norm_);
+    PyNnetModelReplan(model);
+    return true;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return false;
+  }
+}
 
-      // fwd-pass, nnet,
-      nnet.Feedforward(feats_transf, &nnet_out);
-      if (!KALDI_ISFINITE(nnet_out.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in nn-output for";
-      }
-    } else {
-      nnet.Feedforward(feats, &feats_transf);
-      if (!KALDI_ISFINITE(feats_transf.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in transformed-features";
-      }
 
-      // fwd-pass, nnet,
-      nnet_transf.Feedforward(feats_transf, &nnet_out);
-      if (!KALDI_ISFINITE(nnet_out.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in nn-output";
-      }
+bool PyNnetModel_SetInputDeltas(PyNnetModel * model, PySimpleOptions * pyopts) {
+  try {
+    using namespace kaldi;
+    if (!model) {
+      KALDI_ERR << "PyNnetModel_SetInputDeltas called without a model";
     }
+    if (!pyopts || !pyopts->add_deltas_) {
+      KALDI_ERR << "PySimpleOptions does not have DeltaFeaturesOptions registered";
+    }
+    std::lock_guard<std::mutex> lock(model->mutex_);
+    delete model->deltas_;
+    model->deltas_ = new DeltaFeatures(*pyopts->add_deltas_);
+    model->delta_order_ = pyopts->add_deltas_->order;
+    model->delta_truncate_ = pyopts->extra_int_["truncate"];
+    return true;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return false;
+  }
+}
 
-    // convert posteriors to log-posteriors,
-    if (nnet_fwd_opts->apply_log) {
-      if (!(nnet_out.Min() >= 0.0 && nnet_out.Max() <= 1.0)) {
-        KALDI_WARN << "Applying 'log()' to data which don't seem to be probabilities.";
-      }
-      nnet_out.Add(1e-20);  // avoid log(0),
-      nnet_out.ApplyLog();
+
+// Fills model->feats_ with the input of the forward pass: the input itself,
+// or its deltas computed for each segment, straight into the buffer on the
+// CPU and through one copy to the GPU
+static void PyNnetModelInput(PyNnetModel * model,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const std::vector<int> &segment_lengths) {
+  using namespace kaldi;
+  if (!model->deltas_) {
+    model->feats_.Resize(input.NumRows(), input.NumCols(), kUndefined);
+    model->feats_.CopyFromMat(input);
+    return;
+  }
+  int32 dim = (model->delta_truncate_ != 0 ? model->delta_truncate_ :
+               input.NumCols());
+  if (dim > input.NumCols()) {
+    KALDI_ERR << "Cannot truncate features of dimension " << input.NumCols()
+              << " to " << dim << " for the deltas";
+  }
+  int32 rows = input.NumRows(),
+      out_dim = dim * (model->delta_order_ + 1);
+  model->feats_.Resize(rows, out_dim, kUndefined);
+  Matrix<BaseFloat> host;
+  MatrixBase<BaseFloat> * out = &model->feats_.Mat();
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    host.Resize(rows, out_dim, kUndefined);
+    out = &host;
+  }
+#endif
+  // deltas look across frames so are computed within each segment
+  int32 offset = 0;
+  for (auto len : segment_lengths) {
+    if (len == 0)
+      continue;
+    SubMatrix<BaseFloat> segment(input, offset, len, 0, dim);
+    for (int32 f = 0; f < len; f++) {
+      SubVector<BaseFloat> frame(*out, offset + f);
+      model->deltas_->Process(segment, f, &frame);
     }
+    offset += len;
+  }
+  if (out == &host)
+    model->feats_.CopyFromMat(host);
+}
 
-    // subtract log-priors from log-posteriors or pre-softmax,
-    if (prior_opts->class_frame_counts != "") {
-      pdf_prior.SubtractOnLogpost(&nnet_out);
+
+// True if no component of the network looks across frames, so that rows of
+// independent sequences can be stacked and propagated together.
+static bool PyNnetIsFrameIndependent(const kaldi::nnet1::Nnet &nnet) {
+  using kaldi::nnet1::Component;
+  for (kaldi::int32 c = 0; c < nnet.NumComponents(); c++) {
+    switch (nnet.GetComponent(c).GetType()) {
+      case Component::kLstmProjected:
+      case Component::kBlstmProjected:
+      case Component::kRecurrentComponent:
+      case Component::kSplice:
+      case Component::kSentenceAveragingComponent:
+      case Component::kSimpleSentenceAveragingComponent:
+      case Component::kFramePoolingComponent:
+      case Component::kParallelComponent:
+        return false;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+
+// The input as a sparse matrix, if the first layer of the plan takes one and
+// few enough elements are nonzero; the deltas are dense.
+static bool PyNnetModelSparseInput(const PyNnetModel * model,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    kaldi::CuSparseMatrix<kaldi::BaseFloat> * sparse) {
+  using namespace kaldi;
+  if (model->deltas_ || !model->plan_.SparseInputPrepared())
+    return false;
+  int64 max_nonzero = model->opts_.sparse_input_density *
+      static_cast<double>(input.NumRows()) * input.NumCols(), nonzero = 0;
+  for (int32 r = 0; r < input.NumRows(); r++) {
+    const BaseFloat * row = input.RowData(r);
+    for (int32 c = 0; c < input.NumCols(); c++)
+      nonzero += (row[c] != 0.0);
+    if (nonzero > max_nonzero)
+      return false;
+  }
+  // on a GPU this is also all that is copied to it
+  *sparse = SparseMatrix<BaseFloat>(input);
+  return true;
+}
+
+
+static void PyNnetModelPostprocess(const PyNnetModel * model,
+    kaldi::CuMatrixBase<kaldi::BaseFloat> * nnet_out);
+
+
+// Feature transform, network, log and prior on frames already on the device.
+static void PyNnetModelPropagate(PyNnetModel * model,
+    const kaldi::CuMatrixBase<kaldi::BaseFloat> &feats,
+    kaldi::CuMatrix<kaldi::BaseFloat> * nnet_out) {
+  // fwd-pass, feature transform and nnet,
+  model->plan_.Feedforward(feats, nnet_out);
+  PyNnetModelPostprocess(model, nnet_out);
+}
+
+
+// Checks the network output, then the optional log and prior.
+static void PyNnetModelPostprocess(const PyNnetModel * model,
+    kaldi::CuMatrixBase<kaldi::BaseFloat> * nnet_out) {
+  using namespace kaldi;
+  const PyNnetForwardOptions &nnet_fwd_opts = model->opts_;
+
+  if (!KALDI_ISFINITE(nnet_out->Sum())) {  // check there's no nan/inf,
+    KALDI_ERR << "NaN or inf found in nn-output";
+  }
+
+  // convert posteriors to log-posteriors,
+  if (nnet_fwd_opts.apply_log) {
+    if (!(nnet_out->Min() >= 0.0 && nnet_out->Max() <= 1.0)) {
+      KALDI_WARN << "Applying 'log()' to data which don't seem to be probabilities.";
+    }
+    nnet_out->Add(1e-20);  // avoid log(0),
+    nnet_out->ApplyLog();
+  }
+
+  // subtract log-priors from log-posteriors or pre-softmax,
+  if (model->prior_opts_.class_frame_counts != "") {
+    model->pdf_prior_->SubtractOnLogpost(nnet_out);
+  }
+}
+
+
+kaldi::Matrix<kaldi::BaseFloat> * PyNnetModel_Forward(PyNnetModel * model,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input) {
+  std::vector<int> segment_lengths(1, input.NumRows());
+  return PyNnetModel_ForwardBatch(model, input, segment_lengths);
+}
+
+
+kaldi::Matrix<kaldi::BaseFloat> * PyNnetModel_ForwardBatch(PyNnetModel * model,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const std::vector<int> &segment_lengths) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet1;
+
+    if (!model) {
+      KALDI_ERR << "PyNnetModel_Forward called without a model";
+    }
+    int total_rows = 0;
+    for (auto len : segment_lengths) {
+      if (len < 0)
+        KALDI_ERR << "Negative segment length " << len;
+      total_rows += len;
+    }
+    if (total_rows != input.NumRows()) {
+      KALDI_ERR << "Segment lengths sum to " << total_rows
+                << " but input has " << input.NumRows() << " rows";
+    }
+    std::lock_guard<std::mutex> lock(model->mutex_);
+
+    Timer time;
+
+    KALDI_VLOG(2) << "Processing " << input.NumRows() << "frames in "
+                  << segment_lengths.size() << " segments";
+
+    if (!KALDI_ISFINITE(input.Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in features";
+    }
+
+    CuMatrix<BaseFloat> nnet_out;
+    CuSparseMatrix<BaseFloat> sparse_feats;
+    bool frame_independent = segment_lengths.size() <= 1 ||
+        (PyNnetIsFrameIndependent(model->nnet_transf_) &&
+         PyNnetIsFrameIndependent(model->nnet_));
+
+    bool sparse = frame_independent &&
+        PyNnetModelSparseInput(model, input, &sparse_feats);
+    // push it to gpu, all segments in one copy, with the deltas if any,
+    if (!sparse)
+      PyNnetModelInput(model, input, segment_lengths);
+    const CuMatrix<BaseFloat> &feats = model->feats_;
+
+    if (sparse) {
+      model->plan_.Feedforward(sparse_feats, &nnet_out);
+      PyNnetModelPostprocess(model, &nnet_out);
+    } else if (frame_independent) {
+      PyNnetModelPropagate(model, feats, &nnet_out);
+    } else {
+      // networks with temporal context must not see across segments,
+      CuMatrix<BaseFloat> segment_out;
+      int offset = 0;
+      for (auto len : segment_lengths) {
+        if (len == 0)
+          continue;
+        PyNnetModelPropagate(model, feats.RowRange(offset, len), &segment_out);
+        if (nnet_out.NumRows() == 0)
+          nnet_out.Resize(total_rows, segment_out.NumCols(), kUndefined);
+        nnet_out.RowRange(offset, len).CopyFromMat(segment_out);
+        offset += len;
+      }
     }
 
     // download from GPU,
@@ -184,3 +531,130 @@ kaldi::Matrix<kaldi::BaseFloat> * PyGenNnetForwardPass(PySimpleOptions * pyopts,
     return nullptr;
   }
 }
+
+
+// The streams share the model's options and prior, but have their own copy
+// of the network, holding the state of the LSTMs.
+struct PyNnetStream {
+  const PyNnetModel * model_;
+  kaldi::nnet1::MultistreamForward forward_;
+};
+
+
+PyNnetStream * PyNnetStream_new(PyNnetModel * model, int num_streams) {
+  PyNnetStream * stream = nullptr;
+  try {
+    if (!model) {
+      KALDI_ERR << "PyNnetStream_new called without a model";
+    }
+    if (num_streams <= 0) {
+      KALDI_ERR << "Need at least one stream, not " << num_streams;
+    }
+    kaldi::nnet1::Nnet combined;
+    PyNnetModelCombined(model, &combined);
+    stream = new PyNnetStream;
+    stream->model_ = model;
+    stream->forward_.Init(combined, num_streams);
+    return stream;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    delete stream;
+    return nullptr;
+  }
+}
+
+
+void PyNnetStream_delete(PyNnetStream * stream) {
+  delete stream;
+}
+
+
+void PyNnetStream_Reset(PyNnetStream * stream, int s) {
+  try {
+    if (!stream) {
+      KALDI_ERR << "PyNnetStream_Reset called without a stream";
+    }
+    if (s < 0 || s >= stream->forward_.NumStreams()) {
+      KALDI_ERR << "No stream " << s << ", there are "
+                << stream->forward_.NumStreams();
+    }
+    stream->forward_.ResetStream(s);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+  }
+}
+
+
+kaldi::Matrix<kaldi::BaseFloat> * PyNnetStream_Forward(PyNnetStream * stream,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const std::vector<int> &chunk_lengths) {
+  try {
+    using namespace kaldi;
+
+    if (!stream) {
+      KALDI_ERR << "PyNnetStream_Forward called without a stream";
+    }
+    int num_streams = stream->forward_.NumStreams();
+    if (chunk_lengths.size() != num_streams) {
+      KALDI_ERR << chunk_lengths.size() << " chunk lengths for "
+                << num_streams << " streams";
+    }
+    int total_rows = 0;
+    for (auto len : chunk_lengths) {
+      if (len < 0)
+        KALDI_ERR << "Negative chunk length " << len;
+      total_rows += len;
+    }
+    if (total_rows != input.NumRows()) {
+      KALDI_ERR << "Chunk lengths sum to " << total_rows
+                << " but input has " << input.NumRows() << " rows";
+    }
+    if (!KALDI_ISFINITE(input.Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in features";
+    }
+
+    if (total_rows == 0)
+      return new Matrix<BaseFloat>();
+
+    std::vector<SubMatrix<BaseFloat> > chunks;
+    std::vector<const MatrixBase<BaseFloat>*> chunk_ptrs(num_streams, NULL);
+    chunks.reserve(num_streams);
+    int offset = 0;
+    for (int s = 0; s < num_streams; s++) {
+      if (chunk_lengths[s] == 0)
+        continue;
+      chunks.push_back(input.RowRange(offset, chunk_lengths[s]));
+      chunk_ptrs[s] = &chunks.back();
+      offset += chunk_lengths[s];
+    }
+    std::vector<Matrix<BaseFloat> > outs;
+    stream->forward_.Forward(chunk_ptrs, &outs);
+
+    CuMatrix<BaseFloat> nnet_out(total_rows, stream->forward_.OutputDim(),
+                                 kUndefined);
+    offset = 0;
+    for (int s = 0; s < num_streams; s++) {
+      if (chunk_lengths[s] == 0)
+        continue;
+      nnet_out.RowRange(offset, chunk_lengths[s]).CopyFromMat(outs[s]);
+      offset += chunk_lengths[s];
+    }
+    PyNnetModelPostprocess(stream->model_, &nnet_out);
+    return new Matrix<BaseFloat>(nnet_out);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return nullptr;
+  }
+}
+
+
+// Kept for callers that only need a single pass, loads the model each time.
+kaldi::Matrix<kaldi::BaseFloat> * PyGenNnetForwardPass(PySimpleOptions * pyopts,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input) {
+  PyNnetModel * model = PyNnetModel_new(pyopts);
+  if (!model)
+    return nullptr;
+  auto output = PyNnetModel_Forward(model, input);
+  PyNnetModel_delete(model);
+  return output;
+}
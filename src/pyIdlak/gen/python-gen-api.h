@@ -23,14 +23,78 @@
 
 #include "pyIdlak/pylib/pyIdlak_types.h"
 
+// A DNN loaded once from the options' model filename and feature transform
+typedef struct PyNnetModel PyNnetModel;
+
+PyNnetModel * PyNnetModel_new(PySimpleOptions * pyopts);
+void PyNnetModel_delete(PyNnetModel * model);
+kaldi::Matrix<kaldi::BaseFloat> * PyNnetModel_Forward(PyNnetModel * model,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input);
+// Input holds several sequences stacked by row, segment_lengths gives the
+// number of rows of each. The output rows follow the same order.
+kaldi::Matrix<kaldi::BaseFloat> * PyNnetModel_ForwardBatch(PyNnetModel * model,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const std::vector<int> &segment_lengths);
+
+// Fused pre and post processing of a model's forward passes. Input and
+// output CMVN (as PyApplyCMVN with the same options and stats) are folded
+// into the first and last layers of the network, so they cost nothing per
+// frame; the input CMVN applies after the deltas. The deltas (as
+// PyAddDeltas) are computed within each segment straight into the input
+// buffer of the forward pass. False if the options or dimensions do not
+// fit the model.
+bool PyNnetModel_AddInputCmvn(PyNnetModel * model, PySimpleOptions * pyopts,
+    const kaldi::MatrixBase<double> &cmvn_stats);
+bool PyNnetModel_AddOutputCmvn(PyNnetModel * model, PySimpleOptions * pyopts,
+    const kaldi::MatrixBase<double> &cmvn_stats);
+bool PyNnetModel_SetInputDeltas(PyNnetModel * model, PySimpleOptions * pyopts);
+
+// Runs a unidirectional (LSTM) model over num_streams sequences at once, a
+// chunk of frames of each at a time, keeping the state of each stream
+// between chunks. The input of PyNnetStream_Forward holds the next chunk of
+// every stream stacked by row, chunk_lengths gives the number of rows of
+// each (0 for an idle stream) and the output rows follow the same order.
+typedef struct PyNnetStream PyNnetStream;
+
+PyNnetStream * PyNnetStream_new(PyNnetModel * model, int num_streams);
+void PyNnetStream_delete(PyNnetStream * stream);
+// Starts a new sequence on stream s, from its next chunk
+void PyNnetStream_Reset(PyNnetStream * stream, int s);
+kaldi::Matrix<kaldi::BaseFloat> * PyNnetStream_Forward(PyNnetStream * stream,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const std::vector<int> &chunk_lengths);
+
 kaldi::Matrix<kaldi::BaseFloat> * PyGenNnetForwardPass(PySimpleOptions * pyopts,
-    const kaldi::Matrix<kaldi::BaseFloat> &input);
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input);
 
 kaldi::Matrix<kaldi::BaseFloat> * PyApplyCMVN(PySimpleOptions * pyopts,
-    const kaldi::Matrix<kaldi::BaseFloat> &input,
-    const kaldi::Matrix<double> &cmvn_stats);
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input,
+    const kaldi::MatrixBase<double> &cmvn_stats);
 
 kaldi::Matrix<kaldi::BaseFloat> * PyAddDeltas(PySimpleOptions * pyopts,
-    const kaldi::Matrix<kaldi::BaseFloat> &input);
+    const kaldi::MatrixBase<kaldi::BaseFloat> &input);
+
+// Expands phone level features to frame level using the state durations (in
+// frames, one row per phone). Each frame gets the state index, state duration,
+// fuzzy state position, phone duration and fuzzy phone position appended.
+kaldi::Matrix<kaldi::BaseFloat> * PyCombineDurationsAndFeatures(
+    const kaldi::MatrixBase<kaldi::BaseFloat> &phone_features,
+    const kaldi::MatrixBase<kaldi::BaseFloat> &state_durations,
+    double state_pos_fuzz, double phone_pos_fuzz);
+
+// Repeats each row of the phone features num_states times with the state
+// index appended, the input of the state duration DNN.
+kaldi::Matrix<kaldi::BaseFloat> * PyAddStateFeature(
+    const kaldi::MatrixBase<kaldi::BaseFloat> &phone_features,
+    int num_states);
+
+// Turns the output of the state duration DNN (num_states rows per phone, the
+// state duration and the phone duration in the first two columns) into
+// state durations in whole frames, one row per phone, as
+// TangleVoice._post_duration_processing: the states are rescaled to the
+// average of the predicted phone duration and the sum of the states, and the
+// first and last states get at least one frame.
+kaldi::Matrix<kaldi::BaseFloat> * PyPostDurationProcessing(
+    const kaldi::MatrixBase<kaldi::BaseFloat> &durations, int num_states);
 
 #endif // KALDI_PYIDLAK_GEN_PYTHON_GEN_API_H_
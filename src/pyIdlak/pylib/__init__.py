@@ -41,4 +41,5 @@ from .utils import (
         compare_arks,
         get_rspecifier_keys,
         get_matrix_by_key,
+        matrix_to_numpy,
     )
@@ -43,6 +43,7 @@ struct PyNnetForwardOptions {
   bool apply_log = false;
   std::string use_gpu = "no";
   std::string model_filename;
+  float sparse_input_density = 0.05;
 
   void Register(kaldi::OptionsItf *opts) {
     opts->Register("feature-transform", &(feature_transform),
@@ -59,6 +60,10 @@ struct PyNnetForwardOptions {
                    "yes|no|optional, only has effect if compiled with CUDA");
     opts->Register("model-filename", &(model_filename),
                    "Model filename");
+    opts->Register("sparse-input-density", &(sparse_input_density),
+                   "If at most this fraction of the input elements are nonzero "
+                   "(as with one-hot linguistic features), the first affine "
+                   "layer multiplies the input as a sparse matrix; 0 for never");
   }
 };
 typedef struct PyNnetForwardOptions PyNnetForwardOptions;
@@ -58,3 +58,19 @@ kaldi::Matrix<double> * PyKaldiMatrixDouble_frmlist(const double * MATRIX, int m
     }
     return kaldimat;
 }
+
+size_t PyKaldiMatrixBaseFloat_data(kaldi::Matrix<kaldi::BaseFloat> * M) {
+  return reinterpret_cast<size_t>(M->Data());
+}
+
+std::vector<int> PyKaldiMatrixBaseFloat_layout(kaldi::Matrix<kaldi::BaseFloat> * M) {
+  return {M->NumRows(), M->NumCols(), M->Stride(), sizeof(kaldi::BaseFloat)};
+}
+
+size_t PyKaldiMatrixDouble_data(kaldi::Matrix<double> * M) {
+  return reinterpret_cast<size_t>(M->Data());
+}
+
+std::vector<int> PyKaldiMatrixDouble_layout(kaldi::Matrix<double> * M) {
+  return {M->NumRows(), M->NumCols(), M->Stride(), sizeof(double)};
+}
@@ -147,5 +147,13 @@ KaldiMatrixDouble_list * PyKaldiMatrixDouble_tolist(kaldi::Matrix<double> * M);
 kaldi::Matrix<kaldi::BaseFloat> * PyKaldiMatrixBaseFloat_frmlist(const double * MATRIX, int m, int n);
 kaldi::Matrix<double> * PyKaldiMatrixDouble_frmlist(const double * MATRIX, int m, int n);
 
+// Address of the matrix data and its layout as the number of rows, columns,
+// row stride and element size in bytes, for sharing the matrix memory with
+// numpy (see utils.matrix_to_numpy)
+size_t PyKaldiMatrixBaseFloat_data(kaldi::Matrix<kaldi::BaseFloat> * M);
+std::vector<int> PyKaldiMatrixBaseFloat_layout(kaldi::Matrix<kaldi::BaseFloat> * M);
+size_t PyKaldiMatrixDouble_data(kaldi::Matrix<double> * M);
+std::vector<int> PyKaldiMatrixDouble_layout(kaldi::Matrix<double> * M);
+
 
 #endif // KALDI_PYIDLAK_PYLIB_PYIDLAK_IO_H_
@@ -33,11 +33,52 @@ namespace std {
    %template(StringVector) vector<string>;
    %template(ConstCharVector) vector<const char*>;
    %template(DoubleVectorList) vector<vector<double>>;
+   %template(StringVectorList) vector<vector<string>>;
 };
 
 %apply (int ARGC, char **ARGV) { (int argc, char *argv[]) }
 
 
+/* native calls which do not touch python objects while they run are declared
+   with %idlak_allow_threads(function) so other python threads run meanwhile.
+   Arguments are converted before and results after the GIL is released. */
+
+%{
+// Releases the GIL for its lifetime, it is taken back if the call throws
+class PyIdlakAllowThreads {
+ public:
+  PyIdlakAllowThreads() : state_(PyEval_SaveThread()) {}
+  ~PyIdlakAllowThreads() {PyEval_RestoreThread(state_);}
+ private:
+  PyThreadState * state_;
+};
+%}
+
+%define %idlak_allow_threads(FUNC)
+%exception FUNC %{
+    {
+        PyIdlakAllowThreads allow_threads;
+        $action
+    }
+%}
+%enddef
+
+
+/* binary data as python bytes, input points into the bytes object */
+
+typedef std::string PyIdlakBytes;
+
+%typemap(out) PyIdlakBytes %{
+    $result = PyBytes_FromStringAndSize($1.data(), $1.size());
+%}
+
+%typemap(in) (const char * BYTES, size_t LENGTH) (char * buf = 0, Py_ssize_t len = 0) %{
+    if (PyBytes_AsStringAndSize($input, &buf, &len) < 0) SWIG_fail;
+    $1 = buf;
+    $2 = static_cast<size_t>(len);
+%}
+
+
 /* base float matrix from list of list */
 %typemap(in) (const double * MATRIX, int m, int n) %{
     PyObject *row;
@@ -115,8 +156,100 @@ namespace std {
 
 
 %{
+#include <cstring>
 #include "matrix/matrix-lib.h"
 #include "pyIdlak/pylib/pyIdlak_io.h"
+
+// Buffer protocol format of each matrix element type
+template<typename Real> const char * PyIdlakBufferFormat();
+template<> inline const char * PyIdlakBufferFormat<float>() {return "f";}
+template<> inline const char * PyIdlakBufferFormat<double>() {return "d";}
+
+// A 2 dimensional buffer with contiguous rows, e.g. a C ordered numpy array,
+// as a kaldi matrix sharing its memory. Returns NULL with a python error set
+// if obj is not such a buffer, otherwise view must be released after use.
+template<typename Real>
+kaldi::SubMatrix<Real> * PyIdlakBufferMatrix(PyObject * obj, Py_buffer * view) {
+  if (PyObject_GetBuffer(obj, view, PyBUF_STRIDES | PyBUF_FORMAT) < 0)
+    return NULL;
+  if (view->ndim != 2 || view->itemsize != sizeof(Real) ||
+      strcmp(view->format, PyIdlakBufferFormat<Real>()) ||
+      view->strides[1] != view->itemsize ||
+      view->strides[0] % view->itemsize ||
+      view->strides[0] < view->shape[1] * view->itemsize) {
+    PyBuffer_Release(view);
+    PyErr_Format(PyExc_ValueError,
+                 "Expecting a kaldi matrix or a 2 dimensional array of '%s' with contiguous rows",
+                 PyIdlakBufferFormat<Real>());
+    return NULL;
+  }
+  return new kaldi::SubMatrix<Real>(
+      view->shape[0] * view->shape[1] ? static_cast<Real *>(view->buf) : NULL,
+      view->shape[0], view->shape[1], view->strides[0] / view->itemsize);
+}
+
+// Copies a contiguous buffer of doubles, false (with no python error) if obj
+// is not one so the caller can fall back to reading a sequence
+inline bool PyIdlakBufferVector(PyObject * obj, std::vector<double> * vec) {
+  Py_buffer view;
+  if (!PyObject_CheckBuffer(obj)) return false;
+  if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+    PyErr_Clear();
+    return false;
+  }
+  bool ok = view.itemsize == sizeof(double) && !strcmp(view.format, "d");
+  if (ok) {
+    const double * data = static_cast<const double *>(view.buf);
+    vec->assign(data, data + view.len / sizeof(double));
+  }
+  PyBuffer_Release(&view);
+  return ok;
+}
+%}
+
+/* kaldi matrix arguments from either a wrapped kaldi matrix or without
+   copying from a numpy array (or any buffer with contiguous rows) */
+
+%define %kaldi_matrix_buffer_typemaps(REAL)
+%typemap(in) const kaldi::MatrixBase<REAL> & (void * argp = 0, Py_buffer view, kaldi::SubMatrix<REAL> * sub = 0) %{
+    if (SWIG_IsOK(SWIG_ConvertPtr($input, &argp, $descriptor(kaldi::Matrix<REAL> *), 0)) && argp) {
+        $1 = reinterpret_cast<kaldi::Matrix<REAL> *>(argp);
+    } else {
+        sub = PyIdlakBufferMatrix<REAL>($input, &view);
+        if (!sub) SWIG_fail;
+        $1 = sub;
+    }
+%}
+
+%typemap(freearg) const kaldi::MatrixBase<REAL> & %{
+    if (sub$argnum) {
+        delete sub$argnum;
+        PyBuffer_Release(&view$argnum);
+    }
+%}
+%enddef
+
+%kaldi_matrix_buffer_typemaps(kaldi::BaseFloat)
+%kaldi_matrix_buffer_typemaps(double)
+
+
+/* double vectors are copied in one go from a buffer of doubles, e.g. a
+   numpy float64 array, rather than element by element */
+
+%typemap(in) const std::vector<double> & (std::vector<double> tmp, int res = 0, std::vector<double> * ptr = 0) %{
+    if (PyIdlakBufferVector($input, &tmp)) {
+        $1 = &tmp;
+    } else {
+        res = swig::asptr($input, &ptr);
+        if (!SWIG_IsOK(res) || !ptr) {
+            SWIG_exception_fail(SWIG_ArgError(res), "Expecting a sequence of numbers");
+        }
+        $1 = ptr;
+    }
+%}
+
+%typemap(freearg) const std::vector<double> & %{
+    if (SWIG_IsNewObj(res$argnum)) delete ptr$argnum;
 %}
 
 %include "pyIdlak_io.h"
@@ -29,6 +29,8 @@
 
 typedef struct PySimpleOptions PySimpleOptions;
 typedef struct PyIdlakBuffer PyIdlakBuffer;
+// Binary data, returned to python as bytes
+typedef std::string PyIdlakBytes;
 
 // These should be replaced with templates at some point
 typedef class PyIdlakSequentialBaseFloatMatrixReader PyIdlakSequentialBaseFloatMatrixReader;
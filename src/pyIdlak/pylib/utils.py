@@ -122,6 +122,36 @@ try:
         reader = pyIdlak_pylib.PyIdlakRandomAccessDoubleMatrixReader(rspecifier)
         return reader.value(key)
 
+    class _KaldiMatrixArray(object):
+        """ Describes the memory of a wrapped kaldi matrix with the numpy
+            array interface, holding the wrapper so that an array made from
+            it keeps the matrix alive """
+        def __init__(self, mat, data, layout):
+            import sys
+            rows, cols, stride, itemsize = layout
+            byteorder = '<' if sys.byteorder == 'little' else '>'
+            self._mat = mat
+            self.__array_interface__ = {
+                'version' : 3,
+                'typestr' : '{0}f{1}'.format(byteorder, itemsize),
+                'shape' : (rows, cols),
+                'strides' : (stride * itemsize, itemsize),
+                'data' : (data, False)
+            }
+
+    def matrix_to_numpy(mat, double = False):
+        """ Gets a numpy array sharing the memory of a wrapped kaldi matrix
+            (a double matrix if double is True) without copying it. Changes
+            to the array change the matrix. Requires numpy """
+        import numpy as np
+        if double:
+            data = pyIdlak_pylib.PyKaldiMatrixDouble_data(mat)
+            layout = pyIdlak_pylib.PyKaldiMatrixDouble_layout(mat)
+        else:
+            data = pyIdlak_pylib.PyKaldiMatrixBaseFloat_data(mat)
+            layout = pyIdlak_pylib.PyKaldiMatrixBaseFloat_layout(mat)
+        return np.asarray(_KaldiMatrixArray(mat, data, layout))
+
 except ImportError:
     import sys
     print("Cannot import pyIdlak_pylib, not all utilities are available", file = sys.stderr)
@@ -0,0 +1,80 @@
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+# SWIG wrapped API
+from . import pyIdlak_synth as c_api
+from ..vocoder.vocoders import Vocoder
+
+
+class Synthesizer:
+    """ Text to speech for a tangle voice run entirely in C++
+
+        The same pipeline as TangleVoice.speak but without converting the
+        features to Python between the stages. The Python normaliser and
+        post lexical rules are not run on text, a document which has been
+        processed with them can be given to synthesise instead.
+    """
+    def __init__(self, voice_dir):
+        self._synth = c_api.PyIdlakSynthesizer_new(
+            os.path.abspath(str(voice_dir)))
+        if self._synth is None:
+            raise IOError("cannot load voice from '{0}'".format(voice_dir))
+
+
+    def __del__(self):
+        if getattr(self, '_synth', None) is not None:
+            c_api.PyIdlakSynthesizer_delete(self._synth)
+            self._synth = None
+
+
+    @property
+    def srate(self):
+        return c_api.PyIdlakSynthesizer_srate(self._synth)
+
+
+    def speak(self, text, wav_filename = None):
+        """ Synthesise text or XML, returns the waveform
+
+            if wav_filename is set the waveform is also saved to it
+        """
+        waveform = list(c_api.PyIdlakSynthesizer_speak(self._synth, str(text)))
+        return self._result(waveform, wav_filename)
+
+
+    def speak_spurts(self, text):
+        """ Synthesise text or XML, returns a waveform for each spurt """
+        spurts = c_api.PyIdlakSynthesizer_speak_spurts(self._synth, str(text))
+        if not len(spurts):
+            raise RuntimeError("nothing synthesised")
+        return [list(spurt) for spurt in spurts]
+
+
+    def synthesise(self, doc, wav_filename = None):
+        """ Synthesise a txp XMLDoc which has been through text processing
+            but not context extraction, returns the waveform """
+        waveform = list(c_api.PyIdlakSynthesizer_synthesise_binary(
+            self._synth, doc.to_binary()))
+        return self._result(waveform, wav_filename)
+
+
+    def _result(self, waveform, wav_filename):
+        if not len(waveform):
+            raise RuntimeError("nothing synthesised")
+        if wav_filename:
+            Vocoder(self.srate).to_wav(wav_filename, waveform)
+        return waveform
@@ -0,0 +1,219 @@
+// pyIdlak/synth/idlak-synth.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+#include "feat/wave-reader.h"
+#include "idlaktxp/txpstagestats.h"
+#include "pyIdlak_synthesizer.h"
+
+namespace kaldi {
+
+static void WaveformToWave(const std::vector<double> &waveform, int32 srate,
+                           WaveData* wave) {
+  Matrix<BaseFloat> samples(1, waveform.size(), kUndefined);
+  for (size_t i = 0; i < waveform.size(); i++)
+    samples(0, i) = waveform[i];
+  wave->CopyFrom(WaveData(srate, samples));
+}
+
+// Synthesizers of one voice kept for reuse, an extra one is loaded whenever
+// all are in use, so there are as many as the most threads running at once
+class SynthesizerPool {
+ public:
+  explicit SynthesizerPool(const std::string &voicedir):
+      voicedir_(voicedir) { }
+  ~SynthesizerPool() {
+    for (size_t i = 0; i < all_.size(); i++) delete all_[i];
+  }
+  IdlakSynthesizer* Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty()) {
+        IdlakSynthesizer* synth = free_.back();
+        free_.pop_back();
+        return synth;
+      }
+    }
+    std::unique_ptr<IdlakSynthesizer> synth(new IdlakSynthesizer());
+    synth->Load(voicedir_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    all_.push_back(synth.get());
+    return synth.release();
+  }
+  void Release(IdlakSynthesizer* synth) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(synth);
+  }
+ private:
+  std::string voicedir_;
+  std::mutex mutex_;
+  std::vector<IdlakSynthesizer*> all_;
+  std::vector<IdlakSynthesizer*> free_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SynthesizerPool);
+};
+
+// One utterance, synthesised by operator () in a TaskSequencer thread and
+// written by the destructor, which the sequencer runs in input order
+class SynthesiseTask {
+ public:
+  SynthesiseTask(SynthesizerPool* pool, const std::string &key,
+                 const std::string &text, TableWriter<WaveHolder>* writer,
+                 int32* num_done, int32* num_fail):
+      pool_(pool), key_(key), text_(text), writer_(writer),
+      num_done_(num_done), num_fail_(num_fail), srate_(0), ok_(false) { }
+  void operator () () {
+    try {
+      IdlakSynthesizer* synth = pool_->Acquire();
+      srate_ = synth->SampleRate();
+      try {
+        ok_ = synth->Speak(text_, &waveform_);
+      } catch(...) {
+        pool_->Release(synth);
+        throw;
+      }
+      pool_->Release(synth);
+      if (!ok_) KALDI_WARN << "No speech synthesised for " << key_;
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Synthesis of " << key_ << " failed: " << e.what();
+      ok_ = false;
+    }
+  }
+  ~SynthesiseTask() {
+    if (!ok_) {
+      (*num_fail_)++;
+      return;
+    }
+    WaveData wave;
+    WaveformToWave(waveform_, srate_, &wave);
+    writer_->Write(key_, wave);
+    (*num_done_)++;
+  }
+ private:
+  SynthesizerPool* pool_;
+  std::string key_;
+  std::string text_;
+  TableWriter<WaveHolder>* writer_;
+  int32* num_done_;
+  int32* num_fail_;
+  int32 srate_;
+  bool ok_;
+  std::vector<double> waveform_;
+};
+
+}  // namespace kaldi
+
+/// Text to speech with a tangle voice without Python, writes a 16 bit wav,
+/// or a wav table for a table of texts
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  const char *usage =
+      "Synthesise text or txp XML with a tangle voice\n"
+      "Usage:  idlak-synth [options] <voice-dir> <text-input> <wav-output>\n"
+      " or:  idlak-synth [options] <voice-dir> <text-rspecifier> "
+      "<wav-wspecifier>\n"
+      "In the second form the voice is loaded once and each line "
+      "'<utt-id> <text>' of the\n"
+      "input table is synthesised, --num-threads utterances at a time, "
+      "each thread\n"
+      "with its own copy of the voice\n"
+      "e.g.: echo 'Hello world.' | ./idlak-synth ../../../idlak-voices/tangle/en/ga/slt - hello.wav\n" //NOLINT
+      "      ./idlak-synth --num-threads=4 ../../../idlak-voices/tangle/en/ga/slt ark:text ark,scp:wav.ark,wav.scp\n"; //NOLINT
+
+  try {
+    ParseOptions po(usage);
+    std::string stage_stats;
+    TaskSequencerConfig sequencer_config;
+    sequencer_config.Register(&po);
+    po.Register("stage-stats", &stage_stats,
+                "Write the time spent in each stage and the seconds of audio "
+                "synthesised to this file, in Prometheus text format");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+    std::string voicedir = po.GetArg(1),
+        filein = po.GetArg(2),
+        fileout = po.GetArg(3);
+
+    int32 num_done = 0, num_fail = 0;
+    if (ClassifyRspecifier(filein, NULL, NULL) != kNoRspecifier) {
+      if (ClassifyWspecifier(fileout, NULL, NULL, NULL) == kNoWspecifier)
+        KALDI_ERR << "A text table needs a wav table to write to, got "
+                  << fileout;
+      SynthesizerPool pool(voicedir);
+      // load one voice up front so that a bad voice fails straight away
+      pool.Release(pool.Acquire());
+      SequentialTokenVectorReader text_reader(filein);
+      TableWriter<WaveHolder> wav_writer(fileout);
+      {
+        TaskSequencer<SynthesiseTask> sequencer(sequencer_config);
+        for (; !text_reader.Done(); text_reader.Next()) {
+          const std::vector<std::string> &words = text_reader.Value();
+          std::string text;
+          for (size_t i = 0; i < words.size(); i++)
+            text += (i ? " " : "") + words[i];
+          sequencer.Run(new SynthesiseTask(&pool, text_reader.Key(), text,
+                                           &wav_writer, &num_done,
+                                           &num_fail));
+        }
+      }
+      KALDI_LOG << "Synthesised " << num_done << " utterances, failed for "
+                << num_fail;
+    } else {
+      IdlakSynthesizer synth;
+      synth.Load(voicedir);
+
+      bool binary;
+      Input ki(filein, &binary);
+      std::stringstream text;
+      text << ki.Stream().rdbuf();
+
+      std::vector<double> waveform;
+      bool ok = synth.Speak(text.str(),
+          [&waveform](const std::string &spurtid,
+                      const std::vector<double> &spurt) {
+            KALDI_VLOG(1) << "Synthesised spurt " << spurtid << ", "
+                          << spurt.size() << " samples";
+            waveform.insert(waveform.end(), spurt.begin(), spurt.end());
+          });
+      if (!ok) KALDI_ERR << "No speech synthesised from " << filein;
+
+      WaveData wave;
+      WaveformToWave(waveform, synth.SampleRate(), &wave);
+      Output ko(fileout, true, false);
+      wave.Write(ko.Stream());
+      num_done = 1;
+    }
+    if (!stage_stats.empty()) {
+      Output kso(stage_stats, false);
+      TxpStageStatsWritePrometheus(kso.Stream());
+    }
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
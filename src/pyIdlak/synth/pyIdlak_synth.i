@@ -0,0 +1,36 @@
+// pyIdlak/synth/pyIdlak_synth.i
+
+// Copyright 2018 CereProc Ltd.  (Authors: David Braude)
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+%module pyIdlak_synth
+
+%include "../pylib/pyIdlak_typemaps.i"
+
+%{
+#include "python-synth-api.h"
+%}
+
+%apply (const char * BYTES, size_t LENGTH) { (const char * data, size_t len) }
+
+%idlak_allow_threads(PyIdlakSynthesizer_new)
+%idlak_allow_threads(PyIdlakSynthesizer_speak)
+%idlak_allow_threads(PyIdlakSynthesizer_speak_spurts)
+%idlak_allow_threads(PyIdlakSynthesizer_synthesise_binary)
+
+%include "python-synth-api.h"
@@ -0,0 +1,683 @@
+// pyIdlak/synth/pyIdlak_synthesizer.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include "util/common-utils.h"
+#include "util/text-utils.h"
+#include "idlaktxp/txpstagestats.h"
+#include "pyIdlak/pylib/python-pylib-api.h"
+#include "pyIdlak/vocoder/python-vocoder-api.h"
+#include "pyIdlak_synthesizer.h"
+
+namespace kaldi {
+
+// Values fixed in pyIdlak.TangleVoice and vocoder.MCEPVocoder
+static const int32 kNumStates = 5;
+static const double kStatePosFuzz = 0.2;
+static const double kPhonePosFuzz = 0.1;
+static const double kF0Min = 70.0;
+static const int32 kPadeOrder = 5;
+static const int32 kExcitationSeed = 1;
+static const int32 kMlpgInfluenceRange = 30;
+
+static bool SynthFileExists(const std::string &fname) {
+  std::ifstream is(fname.c_str());
+  return is.good();
+}
+
+static std::string SynthReadFile(const std::string &fname) {
+  std::ifstream is(fname.c_str());
+  if (!is.good()) KALDI_ERR << "Cannot open " << fname;
+  std::stringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+// All the whitespace separated numbers in a file
+static void SynthReadFloats(const std::string &fname,
+                            std::vector<double>* values) {
+  std::istringstream is(SynthReadFile(fname));
+  std::string token;
+  double v;
+  values->clear();
+  while (is >> token) {
+    if (!ConvertStringToReal(token, &v))
+      KALDI_ERR << "Bad value '" << token << "' in " << fname;
+    values->push_back(v);
+  }
+}
+
+// The value of --name=value in an options file as written by the tangle
+// recipe, a value which is itself an option means the flag was given alone
+static bool SynthOptValue(const std::string &opts, const std::string &name,
+                          std::string* value) {
+  std::string key = "--" + name;
+  size_t pos = opts.find(key);
+  while (pos != std::string::npos) {
+    size_t p = pos + key.size();
+    while (p < opts.size() && isspace(opts[p])) p++;
+    if (p < opts.size() && opts[p] == '=') {
+      p++;
+      while (p < opts.size() && isspace(opts[p])) p++;
+      size_t end = p;
+      while (end < opts.size() && !isspace(opts[end])) end++;
+      if (end > p) {
+        *value = opts.substr(p, end - p);
+        if (value->compare(0, 2, "--") == 0) *value = "true";
+        return true;
+      }
+    }
+    pos = opts.find(key, pos + 1);
+  }
+  return false;
+}
+
+static bool SynthOptBool(const std::string &value) {
+  std::string v(value);
+  std::transform(v.begin(), v.end(), v.begin(), ::toupper);
+  return v == "TRUE" || v == "ON" || v == "1" || v == "T";
+}
+
+// Minimal reader for the cex frequency table, a json object holding an
+// object per context feature which maps each value seen in training to its
+// count. Only the keys are needed, in file order.
+class SynthCexFreqReader {
+ public:
+  explicit SynthCexFreqReader(const std::string &json) :
+      json_(json), pos_(0) {}
+  bool Read(std::vector<std::vector<std::string> >* values) {
+    std::string key;
+    values->clear();
+    if (!Expect('{')) return false;
+    if (Peek() == '}') return Expect('}');
+    do {
+      if (!ReadString(&key) || !Expect(':') || !Expect('{')) return false;
+      values->push_back(std::vector<std::string>());
+      if (Peek() == '}') {
+        pos_++;
+        continue;
+      }
+      do {
+        if (!ReadString(&key) || !Expect(':') || !SkipNumber()) return false;
+        values->back().push_back(key);
+      } while (Next(','));
+      if (!Expect('}')) return false;
+    } while (Next(','));
+    return Expect('}');
+  }
+
+ private:
+  char Peek() {
+    while (pos_ < json_.size() && isspace(json_[pos_])) pos_++;
+    return pos_ < json_.size() ? json_[pos_] : '\0';
+  }
+  bool Expect(char c) {
+    if (Peek() != c) return false;
+    pos_++;
+    return true;
+  }
+  bool Next(char c) {
+    return Peek() == c && Expect(c);
+  }
+  bool SkipNumber() {
+    Peek();
+    size_t start = pos_;
+    while (pos_ < json_.size() && strchr("+-.eE0123456789", json_[pos_]))
+      pos_++;
+    return pos_ > start;
+  }
+  uint32 ReadHex() {
+    uint32 cp = 0;
+    for (int32 i = 0; i < 4 && pos_ < json_.size(); i++, pos_++)
+      cp = (cp << 4) | (isdigit(json_[pos_]) ? json_[pos_] - '0' :
+                        (tolower(json_[pos_]) - 'a' + 10));
+    return cp;
+  }
+  void AppendUtf8(uint32 cp, std::string* s) {
+    if (cp < 0x80) {
+      s->push_back(cp);
+    } else if (cp < 0x800) {
+      s->push_back(0xc0 | (cp >> 6));
+      s->push_back(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      s->push_back(0xe0 | (cp >> 12));
+      s->push_back(0x80 | ((cp >> 6) & 0x3f));
+      s->push_back(0x80 | (cp & 0x3f));
+    } else {
+      s->push_back(0xf0 | (cp >> 18));
+      s->push_back(0x80 | ((cp >> 12) & 0x3f));
+      s->push_back(0x80 | ((cp >> 6) & 0x3f));
+      s->push_back(0x80 | (cp & 0x3f));
+    }
+  }
+  bool ReadString(std::string* s) {
+    s->clear();
+    if (!Expect('"')) return false;
+    while (pos_ < json_.size() && json_[pos_] != '"') {
+      char c = json_[pos_++];
+      if (c != '\\') {
+        s->push_back(c);
+        continue;
+      }
+      if (pos_ >= json_.size()) return false;
+      c = json_[pos_++];
+      switch (c) {
+        case 'b': s->push_back('\b'); break;
+        case 'f': s->push_back('\f'); break;
+        case 'n': s->push_back('\n'); break;
+        case 'r': s->push_back('\r'); break;
+        case 't': s->push_back('\t'); break;
+        case 'u': {
+          uint32 cp = ReadHex();
+          // surrogate pair
+          if (cp >= 0xd800 && cp < 0xdc00 &&
+              json_.compare(pos_, 2, "\\u") == 0) {
+            pos_ += 2;
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (ReadHex() - 0xdc00);
+          }
+          AppendUtf8(cp, s);
+          break;
+        }
+        default: s->push_back(c); break;
+      }
+    }
+    return Expect('"');
+  }
+  const std::string &json_;
+  size_t pos_;
+};
+
+
+IdlakSynthesizer::Dnn::Dnn() : model(NULL), in_transform(NULL),
+                               in_delta_opts(NULL), in_cmvn_opts(NULL),
+                               out_cmvn_opts(NULL) {}
+
+IdlakSynthesizer::Dnn::~Dnn() {
+  PyNnetModel_delete(model);
+  PyNnetModel_delete(in_transform);
+  if (in_delta_opts) PySimpleOptions_delete(in_delta_opts);
+  if (in_cmvn_opts) PySimpleOptions_delete(in_cmvn_opts);
+  if (out_cmvn_opts) PySimpleOptions_delete(out_cmvn_opts);
+}
+
+// Same files and options as TangleVoice._load_dnn and gen.NNet
+void IdlakSynthesizer::Dnn::Load(const std::string &dnndir,
+                                 const std::string &spk) {
+  std::string value;
+  model_filename = dnndir + "/final.nnet";
+  std::string feat_transform = dnndir + "/reverse_final.feature_transform";
+  if (!SynthFileExists(model_filename))
+    KALDI_ERR << "Cannot find model file: " << model_filename;
+  if (!SynthFileExists(feat_transform))
+    KALDI_ERR << "Cannot find transform file: " << feat_transform;
+
+  // input deltas
+  std::string optsfn = dnndir + "/indelta_opts";
+  if (SynthFileExists(optsfn)) {
+    std::string opts = SynthReadFile(optsfn);
+    int32 n;
+    in_delta_opts = PySimpleOptions_new(DeltaFeaturesOptions);
+    const char* keys[] = {"truncate", "delta-order", "delta-window", NULL};
+    for (int32 k = 0; keys[k]; k++) {
+      if (SynthOptValue(opts, keys[k], &value)) {
+        if (!ConvertStringToInteger(value, &n))
+          KALDI_ERR << "Bad value for --" << keys[k] << " in " << optsfn;
+        PySimpleOptions_set_int(in_delta_opts, keys[k], n);
+      }
+    }
+  }
+
+  // global input cmvn
+  optsfn = dnndir + "/incmvn_opts";
+  std::string cmvnfn = dnndir + "/incmvn_glob.ark";
+  if (SynthFileExists(optsfn) && SynthFileExists(cmvnfn)) {
+    std::string opts = SynthReadFile(optsfn);
+    in_cmvn_opts = PySimpleOptions_new(ApplyCMVNOptions);
+    if (SynthOptValue(opts, "norm-means", &value))
+      PySimpleOptions_set_bool(in_cmvn_opts, "norm-means", SynthOptBool(value));
+    if (SynthOptValue(opts, "norm-vars", &value))
+      PySimpleOptions_set_bool(in_cmvn_opts, "norm-vars", SynthOptBool(value));
+    ReadKaldiObject(cmvnfn, &in_cmvn);
+  }
+
+  // input transform, a separate network
+  std::string intransformfn = dnndir + "/input_final.feature_transform";
+  if (SynthFileExists(intransformfn)) {
+    PySimpleOptions* pyopts = PySimpleOptions_new(PdfPriorOptions);
+    PySimpleOptions_register(pyopts, NnetForwardOptions);
+    PySimpleOptions_set_str(pyopts, "model-filename", intransformfn);
+    in_transform = PyNnetModel_new(pyopts);
+    PySimpleOptions_delete(pyopts);
+    if (!in_transform)
+      KALDI_ERR << "Cannot load input transform: " << intransformfn;
+  }
+
+  // reversed output cmvn for the speaker
+  optsfn = dnndir + "/cmvn_opts";
+  cmvnfn = dnndir + "/cmvn.ark";
+  if (SynthFileExists(optsfn) && SynthFileExists(cmvnfn)) {
+    std::string opts = SynthReadFile(optsfn);
+    out_cmvn_opts = PySimpleOptions_new(ApplyCMVNOptions);
+    PySimpleOptions_set_bool(out_cmvn_opts, "reverse", true);
+    if (SynthOptValue(opts, "norm-means", &value))
+      PySimpleOptions_set_bool(out_cmvn_opts, "norm-means", SynthOptBool(value));
+    if (SynthOptValue(opts, "norm-vars", &value))
+      PySimpleOptions_set_bool(out_cmvn_opts, "norm-vars", SynthOptBool(value));
+    RandomAccessDoubleMatrixReader reader("ark:" + cmvnfn);
+    if (!reader.HasKey(spk))
+      KALDI_ERR << "No cmvn statistics for speaker '" << spk << "' in "
+                << cmvnfn;
+    out_cmvn = reader.Value(spk);
+  }
+
+  PySimpleOptions* pyopts = PySimpleOptions_new(PdfPriorOptions);
+  PySimpleOptions_register(pyopts, NnetForwardOptions);
+  PySimpleOptions_set_str(pyopts, "model-filename", model_filename);
+  PySimpleOptions_set_bool(pyopts, "reverse-transform", true);
+  PySimpleOptions_set_str(pyopts, "feature-transform", feat_transform);
+  model = PyNnetModel_new(pyopts);
+  PySimpleOptions_delete(pyopts);
+  if (!model) KALDI_ERR << "Cannot load model: " << model_filename;
+}
+
+// Same order as gen.NNet.forward_batch
+Matrix<BaseFloat>* IdlakSynthesizer::Dnn::Forward(
+    const MatrixBase<BaseFloat> &input) const {
+  std::unique_ptr<Matrix<BaseFloat> > mat;
+  if (in_delta_opts) {
+    mat.reset(PyAddDeltas(in_delta_opts, input));
+    if (!mat) return NULL;
+  }
+  if (in_cmvn_opts)
+    mat.reset(PyApplyCMVN(in_cmvn_opts, mat ? *mat : input, in_cmvn));
+  if (in_transform) {
+    mat.reset(PyNnetModel_Forward(in_transform, mat ? *mat : input));
+    if (!mat) return NULL;
+  }
+  mat.reset(PyNnetModel_Forward(model, mat ? *mat : input));
+  if (!mat) return NULL;
+  if (out_cmvn_opts)
+    mat.reset(PyApplyCMVN(out_cmvn_opts, *mat, out_cmvn));
+  return mat.release();
+}
+
+
+IdlakSynthesizer::IdlakSynthesizer() :
+    srate_(0), delta_order_(0), mcep_order_(0), bndap_order_(0), fftlen_(0),
+    voice_thresh_(0.8), alpha_(0.0), fshift_(0.005), po_(""),
+    band_opts_(NULL) {}
+
+IdlakSynthesizer::~IdlakSynthesizer() {
+  if (band_opts_) PySimpleOptions_delete(band_opts_);
+}
+
+void IdlakSynthesizer::Load(const std::string &voice_dir) {
+  voicedir_ = voice_dir;
+  LoadConfig(voicedir_ + "/voice.conf");
+  LoadTxp(voicedir_ + "/lang");
+
+  std::string freqfn = voicedir_ + "/lang/cex.ark.freq";
+  std::vector<std::vector<std::string> > values;
+  if (!SynthFileExists(freqfn))
+    KALDI_ERR << "Cannot find cex frequency table: " << freqfn;
+  std::string json = SynthReadFile(freqfn);
+  SynthCexFreqReader freqs(json);
+  if (!freqs.Read(&values))
+    KALDI_ERR << "Cannot parse cex frequency table: " << freqfn;
+  if (!cex_.SetDnnEncoding(values))
+    KALDI_ERR << "cex frequency table does not match the context features";
+
+  dur_.Load(voicedir_ + "/dur", spk_);
+  pitch_.Load(voicedir_ + "/pitch", spk_);
+  acoustic_.Load(voicedir_ + "/acoustic", spk_);
+  LoadMlpg();
+
+  band_opts_ = PySimpleOptions_new(AperiodicEnergyOptions);
+  PySimpleOptions_set_float(band_opts_, "sample-frequency", srate_);
+  PySimpleOptions_set_float(band_opts_, "frame-shift", fshift_);
+  PySimpleOptions_set_int(band_opts_, "num-mel-bins", bndap_order_);
+}
+
+void IdlakSynthesizer::LoadConfig(const std::string &fname) {
+  std::istringstream is(SynthReadFile(fname));
+  std::string line;
+  while (std::getline(is, line)) {
+    Trim(&line);
+    if (line.empty() || line[0] == '#') continue;
+    size_t eq = line.find('=');
+    if (eq == std::string::npos)
+      KALDI_ERR << "Cannot load voice configuration line: " << line;
+    std::string field = line.substr(0, eq), val = line.substr(eq + 1);
+    bool ok = true;
+    if (field == "lng") lng_ = val;
+    else if (field == "acc") acc_ = val;
+    else if (field == "spk") spk_ = val;
+    else if (field == "region") region_ = val;
+    else if (field == "tpdbvar") continue;
+    else if (field == "srate") ok = ConvertStringToInteger(val, &srate_);
+    else if (field == "delta_order")
+      ok = ConvertStringToInteger(val, &delta_order_);
+    else if (field == "mcep_order")
+      ok = ConvertStringToInteger(val, &mcep_order_);
+    else if (field == "bndap_order")
+      ok = ConvertStringToInteger(val, &bndap_order_);
+    else if (field == "fftlen") ok = ConvertStringToInteger(val, &fftlen_);
+    else if (field == "voice_thresh") ok = ConvertStringToReal(val, &voice_thresh_);
+    else if (field == "alpha") ok = ConvertStringToReal(val, &alpha_);
+    else if (field == "fshift") ok = ConvertStringToReal(val, &fshift_);
+    else
+      KALDI_WARN << "unknown voice configuration field '" << field << "'";
+    if (!ok)
+      KALDI_WARN << "voice configuration cannot convert '" << field << "'";
+  }
+  if (lng_.empty()) KALDI_WARN << "voice configuration missing langage (lng)";
+  if (acc_.empty()) KALDI_WARN << "voice configuration missing accent (acc)";
+  if (spk_.empty()) KALDI_WARN << "voice configuration missing speaker (spk)";
+  if (srate_ <= 0 || mcep_order_ <= 0 || bndap_order_ <= 0 || fftlen_ <= 0
+      || fshift_ <= 0.0)
+    KALDI_ERR << "voice configuration needs srate, mcep_order, bndap_order, "
+              << "fftlen and fshift: " << fname;
+}
+
+void IdlakSynthesizer::LoadTxp(const std::string &tpdb) {
+  std::vector<std::string> args;
+  args.push_back("idlak-synth");
+  args.push_back("--tpdb=" + tpdb);
+  args.push_back("--general-lang=" + lng_);
+  args.push_back("--general-acc=" + acc_);
+  if (!region_.empty()) args.push_back("--general-region=" + region_);
+  std::vector<const char*> argv;
+  for (size_t i = 0; i < args.size(); i++) argv.push_back(args[i].c_str());
+  po_.Read(argv.size(), &argv[0]);
+  if (!tokenise_.Init(po_) || !postag_.Init(po_) || !pauses_.Init(po_) ||
+      !phrasing_.Init(po_) || !pronounce_.Init(po_) ||
+      !syllabify_.Init(po_) || !cex_.Init(po_))
+    KALDI_ERR << "Cannot load the txp modules from " << tpdb;
+  tokens_.Add(&postag_);
+  tokens_.Add(&pauses_);
+}
+
+void IdlakSynthesizer::LoadMlpg() {
+  std::string fname = voicedir_ + "/lang/var_cmp.txt";
+  std::istringstream is(SynthReadFile(fname));
+  std::string line;
+  std::vector<double> var;
+  while (std::getline(is, line)) {
+    std::vector<std::string> fields;
+    SplitStringToVector(line, " \t", true, &fields);
+    if (fields.empty()) continue;
+    double v;
+    if (fields.size() < 2 || !ConvertStringToReal(fields[1], &v))
+      KALDI_ERR << "Bad line in " << fname << ": " << line;
+    var.push_back(v);
+  }
+  // the order in the file is f0, df0, ddf0, mcep, bndap, d_mcep, d_bndap,
+  // dd_mcep, dd_bndap with the confidence alongside f0
+  int32 m = mcep_order_ + 1, b = bndap_order_;
+  if (var.size() < static_cast<size_t>(6 + 3 * (m + b)))
+    KALDI_ERR << "Too few variances in " << fname;
+  logf0_.variances.assign(var.begin(), var.begin() + 6);
+  mcep_.variances.clear();
+  bndap_.variances.clear();
+  for (int32 d = 0; d < 3; d++) {
+    std::vector<double>::const_iterator start = var.begin() + 6 + d * (m + b);
+    mcep_.variances.insert(mcep_.variances.end(), start, start + m);
+    bndap_.variances.insert(bndap_.variances.end(), start + m, start + m + b);
+  }
+
+  const char* names[] = {"logF0", "mcep", "bndap"};
+  MlpgStream* streams[] = {&logf0_, &mcep_, &bndap_};
+  for (int32 n = 0; n < 3; n++) {
+    streams[n]->windows.resize(2);
+    SynthReadFloats(voicedir_ + "/win/" + names[n] + "_d1.txt",
+                    &streams[n]->windows[0]);
+    SynthReadFloats(voicedir_ + "/win/" + names[n] + "_d2.txt",
+                    &streams[n]->windows[1]);
+  }
+}
+
+bool IdlakSynthesizer::ProcessText(const std::string &text,
+                                   pugi::xml_document* doc) {
+  pugi::xml_parse_result r = doc->load(text.c_str(),
+                                       pugi::encoding_utf8 | pugi::parse_escapes);
+  if (!r || !doc->document_element()) {
+    std::string wrapped = "<parent>" + text + "</parent>";
+    r = doc->load(wrapped.c_str(), pugi::encoding_utf8 | pugi::parse_escapes);
+    if (!r) {
+      KALDI_WARN << "Cannot parse input: " << r.description();
+      return false;
+    }
+  }
+  TxpProcessTimed(&tokenise_, doc);
+  tokens_.Process(doc);
+  TxpProcessTimed(&phrasing_, doc);
+  TxpProcessTimed(&pronounce_, doc);
+  TxpProcessTimed(&syllabify_, doc);
+  return true;
+}
+
+bool IdlakSynthesizer::Synthesise(pugi::xml_document* doc,
+                                  const SpurtCallback &callback) {
+  std::vector<std::string> ids;
+  std::vector<Matrix<BaseFloat> > feats;
+  {
+    TxpStageTimer timer("cex");
+    if (!cex_.ProcessDnnFeatures(doc, &ids, &feats)) return false;
+    int32 nphones = 0;
+    for (size_t i = 0; i < feats.size(); i++) nphones += feats[i].NumRows();
+    timer.SetItems(nphones, "phones");
+  }
+  std::vector<double> waveform;
+  for (size_t i = 0; i < ids.size(); i++) {
+    SynthesiseSpurt(feats[i], &waveform);
+    TxpStageStatsAddAudio(static_cast<double>(waveform.size()) / srate_);
+    callback(ids[i], waveform);
+  }
+  return !ids.empty();
+}
+
+bool IdlakSynthesizer::Speak(const std::string &text,
+                             const SpurtCallback &callback) {
+  TxpStageTimer timer("speak");
+  pugi::xml_document doc;
+  if (!ProcessText(text, &doc)) return false;
+  return Synthesise(&doc, callback);
+}
+
+bool IdlakSynthesizer::Speak(const std::string &text,
+                             std::vector<double>* waveform) {
+  return Speak(text, [waveform](const std::string &spurtid,
+                                const std::vector<double> &spurt) {
+      waveform->insert(waveform->end(), spurt.begin(), spurt.end());
+    });
+}
+
+// The first column of the prediction is the state duration and the second
+// the phone duration. The phone durations of the states are averaged, then
+// averaged with the total state duration and the states rescaled to match.
+// The first and last states model the transitions so have at least a frame.
+void IdlakSynthesizer::PostDurationProcessing(
+    const MatrixBase<BaseFloat> &durmatrix,
+    Matrix<BaseFloat>* durations) const {
+  if (durmatrix.NumCols() < 2)
+    KALDI_ERR << "Duration model must predict state and phone durations";
+  int32 nphones = durmatrix.NumRows() / kNumStates;
+  durations->Resize(nphones, kNumStates);
+  for (int32 p = 0; p < nphones; p++) {
+    double state_durs[kNumStates];
+    double mean_phn = 0.0, total = 0.0;
+    for (int32 s = 0; s < kNumStates; s++) {
+      state_durs[s] = std::max<double>(durmatrix(p * kNumStates + s, 0), 0.0);
+      mean_phn += durmatrix(p * kNumStates + s, 1);
+      total += state_durs[s];
+    }
+    mean_phn = std::max(mean_phn / kNumStates, 0.0);
+    if (total > 0.0 && mean_phn > 0.0) {
+      double ratio = std::ceil((mean_phn + total) / 2) / total;
+      for (int32 s = 0; s < kNumStates; s++)
+        state_durs[s] = std::ceil(state_durs[s] * ratio);
+    } else {
+      KALDI_WARN << "In phone " << p
+                 << (total == 0.0 ? ": all states have 0 duration" : "")
+                 << (mean_phn == 0.0 ? ": mean phone duration is 0" : "");
+    }
+    state_durs[0] = std::max(state_durs[0], 1.0);
+    state_durs[kNumStates - 1] = std::max(state_durs[kNumStates - 1], 1.0);
+    for (int32 s = 0; s < kNumStates; s++)
+      (*durations)(p, s) = state_durs[s];
+  }
+}
+
+// As TangleVoice._apply_mlpg, the variances of the first and last frames
+// are zero
+void IdlakSynthesizer::ApplyMlpg(const MatrixBase<BaseFloat> &means,
+                                 const MlpgStream &stream,
+                                 Matrix<double>* output) const {
+  int32 nframes = means.NumRows(), order = means.NumCols() / 3;
+  if (stream.variances.size() < static_cast<size_t>(3 * order))
+    KALDI_ERR << "Too few MLPG variances for order " << order;
+  std::vector<double> input(static_cast<size_t>(nframes) * 6 * order, 0.0);
+  for (int32 f = 0; f < nframes; f++) {
+    double* frame = &input[static_cast<size_t>(f) * 6 * order];
+    for (int32 k = 0; k < 3 * order; k++) frame[k] = means(f, k);
+    if (f > 0 && f < nframes - 1)
+      std::copy(stream.variances.begin(), stream.variances.begin() + 3 * order,
+                frame + 3 * order);
+  }
+  TxpStageTimer timer("mlpg");
+  timer.SetItems(nframes, "frames");
+  std::vector<double> result = PySPTK_mlpg(input, order, stream.windows, 0,
+                                           kMlpgInfluenceRange);
+  if (result.size() != static_cast<size_t>(nframes) * order)
+    KALDI_ERR << "MLPG failed, check the variances";
+  output->Resize(nframes, order, kUndefined);
+  for (int32 f = 0; f < nframes; f++)
+    std::copy(&result[static_cast<size_t>(f) * order],
+              &result[static_cast<size_t>(f + 1) * order], output->RowData(f));
+}
+
+void IdlakSynthesizer::SynthesiseSpurt(
+    const MatrixBase<BaseFloat> &phone_features,
+    std::vector<double>* waveform) const {
+  waveform->clear();
+  int32 nphones = phone_features.NumRows(), dim = phone_features.NumCols();
+  if (!nphones) return;
+
+  // state durations, each phone is input once per state with its index
+  Matrix<BaseFloat> dur_in(nphones * kNumStates, dim + 1, kUndefined);
+  for (int32 p = 0; p < nphones; p++) {
+    for (int32 s = 0; s < kNumStates; s++) {
+      SubVector<BaseFloat> row(dur_in, p * kNumStates + s);
+      row.Range(0, dim).CopyFromVec(phone_features.Row(p));
+      row(dim) = s;
+    }
+  }
+  std::unique_ptr<Matrix<BaseFloat> > out;
+  {
+    TxpStageTimer timer("duration");
+    timer.SetItems(nphones, "phones");
+    out.reset(dur_.Forward(dur_in));
+  }
+  if (!out) KALDI_ERR << "Forward pass failed for model: " << dur_.model_filename;
+  Matrix<BaseFloat> durations;
+  PostDurationProcessing(*out, &durations);
+
+  // pitch, rows are the voicing confidence and f0 per frame
+  std::unique_ptr<Matrix<BaseFloat> > feats(PyCombineDurationsAndFeatures(
+      phone_features, durations, kStatePosFuzz, kPhonePosFuzz));
+  if (!feats) KALDI_ERR << "Cannot combine durations and features";
+  int32 nframes = feats->NumRows();
+  if (!nframes) return;
+  {
+    TxpStageTimer timer("pitch");
+    timer.SetItems(nframes, "frames");
+    out.reset(pitch_.Forward(*feats));
+  }
+  if (!out) KALDI_ERR << "Forward pass failed for model: " << pitch_.model_filename;
+  Matrix<double> pitch;
+  ApplyMlpg(*out, logf0_, &pitch);
+  if (pitch.NumCols() < 2)
+    KALDI_ERR << "Pitch model must predict voicing confidence and f0";
+
+  // acoustic features, the output is mcep, bndap then their deltas and
+  // double deltas
+  Matrix<BaseFloat> ac_in(nframes, pitch.NumCols() + feats->NumCols(),
+                          kUndefined);
+  ac_in.ColRange(0, pitch.NumCols()).CopyFromMat(pitch);
+  ac_in.ColRange(pitch.NumCols(), feats->NumCols()).CopyFromMat(*feats);
+  {
+    TxpStageTimer timer("acoustic");
+    timer.SetItems(nframes, "frames");
+    out.reset(acoustic_.Forward(ac_in));
+  }
+  if (!out)
+    KALDI_ERR << "Forward pass failed for model: " << acoustic_.model_filename;
+  int32 m = mcep_order_ + 1, b = bndap_order_;
+  if (out->NumCols() < 3 * (m + b))
+    KALDI_ERR << "Acoustic model output has " << out->NumCols()
+              << " columns, expected " << 3 * (m + b);
+  Matrix<BaseFloat> mcep_in(nframes, 3 * m, kUndefined),
+      bndap_in(nframes, 3 * b, kUndefined);
+  for (int32 d = 0; d < 3; d++) {
+    mcep_in.ColRange(d * m, m).CopyFromMat(out->ColRange(d * (m + b), m));
+    bndap_in.ColRange(d * b, b).CopyFromMat(out->ColRange(d * (m + b) + m, b));
+  }
+  Matrix<double> mceps, bndaps;
+  ApplyMlpg(mcep_in, mcep_, &mceps);
+  ApplyMlpg(bndap_in, bndap_, &bndaps);
+
+  // band aperiodicities are predicted as log values, the excitation takes
+  // decibels. Unvoiced frames have no f0 and no aperiodicity
+  std::vector<double> f0s(nframes), flat_bndaps(nframes * b),
+      flat_mceps(nframes * m);
+  for (int32 f = 0; f < nframes; f++) {
+    bool voiced = pitch(f, 0) > voice_thresh_;
+    f0s[f] = voiced ? pitch(f, 1) : 0.0;
+    for (int32 j = 0; j < b; j++) {
+      double v = bndaps(f, j);
+      v = (v >= -0.5) ? 0.0 : 20.0 * (v + 0.5) / M_LN10;
+      flat_bndaps[f * b + j] = voiced ? v : 0.0;
+    }
+    std::copy(mceps.RowData(f), mceps.RowData(f) + m, &flat_mceps[f * m]);
+  }
+  std::vector<double> excitation;
+  {
+    TxpStageTimer timer("excitation");
+    timer.SetItems(nframes, "frames");
+    excitation = PyVocoder_mixed_excitation(
+        band_opts_, f0s, flat_bndaps, srate_, fshift_, kF0Min, fftlen_,
+        2.0 * fshift_, true, kExcitationSeed);
+  }
+  TxpStageTimer timer("mlsa");
+  timer.SetItems(excitation.size(), "samples");
+  std::vector<double> stable_mceps = PySPTK_mlsacheck(
+      flat_mceps, mcep_order_, alpha_, fftlen_, 2, 0, kPadeOrder, 0.0, true);
+  *waveform = PySPTK_mlsadf(stable_mceps, excitation, mcep_order_, alpha_,
+                            static_cast<int>(srate_ * fshift_), 1, kPadeOrder,
+                            false, false, false, false);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,145 @@
+// pyIdlak/synth/pyIdlak_synthesizer.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_PYIDLAK_SYNTH_PYIDLAK_SYNTHESIZER_H_
+#define KALDI_PYIDLAK_SYNTH_PYIDLAK_SYNTHESIZER_H_
+
+// This file defines a text to waveform synthesizer for a tangle voice, the
+// same pipeline as pyIdlak.TangleVoice.speak run without going through
+// Python between the stages
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "pugixml.hpp"
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+#include "idlaktxp/idlaktxp.h"
+#include "idlaktxp/txptokenpass.h"
+#include "pyIdlak/gen/python-gen-api.h"
+
+namespace kaldi {
+
+/// Synthesizes speech for a voice directory as built by the tangle recipe
+/// (voice.conf, lang, dur, pitch, acoustic and win).
+///
+/// Text goes through the C++ txp modules and context extraction, then the
+/// duration, pitch and acoustic DNNs, MLPG, mixed excitation and the MLSA
+/// filter. Each spurt is passed to the callback as soon as it has been
+/// vocoded. The Python normaliser and post lexical rules have no C++
+/// module, documents processed by them in Python can be given to
+/// Synthesise instead of text.
+///
+/// The models are not shared between threads, use one synthesizer per
+/// thread.
+class IdlakSynthesizer {
+ public:
+  /// Called with the waveform of each spurt, in order
+  typedef std::function<void(const std::string &spurtid,
+                             const std::vector<double> &waveform)>
+      SpurtCallback;
+  IdlakSynthesizer();
+  ~IdlakSynthesizer();
+  /// Load the voice, throws on a missing or bad voice file
+  void Load(const std::string &voice_dir);
+  /// Run the txp modules on text, which is wrapped in a parent element if
+  /// it is not XML. False if it can not be parsed
+  bool ProcessText(const std::string &text, pugi::xml_document* doc);
+  /// Synthesize a document which has been through text processing but not
+  /// context extraction. False if no spurts were produced, throws if a
+  /// model fails
+  bool Synthesise(pugi::xml_document* doc, const SpurtCallback &callback);
+  /// Text to speech, the spurt waveforms are appended to waveform
+  bool Speak(const std::string &text, std::vector<double>* waveform);
+  bool Speak(const std::string &text, const SpurtCallback &callback);
+  int32 SampleRate() const {return srate_;}
+
+ private:
+  // A DNN with the pre and post processing found next to it
+  struct Dnn {
+    Dnn();
+    ~Dnn();
+    void Load(const std::string &dnndir, const std::string &spk);
+    // NULL if the forward pass failed
+    Matrix<BaseFloat>* Forward(const MatrixBase<BaseFloat> &input) const;
+    std::string model_filename;
+    PyNnetModel* model;
+    PyNnetModel* in_transform;
+    PySimpleOptions* in_delta_opts;
+    PySimpleOptions* in_cmvn_opts;
+    PySimpleOptions* out_cmvn_opts;
+    Matrix<double> in_cmvn;
+    Matrix<double> out_cmvn;
+  };
+  // Means, variances and windows for one stream of MLPG
+  struct MlpgStream {
+    std::vector<double> variances;
+    std::vector<std::vector<double> > windows;
+  };
+  void LoadConfig(const std::string &fname);
+  void LoadTxp(const std::string &tpdb);
+  void LoadMlpg();
+  // state durations in frames, a row per phone
+  void PostDurationProcessing(const MatrixBase<BaseFloat> &durmatrix,
+                              Matrix<BaseFloat>* durations) const;
+  // columns are a third each of means, deltas and double deltas
+  void ApplyMlpg(const MatrixBase<BaseFloat> &means,
+                 const MlpgStream &stream, Matrix<double>* output) const;
+  // empty if the spurt has no phones
+  void SynthesiseSpurt(const MatrixBase<BaseFloat> &phone_features,
+                       std::vector<double>* waveform) const;
+
+  std::string voicedir_;
+  std::string lng_, acc_, spk_, region_;
+  int32 srate_;
+  int32 delta_order_;
+  int32 mcep_order_;
+  int32 bndap_order_;
+  int32 fftlen_;
+  double voice_thresh_;
+  double alpha_;
+  double fshift_;
+
+  TxpParseOptions po_;
+  TxpTokenise tokenise_;
+  TxpPosTag postag_;
+  TxpPauses pauses_;
+  TxpPhrasing phrasing_;
+  TxpPronounce pronounce_;
+  TxpSyllabify syllabify_;
+  TxpCex cex_;
+  // part of speech and pauses share one walk of the tokens
+  TxpTokenPass tokens_;
+
+  Dnn dur_;
+  Dnn pitch_;
+  Dnn acoustic_;
+  MlpgStream logf0_;
+  MlpgStream mcep_;
+  MlpgStream bndap_;
+  // band layout for the mixed excitation
+  PySimpleOptions* band_opts_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(IdlakSynthesizer);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_PYIDLAK_SYNTH_PYIDLAK_SYNTHESIZER_H_
@@ -0,0 +1,108 @@
+// pyIdlak/synth/python-synth-api.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <mutex>
+#include <stdexcept>
+
+#include "idlaktxp/txpbinxml.h"
+#include "idlaktxp/txpxmlarena.h"
+#include "pyIdlak_synthesizer.h"
+#include "python-synth-api.h"
+
+// XML trees are built in pages from the arena, see idlaktxp/txpxmlarena.h
+static const bool _xml_arena_installed = (kaldi::TxpXmlArenaInstall(), true);
+
+struct PyIdlakSynthesizer {
+  kaldi::IdlakSynthesizer synth_;
+  // the models keep state while running, calls from several Python
+  // threads take turns
+  std::mutex mutex_;
+};
+
+PyIdlakSynthesizer * PyIdlakSynthesizer_new(const char * voice_dir) {
+  PyIdlakSynthesizer * synth = new PyIdlakSynthesizer;
+  try {
+    synth->synth_.Load(voice_dir);
+    return synth;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    delete synth;
+    return nullptr;
+  }
+}
+
+void PyIdlakSynthesizer_delete(PyIdlakSynthesizer * synth) {
+  delete synth;
+}
+
+int PyIdlakSynthesizer_srate(PyIdlakSynthesizer * synth) {
+  if (!synth) return 0;
+  return synth->synth_.SampleRate();
+}
+
+std::vector<double> PyIdlakSynthesizer_speak(PyIdlakSynthesizer * synth,
+                                             const char * text) {
+  std::vector<double> waveform;
+  if (!synth || !text) return waveform;
+  std::lock_guard<std::mutex> lock(synth->mutex_);
+  try {
+    synth->synth_.Speak(text, &waveform);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    waveform.clear();
+  }
+  return waveform;
+}
+
+std::vector<std::vector<double>> PyIdlakSynthesizer_speak_spurts(
+    PyIdlakSynthesizer * synth, const char * text) {
+  std::vector<std::vector<double>> spurts;
+  if (!synth || !text) return spurts;
+  std::lock_guard<std::mutex> lock(synth->mutex_);
+  try {
+    synth->synth_.Speak(text, [&spurts](const std::string &spurtid,
+                                        const std::vector<double> &waveform) {
+        spurts.push_back(waveform);
+      });
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    spurts.clear();
+  }
+  return spurts;
+}
+
+std::vector<double> PyIdlakSynthesizer_synthesise_binary(
+    PyIdlakSynthesizer * synth, const char * data, size_t len) {
+  std::vector<double> waveform;
+  kaldi::TxpBinaryXml reader;
+  if (!synth || !reader.Open(data, len)) return waveform;
+  pugi::xml_document doc;
+  reader.Load(&doc);
+  std::lock_guard<std::mutex> lock(synth->mutex_);
+  try {
+    synth->synth_.Synthesise(&doc, [&waveform](const std::string &spurtid,
+                                               const std::vector<double> &spurt) {
+        waveform.insert(waveform.end(), spurt.begin(), spurt.end());
+      });
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    waveform.clear();
+  }
+  return waveform;
+}
@@ -0,0 +1,44 @@
+// pyIdlak/synth/python-synth-api.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef KALDI_PYIDLAK_SYNTH_PYTHON_SYNTH_API_H_
+#define KALDI_PYIDLAK_SYNTH_PYTHON_SYNTH_API_H_
+
+#include "pyIdlak/pylib/pyIdlak_types.h"
+
+// A voice loaded for text to speech, see pyIdlak_synthesizer.h. Returns
+// NULL if the voice cannot be loaded
+typedef struct PyIdlakSynthesizer PyIdlakSynthesizer;
+
+PyIdlakSynthesizer * PyIdlakSynthesizer_new(const char * voice_dir);
+void PyIdlakSynthesizer_delete(PyIdlakSynthesizer * synth);
+int PyIdlakSynthesizer_srate(PyIdlakSynthesizer * synth);
+
+// Waveform for text or XML. Empty if nothing could be synthesised
+std::vector<double> PyIdlakSynthesizer_speak(PyIdlakSynthesizer * synth,
+                                             const char * text);
+// As above with a waveform for each spurt
+std::vector<std::vector<double>> PyIdlakSynthesizer_speak_spurts(
+    PyIdlakSynthesizer * synth, const char * text);
+// Waveform for a binary txp document (PyPugiXMLDocument_SaveBinary) that
+// has been through text processing in Python
+std::vector<double> PyIdlakSynthesizer_synthesise_binary(
+    PyIdlakSynthesizer * synth, const char * data, size_t len);
+
+#endif // KALDI_PYIDLAK_SYNTH_PYTHON_SYNTH_API_H_
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+import math
+import unittest
+import sys
+import os
+
+from os.path import join as pjoin
+
+here = os.path.abspath(os.path.dirname(__file__))
+
+sys.path.insert(0, pjoin(here, '..', '..'))
+import pyIdlak
+from pyIdlak import gen
+from pyIdlak import pylib
+
+
+class TestIdlakPythonGen(unittest.TestCase):
+
+    state_pos_fuzz = 0.2
+    phone_pos_fuzz = 0.1
+
+    phone_features = [[1., 2., 3.], [4., 5., 6.]]
+    state_durations = [[1, 2, 1, 3, 1], [2, 0, 1, 1, 4]]
+
+    def _fuzzy_position(self, fuzzy_factor, position, duration):
+        return math.ceil((position / duration) / fuzzy_factor)
+
+    def _combine(self, features, durations):
+        """ Reference implementation of the frame expansion """
+        combined = []
+        for phnfeatures, statedurs in zip(features, durations):
+            phndur = sum(statedurs)
+            for stateidx, statedur in enumerate(statedurs):
+                for statepos in range(statedur):
+                    phnpos = sum(statedurs[:stateidx]) + statepos
+                    combined.append(phnfeatures + [
+                        stateidx, statedur,
+                        self._fuzzy_position(self.state_pos_fuzz, statepos, statedur),
+                        phndur,
+                        self._fuzzy_position(self.phone_pos_fuzz, phnpos, phndur)])
+        return combined
+
+    def _post_durations(self, durmatrix, N):
+        """ Reference implementation of the duration post processing """
+        state_durations = []
+        for p in range(0, len(durmatrix), N):
+            rows = durmatrix[p:p + N]
+            statedurs = [max(row[0], 0) for row in rows]
+            mean_phn = max(sum(row[1] for row in rows) / N, 0)
+            total = sum(statedurs)
+            if total > 0. and mean_phn > 0.:
+                ratio = math.ceil((mean_phn + total) / 2) / total
+                statedurs = [math.ceil(d * ratio) for d in statedurs]
+            statedurs[0] = max(statedurs[0], 1)
+            statedurs[N - 1] = max(statedurs[N - 1], 1)
+            state_durations.append(statedurs)
+        return state_durations
+
+    """ Test cases start here """
+
+    def test_PyCombineDurationsAndFeatures(self):
+        """ Expanding phone features into frame features """
+        phnfeatures = pylib.PyKaldiMatrixBaseFloat_frmlist(self.phone_features)
+        statedurs = pylib.PyKaldiMatrixBaseFloat_frmlist(self.state_durations)
+        mat = gen.c_api.PyCombineDurationsAndFeatures(
+            phnfeatures, statedurs, self.state_pos_fuzz, self.phone_pos_fuzz)
+        combined = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+        expected = self._combine(self.phone_features, self.state_durations)
+
+        self.assertEqual(len(expected), len(combined),
+                         "number of frames are not equal")
+        for exp_row, row in zip(expected, combined):
+            self.assertEqual(len(exp_row), len(row), "row lengths are not equal")
+            for exp_val, val in zip(exp_row, row):
+                self.assertAlmostEqual(exp_val, val, places = 5,
+                                       msg = "values are not the same")
+
+    def test_PyCombineDurationsAndFeatures_mismatch(self):
+        """ Number of phones must agree """
+        phnfeatures = pylib.PyKaldiMatrixBaseFloat_frmlist(self.phone_features[:1])
+        statedurs = pylib.PyKaldiMatrixBaseFloat_frmlist(self.state_durations)
+        mat = gen.c_api.PyCombineDurationsAndFeatures(
+            phnfeatures, statedurs, self.state_pos_fuzz, self.phone_pos_fuzz)
+        self.assertIsNone(mat)
+
+    def test_PyAddStateFeature(self):
+        """ Repeating phone features for each state """
+        phnfeatures = pylib.PyKaldiMatrixBaseFloat_frmlist(self.phone_features)
+        mat = gen.c_api.PyAddStateFeature(phnfeatures, 5)
+        stated = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+        expected = [row + [s] for row in self.phone_features for s in range(5)]
+        self.assertEqual(expected, stated)
+
+    def test_PyPostDurationProcessing(self):
+        """ Rescaling predicted state durations to whole frames """
+        durmatrix = [[3.2, 20.], [-1., 18.], [5.5, 25.], [0.4, 21.], [2., 19.],
+                     [0., 4.], [0., 6.], [0., 5.], [0., 5.], [0., 5.],
+                     [1.5, -3.], [2.5, -2.], [1., -1.], [0., -4.], [0.7, 0.]]
+        mat = gen.c_api.PyPostDurationProcessing(
+            pylib.PyKaldiMatrixBaseFloat_frmlist(durmatrix), 5)
+        durations = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+        expected = self._post_durations(durmatrix, 5)
+        self.assertEqual(len(expected), len(durations))
+        for exp_row, row in zip(expected, durations):
+            for exp_val, val in zip(exp_row, row):
+                self.assertAlmostEqual(exp_val, val, places = 5)
+
+    def test_PyPostDurationProcessing_bad_rows(self):
+        """ Rows must be a whole number of phones """
+        mat = gen.c_api.PyPostDurationProcessing(
+            pylib.PyKaldiMatrixBaseFloat_frmlist([[1., 2.]] * 4), 5)
+        self.assertIsNone(mat)
+
+    cex_xml = ('<parent><txpheader><cex>'
+               '<cexfunction name="PhonL" delim="^" isinteger="0"/>'
+               '<cexfunction name="PhonC" delim="~" isinteger="0"/>'
+               '<cexfunction name="NumSyl" delim="-" isinteger="1"/>'
+               '</cex></txpheader>'
+               '<fileid id="f1"><spt><utt><tk><syl>'
+               '<phon val="pau">^0~pau-0</phon><phon val="a">^pau~a-2</phon>'
+               '<phon val="pau">^a~pau-0</phon><phon val="pau">^pau~pau-0</phon>'
+               '</syl></tk></utt></spt></fileid>'
+               '<fileid><spt><phon val="b">^0~b-1</phon><phon>^b~pau-0</phon>'
+               '</spt></fileid></parent>')
+
+    def test_CEXParser_txp_document(self):
+        """ Context features read from a txp document match lxml """
+        from lxml import etree
+        from pyIdlak import txp
+        doc = txp.XMLDoc()
+        self.assertTrue(doc.load_string(self.cex_xml))
+        expected = gen.CEXParser(etree.fromstring(self.cex_xml)).parse(
+            etree.fromstring(self.cex_xml))
+        cex_features = gen.CEXParser(doc.root).parse(doc.root)
+        self.assertEqual(expected, cex_features)
+        self.assertEqual(['f1', 'test001'], list(cex_features.keys()))
+        self.assertEqual(3, len(cex_features['f1']))
+
+    def test_XMLDoc_load_string_invalid(self):
+        """ Documents without a single root element are rejected """
+        from pyIdlak import txp
+        doc = txp.XMLDoc()
+        self.assertFalse(doc.load_string('Hello <b>world</b>'))
+        self.assertFalse(doc.load_string('<a>1</a><a>2</a>'))
+        self.assertFalse(doc.load_string('<a>1'))
+        self.assertTrue(doc.load_string('<?xml version="1.0"?><a>1</a>'))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -193,6 +193,60 @@ class TestIdlakPythonVocoder(unittest.TestCase):
                 self.assertAlmostEqual(sptk_val, idlak_val,
                              places = 1, msg = "values are not the same")
 
+    def test_MLSASynthesizer(self):
+        """ Streaming MLSA matches vocoding everything at once """
+        mcep_voc = vocoder.MCEPVocoder()
+        mceps = self.mceps.tolist()
+        excitation = mcep_voc.gen_excitation(self.f0s.tolist())
+        full_waveform = mcep_voc.apply_mlsa(mceps, excitation)
+
+        synth = mcep_voc.mlsa_synthesizer()
+        waveform = []
+        chunk = 50
+        for start in range(0, len(mceps), chunk):
+            exc = excitation[start * self.fperiod:(start + chunk) * self.fperiod]
+            waveform.extend(synth.process(mceps[start:start + chunk], exc))
+        waveform.extend(synth.flush())
+
+        self.assertEqual(len(full_waveform), len(waveform),
+                         "lengths are not equal")
+        for full_val, val in zip(full_waveform, waveform):
+            self.assertAlmostEqual(full_val, val, places = 5,
+                                   msg = "values are not the same")
+
+    def test_ola_synthesis(self):
+        """ Overlap-add synthesis sounds like MLSA """
+        mcep_voc = vocoder.MCEPVocoder()
+        mceps = self.mceps.tolist()
+        f0s = self.f0s.tolist()
+        excitation = mcep_voc.gen_excitation(f0s)
+        mlsa_waveform = np.array(mcep_voc.apply_mlsa(mceps, excitation))
+        ola_waveform = np.array(mcep_voc.apply_ola(mceps, excitation))
+        self.assertEqual(len(mlsa_waveform), len(ola_waveform),
+                         "lengths are not equal")
+
+        # the energy contours in 20ms frames agree where there is speech
+        frame = 4 * self.fperiod
+        noframes = len(mlsa_waveform) // frame
+        def _energy(waveform):
+            frames = waveform[:noframes * frame].reshape(noframes, frame)
+            return 10. * np.log10(np.sum(np.square(frames), axis = 1) + 1e-10)
+        mlsa_energy = _energy(mlsa_waveform)
+        ola_energy = _energy(ola_waveform)
+        speech = mlsa_energy > np.max(mlsa_energy) - 40.
+        self.assertLess(np.mean(np.abs(mlsa_energy - ola_energy)[speech]),
+                        1.0, "energy contours differ")
+
+        # and is the filter of vocode_spurts when selected
+        mcep_voc.synthesis = 'ola'
+        spurt_waveform = mcep_voc.vocode_spurts(
+            [(mceps, f0s, None)], vocoder.MCEPExcitation.SPTK)
+        self.assertEqual(len(spurt_waveform), len(ola_waveform),
+                         "lengths are not equal")
+        for ola_val, val in zip(ola_waveform, spurt_waveform):
+            self.assertAlmostEqual(ola_val, val, places = 5,
+                                   msg = "values are not the same")
+
     def test_mixed_excitation(self):
         """ Test generating mixed excitation """
         with tempfile.TemporaryDirectory() as testdir:
@@ -211,6 +265,21 @@ class TestIdlakPythonVocoder(unittest.TestCase):
 
 
 
+    def test_PyVocoder_mixed_excitation(self):
+        """ Native mixed excitation """
+        f0s = self.f0s.tolist()
+        bndaps = self.bndaps.tolist()
+        excitation = vocoder.excitation.mixed_excitation(
+            f0s, bndaps, self.srate, self.fshift, fftlen = self.fftlen)
+        offset = self.fftlen // 2 - self.fperiod
+        self.assertEqual(len(excitation), len(f0s) * self.fperiod - offset,
+                         "number of samples mismatch")
+        rms = np.sqrt(np.mean(np.square(excitation)))
+        self.assertGreater(rms, 0.0, "Excitation seems to be silent")
+        self.assertTrue(np.all(np.isfinite(excitation)),
+                        "Excitation is not finite")
+
+
     def test_MCEPVocoder(self):
         with tempfile.TemporaryDirectory() as testdir:
             mcep_voc = vocoder.MCEPVocoder()
@@ -23,7 +23,10 @@ from . import pytxplib
 
 # The normal Python API
 from .idargparse import TxpArgumentParser
-from .xmldoc import XMLDoc
+from .xmldoc import XMLDoc, XMLNode
 
 from . import modulefactory as modules
 
+
+# Timings of the synthesis stages
+from . import stagestats
@@ -18,6 +18,9 @@
 
 # Automatically generate the C++ modules (add the python modules at the end of file)
 
+import collections
+
+from ..pylib import c_api as pyIdlak_pylib
 from . import pyIdlak_txp
 from . import idargparse
 from . import xmldoc
@@ -72,6 +75,71 @@ for _i in range(pyIdlak_txp.Empty, pyIdlak_txp.NumMods+1):
     globals()[_modcls.__name__] = _module_factory(_i)
 
 
+class ContextExtraction(_module_factory(pyIdlak_txp.ContextExtraction)):
+    """ Context extraction, which can also convert a document directly to
+        DNN input features without writing the model names """
+
+    def set_dnn_encoding(self, cexfreqtable):
+        """ Sets the DNN input feature encoding from a cex frequency table
+            (as loaded by gen.load_cexfreqtable), which must have the phone
+            names then each context feature in order """
+        values = [list(map(str, val_freqs.keys()))
+                  for val_freqs in cexfreqtable.values()]
+        if not pyIdlak_txp.PyIdlakModule_SetDnnEncoding(self._mod, values):
+            raise ValueError("cex frequency table does not match the "
+                             "context features")
+
+
+    def dnn_features(self, doc):
+        """ Runs context extraction on the document and returns the DNN
+            input features for each spurt, in the same form as
+            gen.cex_to_feat """
+        if not type(doc) is xmldoc.XMLDoc:
+            raise ValueError("doc must be a XMLDoc")
+
+        feats = pyIdlak_txp.PyIdlakModule_DnnFeatures(self._mod, doc.idlak_doc)
+        dnnfeatures = collections.OrderedDict()
+        for i in range(pyIdlak_txp.PyCexDnnFeatures_size(feats)):
+            spurtid = pyIdlak_txp.PyCexDnnFeatures_id(feats, i)
+            dnnfeatures[spurtid] = pyIdlak_pylib.PyKaldiMatrixBaseFloat_tolist(
+                pyIdlak_txp.PyCexDnnFeatures_matrix(feats, i))
+        pyIdlak_txp.PyCexDnnFeatures_delete(feats)
+        return dnnfeatures
+
+
+class Pronounce(_module_factory(pyIdlak_txp.Pronounce)):
+    """ Pronunciation, with user entries that can be changed in the
+        lexicon while the module is in use. The lexicon is shared by the
+        modules loaded from the same tpdb, so a change applies to all of
+        them """
+
+    def add_lexicon_entry(self, word, entry, pron, default = False):
+        """ Adds or replaces the pronunciation of the entry (e.g. 'full')
+            of the word, pron being space separated phones """
+        if not pyIdlak_txp.PyIdlakModule_LexiconAdd(self._mod, word, entry,
+                                                     pron, default):
+            raise ValueError("invalid lexicon entry '{0}' for '{1}'".format(
+                entry, word))
+
+
+    def remove_lexicon_entry(self, word, entry = ''):
+        """ Removes the entry of the word, or the word if entry is empty.
+            Returns False if there was no such entry """
+        return bool(pyIdlak_txp.PyIdlakModule_LexiconRemove(
+            self._mod, word, entry))
+
+
+    def clear_lexicon_entries(self):
+        """ Removes all user entries """
+        pyIdlak_txp.PyIdlakModule_LexiconClear(self._mod)
+
+
+    @property
+    def lexicon_version(self):
+        """ The number of changes made to the user entries """
+        return pyIdlak_txp.PyIdlakModule_LexiconVersion(self._mod)
+
+
 # Add Python modules here
 
 from .normaliser.normaliser import Normalise
@@ -32,6 +32,8 @@ from .. import idargparse, xmldoc, pyIdlak_txp, pytxplib
 _validmatchtypes = ['rgx', 'xml']
 _validreplacetypes = ['fixed', 'lookup', 'func', 'xml']
 _validsrc = ['lcase', 'mcase', 'pos']
+# tokens with a norm matching this are already normalised
+_normalisedrgx = compile('^[a-z ]*$')
 
 
 def loadhrules(hrules_fn):
@@ -158,8 +160,11 @@ class RgxMatch(Match):
             return False, []
         if self.rgxname not in self.norm.rgxs:
             return False, []
+        return self.norm.matchrgx(self, pos + self.offset, tokens)
+
+    def match(self, tkpos, tokens):
         if self.src == 'lcase':
-            val = tokens[pos + self.offset].get('tknorm')
+            val = tokens[tkpos].get('tknorm')
             if val is None:
                 return False, []
             matched = match(self.norm.rgxs[self.rgxname], val)
@@ -171,9 +176,9 @@ class RgxMatch(Match):
             else:
                 return False, []
         else:
-            if tokens[pos + self.offset].text:
+            if tokens[tkpos].text:
                 matched = match(self.norm.rgxs[self.rgxname],
-                                (tokens[pos + self.offset].text).strip())
+                                (tokens[tkpos].text).strip())
             else:
                 return False, []
             if matched:
@@ -491,6 +496,20 @@ class Normrules:
         for setname in self.rulesequence:
             self.rules[setname] = self.readruleset(ruledir, setname)
         self.hrules = hrules
+        # regex results for the tokens being normalised
+        self.rgxcache = {}
+
+    def matchrgx(self, rgxmatch, tkpos, tokens):
+        """ Regex match results are cached per token, replaces never
+            change the tknorm or text the regexes are matched against so
+            every rule using the same regex on the same token shares one
+            match """
+        key = (tkpos, rgxmatch.rgxname, rgxmatch.src == 'lcase')
+        result = self.rgxcache.get(key)
+        if result is None:
+            result = rgxmatch.match(tkpos, tokens)
+            self.rgxcache[key] = result
+        return result
 
     def read_normmaster(self, ruledir):
         if self.verboselvl:
@@ -566,6 +585,7 @@ class Normrules:
     def runrulesets(self, tokens):
         if self.verboselvl:
             sys.stderr.write('\tRunning normaliser rules\n')
+        self.rgxcache = {}
         for ridx, ruleset in enumerate(self.rulesequence):
             if self.verboselvl > 1:
                 sys.stderr.write('\t\tRunning normaliser rule set {0} of {1}\n'.format(ridx+1, len(self.rulesequence)))
@@ -588,24 +608,11 @@ class Normrules:
 
 
                 norm_empty = (tk.get('norm') is None or
-                              not match('^[a-z ]*$', tk.get('norm')) or
+                              not match(_normalisedrgx, tk.get('norm')) or
                               ruleset[:4] == 'ssml')
                 if tk.tag == 'tk' and norm_empty:
                     for rule in self.rules[ruleset]:
-                        tokensxml = []
-                        for tk in tokens:
-                            tokensxml.append(etree.tostring(tk,
-                                                            pretty_print=True,
-                                                            encoding='UTF-8')
-                                             .strip())
-                        matched = rule.apply(i, tokens)
-                        if matched:
-                            newtokensxml = []
-                            for tk in tokens:
-                                ntkstr = etree.tostring(tk,
-                                                        pretty_print=True,
-                                                        encoding='UTF-8')
-                                newtokensxml.append(ntkstr.strip())
+                        if rule.apply(i, tokens):
                             break
             if self.verboselvl > 2:
                 sys.stderr.write('\n')
@@ -628,6 +635,8 @@ class Normalise(object):
         self.arch = config.get('normalise-arch', '')
         self.tpdb = pyIdlak_txp.PyTxpParseOptions_GetTpdb(idargs.idlakopts)
         self._idargs = idargs
+        # rules are loaded on the first document and kept for the rest
+        self._normrules = None
 
         # Getting possible directories
         normdir = ['normrules-' + self.arch, 'normrules-default']
@@ -698,9 +707,11 @@ class Normalise(object):
         xmlin = etree.fromstring(strin, parser = xmlparser)
 
 
-        normrules = Normrules(self.ruledir, self.hrules, self._idargs.get('verbose'))
+        if self._normrules is None:
+            self._normrules = Normrules(self.ruledir, self.hrules,
+                                        self._idargs.get('verbose'))
         tokens = xmlin.xpath('.//tk|.//break')
-        normrules.runrulesets(tokens)
+        self._normrules.runrulesets(tokens)
 
         for tkidx, tk in enumerate(tokens):
             if 'norm' not in tk.attrib and 'tknorm' in tk.attrib:
@@ -25,6 +25,15 @@
 #include "python-txp-api.h"
 %}
 
+%apply (const char * BYTES, size_t LENGTH) { (const char * data, size_t len) }
+
+%idlak_allow_threads(PyPugiXMLDocument_LoadString)
+%idlak_allow_threads(PyPugiXMLDocument_SaveBinary)
+%idlak_allow_threads(PyPugiXMLDocument_LoadBinary)
+%idlak_allow_threads(PyIdlakModule_new)
+%idlak_allow_threads(PyIdlakModule_process)
+%idlak_allow_threads(PyIdlakModule_DnnFeatures)
+
 %include "python-txp-api.h"
 
 
@@ -17,7 +17,13 @@
 // limitations under the License.
 //
 
+#include <cstring>
+#include <mutex>
+
 #include "idlaktxp/idlaktxp.h"
+#include "idlaktxp/txpxmlarena.h"
+#include "idlaktxp/txpbinxml.h"
+#include "idlaktxp/txpstagestats.h"
 
 #include "pyIdlak/pylib/pyIdlak_internal.h"
 #include "python-txp-api.h"
@@ -34,6 +40,10 @@ static const char* const _module_names[] = {
   nullptr
 };
 
+// XML trees are built in pages from the arena, see idlaktxp/txpxmlarena.h.
+// This runs when the module is loaded, before any document is created
+static const bool _xml_arena_installed = (kaldi::TxpXmlArenaInstall(), true);
+
 struct PyTxpParseOptions {
   kaldi::TxpParseOptions * po_;
 };
@@ -47,6 +57,14 @@ struct PyPugiXMLDocument {
 struct PyIdlakModule {
   enum IDLAKMOD modtype_;
   void * modptr_;
+  // modules keep caches and per document state, so a module shared between
+  // threads processes one document at a time
+  std::mutex mutex_;
+};
+
+struct PyCexDnnFeatures {
+  std::vector<std::string> ids_;
+  std::vector<kaldi::Matrix<kaldi::BaseFloat> > feats_;
 };
 
 
@@ -161,9 +179,26 @@ void PyPugiXMLDocument_delete(PyPugiXMLDocument * pypugidoc) {
   }
 }
 
-void PyPugiXMLDocument_LoadString(PyPugiXMLDocument * pypugidoc, const char * data) {
+int PyPugiXMLDocument_LoadString(PyPugiXMLDocument * pypugidoc, const char * data) {
+  if (!pypugidoc) return 0;
+  if (!pypugidoc->doc_->load(data, pugi::encoding_utf8))
+    return 0;
+  // pugixml accepts text and several elements at the top level, which is not
+  // a well formed document
+  int nelements = 0;
+  for (pugi::xml_node node = pypugidoc->doc_->first_child(); node;
+       node = node.next_sibling()) {
+    if (node.type() == pugi::node_element)
+      nelements++;
+    else if (node.type() == pugi::node_pcdata || node.type() == pugi::node_cdata)
+      return 0;
+  }
+  return nelements == 1;
+}
+
+void PyPugiXMLDocument_Reset(PyPugiXMLDocument * pypugidoc) {
   if (pypugidoc) {
-    pypugidoc->doc_->load(data, pugi::encoding_utf8);
+    pypugidoc->doc_->reset();
   }
 }
 
@@ -181,6 +216,79 @@ PyIdlakBuffer * PyPugiXMLDocument_SavePretty(PyPugiXMLDocument * pypugidoc) {
   return pybuf;
 }
 
+PyIdlakBytes PyPugiXMLDocument_SaveBinary(PyPugiXMLDocument * pypugidoc) {
+  PyIdlakBytes output;
+  if (pypugidoc) {
+    kaldi::TxpSaveBinaryXml(*pypugidoc->doc_, &output);
+  }
+  return output;
+}
+
+int PyPugiXMLDocument_LoadBinary(PyPugiXMLDocument * pypugidoc, const char * data, size_t len) {
+  kaldi::TxpBinaryXml reader;
+  if (!pypugidoc || !reader.Open(data, len)) return 0;
+  reader.Load(pypugidoc->doc_);
+  return 1;
+}
+
+static pugi::xml_node _node(PyPugiXMLNode * pynode) {
+  return pugi::xml_node(reinterpret_cast<pugi::xml_node_struct *>(pynode));
+}
+
+static PyPugiXMLNode * _pynode(const pugi::xml_node &node) {
+  return reinterpret_cast<PyPugiXMLNode *>(node.internal_object());
+}
+
+PyPugiXMLNode * PyPugiXMLDocument_root(PyPugiXMLDocument * pypugidoc) {
+  if (!pypugidoc) return nullptr;
+  return _pynode(pypugidoc->doc_->document_element());
+}
+
+const char * PyPugiXMLNode_name(PyPugiXMLNode * pynode) {
+  return _node(pynode).name();
+}
+
+PyPugiXMLNode * PyPugiXMLNode_child(PyPugiXMLNode * pynode, const char * name) {
+  return _pynode(_node(pynode).child(name));
+}
+
+PyPugiXMLNode * PyPugiXMLNode_next(PyPugiXMLNode * pyscope, PyPugiXMLNode * pynode,
+                                   const char * name) {
+  pugi::xml_node scope = _node(pyscope);
+  if (!scope) return nullptr;
+  pugi::xml_node node = _node(pynode);
+  if (!node) {
+    if (!strcmp(scope.name(), name)) return _pynode(scope);
+    node = scope;
+  }
+  // depth first, do not leave the subtree of scope
+  while (true) {
+    if (node.first_child()) {
+      node = node.first_child();
+    } else {
+      while (node != scope && !node.next_sibling())
+        node = node.parent();
+      if (node == scope) return nullptr;
+      node = node.next_sibling();
+    }
+    if (node.type() == pugi::node_element && !strcmp(node.name(), name))
+      return _pynode(node);
+  }
+}
+
+const char * PyPugiXMLNode_attribute(PyPugiXMLNode * pynode, const char * name) {
+  pugi::xml_attribute attr = _node(pynode).attribute(name);
+  if (!attr) return nullptr;
+  return attr.value();
+}
+
+const char * PyPugiXMLNode_text(PyPugiXMLNode * pynode) {
+  pugi::xml_node node = _node(pynode).first_child();
+  if (node.type() != pugi::node_pcdata && node.type() != pugi::node_cdata)
+    return nullptr;
+  return node.value();
+}
+
 /* Modules all have Init, Process and Delete */
 
 PyIdlakModule * PyIdlakModule_new(enum IDLAKMOD modtype, PyTxpParseOptions * pypo) {
@@ -271,27 +379,35 @@ void PyIdlakModule_delete(PyIdlakModule * pymod) {
 
 void PyIdlakModule_process(PyIdlakModule * pymod, PyPugiXMLDocument * pypugidoc) {
   if (!pymod || !pypugidoc) return;
+  std::lock_guard<std::mutex> lock(pymod->mutex_);
   switch(pymod->modtype_) {
     case Tokenise:
-      static_cast<kaldi::TxpTokenise *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpTokenise *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case PosTag:
-      static_cast<kaldi::TxpPosTag *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpPosTag *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case Pauses:
-      static_cast<kaldi::TxpPauses *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpPauses *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case Phrasing:
-      static_cast<kaldi::TxpPhrasing *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpPhrasing *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case Pronounce:
-      static_cast<kaldi::TxpPronounce *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpPronounce *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case Syllabify:
-      static_cast<kaldi::TxpSyllabify *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpSyllabify *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case ContextExtraction:
-      static_cast<kaldi::TxpCex *>(pymod->modptr_)->Process(pypugidoc->doc_);
+      kaldi::TxpProcessTimed(static_cast<kaldi::TxpCex *>(pymod->modptr_),
+                             pypugidoc->doc_);
       break;
     case Empty:
     default:
@@ -304,3 +420,97 @@ const char * PyIdlakModule_name(enum IDLAKMOD modtype) {
     return nullptr;
   return _module_names[modtype];
 }
+
+int PyIdlakModule_SetDnnEncoding(PyIdlakModule * pymod,
+                                 const std::vector<std::vector<std::string>> &values) {
+  if (!pymod || pymod->modtype_ != ContextExtraction) return 0;
+  std::lock_guard<std::mutex> lock(pymod->mutex_);
+  return static_cast<kaldi::TxpCex *>(pymod->modptr_)->SetDnnEncoding(values);
+}
+
+PyCexDnnFeatures * PyIdlakModule_DnnFeatures(PyIdlakModule * pymod, PyPugiXMLDocument * pypugidoc) {
+  if (!pymod || !pypugidoc || pymod->modtype_ != ContextExtraction)
+    return nullptr;
+  PyCexDnnFeatures * pyfeats = new PyCexDnnFeatures;
+  std::lock_guard<std::mutex> lock(pymod->mutex_);
+  kaldi::TxpStageTimer timer("cex");
+  static_cast<kaldi::TxpCex *>(pymod->modptr_)->ProcessDnnFeatures(
+      pypugidoc->doc_, &pyfeats->ids_, &pyfeats->feats_);
+  kaldi::int64 nphones = 0;
+  for (size_t i = 0; i < pyfeats->feats_.size(); i++)
+    nphones += pyfeats->feats_[i].NumRows();
+  timer.SetItems(nphones, "phones");
+  return pyfeats;
+}
+
+void PyCexDnnFeatures_delete(PyCexDnnFeatures * pyfeats) {
+  delete pyfeats;
+}
+
+int PyCexDnnFeatures_size(PyCexDnnFeatures * pyfeats) {
+  if (!pyfeats) return 0;
+  return pyfeats->ids_.size();
+}
+
+std::string PyCexDnnFeatures_id(PyCexDnnFeatures * pyfeats, int n) {
+  if (!pyfeats || n < 0 || n >= static_cast<int>(pyfeats->ids_.size()))
+    return std::string("");
+  return pyfeats->ids_[n];
+}
+
+kaldi::Matrix<kaldi::BaseFloat> * PyCexDnnFeatures_matrix(PyCexDnnFeatures * pyfeats, int n) {
+  if (!pyfeats || n < 0 || n >= static_cast<int>(pyfeats->feats_.size()))
+    return nullptr;
+  return &pyfeats->feats_[n];
+}
+
+// the lexicon has its own lock, the module's is not needed
+static kaldi::TxpLexicon * _lexicon(PyIdlakModule * pymod) {
+  if (!pymod || pymod->modtype_ != Pronounce) return nullptr;
+  return static_cast<kaldi::TxpPronounce *>(pymod->modptr_)->Lexicon();
+}
+
+int PyIdlakModule_LexiconAdd(PyIdlakModule * pymod, const std::string &word,
+                             const std::string &entry, const std::string &pron,
+                             bool isdefault) {
+  kaldi::TxpLexicon * lex = _lexicon(pymod);
+  if (!lex) return 0;
+  return lex->AddUserEntry(word, entry, pron, isdefault);
+}
+
+int PyIdlakModule_LexiconRemove(PyIdlakModule * pymod, const std::string &word,
+                                const std::string &entry) {
+  kaldi::TxpLexicon * lex = _lexicon(pymod);
+  if (!lex) return 0;
+  return lex->RemoveUserEntry(word, entry);
+}
+
+void PyIdlakModule_LexiconClear(PyIdlakModule * pymod) {
+  kaldi::TxpLexicon * lex = _lexicon(pymod);
+  if (lex) lex->ClearUserEntries();
+}
+
+long PyIdlakModule_LexiconVersion(PyIdlakModule * pymod) {
+  kaldi::TxpLexicon * lex = _lexicon(pymod);
+  if (!lex) return 0;
+  return static_cast<long>(lex->UserVersion());
+}
+
+void PyTxpStageStats_add(const std::string &stage, double seconds, int items,
+                         const std::string &unit) {
+  kaldi::TxpStageStatsAdd(stage, seconds, items, unit);
+}
+
+void PyTxpStageStats_add_audio(double seconds) {
+  kaldi::TxpStageStatsAddAudio(seconds);
+}
+
+std::string PyTxpStageStats_prometheus() {
+  std::ostringstream stream;
+  kaldi::TxpStageStatsWritePrometheus(stream);
+  return stream.str();
+}
+
+void PyTxpStageStats_reset() {
+  kaldi::TxpStageStatsReset();
+}
@@ -25,7 +25,9 @@
 // TxpParseOptions wrappers
 typedef struct PyTxpParseOptions PyTxpParseOptions;
 typedef struct PyPugiXMLDocument PyPugiXMLDocument;
+typedef struct PyPugiXMLNode PyPugiXMLNode;
 typedef struct PyIdlakModule PyIdlakModule;
+typedef struct PyCexDnnFeatures PyCexDnnFeatures;
 
 // Remember to update the list of names in the .cc
 enum IDLAKMOD {Empty = 0,
@@ -57,8 +59,32 @@ PyIdlakBuffer * PyTxpParseOptions_PrintConfig(PyTxpParseOptions * pypo);
 
 PyPugiXMLDocument * PyPugiXMLDocument_new();
 void PyPugiXMLDocument_delete(PyPugiXMLDocument * pypugidoc);
-void PyPugiXMLDocument_LoadString(PyPugiXMLDocument * pypugidoc, const char * data);
+// Returns 0 if data is not a well formed document with a single root element
+int PyPugiXMLDocument_LoadString(PyPugiXMLDocument * pypugidoc, const char * data);
+// Empties the document, its pages go back to the arena of the calling thread
+// and are reused by the next document built on it
+void PyPugiXMLDocument_Reset(PyPugiXMLDocument * pypugidoc);
 PyIdlakBuffer * PyPugiXMLDocument_SavePretty(PyPugiXMLDocument * pypugidoc);
+// Binary form of the document (see idlaktxp/txpbinxml.h) for passing it to
+// another process, LoadBinary returns 0 if data is not a binary document
+PyIdlakBytes PyPugiXMLDocument_SaveBinary(PyPugiXMLDocument * pypugidoc);
+int PyPugiXMLDocument_LoadBinary(PyPugiXMLDocument * pypugidoc, const char * data, size_t len);
+
+// Read only access to the elements of a document, so that its contents can be
+// read without saving and parsing it again. The nodes belong to the document
+// and are only valid until it is changed. Missing nodes, attributes and text
+// are NULL (None in Python).
+PyPugiXMLNode * PyPugiXMLDocument_root(PyPugiXMLDocument * pypugidoc);
+const char * PyPugiXMLNode_name(PyPugiXMLNode * pynode);
+// First child element called name
+PyPugiXMLNode * PyPugiXMLNode_child(PyPugiXMLNode * pynode, const char * name);
+// The element called name after pynode in document order within scope, or the
+// first one, which may be scope itself, if pynode is NULL
+PyPugiXMLNode * PyPugiXMLNode_next(PyPugiXMLNode * pyscope, PyPugiXMLNode * pynode,
+                                   const char * name);
+const char * PyPugiXMLNode_attribute(PyPugiXMLNode * pynode, const char * name);
+// The text before the first child element
+const char * PyPugiXMLNode_text(PyPugiXMLNode * pynode);
 
 PyIdlakModule * PyIdlakModule_new(enum IDLAKMOD modtype, PyTxpParseOptions * pypo);
 void PyIdlakModule_delete(PyIdlakModule * pymod);
@@ -66,4 +92,37 @@ void PyIdlakModule_process(PyIdlakModule * pymod, PyPugiXMLDocument * pypugidoc)
 
 const char * PyIdlakModule_name(enum IDLAKMOD modtype);
 
+// DNN input features straight from a ContextExtraction module. values holds
+// the phone names followed by the values of each context feature, i.e. the
+// keys of the cex frequency table.
+int PyIdlakModule_SetDnnEncoding(PyIdlakModule * pymod,
+                                 const std::vector<std::vector<std::string>> &values);
+PyCexDnnFeatures * PyIdlakModule_DnnFeatures(PyIdlakModule * pymod, PyPugiXMLDocument * pypugidoc);
+void PyCexDnnFeatures_delete(PyCexDnnFeatures * pyfeats);
+int PyCexDnnFeatures_size(PyCexDnnFeatures * pyfeats);
+std::string PyCexDnnFeatures_id(PyCexDnnFeatures * pyfeats, int n);
+// The matrix belongs to pyfeats
+kaldi::Matrix<kaldi::BaseFloat> * PyCexDnnFeatures_matrix(PyCexDnnFeatures * pyfeats, int n);
+
+// User entries of the lexicon of a Pronounce module, which is shared by the
+// modules loaded from the same tpdb. Add and Remove return 0 if the module is
+// not a Pronounce module or the entry is invalid or, for Remove, not found.
+// An empty entry removes the whole word. Version counts the changes.
+int PyIdlakModule_LexiconAdd(PyIdlakModule * pymod, const std::string &word,
+                             const std::string &entry, const std::string &pron,
+                             bool isdefault);
+int PyIdlakModule_LexiconRemove(PyIdlakModule * pymod, const std::string &word,
+                                const std::string &entry);
+void PyIdlakModule_LexiconClear(PyIdlakModule * pymod);
+long PyIdlakModule_LexiconVersion(PyIdlakModule * pymod);
+
+// Process wide time spent in each stage (see idlaktxp/txpstagestats.h). The
+// modules above are timed as they run, other stages are added from Python
+void PyTxpStageStats_add(const std::string &stage, double seconds, int items,
+                         const std::string &unit);
+void PyTxpStageStats_add_audio(double seconds);
+// The totals in Prometheus text format
+std::string PyTxpStageStats_prometheus();
+void PyTxpStageStats_reset();
+
 #endif // KALDI_PYIDLAK_TXP_PYTHON_TXP_API_H_
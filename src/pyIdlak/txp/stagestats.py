@@ -0,0 +1,102 @@
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+
+""" Process wide time spent in each stage of synthesis
+
+    The C++ txp modules are timed as they run, other stages use StageTimer.
+    All stages go into the same totals, which can be exported for
+    Prometheus:
+
+        with StageTimer('acoustic', items = nframes, unit = 'frames'):
+            ...
+        text = prometheus()
+"""
+
+import re
+import time
+
+from . import pyIdlak_txp
+
+
+class StageTimer(object):
+    """ Context manager adding the time taken in the block to a stage """
+
+    def __init__(self, stage, items = 0, unit = ''):
+        self.stage = stage
+        self.items = items
+        self.unit = unit
+        self._start = None
+
+    def __enter__(self):
+        self._start = time.perf_counter()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        seconds = time.perf_counter() - self._start
+        pyIdlak_txp.PyTxpStageStats_add(self.stage, seconds,
+                                        int(self.items), self.unit)
+        return False
+
+
+def add_audio(seconds):
+    """ Add to the total seconds of audio synthesised, for the real time
+        factor of each stage """
+    pyIdlak_txp.PyTxpStageStats_add_audio(seconds)
+
+
+def prometheus():
+    """ The totals in Prometheus text format """
+    return pyIdlak_txp.PyTxpStageStats_prometheus()
+
+
+_metric_re = re.compile(r'^idlak_(\w+)_total(?:\{stage="((?:[^"\\]|\\.)*)"'
+                        r'(?:,unit="((?:[^"\\]|\\.)*)")?\})? (\S+)$')
+
+
+def stats():
+    """ The totals as a dictionary
+
+        Returns:
+            (dict): 'audio_seconds' and 'stages', by stage a dictionary of
+                    its 'calls', 'seconds', 'items' and 'unit'
+    """
+    ret = {'audio_seconds': 0., 'stages': {}}
+    for line in prometheus().splitlines():
+        m = _metric_re.match(line)
+        if m is None:
+            continue
+        metric, stage, unit, value = m.groups()
+        if stage is None:
+            if metric == 'audio_seconds':
+                ret['audio_seconds'] = float(value)
+            continue
+        stage = re.sub(r'\\(.)', lambda c: '\n' if c.group(1) == 'n'
+                       else c.group(1), stage)
+        entry = ret['stages'].setdefault(
+            stage, {'calls': 0, 'seconds': 0., 'items': 0, 'unit': ''})
+        if metric == 'stage_calls':
+            entry['calls'] = int(value)
+        elif metric == 'stage_seconds':
+            entry['seconds'] = float(value)
+        elif metric == 'stage_items':
+            entry['items'] = int(value)
+            entry['unit'] = unit
+    return ret
+
+
+def reset():
+    pyIdlak_txp.PyTxpStageStats_reset()
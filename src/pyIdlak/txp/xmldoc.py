@@ -36,8 +36,15 @@ class XMLDoc(object):
 
 
     def load_string(self, xmlstr):
-        """ Loads a string containing XML """
-        pyIdlak_txp.PyPugiXMLDocument_LoadString(self._doc, str(xmlstr))
+        """ Loads a string containing XML, returns False if it is not a well
+            formed document with a single root element """
+        return bool(pyIdlak_txp.PyPugiXMLDocument_LoadString(self._doc, str(xmlstr)))
+
+
+    def reset(self):
+        """ Empties the document so it can be reused for the next input,
+            loading a string also resets the document first """
+        pyIdlak_txp.PyPugiXMLDocument_Reset(self._doc)
 
 
     def to_string(self):
@@ -47,7 +54,84 @@ class XMLDoc(object):
         pyIdlak_pylib.PyIdlakBuffer_delete(buf)
         return xmlstr
 
+    def to_binary(self):
+        """ Get the document as bytes in the Idlak binary format, which loads
+            much faster than XML when passing documents between processes """
+        return pyIdlak_txp.PyPugiXMLDocument_SaveBinary(self._doc)
+
+
+    def load_binary(self, data):
+        """ Loads bytes from to_binary """
+        if not pyIdlak_txp.PyPugiXMLDocument_LoadBinary(self._doc, bytes(data)):
+            raise ValueError("not an Idlak binary document")
+
+    @property
+    def root(self):
+        """ The root element, read straight from the underlying document. It
+            is only valid while the document is not changed """
+        node = pyIdlak_txp.PyPugiXMLDocument_root(self._doc)
+        if node is None:
+            return None
+        return XMLNode(node, self)
+
     @property
     def idlak_doc(self):
         """ Get the underlying Idlak PugiXML document """
         return self._doc
+
+
+class XMLNode(object):
+    """ A read only element of an XMLDoc with the parts of the lxml element
+        interface that are used to read the results of the txp modules """
+
+    def __init__(self, node, doc):
+        self._node = node
+        self._doc = doc # keeps the document alive
+        self.attrib = _XMLAttributes(node)
+
+    @property
+    def tag(self):
+        return pyIdlak_txp.PyPugiXMLNode_name(self._node)
+
+    @property
+    def text(self):
+        return pyIdlak_txp.PyPugiXMLNode_text(self._node)
+
+    def find(self, path):
+        """ First element matching a path of child names, e.g. './a/b' """
+        node = self._node
+        for name in path.split('/'):
+            if name in ('', '.'):
+                continue
+            node = pyIdlak_txp.PyPugiXMLNode_child(node, name)
+            if node is None:
+                return None
+        return XMLNode(node, self._doc)
+
+    def iter(self, tag):
+        """ This element and its descendants called tag in document order """
+        node = pyIdlak_txp.PyPugiXMLNode_next(self._node, None, tag)
+        while node is not None:
+            yield XMLNode(node, self._doc)
+            node = pyIdlak_txp.PyPugiXMLNode_next(self._node, node, tag)
+
+
+class _XMLAttributes(object):
+
+    def __init__(self, node):
+        self._node = node
+
+    def get(self, name, default = None):
+        val = pyIdlak_txp.PyPugiXMLNode_attribute(self._node, name)
+        if val is None:
+            return default
+        return val
+
+    def __getitem__(self, name):
+        val = pyIdlak_txp.PyPugiXMLNode_attribute(self._node, name)
+        if val is None:
+            raise KeyError(name)
+        return val
+
+    def __contains__(self, name):
+        return pyIdlak_txp.PyPugiXMLNode_attribute(self._node, name) is not None
@@ -18,8 +18,11 @@
 from . import pyIdlak_vocoder as c_api
 
 
-from .vocoders import MCEPVocoder, MCEPExcitation
+from .vocoders import MCEPVocoder, MCEPExcitation, MLSASynthesizer
 
 from . import excitation
-from .mlpg import mlpg
-from .mlsacheck import stablise_mceps
+from .mlpg import mlpg, mlpg_matrix
+from .mlsacheck import stablise_mceps, mgc2sp
+from .encoder import AudioEncoder, encode
+from . import encoder
+from .resample import Resampler, resample
@@ -0,0 +1,78 @@
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+""" Encoding waveforms into audio files in memory
+
+    The waveform is on the 16 bit scale, as produced by the vocoders. Which
+    compressed formats are available depends on the libraries found when
+    pyIdlak was configured, see formats().
+"""
+
+from . import pyIdlak_vocoder
+
+
+def formats():
+    """ The audio formats which can be encoded in this build """
+    return list(pyIdlak_vocoder.PyAudioEncoder_formats())
+
+
+def encode(audio_format, waveform, srate, quality = 0.4):
+    """ Encode a whole waveform, returns the file contents as bytes
+
+        audio_format is one of formats(), quality goes from 0 (smallest)
+        to 1 (best)
+    """
+    if not audio_format in formats():
+        raise ValueError("cannot encode audio as '{0}'".format(audio_format))
+    data = pyIdlak_vocoder.PyAudio_encode(audio_format, int(srate),
+                                          float(quality), list(waveform))
+    if not data:
+        raise ValueError("failed to encode audio as '{0}' at {1} Hz".format(
+            audio_format, srate))
+    return data
+
+
+class AudioEncoder():
+    """ Encodes a waveform given in chunks
+
+        encode returns the bytes which are complete so far, so they can be
+        sent while the rest is synthesised, and flush returns the end of the
+        stream. A streamed wav header has the maximum length.
+    """
+
+    def __init__(self, audio_format, srate, quality = 0.4):
+        if not audio_format in formats():
+            raise ValueError("cannot encode audio as '{0}'".format(audio_format))
+        self._encoder = pyIdlak_vocoder.PyAudioEncoder_new(
+            audio_format, int(srate), float(quality))
+        if self._encoder is None:
+            raise ValueError("cannot encode audio as '{0}' at {1} Hz".format(
+                audio_format, srate))
+        self.audio_format = audio_format
+
+    def __del__(self):
+        if getattr(self, '_encoder', None) is not None:
+            pyIdlak_vocoder.PyAudioEncoder_delete(self._encoder)
+            self._encoder = None
+
+    def encode(self, waveform):
+        """ Encode the next chunk of the waveform """
+        return pyIdlak_vocoder.PyAudioEncoder_encode(self._encoder,
+                                                     list(waveform))
+
+    def flush(self):
+        """ End the stream, the encoder can not be used again """
+        return pyIdlak_vocoder.PyAudioEncoder_flush(self._encoder)
@@ -15,9 +15,6 @@
 # limitations under the License.
 
 # Excitation functions
-import math
-import random
-
 from . import pyIdlak_vocoder
 from .. import pylib
 
@@ -63,59 +60,28 @@ def mixed_excitation(f0s, bndaps, srate = 48000, fshift = 0.005, f0min = 70.,
     """
     if uv_period is None:
         uv_period = 2. * fshift
-    sshift = int(srate * fshift) # frame shift in samples
-    noframes = len(f0s)
-    nosamples = noframes * sshift
-
-    random.seed(seed)
-
-    excitation = [0.] * nosamples
-    hanning_totals = [0.] * nosamples
+    if not len(f0s):
+        return []
     bndap_order = len(bndaps[0])
-    zero_bndaps = [0.] * bndap_order
-    bands = get_band_info(bndap_order, srate, fshift)
-    period_pre = 0
-    for sidx, fidx, period, voiced in _pitch_periods(
-            f0s, srate, fshift, sshift, noframes, nosamples, f0min, uv_period):
-
-        if voiced:
-            fbndaps = bndaps[fidx]
-        else:
-            fbndaps = zero_bndaps
-
-        # periodic pulse
-        pmag = math.sqrt(period)
-        fpulse = [0. for t in range(fftlen)]
-        fpulse[fftlen//2] = pmag
-
-        nmag = math.sqrt(period / max(1, (period_pre + period)))
-        fnoise = _gen_noise(nmag, period_pre, period, fftlen, gauss)
-
-        fexc = _excitation_mixing(fpulse, fnoise, fbndaps, period, srate, bands)
-        fhann = _pitch_sync_hanning(period_pre, period, fftlen)
-        frame_excitation = [e*h for (e,h) in zip(fexc, fhann)] # apply the hanning window
-        _overlap_and_add(excitation, frame_excitation, sidx)
-        # keeping track of the hanning totals for later normalisation
-        _overlap_and_add(hanning_totals, fhann, sidx)
-        period_pre = period
-
-    # renorm based on the hanning window locations
-    for sidx, (e, h) in enumerate(zip(excitation, hanning_totals)):
-        if h > 0:
-            excitation[sidx] = e / h
-        else:
-            excitation[sidx] = e
-
-    # remove the offset introduced by building the excitation fft window
-    offset = fftlen // 2 - sshift
-    return excitation[offset:]
-
-
-def get_band_info(numbands, srate, fshift, **kwargs):
-    """ Figure out where the Bands need to be
-
-        Returns a list of tuples in Hz of (start, center, end)
-    """
+    flat_bndaps = []
+    for fidx, fbndaps in enumerate(bndaps[:len(f0s)]):
+        if len(fbndaps) != bndap_order:
+            raise ValueError("frame {0} does not have {1} bndaps".format(
+                fidx, bndap_order))
+        flat_bndaps.extend([float(b) for b in fbndaps])
+    if len(bndaps) < len(f0s):
+        raise ValueError("fewer bndap frames than f0 frames")
+
+    opts = _band_options(bndap_order, srate, fshift)
+    excitation = pyIdlak_vocoder.PyVocoder_mixed_excitation(
+        opts.kaldiopts, [float(f0) for f0 in f0s], flat_bndaps, int(srate),
+        float(fshift), float(f0min), int(fftlen), float(uv_period),
+        bool(gauss), int(seed))
+    return list(excitation)
+
+
+def _band_options(numbands, srate, fshift, **kwargs):
+    """ Aperiodic energy options describing the bands """
     opts = pylib.PyOptions(pylib.AperiodicEnergyOptions)
     kwargs['sample-frequency'] = float(srate)
     kwargs['frame-shift'] = float(fshift)
@@ -127,98 +93,16 @@ def get_band_info(numbands, srate, fshift, **kwargs):
             opts.set(kw, v)
         else:
             raise TypeError("get_band_info() got an unexpected keyword argument '{0}'".format(k))
+    return opts
+
+
+def get_band_info(numbands, srate, fshift, **kwargs):
+    """ Figure out where the Bands need to be
 
+        Returns a list of tuples in Hz of (start, center, end)
+    """
+    opts = _band_options(numbands, srate, fshift, **kwargs)
     band_starts  = pyIdlak_vocoder.PyVocoder_get_aperiodic_band_starts(opts.kaldiopts)
     band_centers = pyIdlak_vocoder.PyVocoder_get_aperiodic_band_centers(opts.kaldiopts)
     band_ends    = pyIdlak_vocoder.PyVocoder_get_aperiodic_band_ends(opts.kaldiopts)
     return list(zip(band_starts, band_centers, band_ends))
-
-
-def _pitch_periods(f0s, srate, fshift, sshift, noframes, nosmp, f0min, uv_period):
-    """ Generator to get frame index, pitch period, and voicing """
-    periods = [ 1 / float(max(f0min, f0)) if f0 > 0.0 else uv_period for f0 in f0s ]
-    fidx = 0 # Frame index
-    sidx = 0 # Sample index
-    time = 0. # Time in seconds
-    while fidx < noframes and sidx < nosmp:
-        period_samples = int(srate * periods[fidx])
-        yield (sidx, fidx, period_samples, f0s[fidx] > 0.0)
-        time += periods[fidx]
-        sidx = int(srate * time)
-        while time > (fidx + 1) * fshift:
-            fidx += 1
-
-
-def _gen_noise(nmag, period_pre, period, fftlen, gauss):
-    """ Generates the appropriate amount of noise at the correct energy """
-    s = (fftlen // 2) - (period_pre // 2)
-    e = (fftlen // 2 + fftlen % 2) + (period // 2)
-    noise = [t > s and t < e for t in range(fftlen)]
-    if gauss:
-        return [random.gauss(0, nmag) if n else 0. for n in noise]
-    else:
-        return [nmag * random.random() if n else 0. for n in noise]
-
-
-def _pitch_sync_hanning(period_pre, period, fftlen):
-    """ Pitch synchronous hanning window """
-    hlen = fftlen // 2
-    s = hlen - (period_pre // 2)
-    e = hlen + (fftlen % 2) + (period // 2)
-    def _hann(n, N):
-        return 0.5 * (1. - math.cos(2.0 * math.pi * n / (N - 1.)))
-    def _val(f):
-        if f < s or f > e:
-            return 0.0
-        if f < hlen:
-            return _hann(f - s, period_pre)
-        return _hann(period//2 + (f - hlen), period)
-    return [_val(f) for f in range(fftlen)]
-
-
-def _excitation_mixing(fpulse, fnoise, fbndaps, fperiod, srate, bands):
-    """ Mixing the periodic signal and noise according in a ratio
-        defined by the bndaps in the FFT domain
-    """
-    pulse_fft = list(pyIdlak_vocoder.PyVocoder_FFT(fpulse))
-    noise_fft = list(pyIdlak_vocoder.PyVocoder_FFT(fnoise))
-    fftlen = len(pulse_fft)
-
-    pre_bcenter = 0
-    pre_nweight = None
-    for bidx, bcenterfq in enumerate(map(lambda b: b[1], bands)):
-        bcenter = int(bcenterfq * fftlen / srate)
-        if bidx == len(bands) - 1:
-            bcenter = fftlen//2
-        bndap = fbndaps[bidx]
-        # noise weight needs to be converted from decibels
-        nweight = min(1., max(0., math.pow(10., bndap / 20.0)))
-        if pre_nweight is None:
-            pre_nweight = nweight
-        no_fftbins = bcenter - pre_bcenter
-        nweight_delta = (nweight - pre_nweight) / no_fftbins
-        for i, f in enumerate(range(pre_bcenter, bcenter)):
-            nw = (nweight_delta * i) +  pre_nweight
-            pw = min(1., max(0., math.sqrt(1 - nw*nw))) # periodic weight
-            # FFTs of real signals are symmetric
-            pulse_fft[f] *= pw
-            noise_fft[f] *= nw
-            pulse_fft[-f] *= pw
-            noise_fft[-f] *= nw
-        pre_bcenter = bcenter
-        pre_nweight = nweight
-
-    exc_fft = [p+n for (p,n) in zip(pulse_fft, noise_fft)]
-    fexc_complex = pyIdlak_vocoder.PyVocoder_IFFT(exc_fft)
-    fexc = [f.real / fftlen for f in fexc_complex]
-    energy_norm = math.sqrt(fperiod / sum(e*e for e in fexc))
-
-    return [f / energy_norm for f in fexc]
-
-
-def _overlap_and_add(excitation, frame_excitation, startidx):
-    """ Overlap and add the frame's excitation """
-    for i, e in enumerate(frame_excitation):
-        if startidx + i >= len(excitation):
-            break
-        excitation[startidx + i] += e
@@ -32,7 +32,7 @@ def mlpg(mean, mean_d, mean_dd, var, var_d, var_dd,
         d_win_filename:     first delta coefficients
         dd_win_filename:    second delta coefficients
         input_type          as per SPTK (0)
-        influence_range     as per SPTK (30)
+        influence_range     unused, the whole utterance is solved at once
     """
     num_frames = len(mean)
     if num_frames == 0:
@@ -87,9 +87,38 @@ def mlpg(mean, mean_d, mean_dd, var, var_d, var_dd,
                                             windows,
                                             input_type,
                                             influence_range)
+    if not len(rawresult):
+        raise RuntimeError("MLPG failed, check the variances")
 
     result = []
     for idx in range(0, len(rawresult), vector_length):
         result.append(list(rawresult[idx: idx+vector_length]))
 
     return result
+
+
+def mlpg_matrix(matrix, offset, dim, stride, variances, d_win, dd_win,
+                fix_ends = True):
+    """ MLPG on one stream of a kaldi matrix of DNN outputs
+
+        matrix:             kaldi matrix (frames by outputs)
+        offset:             column of the first static mean
+        dim:                vector length of the stream
+        stride:             columns from the statics to the deltas and from
+                            the deltas to the double deltas
+        variances:          global static, delta and double delta variances
+        d_win:              first delta coefficients
+        dd_win:             second delta coefficients
+        fix_ends            pin the first and last frames to their means
+
+        returns a kaldi matrix of the frames by dim parameters
+    """
+    if len(variances) != 3 * dim:
+        raise ValueError("expected {} variances".format(3 * dim))
+    result = pyIdlak_vocoder.PyVocoder_mlpg_matrix(matrix, offset, dim, stride,
+                                                   list(map(float, variances)),
+                                                   [d_win, dd_win],
+                                                   fix_ends)
+    if result is None:
+        raise RuntimeError("MLPG failed, check the dimensions and variances")
+    return result
@@ -15,20 +15,35 @@
 # limitations under the License.
 
 from . import pyIdlak_vocoder
+from .. import pylib
 
 def stablise_mceps(mceps, alpha, fftlen, check_type = 2, stable_condition = 0,
-              pade_order = 5, threshold = 0.0, quiet = True):
-    """ Return stable mceps """
-    flattened_mceps = []
-    mcep_order = len(mceps[0]) - 1
-    for frame in mceps:
-        flattened_mceps.extend(frame)
+              pade_order = 5, threshold = 0.0, quiet = True, num_threads = 0):
+    """ Return stable mceps
 
-    rawresult = pyIdlak_vocoder.PySPTK_mlsacheck(flattened_mceps, mcep_order,
-        alpha, fftlen, check_type, stable_condition, pade_order,
-        threshold, quiet)
+        the frames are checked natively in one call, split over num_threads
+        threads (one per core if not positive)
+    """
+    mat = pylib.PyKaldiMatrixBaseFloat_frmlist(mceps)
+    stable = pyIdlak_vocoder.PyVocoder_mlsacheck_matrix(mat, alpha, fftlen,
+        check_type, stable_condition, pade_order, threshold, quiet,
+        num_threads)
+    if stable is None:
+        raise ValueError("invalid mlsacheck options")
+    return pylib.PyKaldiMatrixBaseFloat_tolist(stable)
 
-    result = []
-    for idx in range(0, len(rawresult), mcep_order+1):
-        result.append(list(rawresult[idx: idx+vector_length]))
-    return result
+
+def mgc2sp(mgcs, alpha, gamma, fftlen, norm_cepstrum = False,
+           output_phase = False, output_format = 0, num_threads = 0):
+    """ Return the spectrum (fftlen / 2 + 1 bins) of each frame of mgcs
+
+        output_format is as SPTK's mgc2sp -o, the frames are converted
+        natively in one call, split over num_threads threads (one per core
+        if not positive)
+    """
+    mat = pylib.PyKaldiMatrixBaseFloat_frmlist(mgcs)
+    spectrum = pyIdlak_vocoder.PyVocoder_mgc2sp_matrix(mat, alpha, gamma,
+        norm_cepstrum, fftlen, output_phase, output_format, num_threads)
+    if spectrum is None:
+        raise ValueError("FFT length must be a power of 2")
+    return pylib.PyKaldiMatrixBaseFloat_tolist(spectrum)
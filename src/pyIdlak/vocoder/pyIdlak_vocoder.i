@@ -25,6 +25,28 @@
 #include "python-vocoder-api.h"
 %}
 
+%idlak_allow_threads(PyVocoder_FFT)
+%idlak_allow_threads(PyVocoder_IFFT)
+%idlak_allow_threads(PySPTK_excite)
+%idlak_allow_threads(PyVocoder_mixed_excitation)
+%idlak_allow_threads(PySPTK_mgc2sp)
+%idlak_allow_threads(PyVocoder_mgc2sp_matrix)
+%idlak_allow_threads(PySPTK_mlpg)
+%idlak_allow_threads(PyVocoder_mlpg_matrix)
+%idlak_allow_threads(PySPTK_mlsacheck)
+%idlak_allow_threads(PyVocoder_mlsacheck_matrix)
+%idlak_allow_threads(PySPTK_mlsadf)
+%idlak_allow_threads(PyVocoder_ola_synthesis)
+%idlak_allow_threads(PyVocoder_vocode_spurts)
+%idlak_allow_threads(PyMlsaSynthesizer_process)
+%idlak_allow_threads(PyMlsaSynthesizer_flush)
+%idlak_allow_threads(PyAudioEncoder_encode)
+%idlak_allow_threads(PyAudioEncoder_flush)
+%idlak_allow_threads(PyAudio_encode)
+%idlak_allow_threads(PyResampler_process)
+%idlak_allow_threads(PyResampler_flush)
+%idlak_allow_threads(PyVocoder_resample)
+
 %include "python-vocoder-api.h"
 
 
@@ -23,6 +23,12 @@
 #include <vector>
 #include <cstdio>
 #include <complex>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 
 extern "C" {
@@ -30,50 +36,58 @@ extern "C" {
 }
 
 #include "python-vocoder-api.h"
+#include "python-vocoder-encode.h"
 #include "python-vocoder-lib.h"
+#include "python-vocoder-mlsa.h"
+#include "python-vocoder-ola.h"
+#include "feat/resample.h"
 #include "matrix/matrix-functions.h"
+#include "matrix/srfft.h"
 
+// SPTK keeps state in statics (the m-sequence, fft tables and the work
+// buffers of several functions), so calls into it are serialised now that
+// the GIL is released while the vocoder runs
+static std::mutex sptk_mutex;
 
-std::vector<std::complex<double>> PyVocoder_FFT(const std::vector<std::complex<double>> &INPUT) {
+
+// The FFT of a power of two number of points uses SplitRadixComplexFft, whose
+// tables are cached, and other sizes the mixed-radix ComplexFft().
+static std::vector<std::complex<double>> PyVocoderComplexFft(
+    const std::vector<std::complex<double>> &input, bool forward) {
   // TODO: Check size and throw
-  kaldi::Vector<double> *v = new kaldi::Vector<double>(INPUT.size() * 2);
-  for (int i = 0; i < INPUT.size(); i++) {
-    (*v)(2*i) = INPUT[i].real();
-    (*v)((2*i) + 1) = INPUT[i].imag();
+  int n = input.size();
+  kaldi::Vector<double> v(n * 2, kaldi::kUndefined);
+  for (int i = 0; i < n; i++) {
+    v(2 * i) = input[i].real();
+    v(2 * i + 1) = input[i].imag();
   }
-  kaldi::ComplexFft(v, true);
-  std::vector<std::complex<double>> fft;
-  for (int i = 0; i < INPUT.size(); i++) {
-    double rl = (*v)(2*i),
-           im = (*v)((2*i) + 1);
-    fft.push_back(std::complex<double>(rl, im));
+  if (n >= 4 && (n & (n - 1)) == 0) {
+    kaldi::SplitRadixComplexFft<double> srfft(n);
+    std::vector<double> buffer;
+    srfft.Compute(v.Data(), forward, &buffer);
+  } else {
+    kaldi::ComplexFft(&v, forward);
   }
-  delete v;
-  return fft;
+  std::vector<std::complex<double>> output(n);
+  for (int i = 0; i < n; i++)
+    output[i] = std::complex<double>(v(2 * i), v(2 * i + 1));
+  return output;
+}
+
+
+std::vector<std::complex<double>> PyVocoder_FFT(const std::vector<std::complex<double>> &INPUT) {
+  return PyVocoderComplexFft(INPUT, true);
 }
 
 
 std::vector<std::complex<double>> PyVocoder_IFFT(const std::vector<std::complex<double>> &INPUT) {
-  // TODO: Check size and throw
-  kaldi::Vector<double> *v = new kaldi::Vector<double>(INPUT.size() * 2);
-  for (int i = 0; i < INPUT.size(); i++) {
-    (*v)(2*i) = INPUT[i].real();
-    (*v)((2*i) + 1) = INPUT[i].imag();
-  }
-  kaldi::ComplexFft(v, false);
-  std::vector<std::complex<double>> ifft;
-  for (int i = 0; i < INPUT.size(); i++) {
-    double rl = (*v)(2*i),
-           im = (*v)((2*i) + 1);
-    ifft.push_back(std::complex<double>(rl, im));
-  }
-  delete v;
-  return ifft;
+  return PyVocoderComplexFft(INPUT, false);
 }
 
 
 // Adapted from SPTK source code
 std::vector<double> PySPTK_excite(const std::vector<double> &INPUT, int frame_period, int interpolation_period, bool gauss, int seed) {
+  std::lock_guard<std::mutex> lock(sptk_mutex);
 
   // Translating to the names used within SPTK
   int fprd = frame_period,
@@ -131,10 +145,52 @@ std::vector<double> PySPTK_excite(const std::vector<double> &INPUT, int frame_pe
 }
 
 
+// Converts the log amplitude (x) and phase (y) of the no bins from mgc2sp
+// to the output format, in x
+static void mgc2sp_output(double *x, const double *y, int no, bool phase,
+                          int otype) {
+  double logk = 20.0 / log(10.0);
+  if (phase) {
+    switch (otype) {
+      case 1:
+        for (int i = no; i--;)
+          x[i] = y[i];
+        break;
+      case 2:
+        for (int i = no; i--;)
+          x[i] = y[i] * 180 / PI;
+        break;
+      default:
+        for (int i = no; i--;)
+          x[i] = y[i] / PI;
+        break;
+    }
+  } else {
+    switch (otype) {
+      case 1:
+        break;
+      case 2:
+        for (int i = no; i--;)
+          x[i] = exp(x[i]);
+        break;
+      case 3:
+        for (int i = no; i--;)
+          x[i] = exp(2 * x[i]);
+        break;
+      default:
+        for (int i = no; i--;)
+          x[i] *= logk;
+        break;
+    }
+  }
+}
+
+
 // Adapted from SPTK source code
 std::vector<double> PySPTK_mgc2sp(const std::vector<double> &INPUT,
                       double alpha, double gamma, int order, bool norm_cepstrum, int fftlen,
                       bool output_phase, int output_format) {
+  std::lock_guard<std::mutex> lock(sptk_mutex);
 
   std::vector<double> spectrum;
 
@@ -149,7 +205,6 @@ std::vector<double> PySPTK_mgc2sp(const std::vector<double> &INPUT,
   c = y + l;
 
   int no = l / 2 + 1;
-  double logk = 20.0 / log(10.0);
 
   std::vector<double>::const_iterator INPUT_it = INPUT.begin();
   while (vreadf(c, m + 1, INPUT, &INPUT_it) == m + 1) {
@@ -158,40 +213,8 @@ std::vector<double> PySPTK_mgc2sp(const std::vector<double> &INPUT,
       
     mgc2sp(c, m, alpha, gamma, x, y, l);
     
-    if (phase) {
-      switch (otype) {
-        case 1:
-          for (int i = no; i--;)
-            x[i] = y[i];
-          break;
-        case 2:
-          for (int i = no; i--;)
-            x[i] = y[i] * 180 / PI;
-          break;
-        default:
-          for (int i = no; i--;)
-            x[i] = y[i] / PI;
-          break;
-      }
-    } else {
-      switch (otype) {
-        case 1:
-          break;
-        case 2:
-          for (int i = no; i--;)
-            x[i] = exp(x[i]);
-          break;
-        case 3:
-          for (int i = no; i--;)
-            x[i] = exp(2 * x[i]);
-          break;
-        default:
-          for (int i = no; i--;)
-            x[i] *= logk;
-          break;
-      }
-    }
-    
+    mgc2sp_output(x, y, no, phase, otype);
+
     for (int t = 0; t < no; t++) {
       spectrum.push_back(x[t]);
     }
@@ -208,17 +231,26 @@ const double PADE4_THRESH2 = 6.2;
 const double PADE5_THRESH1 = 6.0;
 const double PADE5_THRESH2 = 7.65;
 
-static void mlsacheck(double *mceps, int m, int fftlen, int frame,
-               double a, double r, int c, double *stable_mceps, bool quiet)
+// The FFT is done with SplitRadixRealFft (srfft, of size fftlen, unused in the
+// fast modes) rather than SPTK's fftr / ifft, which keep their tables in
+// statics, so that spurts can be checked concurrently.
+// With a real input only bins 0 ... fftlen / 2 are needed, and clipping or
+// scaling them keeps the spectrum Hermitian, so the inverse is real too.
+// The work buffers are in scratch so they are reused from frame to frame.
+struct MlsaCheckScratch {
+  std::vector<double> x, mag, fft_buffer;
+};
+
+static void mlsacheck(const double *mceps, int m, int fftlen, int frame,
+               double a, double r, int c, double *stable_mceps, bool quiet,
+               const kaldi::SplitRadixRealFft<double> *srfft,
+               MlsaCheckScratch *scratch)
 {
    int i;
-   double gain, *x, *y, *mag = NULL, max = 0.0;
-
-   x = dgetmem(fftlen);
-   y = dgetmem(fftlen);
-
-   fillz(x, sizeof(*x), fftlen);
-   fillz(y, sizeof(*y), fftlen);
+   double gain, max = 0.0;
+   std::vector<double> &x = scratch->x, &mag = scratch->mag,
+       &fft_buffer = scratch->fft_buffer;
+   x.assign(std::max(fftlen, m + 1), 0.0);
 
    /* calculate gain factor */
    for (i = 0, gain = 0.0; i <= m; i++) {
@@ -230,15 +262,18 @@ static void mlsacheck(double *mceps, int m, int fftlen, int frame,
    x[0] -= gain;
 
    /* check stability */
+   int hlen = fftlen / 2;
    if (c == 0 || c == 2 || c == 3) {    /* usual mode */
-      mag = dgetmem(fftlen);
-      fillz(mag, sizeof(*mag), fftlen);
-      fftr(x, y, fftlen);
-      for (i = 0; i < fftlen; i++) {
-         mag[i] = sqrt(x[i] * x[i] + y[i] * y[i]);
+      srfft->Compute(x.data(), true, &fft_buffer);
+      // packed as DC, nyquist, then the real and imaginary part of each bin
+      mag.resize(hlen + 1);
+      mag[0] = std::fabs(x[0]);
+      mag[hlen] = std::fabs(x[1]);
+      for (i = 1; i < hlen; i++)
+         mag[i] = sqrt(x[2 * i] * x[2 * i] + x[2 * i + 1] * x[2 * i + 1]);
+      for (i = 0; i <= hlen; i++)
          if (mag[i] > max)
             max = mag[i];
-      }
    } else {                     /* fast mode */
       for (i = 0; i <= m; i++)
          max += x[i];
@@ -254,17 +289,19 @@ static void mlsacheck(double *mceps, int m, int fftlen, int frame,
 
       /* modification */
       if (c == 2) {             /* clipping */
-         for (i = 0; i < fftlen; i++) {
+         if (mag[0] > r)
+            x[0] *= r / mag[0];
+         if (mag[hlen] > r)
+            x[1] *= r / mag[hlen];
+         for (i = 1; i < hlen; i++) {
             if (mag[i] > r) {
-               x[i] *= r / mag[i];
-               y[i] *= r / mag[i];
+               x[2 * i] *= r / mag[i];
+               x[2 * i + 1] *= r / mag[i];
             }
          }
       } else if (c == 3) {      /* scaling */
-         for (i = 0; i < fftlen; i++) {
+         for (i = 0; i < fftlen; i++)
             x[i] *= r / max;
-            y[i] *= r / max;
-         }
       } else if (c == 4) {      /* fast mode */
          for (i = 0; i <= m; i++)
             x[i] *= r / max;
@@ -275,34 +312,36 @@ static void mlsacheck(double *mceps, int m, int fftlen, int frame,
    if (c == 0 || c == 1 || max <= r) {  /* no modification */
       memcpy(stable_mceps, mceps,  (m + 1)*sizeof(*mceps));
    } else {
-      if (c == 2 || c == 3)
-         ifft(x, y, fftlen);
+      if (c == 2 || c == 3) {
+         srfft->Compute(x.data(), false, &fft_buffer);
+         for (i = 0; i <= m; i++)
+            x[i] /= fftlen;
+      }
       x[0] += gain;
-      memcpy(stable_mceps, x,  (m + 1)*sizeof(*x));
+      memcpy(stable_mceps, x.data(),  (m + 1)*sizeof(double));
    }
-
-   free(x);
-   free(y);
-   if (c == 0 || c == 2 || c == 3)
-      free(mag);
 }
 
-std::vector<double> PySPTK_mlsacheck(const std::vector<double> &INPUT, int order,
-                                     double all_pass_constant, int fftlen, int check_type,
-                                     int stable_condition, int pade_order, double threshold,
-                                     bool quiet) {
-
-  std::vector<double> coeffs;
+// Checks the mlsacheck options and gives the stability threshold, or a
+// negative value after reporting an error
+static double mlsacheck_threshold(int order, int fftlen, int check_type,
+                                  int stable_condition, int pade_order,
+                                  double threshold) {
   int m = order, pd = pade_order, c = check_type;
-  double a = all_pass_constant, r;
+  double r;
 
   if (c != 0 && c != 1 && c != 2 && c != 3 && c != 4) {
     fprintf(stderr, "ERROR: check_type is not in 0, 1, 2, 3, 4\n");
-    return coeffs;
+    return -1.0;
   }
   if (stable_condition != 0 && stable_condition != 1) {
     fprintf(stderr, "ERROR: stable_condition is not in 0, 1\n");
-    return coeffs;
+    return -1.0;
+  }
+  if ((c == 0 || c == 2 || c == 3) &&
+      (fftlen < 4 || (fftlen & (fftlen - 1)) || fftlen < m + 1)) {
+    fprintf(stderr, "ERROR: FFT length must be a power of 2 of at least order + 1\n");
+    return -1.0;
   }
   switch (pd) {
     case 4:
@@ -319,124 +358,633 @@ std::vector<double> PySPTK_mlsacheck(const std::vector<double> &INPUT, int order
       break;
     default:
       fprintf(stderr, "ERROR: Order of Pade approximation should be 4 or 5!\n");
-      return coeffs;
+      return -1.0;
   }
   if (threshold != 0.0)
     r = threshold;
+  return r;
+}
 
-  double * mceps = dgetmem(m + 1);
-  double * stable_mceps = dgetmem(m + 1);
-  int frame = 0;
-  std::vector<double>::const_iterator INPUT_it = INPUT.begin();
-  while (vreadf(mceps, m + 1, INPUT, &INPUT_it) == m + 1) {
-    mlsacheck(mceps, m, fftlen, frame, a, r, c, stable_mceps, quiet);
-    for (int t = 0; t < m + 1; t++) {
-      coeffs.push_back(stable_mceps[t]);
+std::vector<double> PySPTK_mlsacheck(const std::vector<double> &INPUT, int order,
+                                     double all_pass_constant, int fftlen, int check_type,
+                                     int stable_condition, int pade_order, double threshold,
+                                     bool quiet) {
+  std::vector<double> coeffs;
+  int m = order, c = check_type;
+  double a = all_pass_constant;
+  double r = mlsacheck_threshold(order, fftlen, check_type, stable_condition,
+                                 pade_order, threshold);
+  if (r < 0.0)
+    return coeffs;
+
+  std::unique_ptr<kaldi::SplitRadixRealFft<double>> srfft;
+  if (c == 0 || c == 2 || c == 3)
+    srfft.reset(new kaldi::SplitRadixRealFft<double>(fftlen));
+  MlsaCheckScratch scratch;
+  int noframes = INPUT.size() / (m + 1);
+  coeffs.resize(noframes * (m + 1));
+  for (int frame = 0; frame < noframes; frame++)
+    mlsacheck(&INPUT[frame * (m + 1)], m, fftlen, frame, a, r, c,
+              &coeffs[frame * (m + 1)], quiet, srfft.get(), &scratch);
+  return coeffs;
+}
+
+
+// Runs f(begin, end) on contiguous ranges of 0 ... n - 1, one per thread, on
+// num_threads threads (if not positive, one per core) but giving each thread
+// at least min_per_thread items. The first range is done in this thread.
+template <typename F>
+static void PyVocoderParallelRanges(size_t n, int num_threads,
+                                    size_t min_per_thread, F f) {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t max_threads = std::max<size_t>(1, n / std::max<size_t>(1, min_per_thread));
+  num_threads = std::min<size_t>(num_threads, max_threads);
+  std::vector<std::thread> threads;
+  for (int t = 1; t < num_threads; t++)
+    threads.push_back(std::thread(f, n * t / num_threads,
+                                  n * (t + 1) / num_threads));
+  f(0, n / num_threads);
+  for (auto &thread : threads)
+    thread.join();
+}
+
+
+kaldi::Matrix<kaldi::BaseFloat> * PyVocoder_mlsacheck_matrix(const kaldi::MatrixBase<kaldi::BaseFloat> &MCEPS,
+                                                             double all_pass_constant, int fftlen,
+                                                             int check_type, int stable_condition,
+                                                             int pade_order, double threshold,
+                                                             bool quiet, int num_threads) {
+  int m = MCEPS.NumCols() - 1, c = check_type;
+  if (m < 0) {
+    fprintf(stderr, "ERROR: MCEP matrix has no columns\n");
+    return NULL;
+  }
+  double r = mlsacheck_threshold(m, fftlen, check_type, stable_condition,
+                                 pade_order, threshold);
+  if (r < 0.0)
+    return NULL;
+
+  // the plan is shared, only its tables are read by Compute
+  std::unique_ptr<kaldi::SplitRadixRealFft<double>> srfft;
+  if (c == 0 || c == 2 || c == 3)
+    srfft.reset(new kaldi::SplitRadixRealFft<double>(fftlen));
+  auto stable = new kaldi::Matrix<kaldi::BaseFloat>(MCEPS.NumRows(), m + 1,
+                                                    kaldi::kUndefined);
+  PyVocoderParallelRanges(MCEPS.NumRows(), num_threads, 64,
+                          [&](size_t begin, size_t end) {
+    MlsaCheckScratch scratch;
+    std::vector<double> mceps(m + 1), stable_mceps(m + 1);
+    for (size_t frame = begin; frame < end; frame++) {
+      const kaldi::BaseFloat *row = MCEPS.RowData(frame);
+      std::copy(row, row + m + 1, mceps.begin());
+      mlsacheck(mceps.data(), m, fftlen, frame, all_pass_constant, r, c,
+                stable_mceps.data(), quiet, srfft.get(), &scratch);
+      std::copy(stable_mceps.begin(), stable_mceps.end(),
+                stable->RowData(frame));
     }
-    frame++;
+  });
+  return stable;
+}
+
+kaldi::Matrix<kaldi::BaseFloat> * PyVocoder_mgc2sp_matrix(const kaldi::MatrixBase<kaldi::BaseFloat> &INPUT,
+                                                          double alpha, double gamma,
+                                                          bool norm_cepstrum, int fftlen,
+                                                          bool output_phase, int output_format,
+                                                          int num_threads) {
+  int m = INPUT.NumCols() - 1, l = fftlen, no = l / 2 + 1;
+  if (m < 0) {
+    fprintf(stderr, "ERROR: cepstrum matrix has no columns\n");
+    return NULL;
   }
-  free(mceps);
-  free(stable_mceps);
-  return coeffs;
+  if (l < 4 || (l & (l - 1))) {
+    fprintf(stderr, "ERROR: FFT length must be a power of 2\n");
+    return NULL;
+  }
+
+  // the plan is shared, only its tables are read by Compute
+  kaldi::SplitRadixRealFft<double> srfft(l);
+  auto spectrum = new kaldi::Matrix<kaldi::BaseFloat>(INPUT.NumRows(), no,
+                                                      kaldi::kUndefined);
+  PyVocoderParallelRanges(INPUT.NumRows(), num_threads, 16,
+                          [&](size_t begin, size_t end) {
+    kaldi::Mgc2SpScratch scratch;
+    std::vector<double> c(m + 1), x(no), y(no);
+    for (size_t frame = begin; frame < end; frame++) {
+      const kaldi::BaseFloat *row = INPUT.RowData(frame);
+      std::copy(row, row + m + 1, c.begin());
+      if (norm_cepstrum)
+        ignorm(c.data(), c.data(), m, gamma);
+      kaldi::Mgc2Sp(c.data(), m, alpha, gamma, srfft, l, x.data(), y.data(),
+                    &scratch);
+      mgc2sp_output(x.data(), y.data(), no, output_phase, output_format);
+      std::copy(x.begin(), x.end(), spectrum->RowData(frame));
+    }
+  });
+  return spectrum;
+}
+
+
+// MLSA filter state carried between chunks of a stream
+struct PyMlsaSynthesizer {
+  int m, pd, fprd, iprd;
+  double a;
+  bool bflag, ngain, transpose, inverse;
+  bool have_c = false;                      // c holds the current frame
+  std::vector<double> c, cc, inc, d;        // d is the Pade delay line
+  // native kernel for the forward filter, SPTK is still used for transpose
+  std::unique_ptr<kaldi::MlsaFilter<double>> filter;
+  std::deque<std::vector<double>> frames;   // converted frames not yet used
+  std::deque<double> excitation;            // samples not yet filtered
+};
+
+
+PyMlsaSynthesizer * PyMlsaSynthesizer_new(int order, double all_pass_constant,
+                                          int frame_period, int interpolation_period,
+                                          int pade_order, bool bflag, bool nogain,
+                                          bool transpose_filter, bool inverse_filter) {
+  if ((pade_order < 4) || (pade_order > 5)) {
+    fprintf(stderr, "ERROR: Order of Pade approximation should be 4 or 5!\n");
+    return nullptr;
+  }
+  if (order < 0 || frame_period <= 0 || interpolation_period <= 0) {
+    fprintf(stderr, "ERROR: invalid MLSA order or period\n");
+    return nullptr;
+  }
+  PyMlsaSynthesizer * synth = new PyMlsaSynthesizer;
+  synth->m = order;
+  synth->pd = pade_order;
+  synth->fprd = frame_period;
+  synth->iprd = interpolation_period;
+  synth->a = all_pass_constant;
+  synth->bflag = bflag;
+  synth->ngain = nogain;
+  synth->transpose = transpose_filter;
+  synth->inverse = inverse_filter;
+  synth->c.resize(order + 1);
+  synth->cc.resize(order + 1);
+  synth->inc.resize(order + 1);
+  // same size SPTK gives the delay line in mlsadf
+  synth->d.assign(3 * (pade_order + 1) + pade_order * (order + 2), 0.0);
+  if (!transpose_filter && order >= 1)
+    synth->filter.reset(new kaldi::MlsaFilter<double>(order, all_pass_constant,
+                                                     pade_order));
+  return synth;
+}
+
+
+void PyMlsaSynthesizer_delete(PyMlsaSynthesizer * synth) {
+  delete synth;
+}
+
+
+void PyMlsaSynthesizer_reset(PyMlsaSynthesizer * synth) {
+  if (!synth)
+    return;
+  synth->have_c = false;
+  synth->frames.clear();
+  synth->excitation.clear();
+  std::fill(synth->d.begin(), synth->d.end(), 0.0);
+  if (synth->filter)
+    synth->filter->Reset();
+}
+
+
+// Filters n samples of the pending excitation, moving from frame c to cc
+static void PyMlsaSynthesizer_filter(PyMlsaSynthesizer * synth, int n,
+                                     std::vector<double> * waveform) {
+  int m = synth->m, iprd = synth->iprd, fprd = synth->fprd, i, j;
+  double *c = synth->c.data(), *cc = synth->cc.data(),
+         *inc = synth->inc.data(), *d = synth->d.data();
+  // only the native forward filter runs without SPTK
+  std::unique_lock<std::mutex> lock(sptk_mutex, std::defer_lock);
+  if (synth->transpose || !synth->filter)
+    lock.lock();
+
+  for (i = 0; i <= m; i++)
+    inc[i] = (cc[i] - c[i]) * (double) iprd / (double) fprd;
+
+  for (j = n, i = (iprd + 1) / 2; j--;) {
+    double x = synth->excitation.front();
+    synth->excitation.pop_front();
+
+    if (!synth->ngain)
+      x *= exp(c[0]);
+    if (synth->transpose)
+      x = mlsadft(x, c, m, synth->a, synth->pd, d);
+    else if (synth->filter)
+      x = synth->filter->Filter(x, c);
+    else
+      x = mlsadf(x, c, m, synth->a, synth->pd, d);
+
+    waveform->push_back(x);
+
+    if (!--i) {
+      for (i = 0; i <= m; i++)
+        c[i] += inc[i];
+      i = iprd;
+    }
+  }
+}
+
+
+std::vector<double> PyMlsaSynthesizer_process(PyMlsaSynthesizer * synth,
+                                              const std::vector<double> &MCEPS,
+                                              const std::vector<double> &EXCITATION) {
+  std::vector<double> waveform;
+  if (!synth)
+    return waveform;
+  int m = synth->m;
+
+  if (MCEPS.size() % (m + 1))
+    fprintf(stderr, "WARNING: ignoring incomplete MCEP frame\n");
+  for (size_t f = 0; f + m + 1 <= MCEPS.size(); f += m + 1) {
+    std::vector<double> frame(MCEPS.begin() + f, MCEPS.begin() + f + m + 1);
+    if (!synth->bflag)
+      mc2b(frame.data(), frame.data(), m, synth->a);
+    if (synth->inverse) {
+      if (!synth->ngain) {
+        for (int i = 0; i <= m; i++)
+          frame[i] *= -1;
+      } else {
+        frame[0] = 0;
+        for (int i = 1; i <= m; i++)
+          frame[i] *= -1;
+      }
+    }
+    synth->frames.push_back(frame);
+  }
+  synth->excitation.insert(synth->excitation.end(),
+                           EXCITATION.begin(), EXCITATION.end());
+
+  // each frame period needs the following frame to interpolate towards
+  while (!synth->frames.empty()) {
+    if (!synth->have_c) {
+      synth->c = synth->frames.front();
+      synth->frames.pop_front();
+      synth->have_c = true;
+      continue;
+    }
+    if (synth->excitation.size() < static_cast<size_t>(synth->fprd))
+      break;
+    synth->cc = synth->frames.front();
+    synth->frames.pop_front();
+    PyMlsaSynthesizer_filter(synth, synth->fprd, &waveform);
+    synth->c = synth->cc;
+  }
+  return waveform;
 }
 
+
+std::vector<double> PyMlsaSynthesizer_flush(PyMlsaSynthesizer * synth) {
+  std::vector<double> waveform;
+  if (!synth)
+    return waveform;
+  // as in SPTK a final partial period is filtered if excitation runs out
+  if (synth->have_c && !synth->frames.empty() && !synth->excitation.empty()) {
+    synth->cc = synth->frames.front();
+    PyMlsaSynthesizer_filter(synth, synth->excitation.size(), &waveform);
+  }
+  PyMlsaSynthesizer_reset(synth);
+  return waveform;
+}
+
+
 // Adapted from SPTK
 std::vector<double> PySPTK_mlsadf(const std::vector<double> &MCEPS, const std::vector<double> &EXCITATION,
                                   int order, double all_pass_constant,
                                   int frame_period, int interpolation_period, int pade_order,
                                   bool bflag, bool nogain, bool transpose_filter, bool inverse_filter) {
   std::vector<double> waveform;
-  
-  int m = order,  pd = pade_order,  fprd = frame_period, iprd = interpolation_period;
-  bool ngain = nogain,  transpose = transpose_filter,  inverse = inverse_filter;
-  double a = all_pass_constant;
-  
-  if ((pd < 4) || (pd > 5)) {
-    fprintf(stderr, "ERROR: Order of Pade approximation should be 4 or 5!\n");
+
+  // Note in the original mceps were in fpc and excitation in fp
+  PyMlsaSynthesizer * synth = PyMlsaSynthesizer_new(order, all_pass_constant,
+                                                    frame_period, interpolation_period,
+                                                    pade_order, bflag, nogain,
+                                                    transpose_filter, inverse_filter);
+  if (!synth)
+    return waveform;
+
+  waveform = PyMlsaSynthesizer_process(synth, MCEPS, EXCITATION);
+  std::vector<double> tail = PyMlsaSynthesizer_flush(synth);
+  waveform.insert(waveform.end(), tail.begin(), tail.end());
+  PyMlsaSynthesizer_delete(synth);
+  return waveform;
+}
+
+
+std::vector<double> PyVocoder_ola_synthesis(const std::vector<double> &MCEPS, const std::vector<double> &EXCITATION,
+                                            int order, double all_pass_constant,
+                                            int frame_period, int fftlen, bool bflag,
+                                            bool nogain, bool use_gpu, int num_threads) {
+  std::vector<double> waveform;
+  if (order < 0 || frame_period <= 0) {
+    fprintf(stderr, "ERROR: invalid MCEP order or frame period\n");
     return waveform;
   }
-  
-  // Note in the original mceps were in fpc and excitation in fp
-  
-  double *c = dgetmem(3 * (m + 1) + 3 * (pd + 1) + pd * (m + 2));
-  double *cc = c + m + 1;
-  double *inc = cc + m + 1;
-  double *d = inc + m + 1;
-  
-  std::vector<double>::const_iterator MCEPS_it = MCEPS.begin();
-  std::vector<double>::const_iterator EXCITATION_it = EXCITATION.begin();
-  
-  if (vreadf(c, m + 1, MCEPS, &MCEPS_it) != m + 1)
+  if (fftlen < 4 || (fftlen & (fftlen - 1)) || fftlen < 2 * frame_period) {
+    fprintf(stderr, "ERROR: FFT length must be a power of 2 of at least twice the frame period\n");
     return waveform;
-  if (!bflag)
-    mc2b(c, c, m, a);
+  }
+  if (MCEPS.size() % (order + 1))
+    fprintf(stderr, "WARNING: ignoring incomplete MCEP frame\n");
+  kaldi::OlaSynthesizer synth(order, all_pass_constant, frame_period, fftlen,
+                              bflag, nogain);
+  synth.Synthesize(MCEPS, EXCITATION, num_threads, use_gpu, &waveform);
+  return waveform;
+}
 
-  int i, j;
-  double x;
-  if (inverse) {
-    if (!ngain) {
-      for (i = 0; i <= m; i++)
-        c[i] *= -1;
-    } else {
-      c[0] = 0;
-      for (i = 1; i <= m; i++)
-        c[i] *= -1;
-    }
+
+// The number of samples PySPTK_mlsadf gives for a spurt: one frame period
+// per frame after the first, fewer if the excitation runs out.
+static size_t PyVocoderSpurtLength(size_t nomceps, size_t nof0s, int srate,
+                                   double fshift, bool mixed, int fftlen) {
+  int fprd = static_cast<int>(srate * fshift);
+  size_t noexc;
+  if (mixed) {
+    // see PyVocoder_mixed_excitation
+    size_t nosamples = nof0s * fprd;
+    size_t offset = std::min<size_t>(std::max(0, fftlen / 2 - fprd), nosamples);
+    noexc = nosamples - offset;
+  } else {
+    noexc = (nof0s > 0) ? (nof0s - 1) * fprd : 0;
   }
+  if (nomceps < 2)
+    return 0;
+  return std::min(noexc, (nomceps - 1) * fprd);
+}
 
-  bool filter_finished = false;
-  while (!filter_finished) {
-    if (vreadf(cc, m + 1, MCEPS, &MCEPS_it) != m + 1) {
-      filter_finished = true;
-      break;
-    }
-    if (!bflag)
-      mc2b(cc, cc, m, a);
-    if (inverse) {
-      if (!ngain) {
-        for (i = 0; i <= m; i++)
-          cc[i] *= -1;
+
+std::vector<int> PyVocoder_spurt_lengths(const std::vector<int> &NOMCEPS,
+                                         const std::vector<int> &NOF0S,
+                                         int srate, double fshift, bool mixed,
+                                         int fftlen) {
+  std::vector<int> lengths;
+  if (NOMCEPS.size() != NOF0S.size()) {
+    fprintf(stderr, "ERROR: expected MCEP and F0 frame counts for each spurt\n");
+    return lengths;
+  }
+  for (size_t i = 0; i < NOMCEPS.size(); i++)
+    lengths.push_back(PyVocoderSpurtLength(std::max(0, NOMCEPS[i]),
+                                           std::max(0, NOF0S[i]), srate,
+                                           fshift, mixed, fftlen));
+  return lengths;
+}
+
+
+std::vector<double> PyVocoder_vocode_spurts(PySimpleOptions * pyopts,
+                                            const std::vector<std::vector<double>> &MCEPS,
+                                            const std::vector<std::vector<double>> &F0S,
+                                            const std::vector<std::vector<double>> &BNDAPS,
+                                            int order, double all_pass_constant,
+                                            int srate, double fshift, int pade_order,
+                                            bool mixed, double f0min, int fftlen,
+                                            double uv_period, bool gauss, int seed,
+                                            int interpolation_period, bool stablise,
+                                            int stable_condition, double stability_threshold,
+                                            bool quiet, bool bflag, bool nogain,
+                                            bool transpose_filter, bool inverse_filter,
+                                            int num_threads, bool ola, bool use_gpu) {
+  std::vector<double> waveform;
+  size_t nospurts = MCEPS.size();
+  if (F0S.size() != nospurts || (mixed && BNDAPS.size() != nospurts)) {
+    fprintf(stderr, "ERROR: expected MCEPs, F0s and band aperiodicities for each spurt\n");
+    return waveform;
+  }
+  if (order < 0) {
+    fprintf(stderr, "ERROR: MCEP order must not be negative\n");
+    return waveform;
+  }
+  int fprd = static_cast<int>(srate * fshift);
+
+  // where each spurt goes in the output
+  std::vector<size_t> offsets(nospurts + 1, 0);
+  for (size_t i = 0; i < nospurts; i++)
+    offsets[i + 1] = offsets[i] + PyVocoderSpurtLength(
+        MCEPS[i].size() / (order + 1), F0S[i].size(), srate, fshift, mixed,
+        fftlen);
+  waveform.resize(offsets[nospurts]);
+
+  // a spurt whose waveform is not the expected length (after an error) is
+  // kept aside and the output put back together at the end
+  std::vector<std::vector<double>> misfits(nospurts);
+  std::vector<char> is_misfit(nospurts, 0);
+  std::atomic<bool> any_misfit(false);
+  std::atomic<size_t> next_spurt(0);
+
+  auto vocode = [&]() {
+    size_t i;
+    while ((i = next_spurt++) < nospurts) {
+      std::vector<double> excitation;
+      if (mixed) {
+        excitation = PyVocoder_mixed_excitation(pyopts, F0S[i], BNDAPS[i],
+                                                srate, fshift, f0min, fftlen,
+                                                uv_period, gauss, seed);
+      } else {
+        std::vector<double> periods(F0S[i].size());
+        for (size_t f = 0; f < periods.size(); f++)
+          periods[f] = (F0S[i][f] > 0.0) ? srate / F0S[i][f] : 0.0;
+        excitation = PySPTK_excite(periods, fprd, interpolation_period,
+                                   gauss, seed);
+      }
+      std::vector<double> spurt_waveform;
+      if (ola) {
+        spurt_waveform = PyVocoder_ola_synthesis(
+            stablise ? PySPTK_mlsacheck(MCEPS[i], order, all_pass_constant,
+                                        fftlen, 2, stable_condition,
+                                        pade_order, stability_threshold,
+                                        quiet)
+                     : MCEPS[i],
+            excitation, order, all_pass_constant, fprd, fftlen, bflag,
+            nogain, use_gpu, 1);
+      } else if (stablise) {
+        spurt_waveform = PySPTK_mlsadf(
+            PySPTK_mlsacheck(MCEPS[i], order, all_pass_constant, fftlen, 2,
+                             stable_condition, pade_order,
+                             stability_threshold, quiet),
+            excitation, order, all_pass_constant, fprd, interpolation_period,
+            pade_order, bflag, nogain, transpose_filter, inverse_filter);
+      } else {
+        spurt_waveform = PySPTK_mlsadf(
+            MCEPS[i], excitation, order, all_pass_constant, fprd,
+            interpolation_period, pade_order, bflag, nogain, transpose_filter,
+            inverse_filter);
+      }
+      if (spurt_waveform.size() == offsets[i + 1] - offsets[i]) {
+        std::copy(spurt_waveform.begin(), spurt_waveform.end(),
+                  waveform.begin() + offsets[i]);
       } else {
-        cc[0] = 0;
-        for (i = 1; i <= m; i++)
-          cc[i] *= -1;
+        misfits[i].swap(spurt_waveform);
+        is_misfit[i] = 1;
+        any_misfit = true;
       }
     }
+  };
+
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = std::min<size_t>(num_threads, nospurts);
+  std::vector<std::thread> threads;
+  for (int t = 1; t < num_threads; t++)
+    threads.push_back(std::thread(vocode));
+  vocode();
+  for (auto &thread : threads)
+    thread.join();
+
+  if (any_misfit) {
+    std::vector<double> joined;
+    for (size_t i = 0; i < nospurts; i++) {
+      if (is_misfit[i])
+        joined.insert(joined.end(), misfits[i].begin(), misfits[i].end());
+      else
+        joined.insert(joined.end(), waveform.begin() + offsets[i],
+                      waveform.begin() + offsets[i + 1]);
+    }
+    waveform.swap(joined);
+  }
+  return waveform;
+}
 
-    for (i = 0; i <= m; i++)
-      inc[i] = (cc[i] - c[i]) * (double) iprd / (double) fprd;
 
-    for (j = fprd, i = (iprd + 1) / 2; j--;) {
-      if (vreadf(&x, 1, EXCITATION, &EXCITATION_it) != 1) {
-        filter_finished = true;
-        break;
-      }
+struct PyAudioEncoder {
+  std::unique_ptr<kaldi::AudioEncoder> encoder;
+};
 
-      if (!ngain)
-        x *= exp(c[0]);
-      if (transpose)
-        x = mlsadft(x, c, m, a, pd, d);
-      else
-        x = mlsadf(x, c, m, a, pd, d);
 
-      waveform.push_back(x);
+std::vector<std::string> PyAudioEncoder_formats() {
+  return kaldi::AudioEncoder::Formats();
+}
 
-      if (!--i) {
-        for (i = 0; i <= m; i++)
-          c[i] += inc[i];
-        i = iprd;
-      }
-    }
 
-    if (!filter_finished)
-      movem(cc, c, sizeof(*cc), m + 1);
+static PyAudioEncoder * PyAudioEncoder_create(const std::string &format, int srate,
+                                              double quality, kaldi::int64 num_samples) {
+  kaldi::AudioEncoder * encoder = kaldi::AudioEncoder::New(format, srate, quality,
+                                                           num_samples);
+  if (!encoder) {
+    fprintf(stderr, "ERROR: cannot encode %s at %d Hz\n", format.c_str(), srate);
+    return nullptr;
   }
+  PyAudioEncoder * enc = new PyAudioEncoder;
+  enc->encoder.reset(encoder);
+  return enc;
+}
 
-  free(c);
-  return waveform;
+
+PyAudioEncoder * PyAudioEncoder_new(const std::string &format, int srate,
+                                    double quality) {
+  return PyAudioEncoder_create(format, srate, quality, -1);
 }
 
 
+void PyAudioEncoder_delete(PyAudioEncoder * enc) {
+  delete enc;
+}
+
 
+PyIdlakBytes PyAudioEncoder_encode(PyAudioEncoder * enc,
+                                   const std::vector<double> &WAVEFORM) {
+  PyIdlakBytes output;
+  if (!enc || !enc->encoder)
+    return output;
+  try {
+    enc->encoder->Encode(WAVEFORM.data(), WAVEFORM.size(), &output);
+  } catch (std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    output.clear();
+  }
+  return output;
+}
 
 
+PyIdlakBytes PyAudioEncoder_flush(PyAudioEncoder * enc) {
+  PyIdlakBytes output;
+  if (!enc || !enc->encoder)
+    return output;
+  try {
+    enc->encoder->Finish(&output);
+  } catch (std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    output.clear();
+  }
+  enc->encoder.reset();
+  return output;
+}
+
+
+PyIdlakBytes PyAudio_encode(const std::string &format, int srate,
+                            double quality,
+                            const std::vector<double> &WAVEFORM) {
+  PyIdlakBytes output;
+  PyAudioEncoder * enc = PyAudioEncoder_create(format, srate, quality,
+                                               WAVEFORM.size());
+  if (!enc)
+    return output;
+  output = PyAudioEncoder_encode(enc, WAVEFORM);
+  output += PyAudioEncoder_flush(enc);
+  PyAudioEncoder_delete(enc);
+  return output;
+}
+
+
+struct PyResampler {
+  std::unique_ptr<kaldi::LinearResample> resampler;
+};
+
+
+PyResampler * PyResampler_new(int srate_in, int srate_out) {
+  if (srate_in <= 0 || srate_out <= 0) {
+    fprintf(stderr, "ERROR: cannot resample from %d Hz to %d Hz\n",
+            srate_in, srate_out);
+    return nullptr;
+  }
+  // as DownsampleWaveForm in feat/resample.h
+  double cutoff = 0.99 * 0.5 * std::min(srate_in, srate_out);
+  PyResampler * resampler = new PyResampler;
+  resampler->resampler.reset(new kaldi::LinearResample(srate_in, srate_out,
+                                                       cutoff, 6));
+  return resampler;
+}
+
+
+void PyResampler_delete(PyResampler * resampler) {
+  delete resampler;
+}
+
+
+static std::vector<double> PyResampler_run(PyResampler * resampler,
+                                           const std::vector<double> &WAVEFORM,
+                                           bool flush) {
+  std::vector<double> output;
+  if (!resampler)
+    return output;
+  kaldi::Vector<kaldi::BaseFloat> input(WAVEFORM.size(), kaldi::kUndefined),
+      resampled;
+  for (size_t i = 0; i < WAVEFORM.size(); i++)
+    input(i) = WAVEFORM[i];
+  resampler->resampler->Resample(input, flush, &resampled);
+  output.assign(resampled.Data(), resampled.Data() + resampled.Dim());
+  return output;
+}
+
+
+std::vector<double> PyResampler_process(PyResampler * resampler,
+                                        const std::vector<double> &WAVEFORM) {
+  return PyResampler_run(resampler, WAVEFORM, false);
+}
+
+
+std::vector<double> PyResampler_flush(PyResampler * resampler) {
+  return PyResampler_run(resampler, std::vector<double>(), true);
+}
+
+
+std::vector<double> PyVocoder_resample(int srate_in, int srate_out,
+                                       const std::vector<double> &WAVEFORM) {
+  std::vector<double> output;
+  PyResampler * resampler = PyResampler_new(srate_in, srate_out);
+  if (!resampler)
+    return output;
+  output = PyResampler_run(resampler, WAVEFORM, true);
+  PyResampler_delete(resampler);
+  return output;
+}
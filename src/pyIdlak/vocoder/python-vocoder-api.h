@@ -30,6 +30,11 @@
 // TODO: ENUMs as appropriate
 
 #include "pyIdlak/pylib/pyIdlak_types.h"
+#include "matrix/kaldi-matrix.h"
+
+typedef struct PyMlsaSynthesizer PyMlsaSynthesizer;
+typedef struct PyAudioEncoder PyAudioEncoder;
+typedef struct PyResampler PyResampler;
 
 /* Get the start / center / end of the aperiodic bands in Herz with the given options */
 std::vector<double> PyVocoder_get_aperiodic_band_starts(PySimpleOptions * pyopts);
@@ -55,6 +60,25 @@ std::vector<double> PySPTK_excite(const std::vector<double> &INPUT,
                       int frame_period, int interpolation_period, bool gauss, int seed);
 
 
+/*
+mixed excitation - generate excitation mixing a pulse train and band limited noise
+
+  For each pitch period a pulse and noise are mixed in the FFT domain using the
+  band aperiodicities (dB) of the frame, windowed with a pitch synchronous hanning
+  window and overlap added. BNDAPS is the flattened frame by band matrix, the band
+  layout comes from the AperiodicEnergyOptions in pyopts. If uv_period is not
+  positive it defaults to twice the frame shift. Same as excitation.mixed_excitation
+  apart from the random number generator used for the noise.
+*/
+std::vector<double> PyVocoder_mixed_excitation(PySimpleOptions * pyopts,
+                                               const std::vector<double> &F0S,
+                                               const std::vector<double> &BNDAPS,
+                                               int srate, double fshift,
+                                               double f0min, int fftlen,
+                                               double uv_period, bool gauss,
+                                               int seed);
+
+
 
 /*
 mgc2sp - transform mel-generalized cepstrum to spectrum
@@ -70,6 +94,19 @@ std::vector<double> PySPTK_mgc2sp(const std::vector<double> &INPUT,
                       double alpha, double gamma, int order, bool norm_cepstrum, int fftlen,
                       bool output_phase, int output_format);
 
+/*
+mgc2sp over a matrix of frames of (order + 1) coefficients, returning the
+frames by fftlen / 2 + 1 bins in the same output format. The conversion is
+done natively (without SPTK's static buffers) with one FFT plan for all the
+frames, which are split over num_threads threads (if not positive, one per
+core). Returns NULL if fftlen is not a power of 2.
+*/
+kaldi::Matrix<kaldi::BaseFloat> * PyVocoder_mgc2sp_matrix(const kaldi::MatrixBase<kaldi::BaseFloat> &INPUT,
+                                                          double alpha, double gamma,
+                                                          bool norm_cepstrum, int fftlen,
+                                                          bool output_phase, int output_format,
+                                                          int num_threads);
+
 
 /*
 mlpg -  obtains parameter sequence from PDF sequence
@@ -86,12 +123,36 @@ Note that the changes to the following options:
   "-r" has been removed
   "-d" only works with filenames
   "-m" has been removed as total length is required instead
+
+The system is solved exactly over the whole utterance (see
+python-vocoder-mlpg.h), so influence_range is no longer used and is kept for
+compatibility. An empty vector is returned if the system can not be solved.
 */
 std::vector<double> PySPTK_mlpg(const std::vector<double> &INPUT, int vector_length,
                                 const std::vector<std::vector<double>> &delta_windows,
                                 int input_type, int influence_range);
 
 
+/*
+MLPG on a matrix of DNN outputs
+
+Runs MLPG on one stream in the columns of INPUT (frames by outputs): the means
+of the statics are columns offset ... offset + dim - 1 and those of delta
+window w are dim columns starting at offset + w * stride, so e.g. the MCEPs of
+an acoustic model which interleaves MCEPs and band aperiodicities have the
+MCEPs' offset with the stride of both. VARIANCES are the global variances of
+the statics and then of each delta (dim values each), the same for every
+frame. If fix_ends is set the first and last frames get zero variance so the
+output is pinned to their means there. Returns the frames by dim parameters,
+or NULL if the dimensions are inconsistent or the system can not be solved.
+*/
+kaldi::Matrix<kaldi::BaseFloat> * PyVocoder_mlpg_matrix(const kaldi::MatrixBase<kaldi::BaseFloat> &INPUT,
+                                                        int offset, int dim, int stride,
+                                                        const std::vector<double> &VARIANCES,
+                                                        const std::vector<std::vector<double>> &delta_windows,
+                                                        bool fix_ends);
+
+
 /*
 mlsacheck - Check stability of MLSA filter coefficients
 
@@ -113,6 +174,18 @@ std::vector<double> PySPTK_mlsacheck(const std::vector<double> &INPUT, int order
                                      int stable_condition, int pade_order, double threshold,
                                      bool quiet);
 
+/*
+mlsacheck over a matrix of frames of MCEPs (the order is one less than the
+number of columns), returning the stable MCEPs. The options are as above; one
+FFT plan is used for all the frames, which are split over num_threads threads
+(if not positive, one per core). Returns NULL if the options are invalid.
+*/
+kaldi::Matrix<kaldi::BaseFloat> * PyVocoder_mlsacheck_matrix(const kaldi::MatrixBase<kaldi::BaseFloat> &MCEPS,
+                                                             double all_pass_constant, int fftlen,
+                                                             int check_type, int stable_condition,
+                                                             int pade_order, double threshold,
+                                                             bool quiet, int num_threads);
+
 
 
 /*
@@ -136,4 +209,130 @@ std::vector<double> PySPTK_mlsadf(const std::vector<double> &MCEPS, const std::v
                                   bool bflag, bool nogain, bool transpose_filter, bool inverse_filter);
 
 
+/*
+Overlap-add synthesis - a fast alternative to PySPTK_mlsadf
+
+Each MCEP frame is turned into the minimum phase spectrum of its filter (as
+mgc2sp), multiplied by the spectrum of the Hann windowed excitation about the
+frame and inverse transformed, and the frames are overlap-added. The frames
+are independent, so they are transformed on num_threads threads (if not
+positive, one per core) or, if use_gpu is set and kaldi was built with CUDA,
+with cuFFT on the GPU. The output is the same length as PySPTK_mlsadf's and
+bflag and nogain mean the same. fftlen must be a power of 2 of at least twice
+the frame period; it also bounds the length of each frame's impulse response.
+There is no interpolation period, transpose or inverse filter.
+*/
+std::vector<double> PyVocoder_ola_synthesis(const std::vector<double> &MCEPS, const std::vector<double> &EXCITATION,
+                                            int order, double all_pass_constant,
+                                            int frame_period, int fftlen, bool bflag,
+                                            bool nogain, bool use_gpu, int num_threads);
+
+
+/*
+Streaming MLSA synthesis
+
+The same filter as PySPTK_mlsadf but the MCEP frames and excitation can be given
+in chunks. The Pade delay line and the frame being interpolated are kept between
+calls, so the concatenated output of process over all chunks followed by flush is
+the same as one call to PySPTK_mlsadf on the whole input. A frame period is only
+output once the following frame and a full period of excitation are available.
+
+flush outputs any final partial period and resets the synthesizer for a new stream.
+*/
+PyMlsaSynthesizer * PyMlsaSynthesizer_new(int order, double all_pass_constant,
+                                          int frame_period, int interpolation_period,
+                                          int pade_order, bool bflag, bool nogain,
+                                          bool transpose_filter, bool inverse_filter);
+void PyMlsaSynthesizer_delete(PyMlsaSynthesizer * synth);
+void PyMlsaSynthesizer_reset(PyMlsaSynthesizer * synth);
+std::vector<double> PyMlsaSynthesizer_process(PyMlsaSynthesizer * synth,
+                                              const std::vector<double> &MCEPS,
+                                              const std::vector<double> &EXCITATION);
+std::vector<double> PyMlsaSynthesizer_flush(PyMlsaSynthesizer * synth);
+
+
+/*
+Spurt-parallel vocoding
+
+Vocodes a list of spurts (MCEPS, F0S and, for mixed excitation, BNDAPS per
+spurt, flattened frame by coefficient as for the functions above) and returns
+the spurts' waveforms one after another. Each spurt is the same as generating
+its excitation (mixed excitation if mixed is set, else PySPTK_excite with the
+pitch periods of the F0s), optionally stablising the MCEPs with
+PySPTK_mlsacheck (clipping) and running PySPTK_mlsadf (or, if ola is set,
+PyVocoder_ola_synthesis on one thread), but the spurts are vocoded
+concurrently on num_threads threads (if not positive, one per core), each
+spurt written at its precomputed offset in the output. pyopts is the
+AperiodicEnergyOptions for the bands, only used for mixed excitation.
+*/
+std::vector<double> PyVocoder_vocode_spurts(PySimpleOptions * pyopts,
+                                            const std::vector<std::vector<double>> &MCEPS,
+                                            const std::vector<std::vector<double>> &F0S,
+                                            const std::vector<std::vector<double>> &BNDAPS,
+                                            int order, double all_pass_constant,
+                                            int srate, double fshift, int pade_order,
+                                            bool mixed, double f0min, int fftlen,
+                                            double uv_period, bool gauss, int seed,
+                                            int interpolation_period, bool stablise,
+                                            int stable_condition, double stability_threshold,
+                                            bool quiet, bool bflag, bool nogain,
+                                            bool transpose_filter, bool inverse_filter,
+                                            int num_threads, bool ola, bool use_gpu);
+
+/*
+The number of samples PyVocoder_vocode_spurts gives for each spurt, from the
+numbers of MCEP and F0 frames of the spurts, when there are no errors.
+*/
+std::vector<int> PyVocoder_spurt_lengths(const std::vector<int> &NOMCEPS,
+                                         const std::vector<int> &NOF0S,
+                                         int srate, double fshift, bool mixed,
+                                         int fftlen);
+
+
+/*
+Audio encoding in memory
+
+Encodes the 16 bit scale waveform as "pcm" (raw 16 bit little endian), "wav",
+"ogg" (Vorbis), "opus" (Ogg Opus) or "mp3". The compressed formats are only
+available if their library was found when configuring, PyAudioEncoder_formats
+lists those in this build. quality goes from 0 (smallest) to 1 (best).
+
+The encoder takes the waveform in chunks, encode returns the bytes which are
+complete so far and flush the rest of the stream, after which the encoder is
+finished. new returns NULL if the format is not available or does not support
+the sample rate. A streamed wav header has the maximum length, PyAudio_encode
+encodes a whole waveform with the real length in the header.
+*/
+std::vector<std::string> PyAudioEncoder_formats();
+PyAudioEncoder * PyAudioEncoder_new(const std::string &format, int srate,
+                                    double quality);
+void PyAudioEncoder_delete(PyAudioEncoder * enc);
+PyIdlakBytes PyAudioEncoder_encode(PyAudioEncoder * enc,
+                                   const std::vector<double> &WAVEFORM);
+PyIdlakBytes PyAudioEncoder_flush(PyAudioEncoder * enc);
+PyIdlakBytes PyAudio_encode(const std::string &format, int srate,
+                            double quality,
+                            const std::vector<double> &WAVEFORM);
+
+
+/*
+Resampling
+
+Converts the waveform from srate_in to srate_out (both in Hz) with the
+polyphase windowed sinc filter of the feature extraction (LinearResample),
+with the cutoff just under the lower of the two Nyquist frequencies.
+
+The resampler takes the waveform in chunks; process returns the samples
+which are complete so far and flush the rest, after which it can be used
+for a new waveform. new returns NULL if a rate is not positive.
+PyVocoder_resample resamples a whole waveform.
+*/
+PyResampler * PyResampler_new(int srate_in, int srate_out);
+void PyResampler_delete(PyResampler * resampler);
+std::vector<double> PyResampler_process(PyResampler * resampler,
+                                        const std::vector<double> &WAVEFORM);
+std::vector<double> PyResampler_flush(PyResampler * resampler);
+std::vector<double> PyVocoder_resample(int srate_in, int srate_out,
+                                       const std::vector<double> &WAVEFORM);
+
 #endif // KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_API_H_
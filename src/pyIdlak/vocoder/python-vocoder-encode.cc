@@ -0,0 +1,394 @@
+// pyIdlak/vocoder/python-vocoder-encode.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#ifdef HAVE_VORBIS
+#include <vorbis/vorbisenc.h>
+#endif
+#if defined(HAVE_OPUS)
+#include <ogg/ogg.h>
+#include <opus/opus.h>
+#endif
+#ifdef HAVE_LAME
+#include <lame/lame.h>
+#endif
+
+#include "python-vocoder-encode.h"
+
+namespace kaldi {
+
+// Same clipping as MCEPVocoder.to_wav
+static inline int16 EncodeSample(double x) {
+  return static_cast<int16>(std::max(std::min(x, 32767.0), -32768.0));
+}
+
+static void AppendLE(uint32 value, int32 nbytes, std::string *output) {
+  for (int32 i = 0; i < nbytes; i++)
+    output->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+class PcmEncoder : public AudioEncoder {
+ public:
+  void Encode(const double *samples, size_t num_samples,
+              std::string *output) {
+    output->reserve(output->size() + 2 * num_samples);
+    for (size_t i = 0; i < num_samples; i++)
+      AppendLE(static_cast<uint16>(EncodeSample(samples[i])), 2, output);
+  }
+  void Finish(std::string *output) {}
+};
+
+// The header is written before the first samples
+class WavEncoder : public PcmEncoder {
+ public:
+  WavEncoder(int32 srate, int64 num_samples)
+      : srate_(srate), num_samples_(num_samples), started_(false) {}
+  void Encode(const double *samples, size_t num_samples,
+              std::string *output) {
+    if (!started_) WriteHeader(output);
+    PcmEncoder::Encode(samples, num_samples, output);
+  }
+  void Finish(std::string *output) {
+    if (!started_) WriteHeader(output);
+  }
+
+ private:
+  void WriteHeader(std::string *output) {
+    uint32 data_bytes = 0xffffffff - 36;
+    if (num_samples_ >= 0 && 2 * num_samples_ < data_bytes)
+      data_bytes = static_cast<uint32>(2 * num_samples_);
+    output->append("RIFF");
+    AppendLE(data_bytes + 36, 4, output);
+    output->append("WAVEfmt ");
+    AppendLE(16, 4, output);            // fmt chunk size
+    AppendLE(1, 2, output);             // PCM
+    AppendLE(1, 2, output);             // mono
+    AppendLE(srate_, 4, output);
+    AppendLE(2 * srate_, 4, output);    // bytes per second
+    AppendLE(2, 2, output);             // block align
+    AppendLE(16, 2, output);            // bits per sample
+    output->append("data");
+    AppendLE(data_bytes, 4, output);
+    started_ = true;
+  }
+  int32 srate_;
+  int64 num_samples_;
+  bool started_;
+};
+
+#if defined(HAVE_VORBIS) || defined(HAVE_OPUS)
+static void AppendOggPage(const ogg_page &page, std::string *output) {
+  output->append(reinterpret_cast<const char*>(page.header), page.header_len);
+  output->append(reinterpret_cast<const char*>(page.body), page.body_len);
+}
+#endif
+
+#ifdef HAVE_VORBIS
+class VorbisEncoder : public AudioEncoder {
+ public:
+  VorbisEncoder() : ok_(false), started_(false) {}
+  ~VorbisEncoder() {
+    if (!ok_) return;
+    ogg_stream_clear(&os_);
+    vorbis_block_clear(&vb_);
+    vorbis_dsp_clear(&vd_);
+    vorbis_comment_clear(&vc_);
+    vorbis_info_clear(&vi_);
+  }
+  // false if libvorbis does not support the sample rate
+  bool Init(int32 srate, BaseFloat quality) {
+    vorbis_info_init(&vi_);
+    // vorbis quality goes from -0.1 to 1
+    if (vorbis_encode_init_vbr(&vi_, 1, srate, quality * 1.1 - 0.1)) {
+      vorbis_info_clear(&vi_);
+      return false;
+    }
+    vorbis_comment_init(&vc_);
+    vorbis_comment_add_tag(&vc_, "ENCODER", "idlak");
+    vorbis_analysis_init(&vd_, &vi_);
+    vorbis_block_init(&vd_, &vb_);
+    ogg_stream_init(&os_, 1);
+    ok_ = true;
+    return true;
+  }
+  void Encode(const double *samples, size_t num_samples,
+              std::string *output) {
+    if (!started_) WriteHeaders(output);
+    if (!num_samples) return;
+    float **buffer = vorbis_analysis_buffer(&vd_, num_samples);
+    for (size_t i = 0; i < num_samples; i++)
+      buffer[0][i] = EncodeSample(samples[i]) / 32768.0f;
+    vorbis_analysis_wrote(&vd_, num_samples);
+    Drain(output);
+  }
+  void Finish(std::string *output) {
+    if (!started_) WriteHeaders(output);
+    vorbis_analysis_wrote(&vd_, 0);
+    Drain(output);
+  }
+
+ private:
+  void WriteHeaders(std::string *output) {
+    ogg_packet header, comments, codebooks;
+    vorbis_analysis_headerout(&vd_, &vc_, &header, &comments, &codebooks);
+    ogg_stream_packetin(&os_, &header);
+    ogg_stream_packetin(&os_, &comments);
+    ogg_stream_packetin(&os_, &codebooks);
+    // audio starts on a new page
+    ogg_page page;
+    while (ogg_stream_flush(&os_, &page))
+      AppendOggPage(page, output);
+    started_ = true;
+  }
+  void Drain(std::string *output) {
+    ogg_packet packet;
+    ogg_page page;
+    while (vorbis_analysis_blockout(&vd_, &vb_) == 1) {
+      vorbis_analysis(&vb_, NULL);
+      vorbis_bitrate_addblock(&vb_);
+      while (vorbis_bitrate_flushpacket(&vd_, &packet)) {
+        ogg_stream_packetin(&os_, &packet);
+        while (ogg_stream_pageout(&os_, &page))
+          AppendOggPage(page, output);
+      }
+    }
+  }
+  bool ok_;
+  bool started_;
+  vorbis_info vi_;
+  vorbis_comment vc_;
+  vorbis_dsp_state vd_;
+  vorbis_block vb_;
+  ogg_stream_state os_;
+};
+#endif  // HAVE_VORBIS
+
+#ifdef HAVE_OPUS
+// Ogg Opus (RFC 7845), 20ms frames. Granule positions are always at 48kHz
+class OggOpusEncoder : public AudioEncoder {
+ public:
+  OggOpusEncoder() : enc_(NULL), started_(false), packetno_(0), pre_skip_(0),
+                  granule_(0), num_samples_(0) {}
+  ~OggOpusEncoder() {
+    if (!enc_) return;
+    opus_encoder_destroy(enc_);
+    ogg_stream_clear(&os_);
+  }
+  // false if libopus does not support the sample rate
+  bool Init(int32 srate, BaseFloat quality) {
+    int err;
+    enc_ = opus_encoder_create(srate, 1, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK) {
+      enc_ = NULL;
+      return false;
+    }
+    srate_ = srate;
+    frame_size_ = srate / 50;
+    // 12 to 64 kbit/s
+    opus_encoder_ctl(enc_, OPUS_SET_BITRATE(
+        static_cast<opus_int32>(12000 + quality * 52000)));
+    opus_int32 lookahead = 0;
+    opus_encoder_ctl(enc_, OPUS_GET_LOOKAHEAD(&lookahead));
+    pre_skip_ = static_cast<int64>(lookahead) * 48000 / srate;
+    granule_ = pre_skip_;
+    ogg_stream_init(&os_, 1);
+    return true;
+  }
+  void Encode(const double *samples, size_t num_samples,
+              std::string *output) {
+    if (!started_) WriteHeaders(output);
+    num_samples_ += num_samples;
+    for (size_t i = 0; i < num_samples; i++)
+      pending_.push_back(EncodeSample(samples[i]));
+    size_t start = 0;
+    for (; start + frame_size_ <= pending_.size(); start += frame_size_)
+      EncodeFrame(&pending_[start], false, output);
+    pending_.erase(pending_.begin(), pending_.begin() + start);
+  }
+  void Finish(std::string *output) {
+    if (!started_) WriteHeaders(output);
+    // the last frame is zero padded, the final granule position tells the
+    // decoder where the speech ends
+    pending_.resize(frame_size_, 0);
+    EncodeFrame(&pending_[0], true, output);
+    pending_.clear();
+    ogg_page page;
+    while (ogg_stream_flush(&os_, &page))
+      AppendOggPage(page, output);
+  }
+
+ private:
+  void PacketIn(std::string *data, bool bos, bool eos) {
+    ogg_packet packet;
+    packet.packet = reinterpret_cast<unsigned char*>(&(*data)[0]);
+    packet.bytes = data->size();
+    packet.b_o_s = bos;
+    packet.e_o_s = eos;
+    packet.granulepos = bos ? 0 : granule_;
+    packet.packetno = packetno_++;
+    ogg_stream_packetin(&os_, &packet);
+  }
+  void WriteHeaders(std::string *output) {
+    std::string head("OpusHead");
+    head.push_back(1);                  // version
+    head.push_back(1);                  // channels
+    AppendLE(pre_skip_, 2, &head);
+    AppendLE(srate_, 4, &head);         // input sample rate
+    AppendLE(0, 2, &head);              // output gain
+    head.push_back(0);                  // mono / stereo mapping
+    PacketIn(&head, true, false);
+    ogg_page page;
+    while (ogg_stream_flush(&os_, &page))
+      AppendOggPage(page, output);
+    std::string tags("OpusTags");
+    const char *vendor = opus_get_version_string();
+    AppendLE(std::strlen(vendor), 4, &tags);
+    tags.append(vendor);
+    AppendLE(0, 4, &tags);              // no user comments
+    PacketIn(&tags, false, false);
+    while (ogg_stream_flush(&os_, &page))
+      AppendOggPage(page, output);
+    started_ = true;
+  }
+  void EncodeFrame(const opus_int16 *frame, bool last, std::string *output) {
+    unsigned char buffer[4000];
+    opus_int32 nbytes = opus_encode(enc_, frame, frame_size_, buffer,
+                                    sizeof(buffer));
+    if (nbytes < 0) KALDI_ERR << "Opus encoding failed: "
+                              << opus_strerror(nbytes);
+    if (last)
+      granule_ = pre_skip_ + num_samples_ * 48000 / srate_;
+    else
+      granule_ += static_cast<int64>(frame_size_) * 48000 / srate_;
+    std::string data(reinterpret_cast<char*>(buffer), nbytes);
+    PacketIn(&data, false, last);
+    ogg_page page;
+    while (ogg_stream_pageout(&os_, &page))
+      AppendOggPage(page, output);
+  }
+  ::OpusEncoder *enc_;
+  ogg_stream_state os_;
+  bool started_;
+  int64 packetno_;
+  int64 pre_skip_;
+  int64 granule_;
+  int64 num_samples_;
+  int32 srate_;
+  int32 frame_size_;
+  std::vector<opus_int16> pending_;
+};
+#endif  // HAVE_OPUS
+
+#ifdef HAVE_LAME
+class Mp3Encoder : public AudioEncoder {
+ public:
+  Mp3Encoder() : lame_(NULL) {}
+  ~Mp3Encoder() {
+    if (lame_) lame_close(lame_);
+  }
+  // false if LAME does not support the sample rate
+  bool Init(int32 srate, BaseFloat quality) {
+    lame_ = lame_init();
+    if (!lame_) return false;
+    lame_set_in_samplerate(lame_, srate);
+    lame_set_num_channels(lame_, 1);
+    lame_set_mode(lame_, MONO);
+    lame_set_VBR(lame_, vbr_default);
+    // LAME VBR quality goes from 0 (best) to 9
+    lame_set_VBR_q(lame_, static_cast<int>(std::floor(9.0 * (1.0 - quality) +
+                                                      0.5)));
+    return lame_init_params(lame_) >= 0;
+  }
+  void Encode(const double *samples, size_t num_samples,
+              std::string *output) {
+    if (!num_samples) return;
+    pcm_.resize(num_samples);
+    for (size_t i = 0; i < num_samples; i++)
+      pcm_[i] = EncodeSample(samples[i]);
+    // worst case size from lame.h
+    buffer_.resize(num_samples + num_samples / 4 + 7200);
+    int nbytes = lame_encode_buffer(lame_, &pcm_[0], &pcm_[0], num_samples,
+                                    &buffer_[0], buffer_.size());
+    if (nbytes < 0) KALDI_ERR << "MP3 encoding failed: " << nbytes;
+    output->append(reinterpret_cast<char*>(&buffer_[0]), nbytes);
+  }
+  void Finish(std::string *output) {
+    buffer_.resize(7200);
+    int nbytes = lame_encode_flush(lame_, &buffer_[0], buffer_.size());
+    if (nbytes > 0)
+      output->append(reinterpret_cast<char*>(&buffer_[0]), nbytes);
+  }
+
+ private:
+  lame_t lame_;
+  std::vector<int16> pcm_;
+  std::vector<unsigned char> buffer_;
+};
+#endif  // HAVE_LAME
+
+AudioEncoder* AudioEncoder::New(const std::string &format, int32 srate,
+                                BaseFloat quality, int64 num_samples) {
+  if (srate <= 0) return NULL;
+  quality = std::max<BaseFloat>(std::min<BaseFloat>(quality, 1.0), 0.0);
+  if (format == "pcm")
+    return new PcmEncoder();
+  if (format == "wav")
+    return new WavEncoder(srate, num_samples);
+#ifdef HAVE_VORBIS
+  if (format == "ogg") {
+    std::unique_ptr<VorbisEncoder> enc(new VorbisEncoder());
+    return enc->Init(srate, quality) ? enc.release() : NULL;
+  }
+#endif
+#ifdef HAVE_OPUS
+  if (format == "opus") {
+    std::unique_ptr<OggOpusEncoder> enc(new OggOpusEncoder());
+    return enc->Init(srate, quality) ? enc.release() : NULL;
+  }
+#endif
+#ifdef HAVE_LAME
+  if (format == "mp3") {
+    std::unique_ptr<Mp3Encoder> enc(new Mp3Encoder());
+    return enc->Init(srate, quality) ? enc.release() : NULL;
+  }
+#endif
+  return NULL;
+}
+
+std::vector<std::string> AudioEncoder::Formats() {
+  std::vector<std::string> formats;
+  formats.push_back("pcm");
+  formats.push_back("wav");
+#ifdef HAVE_VORBIS
+  formats.push_back("ogg");
+#endif
+#ifdef HAVE_OPUS
+  formats.push_back("opus");
+#endif
+#ifdef HAVE_LAME
+  formats.push_back("mp3");
+#endif
+  return formats;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,64 @@
+// pyIdlak/vocoder/python-vocoder-encode.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Waveform to audio file encoding in memory, not exposed to python.
+//
+// Samples are doubles on the 16 bit scale as produced by the vocoder, they
+// are clipped to 16 bits. Each encoder takes the waveform in chunks and
+// returns whatever encoded bytes are complete, so the output can be sent
+// while the rest of the speech is being synthesised. The compressed formats
+// are only built if the library was found by configure (HAVE_VORBIS for Ogg
+// Vorbis, HAVE_OPUS for Ogg Opus and HAVE_LAME for MP3).
+
+#ifndef KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_ENCODE_H_
+#define KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_ENCODE_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+class AudioEncoder {
+ public:
+  /// Creates a mono encoder for "pcm" (raw 16 bit little endian), "wav",
+  /// "ogg" (Vorbis), "opus" or "mp3". quality goes from 0 (smallest) to
+  /// 1 (best) and is ignored by pcm and wav. If num_samples is known it
+  /// goes in the wav header, otherwise the header has the maximum length
+  /// as is usual for streamed wav. NULL if the format is unknown, was not
+  /// built, or does not support the sample rate.
+  static AudioEncoder* New(const std::string &format, int32 srate,
+                           BaseFloat quality, int64 num_samples = -1);
+  /// Formats which New accepts in this build
+  static std::vector<std::string> Formats();
+
+  virtual ~AudioEncoder() {}
+  /// Appends the bytes encoded so far to output
+  virtual void Encode(const double *samples, size_t num_samples,
+                      std::string *output) = 0;
+  /// Ends the stream, appending the remaining bytes to output. The encoder
+  /// can not be used afterwards.
+  virtual void Finish(std::string *output) = 0;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_ENCODE_H_
@@ -19,7 +19,13 @@
 
 // Mixed excitation functions
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
+#include "base/kaldi-math.h"
+#include "matrix/kaldi-vector.h"
+#include "matrix/srfft.h"
 #include "idlakfeat/feature-aperiodic.h"
 #include "pyIdlak/pylib/pyIdlak_internal.h"
 
@@ -63,4 +69,188 @@ std::vector<double> PyVocoder_get_aperiodic_band_ends(PySimpleOptions * pyopts)
     band_ends.push_back(static_cast<double>(ap_energy.GetBandEnds()(i)));
 
   return band_ends;
-}
\ No newline at end of file
+}
+
+
+// Pitch synchronous excitation periods, same as excitation._pitch_periods
+struct PyVocoderPitchPeriod {
+  int sample;   // start sample
+  int frame;    // frame index
+  int period;   // period in samples
+  bool voiced;
+};
+
+static std::vector<PyVocoderPitchPeriod> PyVocoderPitchPeriods(
+    const std::vector<double> &f0s, int srate, double fshift, int nosamples,
+    double f0min, double uv_period) {
+  std::vector<PyVocoderPitchPeriod> pperiods;
+  int noframes = f0s.size();
+  int fidx = 0, sidx = 0;
+  double time = 0.0;
+  while (fidx < noframes && sidx < nosamples) {
+    double f0 = f0s[fidx];
+    double period = (f0 > 0.0) ? 1.0 / std::max(f0min, f0) : uv_period;
+    PyVocoderPitchPeriod pp;
+    pp.sample = sidx;
+    pp.frame = fidx;
+    pp.period = static_cast<int>(srate * period);
+    pp.voiced = f0 > 0.0;
+    pperiods.push_back(pp);
+    time += period;
+    sidx = static_cast<int>(srate * time);
+    while (time > (fidx + 1) * fshift)
+      fidx++;
+  }
+  return pperiods;
+}
+
+
+static inline double PyVocoderHann(int n, int N) {
+  if (N <= 1)
+    return 1.0;
+  return 0.5 * (1.0 - cos(2.0 * M_PI * n / (N - 1.0)));
+}
+
+
+std::vector<double> PyVocoder_mixed_excitation(PySimpleOptions * pyopts,
+                                               const std::vector<double> &F0S,
+                                               const std::vector<double> &BNDAPS,
+                                               int srate, double fshift,
+                                               double f0min, int fftlen,
+                                               double uv_period, bool gauss,
+                                               int seed) {
+  std::vector<double> excitation;
+  if (!pyopts || !pyopts->aprd_) {
+    fprintf(stderr, "ERROR: mixed excitation requires AperiodicEnergyOptions\n");
+    return excitation;
+  }
+  if (fftlen < 4 || (fftlen & (fftlen - 1))) {
+    fprintf(stderr, "ERROR: FFT length must be a power of 2\n");
+    return excitation;
+  }
+  if (uv_period <= 0.0)
+    uv_period = 2.0 * fshift;
+
+  kaldi::AperiodicEnergy ap_energy(*pyopts->aprd_);
+  const kaldi::Vector<kaldi::BaseFloat> &band_centers = ap_energy.GetBandCenters();
+  int nobands = ap_energy.Dim();
+  int noframes = F0S.size();
+  if (!nobands || BNDAPS.size() != static_cast<size_t>(noframes * nobands)) {
+    fprintf(stderr, "ERROR: expected %d band aperiodicities per frame\n", nobands);
+    return excitation;
+  }
+
+  int sshift = static_cast<int>(srate * fshift);  // frame shift in samples
+  int nosamples = noframes * sshift;
+  int hlen = fftlen / 2;
+
+  // FFT bin of the center of each band, the last band goes up to nyquist
+  std::vector<int> band_bins(nobands);
+  for (int b = 0; b < nobands; b++)
+    band_bins[b] = static_cast<int>(band_centers(b) * fftlen / srate);
+  band_bins[nobands - 1] = hlen;
+
+  kaldi::SplitRadixRealFft<double> srfft(fftlen);
+  std::vector<double> fft_buffer;
+  kaldi::Vector<double> noise(fftlen), fexc(fftlen), fhann(fftlen),
+      pweights(hlen + 1), nweights(hlen + 1);
+  kaldi::Vector<double> exc(nosamples), hann_totals(nosamples);
+  kaldi::RandomState rstate;
+  rstate.seed = seed;
+
+  std::vector<PyVocoderPitchPeriod> pperiods = PyVocoderPitchPeriods(
+      F0S, srate, fshift, nosamples, f0min, uv_period);
+  int period_pre = 0;
+  for (const auto &pp : pperiods) {
+    int period = pp.period;
+
+    // interpolate the noise weights between band centers, unvoiced frames
+    // use 0dB bands i.e. all noise
+    pweights.SetZero();
+    nweights.SetZero();
+    int pre_bcenter = 0;
+    double pre_nweight = 0.0;
+    for (int b = 0; b < nobands; b++) {
+      double bndap = pp.voiced ? BNDAPS[pp.frame * nobands + b] : 0.0;
+      double nweight = std::min(1.0, std::max(0.0, pow(10.0, bndap / 20.0)));
+      if (b == 0)
+        pre_nweight = nweight;
+      int bcenter = band_bins[b];
+      int nobins = bcenter - pre_bcenter;
+      double nweight_delta = (nobins > 0) ? (nweight - pre_nweight) / nobins : 0.0;
+      for (int i = 0, f = pre_bcenter; f < bcenter; i++, f++) {
+        double nw = nweight_delta * i + pre_nweight;
+        nweights(f) = nw;
+        pweights(f) = std::min(1.0, std::max(0.0, sqrt(1.0 - nw * nw)));
+      }
+      pre_bcenter = std::max(pre_bcenter, bcenter);
+      pre_nweight = nweight;
+    }
+    // the DC bin is both f and -f in the original, nyquist is never weighted
+    pweights(0) *= pweights(0);
+    nweights(0) *= nweights(0);
+    pweights(hlen) = 1.0;
+    nweights(hlen) = 1.0;
+
+    // noise, between the midpoints of the previous and current period
+    double nmag = sqrt(static_cast<double>(period) /
+                       std::max(1, period_pre + period));
+    int ns = hlen - period_pre / 2,
+        ne = hlen + (fftlen % 2) + period / 2;
+    noise.SetZero();
+    for (int t = std::max(0, ns + 1); t < std::min(fftlen, ne); t++) {
+      if (gauss)
+        noise(t) = nmag * kaldi::RandGauss(&rstate);
+      else
+        noise(t) = nmag * kaldi::RandUniform(&rstate);
+    }
+    srfft.Compute(noise.Data(), true, &fft_buffer);
+
+    // the pulse is a delta at the center of the window, its spectrum is
+    // pmag * (-1)^k so it is mixed in directly without an FFT
+    double pmag = sqrt(static_cast<double>(period));
+    double *x = fexc.Data();
+    const double *n = noise.Data();
+    x[0] = pmag * pweights(0) + n[0] * nweights(0);
+    x[1] = pmag * pweights(hlen) + n[1] * nweights(hlen);
+    for (int k = 1; k < hlen; k++) {
+      double pulse = (k % 2) ? -pmag : pmag;
+      x[2 * k] = pulse * pweights(k) + n[2 * k] * nweights(k);
+      x[2 * k + 1] = n[2 * k + 1] * nweights(k);
+    }
+    srfft.Compute(x, false, &fft_buffer);
+    fexc.Scale(1.0 / fftlen);
+
+    double energy = kaldi::VecVec(fexc, fexc);
+    if (energy > 0.0)
+      fexc.Scale(1.0 / sqrt(period / energy));
+
+    // pitch synchronous hanning window and overlap add
+    fhann.SetZero();
+    int hs = std::max(0, hlen - period_pre / 2),
+        he = std::min(fftlen - 1, hlen + (fftlen % 2) + period / 2);
+    for (int f = hs; f <= he; f++) {
+      if (f < hlen)
+        fhann(f) = PyVocoderHann(f - (hlen - period_pre / 2), period_pre);
+      else
+        fhann(f) = PyVocoderHann(period / 2 + (f - hlen), period);
+    }
+    int olen = std::min(he + 1, nosamples - pp.sample);
+    for (int f = hs; f < olen; f++) {
+      exc(pp.sample + f) += fexc(f) * fhann(f);
+      hann_totals(pp.sample + f) += fhann(f);
+    }
+    period_pre = period;
+  }
+
+  // renorm based on the hanning window locations
+  for (int s = 0; s < nosamples; s++) {
+    if (hann_totals(s) > 0.0)
+      exc(s) /= hann_totals(s);
+  }
+
+  // remove the offset introduced by building the excitation fft window
+  int offset = std::min(std::max(0, hlen - sshift), nosamples);
+  excitation.assign(exc.Data() + offset, exc.Data() + nosamples);
+  return excitation;
+}
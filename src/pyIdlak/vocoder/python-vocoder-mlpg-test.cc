@@ -0,0 +1,138 @@
+// pyIdlak/vocoder/python-vocoder-mlpg-test.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Checks the banded MLPG solver against a dense solve of the same system.
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "matrix/kaldi-matrix.h"
+#include "matrix/sp-matrix.h"
+#include "python-vocoder-mlpg.h"
+
+namespace kaldi {
+
+static void DenseMlpg(const Matrix<BaseFloat> &means,
+                      const Matrix<BaseFloat> &precisions,
+                      const std::vector<std::vector<double> > &delta_windows,
+                      Matrix<double> *parameters) {
+  int32 num_frames = means.NumRows(),
+      num_windows = delta_windows.size() + 1,
+      dim = means.NumCols() / num_windows;
+  parameters->Resize(num_frames, dim);
+  for (int32 k = 0; k < dim; k++) {
+    SpMatrix<double> wpw(num_frames);
+    Vector<double> wpm(num_frames);
+    for (int32 w = 0; w < num_windows; w++) {
+      std::vector<double> coef(1, 1.0);
+      int32 left = 0;
+      if (w > 0) {
+        coef = delta_windows[w - 1];
+        left = -static_cast<int32>(coef.size() / 2);
+      }
+      int32 right = left + coef.size() - 1;
+      for (int32 t = 0; t < num_frames; t++) {
+        if (t + left < 0 || t + right >= num_frames)
+          continue;
+        Vector<double> row(num_frames);
+        for (int32 j = left; j <= right; j++)
+          row(t + j) = coef[j - left];
+        double p = precisions(t, w * dim + k);
+        wpw.AddVec2(p, row);
+        wpm.AddVec(p * means(t, w * dim + k), row);
+      }
+    }
+    wpw.Invert();
+    Vector<double> c(num_frames);
+    c.AddSpVec(1.0, wpw, wpm, 0.0);
+    parameters->CopyColFromVec(c, k);
+  }
+}
+
+static void RandomProblem(int32 num_frames, int32 dim, int32 num_windows,
+                          Matrix<BaseFloat> *means,
+                          Matrix<BaseFloat> *precisions) {
+  means->Resize(num_frames, dim * num_windows);
+  precisions->Resize(num_frames, dim * num_windows);
+  means->SetRandn();
+  for (int32 t = 0; t < num_frames; t++)
+    for (int32 i = 0; i < dim * num_windows; i++)
+      (*precisions)(t, i) = 0.1 + RandUniform() * 10.0;
+}
+
+static void UnitTestMlpgSolve() {
+  std::vector<std::vector<double> > windows;
+  windows.push_back(std::vector<double>{-0.5, 0.0, 0.5});
+  windows.push_back(std::vector<double>{1.0, -2.0, 1.0});
+  for (int32 iter = 0; iter < 10; iter++) {
+    int32 num_frames = 1 + Rand() % 200, dim = 1 + Rand() % 10;
+    Matrix<BaseFloat> means, precisions, params;
+    RandomProblem(num_frames, dim, 3, &means, &precisions);
+    // some missing observations
+    for (int32 t = 0; t < num_frames; t += 7)
+      precisions(t, dim + Rand() % dim) = 0.0;
+    Matrix<double> ref;
+    DenseMlpg(means, precisions, windows, &ref);
+    KALDI_ASSERT(MlpgSolve(means, precisions, windows, &params,
+                           1 + iter % 4));
+    Matrix<double> diff(params);
+    diff.AddMat(-1.0, ref);
+    KALDI_ASSERT(diff.FrobeniusNorm() <= 1.0e-3 * (1.0 + ref.FrobeniusNorm()));
+  }
+
+  // an even length window has one more tap on the left
+  std::vector<std::vector<double> > even(1, std::vector<double>{-1.0, 1.0});
+  Matrix<BaseFloat> means, precisions, params;
+  RandomProblem(50, 2, 2, &means, &precisions);
+  Matrix<double> ref;
+  DenseMlpg(means, precisions, even, &ref);
+  KALDI_ASSERT(MlpgSolve(means, precisions, even, &params));
+  Matrix<double> diff(params);
+  diff.AddMat(-1.0, ref);
+  KALDI_ASSERT(diff.FrobeniusNorm() <= 1.0e-3 * (1.0 + ref.FrobeniusNorm()));
+
+  // no static observations is singular
+  for (int32 t = 0; t < 50; t++)
+    precisions(t, 0) = 0.0;
+  KALDI_ASSERT(!MlpgSolve(means, precisions, even, &params));
+}
+
+static void MlpgSpeedTest() {
+  std::vector<std::vector<double> > windows;
+  windows.push_back(std::vector<double>{-0.5, 0.0, 0.5});
+  windows.push_back(std::vector<double>{1.0, -2.0, 1.0});
+  Matrix<BaseFloat> means, precisions, params;
+  RandomProblem(6000, 60, 3, &means, &precisions);
+  for (int32 num_threads = 1; num_threads <= 4; num_threads *= 2) {
+    Timer t;
+    MlpgSolve(means, precisions, windows, &params, num_threads);
+    KALDI_LOG << "MLPG 6000 frames x 60 dims, " << num_threads
+              << " threads: " << t.Elapsed() << "s";
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestMlpgSolve();
+  kaldi::MlpgSpeedTest();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
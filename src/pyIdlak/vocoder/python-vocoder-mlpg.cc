@@ -17,415 +17,276 @@
 // limitations under the License.
 //
 
-// The mlpg binary has a lot of internal functions that will makes it unwieldy
-// to include in the vocode-api
-
-// Adapted from SPTK source code
+// MLPG solved exactly over the whole utterance, see python-vocoder-mlpg.h.
+// This replaces the port of SPTK's recursive pstream update, which only
+// looked influence_range frames either side of the current frame.
 
 #include <cmath>
 #include <string>
 #include <vector>
 #include <cstdio>
-#include <iostream>
-#include <exception>
-
-extern "C" {
-#include "SPTK.h"
-}
+#include <algorithm>
 
 #include "python-vocoder-api.h"
-#include "python-vocoder-lib.h"
-
-
-// Structures adapated from SPTK
-typedef struct _DWin {
-   int num;                     /* number of static + deltas */
-   int **width;                 /* width [0..num-1][0(left) 1(right)] */
-   double **coef;               /* coefficient [0..num-1][length[0]..length[1]] */
-   int maxw[2];                 /* max width [0(left) 1(right)] */
-   
-  std::vector<std::vector<double>> org; /* original delta window coefficient vector */
-} DWin;
-
-typedef struct _SMatrix {
-   double **mseq;               /* sequence of mean vector */
-   double **ivseq;              /* sequence of invarsed variance vector */
-   double ***P;                 /* matrix P[th][tv][m] */
-   double **c;                  /* parameter c */
-   double **pi;
-   double **k;
-   int t;                       /* time index */
-   int length;                  /* matrix length (must be power of 2) */
-   unsigned int mask;           /* length - 1 */
-} SMatrix;
-
-typedef struct _PStream {
-   int vSize;                   /* data vector size */
-   int order;                   /* order of cepstrum */
-   int range;
-   DWin dw;
-   double *mean;                /* input mean vector */
-   double *ivar;                /* input inversed variance vector */
-   double *par;                 /* output parameter vector */
-   int iType;                   /* type of input PDFs */
-   /*   0: ( m       , U      ) */
-   /*   1: ( m       , U^{-1} ) */
-   /*   2: ( mU^{-1} , U^{-1} ) */
-   SMatrix sm;
-} PStream;
-
-
-// Constants from SPTK
-
-const double INFTY = 1.0e+38;
-const double INFTY2 = 1.0e+19;
-const double INVINF = 1.0e-38;
-const double INVINF2 = 1.0e-19;
-
-const int WLEFT = 0;
-const int WRIGHT = 1;
-const int LENGTH = 256;
-
-/*  Required Functions  */
-void init_pstream(PStream * pst);
-void init_dwin(PStream * pst);
-double *dcalloc(int x, int xoff);
-double **ddcalloc(int x, int y, int xoff, int yoff);
-double ***dddcalloc(int x, int y, int z, int xoff, int yoff, int zoff);
-double *mlpg(PStream * pst);
-int doupdate(PStream * pst, int d);
-void calc_pi(PStream * pst, int d);
-void calc_k(PStream * pst, int d);
-void update_P(PStream * pst);
-void update_c(PStream * pst, int d);
-
-#define abs(x)  ((x)>0.0 ? (x) : -(x))
-#define sign(x)  ((x) >= 0.0 ? 1 : -1)
-#define finv(x)  (abs(x) <= INVINF2 ? sign(x)*INFTY : (abs(x) >= INFTY2 ? 0 : 1.0/(x)))
-#define min(x, y) ((x)<(y) ? (x) : (y))
-
-std::vector<double> PySPTK_mlpg(const std::vector<double> &INPUT, int vector_length,
-                                const std::vector<std::vector<double>> &delta_windows,
-                                int input_type, int influence_range) {
-  std::vector<double> parameters;
-
-  PStream pst;
-  pst.order = vector_length - 1;
-  pst.range = influence_range;
-  pst.iType = input_type;
-  pst.dw.num = delta_windows.size() + 1;
-  
-  std::vector<double> constvec(1);
-  constvec.push_back(1.);
-  pst.dw.org.push_back(constvec);
-
-  for (int i = 0; i < delta_windows.size(); i++) {
-    pst.dw.org.push_back(delta_windows[i]);
+#include "python-vocoder-mlpg.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+namespace {
+
+// A window with taps at offsets left..right of the frame it is applied at
+struct MlpgWindow {
+  int32 left, right;
+  std::vector<double> coef;     // coef[j - left] is the tap at offset j
+};
+
+
+void MakeMlpgWindows(const std::vector<std::vector<double> > &delta_windows,
+                     std::vector<MlpgWindow> *windows) {
+  windows->resize(delta_windows.size() + 1);
+  (*windows)[0].left = (*windows)[0].right = 0;
+  (*windows)[0].coef.assign(1, 1.0);
+  for (size_t w = 0; w < delta_windows.size(); w++) {
+    MlpgWindow &win = (*windows)[w + 1];
+    int32 fsize = delta_windows[w].size(), leng = fsize / 2;
+    win.left = -leng;
+    win.right = (fsize % 2 == 0) ? leng - 1 : leng;
+    win.coef = delta_windows[w];
   }
+}
 
-  init_pstream(&pst);
-
-  int nframe = 0;
-  int delay = pst.range + pst.dw.maxw[WRIGHT];
 
-  std::vector<double>::const_iterator INPUT_it = INPUT.begin();
-  int readsz = pst.vSize * 2;
-  
-  while (vreadf(pst.mean, readsz, INPUT, &INPUT_it) == readsz) {
-    if (pst.dw.num == 1) {
-      for (int i = 0; i < pst.order+1; i++) {
-        parameters.push_back(pst.mean[i]);
-      }
-    } else {
-      if (pst.iType == 0) {
-        for (int i = 0; i < pst.vSize; i++)
-          pst.ivar[i] = finv(pst.ivar[i]);
-      }
+// Solves the dimensions thread_id_, thread_id_ + num_threads_, ...
+class MlpgDimensionSolver: public MultiThreadable {
+ public:
+  MlpgDimensionSolver(const MatrixBase<BaseFloat> *means,
+                      const MatrixBase<BaseFloat> *precisions,
+                      const std::vector<MlpgWindow> *windows,
+                      Matrix<BaseFloat> *parameters,
+                      std::vector<char> *failed):
+      means_(means), precisions_(precisions), windows_(windows),
+      parameters_(parameters), failed_(failed) { }
+
+  void operator() () {
+    int32 dim = parameters_->NumCols();
+    for (int32 k = thread_id_; k < dim; k += num_threads_)
+      (*failed_)[k] = !Solve(k);
+  }
 
-      mlpg(&pst);
-      
-      if (nframe >= delay) {
-        for (int i = 0; i < pst.order+1; i++)
-          parameters.push_back(pst.par[i]);
+ private:
+  bool Solve(int32 k);
+
+  const MatrixBase<BaseFloat> *means_;
+  const MatrixBase<BaseFloat> *precisions_;
+  const std::vector<MlpgWindow> *windows_;
+  Matrix<BaseFloat> *parameters_;
+  std::vector<char> *failed_;
+};
+
+
+bool MlpgDimensionSolver::Solve(int32 k) {
+  const std::vector<MlpgWindow> &windows = *windows_;
+  int32 num_frames = means_->NumRows(), dim = parameters_->NumCols(), hbw = 0;
+  for (size_t w = 0; w < windows.size(); w++)
+    hbw = std::max(hbw, windows[w].right - windows[w].left);
+
+  // lower band of W' P W, band[t * (hbw + 1) + i] is element (t, t - i)
+  std::vector<double> band(num_frames * (hbw + 1), 0.0), rhs(num_frames, 0.0);
+  for (int32 t = 0; t < num_frames; t++) {
+    for (size_t w = 0; w < windows.size(); w++) {
+      const MlpgWindow &win = windows[w];
+      if (t + win.left < 0 || t + win.right >= num_frames)
+        continue;
+      double prec = (*precisions_)(t, w * dim + k);
+      if (prec == 0.0)
+        continue;
+      double pmean = prec * (*means_)(t, w * dim + k);
+      for (int32 j1 = win.left; j1 <= win.right; j1++) {
+        double c1 = win.coef[j1 - win.left];
+        if (c1 == 0.0)
+          continue;
+        rhs[t + j1] += c1 * pmean;
+        for (int32 j2 = win.left; j2 <= j1; j2++)
+          band[(t + j1) * (hbw + 1) + (j1 - j2)] +=
+              c1 * win.coef[j2 - win.left] * prec;
       }
     }
-    nframe++;
   }
 
-  
-  if (pst.dw.num > 1) {
-    for (int i = 0; i < pst.vSize; i++) {
-      pst.mean[i] = 0.0;
-      pst.ivar[i] = 0.0;
-    }
-    for (int i = 0; i < min(nframe, delay); i++) {
-      mlpg(&pst);
-      for (int i = 0; i < pst.order+1; i++) {
-        parameters.push_back(pst.par[i]);
+  // banded Cholesky, the factor overwrites the band
+  for (int32 t = 0; t < num_frames; t++) {
+    double *lt = &(band[t * (hbw + 1)]);
+    for (int32 i = std::min(t, hbw); i >= 0; i--) {
+      int32 j = t - i;
+      const double *lj = &(band[j * (hbw + 1)]);
+      double s = lt[i];
+      for (int32 q = std::max(0, t - hbw); q < j; q++)
+        s -= lt[t - q] * lj[j - q];
+      if (i == 0) {
+        if (!(s > 0.0))
+          return false;
+        lt[0] = std::sqrt(s);
+      } else {
+        lt[i] = s / lj[0];
       }
     }
   }
 
-  return parameters;
-}
-
-
-
-
-void init_pstream(PStream * pst)
-{
-   int half, full;
-   int i, m;
-
-   init_dwin(pst);
-
-   half = pst->range * 2;
-   full = pst->range * 4 + 1;
-
-   pst->vSize = (pst->order + 1) * pst->dw.num;
-
-   pst->sm.length = LENGTH;
-   while (pst->sm.length < pst->range + pst->dw.maxw[WRIGHT])
-      pst->sm.length *= 2;
-
-   pst->mean = dcalloc(pst->vSize * 2, 0);
-   pst->ivar = pst->mean + pst->vSize;
-
-   pst->sm.mseq = ddcalloc(pst->sm.length, pst->vSize, 0, 0);
-   pst->sm.ivseq = ddcalloc(pst->sm.length, pst->vSize, 0, 0);
-
-   pst->sm.c = ddcalloc(pst->sm.length, pst->order + 1, 0, 0);
-   pst->sm.P = dddcalloc(full, pst->sm.length, pst->order + 1, half, 0, 0);
-
-   pst->sm.pi =
-       ddcalloc(pst->range + pst->dw.maxw[WRIGHT] + 1, pst->order + 1,
-                pst->range, 0);
-   pst->sm.k =
-       ddcalloc(pst->range + pst->dw.maxw[WRIGHT] + 1, pst->order + 1,
-                pst->range, 0);
-
-   for (i = 0; i < pst->sm.length; i++)
-      for (m = 0; m < pst->vSize; m++)
-         pst->sm.ivseq[i][m] = 0.0;
-
-   for (i = 0; i < pst->sm.length; i++)
-      for (m = 0; m <= pst->order; m++)
-         pst->sm.P[0][i][m] = INFTY;
-
-   pst->sm.t = pst->range - 1;
-   pst->sm.mask = pst->sm.length - 1;
-
-   return;
-}
-
-
-void init_dwin(PStream * pst) {
-  int i;
-  int fsize, leng;
-
-  /* memory allocation */
-  if ((pst->dw.width = (int **) calloc(pst->dw.num, sizeof(int *))) == NULL)
-    throw std::bad_alloc();
-
-  for (i = 0; i < pst->dw.num; i++) {
-    if ((pst->dw.width[i] = (int *) calloc(2, sizeof(int))) == NULL)
-      throw std::bad_alloc();
+  // forward then back substitution
+  for (int32 t = 0; t < num_frames; t++) {
+    const double *lt = &(band[t * (hbw + 1)]);
+    double s = rhs[t];
+    for (int32 q = std::max(0, t - hbw); q < t; q++)
+      s -= lt[t - q] * rhs[q];
+    rhs[t] = s / lt[0];
   }
-
-  if ((pst->dw.coef = (double **) calloc(pst->dw.num, sizeof(double *))) == NULL) {
-      throw std::bad_alloc();
+  for (int32 t = num_frames - 1; t >= 0; t--) {
+    double s = rhs[t];
+    for (int32 r = t + 1; r <= std::min(num_frames - 1, t + hbw); r++)
+      s -= band[r * (hbw + 1) + (r - t)] * rhs[r];
+    rhs[t] = s / band[t * (hbw + 1)];
+    (*parameters_)(t, k) = rhs[t];
   }
+  return true;
+}
 
-  /* window for static parameter */
-  pst->dw.width[0][WLEFT] = pst->dw.width[0][WRIGHT] = 0;
-  pst->dw.coef[0] = dcalloc(1, 0);
-  pst->dw.coef[0][0] = 1;
-
-  /* set delta coefficients */
-  for (i = 1; i < pst->dw.num; i++) {
-    fsize = pst->dw.org[i].size();
-    pst->dw.coef[i] = dcalloc(fsize, 0);
-    for (int j = 0; j < fsize; j++)
-      pst->dw.coef[i][j] = pst->dw.org[i][j];
-
-    /* set pointer */
-    leng = fsize / 2;
-    pst->dw.coef[i] += leng;
-    pst->dw.width[i][WLEFT] = -leng;
-    pst->dw.width[i][WRIGHT] = leng;
-    if (fsize % 2 == 0)
-      pst->dw.width[i][WRIGHT]--;
+}  // namespace
+
+
+bool MlpgSolve(const MatrixBase<BaseFloat> &means,
+               const MatrixBase<BaseFloat> &precisions,
+               const std::vector<std::vector<double> > &delta_windows,
+               Matrix<BaseFloat> *parameters, int32 num_threads) {
+  int32 num_windows = delta_windows.size() + 1;
+  KALDI_ASSERT(means.NumRows() == precisions.NumRows() &&
+               means.NumCols() == precisions.NumCols());
+  KALDI_ASSERT(means.NumCols() % num_windows == 0);
+  int32 dim = means.NumCols() / num_windows;
+  num_threads = std::max(1, std::min(num_threads, dim));
+
+  std::vector<MlpgWindow> windows;
+  MakeMlpgWindows(delta_windows, &windows);
+  parameters->Resize(means.NumRows(), dim);
+  std::vector<char> failed(dim, 0);
+  MlpgDimensionSolver solver(&means, &precisions, &windows, parameters,
+                             &failed);
+  {
+    // num_threads 0 runs in this thread
+    MultiThreader<MlpgDimensionSolver> m(num_threads > 1 ? num_threads : 0,
+                                         solver);
   }
-
-  pst->dw.maxw[WLEFT] = pst->dw.maxw[WRIGHT] = 0;
-  for (i = 0; i < pst->dw.num; i++) {
-    if (pst->dw.maxw[WLEFT] > pst->dw.width[i][WLEFT])
-      pst->dw.maxw[WLEFT] = pst->dw.width[i][WLEFT];
-    if (pst->dw.maxw[WRIGHT] < pst->dw.width[i][WRIGHT])
-      pst->dw.maxw[WRIGHT] = pst->dw.width[i][WRIGHT];
+  for (int32 k = 0; k < dim; k++) {
+    if (failed[k]) {
+      KALDI_WARN << "MLPG system for dimension " << k
+                 << " is not positive definite";
+      return false;
+    }
   }
-
-  return;
-}
-
-
-
-double *dcalloc(int x, int xoff) {
-  double *ptr;
-  if ((ptr = (double *) calloc(x, sizeof(*ptr))) == NULL)
-    throw std::bad_alloc();
-  ptr += xoff;
-  return (ptr);
-}
-
-
-double **ddcalloc(int x, int y, int xoff, int yoff) {
-  double **ptr;
-
-  if ((ptr = (double **) calloc(x, sizeof(*ptr))) == NULL)
-    throw std::bad_alloc();
-  for (int i = 0; i < x; i++)
-    ptr[i] = dcalloc(y, yoff);
-  ptr += xoff;
-  return (ptr);
-}
-
-
-double ***dddcalloc(int x, int y, int z, int xoff, int yoff, int zoff) {
-  double ***ptr;
-  if ((ptr = (double ***) calloc(x, sizeof(*ptr))) == NULL)
-    throw std::bad_alloc();
-  for (int i = 0; i < x; i++)
-    ptr[i] = ddcalloc(y, z, yoff, zoff);
-  ptr += xoff;
-  return (ptr);
-}
-
-/*--------------------------------------------------------------------*/
-
-double *mlpg(PStream * pst)
-{
-   int tmin, tmax;
-   int d, m, u;
-
-   pst->sm.t++;
-   tmin = (pst->sm.t - pst->range) & pst->sm.mask;
-   tmax = (pst->sm.t + pst->dw.maxw[WRIGHT]) & pst->sm.mask;
-
-   for (u = -pst->range * 2; u <= pst->range * 2; u++) {
-      for (m = 0; m <= pst->order; m++)
-         pst->sm.P[u][tmax][m] = 0.0;
-   }
-   for (m = 0; m < pst->vSize; m++) {
-      pst->sm.mseq[tmax][m] = pst->mean[m];
-      pst->sm.ivseq[tmax][m] = pst->ivar[m];
-   }
-   for (m = 0; m <= pst->order; m++) {
-      if (pst->iType != 2)
-         pst->sm.c[tmax][m] = pst->mean[m];
-      else
-         pst->sm.c[tmax][m] = pst->mean[m] * finv(pst->ivar[m]);
-      pst->sm.P[0][tmax][m] = finv(pst->ivar[m]);
-   }
-
-   for (d = 1; d < pst->dw.num; d++) {
-      if (doupdate(pst, d)) {
-         calc_pi(pst, d);
-         calc_k(pst, d);
-         update_P(pst);
-         update_c(pst, d);
-      }
-   }
-   pst->par = pst->sm.c[tmin];
-   return (pst->par);
-}
-
-
-int doupdate(PStream * pst, int d)
-{
-   int j;
-
-   if (pst->sm.ivseq[pst->sm.t & pst->sm.mask][(pst->order + 1) * d] == 0.0)
-      return (0);
-   for (j = pst->dw.width[d][WLEFT]; j <= pst->dw.width[d][WRIGHT]; j++)
-      if (pst->sm.P[0][(pst->sm.t + j) & pst->sm.mask][0] == INFTY)
-         return (0);
-   return (1);
+  return true;
 }
 
+}  // namespace kaldi
 
-void calc_pi(PStream * pst, int d)
-{
-   int j, m, u;
 
-   for (m = 0; m <= pst->order; m++)
-      for (u = -pst->range; u <= pst->dw.maxw[WRIGHT]; u++) {
-         pst->sm.pi[u][m] = 0.0;
-         for (j = pst->dw.width[d][WLEFT]; j <= pst->dw.width[d][WRIGHT]; j++)
-            pst->sm.pi[u][m] +=
-                pst->sm.P[u -
-                          j][(pst->sm.t +
-                              j) & pst->sm.mask][m] * pst->dw.coef[d][j];
-      }
-
-   return;
+// Same meaning as SPTK, precisions of zero are infinite variance
+static double mlpg_finv(double x) {
+  const double INFTY = 1.0e+38, INFTY2 = 1.0e+19, INVINF2 = 1.0e-19;
+  if (std::fabs(x) <= INVINF2)
+    return (x >= 0.0) ? INFTY : -INFTY;
+  if (std::fabs(x) >= INFTY2)
+    return 0.0;
+  return 1.0 / x;
 }
 
 
-void calc_k(PStream * pst, int d)
-{
-   int j, m, u;
-   double *ivar, x;
+std::vector<double> PySPTK_mlpg(const std::vector<double> &INPUT, int vector_length,
+                                const std::vector<std::vector<double>> &delta_windows,
+                                int input_type, int influence_range) {
+  std::vector<double> parameters;
+  if (vector_length <= 0) {
+    fprintf(stderr, "ERROR: vector length must be positive\n");
+    return parameters;
+  }
+  int num_windows = delta_windows.size() + 1;
+  int vsize = vector_length * num_windows;
+  int nframe = INPUT.size() / (vsize * 2);
+
+  if (num_windows == 1) {
+    for (int t = 0; t < nframe; t++)
+      parameters.insert(parameters.end(), INPUT.begin() + t * vsize * 2,
+                        INPUT.begin() + t * vsize * 2 + vector_length);
+    return parameters;
+  }
 
-   ivar = pst->sm.ivseq[pst->sm.t & pst->sm.mask] + (pst->order + 1) * d;
-   for (m = 0; m <= pst->order; m++) {
-      x = 0.0;
-      for (j = pst->dw.width[d][WLEFT]; j <= pst->dw.width[d][WRIGHT]; j++)
-         x += pst->dw.coef[d][j] * pst->sm.pi[j][m];
-      x = ivar[m] / (1.0 + ivar[m] * x);
-      for (u = -pst->range; u <= pst->dw.maxw[WRIGHT]; u++) {
-         pst->sm.k[u][m] = pst->sm.pi[u][m] * x;
-      }
-   }
+  kaldi::Matrix<kaldi::BaseFloat> means(nframe, vsize), precisions(nframe, vsize);
+  for (int t = 0; t < nframe; t++) {
+    const double *mean = &(INPUT[t * vsize * 2]), *ivar = mean + vsize;
+    for (int i = 0; i < vsize; i++) {
+      double p = (input_type == 0) ? mlpg_finv(ivar[i]) : ivar[i];
+      means(t, i) = (input_type == 2) ? mean[i] * mlpg_finv(p) : mean[i];
+      precisions(t, i) = p;
+    }
+  }
 
-   return;
+  kaldi::Matrix<kaldi::BaseFloat> params;
+  if (!kaldi::MlpgSolve(means, precisions, delta_windows, &params,
+                        kaldi::g_num_threads)) {
+    fprintf(stderr, "ERROR: MLPG failed, check the variances\n");
+    return parameters;
+  }
+  parameters.reserve(nframe * vector_length);
+  for (int t = 0; t < nframe; t++)
+    for (int i = 0; i < vector_length; i++)
+      parameters.push_back(params(t, i));
+  return parameters;
 }
 
 
-void update_P(PStream * pst)
-{
-   int m, u, v;
-
-   for (m = 0; m <= pst->order; m++)
-      for (u = -pst->range; u <= pst->dw.maxw[WRIGHT]; u++)
-         for (v = u; v <= pst->dw.maxw[WRIGHT]; v++) {
-            pst->sm.P[v - u][(pst->sm.t + u) & pst->sm.mask][m] -=
-                pst->sm.k[v][m] * pst->sm.pi[u][m];
-            if (v != u)
-               pst->sm.P[u - v][(pst->sm.t + v) & pst->sm.mask][m] =
-                   pst->sm.P[v - u][(pst->sm.t + u) & pst->sm.mask][m];
-         }
-
-   return;
-}
+kaldi::Matrix<kaldi::BaseFloat> * PyVocoder_mlpg_matrix(const kaldi::MatrixBase<kaldi::BaseFloat> &INPUT,
+                                                        int offset, int dim, int stride,
+                                                        const std::vector<double> &VARIANCES,
+                                                        const std::vector<std::vector<double>> &delta_windows,
+                                                        bool fix_ends) {
+  int num_windows = delta_windows.size() + 1;
+  int nframe = INPUT.NumRows();
+  if (dim <= 0 || nframe == 0 || offset < 0 || stride < dim ||
+      offset + (num_windows - 1) * stride + dim > INPUT.NumCols()) {
+    fprintf(stderr, "ERROR: MLPG streams do not fit in the input\n");
+    return NULL;
+  }
+  if (static_cast<int>(VARIANCES.size()) != num_windows * dim) {
+    fprintf(stderr, "ERROR: expected %d MLPG variances\n", num_windows * dim);
+    return NULL;
+  }
 
+  if (num_windows == 1)
+    return new kaldi::Matrix<kaldi::BaseFloat>(
+        INPUT.Range(0, nframe, offset, dim));
+
+  // The column blocks are copied straight into the layout MlpgSolve wants,
+  // and the precisions are one row repeated (the ends pinned if asked).
+  int vsize = num_windows * dim;
+  kaldi::Matrix<kaldi::BaseFloat> means(nframe, vsize, kaldi::kUndefined),
+      precisions(nframe, vsize, kaldi::kUndefined);
+  for (int w = 0; w < num_windows; w++)
+    means.ColRange(w * dim, dim).CopyFromMat(
+        INPUT.ColRange(offset + w * stride, dim));
+  kaldi::Vector<kaldi::BaseFloat> precision(vsize);
+  for (int i = 0; i < vsize; i++)
+    precision(i) = mlpg_finv(VARIANCES[i]);
+  precisions.CopyRowsFromVec(precision);
+  if (fix_ends) {
+    precisions.Row(0).Set(mlpg_finv(0.0));
+    precisions.Row(nframe - 1).Set(mlpg_finv(0.0));
+  }
 
-void update_c(PStream * pst, int d)
-{
-   int j, m, u;
-   double *mean, *ivar, x;
-
-   ivar = pst->sm.ivseq[pst->sm.t & pst->sm.mask] + (pst->order + 1) * d;
-   mean = pst->sm.mseq[pst->sm.t & pst->sm.mask] + (pst->order + 1) * d;
-   for (m = 0; m <= pst->order; m++) {
-      x = mean[m];
-      if (pst->iType == 2)
-         x *= finv(ivar[m]);
-      for (j = pst->dw.width[d][WLEFT]; j <= pst->dw.width[d][WRIGHT]; j++)
-         x -= pst->dw.coef[d][j] * pst->sm.c[(pst->sm.t + j) & pst->sm.mask][m];
-      for (u = -pst->range; u <= pst->dw.maxw[WRIGHT]; u++)
-         pst->sm.c[(pst->sm.t + u) & pst->sm.mask][m] += pst->sm.k[u][m] * x;
-   }
-
-   return;
+  kaldi::Matrix<kaldi::BaseFloat> *params = new kaldi::Matrix<kaldi::BaseFloat>;
+  if (!kaldi::MlpgSolve(means, precisions, delta_windows, params,
+                        kaldi::g_num_threads)) {
+    fprintf(stderr, "ERROR: MLPG failed, check the variances\n");
+    delete params;
+    return NULL;
+  }
+  return params;
 }
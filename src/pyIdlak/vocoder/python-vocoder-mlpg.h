@@ -0,0 +1,57 @@
+// pyIdlak/vocoder/python-vocoder-mlpg.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Maximum likelihood parameter generation, not exposed to python.
+//
+// For each feature dimension the static parameters c maximise the likelihood
+// of the stacked static and delta observations, i.e. solve
+//   (W' P W) c = W' P mu
+// where W applies the delta windows, P holds the precisions and mu the means.
+// W' P W is banded with half bandwidth equal to the span of the windows, so
+// it is factorised with a banded Cholesky over the whole utterance in O(T).
+
+#ifndef KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_MLPG_H_
+#define KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_MLPG_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// Generates the static parameter trajectories.
+///
+/// means and precisions are num_frames x (dim * (delta_windows.size() + 1)),
+/// laid out as the static block followed by one block per delta window. A
+/// precision of zero removes that observation. Delta windows are centred in
+/// the same way as SPTK (an even length window has one more tap on the left)
+/// and a window is only applied at frames where it lies inside the utterance.
+///
+/// The dimensions are solved independently using up to num_threads threads.
+/// Returns false if the system for some dimension is not positive definite.
+bool MlpgSolve(const MatrixBase<BaseFloat> &means,
+               const MatrixBase<BaseFloat> &precisions,
+               const std::vector<std::vector<double> > &delta_windows,
+               Matrix<BaseFloat> *parameters, int32 num_threads = 1);
+
+}  // namespace kaldi
+
+#endif  // KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_MLPG_H_
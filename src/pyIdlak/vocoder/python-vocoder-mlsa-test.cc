@@ -0,0 +1,114 @@
+// pyIdlak/vocoder/python-vocoder-mlsa-test.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Checks the MLSA kernel against SPTK's mlsadf and reports the speed of both.
+
+#include <cmath>
+#include <vector>
+
+#include "SPTK.h"
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "python-vocoder-mlsa.h"
+
+namespace kaldi {
+
+static void RandomFilter(int order, std::vector<double> *b) {
+  b->resize(order + 1);
+  for (int i = 0; i <= order; i++)
+    (*b)[i] = 0.5 * RandGauss() / (i + 1);
+}
+
+static void RandomExcitation(int num_samples, std::vector<double> *x) {
+  x->resize(num_samples);
+  for (int n = 0; n < num_samples; n++)
+    (*x)[n] = ((n % 80) == 0 ? 10.0 : 0.0) + 0.1 * RandGauss();
+}
+
+static void UnitTestMlsaFilter() {
+  for (int pd = 4; pd <= 5; pd++) {
+    for (int iter = 0; iter < 5; iter++) {
+      int order = 1 + Rand() % 60, num_samples = 4000;
+      double alpha = 0.3 + 0.2 * RandUniform();
+      std::vector<double> b, x, d(3 * (pd + 1) + pd * (order + 2), 0.0);
+      RandomFilter(order, &b);
+      RandomExcitation(num_samples, &x);
+      std::vector<float> bf(b.begin(), b.end());
+
+      MlsaFilter<double> filter(order, alpha, pd);
+      MlsaFilter<float> filter_float(order, alpha, pd);
+      double max_ref = 0.0, max_diff = 0.0, max_diff_float = 0.0;
+      for (int n = 0; n < num_samples; n++) {
+        double ref = mlsadf(x[n], b.data(), order, alpha, pd, d.data());
+        double y = filter.Filter(x[n], b.data());
+        float yf = filter_float.Filter(static_cast<float>(x[n]), bf.data());
+        max_ref = std::max(max_ref, std::fabs(ref));
+        max_diff = std::max(max_diff, std::fabs(ref - y));
+        max_diff_float = std::max(max_diff_float, std::fabs(ref - yf));
+      }
+      KALDI_ASSERT(max_diff <= 1.0e-10 * (1.0 + max_ref));
+      KALDI_ASSERT(max_diff_float <= 1.0e-3 * (1.0 + max_ref));
+
+      // reset must give the same output as a new filter
+      filter.Reset();
+      std::fill(d.begin(), d.end(), 0.0);
+      for (int n = 0; n < 100; n++)
+        KALDI_ASSERT(filter.Filter(x[n], b.data()) ==
+                     mlsadf(x[n], b.data(), order, alpha, pd, d.data()));
+    }
+  }
+}
+
+template<typename Real>
+static double MlsaKernelSpeed(int order, int pd, const std::vector<double> &b,
+                              const std::vector<double> &x) {
+  std::vector<Real> br(b.begin(), b.end()), xr(x.begin(), x.end());
+  MlsaFilter<Real> filter(order, 0.42, pd);
+  Timer t;
+  filter.Filter(xr.data(), xr.size(), br.data());
+  return t.Elapsed();
+}
+
+static void MlsaSpeedTest() {
+  int order = 60, pd = 5, num_samples = 48000 * 10;
+  std::vector<double> b, x, d(3 * (pd + 1) + pd * (order + 2), 0.0);
+  RandomFilter(order, &b);
+  RandomExcitation(num_samples, &x);
+
+  Timer t;
+  for (int n = 0; n < num_samples; n++)
+    x[n] = mlsadf(x[n], b.data(), order, 0.42, pd, d.data());
+  double sptk = t.Elapsed();
+  RandomExcitation(num_samples, &x);
+  double kernel_double = MlsaKernelSpeed<double>(order, pd, b, x);
+  double kernel_float = MlsaKernelSpeed<float>(order, pd, b, x);
+  KALDI_LOG << "MLSA order " << order << ", 10s at 48kHz: SPTK " << sptk
+            << "s, kernel<double> " << kernel_double << "s, kernel<float> "
+            << kernel_float << "s";
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestMlsaFilter();
+  kaldi::MlsaSpeedTest();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,199 @@
+// pyIdlak/vocoder/python-vocoder-mlsa.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// MLSA filter kernel, not exposed to python.
+//
+// This computes the same recursion as SPTK's mlsadf but lays the state out so
+// the compiler can vectorise it. The Pade stages of the second (FIR) part of
+// the filter only depend on the previous sample's stage outputs, so they are
+// independent within a sample and are run side by side: the delay line is
+// stored tap major with one lane per stage, and the m taps are walked once
+// per sample updating all stages together. The shift of the delay line that
+// SPTK does in a second pass is folded into the tap loop.  The filter is
+// compiled for the instruction sets of base/cpu-dispatch.h and runs the
+// version for the CPU.
+
+#ifndef KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_MLSA_H_
+#define KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_MLSA_H_
+
+#include <vector>
+
+#include "base/cpu-dispatch.h"
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+template<typename Real>
+class MlsaFilter {
+ public:
+  /// Lanes for the Pade stages, the maximum supported Pade order is 5 and the
+  /// lanes are padded so that each tap is a whole number of SIMD registers.
+  static const int kLanes = 8;
+
+  /// order is the order of the mel-cepstrum (m), alpha the all pass constant
+  /// and pade_order must be 4 or 5.
+  MlsaFilter(int order, Real alpha, int pade_order);
+
+  /// Filters one sample with the filter coefficients b (order + 1 values,
+  /// as produced by mc2b). Same as SPTK mlsadf(x, b, m, a, pd, d).
+  Real Filter(Real x, const Real *b) {
+    return CpuDispatch<SampleKernel>(this, x, b);
+  }
+
+  /// Filters num_samples samples in place with fixed coefficients b.
+  void Filter(Real *x, int num_samples, const Real *b) {
+    CpuDispatch<BlockKernel>(this, x, num_samples, b);
+  }
+
+  /// Clears the delay lines.
+  void Reset();
+
+  int Order() const { return order_; }
+  int PadeOrder() const { return pade_order_; }
+
+ private:
+  // The kernels for CpuDispatch().
+  template<CpuIsa isa> struct SampleKernel {
+    static KALDI_CPU_INLINE Real Run(MlsaFilter *filter, Real x,
+                                     const Real *b) {
+      return filter->FilterSample(x, b);
+    }
+  };
+  template<CpuIsa isa> struct BlockKernel {
+    static KALDI_CPU_INLINE void Run(MlsaFilter *filter, Real *x,
+                                     int num_samples, const Real *b) {
+      for (int n = 0; n < num_samples; n++)
+        x[n] = filter->FilterSample(x[n], b);
+    }
+  };
+
+  KALDI_CPU_INLINE Real FilterSample(Real x, const Real *b);
+
+  int order_;
+  int pade_order_;
+  Real alpha_;
+  Real aa_;                       // 1 - alpha^2
+  Real pade_[kLanes];             // Pade coefficients, index 0 unused
+  // first part of the filter (the b(1) term), pade_order + 1 values each
+  std::vector<Real> d1_, pt1_;
+  // second part, (order + 2) taps x kLanes stages, tap major
+  Real *d2_;
+  std::vector<Real> d2_storage_;
+  Real pt2_[kLanes + 1];          // stage outputs from the previous sample
+  Real in_[kLanes];               // stage inputs
+  Real y_[kLanes];                // stage outputs
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MlsaFilter);
+};
+
+
+template<typename Real>
+MlsaFilter<Real>::MlsaFilter(int order, Real alpha, int pade_order):
+    order_(order), pade_order_(pade_order), alpha_(alpha),
+    aa_(1 - alpha * alpha), d2_(NULL) {
+  // Pade approximation coefficients of exp, same values as SPTK
+  static const double pade4[] = { 1.0, 0.4999273, 0.1067005, 0.01170221,
+                                  0.0005656279 };
+  static const double pade5[] = { 1.0, 0.4999391, 0.1107098, 0.01369984,
+                                  0.0009564853, 0.00003041721 };
+  KALDI_ASSERT(order >= 1);
+  KALDI_ASSERT(pade_order == 4 || pade_order == 5);
+  const double *pade = (pade_order == 4) ? pade4 : pade5;
+  for (int i = 0; i < kLanes; i++)
+    pade_[i] = (i <= pade_order) ? static_cast<Real>(pade[i]) : 0;
+  d1_.resize(pade_order + 1);
+  pt1_.resize(pade_order + 1);
+  // over allocate so the delay line can start on a 32 byte boundary
+  int align = 32 / sizeof(Real);
+  d2_storage_.resize((order + 2) * kLanes + align);
+  size_t addr = reinterpret_cast<size_t>(d2_storage_.data());
+  d2_ = d2_storage_.data() + ((32 - addr % 32) % 32) / sizeof(Real);
+  Reset();
+}
+
+
+template<typename Real>
+void MlsaFilter<Real>::Reset() {
+  std::fill(d1_.begin(), d1_.end(), Real(0));
+  std::fill(pt1_.begin(), pt1_.end(), Real(0));
+  std::fill(d2_, d2_ + (order_ + 2) * kLanes, Real(0));
+  for (int s = 0; s <= kLanes; s++)
+    pt2_[s] = 0;
+}
+
+
+template<typename Real>
+KALDI_CPU_INLINE Real MlsaFilter<Real>::FilterSample(Real x, const Real *b) {
+  const int pd = pade_order_, m = order_;
+  const Real a = alpha_, aa = aa_;
+
+  // first part, single tap b(1) filtered through the Pade stages
+  Real out = 0;
+  for (int i = pd; i >= 1; i--) {
+    d1_[i] = aa * pt1_[i - 1] + a * d1_[i];
+    pt1_[i] = d1_[i] * b[1];
+    Real v = pt1_[i] * pade_[i];
+    x += (1 & i) ? v : -v;
+    out += v;
+  }
+  pt1_[0] = x;
+  x = out + x;
+
+  // second part, stage s filters the previous output of stage s - 1
+  for (int s = 0; s < kLanes; s++) {
+    in_[s] = (s < pd) ? pt2_[s] : 0;
+    y_[s] = 0;
+  }
+  Real *d0 = d2_, *d1 = d2_ + kLanes;
+  Real prev[kLanes];
+  for (int s = 0; s < kLanes; s++) {
+    d0[s] = in_[s];
+    d1[s] = aa * in_[s] + a * d1[s];
+    prev[s] = d1[s];
+  }
+  for (int i = 2; i <= m; i++) {
+    Real *di = d2_ + i * kLanes;
+    const Real *dnext = di + kLanes;
+    const Real bi = b[i];
+    for (int s = 0; s < kLanes; s++) {
+      Real ni = di[s] + a * (dnext[s] - prev[s]);
+      y_[s] += ni * bi;
+      di[s] = prev[s];    // shifted delay for the next sample
+      prev[s] = ni;
+    }
+  }
+  Real *dlast = d2_ + (m + 1) * kLanes;
+  for (int s = 0; s < kLanes; s++)
+    dlast[s] = prev[s];
+
+  out = 0;
+  for (int i = pd; i >= 1; i--) {
+    pt2_[i] = y_[i - 1];
+    Real v = pt2_[i] * pade_[i];
+    x += (1 & i) ? v : -v;
+    out += v;
+  }
+  pt2_[0] = x;
+  return out + x;
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_MLSA_H_
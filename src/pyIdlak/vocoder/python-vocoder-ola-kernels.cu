@@ -0,0 +1,46 @@
+// pyIdlak/vocoder/python-vocoder-ola-kernels.cu
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// The CUDA kernel of the overlap-add synthesis (python-vocoder-ola.cc), plus
+// its ANSI-C wrapper
+
+#include <cufft.h>
+
+// Multiplies each bin of the excitation spectra by exp of the log filter
+// spectrum (the FFT of the cepstrum) and by scale.
+__global__
+static void _ola_apply_filter(cufftDoubleComplex *spectra,
+                              const cufftDoubleComplex *log_filters,
+                              int n, double scale) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n) {
+    double a = exp(log_filters[i].x) * scale, s, c;
+    sincos(log_filters[i].y, &s, &c);
+    double er = spectra[i].x, ei = spectra[i].y;
+    spectra[i].x = a * (er * c - ei * s);
+    spectra[i].y = a * (er * s + ei * c);
+  }
+}
+
+extern "C" void cuda_ola_apply_filter(int Gr, int Bl,
+                                      cufftDoubleComplex *spectra,
+                                      const cufftDoubleComplex *log_filters,
+                                      int n, double scale) {
+  _ola_apply_filter<<<Gr, Bl>>>(spectra, log_filters, n, scale);
+}
@@ -0,0 +1,226 @@
+// pyIdlak/vocoder/python-vocoder-ola-test.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares the overlap-add synthesis with the MLSA filter and reports the
+// speed of both.
+
+#include <cmath>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "python-vocoder-mlsa.h"
+#include "python-vocoder-ola.h"
+
+namespace kaldi {
+
+static void RandomMcep(int order, std::vector<double> *mcep) {
+  mcep->resize(order + 1);
+  (*mcep)[0] = RandGauss();
+  for (int i = 1; i <= order; i++)
+    (*mcep)[i] = 0.5 * RandGauss() / (i + 1);
+}
+
+static void RandomExcitation(int num_samples, int pitch_period,
+                             std::vector<double> *x) {
+  x->resize(num_samples);
+  for (int n = 0; n < num_samples; n++)
+    (*x)[n] = ((n % pitch_period) == 0 ? 10.0 : 0.0) + 0.1 * RandGauss();
+}
+
+// mc2b as in SPTK
+static void Mc2b(const double *mc, int order, double alpha, double *b) {
+  b[order] = mc[order];
+  for (int i = order - 1; i >= 0; i--)
+    b[i] = mc[i] - alpha * b[i + 1];
+}
+
+// The reference: the MLSA filter with the coefficients interpolated from
+// frame to frame at every sample, as PySPTK_mlsadf with an interpolation
+// period of 1.
+static void MlsaSynthesize(const std::vector<double> &mceps, int order,
+                           double alpha, int frame_period,
+                           const std::vector<double> &excitation,
+                           std::vector<double> *waveform) {
+  int num_frames = mceps.size() / (order + 1);
+  MlsaFilter<double> filter(order, alpha, 5);
+  std::vector<double> b(order + 1), bb(order + 1), c(order + 1);
+  waveform->clear();
+  for (int t = 0; t + 1 < num_frames; t++) {
+    Mc2b(&mceps[t * (order + 1)], order, alpha, b.data());
+    Mc2b(&mceps[(t + 1) * (order + 1)], order, alpha, bb.data());
+    for (int n = 0; n < frame_period; n++) {
+      size_t i = static_cast<size_t>(t) * frame_period + n;
+      if (i >= excitation.size())
+        return;
+      for (int j = 0; j <= order; j++)
+        c[j] = b[j] + (bb[j] - b[j]) * n / frame_period;
+      waveform->push_back(filter.Filter(excitation[i] * exp(c[0]), c.data()));
+    }
+  }
+}
+
+// Signal to error ratio in dB.
+static double Snr(const std::vector<double> &ref,
+                  const std::vector<double> &x) {
+  KALDI_ASSERT(ref.size() == x.size());
+  double signal = 0.0, error = 0.0;
+  for (size_t n = 0; n < ref.size(); n++) {
+    signal += ref[n] * ref[n];
+    error += (ref[n] - x[n]) * (ref[n] - x[n]);
+  }
+  return 10.0 * log10(signal / std::max(error, 1.0e-300));
+}
+
+// A fixed filter is linear time invariant for both, so they only differ by
+// the Pade approximation and the wrapped impulse response.
+static void UnitTestOlaFixedFilter() {
+  for (int iter = 0; iter < 5; iter++) {
+    int order = 10 + Rand() % 40, fprd = 80, frames = 100;
+    double alpha = 0.3 + 0.2 * RandUniform();
+    std::vector<double> mcep, mceps, excitation, ref, ola;
+    RandomMcep(order, &mcep);
+    for (int t = 0; t < frames; t++)
+      mceps.insert(mceps.end(), mcep.begin(), mcep.end());
+    RandomExcitation(fprd * frames, 100 + Rand() % 60, &excitation);
+
+    MlsaSynthesize(mceps, order, alpha, fprd, excitation, &ref);
+    OlaSynthesizer synth(order, alpha, fprd, 1024);
+    synth.Synthesize(mceps, excitation, 1, false, &ola);
+    KALDI_ASSERT(ola.size() == (frames - 1) * fprd && ref.size() == ola.size());
+    double snr = Snr(ref, ola);
+    KALDI_LOG << "Fixed filter of order " << order << ": SNR " << snr << "dB";
+    KALDI_ASSERT(snr > 40.0);
+  }
+}
+
+// A filter moving between two spectra: MLSA interpolates the coefficients
+// linearly, overlap-add crossfades the outputs, so they agree less closely.
+static void UnitTestOlaMovingFilter() {
+  int order = 24, fprd = 80, frames = 200;
+  double alpha = 0.42;
+  std::vector<double> from, to, mceps, excitation, ref, ola;
+  RandomMcep(order, &from);
+  RandomMcep(order, &to);
+  for (int t = 0; t < frames; t++) {
+    double w = 0.5 - 0.5 * cos(2.0 * M_PI * t / frames);
+    for (int i = 0; i <= order; i++)
+      mceps.push_back(from[i] + w * (to[i] - from[i]));
+  }
+  RandomExcitation(fprd * frames, 120, &excitation);
+  MlsaSynthesize(mceps, order, alpha, fprd, excitation, &ref);
+  OlaSynthesizer synth(order, alpha, fprd, 1024);
+  synth.Synthesize(mceps, excitation, 1, false, &ola);
+  double snr = Snr(ref, ola);
+  KALDI_LOG << "Moving filter: SNR " << snr << "dB";
+  KALDI_ASSERT(snr > 20.0);
+}
+
+// The options, threads and short excitation.
+static void UnitTestOlaOptions() {
+  int order = 30, fprd = 120, frames = 700;
+  double alpha = 0.5;
+  std::vector<double> mceps, bs, excitation, base, x;
+  for (int t = 0; t < frames; t++) {
+    std::vector<double> mcep, b(order + 1);
+    RandomMcep(order, &mcep);
+    Mc2b(mcep.data(), order, alpha, b.data());
+    mceps.insert(mceps.end(), mcep.begin(), mcep.end());
+    bs.insert(bs.end(), b.begin(), b.end());
+  }
+  RandomExcitation(fprd * frames, 200, &excitation);
+  OlaSynthesizer synth(order, alpha, fprd, 2048);
+  synth.Synthesize(mceps, excitation, 1, false, &base);
+
+  // more threads (and batches) give the same waveform
+  synth.Synthesize(mceps, excitation, 4, false, &x);
+  KALDI_ASSERT(x == base);
+
+  OlaSynthesizer bsynth(order, alpha, fprd, 2048, true);
+  bsynth.Synthesize(bs, excitation, 1, false, &x);
+  KALDI_ASSERT(Snr(base, x) > 150.0);
+
+  // without the gain, a fixed filter's output is divided by exp(b(0))
+  std::vector<double> fixed;
+  for (int t = 0; t < 10; t++)
+    fixed.insert(fixed.end(), mceps.begin(), mceps.begin() + order + 1);
+  OlaSynthesizer nsynth(order, alpha, fprd, 2048, false, true);
+  synth.Synthesize(fixed, excitation, 1, false, &base);
+  nsynth.Synthesize(fixed, excitation, 1, false, &x);
+  double gain = exp(bs[0]);
+  for (size_t n = 0; n < x.size(); n++)
+    KALDI_ASSERT(ApproxEqual(x[n] * gain + 1.0, base[n] + 1.0, 1.0e-9));
+
+  // the excitation runs out
+  std::vector<double> short_excitation(excitation.begin(),
+                                       excitation.begin() + 1000);
+  synth.Synthesize(mceps, short_excitation, 1, false, &x);
+  KALDI_ASSERT(x.size() == 1000);
+  std::vector<double> one_frame(mceps.begin(), mceps.begin() + order + 1);
+  synth.Synthesize(one_frame, excitation, 1, false, &x);
+  KALDI_ASSERT(x.empty());
+
+  if (OlaSynthesizer::GpuAvailable()) {
+    synth.Synthesize(mceps, excitation, 1, false, &base);
+    synth.Synthesize(mceps, excitation, 1, true, &x);
+    KALDI_ASSERT(x.size() == base.size() && Snr(base, x) > 150.0);
+  }
+}
+
+static void OlaSpeedTest() {
+  int order = 60, fprd = 240, srate = 48000, frames = 10 * srate / fprd;
+  double alpha = 0.55;
+  std::vector<double> mceps, excitation, x;
+  for (int t = 0; t < frames; t++) {
+    std::vector<double> mcep;
+    RandomMcep(order, &mcep);
+    mceps.insert(mceps.end(), mcep.begin(), mcep.end());
+  }
+  RandomExcitation(fprd * frames, 200, &excitation);
+
+  Timer t;
+  MlsaSynthesize(mceps, order, alpha, fprd, excitation, &x);
+  double mlsa = t.Elapsed();
+  OlaSynthesizer synth(order, alpha, fprd, 4096);
+  t.Reset();
+  synth.Synthesize(mceps, excitation, 1, false, &x);
+  double ola = t.Elapsed();
+  t.Reset();
+  synth.Synthesize(mceps, excitation, 0, false, &x);
+  double ola_threads = t.Elapsed();
+  KALDI_LOG << "Order " << order << ", 10s at 48kHz: MLSA " << mlsa
+            << "s, overlap-add " << ola << "s, on all cores " << ola_threads
+            << "s";
+  if (OlaSynthesizer::GpuAvailable()) {
+    t.Reset();
+    synth.Synthesize(mceps, excitation, 1, true, &x);
+    KALDI_LOG << "Overlap-add with cuFFT " << t.Elapsed() << "s";
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestOlaFixedFilter();
+  kaldi::UnitTestOlaMovingFilter();
+  kaldi::UnitTestOlaOptions();
+  kaldi::OlaSpeedTest();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,415 @@
+// pyIdlak/vocoder/python-vocoder-ola.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <thread>
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#include <cufft.h>
+#endif
+
+#include "python-vocoder-ola.h"
+
+#if HAVE_CUDA == 1
+// in python-vocoder-ola-kernels.cu
+extern "C" void cuda_ola_apply_filter(int Gr, int Bl,
+                                      cufftDoubleComplex *spectra,
+                                      const cufftDoubleComplex *log_filters,
+                                      int n, double scale);
+#endif
+
+namespace kaldi {
+
+void MgcToCepstrum(const double *mgc, int m, double a, double g, int l,
+                   Mgc2SpScratch *scratch) {
+  int m2 = l / 2;
+  std::vector<double> &c = scratch->c, &d = scratch->d;
+
+  /* freqt */
+  double fa = -a, b = 1 - fa * fa;
+  c.assign(l, 0.0);
+  if (fa == 0.0) {
+    for (int i = 0; i <= std::min(m, m2); i++)
+      c[i] = mgc[i];
+  } else {
+    d.assign(l, 0.0);
+    for (int i = -m; i <= 0; i++) {
+      d.swap(c);
+      c[0] = mgc[-i] + fa * d[0];
+      if (1 <= m2)
+        c[1] = b * d[0] + fa * d[1];
+      for (int j = 2; j <= m2; j++)
+        c[j] = d[j - 1] + fa * (d[j] - c[j - 1]);
+    }
+  }
+
+  /* gnorm, gc2gc and ignorm, with gamma 0 the first two undo each other */
+  if (g != 0.0) {
+    double k = 1.0 + g * c[0];
+    for (int i = 1; i <= m2; i++)
+      c[i] /= k;
+    c[0] = log(pow(k, 1.0 / g));
+    std::vector<double> &ca = scratch->ca;
+    ca.assign(c.begin(), c.begin() + m2 + 1);
+    for (int i = 1; i <= m2; i++) {
+      double ss1 = 0.0;
+      for (int k = 1; k < i; k++)
+        ss1 += (i - k) * ca[k] * c[i - k];
+      c[i] = ca[i] - g * ss1 / i;
+    }
+  }
+}
+
+
+void Mgc2Sp(const double *mgc, int m, double a, double g,
+            const SplitRadixRealFft<double> &srfft, int l,
+            double *x, double *y, Mgc2SpScratch *scratch) {
+  int m2 = l / 2;
+  MgcToCepstrum(mgc, m, a, g, l, scratch);
+  std::vector<double> &c = scratch->c;
+
+  /* c2sp, c is zero past m2, and the real FFT is packed as DC, nyquist,
+     then the real and imaginary part of each bin */
+  srfft.Compute(c.data(), true, &scratch->fft_buffer);
+  x[0] = c[0];
+  y[0] = 0.0;
+  x[m2] = c[1];
+  y[m2] = 0.0;
+  for (int i = 1; i < m2; i++) {
+    x[i] = c[2 * i];
+    y[i] = c[2 * i + 1];
+  }
+}
+
+
+// Runs f(begin, end) on contiguous ranges of begin ... end - 1 on up to
+// num_threads threads (if not positive, one per core), the first range in
+// this thread.
+template <typename F>
+static void OlaParallelRanges(int begin, int end, int num_threads, F f) {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  int n = end - begin;
+  num_threads = std::max(1, std::min(num_threads, n / 16));
+  std::vector<std::thread> threads;
+  for (int t = 1; t < num_threads; t++)
+    threads.push_back(std::thread(f, begin + n * t / num_threads,
+                                  begin + n * (t + 1) / num_threads));
+  f(begin, begin + n / num_threads);
+  for (auto &thread : threads)
+    thread.join();
+}
+
+
+OlaSynthesizer::OlaSynthesizer(int order, double alpha, int frame_period,
+                               int fftlen, bool bflag, bool nogain):
+    order_(order), alpha_(alpha), frame_period_(frame_period),
+    fftlen_(fftlen), bflag_(bflag), nogain_(nogain), srfft_(fftlen) {
+  KALDI_ASSERT(order >= 0 && frame_period > 0);
+  KALDI_ASSERT((fftlen & (fftlen - 1)) == 0 && fftlen >= 2 * frame_period);
+  window_.resize(2 * frame_period);
+  for (int n = 0; n < 2 * frame_period; n++)
+    window_[n] = 0.5 - 0.5 * cos(M_PI * n / frame_period);
+
+  // Each step of freqt's recursion maps the previous cepstrum d to
+  // T(d) + mgc(i) e0, so the cepstrum is the sum over k of mgc(k) T^k e0,
+  // and the frames' log spectra are a matrix product instead of a serial
+  // recursion and an FFT each.
+  int l = fftlen, m2 = l / 2;
+  double fa = -alpha, b = 1 - fa * fa;
+  std::vector<double> c(m2 + 1, 0.0), d(m2 + 1), fft_buffer;
+  c[0] = 1.0;
+  log_spectra_.Resize(order + 1, l);
+  for (int k = 0; k <= order; k++) {
+    if (k > 0) {
+      d.swap(c);
+      c[0] = fa * d[0];
+      if (1 <= m2)
+        c[1] = b * d[0] + fa * d[1];
+      for (int j = 2; j <= m2; j++)
+        c[j] = d[j - 1] + fa * (d[j] - c[j - 1]);
+    }
+    double *row = log_spectra_.RowData(k);
+    std::copy(c.begin(), c.end(), row);
+    // c(0) of the cepstrum is b(0) of the MLSA filter, the log gain
+    if (nogain)
+      row[0] = 0.0;
+    srfft_.Compute(row, true, &fft_buffer);
+  }
+}
+
+
+void OlaSynthesizer::FrameLogSpectra(const std::vector<double> &mceps,
+                                     int begin, int end,
+                                     MatrixBase<double> *log_spectra) const {
+  int m = order_;
+  Matrix<double> mcep_rows(end - begin, m + 1, kUndefined);
+  for (int t = begin; t < end; t++) {
+    const double *mcep = &mceps[static_cast<size_t>(t) * (m + 1)];
+    double *row = mcep_rows.RowData(t - begin);
+    if (bflag_) {
+      // b2mc, the inverse of mc2b
+      row[m] = mcep[m];
+      for (int i = m - 1; i >= 0; i--)
+        row[i] = mcep[i] + alpha_ * mcep[i + 1];
+    } else {
+      std::copy(mcep, mcep + m + 1, row);
+    }
+  }
+  log_spectra->AddMatMat(1.0, mcep_rows, kNoTrans, log_spectra_, kNoTrans,
+                         0.0);
+}
+
+
+void OlaSynthesizer::FrameExcitation(const std::vector<double> &excitation,
+                                     size_t length, int frame,
+                                     double *segment) const {
+  // the window of frame t is centred on sample t * frame_period
+  int64 start = static_cast<int64>(frame - 1) * frame_period_;
+  std::fill(segment, segment + fftlen_, 0.0);
+  for (int n = 0; n < 2 * frame_period_; n++) {
+    int64 i = start + n;
+    if (i >= 0 && i < static_cast<int64>(length))
+      segment[n] = excitation[i] * window_[n];
+  }
+}
+
+
+void OlaSynthesizer::FilterFrame(const double *log_spectrum,
+                                 const std::vector<double> &excitation,
+                                 size_t length, int frame, double *segment,
+                                 std::vector<double> *fft_buffer) const {
+  int l = fftlen_, m2 = l / 2;
+  const double *c = log_spectrum;
+  FrameExcitation(excitation, length, frame, segment);
+  srfft_.Compute(segment, true, fft_buffer);
+
+  // multiply by exp of the log spectrum, both packed as DC, nyquist, then
+  // the real and imaginary part of each bin; the inverse FFT is not scaled
+  double scale = 1.0 / l;
+  segment[0] *= exp(c[0]) * scale;
+  segment[1] *= exp(c[1]) * scale;
+  for (int k = 1; k < m2; k++) {
+    double a = exp(c[2 * k]) * scale, re = a * cos(c[2 * k + 1]),
+        im = a * sin(c[2 * k + 1]), er = segment[2 * k],
+        ei = segment[2 * k + 1];
+    segment[2 * k] = er * re - ei * im;
+    segment[2 * k + 1] = er * im + ei * re;
+  }
+  srfft_.Compute(segment, false, fft_buffer);
+}
+
+
+void OlaSynthesizer::Synthesize(const std::vector<double> &mceps,
+                                const std::vector<double> &excitation,
+                                int num_threads, bool use_gpu,
+                                std::vector<double> *waveform) const {
+  int m = order_, l = fftlen_, fprd = frame_period_;
+  int num_frames = mceps.size() / (m + 1);
+  size_t length = 0;
+  if (num_frames >= 2)
+    length = std::min(excitation.size(),
+                      static_cast<size_t>(num_frames - 1) * fprd);
+  waveform->assign(length, 0.0);
+  if (length == 0)
+    return;
+  // the frames whose windows start before the end
+  num_frames = std::min<int64>(num_frames, (length + fprd - 1) / fprd + 1);
+
+  std::vector<double> segments(static_cast<size_t>(kBatchFrames) * l);
+  for (int begin = 0; begin < num_frames; begin += kBatchFrames) {
+    int end = std::min(begin + kBatchFrames, num_frames);
+    if (!use_gpu || !FilterFramesGpu(mceps, excitation, length, begin, end,
+                                     num_threads, segments.data())) {
+      OlaParallelRanges(begin, end, num_threads, [&](int b, int e) {
+        Matrix<double> log_spectra(e - b, l, kUndefined);
+        FrameLogSpectra(mceps, b, e, &log_spectra);
+        std::vector<double> fft_buffer;
+        for (int t = b; t < e; t++)
+          FilterFrame(log_spectra.RowData(t - b), excitation, length, t,
+                      &segments[static_cast<size_t>(t - begin) * l],
+                      &fft_buffer);
+      });
+    }
+    // overlap-add, this is cheap next to the FFTs
+    for (int t = begin; t < end; t++) {
+      const double *segment = &segments[static_cast<size_t>(t - begin) * l];
+      int64 start = static_cast<int64>(t - 1) * fprd;
+      int64 n = std::max<int64>(0, -start),
+          n_end = std::min<int64>(l, static_cast<int64>(length) - start);
+      for (; n < n_end; n++)
+        (*waveform)[start + n] += segment[n];
+    }
+  }
+}
+
+
+#if HAVE_CUDA == 1
+
+namespace {
+// The cuFFT plans and buffers for one FFT length and a batch of frames: the
+// windowed excitation (data) and its spectra, and the log spectra of the
+// filters. The GPU is used by one synthesis at a time.
+struct OlaGpuState {
+  int fftlen;
+  bool failed;
+  cufftHandle forward, inverse;
+  double *data;
+  cufftDoubleComplex *spectra, *log_filters;
+  std::vector<double> host_log_filters;
+  OlaGpuState(): fftlen(0), failed(false), data(NULL), spectra(NULL),
+                 log_filters(NULL) { }
+};
+std::mutex ola_gpu_mutex;
+OlaGpuState ola_gpu;
+
+void OlaGpuFree(OlaGpuState *state) {
+  if (state->fftlen > 0) {
+    cufftDestroy(state->forward);
+    cufftDestroy(state->inverse);
+  }
+  cudaFree(state->data);
+  cudaFree(state->spectra);
+  cudaFree(state->log_filters);
+  state->data = NULL;
+  state->spectra = NULL;
+  state->log_filters = NULL;
+  state->fftlen = 0;
+}
+
+bool OlaGpuInit(OlaGpuState *state, int fftlen) {
+  if (state->fftlen == fftlen)
+    return true;
+  OlaGpuFree(state);
+  int batch = OlaSynthesizer::kBatchFrames, bins = fftlen / 2 + 1;
+  if (cufftPlan1d(&state->forward, fftlen, CUFFT_D2Z, batch) !=
+      CUFFT_SUCCESS)
+    return false;
+  if (cufftPlan1d(&state->inverse, fftlen, CUFFT_Z2D, batch) !=
+      CUFFT_SUCCESS) {
+    cufftDestroy(state->forward);
+    return false;
+  }
+  state->fftlen = fftlen;
+  if (cudaMalloc(reinterpret_cast<void**>(&state->data),
+                 sizeof(double) * batch * fftlen) != cudaSuccess ||
+      cudaMalloc(reinterpret_cast<void**>(&state->spectra),
+                 sizeof(cufftDoubleComplex) * batch * bins) != cudaSuccess ||
+      cudaMalloc(reinterpret_cast<void**>(&state->log_filters),
+                 sizeof(cufftDoubleComplex) * batch * bins) != cudaSuccess) {
+    OlaGpuFree(state);
+    return false;
+  }
+  state->host_log_filters.resize(static_cast<size_t>(2) * batch * bins);
+  return true;
+}
+}  // namespace
+
+
+bool OlaSynthesizer::GpuAvailable() {
+  int num_gpus = 0;
+  if (cudaGetDeviceCount(&num_gpus) != cudaSuccess) {
+    cudaGetLastError();  // so the error is not returned later
+    return false;
+  }
+  return num_gpus > 0;
+}
+
+
+bool OlaSynthesizer::FilterFramesGpu(const std::vector<double> &mceps,
+                                     const std::vector<double> &excitation,
+                                     size_t length, int begin, int end,
+                                     int num_threads, double *segments) const {
+  std::lock_guard<std::mutex> lock(ola_gpu_mutex);
+  OlaGpuState &state = ola_gpu;
+  if (state.failed)
+    return false;
+  int l = fftlen_, m2 = l / 2, batch = kBatchFrames, bins = m2 + 1;
+  if (!OlaGpuInit(&state, l)) {
+    KALDI_WARN << "Cannot set up cuFFT, overlap-add synthesis runs on the CPU";
+    state.failed = true;
+    return false;
+  }
+
+  // the unused frames of the batch are zero, cuFFT's spectra are not packed
+  double *host = state.host_log_filters.data();
+  std::fill(segments + static_cast<size_t>(end - begin) * l,
+            segments + static_cast<size_t>(batch) * l, 0.0);
+  std::fill(host + static_cast<size_t>(end - begin) * 2 * bins,
+            host + static_cast<size_t>(batch) * 2 * bins, 0.0);
+  OlaParallelRanges(begin, end, num_threads, [&](int b, int e) {
+    Matrix<double> log_spectra(e - b, l, kUndefined);
+    FrameLogSpectra(mceps, b, e, &log_spectra);
+    for (int t = b; t < e; t++) {
+      FrameExcitation(excitation, length, t,
+                      segments + static_cast<size_t>(t - begin) * l);
+      const double *packed = log_spectra.RowData(t - b);
+      double *bin = host + static_cast<size_t>(t - begin) * 2 * bins;
+      bin[0] = packed[0];
+      bin[1] = 0.0;
+      std::copy(packed + 2, packed + l, bin + 2);
+      bin[2 * m2] = packed[1];
+      bin[2 * m2 + 1] = 0.0;
+    }
+  });
+
+  size_t n = static_cast<size_t>(batch) * bins;
+  bool ok =
+      cudaMemcpy(state.data, segments, sizeof(double) * batch * l,
+                 cudaMemcpyHostToDevice) == cudaSuccess &&
+      cudaMemcpy(state.log_filters, host, sizeof(cufftDoubleComplex) * n,
+                 cudaMemcpyHostToDevice) == cudaSuccess &&
+      cufftExecD2Z(state.forward, state.data, state.spectra) == CUFFT_SUCCESS;
+  if (ok) {
+    int block = 256;
+    cuda_ola_apply_filter((n + block - 1) / block, block, state.spectra,
+                          state.log_filters, n, 1.0 / l);
+    ok = cudaGetLastError() == cudaSuccess &&
+        cufftExecZ2D(state.inverse, state.spectra, state.data) ==
+        CUFFT_SUCCESS &&
+        cudaMemcpy(segments, state.data,
+                   sizeof(double) * static_cast<size_t>(end - begin) * l,
+                   cudaMemcpyDeviceToHost) == cudaSuccess;
+  }
+  if (!ok) {
+    KALDI_WARN << "cuFFT failed, overlap-add synthesis runs on the CPU";
+    cudaGetLastError();
+    OlaGpuFree(&state);
+    state.failed = true;
+  }
+  return ok;
+}
+
+#else   // HAVE_CUDA == 1
+
+bool OlaSynthesizer::GpuAvailable() { return false; }
+
+bool OlaSynthesizer::FilterFramesGpu(const std::vector<double> &mceps,
+                                     const std::vector<double> &excitation,
+                                     size_t length, int begin, int end,
+                                     int num_threads, double *segments) const {
+  return false;
+}
+
+#endif  // HAVE_CUDA == 1
+
+}  // namespace kaldi
@@ -0,0 +1,130 @@
+// pyIdlak/vocoder/python-vocoder-ola.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+// Overlap-add synthesis from MCEPs, not exposed to python.
+//
+// A fast alternative to the MLSA filter. Each frame's mel-cepstrum is turned
+// into the (minimum phase) spectrum of the filter as mgc2sp does, the
+// excitation around the frame is windowed with a Hann window two frame
+// periods long and multiplied by that spectrum in the FFT domain, and the
+// frames are inverse transformed and overlap-added. The windows of
+// neighbouring frames sum to one, so like the MLSA filter the filter moves
+// from one frame to the next over each frame period. Unlike the MLSA filter
+// every frame is independent, so the frames are transformed in batches on
+// several threads or, with CUDA, with cuFFT.
+//
+// The impulse response of each frame is cut to fftlen - 2 * frame_period
+// samples (the rest wraps round), so fftlen should leave room for it; the
+// voices' usual fftlen of four or more frame periods is plenty.
+
+#ifndef KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_OLA_H_
+#define KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_OLA_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+#include "matrix/srfft.h"
+
+namespace kaldi {
+
+/// Work buffers of MgcToCepstrum and Mgc2Sp, reused from frame to frame.
+struct Mgc2SpScratch {
+  std::vector<double> c, d, ca, fft_buffer;
+};
+
+/// mgc2mgc to the cepstrum of order l / 2 with alpha and gamma 0 (freqt,
+/// gnorm, gc2gc and ignorm as in SPTK), without SPTK's static buffers so
+/// that frames can be converted concurrently. The l values of the cepstrum
+/// (zero past l / 2) are left in scratch->c.
+void MgcToCepstrum(const double *mgc, int m, double a, double g, int l,
+                   Mgc2SpScratch *scratch);
+
+/// mgc2sp: MgcToCepstrum then c2sp with srfft (of size l). Writes the log
+/// amplitude and phase of bins 0 ... l / 2 to x and y.
+void Mgc2Sp(const double *mgc, int m, double a, double g,
+            const SplitRadixRealFft<double> &srfft, int l,
+            double *x, double *y, Mgc2SpScratch *scratch);
+
+
+class OlaSynthesizer {
+ public:
+  /// order and alpha are those of the mel-cepstrum, frame_period is in
+  /// samples and fftlen must be a power of 2 of at least twice the frame
+  /// period. With bflag the frames are MLSA filter coefficients (as mc2b
+  /// gives) instead of mel-cepstra, with nogain the gain is left out; both
+  /// as for the MLSA filter.
+  OlaSynthesizer(int order, double alpha, int frame_period, int fftlen,
+                 bool bflag = false, bool nogain = false);
+
+  /// Synthesises the waveform of mceps (order + 1 values a frame) from the
+  /// excitation. Gives the same number of samples as the MLSA filter: a frame
+  /// period for each frame after the first, fewer if the excitation runs out.
+  /// The frames are transformed on up to num_threads threads (if not
+  /// positive, one per core), or on the GPU if use_gpu and there is one.
+  void Synthesize(const std::vector<double> &mceps,
+                  const std::vector<double> &excitation,
+                  int num_threads, bool use_gpu,
+                  std::vector<double> *waveform) const;
+
+  /// True if this was compiled with CUDA and a GPU can be used.
+  static bool GpuAvailable();
+
+  /// Frames transformed together, which bounds the memory used.
+  static const int kBatchFrames = 256;
+
+ private:
+  // The log spectra of frames begin ... end - 1 into the rows of
+  // log_spectra, packed as SplitRadixRealFft gives them.
+  void FrameLogSpectra(const std::vector<double> &mceps, int begin, int end,
+                       MatrixBase<double> *log_spectra) const;
+  // The windowed excitation about frame 'frame', zero padded to fftlen.
+  void FrameExcitation(const std::vector<double> &excitation, size_t length,
+                       int frame, double *segment) const;
+  // Filters frame 'frame', whose log spectrum is 'log_spectrum', into
+  // segment (fftlen values).
+  void FilterFrame(const double *log_spectrum,
+                   const std::vector<double> &excitation, size_t length,
+                   int frame, double *segment,
+                   std::vector<double> *fft_buffer) const;
+  // Filters frames begin ... end - 1 into segments (fftlen values a frame)
+  // with cuFFT, returns false if the GPU cannot be used.
+  bool FilterFramesGpu(const std::vector<double> &mceps,
+                       const std::vector<double> &excitation, size_t length,
+                       int begin, int end, int num_threads,
+                       double *segments) const;
+
+  int order_;
+  double alpha_;
+  int frame_period_;
+  int fftlen_;
+  bool bflag_;
+  bool nogain_;
+  std::vector<double> window_;    // periodic Hann, 2 * frame_period
+  // freqt and c2sp are linear: row k is the log spectrum of the k'th unit
+  // mel-cepstrum (without its c(0) with nogain), so a frame's log spectrum
+  // is its mel-cepstrum times this.
+  Matrix<double> log_spectra_;
+  SplitRadixRealFft<double> srfft_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_PYIDLAK_VOCODER_PYTHON_VOCODER_OLA_H_
@@ -0,0 +1,67 @@
+# -*- coding: utf-8 -*-
+# Copyright 2026  agent
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+# WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+# MERCHANTABLITY OR NON-INFRINGEMENT.
+# See the Apache 2 License for the specific language governing permissions and
+# limitations under the License.
+
+""" Resampling waveforms, e.g. the 48 kHz vocoder output to telephony rates
+
+    Uses the resampler of the Kaldi feature extraction, a polyphase windowed
+    sinc filter with the cutoff just under the lower Nyquist frequency.
+"""
+
+from . import pyIdlak_vocoder
+
+
+def resample(waveform, srate_in, srate_out):
+    """ Resample a whole waveform from srate_in to srate_out (Hz) """
+    if int(srate_in) <= 0 or int(srate_out) <= 0:
+        raise ValueError("cannot resample from {0} Hz to {1} Hz".format(
+            srate_in, srate_out))
+    if int(srate_in) == int(srate_out):
+        return list(waveform)
+    return list(pyIdlak_vocoder.PyVocoder_resample(int(srate_in),
+                                                   int(srate_out),
+                                                   list(waveform)))
+
+
+class Resampler():
+    """ Resamples a waveform given in chunks
+
+        process returns the samples which are complete so far, so they can
+        be sent while the rest is synthesised, and flush returns the end of
+        the waveform, after which the resampler can be used for a new one.
+    """
+
+    def __init__(self, srate_in, srate_out):
+        self._resampler = pyIdlak_vocoder.PyResampler_new(int(srate_in),
+                                                          int(srate_out))
+        if self._resampler is None:
+            raise ValueError("cannot resample from {0} Hz to {1} Hz".format(
+                srate_in, srate_out))
+        self.srate_in = int(srate_in)
+        self.srate_out = int(srate_out)
+
+    def __del__(self):
+        if getattr(self, '_resampler', None) is not None:
+            pyIdlak_vocoder.PyResampler_delete(self._resampler)
+            self._resampler = None
+
+    def process(self, waveform):
+        """ Resample the next chunk of the waveform """
+        return list(pyIdlak_vocoder.PyResampler_process(self._resampler,
+                                                        list(waveform)))
+
+    def flush(self):
+        """ Return the end of the waveform and reset the resampler """
+        return list(pyIdlak_vocoder.PyResampler_flush(self._resampler))
@@ -19,6 +19,7 @@ import wave
 import struct
 from . import pyIdlak_vocoder
 from . import excitation
+from . import resample
 
 
 
@@ -38,12 +39,13 @@ class Vocoder():
         self._srate = srate
 
 
-    def to_wav(self, wavfn, waveform = False, mode = 'w'):
+    def to_wav(self, wavfn, waveform = False, mode = 'w', srate = None):
         """ Save the vocoded waveform into a file,
 
             Uses wave from the Python standard library,
             raises ValueError if the wave form has not been
-            created yet.
+            created yet. If srate is given and differs from the
+            vocoder's, the waveform is resampled to it.
         """
         if not mode in ['ab', 'wb', 'a', 'w']:
             raise ValueError("mode must be 'a' or 'w'")
@@ -54,11 +56,16 @@ class Vocoder():
         if waveform is None:
             raise ValueError('No waveform to save')
 
+        if srate is None:
+            srate = self.srate
+        elif int(srate) != self.srate:
+            waveform = resample.resample(waveform, self.srate, srate)
+
         mode = mode[0] + 'b' # file must be opened in binary mode
         wav = wave.open(wavfn, mode)
         wav.setnchannels(1)
         wav.setsampwidth(2) # always using signed integer output
-        wav.setframerate(self.srate)
+        wav.setframerate(int(srate))
         for w in waveform:
             wout = int(max(min(w, 0x7fff), (-0x7fff - 1))) # ensures in range
             write_data = struct.pack("<h", wout)
@@ -115,10 +122,143 @@ class MCEPVocoder(Vocoder):
         self.transpose_filter = False
         self.inverse_filter = False
 
+        # The synthesis filter of apply_filter and vocode_spurts: 'mlsa' or
+        # 'ola' for the faster overlap-add synthesis (see apply_ola), which
+        # runs its FFTs on the GPU if use_gpu is set and there is one
+        self.synthesis = 'mlsa'
+        self.use_gpu = False
+
 
     def apply_mlsa(self, mceps, excite, stablise_mceps = True):
         """ Takes the mceps and vocodes them using the given excitation """
 
+        smceps = self._flatten_mceps(mceps, stablise_mceps)
+
+        fperiod = int(self.srate * self.fshift)
+        # a local so that concurrent calls each get their own waveform
+        waveform = pyIdlak_vocoder.PySPTK_mlsadf(
+            smceps, excite, self.order, self.alpha, fperiod, self.iperiod,
+            self.pade_order, self.save_bcoeffs, self.no_gain,
+            self.transpose_filter, self.inverse_filter)
+        self._waveform = waveform
+        return waveform
+
+
+    def apply_ola(self, mceps, excite, stablise_mceps = True,
+                  num_threads = 0):
+        """ Takes the mceps and vocodes them using the given excitation
+
+            Overlap-add synthesis: each frame's filter is applied in the FFT
+            domain to the windowed excitation about the frame, so the
+            frames are independent and are transformed on num_threads
+            threads (0 for one per core), or with cuFFT if use_gpu is set.
+            The output is the same length as apply_mlsa's and sounds the
+            same to within the MLSA filter's frame to frame interpolation;
+            the interpolation period, transpose and inverse filter options
+            are MLSA only.
+        """
+        smceps = self._flatten_mceps(mceps, stablise_mceps)
+
+        fperiod = int(self.srate * self.fshift)
+        waveform = pyIdlak_vocoder.PyVocoder_ola_synthesis(
+            smceps, excite, self.order, self.alpha, fperiod, self.fftlen,
+            self.save_bcoeffs, self.no_gain, bool(self.use_gpu),
+            int(num_threads))
+        self._waveform = waveform
+        return waveform
+
+
+    def apply_filter(self, mceps, excite, stablise_mceps = True):
+        """ apply_mlsa or apply_ola, as synthesis selects """
+        if self.synthesis == 'ola':
+            return self.apply_ola(mceps, excite, stablise_mceps)
+        return self.apply_mlsa(mceps, excite, stablise_mceps)
+
+
+    def vocode_spurts(self, spurts, exc_type = MCEPExcitation.AUTO,
+                      stablise_mceps = True, num_threads = 0, split = False):
+        """ Vocodes several independent spurts at once
+
+            spurts is a list of (mceps, f0s, bndaps) tuples, bndaps may be
+            None for SPTK excitation. The spurts are vocoded concurrently on
+            num_threads threads (0 for one per core) and the waveform is
+            the spurts' waveforms one after another, the same as calling
+            gen_excitation and apply_filter for each spurt in turn.
+
+            If split is set a list of the waveform of each spurt is returned
+        """
+        if exc_type == MCEPExcitation.AUTO:
+            if all(not bndaps is None for _, _, bndaps in spurts):
+                exc_type = MCEPExcitation.MIXED
+            else:
+                exc_type = MCEPExcitation.SPTK
+        mixed = exc_type == MCEPExcitation.MIXED
+
+        all_mceps, all_f0s, all_bndaps = [], [], []
+        bndap_order = None
+        for mceps, f0s, bndaps in spurts:
+            all_mceps.append(self._flatten_mceps(mceps, False))
+            all_f0s.append([float(f0) for f0 in f0s])
+            flat_bndaps = []
+            if mixed and len(f0s):
+                if len(bndaps) < len(f0s):
+                    raise ValueError("fewer bndap frames than f0 frames")
+                if bndap_order is None:
+                    bndap_order = len(bndaps[0])
+                for fidx, fbndaps in enumerate(bndaps[:len(f0s)]):
+                    if len(fbndaps) != bndap_order:
+                        raise ValueError(
+                            "frame {0} does not have {1} bndaps".format(
+                                fidx, bndap_order))
+                    flat_bndaps.extend([float(b) for b in fbndaps])
+            all_bndaps.append(flat_bndaps)
+
+        opts = None
+        if mixed and not bndap_order is None:
+            opts = excitation._band_options(bndap_order, self.srate,
+                                            self.fshift).kaldiopts
+        uv_period = self.uv_period
+        if uv_period is None:
+            uv_period = 2. * self.fshift
+        waveform = pyIdlak_vocoder.PyVocoder_vocode_spurts(
+            opts, all_mceps, all_f0s, all_bndaps, self.order, self.alpha,
+            int(self.srate), float(self.fshift), self.pade_order, mixed,
+            float(self.f0min), self.fftlen, float(uv_period), bool(self.gauss),
+            int(self.seed), int(self.iperiod), bool(stablise_mceps),
+            self.stable_condition, float(self.stability_threshold),
+            self.quiet_stablisation, self.save_bcoeffs, self.no_gain,
+            self.transpose_filter, self.inverse_filter, int(num_threads),
+            self.synthesis == 'ola', bool(self.use_gpu))
+        if not split:
+            return list(waveform)
+
+        lengths = pyIdlak_vocoder.PyVocoder_spurt_lengths(
+            [len(mceps) for mceps, _, _ in spurts],
+            [len(f0s) for _, f0s, _ in spurts],
+            int(self.srate), float(self.fshift), mixed, self.fftlen)
+        if sum(lengths) != len(waveform):
+            # a spurt gave an error, the boundaries are only known by
+            # vocoding them one at a time
+            return [self.vocode_spurts([spurt], exc_type, stablise_mceps, 1)
+                    for spurt in spurts]
+        waveforms = []
+        start = 0
+        for length in lengths:
+            waveforms.append(list(waveform[start:start + length]))
+            start += length
+        return waveforms
+
+
+    def mlsa_synthesizer(self, stablise_mceps = True):
+        """ Creates a streaming MLSA synthesizer with the vocoder settings
+
+            Streaming is always MLSA, whatever synthesis is
+        """
+        return MLSASynthesizer(self, stablise_mceps)
+
+
+    def _flatten_mceps(self, mceps, stablise_mceps):
+        """ Flattens the mceps into one list, optionally stablising them """
         flat_mceps = []
         for idx, mframe in enumerate(mceps):
             if not len(mframe) == self.order + 1:
@@ -128,20 +268,11 @@ class MCEPVocoder(Vocoder):
             flat_mceps.extend([float(x) for x in mframe])
 
         if stablise_mceps:
-            smceps = pyIdlak_vocoder.PySPTK_mlsacheck(
+            return pyIdlak_vocoder.PySPTK_mlsacheck(
                 flat_mceps, self.order, self.alpha, self.fftlen, 2,
                 self.stable_condition, self.pade_order,
                 self.stability_threshold, self.quiet_stablisation)
-        else:
-            smceps = flat_mceps
-
-        fperiod = int(self.srate * self.fshift)
-        self._waveform = pyIdlak_vocoder.PySPTK_mlsadf(
-            smceps, excite, self.order, self.alpha, fperiod, self.iperiod,
-            self.pade_order, self.save_bcoeffs, self.no_gain,
-            self.transpose_filter, self.inverse_filter)
-
-        return self._waveform
+        return flat_mceps
 
 
     def gen_excitation(self, f0s, bndaps = None,
@@ -217,3 +348,47 @@ class MCEPVocoder(Vocoder):
     def pade_order(self):
         return self._pade
 
+
+
+class MLSASynthesizer():
+    """ Streaming MLSA synthesis
+
+        MCEP frames and excitation can be given in chunks as they are
+        generated, the filter state is kept between calls so the audio
+        is the same as vocoding everything at once. Call flush at the end
+        of the stream to get the remaining samples.
+    """
+
+    def __init__(self, vocoder, stablise_mceps = True):
+        self._vocoder = vocoder
+        self._stablise = stablise_mceps
+        fperiod = int(vocoder.srate * vocoder.fshift)
+        self._synth = pyIdlak_vocoder.PyMlsaSynthesizer_new(
+            vocoder.order, vocoder.alpha, fperiod, vocoder.iperiod,
+            vocoder.pade_order, vocoder.save_bcoeffs, vocoder.no_gain,
+            vocoder.transpose_filter, vocoder.inverse_filter)
+        if self._synth is None:
+            raise ValueError("cannot create MLSA synthesizer")
+
+
+    def __del__(self):
+        if getattr(self, '_synth', None) is not None:
+            pyIdlak_vocoder.PyMlsaSynthesizer_delete(self._synth)
+            self._synth = None
+
+
+    def process(self, mceps, excite):
+        """ Adds a chunk of mceps and excitation, returns the new audio """
+        smceps = self._vocoder._flatten_mceps(mceps, self._stablise)
+        return list(pyIdlak_vocoder.PyMlsaSynthesizer_process(
+            self._synth, smceps, excite))
+
+
+    def flush(self):
+        """ Returns the remaining audio and resets for a new stream """
+        return list(pyIdlak_vocoder.PyMlsaSynthesizer_flush(self._synth))
+
+
+    def reset(self):
+        """ Discards any pending input and the filter state """
+        pyIdlak_vocoder.PyMlsaSynthesizer_reset(self._synth)
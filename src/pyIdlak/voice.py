@@ -19,9 +19,10 @@ import copy
 import logging
 import math
 import os
+import queue
 import sys
+import threading
 
-from lxml import etree
 
 from . import txp
 from . import vocoder
@@ -37,7 +38,8 @@ class TangleVoice:
     _state_pos_fuzz = 0.2
 
     """ Wrapper for pyIdlak to be used for TTS """
-    def __init__(self, voice_dir = None, loglvl = logging.WARN):
+    def __init__(self, voice_dir = None, loglvl = logging.WARN,
+                 use_gpu = 'no'):
         logging.basicConfig(level = loglvl)
         self.log = logging.getLogger('tangle')
         self._voicedir = None
@@ -47,6 +49,11 @@ class TangleVoice:
         self._region = ''
         self._fshift = 0.005
         self._voice_thresh = 0.8
+        self._synthesis = 'mlsa'
+        # threads used to vocode the spurts of an utterance, 0 for one per core
+        self.vocoder_threads = 0
+        # nnet-forward's --use-gpu for the DNNs, must be set before loading
+        self.use_gpu = use_gpu
 
         if not voice_dir is None:
             self.load_voice(voice_dir)
@@ -109,6 +116,15 @@ class TangleVoice:
         __load_fields(int_fields, int, 'integer')
         float_fields = ['voice_thresh', 'alpha', 'fshift']
         __load_fields(float_fields, float, 'float')
+        # the synthesis filter, mlsa or ola (overlap-add)
+        if 'synthesis' in voice_conf:
+            if voice_conf['synthesis'] in ('mlsa', 'ola'):
+                self._synthesis = voice_conf['synthesis']
+            else:
+                self.log.error(
+                    "voice configuration unknown synthesis '{0}'".format(
+                        voice_conf['synthesis']))
+            del voice_conf['synthesis']
 
         for k in voice_conf:
             self.log.warn("unknown voice configuration field '{0}'".format(k))
@@ -119,48 +135,221 @@ class TangleVoice:
         self._load_vocoder()
 
 
-    def speak(self, text, wav_filename = None):
+    def speak(self, text, wav_filename = None, pipelined = False):
         """ Simple interface for speaking text, returns the waveform
 
-            if wav_filename is a file name, then
+            if wav_filename is a file name, then the waveform is also saved
+            to it
+
+            if pipelined is set the spurts go through the stages one after
+            another as in speak_spurts, otherwise each stage runs over the
+            whole text at once
+        """
+        with txp.stagestats.StageTimer('speak'):
+            if pipelined:
+                waveform = []
+                for _, spurt_waveform in self.speak_spurts(text):
+                    waveform.extend(spurt_waveform)
+                if wav_filename:
+                    self.log.debug('saving to ' + wav_filename)
+                    self._vocoder.to_wav(wav_filename, waveform)
+                return waveform
+            features = self.spurt_features(text)
+            waveform = self.synthesise_features(features,
+                                                wav_filename = wav_filename)
+        return waveform
+
+
+    def speak_spurts(self, text, queue_size = 1):
+        """ Speak text a spurt at a time
+
+            A generator of (spurtid, waveform), see synthesise_spurts. The
+            first audio is ready after text processing and the synthesis of
+            one spurt.
+        """
+        features = self.spurt_features(text)
+        return self.synthesise_spurts(features, queue_size)
+
+
+    def synthesise_spurts(self, durfeatures, queue_size = 1):
+        """ Synthesise the spurts from spurt_features through a pipeline
+
+            A generator of (spurtid, waveform). The duration, pitch and
+            acoustic models and the vocoder each run in their own thread and
+            take one spurt at a time, so spurt N is vocoded while spurt N+1
+            is in the acoustic model and spurt N+2 in the pitch model. At
+            most queue_size spurts wait between two stages. Closing the
+            generator stops the synthesis.
+        """
+        stages = [self._spurt_durations, self._spurt_pitch,
+                  self._spurt_acoustic, self._spurt_vocode]
+        stop = threading.Event()
+        queues = [queue.Queue(maxsize = max(1, queue_size))
+                  for _ in stages]
+        sources = [iter(durfeatures.items())]
+        sources.extend(_queue_items(q, stop) for q in queues[:-1])
+        threads = []
+        for stage, source, outq in zip(stages, sources, queues):
+            thread = threading.Thread(target = _run_stage,
+                                      args = (stage, source, outq, stop),
+                                      name = 'tangle-' + stage.__name__)
+            thread.daemon = True
+            thread.start()
+            threads.append(thread)
+        try:
+            for item in _queue_items(queues[-1], stop):
+                if isinstance(item, _StageError):
+                    raise item.error
+                yield item
+        finally:
+            stop.set()
+            for thread in threads:
+                thread.join()
+
+
+    def _spurt_durations(self, item):
+        spurtid, spurtfeatures = item
+        durfeatures = collections.OrderedDict([(spurtid, spurtfeatures)])
+        state_durations = self.generate_state_durations(durfeatures)
+        return spurtid, self.combine_durations_and_features(
+            state_durations, durfeatures)
+
+
+    def _spurt_pitch(self, item):
+        spurtid, pitchfeatures = item
+        pitch = self.generate_pitch(pitchfeatures)
+        return spurtid, pitch, self.combine_pitch_and_features(
+            pitch, pitchfeatures)
+
+
+    def _spurt_acoustic(self, item):
+        spurtid, pitch, acousticdnnfeatures = item
+        return spurtid, pitch, self.generate_acoustic_features(
+            acousticdnnfeatures)
+
+
+    def _spurt_vocode(self, item):
+        spurtid, pitch, acousticfeatures = item
+        waveforms = self.vocode_acoustic_features(acousticfeatures, pitch,
+                                                  by_spurt = True)
+        return spurtid, waveforms[spurtid]
+
+
+    def spurt_features(self, text):
+        """ Process the text and return the DNN input features for
+            speak_spurt in an ordered dictionary by spurt id """
+        doc = self.process_text(text, cex=False)
+        return self.context_dnn_features(doc)
+
+
+    def speak_spurt(self, spurtid, features):
+        """ Synthesise one spurt from its DNN input features, returns the
+            waveform """
+        return self.synthesise_features(
+            collections.OrderedDict([(spurtid, features)]))
+
+
+    def synthesise_features(self, durfeatures, wav_filename = None,
+                            by_spurt = False):
+        """ Synthesise the spurts from spurt_features together, returns the
+            waveform, or if by_spurt is set an ordered dictionary of the
+            waveform of each spurt by spurt id
+
+            Text processing is not thread safe, but once batching is enabled
+            this can be called from several threads at the same time.
         """
-        cex = self.process_text(text)
-        durfeatures = self.cex_to_dnn_features(cex)
         state_durations = self.generate_state_durations(durfeatures)
         pitchfeatures = self.combine_durations_and_features(
             state_durations, durfeatures)
         pitch = self.generate_pitch(pitchfeatures)
         acousticdnnfeatures = self.combine_pitch_and_features(
             pitch, pitchfeatures)
-        acousticfeatures = self.generate_acoustic_features(acousticdnnfeatures)
-        waveform = self.vocode_acoustic_features(acousticfeatures, pitch,
-                                                 wav_filename)
-        return waveform
+        acousticfeatures = self.generate_acoustic_features(
+            acousticdnnfeatures)
+        return self.vocode_acoustic_features(acousticfeatures, pitch,
+                                             wav_filename = wav_filename,
+                                             by_spurt = by_spurt)
+
+
+    def enable_batching(self, max_batch_frames = 4096, max_delay = 0.005):
+        """ Run the duration, pitch and acoustic models through batchers
+
+            Forward passes from threads synthesising at the same time are
+            run together in batches of up to max_batch_frames frames, waiting
+            at most max_delay seconds for other requests to join. The models
+            are then only used by the batcher threads, so synthesise_features
+            can be called concurrently.
+        """
+        self._durmodel = gen.NNetBatcher(self._unbatched(self._durmodel),
+                                         max_batch_frames, max_delay)
+        self._pitchmodel = gen.NNetBatcher(self._unbatched(self._pitchmodel),
+                                           max_batch_frames, max_delay)
+        self._acousticmodel = gen.NNetBatcher(
+            self._unbatched(self._acousticmodel), max_batch_frames, max_delay)
+
+
+    def batching_stats(self):
+        """ The stats of each model's batcher, by model, None if batching is
+            not enabled """
+        if not isinstance(self._durmodel, gen.NNetBatcher):
+            return None
+        return {'duration': self._durmodel.stats(),
+                'pitch': self._pitchmodel.stats(),
+                'acoustic': self._acousticmodel.stats()}
+
+
+    def _unbatched(self, model):
+        if isinstance(model, gen.NNetBatcher):
+            model.close()
+            return model.nnet
+        return model
+
+
+    def add_lexicon_entry(self, word, entry, pron, default = False):
+        """ Adds or replaces a user pronunciation of the word, used by
+            text processing from the next document on. pron is space
+            separated phones of the voice's phone set """
+        self.Pronounce.add_lexicon_entry(word, entry, pron, default)
+
 
+    def remove_lexicon_entry(self, word, entry = ''):
+        """ Removes the entry of the word, or the word if entry is empty,
+            returns False if there was no such entry """
+        return self.Pronounce.remove_lexicon_entry(word, entry)
 
-    def process_text(self, text, normalise=True, cex=True):
+
+    def clear_lexicon_entries(self):
+        """ Goes back to the lexicon of the voice """
+        self.Pronounce.clear_lexicon_entries()
+
+
+    @property
+    def lexicon_version(self):
+        """ The number of changes made to the user lexicon entries """
+        return self.Pronounce.lexicon_version
+
+
+    def process_text(self, text, normalise=True, cex=True, doc=None):
         """ Process the input text
 
             If normalise is True then the full normaliser is run.
             If cex is True then context features are also run
+            If doc is a txp XML document it is reset and reused for the
+                result, which avoids allocating a new tree for each input
 
             Returns a txp XML document object
         """
         self.log.debug("Processing input text")
         text = str(text)
-        xmlparser = etree.XMLParser(encoding = 'utf8')
-        try:
-            etree.fromstring(text, parser = xmlparser)
-        except etree.XMLSyntaxError:
+        # the document is parsed once, the parser also checks it is valid
+        if doc is None:
+            doc = txp.XMLDoc()
+        if not doc.load_string(text):
             self.log.debug("Input is not valid xml, adding parent tags")
             text = '<parent>' + text + '</parent>'
-            try:
-                etree.fromstring(text, parser = xmlparser)
-            except etree.XMLSyntaxError as e:
+            if not doc.load_string(text):
                 self.log.critical('Cannot parse input')
-                raise(e)
-
-        doc = txp.XMLDoc(text)
+                raise ValueError('Cannot parse input as XML')
         self.Tokeniser.process(doc)
         self.PosTag.process(doc)
         if normalise:
@@ -184,6 +373,15 @@ class TangleVoice:
         return features
 
 
+    def context_dnn_features(self, doc):
+        """ Runs context extraction on a txp XML that has not been through it
+            and returns the dnn features, without writing the model names """
+        self.log.debug("Extracting DNN input features from processed text")
+        if not type(doc) == txp.XMLDoc:
+            raise ValueError("doc must be a txp XMLDoc")
+        return self.ContextExtraction.dnn_features(doc)
+
+
     def generate_state_durations(self, dnnfeatures, apply_postproc = True):
         """ Takes the dnnfeatures and generates state durations in frames
 
@@ -197,14 +395,42 @@ class TangleVoice:
         """
         self.log.debug("Generating state durations")
         durations = collections.OrderedDict()
-        for spurtid, spurtfeatures in dnnfeatures.items():
-            self.log.debug('generating duration for ' + spurtid)
-            statedfeatures = self._add_state_feature(spurtfeatures)
-            durmatrix = self._durmodel.forward(statedfeatures)
-            if apply_postproc:
-                durations[spurtid] = self._post_duration_processing(durmatrix)
+        spurtids = list(dnnfeatures.keys())
+        nphones = [len(dnnfeatures[spurtid]) for spurtid in spurtids]
+        if not sum(nphones):
+            for spurtid in spurtids:
+                durations[spurtid] = []
+            return durations
+        self.log.debug('generating duration for {0} spurts'.format(len(spurtids)))
+        # the phone features stay in one kaldi matrix from the state
+        # expansion through the DNN to the post processing
+        phnmat = pylib.PyKaldiMatrixBaseFloat_frmlist(
+            [row for spurtid in spurtids for row in dnnfeatures[spurtid]])
+        mat = gen.c_api.PyAddStateFeature(phnmat, self.NumStates)
+        lengths = [n * self.NumStates for n in nphones]
+        with txp.stagestats.StageTimer('duration', sum(nphones), 'phones'):
+            if hasattr(self._durmodel, 'forward_matrix'):
+                mat = self._durmodel.forward_matrix(mat, lengths)
             else:
-                durations[spurtid] = durmatrix
+                # batchers take lists of sequences
+                rows = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+                batch, offset = [], 0
+                for length in lengths:
+                    batch.append(rows[offset:offset + length])
+                    offset += length
+                mat = pylib.PyKaldiMatrixBaseFloat_frmlist(
+                    [row for durmatrix in self._durmodel.forward_batch(batch)
+                     for row in durmatrix])
+        if apply_postproc:
+            mat = gen.c_api.PyPostDurationProcessing(mat, self.NumStates)
+            if mat is None:
+                raise ValueError("cannot post process the state durations")
+            lengths = nphones
+        rows = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+        offset = 0
+        for spurtid, length in zip(spurtids, lengths):
+            durations[spurtid] = rows[offset:offset + length]
+            offset += length
 
         return durations
 
@@ -219,21 +445,19 @@ class TangleVoice:
         self.log.debug("Combining predicted state durations with DNN features")
         combinedfeatures = collections.OrderedDict()
         for spurtid, spurtdurs in durations.items():
-            combinedfeatures[spurtid] = []
-            for phoneidx, statedurs in enumerate(spurtdurs):
-                phnfeatures = dnnfeatures[spurtid][phoneidx]
-                phndur = sum(statedurs)
-                for stateidx, statedur in enumerate(statedurs):
-                    for statepos in range(statedur):
-                        phnpos = sum(statedurs[:stateidx]) + statepos
-                        fuzzy_statepos = self._fuzzy_position(
-                            self._state_pos_fuzz, statepos, statedur)
-                        fuzzy_phnpos = self._fuzzy_position(
-                            self._phone_pos_fuzz, phnpos, phndur)
-                        spos = [stateidx, statedur, fuzzy_statepos]
-                        ppos = [phndur, fuzzy_phnpos]
-                        combinedfeatures[spurtid].append(list(phnfeatures + spos + ppos))
-                        phnpos += 1
+            if not len(spurtdurs):
+                combinedfeatures[spurtid] = []
+                continue
+            phnfeatures = pylib.PyKaldiMatrixBaseFloat_frmlist(
+                dnnfeatures[spurtid][:len(spurtdurs)])
+            statedurs = pylib.PyKaldiMatrixBaseFloat_frmlist(spurtdurs)
+            mat = gen.c_api.PyCombineDurationsAndFeatures(
+                phnfeatures, statedurs,
+                self._state_pos_fuzz, self._phone_pos_fuzz)
+            if mat is None:
+                raise ValueError("cannot combine durations and features "
+                                 "for " + spurtid)
+            combinedfeatures[spurtid] = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
         return combinedfeatures
 
 
@@ -249,16 +473,23 @@ class TangleVoice:
         """
         self.log.debug("Generating pitch values")
         pitch = collections.OrderedDict()
-        for spurtid, spurtfeatures in dnnfeatures.items():
-            self.log.debug('generating pitch for ' + spurtid)
-            pitchmatrix = self._pitchmodel.forward(spurtfeatures)
+        spurtids = list(dnnfeatures.keys())
+        self.log.debug('generating pitch for {0} spurts'.format(len(spurtids)))
+        inputs = [dnnfeatures[spurtid] for spurtid in spurtids]
+        with txp.stagestats.StageTimer('pitch', sum(map(len, inputs)),
+                                       'frames'):
+            pitchmatrices = self._pitchmodel.forward_batch(inputs)
+        for spurtid, pitchmatrix in zip(spurtids, pitchmatrices):
             if mlpg:
                 self.log.debug('applying MLPG to pitch')
                 if os.path.isdir(save_pdf_directory):
                     pdffile = os.path.join(save_pdf_directory, spurtid + '.pitch.pdf')
                 else:
                     pdffile = False
-                pitch[spurtid] = self._apply_mlpg(pitchmatrix, 'logf0', pdffile)
+                order = len(pitchmatrix[0]) // 3
+                mat = pylib.PyKaldiMatrixBaseFloat_frmlist(pitchmatrix)
+                pitch[spurtid] = self._apply_mlpg(mat, 'logf0', pdffile,
+                                                  0, order, order)
             else:
                 if extract:
                     for idx, row in enumerate(pitchmatrix):
@@ -292,32 +523,22 @@ class TangleVoice:
         """
         self.log.debug("Generating acoustic features")
         acoustic = collections.OrderedDict()
-        for spurtid, spurtfeatures in dnnfeatures.items():
-            self.log.debug('generating acoustic features for ' + spurtid)
-            acf = self._acousticmodel.forward(spurtfeatures)
+        spurtids = list(dnnfeatures.keys())
+        self.log.debug('generating acoustic features for {0} spurts'.format(
+            len(spurtids)))
+        inputs = [dnnfeatures[spurtid] for spurtid in spurtids]
+        with txp.stagestats.StageTimer('acoustic', sum(map(len, inputs)),
+                                       'frames'):
+            acfs = self._acousticmodel.forward_batch(inputs)
+        for spurtid, acf in zip(spurtids, acfs):
             if not (mlpg or extract):
                 acoustic[spurtid] = acf
                 continue
 
             # order in the matrix is mcep, bndap, mcep_d, bndap_d, mcep_dd, bndap_dd
-            mcep_start = 0
-            mcep_end = mcep_start + self.mcep_order + 1
-            bndap_start = mcep_end
-            bndap_end = bndap_start + self.bndap_order
-            mcep_d_start = bndap_end
-            mcep_d_end = mcep_d_start + self.mcep_order + 1
-            bndap_d_start = mcep_d_end
-            bndap_d_end = bndap_d_start + self.bndap_order
-            mcep_dd_start = bndap_d_end
-            mcep_dd_end = mcep_dd_start + self.mcep_order + 1
-            bndap_dd_start = mcep_dd_end
-            bndap_dd_end = bndap_dd_start + self.bndap_order
-
-            mceps = []
-            bndaps = []
-            for row in acf:
-                mceps.append(row[mcep_start:mcep_end] + row[mcep_d_start:mcep_d_end] + row[mcep_dd_start:mcep_dd_end])
-                bndaps.append(row[bndap_start:bndap_end] + row[bndap_d_start:bndap_d_end] + row[bndap_dd_start:bndap_dd_end])
+            mcep_dim = self.mcep_order + 1
+            bndap_dim = self.bndap_order
+            stride = mcep_dim + bndap_dim
 
             if mlpg:
                 self.log.debug('applying MLPG')
@@ -330,11 +551,15 @@ class TangleVoice:
                     mcep_pdf_file = False
                     bndap_pdf_file = False
 
-                mceps = self._apply_mlpg(mceps, 'mcep', mcep_pdf_file)
-                bndaps = self._apply_mlpg(bndaps, 'bndap', bndap_pdf_file)
+                # MLPG reads both streams straight from the one matrix
+                mat = pylib.PyKaldiMatrixBaseFloat_frmlist(acf)
+                mceps = self._apply_mlpg(mat, 'mcep', mcep_pdf_file,
+                                         0, mcep_dim, stride)
+                bndaps = self._apply_mlpg(mat, 'bndap', bndap_pdf_file,
+                                          mcep_dim, bndap_dim, stride)
             else:
-                mceps = [mrow[:self.mcep_order+1] for mrow in mceps]
-                bndaps = [brow[:self.bndap_order] for brow in bndaps]
+                mceps = [row[:mcep_dim] for row in acf]
+                bndaps = [row[mcep_dim:stride] for row in acf]
 
             # convert bndaps to decibels to be inline with other tools (predicted as log value)
             for fidx in range(len(bndaps)):
@@ -351,7 +576,7 @@ class TangleVoice:
     def vocode_acoustic_features(self, acoutic_features, pitch,
                                  mixed_excitation = True,
                                  save_residual_directory = False,
-                                 wav_filename = None):
+                                 wav_filename = None, by_spurt = False):
         """ Vocode the acoustic features using MLSA
 
             if mixed_excitation is set to False, then the residual is
@@ -359,13 +584,16 @@ class TangleVoice:
 
             if save_residual_directory is set then the by spurt residual will
                 be saved into that directory (used for debugging)
+
+            if by_spurt is set then an ordered dictionary of the waveform of
+                each spurt by spurt id is returned
         """
         if mixed_excitation:
             exc_type = vocoder.MCEPExcitation.MIXED
         else:
             exc_type = vocoder.MCEPExcitation.SPTK
 
-        waveform = []
+        spurts = []
         for spurtid in acoutic_features:
             mceps =  acoutic_features[spurtid]['mcep']
             bndaps = copy.copy(acoutic_features[spurtid]['bndap'])
@@ -377,8 +605,34 @@ class TangleVoice:
                     f0s.append(0.0)
                     for bidx in range(self.bndap_order):
                         bndaps[fidx][bidx] = 0.0
+            spurts.append((spurtid, mceps, f0s, bndaps))
+
+        if not (save_residual_directory and
+                os.path.isdir(save_residual_directory)):
+            # The spurts are independent so they are vocoded concurrently
+            noframes = sum(len(f0s) for _, _, f0s, _ in spurts)
+            with txp.stagestats.StageTimer('vocode', noframes, 'frames'):
+                waveforms = self._vocoder.vocode_spurts(
+                    [s[1:] for s in spurts], exc_type,
+                    num_threads = self.vocoder_threads, split = True)
+            waveform = []
+            for spurt_waveform in waveforms:
+                waveform.extend(spurt_waveform)
+            txp.stagestats.add_audio(len(waveform) / float(self.srate))
+            if wav_filename:
+                self.log.debug('saving to ' + wav_filename)
+                self._vocoder.to_wav(wav_filename, waveform)
+            if by_spurt:
+                return collections.OrderedDict(
+                    (s[0], w) for s, w in zip(spurts, waveforms))
+            return waveform
 
-            excitation = self._vocoder.gen_excitation(f0s, bndaps, exc_type)
+        waveform = []
+        waveforms = collections.OrderedDict()
+        for spurtid, mceps, f0s, bndaps in spurts:
+            with txp.stagestats.StageTimer('excitation', len(f0s), 'frames'):
+                excitation = self._vocoder.gen_excitation(f0s, bndaps,
+                                                          exc_type)
             if os.path.isdir(save_residual_directory):
                 residualfile = os.path.join(save_residual_directory, spurtid + '.res')
                 with open(residualfile, 'w') as fout:
@@ -386,13 +640,19 @@ class TangleVoice:
                         return '{0:.5f}'.format(v)
                     fout.write('\n'.join(map(_tostr, excitation)))
                     fout.write('\n')
-            spurt_waveform = self._vocoder.apply_mlsa(mceps, excitation)
+            with txp.stagestats.StageTimer('mlsa', len(excitation),
+                                           'samples'):
+                spurt_waveform = self._vocoder.apply_filter(mceps, excitation)
             waveform.extend(spurt_waveform)
+            waveforms[spurtid] = spurt_waveform
+        txp.stagestats.add_audio(len(waveform) / float(self.srate))
 
         if wav_filename:
             self.log.debug('saving to ' + wav_filename)
             self._vocoder.to_wav(wav_filename, waveform)
 
+        if by_spurt:
+            return waveforms
         return waveform
 
 
@@ -451,6 +711,9 @@ class TangleVoice:
     def fshift(self):
         return self._fshift
     @property
+    def synthesis(self):
+        return self._synthesis
+    @property
     def voicedir(self):
         return self._voicedir
 
@@ -485,6 +748,7 @@ class TangleVoice:
             self.log.critical(msg)
             raise IOError(msg)
         self._cexfreqtable = gen.load_cexfreqtable(cexfreqtable)
+        self.ContextExtraction.set_dnn_encoding(self._cexfreqtable)
         self._durmodel = self._load_dnn(join(self._voicedir, 'dur'))
         self._pitchmodel = self._load_dnn(join(self._voicedir, 'pitch'))
         self._acousticmodel = self._load_dnn(join(self._voicedir, 'acoustic'))
@@ -546,6 +810,9 @@ class TangleVoice:
                                             alpha  = self.alpha,
                                             fftlen = self.fftlen,
                                             fshift = self.fshift)
+        self._vocoder.synthesis = self.synthesis
+        # the overlap-add synthesis can use the GPU the DNNs use
+        self._vocoder.use_gpu = self.use_gpu != 'no'
 
 
     def _load_dnn(self, dnndir):
@@ -588,7 +855,8 @@ class TangleVoice:
         # Global CMVN options
 
 
-        return gen.NNet(nnet_model_fn, feat_transform_fn, **kwargs)
+        return gen.NNet(nnet_model_fn, feat_transform_fn,
+                        use_gpu = self.use_gpu, **kwargs)
 
 
     def _load_float_file(self, fname):
@@ -605,120 +873,96 @@ class TangleVoice:
         return ret
 
 
-    def _add_state_feature(self, spurtfeatures):
-        """ Takes the features from context,
-            and generates features with state info """
-        statedfeatures = []
-        for row in spurtfeatures:
-            statedfeatures.extend([row + [s] for s in range(self.NumStates)])
-        return statedfeatures
-
+    def _fuzzy_position(self, fuzzy_factor, position, duration):
+        real_position = position / duration
+        fuzzy_pos =  math.ceil(real_position / fuzzy_factor)
+        return fuzzy_pos
 
-    def _post_duration_processing(self, durmatrix):
-        """ Final processing of state durations
 
-            The first column of the predicted values is the state duration in
-            miliseconds, and the second is the total phone duration.
+    def _apply_mlpg(self, mat, name, pdffile, offset, order, stride):
+        """ Apply MLPG
 
-            The post processing will average the prediction of the phones,
-            avarage that with the total state duration. We then rescale the
-            phones to match this avarage duration, and convert to frames.
-            Finally the first and last states are modified so that they have at
-            least one frame.
+            mat is the kaldi matrix of the DNN outputs, the stream's static
+            means start at column offset and the deltas and double deltas
+            are each stride columns on
         """
-        Sidx = 0 # state duration column = 0
-        Pidx = 1 # phone duration column = 1
-        N = self.NumStates
-        state_durations = []
-        predict_indices = range(0, len(durmatrix), N)
-        for phone_idx, predict_idx in enumerate(predict_indices):
-            pred_idx_range = range(predict_idx, predict_idx + N)
-            phn_state_durs = [max(durmatrix[p][Sidx],0) for p in pred_idx_range]
-
-            mean_phn = sum([durmatrix[p][Pidx] for p in pred_idx_range]) / N
-            mean_phn = max(mean_phn, 0)
-            t_state_dur = sum(phn_state_durs)
-
-            # if all the state durations are zero then just set the first
-            # and last to 1 and avoid a div by zero
-            if t_state_dur > 0. and mean_phn > 0.:
-                tgt_phone_dur = math.ceil((mean_phn + t_state_dur) / 2)
-                ratio = tgt_phone_dur / t_state_dur
-                for sidx in range(N):
-                    phn_state_durs[sidx] *= ratio
-                    phn_state_durs[sidx] = math.ceil(phn_state_durs[sidx])
-            else:
-                tgt_phone_dur = 0
-                msg = 'In phone: {0}'.format(phone_idx)
-                if t_state_dur == 0.:
-                    msg += 'All state have 0. duration'
-                if mean_phn == 0.:
-                    msg += 'Mean phone duration is 0.'
-                self.log.warn(msg)
+        if pdffile:
+            self._save_mlpg_pdf(mat, name, pdffile, offset, order, stride)
 
-            # Ensuring that the first and last state have at least 1 occupancy
-            # as they model the transitions
-            phn_state_durs[0] = max(phn_state_durs[0], 1)
-            phn_state_durs[N - 1] = max(phn_state_durs[N - 1], 1)
+        d1win, d2win = self._delta_windows[name]
+        num_frames = pylib.c_api.PyKaldiMatrixBaseFloat_layout(mat)[0]
+        with txp.stagestats.StageTimer('mlpg', num_frames, 'frames'):
+            output = vocoder.mlpg_matrix(mat, offset, order, stride,
+                                         self._variances[name],
+                                         d1win, d2win, fix_ends = True)
+        return pylib.PyKaldiMatrixBaseFloat_tolist(output)
+
+
+    def _save_mlpg_pdf(self, mat, name, pdffile, offset, order, stride):
+        """ Save the means and variances given to MLPG (for debugging), the
+            first and last frames have zero variance """
+        rows = pylib.PyKaldiMatrixBaseFloat_tolist(mat)
+        num_frames = len(rows)
+        variances = self._variances[name]
+        def _tostr(v):
+            return '{0:.5f}'.format(v)
+        with open(pdffile, 'w') as fout:
+            for fidx, row in enumerate(rows):
+                means = []
+                for w in range(3):
+                    start = offset + w * stride
+                    means.extend(row[start:start + order])
+                if fidx == 0 or fidx == num_frames - 1:
+                    var = [0.] * (3 * order)
+                else:
+                    var = variances
+                fout.write(' '.join(map(_tostr, means)))
+                fout.write(' ')
+                fout.write(' '.join(map(_tostr, var)))
+                fout.write('\n')
 
-            state_durations.append(phn_state_durs)
 
-        return state_durations
+class _StageError(object):
+    """ An exception raised in a pipeline stage, passed on to the end """
+    def __init__(self, error):
+        self.error = error
 
 
-    def _fuzzy_position(self, fuzzy_factor, position, duration):
-        real_position = position / duration
-        fuzzy_pos =  math.ceil(real_position / fuzzy_factor)
-        return fuzzy_pos
+_end_of_spurts = object()
 
 
-    def _apply_mlpg(self, matrix, name, pdffile):
-        """ Apply MLPG
-
-            Assume the order is a third of the matrix
-        """
-        num_frames = len(matrix)
-        order = len(matrix[0])//3
-
-        mean = []
-        mean_d = []
-        mean_dd = []
-        for frame in matrix:
-            mean.append(list(frame[:order]))
-            mean_d.append(list(frame[order:2*order]))
-            mean_dd.append(list(frame[2*order:]))
-
-        var = [self._variances[name][:order]] * num_frames
-        var_d = [self._variances[name][order:2*order]]  * num_frames
-        var_dd = [self._variances[name][2*order:]] * num_frames
-        var[0] = [0.]*order
-        var_d[0] = [0.]*order
-        var_dd[0] = [0.]*order
-        var[-1] = [0.]*order
-        var_d[-1] = [0.]*order
-        var_dd[-1] = [0.]*order
+def _put(outq, item, stop):
+    while not stop.is_set():
+        try:
+            outq.put(item, timeout = 0.1)
+            return True
+        except queue.Full:
+            continue
+    return False
 
-        if pdffile:
-            with open(pdffile, 'w') as fout:
-                for fidx in range(num_frames):
-                    def _tostr(v):
-                        return '{0:.5f}'.format(v)
-                    fout.write(' '.join(map(_tostr, mean[fidx])))
-                    fout.write(' ')
-                    fout.write(' '.join(map(_tostr, mean_d[fidx])))
-                    fout.write(' ')
-                    fout.write(' '.join(map(_tostr, mean_dd[fidx])))
-                    fout.write(' ')
-                    fout.write(' '.join(map(_tostr, var[fidx])))
-                    fout.write(' ')
-                    fout.write(' '.join(map(_tostr, var_d[fidx])))
-                    fout.write(' ')
-                    fout.write(' '.join(map(_tostr, var_dd[fidx])))
-                    fout.write('\n')
 
-        d1win, d2win = self._delta_windows[name]
-        output = vocoder.mlpg(mean, mean_d, mean_dd,
-                              var,  var_d,  var_dd,
-                              d1win, d2win,
-                              input_type = 0)
-        return output
+def _queue_items(inq, stop):
+    """ The items put in a pipeline queue up to the end of the spurts """
+    while not stop.is_set():
+        try:
+            item = inq.get(timeout = 0.1)
+        except queue.Empty:
+            continue
+        if item is _end_of_spurts:
+            return
+        yield item
+
+
+def _run_stage(stage, source, outq, stop):
+    """ Runs a stage of synthesise_spurts over the items from source """
+    try:
+        for item in source:
+            if isinstance(item, _StageError):
+                _put(outq, item, stop)
+                return
+            if not _put(outq, stage(item), stop):
+                return
+    except Exception as e:
+        _put(outq, _StageError(e), stop)
+        return
+    _put(outq, _end_of_spurts, stop)
@@ -19,9 +19,13 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+
 #include "rnnlm/rnnlm-compute-state.h"
 #include "nnet3/nnet-utils.h"
 #include "nnet3/nnet-compile-looped.h"
+#include "rnnlm/sampler.h"
+#include "rnnlm/sampling-lm.h"
 
 namespace kaldi {
 namespace rnnlm {
@@ -68,6 +72,57 @@ RnnlmComputeStateInfo::RnnlmComputeStateInfo(
     KALDI_VLOG(3) << "Computation is:";
     computation.Print(std::cerr, rnnlm);
   }
+
+  if (opts.normalize_probs && opts.normalize_num_samples > 0)
+    SampleNormalizationWords();
+}
+
+void RnnlmComputeStateInfo::SampleNormalizationWords() {
+  if (opts.normalize_sampling_lm.empty())
+    KALDI_ERR << "--normalize-probs-num-samples requires "
+              << "--normalize-probs-sampling-lm";
+  SamplingLm sampling_lm;
+  ReadKaldiObject(opts.normalize_sampling_lm, &sampling_lm);
+  std::vector<BaseFloat> unigram_probs(
+      sampling_lm.GetUnigramDistribution());
+  int32 vocab_size = word_embedding_mat.NumRows();
+  if (unigram_probs.size() > static_cast<size_t>(vocab_size))
+    KALDI_ERR << "The sampling LM has words up to "
+              << (unigram_probs.size() - 1) << " but the vocabulary size is "
+              << vocab_size;
+  unigram_probs.resize(vocab_size, 0.0);
+  unigram_probs[0] = 0.0;  // <eps> is never sampled.
+  int32 num_nonzero = 0;
+  for (int32 i = 0; i < vocab_size; i++)
+    if (unigram_probs[i] > 0.0)
+      num_nonzero++;
+  if (opts.normalize_num_samples >= num_nonzero) {
+    KALDI_WARN << "--normalize-probs-num-samples=" << opts.normalize_num_samples
+               << " is not less than the number of words with nonzero "
+               << "unigram probabilities, " << num_nonzero
+               << "; normalizing over the whole vocabulary.";
+    return;
+  }
+
+  Sampler sampler(unigram_probs);
+  std::vector<std::pair<int32, BaseFloat> > higher_order_probs, sample;
+  sampler.SampleWords(opts.normalize_num_samples, 1.0, higher_order_probs,
+                      &sample);
+  std::sort(sample.begin(), sample.end());
+  int32 num_samples = sample.size();
+  std::vector<int32> words(num_samples);
+  Vector<BaseFloat> log_weights(num_samples);
+  for (int32 i = 0; i < num_samples; i++) {
+    words[i] = sample[i].first;
+    log_weights(i) = -log(sample[i].second);
+  }
+  CuArray<int32> cu_words(words);
+  normalization_embedding_mat.Resize(num_samples, word_embedding_mat.NumCols(),
+                                     kUndefined);
+  normalization_embedding_mat.CopyRows(word_embedding_mat, cu_words);
+  normalization_log_weights = log_weights;
+  KALDI_LOG << "Estimating the normalizer from " << num_samples
+            << " sampled words out of " << vocab_size;
 }
 
 RnnlmComputeState::RnnlmComputeState(const RnnlmComputeStateInfo &info,
@@ -92,21 +147,69 @@ RnnlmComputeState* RnnlmComputeState::GetSuccessorState(int32 next_word) const {
   return ans;
 }
 
+RnnlmComputeState* RnnlmComputeState::GetSuccessorStateUnnormalized(
+    int32 next_word) const {
+  KALDI_ASSERT(next_word > 0 && next_word < info_.word_embedding_mat.NumRows());
+  RnnlmComputeState *ans = new RnnlmComputeState(*this);
+  ans->previous_word_ = next_word;
+  ans->AdvanceChunk();
+  return ans;
+}
+
 void RnnlmComputeState::AddWord(int32 word_index) {
   KALDI_ASSERT(word_index > 0 && word_index < info_.word_embedding_mat.NumRows());
   previous_word_ = word_index;
   AdvanceChunk();
 
-  const CuMatrix<BaseFloat> &word_embedding_mat = info_.word_embedding_mat;
-  if (info_.opts.normalize_probs) {
-    CuVector<BaseFloat> log_probs(info_.word_embedding_mat.NumRows());
+  if (info_.opts.normalize_probs)
+    ComputeNormalizationFactor();
+}
 
-    log_probs.AddMatVec(1.0, word_embedding_mat, kNoTrans,
-                        predicted_word_embedding_->Row(0), 0.0);
-    log_probs.ApplyExp();
+void RnnlmComputeState::ComputeNormalizationFactor() {
+  std::vector<RnnlmComputeState*> states(1, this);
+  ComputeNormalizationFactors(states);
+}
 
-    // We excluding the <eps> symbol which is always 0.
-    normalization_factor_ = log(log_probs.Range(1, log_probs.Dim() - 1).Sum());
+void RnnlmComputeState::ComputeNormalizationFactors(
+    const std::vector<RnnlmComputeState*> &states) {
+  if (states.empty() || !states[0]->info_.opts.normalize_probs)
+    return;
+  const RnnlmComputeStateInfo &info = states[0]->info_;
+  // With a sample of words, the normalizer is estimated as the sum over them
+  // of exp(score) / (inclusion probability) (as in training); otherwise it is
+  // the sum over the vocabulary, excluding the <eps> symbol which is always 0.
+  bool sampled = (info.normalization_embedding_mat.NumRows() != 0);
+  const CuMatrix<BaseFloat> &embedding_mat = (sampled ?
+      info.normalization_embedding_mat : info.word_embedding_mat);
+  int32 num_words = embedding_mat.NumRows(),
+      embedding_dim = embedding_mat.NumCols(),
+      first_word = (sampled ? 0 : 1),
+      num_states = states.size();
+  // The log-probs are worked out for at most this many states at a time, to
+  // keep the matrix of them to about 64MB however large the vocabulary.
+  int32 max_batch_size = std::max<int32>(1, (1 << 24) / num_words);
+  for (int32 begin = 0; begin < num_states; begin += max_batch_size) {
+    int32 this_batch_size = std::min(max_batch_size, num_states - begin);
+    CuMatrix<BaseFloat> predicted_embeddings(this_batch_size, embedding_dim,
+                                             kUndefined);
+    for (int32 i = 0; i < this_batch_size; i++) {
+      const RnnlmComputeState *state = states[begin + i];
+      KALDI_ASSERT(&(state->info_) == &info);
+      predicted_embeddings.Row(i).CopyFromVec(
+          state->predicted_word_embedding_->Row(0));
+    }
+    CuMatrix<BaseFloat> log_probs(this_batch_size, num_words, kUndefined);
+    log_probs.AddMatMat(1.0, predicted_embeddings, kNoTrans,
+                        embedding_mat, kTrans, 0.0);
+    if (sampled)
+      log_probs.AddVecToRows(1.0, info.normalization_log_weights);
+    log_probs.ApplyExp();
+    CuVector<BaseFloat> sums(this_batch_size);
+    sums.AddColSumMat(1.0, log_probs.ColRange(first_word,
+                                              num_words - first_word), 0.0);
+    Vector<BaseFloat> sums_cpu(sums);
+    for (int32 i = 0; i < this_batch_size; i++)
+      states[begin + i]->normalization_factor_ = log(sums_cpu(i));
   }
 }
 
@@ -22,6 +22,7 @@
 #ifndef KALDI_RNNLM_COMPUTE_STATE_H_
 #define KALDI_RNNLM_COMPUTE_STATE_H_
 
+#include <string>
 #include <vector>
 #include "base/kaldi-common.h"
 #include "nnet3/nnet-optimize.h"
@@ -35,6 +36,10 @@ namespace rnnlm {
 struct RnnlmComputeStateComputationOptions {
   bool debug_computation;
   bool normalize_probs;
+  // If >0 (with normalize_probs), estimate the normalizer from this many words
+  // sampled from the unigram distribution of normalize_sampling_lm.
+  int32 normalize_num_samples;
+  std::string normalize_sampling_lm;
   // We need this when we initialize the RnnlmComputeState and pass the BOS history.
   int32 bos_index;
   // We need this to compute the Final() cost of a state.
@@ -46,6 +51,7 @@ struct RnnlmComputeStateComputationOptions {
   RnnlmComputeStateComputationOptions():
       debug_computation(false),
       normalize_probs(false),
+      normalize_num_samples(0),
       bos_index(-1),
       eos_index(-1),
       brk_index(-1)
@@ -57,6 +63,17 @@ struct RnnlmComputeStateComputationOptions {
     opts->Register("normalize-probs", &normalize_probs, "If true, word "
        "probabilities will be correctly normalized (otherwise the sum-to-one "
        "normalization is approximate)");
+    opts->Register("normalize-probs-num-samples", &normalize_num_samples,
+       "If >0, with --normalize-probs=true, the normalizer of each history "
+       "is estimated from this many words sampled from the unigram "
+       "distribution of --normalize-probs-sampling-lm, rather than summed "
+       "over the whole vocabulary.  Much faster for large vocabularies; "
+       "a few thousand samples is typical.");
+    opts->Register("normalize-probs-sampling-lm", &normalize_sampling_lm,
+       "With --normalize-probs-num-samples, the sampling LM the RNNLM was "
+       "trained with (e.g. exp/rnnlm/sampling.lm, as written by "
+       "rnnlm-get-sampling-lm), whose unigram distribution the words are "
+       "sampled from.");
     opts->Register("bos-symbol", &bos_index, "Index in wordlist representing "
                    "the begin-of-sentence symbol");
     opts->Register("eos-symbol", &eos_index, "Index in wordlist representing "
@@ -93,6 +110,18 @@ class RnnlmComputeStateInfo  {
 
   // The compiled, 'looped' computation.
   nnet3::NnetComputation computation;
+
+  // If opts.normalize_num_samples > 0: the embeddings of the sampled words
+  // the normalizer is estimated from, and the logs of the inverses of the
+  // probabilities with which they were included in the sample.  The sample
+  // is drawn once, so the scores of a history are the same every time.
+  // Otherwise these are empty and the normalizer is exact.
+  CuMatrix<BaseFloat> normalization_embedding_mat;
+  CuVector<BaseFloat> normalization_log_weights;
+
+ private:
+  // Draws the sample of words for estimating the normalizer.
+  void SampleNormalizationWords();
 };
 
 /*
@@ -113,6 +142,21 @@ class RnnlmComputeState {
   /// The pointer is owned by the caller.
   RnnlmComputeState* GetSuccessorState(int32 next_word) const;
 
+  /// As GetSuccessorState(), but if opts.normalize_probs is set the state's
+  /// normalization factor is not worked out; ComputeNormalizationFactors()
+  /// must be called on it before LogProbOfWord() or GetLogProbOfWords().
+  RnnlmComputeState* GetSuccessorStateUnnormalized(int32 next_word) const;
+
+  /// Works out the normalization factors of states from
+  /// GetSuccessorStateUnnormalized(), which must all have the same
+  /// RnnlmComputeStateInfo, together: the log-probs of all words for many
+  /// states are one matrix multiplication with the word-embedding matrix
+  /// rather than a matrix-vector product per state, which is most of the time
+  /// taken with a large vocabulary, and on a GPU is one kernel launch and
+  /// copy-back for the batch.  Does nothing unless opts.normalize_probs.
+  static void ComputeNormalizationFactors(
+      const std::vector<RnnlmComputeState*> &states);
+
   /// Return the log-prob that the model predicts for the provided word-index,
   /// given the previous history determined by the sequence of calls to AddWord()
   /// (implicitly starting with the BOS symbol).
@@ -129,6 +173,9 @@ class RnnlmComputeState {
   /// This function does the computation for the next chunk.
   void AdvanceChunk();
 
+  /// Works out normalization_factor_ for the current predicted embedding.
+  void ComputeNormalizationFactor();
+
   const RnnlmComputeStateInfo &info_;
   nnet3::NnetComputer computer_;
   int32 previous_word_;
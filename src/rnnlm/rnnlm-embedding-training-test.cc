@@ -0,0 +1,106 @@
+// rnnlm/rnnlm-embedding-training-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rnnlm/rnnlm-embedding-training.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+namespace rnnlm {
+
+// Checks that training a subset of the rows with momentum, with the momentum
+// of the other rows applied lazily, gives the same result as training the
+// whole matrix with a derivative that is zero outside the subset.
+void UnitTestEmbeddingTrainerLazyMomentum() {
+  int32 num_rows = 20 + RandInt(0, 50), dim = 1 + RandInt(0, 10),
+      num_minibatches = 10 + RandInt(0, 10);
+  RnnlmEmbeddingTrainerOptions config;
+  config.momentum = 0.5 + 0.4 * RandUniform();
+  config.use_natural_gradient = false;
+  config.max_param_change = 0.0;
+  config.learning_rate = 0.1;
+  if (RandInt(0, 1) == 0)
+    config.l2_regularize = 0.01;
+
+  CuMatrix<BaseFloat> embedding_sparse(num_rows, dim);
+  embedding_sparse.SetRandn();
+  CuMatrix<BaseFloat> embedding_dense(embedding_sparse);
+  {
+    RnnlmEmbeddingTrainer trainer_sparse(config, &embedding_sparse),
+        trainer_dense(config, &embedding_dense);
+    for (int32 n = 0; n < num_minibatches; n++) {
+      std::vector<int32> active_words;
+      for (int32 i = 0; i < num_rows; i++)
+        if (RandInt(0, 3) == 0)
+          active_words.push_back(i);
+      if (active_words.empty())
+        active_words.push_back(RandInt(0, num_rows - 1));
+      CuArray<int32> active_words_cuda(active_words);
+
+      // The rows we use have to be the same.
+      trainer_sparse.ApplyPendingMomentum(active_words_cuda);
+      CuMatrix<BaseFloat> rows_sparse(active_words.size(), dim),
+          rows_dense(active_words.size(), dim);
+      rows_sparse.CopyRows(embedding_sparse, active_words_cuda);
+      rows_dense.CopyRows(embedding_dense, active_words_cuda);
+      AssertEqual(rows_sparse, rows_dense);
+
+      CuMatrix<BaseFloat> deriv_sparse(active_words.size(), dim),
+          deriv_dense(num_rows, dim);
+      deriv_sparse.SetRandn();
+      deriv_sparse.AddToRows(1.0, active_words_cuda, &deriv_dense);
+      if (config.l2_regularize > 0.0) {
+        // the l2 term of the dense version is only the same on the active rows.
+        CuMatrix<BaseFloat> l2_correction(embedding_dense);
+        l2_correction.Scale(2.0 * config.l2_regularize);
+        CuMatrix<BaseFloat> active_rows(active_words.size(), dim);
+        active_rows.CopyRows(l2_correction, active_words_cuda);
+        active_rows.AddToRows(-1.0, active_words_cuda, &l2_correction);
+        deriv_dense.AddMat(1.0, l2_correction);
+      }
+      trainer_sparse.Train(active_words_cuda, &deriv_sparse);
+      trainer_dense.Train(&deriv_dense);
+    }
+    // The destructors apply the pending momentum.
+  }
+  AssertEqual(embedding_sparse, embedding_dense);
+}
+
+}  // namespace rnnlm
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::rnnlm;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    CuDevice::Instantiate().SetDebugStrideMode(true);
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("yes");
+#endif
+    for (int32 i = 0; i < 10; i++)
+      UnitTestEmbeddingTrainerLazyMomentum();
+  }
+#if HAVE_CUDA == 1
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -68,6 +68,9 @@ void RnnlmEmbeddingTrainer::SetNaturalGradientOptions() {
 void RnnlmEmbeddingTrainer::Train(
     CuMatrixBase<BaseFloat> *embedding_deriv) {
 
+  if (config_.momentum > 0.0)
+    ApplyPendingMomentum();
+
   // If relevant, do the following:
   // "embedding_deriv += - 2 * l2_regularize * embedding_mat_"
   // This is an approximate to the regular l2 regularization (add l2 regularization
@@ -168,6 +171,14 @@ void RnnlmEmbeddingTrainer::Train(
 
   KALDI_ASSERT(active_words.Dim() == embedding_deriv->NumRows());
 
+  std::vector<int32> active_words_cpu;
+  if (config_.momentum > 0.0) {
+    active_words.CopyToVec(&active_words_cpu);
+    if (momentum_minibatch_.empty())
+      momentum_minibatch_.resize(embedding_mat_->NumRows(), num_minibatches_);
+    ApplyPendingMomentum(active_words_cpu);
+  }
+
   // If relevant, do the following:
   // "embedding_deriv += - 2 * l2_regularize * embedding_mat_"
   // This is an approximate to the regular l2 regularization (add l2 regularization
@@ -204,9 +215,17 @@ void RnnlmEmbeddingTrainer::Train(
     // effective learning rate due to the geometric sum of (1 + momentum +
     // momentum^2, ...).
     scale *= (1.0 - config_.momentum);
+    // Only the rows of the active words are updated; the others have their
+    // momentum applied lazily (see ApplyPendingMomentum()).
     embedding_deriv->AddToRows(scale, active_words, &embedding_mat_momentum_);
-    embedding_mat_->AddMat(1.0, embedding_mat_momentum_);
-    embedding_mat_momentum_.Scale(config_.momentum);
+    CuMatrix<BaseFloat> momentum_rows(active_words.Dim(),
+                                      embedding_mat_->NumCols(), kUndefined);
+    momentum_rows.CopyRows(embedding_mat_momentum_, active_words);
+    momentum_rows.AddToRows(1.0, active_words, embedding_mat_);
+    momentum_rows.AddToRows(config_.momentum - 1.0, active_words,
+                            &embedding_mat_momentum_);
+    for (size_t i = 0; i < active_words_cpu.size(); i++)
+      momentum_minibatch_[active_words_cpu[i]] = num_minibatches_;
   } else {
     embedding_deriv->AddToRows(scale, active_words, embedding_mat_);
   }
@@ -262,7 +281,68 @@ void RnnlmEmbeddingTrainer::TrainBackstitch(
   embedding_deriv->AddToRows(scale, active_words, embedding_mat_);
 }
 
+void RnnlmEmbeddingTrainer::ApplyPendingMomentum(
+    const CuArrayBase<int32> &rows) {
+  if (momentum_minibatch_.empty())
+    return;
+  std::vector<int32> rows_cpu;
+  rows.CopyToVec(&rows_cpu);
+  ApplyPendingMomentum(rows_cpu);
+}
+
+void RnnlmEmbeddingTrainer::ApplyPendingMomentum() {
+  if (momentum_minibatch_.empty())
+    return;
+  std::vector<int32> rows(embedding_mat_->NumRows());
+  for (size_t i = 0; i < rows.size(); i++)
+    rows[i] = i;
+  ApplyPendingMomentum(rows);
+  momentum_minibatch_.clear();
+}
+
+void RnnlmEmbeddingTrainer::ApplyPendingMomentum(
+    const std::vector<int32> &rows) {
+  // In each minibatch in which a row has a zero derivative, the update is
+  // "embedding += momentum_mat; momentum_mat *= momentum", so after k of them
+  // the embedding has had momentum_mat * (1 + momentum + ... momentum^(k-1))
+  // added to it, and momentum_mat has been scaled by momentum^k.
+  std::vector<int32> pending_rows;
+  std::vector<BaseFloat> embedding_scales, momentum_scales;
+  BaseFloat momentum = config_.momentum;
+  for (size_t i = 0; i < rows.size(); i++) {
+    int32 row = rows[i],
+        num_missed = num_minibatches_ - momentum_minibatch_[row];
+    if (num_missed > 0) {
+      BaseFloat momentum_power = std::pow(momentum, num_missed);
+      pending_rows.push_back(row);
+      embedding_scales.push_back((1.0 - momentum_power) / (1.0 - momentum));
+      momentum_scales.push_back(momentum_power - 1.0);
+      momentum_minibatch_[row] = num_minibatches_;
+    }
+  }
+  if (pending_rows.empty())
+    return;
+  int32 num_rows = pending_rows.size();
+  CuArray<int32> pending_rows_cuda(pending_rows);
+  CuVector<BaseFloat> embedding_scales_cuda(num_rows, kUndefined),
+      momentum_scales_cuda(num_rows, kUndefined);
+  embedding_scales_cuda.CopyFromVec(
+      SubVector<BaseFloat>(embedding_scales.data(), num_rows));
+  momentum_scales_cuda.CopyFromVec(
+      SubVector<BaseFloat>(momentum_scales.data(), num_rows));
+
+  CuMatrix<BaseFloat> momentum_rows(num_rows, embedding_mat_->NumCols(),
+                                    kUndefined);
+  momentum_rows.CopyRows(embedding_mat_momentum_, pending_rows_cuda);
+  CuMatrix<BaseFloat> embedding_delta(momentum_rows);
+  embedding_delta.MulRowsVec(embedding_scales_cuda);
+  embedding_delta.AddToRows(1.0, pending_rows_cuda, embedding_mat_);
+  momentum_rows.MulRowsVec(momentum_scales_cuda);
+  momentum_rows.AddToRows(1.0, pending_rows_cuda, &embedding_mat_momentum_);
+}
+
 RnnlmEmbeddingTrainer::~RnnlmEmbeddingTrainer() {
+  ApplyPendingMomentum();
   PrintStats();
 }
 
@@ -181,11 +181,33 @@ class RnnlmEmbeddingTrainer {
                        const CuArrayBase<int32> &active_words,
                        CuMatrixBase<BaseFloat> *word_embedding_deriv);
 
+  /* With momentum, Train() with 'active_words' updates only the rows of the
+     active words: the other rows are owed the momentum of the minibatches they
+     were not active in, and they get it when they are next active, or on
+     destruction.  This function brings the given rows up to date; it should be
+     called before those rows of the embedding matrix are used (e.g. for the
+     forward computation of the minibatch), so that the result is the same as
+     updating the whole matrix every minibatch.  Does nothing if momentum is 0.
+
+      @param [in] rows  A sorted, unique list of row indexes of the embedding
+                      matrix.
+  */
+  void ApplyPendingMomentum(const CuArrayBase<int32> &rows);
+
   ~RnnlmEmbeddingTrainer();
 
 
  private:
 
+  // Brings the momentum of the rows in 'rows' up to date: a row that missed k
+  // minibatches gets what those minibatches would have done to it with a zero
+  // derivative.
+  void ApplyPendingMomentum(const std::vector<int32> &rows);
+
+  // Brings all the rows up to date (this is done before an update of the whole
+  // matrix, and on destruction).
+  void ApplyPendingMomentum();
+
   // Sets options in the object 'preconditioner_', based on the config
   // (but not SetNumSamplesHistory(), we do that in the Train() functions because
   /// we don't have the right information at this point).
@@ -213,6 +235,11 @@ class RnnlmEmbeddingTrainer {
   // *embedding_mat*, and used for the decaying sum of deltas.
   CuMatrix<BaseFloat> embedding_mat_momentum_;
 
+  // Only if momentum is used and we have updated a subset of the rows: for
+  // each row of *embedding_mat_, the value of num_minibatches_ up to which its
+  // momentum has been applied.  Empty if all the rows are up to date.
+  std::vector<int32> momentum_minibatch_;
+
   // This is a copy of the 'embedding_mat' that we were initialized with,
   // which we keep around for purposes of printing stats at the end about how
   // much the matrix changed; we keep it in CPU memory in case GPU memory is a
@@ -19,6 +19,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <utility>
 
 #include "rnnlm/rnnlm-lattice-rescoring.h"
@@ -40,22 +41,54 @@ KaldiRnnlmDeterministicFst::~KaldiRnnlmDeterministicFst() {
 
 void KaldiRnnlmDeterministicFst::Clear() {
   // This function is similar to the destructor but we retain the 0-th entries
-  // in each map which corresponds to the <bos> state.
+  // in each map which corresponds to the <bos> state, and the most recently
+  // used of the other states that have been computed, up to
+  // max_cached_states_ of them.
+  num_cleared_++;
   int32 size = state_to_rnnlm_state_.size();
+  std::vector<std::pair<int32, StateId> > cached;  // (-last used, state).
   for (int32 i = 1; i < size; i++)
-    delete state_to_rnnlm_state_[i];
-  
-  state_to_rnnlm_state_.resize(1);
-  state_to_wseq_.resize(1);
+    if (state_to_rnnlm_state_[i] != NULL)
+      cached.push_back(std::pair<int32, StateId>(-state_last_used_[i], i));
+  if (cached.size() > static_cast<size_t>(max_cached_states_)) {
+    std::nth_element(cached.begin(), cached.begin() + max_cached_states_,
+                     cached.end());
+    for (size_t j = max_cached_states_; j < cached.size(); j++) {
+      delete state_to_rnnlm_state_[cached[j].second];
+      state_to_rnnlm_state_[cached[j].second] = NULL;
+    }
+    cached.resize(max_cached_states_);
+  }
+
+  // Renumber the states kept from 1, in their old order.
+  std::vector<StateId> kept(1, 0);
+  for (size_t j = 0; j < cached.size(); j++)
+    kept.push_back(cached[j].second);
+  std::sort(kept.begin() + 1, kept.end());
   wseq_to_state_.clear();
-  wseq_to_state_[state_to_wseq_[0]] = 0;
+  for (size_t j = 0; j < kept.size(); j++) {
+    StateId old_state = kept[j];
+    state_to_rnnlm_state_[j] = state_to_rnnlm_state_[old_state];
+    state_to_wseq_[j].swap(state_to_wseq_[old_state]);
+    state_last_used_[j] = state_last_used_[old_state];
+    wseq_to_state_[state_to_wseq_[j]] = j;
+  }
+  int32 num_kept = kept.size();
+  state_to_rnnlm_state_.resize(num_kept);
+  state_to_wseq_.resize(num_kept);
+  state_to_prev_.resize(num_kept);
+  state_last_used_.resize(num_kept);
+  pending_states_.clear();
 }
 
 KaldiRnnlmDeterministicFst::KaldiRnnlmDeterministicFst(int32 max_ngram_order,
-    const RnnlmComputeStateInfo &info) {
+    const RnnlmComputeStateInfo &info, int32 max_cached_states) {
+  KALDI_ASSERT(max_cached_states >= 0);
   max_ngram_order_ = max_ngram_order;
+  max_cached_states_ = max_cached_states;
   bos_index_ = info.opts.bos_index;
   eos_index_ = info.opts.eos_index;
+  num_cleared_ = 0;
 
   std::vector<Label> bos_seq;
   bos_seq.push_back(bos_index_);
@@ -65,23 +98,48 @@ KaldiRnnlmDeterministicFst::KaldiRnnlmDeterministicFst(int32 max_ngram_order,
   start_state_ = 0;
 
   state_to_rnnlm_state_.push_back(decodable_rnnlm);
+  state_to_prev_.push_back(std::pair<StateId, Label>(-1, 0));
+  state_last_used_.push_back(0);
 }
 
-fst::StdArc::Weight KaldiRnnlmDeterministicFst::Final(StateId s) {
+const RnnlmComputeState *KaldiRnnlmDeterministicFst::GetRnnlmState(
+    StateId s) {
   /// At this point, we have created the state.
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
+  if (state_to_rnnlm_state_[s] == NULL)
+    ComputePendingStates();
+  state_last_used_[s] = num_cleared_;
+  return state_to_rnnlm_state_[s];
+}
 
-  RnnlmComputeState* rnn = state_to_rnnlm_state_[s];
+void KaldiRnnlmDeterministicFst::ComputePendingStates() {
+  std::vector<RnnlmComputeState*> new_states;
+  new_states.reserve(pending_states_.size());
+  for (size_t i = 0; i < pending_states_.size(); i++) {
+    StateId s = pending_states_[i];
+    // A state only gets successors once it has been used, so the state it is
+    // computed from is not pending.
+    const RnnlmComputeState *prev_rnnlm =
+        state_to_rnnlm_state_[state_to_prev_[s].first];
+    KALDI_ASSERT(prev_rnnlm != NULL && state_to_rnnlm_state_[s] == NULL);
+    RnnlmComputeState *rnnlm =
+        prev_rnnlm->GetSuccessorStateUnnormalized(state_to_prev_[s].second);
+    state_to_rnnlm_state_[s] = rnnlm;
+    new_states.push_back(rnnlm);
+  }
+  RnnlmComputeState::ComputeNormalizationFactors(new_states);
+  pending_states_.clear();
+}
+
+fst::StdArc::Weight KaldiRnnlmDeterministicFst::Final(StateId s) {
+  const RnnlmComputeState* rnn = GetRnnlmState(s);
   return Weight(-rnn->LogProbOfWord(eos_index_));
 }
 
 bool KaldiRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
                                         fst::StdArc *oarc) {
-  /// At this point, we have created the state.
-  KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
-
+  const RnnlmComputeState* rnnlm = GetRnnlmState(s);
   std::vector<Label> word_seq = state_to_wseq_[s];
-  const RnnlmComputeState* rnnlm = state_to_rnnlm_state_[s];
 
   BaseFloat logprob = rnnlm->LogProbOfWord(ilabel);
 
@@ -101,11 +159,15 @@ bool KaldiRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
   typedef MapType::iterator IterType;
   std::pair<IterType, bool> result = wseq_to_state_.insert(wseq_state_pair);
 
-  // If the pair was just inserted, then also add it to state_to_* structures.
+  // If the pair was just inserted, then also add it to state_to_* structures;
+  // its RNNLM state is computed with the other pending states when it is
+  // first used.
   if (result.second == true) {
-    RnnlmComputeState *rnnlm2 = rnnlm->GetSuccessorState(ilabel);
+    pending_states_.push_back(state_to_wseq_.size());
     state_to_wseq_.push_back(word_seq);
-    state_to_rnnlm_state_.push_back(rnnlm2);
+    state_to_rnnlm_state_.push_back(NULL);
+    state_to_prev_.push_back(std::pair<StateId, Label>(s, ilabel));
+    state_last_used_.push_back(num_cleared_);
   }
 
   // Creates the arc.
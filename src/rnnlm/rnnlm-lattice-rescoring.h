@@ -23,6 +23,7 @@
 #define KALDI_RNNLM_RNNLM_LATTICE_RESCORING_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/kaldi-common.h"
@@ -33,6 +34,24 @@
 namespace kaldi {
 namespace rnnlm {
 
+/*
+  KaldiRnnlmDeterministicFst wraps the RNNLM as an on-demand FST whose states
+  are histories of at most max_ngram_order - 1 words.
+
+  The RNNLM state of a history is not computed when GetArc() first reaches it,
+  but when the history itself is first used (by GetArc() or Final()); then all
+  the histories reached so far that are still to do are computed together, so
+  the states composition has reached are a batch (see
+  RnnlmComputeState::ComputeNormalizationFactors()).  This computes the same
+  states as computing each at once would.
+
+  With max_cached_states > 0, Clear() keeps up to that many of the histories
+  (those used in the most recent lattices), so that the lattices of a job
+  share the RNNLM states of the histories they have in common, such as those
+  at the start of sentences.  As within a lattice, a history then has the
+  RNNLM state of the first longer history that reached it, so the scores
+  depend slightly on which lattices were rescored before.
+*/
 class KaldiRnnlmDeterministicFst
     : public fst::DeterministicOnDemandFst<fst::StdArc> {
  public:
@@ -42,9 +61,12 @@ class KaldiRnnlmDeterministicFst
 
   // Does not take ownership.
   KaldiRnnlmDeterministicFst(int32 max_ngram_order,
-      const RnnlmComputeStateInfo &info);
+                             const RnnlmComputeStateInfo &info,
+                             int32 max_cached_states = 0);
   ~KaldiRnnlmDeterministicFst();
 
+  // To be called between lattices: forgets the states, except the <bos> state
+  // and up to max_cached_states others.  The state-ids of those kept change.
   void Clear();
 
   // We cannot use "const" because the pure virtual function in the interface is
@@ -60,8 +82,17 @@ class KaldiRnnlmDeterministicFst
  private:
   typedef unordered_map
       <std::vector<Label>, StateId, VectorHasher<Label> > MapType;
+
+  // Returns the RNNLM state of state s, computing the pending states first if
+  // it is one of them.
+  const RnnlmComputeState *GetRnnlmState(StateId s);
+
+  // Computes the RNNLM states of pending_states_.
+  void ComputePendingStates();
+
   StateId start_state_;
   int32 max_ngram_order_;
+  int32 max_cached_states_;
   int32 bos_index_;
   int32 eos_index_;
 
@@ -70,10 +101,22 @@ class KaldiRnnlmDeterministicFst
   // Mapping from state-id to history sequence>
   std::vector<std::vector<Label> > state_to_wseq_;
 
-  // Mapping from state-id to RNNLM states.
+  // Mapping from state-id to RNNLM states; NULL for pending states.
   // The pointers are owned in this class
   std::vector<RnnlmComputeState*> state_to_rnnlm_state_;
 
+  // Mapping from state-id to the state and word its RNNLM state is to be
+  // computed from, for pending states.
+  std::vector<std::pair<StateId, Label> > state_to_prev_;
+
+  // The states whose RNNLM states are still to be computed, in order.
+  std::vector<StateId> pending_states_;
+
+  // The number of Clear() calls before the state was last used; with
+  // num_cleared_, for choosing the states Clear() keeps.
+  std::vector<int32> state_last_used_;
+  int32 num_cleared_;
+
 };
 
 }  // namespace rnnlm
@@ -25,6 +25,22 @@ namespace rnnlm {
 
 
 
+// Outputs the sorted, unique list of the features (i.e. the columns) that
+// appear in the rows of 'word_features'.
+static void GetActiveFeatures(const CuSparseMatrix<BaseFloat> &word_features,
+                              std::vector<int32> *active_features) {
+  SparseMatrix<BaseFloat> cpu_word_features;
+  word_features.CopyToSmat(&cpu_word_features);
+  active_features->clear();
+  for (int32 r = 0; r < cpu_word_features.NumRows(); r++) {
+    const SparseVector<BaseFloat> &row = cpu_word_features.Row(r);
+    for (int32 i = 0; i < row.NumElements(); i++)
+      active_features->push_back(row.GetElement(i).first);
+  }
+  SortAndUniq(active_features);
+}
+
+
 RnnlmTrainer::RnnlmTrainer(bool train_embedding,
                            const RnnlmCoreTrainerOptions &core_config,
                            const RnnlmEmbeddingTrainerOptions &embedding_config,
@@ -88,6 +104,8 @@ void RnnlmTrainer::Train(RnnlmExample *minibatch) {
   CuArray<int32> active_words_cuda;
   CuSparseMatrix<BaseFloat> active_word_features;
   CuSparseMatrix<BaseFloat> active_word_features_trans;
+  CuArray<int32> active_features_cuda;
+  CuSparseMatrix<BaseFloat> active_features_word_features_trans;
 
   if (!current_minibatch_.sampled_words.empty()) {
     std::vector<int32> active_words;
@@ -99,6 +117,13 @@ void RnnlmTrainer::Train(RnnlmExample *minibatch) {
                                       *word_feature_mat_);
       active_word_features_trans.CopyFromSmat(active_word_features,
                                               kTrans);
+      if (train_embedding_) {
+        std::vector<int32> active_features;
+        GetActiveFeatures(active_word_features, &active_features);
+        active_features_cuda.CopyFromVec(active_features);
+        active_features_word_features_trans.SelectRows(
+            active_features_cuda, active_word_features_trans);
+      }
     }
   }
   GetRnnlmExampleDerived(current_minibatch_, train_embedding_,
@@ -108,6 +133,9 @@ void RnnlmTrainer::Train(RnnlmExample *minibatch) {
   active_words_.Swap(&active_words_cuda);
   active_word_features_.Swap(&active_word_features);
   active_word_features_trans_.Swap(&active_word_features_trans);
+  active_features_.Swap(&active_features_cuda);
+  active_features_word_features_trans_.Swap(
+      &active_features_word_features_trans);
 
   TrainInternal();
 
@@ -133,6 +161,8 @@ void RnnlmTrainer::GetWordEmbedding(CuMatrix<BaseFloat> *word_embedding_storage,
       // There is sampling-- we're using a subset of the words so the user wants
       // an embedding matrix for just those rows.
       KALDI_ASSERT(active_words_.Dim() != 0);
+      if (embedding_trainer_)
+        embedding_trainer_->ApplyPendingMomentum(active_words_);
       word_embedding_storage->Resize(active_words_.Dim(),
                                      embedding_mat_->NumCols(),
                                      kUndefined);
@@ -144,6 +174,8 @@ void RnnlmTrainer::GetWordEmbedding(CuMatrix<BaseFloat> *word_embedding_storage,
     // feature-embedding matrix in order to get the word-embedding matrix.
     const CuSparseMatrix<BaseFloat> &word_feature_mat =
         sampling ? active_word_features_ : *word_feature_mat_;
+    if (sampling && embedding_trainer_)
+      embedding_trainer_->ApplyPendingMomentum(active_features_);
     word_embedding_storage->Resize(word_feature_mat.NumRows(),
                                    embedding_mat_->NumCols());
     word_embedding_storage->AddSmatMat(1.0, word_feature_mat, kNoTrans,
@@ -171,13 +203,27 @@ void RnnlmTrainer::TrainWordEmbedding(
     // There is a sparse word-feature matrix, so we need to multiply by it
     // to get the derivative w.r.t. the feature-embedding matrix.
 
-    if (!sampling && word_feature_mat_transpose_.NumRows() == 0)
+    if (sampling) {
+      // Only the features of the active words have a derivative, so we train
+      // just those rows of the feature-embedding matrix.
+      if (active_features_.Dim() == 0)
+        return;
+      CuMatrix<BaseFloat> feature_embedding_deriv(active_features_.Dim(),
+                                                  embedding_mat_->NumCols());
+      feature_embedding_deriv.AddSmatMat(
+          1.0, active_features_word_features_trans_, kNoTrans,
+          *word_embedding_deriv, 0.0);
+      embedding_trainer_->Train(active_features_, &feature_embedding_deriv);
+      return;
+    }
+
+    if (word_feature_mat_transpose_.NumRows() == 0)
       word_feature_mat_transpose_.CopyFromSmat(*word_feature_mat_, kTrans);
 
     CuMatrix<BaseFloat> feature_embedding_deriv(embedding_mat_->NumRows(),
                                                 embedding_mat_->NumCols());
     const CuSparseMatrix<BaseFloat> &word_features_trans =
-        (sampling ? active_word_features_trans_ : word_feature_mat_transpose_);
+        word_feature_mat_transpose_;
 
     feature_embedding_deriv.AddSmatMat(1.0, word_features_trans, kNoTrans,
                                        *word_embedding_deriv, 0.0);
@@ -210,13 +256,28 @@ void RnnlmTrainer::TrainBackstitchWordEmbedding(
     // There is a sparse word-feature matrix, so we need to multiply by it
     // to get the derivative w.r.t. the feature-embedding matrix.
 
-    if (!sampling && word_feature_mat_transpose_.NumRows() == 0)
+    if (sampling) {
+      // Only the features of the active words have a derivative, so we train
+      // just those rows of the feature-embedding matrix.
+      if (active_features_.Dim() == 0)
+        return;
+      CuMatrix<BaseFloat> feature_embedding_deriv(active_features_.Dim(),
+                                                  embedding_mat_->NumCols());
+      feature_embedding_deriv.AddSmatMat(
+          1.0, active_features_word_features_trans_, kNoTrans,
+          *word_embedding_deriv, 0.0);
+      embedding_trainer_->TrainBackstitch(is_backstitch_step1, active_features_,
+                                          &feature_embedding_deriv);
+      return;
+    }
+
+    if (word_feature_mat_transpose_.NumRows() == 0)
       word_feature_mat_transpose_.CopyFromSmat(*word_feature_mat_, kTrans);
 
     CuMatrix<BaseFloat> feature_embedding_deriv(embedding_mat_->NumRows(),
                                                 embedding_mat_->NumCols());
     const CuSparseMatrix<BaseFloat> &word_features_trans =
-        (sampling ? active_word_features_trans_ : word_feature_mat_transpose_);
+        word_feature_mat_transpose_;
 
     feature_embedding_deriv.AddSmatMat(1.0, word_features_trans, kNoTrans,
                                        *word_embedding_deriv, 0.0);
@@ -246,7 +307,7 @@ void RnnlmTrainer::TrainInternal() {
       num_minibatches_processed_ % core_config_.backstitch_training_interval ==
       srand_seed_ % core_config_.backstitch_training_interval) {
     bool is_backstitch_step1 = true;
-    srand(srand_seed_ + num_minibatches_processed_);
+    RandSeed(srand_seed_ + num_minibatches_processed_);
     core_trainer_->TrainBackstitch(is_backstitch_step1, current_minibatch_,
         derived_, *word_embedding,
         (train_embedding_ ? &word_embedding_deriv : NULL));
@@ -254,7 +315,7 @@ void RnnlmTrainer::TrainInternal() {
       TrainBackstitchWordEmbedding(is_backstitch_step1, &word_embedding_deriv);
 
     is_backstitch_step1 = false;
-    srand(srand_seed_ + num_minibatches_processed_);
+    RandSeed(srand_seed_ + num_minibatches_processed_);
     core_trainer_->TrainBackstitch(is_backstitch_step1, current_minibatch_,
         derived_, *word_embedding,
         (train_embedding_ ? &word_embedding_deriv : NULL));
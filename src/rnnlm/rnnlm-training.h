@@ -179,6 +179,14 @@ class RnnlmTrainer {
   // active_word_features_trans_ is the transpose of active_word_features_;
   // This is a derived quantity computed by the background thread.
   CuSparseMatrix<BaseFloat> active_word_features_trans_;
+  // Only if we are doing subsampling AND we have sparse word features AND we
+  // are training the embedding, active_features_ is the sorted list of the
+  // features that the active words have, i.e. the rows of the
+  // feature-embedding matrix that have a derivative in this minibatch.
+  CuArray<int32> active_features_;
+  // ... and active_features_word_features_trans_ contains just the rows of
+  // active_word_features_trans_ that are listed in active_features_.
+  CuSparseMatrix<BaseFloat> active_features_word_features_trans_;
 
   // This value is used in backstitch training when we need to ensure
   // consistent dropout masks.  It's set to a value derived from rand()
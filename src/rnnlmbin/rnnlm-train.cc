@@ -23,6 +23,7 @@
 #include "rnnlm/rnnlm-example-utils.h"
 #include "nnet3/nnet-utils.h"
 #include "cudamatrix/cu-allocator.h"
+#include "matrix/matrix-allocator.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -94,6 +95,7 @@ int main(int argc, char *argv[]) {
 
     objective_config.Register(&po);
     RegisterCuAllocatorOptions(&po);
+    RegisterMatrixAllocatorOptions(&po);
 
     // register the core RNNLM training options options with the prefix "rnnlm",
     // so they will appear as --rnnlm.max-change and the like.  This is done
@@ -189,6 +191,7 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    PrintMatrixAllocatorStats();
     return 0;
   } catch(const std::exception &e) {
     std::cerr << e.what() << '\n';
@@ -258,6 +258,59 @@ void TestSgmm2PreXform(const AmSgmm2 &sgmm) {
   KALDI_ASSERT(res_vec.IsZero(1.0e-5));
 }
 
+// Tests LogLikelihoods() against LogLikelihood() for each pdf, with a
+// two-level tree and speaker-dependent weights.
+void TestSgmm2LogLikelihoods(const kaldi::FullGmm &full_gmm) {
+  using namespace kaldi;
+  int32 dim = full_gmm.Dim(), num_groups = RandInt(1, 4);
+  std::vector<int32> pdf2group;
+  for (int32 j1 = 0; j1 < num_groups; j1++)
+    for (int32 n = RandInt(1, 3); n > 0; n--)
+      pdf2group.push_back(j1);
+  AmSgmm2 sgmm;
+  sgmm.InitializeFromFullGmm(full_gmm, pdf2group, dim + 1, dim, true, 0.9);
+  sgmm.ComputeNormalizers();
+  Sgmm2SplitSubstatesConfig split_config;
+  split_config.split_substates = 3 * sgmm.NumPdfs();
+  Vector<BaseFloat> occs(sgmm.NumPdfs());
+  occs.Set(100.0);
+  sgmm.SplitSubstates(occs, split_config);
+  sgmm.ComputeNormalizers();
+  sgmm.ComputeWeights();
+
+  Sgmm2PerSpkDerivedVars spk_vars;
+  {
+    Vector<BaseFloat> v_s(sgmm.SpkSpaceDim());
+    v_s.SetRandn();
+    spk_vars.SetSpeakerVector(v_s);
+    sgmm.ComputePerSpkDerivedVars(&spk_vars);
+  }
+  Sgmm2GselectConfig config;
+  config.full_gmm_nbest = std::min(config.full_gmm_nbest, sgmm.NumGauss());
+  Sgmm2LikelihoodCache cache1(sgmm.NumGroups(), sgmm.NumPdfs()),
+      cache2(sgmm.NumGroups(), sgmm.NumPdfs());
+  for (int32 t = 0; t < 5; t++) {
+    Vector<BaseFloat> feat(dim);
+    feat.SetRandn();
+    std::vector<int32> gselect;
+    sgmm.GaussianSelection(config, feat, &gselect);
+    Sgmm2PerFrameDerivedVars per_frame;
+    sgmm.ComputePerFrameVars(feat, gselect, spk_vars, &per_frame);
+    cache1.NextFrame();
+    cache2.NextFrame();
+    Vector<BaseFloat> loglikes;
+    sgmm.LogLikelihoods(per_frame, &cache2, &spk_vars, 1 + t % 3, &loglikes);
+    KALDI_ASSERT(loglikes.Dim() == sgmm.NumPdfs());
+    for (int32 j2 = 0; j2 < sgmm.NumPdfs(); j2++) {
+      AssertEqual(loglikes(j2),
+                  sgmm.LogLikelihood(per_frame, j2, &cache1, &spk_vars), 1e-4);
+      // cached by LogLikelihoods().
+      KALDI_ASSERT(sgmm.LogLikelihood(per_frame, j2, &cache2, &spk_vars) ==
+                   loglikes(j2));
+    }
+  }
+}
+
 void UnitTestSgmm2() {
   size_t dim = 1 + kaldi::RandInt(0, 9);  // random dimension of the gmm
   size_t num_comp = 1 + kaldi::RandInt(0, 9);  // random number of mixtures
@@ -275,6 +328,7 @@ void UnitTestSgmm2() {
   TestSgmm2Substates(sgmm);
   TestSgmm2IncreaseDim(sgmm);
   TestSgmm2PreXform(sgmm);
+  TestSgmm2LogLikelihoods(full_gmm);
 }
 
 int main() {
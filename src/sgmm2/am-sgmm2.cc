@@ -450,12 +450,9 @@ void AmSgmm2::ComputePerFrameVars(const VectorBase<BaseFloat> &data,
   per_frame_vars->gselect = gselect;
   per_frame_vars->xt.CopyFromVec(data);
 
-  for (int32 ki = 0, last = gselect.size(); ki < last; ki++) {
-    int32 i = gselect[ki];
-    per_frame_vars->xti.Row(ki).CopyFromVec(per_frame_vars->xt);
-    if (spk_vars.v_s.Dim() != 0)
-      per_frame_vars->xti.Row(ki).AddVec(-1.0, spk_vars.o_s.Row(i));
-  }
+  per_frame_vars->xti.CopyRowsFromVec(per_frame_vars->xt);
+  if (spk_vars.v_s.Dim() != 0 && !gselect.empty())
+    per_frame_vars->xti.AddRows(-1.0, spk_vars.o_s, &(gselect[0]));
   Vector<BaseFloat> SigmaInv_xt(FeatureDim());
 
   bool speaker_dep_weights =
@@ -492,13 +489,13 @@ void AmSgmm2::ComponentLogLikes(const Sgmm2PerFrameDerivedVars &per_frame_vars,
     KALDI_ASSERT(static_cast<int32>(w_jmi_.size()) == NumGroups() ||
                  "You need to call ComputeWeights().");
   }
-  for (int32 ki = 0;  ki < num_gselect; ki++) {
-    SubVector<BaseFloat> logp_xi(*loglikes, ki);
-    int32 i = gselect[ki];
-    // for all substates, compute z_{i}^T v_{jm}
-    logp_xi.AddMatVec(1.0, v_[j1], kNoTrans, per_frame_vars.zti.Row(ki), 0.0);
-    logp_xi.AddVec(1.0, n_[j1].Row(i));  // for all substates, add n_{jim}
-    logp_xi.Add(per_frame_vars.nti(ki));  // for all substates, add n_{i}(t)
+  if (num_gselect != 0) {
+    // for all selected Gaussians and substates, compute z_{i}^T v_{jm} (one
+    // matrix product rather than a matrix-vector product per Gaussian).
+    loglikes->AddMatMat(1.0, per_frame_vars.zti, kNoTrans, v_[j1], kTrans,
+                        0.0);
+    loglikes->AddRows(1.0, n_[j1], &(gselect[0]));  // add n_{jim}
+    loglikes->AddVecToCols(1.0, per_frame_vars.nti);  // add n_{i}(t)
   }
   if (speaker_dep_weights) { // [SSGMM]
     Vector<BaseFloat> &log_d = spk_vars->log_d_jms[j1];
@@ -544,18 +541,7 @@ BaseFloat AmSgmm2::LogLikelihood(const Sgmm2PerFrameDerivedVars &per_frame_vars,
       cache->substate_cache[j1];
   if (substate_cache.t != t) { // Need to compute sub-state likelihoods.
     substate_cache.t = t;
-    Matrix<BaseFloat> loglikes; // indexed [gselect-index][substate-index]
-    ComponentLogLikes(per_frame_vars, j1, spk_vars, &loglikes);
-    BaseFloat max = loglikes.Max(); // use this to keep things in good numerical range.
-    loglikes.Add(-max);
-    loglikes.ApplyExp();
-    substate_cache.remaining_log_like = max;
-    int32 num_substates = loglikes.NumCols();
-    substate_cache.likes.Resize(num_substates); // zeroes it.
-    substate_cache.likes.AddRowSumMat(1.0, loglikes); // add likelihoods [not in log!] for
-    // each column [i.e. summing over the rows], so we get the sum for
-    // each substate index.  You have to multiply by exp(remaining_log_like)
-    // to get a real likelihood.
+    ComputeSubstateLikes(per_frame_vars, j1, spk_vars, &substate_cache);
   }
 
   BaseFloat log_like = substate_cache.remaining_log_like
@@ -570,6 +556,96 @@ BaseFloat AmSgmm2::LogLikelihood(const Sgmm2PerFrameDerivedVars &per_frame_vars,
   return log_like;
 }
 
+void AmSgmm2::ComputeSubstateLikes(
+    const Sgmm2PerFrameDerivedVars &per_frame_vars,
+    int32 j1,
+    Sgmm2PerSpkDerivedVars *spk_vars,
+    Sgmm2LikelihoodCache::SubstateCacheElement *substate_cache) const {
+  Matrix<BaseFloat> loglikes; // indexed [gselect-index][substate-index]
+  ComponentLogLikes(per_frame_vars, j1, spk_vars, &loglikes);
+  BaseFloat max = loglikes.Max(); // use this to keep things in good numerical range.
+  loglikes.Add(-max);
+  loglikes.ApplyExp();
+  substate_cache->remaining_log_like = max;
+  int32 num_substates = loglikes.NumCols();
+  substate_cache->likes.Resize(num_substates); // zeroes it.
+  substate_cache->likes.AddRowSumMat(1.0, loglikes); // add likelihoods [not in log!] for
+  // each column [i.e. summing over the rows], so we get the sum for
+  // each substate index.  You have to multiply by exp(remaining_log_like)
+  // to get a real likelihood.
+}
+
+class ComputeLogLikelihoodsClass: public MultiThreadable { // For multi-threaded.
+ public:
+  ComputeLogLikelihoodsClass(const AmSgmm2 &am_sgmm,
+                             const Sgmm2PerFrameDerivedVars &per_frame_vars,
+                             Sgmm2LikelihoodCache *cache,
+                             Sgmm2PerSpkDerivedVars *spk_vars,
+                             Vector<BaseFloat> *loglikes):
+      am_sgmm_(am_sgmm), per_frame_vars_(per_frame_vars), cache_(cache),
+      spk_vars_(spk_vars), loglikes_(loglikes) { }
+
+  inline void operator() () {
+    // Each thread writes only the cache entries (and the speaker's log_d_jms
+    // entries) of its own groups, and the log-likes of their pdfs.
+    am_sgmm_.LogLikelihoodsInternal(per_frame_vars_, cache_, spk_vars_,
+                                    num_threads_, thread_id_, loglikes_);
+  }
+ private:
+  const AmSgmm2 &am_sgmm_;
+  const Sgmm2PerFrameDerivedVars &per_frame_vars_;
+  Sgmm2LikelihoodCache *cache_;
+  Sgmm2PerSpkDerivedVars *spk_vars_;
+  Vector<BaseFloat> *loglikes_;
+};
+
+void AmSgmm2::LogLikelihoods(const Sgmm2PerFrameDerivedVars &per_frame_vars,
+                             Sgmm2LikelihoodCache *cache,
+                             Sgmm2PerSpkDerivedVars *spk_vars,
+                             int32 num_threads,
+                             Vector<BaseFloat> *loglikes) const {
+  KALDI_ASSERT(static_cast<int32>(cache->pdf_cache.size()) == NumPdfs() &&
+               static_cast<int32>(cache->substate_cache.size()) == NumGroups());
+  loglikes->Resize(NumPdfs(), kUndefined);
+  if (spk_vars->v_s.Dim() != 0 && HasSpeakerDependentWeights())
+    KALDI_ASSERT(static_cast<int32>(spk_vars->log_d_jms.size()) == NumGroups());
+  ComputeLogLikelihoodsClass c(*this, per_frame_vars, cache, spk_vars,
+                               loglikes);
+  // num_threads == 0 makes MultiThreader run it in this thread.
+  MultiThreader<ComputeLogLikelihoodsClass> m(
+      std::min(num_threads <= 1 ? 0 : num_threads, NumGroups()), c);
+}
+
+void AmSgmm2::LogLikelihoodsInternal(
+    const Sgmm2PerFrameDerivedVars &per_frame_vars,
+    Sgmm2LikelihoodCache *cache,
+    Sgmm2PerSpkDerivedVars *spk_vars,
+    int32 num_threads, int32 thread,
+    Vector<BaseFloat> *loglikes) const {
+  int32 t = cache->t;
+  for (int32 j1 = thread; j1 < NumGroups(); j1 += num_threads) {
+    Sgmm2LikelihoodCache::SubstateCacheElement &substate_cache =
+        cache->substate_cache[j1];
+    if (substate_cache.t != t) {
+      substate_cache.t = t;
+      ComputeSubstateLikes(per_frame_vars, j1, spk_vars, &substate_cache);
+    }
+    const std::vector<int32> &pdfs = group2pdf_[j1];
+    for (size_t p = 0; p < pdfs.size(); p++) {
+      int32 j2 = pdfs[p];
+      Sgmm2LikelihoodCache::PdfCacheElement &pdf_cache = cache->pdf_cache[j2];
+      if (pdf_cache.t != t) {
+        pdf_cache.t = t;
+        pdf_cache.log_like = substate_cache.remaining_log_like
+            + Log(VecVec(substate_cache.likes, c_[j2]));
+        KALDI_ASSERT(pdf_cache.log_like == pdf_cache.log_like &&
+                     pdf_cache.log_like - pdf_cache.log_like == 0);
+      }
+      (*loglikes)(j2) = pdf_cache.log_like;
+    }
+  }
+}
+
 BaseFloat
 AmSgmm2::ComponentPosteriors(const Sgmm2PerFrameDerivedVars &per_frame_vars,
                             int32 j2,
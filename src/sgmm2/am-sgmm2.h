@@ -296,6 +296,18 @@ class AmSgmm2 {
                           Sgmm2LikelihoodCache *cache, // be careful to call NextFrame() when needed!
                           Sgmm2PerSpkDerivedVars *spk_vars,
                           BaseFloat log_prune = 0.0) const;
+
+  /// Computes the log-likelihoods of all pdfs for this frame into "loglikes"
+  /// (indexed by pdf-id j2; it is resized), storing them in "cache" so that
+  /// calls to LogLikelihood() for this frame are then just lookups.  The
+  /// groups of pdfs are shared out among "num_threads" threads; with
+  /// num_threads <= 1 it all runs in the calling thread.  As for
+  /// LogLikelihood(), call cache->NextFrame() first.
+  void LogLikelihoods(const Sgmm2PerFrameDerivedVars &per_frame_vars,
+                      Sgmm2LikelihoodCache *cache,
+                      Sgmm2PerSpkDerivedVars *spk_vars,
+                      int32 num_threads,
+                      Vector<BaseFloat> *loglikes) const;
   
   /// Similar to LogLikelihood() function above, but also computes the posterior
   /// probabilities for the pre-selected Gaussian components and all substates.
@@ -475,6 +487,22 @@ class AmSgmm2 {
                                 Sgmm2PerSpkDerivedVars *spk_vars,
                                 Matrix<BaseFloat> *loglikes) const;
 
+  /// Computes the sub-state likelihoods of group j1 into "substate_cache"
+  /// (called from LogLikelihood() and LogLikelihoods()).
+  void ComputeSubstateLikes(
+      const Sgmm2PerFrameDerivedVars &per_frame_vars,
+      int32 j1,
+      Sgmm2PerSpkDerivedVars *spk_vars,
+      Sgmm2LikelihoodCache::SubstateCacheElement *substate_cache) const;
+
+  /// The part of LogLikelihoods() done by one thread: the groups j1 with
+  /// j1 % num_threads == thread.
+  void LogLikelihoodsInternal(const Sgmm2PerFrameDerivedVars &per_frame_vars,
+                              Sgmm2LikelihoodCache *cache,
+                              Sgmm2PerSpkDerivedVars *spk_vars,
+                              int32 num_threads, int32 thread,
+                              Vector<BaseFloat> *loglikes) const;
+
   
   /// Initializes the matrices M_ and w_.
   void InitializeMw(int32 phn_subspace_dim,
@@ -498,6 +526,7 @@ class AmSgmm2 {
   
   KALDI_DISALLOW_COPY_AND_ASSIGN(AmSgmm2);
   friend class ComputeNormalizersClass;
+  friend class ComputeLogLikelihoodsClass;
   friend class Sgmm2Project;
   friend class EbwAmSgmm2Updater;
   friend class MleAmSgmm2Accs;
@@ -45,7 +45,12 @@ BaseFloat DecodableAmSgmm2::LogLikelihoodForPdf(int32 frame, int32 pdf_id) {
     
     sgmm_.ComputePerFrameVars(data, (*gselect_)[frame], *spk_,
                               &per_frame_vars_);
+    if (num_threads_ > 1)
+      sgmm_.LogLikelihoods(per_frame_vars_, &sgmm_cache_, spk_, num_threads_,
+                           &frame_loglikes_);
   }
+  if (num_threads_ > 1)
+    return frame_loglikes_(pdf_id);
   return sgmm_.LogLikelihood(per_frame_vars_, pdf_id, &sgmm_cache_, spk_,
                              log_prune_);  
 }
@@ -41,7 +41,8 @@ class DecodableAmSgmm2 : public DecodableInterface {
       sgmm_(sgmm), spk_(spk),
       trans_model_(tm), feature_matrix_(&feats),
       gselect_(&gselect), log_prune_(log_prune), cur_frame_(-1),
-      sgmm_cache_(sgmm.NumGroups(), sgmm.NumPdfs()), delete_vars_(false) {
+      sgmm_cache_(sgmm.NumGroups(), sgmm.NumPdfs()), num_threads_(1),
+      delete_vars_(false) {
     KALDI_ASSERT(gselect.size() == static_cast<size_t>(feats.NumRows()));
   }
 
@@ -56,7 +57,8 @@ class DecodableAmSgmm2 : public DecodableInterface {
       sgmm_(sgmm), spk_(spk),
       trans_model_(tm), feature_matrix_(feats),
       gselect_(gselect), log_prune_(log_prune), cur_frame_(-1),
-      sgmm_cache_(sgmm.NumGroups(), sgmm.NumPdfs()), delete_vars_(true) {
+      sgmm_cache_(sgmm.NumGroups(), sgmm.NumPdfs()), num_threads_(1),
+      delete_vars_(true) {
     KALDI_ASSERT(gselect->size() == static_cast<size_t>(feats->NumRows()));
   }
 
@@ -73,6 +75,12 @@ class DecodableAmSgmm2 : public DecodableInterface {
     return (frame == NumFramesReady() - 1);
   }
 
+  /// If num_threads > 1, the likelihoods of all pdfs are computed (using
+  /// that many threads) when a frame is first asked for, instead of one pdf
+  /// at a time as the decoder asks for them.  Worth it with wide beams, when
+  /// the decoder visits most of the pdfs on each frame anyway.
+  void SetNumThreads(int32 num_threads) { num_threads_ = num_threads; }
+
   virtual ~DecodableAmSgmm2();
  protected:
   virtual BaseFloat LogLikelihoodForPdf(int32 frame, int32 pdf_id);
@@ -88,6 +96,8 @@ class DecodableAmSgmm2 : public DecodableInterface {
   int32 cur_frame_;
   Sgmm2PerFrameDerivedVars per_frame_vars_;
   Sgmm2LikelihoodCache sgmm_cache_;
+  int32 num_threads_;
+  Vector<BaseFloat> frame_loglikes_;  // used if num_threads_ > 1.
 
   bool delete_vars_; // If true, we will delete feature_matrix_, gselect_, and
   // spk_ in the destructor.
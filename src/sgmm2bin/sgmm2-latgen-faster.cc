@@ -40,6 +40,7 @@ bool ProcessUtterance(LatticeFasterDecoder &decoder,
                       const TransitionModel &trans_model,
                       double log_prune,
                       double acoustic_scale,
+                      int32 num_threads,
                       const Matrix<BaseFloat> &features,
                       RandomAccessInt32VectorVectorReader &gselect_reader,
                       RandomAccessBaseFloatVectorReaderMapped &spkvecs_reader,
@@ -76,6 +77,7 @@ bool ProcessUtterance(LatticeFasterDecoder &decoder,
   
   DecodableAmSgmm2Scaled sgmm_decodable(am_sgmm, trans_model, features, gselect,
                                         log_prune, acoustic_scale, &spk_vars);
+  sgmm_decodable.SetNumThreads(num_threads);
 
   return DecodeUtteranceLatticeFaster(
       decoder, sgmm_decodable, trans_model, word_syms, utt, acoustic_scale,
@@ -101,6 +103,7 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 0.1;
     bool allow_partial = false;
     BaseFloat log_prune = 5.0;
+    int32 num_threads = 1;
     string word_syms_filename, gselect_rspecifier, spkvecs_rspecifier,
         utt2spk_rspecifier;
 
@@ -121,6 +124,9 @@ int main(int argc, char *argv[]) {
                 "rspecifier for speaker vectors");
     po.Register("utt2spk", &utt2spk_rspecifier,
                 "rspecifier for utterance to speaker map");
+    po.Register("num-threads", &num_threads, "If >1, compute the likelihoods "
+                "of all pdfs on each frame, using this many threads (can be "
+                "faster with wide beams)");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 6) {
@@ -200,6 +206,7 @@ int main(int argc, char *argv[]) {
           }
           double like;
           if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune, acoustic_scale,
+                               num_threads,
                                features, gselect_reader, spkvecs_reader, word_syms,
                                utt, determinize, allow_partial,
                                &alignment_writer, &words_writer, &compact_lattice_writer,
@@ -235,6 +242,7 @@ int main(int argc, char *argv[]) {
         double like;
 
         if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune, acoustic_scale,
+                             num_threads,
                              features, gselect_reader, spkvecs_reader, word_syms,
                              utt, determinize, allow_partial,
                              &alignment_writer, &words_writer, &compact_lattice_writer,
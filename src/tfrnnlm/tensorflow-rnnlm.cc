@@ -108,8 +108,10 @@ KaldiTfRnnlmWrapper::KaldiTfRnnlmWrapper(
     const std::string &rnn_wordlist,
     const std::string &word_symbol_table_rxfilename,
     const std::string &unk_prob_file,
-    const std::string &tf_model_path): opts_(opts) {
+    const std::string &tf_model_path): opts_(opts), cache_(NULL) {
   ReadTfModel(tf_model_path, opts.num_threads);
+  if (opts.cache_size > 0)
+    cache_ = new TfRnnlmHistoryCache(opts.cache_size);
 
   fst::SymbolTable *fst_word_symbols = NULL;
   if (!(fst_word_symbols =
@@ -215,6 +217,15 @@ BaseFloat KaldiTfRnnlmWrapper::GetLogProb(int32 word,
                                           const Tensor &cell_in,
                                           Tensor *context_out,
                                           Tensor *new_cell) {
+  return GetRnnLogProb(word, context_in, cell_in, context_out, new_cell) +
+      OosLogProb(word, fst_word);
+}
+
+BaseFloat KaldiTfRnnlmWrapper::GetRnnLogProb(int32 word,
+                                             const Tensor &context_in,
+                                             const Tensor &cell_in,
+                                             Tensor *context_out,
+                                             Tensor *new_cell) {
   std::vector<std::pair<string, Tensor> > inputs;
 
   Tensor thisword(tensorflow::DT_INT32, {1, 1});
@@ -256,18 +267,40 @@ BaseFloat KaldiTfRnnlmWrapper::GetLogProb(int32 word,
     }
   }
 
-  float ans;
-  if (word != oos_) {
-    ans = outputs[0].scalar<float>()();
-  } else {
-    if (unk_costs_.size() == 0) {
-      ans = outputs[0].scalar<float>()() - log(num_total_words - num_rnn_words);
-    } else {
-      ans = outputs[0].scalar<float>()() + unk_costs_[fst_word];
-    }
+  return outputs[0].scalar<float>()();
+}
+
+BaseFloat KaldiTfRnnlmWrapper::OosLogProb(int32 word, int32 fst_word) const {
+  if (word != oos_)
+    return 0.0;
+  if (unk_costs_.size() == 0)
+    return -log(num_total_words - num_rnn_words);
+  else
+    return unk_costs_[fst_word];
+}
+
+void KaldiTfRnnlmWrapper::GetNextState(int32 word,
+                                       const Tensor &context_in,
+                                       Tensor *context_out,
+                                       Tensor *new_cell) {
+  Tensor thisword(tensorflow::DT_INT32, {1, 1});
+  thisword.scalar<int32>()() = word;
+
+  std::vector<std::pair<string, Tensor> > inputs = {
+    {"Train/Model/test_word_in", thisword},
+    {"Train/Model/test_state_in", context_in},
+  };
+
+  std::vector<Tensor> outputs;
+  Status status = session_->Run(inputs,
+      {"Train/Model/test_state_out",
+       "Train/Model/test_cell_out"}, {}, &outputs);
+  if (!status.ok()) {
+    KALDI_ERR << status.ToString();
   }
 
-  return ans;
+  *context_out = outputs[0];
+  *new_cell = outputs[1];
 }
 
 const Tensor& KaldiTfRnnlmWrapper::GetInitialContext() const {
@@ -327,15 +360,35 @@ void TfRnnlmDeterministicFst::Clear() {
 }
 
 
+BaseFloat TfRnnlmDeterministicFst::GetRnnLogProb(StateId s, int32 rnn_word) {
+  TfRnnlmHistoryCache *cache = rnnlm_->GetCache();
+  TfRnnlmHistoryCache::Entry *entry = NULL;
+  if (cache != NULL) {
+    entry = cache->Find(state_to_wseq_[s]);
+    if (entry != NULL) {
+      std::unordered_map<int32, BaseFloat>::const_iterator iter =
+          entry->logprobs.find(rnn_word);
+      if (iter != entry->logprobs.end())
+        return iter->second;
+    }
+  }
+  BaseFloat logprob = rnnlm_->GetRnnLogProb(rnn_word,
+                                            *state_to_context_[s],
+                                            *state_to_cell_[s], NULL, NULL);
+  if (cache != NULL) {
+    if (entry == NULL)
+      entry = cache->Insert(state_to_wseq_[s], *state_to_context_[s],
+                            *state_to_cell_[s]);
+    entry->logprobs[rnn_word] = logprob;
+  }
+  return logprob;
+}
+
 fst::StdArc::Weight TfRnnlmDeterministicFst::Final(StateId s) {
   // At this point, we should have created the state.
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
 
-  std::vector<Label> wseq = state_to_wseq_[s];
-  BaseFloat logprob = rnnlm_->GetLogProb(rnnlm_->GetEos(),
-                         -1,  // only need type; this param will not be used
-                         *state_to_context_[s],
-                         *state_to_cell_[s], NULL, NULL);
+  BaseFloat logprob = GetRnnLogProb(s, rnnlm_->GetEos());
   return Weight(-logprob);
 }
 
@@ -344,17 +397,9 @@ bool TfRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
 
   std::vector<Label> wseq = state_to_wseq_[s];
-  Tensor *new_context = new Tensor();
-  Tensor *new_cell = new Tensor();
 
   // look-up the rnn label from the FST label
   int32 rnn_word = rnnlm_->FstLabelToRnnLabel(ilabel);
-  BaseFloat logprob = rnnlm_->GetLogProb(rnn_word,
-                                         ilabel,
-                                         *state_to_context_[s],
-                                         *state_to_cell_[s],
-                                         new_context,
-                                         new_cell);
 
   wseq.push_back(rnn_word);
   if (max_ngram_order_ > 0) {
@@ -364,29 +409,65 @@ bool TfRnnlmDeterministicFst::GetArc(StateId s, Label ilabel,
     }
   }
 
-  std::pair<const std::vector<Label>, StateId> wseq_state_pair(
-      wseq, static_cast<Label>(state_to_wseq_.size()));
-
-  // Attemps to insert the current <lseq_state_pair>. If the pair already exists
-  // then it returns false.
+  // The RNNLM is only run for what we do not have already: the state of the
+  // new history if it is neither a state of ours nor in the cache, and the
+  // probability of the word if it is not in the cache.  Both come from one
+  // session run.
   typedef MapType::iterator IterType;
-  std::pair<IterType, bool> result = wseq_to_state_.insert(wseq_state_pair);
-
-  // If the pair was just inserted, then also add it to <state_to_wseq_> and
-  // <state_to_context_>.
-  if (result.second == true) {
+  IterType iter = wseq_to_state_.find(wseq);
+  BaseFloat logprob;
+  if (iter == wseq_to_state_.end()) {
+    Tensor *new_context = new Tensor();
+    Tensor *new_cell = new Tensor();
+    TfRnnlmHistoryCache *cache = rnnlm_->GetCache();
+    TfRnnlmHistoryCache::Entry *entry =
+        (cache != NULL ? cache->Find(wseq) : NULL);
+    if (entry != NULL) {
+      *new_context = entry->context;
+      *new_cell = entry->cell;
+      logprob = GetRnnLogProb(s, rnn_word);
+    } else {
+      TfRnnlmHistoryCache::Entry *prev_entry =
+          (cache != NULL ? cache->Find(state_to_wseq_[s]) : NULL);
+      std::unordered_map<int32, BaseFloat>::const_iterator prob_iter;
+      if (prev_entry != NULL &&
+          (prob_iter = prev_entry->logprobs.find(rnn_word)) !=
+          prev_entry->logprobs.end()) {
+        logprob = prob_iter->second;
+        rnnlm_->GetNextState(rnn_word, *state_to_context_[s],
+                             new_context, new_cell);
+      } else {
+        logprob = rnnlm_->GetRnnLogProb(rnn_word,
+                                        *state_to_context_[s],
+                                        *state_to_cell_[s],
+                                        new_context,
+                                        new_cell);
+        if (cache != NULL) {
+          if (prev_entry == NULL)
+            prev_entry = cache->Insert(state_to_wseq_[s],
+                                       *state_to_context_[s],
+                                       *state_to_cell_[s]);
+          prev_entry->logprobs[rnn_word] = logprob;
+        }
+      }
+      if (cache != NULL)
+        cache->Insert(wseq, *new_context, *new_cell);
+    }
+    std::pair<const std::vector<Label>, StateId> wseq_state_pair(
+        wseq, static_cast<Label>(state_to_wseq_.size()));
+    iter = wseq_to_state_.insert(wseq_state_pair).first;
     state_to_wseq_.push_back(wseq);
     state_to_context_.push_back(new_context);
     state_to_cell_.push_back(new_cell);
   } else {
-    delete new_context;
-    delete new_cell;
+    logprob = GetRnnLogProb(s, rnn_word);
   }
+  logprob += rnnlm_->OosLogProb(rnn_word, ilabel);
 
   // Creates the arc.
   oarc->ilabel = ilabel;
   oarc->olabel = ilabel;
-  oarc->nextstate = result.first->second;
+  oarc->nextstate = iter->second;
   oarc->weight = Weight(-logprob);
 
   return true;
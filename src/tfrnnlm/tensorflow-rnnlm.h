@@ -20,7 +20,9 @@
 #ifndef KALDI_TFRNNLM_TENSORFLOW_RNNLM_H_
 #define KALDI_TFRNNLM_TENSORFLOW_RNNLM_H_
 
+#include <list>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include "util/stl-utils.h"
@@ -64,17 +66,86 @@ namespace tf_rnnlm {
 struct KaldiTfRnnlmWrapperOpts {
   std::string unk_symbol;
   int32 num_threads;  // 0 means unlimited
+  int32 cache_size;
 
-  KaldiTfRnnlmWrapperOpts() : unk_symbol("<oos>"), num_threads(1) {}
+  KaldiTfRnnlmWrapperOpts() : unk_symbol("<oos>"), num_threads(1),
+                              cache_size(0) {}
 
   void Register(OptionsItf *opts) {
     opts->Register("unk-symbol", &unk_symbol, "Symbol for out-of-vocabulary "
                    "words in rnnlm.");
     opts->Register("num-threads", &num_threads, "Number of threads for TF computation; "
                    "0 means unlimited.");
+    opts->Register("cache-size", &cache_size, "Number of word histories whose "
+                   "RNNLM state and word log-probabilities are kept across "
+                   "lattices (least recently used ones are dropped); 0 means "
+                   "no cache.  With the cache, the state of a history that "
+                   "was truncated by --max-ngram-order may come from another "
+                   "lattice.");
   }
 };
 
+/**
+   TfRnnlmHistoryCache is a least-recently-used cache, keyed by word history
+   (in RNNLM labels, as the states of TfRnnlmDeterministicFst), of the RNNLM
+   state of the history and of the log-probabilities of the words that have
+   followed it.  KaldiTfRnnlmWrapper owns one, so it is shared by all the
+   TfRnnlmDeterministicFst's (e.g. one per lattice) that use the wrapper and
+   saves their TensorFlow session runs for the histories seen before.
+*/
+class TfRnnlmHistoryCache {
+ public:
+  struct Entry {
+    Tensor context;
+    Tensor cell;
+    // log p(word | history) of the RNNLM, without the cost of the OOS word.
+    std::unordered_map<int32, BaseFloat> logprobs;
+  };
+
+  explicit TfRnnlmHistoryCache(int32 capacity): capacity_(capacity) {
+    KALDI_ASSERT(capacity > 0);
+  }
+
+  /// Returns the entry of the history, or NULL if it is not cached, and makes
+  /// it the most recently used.
+  Entry *Find(const std::vector<int32> &wseq) {
+    MapType::iterator iter = map_.find(wseq);
+    if (iter == map_.end())
+      return NULL;
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    return &(iter->second->second);
+  }
+
+  /// Returns the entry of the history, adding it with the given state if it
+  /// is not cached (which drops the least recently used entry if the cache
+  /// is full).  The pointers returned earlier may become invalid.
+  Entry *Insert(const std::vector<int32> &wseq, const Tensor &context,
+                const Tensor &cell) {
+    Entry *entry = Find(wseq);
+    if (entry != NULL)
+      return entry;
+    if (static_cast<int32>(map_.size()) >= capacity_) {
+      map_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.push_front(std::make_pair(wseq, Entry()));
+    map_[wseq] = entries_.begin();
+    entry = &(entries_.front().second);
+    entry->context = context;
+    entry->cell = cell;
+    return entry;
+  }
+
+ private:
+  typedef std::list<std::pair<std::vector<int32>, Entry> > ListType;
+  typedef unordered_map<std::vector<int32>, ListType::iterator,
+                        VectorHasher<int32> > MapType;
+
+  int32 capacity_;
+  ListType entries_;  // most recently used first.
+  MapType map_;
+};
+
 /**
 This class wraps the TensorFlow based RNNLM, and provides a set of interfaces
 to be used for class TfRnnlmDeterministicFst, implemented later in this file
@@ -98,6 +169,7 @@ class KaldiTfRnnlmWrapper {
                       const std::string &unk_prob_file,
                       const std::string &tf_model_path);
   ~KaldiTfRnnlmWrapper() {
+    delete cache_;
     session_->Close();
   }
 
@@ -129,6 +201,30 @@ class KaldiTfRnnlmWrapper {
                        Tensor *context_out,
                        Tensor *cell_out);
 
+  /// the same as GetLogProb() but without the cost of the OOS word, which
+  /// OosLogProb() gives; context_in is not used if the last 2 pointers are
+  /// NULL.
+  BaseFloat GetRnnLogProb(int32 word,
+                          const Tensor &context_in,
+                          const Tensor &cell_in,
+                          Tensor *context_out,
+                          Tensor *cell_out);
+
+  /// the log-probability to add to that of the RNNLM for the FST word
+  /// fst_word, whose RNN word is 'word': 0 unless 'word' is <oos>.
+  BaseFloat OosLogProb(int32 word, int32 fst_word) const;
+
+  /// generate only (context_out, cell_out), by passing (context_in, word)
+  /// into the TensorFlow session, for when the probability of the word is
+  /// already known.
+  void GetNextState(int32 word,
+                    const Tensor &context_in,
+                    Tensor *context_out,
+                    Tensor *cell_out);
+
+  /// the cache of word histories, or NULL if --cache-size is 0.
+  TfRnnlmHistoryCache *GetCache() { return cache_; }
+
   /// takes in a word-id for FST and return the word-id for RNNLM
   /// return the word-id for <oos> if not found
   int FstLabelToRnnLabel(int i) const;
@@ -162,6 +258,8 @@ class KaldiTfRnnlmWrapper {
 
   std::vector<float> unk_costs_;  // extra cost for OOS symbol in RNNLM
 
+  TfRnnlmHistoryCache *cache_;  // NULL if opts_.cache_size is 0.
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(KaldiTfRnnlmWrapper);
 };
 
@@ -188,6 +286,10 @@ class TfRnnlmDeterministicFst:
   virtual bool GetArc(StateId s, Label ilabel, fst::StdArc* oarc);
 
  private:
+  // returns log p(word | history of state s) of the RNNLM, without the OOS
+  // cost, from the cache of the wrapper if it has it.
+  BaseFloat GetRnnLogProb(StateId s, int32 rnn_word);
+
   typedef unordered_map<std::vector<Label>,
                         StateId, VectorHasher<Label> > MapType;
   StateId start_state_;
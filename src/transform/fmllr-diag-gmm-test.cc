@@ -222,6 +222,53 @@ void UnitTestFmllrDiagGmmOffset() {
   // mean that something is wrong.
 }
 
+// Checks that AccumulateForFrames() gives the same stats as accumulating
+// frame by frame.
+void UnitTestFmllrAccumulateForFrames() {
+  DiagGmm gmm;
+  InitRandomGmm(&gmm);
+  int32 dim = gmm.Dim(), num_pdfs = 1 + Rand() % 4;
+  AmDiagGmm am_gmm;
+  for (int32 p = 0; p < num_pdfs; p++) {
+    InitRandomGmm(&gmm);
+    while (gmm.Dim() != dim) InitRandomGmm(&gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  int32 num_frames = Rand() % 700;
+  Matrix<BaseFloat> feats(num_frames, dim);
+  Posterior pdf_post(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    SubVector<BaseFloat> row(feats, t);
+    am_gmm.GetPdf(0).Generate(&row);
+    int32 num_post = Rand() % 3;  // some frames have no posteriors.
+    for (int32 j = 0; j < num_post; j++)
+      pdf_post[t].push_back(std::make_pair(Rand() % num_pdfs, RandUniform()));
+  }
+
+  for (int32 full = 0; full < 2; full++) {
+    FmllrOptions opts;
+    opts.update_type = (full ? "full" : "diag");
+    FmllrDiagGmmAccs frame_stats(dim, opts), chunk_stats(dim, opts);
+    for (int32 t = 0; t < num_frames; t++)
+      for (size_t j = 0; j < pdf_post[t].size(); j++)
+        frame_stats.AccumulateForGmm(am_gmm.GetPdf(pdf_post[t][j].first),
+                                     feats.Row(t), pdf_post[t][j].second);
+    chunk_stats.AccumulateForFrames(am_gmm, feats, pdf_post);
+
+    Matrix<BaseFloat> xform1(dim, dim + 1), xform2(dim, dim + 1);
+    xform1.SetUnit();
+    xform2.SetUnit();
+    // Update() commits the last frame of frame_stats.
+    opts.update_type = "none";
+    frame_stats.Update(opts, &xform1, NULL, NULL);
+    chunk_stats.Update(opts, &xform2, NULL, NULL);
+    KALDI_ASSERT(ApproxEqual(frame_stats.beta_, chunk_stats.beta_));
+    KALDI_ASSERT(frame_stats.K_.ApproxEqual(chunk_stats.K_, 1.0e-05));
+    for (int32 i = 0; i < dim; i++)
+      KALDI_ASSERT(frame_stats.G_[i].ApproxEqual(chunk_stats.G_[i], 1.0e-05));
+  }
+}
+
 }  // namespace kaldi ends here
 
 int main() {
@@ -229,6 +276,7 @@ int main() {
     kaldi::UnitTestFmllrDiagGmmOffset();
     kaldi::UnitTestFmllrDiagGmmDiagonal();
     kaldi::UnitTestFmllrDiagGmm();
+    kaldi::UnitTestFmllrAccumulateForFrames();
   }
   std::cout << "Test OK.\n";
 }
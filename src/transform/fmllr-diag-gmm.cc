@@ -19,6 +19,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 using std::vector;
@@ -126,6 +127,48 @@ BaseFloat FmllrDiagGmmAccs::AccumulateForGmmPreselect(
   return loglike;
 }
 
+BaseFloat FmllrDiagGmmAccs::AccumulateForFrames(
+    const AmDiagGmm &am_gmm,
+    const MatrixBase<BaseFloat> &feats,
+    const Posterior &pdf_post) {
+  int32 dim = Dim(), num_frames = feats.NumRows(),
+      chunk_size = std::min<int32>(kChunkSize, num_frames);
+  KALDI_ASSERT(feats.NumCols() == dim && am_gmm.Dim() == dim &&
+               static_cast<int32>(pdf_post.size()) == num_frames);
+  if (num_frames == 0) return 0.0;
+
+  Matrix<BaseFloat> chunk_feats(chunk_size, dim, kUndefined),
+      a(chunk_size, dim, kUndefined), b(chunk_size, dim, kUndefined);
+  Vector<BaseFloat> count(chunk_size, kUndefined), posterior;
+  double tot_like = 0.0;
+  int32 n = 0;  // number of frames in the current chunk.
+  for (int32 t = 0; t < num_frames; t++) {
+    if (pdf_post[t].empty()) continue;
+    SubVector<BaseFloat> data(feats, t), this_a(a, n), this_b(b, n);
+    this_a.SetZero();
+    this_b.SetZero();
+    count(n) = 0.0;
+    for (size_t j = 0; j < pdf_post[t].size(); j++) {
+      const DiagGmm &pdf = am_gmm.GetPdf(pdf_post[t][j].first);
+      BaseFloat weight = pdf_post[t][j].second;
+      tot_like += weight * pdf.ComponentPosteriors(data, &posterior);
+      posterior.Scale(weight);
+      count(n) += posterior.Sum();
+      this_a.AddMatVec(1.0, pdf.means_invvars(), kTrans, posterior, 1.0);
+      this_b.AddMatVec(1.0, pdf.inv_vars(), kTrans, posterior, 1.0);
+    }
+    chunk_feats.Row(n).CopyFromVec(data);
+    if (++n == chunk_size) {
+      CommitFrameStats(chunk_feats, a, b, count);
+      n = 0;
+    }
+  }
+  if (n > 0)
+    CommitFrameStats(chunk_feats.RowRange(0, n), a.RowRange(0, n),
+                     b.RowRange(0, n), count.Range(0, n));
+  return tot_like;
+}
+
 
 
 void FmllrDiagGmmAccs::Update(const FmllrOptions &opts,
@@ -594,6 +637,52 @@ void FmllrDiagGmmAccs::CommitSingleFrameStats() {
   stats.a.SetZero();
   stats.b.SetZero();
 }
+
+void FmllrDiagGmmAccs::CommitFrameStats(const MatrixBase<BaseFloat> &feats,
+                                        const MatrixBase<BaseFloat> &a,
+                                        const MatrixBase<BaseFloat> &b,
+                                        const VectorBase<BaseFloat> &count) {
+  int32 dim = Dim(), num_frames = feats.NumRows();
+  KALDI_ASSERT(a.NumRows() == num_frames && b.NumRows() == num_frames &&
+               count.Dim() == num_frames);
+
+  Matrix<double> xplus(num_frames, dim + 1, kUndefined);
+  xplus.Range(0, num_frames, 0, dim).CopyFromMat(feats);
+  Vector<double> ones(num_frames);
+  ones.Set(1.0);
+  xplus.CopyColFromVec(ones, dim);
+
+  this->beta_ += count.Sum();
+  this->K_.AddMatMat(1.0, Matrix<double>(a), kTrans, xplus, kNoTrans, 1.0);
+
+  if (opts_.update_type == "full") {
+    KALDI_ASSERT(static_cast<size_t>(dim) == this->G_.size());
+    Matrix<double> scaled_xplus(num_frames, dim + 1, kUndefined);
+    Vector<double> b_col(num_frames, kUndefined);
+    for (int32 i = 0; i < dim; i++) {
+      b_col.CopyColFromMat(b, i);
+      if (b_col.Min() >= 0.0) {
+        // G_i += \sum_t b(t, i) x^+_t x^+_t^T is a symmetric rank-k update
+        // once the x^+_t are scaled by sqrt(b(t, i)).
+        scaled_xplus.CopyFromMat(xplus);
+        b_col.ApplyPow(0.5);
+        scaled_xplus.MulRowsVec(b_col);
+        this->G_[i].AddMat2(1.0, scaled_xplus, kTrans, 1.0);
+      } else {  // negative posteriors: add the frames one by one.
+        this->G_[i].AddMat2Vec(1.0, xplus, kTrans, b_col, 1.0);
+      }
+    }
+  } else {
+    for (int32 t = 0; t < num_frames; t++) {
+      for (int32 i = 0; i < dim; i++) {
+        BaseFloat scale = b(t, i), x_i = feats(t, i);
+        this->G_[i](i, i) += scale * x_i * x_i;
+        this->G_[i](dim, i) += scale * 1.0 * x_i;
+        this->G_[i](dim, dim) += scale * 1.0 * 1.0;
+      }
+    }
+  }
+}
     
 
 
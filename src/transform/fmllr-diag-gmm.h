@@ -27,6 +27,7 @@
 #include "base/kaldi-common.h"
 #include "gmm/am-diag-gmm.h"
 #include "gmm/mle-full-gmm.h"
+#include "hmm/posterior.h"
 #include "transform/transform-common.h"
 #include "util/kaldi-table.h"
 #include "util/kaldi-holder.h"
@@ -110,6 +111,15 @@ class FmllrDiagGmmAccs: public AffineXformStats {
       const VectorBase<BaseFloat> &data,
       const VectorBase<BaseFloat> &posteriors);
 
+  /// Accumulates stats for a block of frames: pdf_post[t] is the list of
+  /// (pdf-index, weight) pairs of row t of "feats", e.g. as output by
+  /// ConvertPosteriorToPdfs().  The stats are the same as from calling
+  /// AccumulateForGmm() for each pair, but the outer products of the features
+  /// are added kChunkSize frames at a time as matrix-matrix products, which is
+  /// much faster for "full" fMLLR.  Returns the weighted log-likelihood.
+  BaseFloat AccumulateForFrames(const AmDiagGmm &am_gmm,
+                                const MatrixBase<BaseFloat> &feats,
+                                const Posterior &pdf_post);
   
   /// Update
   void Update(const FmllrOptions &opts,
@@ -143,6 +153,16 @@ class FmllrDiagGmmAccs: public AffineXformStats {
 
   void CommitSingleFrameStats();
 
+  // Adds the stats of the frames (rows) in "feats", where row t of "a" and
+  // "b" and element t of "count" are what SingleFrameStats would hold for
+  // that frame.  Used by AccumulateForFrames().
+  void CommitFrameStats(const MatrixBase<BaseFloat> &feats,
+                        const MatrixBase<BaseFloat> &a,
+                        const MatrixBase<BaseFloat> &b,
+                        const VectorBase<BaseFloat> &count);
+
+  static const int32 kChunkSize = 256;
+
   void InitSingleFrameStats(const VectorBase<BaseFloat> &data);
   
   bool DataHasChanged(const VectorBase<BaseFloat> &data) const; // compares it to the
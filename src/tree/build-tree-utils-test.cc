@@ -835,6 +835,62 @@ void TestSplitDecisionTree() {
     }
   }
 }
+void TestSplitDecisionTreeThreaded() {
+  // Checks that the tree and the objf improvement do not depend on the number
+  // of threads, both when splitting from a single leaf (where the keys are
+  // divided among the threads) and from many leaves (where the leaves are).
+  for (int32 p = 0; p < 4; p++) {
+    int32 num_keys = 2 + Rand() % 5;
+    BuildTreeStatsType stats;
+    size_t n_stats = 50 + Rand() % 100;
+    for (size_t i = 0; i < n_stats; i++) {
+      EventType evec;
+      for (int32 k = 0; k < num_keys; k++)
+        evec.push_back(std::make_pair(k, (EventValueType)(Rand() % 8)));
+      // Stats with whole-number values make many splits tie exactly.
+      stats.push_back(std::make_pair(evec, (Clusterable*)
+                                     new ScalarClusterable(Rand() % 3)));
+    }
+    Questions qo;
+    qo.InitRand(stats, 1 + Rand() % 5, Rand() % 3, kAllKeysIntersection);
+
+    for (int32 table = 0; table < 2; table++) {
+      int32 num_leaves = 0;
+      EventMap *orig_tree = TrivialTree(&num_leaves);
+      if (table == 1) {
+        EventMap *table_tree = DoTableSplit(*orig_tree, 0, stats, &num_leaves);
+        delete orig_tree;
+        orig_tree = table_tree;
+      }
+      std::string ref_str;
+      BaseFloat ref_impr = 0.0, ref_smallest = 0.0;
+      int32 ref_num_leaves = 0;
+      for (int32 num_threads = 1; num_threads <= 4; num_threads++) {
+        int32 this_num_leaves = num_leaves;
+        BaseFloat impr, smallest_split;
+        EventMap *split_tree = SplitDecisionTree(*orig_tree, stats, qo, 0.00001,
+                                                 40, &this_num_leaves, &impr,
+                                                 &smallest_split, num_threads);
+        std::ostringstream os;
+        split_tree->Write(os, false);
+        if (num_threads == 1) {
+          ref_str = os.str();
+          ref_impr = impr;
+          ref_smallest = smallest_split;
+          ref_num_leaves = this_num_leaves;
+        } else {
+          KALDI_ASSERT(os.str() == ref_str && impr == ref_impr &&
+                       smallest_split == ref_smallest &&
+                       this_num_leaves == ref_num_leaves);
+        }
+        delete split_tree;
+      }
+      delete orig_tree;
+    }
+    DeleteBuildTreeStats(&stats);
+  }
+}
+
 void TestBuildTreeStatsIo(bool binary) {
   for (int32 p = 0; p < 10; p++) {
     size_t num_stats = Rand() % 20;
@@ -882,6 +938,7 @@ int main() {
     TestShareEventMapLeaves();
     TestQuestionsInitRand();
     TestSplitDecisionTree();
+    TestSplitDecisionTreeThreaded();
     TestBuildTreeStatsIo(false);
     TestBuildTreeStatsIo(true);
     TestConvertStats();
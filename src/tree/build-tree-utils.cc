@@ -20,6 +20,7 @@
 #include <set>
 #include <queue>
 #include "util/stl-utils.h"
+#include "util/kaldi-thread.h"
 #include "tree/build-tree-utils.h"
 
 
@@ -343,6 +344,36 @@ BaseFloat ComputeInitialSplit(const std::vector<Clusterable*> &summed_stats,
 }
 
 
+// Sums the stats for each value of "key" into summed_stats (indexed by value;
+// NULL for values not seen).  This gives the same answer as SplitStatsByKey
+// followed by SumStatsVec, but in one pass over the stats and without copying
+// the event vectors, which dominates the cost of FindBestSplitForKey when
+// there are many keys.  Returns false (with summed_stats empty) if the key is
+// not defined for all the stats.
+static bool SumStatsByKey(const BuildTreeStatsType &stats,
+                          EventKeyType key,
+                          std::vector<Clusterable*> *summed_stats) {
+  KALDI_ASSERT(summed_stats != NULL && summed_stats->empty());
+  BuildTreeStatsType::const_iterator iter = stats.begin(), end = stats.end();
+  for (; iter != end; ++iter) {
+    EventValueType val;
+    if (!EventMap::Lookup(iter->first, key, &val)) {
+      DeletePointers(summed_stats);
+      summed_stats->clear();
+      return false;
+    }
+    KALDI_ASSERT(val >= 0);
+    if (static_cast<size_t>(val) >= summed_stats->size())
+      summed_stats->resize(val + 1, NULL);
+    Clusterable *cl = iter->second;
+    if (cl != NULL) {
+      if ((*summed_stats)[val] == NULL) (*summed_stats)[val] = cl->Copy();
+      else (*summed_stats)[val]->Add(*cl);
+    }
+  }
+  return true;
+}
+
 // returns best delta-objf.
 // If key does not exist, returns 0 and sets yes_set_out to empty.
 BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
@@ -350,16 +381,11 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
                               EventKeyType key,
                               std::vector<EventValueType> *yes_set_out) {
   if (stats.size()<=1) return 0.0;  // cannot split if only zero or one instance of stats.
-  if (!PossibleValues(key, stats, NULL)) {
+  std::vector<Clusterable*> summed_stats;  // indexed by value corresponding to key. owned here.
+  if (!SumStatsByKey(stats, key, &summed_stats)) {
     yes_set_out->clear();
     return 0.0;  // Can't split as key not always defined.
   }
-  std::vector<Clusterable*> summed_stats;  // indexed by value corresponding to key. owned here.
-  {  // compute summed_stats
-    std::vector<BuildTreeStatsType> split_stats;
-    SplitStatsByKey(stats, key, &split_stats);
-    SumStatsVec(split_stats, &summed_stats);
-  }
 
   std::vector<EventValueType> yes_set;
   BaseFloat improvement = ComputeInitialSplit(summed_stats,
@@ -422,6 +448,35 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
 
 
 
+/*
+  DecisionTreeKeyEvaluator is used in DecisionTreeSplitter to find the best
+  split for each of a list of keys in parallel.  The stats and questions are
+  only read; each key's answer goes in its own slot of "improvements" and
+  "yes_sets", so the choice between keys can be made afterwards in a fixed
+  order.
+*/
+class DecisionTreeKeyEvaluator: public MultiThreadable {
+ public:
+  DecisionTreeKeyEvaluator(const BuildTreeStatsType &stats,
+                           const Questions &q_opts,
+                           const std::vector<EventKeyType> &keys,
+                           std::vector<BaseFloat> *improvements,
+                           std::vector<std::vector<EventValueType> > *yes_sets):
+      stats_(stats), q_opts_(q_opts), keys_(keys),
+      improvements_(improvements), yes_sets_(yes_sets) { }
+  void operator () () {
+    for (size_t i = thread_id_; i < keys_.size(); i += num_threads_)
+      (*improvements_)[i] = FindBestSplitForKey(stats_, q_opts_, keys_[i],
+                                                &((*yes_sets_)[i]));
+  }
+ private:
+  const BuildTreeStatsType &stats_;
+  const Questions &q_opts_;
+  const std::vector<EventKeyType> &keys_;
+  std::vector<BaseFloat> *improvements_;
+  std::vector<std::vector<EventValueType> > *yes_sets_;
+};
+
 /*
   DecisionTreeBuilder is a class used in SplitDecisionTree
 */
@@ -444,10 +499,17 @@ class DecisionTreeSplitter {
       best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());  // may have changed.
     }
   }
+  // num_threads is the number of threads used to evaluate the keys when this
+  // node or its descendants are split; if threaded_search is false, this
+  // node's own best split is found in the calling thread (this is used when
+  // the initial leaves are set up in parallel).
   DecisionTreeSplitter(EventAnswerType leaf, const BuildTreeStatsType &stats,
-                      const Questions &q_opts): q_opts_(q_opts), yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats) {
+                       const Questions &q_opts, int32 num_threads = 1,
+                       bool threaded_search = true):
+      q_opts_(q_opts), num_threads_(num_threads), yes_(NULL), no_(NULL),
+      leaf_(leaf), stats_(stats) {
     // not, this must work when stats is empty too. [just gives zero improvement, non-splittable].
-    FindBestSplit();
+    FindBestSplit(threaded_search ? num_threads_ : 1);
   }
   ~DecisionTreeSplitter() {
     delete yes_;
@@ -481,12 +543,12 @@ class DecisionTreeSplitter {
       delete yes_clust; delete no_clust;
     }
 #endif
-    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_);
-    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_);
+    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_, num_threads_);
+    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_, num_threads_);
     best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());
     stats_.clear();  // note: pointers in stats_ were not owned here.
   }
-  void FindBestSplit() {
+  void FindBestSplit(int32 num_threads) {
     // This sets best_split_impr_, key_ and yes_set_.
     // May just pick best question, or may iterate a bit (depends on
     // q_opts; see FindBestSplitForKey for details)
@@ -495,16 +557,30 @@ class DecisionTreeSplitter {
     if (all_keys.size() == 0) {
       KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
     }
+    std::vector<EventKeyType> keys;
+    for (size_t i = 0; i < all_keys.size(); i++)
+      if (q_opts_.HasQuestionsForKey(all_keys[i]))
+        keys.push_back(all_keys[i]);
     best_split_impr_ = 0;
-    for (size_t i = 0; i < all_keys.size(); i++) {
-      if (q_opts_.HasQuestionsForKey(all_keys[i])) {
-        std::vector<EventValueType> temp_yes_set;
-        BaseFloat split_improvement = FindBestSplitForKey(stats_, q_opts_, all_keys[i], &temp_yes_set);
-        if (split_improvement > best_split_impr_) {
-          best_split_impr_ = split_improvement;
-          yes_set_ = temp_yes_set;
-          key_ = all_keys[i];
-        }
+    if (keys.empty() || stats_.size() <= 1)
+      return;  // FindBestSplitForKey would give zero for all keys.
+
+    std::vector<BaseFloat> improvements(keys.size());
+    std::vector<std::vector<EventValueType> > yes_sets(keys.size());
+    DecisionTreeKeyEvaluator evaluator(stats_, q_opts_, keys,
+                                       &improvements, &yes_sets);
+    num_threads = std::min<int32>(num_threads, keys.size());
+    {
+      MultiThreader<DecisionTreeKeyEvaluator> threader(
+          num_threads > 1 ? num_threads : 0, evaluator);
+    }
+    // Choose in key order, so ties are broken the same way however many
+    // threads were used.
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (improvements[i] > best_split_impr_) {
+        best_split_impr_ = improvements[i];
+        yes_set_.swap(yes_sets[i]);
+        key_ = keys[i];
       }
     }
   }
@@ -513,6 +589,7 @@ class DecisionTreeSplitter {
 
   // Data members... Always used:
   const Questions &q_opts_;
+  int32 num_threads_;
   BaseFloat best_split_impr_;
 
   // If already split:
@@ -529,6 +606,31 @@ class DecisionTreeSplitter {
 
 };
 
+/*
+  DecisionTreeLeafInitializer is used in SplitDecisionTree to set up the
+  DecisionTreeSplitter for each of the initial leaves in parallel.
+*/
+class DecisionTreeLeafInitializer: public MultiThreadable {
+ public:
+  DecisionTreeLeafInitializer(const std::vector<BuildTreeStatsType> &split_stats,
+                              const Questions &q_opts, int32 num_threads,
+                              std::vector<DecisionTreeSplitter*> *builders):
+      split_stats_(split_stats), q_opts_(q_opts), tree_num_threads_(num_threads),
+      builders_(builders) { }
+  void operator () () {
+    for (size_t i = thread_id_; i < split_stats_.size(); i += num_threads_) {
+      EventAnswerType leaf = static_cast<EventAnswerType>(i);
+      (*builders_)[i] = new DecisionTreeSplitter(leaf, split_stats_[i], q_opts_,
+                                                 tree_num_threads_, false);
+    }
+  }
+ private:
+  const std::vector<BuildTreeStatsType> &split_stats_;
+  const Questions &q_opts_;
+  int32 tree_num_threads_;
+  std::vector<DecisionTreeSplitter*> *builders_;
+};
+
 EventMap *SplitDecisionTree(const EventMap &input_map,
                             const BuildTreeStatsType &stats,
                             Questions &q_opts,
@@ -536,7 +638,8 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *obj_impr_out,
-                            BaseFloat *smallest_split_change_out) {
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads) {
   KALDI_ASSERT(num_leaves != NULL && *num_leaves > 0);  // can't be 0 or input_map would be empty.
   int32 num_empty_leaves = 0;
   BaseFloat like_impr = 0.0;
@@ -548,10 +651,20 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
     SplitStatsByMap(stats, input_map, &split_stats);
     KALDI_ASSERT(split_stats.size() != 0);
     builders.resize(split_stats.size());  // size == #leaves.
-    for (size_t i = 0;i < split_stats.size();i++) {
-      EventAnswerType leaf = static_cast<EventAnswerType>(i);
+    for (size_t i = 0;i < split_stats.size();i++)
       if (split_stats[i].size() == 0) num_empty_leaves++;
-      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts);
+    if (num_threads > 1 && split_stats.size() >= static_cast<size_t>(num_threads)) {
+      // Enough leaves to keep the threads busy: give each thread whole leaves.
+      DecisionTreeLeafInitializer initializer(split_stats, q_opts, num_threads,
+                                              &builders);
+      MultiThreader<DecisionTreeLeafInitializer> threader(num_threads,
+                                                          initializer);
+    } else {
+      for (size_t i = 0;i < split_stats.size();i++) {
+        EventAnswerType leaf = static_cast<EventAnswerType>(i);
+        builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts,
+                                               num_threads);
+      }
     }
   }
 
@@ -278,6 +278,10 @@ EventMap *ShareEventMapLeaves(const EventMap &e_in, EventKeyType key,
 /// @param smallest_split_change_out If non-NULL, will be set to the smallest objective-function
 ///         improvement that we got from splitting any leaf; useful to provide a threshold
 ///         for ClusterEventMap.
+/// @param num_threads [in] Number of threads used to find the best split of
+///         each leaf: the initial leaves are divided among the threads, and
+///         when a leaf is split the keys of its children are.  The tree does
+///         not depend on the number of threads.
 /// @return The EventMap after splitting is returned; pointer is owned by caller.
 EventMap *SplitDecisionTree(const EventMap &orig,
                             const BuildTreeStatsType &stats,
@@ -286,7 +290,8 @@ EventMap *SplitDecisionTree(const EventMap &orig,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *objf_impr_out,
-                            BaseFloat *smallest_split_change_out);
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads = 1);
 
 /// CreateRandomQuestions will initialize a Questions randomly, in a reasonable
 /// way [for testing purposes, or when hand-designed questions are not available].
@@ -80,6 +80,8 @@ namespace kaldi {
  *                  further clustering the leaves after they are first
  *                  clustered based on log-likelihood change.
  *                  (See cluster_thresh above) (default: true)
+ * @param num_threads [in] Number of threads used in decision-tree splitting
+ *                  (see SplitDecisionTree); the tree does not depend on it.
  * @return  Returns a pointer to an EventMap object that is the tree.
 
 */
@@ -94,7 +96,8 @@ EventMap *BuildTree(Questions &qopts,
                     int32 max_leaves,
                     BaseFloat cluster_thresh,  // typically == thresh.  If negative, use smallest split.
                     int32 P, 
-                    bool round_num_leaves = true);
+                    bool round_num_leaves = true,
+                    int32 num_threads = 1);
 
 
 /**
@@ -0,0 +1,129 @@
+// tree/compiled-event-map-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tree/compiled-event-map.h"
+#include "tree/context-dep.h"
+
+namespace kaldi {
+
+// Keys are in -1 ... 6, values mostly in 0 ... 9.  Some yes-sets have a large
+// value in them so that they are stored as sorted lists, not bitmaps.
+static EventMap *RandomEventMap(int32 depth) {
+  int32 r = Rand() % 4;
+  if (depth == 0 || r == 0)
+    return new ConstantEventMap(Rand() % 20);
+  EventKeyType key = Rand() % 8 - 1;
+  if (r == 1) {
+    std::vector<EventMap*> table(Rand() % 10, NULL);
+    for (size_t i = 0; i < table.size(); i++)
+      if (Rand() % 4 != 0)
+        table[i] = RandomEventMap(depth - 1);
+    return new TableEventMap(key, table);
+  }
+  std::vector<EventValueType> yes_set;
+  for (EventValueType v = 0; v < 10; v++)
+    if (Rand() % 2 == 0)
+      yes_set.push_back(v);
+  if (Rand() % 3 == 0)
+    yes_set.push_back(1000 + Rand() % 10);
+  return new SplitEventMap(key, yes_set, RandomEventMap(depth - 1),
+                           RandomEventMap(depth - 1));
+}
+
+void TestCompiledEventMap() {
+  for (int32 p = 0; p < 100; p++) {
+    EventMap *emap = RandomEventMap(1 + Rand() % 8);
+    CompiledEventMap compiled(*emap);
+    KALDI_ASSERT(!compiled.Empty());
+    const std::vector<EventKeyType> &keys = compiled.Keys();
+    KALDI_ASSERT(IsSortedAndUniq(keys));
+    for (int32 q = 0; q < 100; q++) {
+      EventType event;
+      bool all_defined = true;
+      for (EventKeyType k = -1; k < 7; k++) {
+        if (Rand() % 10 == 0) {
+          all_defined = false;
+        } else {
+          EventValueType v = (Rand() % 20 == 0 ? 1000 + Rand() % 10 :
+                              Rand() % 12);
+          event.push_back(std::make_pair(k, v));
+        }
+      }
+      EventAnswerType ans1 = -1, ans2 = -1;
+      bool b1 = emap->Map(event, &ans1), b2 = compiled.Map(event, &ans2);
+      KALDI_ASSERT(b1 == b2);
+      if (b1)
+        KALDI_ASSERT(ans1 == ans2);
+      if (all_defined) {
+        std::vector<EventValueType> values(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+          values[i] = event[keys[i] + 1].second;
+        EventAnswerType ans3 = -1;
+        bool b3 = compiled.MapDense(values.empty() ? NULL : &(values[0]),
+                                    &ans3);
+        KALDI_ASSERT(b3 == b1);
+        if (b1)
+          KALDI_ASSERT(ans3 == ans1);
+      }
+    }
+    delete emap;
+  }
+}
+
+void TestCompiledContextDependency() {
+  for (int32 p = 0; p < 10; p++) {
+    size_t num_phones = 1 + Rand() % 10;
+    std::set<int32> phones_set;
+    while (phones_set.size() < num_phones)
+      phones_set.insert(1 + Rand() % (num_phones + 5));
+    std::vector<int32> phones;
+    CopySetToVector(phones_set, &phones);
+    std::vector<int32> phone2num_pdf_classes;
+    ContextDependency *dep = GenRandContextDependency(phones, Rand() % 2 == 0,
+                                                      &phone2num_pdf_classes);
+    int32 N = dep->ContextWidth();
+    for (int32 q = 0; q < 100; q++) {
+      std::vector<int32> phoneseq(N);
+      for (int32 i = 0; i < N; i++)
+        phoneseq[i] = (Rand() % 5 == 0 ? 0 : phones[Rand() % phones.size()]);
+      phoneseq[dep->CentralPosition()] = phones[Rand() % phones.size()];
+      int32 pdf_class = Rand() % 4;
+      EventType event;
+      event.push_back(std::make_pair(kPdfClass, pdf_class));
+      for (int32 i = 0; i < N; i++)
+        event.push_back(std::make_pair(i, phoneseq[i]));
+      int32 pdf1 = -1, pdf2 = -1;
+      bool b1 = dep->ToPdfMap().Map(event, &pdf1),
+          b2 = dep->Compute(phoneseq, pdf_class, &pdf2);
+      KALDI_ASSERT(b1 == b2);
+      if (b1)
+        KALDI_ASSERT(pdf1 == pdf2);
+    }
+    delete dep;
+  }
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestCompiledEventMap();
+  TestCompiledContextDependency();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,212 @@
+// tree/compiled-event-map.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include "tree/compiled-event-map.h"
+
+namespace kaldi {
+
+void CompiledEventMap::Init(const EventMap &emap) {
+  keys_.clear();
+  nodes_.clear();
+  table_.clear();
+  yes_bits_.clear();
+  yes_values_.clear();
+  GetKeys(emap);
+  SortAndUniq(&keys_);
+  std::map<EventAnswerType, int32> leaves;
+  int32 root = Compile(emap, &leaves);
+  KALDI_ASSERT(root == 0);
+}
+
+void CompiledEventMap::GetKeys(const EventMap &emap) {
+  if (const TableEventMap *table = dynamic_cast<const TableEventMap*>(&emap))
+    keys_.push_back(table->key_);
+  else if (const SplitEventMap *split = dynamic_cast<const SplitEventMap*>(&emap))
+    keys_.push_back(split->key_);
+  std::vector<EventMap*> children;
+  emap.GetChildren(&children);
+  for (size_t i = 0; i < children.size(); i++)
+    GetKeys(*(children[i]));
+}
+
+int32 CompiledEventMap::KeyIndex(EventKeyType key) const {
+  std::vector<EventKeyType>::const_iterator iter =
+      std::lower_bound(keys_.begin(), keys_.end(), key);
+  KALDI_ASSERT(iter != keys_.end() && *iter == key);
+  return iter - keys_.begin();
+}
+
+int32 CompiledEventMap::Compile(const EventMap &emap,
+                                std::map<EventAnswerType, int32> *leaves) {
+  if (const ConstantEventMap *constant =
+      dynamic_cast<const ConstantEventMap*>(&emap)) {
+    std::map<EventAnswerType, int32>::iterator iter =
+        leaves->find(constant->answer_);
+    if (iter != leaves->end())
+      return iter->second;
+    Node node;
+    node.type = kConstant;
+    node.key_index = -1;
+    node.arg1 = constant->answer_;
+    node.arg2 = node.set_begin = node.set_size = -1;
+    node.lowest = node.highest = 0;
+    nodes_.push_back(node);
+    (*leaves)[constant->answer_] = nodes_.size() - 1;
+    return nodes_.size() - 1;
+  }
+  // Reserve this node's position before compiling the children, so the root
+  // is at position 0.
+  int32 index = nodes_.size();
+  nodes_.resize(index + 1);
+  Node node;
+  node.set_begin = node.set_size = -1;
+  node.lowest = node.highest = 0;
+  if (const TableEventMap *table = dynamic_cast<const TableEventMap*>(&emap)) {
+    node.type = kTable;
+    node.key_index = KeyIndex(table->key_);
+    int32 size = table->table_.size();
+    node.arg1 = table_.size();
+    node.arg2 = size;
+    table_.resize(table_.size() + size, -1);
+    for (int32 i = 0; i < size; i++) {
+      if (table->table_[i] != NULL) {
+        // Compile() may resize table_, so don't take a reference first.
+        int32 child = Compile(*(table->table_[i]), leaves);
+        table_[node.arg1 + i] = child;
+      }
+    }
+  } else if (const SplitEventMap *split =
+             dynamic_cast<const SplitEventMap*>(&emap)) {
+    node.key_index = KeyIndex(split->key_);
+    const ConstIntegerSet<EventValueType> &yes_set = split->yes_set_;
+    if (yes_set.size() == 0) {
+      // Nothing is in the set; an empty range makes every lookup say "no".
+      node.type = kSplitSorted;
+      node.set_begin = yes_values_.size();
+      node.set_size = 0;
+      node.lowest = 1;
+      node.highest = 0;
+    } else {
+      node.lowest = *(yes_set.begin());
+      node.highest = *(yes_set.end() - 1);
+      size_t range = static_cast<size_t>(node.highest) + 1 - node.lowest;
+      // Same criterion as ConstIntegerSet for storing a bitmap.
+      if (range < yes_set.size() * 8 * sizeof(EventValueType)) {
+        node.type = kSplitBitmap;
+        node.set_begin = yes_bits_.size();
+        yes_bits_.resize(yes_bits_.size() + (range + 31) / 32, 0);
+        for (ConstIntegerSet<EventValueType>::iterator iter = yes_set.begin();
+             iter != yes_set.end(); ++iter) {
+          size_t offset = *iter - node.lowest;
+          yes_bits_[node.set_begin + offset / 32] |= (1u << (offset % 32));
+        }
+      } else {
+        node.type = kSplitSorted;
+        node.set_begin = yes_values_.size();
+        node.set_size = yes_set.size();
+        yes_values_.insert(yes_values_.end(), yes_set.begin(), yes_set.end());
+      }
+    }
+    node.arg1 = Compile(*(split->yes_), leaves);
+    node.arg2 = Compile(*(split->no_), leaves);
+  } else {
+    KALDI_ERR << "CompiledEventMap: unknown type of EventMap.";
+  }
+  nodes_[index] = node;
+  return index;
+}
+
+bool CompiledEventMap::Map(const EventType &event,
+                           EventAnswerType *ans) const {
+  // Put the values of the keys we ask about in the order of keys_; both lists
+  // are sorted so this is a merge.
+  size_t num_keys = keys_.size();
+  const size_t kMaxStackKeys = 64;
+  EventValueType value_buf[kMaxStackKeys];
+  char defined_buf[kMaxStackKeys];
+  std::vector<EventValueType> value_vec;
+  std::vector<char> defined_vec;
+  EventValueType *values = value_buf;
+  char *defined = defined_buf;
+  if (num_keys > kMaxStackKeys) {
+    value_vec.resize(num_keys);
+    defined_vec.resize(num_keys);
+    values = &(value_vec[0]);
+    defined = &(defined_vec[0]);
+  }
+  EventType::const_iterator iter = event.begin(), end = event.end();
+  for (size_t i = 0; i < num_keys; i++) {
+    while (iter != end && iter->first < keys_[i])
+      ++iter;
+    if (iter != end && iter->first == keys_[i]) {
+      values[i] = iter->second;
+      defined[i] = 1;
+    } else {
+      defined[i] = 0;
+    }
+  }
+  return MapInternal(values, defined, ans);
+}
+
+bool CompiledEventMap::MapInternal(const EventValueType *values,
+                                   const char *defined,
+                                   EventAnswerType *ans) const {
+  KALDI_ASSERT(!nodes_.empty());
+  const Node *nodes = &(nodes_[0]);
+  int32 n = 0;
+  while (true) {
+    const Node &node = nodes[n];
+    if (node.type == kConstant) {
+      *ans = node.arg1;
+      return true;
+    }
+    if (defined != NULL && !defined[node.key_index])
+      return false;
+    EventValueType value = values[node.key_index];
+    switch (node.type) {
+      case kTable:
+        if (value < 0 || value >= node.arg2 || table_[node.arg1 + value] < 0) {
+          *ans = -1;  // as TableEventMap.
+          return false;
+        }
+        n = table_[node.arg1 + value];
+        break;
+      case kSplitBitmap: {
+        bool yes = false;
+        if (value >= node.lowest && value <= node.highest) {
+          size_t offset = value - node.lowest;
+          yes = (yes_bits_[node.set_begin + offset / 32] >> (offset % 32)) & 1;
+        }
+        n = (yes ? node.arg1 : node.arg2);
+        break;
+      }
+      default: {  // kSplitSorted
+        bool yes = false;
+        if (value >= node.lowest && value <= node.highest) {
+          const EventValueType *begin = &(yes_values_[node.set_begin]);
+          yes = std::binary_search(begin, begin + node.set_size, value);
+        }
+        n = (yes ? node.arg1 : node.arg2);
+      }
+    }
+  }
+}
+
+}  // end namespace kaldi
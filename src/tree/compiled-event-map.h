@@ -0,0 +1,119 @@
+// tree/compiled-event-map.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_TREE_COMPILED_EVENT_MAP_H_
+#define KALDI_TREE_COMPILED_EVENT_MAP_H_
+
+#include <map>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "tree/event-map.h"
+
+namespace kaldi {
+
+/// \addtogroup event_map_group
+/// @{
+
+/// CompiledEventMap is a read-only copy of an EventMap, for fast lookup.  The
+/// nodes of the tree are stored in one contiguous array, leaves with the same
+/// answer are shared, and the "yes" sets of the splits are stored as bitmaps
+/// (or sorted lists, when a bitmap would be larger, as for ConstIntegerSet).
+/// The keys that the map asks about are numbered 0 ... Keys().size() - 1, so
+/// the value of a key is found by indexing rather than by a binary search of
+/// the event at every node.  This matters for the large full-context trees used
+/// in TTS, which ask about many keys.
+///
+/// Map() gives the same answers as EventMap::Map() on the map it was compiled
+/// from; MapDense() is faster still, for callers that can supply the values of
+/// all the keys directly (see ContextDependency::Compute()).
+class CompiledEventMap {
+ public:
+  CompiledEventMap() { }
+
+  explicit CompiledEventMap(const EventMap &emap) { Init(emap); }
+
+  /// Compiles "emap"; any previous contents are discarded.
+  void Init(const EventMap &emap);
+
+  bool Empty() const { return nodes_.empty(); }
+
+  /// The sorted list of keys that the map may ask about.
+  const std::vector<EventKeyType> &Keys() const { return keys_; }
+
+  /// Returns the number of nodes (after the sharing of leaves).
+  int32 NumNodes() const { return nodes_.size(); }
+
+  /// As EventMap::Map(): returns false if there was no answer for this event
+  /// (a key that was asked about was not defined, or a TableEventMap had no
+  /// entry for its value).
+  bool Map(const EventType &event, EventAnswerType *ans) const;
+
+  /// As Map(), but values[i] is the value of the key Keys()[i], and all keys
+  /// must be defined.  Returns false if there was no answer.
+  bool MapDense(const EventValueType *values, EventAnswerType *ans) const {
+    return MapInternal(values, NULL, ans);
+  }
+
+ private:
+  enum NodeType {
+    kConstant,     // A leaf.
+    kTable,        // A TableEventMap.
+    kSplitBitmap,  // A SplitEventMap whose yes-set is a bitmap.
+    kSplitSorted   // A SplitEventMap whose yes-set is a sorted list.
+  };
+
+  struct Node {
+    int32 type;       // A NodeType.
+    int32 key_index;  // kTable, kSplit*: index of the key in keys_.
+    int32 arg1;       // kConstant: the answer; kTable: start of the row in
+                      // table_; kSplit*: node index of the "yes" child.
+    int32 arg2;       // kTable: the size of the row; kSplit*: node index of
+                      // the "no" child.
+    int32 set_begin;  // kSplit*: start of the yes-set in yes_bits_ or
+                      // yes_values_.
+    int32 set_size;   // kSplitSorted: number of elements in the yes-set.
+    EventValueType lowest, highest;  // kSplit*: range of the yes-set.
+  };
+
+  // Compiles the subtree "emap" and returns its node index.
+  // "leaves" maps answers to the nodes already created for them.
+  int32 Compile(const EventMap &emap,
+                std::map<EventAnswerType, int32> *leaves);
+
+  // Collects all keys asked about in "emap" into keys_ (not sorted or uniq).
+  void GetKeys(const EventMap &emap);
+
+  int32 KeyIndex(EventKeyType key) const;
+
+  // If "defined" is non-NULL, defined[i] says whether values[i] is defined.
+  bool MapInternal(const EventValueType *values, const char *defined,
+                   EventAnswerType *ans) const;
+
+  std::vector<EventKeyType> keys_;
+  std::vector<Node> nodes_;  // The root is nodes_[0].
+  std::vector<int32> table_;  // Node indexes of TableEventMap entries, or -1.
+  std::vector<uint32> yes_bits_;
+  std::vector<EventValueType> yes_values_;
+};
+
+/// @} end "addtogroup event_map_group"
+
+}  // end namespace kaldi
+
+#endif  // KALDI_TREE_COMPILED_EVENT_MAP_H_
@@ -27,6 +27,21 @@ bool ContextDependency::Compute(const std::vector<int32> &phoneseq,
                                  int32 pdf_class,
                                  int32 *pdf_id) const {
   KALDI_ASSERT(static_cast<int32>(phoneseq.size()) == N_);
+  KALDI_ASSERT(pdf_id != NULL);
+  if (use_compiled_) {
+    const std::vector<EventKeyType> &keys = compiled_to_pdf_.Keys();
+    std::vector<EventValueType> values(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (keys[i] == kPdfClass) {
+        values[i] = pdf_class;
+      } else {
+        values[i] = phoneseq[keys[i]];
+        KALDI_ASSERT(values[i] >= 0);
+      }
+    }
+    return compiled_to_pdf_.MapDense(values.empty() ? NULL : &(values[0]),
+                                     pdf_id);
+  }
   EventType  event_vec;
   event_vec.reserve(N_+1);
   event_vec.push_back(std::make_pair
@@ -176,6 +191,19 @@ void ContextDependency::Read (std::istream &is, bool binary) {
   }
   ExpectToken(is, binary, "EndContextDependency");
   to_pdf_ = to_pdf;
+  InitCompiled();
+}
+
+void ContextDependency::InitCompiled() {
+  use_compiled_ = false;
+  if (to_pdf_ == NULL)
+    return;
+  compiled_to_pdf_.Init(*to_pdf_);
+  const std::vector<EventKeyType> &keys = compiled_to_pdf_.Keys();
+  for (size_t i = 0; i < keys.size(); i++)
+    if (keys[i] != kPdfClass && (keys[i] < 0 || keys[i] >= N_))
+      return;
+  use_compiled_ = true;
 }
 
 void ContextDependency::EnumeratePairs(
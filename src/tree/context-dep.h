@@ -23,6 +23,7 @@
 #include "util/stl-utils.h"
 #include "itf/context-dep-itf.h"
 #include "tree/event-map.h"
+#include "tree/compiled-event-map.h"
 #include "matrix/matrix-lib.h"
 #include "tree/cluster-utils.h"
 
@@ -85,12 +86,12 @@ class ContextDependency: public ContextDependencyInterface {
 
   // Constructor with no arguments; will normally be called
   // prior to Read()
-  ContextDependency(): N_(0), P_(0), to_pdf_(NULL) { }
+  ContextDependency(): N_(0), P_(0), to_pdf_(NULL), use_compiled_(false) { }
 
   // Constructor takes ownership of pointers.
   ContextDependency(int32 N, int32 P,
                     EventMap *to_pdf):
-      N_(N), P_(P), to_pdf_(to_pdf) { }
+      N_(N), P_(P), to_pdf_(to_pdf) { InitCompiled(); }
   void Write (std::ostream &os, bool binary) const;
 
   ~ContextDependency() { delete to_pdf_; }
@@ -137,6 +138,13 @@ class ContextDependency: public ContextDependencyInterface {
   int32 P_;
   EventMap *to_pdf_;  // owned here.
 
+  // A compiled copy of to_pdf_ used in Compute(), which fills in the values of
+  // its keys directly; use_compiled_ is false if to_pdf_ is NULL or asks about
+  // keys other than kPdfClass and 0 ... N_-1.
+  CompiledEventMap compiled_to_pdf_;
+  bool use_compiled_;
+  void InitCompiled();
+
   // 'context' is the context-window of phones, of
   // length N, with -1 for those positions where phones 
   // that are currently unknown, treated as wildcards; at least 
@@ -68,6 +68,8 @@ void ReadEventType(std::istream &is, bool binary, EventType *vec);
 
 std::string EventTypeToString(const EventType &evec);  // so we can print events out in error messages.
 
+class CompiledEventMap;  // tree/compiled-event-map.h
+
 struct EventMapVectorHash {  // Hashing object for EventMapVector.  Works for both pointers and references.
   // Not used in event-map.{h, cc}
   size_t operator () (const EventType &vec);
@@ -201,6 +203,7 @@ class ConstantEventMap: public EventMap {
  private:
   EventAnswerType answer_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(ConstantEventMap);
+  friend class CompiledEventMap;
 };
 
 class TableEventMap: public EventMap {
@@ -261,6 +264,7 @@ class TableEventMap: public EventMap {
   EventKeyType key_;
   std::vector<EventMap*> table_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(TableEventMap);
+  friend class CompiledEventMap;
 };
 
 
@@ -338,6 +342,7 @@ class SplitEventMap: public EventMap {  // A decision tree [non-leaf] node.
   EventMap *yes_;  // owned here.
   EventMap *no_;  // owned here.
   SplitEventMap &operator = (const SplitEventMap &other);  // Disallow.
+  friend class CompiledEventMap;
 };
 
 /**
@@ -305,6 +305,42 @@ void UnitTestIoStandard() {
   }
 }
 
+// Reads from offsets into two files in random order with the same Input
+// object, which keeps them open depending on --io-cached-files.
+void UnitTestOffsetInput() {
+  for (int32 n = 0; n < 4; n++) {
+    g_io_options.buffer_size = (n % 2 == 0 ? 16 : 131072);
+    g_io_options.num_cached_files = 1 + n / 2;
+
+    const char *filenames[] = { "tmpf1", "tmpf2" };
+    std::vector<std::vector<size_t> > offsets(2);
+    for (int32 f = 0; f < 2; f++) {
+      Output ko(filenames[f], true, false);
+      for (int32 i = 0; i < 100; i++) {
+        offsets[f].push_back(ko.Stream().tellp());
+        WriteBasicType(ko.Stream(), true, 1000 * f + i);
+        // gaps of different sizes, for Seek().
+        for (int32 j = Rand() % 300; j > 0; j--)
+          ko.Stream() << ' ';
+      }
+    }
+    Input ki;
+    for (int32 k = 0; k < 500; k++) {
+      int32 f = Rand() % 2, i = Rand() % 100;
+      std::ostringstream rxfilename;
+      rxfilename << filenames[f] << ":" << offsets[f][i];
+      KALDI_ASSERT(ki.Open(rxfilename.str()));
+      int32 value;
+      ReadBasicType(ki.Stream(), true, &value);
+      KALDI_ASSERT(value == 1000 * f + i);
+    }
+    ki.Close();
+    unlink(filenames[0]);
+    unlink(filenames[1]);
+  }
+  g_io_options = IoOptions();
+}
+
 // This is Windows-specific.
 void UnitTestNativeFilename() {
 #ifdef KALDI_CYGWIN_COMPAT
@@ -363,6 +399,14 @@ int main(int argc, const char** argv) {
   UnitTestIoStandard();
   UnitTestClassifyRxfilename();
   UnitTestClassifyWxfilename();
+  UnitTestOffsetInput();
+  {
+    // with a tiny buffer.
+    g_io_options.buffer_size = 7;
+    UnitTestIoNew(true);
+    UnitTestIoPipe(false);
+    g_io_options = IoOptions();
+  }
 
   KALDI_ASSERT(1);  // just wanted to check that KALDI_ASSERT does not fail
   // for 1.
@@ -19,7 +19,11 @@
 // limitations under the License.
 #include "util/kaldi-io.h"
 #include <errno.h>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#endif
 #include <cstdlib>
+#include <list>
 #include "base/kaldi-math.h"
 #include "util/text-utils.h"
 #include "util/parse-options.h"
@@ -54,6 +58,44 @@ namespace kaldi {
 // Would mean we could use less of our own code.
 typedef basic_pipebuf<char> PipebufType;
 #endif
+
+IoOptions g_io_options;
+
+// Gives the file buffer 'fb', which must not be open yet, a buffer of
+// --io-buffer-size bytes, which is kept in 'buffer'.  (The default is only
+// BUFSIZ, so each read or write is a system call for a few kilobytes.)
+static void SetFileBuffer(std::filebuf *fb, std::vector<char> *buffer) {
+  if (g_io_options.buffer_size <= 0)
+    return;
+  buffer->resize(g_io_options.buffer_size);
+  fb->pubsetbuf(&((*buffer)[0]), buffer->size());
+}
+
+static size_t PipeBufferSize() {
+  return (g_io_options.buffer_size > 0 ? g_io_options.buffer_size : BUFSIZ);
+}
+
+#if defined(__GLIBCXX__) && defined(POSIX_FADV_SEQUENTIAL)
+// For the file descriptor of a std::filebuf, which is only available in
+// libstdc++ (like the internals basic_pipebuf uses).
+struct FilebufAccess: public std::filebuf {
+  static int Fd(std::filebuf *fb) {
+    return (fb->*(&FilebufAccess::_M_file)).fd();
+  }
+};
+#endif
+
+// Tells the operating system that the file just opened in 'fb' will be read
+// from start to end, so that it reads ahead more; with --io-readahead.
+static void AdviseSequentialRead(std::filebuf *fb) {
+#if defined(__GLIBCXX__) && defined(POSIX_FADV_SEQUENTIAL)
+  if (!g_io_options.readahead)
+    return;
+  int fd = FilebufAccess::Fd(fb);
+  if (fd >= 0)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);  // just a hint.
+#endif
+}
 }
 
 namespace kaldi {
@@ -202,6 +244,7 @@ class FileOutputImpl: public OutputImplBase {
     if (os_.is_open()) KALDI_ERR << "FileOutputImpl::Open(), "
                                 << "open called on already open file.";
     filename_ = filename;
+    SetFileBuffer(os_.rdbuf(), &buffer_);
     os_.open(MapOsPath(filename_).c_str(),
              binary ? std::ios_base::out | std::ios_base::binary
                     : std::ios_base::out);
@@ -231,6 +274,7 @@ class FileOutputImpl: public OutputImplBase {
   }
  private:
   std::string filename_;
+  std::vector<char> buffer_;  // must outlive os_.
   std::ofstream os_;
 };
 
@@ -299,7 +343,8 @@ class PipeOutputImpl: public OutputImplBase {
                                  // we're done.
                                   (binary ? std::ios_base::out|
                                    std::ios_base::binary
-                                   :std::ios_base::out));
+                                   :std::ios_base::out),
+                                  PipeBufferSize());
       KALDI_ASSERT(fb_ != NULL);  // or would be alloc error.
       os_ = new std::ostream(fb_);
 #else
@@ -383,10 +428,14 @@ class FileInputImpl: public InputImplBase {
   virtual bool Open(const std::string &filename, bool binary) {
     if (is_.is_open()) KALDI_ERR << "FileInputImpl::Open(), "
                                 << "open called on already open file.";
+    SetFileBuffer(is_.rdbuf(), &buffer_);
     is_.open(MapOsPath(filename).c_str(),
              binary ? std::ios_base::in | std::ios_base::binary
                     : std::ios_base::in);
-    return is_.is_open();
+    if (!is_.is_open())
+      return false;
+    AdviseSequentialRead(is_.rdbuf());
+    return true;
   }
 
   virtual std::istream &Stream() {
@@ -412,6 +461,7 @@ class FileInputImpl: public InputImplBase {
     // whether it fails.
   }
  private:
+  std::vector<char> buffer_;  // must outlive is_.
   std::ifstream is_;
 };
 
@@ -476,7 +526,8 @@ class PipeInputImpl: public InputImplBase {
                                  // destructor to close the stream.
                                  (binary ? std::ios_base::in|
                                   std::ios_base::binary
-                                  :std::ios_base::in));
+                                  :std::ios_base::in),
+                                 PipeBufferSize());
       KALDI_ASSERT(fb_ != NULL);  // or would be alloc error.
       is_ = new std::istream(fb_);
 #else
@@ -575,76 +626,82 @@ class OffsetFileInputImpl: public InputImplBase {
                 << " byte offset into a file; you'll have to compile 64-bit.";
   }
 
+  OffsetFileInputImpl(): current_(NULL) { }
+
   bool Seek(size_t offset) {
-    size_t cur_pos = is_.tellg();
+    std::ifstream &is = current_->is;
+    size_t cur_pos = is.tellg();
     if (cur_pos == offset) return true;
-    else if (cur_pos<offset && cur_pos+100 > offset) {
+    else if (cur_pos < offset &&
+             cur_pos + std::max<int32>(g_io_options.buffer_size, 100) > offset) {
       // We're close enough that it may be faster to just
-      // read that data, rather than seek.
-      for (size_t i = cur_pos; i < offset; i++)
-        is_.get();
-      return (is_.tellg() == std::streampos(offset));
+      // read that data (much of which may be in the buffer), rather than
+      // seek.
+      is.ignore(offset - cur_pos);
+      return (is.tellg() == std::streampos(offset));
     }
     // Try to actually seek.
-    is_.seekg(offset, std::ios_base::beg);
-    if (is_.fail()) {  // failbit or badbit is set [error happened]
-      is_.close();
+    is.seekg(offset, std::ios_base::beg);
+    if (is.fail()) {  // failbit or badbit is set [error happened]
       return false;  // failure.
     } else {
-      is_.clear();  // Clear any failure bits (e.g. eof).
+      is.clear();  // Clear any failure bits (e.g. eof).
       return true;  // success.
     }
   }
 
   // This Open routine is unusual in that it is designed to work even
   // if it was already open.  This for efficiency when seeking multiple
-  // times.
+  // times: the last --io-cached-files files stay open, so when the entries of
+  // an scp file alternate between archives we just seek.
   virtual bool Open(const std::string &rxfilename, bool binary) {
-    if (is_.is_open()) {
-      // We are opening when we have an already-open file.
-      // We may have to seek within this file, or else close it and
-      // open a different one.
-      std::string tmp_filename;
-      size_t offset;
-      SplitFilename(rxfilename, &tmp_filename, &offset);
-      if (tmp_filename == filename_ && binary == binary_) {  // Just seek
-        is_.clear();  // clear fail bit, etc.
+    std::string filename;
+    size_t offset;
+    SplitFilename(rxfilename, &filename, &offset);
+    current_ = NULL;
+    for (std::list<CachedFile*>::iterator iter = files_.begin();
+         iter != files_.end(); ++iter) {
+      if ((*iter)->filename == filename && (*iter)->binary == binary) {
+        // Just seek; the most recently used file goes first.
+        files_.splice(files_.begin(), files_, iter);
+        current_ = files_.front();
+        current_->is.clear();  // clear fail bit, etc.
         return Seek(offset);
-      } else {
-        is_.close();  // don't bother checking error status of is_.
-        filename_ = tmp_filename;
-        is_.open(MapOsPath(filename_).c_str(),
-                 binary ? std::ios_base::in | std::ios_base::binary
-                        : std::ios_base::in);
-        if (!is_.is_open()) return false;
-        else
-          return Seek(offset);
       }
-    } else {
-      size_t offset;
-      SplitFilename(rxfilename, &filename_, &offset);
-      binary_ = binary;
-      is_.open(MapOsPath(filename_).c_str(),
-                binary ? std::ios_base::in | std::ios_base::binary
-                      : std::ios_base::in);
-      if (!is_.is_open()) return false;
-      else
-        return Seek(offset);
     }
+    size_t max_files = std::max<int32>(g_io_options.num_cached_files, 1);
+    while (!files_.empty() && files_.size() >= max_files) {
+      delete files_.back();  // don't bother checking error status.
+      files_.pop_back();
+    }
+    CachedFile *file = new CachedFile();
+    file->filename = filename;
+    file->binary = binary;
+    SetFileBuffer(file->is.rdbuf(), &(file->buffer));
+    file->is.open(MapOsPath(filename).c_str(),
+                  binary ? std::ios_base::in | std::ios_base::binary
+                         : std::ios_base::in);
+    if (!file->is.is_open()) {
+      delete file;
+      return false;
+    }
+    files_.push_front(file);
+    current_ = file;
+    return Seek(offset);
   }
 
   virtual std::istream &Stream() {
-    if (!is_.is_open())
+    if (current_ == NULL)
       KALDI_ERR << "FileInputImpl::Stream(), file is not open.";
     // I believe this error can only arise from coding error.
-    return is_;
+    return current_->is;
   }
 
   virtual int32 Close() {
-    if (!is_.is_open())
+    if (current_ == NULL)
       KALDI_ERR << "FileInputImpl::Close(), file is not open.";
     // I believe this error can only arise from coding error.
-    is_.close();
+    CloseAll();
     // Don't check status.
     return 0;
   }
@@ -652,13 +709,28 @@ class OffsetFileInputImpl: public InputImplBase {
   virtual InputType MyType() { return kOffsetFileInput; }
 
   virtual ~OffsetFileInputImpl() {
-    // Stream will automatically be closed, and we don't care about
+    // Streams will automatically be closed, and we don't care about
     // whether it fails.
+    CloseAll();
   }
  private:
-  std::string filename_;  // the actual filename
-  bool binary_;  // true if was opened in binary mode.
-  std::ifstream is_;
+  struct CachedFile {
+    std::string filename;  // the actual filename
+    bool binary;  // true if was opened in binary mode.
+    std::vector<char> buffer;  // must outlive is.
+    std::ifstream is;
+  };
+
+  void CloseAll() {
+    for (std::list<CachedFile*>::iterator iter = files_.begin();
+         iter != files_.end(); ++iter)
+      delete *iter;
+    files_.clear();
+    current_ = NULL;
+  }
+
+  std::list<CachedFile*> files_;  // the open files, most recently used first.
+  CachedFile *current_;  // the one Stream() returns, or NULL.
 };
 
 
@@ -28,6 +28,7 @@
 #include <limits>
 #include <string>
 #include "base/kaldi-common.h"
+#include "itf/options-itf.h"
 #include "matrix/kaldi-matrix.h"
 
 
@@ -121,6 +122,39 @@ enum InputType {
 InputType ClassifyRxfilename(const std::string &rxfilename);
 
 
+/// Options for the buffering of the files and pipes that Input and Output
+/// open.  Programs that read or write a lot (e.g. egs) register them with
+/// RegisterIoOptions().
+struct IoOptions {
+  int32 buffer_size;
+  int32 num_cached_files;
+  bool readahead;
+
+  IoOptions(): buffer_size(131072), num_cached_files(8), readahead(true) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("io-buffer-size", &buffer_size, "Size in bytes of the "
+                   "buffers of the files and pipes that are read and written "
+                   "(if <= 0, the C++ library's default)");
+    opts->Register("io-cached-files", &num_cached_files, "Number of files an "
+                   "Input object keeps open for reading from offsets (as in "
+                   "scp files that refer to several archives), so that it can "
+                   "seek instead of reopening them");
+    opts->Register("io-readahead", &readahead, "If true, tell the operating "
+                   "system that files that are read from the start are read "
+                   "sequentially, so that it reads further ahead");
+  }
+};
+
+// The options are read whenever a stream is opened, so they can be changed
+// at any time (before the program uses more than one thread).
+extern IoOptions g_io_options;
+
+inline void RegisterIoOptions(OptionsItf *po) {
+  g_io_options.Register(po);
+}
+
+
 class Output {
  public:
   // The normal constructor, provided for convenience.
@@ -47,8 +47,10 @@ class basic_pipebuf : public basic_filebuf<CharType, Traits> {
   typedef basic_pipebuf<CharType, Traits>   ThisType;
 
  public:
-  basic_pipebuf(FILE *fptr, std::ios_base::openmode mode)
+  basic_pipebuf(FILE *fptr, std::ios_base::openmode mode,
+                size_t buffer_size = BUFSIZ)
       : basic_filebuf<CharType, Traits>() {
+    this->pubsetbuf(NULL, buffer_size);
     this->open(fptr, mode);
     if (!this->is_open()) {
       KALDI_WARN << "Error initializing pipebuf";  // probably indicates
@@ -64,7 +66,8 @@ class basic_pipebuf : public std::basic_filebuf<CharType, Traits> {
   typedef basic_pipebuf<CharType, Traits>   ThisType;
 
  public:
-  basic_pipebuf(FILE *fptr, std::ios_base::openmode mode)
+  basic_pipebuf(FILE *fptr, std::ios_base::openmode mode,
+                size_t buffer_size = BUFSIZ)
       : std::basic_filebuf<CharType, Traits>() {
     this->_M_file.sys_open(fptr, mode);
     if (!this->is_open()) {
@@ -73,7 +76,7 @@ class basic_pipebuf : public std::basic_filebuf<CharType, Traits> {
       return;
     }
     this->_M_mode = mode;
-    this->_M_buf_size = BUFSIZ;
+    this->_M_buf_size = buffer_size;
     this->_M_allocate_internal_buffer();
     this->_M_reading = false;
     this->_M_writing = false;
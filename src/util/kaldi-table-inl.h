@@ -24,8 +24,12 @@
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <errno.h>
@@ -41,6 +45,41 @@ namespace kaldi {
 /// \addtogroup table_impl_types
 /// @{
 
+// Decompresses and reads an object from the output of ReadCompressedObject();
+// returns false on error.
+template<class Holder>
+bool ReadDecompressedObject(const std::string &compressed, Holder *holder) {
+  std::string data;
+  if (!DecompressObject(compressed, &data))
+    return false;
+  MemoryInputBuffer buffer(data.data(), data.data() + data.size());
+  std::istream is(&buffer);
+  return holder->Read(is);
+}
+
+// Reads an object of a Table as Holder::Read does, whether it was written
+// compressed (with the "zstd" wspecifier option) or not.
+template<class Holder>
+bool ReadTableObject(std::istream &is, Holder *holder) {
+  if (!IsCompressedObjectNext(is))
+    return holder->Read(is);
+  std::string compressed;
+  return ReadCompressedObject(is, &compressed) &&
+      ReadDecompressedObject(compressed, holder);
+}
+
+// Writes an object of a Table as Holder::Write does, compressed if the
+// wspecifier had the "zstd" option.
+template<class Holder>
+bool WriteTableObject(std::ostream &os, const WspecifierOptions &opts,
+                      const typename Holder::T &value) {
+  if (!opts.compress)
+    return Holder::Write(os, opts.binary, value);
+  std::ostringstream buffer;
+  return Holder::Write(buffer, opts.binary, value) &&
+      WriteCompressedObject(buffer.str(), opts.compression_level, os);
+}
+
 template<class Holder> class SequentialTableReaderImplBase {
  public:
   typedef typename Holder::T T;
@@ -210,6 +249,17 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     // function needs to be lightweight for the 'bg' feature to work well.
   }
 
+  // Outputs the rxfilename and the range (empty if none) of the current scp
+  // line, for SequentialTableReaderPrefetchImpl to load the object itself.
+  // Valid whenever Done() returns false.
+  void GetScpLine(std::string *data_rxfilename, std::string *range) const {
+    if (!(state_ == kHaveScpLine || state_ == kHaveObject ||
+          state_ == kHaveRange))
+      KALDI_ERR << "GetScpLine() called at the wrong time.";
+    *data_rxfilename = data_rxfilename_;
+    *range = range_;
+  }
+
   // Next goes to the next object.
   // It can leave the object in most of the statuses, but
   // the only circumstances under which it will return are:
@@ -311,7 +361,7 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
                    << PrintableRxfilename(data_rxfilename_);
         return false;
       } else {
-        if (holder_.Read(data_input_.Stream())) {
+        if (ReadTableObject(data_input_.Stream(), &holder_)) {
           state_ = kHaveObject;
         } else {  // holder_ will not contain data.
           KALDI_WARN << "Failed to load object from "
@@ -485,7 +535,8 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
  public:
   typedef typename Holder::T T;
 
-  SequentialTableReaderArchiveImpl(): state_(kUninitialized) { }
+  SequentialTableReaderArchiveImpl(): defer_decompression_(false),
+                                      state_(kUninitialized) { }
 
   virtual bool Open(const std::string &rspecifier) {
     if (state_ != kUninitialized) {
@@ -546,6 +597,21 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
       state_ = kEof;
       return;
     }
+    while (IsArchiveIndexKey(key_)) {  // the "idx" index at the end of the
+      // archive: skip it.  Other archives may follow it, if archives were
+      // concatenated.
+      if (!SkipArchiveIndex(is)) {
+        KALDI_WARN << "Invalid archive index, reading archive "
+                   << PrintableRxfilename(archive_rxfilename_);
+        state_ = kError;
+        return;
+      }
+      is >> key_;
+      if (is.eof()) {
+        state_ = kEof;
+        return;
+      }
+    }
     if (is.fail()) {  // This shouldn't really happen, barring file-system
                       // errors.
       KALDI_WARN << "Error reading archive "
@@ -567,7 +633,13 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
       return;
     }
     if (c != '\n') is.get();  // Consume the space or tab.
-    if (holder_.Read(is)) {
+    bool ans;
+    compressed_.clear();
+    if (defer_decompression_ && IsCompressedObjectNext(is))
+      ans = ReadCompressedObject(is, &compressed_);
+    else
+      ans = ReadTableObject(is, &holder_);
+    if (ans) {
       state_ = kHaveObject;
       return;
     } else {
@@ -632,6 +704,26 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     }
   }
 
+  // For SequentialTableReaderPrefetchImpl: if true, Next() only reads the
+  // compressed data of objects written with the "zstd" option, for
+  // TakeCompressedObject() to output, so that they can be decompressed in
+  // other threads.
+  void SetDeferDecompression(bool defer) { defer_decompression_ = defer; }
+
+  // If the current object was left compressed, outputs its compressed data
+  // (see ReadCompressedObject()), frees it as FreeCurrent() does and returns
+  // true; else returns false.
+  bool TakeCompressedObject(std::string *compressed) {
+    if (state_ != kHaveObject || compressed_.empty())
+      return false;
+    compressed->swap(compressed_);
+    compressed_.clear();
+    state_ = kFreedObject;
+    return true;
+  }
+
+  const std::string &ArchiveRxfilename() const { return archive_rxfilename_; }
+
   void SwapHolder(Holder *other_holder) {
     // call Value() to ensure we have a value, and ignore its return value while
     // suppressing compiler warnings by casting to void.
@@ -685,6 +777,8 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
   std::string rspecifier_;
   std::string archive_rxfilename_;
   RspecifierOptions opts_;
+  bool defer_decompression_;
+  std::string compressed_;  // the current object, if it was left compressed.
   enum StateType {  //  [The state of the reading process]        [does holder_ [is input_
     //                                                     have object]   open]
     kUninitialized,  // Uninitialized or closed.                  no         no
@@ -853,6 +947,311 @@ class SequentialTableReaderBackgroundImpl:
 
 };
 
+// SequentialTableReaderPrefetchImpl is used for the "bgN" option with N > 1:
+// it reads up to N objects ahead of the one the user is at.  If it is given
+// an scp reader (in which case base_reader must be that reader), the objects
+// are loaded by N threads at once, each from its own scp line.  If it is given
+// an archive reader instead, the threads take turns to read from it, and the
+// objects written with the "zstd" option are decompressed by them at once.
+// Else one thread reads the objects from the base reader in turn.
+template<class Holder>
+class SequentialTableReaderPrefetchImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderPrefetchImpl(
+      SequentialTableReaderImplBase<Holder> *base_reader,
+      SequentialTableReaderScriptImpl<Holder> *script_reader,
+      SequentialTableReaderArchiveImpl<Holder> *archive_reader,
+      int32 depth):
+      base_reader_(base_reader), script_reader_(script_reader),
+      archive_reader_(archive_reader), depth_(depth), current_(NULL),
+      base_done_(false), base_busy_(false), stop_(false), error_(false) {
+    KALDI_ASSERT(depth_ > 0);
+  }
+
+  // This function ignores the rxfilename argument, like
+  // SequentialTableReaderBackgroundImpl::Open().
+  virtual bool Open(const std::string &rxfilename) {
+    KALDI_ASSERT(base_reader_ != NULL &&
+                 base_reader_->IsOpen());  // or code error.
+    base_done_ = base_reader_->Done();
+    if (archive_reader_ != NULL)
+      archive_reader_->SetDeferDecompression(true);
+    int32 num_threads = (script_reader_ != NULL || archive_reader_ != NULL ?
+                         depth_ : 1);
+    for (int32 i = 0; i < num_threads; i++)
+      threads_.push_back(std::thread(
+          SequentialTableReaderPrefetchImpl<Holder>::run, this));
+    Next();
+    return true;
+  }
+
+  virtual bool IsOpen() const { return base_reader_ != NULL; }
+
+  virtual bool Done() const { return current_ == NULL; }
+
+  virtual std::string Key() {
+    if (current_ == NULL)
+      KALDI_ERR << "Calling Key() at the wrong time.";
+    return current_->key;
+  }
+
+  virtual T &Value() {
+    if (current_ == NULL)
+      KALDI_ERR << "Calling Value() at the wrong time.";
+    if (!current_->loaded)
+      KALDI_ERR << "Failed to load object from "
+                << PrintableRxfilename(current_->data_rxfilename)
+                << " (to suppress this error, add the permissive "
+                << "(p, ) option to the rspecifier.";
+    return current_->holder.Value();
+  }
+
+  void SwapHolder(Holder *other_holder) {
+    KALDI_ERR << "SwapHolder() should not be called on this class.";
+  }
+
+  virtual void FreeCurrent() {
+    if (current_ == NULL)
+      KALDI_ERR << "Calling FreeCurrent() at the wrong time.";
+    current_->holder.Clear();
+  }
+
+  virtual void Next() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    delete current_;
+    current_ = NULL;
+    // wait for the next object, unless there are no more.
+    while (items_.empty() ? !base_done_ : !items_.front()->done)
+      consumer_cond_.wait(lock);
+    if (items_.empty()) {
+      if (error_)
+        KALDI_ERR << "Error detected (likely code error) in background "
+                  << "reader (',bg' option)";
+      return;
+    }
+    current_ = items_.front();
+    items_.pop_front();
+    producer_cond_.notify_all();
+  }
+
+  // note: we can be sure that Close() won't be called twice, as the TableReader
+  // object will delete this object after calling Close.
+  virtual bool Close() {
+    KALDI_ASSERT(base_reader_ != NULL);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    producer_cond_.notify_all();
+    for (size_t i = 0; i < threads_.size(); i++)
+      threads_[i].join();
+    threads_.clear();
+    delete current_;
+    current_ = NULL;
+    for (size_t i = 0; i < items_.size(); i++)
+      delete items_[i];
+    items_.clear();
+    bool ans = !error_;
+    try {
+      ans = base_reader_->Close() && ans;
+    } catch (...) {
+      ans = false;
+    }
+    delete base_reader_;
+    base_reader_ = NULL;
+    return ans;
+  }
+
+  ~SequentialTableReaderPrefetchImpl() {
+    if (base_reader_) {
+      if (!Close()) {
+        KALDI_ERR << "Error detected closing background reader "
+                  << "(relates to ',bg' modifier)";
+      }
+    }
+  }
+
+ private:
+  struct Item {
+    std::string key;
+    std::string data_rxfilename;  // scp only.
+    std::string range;  // scp only.
+    std::string compressed;  // archives only, see TakeCompressedObject().
+    Holder holder;
+    bool done;  // true once it has been read (or has failed to be read).
+    bool loaded;  // true if it was read successfully.
+    Item(): done(false), loaded(false) { }
+  };
+
+  static void run(SequentialTableReaderPrefetchImpl<Holder> *object) {
+    object->RunInBackground();
+  }
+
+  // Runs in each of the background threads.
+  void RunInBackground() {
+    // the last whole object this thread read for an scp line with a range.
+    std::string cache_rxfilename;
+    Holder cache;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      while (!stop_ && !base_done_ &&
+             (base_busy_ || static_cast<int32>(items_.size()) >= depth_))
+        producer_cond_.wait(lock);
+      if (stop_ || base_done_)
+        return;
+      Item *item = new Item();
+      items_.push_back(item);
+      try {
+        item->key = base_reader_->Key();
+        if (script_reader_ != NULL) {
+          // Take the scp line and go to the next one (which is cheap), then
+          // load the object while other threads load others.
+          script_reader_->GetScpLine(&(item->data_rxfilename),
+                                     &(item->range));
+          base_reader_->Next();
+          base_done_ = base_reader_->Done();
+          lock.unlock();
+          producer_cond_.notify_all();
+          item->loaded = LoadObject(item, &cache_rxfilename, &cache);
+          lock.lock();
+        } else if (archive_reader_ != NULL) {
+          // Read the next object while nobody else reads from the archive
+          // (with the lock released), and decompress this one, if it is
+          // compressed, while the others read.
+          bool compressed = archive_reader_->TakeCompressedObject(
+              &(item->compressed));
+          if (!compressed) {
+            base_reader_->SwapHolder(&(item->holder));
+            item->loaded = true;
+            item->done = true;
+            consumer_cond_.notify_all();
+            item = NULL;  // the main thread may delete it once we unlock.
+          }
+          base_busy_ = true;
+          lock.unlock();
+          base_reader_->Next();
+          lock.lock();
+          base_busy_ = false;
+          base_done_ = base_reader_->Done();
+          producer_cond_.notify_all();
+          if (compressed) {
+            lock.unlock();
+            item->loaded = ReadDecompressedObject(item->compressed,
+                                                  &(item->holder));
+            if (!item->loaded)
+              item->data_rxfilename = archive_reader_->ArchiveRxfilename();
+            item->compressed.clear();
+            lock.lock();
+          }
+        } else {
+          // We are the only thread; reading the next object is the slow part.
+          base_reader_->SwapHolder(&(item->holder));
+          item->loaded = true;
+          item->done = true;
+          consumer_cond_.notify_all();
+          item = NULL;  // the main thread may delete it once we unlock.
+          lock.unlock();
+          base_reader_->Next();
+          lock.lock();
+          base_done_ = base_reader_->Done();
+        }
+      } catch (...) {
+        // As for SequentialTableReaderBackgroundImpl, there is nothing here
+        // that should throw due to user data, so we treat it as a code error,
+        // detected in Next().
+        if (!lock.owns_lock())
+          lock.lock();
+        error_ = true;
+        base_done_ = true;
+        base_busy_ = false;
+      }
+      if (item != NULL)
+        item->done = true;
+      consumer_cond_.notify_all();
+    }
+  }
+
+  // Loads the object of an scp line; returns false on failure.  This does what
+  // SequentialTableReaderScriptImpl::EnsureObjectLoaded() does.  For lines with
+  // a range, the whole object is kept in *cache (and its rxfilename in
+  // *cache_rxfilename), so that a thread does not read it again for the next
+  // range of the same file it gets, as in segmented scp's; each thread has its
+  // own cache.
+  static bool LoadObject(Item *item, std::string *cache_rxfilename,
+                         Holder *cache) {
+    try {
+      bool have_range = !item->range.empty();
+      Holder *holder = (have_range ? cache : &(item->holder));
+      if (!have_range || *cache_rxfilename != item->data_rxfilename) {
+        if (have_range)
+          cache_rxfilename->clear();
+        Input input;
+        bool ans;
+        // note, NULL means it doesn't read the binary-mode header
+        if (Holder::IsReadInBinary())
+          ans = input.Open(item->data_rxfilename, NULL);
+        else
+          ans = input.OpenTextMode(item->data_rxfilename);
+        if (!ans) {
+          KALDI_WARN << "Failed to open file "
+                     << PrintableRxfilename(item->data_rxfilename);
+          return false;
+        }
+        if (!ReadTableObject(input.Stream(), holder)) {
+          KALDI_WARN << "Failed to load object from "
+                     << PrintableRxfilename(item->data_rxfilename);
+          return false;
+        }
+        if (have_range)
+          *cache_rxfilename = item->data_rxfilename;
+      }
+      if (!have_range)
+        return true;
+      if (!item->holder.ExtractRange(*cache, item->range)) {
+        KALDI_WARN  << "Failed to load object from "
+                    << PrintableRxfilename(item->data_rxfilename)
+                    << "[" << item->range << "]";
+        return false;
+      }
+      return true;
+    } catch (const std::exception &e) {
+      KALDI_WARN << "Exception caught loading object from "
+                 << PrintableRxfilename(item->data_rxfilename) << ". "
+                 << e.what();
+      cache_rxfilename->clear();
+      return false;
+    }
+  }
+
+  SequentialTableReaderImplBase<Holder> *base_reader_;
+  // the same as base_reader_ if it is an scp reader (and not permissive), else
+  // NULL.
+  SequentialTableReaderScriptImpl<Holder> *script_reader_;
+  // the same as base_reader_ if it is an archive reader (and not permissive),
+  // else NULL.
+  SequentialTableReaderArchiveImpl<Holder> *archive_reader_;
+  int32 depth_;
+  std::vector<std::thread> threads_;
+
+  // the object the user is at; owned by the main thread.
+  Item *current_;
+
+  // The rest is protected by mutex_.  items_ are the objects after current_,
+  // in order, including those still being read.
+  std::mutex mutex_;
+  std::condition_variable consumer_cond_;  // the main thread waits on this.
+  std::condition_variable producer_cond_;  // the background threads wait on
+                                           // this.
+  std::deque<Item*> items_;
+  bool base_done_;  // true once base_reader_ has no more objects.
+  bool base_busy_;  // true while a thread reads from archive_reader_.
+  bool stop_;  // set by Close().
+  bool error_;
+};
+
 template<class Holder>
 SequentialTableReader<Holder>::SequentialTableReader(const std::string
                                                      &rspecifier): impl_(NULL) {
@@ -885,7 +1284,22 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
     impl_ = NULL;
     return false;  // sub-object will have printed warnings.
   }
-  if (opts.background) {
+  if (opts.background && opts.background_depth > 1) {
+    SequentialTableReaderScriptImpl<Holder> *script_reader = NULL;
+    SequentialTableReaderArchiveImpl<Holder> *archive_reader = NULL;
+    if (wt == kScriptRspecifier && !opts.permissive)
+      script_reader = static_cast<SequentialTableReaderScriptImpl<Holder>*>(
+          impl_);
+    if (wt == kArchiveRspecifier && !opts.permissive)
+      archive_reader = static_cast<SequentialTableReaderArchiveImpl<Holder>*>(
+          impl_);
+    impl_ = new SequentialTableReaderPrefetchImpl<Holder>(
+        impl_, script_reader, archive_reader, opts.background_depth);
+    if (!impl_->Open("")) {
+      // It should only return false on code error.
+      return false;
+    }
+  } else if (opts.background) {
     impl_ = new SequentialTableReaderBackgroundImpl<Holder>(
         impl_);
     if (!impl_->Open("")) {
@@ -973,6 +1387,13 @@ template<class Holder> class TableWriterImplBase {
   // TableWriter::Write returned an exit status.
   virtual bool Write(const std::string &key, const T &value) = 0;
 
+  // Like Write(), but the implementation may move from *value instead of
+  // copying it.  Only TableWriterBackgroundImpl keeps the objects it is given,
+  // so by default this just calls Write().
+  virtual bool WriteMove(const std::string &key, T *value) {
+    return Write(key, *value);
+  }
+
   // Flush will flush any archive; it does not return error status,
   //  any errors will be reported on the next Write or Close.
   virtual void Flush() = 0;
@@ -1014,6 +1435,12 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
                                            NULL,
                                            &opts_);
     KALDI_ASSERT(ws == kArchiveWspecifier);  // or wrongly called.
+    if (opts_.index && ClassifyWxfilename(archive_wxfilename_) != kFileOutput) {
+      KALDI_WARN << "Ignoring the idx option, as the archive is not an actual "
+                 << "file: wspecifier = " << wspecifier;
+      opts_.index = false;
+    }
+    index_.clear();
 
     if (output_.Open(archive_wxfilename_, opts_.binary, false)) {  // false
                                                       // means no binary header.
@@ -1053,7 +1480,10 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     if (!IsToken(key))  // e.g. empty string or has spaces...
       KALDI_ERR << "Using invalid key " << key;
     output_.Stream() << key << ' ';
-    if (!Holder::Write(output_.Stream(), opts_.binary, value)) {
+    if (opts_.index)
+      index_.push_back(std::make_pair(key,
+                                      static_cast<int64>(output_.Stream().tellp())));
+    if (!WriteTableObject<Holder>(output_.Stream(), opts_, value)) {
       KALDI_WARN << "Write failure to "
                  << PrintableWxfilename(archive_wxfilename_);
       state_ = kWriteError;
@@ -1084,6 +1514,12 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     if (!this->IsOpen() || !output_.IsOpen())
       KALDI_ERR << "Close called on a stream that was not open."
                 << this->IsOpen() << ", " << output_.IsOpen();
+    if (opts_.index && state_ == kOpen &&
+        !WriteArchiveIndex(index_, output_.Stream())) {
+      KALDI_WARN << "Failed to write archive index: wspecifier is "
+                 << wspecifier_;
+      state_ = kWriteError;
+    }
     bool close_success = output_.Close();
     if (!close_success) {
       KALDI_WARN << "Error closing stream: wspecifier is " << wspecifier_;
@@ -1115,6 +1551,8 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
   WspecifierOptions opts_;
   std::string wspecifier_;
   std::string archive_wxfilename_;
+  // the keys and offsets of the objects, for the "idx" option.
+  std::vector<std::pair<std::string, int64> > index_;
   enum {               // is stream open?
     kUninitialized,    // no
     kOpen,             // yes
@@ -1216,7 +1654,7 @@ class TableWriterScriptImpl: public TableWriterImplBase<Holder> {
                  << PrintableWxfilename(wxfilename);
       return false;
     }
-    if (!Holder::Write(output.Stream(), opts_.binary, value)
+    if (!WriteTableObject<Holder>(output.Stream(), opts_, value)
         || !output.Close()) {
       KALDI_WARN << "Failed to write data to "
                  << PrintableWxfilename(wxfilename);
@@ -1312,6 +1750,13 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
           "will generally not be interpreted correctly unless the archive is "
           "an actual file: wspecifier = " << wspecifier;
 
+    if (opts_.index && ClassifyWxfilename(archive_wxfilename_) != kFileOutput) {
+      KALDI_WARN << "Ignoring the idx option, as the archive is not an actual "
+                 << "file: wspecifier = " << wspecifier;
+      opts_.index = false;
+    }
+    index_.clear();
+
     if (!archive_output_.Open(archive_wxfilename_, opts_.binary, false)) {
       // false means no binary header.
       state_ = kUninitialized;
@@ -1374,6 +1819,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
     std::string offset_rxfilename;  // rxfilename with offset into the archive,
     // e.g. some_archive_name.ark:431541423
     MakeFilename(archive_os_pos, &offset_rxfilename);
+    if (opts_.index)
+      index_.push_back(std::make_pair(key, static_cast<int64>(archive_os_pos)));
 
     // Write to the script file first.
     // The idea is that we want to get all the information possible into the
@@ -1381,7 +1828,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
     std::ostream &script_os = script_output_.Stream();
     script_output_.Stream() << key << ' ' << offset_rxfilename << '\n';
 
-    if (!Holder::Write(archive_output_.Stream(), opts_.binary, value)) {
+    if (!WriteTableObject<Holder>(archive_output_.Stream(), opts_,
+                                  value)) {
       KALDI_WARN << "Write failure to"
                  << PrintableWxfilename(archive_wxfilename_);
       state_ = kWriteError;
@@ -1427,6 +1875,12 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
   virtual bool Close() {
     if (!this->IsOpen())
       KALDI_ERR << "Close called on a stream that was not open.";
+    if (opts_.index && state_ == kOpen &&
+        !WriteArchiveIndex(index_, archive_output_.Stream())) {
+      KALDI_WARN << "Failed to write archive index: wspecifier is "
+                 << wspecifier_;
+      state_ = kWriteError;
+    }
     bool close_success = true;
     if (archive_output_.IsOpen())
       if (!archive_output_.Close()) close_success = false;
@@ -1455,6 +1909,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
   std::string archive_wxfilename_;
   std::string script_wxfilename_;
   std::string wspecifier_;
+  // the keys and offsets of the objects, for the "idx" option.
+  std::vector<std::pair<std::string, int64> > index_;
   enum {               // is stream open?
     kUninitialized,    // no
     kOpen,             // yes
@@ -1476,6 +1932,174 @@ bool TableWriter<Holder>::IsOpen() const {
 }
 
 
+// TableWriterBackgroundImpl is used for the "bg" option of the wspecifier: it
+// writes the objects to base_writer in a thread of its own, so the calling
+// program does not wait for them to be written.  Write() copies the object
+// (WriteMove() moves it), and up to "depth" objects may be waiting to be
+// written at any one time.
+template<class Holder>
+class TableWriterBackgroundImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  TableWriterBackgroundImpl(TableWriterImplBase<Holder> *base_writer,
+                            int32 depth):
+      base_writer_(base_writer), depth_(depth), num_pending_(0),
+      stop_(false), error_(false) {
+    KALDI_ASSERT(depth_ > 0);
+  }
+
+  // This function ignores the wspecifier argument, as base_writer must
+  // already be open.
+  virtual bool Open(const std::string &wspecifier) {
+    KALDI_ASSERT(base_writer_ != NULL &&
+                 base_writer_->IsOpen());  // or code error.
+    thread_ = std::thread(TableWriterBackgroundImpl<Holder>::run, this);
+    return true;
+  }
+
+  virtual bool IsOpen() const { return base_writer_ != NULL; }
+
+  virtual bool Write(const std::string &key, const T &value) {
+    return Enqueue(key, new T(value));
+  }
+
+  virtual bool WriteMove(const std::string &key, T *value) {
+    return Enqueue(key, new T(std::move(*value)));
+  }
+
+  virtual void Flush() {
+    WaitForPending();
+    try {
+      base_writer_->Flush();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = true;
+    }
+  }
+
+  // note: we can be sure that Close() won't be called twice, as the
+  // TableWriter object will delete this object after calling Close.
+  virtual bool Close() {
+    KALDI_ASSERT(base_writer_ != NULL);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    pending_cond_.notify_one();
+    thread_.join();
+    bool ans = !error_;
+    try {
+      ans = base_writer_->Close() && ans;
+    } catch (...) {
+      ans = false;
+    }
+    delete base_writer_;
+    base_writer_ = NULL;
+    return ans;
+  }
+
+  ~TableWriterBackgroundImpl() {
+    if (base_writer_) {
+      if (!Close()) {
+        KALDI_ERR << "Error detected closing background writer "
+                  << "(relates to ',bg' modifier)";
+      }
+    }
+  }
+
+ private:
+  static void run(TableWriterBackgroundImpl<Holder> *object) {
+    object->RunInBackground();
+  }
+
+  // Runs in the background thread: writes the objects in the order they were
+  // given, and after Close() was called, those that are left.
+  void RunInBackground() {
+    // the last whole object this thread read for an scp line with a range.
+    std::string cache_rxfilename;
+    Holder cache;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      while (queue_.empty() && !stop_)
+        pending_cond_.wait(lock);
+      if (queue_.empty())
+        return;  // stop_ is set.
+      std::pair<std::string, T*> item = queue_.front();
+      queue_.pop_front();
+      bool error = error_;
+      lock.unlock();
+      bool ok = false;
+      if (!error) {  // once a write has failed, we write no more.
+        try {
+          ok = base_writer_->Write(item.first, *(item.second));
+        } catch (...) { }
+      }
+      delete item.second;
+      lock.lock();
+      if (!ok)
+        error_ = true;
+      num_pending_--;
+      done_cond_.notify_all();
+    }
+  }
+
+  // Adds "object" (which we take ownership of) to the queue, after waiting
+  // if depth_ objects are already pending.
+  bool Enqueue(const std::string &key, T *object) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (num_pending_ >= depth_ && !error_)
+      done_cond_.wait(lock);
+    if (error_) {
+      delete object;
+      return false;
+    }
+    queue_.push_back(std::make_pair(key, object));
+    num_pending_++;
+    lock.unlock();
+    pending_cond_.notify_one();
+    return true;
+  }
+
+  // Waits until all the objects given to Write() have been written.
+  void WaitForPending() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (num_pending_ > 0)
+      done_cond_.wait(lock);
+  }
+
+  TableWriterImplBase<Holder> *base_writer_;
+  int32 depth_;
+  std::thread thread_;
+
+  // The rest is protected by mutex_.  num_pending_ is the number of objects
+  // in queue_ plus the one being written, if any.
+  std::mutex mutex_;
+  std::condition_variable pending_cond_;  // the background thread waits on
+                                          // this.
+  std::condition_variable done_cond_;  // Write() and Flush() wait on this.
+  std::deque<std::pair<std::string, T*> > queue_;
+  int32 num_pending_;
+  bool stop_;
+  bool error_;
+};
+
+// Returns a TableWriterBackgroundImpl wrapping "impl" if the objects can be
+// copied, as the background writer requires; else "impl" itself.
+template<class Holder>
+TableWriterImplBase<Holder> *NewTableWriterBackgroundImpl(
+    TableWriterImplBase<Holder> *impl, int32 depth, std::true_type) {
+  return new TableWriterBackgroundImpl<Holder>(impl, depth);
+}
+
+template<class Holder>
+TableWriterImplBase<Holder> *NewTableWriterBackgroundImpl(
+    TableWriterImplBase<Holder> *impl, int32 depth, std::false_type) {
+  KALDI_WARN << "The objects of this table type cannot be copied, so the "
+             << "'bg' option of the wspecifier is ignored.";
+  return impl;
+}
+
 template<class Holder>
 bool TableWriter<Holder>::Open(const std::string &wspecifier) {
   if (IsOpen()) {
@@ -1483,7 +2107,13 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_ERR << "Failed to close previously open writer.";
   }
   KALDI_ASSERT(impl_ == NULL);
-  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, NULL);
+  WspecifierOptions opts;
+  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, &opts);
+  if (opts.compress && !ArchiveCompressionSupported()) {
+    KALDI_WARN << "The zstd option needs Kaldi to be compiled with zstd, "
+               << "writing to " << wspecifier;
+    return false;
+  }
   switch (wtype) {
     case kBothWspecifier:
       impl_ = new TableWriterBothImpl<Holder>();
@@ -1498,13 +2128,20 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_WARN << "ClassifyWspecifier: invalid wspecifier " << wspecifier;
       return false;
   }
-  if (impl_->Open(wspecifier)) {
-    return true;
-  } else {  // The class will have printed a more specific warning.
+  if (!impl_->Open(wspecifier)) {
+    // The class will have printed a more specific warning.
     delete impl_;
     impl_ = NULL;
     return false;
   }
+  if (opts.background) {
+    impl_ = NewTableWriterBackgroundImpl<Holder>(
+        impl_, opts.background_depth,
+        typename std::is_copy_constructible<T>::type());
+    if (!impl_->Open(wspecifier))  // It should only fail on code error.
+      KALDI_ERR << "Failed to start background writer.";
+  }
+  return true;
 }
 
 template<class Holder>
@@ -1517,6 +2154,14 @@ void TableWriter<Holder>::Write(const std::string &key,
   // been printed in the Write function.
 }
 
+template<class Holder>
+void TableWriter<Holder>::Write(const std::string &key,
+                                T &&value) const {
+  CheckImpl();
+  if (!impl_->WriteMove(key, &value))
+    KALDI_ERR << "Error in TableWriter::Write";
+}
+
 template<class Holder>
 void TableWriter<Holder>::Flush() {
   CheckImpl();
@@ -1576,6 +2221,11 @@ template<class Holder> class RandomAccessTableReaderImplBase {
 
   virtual const T &Value(const std::string &key) = 0;
 
+  // Returns the object for "key" if the caller may move from it, because the
+  // table will not be asked for it again (the once (o) option); else NULL.
+  // Dies if there is no such key, like Value().  Used by TakeValue().
+  virtual T *ValueToTake(const std::string &key) { return NULL; }
+
   virtual bool Close() = 0;
 
   virtual ~RandomAccessTableReaderImplBase() {}
@@ -1770,7 +2420,7 @@ class RandomAccessTableReaderScriptImpl:
                        << PrintableRxfilename(data_rxfilename);
             return false;
           } else {
-            if (holder_.Read(input_.Stream())) {
+            if (ReadTableObject(input_.Stream(), &holder_)) {
               state_ = kHaveObject;
             } else {
               KALDI_WARN << "Error reading object from "
@@ -1944,6 +2594,21 @@ class RandomAccessTableReaderArchiveImplBase:
       state_ = kEof;
       return;
     }
+    while (IsArchiveIndexKey(cur_key_)) {  // the "idx" index at the end of the
+      // archive: skip it.  Other archives may follow it, if archives were
+      // concatenated.
+      if (!SkipArchiveIndex(is)) {
+        KALDI_WARN << "Invalid archive index, reading archive "
+                   << PrintableRxfilename(archive_rxfilename_);
+        state_ = kError;
+        return;
+      }
+      is >> cur_key_;
+      if (is.eof()) {
+        state_ = kEof;
+        return;
+      }
+    }
     if (is.fail()) {  // This shouldn't really happen, barring file-system
                       // errors.
       KALDI_WARN << "Error reading archive: rspecifier is " << rspecifier_;
@@ -1966,7 +2631,7 @@ class RandomAccessTableReaderArchiveImplBase:
     }
     if (c != '\n') is.get();  // Consume the space or tab.
     holder_ = new Holder;
-    if (holder_->Read(is)) {
+    if (ReadTableObject(is, holder_)) {
       state_ = kHaveObject;
       return;
     } else {
@@ -2225,6 +2890,12 @@ class RandomAccessTableReaderSortedArchiveImpl:
       pending_delete_ = index;  // mark this index to be deleted on next call.
     return seen_pairs_[index].second->Value();
   }
+  virtual T *ValueToTake(const std::string &key) {
+    if (!opts_.once) return NULL;
+    // The holder is deleted on the next call, so nothing sees the object after
+    // the caller has moved from it.
+    return const_cast<T*>(&(Value(key)));
+  }
   virtual ~RandomAccessTableReaderSortedArchiveImpl() {
     if (this->IsOpen())
       if (!Close())  // more specific warning will already have been printed.
@@ -2403,6 +3074,11 @@ class RandomAccessTableReaderUnsortedArchiveImpl:
                 << " in archive " << PrintableRxfilename(archive_rxfilename_);
     return *ans_ptr;
   }
+  virtual T *ValueToTake(const std::string &key) {
+    if (!opts_.once) return NULL;
+    // As for the sorted archive, the holder is deleted on the next call.
+    return const_cast<T*>(&(Value(key)));
+  }
   virtual ~RandomAccessTableReaderUnsortedArchiveImpl() {
     if (this->IsOpen())
       if (!Close())  // more specific warning will already have been printed.
@@ -2513,6 +3189,85 @@ RandomAccessTableReader<Holder>::RandomAccessTableReader(const
         " (rspecifier is: " << rspecifier << ")";
 }
 
+// RandomAccessTableReaderIndexedArchiveImpl is used for archives that are
+// files written with the "idx" wspecifier option, whatever the options of the
+// rspecifier.  It maps the archive into memory, and reads the objects asked
+// for from where the index says they are; only the last one is kept.
+template<class Holder>
+class RandomAccessTableReaderIndexedArchiveImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  RandomAccessTableReaderIndexedArchiveImpl(): holder_(NULL) { }
+
+  // Returns false if the archive is not a file with an index, in which case
+  // another implementation should be used.
+  virtual bool Open(const std::string &rspecifier) {
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kArchiveRspecifier);
+    return archive_.Open(archive_rxfilename_);
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    if (!opts_.permissive)
+      return archive_.HasKey(key);
+    // In permissive mode, objects that cannot be read do not count.
+    return LoadObject(key);
+  }
+
+  virtual const T &Value(const std::string &key) {
+    if (!LoadObject(key))
+      KALDI_ERR << "Value() called on non-existent key or unreadable object "
+                << key << " in archive "
+                << PrintableRxfilename(archive_rxfilename_);
+    return holder_->Value();
+  }
+
+  virtual bool Close() {
+    if (!archive_.IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    archive_.Close();
+    delete holder_;
+    holder_ = NULL;
+    return true;
+  }
+
+  virtual ~RandomAccessTableReaderIndexedArchiveImpl() {
+    delete holder_;
+  }
+
+ private:
+  // Makes holder_ hold the object of "key", and returns false if it cannot.
+  bool LoadObject(const std::string &key) {
+    if (holder_ != NULL && key == cur_key_)
+      return true;
+    const char *begin, *end;
+    if (!archive_.Find(key, &begin, &end))
+      return false;
+    delete holder_;
+    holder_ = new Holder;
+    MemoryInputBuffer buffer(begin, end);
+    std::istream is(&buffer);
+    if (!ReadTableObject(is, holder_)) {
+      KALDI_WARN << "Object read failed for key " << key << ", reading archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      delete holder_;
+      holder_ = NULL;
+      return false;
+    }
+    cur_key_ = key;
+    return true;
+  }
+
+  MappedArchive archive_;
+  std::string archive_rxfilename_;
+  RspecifierOptions opts_;
+  std::string cur_key_;  // the key of the object in holder_.
+  Holder *holder_;
+};
+
 template<class Holder>
 bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
   if (IsOpen())
@@ -2523,7 +3278,14 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
     case kScriptRspecifier:
       impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
       break;
-    case kArchiveRspecifier:
+    case kArchiveRspecifier: {
+      RandomAccessTableReaderIndexedArchiveImpl<Holder> *indexed_impl =
+          new RandomAccessTableReaderIndexedArchiveImpl<Holder>();
+      if (indexed_impl->Open(rspecifier)) {
+        impl_ = indexed_impl;
+        return true;
+      }
+      delete indexed_impl;  // The archive has no index.
       if (opts.sorted) {
         if (opts.called_sorted)  // "doubly" sorted case.
           impl_ = new RandomAccessTableReaderDSortedArchiveImpl<Holder>();
@@ -2533,6 +3295,7 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
         impl_ = new RandomAccessTableReaderUnsortedArchiveImpl<Holder>();
       }
       break;
+    }
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier: "
                  << rspecifier;
@@ -2563,6 +3326,17 @@ RandomAccessTableReader<Holder>::Value(const std::string &key) {
   return impl_->Value(key);
 }
 
+template<class Holder>
+void RandomAccessTableReader<Holder>::TakeValue(const std::string &key,
+                                                T *value) {
+  CheckImpl();
+  T *to_take = impl_->ValueToTake(key);
+  if (to_take != NULL)
+    *value = std::move(*to_take);
+  else
+    *value = impl_->Value(key);
+}
+
 template<class Holder>
 bool RandomAccessTableReader<Holder>::Close() {
   CheckImpl();
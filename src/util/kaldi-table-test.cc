@@ -16,6 +16,7 @@
 // MERCHANTABLITY OR NON-INFRINGEMENT.
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
+#include <fstream>
 #include "base/io-funcs.h"
 #include "util/kaldi-io.h"
 #include "base/kaldi-math.h"
@@ -177,6 +178,53 @@ void UnitTestClassifyWspecifier() {
     KALDI_ASSERT(ans == kBothWspecifier && ark == "" && scp == "" &&
                  opts.binary == true && opts.flush == false);
   }
+
+  {
+    std::string a = "ark,bg:foo";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kArchiveWspecifier && ark == "foo" &&
+                 opts.background && opts.background_depth == 1);
+  }
+
+  {
+    std::string a = "ark,scp,bg8:foo,bar";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && ark == "foo" && scp == "bar" &&
+                 opts.background && opts.background_depth == 8);
+  }
+
+  {
+    std::string a = "ark,bg0:foo";  // the depth must be positive.
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, NULL);
+    KALDI_ASSERT(ans == kNoWspecifier);
+  }
+
+  {
+    std::string a = "ark,zstd:foo";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kArchiveWspecifier && ark == "foo" &&
+                 opts.compress && opts.compression_level == 3);
+  }
+
+  {
+    std::string a = "ark,scp,zstd19:foo,bar";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && opts.compress &&
+                 opts.compression_level == 19);
+  }
+
+  {
+    std::string a = "ark,zstdx:foo";
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, NULL);
+    KALDI_ASSERT(ans == kNoWspecifier);
+  }
 }
 
 
@@ -324,6 +372,31 @@ void UnitTestClassifyRspecifier() {
     RspecifierType ans = ClassifyRspecifier(a, &b, NULL);
     KALDI_ASSERT(ans == kArchiveRspecifier && b == "a");
   }
+
+  {
+    std::string a = "scp,bg:a", b;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &b, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && b == "a" && opts.background &&
+                 opts.background_depth == 1);
+  }
+  {
+    std::string a = "scp,p,bg16:a", b;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &b, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && b == "a" && opts.background &&
+                 opts.permissive && opts.background_depth == 16);
+  }
+  {
+    std::string a = "ark,bgx:a";
+    RspecifierType ans = ClassifyRspecifier(a, NULL, NULL);
+    KALDI_ASSERT(ans == kNoRspecifier);
+  }
+  {
+    std::string a = "ark,zstd:a", b;
+    RspecifierType ans = ClassifyRspecifier(a, &b, NULL);
+    KALDI_ASSERT(ans == kArchiveRspecifier && b == "a");
+  }
 }
 
 void UnitTestTableSequentialInt32(bool binary) {
@@ -629,15 +702,17 @@ void UnitTestTableSequentialInt32Script(bool binary) {
   }
 
   bool ans;
-  Int32Writer bw(binary ? "b,scp:tmp.scp" : "t,scp:tmp.scp");
+  Int32Writer bw(std::string(binary ? "b,scp" : "t,scp") +
+                 (RandInt(0, 1) == 0 ? "" : ",bg") + ":tmp.scp");
   for (int32 i = 0; i < sz; i++)  {
     bw.Write(k[i], v[i]);
   }
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialInt32Reader sbr(RandInt(0, 1) == 0 ?
-                            "scp:tmp.scp" : "scp,bg:tmp.scp");
+  const char *rspecifiers[] = { "scp:tmp.scp", "scp,bg:tmp.scp",
+                                "scp,bg3:tmp.scp" };
+  SequentialInt32Reader sbr(rspecifiers[RandInt(0, 2)]);
   std::vector<std::string> k2;
   std::vector<int32> v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -672,15 +747,18 @@ void UnitTestTableSequentialDoubleMatrixBoth(bool binary, bool read_scp) {
   }
 
   bool ans;
-  DoubleMatrixWriter bw(binary ? "b,ark,scp:tmpf,tmpf.scp" :
-                        "t,ark,scp:tmpf,tmpf.scp");
+  DoubleMatrixWriter bw(std::string(binary ? "b,ark,scp" : "t,ark,scp") +
+                        (RandInt(0, 1) == 0 ? "" : ",bg2") +
+                        ":tmpf,tmpf.scp");
   for (int32 i = 0; i < sz; i++)  {
     bw.Write(k[i], *(v[i]));
   }
   ans = bw.Close();
   KALDI_ASSERT(ans);
 
-  SequentialDoubleMatrixReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  SequentialDoubleMatrixReader sbr(
+      std::string(read_scp ? "scp" : "ark") +
+      (RandInt(0, 1) == 0 ? "" : ",bg4") + (read_scp ? ":tmpf.scp" : ":tmpf"));
   std::vector<std::string> k2;
   std::vector<Matrix<double>* > v2;
   for (; !sbr.Done(); sbr.Next()) {
@@ -957,9 +1035,10 @@ void UnitTestRangesMatrix(bool binary) {
 
   {  // test sequential reading.
     bool permissive = (RandInt(0, 1) == 0);
-    SequentialBaseFloatMatrixReader reader(permissive ?
-                                           "scp,p:tmpf_ranges.scp" :
-                                           "scp:tmpf_ranges.scp");
+    std::string opts = (permissive ? "scp,p" : "scp");
+    if (RandInt(0, 1) == 0)  // also read several at once.
+      opts += ",bg4";
+    SequentialBaseFloatMatrixReader reader(opts + ":tmpf_ranges.scp");
 
     int32 i = 0;
     for (; !reader.Done(); reader.Next(), i++) {
@@ -975,6 +1054,48 @@ void UnitTestRangesMatrix(bool binary) {
   unlink("tmpf_ranges.scp");
 }
 
+// A segmented scp, i.e. many ranges of the same objects, read in the
+// background by several threads.
+void UnitTestRangesSegmentedBackground(bool binary) {
+  std::vector<Matrix<BaseFloat> > mats(2);
+  std::vector<std::string> lines;
+  {
+    BaseFloatMatrixWriter writer(std::string(binary ? "b" : "t") +
+                                 ",ark,scp:tmpf,tmpf.scp");
+    for (int32 n = 0; n < 2; n++) {
+      mats[n].Resize(RandInt(20, 30), RandInt(1, 5));
+      mats[n].SetRandn();
+      writer.Write(n == 0 ? "a" : "b", mats[n]);
+    }
+    KALDI_ASSERT(writer.Close());
+    bool binary_in;
+    Input scp_input("tmpf.scp", &binary_in);
+    std::string line;
+    while (getline(scp_input.Stream(), line))
+      lines.push_back(line.substr(2));  // the rxfilename, after "a ".
+    KALDI_ASSERT(lines.size() == 2);
+  }
+  std::vector<Matrix<BaseFloat> > segments;
+  {
+    Output output("tmpf_ranges.scp", false);
+    for (int32 n = 0; n < 2; n++) {
+      for (int32 row = 0; row + 5 <= mats[n].NumRows(); row += 5) {
+        output.Stream() << "seg" << segments.size() << ' ' << lines[n] << '['
+                        << row << ':' << (row + 4) << "]\n";
+        segments.push_back(Matrix<BaseFloat>(mats[n].RowRange(row, 5)));
+      }
+    }
+  }
+  SequentialBaseFloatMatrixReader reader("scp,bg4:tmpf_ranges.scp");
+  size_t i = 0;
+  for (; !reader.Done(); reader.Next(), i++)
+    KALDI_ASSERT(reader.Value().ApproxEqual(segments[i]));
+  KALDI_ASSERT(reader.Close() && i == segments.size());
+  unlink("tmpf");
+  unlink("tmpf.scp");
+  unlink("tmpf_ranges.scp");
+}
+
 void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
                                          bool sorted, bool called_sorted,
                                          bool once) {
@@ -1052,6 +1173,242 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
 
 
 
+// Writing an indexed archive, and reading it in random order.
+void UnitTestTableIndexedArchive(bool binary) {
+  int32 sz = RandInt(0, 20);
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "key" << RandInt(0, 1000) << '_' << i;
+    k.push_back(key.str());
+    v[i].Resize(RandInt(1, 10), RandInt(1, 10));
+    v[i].SetRandn();
+  }
+  {
+    std::string wspecifier = std::string(binary ? "b" : "t") +
+        (RandInt(0, 1) == 0 ? ",ark,idx:tmpf" : ",ark,scp,idx:tmpf,tmpf.scp");
+    BaseFloatMatrixWriter writer(wspecifier);
+    for (int32 i = 0; i < sz; i++)
+      writer.Write(k[i], v[i]);
+    KALDI_ASSERT(writer.Close());
+  }
+  {  // it can still be read as an ordinary archive.
+    SequentialBaseFloatMatrixReader reader(RandInt(0, 1) == 0 ? "ark:tmpf" :
+                                           "ark:cat tmpf|");
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(reader.Key() == k[i]);
+      KALDI_ASSERT(reader.Value().ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(reader.Close() && i == sz);
+  }
+  {
+    MappedArchive archive;
+    KALDI_ASSERT(archive.Open("tmpf"));
+    for (int32 i = 0; i < sz; i++)
+      KALDI_ASSERT(archive.HasKey(k[i]));
+    KALDI_ASSERT(!archive.HasKey("foo"));
+  }
+  {
+    RandomAccessBaseFloatMatrixReader reader(RandInt(0, 1) == 0 ? "ark:tmpf" :
+                                             "ark,s,cs:tmpf");
+    for (int32 n = 0; n < 2 * sz; n++) {
+      int32 i = RandInt(0, sz - 1);
+      KALDI_ASSERT(reader.HasKey(k[i]));
+      KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
+// Two indexed archives concatenated: the index of the first one must not stop
+// the readers, and the index at the end (of the second one) must not be used.
+void UnitTestTableConcatenatedIndexedArchives(bool binary) {
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v;
+  const char *filenames[] = { "tmpf.1", "tmpf.2" };
+  for (int32 n = 0; n < 2; n++) {
+    std::string wspecifier = std::string(binary ? "b" : "t") + ",ark,idx:" +
+        filenames[n];
+    BaseFloatMatrixWriter writer(wspecifier);
+    int32 sz = RandInt(1, 10);
+    for (int32 i = 0; i < sz; i++) {
+      std::ostringstream key;
+      key << "key" << n << '_' << i;
+      k.push_back(key.str());
+      v.push_back(Matrix<BaseFloat>(RandInt(1, 10), RandInt(1, 10)));
+      v.back().SetRandn();
+      writer.Write(k.back(), v.back());
+    }
+    KALDI_ASSERT(writer.Close());
+  }
+  {
+    std::ofstream os("tmpf", std::ios::binary);
+    for (int32 n = 0; n < 2; n++) {
+      std::ifstream is(filenames[n], std::ios::binary);
+      os << is.rdbuf();
+    }
+    KALDI_ASSERT(os.good());
+  }
+  int32 sz = k.size();
+  {
+    SequentialBaseFloatMatrixReader reader(RandInt(0, 1) == 0 ? "ark:tmpf" :
+                                           "ark:cat tmpf.1 tmpf.2|");
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(reader.Key() == k[i]);
+      KALDI_ASSERT(reader.Value().ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(reader.Close() && i == sz);
+  }
+  {
+    MappedArchive archive;
+    KALDI_ASSERT(!archive.Open("tmpf"));
+  }
+  {
+    RandomAccessBaseFloatMatrixReader reader(RandInt(0, 1) == 0 ? "ark:tmpf" :
+                                             "ark:cat tmpf.1 tmpf.2|");
+    for (int32 n = 0; n < 2 * sz; n++) {
+      int32 i = RandInt(0, sz - 1);
+      KALDI_ASSERT(reader.HasKey(k[i]));
+      KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  unlink("tmpf");
+  unlink("tmpf.1");
+  unlink("tmpf.2");
+}
+
+// Writing an archive with the "zstd" option, and reading it in the different
+// ways.
+void UnitTestTableCompressedArchive(bool binary) {
+  if (!ArchiveCompressionSupported()) {
+    KALDI_ASSERT(!BaseFloatMatrixWriter().Open("ark,zstd:tmpf"));
+    return;
+  }
+  int32 sz = RandInt(0, 20);
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "key" << RandInt(0, 1000) << '_' << i;
+    k.push_back(key.str());
+    v[i].Resize(RandInt(5, 10), RandInt(5, 10));
+    v[i].SetRandn();
+  }
+  bool write_scp = (RandInt(0, 1) == 0);
+  {
+    std::string wspecifier = std::string(binary ? "b" : "t") +
+        (RandInt(0, 1) == 0 ? ",zstd" : ",zstd9") +
+        (RandInt(0, 1) == 0 ? ",bg" : "") +
+        (write_scp ? ",ark,scp:tmpf,tmpf.scp" : ",ark:tmpf");
+    BaseFloatMatrixWriter writer(wspecifier);
+    for (int32 i = 0; i < sz; i++)
+      writer.Write(k[i], v[i]);
+    KALDI_ASSERT(writer.Close());
+  }
+  const char *sequential_rspecifiers[] = {
+    "ark:tmpf", "ark,bg:tmpf", "ark,bg4:cat tmpf|", "ark,p,bg4:tmpf",
+    "scp:tmpf.scp", "scp,bg4:tmpf.scp" };
+  for (int32 n = 0; n < (write_scp ? 6 : 4); n++) {
+    SequentialBaseFloatMatrixReader reader(sequential_rspecifiers[n]);
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(reader.Key() == k[i]);
+      KALDI_ASSERT(reader.Value().ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(reader.Close() && i == sz);
+  }
+  const char *random_rspecifiers[] = { "ark:tmpf", "ark:cat tmpf|",
+                                       "scp:tmpf.scp" };
+  for (int32 n = 0; n < (write_scp ? 3 : 2); n++) {
+    RandomAccessBaseFloatMatrixReader reader(random_rspecifiers[n]);
+    for (int32 j = 0; j < 2 * sz; j++) {
+      int32 i = RandInt(0, sz - 1);
+      KALDI_ASSERT(reader.HasKey(k[i]));
+      KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  {  // a corrupted object is an error, also when it is decompressed by the
+     // bgN threads.
+    std::fstream f("tmpf", std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(0, std::ios::end);
+    int64 size = f.tellp();
+    if (sz > 0) {  // the end of the last object is corrupted.
+      f.seekp(size - 20);
+      f.write("corrupted data", 14);
+      f.close();
+      bool threw = false;
+      try {
+        SequentialBaseFloatMatrixReader reader("ark,bg4:tmpf");
+        for (; !reader.Done(); reader.Next())
+          reader.Value();
+        threw = !reader.Close();
+      } catch (const std::exception &e) {
+        threw = true;
+      }
+      KALDI_ASSERT(threw);
+    }
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
+// Writing with Write(key, T&&), also in the background, and reading with
+// TakeValue().
+void UnitTestTableMove(bool binary) {
+  int32 sz = RandInt(0, 20);
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "key" << (100 + i);  // sorted order.
+    k.push_back(key.str());
+    v[i].Resize(RandInt(1, 10), RandInt(1, 10));
+    v[i].SetRandn();
+  }
+  {
+    std::string wspecifier = std::string(binary ? "b" : "t") +
+        (RandInt(0, 1) == 0 ? ",bg" : "") + ",ark:tmpf";
+    BaseFloatMatrixWriter writer(wspecifier);
+    for (int32 i = 0; i < sz; i++) {
+      Matrix<BaseFloat> copy(v[i]);
+      writer.Write(k[i], std::move(copy));
+    }
+    KALDI_ASSERT(writer.Close());
+  }
+  const char *rspecifiers[] = { "ark:tmpf", "ark,o:tmpf", "ark,s,o:tmpf",
+                                "ark,s,cs:tmpf" };
+  for (int32 n = 0; n < 4; n++) {
+    bool once = (n == 1 || n == 2);
+    RandomAccessBaseFloatMatrixReader reader(rspecifiers[n]);
+    for (int32 i = 0; i < sz; i++) {
+      if (RandInt(0, 1) == 0 && !once) continue;
+      KALDI_ASSERT(reader.HasKey(k[i]));
+      Matrix<BaseFloat> value;
+      reader.TakeValue(k[i], &value);
+      KALDI_ASSERT(value.ApproxEqual(v[i], 1.0e-04));
+      if (!once)  // the table still has it.
+        KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i], 1.0e-04));
+    }
+  }
+  {
+    SequentialBaseFloatMatrixReader reader("ark:tmpf");
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      Matrix<BaseFloat> value(std::move(reader.Value()));
+      KALDI_ASSERT(value.ApproxEqual(v[i], 1.0e-04));
+    }
+    KALDI_ASSERT(reader.Close() && i == sz);
+  }
+  unlink("tmpf");
+}
+
 }  // end namespace kaldi.
 
 int main() {
@@ -1066,6 +1423,11 @@ int main() {
     UnitTestTableSequentialInt32Script(b);
     UnitTestTableSequentialDouble(b);
     UnitTestRangesMatrix(b);
+    UnitTestRangesSegmentedBackground(b);
+    UnitTestTableIndexedArchive(b);
+    UnitTestTableConcatenatedIndexedArchives(b);
+    UnitTestTableCompressedArchive(b);
+    UnitTestTableMove(b);
     for (int j = 0; j < 2; j++) {
       bool c = (j == 0);
       UnitTestTableSequentialDoubleBoth(b, c);
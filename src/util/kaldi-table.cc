@@ -17,11 +17,50 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "util/kaldi-table.h"
+#include "util/kaldi-io.h"
 #include "util/text-utils.h"
 
 namespace kaldi {
 
+// Parses the "bg" option of rspecifiers and wspecifiers, which may be followed
+// by the number of objects to read or write ahead, e.g. "bg8".
+static bool ParseBackgroundOption(const std::string &str, int32 *depth) {
+  if (str.compare(0, 2, "bg") != 0)
+    return false;
+  if (str.size() == 2) {
+    *depth = 1;
+    return true;
+  }
+  return ConvertStringToInteger(str.substr(2), depth) && *depth > 0;
+}
+
+// Parses the "zstd" option of wspecifiers (also accepted, and ignored, in
+// rspecifiers), which may be followed by the compression level, e.g.
+// "zstd19".
+static bool ParseCompressionOption(const std::string &str, int32 *level) {
+  if (str.compare(0, 4, "zstd") != 0)
+    return false;
+  if (str.size() == 4) {
+    *level = 3;
+    return true;
+  }
+  return ConvertStringToInteger(str.substr(4), level) && *level > 0;
+}
+
 
 bool ReadScriptFile(const std::string &rxfilename,
                     bool warn,
@@ -159,6 +198,7 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
 
   std::string before_colon(wspecifier, 0, pos), after_colon(wspecifier, pos+1);
 
+  int32 background_depth, compression_level;
   std::vector<std::string> split_first_part;  // Split part before ':' on ', '.
   SplitStringToVector(before_colon, ", ", false, &split_first_part);  // false==
   // don't omit empty strings between commas.
@@ -179,6 +219,18 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       if (opts) opts->flush = true;
     } else if (!strcmp(c, "nf")) {
       if (opts) opts->flush = false;
+    } else if (!strcmp(c, "idx")) {
+      if (opts) opts->index = true;
+    } else if (ParseBackgroundOption(str, &background_depth)) {
+      if (opts) {
+        opts->background = true;
+        opts->background_depth = background_depth;
+      }
+    } else if (ParseCompressionOption(str, &compression_level)) {
+      if (opts) {
+        opts->compress = true;
+        opts->compression_level = compression_level;
+      }
     } else if (!strcmp(c, "t")) {
       if (opts) opts->binary = false;
     } else if (!strcmp(c, "p")) {
@@ -262,6 +314,7 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   std::string before_colon(rspecifier, 0, pos),
       after_colon(rspecifier, pos+1);
 
+  int32 background_depth, compression_level;
   std::vector<std::string> split_first_part;  // Split part before ':' on ', '.
   SplitStringToVector(before_colon, ", ", false, &split_first_part);  // false==
   // don't omit empty strings between commas.
@@ -275,6 +328,8 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
     if (!strcmp(c, "b"));  // Ignore this option.  It's so we can use the same
     // specifiers for rspecifiers and wspecifiers.
     else if (!strcmp(c, "t"));  // Ignore this option too.
+    else if (ParseCompressionOption(str, &compression_level));  // and this
+    // one: compressed objects are recognised anyway.
     else if (!strcmp(c, "o")) {
       if (opts) opts->once = true;
     } else if (!strcmp(c, "no")) {
@@ -291,8 +346,11 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = true;
     } else if (!strcmp(c, "ncs")) {
       if (opts) opts->called_sorted = false;
-    } else if (!strcmp(c, "bg")) {
-      if (opts) opts->background = true;
+    } else if (ParseBackgroundOption(str, &background_depth)) {
+      if (opts) {
+        opts->background = true;
+        opts->background_depth = background_depth;
+      }
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else
@@ -318,4 +376,262 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
 
 
 
+// The index of an archive is this key followed by a space, then (in binary
+// mode) the number of entries and, for each, its key and the offset of its
+// object; then, at the very end of the file, the offset of the index key and
+// kArchiveIndexMagic.  The leading \001 is what makes the key an invalid
+// token.
+static const char *kArchiveIndexKey = "\001KALDI_ARCHIVE_INDEX";
+static const char kArchiveIndexMagic[] = "KALDIIDX";
+static const size_t kArchiveIndexMagicSize = 8;
+// the size of the offset of the index key, as written by WriteBasicType().
+static const size_t kArchiveIndexOffsetSize = 1 + sizeof(int64);
+
+bool IsArchiveIndexKey(const std::string &key) {
+  return key == kArchiveIndexKey;
+}
+
+bool WriteArchiveIndex(const std::vector<std::pair<std::string, int64> > &index,
+                       std::ostream &os) {
+  int64 index_begin = os.tellp();
+  if (index_begin < 0)
+    return false;
+  os << kArchiveIndexKey << ' ';
+  WriteBasicType(os, true, static_cast<int32>(index.size()));
+  for (size_t i = 0; i < index.size(); i++) {
+    WriteToken(os, true, index[i].first);
+    WriteBasicType(os, true, index[i].second);
+  }
+  WriteBasicType(os, true, index_begin);
+  os.write(kArchiveIndexMagic, kArchiveIndexMagicSize);
+  return !os.fail();
+}
+
+bool SkipArchiveIndex(std::istream &is) {
+  if (is.get() != ' ')
+    return false;
+  try {
+    int32 num_entries;
+    ReadBasicType(is, true, &num_entries);
+    if (num_entries < 0)
+      return false;
+    std::string key;
+    int64 offset;
+    for (int32 i = 0; i < num_entries; i++) {
+      ReadToken(is, true, &key);
+      ReadBasicType(is, true, &offset);
+    }
+    ReadBasicType(is, true, &offset);  // the offset of the index key.
+    char magic[kArchiveIndexMagicSize];
+    is.read(magic, kArchiveIndexMagicSize);
+    return !is.fail() &&
+        memcmp(magic, kArchiveIndexMagic, kArchiveIndexMagicSize) == 0;
+  } catch (const std::exception &e) {
+    return false;
+  }
+}
+
+
+bool ArchiveCompressionSupported() {
+#ifdef HAVE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool WriteCompressedObject(const std::string &data, int32 level,
+                           std::ostream &os) {
+#ifdef HAVE_ZSTD
+  std::string compressed(ZSTD_compressBound(data.size()), '\0');
+  // with a checksum, so that corrupted data is detected when it is read.
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+  size_t size = ZSTD_compress2(cctx, &(compressed[0]), compressed.size(),
+                               data.data(), data.size());
+  ZSTD_freeCCtx(cctx);
+  if (ZSTD_isError(size)) {
+    KALDI_WARN << "zstd compression failed: " << ZSTD_getErrorName(size);
+    return false;
+  }
+  os.put('\1');
+  os.put('Z');
+  WriteBasicType(os, true, static_cast<int64>(size));
+  os.write(compressed.data(), size);
+  return os.good();
+#else
+  KALDI_WARN << "Kaldi was compiled without zstd, cannot compress objects.";
+  return false;
+#endif
+}
+
+bool ReadCompressedObject(std::istream &is, std::string *compressed) {
+  if (is.get() != '\1' || is.get() != 'Z') {
+    KALDI_WARN << "Expected a compressed object.";
+    return false;
+  }
+  int64 size;
+  try {
+    ReadBasicType(is, true, &size);
+  } catch (const std::exception &e) {
+    return false;
+  }
+  if (size <= 0) {
+    KALDI_WARN << "Invalid size " << size << " of compressed object.";
+    return false;
+  }
+  compressed->resize(size);
+  is.read(&((*compressed)[0]), size);
+  return !is.fail();
+}
+
+bool DecompressObject(const std::string &compressed, std::string *data) {
+#ifdef HAVE_ZSTD
+  unsigned long long size = ZSTD_getFrameContentSize(compressed.data(),
+                                                     compressed.size());
+  if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    KALDI_WARN << "Invalid compressed object.";
+    return false;
+  }
+  data->resize(size);
+  size_t ans = ZSTD_decompress(&((*data)[0]), size, compressed.data(),
+                               compressed.size());
+  if (ZSTD_isError(ans) || ans != size) {
+    KALDI_WARN << "zstd decompression failed: "
+               << (ZSTD_isError(ans) ? ZSTD_getErrorName(ans) : "short data");
+    return false;
+  }
+  return true;
+#else
+  KALDI_WARN << "Kaldi was compiled without zstd, cannot read compressed "
+             << "objects (written with the zstd wspecifier option).";
+  return false;
+#endif
+}
+
+MemoryInputBuffer::MemoryInputBuffer(const char *begin, const char *end) {
+  // The buffer is never written to, as we do not allow putting back
+  // characters other than those that were read.
+  char *b = const_cast<char*>(begin), *e = const_cast<char*>(end);
+  setg(b, b, e);
+}
+
+MemoryInputBuffer::pos_type MemoryInputBuffer::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  char *pos;
+  if (dir == std::ios_base::beg) pos = eback() + off;
+  else if (dir == std::ios_base::cur) pos = gptr() + off;
+  else pos = egptr() + off;
+  if (!(which & std::ios_base::in) || pos < eback() || pos > egptr())
+    return pos_type(off_type(-1));
+  setg(eback(), pos, egptr());
+  return pos_type(pos - eback());
+}
+
+MemoryInputBuffer::pos_type MemoryInputBuffer::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+bool MappedArchive::Open(const std::string &filename) {
+  Close();
+#ifdef _MSC_VER
+  return false;  // We do not memory-map files on Windows.
+#else
+  if (ClassifyRxfilename(filename) != kFileInput)
+    return false;
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      st.st_size < static_cast<off_t>(kArchiveIndexOffsetSize +
+                                      kArchiveIndexMagicSize)) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping stays valid.
+  if (data == MAP_FAILED)
+    return false;
+  data_ = static_cast<const char*>(data);
+  size_ = st.st_size;
+  if (memcmp(data_ + size_ - kArchiveIndexMagicSize, kArchiveIndexMagic,
+             kArchiveIndexMagicSize) != 0) {
+    Close();  // no index.
+    return false;
+  }
+  if (!ReadIndex()) {
+    KALDI_WARN << "The index of archive " << filename << " does not match "
+               << "it (corrupted, or concatenated archives?); reading it "
+               << "without the index.";
+    Close();
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool MappedArchive::ReadIndex() {
+  const char *trailer = data_ + size_ - kArchiveIndexMagicSize -
+      kArchiveIndexOffsetSize;
+  try {
+    MemoryInputBuffer trailer_buf(trailer, trailer + kArchiveIndexOffsetSize);
+    std::istream trailer_is(&trailer_buf);
+    ReadBasicType(trailer_is, true, &index_begin_);
+    if (index_begin_ < 0 || index_begin_ >= trailer - data_)
+      return false;
+    MemoryInputBuffer buf(data_ + index_begin_, trailer);
+    std::istream is(&buf);
+    std::string key;
+    is >> key;
+    if (!IsArchiveIndexKey(key) || is.get() != ' ')
+      return false;
+    int32 num_entries;
+    ReadBasicType(is, true, &num_entries);
+    if (num_entries < 0)
+      return false;
+    offsets_.reserve(num_entries);
+    for (int32 i = 0; i < num_entries; i++) {
+      int64 offset;
+      ReadToken(is, true, &key);
+      ReadBasicType(is, true, &offset);
+      if (offset < 0 || offset > index_begin_)
+        return false;
+      offsets_[key] = offset;
+    }
+    // The index must end at the trailer; if it doesn't, this is the index of
+    // another archive, e.g. if archives were concatenated, and index_begin_
+    // was relative to the start of the last one.
+    return is.peek() == std::istream::traits_type::eof();
+  } catch (const std::exception &e) {
+    return false;
+  }
+}
+
+void MappedArchive::Close() {
+#ifndef _MSC_VER
+  if (data_ != NULL)
+    munmap(const_cast<char*>(data_), size_);
+#endif
+  data_ = NULL;
+  size_ = 0;
+  index_begin_ = 0;
+  offsets_.clear();
+}
+
+bool MappedArchive::Find(const std::string &key, const char **begin,
+                         const char **end) const {
+  std::unordered_map<std::string, int64, StringHasher>::const_iterator iter =
+      offsets_.find(key);
+  if (iter == offsets_.end())
+    return false;
+  *begin = data_ + iter->second;
+  *end = data_ + index_begin_;
+  return true;
+}
+
+
 }  // end namespace kaldi
@@ -21,12 +21,15 @@
 #ifndef KALDI_UTIL_KALDI_TABLE_H_
 #define KALDI_UTIL_KALDI_TABLE_H_
 
+#include <streambuf>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
 #include "base/kaldi-common.h"
 #include "util/kaldi-holder.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 
@@ -71,12 +74,28 @@ typedef std::vector<std::string> KeyList;
 //  p means permissive mode, when writing to an "scp" file only: will ignore
 //     missing scp entries, i.e. won't write anything for those files but will
 //     return success status).
+//  bg means "background": the objects are written in a background thread
+//     (which gets a copy of each), one at a time; bgN, e.g. bg8, lets up to N
+//     objects wait to be written.  Write errors are then reported by a later
+//     Write() or by Close().
+//  idx means "indexed", for archives that are actual files: Close() appends
+//     to the archive an index of where each object is in it, which
+//     RandomAccessTableReader uses to read the objects directly from the
+//     (memory-mapped) file, in any order.  The archive can still be read as
+//     usual; readers stop at the index.
+//  zstd means each object is compressed with zstd (at level 3; zstdN, e.g.
+//     zstd19, sets the level) as it is written, so e.g. uncompressed
+//     features or examples take less disk and I/O.  Readers recognise the
+//     compressed objects whatever the rspecifier; it needs Kaldi to have been
+//     compiled with zstd (see ArchiveCompressionSupported()).
 //
 //  So the following are valid wspecifiers:
 //  ark,b,f:foo
 //  "ark,b,b:| gzip -c > foo"
 //  "ark,scp,t,nf:foo.ark,|gzip -c > foo.scp.gz"
 //  ark,b:-
+//  ark,idx:foo.ark
+//  ark,zstd,bg:foo.ark
 //
 //  The meanings of rxfilename and wxfilename are as described in
 //  kaldi-stream.h (they are filenames but include pipes, stdin/stdout
@@ -114,7 +133,14 @@ struct WspecifierOptions {
   bool binary;
   bool flush;
   bool permissive;  // will ignore absent scp entries.
-  WspecifierOptions(): binary(true), flush(false), permissive(false) { }
+  bool background;  // "bg" or "bgN": write in a background thread.
+  int32 background_depth;  // the N of "bgN" (1 for "bg").
+  bool index;  // "idx": write an index at the end of the archive.
+  bool compress;  // "zstd" or "zstdN": compress each object.
+  int32 compression_level;  // the N of "zstdN" (3 for "zstd").
+  WspecifierOptions(): binary(true), flush(false), permissive(false),
+                       background(false), background_depth(1),
+                       index(false), compress(false), compression_level(3) { }
 };
 
 // ClassifyWspecifier returns the type of the wspecifier string,
@@ -161,6 +187,103 @@ bool WriteScriptFile(std::ostream &os,
                      const std::vector<std::pair<std::string, std::string> >
                      &script);
 
+// Archives written with the "idx" wspecifier option end with an index of the
+// byte offsets of their objects.  The index begins with a key that is not a
+// valid token (see IsToken()), so it cannot be the key of an object; archive
+// readers skip it, and go on to the next key in case several archives were
+// concatenated.
+
+// Returns true if "key", read where the key of an archive entry was expected,
+// begins the index of the archive.
+bool IsArchiveIndexKey(const std::string &key);
+
+// Writes the index of an archive to the end of it, given the keys and the
+// offsets (from os.tellp()) of their objects.  Returns false on error.
+bool WriteArchiveIndex(const std::vector<std::pair<std::string, int64> > &index,
+                       std::ostream &os);
+
+// Reads the rest of an archive index, after its key (see IsArchiveIndexKey())
+// has been read from "is", up to and including its trailer.  Returns false if
+// it is not a well-formed index.
+bool SkipArchiveIndex(std::istream &is);
+
+// With the "zstd" wspecifier option each object is written compressed: after
+// the key come the bytes "\1Z", the size of the compressed data (an int64, as
+// WriteBasicType writes it in binary) and a zstd frame of what Holder::Write
+// would have written.  No Holder's output begins with '\1' (binary ones begin
+// with "\0B"), so readers tell the compressed objects apart by peeking at one
+// byte.
+
+/// Returns true if Kaldi was compiled with zstd (with HAVE_ZSTD defined),
+/// which compressed objects need both to be written and to be read.
+bool ArchiveCompressionSupported();
+
+/// Writes "data", the output of Holder::Write for an object, in the
+/// compressed format above.  Returns false on error.
+bool WriteCompressedObject(const std::string &data, int32 level,
+                           std::ostream &os);
+
+/// Returns true if the next object in the stream is compressed; it reads
+/// nothing.
+inline bool IsCompressedObjectNext(std::istream &is) {
+  return is.peek() == '\1';
+}
+
+/// Reads a compressed object, from its "\1Z" on, without decompressing it.
+/// Returns false on error.
+bool ReadCompressedObject(std::istream &is, std::string *compressed);
+
+/// Decompresses the output of ReadCompressedObject() to what Holder::Write
+/// wrote.  Returns false (with a warning) on error.
+bool DecompressObject(const std::string &compressed, std::string *data);
+
+/// MemoryInputBuffer is a read-only stream buffer over memory that is owned
+/// elsewhere, e.g. a memory-mapped file, so an std::istream can read from it
+/// with no copy to a buffer of its own.
+class MemoryInputBuffer: public std::streambuf {
+ public:
+  MemoryInputBuffer(const char *begin, const char *end);
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+};
+
+/// MappedArchive memory-maps an archive file written with the "idx" option and
+/// reads its index, to find each object in it in constant time.
+class MappedArchive {
+ public:
+  MappedArchive(): data_(NULL), size_(0), index_begin_(0) { }
+
+  /// Returns false if "filename" is not an actual file, or could not be
+  /// mapped, or has no index (it only warns if the index was corrupted).
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return data_ != NULL; }
+
+  void Close();
+
+  bool HasKey(const std::string &key) const {
+    return offsets_.count(key) != 0;
+  }
+
+  /// If the archive has the key, outputs the memory from its object up to the
+  /// index, and returns true; it is valid while the archive is open.
+  bool Find(const std::string &key, const char **begin,
+            const char **end) const;
+
+  ~MappedArchive() { Close(); }
+
+ private:
+  bool ReadIndex();
+
+  const char *data_;
+  size_t size_;
+  int64 index_begin_;
+  std::unordered_map<std::string, int64, StringHasher> offsets_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedArchive);
+};
+
 // Documentation for "rspecifier"
 // "rspecifier" describes how we read a set of objects indexed by keys.
 // The possibilities are:
@@ -189,10 +312,22 @@ bool WriteScriptFile(std::ostream &os,
 //       value, in a background thread.  Recommended when reading larger objects
 //       such as neural-net training examples, especially when you want to
 //       maximize GPU usage.
+//   bgN, e.g. bg8, is as bg but reads up to N values ahead.  For scp
+//       rspecifiers (unless permissive) the N values are read by N threads at
+//       once, so that e.g. compressed matrices are decompressed in parallel;
+//       archives are necessarily read in order, by one thread, but objects
+//       written with the "zstd" option are decompressed by the N threads.
 //
 //   b   is ignored [for scripting convenience]
 //   t   is ignored [for scripting convenience]
+//   zstd and zstdN are ignored too: archives written with them are read with
+//       the same rspecifiers as others.  Their objects are decompressed where
+//       they are read, so with bgN in the N threads, also for archives.
 //
+//  If an ark rspecifier is an actual file that was written with the "idx"
+//  wspecifier option, RandomAccessTableReader memory-maps it and reads each
+//  object directly from where its index says it is, whatever the order the
+//  keys are asked for in; the s, cs and o options then make no difference.
 //
 //  So for instance the following would be a valid rspecifier:
 //
@@ -211,9 +346,11 @@ struct  RspecifierOptions {
   bool background;  // For sequential readers, if the background option ("bg")
                     // is provided, it will read ahead to the next object in a
                     // background thread.
+  int32 background_depth;  // the N of "bgN": how many objects to read ahead
+                           // (1 for "bg").
   RspecifierOptions(): once(false), sorted(false),
                        called_sorted(false), permissive(false),
-                       background(false) { }
+                       background(false), background_depth(1) { }
 };
 
 enum RspecifierType  {
@@ -264,6 +401,12 @@ class RandomAccessTableReader {
   // want to catch this error.
   const T &Value(const std::string &key);
 
+  // Like Value(), but puts the object into *value.  When the table would
+  // only drop the object after this call anyway (archives read with the once
+  // (o) option), the object is moved into *value rather than copied, which
+  // saves a copy of large objects such as matrices and lattices.
+  void TakeValue(const std::string &key, T *value);
+
   ~RandomAccessTableReader();
 
   // Allow copy-constructor only for non-opened readers (needed for inclusion in
@@ -321,7 +464,9 @@ class SequentialTableReader {
   // corresponding file cannot be read.]  You probably wouldn't want to catch
   // this exception; the user can just specify the p option in the rspecifier.
   // We make this non-const to enable things like shallow swap on the held
-  // object in situations where this would avoid making a redundant copy.
+  // object in situations where this would avoid making a redundant copy; you
+  // may also move from it, e.g. Matrix<BaseFloat> m(std::move(reader.Value())),
+  // as long as you call Next() before calling Value() again.
   T &Value();
 
   // Next goes to the next key.  It will not throw; any error will
@@ -387,6 +532,11 @@ class TableWriter {
   // KALDI_ERR macro)
   inline void Write(const std::string &key, const T &value) const;
 
+  // As above, but the writer may move from "value" (leaving it in a valid but
+  // unspecified state) instead of copying it, which the background (bg)
+  // option would otherwise have to do.
+  inline void Write(const std::string &key, T &&value) const;
+
 
   // Flush will flush any archive; it does not return error status
   // or throw, any errors will be reported on the next Write or Close.
@@ -123,6 +123,85 @@ void TestTaskSequencer() {
 }
 
 
+// A task that itself runs a TaskSequencer and MultiThreader (as a program
+// that is run in parallel may), to check that nested use does not deadlock.
+class MyNestedTaskClass {
+ public:
+  MyNestedTaskClass(int32 i, std::vector<int32> *vec):
+      i_(i), sum_(0), vec_(vec) { }
+
+  void operator() () {
+    TaskSequencerConfig config;
+    config.num_threads = 1 + Rand() % 4;
+    std::vector<int32> inner_output;
+    {
+      TaskSequencer<MyTaskClass> sequencer(config);
+      for (int32 j = 0; j < 10; j++)
+        sequencer.Run(new MyTaskClass(j, &inner_output));
+    }
+    KALDI_ASSERT(inner_output.size() == 10);
+    for (int32 j = 0; j < 10; j++)
+      KALDI_ASSERT(inner_output[j] == j);
+    MyThreadClass c(1000, &sum_);
+    MultiThreader<MyThreadClass> m(1 + Rand() % 8, c);
+  }
+  ~MyNestedTaskClass() {
+    KALDI_ASSERT(sum_ == (1000 * (1000 - 1)) / 2);
+    vec_->push_back(i_);
+  }
+
+ private:
+  int32 i_;
+  int32 sum_;
+  std::vector<int32> *vec_;
+};
+
+void TestNestedParallelism() {
+  TaskSequencerConfig config;
+  config.num_threads = 1 + Rand() % 8;
+  int32 num_tasks = Rand() % 30;
+  std::vector<int32> task_output;
+  {
+    TaskSequencer<MyNestedTaskClass> sequencer(config);
+    for (int32 i = 0; i < num_tasks; i++)
+      sequencer.Run(new MyNestedTaskClass(i, &task_output));
+  }
+  KALDI_ASSERT(task_output.size() == static_cast<size_t>(num_tasks));
+  for (int32 i = 0; i < num_tasks; i++)
+    KALDI_ASSERT(task_output[i] == i);
+}
+
+void TestOrderedCompletion() {
+  // positions are completed in a random order from the threads of the pool,
+  // the functions must still be called in order.
+  ThreadPool &pool = ThreadPool::Global();
+  pool.EnsureThreads(4);
+  int32 num_positions = 200;
+  std::vector<int64> positions(num_positions);
+  std::vector<int32> output;
+  {
+    OrderedCompletion completion;
+    for (int32 i = 0; i < num_positions; i++)
+      positions[i] = completion.Reserve();
+    std::vector<int32> order(num_positions);
+    for (int32 i = 0; i < num_positions; i++)
+      order[i] = i;
+    std::random_shuffle(order.begin(), order.end());
+    for (int32 i = 0; i < num_positions; i++) {
+      int32 p = order[i];
+      pool.Submit([&completion, &positions, &output, p] () {
+          completion.Complete(positions[p], [&output, p] () {
+              output.push_back(p);
+            });
+        });
+    }
+    completion.Wait();
+  }
+  KALDI_ASSERT(output.size() == static_cast<size_t>(num_positions));
+  for (int32 i = 0; i < num_positions; i++)
+    KALDI_ASSERT(output[i] == i);
+}
+
 }  // end namespace kaldi.
 
 int main() {
@@ -130,4 +209,7 @@ int main() {
   TestThreads();
   for (int32 i = 0; i < 10; i++)
     TestTaskSequencer();
+  for (int32 i = 0; i < 5; i++)
+    TestNestedParallelism();
+  TestOrderedCompletion();
 }
@@ -18,6 +18,10 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
+#include <chrono>
 #include "base/kaldi-common.h"
 #include "util/kaldi-thread.h"
 
@@ -29,5 +33,191 @@ MultiThreadable::~MultiThreadable() {
 }
 
 
+// The pool of the process; see ThreadPool::Global().
+static std::atomic<ThreadPool*> g_thread_pool(NULL);
+
+// Which pool, and which of its queues, the thread is a worker of, if any.
+static thread_local ThreadPool *tls_pool = NULL;
+static thread_local int32 tls_queue_index = -1;
+
+#ifndef _MSC_VER
+// The threads of the pool are not copied into the child of a fork(), so the
+// child starts again with a new pool.  The old one is just forgotten: its
+// mutexes may have been locked by threads that no longer exist.
+static void ForgetThreadPoolAfterFork() {
+  g_thread_pool = NULL;
+}
+#endif
+
+ThreadPool &ThreadPool::Global() {
+  ThreadPool *pool = g_thread_pool;
+  if (pool != NULL)
+    return *pool;
+#ifndef _MSC_VER
+  static std::atomic<bool> registered(false);
+  if (!registered.exchange(true))
+    pthread_atfork(NULL, NULL, ForgetThreadPoolAfterFork);
+#endif
+  ThreadPool *new_pool = new ThreadPool();
+  if (g_thread_pool.compare_exchange_strong(pool, new_pool))
+    return *new_pool;
+  delete new_pool;  // another thread was first; it has no threads yet.
+  return *pool;
+}
+
+ThreadPool::ThreadPool(): num_threads_(0), base_seed_(0), num_queued_(0) { }
+
+void ThreadPool::EnsureThreads(int32 num_threads) {
+  if (num_threads <= num_threads_)
+    return;
+  std::lock_guard<std::mutex> lock(grow_mutex_);
+  if (num_threads > kMaxThreads) {
+    KALDI_WARN << "Limiting the thread pool to " << kMaxThreads
+               << " threads (" << num_threads << " requested)";
+    num_threads = kMaxThreads;
+  }
+  if (num_threads_ == 0)
+    base_seed_ = Rand();
+  while (num_threads_ < num_threads) {
+    int32 index = num_threads_;
+    queues_[index].reset(new JobQueue());
+    uint32 seed = base_seed_ + 0x9E3779B9u * static_cast<uint32>(index);
+    threads_.push_back(std::thread(&ThreadPool::WorkerLoop, this, index,
+                                   seed));
+    num_threads_ = index + 1;
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+  if (num_threads_ == 0)
+    EnsureThreads(1);
+  JobQueue *queue = (tls_pool == this ? queues_[tls_queue_index].get() :
+                     &injected_);
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->jobs.push_back(std::move(job));
+  }
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    num_queued_++;
+  }
+  idle_cond_.notify_one();
+}
+
+bool ThreadPool::PopJob(int32 queue_index, std::function<void()> *job) {
+  // A worker's own queue is used as a stack, so that nested jobs run in the
+  // thread that queued them while its cache is warm; the others are queues.
+  if (queue_index >= 0) {
+    JobQueue *own = queues_[queue_index].get();
+    std::lock_guard<std::mutex> lock(own->mutex);
+    if (!own->jobs.empty()) {
+      *job = std::move(own->jobs.back());
+      own->jobs.pop_back();
+      num_queued_--;
+      return true;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(injected_.mutex);
+    if (!injected_.jobs.empty()) {
+      *job = std::move(injected_.jobs.front());
+      injected_.jobs.pop_front();
+      num_queued_--;
+      return true;
+    }
+  }
+  // Steal the oldest job of another worker, starting with the next one so the
+  // thieves do not all go for the same queue.
+  int32 num_threads = num_threads_;
+  for (int32 i = 1; i <= num_threads; i++) {
+    int32 q = (queue_index + i + num_threads) % num_threads;
+    if (q == queue_index)
+      continue;
+    JobQueue *other = queues_[q].get();
+    std::lock_guard<std::mutex> lock(other->mutex);
+    if (!other->jobs.empty()) {
+      *job = std::move(other->jobs.front());
+      other->jobs.pop_front();
+      num_queued_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::RunPendingJob() {
+  std::function<void()> job;
+  if (!PopJob(tls_pool == this ? tls_queue_index : -1, &job))
+    return false;
+  job();
+  return true;
+}
+
+void ThreadPool::HelpUntil(std::unique_lock<std::mutex> *lock,
+                           std::condition_variable *cond,
+                           const std::function<bool()> &pred) {
+  while (!pred()) {
+    lock->unlock();
+    bool ran_job = RunPendingJob();
+    lock->lock();
+    // The timeout is in case jobs are queued while we wait that nobody else
+    // is free to run.
+    if (!ran_job && !pred())
+      cond->wait_for(*lock, std::chrono::milliseconds(10));
+  }
+}
+
+void ThreadPool::WorkerLoop(int32 index, uint32 seed) {
+  tls_pool = this;
+  tls_queue_index = index;
+  SetThreadRandSeed(seed);
+  while (true) {
+    std::function<void()> job;
+    if (PopJob(index, &job)) {
+      job();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cond_.wait(lock, [this] () { return num_queued_ > 0; });
+  }
+}
+
+
+int64 OrderedCompletion::Reserve() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_reserved_++;
+}
+
+void OrderedCompletion::Complete(int64 position,
+                                 std::function<void()> finish) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  KALDI_ASSERT(position >= num_completed_ && position < num_reserved_);
+  ready_[position] = std::move(finish);
+  if (completing_)
+    return;  // that thread will call 'finish' when it gets to it.
+  completing_ = true;
+  std::map<int64, std::function<void()> >::iterator iter;
+  while ((iter = ready_.begin()) != ready_.end() &&
+         iter->first == num_completed_) {
+    std::function<void()> f = std::move(iter->second);
+    ready_.erase(iter);
+    lock.unlock();
+    f();
+    lock.lock();
+    num_completed_++;
+  }
+  completing_ = false;
+  // with the lock held, as Wait() may return and the object be destroyed once
+  // it is released.
+  cond_.notify_all();
+}
+
+void OrderedCompletion::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  ThreadPool::Global().HelpUntil(&lock, &cond_, [this] () {
+      return num_completed_ == num_reserved_ && !completing_; });
+}
+
+
 
 }  // end namespace kaldi
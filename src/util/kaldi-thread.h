@@ -22,7 +22,15 @@
 #ifndef KALDI_THREAD_KALDI_THREAD_H_
 #define KALDI_THREAD_KALDI_THREAD_H_ 1
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include "itf/options-itf.h"
 #include "util/kaldi-semaphore.h"
 
@@ -44,7 +52,7 @@
 // a destructor with side effects (typically some kind of output).
 // TaskSequencer is responsible for running the jobs in parallel. It has a
 // function Run() that will accept a new object of class C; this will block
-// until a thread is free, at which time it will spawn a thread that starts
+// until a thread is free, at which time it will have a thread start
 // running the operator () of the object. When threads are finished running,
 // the objects will be deleted. TaskSequencer guarantees that the destructors
 // will be called sequentially (not in parallel) and in the same order the
@@ -52,6 +60,14 @@
 // destructor to have side effects such as outputting data.
 // Note: the destructor of TaskSequencer will wait for any remaining jobs that
 // are still running and will call the destructors.
+//
+// Both of them run the jobs in ThreadPool::Global(), a process-wide pool of
+// threads that are created once and then reused, so that small jobs (e.g. one
+// utterance each) do not pay for creating a thread.  Each thread of the pool
+// has its own queue of jobs and takes jobs from the others' queues when it
+// runs out ("work stealing").  Jobs may themselves use MultiThreader or
+// TaskSequencer: the threads that wait for jobs to finish run queued jobs in
+// the meantime.
 
 
 namespace kaldi {
@@ -63,6 +79,119 @@ extern int32 g_num_threads;  // Maximum number of threads (for programs that
 // should register it with their ParseOptions, as something like:
 // po.Register("num-threads", &g_num_threads, "Number of threads to use.");
 
+/// A process-wide pool of worker threads; see the comment at the top of this
+/// file.  The pool only grows: MultiThreader and TaskSequencer call
+/// EnsureThreads() with the number of threads they were asked for, so jobs
+/// that wait for each other (e.g. a producer and consumers) still all run.
+/// Each worker gets its own random number generator (SetThreadRandSeed() in
+/// base/kaldi-math.h), seeded from its index and from one Rand() of the thread
+/// that started the first workers, so Rand() needs no lock in jobs, srand()
+/// before the first threads are started still decides the numbers, and the
+/// number of threads does not change the random numbers that the starting
+/// thread gets afterwards.
+class ThreadPool {
+ public:
+  /// Returns the pool of the process.  (In the child of a fork() it is a new,
+  /// empty, pool, since the threads do not survive the fork.)
+  static ThreadPool &Global();
+
+  /// Makes sure there are at least 'num_threads' worker threads.
+  void EnsureThreads(int32 num_threads);
+
+  int32 NumThreads() const { return num_threads_; }
+
+  /// Queues a job.  If it is called from a worker thread of this pool, it is
+  /// queued for that thread (it will most likely run it next, unless another
+  /// thread steals it); otherwise it goes in a queue shared by all the
+  /// workers.
+  void Submit(std::function<void()> job);
+
+  /// Runs one of the queued jobs in the calling thread, if there is one, and
+  /// returns true if it did.  For threads that would otherwise be idle waiting
+  /// for other jobs.
+  bool RunPendingJob();
+
+  /// Waits until pred() is true, which the caller must make sure is signalled
+  /// on 'cond', while running queued jobs.  'lock' must be locked; it is
+  /// unlocked while jobs are run.
+  void HelpUntil(std::unique_lock<std::mutex> *lock,
+                 std::condition_variable *cond,
+                 const std::function<bool()> &pred);
+
+ private:
+  // There is no reason to have more threads than this; EnsureThreads() warns
+  // and stops here.
+  static const int32 kMaxThreads = 1024;
+
+  struct JobQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()> > jobs;
+  };
+
+  // Only Global() creates a pool.  It is never destroyed, its threads just
+  // exit with the process.
+  ThreadPool();
+
+  bool PopJob(int32 queue_index, std::function<void()> *job);
+  void WorkerLoop(int32 index, uint32 seed);
+
+  // the queues of the workers; the first num_threads_ are in use.  They are
+  // never deallocated, so that they can be accessed while the pool grows.
+  std::unique_ptr<JobQueue> queues_[kMaxThreads];
+  JobQueue injected_;  // jobs from threads outside the pool
+  std::atomic<int32> num_threads_;
+  std::mutex grow_mutex_;
+  std::vector<std::thread> threads_;
+  uint32 base_seed_;  // the seeds of the workers are derived from this.
+
+  // for idle workers to wait for new jobs.  num_queued_ is incremented with
+  // idle_mutex_ locked, after the job is queued.
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  std::atomic<int64> num_queued_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+
+/// Calls functions one at a time, in a given order, as they become ready in
+/// different threads; TaskSequencer uses it for the destructors of its jobs.
+/// Each job reserves a position with Reserve() (in the thread that decides the
+/// order) and later calls Complete() with the function to run; that runs the
+/// functions of all the positions that are ready, in order, in the thread that
+/// completes the first missing position, so no thread blocks waiting for its
+/// turn.
+class OrderedCompletion {
+ public:
+  OrderedCompletion(): num_reserved_(0), num_completed_(0),
+                       completing_(false) { }
+
+  /// Returns the next position.
+  int64 Reserve();
+
+  /// 'finish' is called once those of all the earlier positions have been
+  /// called, never at the same time as another one; this may be in this call
+  /// or in a later call to Complete() from another thread.
+  void Complete(int64 position, std::function<void()> finish);
+
+  /// Waits until the functions of all the reserved positions have been called
+  /// (running queued jobs of ThreadPool::Global() meanwhile).
+  void Wait();
+
+  ~OrderedCompletion() { Wait(); }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int64 num_reserved_;
+  int64 num_completed_;
+  bool completing_;  // true while a thread is calling the functions.
+  std::map<int64, std::function<void()> > ready_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OrderedCompletion);
+};
+
+
 class MultiThreadable {
   // To create a function object that does part of the job, inherit from this
   // class, implement a copy constructor calling the default copy constructor
@@ -116,31 +245,42 @@ template<class C>
 class MultiThreader {
  public:
   MultiThreader(int32 num_threads, const C &c_in) :
-    threads_(std::max<int32>(1, num_threads)),
-    cvec_(std::max<int32>(1, num_threads), c_in) {
+    cvec_(std::max<int32>(1, num_threads), c_in), num_running_(0) {
     if (num_threads == 0) {
       // This is a special case with num_threads == 0, which behaves like with
-      // num_threads == 1 but without creating extra threads.  This can be
+      // num_threads == 1 but without using other threads.  This can be
       // useful in GPU computations where threads cannot be used.
       cvec_[0].thread_id_ = 0;
       cvec_[0].num_threads_ = 1;
       (cvec_[0])();
     } else {
-      for (int32 i = 0; i < threads_.size(); i++) {
+      ThreadPool &pool = ThreadPool::Global();
+      pool.EnsureThreads(cvec_.size());
+      num_running_ = cvec_.size();
+      for (int32 i = 0; i < cvec_.size(); i++) {
         cvec_[i].thread_id_ = i;
-        cvec_[i].num_threads_ = threads_.size();
-        threads_[i] = std::thread(std::ref(cvec_[i]));
+        cvec_[i].num_threads_ = cvec_.size();
+        pool.Submit([this, i] () {
+            (cvec_[i])();
+            std::lock_guard<std::mutex> lock(mutex_);
+            // notify with the lock held, we may be destroyed once it is
+            // released.
+            if (--num_running_ == 0)
+              done_.notify_all();
+          });
       }
     }
   }
   ~MultiThreader() {
-    for (size_t i = 0; i < threads_.size(); i++)
-      if (threads_[i].joinable())
-        threads_[i].join();
+    std::unique_lock<std::mutex> lock(mutex_);
+    ThreadPool::Global().HelpUntil(&lock, &done_,
+                                   [this] () { return num_running_ == 0; });
   }
  private:
-  std::vector<std::thread> threads_;
   std::vector<C> cvec_;
+  int32 num_running_;
+  std::mutex mutex_;
+  std::condition_variable done_;
 };
 
 /// Here, class C should inherit from MultiThreadable.  Note: if you want to
@@ -177,11 +317,12 @@ class TaskSequencer {
       num_threads_(config.num_threads),
       threads_avail_(config.num_threads),
       tot_threads_avail_(config.num_threads_total > 0 ? config.num_threads_total :
-                         config.num_threads + 20),
-      thread_list_(NULL) {
+                         config.num_threads + 20) {
     KALDI_ASSERT((config.num_threads_total <= 0 ||
                   config.num_threads_total >= config.num_threads) &&
                  "num-threads-total, if specified, must be >= num-threads");
+    if (num_threads_ > 0)
+      ThreadPool::Global().EnsureThreads(num_threads_);
   }
 
   /// This function takes ownership of the pointer "c", and will delete it
@@ -195,79 +336,32 @@ class TaskSequencer {
     }
 
     threads_avail_.Wait(); // wait till we have a thread for computation free.
-    tot_threads_avail_.Wait(); // this ensures we don't have too many threads
+    tot_threads_avail_.Wait(); // this ensures we don't have too many jobs
     // waiting on I/O, and consume too much memory.
 
-    // put the new RunTaskArgsList object at head of the singly
-    // linked list thread_list_.
-    thread_list_ = new RunTaskArgsList(this, c, thread_list_);
-    thread_list_->thread = std::thread(TaskSequencer<C>::RunTask,
-                                       thread_list_);
+    int64 position = completion_.Reserve();
+    ThreadPool::Global().Submit([this, c, position] () {
+        (*c)();  // does the computation.
+        threads_avail_.Signal();  // lets the next job start.
+        // the destructor may cause some output, e.g. to a stream;
+        // completion_ calls them one at a time and in the order of Run().
+        completion_.Complete(position, [this, c] () {
+            delete c;
+            tot_threads_avail_.Signal();
+          });
+      });
   }
 
   void Wait() { // You call this at the end if it's more convenient
     // than waiting for the destructor.  It waits for all tasks to finish.
-    if (thread_list_ != NULL) {
-      thread_list_->thread.join();
-      KALDI_ASSERT(thread_list_->tail == NULL); // thread would not
-      // have exited without setting tail to NULL.
-      delete thread_list_;
-      thread_list_ = NULL;
-    }
+    completion_.Wait();
   }
 
-  /// The destructor waits for the last thread to exit.
+  /// The destructor waits for the last task to be deleted.
   ~TaskSequencer() {
     Wait();
   }
  private:
-  struct RunTaskArgsList {
-    TaskSequencer *me; // Think of this as a "this" pointer.
-    C *c; // Clist element of the task we're expected
-    std::thread thread;
-    RunTaskArgsList *tail;
-    RunTaskArgsList(TaskSequencer *me, C *c, RunTaskArgsList *tail):
-        me(me), c(c), tail(tail) {}
-  };
-  // This static function gets run in the threads that we create.
-  static void RunTask(RunTaskArgsList *args) {
-    // (1) run the job.
-    (*(args->c))(); // call operator () on args->c, which does the computation.
-    args->me->threads_avail_.Signal(); // Signal that the compute-intensive
-    // part of the thread is done (we want to run no more than
-    // config_.num_threads of these.)
-
-    // (2) we want to destroy the object "c" now, by deleting it.  But for
-    //     correct sequencing (this is the whole point of this class, it
-    //     is intended to ensure the output of the program is in correct order),
-    //     we first wait till the previous thread, whose details will be in "tail",
-    //     is finished.
-    if (args->tail != NULL) {
-      args->tail->thread.join();
-    }
-
-    delete args->c; // delete the object "c".  This may cause some output,
-    // e.g. to a stream.  We don't need to worry about concurrent access to
-    // the output stream, because each thread waits for the previous thread
-    // to be done, before doing this.  So there is no risk of concurrent
-    // access.
-    args->c = NULL;
-
-    if (args->tail != NULL) {
-      KALDI_ASSERT(args->tail->tail == NULL); // Because we already
-      // did join on args->tail->thread, which means that
-      // thread was done, and before it exited, it would have
-      // deleted and set to NULL its tail (which is the next line of code).
-      delete args->tail;
-      args->tail = NULL;
-    }
-    // At this point we are exiting from the thread.  Signal the
-    // "tot_threads_avail_" semaphore which is used to limit the total number of threads that are alive, including
-    // not onlhy those that are in active computation in c->operator (), but those
-    // that are waiting on I/O or other threads.
-    args->me->tot_threads_avail_.Signal();
-  }
-
   int32 num_threads_; // copy of config.num_threads (since Semaphore doesn't store original count)
 
   Semaphore threads_avail_; // Initialized to the number of threads we are
@@ -275,8 +369,9 @@ class TaskSequencer {
 
   Semaphore tot_threads_avail_; // We use this semaphore to ensure we don't
   // consume too much memory...
-  RunTaskArgsList *thread_list_;
 
+  // must be after the semaphores, as its destructor waits for the jobs.
+  OrderedCompletion completion_;
 };
 
 } // namespace kaldi
@@ -393,6 +393,8 @@ int ParseOptions::Read(int argc, const char *const argv[]) {
     strm << '\n';
     std::cerr << strm.str() << std::flush;
   }
+  if (!profile_output_.empty())
+    EnableProfiler(profile_output_);
   return i;
 }
 
@@ -0,0 +1,88 @@
+// util/spsc-ring-buffer-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+
+#include "util/spsc-ring-buffer.h"
+
+namespace kaldi {
+
+void TestSpscRingBuffer() {
+  SpscRingBuffer<int32> buffer(10);
+  KALDI_ASSERT(buffer.Size() == 0 && buffer.FreeSpace() >= 10);
+  std::vector<int32> elements(100);
+  for (size_t i = 0; i < elements.size(); i++)
+    elements[i] = i;
+  size_t free_space = buffer.FreeSpace();
+  KALDI_ASSERT(buffer.Write(&(elements[0]), 100) == free_space);
+  KALDI_ASSERT(buffer.Size() == free_space && buffer.FreeSpace() == 0);
+  std::vector<int32> read(100);
+  KALDI_ASSERT(buffer.Read(&(read[0]), 3) == 3);
+  KALDI_ASSERT(read[0] == 0 && read[1] == 1 && read[2] == 2);
+  KALDI_ASSERT(buffer.FreeSpace() == 3);
+  KALDI_ASSERT(buffer.Write(&(elements[free_space]), 100) == 3);
+  KALDI_ASSERT(buffer.Read(&(read[0]), 100) == free_space);
+  for (size_t i = 0; i < free_space; i++)
+    KALDI_ASSERT(read[i] == static_cast<int32>(i + 3));
+  KALDI_ASSERT(buffer.Size() == 0);
+}
+
+// one thread writes a sequence in pieces of random size while the other
+// reads it.
+void TestSpscRingBufferThreads() {
+  const int32 n = 100000;
+  SpscRingBuffer<int32> buffer(RandInt(1, 1000));
+  std::thread writer([&buffer]() {
+      std::vector<int32> piece(100);
+      int32 next = 0;
+      while (next < n) {
+        int32 size = std::min<int32>(RandInt(1, 100), n - next);
+        for (int32 i = 0; i < size; i++)
+          piece[i] = next + i;
+        int32 written = 0;
+        while (written < size) {
+          size_t num_written = buffer.Write(&(piece[written]), size - written);
+          if (num_written == 0) std::this_thread::yield();
+          written += num_written;
+        }
+        next += size;
+      }
+    });
+  std::vector<int32> piece(100);
+  int32 next = 0;
+  while (next < n) {
+    size_t num_read = buffer.Read(&(piece[0]), RandInt(1, 100));
+    if (num_read == 0) std::this_thread::yield();
+    for (size_t i = 0; i < num_read; i++)
+      KALDI_ASSERT(piece[i] == next++);
+  }
+  writer.join();
+  KALDI_ASSERT(buffer.Size() == 0);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestSpscRingBuffer();
+  for (int32 i = 0; i < 3; i++)
+    TestSpscRingBufferThreads();
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
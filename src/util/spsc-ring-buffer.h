@@ -0,0 +1,101 @@
+// util/spsc-ring-buffer.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_SPSC_RING_BUFFER_H_
+#define KALDI_UTIL_SPSC_RING_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   A fixed size queue of elements that one thread writes to and another reads
+   from, with no locks: each side only changes its own position, which it
+   publishes to the other with an atomic store (release), and sees the other's
+   with an atomic load (acquire).  With more than one thread writing or
+   reading it is not safe.  T should be a simple type, e.g. int16 for audio
+   samples.
+*/
+template<class T>
+class SpscRingBuffer {
+ public:
+  /// The buffer holds up to "capacity" elements (rounded up to a power of
+  /// two).
+  explicit SpscRingBuffer(size_t capacity): read_pos_(0), write_pos_(0) {
+    size_t size = 1;
+    while (size < capacity + 1) size *= 2;
+    data_.resize(size);
+    mask_ = size - 1;
+  }
+
+  /// The number of elements that can be written now.  Called by the writer.
+  size_t FreeSpace() const {
+    size_t read_pos = read_pos_.load(std::memory_order_acquire),
+        write_pos = write_pos_.load(std::memory_order_relaxed);
+    return mask_ - ((write_pos - read_pos) & mask_);
+  }
+
+  /// The number of elements that can be read now.  Called by the reader.
+  size_t Size() const {
+    size_t write_pos = write_pos_.load(std::memory_order_acquire),
+        read_pos = read_pos_.load(std::memory_order_relaxed);
+    return (write_pos - read_pos) & mask_;
+  }
+
+  /// Writes as many of the n elements as there is space for, and returns how
+  /// many that was.  Called by the writer.
+  size_t Write(const T *elements, size_t n) {
+    n = std::min(n, FreeSpace());
+    size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++)
+      data_[(write_pos + i) & mask_] = elements[i];
+    write_pos_.store((write_pos + n) & mask_, std::memory_order_release);
+    return n;
+  }
+
+  /// Reads up to n elements, and returns how many were read.  Called by the
+  /// reader.
+  size_t Read(T *elements, size_t n) {
+    n = std::min(n, Size());
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++)
+      elements[i] = data_[(read_pos + i) & mask_];
+    read_pos_.store((read_pos + n) & mask_, std::memory_order_release);
+    return n;
+  }
+
+ private:
+  std::vector<T> data_;
+  size_t mask_;
+  // the positions are kept apart so that the two threads don't share a cache
+  // line for them.
+  std::atomic<size_t> read_pos_;
+  char padding_[64];
+  std::atomic<size_t> write_pos_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SpscRingBuffer);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_SPSC_RING_BUFFER_H_